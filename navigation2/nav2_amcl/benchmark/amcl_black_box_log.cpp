@@ -0,0 +1,119 @@
+/*
+ *  Player - One Hell of a Robot Server
+ *  Copyright (C) 2000  Brian Gerkey   &  Kasper Stoy
+ *                      gerkey@usc.edu    kaspers@robotics.usc.edu
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+// Turns what AMCL recorded in a black box (see nav2_util/black_box.hpp) into a
+// log for amcl_replay_benchmark, which stays free of ROS: the laser's mounting,
+// and each scan after the odometric pose it was taken at. There is no ground
+// truth in a black box, so the replay reports no pose error.
+//
+// Usage:
+//   amcl_black_box_log <black box> <log>
+
+#include <cmath>
+#include <cstdio>
+
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav2_util/black_box.hpp"
+#include "sensor_msgs/msg/laser_scan.hpp"
+
+static double yawOf(const geometry_msgs::msg::Quaternion & q)
+{
+  return std::atan2(2.0 * (q.w * q.z + q.x * q.y), 1.0 - 2.0 * (q.y * q.y + q.z * q.z));
+}
+
+static double secondsOf(const builtin_interfaces::msg::Time & stamp)
+{
+  return stamp.sec + stamp.nanosec * 1e-9;
+}
+
+int main(int argc, char ** argv)
+{
+  if (argc != 3) {
+    fprintf(stderr, "Usage: amcl_black_box_log <black box> <log>\n");
+    return 1;
+  }
+
+  nav2_util::BlackBoxLog black_box;
+  if (!black_box.read(argv[1])) {
+    fprintf(stderr, "Could not read the black box %s\n", argv[1]);
+    return 1;
+  }
+  const int scan_channel = black_box.find("amcl/scan");
+  const int odom_channel = black_box.find("amcl/odom_pose");
+  const int laser_channel = black_box.find("amcl/laser_pose");
+  if (scan_channel < 0 || odom_channel < 0) {
+    fprintf(stderr, "%s has no AMCL scans\n", argv[1]);
+    return 1;
+  }
+
+  FILE * log = fopen(argv[2], "w");
+  if (!log) {
+    fprintf(stderr, "Could not write %s\n", argv[2]);
+    return 1;
+  }
+  fprintf(log, "# from the black box %s\n", argv[1]);
+
+  // AMCL records the odometric pose right after each scan; the mounting of the
+  // laser is only recorded when AMCL first sees it, and may have been
+  // overwritten since
+  bool has_laser_pose = false;
+  sensor_msgs::msg::LaserScan scan;
+  bool pending_scan = false;
+  int scans = 0;
+  for (const auto & record : black_box.records()) {
+    const int channel = static_cast<int>(record.channel);
+    if (channel == laser_channel && !has_laser_pose) {
+      geometry_msgs::msg::PoseStamped laser_pose;
+      if (nav2_util::BlackBoxLog::deserialize(record, laser_pose)) {
+        fprintf(log, "laser_pose %.6f %.6f %.6f\n", laser_pose.pose.position.x,
+          laser_pose.pose.position.y, yawOf(laser_pose.pose.orientation));
+        has_laser_pose = true;
+      }
+    } else if (channel == scan_channel) {
+      pending_scan = nav2_util::BlackBoxLog::deserialize(record, scan);
+    } else if (channel == odom_channel && pending_scan) {
+      geometry_msgs::msg::PoseStamped odom;
+      if (!nav2_util::BlackBoxLog::deserialize(record, odom)) {
+        continue;
+      }
+      double t = secondsOf(scan.header.stamp);
+      fprintf(log, "odom %.6f %.6f %.6f %.6f\n", t, odom.pose.position.x,
+        odom.pose.position.y, yawOf(odom.pose.orientation));
+      fprintf(log, "scan %.6f %.6f %.6f %.6f %.9f %zu", t, scan.range_min, scan.range_max,
+        scan.angle_min, scan.angle_increment, scan.ranges.size());
+      for (float range : scan.ranges) {
+        // the log is read with >>, which takes no inf or nan; AMCL treats both as no return
+        fprintf(log, " %.4f", std::isfinite(range) ? range : scan.range_max);
+      }
+      fprintf(log, "\n");
+      pending_scan = false;
+      ++scans;
+    }
+  }
+  fclose(log);
+
+  if (!has_laser_pose) {
+    fprintf(stderr, "The laser's mounting was not in the black box; taking it to be at the "
+      "base\n");
+  }
+  printf("%d scans written to %s\n", scans, argv[2]);
+  return 0;
+}
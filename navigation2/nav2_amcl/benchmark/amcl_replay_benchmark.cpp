@@ -0,0 +1,576 @@
+/*
+ *  Player - One Hell of a Robot Server
+ *  Copyright (C) 2000  Brian Gerkey   &  Kasper Stoy
+ *                      gerkey@usc.edu    kaspers@robotics.usc.edu
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+// Replays scans and odometry through the particle filter and the laser models,
+// without ROS, and reports per-stage timing, particles per second and the pose
+// error against ground truth for every combination of the swept settings.
+//
+// Usage:
+//   amcl_replay_benchmark --map <pgm> [--resolution <m/cell>] [--log <file> | --synthetic <scans>]
+//     [--particles <n,...>] [--models <name,...>] [--beams <n,...>] [--threads <n>]
+//     [--seed <n>] [--update-min-d <m>] [--update-min-a <rad>]
+//
+// The map is a binary PGM read with map_server's default thresholds, centred
+// on the origin.  A log holds one record per line:
+//   laser_pose <x> <y> <yaw>          laser mounting in the base frame
+//   odom <t> <x> <y> <yaw>            odometric pose of the base
+//   truth <t> <x> <y> <yaw>           ground truth pose of the base in the map
+//   scan <t> <range_min> <range_max> <angle_min> <angle_increment> <n> <range>...
+// Each scan is paired with the latest odom and truth records at or before it.
+// Without a log, --synthetic simulates a run of that many scans on the map.
+// nav2_util's synthetic_map writes large maps to simulate on from a seeded
+// spec, e.g. "synthetic_map corridors:8000x8000:seed=2 /tmp/office".
+// amcl_black_box_log writes a log from what AMCL recorded in a black box.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "nav2_amcl/angleutils.hpp"
+#include "nav2_amcl/map/map.hpp"
+#include "nav2_amcl/motion_model/motion_model.hpp"
+#include "nav2_amcl/pf/pf.hpp"
+#include "nav2_amcl/sensors/laser/laser.hpp"
+#include "nav2_amcl/stage_latency.hpp"
+
+using nav2_amcl::angleutils;
+
+namespace
+{
+
+struct Scan
+{
+  double stamp;
+  double range_min;
+  double range_max;
+  double angle_min;
+  double angle_increment;
+  std::vector<double> ranges;
+  pf_vector_t odom;
+  pf_vector_t truth;
+  bool has_truth;
+};
+
+struct Run
+{
+  pf_vector_t laser_pose;
+  std::vector<Scan> scans;
+};
+
+struct Options
+{
+  std::string map_file;
+  double resolution{0.05};
+  std::string log_file;
+  int synthetic{0};
+  std::vector<int> particles{2000};
+  std::vector<std::string> models{"likelihood_field"};
+  std::vector<int> beams{60};
+  int threads{1};
+  int seed{1};
+  double update_min_d{0.25};
+  double update_min_a{0.2};
+};
+
+// Node defaults for the sensor and motion models
+const double z_hit = 0.5;
+const double z_short = 0.05;
+const double z_max = 0.05;
+const double z_rand = 0.5;
+const double sigma_hit = 0.2;
+const double lambda_short = 0.1;
+const double max_occ_dist = 2.0;
+const double alpha = 0.2;
+
+pf_vector_t make_pose(double x, double y, double yaw)
+{
+  pf_vector_t p = pf_vector_zero();
+  p.v[0] = x;
+  p.v[1] = y;
+  p.v[2] = yaw;
+  return p;
+}
+
+template<typename T>
+std::vector<T> parse_list(const std::string & arg)
+{
+  std::vector<T> values;
+  std::stringstream ss(arg);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    std::stringstream is(item);
+    T value;
+    is >> value;
+    values.push_back(value);
+  }
+  return values;
+}
+
+bool parse_options(int argc, char ** argv, Options & options)
+{
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      fprintf(stderr, "Missing value for %s\n", arg.c_str());
+      return false;
+    }
+    std::string value = argv[++i];
+    if (arg == "--map") {
+      options.map_file = value;
+    } else if (arg == "--resolution") {
+      options.resolution = atof(value.c_str());
+    } else if (arg == "--log") {
+      options.log_file = value;
+    } else if (arg == "--synthetic") {
+      options.synthetic = atoi(value.c_str());
+    } else if (arg == "--particles") {
+      options.particles = parse_list<int>(value);
+    } else if (arg == "--models") {
+      options.models = parse_list<std::string>(value);
+    } else if (arg == "--beams") {
+      options.beams = parse_list<int>(value);
+    } else if (arg == "--threads") {
+      options.threads = atoi(value.c_str());
+    } else if (arg == "--seed") {
+      options.seed = atoi(value.c_str());
+    } else if (arg == "--update-min-d") {
+      options.update_min_d = atof(value.c_str());
+    } else if (arg == "--update-min-a") {
+      options.update_min_a = atof(value.c_str());
+    } else {
+      fprintf(stderr, "Unknown option %s\n", arg.c_str());
+      return false;
+    }
+  }
+  if (options.map_file.empty() || (options.log_file.empty() && options.synthetic <= 0)) {
+    fprintf(stderr, "Usage: %s --map <pgm> [--resolution <m/cell>] "
+      "[--log <file> | --synthetic <scans>] [--particles <n,...>] [--models <name,...>] "
+      "[--beams <n,...>] [--threads <n>] [--seed <n>] [--update-min-d <m>] "
+      "[--update-min-a <rad>]\n", argv[0]);
+    return false;
+  }
+  return true;
+}
+
+// Read a binary PGM the way map_server does with its default thresholds
+// (occupied above 0.65, free below 0.196, unknown in between)
+bool load_map(const std::string & filename, double resolution, map_t * map)
+{
+  std::ifstream file(filename, std::ios::binary);
+  std::string magic;
+  if (!(file >> magic) || magic != "P5") {
+    return false;
+  }
+  int header[3];
+  for (int k = 0; k < 3; k++) {
+    file >> std::ws;
+    while (file.peek() == '#') {
+      std::string comment;
+      std::getline(file, comment);
+      file >> std::ws;
+    }
+    if (!(file >> header[k])) {
+      return false;
+    }
+  }
+  file.get();
+
+  map->size_x = header[0];
+  map->size_y = header[1];
+  map->scale = resolution;
+  map_alloc_cells(map, MAP_LAYOUT_CELLS, 0);
+  std::vector<unsigned char> row(map->size_x);
+  for (int j = map->size_y - 1; j >= 0; j--) {
+    if (!file.read(reinterpret_cast<char *>(row.data()), row.size())) {
+      return false;
+    }
+    for (int i = 0; i < map->size_x; i++) {
+      double occ = (header[2] - row[i]) / static_cast<double>(header[2]);
+      map_set_occ_state(map, MAP_INDEX(map, i, j), occ > 0.65 ? +1 : (occ < 0.196 ? -1 : 0));
+    }
+  }
+  return true;
+}
+
+bool load_log(const std::string & filename, Run & run)
+{
+  std::ifstream file(filename);
+  if (!file) {
+    fprintf(stderr, "Could not open %s\n", filename.c_str());
+    return false;
+  }
+  run.laser_pose = pf_vector_zero();
+  pf_vector_t odom = pf_vector_zero();
+  pf_vector_t truth = pf_vector_zero();
+  bool has_odom = false;
+  bool has_truth = false;
+  std::string line;
+  while (std::getline(file, line)) {
+    std::stringstream ss(line);
+    std::string type;
+    if (!(ss >> type) || type[0] == '#') {
+      continue;
+    }
+    double t;
+    if (type == "laser_pose") {
+      ss >> run.laser_pose.v[0] >> run.laser_pose.v[1] >> run.laser_pose.v[2];
+    } else if (type == "odom") {
+      ss >> t >> odom.v[0] >> odom.v[1] >> odom.v[2];
+      has_odom = true;
+    } else if (type == "truth") {
+      ss >> t >> truth.v[0] >> truth.v[1] >> truth.v[2];
+      has_truth = true;
+    } else if (type == "scan") {
+      Scan scan;
+      int count;
+      ss >> scan.stamp >> scan.range_min >> scan.range_max >> scan.angle_min >>
+      scan.angle_increment >> count;
+      scan.ranges.resize(count);
+      for (int i = 0; i < count; i++) {
+        ss >> scan.ranges[i];
+      }
+      if (!ss || !has_odom) {
+        continue;
+      }
+      scan.odom = odom;
+      scan.truth = truth;
+      scan.has_truth = has_truth;
+      run.scans.push_back(scan);
+    }
+  }
+  return !run.scans.empty();
+}
+
+// Range to the first occupied cell along a ray; unlike map_calc_range, unknown
+// cells do not stop it, as they would not stop a real laser
+double cast_ray(map_t * map, double ox, double oy, double oa, double max_range)
+{
+  double step = map->scale / 4;
+  double c = cos(oa) * step;
+  double s = sin(oa) * step;
+  for (double range = 0.0; range < max_range; range += step) {
+    int i = MAP_GXWX(map, ox);
+    int j = MAP_GYWY(map, oy);
+    if (!MAP_VALID(map, i, j)) {
+      break;
+    }
+    if (map_occ_state(map, MAP_INDEX(map, i, j)) == +1) {
+      return range;
+    }
+    ox += c;
+    oy += s;
+  }
+  return max_range;
+}
+
+// Drive around the free space of the map, ray casting a 360 beam scan every
+// 5 cm with a little range noise, and integrate noisy odometry along the way
+void simulate_run(map_t * map, map_free_space_t * free_space, int scan_count, int seed, Run & run)
+{
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> range_noise(0.0, 0.01);
+  std::normal_distribution<double> odom_noise(0.0, 0.02);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  auto clearance = [map](double x, double y) {
+      int i = MAP_GXWX(map, x);
+      int j = MAP_GYWY(map, y);
+      if (!MAP_VALID(map, i, j) || map_occ_state(map, MAP_INDEX(map, i, j)) != -1) {
+        return 0.0;
+      }
+      return map_occ_dist(map, MAP_INDEX(map, i, j));
+    };
+
+  // Start somewhere with room to move
+  pf_vector_t truth = pf_vector_zero();
+  for (int tries = 0; tries < 10000; tries++) {
+    int i, j;
+    map_free_space_cell(free_space, static_cast<int>(uniform(rng) * free_space->cell_count),
+      &i, &j);
+    truth = make_pose(MAP_WXGX(map, i), MAP_WYGY(map, j), uniform(rng) * 2 * M_PI - M_PI);
+    if (clearance(truth.v[0], truth.v[1]) > 0.5) {
+      break;
+    }
+  }
+
+  run.laser_pose = pf_vector_zero();
+  pf_vector_t odom = truth;
+  const double step = 0.05;
+  const double range_max = 12.0;
+  const int beam_count = 360;
+  for (int k = 0; k < scan_count; k++) {
+    // Turn away from obstacles, otherwise drift slowly
+    double turn = (uniform(rng) - 0.5) * 0.1;
+    double heading = truth.v[2] + turn;
+    while (clearance(truth.v[0] + 4 * step * cos(heading),
+      truth.v[1] + 4 * step * sin(heading)) < 0.3)
+    {
+      heading = truth.v[2] + (uniform(rng) - 0.5) * 2 * M_PI;
+    }
+    double dx = step * cos(heading);
+    double dy = step * sin(heading);
+    double dyaw = angleutils::angle_diff(heading, truth.v[2]);
+    // Odometry sees the motion in the robot frame with some error
+    double c = cos(truth.v[2]);
+    double s = sin(truth.v[2]);
+    double fwd = (c * dx + s * dy) * (1.0 + odom_noise(rng));
+    double side = (-s * dx + c * dy) * (1.0 + odom_noise(rng));
+    double oc = cos(odom.v[2]);
+    double os = sin(odom.v[2]);
+    odom.v[0] += oc * fwd - os * side;
+    odom.v[1] += os * fwd + oc * side;
+    odom.v[2] = angleutils::normalize(odom.v[2] + dyaw * (1.0 + odom_noise(rng)));
+    truth = make_pose(truth.v[0] + dx, truth.v[1] + dy, angleutils::normalize(heading));
+
+    Scan scan;
+    scan.stamp = k * 0.1;
+    scan.range_min = 0.05;
+    scan.range_max = range_max;
+    scan.angle_min = -M_PI;
+    scan.angle_increment = 2 * M_PI / beam_count;
+    scan.ranges.resize(beam_count);
+    for (int b = 0; b < beam_count; b++) {
+      double bearing = truth.v[2] + scan.angle_min + b * scan.angle_increment;
+      double range = cast_ray(map, truth.v[0], truth.v[1], bearing, range_max);
+      scan.ranges[b] = range < range_max ? std::max(0.0, range + range_noise(rng)) : range_max;
+    }
+    scan.odom = odom;
+    scan.truth = truth;
+    scan.has_truth = true;
+    run.scans.push_back(scan);
+  }
+}
+
+map_free_space_t * g_free_space;
+
+pf_vector_t uniform_pose(void * arg)
+{
+  map_t * map = reinterpret_cast<map_t *>(arg);
+  int i, j;
+  map_free_space_cell(g_free_space, static_cast<int>(drand48() * g_free_space->cell_count),
+    &i, &j);
+  return make_pose(MAP_WXGX(map, i), MAP_WYGY(map, j), drand48() * 2 * M_PI - M_PI);
+}
+
+nav2_amcl::Laser * create_laser(
+  const std::string & model, int max_beams, int max_particles, map_t * map)
+{
+  if (model == "beam") {
+    return new nav2_amcl::BeamModel(z_hit, z_short, z_max, z_rand, sigma_hit, lambda_short,
+             0.0, max_beams, map);
+  } else if (model == "likelihood_field") {
+    return new nav2_amcl::LikelihoodFieldModel(z_hit, z_rand, sigma_hit, max_occ_dist,
+             max_beams, map);
+  } else if (model == "likelihood_field_batch") {
+    return new nav2_amcl::LikelihoodFieldModelBatch(z_hit, z_rand, sigma_hit, max_occ_dist,
+             max_beams, map);
+  } else if (model == "likelihood_field_gpu") {
+    return new nav2_amcl::LikelihoodFieldModelGPU(z_hit, z_rand, sigma_hit, max_occ_dist,
+             max_beams, map);
+  } else if (model == "likelihood_field_prob") {
+    return new nav2_amcl::LikelihoodFieldModelProb(z_hit, z_rand, sigma_hit, max_occ_dist,
+             false, 0.5, 0.3, 0.9, max_particles, max_beams, map);
+  }
+  return nullptr;
+}
+
+double seconds_since(const std::chrono::steady_clock::time_point & start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Run the filter over the whole run with one combination of settings
+void benchmark(
+  const Options & options, const Run & run, map_t * map,
+  const std::string & model, int max_particles, int max_beams)
+{
+  std::unique_ptr<nav2_amcl::Laser> laser(create_laser(model, max_beams, max_particles, map));
+  if (!laser) {
+    fprintf(stderr, "Unknown model %s\n", model.c_str());
+    return;
+  }
+  pf_vector_t laser_pose = make_pose(run.laser_pose.v[0], run.laser_pose.v[1], 0.0);
+  laser->SetLaserPose(laser_pose);
+
+  srand48(options.seed);
+  nav2_amcl::DifferentialMotionModel motion(alpha, alpha, alpha, alpha);
+  motion.setSeed(options.seed);
+
+  pf_t * pf = pf_alloc(std::min(500, max_particles), max_particles, 0.0, 0.0,
+      uniform_pose, map);
+  pf->pop_err = 0.05;
+  pf->pop_z = 0.99;
+  pf_set_sensor_threads(pf, options.threads);
+
+  const Scan & first = run.scans.front();
+  pf_vector_t init = first.has_truth ? first.truth : first.odom;
+  pf_matrix_t init_cov = pf_matrix_zero();
+  init_cov.m[0][0] = 0.5 * 0.5;
+  init_cov.m[1][1] = 0.5 * 0.5;
+  init_cov.m[2][2] = (M_PI / 12.0) * (M_PI / 12.0);
+  pf_init(pf, init, init_cov);
+
+  size_t window = run.scans.size();
+  nav2_amcl::StageLatency motion_time(window), sensor_time(window), resample_time(window);
+  double sensor_total = 0.0;
+  double particles_weighed = 0.0;
+  double error_sum = 0.0, error_max = 0.0, yaw_error_sum = 0.0;
+  int error_count = 0;
+  double final_error = 0.0;
+
+  pf_vector_t pf_odom_pose = first.odom;
+  bool initialized = false;
+  for (const Scan & scan : run.scans) {
+    pf_vector_t delta = pf_vector_zero();
+    delta.v[0] = scan.odom.v[0] - pf_odom_pose.v[0];
+    delta.v[1] = scan.odom.v[1] - pf_odom_pose.v[1];
+    delta.v[2] = angleutils::angle_diff(scan.odom.v[2], pf_odom_pose.v[2]);
+    bool update = !initialized || fabs(delta.v[0]) > options.update_min_d ||
+      fabs(delta.v[1]) > options.update_min_d || fabs(delta.v[2]) > options.update_min_a;
+    if (!update) {
+      continue;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (initialized) {
+      motion.odometryUpdate(pf, scan.odom, delta);
+    }
+    motion_time.add(seconds_since(start));
+    initialized = true;
+
+    nav2_amcl::LaserData ldata;
+    ldata.laser = laser.get();
+    ldata.range_count = scan.ranges.size();
+    ldata.range_max = scan.range_max;
+    ldata.allocate(ldata.range_count);
+    for (int i = 0; i < ldata.range_count; i++) {
+      ldata.ranges[i] = scan.ranges[i] <= scan.range_min ? scan.range_max : scan.ranges[i];
+      ldata.bearings[i] = run.laser_pose.v[2] + scan.angle_min + i * scan.angle_increment;
+    }
+    int sample_count = pf->sets[pf->current_set].sample_count;
+    start = std::chrono::steady_clock::now();
+    laser->sensorUpdate(pf, &ldata);
+    double elapsed = seconds_since(start);
+    sensor_time.add(elapsed);
+    sensor_total += elapsed;
+    particles_weighed += sample_count;
+
+    start = std::chrono::steady_clock::now();
+    pf_update_resample(pf);
+    resample_time.add(seconds_since(start));
+    pf_odom_pose = scan.odom;
+
+    if (!scan.has_truth) {
+      continue;
+    }
+    // Error of the heaviest cluster, as the node would publish it
+    double best_weight = -1.0;
+    pf_vector_t best = pf_vector_zero();
+    for (int c = 0; c < pf->sets[pf->current_set].cluster_count; c++) {
+      double weight;
+      pf_vector_t mean;
+      pf_matrix_t cov;
+      if (pf_get_cluster_stats(pf, c, &weight, &mean, &cov) && weight > best_weight) {
+        best_weight = weight;
+        best = mean;
+      }
+    }
+    final_error = hypot(best.v[0] - scan.truth.v[0], best.v[1] - scan.truth.v[1]);
+    error_sum += final_error;
+    error_max = std::max(error_max, final_error);
+    yaw_error_sum += fabs(angleutils::angle_diff(best.v[2], scan.truth.v[2]));
+    error_count++;
+  }
+
+  printf("%-24s %9d %5d %7zu %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f %12.0f",
+    model.c_str(), max_particles, max_beams, sensor_time.count(),
+    motion_time.percentile(0.5) * 1e3, sensor_time.percentile(0.5) * 1e3,
+    sensor_time.percentile(0.99) * 1e3, resample_time.percentile(0.5) * 1e3,
+    resample_time.percentile(0.99) * 1e3,
+    (motion_time.percentile(0.5) + sensor_time.percentile(0.5) +
+    resample_time.percentile(0.5)) * 1e3,
+    sensor_total > 0.0 ? particles_weighed / sensor_total : 0.0);
+  if (error_count > 0) {
+    printf(" %8.3f %8.3f %8.3f %8.3f\n", error_sum / error_count, error_max, final_error,
+      yaw_error_sum / error_count);
+  } else {
+    printf(" %8s %8s %8s %8s\n", "-", "-", "-", "-");
+  }
+
+  pf_free(pf);
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  Options options;
+  if (!parse_options(argc, argv, options)) {
+    return 1;
+  }
+
+  map_t * map = map_alloc();
+  if (!load_map(options.map_file, options.resolution, map)) {
+    fprintf(stderr, "Could not load map %s\n", options.map_file.c_str());
+    return 1;
+  }
+  map_update_cspace(map, max_occ_dist);
+  g_free_space = map_free_space_alloc(map);
+  if (g_free_space->cell_count == 0) {
+    fprintf(stderr, "The map has no free space\n");
+    return 1;
+  }
+
+  Run run;
+  if (!options.log_file.empty()) {
+    if (!load_log(options.log_file, run)) {
+      fprintf(stderr, "No usable scans in %s\n", options.log_file.c_str());
+      return 1;
+    }
+  } else {
+    simulate_run(map, g_free_space, options.synthetic, options.seed, run);
+  }
+
+  printf("%zu scans, %d x %d map, %d sensor thread(s)\n", run.scans.size(), map->size_x,
+    map->size_y, options.threads);
+  printf("%-24s %9s %5s %7s %8s %8s %8s %8s %8s %8s %12s %8s %8s %8s %8s\n",
+    "model", "particles", "beams", "updates", "mot50ms", "sen50ms", "sen99ms", "res50ms",
+    "res99ms", "tot50ms", "particles/s", "err_m", "max_m", "final_m", "yaw_rad");
+  for (const std::string & model : options.models) {
+    for (int particles : options.particles) {
+      for (int beams : options.beams) {
+        benchmark(options, run, map, model, particles, beams);
+      }
+    }
+  }
+
+  map_free_space_free(g_free_space);
+  map_free(map);
+  return 0;
+}
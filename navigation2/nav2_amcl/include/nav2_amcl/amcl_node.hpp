@@ -21,19 +21,38 @@
 #ifndef NAV2_AMCL__AMCL_NODE_HPP_
 #define NAV2_AMCL__AMCL_NODE_HPP_
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
 #include "geometry_msgs/msg/pose_array.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
+#include "geometry_msgs/msg/pose_with_covariance_stamped.hpp"
+#include "geometry_msgs/msg/transform_stamped.hpp"
 #include "message_filters/subscriber.h"
+#include "nav2_dynamic_params/dynamic_params_client.hpp"
 #include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/map_cache.hpp"
+#include "nav2_util/shared_map_registry.hpp"
+#include "nav2_util/transform_scheduler.hpp"
 #include "nav2_amcl/motion_model/motion_model.hpp"
+#include "nav2_amcl/particle_checkpoint.hpp"
+#include "nav2_amcl/sensors/laser/beam_selector.hpp"
 #include "nav2_amcl/sensors/laser/laser.hpp"
+#include "nav2_amcl/sensors/laser/scan_matcher.hpp"
+#include "nav2_amcl/spsc_ring.hpp"
+#include "nav2_amcl/stage_latency.hpp"
+#include "nav2_msgs/msg/particle_cloud.hpp"
 #include "nav_msgs/srv/set_map.hpp"
 #include "sensor_msgs/msg/laser_scan.hpp"
 #include "std_srvs/srv/empty.hpp"
@@ -43,7 +62,6 @@
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 #pragma GCC diagnostic ignored "-Wreorder"
-#include "tf2_ros/message_filter.h"
 #pragma GCC diagnostic pop
 
 #define NEW_UNIFORM_SAMPLING 1
@@ -54,7 +72,7 @@ namespace nav2_amcl
 class AmclNode : public nav2_util::LifecycleNode
 {
 public:
-  AmclNode();
+  explicit AmclNode(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   ~AmclNode();
 
 protected:
@@ -81,17 +99,31 @@ protected:
   // Map-related
   void mapReceived(const nav_msgs::msg::OccupancyGrid::SharedPtr msg);
   void handleMapMessage(const nav_msgs::msg::OccupancyGrid & msg);
-  void createFreeSpaceVector();
+  void createFreeSpaceIndex();
+  // Fill in the likelihood field distances of map, from map_cache_directory_ if possible
+  void loadOrComputeDistanceField(map_t * map);
   void freeMapDependentMemory();
   map_t * map_{nullptr};
   map_t * convertMap(const nav_msgs::msg::OccupancyGrid & map_msg);
+  // Convert map_msg and fill in its distance field, ready to become map_
+  std::shared_ptr<map_t> prepareMap(const nav_msgs::msg::OccupancyGrid & map_msg);
+  // prepareMap(), or with share_maps the map another node of the process prepared from the
+  // same cells, which is only ever read
+  std::shared_ptr<map_t> prepareSharedMap(const nav_msgs::msg::OccupancyGrid & map_msg);
+  std::shared_ptr<map_t> map_holder_;  // owns map_, which map_cache_ may share
+  // The maps prepared so far, and those the map server preloaded, prepared in the background
+  // so that switching to one of them skips computing its distance field
+  void cachedMapReceived(const nav_msgs::msg::OccupancyGrid::SharedPtr msg);
+  std::unique_ptr<nav2_util::MapCache<map_t>> map_cache_;
+  rclcpp::Subscription<nav_msgs::msg::OccupancyGrid>::ConstSharedPtr map_cache_sub_;
+  std::vector<std::future<void>> map_preparations_;
   bool first_map_only_{true};
   bool first_map_received_{false};
   amcl_hyp_t * initial_pose_hyp_;
   std::recursive_mutex configuration_mutex_;
   rclcpp::Subscription<nav_msgs::msg::OccupancyGrid>::ConstSharedPtr map_sub_;
 #if NEW_UNIFORM_SAMPLING
-  static std::vector<std::pair<int, int>> free_space_indices;
+  static map_free_space_t * free_space_;
 #endif
 
   // Transforms
@@ -107,8 +139,18 @@ protected:
   // Message filters
   void initMessageFilters();
   std::unique_ptr<message_filters::Subscriber<sensor_msgs::msg::LaserScan>> laser_scan_sub_;
-  std::unique_ptr<tf2_ros::MessageFilter<sensor_msgs::msg::LaserScan>> laser_scan_filter_;
+  // Holds scans until they can be transformed to the odom frame
+  std::shared_ptr<nav2_util::TransformScheduler> transform_scheduler_;
+  nav2_util::TransformScheduler::ChannelPtr laser_scan_channel_;
   message_filters::Connection laser_scan_connection_;
+  // Scans the scheduler dropped, for the queue being full or the transform never arriving
+  std::atomic<uint64_t> dropped_scans_{0};
+  nav2_util::Counter * dropped_scans_counter_;
+  // Black box channels for each scan, the odometry pose it was taken at, and the pose of
+  // each laser on the robot when first seen
+  int scan_channel_;
+  int odom_pose_channel_;
+  int laser_pose_channel_;
 
   // Publishers and subscribers
   void initPubSub();
@@ -117,9 +159,69 @@ protected:
   rclcpp_lifecycle::LifecyclePublisher<geometry_msgs::msg::PoseWithCovarianceStamped>::SharedPtr
     pose_pub_;
   rclcpp_lifecycle::LifecyclePublisher<geometry_msgs::msg::PoseArray>::SharedPtr particlecloud_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::ParticleCloud>::SharedPtr
+    compact_particlecloud_pub_;
   void initialPoseReceived(geometry_msgs::msg::PoseWithCovarianceStamped::SharedPtr msg);
   void laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan);
 
+  // Asynchronous publishing.  With async_publish, the scan callback fills a
+  // snapshot of what it would have published and hands it through
+  // publish_ring_ to publisher_thread_, which builds and sends the messages.
+  struct PublishSnapshot
+  {
+    bool has_transform{false};
+    geometry_msgs::msg::TransformStamped transform;
+    bool has_pose{false};
+    geometry_msgs::msg::PoseWithCovarianceStamped pose;
+    bool has_cloud{false};
+    rclcpp::Time cloud_stamp;
+    std::vector<pf_vector_t> particles;
+    std::vector<double> weights;
+  };
+  static const size_t PUBLISH_QUEUE_SIZE = 4;
+  void startPublisherThread();
+  void stopPublisherThread();
+  void publisherLoop();
+  SpscRing<PublishSnapshot> publish_ring_{PUBLISH_QUEUE_SIZE};
+  // Slot being filled by the current scan callback, if any
+  PublishSnapshot * pending_snapshot_{nullptr};
+  std::thread publisher_thread_;
+  std::atomic<bool> publisher_running_{false};
+  std::mutex publisher_wake_mutex_;
+  std::condition_variable publisher_wake_;
+  // Build and publish the particle clouds of a snapshot, on publisher_thread_
+  // with async_publish
+  void publishClouds(const PublishSnapshot & snapshot);
+  PublishSnapshot cloud_snapshot_;  // without async_publish
+  geometry_msgs::msg::PoseArray cloud_msg_;
+  nav2_msgs::msg::ParticleCloud compact_cloud_msg_;
+  std::vector<int> cloud_indices_;
+
+  // Per-stage latency diagnostics
+  enum Stage
+  {
+    STAGE_ODOM_TF,        // Odometry pose lookup
+    STAGE_MOTION_UPDATE,  // Motion model
+    STAGE_LASER_TF,       // Laser angle transforms
+    STAGE_SENSOR_UPDATE,  // Laser model
+    STAGE_RESAMPLE,       // Resampling, including the cluster statistics
+    STAGE_SCAN_MATCH,     // Refinement of the published pose (within the publish stage)
+    STAGE_PUBLISH,        // Hypotheses, pose, particle cloud and transform (only the
+                          // handoff to the publisher thread with async_publish)
+    STAGE_TOTAL,          // The whole scan callback
+    STAGE_COUNT
+  };
+  std::array<StageLatency, STAGE_COUNT> stage_latency_;
+  // The same durations in the process's metrics registry, as amcl.<stage>
+  std::array<nav2_util::LatencyHistogram *, STAGE_COUNT> stage_histograms_;
+  void recordStage(Stage stage, nav2_util::ExecutionTimer & timer);
+  int last_beam_count_{0};
+  void publishLatencyDiagnostics();
+  rclcpp_lifecycle::LifecyclePublisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr
+    diagnostics_pub_;
+  double latency_diagnostics_rate_;
+  rclcpp::Time last_diagnostics_time_;
+
   // Services and service callbacks
   void initServices();
   rclcpp::Service<std_srvs::srv::Empty>::SharedPtr global_loc_srv_;
@@ -140,6 +242,8 @@ protected:
 
   // Odometry
   void initOdometry();
+  // (Re)create motion_model_ for robot_model_type_, seeding it if random_seed is set
+  void createMotionModel();
   std::unique_ptr<nav2_amcl::MotionModel> motion_model_;
   geometry_msgs::msg::PoseStamped latest_odom_pose_;
   geometry_msgs::msg::PoseWithCovarianceStamped last_published_pose_;
@@ -156,6 +260,29 @@ protected:
   void initParticleFilter();
   // Pose-generating function used to uniformly distribute particles over the map
   static pf_vector_t uniformPoseGenerator(void * arg);
+  // Coarse-to-fine global localization: seed the filter with the uniform
+  // candidates that best match a scan on a downsampled likelihood field
+  bool seedGlobalLocalization(
+    const int & laser_index,
+    const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan);
+  void createCoarseField();
+  // Pose-generating function that hands out global_candidates_ in turn
+  static pf_vector_t candidatePoseGenerator(void * arg);
+  bool global_localization_pending_{false};
+  std::vector<float> coarse_field_;
+  int coarse_size_x_{0};
+  int coarse_size_y_{0};
+  std::vector<pf_vector_t> global_candidates_;
+  size_t next_candidate_{0};
+  // Checkpoints of the particles in checkpoint_file, written in the background, and the one
+  // read on activation, restored once its map is known
+  void saveCheckpoint(const pf_sample_set_t * set);
+  void loadCheckpoint();
+  bool restoreCheckpoint();
+  std::unique_ptr<ParticleCheckpoint> checkpoint_;
+  std::future<bool> checkpoint_write_;
+  std::chrono::steady_clock::time_point last_checkpoint_time_;
+  uint64_t map_id_{0};
   pf_t * pf_{nullptr};
   bool pf_init_;
   pf_vector_t pf_odom_pose_;
@@ -164,11 +291,21 @@ protected:
   // Laser scan related
   void initLaserScan();
   const char * scan_topic_{"scan"};
-  nav2_amcl::Laser * createLaserObject();
+  nav2_amcl::Laser * createLaserObject(int max_beams);
   int scan_error_count_{0};
   std::vector<nav2_amcl::Laser *> lasers_;
   std::vector<bool> lasers_update_;
   std::map<std::string, int> frame_to_laser_;
+  // The ranges and bearings of each laser's scans, by laser index
+  std::vector<nav2_amcl::ScanBuffer> scan_buffers_;
+  // Scans waiting to be fused, by laser index, and the model that evaluates
+  // them from the base origin
+  std::map<int, sensor_msgs::msg::LaserScan::ConstSharedPtr> pending_scans_;
+  std::unique_ptr<nav2_amcl::Laser> fused_laser_;
+  int fused_laser_beams_{0};
+  // Beam selection for adaptive_beams, and the measured laser model cost per beam
+  BeamSelector beam_selector_;
+  double sensor_time_per_beam_{0.0};
   rclcpp::Time last_laser_received_ts_;
   void checkLaserReceived();
   std::chrono::seconds laser_check_interval_;  // TODO(mjeronimo): not initialized
@@ -182,10 +319,27 @@ protected:
     const std::string & laser_scan_frame_id,
     geometry_msgs::msg::PoseStamped & laser_pose);
   bool shouldUpdateFilter(const pf_vector_t pose, pf_vector_t & delta);
+  // Convert a scan into ranges and base frame bearings for the given laser
+  bool scanToLaserData(
+    const int & laser_index,
+    const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan,
+    nav2_amcl::LaserData & ldata);
+  // Endpoints of max_beams_ evenly spaced beams, in the base frame
+  void scanEndpoints(
+    const int & laser_index, const nav2_amcl::LaserData & ldata,
+    std::vector<std::array<double, 2>> & endpoints);
+  // Correlative scan matching of a scan around the pose of the best hypothesis
+  bool refinePose(
+    const int & laser_index,
+    const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan,
+    pf_vector_t & pose);
+  ScanMatcher scan_matcher_;
   bool updateFilter(
     const int & laser_index,
     const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan,
     const pf_vector_t & pose);
+  // Update the filter with all of pending_scans_ in one sensor pass
+  bool updateFilterFused(const pf_vector_t & pose);
   void publishParticleCloud(const pf_sample_set_t * set);
   bool getMaxWeightHyp(
     std::vector<amcl_hyp_t> & hyps, amcl_hyp_t & max_weight_hyps,
@@ -207,6 +361,14 @@ protected:
   double initial_pose_z_;
   double initial_pose_yaw_;
 
+  // Live tuning: changes to the parameters in the tunable table of amcl_node.cpp are collected
+  // from the parameter events, and at the start of the next laser update only the parts of the
+  // filter they affect are recomputed
+  void initDynamicParameters();
+  void applyReconfiguration();
+  std::unique_ptr<nav2_dynamic_params::DynamicParamsClient> dynamic_params_client_;
+  std::atomic<unsigned> pending_reconfiguration_{0};  ///< Reconfiguration flags, or 0
+
   // Node parameters (initialized via initParameters)
   void initParameters();
   double alpha1_;
@@ -218,25 +380,59 @@ protected:
   double beam_skip_distance_;
   double beam_skip_error_threshold_;
   double beam_skip_threshold_;
+  std::string checkpoint_file_;
+  double checkpoint_max_age_;
+  double checkpoint_rate_;
   bool do_beamskip_;
+  bool fuse_scans_;
+  double scan_fusion_window_;
+  std::string distance_transform_;
   std::string global_frame_id_;
+  bool global_localization_coarse_;
+  int global_localization_candidates_;
+  int global_localization_downsample_;
+  bool latest_scan_only_;
   double lambda_short_;
   double laser_likelihood_max_dist_;
   double laser_max_range_;
   double laser_min_range_;
   std::string sensor_model_type_;
+  bool use_hit_prob_table_;
+  bool compact_map_;
+  int map_tile_shift_;
+  std::string map_cache_directory_;
+  int map_cache_size_;
+  bool share_maps_{false};
+  bool shared_distance_field_{false};
   int max_beams_;
   int max_particles_;
   int min_particles_;
   std::string odom_frame_id_;
   double pf_err_;
   double pf_z_;
+  std::string particle_histogram_;
+  int particle_cloud_max_particles_;
+  double particle_cloud_rate_;
+  std::string particle_cloud_sampling_;
+  rclcpp::Time last_particle_cloud_time_;
+  int random_seed_;
   double alpha_fast_;
   double alpha_slow_;
   int resample_interval_;
+  double resample_ess_threshold_;
+  std::string resample_method_;
   std::string robot_model_type_;
   tf2::Duration save_pose_period_;
+  bool scan_match_refinement_;
+  double scan_match_angular_window_;
+  double scan_match_linear_window_;
+  double scan_match_min_score_;
+  bool async_publish_;
   double sigma_hit_;
+  int sensor_update_threads_;
+  bool adaptive_beams_;
+  int adaptive_min_beams_;
+  double sensor_time_budget_;
   bool tf_broadcast_;
   tf2::Duration transform_tolerance_;
   double a_thresh_;
@@ -41,6 +41,14 @@ struct _rtk_fig_t;
 // Limits
 #define MAP_WIFI_MAX_LEVELS 8
 
+// Cell storage layouts
+#define MAP_LAYOUT_CELLS 0    // one map_cell_t per cell
+#define MAP_LAYOUT_COMPACT 1  // separate occ_state and fixed point occ_dist planes
+
+// Distance transforms for map_update_cspace
+#define MAP_CSPACE_BRUSHFIRE 0  // priority queue brushfire from the obstacles
+#define MAP_CSPACE_EDT 1        // exact, linear time separable Euclidean transform
+
 
 // Description for a single map cell.
 typedef struct
@@ -68,12 +76,46 @@ typedef struct
   // Map dimensions (number of cells)
   int size_x, size_y;
 
-  // The map data, stored as a grid
+  // The map data, stored as a grid (MAP_LAYOUT_CELLS only, NULL otherwise)
   map_cell_t * cells;
 
+  // The map data as separate planes (MAP_LAYOUT_COMPACT only, NULL otherwise).
+  // occ_dist is stored in units of occ_dist_res, which map_update_cspace sets
+  // so that max_occ_dist is the largest representable distance.
+  int8_t * occ_state_plane;
+  uint16_t * occ_dist_plane;
+  double occ_dist_res;
+
+  // Cells are stored in square tiles of 2^tile_shift cells per side, tiles_x
+  // tiles per row, so that neighbouring cells share cache lines.  A tile_shift
+  // of zero is plain row-major order.
+  int tile_shift;
+  int tiles_x;
+
   // Max distance at which we care about obstacles, for constructing
   // likelihood field
   double max_occ_dist;
+
+  // Optional per-cell Gaussian hit probability, exp(-occ_dist^2 / (2 sigma^2)),
+  // built by map_update_hit_prob for the sigma in hit_prob_sigma.  A sigma of
+  // zero means the table is stale.
+  float * hit_prob;
+  double hit_prob_sigma;
+
+  // Distance transform used by map_update_cspace, and the number of threads the
+  // EDT may use
+  int cspace_method;
+  int cspace_threads;
+
+  // Set once the cspace distances are up to date for max_occ_dist, so that
+  // map_update_cspace can skip recomputing them
+  int cspace_valid;
+
+  // Optional ray casting acceleration, built by map_update_range_skip: for
+  // each free cell, the Chebyshev distance (in cells, capped at 255) to the
+  // nearest cell that stops a ray, i.e. one that is not free or is off the map.
+  // Zero for cells that stop rays.
+  uint8_t * range_skip;
 } map_t;
 
 
@@ -87,7 +129,14 @@ map_t * map_alloc(void);
 // Destroy a map
 void map_free(map_t * map);
 
-// Get the cell at the given point
+// Allocate zeroed storage for a map of size_x * size_y cells using the given
+// layout and tiling; MAP_INDEX is only valid once this has been called
+void map_alloc_cells(map_t * map, int layout, int tile_shift);
+
+// Number of cells in the storage (including the padding of partial tiles)
+int map_cell_count(const map_t * map);
+
+// Get the cell at the given point; NULL for maps without a cell array
 map_cell_t * map_get_cell(map_t * map, double ox, double oy, double oa);
 
 // Load an occupancy map
@@ -96,9 +145,63 @@ int map_load_occ(map_t * map, const char * filename, double scale, int negate);
 // Load a wifi signal strength map
 // int map_load_wifi(map_t *map, const char *filename, int index);
 
-// Update the cspace distances
+// Update the cspace distances; does nothing if they are already up to date
+// for this max_occ_dist
 void map_update_cspace(map_t * map, double max_occ_dist);
 
+// Set the cspace distances from the squared distances in cells to the nearest
+// obstacle, size_x * size_y of them row by row, clipped as map_update_cspace
+// clips them
+void map_set_cspace(map_t * map, const uint32_t * sq_distances, double max_occ_dist);
+
+// Hash of the map geometry, occupancy and cspace method, for keying cached
+// distance fields
+uint64_t map_hash(const map_t * map);
+
+// Save the cspace distances to a file tagged with key.  Returns 0 on success.
+int map_save_cspace(const map_t * map, const char * filename, uint64_t key);
+
+// Load cspace distances saved by map_save_cspace in place of
+// map_update_cspace.  Returns 0 on success and -1, leaving the map untouched, if
+// the file is missing or was saved for a different key, map or max_occ_dist.
+int map_load_cspace(map_t * map, const char * filename, uint64_t key, double max_occ_dist);
+
+// Update the per-cell hit probability table from the cspace distances; does
+// nothing if the table is already up to date for this sigma
+void map_update_hit_prob(map_t * map, double sigma_hit);
+
+
+/**************************************************************************
+ * Free space index
+ **************************************************************************/
+
+// The free cells of a map as runs along its rows, for drawing uniformly
+// distributed free cells in (expected) constant time
+typedef struct
+{
+  // Number of free cells and runs
+  int cell_count, run_count;
+
+  // Rank of the first cell of each run among all free cells, plus a final
+  // entry equal to cell_count, and the map coords of that first cell
+  int * run_offset;
+  int * run_i;
+  int * run_j;
+
+  // guide[g] is the run holding the free cell of rank g * cell_count / run_count,
+  // the starting point for the search in map_free_space_cell
+  int * guide;
+} map_free_space_t;
+
+// Index the cells of the map whose occ_state is free (-1)
+map_free_space_t * map_free_space_alloc(const map_t * map);
+
+// Destroy a free space index
+void map_free_space_free(map_free_space_t * free_space);
+
+// Map coords of the free cell of the given rank (0 <= rank < cell_count)
+void map_free_space_cell(const map_free_space_t * free_space, int rank, int * i, int * j);
+
 
 /**************************************************************************
  * Range functions
@@ -107,6 +210,10 @@ void map_update_cspace(map_t * map, double max_occ_dist);
 // Extract a single range reading from the map
 double map_calc_range(map_t * map, double ox, double oy, double oa, double max_range);
 
+// Build the range_skip table, which lets map_calc_range jump over free space.
+// Must be rebuilt if the occupancy changes.
+void map_update_range_skip(map_t * map);
+
 
 /**************************************************************************
  * GUI/diagnostic functions
@@ -138,7 +245,45 @@ void map_draw_wifi(map_t * map, struct _rtk_fig_t * fig, int index);
 #define MAP_VALID(map, i, j) ((i >= 0) && (i < map->size_x) && (j >= 0) && (j < map->size_y))
 
 // Compute the cell index for the given map coords.
-#define MAP_INDEX(map, i, j) ((i) + (j) * map->size_x)
+#define MAP_INDEX(map, i, j) (map->tile_shift == 0 ? \
+  (i) + (j) * map->size_x : MAP_TILED_INDEX(map, i, j))
+
+#define MAP_TILED_INDEX(map, i, j) \
+  (((((j) >> map->tile_shift) * map->tiles_x + ((i) >> map->tile_shift)) << \
+  (2 * map->tile_shift)) + \
+  (((j) & ((1 << map->tile_shift) - 1)) << map->tile_shift) + \
+  ((i) & ((1 << map->tile_shift) - 1)))
+
+// Layout-independent access to the cell at a MAP_INDEX
+static inline int map_occ_state(const map_t * map, int index)
+{
+  return map->cells ? map->cells[index].occ_state : map->occ_state_plane[index];
+}
+
+static inline double map_occ_dist(const map_t * map, int index)
+{
+  return map->cells ? map->cells[index].occ_dist :
+         map->occ_dist_plane[index] * map->occ_dist_res;
+}
+
+static inline void map_set_occ_state(map_t * map, int index, int occ_state)
+{
+  if (map->cells) {
+    map->cells[index].occ_state = occ_state;
+  } else {
+    map->occ_state_plane[index] = (int8_t) occ_state;
+  }
+}
+
+static inline void map_set_occ_dist(map_t * map, int index, double occ_dist)
+{
+  if (map->cells) {
+    map->cells[index].occ_dist = occ_dist;
+  } else {
+    double units = occ_dist / map->occ_dist_res + 0.5;
+    map->occ_dist_plane[index] = (uint16_t) (units < UINT16_MAX ? units : UINT16_MAX);
+  }
+}
 
 #ifdef __cplusplus
 }
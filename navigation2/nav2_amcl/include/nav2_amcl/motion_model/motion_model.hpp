@@ -17,9 +17,11 @@
 #ifndef NAV2_AMCL__MOTION_MODEL__MOTION_MODEL_HPP_
 #define NAV2_AMCL__MOTION_MODEL__MOTION_MODEL_HPP_
 
+#include <stdint.h>
 #include <string>
 #include "nav2_amcl/pf/pf.hpp"
 #include "nav2_amcl/pf/pf_pdf.hpp"
+#include "nav2_amcl/pf/pf_random.hpp"
 
 namespace nav2_amcl
 {
@@ -27,12 +29,22 @@ namespace nav2_amcl
 class MotionModel
 {
 public:
+  MotionModel();
   virtual ~MotionModel() = default;
   virtual void odometryUpdate(pf_t * pf, const pf_vector_t & pose, const pf_vector_t & delta) = 0;
 
+  // Seed the generator used for the motion noise, for reproducible runs
+  void setSeed(uint64_t seed);
+
   static MotionModel * createMotionModel(
     std::string & type, double alpha1, double alpha2,
     double alpha3, double alpha4, double alpha5);
+
+  // Number of samples whose noise is drawn together
+  static const int BLOCK_SIZE = 256;
+
+protected:
+  pf_rng_t rng_;
 };
 
 class OmniMotionModel : public MotionModel
@@ -0,0 +1,53 @@
+// Copyright (c) 2018 Intel Corporation
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef NAV2_AMCL__PARTICLE_CHECKPOINT_HPP_
+#define NAV2_AMCL__PARTICLE_CHECKPOINT_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "nav2_amcl/pf/pf.hpp"
+
+namespace nav2_amcl
+{
+
+// A copy of the particle set, from which the filter can resume after a
+// restart on the same map
+struct ParticleCheckpoint
+{
+  uint64_t map_id{0};  // map_hash() of the map the particles are on
+  int64_t stamp{0};    // when it was taken, in ns since the epoch of the system clock
+  std::vector<double> x;
+  std::vector<double> y;
+  std::vector<double> theta;
+  std::vector<double> weight;
+
+  // Copy the particles of set
+  void assign(const pf_sample_set_t * set);
+};
+
+// Write a checkpoint to a temporary file first, and rename it over filename,
+// so that a reader never sees a partial checkpoint
+bool saveParticleCheckpoint(const std::string & filename, const ParticleCheckpoint & checkpoint);
+
+// Read a checkpoint; false if there is none, or the file is not one
+bool loadParticleCheckpoint(const std::string & filename, ParticleCheckpoint & checkpoint);
+
+}  // namespace nav2_amcl
+
+#endif  // NAV2_AMCL__PARTICLE_CHECKPOINT_HPP_
@@ -30,6 +30,8 @@
 
 #include "nav2_amcl/pf/pf_vector.hpp"
 #include "nav2_amcl/pf/pf_kdtree.hpp"
+#include "nav2_amcl/pf/pf_hashgrid.hpp"
+#include "nav2_amcl/pf/pf_thread_pool.hpp"
 
 #ifdef __cplusplus
 extern "C" {
@@ -57,17 +59,6 @@ typedef double (* pf_sensor_model_fn_t) (
   struct _pf_sample_set_t * set);
 
 
-// Information for a single sample
-typedef struct
-{
-  // Pose represented by this sample
-  pf_vector_t pose;
-
-  // Weight for this pose
-  double weight;
-} pf_sample_t;
-
-
 // Information for a cluster of samples
 typedef struct
 {
@@ -86,16 +77,28 @@ typedef struct
 } pf_cluster_t;
 
 
+// Alignment of the sample arrays, in bytes
+#define PF_SAMPLE_ALIGN 64
+
 // Information for a set of samples
 typedef struct _pf_sample_set_t
 {
-  // The samples
+  // The samples, one array per field so that each is read contiguously: the
+  // x, y and theta of their poses, and their weights.  The arrays of a set
+  // are aligned to PF_SAMPLE_ALIGN bytes.
   int sample_count;
-  pf_sample_t * samples;
+  double * x;
+  double * y;
+  double * theta;
+  double * weight;
 
   // A kdtree encoding the histogram
   pf_kdtree_t * kdtree;
 
+  // The same histogram as a hash grid; which of the two is maintained
+  // depends on pf_t::histogram_type
+  pf_hashgrid_t * hashgrid;
+
   // Clusters
   int cluster_count, cluster_max_count;
   pf_cluster_t * clusters;
@@ -107,6 +110,25 @@ typedef struct _pf_sample_set_t
 } pf_sample_set_t;
 
 
+// The pose of sample i of a set
+static inline pf_vector_t pf_sample_pose(const pf_sample_set_t * set, int i)
+{
+  pf_vector_t pose;
+  pose.v[0] = set->x[i];
+  pose.v[1] = set->y[i];
+  pose.v[2] = set->theta[i];
+  return pose;
+}
+
+// Set the pose of sample i of a set
+static inline void pf_sample_set_pose(pf_sample_set_t * set, int i, pf_vector_t pose)
+{
+  set->x[i] = pose.v[0];
+  set->y[i] = pose.v[1];
+  set->theta[i] = pose.v[2];
+}
+
+
 // Information for an entire filter
 typedef struct _pf_t
 {
@@ -124,6 +146,10 @@ typedef struct _pf_t
   // Running averages, slow and fast, of likelihood
   double w_slow, w_fast;
 
+  // Effective sample size of the current set, 1 / sum(w^2) of its normalized
+  // weights, as of the last sensor update
+  double n_eff;
+
   // Decay rates for running averages
   double alpha_slow, alpha_fast;
 
@@ -134,6 +160,18 @@ typedef struct _pf_t
   double dist_threshold;  // distance threshold in each axis over which the pf is considered to not
                           // be converged
   int converged;
+
+  // Optional worker pool used by pf_update_sensor_parallel
+  pf_thread_pool_t * sensor_pool;
+
+  // Resampling scheme (PF_RESAMPLE_*) and its workspace, sized for
+  // max_samples so that resampling does not allocate
+  int resample_method;
+  double * resample_cdf;
+  int * resample_index;
+
+  // Histogram used for KLD sampling and clustering (PF_HISTOGRAM_*)
+  int histogram_type;
 } pf_t;
 
 
@@ -158,9 +196,55 @@ void pf_update_action(pf_t * pf, pf_action_model_fn_t action_fn, void * action_d
 // Update the filter with some new sensor observation
 void pf_update_sensor(pf_t * pf, pf_sensor_model_fn_t sensor_fn, void * sensor_data);
 
+// Number of samples handed to the sensor model per job by
+// pf_update_sensor_parallel.  Fixed, so that the reduction of the chunk weights
+// is independent of the number of threads.
+#define PF_SENSOR_CHUNK_SIZE 256
+
+// Samples per job of pf_cluster_stats.  Fixed, so that the merge of the chunk
+// statistics is independent of the number of threads.
+#define PF_STATS_CHUNK_SIZE 2048
+
+// Use [num_threads] threads for pf_update_sensor_parallel and pf_cluster_stats;
+// 1 disables the pool
+void pf_set_sensor_threads(pf_t * pf, int num_threads);
+
+// Update the filter with some new sensor observation, weighting chunks of the
+// sample set concurrently.  The sensor model is called once per chunk with a
+// sample set view covering only that chunk, so it must not keep state across
+// samples.  Falls back to pf_update_sensor when no pool is configured.
+void pf_update_sensor_parallel(pf_t * pf, pf_sensor_model_fn_t sensor_fn, void * sensor_data);
+
 // Resample the distribution
 void pf_update_resample(pf_t * pf);
 
+// Rebuild the histogram and cluster statistics of the current set for the
+// poses and weights of its samples, without resampling it
+void pf_update_stats(pf_t * pf);
+
+// Resampling schemes.  PF_RESAMPLE_MULTINOMIAL draws every sample
+// independently; PF_RESAMPLE_LOW_VARIANCE is the systematic resampler from
+// Probabilistic Robotics (p110), which runs in O(N) and has lower variance.
+// Both keep the KLD-adaptive sample count.
+#define PF_RESAMPLE_MULTINOMIAL 0
+#define PF_RESAMPLE_LOW_VARIANCE 1
+
+// Select the resampling scheme used by pf_update_resample
+void pf_set_resample_method(pf_t * pf, int method);
+
+// Change the min and max number of samples of a running filter.  The samples
+// are kept, up to the new maximum, and the next resample adapts their number.
+void pf_set_sample_limits(pf_t * pf, int min_samples, int max_samples);
+
+// Histograms used to count occupied bins for KLD sampling and to label
+// clusters.  Both give the same bins; the hash grid keeps them in contiguous
+// memory and finds them in constant time.
+#define PF_HISTOGRAM_KDTREE 0
+#define PF_HISTOGRAM_HASHGRID 1
+
+// Select the histogram; must be called before the filter is initialized
+void pf_set_histogram_type(pf_t * pf, int type);
+
 // Compute the CEP statistics (mean and variance).
 void pf_get_cep_stats(pf_t * pf, pf_vector_t * mean, double * var);
 
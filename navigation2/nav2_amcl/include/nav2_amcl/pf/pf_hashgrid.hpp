@@ -0,0 +1,90 @@
+/*
+ *  Player - One Hell of a Robot Server
+ *  Copyright (C) 2000  Brian Gerkey   &  Kasper Stoy
+ *                      gerkey@usc.edu    kaspers@robotics.usc.edu
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/**************************************************************************
+ * Desc: Hash grid histogram; an alternative to the kd-tree
+ *************************************************************************/
+
+#ifndef NAV2_AMCL__PF__PF_HASHGRID_HPP_
+#define NAV2_AMCL__PF__PF_HASHGRID_HPP_
+
+
+// An occupied histogram bin
+typedef struct
+{
+  // The key for this bin
+  int key[3];
+
+  // The value for this bin
+  double value;
+
+  // The cluster label
+  int cluster;
+
+  // Slot in the hash table that refers to this bin
+  int slot;
+} pf_hashgrid_bin_t;
+
+
+// A histogram over quantized (x, y, theta) poses.  Bins are stored
+// contiguously in insertion order and found through an open-addressing hash
+// table of bin indices; a table slot is only valid if the bin it refers to
+// points back at it, so clearing the grid takes constant time.
+typedef struct
+{
+  // Cell size
+  double size[3];
+
+  // Hash table of bin indices; slot_mask + 1 is a power of two
+  int slot_mask;
+  int * slots;
+
+  // The occupied bins
+  int bin_count, bin_max_count;
+  pf_hashgrid_bin_t * bins;
+
+  // Workspace for pf_hashgrid_cluster
+  int * stack;
+} pf_hashgrid_t;
+
+
+// Create a grid that can hold up to max_size bins
+extern pf_hashgrid_t * pf_hashgrid_alloc(int max_size);
+
+// Destroy a grid
+extern void pf_hashgrid_free(pf_hashgrid_t * self);
+
+// Clear all entries from the grid
+extern void pf_hashgrid_clear(pf_hashgrid_t * self);
+
+// Insert a pose into the grid
+extern void pf_hashgrid_insert(pf_hashgrid_t * self, pf_vector_t pose, double value);
+
+// Cluster the bins in the grid; bins are connected if their keys differ by
+// at most one in every dimension
+extern void pf_hashgrid_cluster(pf_hashgrid_t * self);
+
+// Determine the probability estimate for the given pose
+extern double pf_hashgrid_get_prob(pf_hashgrid_t * self, pf_vector_t pose);
+
+// Determine the cluster label for the given pose
+extern int pf_hashgrid_get_cluster(pf_hashgrid_t * self, pf_vector_t pose);
+
+#endif  // NAV2_AMCL__PF__PF_HASHGRID_HPP_
@@ -0,0 +1,77 @@
+/*
+ *  Player - One Hell of a Robot Server
+ *  Copyright (C) 2000  Brian Gerkey   &  Kasper Stoy
+ *                      gerkey@usc.edu    kaspers@robotics.usc.edu
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/**************************************************************************
+ * Desc: Seedable random number generation for the particle filter
+ *************************************************************************/
+
+#ifndef NAV2_AMCL__PF__PF_RANDOM_HPP_
+#define NAV2_AMCL__PF__PF_RANDOM_HPP_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of independent xoshiro256** streams advanced side by side; the
+// refill loop runs across them so that it can be vectorized
+#define PF_RNG_LANES 4
+
+// Number of 64-bit outputs generated per refill
+#define PF_RNG_BUFFER_SIZE 64
+
+// Number of layers in the Ziggurat used for Gaussian samples
+#define PF_RNG_ZIGGURAT_LAYERS 128
+
+// Random number generator state
+typedef struct
+{
+  // xoshiro256** state, one column per lane
+  uint64_t s[4][PF_RNG_LANES];
+
+  // Generated outputs not yet handed out
+  uint64_t buffer[PF_RNG_BUFFER_SIZE];
+  int buffer_pos;
+
+  // Ziggurat layer edges and the ratio of consecutive edges
+  double zig_x[PF_RNG_ZIGGURAT_LAYERS + 1];
+  double zig_r[PF_RNG_ZIGGURAT_LAYERS];
+} pf_rng_t;
+
+
+// Seed the generator; equal seeds give equal sequences
+void pf_rng_seed(pf_rng_t * rng, uint64_t seed);
+
+// Draw 64 random bits
+uint64_t pf_rng_next(pf_rng_t * rng);
+
+// Draw uniformly from [0, 1)
+double pf_rng_uniform(pf_rng_t * rng);
+
+// Fill out[0 .. count) with draws from the standard normal distribution,
+// using the Ziggurat method
+void pf_rng_gaussian(pf_rng_t * rng, double * out, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // NAV2_AMCL__PF__PF_RANDOM_HPP_
@@ -0,0 +1,58 @@
+/*
+ *  Player - One Hell of a Robot Server
+ *  Copyright (C) 2000  Brian Gerkey   &  Kasper Stoy
+ *                      gerkey@usc.edu    kaspers@robotics.usc.edu
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/**************************************************************************
+ * Desc: Fixed-size worker pool for the particle filter
+ *************************************************************************/
+
+#ifndef NAV2_AMCL__PF__PF_THREAD_POOL_HPP_
+#define NAV2_AMCL__PF__PF_THREAD_POOL_HPP_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Function prototype for a job; called once for each job index in [0, job_count)
+typedef void (* pf_job_fn_t) (void * job_data, int job);
+
+// Opaque pool of worker threads
+typedef struct _pf_thread_pool_t pf_thread_pool_t;
+
+// Create a pool that runs jobs on [num_threads] threads in total, including the
+// calling thread.  Returns NULL if num_threads < 2 or the threads could not be
+// started; callers should then run serially.
+pf_thread_pool_t * pf_thread_pool_alloc(int num_threads);
+
+// Stop the workers and free the pool
+void pf_thread_pool_free(pf_thread_pool_t * pool);
+
+// Number of threads (including the caller) used by the pool
+int pf_thread_pool_size(pf_thread_pool_t * pool);
+
+// Run job_fn for every job index and block until all of them have finished.
+// The calling thread takes part in the work.
+void pf_thread_pool_run(
+  pf_thread_pool_t * pool, pf_job_fn_t job_fn, void * job_data, int job_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // NAV2_AMCL__PF__PF_THREAD_POOL_HPP_
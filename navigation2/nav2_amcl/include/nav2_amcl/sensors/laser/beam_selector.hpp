@@ -0,0 +1,47 @@
+// Copyright (c) 2018 Intel Corporation
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef NAV2_AMCL__SENSORS__LASER__BEAM_SELECTOR_HPP_
+#define NAV2_AMCL__SENSORS__LASER__BEAM_SELECTOR_HPP_
+
+#include <vector>
+#include "nav2_amcl/sensors/laser/laser.hpp"
+
+namespace nav2_amcl
+{
+
+// Picks a subset of the beams of a scan for the laser models to evaluate.
+// Instead of a fixed stride, each beam is scored by how much the range
+// changes around it, since edges and corners constrain the pose much more
+// than flat walls.  The scan is split into angular bins that each keep their
+// best beam, so the selection still covers the whole field of view, and the
+// rest of the budget goes to the highest scoring beams overall.
+class BeamSelector
+{
+public:
+  // Copy at most max_beams valid beams of in, in scan order, into out
+  void select(const LaserData & in, int max_beams, LaserData & out);
+
+private:
+  std::vector<double> score_;
+  std::vector<int> candidates_;
+  std::vector<char> chosen_;
+};
+
+}  // namespace nav2_amcl
+
+#endif  // NAV2_AMCL__SENSORS__LASER__BEAM_SELECTOR_HPP_
@@ -18,10 +18,14 @@
 #ifndef NAV2_AMCL__SENSORS__LASER__LASER_HPP_
 #define NAV2_AMCL__SENSORS__LASER__LASER_HPP_
 
+#include <stdint.h>
+#include <memory>
 #include <string>
+#include <vector>
 #include "nav2_amcl/pf/pf.hpp"
 #include "nav2_amcl/pf/pf_pdf.hpp"
 #include "nav2_amcl/map/map.hpp"
+#include "nav2_amcl/sensors/laser/likelihood_field_device.hpp"
 
 namespace nav2_amcl
 {
@@ -36,32 +40,74 @@ public:
   virtual ~Laser();
   virtual bool sensorUpdate(pf_t * pf, LaserData * data) = 0;
   void SetLaserPose(pf_vector_t & laser_pose);
+  pf_vector_t GetLaserPose() const;
+
+  // Look the Gaussian hit probability up in the map's per-cell table instead of
+  // evaluating it for every beam.  Only used by the likelihood field models.
+  void enableHitProbTable();
+
+  // Change the weights of the hit and random parts of the model and the standard
+  // deviation of hits, rebuilding the hit probability table if sigma_hit changed.
+  // Also brings the table up to date after the map's cspace was recomputed.
+  void setHitModel(double z_hit, double z_rand, double sigma_hit);
 
 protected:
   double z_hit_;
   double z_rand_;
   double sigma_hit_;
 
-  void reallocTempData(int max_samples, int max_obs);
+  // (Re)build the map's hit probability table for sigma_hit_ if it is enabled;
+  // returns whether the table should be used
+  bool updateHitProbTable();
+  bool use_hit_prob_table_;
+
   map_t * map_;
   pf_vector_t laser_pose_;
   int max_beams_;
-  int max_samples_;
-  int max_obs_;
-  double ** temp_obs_;
 };
 
 class LaserData
 {
 public:
   Laser * laser;
-  LaserData() {ranges = NULL;}
-  virtual ~LaserData() {delete[] ranges;}
+  LaserData()
+  : range_count(0), range_max(0.0), ranges(NULL), bearings(NULL) {}
+  virtual ~LaserData() {}
+
+  // Point ranges and bearings at buffers of the data's own, of count beams
+  void allocate(int count);
 
 public:
   int range_count;
   double range_max;
-  double(*ranges)[2];
+  // The range and base frame bearing of each beam, as separate arrays the models can load
+  // several beams at a time from, in the data's own buffers or a ScanBuffer's
+  float * ranges;
+  float * bearings;
+
+private:
+  std::vector<float> own_ranges_;
+  std::vector<float> own_bearings_;
+};
+
+// The ranges and bearings of the scans of one laser, reused from scan to scan. The bearings
+// are only recomputed when the laser's angles change.
+class ScanBuffer
+{
+public:
+  void reserve(size_t count);
+
+  // Copy the ranges of a scan, with readings at or below range_min as range_max, and point
+  // data at them and the bearings
+  void fill(
+    const std::vector<float> & scan_ranges, double range_min, double range_max,
+    double angle_min, double angle_increment, LaserData & data);
+
+private:
+  std::vector<float> ranges_;
+  std::vector<float> bearings_;
+  double angle_min_{0.0};
+  double angle_increment_{0.0};
 };
 
 
@@ -73,6 +119,9 @@ public:
     double lambda_short, double chi_outlier, size_t max_beams, map_t * map);
   bool sensorUpdate(pf_t * pf, LaserData * data);
 
+  // Change the weights of the short and max range parts of the model
+  void setShortModel(double z_short, double z_max, double lambda_short);
+
 private:
   static double sensorFunction(LaserData * data, pf_sample_set_t * set);
   double z_short_;
@@ -93,6 +142,70 @@ private:
   static double sensorFunction(LaserData * data, pf_sample_set_t * set);
 };
 
+// Same observation model as LikelihoodFieldModel, but evaluated over batches of
+// particles at a time: beam endpoints are precomputed once per scan, each batch
+// is kept in structure-of-arrays form and the hit coordinates, map indices and
+// occ_dist gathers are vectorized (AVX2 or NEON, with a scalar fallback)
+class LikelihoodFieldModelBatch : public Laser
+{
+public:
+  LikelihoodFieldModelBatch(
+    double z_hit, double z_rand, double sigma_hit, double max_occ_dist,
+    size_t max_beams, map_t * map);
+  bool sensorUpdate(pf_t * pf, LaserData * data);
+
+  // Number of particles scored per pass over the beams
+  static const int BATCH_SIZE = 64;
+
+protected:
+  static double sensorFunction(LaserData * data, pf_sample_set_t * set);
+  void precomputeBeams(LaserData * data);
+
+  // Beam endpoints in the laser frame for the current scan; read-only while
+  // the sample chunks are being weighted
+  std::vector<double> beam_x_;
+  std::vector<double> beam_y_;
+
+private:
+  // Per-batch laser poses and obstacle distances, structure-of-arrays
+  struct Batch
+  {
+    double x[BATCH_SIZE];
+    double y[BATCH_SIZE];
+    double cos[BATCH_SIZE];
+    double sin[BATCH_SIZE];
+    double z[BATCH_SIZE];
+  };
+
+  void gatherOccDist(double beam_x, double beam_y, int count, Batch & batch) const;
+};
+
+// Same observation model as LikelihoodFieldModel, with the weights of all the particles
+// computed at once on a CUDA device: the distance field is uploaded once per map as a
+// texture, and the particles and beam endpoints on every update.  The weights stay on the
+// CPU as LikelihoodFieldModelBatch computes them when AMCL was built without AMCL_CUDA,
+// there is no device or the device fails.
+class LikelihoodFieldModelGPU : public LikelihoodFieldModelBatch
+{
+public:
+  LikelihoodFieldModelGPU(
+    double z_hit, double z_rand, double sigma_hit, double max_occ_dist,
+    size_t max_beams, map_t * map);
+  ~LikelihoodFieldModelGPU();
+  bool sensorUpdate(pf_t * pf, LaserData * data);
+
+  // Whether the weights are computed on the device
+  bool onDevice() const {return device_ != nullptr;}
+
+private:
+  static double sensorFunction(LaserData * data, pf_sample_set_t * set);
+  // Upload the distance field if the map's changed since the last upload
+  bool uploadMap();
+
+  std::unique_ptr<LikelihoodFieldDevice> device_;
+  double uploaded_max_occ_dist_{-1.0};
+};
+
 class LikelihoodFieldModelProb : public Laser
 {
 public:
@@ -100,15 +213,26 @@ public:
     double z_hit, double z_rand, double sigma_hit, double max_occ_dist,
     bool do_beamskip, double beam_skip_distance,
     double beam_skip_threshold, double beam_skip_error_threshold,
-    size_t max_beams, map_t * map);
+    int max_samples, size_t max_beams, map_t * map);
   bool sensorUpdate(pf_t * pf, LaserData * data);
 
 private:
   static double sensorFunction(LaserData * data, pf_sample_set_t * set);
+  void reserveBeamSkip(int max_samples);
   bool do_beamskip_;
   double beam_skip_distance_;
   double beam_skip_threshold_;
   double beam_skip_error_threshold_;
+
+  // Beam skipping buffers, sized once for max_samples particles: per-particle
+  // rows of beam log probabilities, per-beam agreement counts, bitsets of the
+  // observed and accepted beams, and the list of beams to integrate
+  int beam_skip_samples_{0};
+  std::vector<float> beam_log_pz_;
+  std::vector<int> beam_hits_;
+  std::vector<uint64_t> beam_valid_;
+  std::vector<uint64_t> beam_mask_;
+  std::vector<int> beam_used_;
 };
 
 }  // namespace nav2_amcl
@@ -0,0 +1,67 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef NAV2_AMCL__SENSORS__LASER__LIKELIHOOD_FIELD_DEVICE_HPP_
+#define NAV2_AMCL__SENSORS__LASER__LIKELIHOOD_FIELD_DEVICE_HPP_
+
+namespace nav2_amcl
+{
+
+// Where the distance field lies, as MAP_GXWX and MAP_GYWY place it
+struct DeviceMapGeometry
+{
+  int size_x, size_y;
+  double origin_x, origin_y;
+  double scale;
+  float off_map;  // the distance of endpoints outside the map, max_occ_dist
+};
+
+// The likelihood field model's weights on a CUDA device, for LikelihoodFieldModelGPU.
+// Built from likelihood_field_device.cu with AMCL_CUDA, and otherwise a stub that is never
+// available.  Not thread safe; each laser model keeps its own.
+class LikelihoodFieldDevice
+{
+public:
+  // Whether AMCL was built with CUDA and the machine has a device
+  static bool available();
+
+  LikelihoodFieldDevice();
+  ~LikelihoodFieldDevice();
+  LikelihoodFieldDevice(const LikelihoodFieldDevice &) = delete;
+  LikelihoodFieldDevice & operator=(const LikelihoodFieldDevice &) = delete;
+
+  // Upload the obstacle distances, size_x * size_y of them row by row, as a texture kept
+  // until the next map.  Returns false on a device error.
+  bool uploadMap(const float * occ_dist, const DeviceMapGeometry & geometry);
+
+  // Multiply weight[k] by the likelihood of the beam endpoints, in the laser frame, from the
+  // laser pose of sample k, and set total to the sum of the new weights.  The same model as
+  // LikelihoodFieldModel: 1 plus the cube of z_hit * exp(-z^2 / z_hit_denom) + z_rand per
+  // beam.  Returns false on a device error, with the weights untouched.
+  bool weigh(
+    const double * x, const double * y, const double * theta, double * weight, int count,
+    const double * beam_x, const double * beam_y, int beam_count, const double laser_pose[3],
+    double z_hit, double z_rand, double z_hit_denom, double * total);
+
+private:
+  struct Buffers;
+  Buffers * buffers_;
+};
+
+}  // namespace nav2_amcl
+
+#endif  // NAV2_AMCL__SENSORS__LASER__LIKELIHOOD_FIELD_DEVICE_HPP_
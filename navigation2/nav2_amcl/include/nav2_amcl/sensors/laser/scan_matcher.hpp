@@ -0,0 +1,90 @@
+// Copyright (c) 2018 Intel Corporation
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef NAV2_AMCL__SENSORS__LASER__SCAN_MATCHER_HPP_
+#define NAV2_AMCL__SENSORS__LASER__SCAN_MATCHER_HPP_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "nav2_amcl/map/map.hpp"
+#include "nav2_amcl/pf/pf_vector.hpp"
+
+namespace nav2_amcl
+{
+
+// Correlative scan matching of a scan against the likelihood field of the
+// map, searched exhaustively over a window around a pose by branch and bound
+// (Olson, Real-Time Correlative Scan Matching).  A pose scores the mean hit
+// probability, exp(-d^2 / (2 sigma^2)), of the cells its endpoints fall in,
+// d being their cspace distance to the nearest obstacle.  Each level of the
+// search steps the translation by twice the cells of the level below, and is
+// bounded by a grid holding the best score over every block of that size.
+class ScanMatcher
+{
+public:
+  // Drop the grids; they are rebuilt from the next map matched against
+  void clear();
+
+  // Search the poses within linear_window (m) and angular_window (rad) of
+  // pose for the one that best matches the endpoints, given in the base
+  // frame, at the resolution of the map.  Replaces pose with it and returns
+  // true if it scores at least min_score, from 0 to 1.  The cspace distances
+  // of the map must be up to date.
+  bool match(
+    map_t * map, double sigma_hit,
+    const std::vector<std::array<double, 2>> & endpoints,
+    double linear_window, double angular_window, double min_score,
+    pf_vector_t & pose, double * match_score = nullptr);
+
+private:
+  struct Candidate
+  {
+    int angle;
+    int dx;
+    int dy;
+    int score;
+  };
+
+  // Rebuild the grids for depth levels, unless they were built from this
+  // map and distance field
+  void update(map_t * map, double sigma_hit, int depth);
+
+  // Upper bound of the score of the translations (dx, dy) to
+  // (dx + 2^level - 1, dy + 2^level - 1) at an angle, exact at level 0
+  int score(const Candidate & candidate, int level) const;
+
+  void search(std::vector<Candidate> & candidates, int level, Candidate & best);
+
+  map_t * map_{nullptr};
+  double sigma_hit_{0.0};
+  double max_occ_dist_{0.0};
+  int size_x_{0};
+  int size_y_{0};
+  int window_{0};
+
+  // Per level, the best quantized hit probability over the block of
+  // 2^level cells per side starting at each cell, row by row
+  std::vector<std::vector<uint8_t>> levels_;
+
+  // The endpoint cells at each angle, for the pose being searched
+  std::vector<std::vector<std::array<int, 2>>> cells_;
+};
+
+}  // namespace nav2_amcl
+
+#endif  // NAV2_AMCL__SENSORS__LASER__SCAN_MATCHER_HPP_
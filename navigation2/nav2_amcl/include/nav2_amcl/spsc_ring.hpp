@@ -0,0 +1,115 @@
+/*
+ *  Player - One Hell of a Robot Server
+ *  Copyright (C) 2000  Brian Gerkey   &  Kasper Stoy
+ *                      gerkey@usc.edu    kaspers@robotics.usc.edu
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef NAV2_AMCL__SPSC_RING_HPP_
+#define NAV2_AMCL__SPSC_RING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace nav2_amcl
+{
+
+// Lock-free ring for handing items from exactly one producer thread to exactly
+// one consumer thread.  Items are filled and read in place, so slots (and any
+// storage they own) are reused rather than reallocated.
+template<typename T>
+class SpscRing
+{
+public:
+  explicit SpscRing(size_t capacity);
+
+  // Producer: the slot to fill next, or nullptr if the ring is full.  The slot
+  // still holds whatever it held last time around.
+  T * back();
+  // Producer: hand the slot returned by back() to the consumer
+  void push();
+
+  // Consumer: the oldest item, or nullptr if the ring is empty
+  T * front();
+  // Consumer: release the item returned by front() back to the producer
+  void pop();
+
+  bool empty() const;
+
+private:
+  // One slot is kept empty to tell a full ring from an empty one
+  std::vector<T> slots_;
+  std::atomic<size_t> head_;  // next slot to read, owned by the consumer
+  std::atomic<size_t> tail_;  // next slot to write, owned by the producer
+};
+
+template<typename T>
+SpscRing<T>::SpscRing(size_t capacity)
+: slots_(capacity + 1), head_(0), tail_(0)
+{
+}
+
+template<typename T>
+T *
+SpscRing<T>::back()
+{
+  size_t tail = tail_.load(std::memory_order_relaxed);
+  size_t next = (tail + 1) % slots_.size();
+  if (next == head_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return &slots_[tail];
+}
+
+template<typename T>
+void
+SpscRing<T>::push()
+{
+  size_t tail = tail_.load(std::memory_order_relaxed);
+  tail_.store((tail + 1) % slots_.size(), std::memory_order_release);
+}
+
+template<typename T>
+T *
+SpscRing<T>::front()
+{
+  size_t head = head_.load(std::memory_order_relaxed);
+  if (head == tail_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return &slots_[head];
+}
+
+template<typename T>
+void
+SpscRing<T>::pop()
+{
+  size_t head = head_.load(std::memory_order_relaxed);
+  head_.store((head + 1) % slots_.size(), std::memory_order_release);
+}
+
+template<typename T>
+bool
+SpscRing<T>::empty() const
+{
+  return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+}
+
+}  // namespace nav2_amcl
+
+#endif  // NAV2_AMCL__SPSC_RING_HPP_
@@ -0,0 +1,99 @@
+/*
+ *  Player - One Hell of a Robot Server
+ *  Copyright (C) 2000  Brian Gerkey   &  Kasper Stoy
+ *                      gerkey@usc.edu    kaspers@robotics.usc.edu
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef NAV2_AMCL__STAGE_LATENCY_HPP_
+#define NAV2_AMCL__STAGE_LATENCY_HPP_
+
+#include <algorithm>
+#include <vector>
+
+namespace nav2_amcl
+{
+
+// Durations of the most recent runs of one processing stage, kept in a
+// fixed-size ring so that recording never allocates
+class StageLatency
+{
+public:
+  explicit StageLatency(size_t window = 256);
+
+  // Record one run, in seconds
+  void add(double seconds);
+
+  // Number of runs currently in the window
+  size_t count() const;
+
+  // The p-quantile (0 <= p <= 1) of the runs in the window; 0 if there are none
+  double percentile(double p) const;
+
+  // Forget all recorded runs
+  void clear();
+
+private:
+  std::vector<double> samples_;
+  size_t next_;
+  size_t count_;
+  mutable std::vector<double> scratch_;
+};
+
+inline
+StageLatency::StageLatency(size_t window)
+: samples_(window), next_(0), count_(0)
+{
+  scratch_.reserve(window);
+}
+
+inline void
+StageLatency::add(double seconds)
+{
+  samples_[next_] = seconds;
+  next_ = (next_ + 1) % samples_.size();
+  count_ = std::min(count_ + 1, samples_.size());
+}
+
+inline size_t
+StageLatency::count() const
+{
+  return count_;
+}
+
+inline double
+StageLatency::percentile(double p) const
+{
+  if (count_ == 0) {
+    return 0.0;
+  }
+  scratch_.assign(samples_.begin(), samples_.begin() + count_);
+  size_t k = std::min(static_cast<size_t>(p * count_), count_ - 1);
+  std::nth_element(scratch_.begin(), scratch_.begin() + k, scratch_.end());
+  return scratch_[k];
+}
+
+inline void
+StageLatency::clear()
+{
+  next_ = 0;
+  count_ = 0;
+}
+
+}  // namespace nav2_amcl
+
+#endif  // NAV2_AMCL__STAGE_LATENCY_HPP_
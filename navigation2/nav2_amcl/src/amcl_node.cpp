@@ -23,22 +23,29 @@
 #include "nav2_amcl/amcl_node.hpp"
 
 #include <algorithm>
+#include <future>
 #include <memory>
+#include <numeric>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "message_filters/subscriber.h"
 #include "nav2_amcl/angleutils.hpp"
+#include "nav2_util/black_box.hpp"
+#include "nav2_util/distance_field.hpp"
+#include "nav2_util/execution_timer.hpp"
 #include "nav2_util/geometry_utils.hpp"
 #include "nav2_amcl/pf/pf.hpp"
 #include "nav2_util/string_utils.hpp"
+#include "nav2_util/tracing.hpp"
+#include "nav2_amcl/sensors/laser/beam_selector.hpp"
 #include "nav2_amcl/sensors/laser/laser.hpp"
 #include "tf2/convert.h"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
 #include "tf2/LinearMath/Transform.h"
 #include "tf2_ros/buffer.h"
-#include "tf2_ros/message_filter.h"
 #include "tf2_ros/transform_broadcaster.h"
 #include "tf2_ros/transform_listener.h"
 #include "tf2_ros/create_timer_ros.h"
@@ -55,11 +62,35 @@ namespace nav2_amcl
 {
 using nav2_util::geometry_utils::orientationAroundZAxis;
 
-AmclNode::AmclNode()
-: nav2_util::LifecycleNode("amcl", "", true)
+static const char * const STAGE_NAMES[] = {
+  "odom_tf", "motion_update", "laser_tf", "sensor_update", "resample", "scan_match", "publish",
+  "total"};
+
+AmclNode::AmclNode(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("amcl", "", true, options)
 {
   RCLCPP_INFO(get_logger(), "Creating");
 
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    stage_histograms_[i] = &nav2_util::MetricsRegistry::global().histogram(
+      std::string("amcl.") + STAGE_NAMES[i], "AMCL filter update stage");
+  }
+  dropped_scans_counter_ = &nav2_util::MetricsRegistry::global().counter("amcl.dropped_scans",
+      "Laser scans dropped before the filter update");
+  scan_channel_ = nav2_util::BlackBox::global().channel("amcl/scan",
+      "sensor_msgs/msg/LaserScan");
+  odom_pose_channel_ = nav2_util::BlackBox::global().channel("amcl/odom_pose",
+      "geometry_msgs/msg/PoseStamped");
+  laser_pose_channel_ = nav2_util::BlackBox::global().channel("amcl/laser_pose",
+      "geometry_msgs/msg/PoseStamped");
+
+  add_parameter("adaptive_beams", rclcpp::ParameterValue(false),
+    "Pick the most informative beams, within sensor_time_budget, instead of a fixed stride of "
+    "max_beams while the filter has not converged");
+
+  add_parameter("adaptive_min_beams", rclcpp::ParameterValue(8),
+    "Fewest beams adaptive_beams may use");
+
   add_parameter("alpha1", rclcpp::ParameterValue(0.2),
     "This is the alpha1 parameter", "These are additional constraints for alpha1");
 
@@ -75,6 +106,10 @@ AmclNode::AmclNode()
   add_parameter("alpha5", rclcpp::ParameterValue(0.2),
     "This is the alpha5 parameter", "These are additional constraints for alpha5");
 
+  add_parameter("async_publish", rclcpp::ParameterValue(false),
+    "Publish the transform, pose and particle cloud from a separate thread, so that building "
+    "large particle clouds does not delay the next scan");
+
   add_parameter("base_frame_id", rclcpp::ParameterValue(std::string("base_footprint")),
     "Which frame to use for the robot base");
 
@@ -83,9 +118,47 @@ AmclNode::AmclNode()
   add_parameter("beam_skip_threshold", rclcpp::ParameterValue(0.3));
   add_parameter("do_beamskip", rclcpp::ParameterValue(false));
 
+  add_parameter("checkpoint_file", rclcpp::ParameterValue(std::string("")),
+    "File to checkpoint the particles in, from which they are restored on activation, "
+    "instead of from the initial pose", "Empty disables checkpoints");
+
+  add_parameter("checkpoint_max_age", rclcpp::ParameterValue(60.0),
+    "Age (s) beyond which a checkpoint is not restored");
+
+  add_parameter("checkpoint_rate", rclcpp::ParameterValue(1.0),
+    "Maximum rate (Hz) at which to checkpoint the particles");
+
+  add_parameter("distance_transform", rclcpp::ParameterValue(std::string("brushfire")),
+    "How to compute the obstacle distances for the likelihood field models, either brushfire "
+    "or edt",
+    "edt is an exact linear time transform that runs on all cores");
+
+  add_parameter("fuse_scans", rclcpp::ParameterValue(false),
+    "Evaluate the scans of all lasers in one sensor update, followed by a single resample, "
+    "instead of updating and resampling once per scan. Not used with the beam model");
+
   add_parameter("global_frame_id", rclcpp::ParameterValue(std::string("map")),
     "The name of the coordinate frame published by the localization system");
 
+  add_parameter("global_localization_coarse", rclcpp::ParameterValue(false),
+    "On reinitialize_global_localization, seed the filter with the best of many uniform "
+    "candidates, scored against the next scan on a downsampled likelihood field");
+
+  add_parameter("global_localization_candidates", rclcpp::ParameterValue(10),
+    "Candidates scored by global_localization_coarse for each particle kept");
+
+  add_parameter("global_localization_downsample", rclcpp::ParameterValue(4),
+    "Map cells per side of one cell of the likelihood field used by global_localization_coarse");
+
+  add_parameter("latency_diagnostics_rate", rclcpp::ParameterValue(0.0),
+    "Rate (Hz) at which to publish the p50/p99 latency of each filter stage, with the particle, "
+    "beam and dropped scan counts, on amcl_diagnostics",
+    "0.0 to disable");
+
+  add_parameter("latest_scan_only", rclcpp::ParameterValue(false),
+    "Keep only the newest scan waiting for its transform or to be processed, so that after a "
+    "stall the filter drops the backlog and catches up in one update");
+
   add_parameter("lambda_short", rclcpp::ParameterValue(0.1),
     "Exponential decay parameter for z_short part of model");
 
@@ -101,8 +174,12 @@ AmclNode::AmclNode()
     "-1.0 will cause the laser's reported minimum range to be used");
 
   add_parameter("laser_model_type", rclcpp::ParameterValue(std::string("likelihood_field")),
-    "Which model to use, either beam, likelihood_field, or likelihood_field_prob",
-    "Same as likelihood_field but incorporates the beamskip feature, if enabled");
+    "Which model to use, either beam, likelihood_field, likelihood_field_batch, "
+    "likelihood_field_gpu or likelihood_field_prob",
+    "likelihood_field_batch is a vectorized evaluation of likelihood_field; likelihood_field_gpu "
+    "evaluates it on a CUDA device when AMCL is built with AMCL_CUDA, and is "
+    "likelihood_field_batch otherwise; likelihood_field_prob is the same as likelihood_field but "
+    "incorporates the beamskip feature, if enabled");
 
   add_parameter("set_initial_pose", rclcpp::ParameterValue(false),
     "Causes AMCL to set initial pose from the initial_pose* parameters instead of "
@@ -120,6 +197,40 @@ AmclNode::AmclNode()
   add_parameter("initial_pose.yaw", rclcpp::ParameterValue(0.0),
     "Yaw of the initial robot pose in the map frame");
 
+  add_parameter("use_hit_prob_table", rclcpp::ParameterValue(false),
+    "Precompute the likelihood field hit probability of every map cell instead of evaluating "
+    "it for each beam",
+    "Costs 4 bytes per map cell; ignored by the beam model");
+
+  add_parameter("compact_map", rclcpp::ParameterValue(false),
+    "Store the map as separate occupancy and 16-bit fixed point distance planes instead of one "
+    "struct per cell, to reduce memory use and cache misses on large maps");
+
+  add_parameter("map_cache_directory", rclcpp::ParameterValue(std::string("")),
+    "Directory in which to cache the likelihood field distances, keyed by the map contents and "
+    "laser_likelihood_max_dist, so that restarts on the same map skip computing them",
+    "Empty disables the cache");
+
+  add_parameter("map_cache_size", rclcpp::ParameterValue(0),
+    "How many maps to keep in memory with their likelihood field distances, including those "
+    "the map server preloads on its map_cache topic, so that switching to one is immediate",
+    "0 disables the cache");
+
+  add_parameter("share_maps", rclcpp::ParameterValue(false),
+    "Share each map with its likelihood field distances among the AMCL nodes of the process "
+    "that get the same map, e.g. the robots of a fleet simulator, instead of each keeping its own");
+
+  add_parameter("shared_distance_field", rclcpp::ParameterValue(false),
+    "Take the likelihood field distances from the exact distance field of the map shared by the "
+    "nodes of the process, such as a costmap's static layer with shared_distance_field for its "
+    "inflation layer, instead of computing them for AMCL alone",
+    "Overrides distance_transform and map_cache_directory; ignored by the beam model");
+
+  add_parameter("map_tile_size", rclcpp::ParameterValue(0),
+    "Store the map in square tiles of this many cells per side (rounded down to a power of "
+    "two) so that nearby cells share cache lines",
+    "0 or 1 keeps row-major order");
+
   add_parameter("max_beams", rclcpp::ParameterValue(60),
     "How many evenly-spaced beams in each scan to be used when updating the filter");
 
@@ -135,6 +246,10 @@ AmclNode::AmclNode()
   add_parameter("pf_err", rclcpp::ParameterValue(0.05));
   add_parameter("pf_z", rclcpp::ParameterValue(0.99));
 
+  add_parameter("random_seed", rclcpp::ParameterValue(-1),
+    "Seed for the particle filter's random number generators, for reproducible runs",
+    "-1 seeds them from the clock");
+
   add_parameter("recovery_alpha_fast", rclcpp::ParameterValue(0.0),
     "Exponential decay rate for the fast average weight filter, used in deciding when to recover "
     "by adding random poses",
@@ -148,6 +263,31 @@ AmclNode::AmclNode()
   add_parameter("resample_interval", rclcpp::ParameterValue(1),
     "Number of filter updates required before resampling");
 
+  add_parameter("resample_ess_threshold", rclcpp::ParameterValue(0.0),
+    "Only resample when the effective sample size of the particles is below this fraction of "
+    "their number, or to recover; otherwise just refresh the estimate. 0 always resamples",
+    "A good value might be 0.5");
+
+  add_parameter("particle_cloud_max_particles", rclcpp::ParameterValue(0),
+    "Most particles to publish in the particle clouds, picked as particle_cloud_sampling says",
+    "0 publishes them all");
+
+  add_parameter("particle_cloud_rate", rclcpp::ParameterValue(0.0),
+    "Maximum rate (Hz) at which to publish the particle clouds",
+    "0.0 publishes them on every update");
+
+  add_parameter("particle_cloud_sampling", rclcpp::ParameterValue(std::string("top_weight")),
+    "How particle_cloud_max_particles are picked: top_weight keeps the heaviest, stride takes "
+    "them evenly spaced through the set");
+
+  add_parameter("particle_histogram", rclcpp::ParameterValue(std::string("kdtree")),
+    "Histogram used to count particle bins for adaptive sampling and to cluster particles: "
+    "kdtree or hashgrid");
+
+  add_parameter("resample_method", rclcpp::ParameterValue(std::string("multinomial")),
+    "Resampling scheme: multinomial draws every particle independently, low_variance uses the "
+    "systematic resampler, which runs in linear time and adds less sampling noise");
+
   add_parameter("robot_model_type", rclcpp::ParameterValue(std::string("differential")));
 
   add_parameter("save_pose_rate", rclcpp::ParameterValue(0.5),
@@ -158,6 +298,30 @@ AmclNode::AmclNode()
 
   add_parameter("sigma_hit", rclcpp::ParameterValue(0.2));
 
+  add_parameter("scan_match_refinement", rclcpp::ParameterValue(false),
+    "Refine the published pose by matching the scan against the likelihood field around the "
+    "best hypothesis, so that fewer particles give the same accuracy");
+
+  add_parameter("scan_match_angular_window", rclcpp::ParameterValue(0.2),
+    "Largest rotation (rad) of the pose searched by scan_match_refinement");
+
+  add_parameter("scan_match_linear_window", rclcpp::ParameterValue(0.2),
+    "Largest translation (m) along each axis searched by scan_match_refinement");
+
+  add_parameter("scan_match_min_score", rclcpp::ParameterValue(0.5),
+    "Mean hit probability of the scan endpoints, from 0 to 1, below which scan_match_refinement "
+    "keeps the filter's pose");
+
+  add_parameter("scan_fusion_window", rclcpp::ParameterValue(0.05),
+    "With fuse_scans, the longest time (s) to wait for the other lasers' scans before updating");
+
+  add_parameter("sensor_time_budget", rclcpp::ParameterValue(0.02),
+    "Time (s) the laser model may take per update when adaptive_beams is set");
+
+  add_parameter("sensor_update_threads", rclcpp::ParameterValue(1),
+    "Number of threads used to weight the particles against each laser scan",
+    "1 weights them on the laser callback thread only");
+
   add_parameter("tf_broadcast", rclcpp::ParameterValue(true),
     "Set this to false to prevent amcl from publishing the transform between the global frame and "
     "the odometry frame");
@@ -181,6 +345,7 @@ AmclNode::AmclNode()
 AmclNode::~AmclNode()
 {
   RCLCPP_INFO(get_logger(), "Destroying");
+  stopPublisherThread();
 }
 
 nav2_util::CallbackReturn
@@ -196,6 +361,7 @@ AmclNode::on_configure(const rclcpp_lifecycle::State & /*state*/)
   initOdometry();
   initParticleFilter();
   initLaserScan();
+  initDynamicParameters();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -229,6 +395,12 @@ AmclNode::on_activate(const rclcpp_lifecycle::State & /*state*/)
   // Lifecycle publishers must be explicitly activated
   pose_pub_->on_activate();
   particlecloud_pub_->on_activate();
+  compact_particlecloud_pub_->on_activate();
+  diagnostics_pub_->on_activate();
+
+  if (async_publish_) {
+    startPublisherThread();
+  }
 
   first_pose_sent_ = false;
 
@@ -236,6 +408,12 @@ AmclNode::on_activate(const rclcpp_lifecycle::State & /*state*/)
   // process incoming callbacks until we are
   active_ = true;
 
+  // A recent checkpoint takes precedence over the initial pose, and is
+  // restored once the map it was taken on is received
+  if (!checkpoint_file_.empty() && !initial_pose_is_known_) {
+    loadCheckpoint();
+  }
+
   if (set_initial_pose_) {
     auto msg = std::make_shared<geometry_msgs::msg::PoseWithCovarianceStamped>();
 
@@ -261,9 +439,14 @@ AmclNode::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
 
   active_ = false;
 
+  // Drain and stop the publisher thread while its publishers are still active
+  stopPublisherThread();
+
   // Lifecycle publishers must be explicitly deactivated
   pose_pub_->on_deactivate();
   particlecloud_pub_->on_deactivate();
+  compact_particlecloud_pub_->on_deactivate();
+  diagnostics_pub_->on_deactivate();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -275,17 +458,34 @@ AmclNode::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
 
   // Get rid of the inputs first (services and message filter input), so we
   // don't continue to process incoming messages
+  dynamic_params_client_.reset();
+  pending_reconfiguration_ = 0;
   global_loc_srv_.reset();
   nomotion_update_srv_.reset();
   initial_pose_sub_.reset();
   laser_scan_connection_.disconnect();
-  laser_scan_filter_.reset();
+  if (transform_scheduler_) {
+    transform_scheduler_->removeChannel(laser_scan_channel_);
+  }
+  laser_scan_channel_.reset();
+  transform_scheduler_.reset();
   laser_scan_sub_.reset();
 
   // Map
-  map_free(map_);
+  map_cache_sub_.reset();
+  for (auto & preparation : map_preparations_) {
+    preparation.wait();
+  }
+  map_preparations_.clear();
+  if (checkpoint_write_.valid()) {
+    checkpoint_write_.wait();
+  }
+  checkpoint_.reset();
+  map_cache_.reset();
+  map_holder_.reset();
   map_ = nullptr;
-  free_space_indices.resize(0);
+  map_free_space_free(free_space_);
+  free_space_ = nullptr;
 
   // Transforms
   tf_broadcaster_.reset();
@@ -295,6 +495,8 @@ AmclNode::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
   // PubSub
   pose_pub_.reset();
   particlecloud_pub_.reset();
+  compact_particlecloud_pub_.reset();
+  diagnostics_pub_.reset();
 
   // Odometry
   motion_model_.reset();
@@ -305,8 +507,11 @@ AmclNode::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
 
   // Laser Scan
   lasers_.clear();
+  fused_laser_.reset();
+  pending_scans_.clear();
   lasers_update_.clear();
   frame_to_laser_.clear();
+  scan_buffers_.clear();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -322,6 +527,7 @@ nav2_util::CallbackReturn
 AmclNode::on_shutdown(const rclcpp_lifecycle::State & /*state*/)
 {
   RCLCPP_INFO(get_logger(), "Shutting down");
+  stopPublisherThread();
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
@@ -356,7 +562,7 @@ AmclNode::checkElapsedTime(std::chrono::seconds check_interval, rclcpp::Time las
 }
 
 #if NEW_UNIFORM_SAMPLING
-std::vector<std::pair<int, int>> AmclNode::free_space_indices;
+map_free_space_t * AmclNode::free_space_ = nullptr;
 #endif
 
 bool
@@ -397,11 +603,12 @@ AmclNode::uniformPoseGenerator(void * arg)
   map_t * map = reinterpret_cast<map_t *>(arg);
 
 #if NEW_UNIFORM_SAMPLING
-  unsigned int rand_index = drand48() * free_space_indices.size();
-  std::pair<int, int> free_point = free_space_indices[rand_index];
+  int rand_index = drand48() * free_space_->cell_count;
+  int i, j;
+  map_free_space_cell(free_space_, rand_index, &i, &j);
   pf_vector_t p;
-  p.v[0] = MAP_WXGX(map, free_point.first);
-  p.v[1] = MAP_WYGY(map, free_point.second);
+  p.v[0] = MAP_WXGX(map, i);
+  p.v[1] = MAP_WYGY(map, j);
   p.v[2] = drand48() * 2 * M_PI - M_PI;
 #else
   double min_x, max_x, min_y, max_y;
@@ -422,7 +629,7 @@ AmclNode::uniformPoseGenerator(void * arg)
     int i, j;
     i = MAP_GXWX(map, p.v[0]);
     j = MAP_GYWY(map, p.v[1]);
-    if (MAP_VALID(map, i, j) && (map->cells[MAP_INDEX(map, i, j)].occ_state == -1)) {
+    if (MAP_VALID(map, i, j) && (map_occ_state(map, MAP_INDEX(map, i, j)) == -1)) {
       break;
     }
   }
@@ -430,6 +637,247 @@ AmclNode::uniformPoseGenerator(void * arg)
   return p;
 }
 
+pf_vector_t
+AmclNode::candidatePoseGenerator(void * arg)
+{
+  AmclNode * node = reinterpret_cast<AmclNode *>(arg);
+  pf_vector_t p = node->global_candidates_[node->next_candidate_];
+  node->next_candidate_ = (node->next_candidate_ + 1) % node->global_candidates_.size();
+  return p;
+}
+
+void
+AmclNode::createCoarseField()
+{
+  // Each coarse cell holds the smallest obstacle distance in its block, so a
+  // candidate is never scored worse than it would be at full resolution. A shared map comes
+  // with its distance field and is not to be changed
+  if (!share_maps_) {
+    map_update_cspace(map_, laser_likelihood_max_dist_);
+  }
+  int ds = std::max(1, global_localization_downsample_);
+  coarse_size_x_ = (map_->size_x + ds - 1) / ds;
+  coarse_size_y_ = (map_->size_y + ds - 1) / ds;
+  coarse_field_.assign(coarse_size_x_ * coarse_size_y_,
+    static_cast<float>(map_->max_occ_dist));
+  for (int j = 0; j < map_->size_y; j++) {
+    for (int i = 0; i < map_->size_x; i++) {
+      float & coarse = coarse_field_[i / ds + (j / ds) * coarse_size_x_];
+      coarse = std::min(coarse, static_cast<float>(map_occ_dist(map_, MAP_INDEX(map_, i, j))));
+    }
+  }
+}
+
+bool
+AmclNode::seedGlobalLocalization(
+  const int & laser_index,
+  const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan)
+{
+  nav2_amcl::LaserData ldata;
+  if (free_space_->cell_count == 0 || !scanToLaserData(laser_index, laser_scan, ldata)) {
+    return false;
+  }
+  if (coarse_field_.empty()) {
+    createCoarseField();
+  }
+
+  std::vector<std::array<double, 2>> endpoints;
+  scanEndpoints(laser_index, ldata, endpoints);
+  if (endpoints.empty()) {
+    return false;
+  }
+
+  // Score uniform candidates with the likelihood field model on the coarse
+  // field, and keep the best max_particles_ of them
+  int ds = std::max(1, global_localization_downsample_);
+  int candidate_count = max_particles_ * std::max(1, global_localization_candidates_);
+  double z_hit_denom = 2 * sigma_hit_ * sigma_hit_;
+  double z_rand_mult = 1.0 / ldata.range_max;
+  std::vector<std::pair<double, pf_vector_t>> scored(candidate_count);
+  for (int k = 0; k < candidate_count; k++) {
+    pf_vector_t pose = uniformPoseGenerator(map_);
+    double c = cos(pose.v[2]);
+    double s = sin(pose.v[2]);
+    double score = 0.0;
+    for (const auto & endpoint : endpoints) {
+      double x = pose.v[0] + c * endpoint[0] - s * endpoint[1];
+      double y = pose.v[1] + s * endpoint[0] + c * endpoint[1];
+      int mi = MAP_GXWX(map_, x);
+      int mj = MAP_GYWY(map_, y);
+      double z = MAP_VALID(map_, mi, mj) ?
+        coarse_field_[mi / ds + (mj / ds) * coarse_size_x_] : map_->max_occ_dist;
+      score += log(z_hit_ * exp(-(z * z) / z_hit_denom) + z_rand_ * z_rand_mult);
+    }
+    scored[k] = std::make_pair(score, pose);
+  }
+  size_t keep = std::min(static_cast<size_t>(max_particles_), scored.size());
+  std::nth_element(scored.begin(), scored.begin() + (keep - 1), scored.end(),
+    [](const std::pair<double, pf_vector_t> & a, const std::pair<double, pf_vector_t> & b) {
+      return a.first > b.first;
+    });
+
+  global_candidates_.resize(keep);
+  for (size_t k = 0; k < keep; k++) {
+    global_candidates_[k] = scored[k].second;
+  }
+  next_candidate_ = 0;
+  pf_init_model(pf_, (pf_init_model_fn_t)AmclNode::candidatePoseGenerator,
+    reinterpret_cast<void *>(this));
+  RCLCPP_INFO(get_logger(), "Seeded global localization with the best %zu of %d candidates",
+    keep, candidate_count);
+  return true;
+}
+
+void
+AmclNode::saveCheckpoint(const pf_sample_set_t * set)
+{
+  if (checkpoint_file_.empty() || !initial_pose_is_known_) {return;}
+  auto stamp = std::chrono::steady_clock::now();
+  if (checkpoint_rate_ > 0.0 &&
+    std::chrono::duration<double>(stamp - last_checkpoint_time_).count() < 1.0 / checkpoint_rate_)
+  {
+    return;
+  }
+  // A write that is still going is left to finish, and this checkpoint skipped
+  if (checkpoint_write_.valid()) {
+    if (checkpoint_write_.wait_for(0s) != std::future_status::ready) {
+      return;
+    }
+    if (!checkpoint_write_.get()) {
+      RCLCPP_WARN(get_logger(), "Could not checkpoint the particles in %s",
+        checkpoint_file_.c_str());
+    }
+  }
+  last_checkpoint_time_ = stamp;
+
+  // Only the copy is made here; the scans should not wait for the disk
+  auto checkpoint = std::make_shared<ParticleCheckpoint>();
+  checkpoint->map_id = map_id_;
+  checkpoint->stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  checkpoint->assign(set);
+  std::string filename = checkpoint_file_;
+  checkpoint_write_ = std::async(std::launch::async, [filename, checkpoint]() {
+      return saveParticleCheckpoint(filename, *checkpoint);
+    });
+}
+
+void
+AmclNode::loadCheckpoint()
+{
+  checkpoint_.reset();
+  auto checkpoint = std::make_unique<ParticleCheckpoint>();
+  if (!loadParticleCheckpoint(checkpoint_file_, *checkpoint)) {
+    RCLCPP_INFO(get_logger(), "No particle checkpoint in %s", checkpoint_file_.c_str());
+    return;
+  }
+  // The system clock, as the checkpoint may be from before a reboot
+  double age = 1e-9 * (std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count() - checkpoint->stamp);
+  if (age < 0.0 || age > checkpoint_max_age_) {
+    RCLCPP_INFO(get_logger(), "Ignoring the particle checkpoint taken %.0f s ago", age);
+    return;
+  }
+  RCLCPP_INFO(get_logger(), "Read a checkpoint of %zu particles taken %.1f s ago",
+    checkpoint->x.size(), age);
+  checkpoint_ = std::move(checkpoint);
+}
+
+bool
+AmclNode::restoreCheckpoint()
+{
+  if (!checkpoint_) {
+    return false;
+  }
+  std::unique_ptr<ParticleCheckpoint> checkpoint = std::move(checkpoint_);
+  if (checkpoint->map_id != map_id_) {
+    RCLCPP_WARN(get_logger(), "The particle checkpoint is of another map, not restoring it");
+    return false;
+  }
+
+  // Draw max_particles poses from the saved ones in proportion to their
+  // weights, evenly spaced as in low variance resampling, for pf_init_model to
+  // hand out in turn
+  double total = 0.0;
+  for (double weight : checkpoint->weight) {
+    total += weight;
+  }
+  if (!(total > 0.0)) {
+    return false;
+  }
+  global_candidates_.resize(max_particles_);
+  double step = total / max_particles_;
+  double cumulative = checkpoint->weight[0];
+  size_t i = 0;
+  for (int k = 0; k < max_particles_; k++) {
+    double target = (k + 0.5) * step;
+    while (cumulative < target && i + 1 < checkpoint->weight.size()) {
+      cumulative += checkpoint->weight[++i];
+    }
+    global_candidates_[k].v[0] = checkpoint->x[i];
+    global_candidates_[k].v[1] = checkpoint->y[i];
+    global_candidates_[k].v[2] = checkpoint->theta[i];
+  }
+  next_candidate_ = 0;
+  pf_init_model(pf_, (pf_init_model_fn_t)AmclNode::candidatePoseGenerator,
+    reinterpret_cast<void *>(this));
+
+  RCLCPP_INFO(get_logger(), "Restored %zu particles from the checkpoint", checkpoint->x.size());
+  pf_init_ = false;
+  global_localization_pending_ = false;
+  init_pose_received_on_inactive = false;
+  initial_pose_is_known_ = true;
+  return true;
+}
+
+void
+AmclNode::scanEndpoints(
+  const int & laser_index, const nav2_amcl::LaserData & ldata,
+  std::vector<std::array<double, 2>> & endpoints)
+{
+  pf_vector_t laser_pose = lasers_[laser_index]->GetLaserPose();
+  int step = max_beams_ > 1 ? (ldata.range_count - 1) / (max_beams_ - 1) : 1;
+  step = std::max(step, 1);
+  endpoints.clear();
+  for (int i = 0; i < ldata.range_count; i += step) {
+    if (ldata.ranges[i] < ldata.range_max) {
+      endpoints.push_back({{laser_pose.v[0] + ldata.ranges[i] * cos(ldata.bearings[i]),
+          laser_pose.v[1] + ldata.ranges[i] * sin(ldata.bearings[i])}});
+    }
+  }
+}
+
+bool
+AmclNode::refinePose(
+  const int & laser_index,
+  const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan,
+  pf_vector_t & pose)
+{
+  nav2_amcl::LaserData ldata;
+  if (!scanToLaserData(laser_index, laser_scan, ldata)) {
+    return false;
+  }
+  std::vector<std::array<double, 2>> endpoints;
+  scanEndpoints(laser_index, ldata, endpoints);
+
+  // The beam model leaves the distance field to be built here; a shared map
+  // comes with its own
+  if (!share_maps_) {
+    map_update_cspace(map_, laser_likelihood_max_dist_);
+  }
+  double score = 0.0;
+  if (!scan_matcher_.match(map_, sigma_hit_, endpoints, scan_match_linear_window_,
+    scan_match_angular_window_, scan_match_min_score_, pose, &score))
+  {
+    RCLCPP_DEBUG(get_logger(), "Scan matching found no pose scoring %.2f, keeping the filter's",
+      scan_match_min_score_);
+    return false;
+  }
+  RCLCPP_DEBUG(get_logger(), "Scan matching refined the pose to (%.3f, %.3f, %.3f), score %.2f",
+    pose.v[0], pose.v[1], pose.v[2], score);
+  return true;
+}
+
 void
 AmclNode::globalLocalizationCallback(
   const std::shared_ptr<rmw_request_id_t>/*request_header*/,
@@ -440,6 +888,10 @@ AmclNode::globalLocalizationCallback(
 
   pf_init_model(pf_, (pf_init_model_fn_t)AmclNode::uniformPoseGenerator,
     reinterpret_cast<void *>(map_));
+  if (global_localization_coarse_) {
+    RCLCPP_INFO(get_logger(), "Seeding global localization from the next scan");
+    global_localization_pending_ = true;
+  }
   RCLCPP_INFO(get_logger(), "Global initialisation done!");
   initial_pose_is_known_ = true;
   pf_init_ = false;
@@ -544,6 +996,7 @@ AmclNode::handleInitialPose(geometry_msgs::msg::PoseWithCovarianceStamped & msg)
 
   pf_init(pf_, pf_init_pose_mean, pf_init_pose_cov);
   pf_init_ = false;
+  global_localization_pending_ = false;
   init_pose_received_on_inactive = false;
   initial_pose_is_known_ = true;
 }
@@ -562,6 +1015,13 @@ AmclNode::laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
     return;
   }
 
+  if (pending_reconfiguration_) {
+    applyReconfiguration();
+  }
+
+  nav2_util::ExecutionTimer total_timer, timer;
+  total_timer.start();
+
   std::string laser_scan_frame_id = nav2_util::strip_leading_slash(laser_scan->header.frame_id);
   last_laser_received_ts_ = now();
   int laser_index = -1;
@@ -577,14 +1037,42 @@ AmclNode::laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
     laser_index = frame_to_laser_[laser_scan->header.frame_id];
   }
 
+  // A coarse-to-fine global localization seeds the filter from this scan; the
+  // update below then refines it at full resolution
+  if (global_localization_pending_) {
+    global_localization_pending_ = false;
+    seedGlobalLocalization(laser_index, laser_scan);
+  }
+
+  // In fused mode, hold scans back until every laser has one, or until the
+  // oldest one is scan_fusion_window old, then update with all of them
+  bool fuse = fuse_scans_ && sensor_model_type_ != "beam";
+  if (fuse) {
+    pending_scans_[laser_index] = laser_scan;
+    rclcpp::Time newest(laser_scan->header.stamp);
+    double oldest_age = 0.0;
+    for (const auto & pending : pending_scans_) {
+      oldest_age = std::max(oldest_age,
+          (newest - rclcpp::Time(pending.second->header.stamp)).seconds());
+    }
+    if (pending_scans_.size() < lasers_.size() && oldest_age < scan_fusion_window_) {
+      return;
+    }
+  }
+
   // Where was the robot when this scan was taken?
   pf_vector_t pose;
+  timer.start();
   if (!getOdomPose(latest_odom_pose_, pose.v[0], pose.v[1], pose.v[2],
     laser_scan->header.stamp, base_frame_id_))
   {
     RCLCPP_ERROR(get_logger(), "Couldn't determine robot's pose associated with laser scan");
     return;
   }
+  timer.end();
+  recordStage(STAGE_ODOM_TF, timer);
+  nav2_util::BlackBox::global().record(scan_channel_, *laser_scan);
+  nav2_util::BlackBox::global().record(odom_pose_channel_, latest_odom_pose_);
 
   pf_vector_t delta = pf_vector_zero();
   bool force_publication = false;
@@ -607,35 +1095,84 @@ AmclNode::laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
       }
     }
     if (lasers_update_[laser_index]) {
+      timer.start();
       motion_model_->odometryUpdate(pf_, pose, delta);
+      timer.end();
+      recordStage(STAGE_MOTION_UPDATE, timer);
     }
     force_update_ = false;
   }
 
   bool resampled = false;
 
+  // With async_publish, collect everything published below into one
+  // snapshot for the publisher thread.  If it has fallen so far behind that
+  // the ring is full, the pose and transform go out from here instead and
+  // the particle cloud is dropped.
+  if (async_publish_) {
+    pending_snapshot_ = publish_ring_.back();
+    if (pending_snapshot_) {
+      pending_snapshot_->has_transform = false;
+      pending_snapshot_->has_pose = false;
+      pending_snapshot_->has_cloud = false;
+    }
+  }
+
   // If the robot has moved, update the filter
   if (lasers_update_[laser_index]) {
-    updateFilter(laser_index, laser_scan, pose);
+    NAV2_TRACEPOINT2(amcl_update_start, laser_index, fuse);
+    if (fuse) {
+      updateFilterFused(pose);
+    } else {
+      updateFilter(laser_index, laser_scan, pose);
+    }
+    NAV2_TRACEPOINT2(amcl_update_end, laser_index, last_beam_count_);
 
-    // Resample the particles
+    // Resample the particles, unless their weights are spread evenly enough to
+    // carry on with them
     if (!(++resample_count_ % resample_interval_)) {
-      pf_update_resample(pf_);
+      pf_sample_set_t * set = pf_->sets + pf_->current_set;
+      bool degenerate = resample_ess_threshold_ <= 0.0 ||
+        pf_->n_eff < resample_ess_threshold_ * set->sample_count;
+      bool recovering = pf_->w_slow > 0.0 && pf_->w_fast < pf_->w_slow;
+      timer.start();
+      if (degenerate || recovering) {
+        pf_update_resample(pf_);
+      } else {
+        RCLCPP_DEBUG(get_logger(), "Skipping the resample at %.0f effective particles of %d",
+          pf_->n_eff, set->sample_count);
+        pf_update_stats(pf_);
+      }
+      timer.end();
+      recordStage(STAGE_RESAMPLE, timer);
       resampled = true;
     }
 
     pf_sample_set_t * set = pf_->sets + pf_->current_set;
     RCLCPP_DEBUG(get_logger(), "Num samples: %d\n", set->sample_count);
 
+    timer.start();
     if (!force_update_) {
       publishParticleCloud(set);
     }
+    saveCheckpoint(set);
+  } else {
+    timer.start();
   }
+  pending_scans_.clear();
   if (resampled || force_publication || !first_pose_sent_) {
     amcl_hyp_t max_weight_hyps;
     std::vector<amcl_hyp_t> hyps;
     int max_weight_hyp = -1;
     if (getMaxWeightHyp(hyps, max_weight_hyps, max_weight_hyp)) {
+      // The filter's covariance is kept, as the match only moves its mean
+      if (scan_match_refinement_) {
+        nav2_util::ExecutionTimer match_timer;
+        match_timer.start();
+        refinePose(laser_index, laser_scan, hyps[max_weight_hyp].pf_pose_mean);
+        match_timer.end();
+        recordStage(STAGE_SCAN_MATCH, match_timer);
+      }
       publishAmclPose(laser_scan, hyps, max_weight_hyp);
       calculateMaptoOdomTransform(laser_scan, hyps, max_weight_hyp);
 
@@ -659,6 +1196,70 @@ AmclNode::laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
       sendMapToOdomTransform(transform_expiration);
     }
   }
+  if (pending_snapshot_) {
+    publish_ring_.push();
+    pending_snapshot_ = nullptr;
+    publisher_wake_.notify_one();
+  }
+  timer.end();
+  recordStage(STAGE_PUBLISH, timer);
+
+  total_timer.end();
+  recordStage(STAGE_TOTAL, total_timer);
+
+  if (latency_diagnostics_rate_ > 0.0 &&
+    (now() - last_diagnostics_time_).seconds() >= 1.0 / latency_diagnostics_rate_)
+  {
+    publishLatencyDiagnostics();
+    last_diagnostics_time_ = now();
+  }
+}
+
+void
+AmclNode::recordStage(Stage stage, nav2_util::ExecutionTimer & timer)
+{
+  stage_latency_[stage].add(timer.elapsed_time_in_seconds());
+  stage_histograms_[stage]->record(timer.elapsed_time());
+}
+
+void
+AmclNode::publishLatencyDiagnostics()
+{
+
+  auto msg = std::make_unique<diagnostic_msgs::msg::DiagnosticArray>();
+  msg->header.stamp = now();
+
+  diagnostic_msgs::msg::DiagnosticStatus status;
+  status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+  status.name = std::string(get_name()) + ": filter latency";
+  status.hardware_id = global_frame_id_;
+  status.message = "Per-stage latency in milliseconds over the most recent updates";
+
+  auto add_value = [&status](const std::string & key, const std::string & value) {
+      diagnostic_msgs::msg::KeyValue kv;
+      kv.key = key;
+      kv.value = value;
+      status.values.push_back(kv);
+    };
+
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    const StageLatency & latency = stage_latency_[i];
+    if (latency.count() == 0) {
+      continue;
+    }
+    add_value(std::string(STAGE_NAMES[i]) + ".p50",
+      std::to_string(1e3 * latency.percentile(0.5)));
+    add_value(std::string(STAGE_NAMES[i]) + ".p99",
+      std::to_string(1e3 * latency.percentile(0.99)));
+  }
+
+  pf_sample_set_t * set = pf_->sets + pf_->current_set;
+  add_value("particle_count", std::to_string(set->sample_count));
+  add_value("beam_count", std::to_string(last_beam_count_));
+  add_value("dropped_scans", std::to_string(dropped_scans_.load()));
+
+  msg->status.push_back(status);
+  diagnostics_pub_->publish(std::move(msg));
 }
 
 bool AmclNode::addNewScanner(
@@ -667,9 +1268,11 @@ bool AmclNode::addNewScanner(
   const std::string & laser_scan_frame_id,
   geometry_msgs::msg::PoseStamped & laser_pose)
 {
-  lasers_.push_back(createLaserObject());
+  lasers_.push_back(createLaserObject(max_beams_));
   lasers_update_.push_back(true);
   laser_index = frame_to_laser_.size();
+  scan_buffers_.resize(std::max(scan_buffers_.size(), static_cast<size_t>(laser_index) + 1));
+  scan_buffers_[laser_index].reserve(laser_scan->ranges.size());
 
   geometry_msgs::msg::PoseStamped ident;
   ident.header.frame_id = laser_scan_frame_id;
@@ -684,6 +1287,7 @@ bool AmclNode::addNewScanner(
       base_frame_id_.c_str(), e.what());
     return false;
   }
+  nav2_util::BlackBox::global().record(laser_pose_channel_, laser_pose);
 
   pf_vector_t laser_pose_v;
   laser_pose_v.v[0] = laser_pose.pose.position.x;
@@ -709,12 +1313,11 @@ bool AmclNode::shouldUpdateFilter(const pf_vector_t pose, pf_vector_t & delta)
   return update;
 }
 
-bool AmclNode::updateFilter(
+bool AmclNode::scanToLaserData(
   const int & laser_index,
   const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan,
-  const pf_vector_t & pose)
+  nav2_amcl::LaserData & ldata)
 {
-  nav2_amcl::LaserData ldata;
   ldata.laser = lasers_[laser_index];
   ldata.range_count = laser_scan->ranges.size();
   // To account for lasers that are mounted upside-down, we determine the
@@ -729,6 +1332,8 @@ bool AmclNode::updateFilter(
 
   inc_q.header = min_q.header;
   inc_q.quaternion = orientationAroundZAxis(laser_scan->angle_min + laser_scan->angle_increment);
+  nav2_util::ExecutionTimer timer;
+  timer.start();
   try {
     tf_buffer_->transform(min_q, min_q, base_frame_id_);
     tf_buffer_->transform(inc_q, inc_q, base_frame_id_);
@@ -737,6 +1342,8 @@ bool AmclNode::updateFilter(
       e.what());
     return false;
   }
+  timer.end();
+  recordStage(STAGE_LASER_TF, timer);
   double angle_min = tf2::getYaw(min_q.quaternion);
   double angle_increment = tf2::getYaw(inc_q.quaternion) - angle_min;
 
@@ -760,42 +1367,222 @@ bool AmclNode::updateFilter(
     range_min = laser_scan->range_min;
   }
 
-  // The LaserData destructor will free this memory
-  ldata.ranges = new double[ldata.range_count][2];
-  for (int i = 0; i < ldata.range_count; i++) {
-    // amcl doesn't (yet) have a concept of min range.  So we'll map short
-    // readings to max range.
-    if (laser_scan->ranges[i] <= range_min) {
-      ldata.ranges[i][0] = ldata.range_max;
-    } else {
-      ldata.ranges[i][0] = laser_scan->ranges[i];
+  // Reuse the laser's buffers, and its bearings while its angles are unchanged
+  scan_buffers_[laser_index].fill(
+    laser_scan->ranges, range_min, ldata.range_max, angle_min, angle_increment, ldata);
+  return true;
+}
+
+bool AmclNode::updateFilter(
+  const int & laser_index,
+  const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan,
+  const pf_vector_t & pose)
+{
+  nav2_amcl::LaserData ldata;
+  if (!scanToLaserData(laser_index, laser_scan, ldata)) {
+    return false;
+  }
+
+  // Until the filter converges, and once there is a timing estimate, pick
+  // as many informative beams as fit in the time budget
+  nav2_amcl::LaserData * data = &ldata;
+  nav2_amcl::LaserData selected;
+  if (adaptive_beams_ && !pf_->converged && sensor_time_per_beam_ > 0.0) {
+    int budget = static_cast<int>(sensor_time_budget_ / sensor_time_per_beam_);
+    budget = std::max(adaptive_min_beams_, std::min(budget, max_beams_));
+    beam_selector_.select(ldata, budget, selected);
+    data = &selected;
+  }
+
+  // Number of beams the models evaluate: they subsample to max_beams_ and
+  // ignore max range readings
+  int step = max_beams_ > 1 ? (data->range_count - 1) / (max_beams_ - 1) : 1;
+  step = std::max(step, 1);
+  last_beam_count_ = 0;
+  for (int i = 0; i < data->range_count; i += step) {
+    if (data->ranges[i] < data->range_max) {
+      last_beam_count_++;
     }
-    // Compute bearing
-    ldata.ranges[i][1] = angle_min +
-      (i * angle_increment);
   }
-  lasers_[laser_index]->sensorUpdate(pf_, reinterpret_cast<nav2_amcl::LaserData *>(&ldata));
+
+  nav2_util::ExecutionTimer timer;
+  timer.start();
+  lasers_[laser_index]->sensorUpdate(pf_, data);
+  timer.end();
+  recordStage(STAGE_SENSOR_UPDATE, timer);
+
+  // Running estimate of the laser model's cost per beam
+  if (last_beam_count_ > 0) {
+    double per_beam = timer.elapsed_time_in_seconds() / last_beam_count_;
+    sensor_time_per_beam_ = sensor_time_per_beam_ > 0.0 ?
+      0.8 * sensor_time_per_beam_ + 0.2 * per_beam : per_beam;
+  }
   lasers_update_[laser_index] = false;
   pf_odom_pose_ = pose;
   return true;
 }
 
+bool AmclNode::updateFilterFused(const pf_vector_t & pose)
+{
+  // Every beam of every pending scan, as an endpoint in the base frame.  The
+  // likelihood field models only look at the endpoints, so expressing them
+  // as ranges and bearings from the base origin evaluates them exactly.
+  std::vector<std::array<double, 2>> beams;
+  double range_max = 0.0;
+  for (const auto & pending : pending_scans_) {
+    nav2_amcl::LaserData ldata;
+    if (!scanToLaserData(pending.first, pending.second, ldata)) {
+      continue;
+    }
+    pf_vector_t laser_pose = lasers_[pending.first]->GetLaserPose();
+    range_max = std::max(range_max, ldata.range_max + hypot(laser_pose.v[0], laser_pose.v[1]));
+
+    // Subsample each scan to max_beams_ as the per-scan update would
+    int step = max_beams_ > 1 ? (ldata.range_count - 1) / (max_beams_ - 1) : 1;
+    step = std::max(step, 1);
+    for (int i = 0; i < ldata.range_count; i += step) {
+      double range = ldata.ranges[i];
+      double bearing = ldata.bearings[i];
+      if (!(range < ldata.range_max)) {
+        continue;
+      }
+      double x = laser_pose.v[0] + range * cos(bearing);
+      double y = laser_pose.v[1] + range * sin(bearing);
+      beams.push_back({{hypot(x, y), atan2(y, x)}});
+    }
+  }
+  pending_scans_.clear();
+
+  if (beams.empty()) {
+    return false;
+  }
+
+  // One model instance, at the base origin, evaluates the combined scan
+  int beam_count = static_cast<int>(beams.size());
+  if (!fused_laser_ || fused_laser_beams_ < beam_count) {
+    fused_laser_beams_ = std::max(beam_count, max_beams_ * static_cast<int>(lasers_.size()));
+    fused_laser_.reset(createLaserObject(fused_laser_beams_));
+    pf_vector_t origin = pf_vector_zero();
+    fused_laser_->SetLaserPose(origin);
+  }
+
+  nav2_amcl::LaserData fused;
+  fused.laser = fused_laser_.get();
+  fused.range_count = beam_count;
+  fused.range_max = range_max;
+  fused.allocate(beam_count);
+  for (int i = 0; i < beam_count; i++) {
+    fused.ranges[i] = beams[i][0];
+    fused.bearings[i] = beams[i][1];
+  }
+  last_beam_count_ = beam_count;
+
+  nav2_util::ExecutionTimer timer;
+  timer.start();
+  fused_laser_->sensorUpdate(pf_, &fused);
+  timer.end();
+  recordStage(STAGE_SENSOR_UPDATE, timer);
+
+  for (unsigned int i = 0; i < lasers_update_.size(); i++) {
+    lasers_update_[i] = false;
+  }
+  pf_odom_pose_ = pose;
+  return true;
+}
+
 void
 AmclNode::publishParticleCloud(const pf_sample_set_t * set)
 {
   // If initial pose is not known, AMCL does not know the current pose
   if (!initial_pose_is_known_) {return;}
-  geometry_msgs::msg::PoseArray cloud_msg;
-  cloud_msg.header.stamp = this->now();
-  cloud_msg.header.frame_id = global_frame_id_;
-  cloud_msg.poses.resize(set->sample_count);
+  if (particlecloud_pub_->get_subscription_count() == 0 &&
+    compact_particlecloud_pub_->get_subscription_count() == 0)
+  {
+    return;
+  }
+  rclcpp::Time stamp = now();
+  if (particle_cloud_rate_ > 0.0 &&
+    (stamp - last_particle_cloud_time_).seconds() < 1.0 / particle_cloud_rate_)
+  {
+    return;
+  }
+  last_particle_cloud_time_ = stamp;
+
+  // Only the particles are copied here; the messages are built from them on
+  // the publisher thread with async_publish
+  PublishSnapshot * snapshot = async_publish_ ? pending_snapshot_ : &cloud_snapshot_;
+  if (!snapshot) {
+    return;
+  }
+  snapshot->cloud_stamp = stamp;
+  snapshot->particles.resize(set->sample_count);
+  snapshot->weights.resize(set->sample_count);
   for (int i = 0; i < set->sample_count; i++) {
-    cloud_msg.poses[i].position.x = set->samples[i].pose.v[0];
-    cloud_msg.poses[i].position.y = set->samples[i].pose.v[1];
-    cloud_msg.poses[i].position.z = 0;
-    cloud_msg.poses[i].orientation = orientationAroundZAxis(set->samples[i].pose.v[2]);
+    snapshot->particles[i] = pf_sample_pose(set, i);
+    snapshot->weights[i] = set->weight[i];
+  }
+  snapshot->has_cloud = true;
+  if (!async_publish_) {
+    publishClouds(cloud_snapshot_);
+  }
+}
+
+void
+AmclNode::publishClouds(const PublishSnapshot & snapshot)
+{
+  // The particles to publish, in the order of the set
+  int count = snapshot.particles.size();
+  int kept = count;
+  if (particle_cloud_max_particles_ > 0) {
+    kept = std::min(count, particle_cloud_max_particles_);
+  }
+  cloud_indices_.resize(count);
+  std::iota(cloud_indices_.begin(), cloud_indices_.end(), 0);
+  if (kept < count) {
+    if (particle_cloud_sampling_ == "stride") {
+      for (int i = 0; i < kept; i++) {
+        cloud_indices_[i] = static_cast<int64_t>(i) * count / kept;
+      }
+    } else {
+      const std::vector<double> & weights = snapshot.weights;
+      std::nth_element(cloud_indices_.begin(), cloud_indices_.begin() + kept,
+        cloud_indices_.end(), [&weights](int a, int b) {return weights[a] > weights[b];});
+      std::sort(cloud_indices_.begin(), cloud_indices_.begin() + kept);
+    }
+    cloud_indices_.resize(kept);
+  }
+
+  if (particlecloud_pub_->get_subscription_count() > 0) {
+    cloud_msg_.header.stamp = snapshot.cloud_stamp;
+    cloud_msg_.header.frame_id = global_frame_id_;
+    cloud_msg_.poses.resize(kept);
+    for (int i = 0; i < kept; i++) {
+      const pf_vector_t & pose = snapshot.particles[cloud_indices_[i]];
+      cloud_msg_.poses[i].position.x = pose.v[0];
+      cloud_msg_.poses[i].position.y = pose.v[1];
+      cloud_msg_.poses[i].position.z = 0;
+      cloud_msg_.poses[i].orientation = orientationAroundZAxis(pose.v[2]);
+    }
+    particlecloud_pub_->publish(cloud_msg_);
+  }
+
+  if (compact_particlecloud_pub_->get_subscription_count() > 0) {
+    compact_cloud_msg_.header.stamp = snapshot.cloud_stamp;
+    compact_cloud_msg_.header.frame_id = global_frame_id_;
+    compact_cloud_msg_.particle_count = count;
+    compact_cloud_msg_.x.resize(kept);
+    compact_cloud_msg_.y.resize(kept);
+    compact_cloud_msg_.yaw.resize(kept);
+    compact_cloud_msg_.weight.resize(kept);
+    for (int i = 0; i < kept; i++) {
+      int index = cloud_indices_[i];
+      compact_cloud_msg_.x[i] = snapshot.particles[index].v[0];
+      compact_cloud_msg_.y[i] = snapshot.particles[index].v[1];
+      compact_cloud_msg_.yaw[i] = snapshot.particles[index].v[2];
+      compact_cloud_msg_.weight[i] = snapshot.weights[index];
+    }
+    compact_particlecloud_pub_->publish(compact_cloud_msg_);
   }
-  particlecloud_pub_->publish(cloud_msg);
 }
 
 bool
@@ -880,7 +1667,12 @@ AmclNode::publishAmclPose(
   temp += p.pose.pose.position.x + p.pose.pose.position.y;
   if (!std::isnan(temp)) {
     RCLCPP_DEBUG(get_logger(), "Publishing pose");
-    pose_pub_->publish(p);
+    if (pending_snapshot_) {
+      pending_snapshot_->pose = p;
+      pending_snapshot_->has_pose = true;
+    } else {
+      pose_pub_->publish(p);
+    }
     first_pose_sent_ = true;
     last_published_pose_ = p;
   } else {
@@ -933,27 +1725,106 @@ AmclNode::sendMapToOdomTransform(const tf2::TimePoint & transform_expiration)
   tmp_tf_stamped.header.stamp = tf2_ros::toMsg(transform_expiration);
   tmp_tf_stamped.child_frame_id = odom_frame_id_;
   tf2::impl::Converter<false, true>::convert(latest_tf_.inverse(), tmp_tf_stamped.transform);
-  tf_broadcaster_->sendTransform(tmp_tf_stamped);
+  if (pending_snapshot_) {
+    pending_snapshot_->transform = tmp_tf_stamped;
+    pending_snapshot_->has_transform = true;
+  } else {
+    tf_broadcaster_->sendTransform(tmp_tf_stamped);
+  }
+}
+
+void
+AmclNode::startPublisherThread()
+{
+  if (publisher_running_) {
+    return;
+  }
+  while (!publish_ring_.empty()) {
+    publish_ring_.pop();
+  }
+  publisher_running_ = true;
+  publisher_thread_ = std::thread(&AmclNode::publisherLoop, this);
+}
+
+void
+AmclNode::stopPublisherThread()
+{
+  if (!publisher_running_) {
+    return;
+  }
+  publisher_running_ = false;
+  publisher_wake_.notify_one();
+  publisher_thread_.join();
+}
+
+void
+AmclNode::publisherLoop()
+{
+  // Runs until stopPublisherThread, then drains what is left in the ring
+  while (true) {
+    PublishSnapshot * snapshot = publish_ring_.front();
+    if (!snapshot) {
+      if (!publisher_running_) {
+        return;
+      }
+      // The ring itself takes no lock; the mutex only serves the wait, and
+      // the timeout covers a notification that arrives before we sleep
+      std::unique_lock<std::mutex> lock(publisher_wake_mutex_);
+      publisher_wake_.wait_for(lock, 10ms);
+      continue;
+    }
+
+    // The transform first, since it is what other nodes are waiting on
+    if (snapshot->has_transform) {
+      tf_broadcaster_->sendTransform(snapshot->transform);
+    }
+    if (snapshot->has_pose) {
+      pose_pub_->publish(snapshot->pose);
+    }
+    if (snapshot->has_cloud) {
+      publishClouds(*snapshot);
+    }
+    publish_ring_.pop();
+  }
 }
 
 nav2_amcl::Laser *
-AmclNode::createLaserObject()
+AmclNode::createLaserObject(int max_beams)
 {
   RCLCPP_INFO(get_logger(), "createLaserObject");
 
   if (sensor_model_type_ == "beam") {
     return new nav2_amcl::BeamModel(z_hit_, z_short_, z_max_, z_rand_, sigma_hit_, lambda_short_,
-             0.0, max_beams_, map_);
+             0.0, max_beams, map_);
   }
 
+  // a shared map keeps the distances it was prepared with
+  double max_occ_dist = share_maps_ ? map_->max_occ_dist : laser_likelihood_max_dist_;
+  nav2_amcl::Laser * laser;
   if (sensor_model_type_ == "likelihood_field_prob") {
-    return new nav2_amcl::LikelihoodFieldModelProb(z_hit_, z_rand_, sigma_hit_,
-             laser_likelihood_max_dist_, do_beamskip_, beam_skip_distance_, beam_skip_threshold_,
-             beam_skip_error_threshold_, max_beams_, map_);
+    laser = new nav2_amcl::LikelihoodFieldModelProb(z_hit_, z_rand_, sigma_hit_,
+        max_occ_dist, do_beamskip_, beam_skip_distance_, beam_skip_threshold_,
+        beam_skip_error_threshold_, max_particles_, max_beams, map_);
+  } else if (sensor_model_type_ == "likelihood_field_batch") {
+    laser = new nav2_amcl::LikelihoodFieldModelBatch(z_hit_, z_rand_, sigma_hit_,
+        max_occ_dist, max_beams, map_);
+  } else if (sensor_model_type_ == "likelihood_field_gpu") {
+    auto gpu_laser = new nav2_amcl::LikelihoodFieldModelGPU(z_hit_, z_rand_, sigma_hit_,
+        max_occ_dist, max_beams, map_);
+    if (!gpu_laser->onDevice()) {
+      RCLCPP_WARN(get_logger(), "No CUDA device or AMCL built without AMCL_CUDA, the "
+        "likelihood_field_gpu model runs on the CPU as likelihood_field_batch");
+    }
+    laser = gpu_laser;
+  } else {
+    laser = new nav2_amcl::LikelihoodFieldModel(z_hit_, z_rand_, sigma_hit_,
+        max_occ_dist, max_beams, map_);
   }
 
-  return new nav2_amcl::LikelihoodFieldModel(z_hit_, z_rand_, sigma_hit_,
-           laser_likelihood_max_dist_, max_beams_, map_);
+  if (use_hit_prob_table_) {
+    laser->enableHitProbTable();
+  }
+  return laser;
 }
 
 void
@@ -961,18 +1832,32 @@ AmclNode::initParameters()
 {
   double save_pose_rate;
   double tmp_tol;
+  int map_tile_size;
 
+  get_parameter("adaptive_beams", adaptive_beams_);
+  get_parameter("adaptive_min_beams", adaptive_min_beams_);
   get_parameter("alpha1", alpha1_);
   get_parameter("alpha2", alpha2_);
   get_parameter("alpha3", alpha3_);
   get_parameter("alpha4", alpha4_);
   get_parameter("alpha5", alpha5_);
+  get_parameter("async_publish", async_publish_);
   get_parameter("base_frame_id", base_frame_id_);
   get_parameter("beam_skip_distance", beam_skip_distance_);
   get_parameter("beam_skip_error_threshold", beam_skip_error_threshold_);
   get_parameter("beam_skip_threshold", beam_skip_threshold_);
+  get_parameter("checkpoint_file", checkpoint_file_);
+  get_parameter("checkpoint_max_age", checkpoint_max_age_);
+  get_parameter("checkpoint_rate", checkpoint_rate_);
   get_parameter("do_beamskip", do_beamskip_);
+  get_parameter("distance_transform", distance_transform_);
+  get_parameter("fuse_scans", fuse_scans_);
   get_parameter("global_frame_id", global_frame_id_);
+  get_parameter("global_localization_coarse", global_localization_coarse_);
+  get_parameter("global_localization_candidates", global_localization_candidates_);
+  get_parameter("global_localization_downsample", global_localization_downsample_);
+  get_parameter("latency_diagnostics_rate", latency_diagnostics_rate_);
+  get_parameter("latest_scan_only", latest_scan_only_);
   get_parameter("lambda_short", lambda_short_);
   get_parameter("laser_likelihood_max_dist", laser_likelihood_max_dist_);
   get_parameter("laser_max_range", laser_max_range_);
@@ -983,18 +1868,39 @@ AmclNode::initParameters()
   get_parameter("initial_pose.y", initial_pose_y_);
   get_parameter("initial_pose.z", initial_pose_z_);
   get_parameter("initial_pose.yaw", initial_pose_yaw_);
+  get_parameter("use_hit_prob_table", use_hit_prob_table_);
+  get_parameter("compact_map", compact_map_);
+  get_parameter("map_cache_directory", map_cache_directory_);
+  get_parameter("map_cache_size", map_cache_size_);
+  get_parameter("share_maps", share_maps_);
+  get_parameter("shared_distance_field", shared_distance_field_);
+  get_parameter("map_tile_size", map_tile_size);
   get_parameter("max_beams", max_beams_);
   get_parameter("max_particles", max_particles_);
   get_parameter("min_particles", min_particles_);
   get_parameter("odom_frame_id", odom_frame_id_);
   get_parameter("pf_err", pf_err_);
   get_parameter("pf_z", pf_z_);
+  get_parameter("particle_cloud_max_particles", particle_cloud_max_particles_);
+  get_parameter("particle_cloud_rate", particle_cloud_rate_);
+  get_parameter("particle_cloud_sampling", particle_cloud_sampling_);
+  get_parameter("particle_histogram", particle_histogram_);
+  get_parameter("random_seed", random_seed_);
   get_parameter("recovery_alpha_fast", alpha_fast_);
   get_parameter("recovery_alpha_slow", alpha_slow_);
+  get_parameter("resample_ess_threshold", resample_ess_threshold_);
   get_parameter("resample_interval", resample_interval_);
+  get_parameter("resample_method", resample_method_);
   get_parameter("robot_model_type", robot_model_type_);
   get_parameter("save_pose_rate", save_pose_rate);
   get_parameter("sigma_hit", sigma_hit_);
+  get_parameter("scan_fusion_window", scan_fusion_window_);
+  get_parameter("scan_match_refinement", scan_match_refinement_);
+  get_parameter("scan_match_angular_window", scan_match_angular_window_);
+  get_parameter("scan_match_linear_window", scan_match_linear_window_);
+  get_parameter("scan_match_min_score", scan_match_min_score_);
+  get_parameter("sensor_time_budget", sensor_time_budget_);
+  get_parameter("sensor_update_threads", sensor_update_threads_);
   get_parameter("tf_broadcast", tf_broadcast_);
   get_parameter("transform_tolerance", tmp_tol);
   get_parameter("update_min_a", a_thresh_);
@@ -1008,11 +1914,25 @@ AmclNode::initParameters()
   save_pose_period_ = tf2::durationFromSec(1.0 / save_pose_rate);
   transform_tolerance_ = tf2::durationFromSec(tmp_tol);
 
+  if (share_maps_ && use_hit_prob_table_) {
+    // the table is rebuilt on the map for each sigma_hit, which other nodes would be reading
+    RCLCPP_WARN(get_logger(), "use_hit_prob_table is ignored while maps are shared");
+    use_hit_prob_table_ = false;
+  }
+
+  map_tile_shift_ = 0;
+  while ((2 << map_tile_shift_) <= map_tile_size && map_tile_shift_ < 8) {
+    map_tile_shift_++;
+  }
+
   odom_frame_id_ = nav2_util::strip_leading_slash(odom_frame_id_);
   base_frame_id_ = nav2_util::strip_leading_slash(base_frame_id_);
   global_frame_id_ = nav2_util::strip_leading_slash(global_frame_id_);
 
   last_time_printed_msg_ = now();
+  last_diagnostics_time_ = now();
+  // Of the clock now() reads, so that the first cloud is never held back
+  last_particle_cloud_time_ = rclcpp::Time(0, 0, get_clock()->get_clock_type());
 
   // Semantic checks
 
@@ -1023,6 +1943,147 @@ AmclNode::initParameters()
   }
 }
 
+namespace
+{
+
+// What changing a parameter at run time takes
+enum Reconfiguration : unsigned
+{
+  RECONFIGURE_LASER_MODEL = 1,   // new weights for the laser models
+  RECONFIGURE_CSPACE = 2,        // the distance field recomputed
+  RECONFIGURE_SAMPLES = 4,       // the sample buffers resized
+  RECONFIGURE_MOTION_MODEL = 8,  // a new motion model
+  RECONFIGURE_FILTER = 16,       // nothing but the new values
+};
+
+const std::vector<std::pair<std::string, unsigned>> tunable_parameters = {
+  {"alpha1", RECONFIGURE_MOTION_MODEL},
+  {"alpha2", RECONFIGURE_MOTION_MODEL},
+  {"alpha3", RECONFIGURE_MOTION_MODEL},
+  {"alpha4", RECONFIGURE_MOTION_MODEL},
+  {"alpha5", RECONFIGURE_MOTION_MODEL},
+  {"lambda_short", RECONFIGURE_LASER_MODEL},
+  {"laser_likelihood_max_dist", RECONFIGURE_CSPACE},
+  {"max_particles", RECONFIGURE_SAMPLES},
+  {"min_particles", RECONFIGURE_SAMPLES},
+  {"pf_err", RECONFIGURE_FILTER},
+  {"pf_z", RECONFIGURE_FILTER},
+  {"recovery_alpha_fast", RECONFIGURE_FILTER},
+  {"recovery_alpha_slow", RECONFIGURE_FILTER},
+  {"resample_ess_threshold", RECONFIGURE_FILTER},
+  {"resample_interval", RECONFIGURE_FILTER},
+  {"sigma_hit", RECONFIGURE_LASER_MODEL},
+  {"update_min_a", RECONFIGURE_FILTER},
+  {"update_min_d", RECONFIGURE_FILTER},
+  {"z_hit", RECONFIGURE_LASER_MODEL},
+  {"z_max", RECONFIGURE_LASER_MODEL},
+  {"z_rand", RECONFIGURE_LASER_MODEL},
+  {"z_short", RECONFIGURE_LASER_MODEL},
+};
+
+}  // namespace
+
+void
+AmclNode::initDynamicParameters()
+{
+  std::vector<std::string> names;
+  for (const auto & tunable : tunable_parameters) {
+    names.push_back(tunable.first);
+  }
+
+  // The events are received on the rclcpp node's thread, and the laser update, on which the
+  // filter is used, picks up the changes of all the events since the last one
+  dynamic_params_client_ = std::make_unique<nav2_dynamic_params::DynamicParamsClient>(
+    rclcpp_node_);
+  dynamic_params_client_->add_known_parameters(get_namespace(), get_name(),
+    get_parameters(names));
+  dynamic_params_client_->set_callback([this]() {
+      unsigned reconfiguration = 0;
+      for (const auto & tunable : tunable_parameters) {
+        if (dynamic_params_client_->is_in_event(get_namespace(), get_name(), tunable.first)) {
+          reconfiguration |= tunable.second;
+        }
+      }
+      pending_reconfiguration_ |= reconfiguration;
+    }, false);
+}
+
+void
+AmclNode::applyReconfiguration()
+{
+  std::lock_guard<std::recursive_mutex> cfl(configuration_mutex_);
+  unsigned reconfiguration = pending_reconfiguration_.exchange(0);
+
+  get_parameter("alpha1", alpha1_);
+  get_parameter("alpha2", alpha2_);
+  get_parameter("alpha3", alpha3_);
+  get_parameter("alpha4", alpha4_);
+  get_parameter("alpha5", alpha5_);
+  get_parameter("lambda_short", lambda_short_);
+  get_parameter("laser_likelihood_max_dist", laser_likelihood_max_dist_);
+  get_parameter("max_particles", max_particles_);
+  get_parameter("min_particles", min_particles_);
+  get_parameter("pf_err", pf_err_);
+  get_parameter("pf_z", pf_z_);
+  get_parameter("recovery_alpha_fast", alpha_fast_);
+  get_parameter("recovery_alpha_slow", alpha_slow_);
+  get_parameter("resample_ess_threshold", resample_ess_threshold_);
+  get_parameter("resample_interval", resample_interval_);
+  get_parameter("sigma_hit", sigma_hit_);
+  get_parameter("update_min_a", a_thresh_);
+  get_parameter("update_min_d", d_thresh_);
+  get_parameter("z_hit", z_hit_);
+  get_parameter("z_max", z_max_);
+  get_parameter("z_rand", z_rand_);
+  get_parameter("z_short", z_short_);
+
+  if (min_particles_ > max_particles_) {
+    RCLCPP_WARN(get_logger(), "You've set min_particles to be greater than max particles,"
+      " this isn't allowed so max_particles will be set to min_particles.");
+    max_particles_ = min_particles_;
+  }
+
+  pf_->pop_err = pf_err_;
+  pf_->pop_z = pf_z_;
+  pf_->alpha_slow = alpha_slow_;
+  pf_->alpha_fast = alpha_fast_;
+
+  if (reconfiguration & RECONFIGURE_SAMPLES) {
+    RCLCPP_INFO(get_logger(), "Resizing the particle filter to %d-%d particles",
+      min_particles_, max_particles_);
+    pf_set_sample_limits(pf_, min_particles_, max_particles_);
+  }
+
+  if (reconfiguration & RECONFIGURE_MOTION_MODEL) {
+    createMotionModel();
+  }
+
+  // The likelihood field models share the map's distance field, which is only recomputed for
+  // the new distance, then the hit probability tables for the new distances or sigma_hit
+  if ((reconfiguration & RECONFIGURE_CSPACE) && map_ && sensor_model_type_ != "beam") {
+    if (share_maps_) {
+      RCLCPP_INFO(get_logger(), "Maps are shared, so the distance field for %.2fm is only "
+        "used from the next map on", laser_likelihood_max_dist_);
+    } else {
+      RCLCPP_INFO(get_logger(), "Recomputing the distance field for %.2fm",
+        laser_likelihood_max_dist_);
+      map_update_cspace(map_, laser_likelihood_max_dist_);
+    }
+  }
+  if (reconfiguration & (RECONFIGURE_LASER_MODEL | RECONFIGURE_CSPACE)) {
+    std::vector<nav2_amcl::Laser *> lasers = lasers_;
+    if (fused_laser_) {
+      lasers.push_back(fused_laser_.get());
+    }
+    for (auto laser : lasers) {
+      laser->setHitModel(z_hit_, z_rand_, sigma_hit_);
+      if (sensor_model_type_ == "beam") {
+        static_cast<nav2_amcl::BeamModel *>(laser)->setShortModel(z_short_, z_max_, lambda_short_);
+      }
+    }
+  }
+}
+
 void
 AmclNode::mapReceived(const nav_msgs::msg::OccupancyGrid::SharedPtr msg)
 {
@@ -1030,7 +2091,7 @@ AmclNode::mapReceived(const nav_msgs::msg::OccupancyGrid::SharedPtr msg)
   if (first_map_only_ && first_map_received_) {
     return;
   }
-  if (initial_pose_is_known_) {
+  if (initial_pose_is_known_ || checkpoint_) {
     handleMapMessage(*msg);
     first_map_received_ = true;
   }
@@ -1057,62 +2118,162 @@ AmclNode::handleMapMessage(const nav_msgs::msg::OccupancyGrid & msg)
   // Clear queued laser objects because they hold pointers to the existing
   // map, #5202.
   lasers_.clear();
+  fused_laser_.reset();
+  pending_scans_.clear();
   lasers_update_.clear();
   frame_to_laser_.clear();
+  scan_buffers_.clear();
 
-  map_ = convertMap(msg);
+  map_holder_ = map_cache_ ? map_cache_->find(msg) : nullptr;
+  if (map_holder_) {
+    RCLCPP_INFO(get_logger(), "Switched to a map prepared before");
+  } else {
+    nav2_util::ExecutionTimer timer;
+    timer.start();
+    map_holder_ = prepareSharedMap(msg);
+    timer.end();
+    record_startup_phase("map conversion and distance field (map_update_cspace)", timer);
+    if (map_cache_) {
+      map_cache_->insert(msg, map_holder_);
+    }
+  }
+  map_ = map_holder_.get();
+  if (!checkpoint_file_.empty()) {
+    map_id_ = map_hash(map_);
+  }
 
 #if NEW_UNIFORM_SAMPLING
-  createFreeSpaceVector();
+  createFreeSpaceIndex();
 #endif
   // Create the particle filter
   initParticleFilter();
   // resample_count = 0 is extra
 
   // Instantiate the sensor objects
-  motion_model_.reset();
-  motion_model_ = std::unique_ptr<nav2_amcl::MotionModel>(nav2_amcl::MotionModel::createMotionModel(
-        robot_model_type_, alpha1_, alpha2_, alpha3_, alpha4_, alpha5_));
+  createMotionModel();
 
   // Laser
   lasers_.clear();
+  fused_laser_.reset();
+  pending_scans_.clear();
+
+  if (!restoreCheckpoint()) {
+    handleInitialPose(last_published_pose_);
+  }
+}
+
+std::shared_ptr<map_t>
+AmclNode::prepareMap(const nav_msgs::msg::OccupancyGrid & map_msg)
+{
+  std::shared_ptr<const nav2_util::DistanceField> field;
+  if (shared_distance_field_ && sensor_model_type_ != "beam") {
+    // 100 is the occupancy convertMap() takes as an obstacle
+    field = nav2_util::sharedDistanceField(map_msg, 100,
+        std::max(1u, std::thread::hardware_concurrency()));
+  }
+  // the map holds the field, for the nodes that load the same map after it to find it
+  std::shared_ptr<map_t> map(convertMap(map_msg), [field](map_t * prepared) {map_free(prepared);});
+  if (field) {
+    map_set_cspace(map.get(), field->sq_distances.data(), laser_likelihood_max_dist_);
+  } else if (sensor_model_type_ != "beam") {
+    loadOrComputeDistanceField(map.get());
+  }
+  return map;
+}
 
-  handleInitialPose(last_published_pose_);
+std::shared_ptr<map_t>
+AmclNode::prepareSharedMap(const nav_msgs::msg::OccupancyGrid & map_msg)
+{
+  if (!share_maps_) {
+    return prepareMap(map_msg);
+  }
+  // everything that shapes the prepared map besides its cells
+  std::string prepared = "amcl " + std::to_string(laser_likelihood_max_dist_) + " " +
+    (shared_distance_field_ ? "shared" : distance_transform_) +
+    (compact_map_ ? " compact " : " cells ") + std::to_string(map_tile_shift_);
+  return nav2_util::SharedMapRegistry<map_t>::global().getOrPrepare(
+    {nav2_util::hashOccupancyGrid(map_msg), prepared},
+    [this, &map_msg]() {
+      // with its distance field whatever the model, as global localization may need it and
+      // nothing changes a shared map after this
+      std::shared_ptr<map_t> map = prepareMap(map_msg);
+      map_update_cspace(map.get(), laser_likelihood_max_dist_);
+      return map;
+    });
 }
 
 void
-AmclNode::createFreeSpaceVector()
+AmclNode::cachedMapReceived(const nav_msgs::msg::OccupancyGrid::SharedPtr msg)
 {
-  // Index of free space
-  free_space_indices.resize(0);
-  for (int i = 0; i < map_->size_x; i++) {
-    for (int j = 0; j < map_->size_y; j++) {
-      if (map_->cells[MAP_INDEX(map_, i, j)].occ_state == -1) {
-        free_space_indices.push_back(std::make_pair(i, j));
-      }
-    }
+  if (map_cache_->find(*msg)) {
+    return;
   }
+  RCLCPP_INFO(get_logger(), "Preparing a %d X %d preloaded map", msg->info.width,
+    msg->info.height);
+
+  map_preparations_.erase(
+    std::remove_if(map_preparations_.begin(), map_preparations_.end(),
+    [](std::future<void> & preparation) {
+      return preparation.wait_for(0s) == std::future_status::ready;
+    }), map_preparations_.end());
+
+  // The distance field takes seconds on a large map, which the scans should not wait for
+  map_preparations_.push_back(std::async(std::launch::async, [this, msg]() {
+      map_cache_->insert(*msg, prepareSharedMap(*msg));
+    }));
 }
 
 void
-AmclNode::freeMapDependentMemory()
+AmclNode::loadOrComputeDistanceField(map_t * map)
 {
-  if (map_ != NULL) {
-    map_free(map_);
-    map_ = NULL;
+  if (map_cache_directory_.empty()) {
+    map_update_cspace(map, laser_likelihood_max_dist_);
+    return;
   }
 
+  uint64_t key = map_hash(map);
+  char name[64];
+  snprintf(name, sizeof(name), "/amcl_cspace_%016llx_%.3f.bin",
+    static_cast<unsigned long long>(key), laser_likelihood_max_dist_);
+  std::string path = map_cache_directory_ + name;
+
+  if (map_load_cspace(map, path.c_str(), key, laser_likelihood_max_dist_) == 0) {
+    RCLCPP_INFO(get_logger(), "Loaded cached distance field from %s", path.c_str());
+    return;
+  }
+  map_update_cspace(map, laser_likelihood_max_dist_);
+  if (map_save_cspace(map, path.c_str(), key) != 0) {
+    RCLCPP_WARN(get_logger(), "Could not cache the distance field in %s", path.c_str());
+  }
+}
+
+void
+AmclNode::createFreeSpaceIndex()
+{
+  // Index of free space
+  map_free_space_free(free_space_);
+  free_space_ = map_free_space_alloc(map_);
+}
+
+void
+AmclNode::freeMapDependentMemory()
+{
+  map_holder_.reset();
+  map_ = NULL;
+
   if (pf_ != NULL) {
     pf_free(pf_);
     pf_ = NULL;
   }
+  coarse_field_.clear();
+  scan_matcher_.clear();
 
-  motion_model_.reset();
-  motion_model_ = std::unique_ptr<nav2_amcl::MotionModel>(nav2_amcl::MotionModel::createMotionModel(
-        robot_model_type_, alpha1_, alpha2_, alpha3_, alpha4_, alpha5_));
+  createMotionModel();
 
   // Laser
   lasers_.clear();
+  fused_laser_.reset();
+  pending_scans_.clear();
 }
 
 // Convert an OccupancyGrid map message into the internal representation. This function
@@ -1128,17 +2289,25 @@ AmclNode::convertMap(const nav_msgs::msg::OccupancyGrid & map_msg)
   map->origin_x = map_msg.info.origin.position.x + (map->size_x / 2) * map->scale;
   map->origin_y = map_msg.info.origin.position.y + (map->size_y / 2) * map->scale;
 
-  map->cells =
-    reinterpret_cast<map_cell_t *>(malloc(sizeof(map_cell_t) * map->size_x * map->size_y));
+  map_alloc_cells(map, compact_map_ ? MAP_LAYOUT_COMPACT : MAP_LAYOUT_CELLS, map_tile_shift_);
+
+  if (distance_transform_ == "edt") {
+    map->cspace_method = MAP_CSPACE_EDT;
+    map->cspace_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
 
   // Convert to player format
-  for (int i = 0; i < map->size_x * map->size_y; i++) {
-    if (map_msg.data[i] == 0) {
-      map->cells[i].occ_state = -1;
-    } else if (map_msg.data[i] == 100) {
-      map->cells[i].occ_state = +1;
-    } else {
-      map->cells[i].occ_state = 0;
+  for (int j = 0; j < map->size_y; j++) {
+    for (int i = 0; i < map->size_x; i++) {
+      int value = map_msg.data[i + j * map->size_x];
+      int index = MAP_INDEX(map, i, j);
+      if (value == 0) {
+        map_set_occ_state(map, index, -1);
+      } else if (value == 100) {
+        map_set_occ_state(map, index, +1);
+      } else {
+        map_set_occ_state(map, index, 0);
+      }
     }
   }
 
@@ -1167,14 +2336,32 @@ AmclNode::initTransforms()
 void
 AmclNode::initMessageFilters()
 {
+  // With latest_scan_only, the subscription keeps just the newest scan that has
+  // not been taken, and the scheduler just the newest waiting for its transform:
+  // each evicts the one before, rather than queueing them to be processed in turn
+  rmw_qos_profile_t scan_qos = rmw_qos_profile_sensor_data;
+  size_t channel_queue_size = 10;
+  if (latest_scan_only_) {
+    scan_qos.depth = 1;
+    channel_queue_size = 1;
+  }
   laser_scan_sub_ = std::make_unique<message_filters::Subscriber<sensor_msgs::msg::LaserScan>>(
-    rclcpp_node_.get(), scan_topic_, rmw_qos_profile_sensor_data);
-
-  laser_scan_filter_ = std::make_unique<tf2_ros::MessageFilter<sensor_msgs::msg::LaserScan>>(
-    *laser_scan_sub_, *tf_buffer_, odom_frame_id_, 10, rclcpp_node_);
-
-  laser_scan_connection_ = laser_scan_filter_->registerCallback(std::bind(&AmclNode::laserReceived,
-      this, std::placeholders::_1));
+    rclcpp_node_.get(), scan_topic_, scan_qos);
+
+  transform_scheduler_ = nav2_util::TransformScheduler::forBuffer(*tf_buffer_);
+  laser_scan_channel_ = transform_scheduler_->addChannel({odom_frame_id_}, channel_queue_size,
+      tf2::Duration(0), [this]() {
+      dropped_scans_++;
+      dropped_scans_counter_->increment();
+    });
+
+  auto scheduler = transform_scheduler_;
+  auto channel = laser_scan_channel_;
+  laser_scan_connection_ = laser_scan_sub_->registerCallback(
+    [this, scheduler, channel](const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan) {
+      scheduler->schedule(channel, laser_scan,
+      std::bind(&AmclNode::laserReceived, this, std::placeholders::_1));
+    });
 }
 
 void
@@ -1185,9 +2372,15 @@ AmclNode::initPubSub()
   particlecloud_pub_ = create_publisher<geometry_msgs::msg::PoseArray>("particlecloud",
       rclcpp::SensorDataQoS());
 
+  compact_particlecloud_pub_ = create_publisher<nav2_msgs::msg::ParticleCloud>(
+    "particlecloud_compact", rclcpp::SensorDataQoS());
+
   pose_pub_ = create_publisher<geometry_msgs::msg::PoseWithCovarianceStamped>("amcl_pose",
       rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable());
 
+  diagnostics_pub_ = create_publisher<diagnostic_msgs::msg::DiagnosticArray>("amcl_diagnostics",
+      rclcpp::SystemDefaultsQoS());
+
   initial_pose_sub_ = create_subscription<geometry_msgs::msg::PoseWithCovarianceStamped>(
     "initialpose", rclcpp::SystemDefaultsQoS(),
     std::bind(&AmclNode::initialPoseReceived, this, std::placeholders::_1));
@@ -1196,6 +2389,13 @@ AmclNode::initPubSub()
     "map", rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable(),
     std::bind(&AmclNode::mapReceived, this, std::placeholders::_1));
 
+  if (map_cache_size_ > 0) {
+    map_cache_ = std::make_unique<nav2_util::MapCache<map_t>>(map_cache_size_);
+    map_cache_sub_ = create_subscription<nav_msgs::msg::OccupancyGrid>(
+      "map_cache", rclcpp::QoS(rclcpp::KeepLast(map_cache_size_)).transient_local().reliable(),
+      std::bind(&AmclNode::cachedMapReceived, this, std::placeholders::_1));
+  }
+
   RCLCPP_INFO(get_logger(), "Subscribed to map topic.");
 }
 
@@ -1224,12 +2424,22 @@ AmclNode::initOdometry()
   init_cov_[1] = 0.5 * 0.5;
   init_cov_[2] = (M_PI / 12.0) * (M_PI / 12.0);
 
-  motion_model_ = std::unique_ptr<nav2_amcl::MotionModel>(nav2_amcl::MotionModel::createMotionModel(
-        robot_model_type_, alpha1_, alpha2_, alpha3_, alpha4_, alpha5_));
+  createMotionModel();
 
   latest_odom_pose_ = geometry_msgs::msg::PoseStamped();
 }
 
+void
+AmclNode::createMotionModel()
+{
+  motion_model_.reset();
+  motion_model_ = std::unique_ptr<nav2_amcl::MotionModel>(nav2_amcl::MotionModel::createMotionModel(
+        robot_model_type_, alpha1_, alpha2_, alpha3_, alpha4_, alpha5_));
+  if (motion_model_ && random_seed_ >= 0) {
+    motion_model_->setSeed(random_seed_);
+  }
+}
+
 void
 AmclNode::initParticleFilter()
 {
@@ -1239,6 +2449,22 @@ AmclNode::initParticleFilter()
       reinterpret_cast<void *>(map_));
   pf_->pop_err = pf_err_;
   pf_->pop_z = pf_z_;
+  pf_set_sensor_threads(pf_, sensor_update_threads_);
+  if (random_seed_ >= 0) {
+    srand48(random_seed_);
+  }
+  if (particle_histogram_ == "hashgrid") {
+    pf_set_histogram_type(pf_, PF_HISTOGRAM_HASHGRID);
+  } else if (particle_histogram_ != "kdtree") {
+    RCLCPP_WARN(get_logger(), "Unknown particle_histogram \"%s\"; using kdtree",
+      particle_histogram_.c_str());
+  }
+  if (resample_method_ == "low_variance") {
+    pf_set_resample_method(pf_, PF_RESAMPLE_LOW_VARIANCE);
+  } else if (resample_method_ != "multinomial") {
+    RCLCPP_WARN(get_logger(), "Unknown resample_method \"%s\"; using multinomial",
+      resample_method_.c_str());
+  }
 
   // Initialize the filter
   pf_vector_t pf_init_pose_mean = pf_vector_zero();
@@ -1266,3 +2492,7 @@ AmclNode::initLaserScan()
 }
 
 }  // namespace nav2_amcl
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_amcl::AmclNode)
@@ -32,6 +32,7 @@
 #include <stdio.h>
 
 #include "nav2_amcl/map/map.hpp"
+#include "nav2_util/grid_memory.hpp"
 
 
 // Create a new map
@@ -52,6 +53,21 @@ map_t * map_alloc(void)
 
   // Allocate storage for main map
   map->cells = (map_cell_t *) NULL;
+  map->occ_state_plane = (int8_t *) NULL;
+  map->occ_dist_plane = (uint16_t *) NULL;
+  map->occ_dist_res = 0;
+  map->tile_shift = 0;
+  map->tiles_x = 0;
+  map->max_occ_dist = 0;
+
+  map->hit_prob = (float *) NULL;
+  map->hit_prob_sigma = 0;
+
+  map->cspace_method = MAP_CSPACE_BRUSHFIRE;
+  map->cspace_threads = 1;
+  map->cspace_valid = 0;
+
+  map->range_skip = (uint8_t *) NULL;
 
   return map;
 }
@@ -60,11 +76,61 @@ map_t * map_alloc(void)
 // Destroy a map
 void map_free(map_t * map)
 {
-  free(map->cells);
+  nav2_util_free_grid(map->cells);
+  nav2_util_free_grid(map->occ_state_plane);
+  nav2_util_free_grid(map->occ_dist_plane);
+  nav2_util_free_grid(map->hit_prob);
+  nav2_util_free_grid(map->range_skip);
   free(map);
 }
 
 
+// Allocate storage for the cells
+void map_alloc_cells(map_t * map, int layout, int tile_shift)
+{
+  int count;
+
+  map->tile_shift = tile_shift;
+  map->tiles_x = (map->size_x + (1 << tile_shift) - 1) >> tile_shift;
+
+  nav2_util_free_grid(map->cells);
+  nav2_util_free_grid(map->occ_state_plane);
+  nav2_util_free_grid(map->occ_dist_plane);
+  nav2_util_free_grid(map->hit_prob);
+  nav2_util_free_grid(map->range_skip);
+  map->cells = (map_cell_t *) NULL;
+  map->occ_state_plane = (int8_t *) NULL;
+  map->occ_dist_plane = (uint16_t *) NULL;
+  map->hit_prob = (float *) NULL;
+  map->range_skip = (uint8_t *) NULL;
+  map->hit_prob_sigma = 0;
+  map->cspace_valid = 0;
+
+  count = map_cell_count(map);
+  if (layout == MAP_LAYOUT_COMPACT) {
+    map->occ_state_plane = (int8_t *) nav2_util_allocate_grid(count * sizeof(int8_t));
+    // One element of padding, so the last cell can be fetched with a 32-bit load
+    map->occ_dist_plane = (uint16_t *) nav2_util_allocate_grid((count + 1) * sizeof(uint16_t));
+    map->occ_dist_res = 1.0;
+  } else {
+    map->cells = (map_cell_t *) nav2_util_allocate_grid(count * sizeof(map_cell_t));
+  }
+}
+
+
+// Number of cells in the storage
+int map_cell_count(const map_t * map)
+{
+  int tiles_y;
+
+  if (map->tile_shift == 0) {
+    return map->size_x * map->size_y;
+  }
+  tiles_y = (map->size_y + (1 << map->tile_shift) - 1) >> map->tile_shift;
+  return (map->tiles_x * tiles_y) << (2 * map->tile_shift);
+}
+
+
 // Get the cell at the given point
 map_cell_t * map_get_cell(map_t * map, double ox, double oy, double oa)
 {
@@ -75,7 +141,7 @@ map_cell_t * map_get_cell(map_t * map, double ox, double oy, double oa)
   i = MAP_GXWX(map, ox);
   j = MAP_GYWY(map, oy);
 
-  if (!MAP_VALID(map, i, j)) {
+  if (!MAP_VALID(map, i, j) || map->cells == NULL) {
     return NULL;
   }
 
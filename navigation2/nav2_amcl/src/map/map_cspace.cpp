@@ -22,8 +22,12 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 #include <queue>
+#include <thread>
+#include <vector>
 #include "nav2_amcl/map/map.hpp"
+#include "nav2_util/grid_memory.hpp"
 
 class CellData
 {
@@ -66,8 +70,8 @@ public:
 
 bool operator<(const CellData & a, const CellData & b)
 {
-  return a.map_->cells[MAP_INDEX(a.map_, a.i_,
-           a.j_)].occ_dist > a.map_->cells[MAP_INDEX(b.map_, b.i_, b.j_)].occ_dist;
+  return map_occ_dist(a.map_, MAP_INDEX(a.map_, a.i_, a.j_)) >
+         map_occ_dist(b.map_, MAP_INDEX(b.map_, b.i_, b.j_));
 }
 
 CachedDistanceMap *
@@ -104,7 +108,7 @@ void enqueue(
     return;
   }
 
-  map->cells[MAP_INDEX(map, i, j)].occ_dist = distance * map->scale;
+  map_set_occ_dist(map, MAP_INDEX(map, i, j), distance * map->scale);
 
   CellData cell;
   cell.map_ = map;
@@ -118,16 +122,14 @@ void enqueue(
   marked[MAP_INDEX(map, i, j)] = 1;
 }
 
-// Update the cspace distance values
-void map_update_cspace(map_t * map, double max_occ_dist)
+// Brushfire the distances out from the obstacle cells, in order of distance
+static void map_update_cspace_brushfire(map_t * map, double max_occ_dist)
 {
   unsigned char * marked;
   std::priority_queue<CellData> Q;
 
-  marked = new unsigned char[map->size_x * map->size_y];
-  memset(marked, 0, sizeof(unsigned char) * map->size_x * map->size_y);
-
-  map->max_occ_dist = max_occ_dist;
+  marked = new unsigned char[map_cell_count(map)];
+  memset(marked, 0, sizeof(unsigned char) * map_cell_count(map));
 
   CachedDistanceMap * cdm = get_distance_map(map->scale, map->max_occ_dist);
 
@@ -137,13 +139,13 @@ void map_update_cspace(map_t * map, double max_occ_dist)
   for (int i = 0; i < map->size_x; i++) {
     cell.src_i_ = cell.i_ = i;
     for (int j = 0; j < map->size_y; j++) {
-      if (map->cells[MAP_INDEX(map, i, j)].occ_state == +1) {
-        map->cells[MAP_INDEX(map, i, j)].occ_dist = 0.0;
+      if (map_occ_state(map, MAP_INDEX(map, i, j)) == +1) {
+        map_set_occ_dist(map, MAP_INDEX(map, i, j), 0.0);
         cell.src_j_ = cell.j_ = j;
         marked[MAP_INDEX(map, i, j)] = 1;
         Q.push(cell);
       } else {
-        map->cells[MAP_INDEX(map, i, j)].occ_dist = max_occ_dist;
+        map_set_occ_dist(map, MAP_INDEX(map, i, j), max_occ_dist);
       }
     }
   }
@@ -176,3 +178,178 @@ void map_update_cspace(map_t * map, double max_occ_dist)
 
   delete[] marked;
 }
+
+// One dimensional squared distance transform of the finite sampled function f,
+// from Felzenszwalb & Huttenlocher, "Distance Transforms of Sampled Functions".
+// v and z are workspace of n and n + 1 elements.
+static void distance_transform_1d(const double * f, int n, double * d, int * v, double * z)
+{
+  int k = 0;
+  v[0] = 0;
+  z[0] = -HUGE_VAL;
+  z[1] = HUGE_VAL;
+
+  // Lower envelope of the parabolas rooted at each sample; f is finite, so
+  // z[0] = -inf stops the search at the first parabola
+  for (int q = 1; q < n; q++) {
+    double s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+    while (s <= z[k]) {
+      k--;
+      s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+    }
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = HUGE_VAL;
+  }
+
+  k = 0;
+  for (int q = 0; q < n; q++) {
+    while (z[k + 1] < q) {
+      k++;
+    }
+    d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+  }
+}
+
+// Run fn(begin, end) over [0, n) split into contiguous ranges, one per thread
+template<typename Fn>
+static void parallel_for(int threads, int n, Fn fn)
+{
+  threads = std::max(1, std::min(threads, n));
+  if (threads == 1) {
+    fn(0, n);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  int chunk = (n + threads - 1) / threads;
+  for (int begin = chunk; begin < n; begin += chunk) {
+    workers.emplace_back(fn, begin, std::min(n, begin + chunk));
+  }
+  fn(0, std::min(n, chunk));
+  for (auto & worker : workers) {
+    worker.join();
+  }
+}
+
+// Exact Euclidean distance transform: a column pass then a row pass of the
+// separable 1D transform, each parallelized over columns/rows.  Distances are
+// clipped exactly as the brushfire clips them.
+static void map_update_cspace_edt(map_t * map, double max_occ_dist)
+{
+  const int size_x = map->size_x;
+  const int size_y = map->size_y;
+  const int cell_radius = max_occ_dist / map->scale;
+
+  // Squared distances beyond the radius all end up as max_occ_dist, so cap
+  // them; this also keeps the squared cell distances exact in a double
+  const double cap = (cell_radius + 1.0) * (cell_radius + 1.0);
+
+  // Squared distance in cells to the nearest obstacle, row-major
+  std::vector<double> grid(static_cast<size_t>(size_x) * size_y);
+
+  // Columns: obstacles are sources, everything else starts at the cap
+  parallel_for(map->cspace_threads, size_x, [&](int begin, int end) {
+      std::vector<double> f(size_y), d(size_y), z(size_y + 1);
+      std::vector<int> v(size_y);
+      for (int i = begin; i < end; i++) {
+        for (int j = 0; j < size_y; j++) {
+          f[j] = map_occ_state(map, MAP_INDEX(map, i, j)) == +1 ? 0.0 : cap;
+        }
+        distance_transform_1d(f.data(), size_y, d.data(), v.data(), z.data());
+        for (int j = 0; j < size_y; j++) {
+          grid[i + static_cast<size_t>(j) * size_x] = std::min(d[j], cap);
+        }
+      }
+    });
+
+  // Rows: combine the column distances and write the result back to the map
+  parallel_for(map->cspace_threads, size_y, [&](int begin, int end) {
+      std::vector<double> d(size_x), z(size_x + 1);
+      std::vector<int> v(size_x);
+      for (int j = begin; j < end; j++) {
+        const double * f = &grid[static_cast<size_t>(j) * size_x];
+        distance_transform_1d(f, size_x, d.data(), v.data(), z.data());
+        for (int i = 0; i < size_x; i++) {
+          double distance = sqrt(d[i]);
+          map_set_occ_dist(map, MAP_INDEX(map, i, j),
+            distance > cell_radius ? max_occ_dist : distance * map->scale);
+        }
+      }
+    });
+}
+
+// Update the cspace distance values
+void map_update_cspace(map_t * map, double max_occ_dist)
+{
+  if (map->cspace_valid && map->max_occ_dist == max_occ_dist) {
+    return;
+  }
+  map->max_occ_dist = max_occ_dist;
+
+  // Use the full fixed point range for distances up to max_occ_dist
+  if (map->occ_dist_plane) {
+    map->occ_dist_res = max_occ_dist / UINT16_MAX;
+  }
+
+  // The distances are about to change under any hit probability table
+  map->hit_prob_sigma = 0;
+
+  if (map->cspace_method == MAP_CSPACE_EDT) {
+    map_update_cspace_edt(map, max_occ_dist);
+  } else {
+    map_update_cspace_brushfire(map, max_occ_dist);
+  }
+  map->cspace_valid = 1;
+}
+
+// Set the cspace distance values from a distance field computed elsewhere
+void map_set_cspace(map_t * map, const uint32_t * sq_distances, double max_occ_dist)
+{
+  map->max_occ_dist = max_occ_dist;
+  if (map->occ_dist_plane) {
+    map->occ_dist_res = max_occ_dist / UINT16_MAX;
+  }
+  map->hit_prob_sigma = 0;
+
+  const int cell_radius = max_occ_dist / map->scale;
+  for (int j = 0; j < map->size_y; j++) {
+    const uint32_t * row = sq_distances + static_cast<size_t>(j) * map->size_x;
+    for (int i = 0; i < map->size_x; i++) {
+      double distance = sqrt(static_cast<double>(row[i]));
+      map_set_occ_dist(map, MAP_INDEX(map, i, j),
+        distance > cell_radius ? max_occ_dist : distance * map->scale);
+    }
+  }
+  map->cspace_valid = 1;
+}
+
+// Update the per-cell hit probability table
+void map_update_hit_prob(map_t * map, double sigma_hit)
+{
+  if (map->hit_prob != NULL && map->hit_prob_sigma == sigma_hit) {
+    return;
+  }
+
+  int cell_count = map_cell_count(map);
+  if (map->hit_prob == NULL) {
+    map->hit_prob = nav2_util::allocate_grid_of<float>(cell_count);
+  }
+
+  // occ_dist only takes the few values on the cached distance grid, so
+  // evaluate the exponential once per distinct distance
+  double z_hit_denom = 2 * sigma_hit * sigma_hit;
+  double last_dist = -1.0;
+  float last_prob = 0.0f;
+  for (int i = 0; i < cell_count; i++) {
+    double z = map_occ_dist(map, i);
+    if (z != last_dist) {
+      last_dist = z;
+      last_prob = static_cast<float>(exp(-(z * z) / z_hit_denom));
+    }
+    map->hit_prob[i] = last_prob;
+  }
+
+  map->hit_prob_sigma = sigma_hit;
+}
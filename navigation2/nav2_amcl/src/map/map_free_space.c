@@ -0,0 +1,119 @@
+/*
+ *  Player - One Hell of a Robot Server
+ *  Copyright (C) 2000  Brian Gerkey   &  Kasper Stoy
+ *                      gerkey@usc.edu    kaspers@robotics.usc.edu
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/**************************************************************************
+ * Desc: Run-length index of the free cells of a map
+ **************************************************************************/
+
+#include <stdlib.h>
+
+#include "nav2_amcl/map/map.hpp"
+
+
+// Count the runs of free cells, row by row, and record them in free_space
+// if it is given
+static int map_free_space_runs(const map_t * map, map_free_space_t * free_space)
+{
+  int i, j, start, runs = 0, cells = 0;
+
+  for (j = 0; j < map->size_y; j++) {
+    i = 0;
+    while (i < map->size_x) {
+      if (map_occ_state(map, MAP_INDEX(map, i, j)) != -1) {
+        i++;
+        continue;
+      }
+      start = i;
+      while (i < map->size_x && map_occ_state(map, MAP_INDEX(map, i, j)) == -1) {
+        i++;
+      }
+      if (free_space) {
+        free_space->run_offset[runs] = cells;
+        free_space->run_i[runs] = start;
+        free_space->run_j[runs] = j;
+      }
+      runs++;
+      cells += i - start;
+    }
+  }
+  if (free_space) {
+    free_space->run_offset[runs] = cells;
+    free_space->cell_count = cells;
+  }
+  return runs;
+}
+
+
+// Index the free cells
+map_free_space_t * map_free_space_alloc(const map_t * map)
+{
+  int g, run;
+  map_free_space_t * free_space;
+
+  free_space = calloc(1, sizeof(map_free_space_t));
+
+  // One pass to size the arrays, one to fill them
+  free_space->run_count = map_free_space_runs(map, NULL);
+  free_space->run_offset = malloc(sizeof(int) * (free_space->run_count + 1));
+  free_space->run_i = malloc(sizeof(int) * (free_space->run_count + 1));
+  free_space->run_j = malloc(sizeof(int) * (free_space->run_count + 1));
+  free_space->guide = malloc(sizeof(int) * (free_space->run_count + 1));
+  map_free_space_runs(map, free_space);
+
+  // With one guide entry per run, the search from it visits about one run
+  run = 0;
+  for (g = 0; g < free_space->run_count; g++) {
+    int rank = (int) ((int64_t) g * free_space->cell_count / free_space->run_count);
+    while (free_space->run_offset[run + 1] <= rank) {
+      run++;
+    }
+    free_space->guide[g] = run;
+  }
+
+  return free_space;
+}
+
+
+// Destroy a free space index
+void map_free_space_free(map_free_space_t * free_space)
+{
+  if (free_space == NULL) {
+    return;
+  }
+  free(free_space->run_offset);
+  free(free_space->run_i);
+  free(free_space->run_j);
+  free(free_space->guide);
+  free(free_space);
+}
+
+
+// Map coords of the free cell of the given rank
+void map_free_space_cell(const map_free_space_t * free_space, int rank, int * i, int * j)
+{
+  int run;
+
+  run = free_space->guide[(int64_t) rank * free_space->run_count / free_space->cell_count];
+  while (free_space->run_offset[run + 1] <= rank) {
+    run++;
+  }
+  *i = free_space->run_i[run] + rank - free_space->run_offset[run];
+  *j = free_space->run_j[run];
+}
@@ -28,9 +28,110 @@
 #include <assert.h>
 #include <math.h>
 #include <string.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "nav2_amcl/map/map.hpp"
+#include "nav2_util/grid_memory.hpp"
+
+static int map_range_min(int a, int b)
+{
+  return a < b ? a : b;
+}
+
+
+// Whether a ray stops at cell (i, j)
+static int map_range_blocked(map_t * map, int i, int j)
+{
+  return !MAP_VALID(map, i, j) || map_occ_state(map, MAP_INDEX(map, i, j)) > -1;
+}
+
+
+// Build the Chebyshev distance from every cell to the nearest cell that stops
+// rays, with the usual two pass chamfer over 8-neighbourhoods.  Cells beyond
+// the map edge stop rays, so the edge cells start with a distance of one.
+void map_update_range_skip(map_t * map)
+{
+  int i, j, di, ni, nj, d;
+  uint8_t * skip;
+
+  nav2_util_free_grid(map->range_skip);
+  skip = (uint8_t *) nav2_util_allocate_grid(sizeof(uint8_t) * map_cell_count(map));
+  map->range_skip = skip;
+
+  // Forward pass, from the left and below
+  for (j = 0; j < map->size_y; j++) {
+    for (i = 0; i < map->size_x; i++) {
+      if (map_range_blocked(map, i, j)) {
+        skip[MAP_INDEX(map, i, j)] = 0;
+        continue;
+      }
+      d = 255;
+      for (di = -1; di <= 1; di++) {
+        ni = i + di;
+        nj = j - 1;
+        d = map_range_min(d, MAP_VALID(map, ni, nj) ? skip[MAP_INDEX(map, ni, nj)] + 1 : 1);
+      }
+      d = map_range_min(d, MAP_VALID(map, i - 1, j) ? skip[MAP_INDEX(map, i - 1, j)] + 1 : 1);
+      skip[MAP_INDEX(map, i, j)] = d;
+    }
+  }
+
+  // Backward pass, from the right and above
+  for (j = map->size_y - 1; j >= 0; j--) {
+    for (i = map->size_x - 1; i >= 0; i--) {
+      d = skip[MAP_INDEX(map, i, j)];
+      if (d == 0) {
+        continue;
+      }
+      for (di = -1; di <= 1; di++) {
+        ni = i + di;
+        nj = j + 1;
+        d = map_range_min(d, MAP_VALID(map, ni, nj) ? skip[MAP_INDEX(map, ni, nj)] + 1 : 1);
+      }
+      d = map_range_min(d, MAP_VALID(map, i + 1, j) ? skip[MAP_INDEX(map, i + 1, j)] + 1 : 1);
+      skip[MAP_INDEX(map, i, j)] = d;
+    }
+  }
+}
+
+
+// Ray casting over the range_skip table.  Step k of the Bresenham line below
+// is at (x0 + k * xstep, y0 + ystep * floor((2 k dy + dx) / (2 dx))), so the
+// walk can move straight to any step.  Every cell up to d - 1 steps ahead is
+// within Chebyshev distance d - 1 of the current one, where d is its
+// range_skip value, so those cells are free and can be skipped.
+static double map_calc_range_skip(
+  map_t * map, int x0, int y0, int deltax, int deltay,
+  int xstep, int ystep, char steep, double max_range)
+{
+  int k, last, x, y, d;
+  int64_t twice_dx;
+
+  twice_dx = 2 * (int64_t) deltax;
+  last = deltax + 1;
+
+  for (k = 0; k <= last; ) {
+    x = x0 + k * xstep;
+    y = y0;
+    if (deltax > 0) {
+      y += ystep * (int) ((2 * (int64_t) k * deltay + deltax) / twice_dx);
+    }
+
+    if (steep) {
+      d = MAP_VALID(map, y, x) ? map->range_skip[MAP_INDEX(map, y, x)] : 0;
+    } else {
+      d = MAP_VALID(map, x, y) ? map->range_skip[MAP_INDEX(map, x, y)] : 0;
+    }
+    if (d == 0) {
+      return sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0)) * map->scale;
+    }
+
+    k += d > 1 ? d - 1 : 1;
+  }
+  return max_range;
+}
+
 
 // Extract a single range reading from the map.  Unknown cells and/or
 // out-of-bound cells are treated as occupied, which makes it easy to
@@ -86,12 +187,16 @@ double map_calc_range(map_t * map, double ox, double oy, double oa, double max_r
     ystep = -1;
   }
 
+  if (map->range_skip != NULL) {
+    return map_calc_range_skip(map, x0, y0, deltax, deltay, xstep, ystep, steep, max_range);
+  }
+
   if (steep) {
-    if (!MAP_VALID(map, y, x) || map->cells[MAP_INDEX(map, y, x)].occ_state > -1) {
+    if (!MAP_VALID(map, y, x) || map_occ_state(map, MAP_INDEX(map, y, x)) > -1) {
       return sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0)) * map->scale;
     }
   } else {
-    if (!MAP_VALID(map, x, y) || map->cells[MAP_INDEX(map, x, y)].occ_state > -1) {
+    if (!MAP_VALID(map, x, y) || map_occ_state(map, MAP_INDEX(map, x, y)) > -1) {
       return sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0)) * map->scale;
     }
   }
@@ -105,11 +210,11 @@ double map_calc_range(map_t * map, double ox, double oy, double oa, double max_r
     }
 
     if (steep) {
-      if (!MAP_VALID(map, y, x) || map->cells[MAP_INDEX(map, y, x)].occ_state > -1) {
+      if (!MAP_VALID(map, y, x) || map_occ_state(map, MAP_INDEX(map, y, x)) > -1) {
         return sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0)) * map->scale;
       }
     } else {
-      if (!MAP_VALID(map, x, y) || map->cells[MAP_INDEX(map, x, y)].occ_state > -1) {
+      if (!MAP_VALID(map, x, y) || map_occ_state(map, MAP_INDEX(map, x, y)) > -1) {
         return sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0)) * map->scale;
       }
     }
@@ -32,6 +32,7 @@
 #include <string.h>
 
 #include "nav2_amcl/map/map.hpp"
+#include "nav2_util/grid_memory.hpp"
 
 
 ////////////////////////////////////////////////////////////////////////////
@@ -77,7 +78,7 @@ int map_load_occ(map_t * map, const char * filename, double scale, int negate)
     map->scale = scale;
     map->size_x = width;
     map->size_y = height;
-    map->cells = calloc(width * height, sizeof(map->cells[0]));
+    map->cells = nav2_util_allocate_grid(width * height * sizeof(map->cells[0]));
   } else {
     if (width != map->size_x || height != map->size_y) {
       // PLAYER_ERROR("map dimensions are inconsistent with prior map dimensions");
@@ -124,6 +125,140 @@ int map_load_occ(map_t * map, const char * filename, double scale, int negate)
 }
 
 
+////////////////////////////////////////////////////////////////////////////
+// Cached distance fields.  The file is a header followed by one float
+// distance per cell in row-major order, so it does not depend on the layout
+// or tiling of the map that saved it.
+#define MAP_CSPACE_MAGIC "AMCLDF01"
+
+typedef struct
+{
+  char magic[8];
+  uint64_t key;
+  int32_t size_x, size_y;
+  double scale;
+  double max_occ_dist;
+} map_cspace_header_t;
+
+
+// FNV-1a over the map geometry and occupancy
+uint64_t map_hash(const map_t * map)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  int i, j;
+  int64_t fields[4];
+
+  fields[0] = map->size_x;
+  fields[1] = map->size_y;
+  fields[2] = map->cspace_method;
+  memcpy(&fields[3], &map->scale, sizeof(double));
+  for (i = 0; i < (int) sizeof(fields); i++) {
+    hash = (hash ^ ((const uint8_t *) fields)[i]) * 1099511628211ULL;
+  }
+  for (j = 0; j < map->size_y; j++) {
+    for (i = 0; i < map->size_x; i++) {
+      hash = (hash ^ (uint8_t) map_occ_state(map, MAP_INDEX(map, i, j))) * 1099511628211ULL;
+    }
+  }
+  return hash;
+}
+
+
+// Save the cspace distances; written to a temporary file first so that a
+// reader never sees a partial cache
+int map_save_cspace(const map_t * map, const char * filename, uint64_t key)
+{
+  FILE * file;
+  char * tmp_name;
+  float * row;
+  map_cspace_header_t header;
+  int i, j, ok;
+
+  tmp_name = malloc(strlen(filename) + 5);
+  sprintf(tmp_name, "%s.tmp", filename);
+  file = fopen(tmp_name, "wb");
+  if (file == NULL) {
+    free(tmp_name);
+    return -1;
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MAP_CSPACE_MAGIC, sizeof(header.magic));
+  header.key = key;
+  header.size_x = map->size_x;
+  header.size_y = map->size_y;
+  header.scale = map->scale;
+  header.max_occ_dist = map->max_occ_dist;
+  ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+  row = malloc(sizeof(float) * map->size_x);
+  for (j = 0; ok && j < map->size_y; j++) {
+    for (i = 0; i < map->size_x; i++) {
+      row[i] = (float) map_occ_dist(map, MAP_INDEX(map, i, j));
+    }
+    ok = fwrite(row, sizeof(float), map->size_x, file) == (size_t) map->size_x;
+  }
+  free(row);
+
+  ok = (fclose(file) == 0) && ok;
+  ok = ok && rename(tmp_name, filename) == 0;
+  if (!ok) {
+    remove(tmp_name);
+  }
+  free(tmp_name);
+  return ok ? 0 : -1;
+}
+
+
+// Load the cspace distances
+int map_load_cspace(map_t * map, const char * filename, uint64_t key, double max_occ_dist)
+{
+  FILE * file;
+  float * dist;
+  map_cspace_header_t header;
+  int i, j, ok;
+
+  file = fopen(filename, "rb");
+  if (file == NULL) {
+    return -1;
+  }
+
+  ok = fread(&header, sizeof(header), 1, file) == 1 &&
+    memcmp(header.magic, MAP_CSPACE_MAGIC, sizeof(header.magic)) == 0 &&
+    header.key == key && header.size_x == map->size_x && header.size_y == map->size_y &&
+    header.scale == map->scale && header.max_occ_dist == max_occ_dist;
+  if (!ok) {
+    fclose(file);
+    return -1;
+  }
+
+  // Read everything before touching the map, so a truncated file leaves it as
+  // it was
+  dist = malloc(sizeof(float) * map->size_x * map->size_y);
+  ok = fread(dist, sizeof(float), map->size_x * map->size_y, file) ==
+    (size_t) (map->size_x * map->size_y);
+  fclose(file);
+  if (!ok) {
+    free(dist);
+    return -1;
+  }
+
+  map->max_occ_dist = max_occ_dist;
+  if (map->occ_dist_plane) {
+    map->occ_dist_res = max_occ_dist / UINT16_MAX;
+  }
+  map->hit_prob_sigma = 0;
+  for (j = 0; j < map->size_y; j++) {
+    for (i = 0; i < map->size_x; i++) {
+      map_set_occ_dist(map, MAP_INDEX(map, i, j), dist[i + j * map->size_x]);
+    }
+  }
+  free(dist);
+  map->cspace_valid = 1;
+  return 0;
+}
+
+
 ////////////////////////////////////////////////////////////////////////////
 // Load a wifi signal strength map
 /*
@@ -165,7 +300,7 @@ int map_load_wifi(map_t *map, const char *filename, int index)
   {
     map->size_x = width;
     map->size_y = height;
-    map->cells = calloc(width * height, sizeof(map->cells[0]));
+    map->cells = nav2_util_allocate_grid(width * height * sizeof(map->cells[0]));
   }
   else
   {
@@ -78,27 +78,38 @@ DifferentialMotionModel::odometryUpdate(
   delta_rot2_noise = std::min(fabs(angleutils::angle_diff(delta_rot2, 0.0)),
       fabs(angleutils::angle_diff(delta_rot2, M_PI)));
 
-  for (int i = 0; i < set->sample_count; i++) {
-    pf_sample_t * sample = set->samples + i;
-
-    // Sample pose differences
-    delta_rot1_hat = angleutils::angle_diff(delta_rot1,
-        pf_ran_gaussian(sqrt(alpha1_ * delta_rot1_noise * delta_rot1_noise +
-        alpha2_ * delta_trans * delta_trans)));
-    delta_trans_hat = delta_trans -
-      pf_ran_gaussian(sqrt(alpha3_ * delta_trans * delta_trans +
-        alpha4_ * delta_rot1_noise * delta_rot1_noise +
-        alpha4_ * delta_rot2_noise * delta_rot2_noise));
-    delta_rot2_hat = angleutils::angle_diff(delta_rot2,
-        pf_ran_gaussian(sqrt(alpha1_ * delta_rot2_noise * delta_rot2_noise +
-        alpha2_ * delta_trans * delta_trans)));
-
-    // Apply sampled update to particle pose
-    sample->pose.v[0] += delta_trans_hat *
-      cos(sample->pose.v[2] + delta_rot1_hat);
-    sample->pose.v[1] += delta_trans_hat *
-      sin(sample->pose.v[2] + delta_rot1_hat);
-    sample->pose.v[2] += delta_rot1_hat + delta_rot2_hat;
+  double rot1_stddev = sqrt(alpha1_ * delta_rot1_noise * delta_rot1_noise +
+      alpha2_ * delta_trans * delta_trans);
+  double trans_stddev = sqrt(alpha3_ * delta_trans * delta_trans +
+      alpha4_ * delta_rot1_noise * delta_rot1_noise +
+      alpha4_ * delta_rot2_noise * delta_rot2_noise);
+  double rot2_stddev = sqrt(alpha1_ * delta_rot2_noise * delta_rot2_noise +
+      alpha2_ * delta_trans * delta_trans);
+
+  // Draw the standard normal noise for a block of samples at a time, then
+  // apply the update across the block
+  double rot1_noise[BLOCK_SIZE], trans_noise[BLOCK_SIZE], rot2_noise[BLOCK_SIZE];
+
+  for (int first = 0; first < set->sample_count; first += BLOCK_SIZE) {
+    int count = std::min(BLOCK_SIZE, set->sample_count - first);
+    pf_rng_gaussian(&rng_, rot1_noise, count);
+    pf_rng_gaussian(&rng_, trans_noise, count);
+    pf_rng_gaussian(&rng_, rot2_noise, count);
+
+    double * x = set->x + first;
+    double * y = set->y + first;
+    double * theta = set->theta + first;
+    for (int i = 0; i < count; i++) {
+      // Sample pose differences
+      delta_rot1_hat = angleutils::angle_diff(delta_rot1, rot1_stddev * rot1_noise[i]);
+      delta_trans_hat = delta_trans - trans_stddev * trans_noise[i];
+      delta_rot2_hat = angleutils::angle_diff(delta_rot2, rot2_stddev * rot2_noise[i]);
+
+      // Apply sampled update to particle pose
+      x[i] += delta_trans_hat * cos(theta[i] + delta_rot1_hat);
+      y[i] += delta_trans_hat * sin(theta[i] + delta_rot1_hat);
+      theta[i] += delta_rot1_hat + delta_rot2_hat;
+    }
   }
 }
 
@@ -16,11 +16,27 @@
 
 #include "nav2_amcl/motion_model/motion_model.hpp"
 
+#include <chrono>
+#include <random>
 #include <string>
 
 namespace nav2_amcl
 {
 
+MotionModel::MotionModel()
+{
+  std::random_device device;
+  uint64_t seed = (static_cast<uint64_t>(device()) << 32) ^
+    std::chrono::steady_clock::now().time_since_epoch().count();
+  pf_rng_seed(&rng_, seed);
+}
+
+void
+MotionModel::setSeed(uint64_t seed)
+{
+  pf_rng_seed(&rng_, seed);
+}
+
 MotionModel *
 MotionModel::createMotionModel(
   std::string & type, double alpha1, double alpha2,
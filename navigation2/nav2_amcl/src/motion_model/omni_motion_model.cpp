@@ -64,24 +64,40 @@ OmniMotionModel::odometryUpdate(pf_t * pf, const pf_vector_t & pose, const pf_ve
   double strafe_hat_stddev = sqrt(alpha4_ * (delta_rot * delta_rot) +
       alpha5_ * (delta_trans * delta_trans) );
 
-  for (int i = 0; i < set->sample_count; i++) {
-    pf_sample_t * sample = set->samples + i;
+  // The bearing of the motion relative to the old heading is the same for
+  // every sample
+  double delta_bearing_rel = angleutils::angle_diff(atan2(delta.v[1], delta.v[0]),
+      old_pose.v[2]);
 
-    delta_bearing = angleutils::angle_diff(atan2(delta.v[1], delta.v[0]),
-        old_pose.v[2]) + sample->pose.v[2];
-    double cs_bearing = cos(delta_bearing);
-    double sn_bearing = sin(delta_bearing);
+  // Draw the standard normal noise for a block of samples at a time, then
+  // apply the update across the block
+  double trans_noise[BLOCK_SIZE], rot_noise[BLOCK_SIZE], strafe_noise[BLOCK_SIZE];
 
-    // Sample pose differences
-    delta_trans_hat = delta_trans + pf_ran_gaussian(trans_hat_stddev);
-    delta_rot_hat = delta_rot + pf_ran_gaussian(rot_hat_stddev);
-    delta_strafe_hat = 0 + pf_ran_gaussian(strafe_hat_stddev);
-    // Apply sampled update to particle pose
-    sample->pose.v[0] += (delta_trans_hat * cs_bearing +
-      delta_strafe_hat * sn_bearing);
-    sample->pose.v[1] += (delta_trans_hat * sn_bearing -
-      delta_strafe_hat * cs_bearing);
-    sample->pose.v[2] += delta_rot_hat;
+  for (int first = 0; first < set->sample_count; first += BLOCK_SIZE) {
+    int count = std::min(BLOCK_SIZE, set->sample_count - first);
+    pf_rng_gaussian(&rng_, trans_noise, count);
+    pf_rng_gaussian(&rng_, rot_noise, count);
+    pf_rng_gaussian(&rng_, strafe_noise, count);
+
+    double * x = set->x + first;
+    double * y = set->y + first;
+    double * theta = set->theta + first;
+    for (int i = 0; i < count; i++) {
+      delta_bearing = delta_bearing_rel + theta[i];
+      double cs_bearing = cos(delta_bearing);
+      double sn_bearing = sin(delta_bearing);
+
+      // Sample pose differences
+      delta_trans_hat = delta_trans + trans_hat_stddev * trans_noise[i];
+      delta_rot_hat = delta_rot + rot_hat_stddev * rot_noise[i];
+      delta_strafe_hat = 0 + strafe_hat_stddev * strafe_noise[i];
+      // Apply sampled update to particle pose
+      x[i] += (delta_trans_hat * cs_bearing +
+        delta_strafe_hat * sn_bearing);
+      y[i] += (delta_trans_hat * sn_bearing -
+        delta_strafe_hat * cs_bearing);
+      theta[i] += delta_rot_hat;
+    }
   }
 }
 
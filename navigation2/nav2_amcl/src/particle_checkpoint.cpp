@@ -0,0 +1,108 @@
+// Copyright (c) 2018 Intel Corporation
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <stdio.h>
+#include <string.h>
+
+#include "nav2_amcl/particle_checkpoint.hpp"
+
+namespace nav2_amcl
+{
+
+namespace
+{
+
+// A header followed by the x, y, theta and weight arrays in turn
+const char checkpoint_magic[8] = {'A', 'M', 'C', 'L', 'P', 'S', '0', '1'};
+
+struct CheckpointHeader
+{
+  char magic[8];
+  uint64_t map_id;
+  int64_t stamp;
+  int64_t count;
+};
+
+}  // namespace
+
+void
+ParticleCheckpoint::assign(const pf_sample_set_t * set)
+{
+  x.assign(set->x, set->x + set->sample_count);
+  y.assign(set->y, set->y + set->sample_count);
+  theta.assign(set->theta, set->theta + set->sample_count);
+  weight.assign(set->weight, set->weight + set->sample_count);
+}
+
+bool
+saveParticleCheckpoint(const std::string & filename, const ParticleCheckpoint & checkpoint)
+{
+  std::string tmp_name = filename + ".tmp";
+  FILE * file = fopen(tmp_name.c_str(), "wb");
+  if (file == NULL) {
+    return false;
+  }
+
+  CheckpointHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, checkpoint_magic, sizeof(header.magic));
+  header.map_id = checkpoint.map_id;
+  header.stamp = checkpoint.stamp;
+  header.count = checkpoint.x.size();
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  for (const std::vector<double> * array :
+    {&checkpoint.x, &checkpoint.y, &checkpoint.theta, &checkpoint.weight})
+  {
+    ok = ok && fwrite(array->data(), sizeof(double), header.count, file) ==
+      static_cast<size_t>(header.count);
+  }
+
+  ok = (fclose(file) == 0) && ok;
+  ok = ok && rename(tmp_name.c_str(), filename.c_str()) == 0;
+  if (!ok) {
+    remove(tmp_name.c_str());
+  }
+  return ok;
+}
+
+bool
+loadParticleCheckpoint(const std::string & filename, ParticleCheckpoint & checkpoint)
+{
+  FILE * file = fopen(filename.c_str(), "rb");
+  if (file == NULL) {
+    return false;
+  }
+
+  CheckpointHeader header;
+  bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+    memcmp(header.magic, checkpoint_magic, sizeof(header.magic)) == 0 &&
+    header.count > 0 && header.count <= (1 << 24);
+  if (ok) {
+    checkpoint.map_id = header.map_id;
+    checkpoint.stamp = header.stamp;
+    for (std::vector<double> * array :
+      {&checkpoint.x, &checkpoint.y, &checkpoint.theta, &checkpoint.weight})
+    {
+      array->resize(header.count);
+      ok = ok && fread(array->data(), sizeof(double), header.count, file) ==
+        static_cast<size_t>(header.count);
+    }
+  }
+  fclose(file);
+  return ok;
+}
+
+}  // namespace nav2_amcl
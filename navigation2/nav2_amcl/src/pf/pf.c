@@ -29,6 +29,7 @@
 #include <assert.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "nav2_amcl/pf/pf.hpp"
@@ -40,6 +41,27 @@
 // with samples in them.
 static int pf_resample_limit(pf_t * pf, int k);
 
+// Reallocate the sample arrays of a set for max_samples samples, keeping as
+// many of its samples as fit
+static void pf_sample_set_resize(pf_sample_set_t * set, int max_samples);
+
+// Normalize the sample weights after a sensor update and update the running
+// averages of the likelihood
+static void pf_normalize_sensor_weights(pf_t * pf, pf_sample_set_t * set, double total);
+
+// Fill pf->resample_index with the systematic resampling of set_a
+static void pf_resample_systematic(pf_t * pf, pf_sample_set_t * set_a, double total);
+
+// Find the sample whose cumulative weight interval contains r
+static int pf_resample_search(pf_t * pf, int sample_count, double r);
+
+// Histogram operations, forwarded to the kd-tree or the hash grid
+static void pf_histogram_clear(pf_t * pf, pf_sample_set_t * set);
+static void pf_histogram_insert(pf_t * pf, pf_sample_set_t * set, pf_vector_t pose, double value);
+static int pf_histogram_bin_count(pf_t * pf, pf_sample_set_t * set);
+static void pf_histogram_cluster(pf_t * pf, pf_sample_set_t * set);
+static int pf_histogram_get_cluster(pf_t * pf, pf_sample_set_t * set, pf_vector_t pose);
+
 
 // Create a new filter
 pf_t * pf_alloc(
@@ -50,7 +72,6 @@ pf_t * pf_alloc(
   int i, j;
   pf_t * pf;
   pf_sample_set_t * set;
-  pf_sample_t * sample;
 
   srand48(time(NULL));
 
@@ -75,19 +96,19 @@ pf_t * pf_alloc(
   for (j = 0; j < 2; j++) {
     set = pf->sets + j;
 
+    pf_sample_set_resize(set, max_samples);
     set->sample_count = max_samples;
-    set->samples = calloc(max_samples, sizeof(pf_sample_t));
 
     for (i = 0; i < set->sample_count; i++) {
-      sample = set->samples + i;
-      sample->pose.v[0] = 0.0;
-      sample->pose.v[1] = 0.0;
-      sample->pose.v[2] = 0.0;
-      sample->weight = 1.0 / max_samples;
+      set->x[i] = 0.0;
+      set->y[i] = 0.0;
+      set->theta[i] = 0.0;
+      set->weight[i] = 1.0 / max_samples;
     }
 
     // HACK: is 3 times max_samples enough?
     set->kdtree = pf_kdtree_alloc(3 * max_samples);
+    set->hashgrid = pf_hashgrid_alloc(max_samples);
 
     set->cluster_count = 0;
     set->cluster_max_count = max_samples;
@@ -99,10 +120,19 @@ pf_t * pf_alloc(
 
   pf->w_slow = 0.0;
   pf->w_fast = 0.0;
+  pf->n_eff = max_samples;
 
   pf->alpha_slow = alpha_slow;
   pf->alpha_fast = alpha_fast;
 
+  pf->sensor_pool = NULL;
+
+  pf->resample_method = PF_RESAMPLE_MULTINOMIAL;
+  pf->resample_cdf = calloc(max_samples + 1, sizeof(double));
+  pf->resample_index = calloc(max_samples, sizeof(int));
+
+  pf->histogram_type = PF_HISTOGRAM_KDTREE;
+
   // set converged to 0
   pf_init_converged(pf);
 
@@ -114,10 +144,15 @@ void pf_free(pf_t * pf)
 {
   int i;
 
+  pf_thread_pool_free(pf->sensor_pool);
+  free(pf->resample_index);
+  free(pf->resample_cdf);
+
   for (i = 0; i < 2; i++) {
     free(pf->sets[i].clusters);
     pf_kdtree_free(pf->sets[i].kdtree);
-    free(pf->sets[i].samples);
+    pf_hashgrid_free(pf->sets[i].hashgrid);
+    free(pf->sets[i].x);
   }
   free(pf);
 }
@@ -127,13 +162,12 @@ void pf_init(pf_t * pf, pf_vector_t mean, pf_matrix_t cov)
 {
   int i;
   pf_sample_set_t * set;
-  pf_sample_t * sample;
   pf_pdf_gaussian_t * pdf;
 
   set = pf->sets + pf->current_set;
 
   // Create the kd tree for adaptive sampling
-  pf_kdtree_clear(set->kdtree);
+  pf_histogram_clear(pf, set);
 
   set->sample_count = pf->max_samples;
 
@@ -141,12 +175,11 @@ void pf_init(pf_t * pf, pf_vector_t mean, pf_matrix_t cov)
 
   // Compute the new sample poses
   for (i = 0; i < set->sample_count; i++) {
-    sample = set->samples + i;
-    sample->weight = 1.0 / pf->max_samples;
-    sample->pose = pf_pdf_gaussian_sample(pdf);
+    set->weight[i] = 1.0 / pf->max_samples;
+    pf_sample_set_pose(set, i, pf_pdf_gaussian_sample(pdf));
 
     // Add sample to histogram
-    pf_kdtree_insert(set->kdtree, sample->pose, sample->weight);
+    pf_histogram_insert(pf, set, pf_sample_pose(set, i), set->weight[i]);
   }
 
   pf->w_slow = pf->w_fast = 0.0;
@@ -166,23 +199,21 @@ void pf_init_model(pf_t * pf, pf_init_model_fn_t init_fn, void * init_data)
 {
   int i;
   pf_sample_set_t * set;
-  pf_sample_t * sample;
 
   set = pf->sets + pf->current_set;
 
   // Create the kd tree for adaptive sampling
-  pf_kdtree_clear(set->kdtree);
+  pf_histogram_clear(pf, set);
 
   set->sample_count = pf->max_samples;
 
   // Compute the new sample poses
   for (i = 0; i < set->sample_count; i++) {
-    sample = set->samples + i;
-    sample->weight = 1.0 / pf->max_samples;
-    sample->pose = (*init_fn)(init_data);
+    set->weight[i] = 1.0 / pf->max_samples;
+    pf_sample_set_pose(set, i, (*init_fn)(init_data));
 
     // Add sample to histogram
-    pf_kdtree_insert(set->kdtree, sample->pose, sample->weight);
+    pf_histogram_insert(pf, set, pf_sample_pose(set, i), set->weight[i]);
   }
 
   pf->w_slow = pf->w_fast = 0.0;
@@ -206,24 +237,20 @@ int pf_update_converged(pf_t * pf)
 {
   int i;
   pf_sample_set_t * set;
-  pf_sample_t * sample;
 
   set = pf->sets + pf->current_set;
   double mean_x = 0, mean_y = 0;
 
   for (i = 0; i < set->sample_count; i++) {
-    sample = set->samples + i;
-
-    mean_x += sample->pose.v[0];
-    mean_y += sample->pose.v[1];
+    mean_x += set->x[i];
+    mean_y += set->y[i];
   }
   mean_x /= set->sample_count;
   mean_y /= set->sample_count;
 
   for (i = 0; i < set->sample_count; i++) {
-    sample = set->samples + i;
-    if (fabs(sample->pose.v[0] - mean_x) > pf->dist_threshold ||
-      fabs(sample->pose.v[1] - mean_y) > pf->dist_threshold)
+    if (fabs(set->x[i] - mean_x) > pf->dist_threshold ||
+      fabs(set->y[i] - mean_y) > pf->dist_threshold)
     {
       set->converged = 0;
       pf->converged = 0;
@@ -248,9 +275,7 @@ void pf_update_action(pf_t * pf, pf_action_model_fn_t action_fn, void * action_d
 // Update the filter with some new sensor observation
 void pf_update_sensor(pf_t * pf, pf_sensor_model_fn_t sensor_fn, void * sensor_data)
 {
-  int i;
   pf_sample_set_t * set;
-  pf_sample_t * sample;
   double total;
 
   set = pf->sets + pf->current_set;
@@ -258,14 +283,107 @@ void pf_update_sensor(pf_t * pf, pf_sensor_model_fn_t sensor_fn, void * sensor_d
   // Compute the sample weights
   total = (*sensor_fn)(sensor_data, set);
 
+  pf_normalize_sensor_weights(pf, set, total);
+}
+
+
+void pf_set_sensor_threads(pf_t * pf, int num_threads)
+{
+  if (pf->sensor_pool != NULL && pf_thread_pool_size(pf->sensor_pool) == num_threads) {
+    return;
+  }
+  pf_thread_pool_free(pf->sensor_pool);
+  pf->sensor_pool = pf_thread_pool_alloc(num_threads);
+}
+
+
+// Work shared by the sensor update jobs; job k weights samples
+// [k * PF_SENSOR_CHUNK_SIZE, (k + 1) * PF_SENSOR_CHUNK_SIZE)
+typedef struct
+{
+  pf_sensor_model_fn_t sensor_fn;
+  void * sensor_data;
+  pf_sample_set_t * set;
+
+  // Total weight of each chunk
+  double * chunk_totals;
+} pf_sensor_job_t;
+
+
+static void pf_sensor_job(void * job_data, int job)
+{
+  pf_sensor_job_t * sensor_job = (pf_sensor_job_t *) job_data;
+  pf_sample_set_t chunk;
+  int first;
+
+  // A view onto this chunk of the set; everything but the samples is shared.
+  // The chunk size keeps the arrays of the view aligned.
+  chunk = *sensor_job->set;
+  first = job * PF_SENSOR_CHUNK_SIZE;
+  chunk.x = sensor_job->set->x + first;
+  chunk.y = sensor_job->set->y + first;
+  chunk.theta = sensor_job->set->theta + first;
+  chunk.weight = sensor_job->set->weight + first;
+  chunk.sample_count = sensor_job->set->sample_count - first;
+  if (chunk.sample_count > PF_SENSOR_CHUNK_SIZE) {
+    chunk.sample_count = PF_SENSOR_CHUNK_SIZE;
+  }
+
+  sensor_job->chunk_totals[job] =
+    (*sensor_job->sensor_fn)(sensor_job->sensor_data, &chunk);
+}
+
+
+// Update the filter with some new sensor observation, in parallel
+void pf_update_sensor_parallel(pf_t * pf, pf_sensor_model_fn_t sensor_fn, void * sensor_data)
+{
+  int i, chunk_count;
+  pf_sample_set_t * set;
+  pf_sensor_job_t sensor_job;
+  double total;
+
+  set = pf->sets + pf->current_set;
+  chunk_count = (set->sample_count + PF_SENSOR_CHUNK_SIZE - 1) / PF_SENSOR_CHUNK_SIZE;
+
+  if (pf->sensor_pool == NULL || chunk_count < 2) {
+    pf_update_sensor(pf, sensor_fn, sensor_data);
+    return;
+  }
+
+  sensor_job.sensor_fn = sensor_fn;
+  sensor_job.sensor_data = sensor_data;
+  sensor_job.set = set;
+  sensor_job.chunk_totals = calloc(chunk_count, sizeof(double));
+
+  pf_thread_pool_run(pf->sensor_pool, pf_sensor_job, &sensor_job, chunk_count);
+
+  // Reduce in chunk order so the result does not depend on scheduling
+  total = 0.0;
+  for (i = 0; i < chunk_count; i++) {
+    total += sensor_job.chunk_totals[i];
+  }
+  free(sensor_job.chunk_totals);
+
+  pf_normalize_sensor_weights(pf, set, total);
+}
+
+
+// Normalize the sample weights after a sensor update
+void pf_normalize_sensor_weights(pf_t * pf, pf_sample_set_t * set, double total)
+{
+  int i;
+  double * weight = set->weight;
+
   if (total > 0.0) {
-    // Normalize weights
+    // Normalize weights, and sum their squares for the effective sample size
     double w_avg = 0.0;
+    double w_squares = 0.0;
     for (i = 0; i < set->sample_count; i++) {
-      sample = set->samples + i;
-      w_avg += sample->weight;
-      sample->weight /= total;
+      w_avg += weight[i];
+      weight[i] /= total;
+      w_squares += weight[i] * weight[i];
     }
+    pf->n_eff = 1.0 / w_squares;
     // Update running averages of likelihood of samples (Prob Rob p258)
     w_avg /= set->sample_count;
     if (pf->w_slow == 0.0) {
@@ -281,24 +399,80 @@ void pf_update_sensor(pf_t * pf, pf_sensor_model_fn_t sensor_fn, void * sensor_d
   } else {
     // Handle zero total
     for (i = 0; i < set->sample_count; i++) {
-      sample = set->samples + i;
-      sample->weight = 1.0 / set->sample_count;
+      weight[i] = 1.0 / set->sample_count;
+    }
+    pf->n_eff = set->sample_count;
+  }
+}
+
+
+void pf_set_resample_method(pf_t * pf, int method)
+{
+  pf->resample_method = method;
+}
+
+
+// Change the limits on the number of samples, keeping the current samples
+void pf_set_sample_limits(pf_t * pf, int min_samples, int max_samples)
+{
+  int i, j;
+  double total;
+  pf_sample_set_t * set;
+
+  pf->min_samples = min_samples;
+  if (max_samples == pf->max_samples) {
+    return;
+  }
+
+  for (j = 0; j < 2; j++) {
+    set = pf->sets + j;
+    pf_sample_set_resize(set, max_samples);
+    if (set->sample_count > max_samples) {
+      set->sample_count = max_samples;
+    }
+
+    pf_kdtree_free(set->kdtree);
+    set->kdtree = pf_kdtree_alloc(3 * max_samples);
+    pf_hashgrid_free(set->hashgrid);
+    set->hashgrid = pf_hashgrid_alloc(max_samples);
+
+    set->cluster_max_count = max_samples;
+    set->clusters = realloc(set->clusters, max_samples * sizeof(pf_cluster_t));
+    if (set->cluster_count > max_samples) {
+      set->cluster_count = max_samples;
+    }
+  }
+
+  pf->resample_cdf = realloc(pf->resample_cdf, (max_samples + 1) * sizeof(double));
+  pf->resample_index = realloc(pf->resample_index, max_samples * sizeof(int));
+  pf->max_samples = max_samples;
+
+  // The samples dropped took their weight with them, and the new histogram
+  // starts out empty
+  set = pf->sets + pf->current_set;
+  total = 0;
+  for (i = 0; i < set->sample_count; i++) {
+    total += set->weight[i];
+  }
+  pf_histogram_clear(pf, set);
+  for (i = 0; i < set->sample_count; i++) {
+    if (total > 0) {
+      set->weight[i] /= total;
+    } else {
+      set->weight[i] = 1.0 / set->sample_count;
     }
+    pf_histogram_insert(pf, set, pf_sample_pose(set, i), set->weight[i]);
   }
+  pf_cluster_stats(pf, set);
 }
 
 
 // Resample the distribution
 void pf_update_resample(pf_t * pf)
 {
-  int i;
+  int i, m, n, stride;
   double total;
   pf_sample_set_t * set_a, * set_b;
-  pf_sample_t * sample_a, * sample_b;
-
-  // double r,c,U;
-  // int m;
-  // double count_inv;
   double * c;
 
   double w_diff;
@@ -306,17 +480,37 @@ void pf_update_resample(pf_t * pf)
   set_a = pf->sets + pf->current_set;
   set_b = pf->sets + (pf->current_set + 1) % 2;
 
-  // Build up cumulative probability table for resampling.
-  // TODO(?): Replace this with a more efficient procedure
-  // (e.g., http://www.network-theory.co.uk/docs/gslref/GeneralDiscreteDistributions.html)
-  c = (double *)malloc(sizeof(double) * (set_a->sample_count + 1));
+  // Build up cumulative probability table for resampling
+  c = pf->resample_cdf;
   c[0] = 0.0;
   for (i = 0; i < set_a->sample_count; i++) {
-    c[i + 1] = c[i] + set_a->samples[i].weight;
+    c[i + 1] = c[i] + set_a->weight[i];
+  }
+
+  // The systematic resampler picks max_samples samples up front.  The KLD
+  // test below may stop after any prefix of them, so they are visited with a
+  // stride that is coprime to max_samples: every prefix is then spread over
+  // the whole cumulative distribution rather than biased towards its start.
+  stride = 1;
+  if (pf->resample_method == PF_RESAMPLE_LOW_VARIANCE) {
+    pf_resample_systematic(pf, set_a, c[set_a->sample_count]);
+
+    stride = (int) (0.618034 * pf->max_samples) + 1;
+    for (;; stride++) {
+      int a = stride, b = pf->max_samples;
+      while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+      }
+      if (a == 1) {
+        break;
+      }
+    }
   }
 
   // Create the kd tree for adaptive sampling
-  pf_kdtree_clear(set_b->kdtree);
+  pf_histogram_clear(pf, set_b);
 
   // Draw samples from set a to create set b.
   total = 0;
@@ -328,72 +522,37 @@ void pf_update_resample(pf_t * pf)
   }
   // printf("w_diff: %9.6f\n", w_diff);
 
-  // Can't (easily) combine low-variance sampler with KLD adaptive
-  // sampling, so we'll take the more traditional route.
-  /*
-  // Low-variance resampler, taken from Probabilistic Robotics, p110
-  count_inv = 1.0/set_a->sample_count;
-  r = drand48() * count_inv;
-  c = set_a->samples[0].weight;
-  i = 0;
   m = 0;
-  */
   while (set_b->sample_count < pf->max_samples) {
-    sample_b = set_b->samples + set_b->sample_count++;
+    n = set_b->sample_count++;
 
     if (drand48() < w_diff) {
-      sample_b->pose = (pf->random_pose_fn)(pf->random_pose_data);
+      pf_sample_set_pose(set_b, n, (pf->random_pose_fn)(pf->random_pose_data));
     } else {
-      // Can't (easily) combine low-variance sampler with KLD adaptive
-      // sampling, so we'll take the more traditional route.
-      /*
-      // Low-variance resampler, taken from Probabilistic Robotics, p110
-      U = r + m * count_inv;
-      while(U>c)
-      {
-        i++;
-        // Handle wrap-around by resetting counters and picking a new random
-        // number
-        if(i >= set_a->sample_count)
-        {
-          r = drand48() * count_inv;
-          c = set_a->samples[0].weight;
-          i = 0;
-          m = 0;
-          U = r + m * count_inv;
-          continue;
-        }
-        c += set_a->samples[i].weight;
-      }
-      m++;
-      */
-
-      // Naive discrete event sampler
-      double r;
-      r = drand48();
-      for (i = 0; i < set_a->sample_count; i++) {
-        if ((c[i] <= r) && (r < c[i + 1])) {
-          break;
-        }
+      if (pf->resample_method == PF_RESAMPLE_LOW_VARIANCE) {
+        i = pf->resample_index[m];
+        m = (m + stride) % pf->max_samples;
+      } else {
+        // Naive discrete event sampler
+        i = pf_resample_search(pf, set_a->sample_count, drand48());
       }
       assert(i < set_a->sample_count);
-
-      sample_a = set_a->samples + i;
-
-      assert(sample_a->weight > 0);
+      assert(set_a->weight[i] > 0);
 
       // Add sample to list
-      sample_b->pose = sample_a->pose;
+      set_b->x[n] = set_a->x[i];
+      set_b->y[n] = set_a->y[i];
+      set_b->theta[n] = set_a->theta[i];
     }
 
-    sample_b->weight = 1.0;
-    total += sample_b->weight;
+    set_b->weight[n] = 1.0;
+    total += set_b->weight[n];
 
     // Add sample to histogram
-    pf_kdtree_insert(set_b->kdtree, sample_b->pose, sample_b->weight);
+    pf_histogram_insert(pf, set_b, pf_sample_pose(set_b, n), set_b->weight[n]);
 
     // See if we have enough samples yet
-    if (set_b->sample_count > pf_resample_limit(pf, set_b->kdtree->leaf_count)) {
+    if (set_b->sample_count > pf_resample_limit(pf, pf_histogram_bin_count(pf, set_b))) {
       break;
     }
   }
@@ -407,8 +566,7 @@ void pf_update_resample(pf_t * pf)
 
   // Normalize weights
   for (i = 0; i < set_b->sample_count; i++) {
-    sample_b = set_b->samples + i;
-    sample_b->weight /= total;
+    set_b->weight[i] /= total;
   }
 
   // Re-compute cluster statistics
@@ -418,8 +576,168 @@ void pf_update_resample(pf_t * pf)
   pf->current_set = (pf->current_set + 1) % 2;
 
   pf_update_converged(pf);
+}
+
+
+// Rebuild the statistics of the current set without resampling it
+void pf_update_stats(pf_t * pf)
+{
+  int i;
+  pf_sample_set_t * set;
+
+  set = pf->sets + pf->current_set;
+
+  // The samples have moved since the histogram was built
+  pf_histogram_clear(pf, set);
+  for (i = 0; i < set->sample_count; i++) {
+    pf_histogram_insert(pf, set, pf_sample_pose(set, i), set->weight[i]);
+  }
+  pf_cluster_stats(pf, set);
+
+  pf_update_converged(pf);
+}
+
+
+// Low-variance resampler, taken from Probabilistic Robotics, p110: a single
+// random offset, then max_samples evenly spaced pointers into the cumulative
+// weights, walked in one pass.
+void pf_resample_systematic(pf_t * pf, pf_sample_set_t * set_a, double total)
+{
+  int i, m;
+  double step, u;
+  double * c;
+
+  c = pf->resample_cdf;
+  step = total / pf->max_samples;
+  u = drand48() * step;
+
+  i = 0;
+  for (m = 0; m < pf->max_samples; m++) {
+    while (i < set_a->sample_count - 1 && c[i + 1] <= u) {
+      i++;
+    }
+    pf->resample_index[m] = i;
+    u += step;
+  }
+}
+
+
+// Binary search over the cumulative weights for the sample i with
+// c[i] <= r < c[i + 1]; returns sample_count if there is none
+int pf_resample_search(pf_t * pf, int sample_count, double r)
+{
+  int lo, hi, mid;
+  double * c;
+
+  c = pf->resample_cdf;
+  if (!(r < c[sample_count])) {
+    return sample_count;
+  }
 
-  free(c);
+  // Largest lo with c[lo] <= r
+  lo = 0;
+  hi = sample_count;
+  while (hi - lo > 1) {
+    mid = (lo + hi) / 2;
+    if (c[mid] <= r) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+
+void pf_set_histogram_type(pf_t * pf, int type)
+{
+  pf->histogram_type = type;
+}
+
+
+void pf_histogram_clear(pf_t * pf, pf_sample_set_t * set)
+{
+  if (pf->histogram_type == PF_HISTOGRAM_HASHGRID) {
+    pf_hashgrid_clear(set->hashgrid);
+  } else {
+    pf_kdtree_clear(set->kdtree);
+  }
+}
+
+
+void pf_histogram_insert(pf_t * pf, pf_sample_set_t * set, pf_vector_t pose, double value)
+{
+  if (pf->histogram_type == PF_HISTOGRAM_HASHGRID) {
+    pf_hashgrid_insert(set->hashgrid, pose, value);
+  } else {
+    pf_kdtree_insert(set->kdtree, pose, value);
+  }
+}
+
+
+int pf_histogram_bin_count(pf_t * pf, pf_sample_set_t * set)
+{
+  if (pf->histogram_type == PF_HISTOGRAM_HASHGRID) {
+    return set->hashgrid->bin_count;
+  }
+  return set->kdtree->leaf_count;
+}
+
+
+void pf_histogram_cluster(pf_t * pf, pf_sample_set_t * set)
+{
+  if (pf->histogram_type == PF_HISTOGRAM_HASHGRID) {
+    pf_hashgrid_cluster(set->hashgrid);
+  } else {
+    pf_kdtree_cluster(set->kdtree);
+  }
+}
+
+
+int pf_histogram_get_cluster(pf_t * pf, pf_sample_set_t * set, pf_vector_t pose)
+{
+  if (pf->histogram_type == PF_HISTOGRAM_HASHGRID) {
+    return pf_hashgrid_get_cluster(set->hashgrid, pose);
+  }
+  return pf_kdtree_get_cluster(set->kdtree, pose);
+}
+
+
+// The four arrays of a set share one allocation, each starting on a
+// PF_SAMPLE_ALIGN boundary, which x points to
+void pf_sample_set_resize(pf_sample_set_t * set, int max_samples)
+{
+  size_t stride;
+  void * block;
+  double * x;
+  int kept;
+
+  stride = (max_samples * sizeof(double) + PF_SAMPLE_ALIGN - 1) / PF_SAMPLE_ALIGN * PF_SAMPLE_ALIGN;
+  if (stride == 0) {
+    stride = PF_SAMPLE_ALIGN;
+  }
+  if (posix_memalign(&block, PF_SAMPLE_ALIGN, 4 * stride) != 0) {
+    abort();
+  }
+  memset(block, 0, 4 * stride);
+  x = (double *) block;
+
+  kept = set->x != NULL ? set->sample_count : 0;
+  if (kept > max_samples) {
+    kept = max_samples;
+  }
+  if (kept > 0) {
+    memcpy(x, set->x, kept * sizeof(double));
+    memcpy(x + stride / sizeof(double), set->y, kept * sizeof(double));
+    memcpy(x + 2 * stride / sizeof(double), set->theta, kept * sizeof(double));
+    memcpy(x + 3 * stride / sizeof(double), set->weight, kept * sizeof(double));
+  }
+  free(set->x);
+
+  set->x = x;
+  set->y = x + stride / sizeof(double);
+  set->theta = x + 2 * stride / sizeof(double);
+  set->weight = x + 3 * stride / sizeof(double);
 }
 
 
@@ -452,143 +770,243 @@ int pf_resample_limit(pf_t * pf, int k)
 }
 
 
-// Re-compute the cluster statistics for a sample set
-void pf_cluster_stats(pf_t * pf, pf_sample_set_t * set)
+// Running weighted statistics of a group of samples, which merge pairwise as in
+// Chan, Golub and LeVeque, so that the covariance never subtracts two large
+// second moments from each other
+typedef struct
 {
-  (void)pf;
-  int i, j, k, cidx;
-  pf_sample_t * sample;
-  pf_cluster_t * cluster;
-
-  // Workspace
-  double m[4], c[2][2];
-  size_t count;
+  int count;
   double weight;
+  double mean[2];
 
-  // Cluster the samples
-  pf_kdtree_cluster(set->kdtree);
+  // Sum of weight * (x - mean) * (x - mean)^T over the linear components
+  double scatter[2][2];
 
-  // Initialize cluster stats
-  set->cluster_count = 0;
+  // Weighted sums of the cosine and sine of the heading
+  double heading[2];
+} pf_stats_t;
 
-  for (i = 0; i < set->cluster_max_count; i++) {
-    cluster = set->clusters + i;
-    cluster->count = 0;
-    cluster->weight = 0;
-    cluster->mean = pf_vector_zero();
-    cluster->cov = pf_matrix_zero();
 
-    for (j = 0; j < 4; j++) {
-      cluster->m[j] = 0.0;
-    }
-    for (j = 0; j < 2; j++) {
-      for (k = 0; k < 2; k++) {
-        cluster->c[j][k] = 0.0;
-      }
+// Add a sample to the statistics, in the weighted form of Welford's update
+static void pf_stats_add(
+  pf_stats_t * stats, pf_vector_t pose, double weight, double cos_theta, double sin_theta)
+{
+  int j, k;
+  double total, d[2], f;
+
+  stats->count += 1;
+  stats->heading[0] += weight * cos_theta;
+  stats->heading[1] += weight * sin_theta;
+
+  total = stats->weight + weight;
+  if (total <= 0.0) {
+    return;
+  }
+  d[0] = pose.v[0] - stats->mean[0];
+  d[1] = pose.v[1] - stats->mean[1];
+  f = weight * stats->weight / total;
+  for (j = 0; j < 2; j++) {
+    for (k = 0; k < 2; k++) {
+      stats->scatter[j][k] += f * d[j] * d[k];
     }
+    stats->mean[j] += d[j] * weight / total;
   }
+  stats->weight = total;
+}
+
 
-  // Initialize overall filter stats
-  count = 0;
-  weight = 0.0;
-  set->mean = pf_vector_zero();
-  set->cov = pf_matrix_zero();
-  for (j = 0; j < 4; j++) {
-    m[j] = 0.0;
+// Merge the statistics of b into a
+static void pf_stats_merge(pf_stats_t * a, const pf_stats_t * b)
+{
+  int j, k;
+  double total, d[2], f;
+
+  a->count += b->count;
+  a->heading[0] += b->heading[0];
+  a->heading[1] += b->heading[1];
+
+  total = a->weight + b->weight;
+  if (total <= 0.0) {
+    return;
   }
+  d[0] = b->mean[0] - a->mean[0];
+  d[1] = b->mean[1] - a->mean[1];
+  f = a->weight * b->weight / total;
   for (j = 0; j < 2; j++) {
     for (k = 0; k < 2; k++) {
-      c[j][k] = 0.0;
+      a->scatter[j][k] += b->scatter[j][k] + f * d[j] * d[k];
     }
+    a->mean[j] += d[j] * b->weight / total;
   }
+  a->weight = total;
+}
 
-  // Compute cluster stats
-  for (i = 0; i < set->sample_count; i++) {
-    sample = set->samples + i;
 
-    // printf("%d %f %f %f\n", i, sample->pose.v[0], sample->pose.v[1], sample->pose.v[2]);
+// The mean and covariance of the statistics
+static void pf_stats_moments(const pf_stats_t * stats, pf_vector_t * mean, pf_matrix_t * cov)
+{
+  int j, k;
+
+  mean->v[0] = stats->mean[0];
+  mean->v[1] = stats->mean[1];
+  mean->v[2] = atan2(stats->heading[1], stats->heading[0]);
+
+  *cov = pf_matrix_zero();
+
+  // Covariance in linear components
+  if (stats->weight > 0.0) {
+    for (j = 0; j < 2; j++) {
+      for (k = 0; k < 2; k++) {
+        cov->m[j][k] = stats->scatter[j][k] / stats->weight;
+      }
+    }
+  }
+
+  // Covariance in angular components; I think this is the correct
+  // formula for circular statistics.
+  cov->m[2][2] = -2 * log(sqrt(stats->heading[0] * stats->heading[0] +
+      stats->heading[1] * stats->heading[1]));
+}
+
+
+// Work shared by the cluster statistics jobs; job k covers samples
+// [k * PF_STATS_CHUNK_SIZE, (k + 1) * PF_STATS_CHUNK_SIZE)
+typedef struct
+{
+  pf_t * pf;
+  pf_sample_set_t * set;
+
+  // Statistics of all the samples of each chunk
+  pf_stats_t * totals;
+
+  // Statistics of each cluster in each chunk, grown to the highest cluster
+  // label seen in the chunk
+  pf_stats_t ** clusters;
+  int * cluster_counts;
+} pf_stats_job_t;
+
+
+static void pf_stats_job(void * job_data, int job)
+{
+  pf_stats_job_t * stats_job = (pf_stats_job_t *) job_data;
+  pf_sample_set_t * set = stats_job->set;
+  pf_stats_t * clusters = NULL;
+  int i, first, last, cidx, capacity, grown;
+  pf_vector_t pose;
+  double cos_theta, sin_theta;
+
+  first = job * PF_STATS_CHUNK_SIZE;
+  last = first + PF_STATS_CHUNK_SIZE;
+  if (last > set->sample_count) {
+    last = set->sample_count;
+  }
+
+  capacity = 0;
+  for (i = first; i < last; i++) {
+    pose = pf_sample_pose(set, i);
 
     // Get the cluster label for this sample
-    cidx = pf_kdtree_get_cluster(set->kdtree, sample->pose);
+    cidx = pf_histogram_get_cluster(stats_job->pf, set, pose);
     assert(cidx >= 0);
     if (cidx >= set->cluster_max_count) {
       continue;
     }
-    if (cidx + 1 > set->cluster_count) {
-      set->cluster_count = cidx + 1;
+    if (cidx >= capacity) {
+      grown = capacity > 0 ? capacity : 8;
+      while (grown <= cidx) {
+        grown *= 2;
+      }
+      clusters = realloc(clusters, grown * sizeof(pf_stats_t));
+      memset(clusters + capacity, 0, (grown - capacity) * sizeof(pf_stats_t));
+      capacity = grown;
+    }
+    if (cidx + 1 > stats_job->cluster_counts[job]) {
+      stats_job->cluster_counts[job] = cidx + 1;
     }
 
-    cluster = set->clusters + cidx;
+    cos_theta = cos(pose.v[2]);
+    sin_theta = sin(pose.v[2]);
+    pf_stats_add(clusters + cidx, pose, set->weight[i], cos_theta, sin_theta);
+    pf_stats_add(stats_job->totals + job, pose, set->weight[i], cos_theta, sin_theta);
+  }
+  stats_job->clusters[job] = clusters;
+}
 
-    cluster->count += 1;
-    cluster->weight += sample->weight;
 
-    count += 1;
-    weight += sample->weight;
+// Re-compute the cluster statistics for a sample set, in one pass over the
+// samples split into chunks, concurrently on the sensor pool if there is one
+void pf_cluster_stats(pf_t * pf, pf_sample_set_t * set)
+{
+  int i, j, k, job, job_count;
+  pf_cluster_t * cluster;
+  pf_stats_job_t stats_job;
+  pf_stats_t merged, total;
 
-    // Compute mean
-    cluster->m[0] += sample->weight * sample->pose.v[0];
-    cluster->m[1] += sample->weight * sample->pose.v[1];
-    cluster->m[2] += sample->weight * cos(sample->pose.v[2]);
-    cluster->m[3] += sample->weight * sin(sample->pose.v[2]);
+  // Cluster the samples
+  pf_histogram_cluster(pf, set);
 
-    m[0] += sample->weight * sample->pose.v[0];
-    m[1] += sample->weight * sample->pose.v[1];
-    m[2] += sample->weight * cos(sample->pose.v[2]);
-    m[3] += sample->weight * sin(sample->pose.v[2]);
+  job_count = (set->sample_count + PF_STATS_CHUNK_SIZE - 1) / PF_STATS_CHUNK_SIZE;
+  if (job_count < 1) {
+    job_count = 1;
+  }
+  stats_job.pf = pf;
+  stats_job.set = set;
+  stats_job.totals = calloc(job_count, sizeof(pf_stats_t));
+  stats_job.clusters = calloc(job_count, sizeof(pf_stats_t *));
+  stats_job.cluster_counts = calloc(job_count, sizeof(int));
+
+  if (pf->sensor_pool != NULL && job_count > 1) {
+    pf_thread_pool_run(pf->sensor_pool, pf_stats_job, &stats_job, job_count);
+  } else {
+    for (job = 0; job < job_count; job++) {
+      pf_stats_job(&stats_job, job);
+    }
+  }
 
-    // Compute covariance in linear components
-    for (j = 0; j < 2; j++) {
-      for (k = 0; k < 2; k++) {
-        cluster->c[j][k] += sample->weight * sample->pose.v[j] * sample->pose.v[k];
-        c[j][k] += sample->weight * sample->pose.v[j] * sample->pose.v[k];
-      }
+  // Merge in chunk order so the result does not depend on scheduling
+  set->cluster_count = 0;
+  for (job = 0; job < job_count; job++) {
+    if (stats_job.cluster_counts[job] > set->cluster_count) {
+      set->cluster_count = stats_job.cluster_counts[job];
     }
   }
 
-  // Normalize
   for (i = 0; i < set->cluster_count; i++) {
-    cluster = set->clusters + i;
-
-    cluster->mean.v[0] = cluster->m[0] / cluster->weight;
-    cluster->mean.v[1] = cluster->m[1] / cluster->weight;
-    cluster->mean.v[2] = atan2(cluster->m[3], cluster->m[2]);
-
-    cluster->cov = pf_matrix_zero();
+    memset(&merged, 0, sizeof(merged));
+    for (job = 0; job < job_count; job++) {
+      if (i < stats_job.cluster_counts[job]) {
+        pf_stats_merge(&merged, stats_job.clusters[job] + i);
+      }
+    }
 
-    // Covariance in linear components
+    cluster = set->clusters + i;
+    cluster->count = merged.count;
+    cluster->weight = merged.weight;
+    pf_stats_moments(&merged, &cluster->mean, &cluster->cov);
+
+    // The raw weighted moments, as they were accumulated before
+    cluster->m[0] = merged.weight * merged.mean[0];
+    cluster->m[1] = merged.weight * merged.mean[1];
+    cluster->m[2] = merged.heading[0];
+    cluster->m[3] = merged.heading[1];
     for (j = 0; j < 2; j++) {
       for (k = 0; k < 2; k++) {
-        cluster->cov.m[j][k] = cluster->c[j][k] / cluster->weight -
-          cluster->mean.v[j] * cluster->mean.v[k];
+        cluster->c[j][k] = merged.scatter[j][k] + merged.weight * merged.mean[j] * merged.mean[k];
       }
     }
-
-    // Covariance in angular components; I think this is the correct
-    // formula for circular statistics.
-    cluster->cov.m[2][2] = -2 * log(sqrt(cluster->m[2] * cluster->m[2] +
-        cluster->m[3] * cluster->m[3]));
-
-    // printf("cluster %d %d %f (%f %f %f)\n", i, cluster->count, cluster->weight,
-    // cluster->mean.v[0], cluster->mean.v[1], cluster->mean.v[2]);
-    // pf_matrix_fprintf(cluster->cov, stdout, "%e");
   }
 
   // Compute overall filter stats
-  set->mean.v[0] = m[0] / weight;
-  set->mean.v[1] = m[1] / weight;
-  set->mean.v[2] = atan2(m[3], m[2]);
-
-  // Covariance in linear components
-  for (j = 0; j < 2; j++) {
-    for (k = 0; k < 2; k++) {
-      set->cov.m[j][k] = c[j][k] / weight - set->mean.v[j] * set->mean.v[k];
-    }
+  memset(&total, 0, sizeof(total));
+  for (job = 0; job < job_count; job++) {
+    pf_stats_merge(&total, stats_job.totals + job);
+    free(stats_job.clusters[job]);
   }
+  pf_stats_moments(&total, &set->mean, &set->cov);
 
-  // Covariance in angular components; I think this is the correct
-  // formula for circular statistics.
-  set->cov.m[2][2] = -2 * log(sqrt(m[2] * m[2] + m[3] * m[3]));
+  free(stats_job.totals);
+  free(stats_job.clusters);
+  free(stats_job.cluster_counts);
 }
 
 
@@ -598,7 +1016,6 @@ void pf_get_cep_stats(pf_t * pf, pf_vector_t * mean, double * var)
   int i;
   double mn, mx, my, mrr;
   pf_sample_set_t * set;
-  pf_sample_t * sample;
 
   set = pf->sets + pf->current_set;
 
@@ -608,13 +1025,11 @@ void pf_get_cep_stats(pf_t * pf, pf_vector_t * mean, double * var)
   mrr = 0.0;
 
   for (i = 0; i < set->sample_count; i++) {
-    sample = set->samples + i;
-
-    mn += sample->weight;
-    mx += sample->weight * sample->pose.v[0];
-    my += sample->weight * sample->pose.v[1];
-    mrr += sample->weight * sample->pose.v[0] * sample->pose.v[0];
-    mrr += sample->weight * sample->pose.v[1] * sample->pose.v[1];
+    mn += set->weight[i];
+    mx += set->weight[i] * set->x[i];
+    my += set->weight[i] * set->y[i];
+    mrr += set->weight[i] * set->x[i] * set->x[i];
+    mrr += set->weight[i] * set->y[i] * set->y[i];
   }
 
   mean->v[0] = mx / mn;
@@ -0,0 +1,260 @@
+/*
+ *  Player - One Hell of a Robot Server
+ *  Copyright (C) 2000  Brian Gerkey   &  Kasper Stoy
+ *                      gerkey@usc.edu    kaspers@robotics.usc.edu
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/**************************************************************************
+ * Desc: Hash grid histogram functions
+ *************************************************************************/
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+#include "nav2_amcl/pf/pf_vector.hpp"
+#include "nav2_amcl/pf/pf_hashgrid.hpp"
+
+
+// Compute the key for a pose
+static void pf_hashgrid_key(pf_hashgrid_t * self, pf_vector_t pose, int key[]);
+
+// Find the slot holding the given key, or the empty slot where it belongs
+static int pf_hashgrid_find_slot(pf_hashgrid_t * self, int key[]);
+
+// Find the bin with the given key; returns NULL if there is none
+static pf_hashgrid_bin_t * pf_hashgrid_find_bin(pf_hashgrid_t * self, int key[]);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Create a grid
+pf_hashgrid_t * pf_hashgrid_alloc(int max_size)
+{
+  int slot_count;
+  pf_hashgrid_t * self;
+
+  self = calloc(1, sizeof(pf_hashgrid_t));
+
+  self->size[0] = 0.50;
+  self->size[1] = 0.50;
+  self->size[2] = (10 * M_PI / 180);
+
+  // Keep the load factor at or below one half
+  slot_count = 16;
+  while (slot_count < 2 * max_size) {
+    slot_count *= 2;
+  }
+  self->slot_mask = slot_count - 1;
+  self->slots = calloc(slot_count, sizeof(int));
+
+  self->bin_count = 0;
+  self->bin_max_count = max_size;
+  self->bins = calloc(self->bin_max_count, sizeof(pf_hashgrid_bin_t));
+  self->stack = calloc(self->bin_max_count, sizeof(int));
+
+  return self;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Destroy a grid
+void pf_hashgrid_free(pf_hashgrid_t * self)
+{
+  free(self->stack);
+  free(self->bins);
+  free(self->slots);
+  free(self);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Clear all entries from the grid.  Stale slots are recognised by
+// pf_hashgrid_find_slot, so the table itself is left alone.
+void pf_hashgrid_clear(pf_hashgrid_t * self)
+{
+  self->bin_count = 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Insert a pose into the grid
+void pf_hashgrid_insert(pf_hashgrid_t * self, pf_vector_t pose, double value)
+{
+  int key[3];
+  int slot, index;
+  pf_hashgrid_bin_t * bin;
+
+  pf_hashgrid_key(self, pose, key);
+
+  slot = pf_hashgrid_find_slot(self, key);
+  index = self->slots[slot];
+  if (index < self->bin_count && self->bins[index].slot == slot) {
+    self->bins[index].value += value;
+    return;
+  }
+
+  assert(self->bin_count < self->bin_max_count);
+  index = self->bin_count++;
+  bin = self->bins + index;
+  bin->key[0] = key[0];
+  bin->key[1] = key[1];
+  bin->key[2] = key[2];
+  bin->value = value;
+  bin->cluster = -1;
+  bin->slot = slot;
+  self->slots[slot] = index;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Determine the probability estimate for the given pose
+double pf_hashgrid_get_prob(pf_hashgrid_t * self, pf_vector_t pose)
+{
+  int key[3];
+  pf_hashgrid_bin_t * bin;
+
+  pf_hashgrid_key(self, pose, key);
+
+  bin = pf_hashgrid_find_bin(self, key);
+  if (bin == NULL) {
+    return 0.0;
+  }
+  return bin->value;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Determine the cluster label for the given pose
+int pf_hashgrid_get_cluster(pf_hashgrid_t * self, pf_vector_t pose)
+{
+  int key[3];
+  pf_hashgrid_bin_t * bin;
+
+  pf_hashgrid_key(self, pose, key);
+
+  bin = pf_hashgrid_find_bin(self, key);
+  if (bin == NULL) {
+    return -1;
+  }
+  return bin->cluster;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Cluster the bins in the grid, using an explicit stack rather than recursion
+void pf_hashgrid_cluster(pf_hashgrid_t * self)
+{
+  int i, n;
+  int stack_count, cluster_count;
+  int nkey[3];
+  pf_hashgrid_bin_t * bin, * nbin;
+
+  for (i = 0; i < self->bin_count; i++) {
+    self->bins[i].cluster = -1;
+  }
+
+  cluster_count = 0;
+
+  // Do connected components for each bin
+  for (i = 0; i < self->bin_count; i++) {
+    if (self->bins[i].cluster >= 0) {
+      continue;
+    }
+
+    // Assign a label to this cluster
+    self->bins[i].cluster = cluster_count++;
+    stack_count = 0;
+    self->stack[stack_count++] = i;
+
+    while (stack_count > 0) {
+      bin = self->bins + self->stack[--stack_count];
+
+      for (n = 0; n < 3 * 3 * 3; n++) {
+        nkey[0] = bin->key[0] + (n / 9) - 1;
+        nkey[1] = bin->key[1] + ((n % 9) / 3) - 1;
+        nkey[2] = bin->key[2] + ((n % 9) % 3) - 1;
+
+        nbin = pf_hashgrid_find_bin(self, nkey);
+        if (nbin == NULL || nbin->cluster >= 0) {
+          continue;
+        }
+
+        // Label this bin and visit its neighbours later.  Every bin is
+        // pushed at most once, so the stack cannot overflow.
+        nbin->cluster = bin->cluster;
+        assert(stack_count < self->bin_max_count);
+        self->stack[stack_count++] = nbin - self->bins;
+      }
+    }
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Compute the key for a pose
+void pf_hashgrid_key(pf_hashgrid_t * self, pf_vector_t pose, int key[])
+{
+  key[0] = floor(pose.v[0] / self->size[0]);
+  key[1] = floor(pose.v[1] / self->size[1]);
+  key[2] = floor(pose.v[2] / self->size[2]);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Find the slot holding the given key, or the empty slot where it belongs,
+// with linear probing
+int pf_hashgrid_find_slot(pf_hashgrid_t * self, int key[])
+{
+  uint32_t hash;
+  int slot, index;
+  pf_hashgrid_bin_t * bin;
+
+  hash = (uint32_t) key[0] * 0x9e3779b1u;
+  hash ^= (uint32_t) key[1] * 0x85ebca77u;
+  hash ^= (uint32_t) key[2] * 0xc2b2ae3du;
+  hash ^= hash >> 15;
+
+  slot = hash & self->slot_mask;
+  for (;; ) {
+    index = self->slots[slot];
+    if (index >= self->bin_count || self->bins[index].slot != slot) {
+      return slot;
+    }
+    bin = self->bins + index;
+    if (bin->key[0] == key[0] && bin->key[1] == key[1] && bin->key[2] == key[2]) {
+      return slot;
+    }
+    slot = (slot + 1) & self->slot_mask;
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Find the bin with the given key
+pf_hashgrid_bin_t * pf_hashgrid_find_bin(pf_hashgrid_t * self, int key[])
+{
+  int slot, index;
+
+  slot = pf_hashgrid_find_slot(self, key);
+  index = self->slots[slot];
+  if (index >= self->bin_count || self->bins[index].slot != slot) {
+    return NULL;
+  }
+  return self->bins + index;
+}
@@ -0,0 +1,169 @@
+/*
+ *  Player - One Hell of a Robot Server
+ *  Copyright (C) 2000  Brian Gerkey   &  Kasper Stoy
+ *                      gerkey@usc.edu    kaspers@robotics.usc.edu
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/**************************************************************************
+ * Desc: Seedable random number generation for the particle filter.
+ *       Uniform bits come from xoshiro256** (Blackman and Vigna); Gaussian
+ *       samples use the Ziggurat method in the form given by Doornik,
+ *       "An Improved Ziggurat Method to Generate Normal Random Samples".
+ *************************************************************************/
+
+#include <math.h>
+
+#include "nav2_amcl/pf/pf_random.hpp"
+
+
+// Right edge of the base layer and the area of each layer, for 128 layers
+#define PF_RNG_ZIGGURAT_R 3.442619855899
+#define PF_RNG_ZIGGURAT_V 9.91256303526217e-3
+
+
+static uint64_t pf_rng_rotl(uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+
+// Used to expand the seed into the full state
+static uint64_t pf_rng_splitmix64(uint64_t * x)
+{
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+
+// Advance every lane and refill the output buffer
+static void pf_rng_refill(pf_rng_t * rng)
+{
+  int i, lane;
+  uint64_t t;
+
+  for (i = 0; i < PF_RNG_BUFFER_SIZE; i += PF_RNG_LANES) {
+    for (lane = 0; lane < PF_RNG_LANES; lane++) {
+      rng->buffer[i + lane] = pf_rng_rotl(rng->s[1][lane] * 5, 7) * 9;
+
+      t = rng->s[1][lane] << 17;
+      rng->s[2][lane] ^= rng->s[0][lane];
+      rng->s[3][lane] ^= rng->s[1][lane];
+      rng->s[1][lane] ^= rng->s[2][lane];
+      rng->s[0][lane] ^= rng->s[3][lane];
+      rng->s[2][lane] ^= t;
+      rng->s[3][lane] = pf_rng_rotl(rng->s[3][lane], 45);
+    }
+  }
+  rng->buffer_pos = 0;
+}
+
+
+void pf_rng_seed(pf_rng_t * rng, uint64_t seed)
+{
+  int i, lane;
+  double f;
+
+  for (lane = 0; lane < PF_RNG_LANES; lane++) {
+    for (i = 0; i < 4; i++) {
+      rng->s[i][lane] = pf_rng_splitmix64(&seed);
+    }
+  }
+  rng->buffer_pos = PF_RNG_BUFFER_SIZE;
+
+  // Layer edges: zig_x[0] is the width of a rectangle with the base layer's
+  // area, and the remaining layers have equal area
+  f = exp(-0.5 * PF_RNG_ZIGGURAT_R * PF_RNG_ZIGGURAT_R);
+  rng->zig_x[0] = PF_RNG_ZIGGURAT_V / f;
+  rng->zig_x[1] = PF_RNG_ZIGGURAT_R;
+  for (i = 2; i < PF_RNG_ZIGGURAT_LAYERS; i++) {
+    rng->zig_x[i] = sqrt(-2.0 * log(PF_RNG_ZIGGURAT_V / rng->zig_x[i - 1] + f));
+    f = exp(-0.5 * rng->zig_x[i] * rng->zig_x[i]);
+  }
+  rng->zig_x[PF_RNG_ZIGGURAT_LAYERS] = 0.0;
+
+  for (i = 0; i < PF_RNG_ZIGGURAT_LAYERS; i++) {
+    rng->zig_r[i] = rng->zig_x[i + 1] / rng->zig_x[i];
+  }
+}
+
+
+uint64_t pf_rng_next(pf_rng_t * rng)
+{
+  if (rng->buffer_pos == PF_RNG_BUFFER_SIZE) {
+    pf_rng_refill(rng);
+  }
+  return rng->buffer[rng->buffer_pos++];
+}
+
+
+double pf_rng_uniform(pf_rng_t * rng)
+{
+  return (pf_rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+// Sample from the tail beyond the base layer
+static double pf_rng_gaussian_tail(pf_rng_t * rng, int negative)
+{
+  double x, y;
+
+  do {
+    x = -log(1.0 - pf_rng_uniform(rng)) / PF_RNG_ZIGGURAT_R;
+    y = -log(1.0 - pf_rng_uniform(rng));
+  } while (y + y < x * x);
+
+  return negative ? -(PF_RNG_ZIGGURAT_R + x) : PF_RNG_ZIGGURAT_R + x;
+}
+
+
+void pf_rng_gaussian(pf_rng_t * rng, double * out, int count)
+{
+  int n, layer;
+  uint64_t bits;
+  double u, x, f0, f1;
+
+  for (n = 0; n < count; n++) {
+    for (;; ) {
+      // The low bits pick the layer and the top 53 give a uniform in (-1, 1)
+      bits = pf_rng_next(rng);
+      layer = bits & (PF_RNG_ZIGGURAT_LAYERS - 1);
+      u = 2.0 * ((bits >> 11) * (1.0 / 9007199254740992.0)) - 1.0;
+
+      // Inside the rectangle covered by the next layer up; the common case
+      if (fabs(u) < rng->zig_r[layer]) {
+        x = u * rng->zig_x[layer];
+        break;
+      }
+
+      if (layer == 0) {
+        x = pf_rng_gaussian_tail(rng, u < 0.0);
+        break;
+      }
+
+      // In the wedge between this layer and the next; accept under the curve
+      x = u * rng->zig_x[layer];
+      f0 = exp(-0.5 * (rng->zig_x[layer] * rng->zig_x[layer] - x * x));
+      f1 = exp(-0.5 * (rng->zig_x[layer + 1] * rng->zig_x[layer + 1] - x * x));
+      if (f1 + pf_rng_uniform(rng) * (f0 - f1) < 1.0) {
+        break;
+      }
+    }
+    out[n] = x;
+  }
+}
@@ -0,0 +1,180 @@
+/*
+ *  Player - One Hell of a Robot Server
+ *  Copyright (C) 2000  Brian Gerkey   &  Kasper Stoy
+ *                      gerkey@usc.edu    kaspers@robotics.usc.edu
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/**************************************************************************
+ * Desc: Fixed-size worker pool for the particle filter
+ *************************************************************************/
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "nav2_amcl/pf/pf_thread_pool.hpp"
+
+
+struct _pf_thread_pool_t
+{
+  // Worker threads; the thread calling pf_thread_pool_run is not included
+  int worker_count;
+  pthread_t * workers;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t work_cond;
+  pthread_cond_t done_cond;
+
+  // The batch of jobs currently being run
+  pf_job_fn_t job_fn;
+  void * job_data;
+  int job_count;
+
+  // Next job to hand out, and number of jobs not yet finished
+  int next_job;
+  int pending;
+
+  int shutdown;
+};
+
+
+// Take and run jobs until there are none left.  Must be called with the mutex
+// held; returns with the mutex held.
+static void pf_thread_pool_drain(pf_thread_pool_t * pool)
+{
+  int job;
+
+  while (pool->next_job < pool->job_count) {
+    job = pool->next_job++;
+    pthread_mutex_unlock(&pool->mutex);
+
+    (*pool->job_fn)(pool->job_data, job);
+
+    pthread_mutex_lock(&pool->mutex);
+    if (--pool->pending == 0) {
+      pthread_cond_signal(&pool->done_cond);
+    }
+  }
+}
+
+
+static void * pf_thread_pool_worker(void * arg)
+{
+  pf_thread_pool_t * pool = (pf_thread_pool_t *) arg;
+
+  pthread_mutex_lock(&pool->mutex);
+  for (;; ) {
+    while (!pool->shutdown && pool->next_job >= pool->job_count) {
+      pthread_cond_wait(&pool->work_cond, &pool->mutex);
+    }
+    if (pool->shutdown) {
+      break;
+    }
+    pf_thread_pool_drain(pool);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+
+  return NULL;
+}
+
+
+// Create a pool with num_threads threads in total
+pf_thread_pool_t * pf_thread_pool_alloc(int num_threads)
+{
+  int i;
+  pf_thread_pool_t * pool;
+
+  if (num_threads < 2) {
+    return NULL;
+  }
+
+  pool = calloc(1, sizeof(pf_thread_pool_t));
+  pool->workers = calloc(num_threads - 1, sizeof(pthread_t));
+
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->work_cond, NULL);
+  pthread_cond_init(&pool->done_cond, NULL);
+
+  for (i = 0; i < num_threads - 1; i++) {
+    if (pthread_create(pool->workers + i, NULL, pf_thread_pool_worker, pool) != 0) {
+      break;
+    }
+    pool->worker_count++;
+  }
+
+  if (pool->worker_count == 0) {
+    pf_thread_pool_free(pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+
+// Stop the workers and free the pool
+void pf_thread_pool_free(pf_thread_pool_t * pool)
+{
+  int i;
+
+  if (pool == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->mutex);
+  pool->shutdown = 1;
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->mutex);
+
+  for (i = 0; i < pool->worker_count; i++) {
+    pthread_join(pool->workers[i], NULL);
+  }
+
+  pthread_cond_destroy(&pool->done_cond);
+  pthread_cond_destroy(&pool->work_cond);
+  pthread_mutex_destroy(&pool->mutex);
+
+  free(pool->workers);
+  free(pool);
+}
+
+
+int pf_thread_pool_size(pf_thread_pool_t * pool)
+{
+  return pool->worker_count + 1;
+}
+
+
+// Run all jobs and wait for them to finish
+void pf_thread_pool_run(
+  pf_thread_pool_t * pool, pf_job_fn_t job_fn, void * job_data, int job_count)
+{
+  pthread_mutex_lock(&pool->mutex);
+
+  pool->job_fn = job_fn;
+  pool->job_data = job_data;
+  pool->job_count = job_count;
+  pool->next_job = 0;
+  pool->pending = job_count;
+  pthread_cond_broadcast(&pool->work_cond);
+
+  pf_thread_pool_drain(pool);
+
+  while (pool->pending > 0) {
+    pthread_cond_wait(&pool->done_cond, &pool->mutex);
+  }
+
+  pthread_mutex_unlock(&pool->mutex);
+}
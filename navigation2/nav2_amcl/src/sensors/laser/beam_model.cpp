@@ -39,6 +39,17 @@ BeamModel::BeamModel(
   z_max_ = z_max;
   lambda_short_ = lambda_short;
   chi_outlier_ = chi_outlier;
+
+  // Let map_calc_range skip over free space; the ranges are unchanged
+  map_update_range_skip(map);
+}
+
+void
+BeamModel::setShortModel(double z_short, double z_max, double lambda_short)
+{
+  z_short_ = z_short;
+  z_max_ = z_max;
+  lambda_short_ = lambda_short;
 }
 
 // Determine the probability for the given pose
@@ -52,7 +63,6 @@ BeamModel::sensorFunction(LaserData * data, pf_sample_set_t * set)
   double map_range;
   double obs_range, obs_bearing;
   double total_weight;
-  pf_sample_t * sample;
   pf_vector_t pose;
 
   self = reinterpret_cast<BeamModel *>(data->laser);
@@ -61,8 +71,7 @@ BeamModel::sensorFunction(LaserData * data, pf_sample_set_t * set)
 
   // Compute the sample weights
   for (j = 0; j < set->sample_count; j++) {
-    sample = set->samples + j;
-    pose = sample->pose;
+    pose = pf_sample_pose(set, j);
 
     // Take account of the laser pose relative to the robot
     pose = pf_vector_coord_add(self->laser_pose_, pose);
@@ -70,9 +79,14 @@ BeamModel::sensorFunction(LaserData * data, pf_sample_set_t * set)
     p = 1.0;
 
     step = (data->range_count - 1) / (self->max_beams_ - 1);
+
+    // Step size must be at least 1
+    if (step < 1) {
+      step = 1;
+    }
     for (i = 0; i < data->range_count; i += step) {
-      obs_range = data->ranges[i][0];
-      obs_bearing = data->ranges[i][1];
+      obs_range = data->ranges[i];
+      obs_bearing = data->bearings[i];
 
       // Compute the range according to the map
       map_range = map_calc_range(self->map_, pose.v[0], pose.v[1],
@@ -108,8 +122,8 @@ BeamModel::sensorFunction(LaserData * data, pf_sample_set_t * set)
       p += pz * pz * pz;
     }
 
-    sample->weight *= p;
-    total_weight += sample->weight;
+    set->weight[j] *= p;
+    total_weight += set->weight[j];
   }
 
   return total_weight;
@@ -121,7 +135,7 @@ BeamModel::sensorUpdate(pf_t * pf, LaserData * data)
   if (max_beams_ < 2) {
     return false;
   }
-  pf_update_sensor(pf, (pf_sensor_model_fn_t) sensorFunction, data);
+  pf_update_sensor_parallel(pf, (pf_sensor_model_fn_t) sensorFunction, data);
 
   return true;
 }
@@ -0,0 +1,101 @@
+/*
+ *  Player - One Hell of a Robot Server
+ *  Copyright (C) 2000  Brian Gerkey   &  Kasper Stoy
+ *                      gerkey@usc.edu    kaspers@robotics.usc.edu
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <math.h>
+#include <algorithm>
+
+#include "nav2_amcl/sensors/laser/beam_selector.hpp"
+
+namespace nav2_amcl
+{
+
+void
+BeamSelector::select(const LaserData & in, int max_beams, LaserData & out)
+{
+  int n = in.range_count;
+
+  // Score the valid beams by the range change to either neighbour; an invalid
+  // neighbour counts as a jump to max range
+  score_.assign(n, -1.0);
+  for (int i = 0; i < n; i++) {
+    double r = in.ranges[i];
+    if (!(r < in.range_max)) {
+      continue;
+    }
+    double score = 0.0;
+    for (int k = i - 1; k <= i + 1; k += 2) {
+      if (k < 0 || k >= n) {
+        continue;
+      }
+      double rk = in.ranges[k];
+      score += fabs((rk < in.range_max ? rk : in.range_max) - r);
+    }
+    score_[i] = score;
+  }
+
+  chosen_.assign(n, 0);
+  int chosen_count = 0;
+
+  // The best beam of each angular bin
+  int bin_count = std::max(1, max_beams / 2);
+  for (int b = 0; b < bin_count; b++) {
+    int best = -1;
+    for (int i = b * n / bin_count; i < (b + 1) * n / bin_count; i++) {
+      if (score_[i] >= 0.0 && (best < 0 || score_[i] > score_[best])) {
+        best = i;
+      }
+    }
+    if (best >= 0) {
+      chosen_[best] = 1;
+      chosen_count++;
+    }
+  }
+
+  // Then the highest scoring of the rest
+  candidates_.clear();
+  for (int i = 0; i < n; i++) {
+    if (score_[i] >= 0.0 && !chosen_[i]) {
+      candidates_.push_back(i);
+    }
+  }
+  int extra = std::min(static_cast<int>(candidates_.size()), std::max(0, max_beams - chosen_count));
+  std::partial_sort(candidates_.begin(), candidates_.begin() + extra, candidates_.end(),
+    [this](int a, int b) {return score_[a] > score_[b];});
+  for (int k = 0; k < extra; k++) {
+    chosen_[candidates_[k]] = 1;
+    chosen_count++;
+  }
+
+  out.laser = in.laser;
+  out.range_max = in.range_max;
+  out.range_count = chosen_count;
+  out.allocate(chosen_count);
+  int j = 0;
+  for (int i = 0; i < n; i++) {
+    if (chosen_[i]) {
+      out.ranges[j] = in.ranges[i];
+      out.bearings[j] = in.bearings[i];
+      j++;
+    }
+  }
+}
+
+}  // namespace nav2_amcl
@@ -20,6 +20,7 @@
  */
 
 #include <sys/types.h>
+#include <algorithm>
 #include <math.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -31,7 +32,7 @@ namespace nav2_amcl
 {
 
 Laser::Laser(size_t max_beams, map_t * map)
-: max_samples_(0), max_obs_(0), temp_obs_(NULL)
+: use_hit_prob_table_(false)
 {
   max_beams_ = max_beams;
   map_ = map;
@@ -39,36 +40,92 @@ Laser::Laser(size_t max_beams, map_t * map)
 
 Laser::~Laser()
 {
-  if (temp_obs_) {
-    for (int k = 0; k < max_samples_; k++) {
-      delete[] temp_obs_[k];
-    }
-    delete[] temp_obs_;
-  }
 }
 
 void
-Laser::reallocTempData(int new_max_samples, int new_max_obs)
+Laser::SetLaserPose(pf_vector_t & laser_pose)
 {
-  if (temp_obs_) {
-    for (int k = 0; k < max_samples_; k++) {
-      delete[] temp_obs_[k];
-    }
-    delete[] temp_obs_;
-  }
-  max_obs_ = new_max_obs;
-  max_samples_ = fmax(max_samples_, new_max_samples);
+  laser_pose_ = laser_pose;
+}
+
+pf_vector_t
+Laser::GetLaserPose() const
+{
+  return laser_pose_;
+}
+
+void
+Laser::enableHitProbTable()
+{
+  use_hit_prob_table_ = true;
+  updateHitProbTable();
+}
+
+void
+Laser::setHitModel(double z_hit, double z_rand, double sigma_hit)
+{
+  z_hit_ = z_hit;
+  z_rand_ = z_rand;
+  sigma_hit_ = sigma_hit;
+  updateHitProbTable();
+}
 
-  temp_obs_ = new double *[max_samples_]();
-  for (int k = 0; k < max_samples_; k++) {
-    temp_obs_[k] = new double[max_obs_]();
+bool
+Laser::updateHitProbTable()
+{
+  if (!use_hit_prob_table_) {
+    return false;
   }
+  // The map may be shared with lasers using another sigma, or its cspace may
+  // have been recomputed since the last update
+  map_update_hit_prob(map_, sigma_hit_);
+  return true;
 }
 
 void
-Laser::SetLaserPose(pf_vector_t & laser_pose)
+LaserData::allocate(int count)
 {
-  laser_pose_ = laser_pose;
+  own_ranges_.resize(std::max(count, 1));
+  own_bearings_.resize(std::max(count, 1));
+  ranges = own_ranges_.data();
+  bearings = own_bearings_.data();
+}
+
+void
+ScanBuffer::reserve(size_t count)
+{
+  ranges_.reserve(count);
+  bearings_.reserve(count);
+}
+
+void
+ScanBuffer::fill(
+  const std::vector<float> & scan_ranges, double range_min, double range_max,
+  double angle_min, double angle_increment, LaserData & data)
+{
+  size_t count = scan_ranges.size();
+  if (bearings_.size() != count || angle_min != angle_min_ ||
+    angle_increment != angle_increment_)
+  {
+    bearings_.resize(count);
+    for (size_t i = 0; i < count; i++) {
+      bearings_[i] = angle_min + i * angle_increment;
+    }
+    angle_min_ = angle_min;
+    angle_increment_ = angle_increment;
+  }
+
+  // amcl doesn't (yet) have a concept of min range.  So we'll map short
+  // readings to max range.
+  ranges_.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    ranges_[i] = scan_ranges[i] <= range_min ? range_max : scan_ranges[i];
+  }
+
+  data.range_count = count;
+  data.range_max = range_max;
+  data.ranges = ranges_.data();
+  data.bearings = bearings_.data();
 }
 
 }  // namespace nav2_amcl
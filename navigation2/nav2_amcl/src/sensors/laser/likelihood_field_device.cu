@@ -0,0 +1,302 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <cuda_runtime.h>
+
+#include "nav2_amcl/sensors/laser/likelihood_field_device.hpp"
+
+namespace nav2_amcl
+{
+
+namespace
+{
+
+// Threads per block of the weighing kernel, a power of two for the block reduction
+const int BLOCK_SIZE = 256;
+
+struct FieldParams
+{
+  double origin_x, origin_y;
+  double scale;
+  double half_x, half_y;  // size_x / 2, size_y / 2 (integer division)
+  double size_x, size_y;
+  float off_map;
+};
+
+inline bool ok(cudaError_t error)
+{
+  return error == cudaSuccess;
+}
+
+// Sum the values of a block in shared memory into values[0]
+__device__ void reduceBlock(double * values)
+{
+  for (int stride = blockDim.x / 2; stride > 0; stride >>= 1) {
+    __syncthreads();
+    if (threadIdx.x < stride) {
+      values[threadIdx.x] += values[threadIdx.x + stride];
+    }
+  }
+  __syncthreads();
+}
+
+// One thread per sample: weigh it, then sum the weights of the block into block_totals
+__global__ void weighSamples(
+  const double * x, const double * y, const double * theta, double * weight, int count,
+  const double * beam_x, const double * beam_y, int beam_count,
+  double laser_x, double laser_y, double laser_theta,
+  cudaTextureObject_t field, FieldParams f,
+  double z_hit, double z_rand, double z_hit_denom, double * block_totals)
+{
+  __shared__ double totals[BLOCK_SIZE];
+  int k = blockIdx.x * blockDim.x + threadIdx.x;
+  double new_weight = 0.0;
+  if (k < count) {
+    // The laser pose, as pf_vector_coord_add gives it
+    double c = cos(theta[k]);
+    double s = sin(theta[k]);
+    double px = x[k] + laser_x * c - laser_y * s;
+    double py = y[k] + laser_x * s + laser_y * c;
+    double pc = cos(theta[k] + laser_theta);
+    double ps = sin(theta[k] + laser_theta);
+
+    double p = 1.0;
+    for (int b = 0; b < beam_count; b++) {
+      double bx = __ldg(beam_x + b);
+      double by = __ldg(beam_y + b);
+      double hx = px + pc * bx - ps * by;
+      double hy = py + ps * bx + pc * by;
+
+      // Same arithmetic as MAP_GXWX/MAP_GYWY/MAP_VALID
+      double mi = floor((hx - f.origin_x) / f.scale + 0.5) + f.half_x;
+      double mj = floor((hy - f.origin_y) / f.scale + 0.5) + f.half_y;
+      double z = f.off_map;
+      if (mi >= 0 && mi < f.size_x && mj >= 0 && mj < f.size_y) {
+        z = tex2D<float>(field, static_cast<float>(mi) + 0.5f, static_cast<float>(mj) + 0.5f);
+      }
+      double pz = z_hit * exp(-(z * z) / z_hit_denom) + z_rand;
+      p += pz * pz * pz;
+    }
+    new_weight = weight[k] * p;
+    weight[k] = new_weight;
+  }
+
+  totals[threadIdx.x] = new_weight;
+  reduceBlock(totals);
+  if (threadIdx.x == 0) {
+    block_totals[blockIdx.x] = totals[0];
+  }
+}
+
+// A single block summing the block totals, in a fixed order for the same total every time
+__global__ void sumTotals(const double * block_totals, int blocks, double * total)
+{
+  __shared__ double totals[BLOCK_SIZE];
+  double sum = 0.0;
+  for (int b = threadIdx.x; b < blocks; b += blockDim.x) {
+    sum += block_totals[b];
+  }
+  totals[threadIdx.x] = sum;
+  reduceBlock(totals);
+  if (threadIdx.x == 0) {
+    *total = totals[0];
+  }
+}
+
+// Reallocate a device array for count elements, dropping its contents
+template<typename T>
+bool reallocate(T ** array, int count)
+{
+  cudaFree(*array);
+  *array = nullptr;
+  return ok(cudaMalloc(array, count * sizeof(T)));
+}
+
+}  // namespace
+
+struct LikelihoodFieldDevice::Buffers
+{
+  cudaArray_t field_array{nullptr};
+  cudaTextureObject_t field{0};
+  FieldParams params;
+
+  // The samples and beams of an update, grown as they need to be
+  double * x{nullptr};
+  double * y{nullptr};
+  double * theta{nullptr};
+  double * weight{nullptr};
+  int sample_capacity{0};
+
+  double * beam_x{nullptr};
+  double * beam_y{nullptr};
+  int beam_capacity{0};
+
+  double * block_totals{nullptr};
+  int block_capacity{0};
+  double * total{nullptr};
+
+  void releaseField()
+  {
+    if (field) {
+      cudaDestroyTextureObject(field);
+      field = 0;
+    }
+    cudaFreeArray(field_array);
+    field_array = nullptr;
+  }
+};
+
+bool
+LikelihoodFieldDevice::available()
+{
+  int devices = 0;
+  return ok(cudaGetDeviceCount(&devices)) && devices > 0;
+}
+
+LikelihoodFieldDevice::LikelihoodFieldDevice()
+: buffers_(new Buffers)
+{
+}
+
+LikelihoodFieldDevice::~LikelihoodFieldDevice()
+{
+  buffers_->releaseField();
+  cudaFree(buffers_->x);
+  cudaFree(buffers_->y);
+  cudaFree(buffers_->theta);
+  cudaFree(buffers_->weight);
+  cudaFree(buffers_->beam_x);
+  cudaFree(buffers_->beam_y);
+  cudaFree(buffers_->block_totals);
+  cudaFree(buffers_->total);
+  delete buffers_;
+}
+
+bool
+LikelihoodFieldDevice::uploadMap(const float * occ_dist, const DeviceMapGeometry & geometry)
+{
+  Buffers & d = *buffers_;
+  d.releaseField();
+
+  cudaChannelFormatDesc format = cudaCreateChannelDesc<float>();
+  if (!ok(cudaMallocArray(&d.field_array, &format, geometry.size_x, geometry.size_y)) ||
+    !ok(cudaMemcpy2DToArray(d.field_array, 0, 0, occ_dist, geometry.size_x * sizeof(float),
+    geometry.size_x * sizeof(float), geometry.size_y, cudaMemcpyHostToDevice)))
+  {
+    return false;
+  }
+
+  // Cells are read whole at their centers, in cell coordinates
+  cudaResourceDesc resource = {};
+  resource.resType = cudaResourceTypeArray;
+  resource.res.array.array = d.field_array;
+  cudaTextureDesc texture = {};
+  texture.addressMode[0] = cudaAddressModeClamp;
+  texture.addressMode[1] = cudaAddressModeClamp;
+  texture.filterMode = cudaFilterModePoint;
+  texture.readMode = cudaReadModeElementType;
+  texture.normalizedCoords = 0;
+  if (!ok(cudaCreateTextureObject(&d.field, &resource, &texture, nullptr))) {
+    return false;
+  }
+
+  d.params.origin_x = geometry.origin_x;
+  d.params.origin_y = geometry.origin_y;
+  d.params.scale = geometry.scale;
+  d.params.half_x = geometry.size_x / 2;
+  d.params.half_y = geometry.size_y / 2;
+  d.params.size_x = geometry.size_x;
+  d.params.size_y = geometry.size_y;
+  d.params.off_map = geometry.off_map;
+  return true;
+}
+
+bool
+LikelihoodFieldDevice::weigh(
+  const double * x, const double * y, const double * theta, double * weight, int count,
+  const double * beam_x, const double * beam_y, int beam_count, const double laser_pose[3],
+  double z_hit, double z_rand, double z_hit_denom, double * total)
+{
+  Buffers & d = *buffers_;
+  if (!d.field) {
+    return false;
+  }
+  if (count == 0) {
+    *total = 0.0;
+    return true;
+  }
+  int blocks = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  size_t sample_bytes = count * sizeof(double);
+  size_t beam_bytes = beam_count * sizeof(double);
+
+  if (count > d.sample_capacity) {
+    d.sample_capacity = 0;
+    if (!reallocate(&d.x, count) || !reallocate(&d.y, count) ||
+      !reallocate(&d.theta, count) || !reallocate(&d.weight, count))
+    {
+      return false;
+    }
+    d.sample_capacity = count;
+  }
+  if (beam_count > d.beam_capacity) {
+    d.beam_capacity = 0;
+    if (!reallocate(&d.beam_x, beam_count) || !reallocate(&d.beam_y, beam_count)) {
+      return false;
+    }
+    d.beam_capacity = beam_count;
+  }
+  if (blocks > d.block_capacity) {
+    d.block_capacity = 0;
+    if (!reallocate(&d.block_totals, blocks)) {
+      return false;
+    }
+    d.block_capacity = blocks;
+  }
+  if (!d.total && !ok(cudaMalloc(&d.total, sizeof(double)))) {
+    return false;
+  }
+
+  if (!ok(cudaMemcpy(d.x, x, sample_bytes, cudaMemcpyHostToDevice)) ||
+    !ok(cudaMemcpy(d.y, y, sample_bytes, cudaMemcpyHostToDevice)) ||
+    !ok(cudaMemcpy(d.theta, theta, sample_bytes, cudaMemcpyHostToDevice)) ||
+    !ok(cudaMemcpy(d.weight, weight, sample_bytes, cudaMemcpyHostToDevice)) ||
+    (beam_count > 0 &&
+    (!ok(cudaMemcpy(d.beam_x, beam_x, beam_bytes, cudaMemcpyHostToDevice)) ||
+    !ok(cudaMemcpy(d.beam_y, beam_y, beam_bytes, cudaMemcpyHostToDevice)))))
+  {
+    return false;
+  }
+
+  weighSamples<<<blocks, BLOCK_SIZE>>>(d.x, d.y, d.theta, d.weight, count,
+    d.beam_x, d.beam_y, beam_count, laser_pose[0], laser_pose[1], laser_pose[2],
+    d.field, d.params, z_hit, z_rand, z_hit_denom, d.block_totals);
+  sumTotals<<<1, BLOCK_SIZE>>>(d.block_totals, blocks, d.total);
+  if (!ok(cudaGetLastError())) {
+    return false;
+  }
+
+  // The copies wait for the kernels, and the weights are only written once both succeed
+  double device_total;
+  if (!ok(cudaMemcpy(&device_total, d.total, sizeof(double), cudaMemcpyDeviceToHost)) ||
+    !ok(cudaMemcpy(weight, d.weight, sample_bytes, cudaMemcpyDeviceToHost)))
+  {
+    return false;
+  }
+  *total = device_total;
+  return true;
+}
+
+}  // namespace nav2_amcl
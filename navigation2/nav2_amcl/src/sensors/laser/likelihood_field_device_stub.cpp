@@ -0,0 +1,53 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// LikelihoodFieldDevice without CUDA: never available, so the GPU model stays on the CPU
+
+#include "nav2_amcl/sensors/laser/likelihood_field_device.hpp"
+
+namespace nav2_amcl
+{
+
+bool
+LikelihoodFieldDevice::available()
+{
+  return false;
+}
+
+LikelihoodFieldDevice::LikelihoodFieldDevice()
+: buffers_(nullptr)
+{
+}
+
+LikelihoodFieldDevice::~LikelihoodFieldDevice()
+{
+}
+
+bool
+LikelihoodFieldDevice::uploadMap(const float *, const DeviceMapGeometry &)
+{
+  return false;
+}
+
+bool
+LikelihoodFieldDevice::weigh(
+  const double *, const double *, const double *, double *, int,
+  const double *, const double *, int, const double[3], double, double, double, double *)
+{
+  return false;
+}
+
+}  // namespace nav2_amcl
@@ -47,7 +47,6 @@ LikelihoodFieldModel::sensorFunction(LaserData * data, pf_sample_set_t * set)
   double p;
   double obs_range, obs_bearing;
   double total_weight;
-  pf_sample_t * sample;
   pf_vector_t pose;
   pf_vector_t hit;
 
@@ -55,10 +54,12 @@ LikelihoodFieldModel::sensorFunction(LaserData * data, pf_sample_set_t * set)
 
   total_weight = 0.0;
 
+  double max_dist_prob = exp(-(self->map_->max_occ_dist * self->map_->max_occ_dist) /
+      (2 * self->sigma_hit_ * self->sigma_hit_));
+
   // Compute the sample weights
   for (j = 0; j < set->sample_count; j++) {
-    sample = set->samples + j;
-    pose = sample->pose;
+    pose = pf_sample_pose(set, j);
 
     // Take account of the laser pose relative to the robot
     pose = pf_vector_coord_add(self->laser_pose_, pose);
@@ -77,8 +78,8 @@ LikelihoodFieldModel::sensorFunction(LaserData * data, pf_sample_set_t * set)
     }
 
     for (i = 0; i < data->range_count; i += step) {
-      obs_range = data->ranges[i][0];
-      obs_bearing = data->ranges[i][1];
+      obs_range = data->ranges[i];
+      obs_bearing = data->bearings[i];
 
       // This model ignores max range readings
       if (obs_range >= data->range_max) {
@@ -103,14 +104,23 @@ LikelihoodFieldModel::sensorFunction(LaserData * data, pf_sample_set_t * set)
 
       // Part 1: Get distance from the hit to closest obstacle.
       // Off-map penalized as max distance
-      if (!MAP_VALID(self->map_, mi, mj)) {
-        z = self->map_->max_occ_dist;
+      if (self->use_hit_prob_table_) {
+        // Gaussian model, precomputed per cell
+        if (!MAP_VALID(self->map_, mi, mj)) {
+          pz += self->z_hit_ * max_dist_prob;
+        } else {
+          pz += self->z_hit_ * self->map_->hit_prob[MAP_INDEX(self->map_, mi, mj)];
+        }
       } else {
-        z = self->map_->cells[MAP_INDEX(self->map_, mi, mj)].occ_dist;
+        if (!MAP_VALID(self->map_, mi, mj)) {
+          z = self->map_->max_occ_dist;
+        } else {
+          z = map_occ_dist(self->map_, MAP_INDEX(self->map_, mi, mj));
+        }
+        // Gaussian model
+        // NOTE: this should have a normalization of 1/(sqrt(2pi)*sigma)
+        pz += self->z_hit_ * exp(-(z * z) / z_hit_denom);
       }
-      // Gaussian model
-      // NOTE: this should have a normalization of 1/(sqrt(2pi)*sigma)
-      pz += self->z_hit_ * exp(-(z * z) / z_hit_denom);
       // Part 2: random measurements
       pz += self->z_rand_ * z_rand_mult;
 
@@ -124,8 +134,8 @@ LikelihoodFieldModel::sensorFunction(LaserData * data, pf_sample_set_t * set)
       p += pz * pz * pz;
     }
 
-    sample->weight *= p;
-    total_weight += sample->weight;
+    set->weight[j] *= p;
+    total_weight += set->weight[j];
   }
 
   return total_weight;
@@ -138,7 +148,8 @@ LikelihoodFieldModel::sensorUpdate(pf_t * pf, LaserData * data)
   if (max_beams_ < 2) {
     return false;
   }
-  pf_update_sensor(pf, (pf_sensor_model_fn_t) sensorFunction, data);
+  updateHitProbTable();
+  pf_update_sensor_parallel(pf, (pf_sensor_model_fn_t) sensorFunction, data);
 
   return true;
 }
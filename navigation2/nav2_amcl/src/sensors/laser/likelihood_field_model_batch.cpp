@@ -0,0 +1,419 @@
+/*
+ *  Player - One Hell of a Robot Server
+ *  Copyright (C) 2000  Brian Gerkey   &  Kasper Stoy
+ *                      gerkey@usc.edu    kaspers@robotics.usc.edu
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <math.h>
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+
+#include "nav2_amcl/sensors/laser/laser.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define AMCL_HAVE_AVX2_DISPATCH 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define AMCL_HAVE_NEON 1
+#endif
+
+namespace nav2_amcl
+{
+
+namespace
+{
+
+// Everything the gather kernels need to know about the map, hoisted out of the
+// per-beam loop
+struct GatherParams
+{
+  const double * occ_dist;  // &cells[0].occ_dist
+  int stride;               // cell stride in doubles
+  const uint16_t * occ_dist_fixed;  // compact layout occ_dist plane instead, if set
+  double occ_dist_res;
+  const float * hit_prob;   // gather from the hit probability table instead, if set
+  double origin_x, origin_y;
+  double scale;
+  double half_x, half_y;    // size_x / 2, size_y / 2 (integer division)
+  double size_x, size_y;
+  int width;                // size_x
+  int tile_shift, tiles_x;
+  double off_map;           // value reported for endpoints outside the map
+};
+
+// Same as MAP_INDEX
+inline int
+cellIndex(const GatherParams & g, int i, int j)
+{
+  if (g.tile_shift == 0) {
+    return i + j * g.width;
+  }
+  int mask = (1 << g.tile_shift) - 1;
+  return (((j >> g.tile_shift) * g.tiles_x + (i >> g.tile_shift)) << (2 * g.tile_shift)) +
+         ((j & mask) << g.tile_shift) + (i & mask);
+}
+
+inline double
+lookup(const GatherParams & g, int index)
+{
+  if (g.hit_prob) {
+    return g.hit_prob[index];
+  }
+  if (g.occ_dist_fixed) {
+    return g.occ_dist_fixed[index] * g.occ_dist_res;
+  }
+  return g.occ_dist[static_cast<ptrdiff_t>(index) * g.stride];
+}
+
+inline double
+gatherOne(const GatherParams & g, double hx, double hy)
+{
+  // Same arithmetic as MAP_GXWX/MAP_GYWY/MAP_VALID/MAP_INDEX
+  double mi = floor((hx - g.origin_x) / g.scale + 0.5) + g.half_x;
+  double mj = floor((hy - g.origin_y) / g.scale + 0.5) + g.half_y;
+  if (!(mi >= 0 && mi < g.size_x && mj >= 0 && mj < g.size_y)) {
+    return g.off_map;
+  }
+  return lookup(g, cellIndex(g, static_cast<int>(mi), static_cast<int>(mj)));
+}
+
+void
+gatherScalar(
+  const GatherParams & g, double bx, double by, int begin, int count,
+  const double * px, const double * py, const double * pc, const double * ps, double * z)
+{
+  for (int k = begin; k < count; k++) {
+    double hx = px[k] + pc[k] * bx - ps[k] * by;
+    double hy = py[k] + ps[k] * bx + pc[k] * by;
+    z[k] = gatherOne(g, hx, hy);
+  }
+}
+
+#if AMCL_HAVE_AVX2_DISPATCH
+// Compiled for AVX2 regardless of the global flags, only called after a
+// runtime CPU check
+__attribute__((target("avx2,fma")))
+int
+gatherAVX2(
+  const GatherParams & g, double bx, double by, int count,
+  const double * px, const double * py, const double * pc, const double * ps, double * z)
+{
+  const __m256d vbx = _mm256_set1_pd(bx);
+  const __m256d vby = _mm256_set1_pd(by);
+  const __m256d vox = _mm256_set1_pd(g.origin_x);
+  const __m256d voy = _mm256_set1_pd(g.origin_y);
+  const __m256d vscale = _mm256_set1_pd(g.scale);
+  const __m256d vhalf = _mm256_set1_pd(0.5);
+  const __m256d vhx = _mm256_set1_pd(g.half_x);
+  const __m256d vhy = _mm256_set1_pd(g.half_y);
+  const __m256d vsx = _mm256_set1_pd(g.size_x);
+  const __m256d vsy = _mm256_set1_pd(g.size_y);
+  const __m256d vzero = _mm256_setzero_pd();
+  const __m256d voff = _mm256_set1_pd(g.off_map);
+  const __m128 voff_ps = _mm_set1_ps(static_cast<float>(g.off_map));
+  // Picks the low 32 bits of each 64-bit lane, to narrow the validity mask
+  const __m256i vnarrow = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  const __m256d vres = _mm256_set1_pd(g.occ_dist_res);
+  const __m128i vsize_x = _mm_set1_epi32(g.width);
+  const __m128i vstride = _mm_set1_epi32(g.stride);
+  const __m128i vtiles_x = _mm_set1_epi32(g.tiles_x);
+  const __m128i vtile_shift = _mm_cvtsi32_si128(g.tile_shift);
+  const __m128i vtile_shift2 = _mm_cvtsi32_si128(2 * g.tile_shift);
+  const __m128i vtile_mask = _mm_set1_epi32((1 << g.tile_shift) - 1);
+  const __m128i vlow16 = _mm_set1_epi32(0xffff);
+
+  int k = 0;
+  for (; k + 4 <= count; k += 4) {
+    __m256d c = _mm256_loadu_pd(pc + k);
+    __m256d s = _mm256_loadu_pd(ps + k);
+    // hx = px + c * bx - s * by, hy = py + s * bx + c * by
+    __m256d hx = _mm256_fnmadd_pd(s, vby, _mm256_fmadd_pd(c, vbx, _mm256_loadu_pd(px + k)));
+    __m256d hy = _mm256_fmadd_pd(c, vby, _mm256_fmadd_pd(s, vbx, _mm256_loadu_pd(py + k)));
+
+    __m256d mi = _mm256_add_pd(
+      _mm256_floor_pd(_mm256_add_pd(_mm256_div_pd(_mm256_sub_pd(hx, vox), vscale), vhalf)), vhx);
+    __m256d mj = _mm256_add_pd(
+      _mm256_floor_pd(_mm256_add_pd(_mm256_div_pd(_mm256_sub_pd(hy, voy), vscale), vhalf)), vhy);
+
+    __m256d valid = _mm256_and_pd(
+      _mm256_and_pd(_mm256_cmp_pd(mi, vzero, _CMP_GE_OQ), _mm256_cmp_pd(mi, vsx, _CMP_LT_OQ)),
+      _mm256_and_pd(_mm256_cmp_pd(mj, vzero, _CMP_GE_OQ), _mm256_cmp_pd(mj, vsy, _CMP_LT_OQ)));
+
+    // Zero the coordinates of off-map lanes so the index math cannot overflow
+    mi = _mm256_and_pd(mi, valid);
+    mj = _mm256_and_pd(mj, valid);
+    __m128i ci = _mm256_cvttpd_epi32(mi);
+    __m128i cj = _mm256_cvttpd_epi32(mj);
+    __m128i index;
+    if (g.tile_shift == 0) {
+      index = _mm_add_epi32(ci, _mm_mullo_epi32(cj, vsize_x));
+    } else {
+      __m128i tile = _mm_add_epi32(
+        _mm_mullo_epi32(_mm_srl_epi32(cj, vtile_shift), vtiles_x), _mm_srl_epi32(ci, vtile_shift));
+      index = _mm_add_epi32(
+        _mm_add_epi32(_mm_sll_epi32(tile, vtile_shift2),
+        _mm_sll_epi32(_mm_and_si128(cj, vtile_mask), vtile_shift)),
+        _mm_and_si128(ci, vtile_mask));
+    }
+
+    __m256d value;
+    if (g.hit_prob || g.occ_dist_fixed) {
+      __m128i valid_epi32 = _mm256_castsi256_si128(
+        _mm256_permutevar8x32_epi32(_mm256_castpd_si256(valid), vnarrow));
+      if (g.hit_prob) {
+        value = _mm256_cvtps_pd(
+          _mm_mask_i32gather_ps(voff_ps, g.hit_prob, index, _mm_castsi128_ps(valid_epi32),
+          sizeof(float)));
+      } else {
+        // No 16-bit gather: fetch 32 bits at each uint16_t and keep the low half
+        // (the plane is padded by one element for the last cell)
+        __m128i raw = _mm_mask_i32gather_epi32(_mm_setzero_si128(),
+            reinterpret_cast<const int *>(g.occ_dist_fixed), index, valid_epi32, sizeof(uint16_t));
+        value = _mm256_blendv_pd(voff,
+            _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_and_si128(raw, vlow16)), vres), valid);
+      }
+    } else {
+      index = _mm_mullo_epi32(index, vstride);
+      value = _mm256_mask_i32gather_pd(voff, g.occ_dist, index, valid, sizeof(double));
+    }
+    _mm256_storeu_pd(z + k, value);
+  }
+  return k;
+}
+
+inline bool
+cpuHasAVX2()
+{
+  static const bool has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return has_avx2;
+}
+#endif
+
+#if AMCL_HAVE_NEON
+int
+gatherNEON(
+  const GatherParams & g, double bx, double by, int count,
+  const double * px, const double * py, const double * pc, const double * ps, double * z)
+{
+  const float64x2_t vbx = vdupq_n_f64(bx);
+  const float64x2_t vby = vdupq_n_f64(by);
+  const float64x2_t vox = vdupq_n_f64(g.origin_x);
+  const float64x2_t voy = vdupq_n_f64(g.origin_y);
+  const float64x2_t vscale = vdupq_n_f64(g.scale);
+  const float64x2_t vhalf = vdupq_n_f64(0.5);
+  const float64x2_t vhx = vdupq_n_f64(g.half_x);
+  const float64x2_t vhy = vdupq_n_f64(g.half_y);
+
+  int k = 0;
+  for (; k + 2 <= count; k += 2) {
+    float64x2_t c = vld1q_f64(pc + k);
+    float64x2_t s = vld1q_f64(ps + k);
+    float64x2_t hx = vfmsq_f64(vfmaq_f64(vld1q_f64(px + k), c, vbx), s, vby);
+    float64x2_t hy = vfmaq_f64(vfmaq_f64(vld1q_f64(py + k), s, vbx), c, vby);
+
+    float64x2_t mi = vaddq_f64(
+      vrndmq_f64(vaddq_f64(vdivq_f64(vsubq_f64(hx, vox), vscale), vhalf)), vhx);
+    float64x2_t mj = vaddq_f64(
+      vrndmq_f64(vaddq_f64(vdivq_f64(vsubq_f64(hy, voy), vscale), vhalf)), vhy);
+
+    // NEON has no gather; the lookups themselves stay scalar
+    double cell_i[2], cell_j[2];
+    vst1q_f64(cell_i, mi);
+    vst1q_f64(cell_j, mj);
+    for (int l = 0; l < 2; l++) {
+      if (cell_i[l] >= 0 && cell_i[l] < g.size_x && cell_j[l] >= 0 && cell_j[l] < g.size_y) {
+        z[k + l] = lookup(g,
+            cellIndex(g, static_cast<int>(cell_i[l]), static_cast<int>(cell_j[l])));
+      } else {
+        z[k + l] = g.off_map;
+      }
+    }
+  }
+  return k;
+}
+#endif
+
+}  // namespace
+
+LikelihoodFieldModelBatch::LikelihoodFieldModelBatch(
+  double z_hit, double z_rand, double sigma_hit,
+  double max_occ_dist, size_t max_beams, map_t * map)
+: Laser(max_beams, map)
+{
+  z_hit_ = z_hit;
+  z_rand_ = z_rand;
+  sigma_hit_ = sigma_hit;
+  map_update_cspace(map, max_occ_dist);
+}
+
+// Keep the beams the scalar model would have used, as endpoints in the laser frame
+void
+LikelihoodFieldModelBatch::precomputeBeams(LaserData * data)
+{
+  beam_x_.clear();
+  beam_y_.clear();
+
+  int step = (data->range_count - 1) / (max_beams_ - 1);
+
+  // Step size must be at least 1
+  if (step < 1) {
+    step = 1;
+  }
+
+  for (int i = 0; i < data->range_count; i += step) {
+    double obs_range = data->ranges[i];
+    double obs_bearing = data->bearings[i];
+
+    // This model ignores max range readings
+    if (obs_range >= data->range_max) {
+      continue;
+    }
+
+    // Check for NaN
+    if (obs_range != obs_range) {
+      continue;
+    }
+
+    beam_x_.push_back(obs_range * cos(obs_bearing));
+    beam_y_.push_back(obs_range * sin(obs_bearing));
+  }
+}
+
+// Fill batch.z with the obstacle distance (or, with the table enabled, the hit
+// probability) under one beam endpoint for every particle in the batch
+void
+LikelihoodFieldModelBatch::gatherOccDist(
+  double beam_x, double beam_y, int count, Batch & batch) const
+{
+  static_assert(sizeof(map_cell_t) % sizeof(double) == 0,
+    "map_cell_t must be a whole number of doubles for the strided gather");
+
+  GatherParams g;
+  g.occ_dist = map_->cells ? &map_->cells[0].occ_dist : NULL;
+  g.stride = sizeof(map_cell_t) / sizeof(double);
+  g.occ_dist_fixed = map_->occ_dist_plane;
+  g.occ_dist_res = map_->occ_dist_res;
+  g.hit_prob = use_hit_prob_table_ ? map_->hit_prob : NULL;
+  g.origin_x = map_->origin_x;
+  g.origin_y = map_->origin_y;
+  g.scale = map_->scale;
+  g.half_x = map_->size_x / 2;
+  g.half_y = map_->size_y / 2;
+  g.size_x = map_->size_x;
+  g.size_y = map_->size_y;
+  g.width = map_->size_x;
+  g.tile_shift = map_->tile_shift;
+  g.tiles_x = map_->tiles_x;
+  g.off_map = map_->max_occ_dist;
+  if (g.hit_prob) {
+    g.off_map = exp(-(g.off_map * g.off_map) / (2 * sigma_hit_ * sigma_hit_));
+  }
+
+  int done = 0;
+#if AMCL_HAVE_AVX2_DISPATCH
+  if (cpuHasAVX2()) {
+    done = gatherAVX2(g, beam_x, beam_y, count,
+        batch.x, batch.y, batch.cos, batch.sin, batch.z);
+  }
+#elif AMCL_HAVE_NEON
+  done = gatherNEON(g, beam_x, beam_y, count,
+      batch.x, batch.y, batch.cos, batch.sin, batch.z);
+#endif
+  gatherScalar(g, beam_x, beam_y, done, count,
+    batch.x, batch.y, batch.cos, batch.sin, batch.z);
+}
+
+double
+LikelihoodFieldModelBatch::sensorFunction(LaserData * data, pf_sample_set_t * set)
+{
+  LikelihoodFieldModelBatch * self;
+  double total_weight;
+  double p[BATCH_SIZE];
+  Batch batch;
+
+  self = reinterpret_cast<LikelihoodFieldModelBatch *>(data->laser);
+
+  total_weight = 0.0;
+
+  // Pre-compute a couple of things
+  double z_hit_denom = 2 * self->sigma_hit_ * self->sigma_hit_;
+  double z_rand = self->z_rand_ / data->range_max;
+
+  const int beam_count = static_cast<int>(self->beam_x_.size());
+
+  for (int first = 0; first < set->sample_count; first += BATCH_SIZE) {
+    int count = std::min(static_cast<int>(BATCH_SIZE), set->sample_count - first);
+
+    // Take account of the laser pose relative to the robot, once per particle
+    for (int k = 0; k < count; k++) {
+      pf_vector_t pose = pf_vector_coord_add(self->laser_pose_, pf_sample_pose(set, first + k));
+      batch.x[k] = pose.v[0];
+      batch.y[k] = pose.v[1];
+      batch.cos[k] = cos(pose.v[2]);
+      batch.sin[k] = sin(pose.v[2]);
+      p[k] = 1.0;
+    }
+
+    for (int b = 0; b < beam_count; b++) {
+      self->gatherOccDist(self->beam_x_[b], self->beam_y_[b], count, batch);
+
+      for (int k = 0; k < count; k++) {
+        // Gaussian model plus random measurements
+        double pz;
+        if (self->use_hit_prob_table_) {
+          pz = self->z_hit_ * batch.z[k] + z_rand;
+        } else {
+          double z = batch.z[k];
+          pz = self->z_hit_ * exp(-(z * z) / z_hit_denom) + z_rand;
+        }
+
+        assert(pz <= 1.0);
+        assert(pz >= 0.0);
+        // Same ad-hoc combination of beam probabilities as LikelihoodFieldModel
+        p[k] += pz * pz * pz;
+      }
+    }
+
+    double * weight = set->weight + first;
+    for (int k = 0; k < count; k++) {
+      weight[k] *= p[k];
+      total_weight += weight[k];
+    }
+  }
+
+  return total_weight;
+}
+
+bool
+LikelihoodFieldModelBatch::sensorUpdate(pf_t * pf, LaserData * data)
+{
+  if (max_beams_ < 2) {
+    return false;
+  }
+  precomputeBeams(data);
+  updateHitProbTable();
+  pf_update_sensor_parallel(pf, (pf_sensor_model_fn_t) sensorFunction, data);
+
+  return true;
+}
+
+}  // namespace nav2_amcl
@@ -0,0 +1,112 @@
+/*
+ *  Player - One Hell of a Robot Server
+ *  Copyright (C) 2000  Brian Gerkey   &  Kasper Stoy
+ *                      gerkey@usc.edu    kaspers@robotics.usc.edu
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <vector>
+
+#include "nav2_amcl/sensors/laser/laser.hpp"
+
+namespace nav2_amcl
+{
+
+LikelihoodFieldModelGPU::LikelihoodFieldModelGPU(
+  double z_hit, double z_rand, double sigma_hit,
+  double max_occ_dist, size_t max_beams, map_t * map)
+: LikelihoodFieldModelBatch(z_hit, z_rand, sigma_hit, max_occ_dist, max_beams, map)
+{
+  if (LikelihoodFieldDevice::available()) {
+    device_.reset(new LikelihoodFieldDevice());
+  }
+}
+
+LikelihoodFieldModelGPU::~LikelihoodFieldModelGPU()
+{
+}
+
+bool
+LikelihoodFieldModelGPU::uploadMap()
+{
+  // the distances only change when map_update_cspace recomputes them for a new max_occ_dist
+  if (map_->max_occ_dist == uploaded_max_occ_dist_) {
+    return true;
+  }
+
+  std::vector<float> field(static_cast<size_t>(map_->size_x) * map_->size_y);
+  for (int j = 0; j < map_->size_y; j++) {
+    for (int i = 0; i < map_->size_x; i++) {
+      field[i + static_cast<size_t>(j) * map_->size_x] =
+        static_cast<float>(map_occ_dist(map_, MAP_INDEX(map_, i, j)));
+    }
+  }
+
+  DeviceMapGeometry geometry;
+  geometry.size_x = map_->size_x;
+  geometry.size_y = map_->size_y;
+  geometry.origin_x = map_->origin_x;
+  geometry.origin_y = map_->origin_y;
+  geometry.scale = map_->scale;
+  geometry.off_map = static_cast<float>(map_->max_occ_dist);
+  if (!device_->uploadMap(field.data(), geometry)) {
+    return false;
+  }
+  uploaded_max_occ_dist_ = map_->max_occ_dist;
+  return true;
+}
+
+double
+LikelihoodFieldModelGPU::sensorFunction(LaserData * data, pf_sample_set_t * set)
+{
+  LikelihoodFieldModelGPU * self = static_cast<LikelihoodFieldModelGPU *>(data->laser);
+
+  double z_hit_denom = 2 * self->sigma_hit_ * self->sigma_hit_;
+  double z_rand = self->z_rand_ / data->range_max;
+  double total_weight;
+  if (self->device_->weigh(set->x, set->y, set->theta, set->weight, set->sample_count,
+    self->beam_x_.data(), self->beam_y_.data(), static_cast<int>(self->beam_x_.size()),
+    self->laser_pose_.v, self->z_hit_, z_rand, z_hit_denom, &total_weight))
+  {
+    return total_weight;
+  }
+
+  // the device left the weights as they were, for the CPU from now on
+  self->device_.reset();
+  return LikelihoodFieldModelBatch::sensorFunction(data, set);
+}
+
+bool
+LikelihoodFieldModelGPU::sensorUpdate(pf_t * pf, LaserData * data)
+{
+  if (device_ && !uploadMap()) {
+    device_.reset();
+  }
+  if (!device_) {
+    return LikelihoodFieldModelBatch::sensorUpdate(pf, data);
+  }
+  if (max_beams_ < 2) {
+    return false;
+  }
+  precomputeBeams(data);
+  // the CPU only normalizes the weights, on the thread of the update
+  pf_update_sensor(pf, (pf_sensor_model_fn_t) sensorFunction, data);
+
+  return true;
+}
+
+}  // namespace nav2_amcl
@@ -22,6 +22,8 @@
 
 #include <math.h>
 #include <assert.h>
+#include <algorithm>
+#include <vector>
 
 #include "nav2_amcl/sensors/laser/laser.hpp"
 
@@ -34,7 +36,7 @@ LikelihoodFieldModelProb::LikelihoodFieldModelProb(
   double beam_skip_distance,
   double beam_skip_threshold,
   double beam_skip_error_threshold,
-  size_t max_beams, map_t * map)
+  int max_samples, size_t max_beams, map_t * map)
 : Laser(max_beams, map)
 {
   z_hit_ = z_hit;
@@ -45,6 +47,35 @@ LikelihoodFieldModelProb::LikelihoodFieldModelProb(
   beam_skip_threshold_ = beam_skip_threshold;
   beam_skip_error_threshold_ = beam_skip_error_threshold;
   map_update_cspace(map, max_occ_dist);
+
+  if (do_beamskip_) {
+    reserveBeamSkip(max_samples);
+  }
+}
+
+// Size the beam skipping buffers for up to max_samples particles
+void
+LikelihoodFieldModelProb::reserveBeamSkip(int max_samples)
+{
+  int words = (max_beams_ + 63) / 64;
+  beam_skip_samples_ = max_samples;
+  beam_log_pz_.resize(static_cast<size_t>(max_samples) * max_beams_);
+  beam_hits_.resize(max_beams_);
+  beam_valid_.resize(words);
+  beam_mask_.resize(words);
+  beam_used_.reserve(max_beams_);
+}
+
+static inline void
+setBit(std::vector<uint64_t> & bits, int i)
+{
+  bits[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+
+static inline bool
+testBit(const std::vector<uint64_t> & bits, int i)
+{
+  return (bits[i >> 6] >> (i & 63)) & 1;
 }
 
 // Determine the probability for the given pose
@@ -57,7 +88,6 @@ LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set
   double log_p;
   double obs_range, obs_bearing;
   double total_weight;
-  pf_sample_t * sample;
   pf_vector_t pose;
   pf_vector_t hit;
 
@@ -91,37 +121,25 @@ LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set
     do_beamskip = false;
   }
 
-  // we need a count the no of particles for which the beam agreed with the map
-  int * obs_count = new int[self->max_beams_]();
-
-  // we also need a mask of which observations to integrate (to decide which beams to integrate to
-  // all particles)
-  bool * obs_mask = new bool[self->max_beams_]();
-
   int beam_ind = 0;
 
-  // realloc indicates if we need to reallocate the temp data structure needed to do beamskipping
-  bool realloc = false;
-
+  // Beam skipping keeps, for every particle, the log probability of each beam
+  // in a row of beam_log_pz_, along with the number of particles for which
+  // each beam agreed with the map and which beams were observed at all
   if (do_beamskip) {
-    if (self->max_obs_ < self->max_beams_) {
-      realloc = true;
-    }
-
-    if (self->max_samples_ < set->sample_count) {
-      realloc = true;
-    }
-
-    if (realloc) {
-      self->reallocTempData(set->sample_count, self->max_beams_);
-      fprintf(stderr, "Reallocing temp weights %d - %d\n", self->max_samples_, self->max_obs_);
+    if (self->beam_skip_samples_ < set->sample_count) {
+      self->reserveBeamSkip(set->sample_count);
+      fprintf(stderr, "Reallocing beam skip buffers for %d samples\n", set->sample_count);
     }
+    std::fill(self->beam_hits_.begin(), self->beam_hits_.end(), 0);
+    std::fill(self->beam_valid_.begin(), self->beam_valid_.end(), 0);
+    std::fill(self->beam_mask_.begin(), self->beam_mask_.end(), 0);
   }
+  int * obs_count = do_beamskip ? self->beam_hits_.data() : NULL;
 
   // Compute the sample weights
   for (j = 0; j < set->sample_count; j++) {
-    sample = set->samples + j;
-    pose = sample->pose;
+    pose = pf_sample_pose(set, j);
 
     // Take account of the laser pose relative to the robot
     pose = pf_vector_coord_add(self->laser_pose_, pose);
@@ -129,10 +147,12 @@ LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set
     log_p = 0;
 
     beam_ind = 0;
+    float * log_pz_row = do_beamskip ?
+      self->beam_log_pz_.data() + static_cast<size_t>(j) * self->max_beams_ : NULL;
 
     for (i = 0; i < data->range_count; i += step, beam_ind++) {
-      obs_range = data->ranges[i][0];
-      obs_bearing = data->ranges[i][1];
+      obs_range = data->ranges[i];
+      obs_bearing = data->bearings[i];
 
       // This model ignores max range readings
       if (obs_range >= data->range_max) {
@@ -161,11 +181,15 @@ LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set
       if (!MAP_VALID(self->map_, mi, mj)) {
         pz += self->z_hit_ * max_dist_prob;
       } else {
-        z = self->map_->cells[MAP_INDEX(self->map_, mi, mj)].occ_dist;
-        if (z < beam_skip_distance) {
+        z = map_occ_dist(self->map_, MAP_INDEX(self->map_, mi, mj));
+        if (do_beamskip && z < beam_skip_distance) {
           obs_count[beam_ind] += 1;
         }
-        pz += self->z_hit_ * exp(-(z * z) / z_hit_denom);
+        if (self->use_hit_prob_table_) {
+          pz += self->z_hit_ * self->map_->hit_prob[MAP_INDEX(self->map_, mi, mj)];
+        } else {
+          pz += self->z_hit_ * exp(-(z * z) / z_hit_denom);
+        }
       }
 
       // Gaussian model
@@ -182,22 +206,32 @@ LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set
       if (!do_beamskip) {
         log_p += log(pz);
       } else {
-        self->temp_obs_[j][beam_ind] = pz;
+        log_pz_row[beam_ind] = log(pz);
+        if (j == 0) {
+          setBit(self->beam_valid_, beam_ind);
+        }
       }
     }
     if (!do_beamskip) {
-      sample->weight *= exp(log_p);
-      total_weight += sample->weight;
+      set->weight[j] *= exp(log_p);
+      total_weight += set->weight[j];
     }
   }
 
   if (do_beamskip) {
+    // Only beams that were observed take part; max range and NaN readings
+    // are the same for every particle
+    int beam_count = beam_ind;
+    int observed_beam_count = 0;
     int skipped_beam_count = 0;
-    for (beam_ind = 0; beam_ind < self->max_beams_; beam_ind++) {
+    for (beam_ind = 0; beam_ind < beam_count; beam_ind++) {
+      if (!testBit(self->beam_valid_, beam_ind)) {
+        continue;
+      }
+      observed_beam_count++;
       if ((obs_count[beam_ind] / static_cast<double>(set->sample_count)) > beam_skip_threshold) {
-        obs_mask[beam_ind] = true;
+        setBit(self->beam_mask_, beam_ind);
       } else {
-        obs_mask[beam_ind] = false;
         skipped_beam_count++;
       }
     }
@@ -208,7 +242,7 @@ LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set
     // the right solution
     bool error = false;
 
-    if (skipped_beam_count >= (beam_ind * self->beam_skip_error_threshold_)) {
+    if (skipped_beam_count >= (observed_beam_count * self->beam_skip_error_threshold_)) {
       fprintf(stderr,
         "Over %f%% of the observations were not in the map - pf may have converged to wrong pose -"
         " integrating all observations\n",
@@ -216,26 +250,33 @@ LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set
       error = true;
     }
 
+    // The beams to integrate, in increasing order so that every particle's
+    // row is read front to back
+    std::vector<int> & used = self->beam_used_;
+    used.clear();
+    for (beam_ind = 0; beam_ind < beam_count; beam_ind++) {
+      if (testBit(self->beam_valid_, beam_ind) &&
+        (error || testBit(self->beam_mask_, beam_ind)))
+      {
+        used.push_back(beam_ind);
+      }
+    }
+
     for (j = 0; j < set->sample_count; j++) {
-      sample = set->samples + j;
-      pose = sample->pose;
+      const float * log_pz_row =
+        self->beam_log_pz_.data() + static_cast<size_t>(j) * self->max_beams_;
 
       log_p = 0;
-
-      for (beam_ind = 0; beam_ind < self->max_beams_; beam_ind++) {
-        if (error || obs_mask[beam_ind]) {
-          log_p += log(self->temp_obs_[j][beam_ind]);
-        }
+      for (size_t k = 0; k < used.size(); k++) {
+        log_p += log_pz_row[used[k]];
       }
 
-      sample->weight *= exp(log_p);
+      set->weight[j] *= exp(log_p);
 
-      total_weight += sample->weight;
+      total_weight += set->weight[j];
     }
   }
 
-  delete[] obs_count;
-  delete[] obs_mask;
   return total_weight;
 }
 
@@ -245,7 +286,14 @@ LikelihoodFieldModelProb::sensorUpdate(pf_t * pf, LaserData * data)
   if (max_beams_ < 2) {
     return false;
   }
-  pf_update_sensor(pf, (pf_sensor_model_fn_t) sensorFunction, data);
+  updateHitProbTable();
+  if (do_beamskip_) {
+    // Beam skipping needs every particle's observations before any weight can
+    // be computed, so it has to see the whole set at once
+    pf_update_sensor(pf, (pf_sensor_model_fn_t) sensorFunction, data);
+  } else {
+    pf_update_sensor_parallel(pf, (pf_sensor_model_fn_t) sensorFunction, data);
+  }
 
   return true;
 }
@@ -0,0 +1,204 @@
+// Copyright (c) 2018 Intel Corporation
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <math.h>
+#include <algorithm>
+
+#include "nav2_amcl/sensors/laser/scan_matcher.hpp"
+
+namespace nav2_amcl
+{
+
+// Each level takes a byte per map cell; wider windows just start the search
+// with more candidates
+static const int max_depth = 6;
+
+void
+ScanMatcher::clear()
+{
+  map_ = nullptr;
+  levels_.clear();
+}
+
+bool
+ScanMatcher::match(
+  map_t * map, double sigma_hit,
+  const std::vector<std::array<double, 2>> & endpoints,
+  double linear_window, double angular_window, double min_score,
+  pf_vector_t & pose, double * match_score)
+{
+  if (endpoints.empty()) {
+    return false;
+  }
+
+  // Deep enough for a single candidate of the top level to cover the window
+  window_ = std::max(0, static_cast<int>(ceil(linear_window / map->scale)));
+  int depth = 0;
+  while ((1 << depth) < 2 * window_ + 1 && depth < max_depth) {
+    depth++;
+  }
+  update(map, sigma_hit, depth);
+
+  // Step the angle by as much as moves the farthest endpoint by one cell
+  double max_range = map->scale;
+  for (const auto & endpoint : endpoints) {
+    max_range = std::max(max_range, hypot(endpoint[0], endpoint[1]));
+  }
+  double angle_step = acos(1.0 - (map->scale * map->scale) / (2.0 * max_range * max_range));
+  int angles = std::max(0, static_cast<int>(ceil(angular_window / angle_step)));
+
+  cells_.resize(2 * angles + 1);
+  for (int a = 0; a <= 2 * angles; a++) {
+    double c = cos(pose.v[2] + (a - angles) * angle_step);
+    double s = sin(pose.v[2] + (a - angles) * angle_step);
+    cells_[a].resize(endpoints.size());
+    for (size_t k = 0; k < endpoints.size(); k++) {
+      double x = pose.v[0] + c * endpoints[k][0] - s * endpoints[k][1];
+      double y = pose.v[1] + s * endpoints[k][0] + c * endpoints[k][1];
+      cells_[a][k] = {{static_cast<int>(MAP_GXWX(map, x)), static_cast<int>(MAP_GYWY(map, y))}};
+    }
+  }
+
+  std::vector<Candidate> candidates;
+  int step = 1 << depth;
+  for (int a = 0; a <= 2 * angles; a++) {
+    for (int dx = -window_; dx <= window_; dx += step) {
+      for (int dy = -window_; dy <= window_; dy += step) {
+        Candidate candidate{a, dx, dy, 0};
+        candidate.score = score(candidate, depth);
+        candidates.push_back(candidate);
+      }
+    }
+  }
+
+  // Only the poses scoring at least min_score are of interest
+  double full_score = 255.0 * endpoints.size();
+  Candidate best{-1, 0, 0, static_cast<int>(ceil(min_score * full_score)) - 1};
+  search(candidates, depth, best);
+  if (best.angle < 0) {
+    return false;
+  }
+
+  pose.v[0] += best.dx * map->scale;
+  pose.v[1] += best.dy * map->scale;
+  pose.v[2] += (best.angle - angles) * angle_step;
+  if (match_score) {
+    *match_score = best.score / full_score;
+  }
+  return true;
+}
+
+void
+ScanMatcher::update(map_t * map, double sigma_hit, int depth)
+{
+  if (map != map_ || sigma_hit != sigma_hit_ || map->max_occ_dist != max_occ_dist_) {
+    levels_.clear();
+    map_ = map;
+    sigma_hit_ = sigma_hit;
+    max_occ_dist_ = map->max_occ_dist;
+    size_x_ = map->size_x;
+    size_y_ = map->size_y;
+  }
+  int cells = size_x_ * size_y_;
+
+  if (levels_.empty()) {
+    double z_hit_denom = 2 * sigma_hit * sigma_hit;
+    levels_.emplace_back(cells);
+    std::vector<uint8_t> & grid = levels_[0];
+    for (int j = 0; j < size_y_; j++) {
+      for (int i = 0; i < size_x_; i++) {
+        double z = map_occ_dist(map, MAP_INDEX(map, i, j));
+        grid[j * size_x_ + i] = static_cast<uint8_t>(lround(255.0 * exp(-(z * z) / z_hit_denom)));
+      }
+    }
+  }
+
+  // A block is the best of the four half as wide at its corners; those
+  // past the edge of the map score nothing
+  while (static_cast<int>(levels_.size()) <= depth) {
+    int half = 1 << (levels_.size() - 1);
+    levels_.emplace_back(cells);
+    const std::vector<uint8_t> & below = levels_[levels_.size() - 2];
+    std::vector<uint8_t> & grid = levels_.back();
+    for (int j = 0; j < size_y_; j++) {
+      for (int i = 0; i < size_x_; i++) {
+        uint8_t best = below[j * size_x_ + i];
+        if (i + half < size_x_) {
+          best = std::max(best, below[j * size_x_ + i + half]);
+        }
+        if (j + half < size_y_) {
+          best = std::max(best, below[(j + half) * size_x_ + i]);
+          if (i + half < size_x_) {
+            best = std::max(best, below[(j + half) * size_x_ + i + half]);
+          }
+        }
+        grid[j * size_x_ + i] = best;
+      }
+    }
+  }
+}
+
+int
+ScanMatcher::score(const Candidate & candidate, int level) const
+{
+  // A block reaching onto the map from below or left of it is bounded by the
+  // block at its edge, which holds all of its cells that are on the map
+  int size = 1 << level;
+  const std::vector<uint8_t> & grid = levels_[level];
+  int score = 0;
+  for (const auto & cell : cells_[candidate.angle]) {
+    int i = cell[0] + candidate.dx;
+    int j = cell[1] + candidate.dy;
+    if (i >= size_x_ || j >= size_y_ || i + size <= 0 || j + size <= 0) {
+      continue;
+    }
+    score += grid[std::max(j, 0) * size_x_ + std::max(i, 0)];
+  }
+  return score;
+}
+
+void
+ScanMatcher::search(std::vector<Candidate> & candidates, int level, Candidate & best)
+{
+  std::sort(candidates.begin(), candidates.end(),
+    [](const Candidate & a, const Candidate & b) {return a.score > b.score;});
+
+  std::vector<Candidate> children;
+  for (const Candidate & candidate : candidates) {
+    if (candidate.score <= best.score) {
+      return;
+    }
+    if (level == 0) {
+      best = candidate;
+      return;
+    }
+    int half = 1 << (level - 1);
+    children.clear();
+    for (int ox = 0; ox <= half; ox += half) {
+      for (int oy = 0; oy <= half; oy += half) {
+        Candidate child{candidate.angle, candidate.dx + ox, candidate.dy + oy, 0};
+        if (child.dx > window_ || child.dy > window_) {
+          continue;
+        }
+        child.score = score(child, level - 1);
+        children.push_back(child);
+      }
+    }
+    search(children, level - 1, best);
+  }
+}
+
+}  // namespace nav2_amcl
@@ -15,13 +15,19 @@
 #ifndef NAV2_BEHAVIOR_TREE__BEHAVIOR_TREE_ENGINE_HPP_
 #define NAV2_BEHAVIOR_TREE__BEHAVIOR_TREE_ENGINE_HPP_
 
+#include <chrono>
+#include <map>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "behaviortree_cpp/behavior_tree.h"
 #include "behaviortree_cpp/blackboard/blackboard_local.h"
 #include "behaviortree_cpp/bt_factory.h"
 #include "behaviortree_cpp/xml_parsing.h"
+#include "nav2_behavior_tree/tick_wakeup.hpp"
+#include "nav2_util/loop_rate.hpp"
+#include "nav2_util/metrics.hpp"
 
 namespace nav2_behavior_tree
 {
@@ -31,9 +37,15 @@ enum class BtStatus { SUCCEEDED, FAILED, CANCELED };
 class BehaviorTreeEngine
 {
 public:
-  BehaviorTreeEngine();
+  // With event_driven, the engine ticks the tree again as soon as a node's action or service
+  // completes or notify is called, instead of waiting out the rest of the loop period, which
+  // then only bounds the time between ticks. It waits by spinning the tree's "node".
+  explicit BehaviorTreeEngine(bool event_driven = false);
   virtual ~BehaviorTreeEngine() {}
 
+  // Run the tree described by behavior_tree_xml. The tree is only built the first time it is
+  // run on blackboard, after which it is reset and run again, keeping its nodes and their
+  // connected clients.
   BtStatus run(
     BT::Blackboard::Ptr & blackboard,
     const std::string & behavior_tree_xml,
@@ -49,6 +61,20 @@ public:
 
   BT::Tree buildTreeFromText(std::string & xml_string, BT::Blackboard::Ptr blackboard);
 
+  // As buildTreeFromText, for a tree that can be kept and run many times
+  std::unique_ptr<BT::Tree> buildTree(
+    const std::string & xml_string,
+    BT::Blackboard::Ptr blackboard);
+
+  // Wake an event-driven engine for an immediate tick, such as after a cancel or preempt
+  // request or a write to the blackboard from another thread. Does nothing otherwise.
+  void notify()
+  {
+    if (tick_wakeup_) {
+      tick_wakeup_->notify();
+    }
+  }
+
   void haltAllActions(BT::TreeNode * root_node)
   {
     auto visitor = [](BT::TreeNode * node) {
@@ -72,8 +98,35 @@ protected:
   // Methods used to register as (simple action) BT nodes
   BT::NodeStatus initialPoseReceived(BT::TreeNode & tree_node);
 
+  // Whether the leg after the current waypoint of the route has a plan, or there is none
+  BT::NodeStatus nextLegPlanned(BT::TreeNode & tree_node);
+
+  // Tick the tree until it completes, waiting loopTimeout or for an event between ticks. The
+  // waits keep /clock's time when the tree's node is on sim time.
+  BtStatus tickUntilDone(
+    BT::TreeNode * root_node,
+    std::function<void()> onLoop,
+    std::function<bool()> cancelRequested,
+    std::chrono::milliseconds loopTimeout);
+
+  // Spin the tree's node until an event is notified or the deadline on clock passes
+  void waitForEvent(
+    const BT::Blackboard::Ptr & blackboard,
+    nav2_util::LoopClock & clock,
+    std::chrono::nanoseconds deadline);
+
   // The factory that will be used to dynamically construct the behavior tree
   BT::BehaviorTreeFactory factory_;
+
+  // Set in event-driven mode, and put on the blackboard of its trees as "tick_wakeup"
+  std::shared_ptr<rclcpp::executors::SingleThreadedExecutor> executor_;
+  std::shared_ptr<TickWakeup> tick_wakeup_;
+
+  // The trees built by run, by the blackboard they were built on and their XML
+  std::map<std::pair<const BT::Blackboard *, std::string>, std::unique_ptr<BT::Tree>> trees_;
+
+  // Every tick of a root node, in the process's metrics registry as bt.tick
+  nav2_util::LatencyHistogram & tick_time_;
 };
 
 }  // namespace nav2_behavior_tree
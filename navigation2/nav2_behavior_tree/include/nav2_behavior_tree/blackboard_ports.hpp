@@ -0,0 +1,85 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BEHAVIOR_TREE__BLACKBOARD_PORTS_HPP_
+#define NAV2_BEHAVIOR_TREE__BLACKBOARD_PORTS_HPP_
+
+#include <memory>
+
+#include "behaviortree_cpp/blackboard/blackboard.h"
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav2_msgs/msg/path.hpp"
+
+namespace nav2_behavior_tree
+{
+
+// A blackboard entry of a fixed key and type, so that the nodes writing and reading it cannot
+// disagree on either
+template<typename T>
+class BlackboardPort
+{
+public:
+  constexpr explicit BlackboardPort(const char * key)
+  : key_(key)
+  {
+  }
+
+  const char * key() const {return key_;}
+
+  // Throws if the entry is missing
+  T get(const BT::Blackboard::Ptr & blackboard) const
+  {
+    return blackboard->template get<T>(key_);
+  }
+
+  bool get(const BT::Blackboard::Ptr & blackboard, T & value) const
+  {
+    return blackboard->get(key_, value);
+  }
+
+  void set(const BT::Blackboard::Ptr & blackboard, const T & value) const
+  {
+    blackboard->template set<T>(key_, value);
+  }
+
+private:
+  const char * key_;
+};
+
+// Paths are shared, never changed once on the blackboard: a new path replaces the pointer, so
+// that a node can keep the one it has without copying it
+using PathConstPtr = std::shared_ptr<const nav2_msgs::msg::Path>;
+
+class WaypointRoute;
+
+namespace ports
+{
+
+// The pose to navigate to, updated in place by the navigator
+const BlackboardPort<geometry_msgs::msg::PoseStamped::SharedPtr> goal{"goal"};
+
+// The newest path to the goal
+const BlackboardPort<PathConstPtr> path{"path"};
+
+// Set when a new path replaces the one FollowPath was given
+const BlackboardPort<bool> path_updated{"path_updated"};
+
+// The waypoints of the goal, the current one being the goal above, and the plans of their legs
+const BlackboardPort<std::shared_ptr<WaypointRoute>> route{"route"};
+
+}  // namespace ports
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__BLACKBOARD_PORTS_HPP_
@@ -15,10 +15,14 @@
 #ifndef NAV2_BEHAVIOR_TREE__BT_ACTION_NODE_HPP_
 #define NAV2_BEHAVIOR_TREE__BT_ACTION_NODE_HPP_
 
+#include <chrono>
+#include <future>
 #include <memory>
 #include <string>
 
 #include "behaviortree_cpp/action_node.h"
+#include "nav2_behavior_tree/bt_profiler.hpp"
+#include "nav2_behavior_tree/tick_wakeup.hpp"
 #include "nav2_util/node_utils.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
 
@@ -51,7 +55,12 @@ public:
   // but override on_init instead.
   void onInit() final
   {
-    node_ = blackboard()->template get<rclcpp::Node::SharedPtr>("node");
+    // A tree given an "async_node", which something else spins, calls its actions through it
+    // and never waits on the tree's thread, so that its actions can run side by side
+    async_ = blackboard()->get("async_node", node_) && node_;
+    if (!async_) {
+      node_ = blackboard()->template get<rclcpp::Node::SharedPtr>("node");
+    }
 
     // Initialize the input and output messages
     goal_ = typename ActionT::Goal();
@@ -61,6 +70,9 @@ public:
     node_loop_timeout_ =
       blackboard()->template get<std::chrono::milliseconds>("node_loop_timeout");
 
+    // Only set when the tree is run by an event-driven engine
+    blackboard()->get("tick_wakeup", tick_wakeup_);
+
     // Now that we have the ROS node to use, create the action client for this BT action
     action_client_ = rclcpp_action::create_client<ActionT>(node_, action_name_);
 
@@ -101,43 +113,69 @@ public:
   // The main override required by a BT action
   BT::NodeStatus tick() override
   {
+    // Times each resumption of the coroutine, which is how long the tree waits for it
+    BtProfiler::ScopedTick profile(BtProfiler::fromBlackboard(blackboard()), this);
+
     on_tick();
 
-    // Enable result awareness by providing an empty lambda function
+    // Enable result awareness by providing a lambda function, which wakes an event-driven
+    // engine to tick the tree with the result
     auto send_goal_options = typename rclcpp_action::Client<ActionT>::SendGoalOptions();
-    send_goal_options.result_callback = [](auto) {};
+    send_goal_options.result_callback = [wakeup = tick_wakeup_](auto) {
+        if (wakeup) {
+          wakeup->notify();
+        }
+      };
+
+    // Wake the engine when the server answers the goal too, as nothing else does when the
+    // node is spun in the background
+    if (async_) {
+      send_goal_options.goal_response_callback = [wakeup = tick_wakeup_](auto) {
+          if (wakeup) {
+            wakeup->notify();
+          }
+        };
+    }
+
+    // An event-driven engine, or the background executor, spins the node for the result
+    // between ticks, so the node only checks for it instead of waiting
+    auto result_timeout = (tick_wakeup_ || async_) ?
+      std::chrono::milliseconds(0) : node_loop_timeout_;
 
 new_goal_received:
-    auto future_goal_handle = action_client_->async_send_goal(goal_, send_goal_options);
-    if (rclcpp::spin_until_future_complete(node_, future_goal_handle) !=
-      rclcpp::executor::FutureReturnCode::SUCCESS)
-    {
+    goal_handle_.reset();
+    future_goal_handle_ = action_client_->async_send_goal(goal_, send_goal_options);
+    if (async_) {
+      while (!future_complete(future_goal_handle_, std::chrono::milliseconds(0))) {
+        profile.stop();
+        setStatusRunningAndYield();
+        profile.start();
+      }
+    } else if (!future_complete(future_goal_handle_)) {
       throw std::runtime_error("send_goal failed");
     }
 
-    goal_handle_ = future_goal_handle.get();
+    goal_handle_ = future_goal_handle_.get();
     if (!goal_handle_) {
       throw std::runtime_error("Goal was rejected by the action server");
     }
 
     auto future_result = goal_handle_->async_result();
-    rclcpp::executor::FutureReturnCode rc;
-    do {
-      rc = rclcpp::spin_until_future_complete(node_, future_result, node_loop_timeout_);
-      if (rc == rclcpp::executor::FutureReturnCode::TIMEOUT) {
-        on_loop_timeout();
-
-        // We can handle a new goal if we're still executing
-        auto status = goal_handle_->get_status();
-        if (goal_updated_ && (status == action_msgs::msg::GoalStatus::STATUS_EXECUTING)) {
-          goal_updated_ = false;
-          goto new_goal_received;
-        }
-
-        // Yield to any other CoroActionNodes (coroutines)
-        setStatusRunningAndYield();
+    while (!future_complete(future_result, result_timeout)) {
+      on_loop_timeout();
+
+      // We can handle a new goal if we're still executing
+      auto status = goal_handle_->get_status();
+      if (goal_updated_ && (status == action_msgs::msg::GoalStatus::STATUS_EXECUTING)) {
+        goal_updated_ = false;
+        goto new_goal_received;
       }
-    } while (rc != rclcpp::executor::FutureReturnCode::SUCCESS);
+
+      // Yield to any other CoroActionNodes (coroutines)
+      profile.stop();
+      setStatusRunningAndYield();
+      profile.start();
+    }
 
     result_ = future_result.get();
     switch (result_.code) {
@@ -165,9 +203,7 @@ new_goal_received:
   {
     if (should_cancel_goal()) {
       auto future_cancel = action_client_->async_cancel_goal(goal_handle_);
-      if (rclcpp::spin_until_future_complete(node_, future_cancel) !=
-        rclcpp::executor::FutureReturnCode::SUCCESS)
-      {
+      if (!future_complete(future_cancel)) {
         RCLCPP_ERROR(node_->get_logger(),
           "Failed to cancel action server for %s", action_name_.c_str());
       }
@@ -178,6 +214,29 @@ new_goal_received:
   }
 
 protected:
+  // Whether future completed within timeout, spinning the node for it unless it is spun in
+  // the background. A negative timeout waits until it completes or ROS shuts down.
+  template<typename FutureT>
+  bool future_complete(
+    FutureT & future,
+    std::chrono::milliseconds timeout = std::chrono::milliseconds(-1))
+  {
+    if (!async_) {
+      return rclcpp::spin_until_future_complete(node_, future, timeout) ==
+             rclcpp::executor::FutureReturnCode::SUCCESS;
+    }
+
+    if (timeout >= std::chrono::milliseconds(0)) {
+      return future.wait_for(timeout) == std::future_status::ready;
+    }
+    while (rclcpp::ok()) {
+      if (future.wait_for(node_loop_timeout_) == std::future_status::ready) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   bool should_cancel_goal()
   {
     // Shut the node down if it is currently running
@@ -185,7 +244,20 @@ protected:
       return false;
     }
 
-    rclcpp::spin_some(node_);
+    // A node that does not wait may be halted before the server has answered its goal
+    if (!goal_handle_) {
+      if (!future_goal_handle_.valid() || !future_complete(future_goal_handle_)) {
+        return false;
+      }
+      goal_handle_ = future_goal_handle_.get();
+      if (!goal_handle_) {
+        return false;
+      }
+    }
+
+    if (!async_) {
+      rclcpp::spin_some(node_);
+    }
     auto status = goal_handle_->get_status();
 
     // Check if the goal is still executing
@@ -204,6 +276,8 @@ protected:
   // All ROS2 actions have a goal and a result
   typename ActionT::Goal goal_;
   bool goal_updated_{false};
+  std::shared_future<typename rclcpp_action::ClientGoalHandle<ActionT>::SharedPtr>
+  future_goal_handle_;
   typename rclcpp_action::ClientGoalHandle<ActionT>::SharedPtr goal_handle_;
   typename rclcpp_action::ClientGoalHandle<ActionT>::WrappedResult result_;
 
@@ -213,6 +287,12 @@ protected:
   // The timeout value while to use in the tick loop while waiting for
   // a result from the server
   std::chrono::milliseconds node_loop_timeout_;
+
+  // Wakes the engine when the result arrives, null unless the engine is event-driven
+  std::shared_ptr<TickWakeup> tick_wakeup_;
+
+  // Whether node_ is the "async_node", spun in the background
+  bool async_{false};
 };
 
 }  // namespace nav2_behavior_tree
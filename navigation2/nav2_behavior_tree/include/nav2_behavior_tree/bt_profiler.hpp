@@ -0,0 +1,152 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BEHAVIOR_TREE__BT_PROFILER_HPP_
+#define NAV2_BEHAVIOR_TREE__BT_PROFILER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "behaviortree_cpp/behavior_tree.h"
+#include "behaviortree_cpp/loggers/abstract_logger.h"
+
+namespace nav2_behavior_tree
+{
+
+// Records how the nodes of a tree spend their time: for every node, its status transitions and
+// the time it stays RUNNING, and for the nodes that report their ticks (the action, service and
+// condition nodes of this package, and the root), the number of ticks and the time spent in
+// them. The most recent transitions and ticks are kept in a ring buffer.
+//
+// Everything is recorded from the tree's thread without locks. summary and recent can be
+// called from any other thread, and only ever see completely written records.
+class BtProfiler : public BT::StatusChangeLogger
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // A record of the ring buffer
+  struct Event
+  {
+    enum class Type : uint8_t { TRANSITION, TICK };
+
+    Type type;
+    uint16_t node;
+    BT::NodeStatus prev_status;
+    BT::NodeStatus status;
+    int64_t time_ns;      // since the profiler was created
+    int64_t duration_ns;  // of the tick, or of the state the node left
+  };
+
+  explicit BtProfiler(BT::TreeNode * root_node, size_t capacity = 4096);
+
+  void callback(
+    BT::Duration timestamp, const BT::TreeNode & node,
+    BT::NodeStatus prev_status, BT::NodeStatus status) override;
+
+  void flush() override {}
+
+  // Record a tick of node that took from start to now
+  void recordTick(const BT::TreeNode * node, Clock::time_point start);
+
+  // A line per node with its totals, slowest first
+  std::string summary() const;
+
+  // The recorded events since since_ns, one per line, oldest first
+  std::string recent(int64_t since_ns = 0) const;
+
+  // The profiler put on blackboard as "bt_profiler", null if there is none
+  static BtProfiler * fromBlackboard(const BT::Blackboard::Ptr & blackboard);
+
+  // Nanoseconds since the profiler was created, on the clock of Event::time_ns
+  int64_t now() const;
+
+  // Times a tick from construction to destruction, or to stop. profiler may be null.
+  class ScopedTick
+  {
+  public:
+    ScopedTick(BtProfiler * profiler, const BT::TreeNode * node)
+    : profiler_(profiler), node_(node)
+    {
+      start();
+    }
+
+    ~ScopedTick()
+    {
+      stop();
+    }
+
+    // For coroutines, which stop before they yield and start again once resumed
+    void start()
+    {
+      start_ = Clock::now();
+      running_ = true;
+    }
+
+    void stop()
+    {
+      if (profiler_ && running_) {
+        profiler_->recordTick(node_, start_);
+      }
+      running_ = false;
+    }
+
+  private:
+    BtProfiler * profiler_;
+    const BT::TreeNode * node_;
+    Clock::time_point start_;
+    bool running_{false};
+  };
+
+private:
+  // Totals of a node, each written by the tree's thread only
+  struct NodeStats
+  {
+    std::string name;
+    BT::NodeStatus status{BT::NodeStatus::IDLE};
+    int64_t status_since_ns{0};
+    std::atomic<uint64_t> ticks{0};
+    std::atomic<int64_t> tick_ns{0};
+    std::atomic<int64_t> max_tick_ns{0};
+    std::atomic<uint64_t> transitions{0};
+    std::atomic<int64_t> running_ns{0};
+    std::atomic<int64_t> max_running_ns{0};
+    std::atomic<int64_t> running_since_ns{-1};  // -1 while not running
+  };
+
+  struct Slot
+  {
+    std::atomic<uint64_t> sequence{0};
+    Event event;
+  };
+
+  int nodeIndex(const BT::TreeNode * node) const;
+  void push(const Event & event);
+
+  Clock::time_point start_;
+  std::vector<std::unique_ptr<NodeStats>> nodes_;
+  std::unordered_map<const BT::TreeNode *, int> node_index_;
+
+  std::vector<Slot> ring_;
+  std::atomic<uint64_t> head_{0};
+};
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__BT_PROFILER_HPP_
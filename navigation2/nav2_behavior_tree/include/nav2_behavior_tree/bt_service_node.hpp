@@ -15,10 +15,14 @@
 #ifndef NAV2_BEHAVIOR_TREE__BT_SERVICE_NODE_HPP_
 #define NAV2_BEHAVIOR_TREE__BT_SERVICE_NODE_HPP_
 
+#include <chrono>
+#include <future>
 #include <string>
 #include <memory>
 
 #include "behaviortree_cpp/action_node.h"
+#include "nav2_behavior_tree/bt_profiler.hpp"
+#include "nav2_behavior_tree/tick_wakeup.hpp"
 #include "nav2_util/node_utils.hpp"
 #include "rclcpp/rclcpp.hpp"
 
@@ -57,12 +61,20 @@ public:
   // but override on_init instead.
   void onInit() final
   {
-    node_ = blackboard()->template get<rclcpp::Node::SharedPtr>("node");
+    // A tree given an "async_node", which something else spins, calls its services
+    // through it and never waits on the tree's thread
+    async_ = blackboard()->get("async_node", node_) && node_;
+    if (!async_) {
+      node_ = blackboard()->template get<rclcpp::Node::SharedPtr>("node");
+    }
 
     // Get the required items from the blackboard
     node_loop_timeout_ =
       blackboard()->template get<std::chrono::milliseconds>("node_loop_timeout");
 
+    // Only set when the tree is run by an event-driven engine
+    blackboard()->get("tick_wakeup", tick_wakeup_);
+
     // Now that we have node_ to use, create the service client for this BT service
     service_client_ = node_->create_client<ServiceT>(service_name_);
 
@@ -81,7 +93,14 @@ public:
   // The main override required by a BT service
   BT::NodeStatus tick() override
   {
+    BtProfiler::ScopedTick profile(BtProfiler::fromBlackboard(blackboard()), this);
+
     on_tick();
+
+    if (tick_wakeup_ || async_) {
+      return tick_without_waiting(profile);
+    }
+
     auto future_result = service_client_->async_send_request(request_);
 
     rclcpp::executor::FutureReturnCode rc;
@@ -106,6 +125,41 @@ public:
   }
 
 protected:
+  // With an event-driven engine or an "async_node", yield while waiting for the response,
+  // which the engine or the background executor spins for, still failing after
+  // node_loop_timeout. The response wakes an event-driven engine.
+  BT::NodeStatus tick_without_waiting(BtProfiler::ScopedTick & profile)
+  {
+    auto wakeup = tick_wakeup_;
+    auto future_result = service_client_->async_send_request(request_,
+        [wakeup](typename rclcpp::Client<ServiceT>::SharedFuture) {
+          if (wakeup) {
+            wakeup->notify();
+          }
+        });
+
+    auto deadline = std::chrono::steady_clock::now() + node_loop_timeout_;
+    while (!response_received(future_result)) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        return BT::NodeStatus::FAILURE;
+      }
+      profile.stop();
+      setStatusRunningAndYield();
+      profile.start();
+    }
+    return BT::NodeStatus::SUCCESS;
+  }
+
+  template<typename FutureT>
+  bool response_received(FutureT & future)
+  {
+    if (async_) {
+      return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+    return rclcpp::spin_until_future_complete(node_, future, std::chrono::milliseconds(0)) ==
+           rclcpp::executor::FutureReturnCode::SUCCESS;
+  }
+
   std::string service_name_, service_node_name_;
   typename std::shared_ptr<rclcpp::Client<ServiceT>> service_client_;
   std::shared_ptr<typename ServiceT::Request> request_;
@@ -116,6 +170,12 @@ protected:
   // The timeout value while to use in the tick loop while waiting for
   // a result from the server
   std::chrono::milliseconds node_loop_timeout_;
+
+  // Wakes the engine when the response arrives, null unless the engine is event-driven
+  std::shared_ptr<TickWakeup> tick_wakeup_;
+
+  // Whether node_ is the "async_node", spun in the background
+  bool async_{false};
 };
 
 }  // namespace nav2_behavior_tree
@@ -0,0 +1,77 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BEHAVIOR_TREE__COMPUTE_NEXT_LEG_ACTION_HPP_
+#define NAV2_BEHAVIOR_TREE__COMPUTE_NEXT_LEG_ACTION_HPP_
+
+#include <memory>
+#include <string>
+
+#include "nav2_msgs/action/compute_path_to_pose.hpp"
+#include "nav2_behavior_tree/blackboard_ports.hpp"
+#include "nav2_behavior_tree/bt_action_node.hpp"
+#include "nav2_behavior_tree/waypoint_route.hpp"
+
+namespace nav2_behavior_tree
+{
+
+/**
+ * @brief Plans the leg of the route after the current waypoint, from that waypoint, while the
+ * robot is still driving the leg to it, and appends it to the path followed
+ *
+ * Guard it with NextLegPlanned, so each leg is planned once, and only when there is one.
+ */
+class ComputeNextLegAction : public BtActionNode<nav2_msgs::action::ComputePathToPose>
+{
+public:
+  explicit ComputeNextLegAction(const std::string & action_name)
+  : BtActionNode<nav2_msgs::action::ComputePathToPose>(action_name)
+  {
+  }
+
+  void on_tick() override
+  {
+    route_ = ports::route.get(blackboard());
+    route_index_ = route_->currentIndex();
+
+    goal_.use_start = true;
+    goal_.start = route_->current();
+    goal_.pose = route_->hasNext() ? route_->next() : route_->current();
+  }
+
+  void on_success() override
+  {
+    // The plan is stale if the goal was replaced or the route moved on while planning
+    if (ports::route.get(blackboard()) != route_ || route_->currentIndex() != route_index_ ||
+      !route_->hasNext())
+    {
+      return;
+    }
+
+    auto result = result_.result;
+    route_->setNextLeg(PathConstPtr(result, &result->path));
+    if (route_->path()) {
+      ports::path.set(blackboard(), route_->path());
+      ports::path_updated.set(blackboard(), true);
+    }
+  }
+
+private:
+  std::shared_ptr<WaypointRoute> route_;
+  size_t route_index_{0};
+};
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__COMPUTE_NEXT_LEG_ACTION_HPP_
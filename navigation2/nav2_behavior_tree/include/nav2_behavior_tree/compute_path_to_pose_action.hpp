@@ -19,7 +19,9 @@
 #include <string>
 
 #include "nav2_msgs/action/compute_path_to_pose.hpp"
+#include "nav2_behavior_tree/blackboard_ports.hpp"
 #include "nav2_behavior_tree/bt_action_node.hpp"
+#include "nav2_behavior_tree/waypoint_route.hpp"
 
 namespace nav2_behavior_tree
 {
@@ -34,22 +36,40 @@ public:
 
   void on_tick() override
   {
-    goal_.pose = *(blackboard()->get<geometry_msgs::msg::PoseStamped::SharedPtr>("goal"));
+    goal_.pose = *ports::goal.get(blackboard());
+
+    std::shared_ptr<WaypointRoute> route;
+    route_index_ = ports::route.get(blackboard(), route) && route ? route->currentIndex() : 0;
   }
 
   void on_success() override
   {
-    *(blackboard()->get<nav2_msgs::msg::Path::SharedPtr>("path")) = result_.result->path;
+    // Share the path inside the result rather than copying it
+    auto result = result_.result;
+    PathConstPtr path(result, &result->path);
+
+    // On a route, the path runs on along the leg after the goal once that is planned
+    std::shared_ptr<WaypointRoute> route;
+    if (ports::route.get(blackboard(), route) && route) {
+      if (route->currentIndex() != route_index_) {
+        // the route moved on while planning, to a goal this is no path to
+        return;
+      }
+      route->setLeg(path);
+      path = route->path();
+    }
+    ports::path.set(blackboard(), path);
 
     if (first_time_) {
       first_time_ = false;
     } else {
-      blackboard()->set<bool>("path_updated", true);  // NOLINT
+      ports::path_updated.set(blackboard(), true);
     }
   }
 
 private:
   bool first_time_{true};
+  size_t route_index_{0};
 };
 
 }  // namespace nav2_behavior_tree
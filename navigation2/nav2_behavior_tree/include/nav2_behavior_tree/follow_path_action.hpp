@@ -19,6 +19,7 @@
 #include <string>
 
 #include "nav2_msgs/action/follow_path.hpp"
+#include "nav2_behavior_tree/blackboard_ports.hpp"
 #include "nav2_behavior_tree/bt_action_node.hpp"
 
 namespace nav2_behavior_tree
@@ -34,27 +35,42 @@ public:
 
   void on_init() override
   {
-    blackboard()->set<bool>("path_updated", false);
+    ports::path_updated.set(blackboard(), false);
   }
 
   void on_tick() override
   {
-    goal_.path = *(blackboard()->get<nav2_msgs::msg::Path::SharedPtr>("path"));
+    // The latest path is sent now, including when the tree is run again for another goal
+    setPath(ports::path.get(blackboard()));
+    ports::path_updated.set(blackboard(), false);
   }
 
   void on_loop_timeout() override
   {
     // Check if the goal has been updated
-    if (blackboard()->get<bool>("path_updated")) {
+    if (ports::path_updated.get(blackboard())) {
       // Reset the flag in the blackboard
-      blackboard()->set<bool>("path_updated", false);  // NOLINT
+      ports::path_updated.set(blackboard(), false);
 
       // Grab the new goal and set the flag so that we send the new goal to
       // the action server on the next loop iteration
-      goal_.path = *(blackboard()->get<nav2_msgs::msg::Path::SharedPtr>("path"));
+      setPath(ports::path.get(blackboard()));
       goal_updated_ = true;
     }
   }
+
+private:
+  // Copy path into the goal, which is the one copy made of each path, unless the goal
+  // already holds it
+  void setPath(const PathConstPtr & path)
+  {
+    if (path != goal_path_) {
+      goal_.path = *path;
+      goal_path_ = path;
+    }
+  }
+
+  PathConstPtr goal_path_;
 };
 
 }  // namespace nav2_behavior_tree
@@ -20,6 +20,9 @@
 
 #include "rclcpp/rclcpp.hpp"
 #include "behaviortree_cpp/condition_node.h"
+#include "nav2_behavior_tree/blackboard_ports.hpp"
+#include "nav2_behavior_tree/bt_profiler.hpp"
+#include "nav2_behavior_tree/waypoint_route.hpp"
 #include "nav2_util/robot_utils.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "tf2_ros/transform_listener.h"
@@ -45,6 +48,8 @@ public:
 
   BT::NodeStatus tick() override
   {
+    BtProfiler::ScopedTick profile(BtProfiler::fromBlackboard(blackboard()), this);
+
     if (!initialized_) {
       initialize();
     }
@@ -83,12 +88,22 @@ public:
     blackboard()->get<geometry_msgs::msg::PoseStamped::SharedPtr>("goal", goal_);
     double dx = goal_->pose.position.x - current_pose.pose.position.x;
     double dy = goal_->pose.position.y - current_pose.pose.position.y;
-
-    if ( (dx * dx + dy * dy) <= (goal_reached_tol_ * goal_reached_tol_) ) {
-      return true;
-    } else {
+    bool reached = (dx * dx + dy * dy) <= (goal_reached_tol_ * goal_reached_tol_);
+
+    // A waypoint before the last of a route is not the goal. Once the robot reaches or
+    // drives past it, the route moves on and the goal becomes the next waypoint.
+    std::shared_ptr<WaypointRoute> route;
+    if (ports::route.get(blackboard(), route) && route && route->hasNext()) {
+      if (reached || route->passedCurrent(current_pose.pose.position)) {
+        route->advance();
+        *goal_ = route->current();
+        RCLCPP_INFO(node_->get_logger(), "Passed waypoint %zu of %zu",
+          route->currentIndex(), route->size());
+      }
       return false;
     }
+
+    return reached;
   }
 
 protected:
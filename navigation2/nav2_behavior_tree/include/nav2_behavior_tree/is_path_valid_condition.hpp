@@ -0,0 +1,133 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BEHAVIOR_TREE__IS_PATH_VALID_CONDITION_HPP_
+#define NAV2_BEHAVIOR_TREE__IS_PATH_VALID_CONDITION_HPP_
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+
+#include "rclcpp/rclcpp.hpp"
+#include "behaviortree_cpp/condition_node.h"
+#include "nav2_behavior_tree/blackboard_ports.hpp"
+#include "nav2_behavior_tree/bt_profiler.hpp"
+#include "nav2_msgs/srv/is_path_valid.hpp"
+
+namespace nav2_behavior_tree
+{
+
+// Succeeds while the path on the blackboard is still clear on the costmap and the robot
+// within max_deviation meters of it, as the costmap's is_path_valid service tells, so that a
+// Fallback before ComputePathToPose only replans when the path no longer holds. The costmap
+// checks again only the parts of the path near what changed since it was last asked.
+//
+// Fails, and so has the path replanned, when there is no path yet, when it ends farther than
+// goal_tolerance from the goal, as the path to a previous goal does, or when the service
+// doesn't answer within the node_loop_timeout.
+class IsPathValidCondition : public BT::ConditionNode
+{
+public:
+  IsPathValidCondition(const std::string & condition_name, const BT::NodeParameters & params)
+  : BT::ConditionNode(condition_name, params)
+  {
+    getParam<std::string>("service_name", service_name_);
+    getParam<double>("max_deviation", max_deviation_);
+    getParam<double>("goal_tolerance", goal_tolerance_);
+  }
+
+  IsPathValidCondition() = delete;
+
+  // Any BT node that accepts parameters must provide a requiredNodeParameters method
+  static const BT::NodeParameters & requiredNodeParameters()
+  {
+    static BT::NodeParameters params = {
+      {"service_name", "/global_costmap/is_path_valid"}, {"max_deviation", "0.5"},
+      {"goal_tolerance", "0.25"}};
+    return params;
+  }
+
+  void onInit() override
+  {
+    node_ = blackboard()->template get<rclcpp::Node::SharedPtr>("node");
+    node_loop_timeout_ =
+      blackboard()->template get<std::chrono::milliseconds>("node_loop_timeout");
+    client_ = node_->create_client<nav2_msgs::srv::IsPathValid>(service_name_);
+  }
+
+  BT::NodeStatus tick() override
+  {
+    BtProfiler::ScopedTick profile(BtProfiler::fromBlackboard(blackboard()), this);
+
+    PathConstPtr path;
+    if (!ports::path.get(blackboard(), path) || !path || path->poses.empty()) {
+      return BT::NodeStatus::FAILURE;
+    }
+
+    geometry_msgs::msg::PoseStamped::SharedPtr goal;
+    if (ports::goal.get(blackboard(), goal) && goal) {
+      const auto & end = path->poses.back().position;
+      if (std::hypot(end.x - goal->pose.position.x, end.y - goal->pose.position.y) >
+        goal_tolerance_)
+      {
+        return BT::NodeStatus::FAILURE;
+      }
+    }
+
+    if (!client_->service_is_ready()) {
+      RCLCPP_DEBUG(node_->get_logger(), "\"%s\" is not available, replanning",
+        service_name_.c_str());
+      return BT::NodeStatus::FAILURE;
+    }
+
+    auto request = std::make_shared<nav2_msgs::srv::IsPathValid::Request>();
+    request->path = *path;
+    request->max_deviation = max_deviation_;
+    auto future = client_->async_send_request(request);
+    if (rclcpp::spin_until_future_complete(node_, future, node_loop_timeout_) !=
+      rclcpp::executor::FutureReturnCode::SUCCESS)
+    {
+      RCLCPP_WARN(node_->get_logger(), "\"%s\" did not answer, replanning",
+        service_name_.c_str());
+      return BT::NodeStatus::FAILURE;
+    }
+
+    auto response = future.get();
+    if (response->is_valid) {
+      return BT::NodeStatus::SUCCESS;
+    }
+    if (response->blocked_index >= 0) {
+      RCLCPP_INFO(node_->get_logger(), "The path is blocked at pose %d of %zu, replanning",
+        response->blocked_index, path->poses.size());
+    } else if (response->deviated) {
+      RCLCPP_INFO(node_->get_logger(), "The robot is over %.2f m off the path, replanning",
+        max_deviation_);
+    }
+    return BT::NodeStatus::FAILURE;
+  }
+
+private:
+  std::string service_name_;
+  double max_deviation_{0.5};
+  double goal_tolerance_{0.25};
+
+  rclcpp::Node::SharedPtr node_;
+  std::chrono::milliseconds node_loop_timeout_;
+  rclcpp::Client<nav2_msgs::srv::IsPathValid>::SharedPtr client_;
+};
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__IS_PATH_VALID_CONDITION_HPP_
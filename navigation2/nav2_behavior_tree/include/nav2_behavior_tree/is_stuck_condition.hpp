@@ -20,11 +20,11 @@
 #include <cmath>
 #include <atomic>
 #include <memory>
-#include <deque>
 
 #include "rclcpp/rclcpp.hpp"
 #include "behaviortree_cpp/condition_node.h"
-#include "nav_msgs/msg/odometry.hpp"
+#include "nav2_util/motion_history.hpp"
+#include "nav2_behavior_tree/recovery_prefetch.hpp"
 
 using namespace std::chrono_literals; // NOLINT
 
@@ -39,7 +39,8 @@ public:
     is_stuck_(false),
     odom_history_size_(10),
     current_accel_(0.0),
-    brake_accel_limit_(-10.0)
+    brake_accel_limit_(-10.0),
+    prefetch_fraction_(0.5)
   {
   }
 
@@ -54,31 +55,27 @@ public:
   {
     node_ = blackboard()->template get<rclcpp::Node::SharedPtr>("node");
 
-    odom_sub_ = node_->create_subscription<nav_msgs::msg::Odometry>("odom",
-        rclcpp::SystemDefaultsQoS(),
-        std::bind(&IsStuckCondition::onOdomReceived, this, std::placeholders::_1));
+    // The IsStuck nodes of a tree share one history of the odometry, and with it a single
+    // subscription
+    if (!blackboard()->get("motion_history", motion_history_) || !motion_history_) {
+      motion_history_ = std::make_shared<nav2_util::MotionHistory>(odom_history_size_);
+      motion_history_->subscribe(node_, "odom");
+      blackboard()->set<std::shared_ptr<nav2_util::MotionHistory>>(  // NOLINT
+        "motion_history", motion_history_);
+    }
+
+    recovery_prefetch_ = RecoveryPrefetch::fromBlackboard(blackboard());
 
     RCLCPP_DEBUG(node_->get_logger(), "Initialized an IsStuckCondition BT node");
 
     RCLCPP_INFO_ONCE(node_->get_logger(), "Waiting on odometry");
   }
 
-  void onOdomReceived(const typename nav_msgs::msg::Odometry::SharedPtr msg)
+  BT::NodeStatus tick() override
   {
-    RCLCPP_INFO_ONCE(node_->get_logger(), "Got odometry");
-
-    while (odom_history_.size() >= odom_history_size_) {
-      odom_history_.pop_front();
-    }
-
-    odom_history_.push_back(*msg);
-
     // TODO(orduno) #383 Move the state calculation and is stuck to robot class
     updateStates();
-  }
 
-  BT::NodeStatus tick() override
-  {
     // TODO(orduno) #383 Once check for is stuck and state calculations are moved to robot class
     //              this becomes
     // if (robot_state_.isStuck()) {
@@ -108,19 +105,8 @@ public:
   {
     // Approximate acceleration
     // TODO(orduno) #400 Smooth out velocity history for better accel approx.
-    if (odom_history_.size() > 2) {
-      auto curr_odom = odom_history_.end()[-1];
-      double curr_time = static_cast<double>(curr_odom.header.stamp.sec);
-      curr_time += (static_cast<double>(curr_odom.header.stamp.nanosec)) * 1e-9;
-
-      auto prev_odom = odom_history_.end()[-2];
-      double prev_time = static_cast<double>(prev_odom.header.stamp.sec);
-      prev_time += (static_cast<double>(prev_odom.header.stamp.nanosec)) * 1e-9;
-
-      double dt = curr_time - prev_time;
-      double vel_diff = static_cast<double>(
-        curr_odom.twist.twist.linear.x - prev_odom.twist.twist.linear.x);
-      current_accel_ = vel_diff / dt;
+    if (motion_history_->size() > 2) {
+      current_accel_ = motion_history_->acceleration();
     }
 
     is_stuck_ = isStuck();
@@ -142,6 +128,12 @@ public:
       return true;
     }
 
+    // A deceleration part way to the limit makes a recovery likely soon, so the recovery
+    // servers get ready for it before the robot is stuck
+    if (current_accel_ < prefetch_fraction_ * brake_accel_limit_) {
+      recovery_prefetch_->request();
+    }
+
     return false;
   }
 
@@ -155,17 +147,19 @@ private:
 
   std::atomic<bool> is_stuck_;
 
-  // Listen to odometry
-  rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
-  // Store history of odometry measurements
-  std::deque<nav_msgs::msg::Odometry> odom_history_;
-  std::deque<nav_msgs::msg::Odometry>::size_type odom_history_size_;
+  // History of odometry measurements, shared through the blackboard
+  std::shared_ptr<nav2_util::MotionHistory> motion_history_;
+  size_t odom_history_size_;
 
   // Calculated states
   double current_accel_;
 
   // Robot specific paramters
   double brake_accel_limit_;
+
+  // The fraction of the brake limit a deceleration beyond which asks for a recovery prefetch
+  double prefetch_fraction_;
+  std::shared_ptr<RecoveryPrefetch> recovery_prefetch_;
 };
 
 }  // namespace nav2_behavior_tree
@@ -16,9 +16,12 @@
 #define NAV2_BEHAVIOR_TREE__RATE_CONTROLLER_NODE_HPP_
 
 #include <chrono>
+#include <memory>
 #include <string>
 
 #include "behaviortree_cpp/decorator_node.h"
+#include "nav2_util/loop_rate.hpp"
+#include "rclcpp/rclcpp.hpp"
 
 namespace nav2_behavior_tree
 {
@@ -44,7 +47,9 @@ public:
 private:
   BT::NodeStatus tick() override;
 
-  std::chrono::time_point<std::chrono::high_resolution_clock> start_;
+  // The period is kept on the clock of the tree's node, so it follows /clock on sim time
+  std::unique_ptr<nav2_util::LoopClock> clock_;
+  std::chrono::nanoseconds start_;
   double period_;
 };
 
@@ -55,15 +60,22 @@ inline BT::NodeStatus RateController::tick()
   if (status() == BT::NodeStatus::IDLE) {
     // Reset the starting point since we're starting a new iteration of
     // the rate controller (moving from IDLE to RUNNING)
-    start_ = std::chrono::high_resolution_clock::now();
+    if (!clock_) {
+      rclcpp::Node::SharedPtr node;
+      if (blackboard() && blackboard()->get("node", node) && node) {
+        clock_ = std::make_unique<nav2_util::LoopClock>(node->get_clock());
+      } else {
+        clock_ = std::make_unique<nav2_util::LoopClock>();
+      }
+    }
+    start_ = clock_->now();
     first_time = true;
   }
 
   setStatus(BT::NodeStatus::RUNNING);
 
   // Determine how long its been since we've started this iteration
-  auto now = std::chrono::high_resolution_clock::now();
-  auto elapsed = now - start_;
+  auto elapsed = clock_->now() - start_;
 
   // Now, get that in seconds
   typedef std::chrono::duration<float> float_seconds;
@@ -80,7 +92,7 @@ inline BT::NodeStatus RateController::tick()
 
       case BT::NodeStatus::SUCCESS:
         child_node_->setStatus(BT::NodeStatus::IDLE);
-        start_ = std::chrono::high_resolution_clock::now();  // Reset the timer
+        start_ = clock_->now();  // Reset the timer
         return BT::NodeStatus::SUCCESS;
 
       case BT::NodeStatus::FAILURE:
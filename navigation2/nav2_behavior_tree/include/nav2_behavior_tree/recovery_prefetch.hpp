@@ -0,0 +1,91 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BEHAVIOR_TREE__RECOVERY_PREFETCH_HPP_
+#define NAV2_BEHAVIOR_TREE__RECOVERY_PREFETCH_HPP_
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "rclcpp/rclcpp.hpp"
+#include "behaviortree_cpp/blackboard/blackboard.h"
+#include "std_msgs/msg/empty.hpp"
+
+namespace nav2_behavior_tree
+{
+
+/**
+ * @brief Asks the recovery servers to get ready for a recovery that looks likely soon
+ *
+ * A request is an empty message on the recovery_prefetch topic. The recoveries take it to
+ * convert their latest costmap, look up the robot's pose and rasterize its footprint, so the
+ * first cycle of a recovery sent shortly after does none of this. Requests closer together
+ * than min_period are dropped, so nodes can ask on every tick a failure looks near.
+ */
+class RecoveryPrefetch
+{
+public:
+  explicit RecoveryPrefetch(
+    const rclcpp::Node::SharedPtr & node,
+    std::chrono::steady_clock::duration min_period = std::chrono::seconds(1))
+  : min_period_(min_period)
+  {
+    publisher_ = node->create_publisher<std_msgs::msg::Empty>("recovery_prefetch", 1);
+  }
+
+  /**
+   * @brief The prefetcher shared by the nodes of the tree on this blackboard, made on first use
+   */
+  static std::shared_ptr<RecoveryPrefetch> fromBlackboard(const BT::Blackboard::Ptr & blackboard)
+  {
+    std::shared_ptr<RecoveryPrefetch> prefetch;
+    if (!blackboard->get("recovery_prefetch", prefetch) || !prefetch) {
+      auto node = blackboard->get<rclcpp::Node::SharedPtr>("node");
+      prefetch = std::make_shared<RecoveryPrefetch>(node);
+      blackboard->set<std::shared_ptr<RecoveryPrefetch>>("recovery_prefetch", prefetch);  // NOLINT
+    }
+    return prefetch;
+  }
+
+  /**
+   * @brief Ask for a prefetch, unless one was asked for within min_period
+   */
+  void request()
+  {
+    auto now = std::chrono::steady_clock::now();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (requested_ && now - last_request_ < min_period_) {
+        return;
+      }
+      requested_ = true;
+      last_request_ = now;
+    }
+    publisher_->publish(std_msgs::msg::Empty());
+  }
+
+private:
+  rclcpp::Publisher<std_msgs::msg::Empty>::SharedPtr publisher_;
+  std::chrono::steady_clock::duration min_period_;
+
+  std::mutex mutex_;
+  bool requested_{false};
+  std::chrono::steady_clock::time_point last_request_;
+};
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__RECOVERY_PREFETCH_HPP_
@@ -0,0 +1,156 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BEHAVIOR_TREE__SPECULATIVE_REPLANNING_NODE_HPP_
+#define NAV2_BEHAVIOR_TREE__SPECULATIVE_REPLANNING_NODE_HPP_
+
+#include <chrono>
+#include <string>
+
+#include "behaviortree_cpp/decorator_node.h"
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav2_behavior_tree/blackboard_ports.hpp"
+#include "rclcpp/time.hpp"
+
+namespace nav2_behavior_tree
+{
+
+// Keeps its child, a planning subtree such as ComputePathToPose, running back to back: as soon
+// as one plan completes, the next one starts, at most max_hz times a second. Once a path has
+// been planned for the current goal, the node returns SUCCESS while the next plan is under
+// way, so that the nodes after it, such as FollowPath, go on with the newest path.
+//
+// A plan is discarded, and the path it wrote to the blackboard put back, if the goal changed
+// while it was computed or if it is older than the path it would replace. It only runs in the
+// background with the bt_navigator's async_actions, otherwise the child waits in every tick.
+class SpeculativeReplanning : public BT::DecoratorNode
+{
+public:
+  SpeculativeReplanning(const std::string & name, const BT::NodeParameters & params)
+  : BT::DecoratorNode(name, params)
+  {
+    double hz = 0.0;
+    getParam<double>("max_hz", hz);
+    period_ = hz > 0.0 ? 1.0 / hz : 0.0;
+  }
+
+  // Any BT node that accepts parameters must provide a requiredNodeParameters method
+  static const BT::NodeParameters & requiredNodeParameters()
+  {
+    static BT::NodeParameters params = {{"max_hz", "0"}};
+    return params;
+  }
+
+  void halt() override
+  {
+    have_path_ = false;
+    DecoratorNode::halt();
+  }
+
+private:
+  BT::NodeStatus tick() override;
+
+  // Whether the plan that just completed is stale and must not replace previous_path_
+  bool isStale(
+    const geometry_msgs::msg::PoseStamped & goal,
+    const nav2_msgs::msg::Path & path) const;
+
+  double period_;
+  std::chrono::steady_clock::time_point launch_time_;
+
+  // Whether a path was accepted for the current goal, and the stamp of the last one
+  bool have_path_{false};
+  builtin_interfaces::msg::Time accepted_stamp_;
+
+  // The goal the running plan is for, and the blackboard as the plan found it, whose path
+  // is shared rather than copied
+  geometry_msgs::msg::PoseStamped launch_goal_;
+  PathConstPtr previous_path_;
+  bool previous_path_updated_{false};
+};
+
+inline bool SpeculativeReplanning::isStale(
+  const geometry_msgs::msg::PoseStamped & goal,
+  const nav2_msgs::msg::Path & path) const
+{
+  if (goal.header.frame_id != launch_goal_.header.frame_id ||
+    goal.pose.position.x != launch_goal_.pose.position.x ||
+    goal.pose.position.y != launch_goal_.pose.position.y ||
+    goal.pose.position.z != launch_goal_.pose.position.z ||
+    goal.pose.orientation.x != launch_goal_.pose.orientation.x ||
+    goal.pose.orientation.y != launch_goal_.pose.orientation.y ||
+    goal.pose.orientation.z != launch_goal_.pose.orientation.z ||
+    goal.pose.orientation.w != launch_goal_.pose.orientation.w)
+  {
+    return true;
+  }
+
+  return have_path_ && rclcpp::Time(path.header.stamp) < rclcpp::Time(accepted_stamp_);
+}
+
+inline BT::NodeStatus SpeculativeReplanning::tick()
+{
+  auto goal = ports::goal.get(blackboard());
+
+  if (status() == BT::NodeStatus::IDLE) {
+    // A new run of the tree, for a new goal
+    have_path_ = false;
+  }
+
+  const BT::NodeStatus pending = have_path_ ? BT::NodeStatus::SUCCESS : BT::NodeStatus::RUNNING;
+  setStatus(BT::NodeStatus::RUNNING);
+
+  if (child_node_->status() == BT::NodeStatus::IDLE) {
+    // Start the next plan, unless the last one started less than a period ago
+    auto now = std::chrono::steady_clock::now();
+    if (have_path_ && std::chrono::duration<double>(now - launch_time_).count() < period_) {
+      return pending;
+    }
+    launch_time_ = now;
+    launch_goal_ = *goal;
+    previous_path_ = ports::path.get(blackboard());
+    previous_path_updated_ = ports::path_updated.get(blackboard());
+  }
+
+  const BT::NodeStatus child_state = child_node_->executeTick();
+
+  switch (child_state) {
+    case BT::NodeStatus::RUNNING:
+      return pending;
+
+    case BT::NodeStatus::SUCCESS:
+      {
+        child_node_->setStatus(BT::NodeStatus::IDLE);
+        auto path = ports::path.get(blackboard());
+        if (isStale(*goal, *path)) {
+          ports::path.set(blackboard(), previous_path_);
+          ports::path_updated.set(blackboard(), previous_path_updated_);
+          return pending;
+        }
+        have_path_ = true;
+        accepted_stamp_ = path->header.stamp;
+        return BT::NodeStatus::SUCCESS;
+      }
+
+    case BT::NodeStatus::FAILURE:
+    default:
+      // Keep following the last path while the next plan is tried
+      child_node_->setStatus(BT::NodeStatus::IDLE);
+      return have_path_ ? BT::NodeStatus::SUCCESS : BT::NodeStatus::FAILURE;
+  }
+}
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__SPECULATIVE_REPLANNING_NODE_HPP_
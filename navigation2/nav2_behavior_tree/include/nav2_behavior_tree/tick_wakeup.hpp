@@ -0,0 +1,63 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BEHAVIOR_TREE__TICK_WAKEUP_HPP_
+#define NAV2_BEHAVIOR_TREE__TICK_WAKEUP_HPP_
+
+#include <memory>
+#include <mutex>
+
+#include "rclcpp/rclcpp.hpp"
+
+namespace nav2_behavior_tree
+{
+
+// Lets the nodes of an event-driven tree, and anything else that changes what the tree
+// would do, wake the BehaviorTreeEngine between ticks. The engine waits by spinning the tree's
+// ROS node on executor, which notify interrupts.
+class TickWakeup
+{
+public:
+  explicit TickWakeup(std::shared_ptr<rclcpp::executors::SingleThreadedExecutor> executor)
+  : executor_(executor)
+  {
+  }
+
+  // Record that something happened, and have the engine tick again without waiting.
+  // Safe to call from any thread, including from callbacks run by the engine's executor.
+  void notify()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_ = true;
+    executor_->cancel();
+  }
+
+  // Whether notify was called since the last call
+  bool consume()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool pending = pending_;
+    pending_ = false;
+    return pending;
+  }
+
+private:
+  std::mutex mutex_;
+  bool pending_{false};
+  std::shared_ptr<rclcpp::executors::SingleThreadedExecutor> executor_;
+};
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__TICK_WAKEUP_HPP_
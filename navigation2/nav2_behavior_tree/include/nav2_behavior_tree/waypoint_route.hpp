@@ -0,0 +1,145 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BEHAVIOR_TREE__WAYPOINT_ROUTE_HPP_
+#define NAV2_BEHAVIOR_TREE__WAYPOINT_ROUTE_HPP_
+
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "geometry_msgs/msg/point.hpp"
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav2_behavior_tree/blackboard_ports.hpp"
+
+namespace nav2_behavior_tree
+{
+
+/**
+ * @brief The waypoints of a navigation goal, with the plans of the leg being driven and the
+ * leg after it
+ *
+ * The leg after the current waypoint is planned while the robot is still on its way there,
+ * and the path followed runs on through the waypoint along it, so the robot passes the
+ * waypoint without stopping. A goal of one pose is a route with no leg after it.
+ */
+class WaypointRoute
+{
+public:
+  explicit WaypointRoute(std::vector<geometry_msgs::msg::PoseStamped> poses)
+  : poses_(std::move(poses))
+  {
+  }
+
+  size_t size() const {return poses_.size();}
+  size_t currentIndex() const {return current_;}
+
+  // The waypoint the robot is on its way to
+  const geometry_msgs::msg::PoseStamped & current() const {return poses_[current_];}
+
+  // Whether there is a waypoint after the current one, and which it is
+  bool hasNext() const {return current_ + 1 < poses_.size();}
+  const geometry_msgs::msg::PoseStamped & next() const {return poses_[current_ + 1];}
+
+  // Whether the leg after the current waypoint, if any, has a plan
+  bool nextLegPlanned() const {return !hasNext() || next_leg_ != nullptr;}
+
+  // The plan from the robot to the current waypoint
+  void setLeg(PathConstPtr leg)
+  {
+    leg_ = std::move(leg);
+    stitch();
+  }
+
+  // The plan from the current waypoint to the next
+  void setNextLeg(PathConstPtr next_leg)
+  {
+    next_leg_ = std::move(next_leg);
+    stitch();
+  }
+
+  /**
+   * @brief Move on to the next waypoint, the leg after the current one becoming the leg
+   * being driven
+   */
+  void advance()
+  {
+    if (!hasNext()) {
+      return;
+    }
+    current_++;
+    leg_ = std::move(next_leg_);
+    next_leg_.reset();
+    if (leg_) {
+      path_ = leg_;
+    }
+  }
+
+  /**
+   * @brief Whether the robot at position has gone past the current waypoint, its nearest
+   * pose on the path being on the leg after it
+   *
+   * Checks made now and then can miss the robot being within a tolerance of a waypoint it
+   * drives through, but not it being beyond.
+   */
+  bool passedCurrent(const geometry_msgs::msg::Point & position) const
+  {
+    if (!leg_ || !next_leg_ || path_ == leg_) {
+      return false;
+    }
+    size_t nearest = 0;
+    double nearest_sq = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < path_->poses.size(); ++i) {
+      double dx = path_->poses[i].position.x - position.x;
+      double dy = path_->poses[i].position.y - position.y;
+      double d_sq = dx * dx + dy * dy;
+      if (d_sq < nearest_sq) {
+        nearest_sq = d_sq;
+        nearest = i;
+      }
+    }
+    return nearest >= leg_->poses.size();
+  }
+
+  // The path to follow: the leg being driven, and the leg after it once planned
+  PathConstPtr path() const {return path_;}
+
+private:
+  void stitch()
+  {
+    if (!leg_) {
+      return;
+    }
+    if (!next_leg_ || next_leg_->poses.empty()) {
+      path_ = leg_;
+      return;
+    }
+    auto path = std::make_shared<nav2_msgs::msg::Path>(*leg_);
+    // the next leg starts on the waypoint the leg ends on
+    path->poses.insert(path->poses.end(), next_leg_->poses.begin() + 1, next_leg_->poses.end());
+    path_ = path;
+  }
+
+  std::vector<geometry_msgs::msg::PoseStamped> poses_;
+  size_t current_{0};
+
+  PathConstPtr leg_;
+  PathConstPtr next_leg_;
+  PathConstPtr path_;
+};
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__WAYPOINT_ROUTE_HPP_
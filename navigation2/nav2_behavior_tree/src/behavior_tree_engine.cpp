@@ -14,21 +14,30 @@
 
 #include "nav2_behavior_tree/behavior_tree_engine.hpp"
 
+#include <chrono>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "behaviortree_cpp/blackboard/blackboard_local.h"
 #include "nav2_behavior_tree/back_up_action.hpp"
 #include "nav2_behavior_tree/bt_conversions.hpp"
+#include "nav2_behavior_tree/bt_profiler.hpp"
+#include "nav2_behavior_tree/compute_next_leg_action.hpp"
 #include "nav2_behavior_tree/compute_path_to_pose_action.hpp"
 #include "nav2_behavior_tree/follow_path_action.hpp"
 #include "nav2_behavior_tree/goal_reached_condition.hpp"
+#include "nav2_behavior_tree/is_path_valid_condition.hpp"
 #include "nav2_behavior_tree/is_stuck_condition.hpp"
 #include "nav2_behavior_tree/rate_controller_node.hpp"
 #include "nav2_behavior_tree/recovery_node.hpp"
+#include "nav2_behavior_tree/speculative_replanning_node.hpp"
 #include "nav2_behavior_tree/spin_action.hpp"
 #include "nav2_behavior_tree/clear_costmap_service.hpp"
 #include "nav2_behavior_tree/reinitialize_global_localization_service.hpp"
+#include "nav2_behavior_tree/waypoint_route.hpp"
+#include "nav2_util/loop_rate.hpp"
+#include "nav2_util/tracing.hpp"
 #include "rclcpp/rclcpp.hpp"
 
 using namespace std::chrono_literals;
@@ -36,10 +45,32 @@ using namespace std::chrono_literals;
 namespace nav2_behavior_tree
 {
 
-BehaviorTreeEngine::BehaviorTreeEngine()
+namespace
 {
+
+// The clock of the tree's node, which with use_sim_time follows /clock
+rclcpp::Clock::SharedPtr treeClock(const BT::Blackboard::Ptr & blackboard)
+{
+  rclcpp::Node::SharedPtr node;
+  if (blackboard && blackboard->get("node", node) && node) {
+    return node->get_clock();
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+BehaviorTreeEngine::BehaviorTreeEngine(bool event_driven)
+: tick_time_(nav2_util::MetricsRegistry::global().histogram("bt.tick", "Behavior tree tick"))
+{
+  if (event_driven) {
+    executor_ = std::make_shared<rclcpp::executors::SingleThreadedExecutor>();
+    tick_wakeup_ = std::make_shared<TickWakeup>(executor_);
+  }
+
   // Register our custom action nodes so that they can be included in XML description
   factory_.registerNodeType<nav2_behavior_tree::ComputePathToPoseAction>("ComputePathToPose");
+  factory_.registerNodeType<nav2_behavior_tree::ComputeNextLegAction>("ComputeNextLeg");
   factory_.registerNodeType<nav2_behavior_tree::FollowPathAction>("FollowPath");
   factory_.registerNodeType<nav2_behavior_tree::BackUpAction>("BackUp");
   factory_.registerNodeType<nav2_behavior_tree::SpinAction>("Spin");
@@ -50,13 +81,17 @@ BehaviorTreeEngine::BehaviorTreeEngine()
   // Register our custom condition nodes
   factory_.registerNodeType<nav2_behavior_tree::IsStuckCondition>("IsStuck");
   factory_.registerNodeType<nav2_behavior_tree::GoalReachedCondition>("GoalReached");
+  factory_.registerNodeType<nav2_behavior_tree::IsPathValidCondition>("IsPathValid");
 
   // Register our simple condition nodes
   factory_.registerSimpleCondition("initialPoseReceived",
     std::bind(&BehaviorTreeEngine::initialPoseReceived, this, std::placeholders::_1));
+  factory_.registerSimpleCondition("NextLegPlanned",
+    std::bind(&BehaviorTreeEngine::nextLegPlanned, this, std::placeholders::_1));
 
   // Register our custom decorator nodes
   factory_.registerNodeType<nav2_behavior_tree::RateController>("RateController");
+  factory_.registerNodeType<nav2_behavior_tree::SpeculativeReplanning>("SpeculativeReplanning");
 
   // Register our custom control nodes
   factory_.registerNodeType<nav2_behavior_tree::RecoveryNode>("RecoveryNode");
@@ -70,27 +105,15 @@ BehaviorTreeEngine::run(
   std::function<bool()> cancelRequested,
   std::chrono::milliseconds loopTimeout)
 {
-  // Parse the input XML and create the corresponding Behavior Tree
-  BT::Tree tree = BT::buildTreeFromText(factory_, behavior_tree_xml, blackboard);
-
-  rclcpp::WallRate loopRate(loopTimeout);
-  BT::NodeStatus result = BT::NodeStatus::RUNNING;
-
-  // Loop until something happens with ROS or the node completes
-  while (rclcpp::ok() && result == BT::NodeStatus::RUNNING) {
-    if (cancelRequested()) {
-      tree.root_node->halt();
-      return BtStatus::CANCELED;
-    }
-
-    onLoop();
-
-    result = tree.root_node->executeTick();
-
-    loopRate.sleep();
+  auto & tree = trees_[std::make_pair(blackboard.get(), behavior_tree_xml)];
+  if (!tree) {
+    // Parse the input XML and create the corresponding Behavior Tree
+    tree = buildTree(behavior_tree_xml, blackboard);
+  } else {
+    resetTree(tree->root_node);
   }
 
-  return (result == BT::NodeStatus::SUCCESS) ? BtStatus::SUCCEEDED : BtStatus::FAILED;
+  return tickUntilDone(tree->root_node, onLoop, cancelRequested, loopTimeout);
 }
 
 BtStatus
@@ -100,32 +123,109 @@ BehaviorTreeEngine::run(
   std::function<bool()> cancelRequested,
   std::chrono::milliseconds loopTimeout)
 {
-  rclcpp::WallRate loopRate(loopTimeout);
+  return tickUntilDone(tree->root_node, onLoop, cancelRequested, loopTimeout);
+}
+
+BtStatus
+BehaviorTreeEngine::tickUntilDone(
+  BT::TreeNode * root_node,
+  std::function<void()> onLoop,
+  std::function<bool()> cancelRequested,
+  std::chrono::milliseconds loopTimeout)
+{
+  auto clock = std::make_shared<nav2_util::LoopClock>(treeClock(root_node->blackboard()));
+  nav2_util::LoopRate loopRate(clock, 1.0 / std::chrono::duration<double>(loopTimeout).count());
   BT::NodeStatus result = BT::NodeStatus::RUNNING;
 
+  // Events from before the tree started are seen by its first tick
+  if (tick_wakeup_) {
+    tick_wakeup_->consume();
+  }
+
   // Loop until something happens with ROS or the node completes
   while (rclcpp::ok() && result == BT::NodeStatus::RUNNING) {
+    auto deadline = clock->now() + loopTimeout;
+
     if (cancelRequested()) {
-      tree->root_node->halt();
+      root_node->halt();
       return BtStatus::CANCELED;
     }
 
     onLoop();
 
-    result = tree->root_node->executeTick();
+    {
+      nav2_util::ScopedTimer timer(tick_time_);
+      BtProfiler::ScopedTick profile(BtProfiler::fromBlackboard(root_node->blackboard()),
+        root_node);
+      NAV2_TRACEPOINT1(bt_tick_start, root_node);
+      result = root_node->executeTick();
+      NAV2_TRACEPOINT2(bt_tick_end, root_node, static_cast<int>(result));
+    }
 
-    loopRate.sleep();
+    if (result != BT::NodeStatus::RUNNING) {
+      break;
+    }
+
+    if (tick_wakeup_) {
+      waitForEvent(root_node->blackboard(), *clock, deadline);
+    } else {
+      loopRate.sleep();
+    }
   }
 
   return (result == BT::NodeStatus::SUCCESS) ? BtStatus::SUCCEEDED : BtStatus::FAILED;
 }
 
+void
+BehaviorTreeEngine::waitForEvent(
+  const BT::Blackboard::Ptr & blackboard,
+  nav2_util::LoopClock & clock,
+  std::chrono::nanoseconds deadline)
+{
+  // The tree's nodes spin its node themselves while they tick, so it is only added to the
+  // executor for the wait. Without a node, the executor still waits for notify.
+  rclcpp::Node::SharedPtr node;
+  if (blackboard && blackboard->get("node", node) && node) {
+    executor_->add_node(node, false);
+  }
+
+  if (!tick_wakeup_->consume()) {
+    clock.waitUntil(deadline, [this](std::chrono::nanoseconds timeout) {
+        executor_->spin_once(timeout);
+        return tick_wakeup_->consume();
+      });
+  }
+
+  if (node) {
+    executor_->remove_node(node, false);
+  }
+}
+
 BT::Tree
 BehaviorTreeEngine::buildTreeFromText(std::string & xml_string, BT::Blackboard::Ptr blackboard)
 {
+  // The nodes pick up the wakeup while they are initialized
+  if (tick_wakeup_) {
+    blackboard->set<std::shared_ptr<TickWakeup>>("tick_wakeup", tick_wakeup_);  // NOLINT
+  }
   return BT::buildTreeFromText(factory_, xml_string, blackboard);
 }
 
+std::unique_ptr<BT::Tree>
+BehaviorTreeEngine::buildTree(const std::string & xml_string, BT::Blackboard::Ptr blackboard)
+{
+  std::string xml = xml_string;
+  BT::Tree temp_tree = buildTreeFromText(xml, blackboard);
+
+  // Unfortunately, the BT library provides the tree as a struct instead of a pointer. So, we will
+  // create a new BT::Tree ourselves and move the data over
+  auto tree = std::make_unique<BT::Tree>();
+  tree->root_node = temp_tree.root_node;
+  tree->nodes = std::move(temp_tree.nodes);
+  temp_tree.root_node = nullptr;
+  return tree;
+}
+
 BT::NodeStatus
 BehaviorTreeEngine::initialPoseReceived(BT::TreeNode & tree_node)
 {
@@ -133,4 +233,14 @@ BehaviorTreeEngine::initialPoseReceived(BT::TreeNode & tree_node)
   return initPoseReceived ? BT::NodeStatus::SUCCESS : BT::NodeStatus::FAILURE;
 }
 
+BT::NodeStatus
+BehaviorTreeEngine::nextLegPlanned(BT::TreeNode & tree_node)
+{
+  std::shared_ptr<WaypointRoute> route;
+  if (!ports::route.get(tree_node.blackboard(), route) || !route || route->nextLegPlanned()) {
+    return BT::NodeStatus::SUCCESS;
+  }
+  return BT::NodeStatus::FAILURE;
+}
+
 }  // namespace nav2_behavior_tree
@@ -0,0 +1,228 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_behavior_tree/bt_profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nav2_behavior_tree
+{
+
+namespace
+{
+
+double toMs(int64_t ns)
+{
+  return ns / 1e6;
+}
+
+void storeMax(std::atomic<int64_t> & max, int64_t value)
+{
+  // only the tree's thread writes, so there is no race between the load and the store
+  if (value > max.load(std::memory_order_relaxed)) {
+    max.store(value, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace
+
+BtProfiler::BtProfiler(BT::TreeNode * root_node, size_t capacity)
+: BT::StatusChangeLogger(root_node), start_(Clock::now()), ring_(std::max<size_t>(capacity, 1))
+{
+  BT::applyRecursiveVisitor(root_node, [this](BT::TreeNode * node) {
+      node_index_[node] = static_cast<int>(nodes_.size());
+      nodes_.emplace_back(std::make_unique<NodeStats>());
+      nodes_.back()->name = node->name();
+    });
+}
+
+BtProfiler *
+BtProfiler::fromBlackboard(const BT::Blackboard::Ptr & blackboard)
+{
+  std::shared_ptr<BtProfiler> profiler;
+  if (!blackboard || !blackboard->get("bt_profiler", profiler)) {
+    return nullptr;
+  }
+  return profiler.get();
+}
+
+int64_t
+BtProfiler::now() const
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_).count();
+}
+
+int
+BtProfiler::nodeIndex(const BT::TreeNode * node) const
+{
+  auto it = node_index_.find(node);
+  return it == node_index_.end() ? -1 : it->second;
+}
+
+void
+BtProfiler::callback(
+  BT::Duration /*timestamp*/, const BT::TreeNode & node,
+  BT::NodeStatus prev_status, BT::NodeStatus status)
+{
+  int index = nodeIndex(&node);
+  if (index < 0) {
+    return;
+  }
+
+  NodeStats & stats = *nodes_[index];
+  int64_t time = now();
+  int64_t duration = time - stats.status_since_ns;
+
+  stats.transitions.fetch_add(1, std::memory_order_relaxed);
+  if (prev_status == BT::NodeStatus::RUNNING) {
+    stats.running_ns.fetch_add(duration, std::memory_order_relaxed);
+    storeMax(stats.max_running_ns, duration);
+    stats.running_since_ns.store(-1, std::memory_order_relaxed);
+  }
+  if (status == BT::NodeStatus::RUNNING) {
+    stats.running_since_ns.store(time, std::memory_order_relaxed);
+  }
+  stats.status = status;
+  stats.status_since_ns = time;
+
+  push({Event::Type::TRANSITION, static_cast<uint16_t>(index), prev_status, status, time,
+      duration});
+}
+
+void
+BtProfiler::recordTick(const BT::TreeNode * node, Clock::time_point start)
+{
+  int index = nodeIndex(node);
+  if (index < 0) {
+    return;
+  }
+
+  NodeStats & stats = *nodes_[index];
+  int64_t time = now();
+  int64_t duration =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+  stats.ticks.fetch_add(1, std::memory_order_relaxed);
+  stats.tick_ns.fetch_add(duration, std::memory_order_relaxed);
+  storeMax(stats.max_tick_ns, duration);
+
+  push({Event::Type::TICK, static_cast<uint16_t>(index), stats.status, stats.status, time,
+      duration});
+}
+
+void
+BtProfiler::push(const Event & event)
+{
+  // Each slot is a sequence lock: odd while it is written, then twice the index of the event
+  // plus two, so that a reader can tell both a torn event and one already overwritten
+  uint64_t index = head_.load(std::memory_order_relaxed);
+  Slot & slot = ring_[index % ring_.size()];
+  slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.event = event;
+  slot.sequence.store(2 * index + 2, std::memory_order_release);
+  head_.store(index + 1, std::memory_order_release);
+}
+
+std::string
+BtProfiler::summary() const
+{
+  struct Line
+  {
+    int64_t worst_ns;
+    std::string text;
+  };
+  std::vector<Line> lines;
+
+  int64_t time = now();
+  char buffer[512];
+  for (const auto & stats : nodes_) {
+    uint64_t transitions = stats->transitions.load(std::memory_order_relaxed);
+    uint64_t ticks = stats->ticks.load(std::memory_order_relaxed);
+    if (!transitions && !ticks) {
+      continue;
+    }
+
+    int64_t running_since = stats->running_since_ns.load(std::memory_order_relaxed);
+    int64_t running_for = running_since < 0 ? 0 : time - running_since;
+    int64_t max_running = std::max(stats->max_running_ns.load(std::memory_order_relaxed),
+        running_for);
+    int64_t max_tick = stats->max_tick_ns.load(std::memory_order_relaxed);
+
+    snprintf(buffer, sizeof(buffer),
+        "%s: %llu ticks, %.3f ms in tick (max %.3f ms), %llu transitions, "
+        "%.3f ms RUNNING (max %.3f ms)",
+        stats->name.c_str(), static_cast<unsigned long long>(ticks),  // NOLINT
+        toMs(stats->tick_ns.load(std::memory_order_relaxed)), toMs(max_tick),
+        static_cast<unsigned long long>(transitions),  // NOLINT
+        toMs(stats->running_ns.load(std::memory_order_relaxed) + running_for), toMs(max_running));
+    std::string text(buffer);
+    if (running_since >= 0) {
+      snprintf(buffer, sizeof(buffer), ", RUNNING for %.3f ms", toMs(running_for));
+      text += buffer;
+    }
+    lines.push_back({std::max(max_running, max_tick), text});
+  }
+
+  std::stable_sort(lines.begin(), lines.end(), [](const Line & a, const Line & b) {
+      return a.worst_ns > b.worst_ns;
+    });
+
+  std::string result;
+  for (const auto & line : lines) {
+    result += line.text + "\n";
+  }
+  return result;
+}
+
+std::string
+BtProfiler::recent(int64_t since_ns) const
+{
+  uint64_t head = head_.load(std::memory_order_acquire);
+  uint64_t first = head > ring_.size() ? head - ring_.size() : 0;
+
+  std::string result;
+  char buffer[512];
+  for (uint64_t index = first; index < head; ++index) {
+    const Slot & slot = ring_[index % ring_.size()];
+    uint64_t before = slot.sequence.load(std::memory_order_acquire);
+    Event event = slot.event;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (before != 2 * index + 2 || slot.sequence.load(std::memory_order_relaxed) != before) {
+      // overwritten by the tree while it was read
+      continue;
+    }
+    if (event.time_ns < since_ns) {
+      continue;
+    }
+
+    const std::string & name = nodes_[event.node]->name;
+    if (event.type == Event::Type::TICK) {
+      snprintf(buffer, sizeof(buffer), "%.6f s %s: tick of %.3f ms\n",
+        event.time_ns / 1e9, name.c_str(), toMs(event.duration_ns));
+    } else {
+      snprintf(buffer, sizeof(buffer), "%.6f s %s: %s -> %s after %.3f ms\n",
+        event.time_ns / 1e9, name.c_str(), BT::toStr(event.prev_status),
+        BT::toStr(event.status), toMs(event.duration_ns));
+    }
+    result += buffer;
+  }
+  return result;
+}
+
+}  // namespace nav2_behavior_tree
@@ -14,6 +14,7 @@
 
 #include <string>
 #include "nav2_behavior_tree/recovery_node.hpp"
+#include "nav2_behavior_tree/recovery_prefetch.hpp"
 
 namespace nav2_behavior_tree
 {
@@ -57,6 +58,9 @@ BT::NodeStatus RecoveryNode::tick()
           {
             // tick second child
             if (retry_count_ <= number_of_retries_) {
+              // The recovery often starts with a costmap clear, so the recovery servers get
+              // ready for the motion after it while that runs
+              RecoveryPrefetch::fromBlackboard(blackboard())->request();
               current_child_idx_++;
               break;
             } else {
@@ -0,0 +1,148 @@
+# Copyright (c) 2019 Intel Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Launches the same nodes as nav2_bringup_launch.py, with the servers loaded as components
+# into a single multi-threaded process instead of a process each.
+
+import os
+
+from ament_index_python.packages import get_package_prefix
+from ament_index_python.packages import get_package_share_directory
+
+import launch.actions
+import launch_ros.actions
+from launch_ros.descriptions import ComposableNode
+
+from nav2_common.launch import RewrittenYaml
+
+
+def generate_launch_description():
+    # Get the launch directory
+    launch_dir = os.path.join(get_package_share_directory('nav2_bringup'), 'launch')
+
+    # Create the launch configuration variables
+    map_yaml_file = launch.substitutions.LaunchConfiguration('map')
+    use_sim_time = launch.substitutions.LaunchConfiguration('use_sim_time')
+    params_file = launch.substitutions.LaunchConfiguration('params')
+    bt_xml_file = launch.substitutions.LaunchConfiguration('bt_xml_file')
+    autostart = launch.substitutions.LaunchConfiguration('autostart')
+
+    stdout_linebuf_envvar = launch.actions.SetEnvironmentVariable(
+        'RCUTILS_CONSOLE_STDOUT_LINE_BUFFERED', '1')
+
+    # Create our own temporary YAML files that include substitutions
+    param_substitutions = {
+        'use_sim_time': use_sim_time,
+        'yaml_filename': map_yaml_file,
+        'bt_xml_filename': bt_xml_file,
+        'autostart': autostart
+    }
+
+    configured_params = RewrittenYaml(
+        source_file=params_file, rewrites=param_substitutions,
+        convert_types=True)
+
+    # Declare the launch arguments
+    declare_map_yaml_cmd = launch.actions.DeclareLaunchArgument(
+        'map',
+        default_value=os.path.join(launch_dir, 'turtlebot3_world.yaml'),
+        description='Full path to map file to load')
+
+    declare_use_sim_time_cmd = launch.actions.DeclareLaunchArgument(
+        'use_sim_time',
+        default_value='false',
+        description='Use simulation (Gazebo) clock if true')
+
+    declare_params_file_cmd = launch.actions.DeclareLaunchArgument(
+        'params',
+        default_value=os.path.join(launch_dir, 'nav2_params.yaml'),
+        description='Full path to the ROS2 parameters file to use for all launched nodes')
+
+    declare_autostart_cmd = launch.actions.DeclareLaunchArgument(
+        'autostart', default_value='true',
+        description='Automatically startup the nav2 stack')
+
+    declare_bt_xml_cmd = launch.actions.DeclareLaunchArgument(
+        'bt_xml_file',
+        default_value=os.path.join(get_package_prefix('nav2_bt_navigator'),
+            'behavior_trees', 'navigate_w_replanning_and_recovery.xml'),
+        description='Full path to the behavior tree xml file to use')
+
+    # Intra-process communication can't carry transient local topics, such as the map, the
+    # costmaps and the AMCL pose, so only the nodes whose topics are all volatile use it
+    intra_process = [{'use_intra_process_comms': True}]
+
+    # The parameters file is given to the container, whose nodes all read it. The node names are
+    # the ones the servers set, since they also name the helper nodes that each server creates.
+    start_container_cmd = launch_ros.actions.ComposableNodeContainer(
+        node_name='nav2_container',
+        node_namespace='',
+        package='rclcpp_components',
+        node_executable='component_container_mt',
+        output='screen',
+        parameters=[configured_params],
+        composable_node_descriptions=[
+            ComposableNode(
+                package='nav2_map_server',
+                node_plugin='nav2_map_server::MapServer'),
+            ComposableNode(
+                package='nav2_amcl',
+                node_plugin='nav2_amcl::AmclNode'),
+            ComposableNode(
+                package='nav2_world_model',
+                node_plugin='nav2_world_model::WorldModel',
+                extra_arguments=intra_process),
+            ComposableNode(
+                package='dwb_controller',
+                node_plugin='dwb_controller::DwbController',
+                extra_arguments=intra_process),
+            ComposableNode(
+                package='nav2_navfn_planner',
+                node_plugin='nav2_navfn_planner::NavfnPlanner',
+                extra_arguments=intra_process),
+            ComposableNode(
+                package='nav2_recoveries',
+                node_plugin='nav2_recoveries::RecoveriesNode',
+                parameters=[{'use_sim_time': use_sim_time}]),
+            ComposableNode(
+                package='nav2_bt_navigator',
+                node_plugin='nav2_bt_navigator::BtNavigator',
+                extra_arguments=intra_process),
+        ])
+
+    start_lifecycle_manager_cmd = launch_ros.actions.Node(
+        package='nav2_lifecycle_manager',
+        node_executable='lifecycle_manager',
+        node_name='lifecycle_manager',
+        output='screen',
+        parameters=[configured_params])
+
+    # Create the launch description and populate
+    ld = launch.LaunchDescription()
+
+    # Set environment variables
+    ld.add_action(stdout_linebuf_envvar)
+
+    # Declare the launch options
+    ld.add_action(declare_map_yaml_cmd)
+    ld.add_action(declare_use_sim_time_cmd)
+    ld.add_action(declare_params_file_cmd)
+    ld.add_action(declare_autostart_cmd)
+    ld.add_action(declare_bt_xml_cmd)
+
+    # Add the actions to launch all of the navigation nodes
+    ld.add_action(start_lifecycle_manager_cmd)
+    ld.add_action(start_container_cmd)
+
+    return ld
@@ -15,17 +15,25 @@
 #ifndef NAV2_BT_NAVIGATOR__BT_NAVIGATOR_HPP_
 #define NAV2_BT_NAVIGATOR__BT_NAVIGATOR_HPP_
 
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "behaviortree_cpp/blackboard/blackboard_local.h"
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "nav2_behavior_tree/behavior_tree_engine.hpp"
+#include "nav2_behavior_tree/blackboard_ports.hpp"
+#include "nav2_behavior_tree/bt_profiler.hpp"
 #include "nav2_util/lifecycle_node.hpp"
+#include "nav2_msgs/action/navigate_through_poses.hpp"
 #include "nav2_msgs/action/navigate_to_pose.hpp"
 #include "nav2_msgs/msg/path.hpp"
 #include "nav2_util/simple_action_server.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
+#include "std_srvs/srv/trigger.hpp"
 
 namespace nav2_bt_navigator
 {
@@ -33,7 +41,7 @@ namespace nav2_bt_navigator
 class BtNavigator : public nav2_util::LifecycleNode
 {
 public:
-  BtNavigator();
+  explicit BtNavigator(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   ~BtNavigator();
 
 protected:
@@ -56,6 +64,30 @@ protected:
   // Goal pose initialization on the blackboard
   void initializeGoalPose();
 
+  using ThroughPosesActionServer =
+    nav2_util::SimpleActionServer<nav2_msgs::action::NavigateThroughPoses>;
+
+  // A second action server, for NavigateThroughPoses, runs the same tree on a route of the
+  // poses, planning each leg while the robot drives the one before
+  std::unique_ptr<ThroughPosesActionServer> through_poses_server_;
+
+  void navigateThroughPoses();
+
+  // Route initialization on the blackboard, false if there are no poses
+  bool initializeRoute();
+
+  // Put the route through poses on the blackboard, its first pose being the goal
+  void setRoute(std::vector<geometry_msgs::msg::PoseStamped> poses);
+
+  // Run the tree for the current goal of server, taking preempts with initialize_goal
+  template<typename ActionT>
+  void navigate(
+    std::unique_ptr<nav2_util::SimpleActionServer<ActionT>> & server,
+    std::function<bool()> initialize_goal);
+
+  // The action servers take turns with the one tree
+  std::mutex navigate_mutex_;
+
   // A subscription and callback to handle the topic-based goal published from rviz
   void onGoalPoseReceived(const geometry_msgs::msg::PoseStamped::SharedPtr pose);
   rclcpp::Subscription<geometry_msgs::msg::PoseStamped>::SharedPtr goal_sub_;
@@ -66,9 +98,6 @@ protected:
   // The goal (on the blackboard) to be passed to ComputePath
   std::shared_ptr<geometry_msgs::msg::PoseStamped> goal_;
 
-  // The path (on the blackboard) to be returned from ComputePath and sent to the FollowPath task
-  std::shared_ptr<nav2_msgs::msg::Path> path_;
-
   // The XML string that defines the Behavior Tree to create
   std::string xml_string_;
 
@@ -78,11 +107,31 @@ protected:
   // The complete behavior tree that results from parsing the incoming XML
   std::unique_ptr<BT::Tree> tree_;
 
+  // With bt_profiling, the record of how the nodes of tree_ spend their time, the service
+  // returning it and the timer logging it
+  std::shared_ptr<nav2_behavior_tree::BtProfiler> profiler_;
+  rclcpp::Service<std_srvs::srv::Trigger>::SharedPtr profile_service_;
+  rclcpp::TimerBase::SharedPtr profile_timer_;
+
+  void dumpProfile(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<std_srvs::srv::Trigger::Request> request,
+    std::shared_ptr<std_srvs::srv::Trigger::Response> response);
+
   // A client that we'll use to send a command message to our own task server
   rclcpp_action::Client<nav2_msgs::action::NavigateToPose>::SharedPtr self_client_;
 
   // A regular, non-spinning ROS node that we can use for calls to the action client
   rclcpp::Node::SharedPtr client_node_;
+
+  // With async_actions, the node the tree's actions and services use instead, and the
+  // executor and thread spinning it
+  rclcpp::Node::SharedPtr async_client_node_;
+  std::unique_ptr<rclcpp::executors::SingleThreadedExecutor> async_executor_;
+  std::unique_ptr<std::thread> async_thread_;
+
+  // The black box channel for the goals navigated to
+  int goal_channel_;
 };
 
 }  // namespace nav2_bt_navigator
@@ -19,19 +19,29 @@
 #include <streambuf>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "nav2_behavior_tree/bt_conversions.hpp"
+#include "nav2_behavior_tree/waypoint_route.hpp"
+#include "nav2_util/black_box.hpp"
 
 namespace nav2_bt_navigator
 {
 
-BtNavigator::BtNavigator()
-: nav2_util::LifecycleNode("bt_navigator", "", true)
+BtNavigator::BtNavigator(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("bt_navigator", "", true, options)
 {
   RCLCPP_INFO(get_logger(), "Creating");
 
   // Declare this node's parameters
   declare_parameter("bt_xml_filename", rclcpp::ParameterValue(std::string("bt_navigator.xml")));
+  declare_parameter("event_driven_ticks", rclcpp::ParameterValue(false));
+  declare_parameter("async_actions", rclcpp::ParameterValue(false));
+  declare_parameter("bt_profiling", rclcpp::ParameterValue(false));
+  declare_parameter("bt_profile_period", rclcpp::ParameterValue(0.0));
+
+  goal_channel_ = nav2_util::BlackBox::global().channel("bt_navigator/goal",
+      "geometry_msgs/msg/PoseStamped");
 }
 
 BtNavigator::~BtNavigator()
@@ -63,25 +73,50 @@ BtNavigator::on_configure(const rclcpp_lifecycle::State & /*state*/)
   // Create an action server that we implement with our navigateToPose method
   action_server_ = std::make_unique<ActionServer>(rclcpp_node_, "NavigateToPose",
       std::bind(&BtNavigator::navigateToPose, this), false);
-
-  // Create the class that registers our custom nodes and executes the BT
-  bt_ = std::make_unique<nav2_behavior_tree::BehaviorTreeEngine>();
-
-  // Create the path that will be returned from ComputePath and sent to FollowPath
+  through_poses_server_ = std::make_unique<ThroughPosesActionServer>(rclcpp_node_,
+      "NavigateThroughPoses", std::bind(&BtNavigator::navigateThroughPoses, this), false);
+
+  // Create the class that registers our custom nodes and executes the BT. When event-driven,
+  // it ticks as soon as a node completes or a preempt or cancel request arrives, and the
+  // loop rate only bounds the time between ticks.
+  bool event_driven_ticks;
+  get_parameter("event_driven_ticks", event_driven_ticks);
+  bt_ = std::make_unique<nav2_behavior_tree::BehaviorTreeEngine>(event_driven_ticks);
+  action_server_->set_request_callback([this]() {bt_->notify();});
+  through_poses_server_->set_request_callback([this]() {bt_->notify();});
+
+  // Create the goal that is passed to ComputePath
   goal_ = std::make_shared<geometry_msgs::msg::PoseStamped>();
-  path_ = std::make_shared<nav2_msgs::msg::Path>();
 
   // Create the blackboard that will be shared by all of the nodes in the tree
   blackboard_ = BT::Blackboard::create<BT::BlackboardLocal>();
 
   // Put items on the blackboard
-  blackboard_->set<geometry_msgs::msg::PoseStamped::SharedPtr>("goal", goal_);  // NOLINT
-  blackboard_->set<nav2_msgs::msg::Path::SharedPtr>("path", path_);  // NOLINT
+  nav2_behavior_tree::ports::goal.set(blackboard_, goal_);
+  // The path returned from ComputePath and sent to FollowPath, empty until the first plan
+  nav2_behavior_tree::ports::path.set(blackboard_, std::make_shared<nav2_msgs::msg::Path>());
   blackboard_->set<rclcpp::Node::SharedPtr>("node", client_node_);  // NOLINT
   blackboard_->set<std::chrono::milliseconds>("node_loop_timeout", std::chrono::milliseconds(10));  // NOLINT
-  blackboard_->set<bool>("path_updated", false);  // NOLINT
+  nav2_behavior_tree::ports::path_updated.set(blackboard_, false);
   blackboard_->set<bool>("initial_pose_received", false);  // NOLINT
 
+  // With async_actions, the action and service nodes of the tree call their servers through a
+  // node spun on a thread of its own, and return RUNNING while they wait instead of spinning
+  // on the tree's thread, so that actions in parallel branches overlap
+  bool async_actions;
+  get_parameter("async_actions", async_actions);
+  if (async_actions) {
+    auto async_options = rclcpp::NodeOptions().arguments(
+      {"--ros-args",
+        std::string("__node:=") + get_name() + "_async_client_node",
+        "--"});
+    async_client_node_ = std::make_shared<rclcpp::Node>("_", async_options);
+    async_executor_ = std::make_unique<rclcpp::executors::SingleThreadedExecutor>();
+    async_executor_->add_node(async_client_node_);
+    async_thread_ = std::make_unique<std::thread>([this]() {async_executor_->spin();});
+    blackboard_->set<rclcpp::Node::SharedPtr>("async_node", async_client_node_);  // NOLINT
+  }
+
   // Get the BT filename to use from the node parameter
   std::string bt_xml_filename;
   get_parameter("bt_xml_filename", bt_xml_filename);
@@ -100,15 +135,34 @@ BtNavigator::on_configure(const rclcpp_lifecycle::State & /*state*/)
   RCLCPP_DEBUG(get_logger(), "Behavior Tree file: '%s'", bt_xml_filename.c_str());
   RCLCPP_DEBUG(get_logger(), "Behavior Tree XML: %s", xml_string_.c_str());
 
-  // Create the Behavior Tree from the XML input (after registering our own node types)
-  BT::Tree temp_tree = bt_->buildTreeFromText(xml_string_, blackboard_);
-
-  // Unfortunately, the BT library provides the tree as a struct instead of a pointer. So, we will
-  // createa new BT::Tree ourselves and move the data over
-  tree_ = std::make_unique<BT::Tree>();
-  tree_->root_node = temp_tree.root_node;
-  tree_->nodes = std::move(temp_tree.nodes);
-  temp_tree.root_node = nullptr;
+  // Create the Behavior Tree from the XML input (after registering our own node types). It is
+  // built once here, connecting the clients of its nodes to their servers, and reset and run
+  // again for every goal.
+  tree_ = bt_->buildTree(xml_string_, blackboard_);
+
+  // With bt_profiling, record the ticks and status transitions of the tree's nodes, which the
+  // dump_bt_profile service returns and which are logged every bt_profile_period seconds
+  bool bt_profiling;
+  get_parameter("bt_profiling", bt_profiling);
+  if (bt_profiling) {
+    profiler_ = std::make_shared<nav2_behavior_tree::BtProfiler>(tree_->root_node);
+    blackboard_->set<std::shared_ptr<nav2_behavior_tree::BtProfiler>>("bt_profiler", profiler_);  // NOLINT
+
+    profile_service_ = create_service<std_srvs::srv::Trigger>("dump_bt_profile",
+        std::bind(&BtNavigator::dumpProfile, this,
+        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    double bt_profile_period;
+    get_parameter("bt_profile_period", bt_profile_period);
+    if (bt_profile_period > 0.0) {
+      profile_timer_ = create_wall_timer(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::duration<double>(bt_profile_period)),
+        [this]() {
+          RCLCPP_INFO(get_logger(), "Behavior tree profile:\n%s", profiler_->summary().c_str());
+        });
+    }
+  }
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -119,6 +173,7 @@ BtNavigator::on_activate(const rclcpp_lifecycle::State & /*state*/)
   RCLCPP_INFO(get_logger(), "Activating");
 
   action_server_->activate();
+  through_poses_server_->activate();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -129,6 +184,7 @@ BtNavigator::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
   RCLCPP_INFO(get_logger(), "Deactivating");
 
   action_server_->deactivate();
+  through_poses_server_->deactivate();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -138,16 +194,27 @@ BtNavigator::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
 {
   RCLCPP_INFO(get_logger(), "Cleaning up");
 
+  profile_timer_.reset();
+  profile_service_.reset();
+  profiler_.reset();
   goal_sub_.reset();
   client_node_.reset();
   self_client_.reset();
   action_server_.reset();
-  path_.reset();
+  through_poses_server_.reset();
   xml_string_.clear();
   tree_.reset();
   blackboard_.reset();
   bt_.reset();
 
+  if (async_thread_) {
+    async_executor_->cancel();
+    async_thread_->join();
+    async_thread_.reset();
+    async_executor_.reset();
+    async_client_node_.reset();
+  }
+
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
@@ -168,54 +235,85 @@ BtNavigator::on_shutdown(const rclcpp_lifecycle::State & /*state*/)
 void
 BtNavigator::navigateToPose()
 {
-  initializeGoalPose();
+  navigate(action_server_, [this]() {
+      initializeGoalPose();
+      return true;
+    });
+}
+
+void
+BtNavigator::navigateThroughPoses()
+{
+  navigate(through_poses_server_, std::bind(&BtNavigator::initializeRoute, this));
+}
+
+template<typename ActionT>
+void
+BtNavigator::navigate(
+  std::unique_ptr<nav2_util::SimpleActionServer<ActionT>> & server,
+  std::function<bool()> initialize_goal)
+{
+  std::lock_guard<std::mutex> lock(navigate_mutex_);
 
-  auto is_canceling = [this]() {
-      if (action_server_ == nullptr) {
+  if (!initialize_goal()) {
+    server->terminate_goals();
+    return;
+  }
+
+  auto is_canceling = [this, &server]() {
+      if (server == nullptr) {
         RCLCPP_DEBUG(get_logger(), "Action server unavailable. Canceling.");
         return true;
       }
 
-      if (!action_server_->is_server_active()) {
+      if (!server->is_server_active()) {
         RCLCPP_DEBUG(get_logger(), "Action server is inactive. Canceling.");
         return true;
       }
 
-      return action_server_->is_cancel_requested();
+      return server->is_cancel_requested();
     };
 
-  auto on_loop = [this]() {
-      if (action_server_->is_preempt_requested()) {
+  bool goal_invalid = false;
+  auto on_loop = [this, &server, &initialize_goal, &goal_invalid]() {
+      if (server->is_preempt_requested()) {
         RCLCPP_INFO(get_logger(), "Received goal preemption request");
-        action_server_->accept_pending_goal();
-        initializeGoalPose();
+        server->accept_pending_goal();
+        goal_invalid = !initialize_goal();
       }
     };
 
+  auto is_canceling_or_invalid = [&is_canceling, &goal_invalid]() {
+      return goal_invalid || is_canceling();
+    };
+
   // Execute the BT that was previously created in the configure step
-  nav2_behavior_tree::BtStatus rc = bt_->run(tree_, on_loop, is_canceling);
+  nav2_behavior_tree::BtStatus rc = bt_->run(tree_, on_loop, is_canceling_or_invalid);
 
   switch (rc) {
     case nav2_behavior_tree::BtStatus::SUCCEEDED:
       RCLCPP_INFO(get_logger(), "Navigation succeeded");
-      action_server_->succeeded_current();
+      server->succeeded_current();
       break;
 
     case nav2_behavior_tree::BtStatus::FAILED:
       RCLCPP_ERROR(get_logger(), "Navigation failed");
-      action_server_->terminate_goals();
+      server->terminate_goals();
       break;
 
     case nav2_behavior_tree::BtStatus::CANCELED:
       RCLCPP_INFO(get_logger(), "Navigation canceled");
-      action_server_->terminate_goals();
-      // Reset the BT so that it can be run again in the future
-      bt_->resetTree(tree_->root_node);
+      server->terminate_goals();
       break;
 
     default:
       throw std::logic_error("Invalid status return from BT");
   }
+
+  // Reset the BT so that the next goal starts from the same state as the first. Actions still
+  // running in the background, such as a speculative plan, are halted first.
+  bt_->haltAllActions(tree_->root_node);
+  bt_->resetTree(tree_->root_node);
 }
 
 void
@@ -226,8 +324,48 @@ BtNavigator::initializeGoalPose()
   RCLCPP_INFO(get_logger(), "Begin navigating from current location to (%.2f, %.2f)",
     goal->pose.pose.position.x, goal->pose.pose.position.y);
 
-  // Update the goal pose on the blackboard
-  *(blackboard_->get<geometry_msgs::msg::PoseStamped::SharedPtr>("goal")) = goal->pose;
+  setRoute({goal->pose});
+}
+
+bool
+BtNavigator::initializeRoute()
+{
+  auto goal = through_poses_server_->get_current_goal();
+  if (goal->poses.empty()) {
+    RCLCPP_ERROR(get_logger(), "Received a route with no poses");
+    return false;
+  }
+
+  RCLCPP_INFO(get_logger(), "Begin navigating from current location through %zu poses to "
+    "(%.2f, %.2f)", goal->poses.size(), goal->poses.back().pose.position.x,
+    goal->poses.back().pose.position.y);
+
+  setRoute(goal->poses);
+  return true;
+}
+
+void
+BtNavigator::setRoute(std::vector<geometry_msgs::msg::PoseStamped> poses)
+{
+  for (const auto & pose : poses) {
+    nav2_util::BlackBox::global().record(goal_channel_, pose);
+  }
+
+  // Update the goal pose on the blackboard, and the route it starts, which a tree that
+  // plans the legs of a route ahead uses
+  *nav2_behavior_tree::ports::goal.get(blackboard_) = poses.front();
+  nav2_behavior_tree::ports::route.set(blackboard_,
+    std::make_shared<nav2_behavior_tree::WaypointRoute>(std::move(poses)));
+}
+
+void
+BtNavigator::dumpProfile(
+  const std::shared_ptr<rmw_request_id_t>/*request_header*/,
+  const std::shared_ptr<std_srvs::srv::Trigger::Request>/*request*/,
+  std::shared_ptr<std_srvs::srv::Trigger::Response> response)
+{
+  response->success = true;
+  response->message = profiler_->summary() + "\nRecent events:\n" + profiler_->recent();
 }
 
 void
@@ -239,3 +377,7 @@ BtNavigator::onGoalPoseReceived(const geometry_msgs::msg::PoseStamped::SharedPtr
 }
 
 }  // namespace nav2_bt_navigator
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_bt_navigator::BtNavigator)
@@ -33,7 +33,9 @@ macro(nav2_package)
   endif()
 
   if(CMAKE_COMPILER_IS_GNUCXX OR CMAKE_CXX_COMPILER_ID MATCHES "Clang")
-    add_compile_options(-Wall -Wextra -Wpedantic -Werror -Wno-deprecated-declarations -fPIC)
+    # host compiler flags, which nvcc does not take for the CUDA sources some packages have
+    set(nav2_host_flags -Wall -Wextra -Wpedantic -Werror -Wno-deprecated-declarations -fPIC)
+    add_compile_options("$<$<NOT:$<COMPILE_LANGUAGE:CUDA>>:${nav2_host_flags}>")
   endif()
 
   option(COVERAGE_ENABLED "Enable code coverage" FALSE)
@@ -42,4 +44,14 @@ macro(nav2_package)
     set(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} --coverage")
     set(CMAKE_SHARED_LINKER_FLAGS "${CMAKE_SHARED_LINKER_FLAGS} --coverage")
   endif()
+
+  # Static tracepoints, see nav2_util/tracing.hpp; nops unless a tracer attaches
+  option(NAV2_TRACING "Compile in USDT tracepoints where sys/sdt.h is available" TRUE)
+  if(NAV2_TRACING)
+    include(CheckIncludeFileCXX)
+    check_include_file_cxx(sys/sdt.h NAV2_HAVE_SYS_SDT_H)
+    if(NAV2_HAVE_SYS_SDT_H)
+      add_definitions(-DNAV2_TRACING_USDT)
+    endif()
+  endif()
 endmacro()
@@ -0,0 +1,151 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Times the layer combine kernels against their scalar versions on a grid
+// that is mostly free and unknown, like a real costmap, or on the master grid
+// of a costmap dump, combined with one of its layers if --layer names one.
+//
+// Usage:
+//   costmap_combine_benchmark [--size <cells>] [--repeat <n>]
+//                             [--dump <file> [--layer <name>]]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_combine.hpp"
+#include "nav2_costmap_2d/costmap_dump.hpp"
+
+typedef void (* CombineFn)(unsigned char *, const unsigned char *, size_t);
+
+static std::vector<unsigned char> makeGrid(size_t cells, std::mt19937 & rng)
+{
+  std::uniform_int_distribution<int> kind(0, 99);
+  std::uniform_int_distribution<int> cost(1, 252);
+  std::vector<unsigned char> grid(cells);
+  for (auto & cell : grid) {
+    int k = kind(rng);
+    if (k < 60) {
+      cell = nav2_costmap_2d::FREE_SPACE;
+    } else if (k < 85) {
+      cell = nav2_costmap_2d::NO_INFORMATION;
+    } else if (k < 90) {
+      cell = nav2_costmap_2d::LETHAL_OBSTACLE;
+    } else {
+      cell = cost(rng);
+    }
+  }
+  return grid;
+}
+
+static double timeKernel(
+  CombineFn combine, const std::vector<unsigned char> & master,
+  const std::vector<unsigned char> & layer, unsigned int size_x, unsigned int size_y, int repeat)
+{
+  std::vector<unsigned char> work(master.size());
+  double total = 0.0;
+  for (int r = 0; r < repeat; ++r) {
+    memcpy(work.data(), master.data(), master.size());
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int j = 0; j < size_y; ++j) {
+      combine(work.data() + j * size_x, layer.data() + j * size_x, size_x);
+    }
+    total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  return total / repeat;
+}
+
+int main(int argc, char ** argv)
+{
+  unsigned int size = 1000;
+  int repeat = 50;
+  std::string dump_file;
+  std::string layer_name;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--size")) {
+      size = atoi(argv[i + 1]);
+    } else if (!strcmp(argv[i], "--repeat")) {
+      repeat = atoi(argv[i + 1]);
+    } else if (!strcmp(argv[i], "--dump")) {
+      dump_file = argv[i + 1];
+    } else if (!strcmp(argv[i], "--layer")) {
+      layer_name = argv[i + 1];
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  unsigned int size_x = size;
+  unsigned int size_y = size;
+  std::mt19937 rng(42);
+  std::vector<unsigned char> master;
+  std::vector<unsigned char> layer;
+  if (!dump_file.empty()) {
+    std::unique_ptr<nav2_costmap_2d::CostmapDump> dump;
+    try {
+      dump = std::make_unique<nav2_costmap_2d::CostmapDump>(dump_file);
+    } catch (std::runtime_error & e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+    }
+    size_x = dump->sizeX();
+    size_y = dump->sizeY();
+    size_t cells = static_cast<size_t>(size_x) * size_y;
+    master.assign(dump->costs(), dump->costs() + cells);
+    if (!layer_name.empty()) {
+      auto costs = static_cast<const unsigned char *>(
+        dump->find({layer_name, size_x, size_y, 0, 1, nullptr}));
+      if (!costs) {
+        fprintf(stderr, "No layer %s in %s\n", layer_name.c_str(), dump_file.c_str());
+        return 1;
+      }
+      layer.assign(costs, costs + cells);
+    } else {
+      layer = makeGrid(cells, rng);
+    }
+  } else {
+    master = makeGrid(size * size, rng);
+    layer = makeGrid(size * size, rng);
+  }
+
+  struct Kernel
+  {
+    const char * name;
+    CombineFn scalar;
+    CombineFn vector;
+  };
+  const Kernel kernels[] = {
+    {"max", nav2_costmap_2d::combineMaxScalar, nav2_costmap_2d::combineMax},
+    {"overwrite", nav2_costmap_2d::combineOverwriteScalar, nav2_costmap_2d::combineOverwrite},
+    {"addition", nav2_costmap_2d::combineAdditionScalar, nav2_costmap_2d::combineAddition},
+  };
+
+  printf("%ux%u cells, %d repeats\n", size_x, size_y, repeat);
+  printf("%-10s %12s %12s %8s\n", "kernel", "scalar ms", "vector ms", "speedup");
+  for (const Kernel & kernel : kernels) {
+    double scalar = timeKernel(kernel.scalar, master, layer, size_x, size_y, repeat);
+    double vector = timeKernel(kernel.vector, master, layer, size_x, size_y, repeat);
+    printf("%-10s %12.3f %12.3f %7.1fx\n", kernel.name, scalar * 1e3, vector * 1e3,
+      scalar / vector);
+  }
+  return 0;
+}
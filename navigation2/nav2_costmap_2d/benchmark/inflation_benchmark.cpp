@@ -0,0 +1,148 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Times the inflation kernel on a grid with scattered obstacles: the cost
+// lookups of the wavefront from the flat kernel against the arrays of row
+// pointers it replaced, and the stamps with the radius fixed at compile time
+// against the generic one.
+//
+// Usage:
+//   costmap_inflation_benchmark [--size <cells>] [--radius <cells>]
+//                               [--obstacles <percent>] [--repeat <n>]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/inflation_kernel.hpp"
+
+using nav2_costmap_2d::InflationKernel;
+
+static unsigned char costOf(double distance)
+{
+  if (distance == 0.0) {
+    return nav2_costmap_2d::LETHAL_OBSTACLE;
+  }
+  return static_cast<unsigned char>(252 * std::exp(-0.3 * distance));
+}
+
+template<typename Fn>
+static double timeRepeated(int repeat, Fn fn)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeat; ++r) {
+    fn();
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeat;
+}
+
+int main(int argc, char ** argv)
+{
+  int size = 1000;
+  int radius = 11;
+  int percent = 2;
+  int repeat = 20;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--size")) {
+      size = atoi(argv[i + 1]);
+    } else if (!strcmp(argv[i], "--radius")) {
+      radius = atoi(argv[i + 1]);
+    } else if (!strcmp(argv[i], "--obstacles")) {
+      percent = atoi(argv[i + 1]);
+    } else if (!strcmp(argv[i], "--repeat")) {
+      repeat = atoi(argv[i + 1]);
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> kind(0, 99);
+  std::vector<unsigned char> grid(static_cast<size_t>(size) * size, nav2_costmap_2d::FREE_SPACE);
+  std::vector<int> obstacles;
+  for (size_t i = 0; i < grid.size(); ++i) {
+    if (kind(rng) < percent) {
+      grid[i] = nav2_costmap_2d::LETHAL_OBSTACLE;
+      obstacles.push_back(static_cast<int>(i));
+    }
+  }
+
+  InflationKernel kernel;
+  kernel.build(radius, costOf);
+
+  // the layout the kernel replaced, one allocation per row
+  int side = radius + 2;
+  std::vector<unsigned char *> rows(side);
+  for (int i = 0; i < side; ++i) {
+    rows[i] = new unsigned char[side];
+    for (int j = 0; j < side; ++j) {
+      rows[i][j] = kernel.cost(i, j);
+    }
+  }
+
+  // the wavefront looks up each cell it reaches against its obstacle
+  volatile unsigned int sink = 0;
+  auto lookups = [&](auto lookup) {
+      unsigned int sum = 0;
+      for (int index : obstacles) {
+        for (int dy = -radius; dy <= radius; ++dy) {
+          for (int dx = -radius; dx <= radius; ++dx) {
+            sum += lookup(std::abs(dx), std::abs(dy)) ^ (index & 1);
+          }
+        }
+      }
+      sink = sink + sum;
+    };
+  double pointer_time = timeRepeated(repeat, [&]() {
+        lookups([&](int dx, int dy) {return rows[dx][dy];});
+      });
+  double flat_time = timeRepeated(repeat, [&]() {
+        lookups([&](int dx, int dy) {return kernel.cost(dx, dy);});
+      });
+
+  std::vector<unsigned char> work(grid.size());
+  auto stamps = [&](bool unrolled) {
+      memcpy(work.data(), grid.data(), grid.size());
+      for (int index : obstacles) {
+        if (unrolled) {
+          kernel.stamp(work.data(), size, size, index % size, index / size,
+            nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+        } else {
+          kernel.stampGeneric(work.data(), size, size, index % size, index / size,
+            nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+        }
+      }
+    };
+  double generic_time = timeRepeated(repeat, [&]() {stamps(false);});
+  double unrolled_time = timeRepeated(repeat, [&]() {stamps(true);});
+
+  for (unsigned char * row : rows) {
+    delete[] row;
+  }
+
+  printf("%dx%d cells, %zu obstacles, radius %d, %d repeats\n", size, size, obstacles.size(),
+    radius, repeat);
+  printf("%-10s %12s %12s %8s\n", "", "before ms", "after ms", "speedup");
+  printf("%-10s %12.3f %12.3f %7.1fx\n", "lookups", pointer_time * 1e3, flat_time * 1e3,
+    pointer_time / flat_time);
+  printf("%-10s %12.3f %12.3f %7.1fx\n", "stamps", generic_time * 1e3, unrolled_time * 1e3,
+    generic_time / unrolled_time);
+  return 0;
+}
@@ -0,0 +1,614 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Times the costmap's hot paths on synthetic maps of each size given, the way
+// Google Benchmark would: every case runs until it has taken at least the
+// minimum time, with whatever it needs reset outside of the timing, and is
+// reported as its mean and fastest iteration. The cases are
+//
+//   inflation/<mode>/density:<percent>   InflationLayer::updateCosts over the
+//                                        whole map, by each inflation mode
+//   inflation/<mode>/map:<spec>          the same over the obstacles of each
+//                                        synthetic map given (see
+//                                        nav2_util/synthetic_costmap.hpp)
+//   obstacle/scan, obstacle/cloud        ObstacleLayer::updateBounds clearing
+//                                        and marking a planar scan or a cloud
+//   voxel/cloud                          the same for the VoxelLayer
+//   obstacle/black_box, voxel/black_box  the same for the scans AMCL recorded
+//                                        in a black box, one after the other,
+//                                        each where the robot was relative to
+//                                        the first, from the map's center
+//   costmap/update_origin                Costmap2D::updateOrigin by a few cells
+//   layout/<layout>/window, /ray         the highest cost around random cells and
+//                                        the costs along random rays, from cells
+//                                        stored row major as Costmap2D does or in
+//                                        the tiles of a TileMajorGrid
+//   layout/<layout>/export               the cells copied out row major
+//   combine/<method>                     the CostmapLayer combine methods
+//   publisher/full                       Costmap2DPublisher::publishCostmap of
+//                                        the whole map, which is prepareGrid()
+//                                        and prepareCostmap() and a publish to
+//                                        no subscribers
+//
+// Usage:
+//   costmap_layers_benchmark [--sizes <cells,...>] [--densities <percent,...>]
+//                            [--min-time <seconds>] [--filter <substring>]
+//                            [--black-box <file>] [--synthetic <spec>]...
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/costmap_2d_publisher.hpp"
+#include "nav2_costmap_2d/costmap_layer.hpp"
+#include "nav2_costmap_2d/footprint.hpp"
+#include "nav2_costmap_2d/inflation_layer.hpp"
+#include "nav2_costmap_2d/layered_costmap.hpp"
+#include "nav2_costmap_2d/obstacle_layer.hpp"
+#include "nav2_costmap_2d/tile_major_grid.hpp"
+#include "nav2_costmap_2d/voxel_layer.hpp"
+#include "nav2_util/black_box.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/line_traversal.hpp"
+#include "nav2_util/synthetic_costmap.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/laser_scan.hpp"
+#include "sensor_msgs/point_cloud2_iterator.hpp"
+#include "tf2_ros/buffer.h"
+
+using nav2_costmap_2d::Costmap2D;
+
+static const double RESOLUTION = 0.05;
+
+class Runner
+{
+public:
+  Runner(double min_time, const std::string & filter)
+  : min_time_(min_time), filter_(filter)
+  {
+    printf("%-44s %12s %12s %10s\n", "Benchmark", "Mean ms", "Min ms", "Iterations");
+  }
+
+  // setup runs before every iteration of body, outside of the timing
+  void run(
+    const std::string & name, std::function<void()> setup, std::function<void()> body)
+  {
+    if (!filter_.empty() && name.find(filter_) == std::string::npos) {
+      return;
+    }
+    setup();
+    body();
+
+    double total = 0.0;
+    double fastest = 1e30;
+    int iterations = 0;
+    while (total < min_time_ || iterations < 3) {
+      setup();
+      auto start = std::chrono::steady_clock::now();
+      body();
+      double elapsed =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      total += elapsed;
+      fastest = std::min(fastest, elapsed);
+      ++iterations;
+    }
+    printf("%-44s %12.3f %12.3f %10d\n", name.c_str(), total / iterations * 1e3,
+      fastest * 1e3, iterations);
+    fflush(stdout);
+  }
+
+  void run(const std::string & name, std::function<void()> body)
+  {
+    run(name, []() {}, body);
+  }
+
+private:
+  double min_time_;
+  std::string filter_;
+};
+
+// Exposes the combine methods, which layers only call on themselves
+class CombineLayer : public nav2_costmap_2d::CostmapLayer
+{
+public:
+  CombineLayer()
+  {
+    enabled_ = true;
+  }
+
+  void updateBounds(double, double, double, double *, double *, double *, double *) override {}
+  void updateCosts(Costmap2D &, int, int, int, int) override {}
+
+  using CostmapLayer::updateWithTrueOverwrite;
+  using CostmapLayer::updateWithOverwrite;
+  using CostmapLayer::updateWithMax;
+  using CostmapLayer::updateWithAddition;
+};
+
+static std::vector<int> parseList(const char * text)
+{
+  std::vector<int> values;
+  std::stringstream stream(text);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    values.push_back(atoi(item.c_str()));
+  }
+  return values;
+}
+
+// Mostly free and unknown, as a real layer is
+static void fillMixed(unsigned char * grid, size_t cells, std::mt19937 & rng)
+{
+  std::uniform_int_distribution<int> kind(0, 99);
+  std::uniform_int_distribution<int> cost(1, 252);
+  for (size_t i = 0; i < cells; ++i) {
+    int k = kind(rng);
+    if (k < 60) {
+      grid[i] = nav2_costmap_2d::FREE_SPACE;
+    } else if (k < 85) {
+      grid[i] = nav2_costmap_2d::NO_INFORMATION;
+    } else if (k < 90) {
+      grid[i] = nav2_costmap_2d::LETHAL_OBSTACLE;
+    } else {
+      grid[i] = cost(rng);
+    }
+  }
+}
+
+// Costmap2D's row-major cells, read the way TileMajorGrid reads its own
+struct RowMajorCells
+{
+  const unsigned char * cells;
+  unsigned int size_x;
+  unsigned int size_y;
+
+  unsigned char getCost(unsigned int mx, unsigned int my) const
+  {
+    return cells[static_cast<size_t>(my) * size_x + mx];
+  }
+
+  template<typename Visit>
+  void forEachCell(
+    unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn, Visit visit) const
+  {
+    xn = std::min(xn, size_x);
+    yn = std::min(yn, size_y);
+    for (unsigned int my = y0; my < yn; ++my) {
+      const unsigned char * row = cells + static_cast<size_t>(my) * size_x;
+      for (unsigned int mx = x0; mx < xn; ++mx) {
+        visit(mx, my, row[mx]);
+      }
+    }
+  }
+};
+
+// The highest cost in a square around each center, as a footprint check reads it
+template<typename Cells>
+static unsigned int maxInWindows(
+  const Cells & cells, const std::vector<std::array<unsigned int, 4>> & windows)
+{
+  unsigned int total = 0;
+  for (const auto & window : windows) {
+    unsigned char highest = 0;
+    cells.forEachCell(window[0], window[1], window[2], window[3],
+      [&](unsigned int, unsigned int, unsigned char cost) {
+        highest = std::max(highest, cost);
+      });
+    total += highest;
+  }
+  return total;
+}
+
+// The costs along each ray, cell by cell, as raytracing reads them
+template<typename Cells>
+static unsigned int sumAlongRays(
+  const Cells & cells, const std::vector<std::array<int, 4>> & rays)
+{
+  unsigned int total = 0;
+  for (const auto & ray : rays) {
+    nav2_util::traceCells(ray[0], ray[1], ray[2], ray[3],
+      [&](int x, int y) {total += cells.getCost(x, y);});
+  }
+  return total;
+}
+
+static sensor_msgs::msg::PointCloud2 makeCloud(const std::vector<std::array<float, 3>> & points)
+{
+  sensor_msgs::msg::PointCloud2 cloud;
+  sensor_msgs::PointCloud2Modifier modifier(cloud);
+  modifier.setPointCloud2FieldsByString(1, "xyz");
+  modifier.resize(points.size());
+  sensor_msgs::PointCloud2Iterator<float> iter_x(cloud, "x");
+  sensor_msgs::PointCloud2Iterator<float> iter_y(cloud, "y");
+  sensor_msgs::PointCloud2Iterator<float> iter_z(cloud, "z");
+  for (const auto & point : points) {
+    *iter_x = point[0];
+    *iter_y = point[1];
+    *iter_z = point[2];
+    ++iter_x;
+    ++iter_y;
+    ++iter_z;
+  }
+  return cloud;
+}
+
+// A planar scan of 1081 beams over 270 degrees, ending on a circle around the center
+static sensor_msgs::msg::PointCloud2 makeScan(double cx, double cy, double range)
+{
+  std::vector<std::array<float, 3>> points;
+  for (int i = 0; i < 1081; ++i) {
+    double angle = -0.75 * M_PI + i * 1.5 * M_PI / 1080;
+    points.push_back({{static_cast<float>(cx + range * cos(angle)),
+        static_cast<float>(cy + range * sin(angle)), 0.1f}});
+  }
+  return makeCloud(points);
+}
+
+// A depth camera's worth of points scattered over a disc around the center
+static sensor_msgs::msg::PointCloud2 makeScatter(
+  double cx, double cy, double range, std::mt19937 & rng)
+{
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<std::array<float, 3>> points;
+  for (int i = 0; i < 30000; ++i) {
+    double r = range * std::sqrt(unit(rng));
+    double angle = 2.0 * M_PI * unit(rng);
+    points.push_back({{static_cast<float>(cx + r * cos(angle)),
+        static_cast<float>(cy + r * sin(angle)), static_cast<float>(1.8 * unit(rng))}});
+  }
+  return makeCloud(points);
+}
+
+// A scan from a black box, with the pose of the laser it was taken at
+struct RecordedScan
+{
+  double x;
+  double y;
+  double yaw;
+  sensor_msgs::msg::LaserScan scan;
+};
+
+static double yawOf(const geometry_msgs::msg::Quaternion & q)
+{
+  return std::atan2(2.0 * (q.w * q.z + q.x * q.y), 1.0 - 2.0 * (q.y * q.y + q.z * q.z));
+}
+
+// The scans AMCL recorded, each with the odometric pose recorded right after it and the
+// laser's mounting, relative to the laser's pose at the first scan
+static std::vector<RecordedScan> readBlackBoxScans(const std::string & filename)
+{
+  std::vector<RecordedScan> scans;
+  nav2_util::BlackBoxLog black_box;
+  if (!black_box.read(filename)) {
+    fprintf(stderr, "Could not read the black box %s
+", filename.c_str());
+    return scans;
+  }
+  const int scan_channel = black_box.find("amcl/scan");
+  const int odom_channel = black_box.find("amcl/odom_pose");
+  const int laser_channel = black_box.find("amcl/laser_pose");
+
+  geometry_msgs::msg::PoseStamped laser;
+  laser.pose.orientation.w = 1.0;
+  for (const auto & record : black_box.records()) {
+    if (static_cast<int>(record.channel) == laser_channel) {
+      nav2_util::BlackBoxLog::deserialize(record, laser);
+      break;
+    }
+  }
+  const double laser_yaw = yawOf(laser.pose.orientation);
+
+  RecordedScan recorded;
+  bool pending = false;
+  for (const auto & record : black_box.records()) {
+    const int channel = static_cast<int>(record.channel);
+    geometry_msgs::msg::PoseStamped odom;
+    if (channel == scan_channel) {
+      pending = nav2_util::BlackBoxLog::deserialize(record, recorded.scan);
+    } else if (channel == odom_channel && pending &&
+      nav2_util::BlackBoxLog::deserialize(record, odom))
+    {
+      double yaw = yawOf(odom.pose.orientation);
+      recorded.x = odom.pose.position.x + laser.pose.position.x * cos(yaw) -
+        laser.pose.position.y * sin(yaw);
+      recorded.y = odom.pose.position.y + laser.pose.position.x * sin(yaw) +
+        laser.pose.position.y * cos(yaw);
+      recorded.yaw = yaw + laser_yaw;
+      scans.push_back(recorded);
+      pending = false;
+    }
+  }
+  for (size_t i = 1; i < scans.size(); ++i) {
+    scans[i].x -= scans[0].x;
+    scans[i].y -= scans[0].y;
+  }
+  if (!scans.empty()) {
+    scans[0].x = scans[0].y = 0.0;
+  }
+  return scans;
+}
+
+// The returns of a recorded scan as a cloud, with the laser at (cx, cy) plus its recorded pose
+static nav2_costmap_2d::Observation observeRecorded(
+  const RecordedScan & recorded, double cx, double cy)
+{
+  const sensor_msgs::msg::LaserScan & scan = recorded.scan;
+  geometry_msgs::msg::Point origin;
+  origin.x = cx + recorded.x;
+  origin.y = cy + recorded.y;
+  origin.z = 0.5;
+  std::vector<std::array<float, 3>> points;
+  for (size_t i = 0; i < scan.ranges.size(); ++i) {
+    float range = scan.ranges[i];
+    if (!(range >= scan.range_min && range < scan.range_max)) {
+      continue;
+    }
+    double angle = recorded.yaw + scan.angle_min + i * scan.angle_increment;
+    points.push_back({{static_cast<float>(origin.x + range * cos(angle)),
+        static_cast<float>(origin.y + range * sin(angle)), 0.1f}});
+  }
+  return nav2_costmap_2d::Observation(origin, makeCloud(points), scan.range_max,
+           scan.range_max);
+}
+
+int main(int argc, char ** argv)
+{
+  std::vector<int> sizes = {200, 500, 1000};
+  std::vector<int> densities = {1, 5, 20};
+  double min_time = 0.5;
+  std::string filter;
+  std::vector<RecordedScan> recorded_scans;
+  std::vector<std::pair<std::string, nav2_util::SyntheticMapSpec>> synthetic_maps;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--sizes")) {
+      sizes = parseList(argv[i + 1]);
+    } else if (!strcmp(argv[i], "--densities")) {
+      densities = parseList(argv[i + 1]);
+    } else if (!strcmp(argv[i], "--min-time")) {
+      min_time = atof(argv[i + 1]);
+    } else if (!strcmp(argv[i], "--filter")) {
+      filter = argv[i + 1];
+    } else if (!strcmp(argv[i], "--black-box")) {
+      recorded_scans = readBlackBoxScans(argv[i + 1]);
+      if (recorded_scans.empty()) {
+        fprintf(stderr, "No AMCL scans in %s\n", argv[i + 1]);
+        return 1;
+      }
+    } else if (!strcmp(argv[i], "--synthetic")) {
+      nav2_util::SyntheticMapSpec spec;
+      std::string error;
+      if (!nav2_util::parse_synthetic_map_spec(argv[i + 1], spec, error)) {
+        fprintf(stderr, "Could not read %s: %s\n", argv[i + 1], error.c_str());
+        return 1;
+      }
+      synthetic_maps.emplace_back(argv[i + 1], spec);
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  rclcpp::init(0, nullptr);
+
+  auto options = rclcpp::NodeOptions();
+  options.parameter_overrides({
+      rclcpp::Parameter("inflation_distance_transform.distance_transform", true),
+      rclcpp::Parameter("inflation_stamp_kernel.stamp_kernel", true),
+    });
+  auto node = std::make_shared<nav2_util::LifecycleNode>(
+    "costmap_layers_benchmark", "", false, options);
+  node->declare_parameter("track_unknown_space", rclcpp::ParameterValue(false));
+  node->declare_parameter("transform_tolerance", rclcpp::ParameterValue(0.3));
+  node->declare_parameter("observation_sources", rclcpp::ParameterValue(std::string("")));
+  tf2_ros::Buffer tf(node->get_clock());
+
+  nav2_costmap_2d::LayeredCostmap layers("map", false, false);
+  const char * inflation_modes[] = {"wavefront", "distance_transform", "stamp_kernel"};
+  std::vector<std::shared_ptr<nav2_costmap_2d::InflationLayer>> inflation_layers;
+  for (const char * mode : inflation_modes) {
+    auto layer = std::make_shared<nav2_costmap_2d::InflationLayer>();
+    layer->initialize(&layers, std::string("inflation_") + mode, &tf, node, nullptr, nullptr);
+    layers.addPlugin(layer);
+    inflation_layers.push_back(layer);
+  }
+  auto obstacle_layer = std::make_shared<nav2_costmap_2d::ObstacleLayer>();
+  obstacle_layer->initialize(&layers, "obstacles", &tf, node, nullptr, nullptr);
+  layers.addPlugin(obstacle_layer);
+  auto voxel_layer = std::make_shared<nav2_costmap_2d::VoxelLayer>();
+  voxel_layer->initialize(&layers, "voxels", &tf, node, nullptr, nullptr);
+  layers.addPlugin(voxel_layer);
+  layers.setFootprint(nav2_costmap_2d::makeFootprintFromRadius(0.2));
+
+  Runner runner(min_time, filter);
+  std::mt19937 rng(42);
+  for (int size : sizes) {
+    std::string suffix = "/size:" + std::to_string(size);
+    size_t cells = static_cast<size_t>(size) * size;
+    layers.resizeMap(size, size, RESOLUTION, 0.0, 0.0);
+    Costmap2D & master = *layers.getCostmap();
+
+    // inflation of lethal cells scattered over free space
+    for (int density : densities) {
+      std::uniform_int_distribution<int> kind(0, 99);
+      std::vector<unsigned char> obstacles(cells, nav2_costmap_2d::FREE_SPACE);
+      for (auto & cell : obstacles) {
+        if (kind(rng) < density) {
+          cell = nav2_costmap_2d::LETHAL_OBSTACLE;
+        }
+      }
+      for (size_t m = 0; m < inflation_layers.size(); ++m) {
+        auto & layer = *inflation_layers[m];
+        runner.run(std::string("inflation/") + inflation_modes[m] + "/density:" +
+          std::to_string(density) + suffix,
+          [&]() {memcpy(master.getCharMap(), obstacles.data(), cells);},
+          [&]() {layer.updateCosts(master, 0, 0, size, size);});
+      }
+    }
+
+    // clearing and marking from the center, out to most of the way to the edge
+    double center = 0.5 * size * RESOLUTION;
+    double range = 0.4 * size * RESOLUTION;
+    geometry_msgs::msg::Point origin;
+    origin.x = center;
+    origin.y = center;
+    origin.z = 0.5;
+    nav2_costmap_2d::Observation scan(origin, makeScan(center, center, range),
+      range + 1.0, range + 1.0);
+    nav2_costmap_2d::Observation scatter(origin, makeScatter(center, center, range, rng),
+      range + 1.0, range + 1.0);
+    auto observe = [&](nav2_costmap_2d::ObstacleLayer & layer, const std::string & name,
+        nav2_costmap_2d::Observation & observation) {
+        layer.clearStaticObservations(true, true);
+        layer.addStaticObservation(observation, true, true);
+        runner.run(name + suffix, [&]() {
+            double min_x = 1e30, min_y = 1e30, max_x = -1e30, max_y = -1e30;
+            layer.updateBounds(center, center, 0.0, &min_x, &min_y, &max_x, &max_y);
+          });
+        layer.clearStaticObservations(true, true);
+      };
+    observe(*obstacle_layer, "obstacle/scan", scan);
+    observe(*obstacle_layer, "obstacle/cloud", scatter);
+    observe(*voxel_layer, "voxel/cloud", scatter);
+
+    // the recorded scans in turn, each set up outside of the timing
+    if (!recorded_scans.empty()) {
+      std::vector<nav2_costmap_2d::Observation> recorded;
+      for (const auto & scan : recorded_scans) {
+        recorded.push_back(observeRecorded(scan, center, center));
+      }
+      auto replay = [&](nav2_costmap_2d::ObstacleLayer & layer, const std::string & name) {
+          size_t next = 0;
+          geometry_msgs::msg::Point robot;
+          runner.run(name + suffix, [&]() {
+              nav2_costmap_2d::Observation & observation = recorded[next++ % recorded.size()];
+              robot = observation.origin_;
+              layer.clearStaticObservations(true, true);
+              layer.addStaticObservation(observation, true, true);
+            }, [&]() {
+              double min_x = 1e30, min_y = 1e30, max_x = -1e30, max_y = -1e30;
+              layer.updateBounds(robot.x, robot.y, 0.0, &min_x, &min_y, &max_x, &max_y);
+            });
+          layer.clearStaticObservations(true, true);
+        };
+      replay(*obstacle_layer, "obstacle/black_box");
+      replay(*voxel_layer, "voxel/black_box");
+    }
+
+    // a rolling window following a robot, a few cells each way per cycle
+    Costmap2D rolling(size, size, RESOLUTION, 0.0, 0.0);
+    fillMixed(rolling.getCharMap(), cells, rng);
+    int step = 0;
+    runner.run("costmap/update_origin" + suffix, [&]() {
+        double shift = (step++ % 2 ? -1.0 : 1.0) * RESOLUTION;
+        rolling.updateOrigin(
+          rolling.getOriginX() + 7 * shift, rolling.getOriginY() + 3 * shift);
+      });
+
+    // neighborhood reads, row major as Costmap2D stores cells and tile major
+    std::vector<std::array<unsigned int, 4>> windows;
+    std::vector<std::array<int, 4>> rays;
+    {
+      // 1 m footprints, and rays of a third of the map, from cells all over it
+      const unsigned int radius = 10;
+      std::uniform_int_distribution<int> cell(0, size - 1);
+      std::uniform_real_distribution<double> angle(0.0, 2 * M_PI);
+      for (int i = 0; i < 2000; ++i) {
+        const unsigned int x = cell(rng), y = cell(rng);
+        windows.push_back({x > radius ? x - radius : 0, y > radius ? y - radius : 0,
+            x + radius + 1, y + radius + 1});
+        const double a = angle(rng);
+        const int x1 = std::max(0, std::min(size - 1, static_cast<int>(x + size / 3 * cos(a))));
+        const int y1 = std::max(0, std::min(size - 1, static_cast<int>(y + size / 3 * sin(a))));
+        rays.push_back({static_cast<int>(x), static_cast<int>(y), x1, y1});
+      }
+    }
+    std::vector<unsigned char> row_major(cells);
+    fillMixed(row_major.data(), cells, rng);
+    std::vector<unsigned char> exported(cells);
+    RowMajorCells row_cells{row_major.data(), static_cast<unsigned int>(size),
+      static_cast<unsigned int>(size)};
+    nav2_costmap_2d::TileMajorGrid<3> tile_8(size, size);
+    tile_8.fromRowMajor(row_major.data());
+    nav2_costmap_2d::TileMajorGrid<4> tile_16(size, size);
+    tile_16.fromRowMajor(row_major.data());
+    volatile unsigned int sink = 0;  // kept, so the reads are not optimized away
+    runner.run("layout/row_major/window" + suffix,
+      [&]() {sink += maxInWindows(row_cells, windows);});
+    runner.run("layout/tile_8/window" + suffix, [&]() {sink += maxInWindows(tile_8, windows);});
+    runner.run("layout/tile_16/window" + suffix, [&]() {sink += maxInWindows(tile_16, windows);});
+    runner.run("layout/row_major/ray" + suffix, [&]() {sink += sumAlongRays(row_cells, rays);});
+    runner.run("layout/tile_8/ray" + suffix, [&]() {sink += sumAlongRays(tile_8, rays);});
+    runner.run("layout/tile_16/ray" + suffix, [&]() {sink += sumAlongRays(tile_16, rays);});
+    runner.run("layout/row_major/export" + suffix,
+      [&]() {memcpy(exported.data(), row_major.data(), cells);});
+    runner.run("layout/tile_8/export" + suffix, [&]() {tile_8.toRowMajor(exported.data());});
+    runner.run("layout/tile_16/export" + suffix, [&]() {tile_16.toRowMajor(exported.data());});
+
+    // each combine method over the whole map
+    CombineLayer combine;
+    combine.resizeMap(size, size, RESOLUTION, 0.0, 0.0);
+    fillMixed(combine.getCharMap(), cells, rng);
+    std::vector<unsigned char> before(cells);
+    fillMixed(before.data(), cells, rng);
+    auto restore = [&]() {memcpy(master.getCharMap(), before.data(), cells);};
+    runner.run("combine/true_overwrite" + suffix, restore,
+      [&]() {combine.updateWithTrueOverwrite(master, 0, 0, size, size);});
+    runner.run("combine/overwrite" + suffix, restore,
+      [&]() {combine.updateWithOverwrite(master, 0, 0, size, size);});
+    runner.run("combine/max" + suffix, restore,
+      [&]() {combine.updateWithMax(master, 0, 0, size, size);});
+    runner.run("combine/addition" + suffix, restore,
+      [&]() {combine.updateWithAddition(master, 0, 0, size, size);});
+
+    // the whole map on every cycle, as with always_send_full_costmap
+    restore();
+    nav2_costmap_2d::Costmap2DPublisher publisher(node, &master, "map",
+      "benchmark_costmap" + std::to_string(size), true);
+    publisher.on_activate();
+    runner.run("publisher/full" + suffix, [&]() {publisher.publishCostmap();});
+    publisher.on_deactivate();
+  }
+
+  // inflation of the obstacles of rooms, mazes and the like, the map's own inflation left out
+  for (auto & synthetic_map : synthetic_maps) {
+    nav2_util::SyntheticMapSpec & spec = synthetic_map.second;
+    spec.inflation_radius = 0.0;
+    std::vector<uint8_t> obstacles = nav2_util::generate_synthetic_costmap(spec);
+    layers.resizeMap(spec.size_x, spec.size_y, spec.resolution, 0.0, 0.0);
+    Costmap2D & master = *layers.getCostmap();
+    for (size_t m = 0; m < inflation_layers.size(); ++m) {
+      auto & layer = *inflation_layers[m];
+      runner.run(std::string("inflation/") + inflation_modes[m] + "/map:" + synthetic_map.first,
+        [&]() {memcpy(master.getCharMap(), obstacles.data(), obstacles.size());},
+        [&]() {layer.updateCosts(master, 0, 0, spec.size_x, spec.size_y);});
+    }
+  }
+
+  rclcpp::shutdown();
+  return 0;
+}
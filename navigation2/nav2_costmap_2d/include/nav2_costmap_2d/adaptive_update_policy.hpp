@@ -0,0 +1,87 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__ADAPTIVE_UPDATE_POLICY_HPP_
+#define NAV2_COSTMAP_2D__ADAPTIVE_UPDATE_POLICY_HPP_
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class AdaptiveUpdatePolicy
+ * @brief Scales the map update rate, and the size of a rolling window, with how fast the
+ *        robot moves and what the updates cost
+ *
+ * Parked, the map updates at min_frequency over min_window_scale of its size; at full_speed
+ * or full_rotation and over, at max_frequency over all of it. The speed comes from the poses
+ * of successive updates. It is taken at once when it rises, and when it falls it is followed
+ * down from full speed to parked over settle_time, so the map is ready as soon as the robot
+ * moves off but doesn't shrink on a pause.
+ * With a cpu_budget, the rate is also held to that fraction of a core, at the updates'
+ * average cost, though never below min_frequency.
+ */
+class AdaptiveUpdatePolicy
+{
+public:
+  struct Params
+  {
+    double min_frequency{1.0};
+    double max_frequency{5.0};
+    double full_speed{0.5};  ///< m/s, 0 to not count translation
+    double full_rotation{1.0};  ///< rad/s, 0 to not count rotation
+    double settle_time{2.0};  ///< s
+    double cpu_budget{0.0};  ///< the fraction of a core, 0 for none
+    double min_window_scale{1.0};  ///< 1 keeps the window whole
+    double window_step{0.25};  ///< the scale changes in steps of this
+  };
+
+  explicit AdaptiveUpdatePolicy(const Params & params);
+
+  /**
+   * @brief Take in the robot's pose at an update, at time in seconds
+   */
+  void addPose(double x, double y, double yaw, double time);
+
+  /**
+   * @brief Take in how long an update took, in seconds
+   */
+  void addUpdateTime(double seconds);
+
+  /**
+   * @brief How fast the robot moves, from 0 parked to 1 at full speed or rotation
+   */
+  double level() const {return level_;}
+
+  /**
+   * @brief The update rate for now
+   */
+  double frequency() const;
+
+  /**
+   * @brief The fraction of its size the rolling window should have for now, a whole step
+   */
+  double windowScale() const;
+
+private:
+  Params params_;
+
+  bool has_pose_{false};
+  double x_{0.0}, y_{0.0}, yaw_{0.0}, time_{0.0};
+  double level_{0.0};
+  double update_time_{0.0};  ///< the average, 0 before the first
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__ADAPTIVE_UPDATE_POLICY_HPP_
@@ -0,0 +1,104 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__ASYNC_LAYER_HPP_
+#define NAV2_COSTMAP_2D__ASYNC_LAYER_HPP_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "nav2_costmap_2d/costmap_layer.hpp"
+#include "nav2_costmap_2d/dirty_regions.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class AsyncLayer
+ * @brief A layer computed on a thread of its own, at its own pace
+ *
+ * Each update, updateBounds() publishes the last computation the worker finished into the
+ * layer's grid and grows the bounds over what it changed, then, with the worker idle, takes
+ * a snapshot of the inputs through prepareCompute() and hands the worker the next one. So
+ * however long compute() takes, the update only copies grids, and the other layers stay
+ * at its rate; the layer's costs are as old as its last finished computation.
+ *
+ * The worker computes into a copy of the layer's grid as it was when the computation
+ * started. A rolling window moves the published grid meanwhile, and the result is copied
+ * in at whatever the origin has become. Subclasses must call stopWorker() in their
+ * destructors, before the members compute() reads are gone.
+ */
+class AsyncLayer : public CostmapLayer
+{
+public:
+  ~AsyncLayer() override;
+
+  void updateBounds(
+    double robot_x, double robot_y, double robot_yaw,
+    double * min_x, double * min_y, double * max_x, double * max_y) override;
+
+  /** @brief Combine the published grid into the master with updateWithMax. */
+  void updateCosts(Costmap2D & master_grid, int min_i, int min_j, int max_i, int max_j) override;
+
+  /** @brief Wait out the worker, then resize; a computation still to publish is dropped. */
+  void matchSize() override;
+
+  /** @brief The published grid and the worker's copy of it. */
+  size_t getMemoryUsage() const override;
+  double getMemoryPerCell() const override;
+
+  /** @brief Block until the worker has finished whatever it was given. */
+  void waitForCompute();
+
+protected:
+  /**
+   * @brief Copy what compute() reads into state only the worker touches until it finishes
+   *
+   * Called on the update thread with the master grid's mutex held and the worker idle.
+   * @return Whether there is anything to compute
+   */
+  virtual bool prepareCompute(double robot_x, double robot_y, double robot_yaw) = 0;
+
+  /**
+   * @brief Compute the layer, on the worker, without locking the master grid
+   * @param grid The layer's grid as published when the computation started, to update
+   * @param changed To grow over the world area of grid that was changed
+   */
+  virtual void compute(Costmap2D & grid, WorldBounds & changed) = 0;
+
+  /** @brief Finish the current computation and join the worker. */
+  void stopWorker();
+
+private:
+  void workerLoop();
+
+  // Copy the worker's changes into the published grid
+  void publishResult(double * min_x, double * min_y, double * max_x, double * max_y);
+
+  Costmap2D working_;  ///< Only the worker touches it while a computation runs
+  WorldBounds changed_{1e30, 1e30, -1e30, -1e30};
+
+  std::thread worker_;
+  std::mutex worker_mutex_;
+  std::condition_variable worker_cv_;
+  unsigned int started_{0};  ///< Computations handed out, guarded by worker_mutex_
+  unsigned int finished_{0};  ///< Computations done, guarded by worker_mutex_
+  bool has_result_{false};
+  bool shutdown_{false};
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__ASYNC_LAYER_HPP_
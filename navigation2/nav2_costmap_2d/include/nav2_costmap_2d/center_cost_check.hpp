@@ -0,0 +1,99 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__CENTER_COST_CHECK_HPP_
+#define NAV2_COSTMAP_2D__CENTER_COST_CHECK_HPP_
+
+#include <string>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/// @brief How much of a footprint check the cost of the pose's own cell may settle
+enum class CenterCheckMode
+{
+  EXACT,          ///< Always walk the footprint
+  INSCRIBED,      ///< A center at INSCRIBED_INFLATED_OBSTACLE or above is a collision
+  CIRCUMSCRIBED   ///< As INSCRIBED, and a center below the circumscribed cost is free
+};
+
+/// @brief What the cost of the pose's own cell says about its footprint
+enum class CenterCheckResult
+{
+  COLLISION,  ///< An obstacle is within the inscribed radius, so inside the footprint
+  FREE,       ///< No obstacle is within the circumscribed radius, so none touches the footprint
+  AMBIGUOUS   ///< The footprint has to be walked
+};
+
+/**
+ * @class CenterCostCheck
+ * @brief The first tier of a footprint check, answered from the cost of the pose's cell
+ *
+ * The inflation layer gives a cell INSCRIBED_INFLATED_OBSTACLE when an obstacle is within the
+ * inscribed radius, and less than the circumscribed cost only when every obstacle is further
+ * than the circumscribed radius. Only a center cost between the two needs the footprint walked.
+ *
+ * A free pose is scored with its center cost instead of the highest cost under its outline.
+ * Unknown cells are not inflated, so a NO_INFORMATION center is always walked, but an unknown
+ * cell under the outline of a free pose goes unnoticed.
+ */
+class CenterCostCheck
+{
+public:
+  /**
+   * @param circumscribed_cost The cost of a cell the circumscribed radius from an obstacle,
+   * with 0 keeping any pose from being free
+   */
+  explicit CenterCostCheck(
+    CenterCheckMode mode = CenterCheckMode::EXACT,
+    unsigned char circumscribed_cost = 0)
+  : mode_(mode), circumscribed_cost_(circumscribed_cost)
+  {
+  }
+
+  void setMode(CenterCheckMode mode) {mode_ = mode;}
+  CenterCheckMode getMode() const {return mode_;}
+  void setCircumscribedCost(unsigned char cost) {circumscribed_cost_ = cost;}
+  unsigned char getCircumscribedCost() const {return circumscribed_cost_;}
+
+  CenterCheckResult classify(unsigned char center_cost) const
+  {
+    if (mode_ == CenterCheckMode::EXACT || center_cost == NO_INFORMATION) {
+      return CenterCheckResult::AMBIGUOUS;
+    }
+    if (center_cost >= INSCRIBED_INFLATED_OBSTACLE) {
+      return CenterCheckResult::COLLISION;
+    }
+    if (mode_ == CenterCheckMode::CIRCUMSCRIBED && center_cost < circumscribed_cost_) {
+      return CenterCheckResult::FREE;
+    }
+    return CenterCheckResult::AMBIGUOUS;
+  }
+
+private:
+  CenterCheckMode mode_;
+  unsigned char circumscribed_cost_;
+};
+
+/**
+ * @brief Parse "exact", "inscribed" or "circumscribed"
+ * @return False, leaving mode alone, for anything else
+ */
+bool centerCheckModeFromString(const std::string & name, CenterCheckMode & mode);
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__CENTER_COST_CHECK_HPP_
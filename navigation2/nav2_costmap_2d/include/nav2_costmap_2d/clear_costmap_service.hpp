@@ -44,6 +44,9 @@ public:
   // Clears within a window around the robot
   void clearAroundRobot(double window_size_x, double window_size_y);
 
+  // Clears within a polygon in the global frame, which need not be convex
+  void clearPolygon(const std::vector<geometry_msgs::msg::Point> & polygon);
+
   // Clears all layers
   void clearEntirely();
 
@@ -77,8 +80,8 @@ private:
     const std::shared_ptr<nav2_msgs::srv::ClearEntireCostmap::Request> request,
     const std::shared_ptr<nav2_msgs::srv::ClearEntireCostmap::Response> response);
 
-  void clearLayerExceptRegion(
-    std::shared_ptr<CostmapLayer> & costmap, double pose_x, double pose_y, double reset_distance);
+  // The clears above are queued on these layers and applied by the next map update
+  std::vector<std::shared_ptr<CostmapLayer>> getClearableLayers() const;
 
   bool isClearable(const std::string & layer_name) const;
 
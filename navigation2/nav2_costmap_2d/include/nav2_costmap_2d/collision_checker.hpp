@@ -19,12 +19,15 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <utility>
 
 #include "rclcpp/rclcpp.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "geometry_msgs/msg/pose2_d.hpp"
+#include "nav2_costmap_2d/center_cost_check.hpp"
 #include "nav2_costmap_2d/costmap_2d.hpp"
 #include "nav2_costmap_2d/costmap_subscriber.hpp"
+#include "nav2_costmap_2d/footprint.hpp"
 #include "nav2_costmap_2d/footprint_subscriber.hpp"
 #include "nav2_util/robot_utils.hpp"
 #pragma GCC diagnostic push
@@ -44,7 +47,8 @@ public:
     FootprintSubscriber & footprint_sub,
     tf2_ros::Buffer & tf,
     std::string name = "collision_checker",
-    std::string global_frame = "map");
+    std::string global_frame = "map",
+    unsigned int yaw_bins = 0);
 
   ~CollisionChecker();
 
@@ -52,16 +56,85 @@ public:
   double scorePose(const geometry_msgs::msg::Pose2D & pose);
   bool isCollisionFree(const geometry_msgs::msg::Pose2D & pose);
 
+  /**
+   * @brief Score many poses against one costmap and footprint lookup
+   * @return The score of each pose, or -1.0 where it is off the grid or in collision
+   */
+  std::vector<double> scorePoses(const std::vector<geometry_msgs::msg::Pose2D> & poses);
+  // Whether all of the poses are collision free, stopping at the first one that is not
+  bool isCollisionFree(const std::vector<geometry_msgs::msg::Pose2D> & poses);
+
+  /**
+   * @brief Check a simulated trajectory against one costmap and footprint lookup
+   * @return The index of the first pose in collision or off the grid, -1 if there is none,
+   * or 0 if the costmap or footprint is unavailable
+   */
+  int firstCollision(const std::vector<geometry_msgs::msg::Pose2D> & poses);
+
+  /**
+   * @brief Settle poses from the cost of their own cell where it can, walking the footprint
+   * only for the rest. The default checks every footprint exactly.
+   */
+  void setCenterCheck(const CenterCostCheck & center_check) {center_check_ = center_check;}
+
 protected:
   double lineCost(int x0, int x1, int y0, int y1) const;
   double pointCost(int x, int y) const;
   void unorientFootprint(const Footprint & oriented_footprint, Footprint & reset_footprint);
   void worldToMap(double wx, double wy, unsigned int & mx, unsigned int & my);
   Footprint getFootprint(const geometry_msgs::msg::Pose2D & pose);
+  Footprint getFootprintSpec();
   double footprintCost(const Footprint footprint);
 
+  void updateCostmap();
+  double poseCost(const geometry_msgs::msg::Pose2D & pose, const Footprint & footprint_spec);
+  // poseCost() of a pose whose cell is already known to be on the grid
+  double cellCost(
+    const geometry_msgs::msg::Pose2D & pose, unsigned int cell_x, unsigned int cell_y,
+    const Footprint & footprint_spec);
+  // Points and their cells from Costmap2D::worldToMapBatch(), kept to avoid reallocating
+  struct BatchCells
+  {
+    std::vector<double> x, y;
+    std::vector<unsigned int> mx, my;
+    std::vector<unsigned char> valid;
+  };
+
+  // The cells of poses or points, by their x and y
+  template<typename PointT>
+  void batchToMap(const std::vector<PointT> & points, BatchCells & cells)
+  {
+    cells.x.resize(points.size());
+    cells.y.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+      cells.x[i] = points[i].x;
+      cells.y[i] = points[i].y;
+    }
+    cells.mx.resize(points.size());
+    cells.my.resize(points.size());
+    cells.valid.resize(points.size());
+    costmap_->worldToMapBatch(cells.x.data(), cells.y.data(), points.size(),
+      cells.mx.data(), cells.my.data(), cells.valid.data());
+  }
+  double rasterCost(
+    unsigned int cell_x, unsigned int cell_y, double theta,
+    const Footprint & footprint_spec);
+  bool footprintOnGrid(
+    unsigned int cell_x, unsigned int cell_y,
+    const Footprint & footprint_spec) const;
+
   std::shared_ptr<Costmap2D> costmap_;
 
+  // With yaw_bins_ set, the footprint outline is rasterized once per yaw bin as cell
+  // offsets from the pose's cell, and kept until the footprint or resolution changes
+  unsigned int yaw_bins_;
+  FootprintMasks masks_;
+
+  CenterCostCheck center_check_;
+
+  BatchCells pose_cells_;
+  BatchCells footprint_cells_;
+
   // Name used for logging
   std::string name_;
   std::string global_frame_;
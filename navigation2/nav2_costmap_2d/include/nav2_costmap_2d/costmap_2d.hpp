@@ -43,11 +43,14 @@
 #include <limits.h>
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
 #include <string>
 #include <vector>
 #include <queue>
 #include <mutex>
 #include "geometry_msgs/msg/point.hpp"
+#include "nav2_costmap_2d/footprint.hpp"
+#include "nav2_util/line_traversal.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -152,6 +155,26 @@ public:
    */
   bool worldToMap(double wx, double wy, unsigned int & mx, unsigned int & my) const;
 
+  /**
+   * @brief  Convert count points from world to map coordinates, as worldToMap() does each
+   *
+   * The points are arrays of x and of y, and the loop has no branches, so the compiler
+   * vectorizes it. It divides by the resolution as worldToMap() does rather than multiplying
+   * by its inverse, whose rounding would put points on cell edges in the other cell.
+   * @param  valid Set to 1 for each point on the map and 0 for the rest, whose mx and my are 0
+   * @return The number of points on the map
+   */
+  size_t worldToMapBatch(
+    const double * wx, const double * wy, size_t count,
+    unsigned int * mx, unsigned int * my, unsigned char * valid) const;
+
+  /**
+   * @brief  Convert count cells from map to world coordinates, as mapToWorld() does each
+   */
+  void mapToWorldBatch(
+    const unsigned int * mx, const unsigned int * my, size_t count,
+    double * wx, double * wy) const;
+
   /**
    * @brief  Convert from world coordinates to map coordinates without checking for legal bounds
    * @param  wx The x world coordinate
@@ -263,6 +286,20 @@ public:
     const std::vector<geometry_msgs::msg::Point> & polygon,
     unsigned char cost_value);
 
+  /**
+   * @brief  Sets the cost of the cells a footprint covers to a desired value, from the
+   * footprint's masks rather than by rasterizing it again
+   * @param wx The x position of the footprint's pose
+   * @param wy The y position of the footprint's pose
+   * @param theta The yaw of the footprint's pose
+   * @param masks The masks of the footprint, with yaw bins
+   * @param cost_value The value to set costs to
+   * @return True if the footprint was filled... false if it is not all on the map
+   */
+  bool setFootprintCost(
+    double wx, double wy, double theta, FootprintMasks & masks,
+    unsigned char cost_value);
+
   /**
    * @brief  Get the map cells that make up the outline of a polygon
    * @param polygon The polygon in map coordinates to rasterize
@@ -298,11 +335,58 @@ public:
     unsigned int size_x, unsigned int size_y, double resolution, double origin_x,
     double origin_y);
 
+  /**
+   * @brief  Resize the map as resizeMap() does, but keep the costs of the cells the old and
+   * new geometry share, such as when a map being built grows
+   *
+   * Only a grid lined up with the old one, as alignedOffset() tells, can keep its costs; any
+   * other is reset. The rest of the new grid is set to the default value.
+   * @return Whether the costs were kept
+   */
+  bool resizeMapKeepingCosts(
+    unsigned int size_x, unsigned int size_y, double resolution, double origin_x,
+    double origin_y);
+
+  /**
+   * @brief  Whether a grid of the given resolution and origin lines up with this map's cells,
+   * having the same resolution and an origin a whole number of cells from this map's
+   * @param offset_x, offset_y Set to the other origin's offset from this map's, in cells
+   */
+  bool alignedOffset(
+    double resolution, double origin_x, double origin_y, int & offset_x,
+    int & offset_y) const;
+
   void resetMap(unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn);
 
   void resetMapToValue(
     unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn, unsigned char value);
 
+  /**
+   * @brief  Set every cell outside of a window to a value, a block of whole rows at a time
+   * above and below the window
+   * @param x0, y0, xn, yn The window to keep, which may reach off the map
+   * @param value The value to set the other cells to
+   */
+  void resetMapOutside(int x0, int y0, int xn, int yn, unsigned char value);
+
+  /**
+   * @brief  Get the rows of cells whose centers are within a polygon, clipped to the map
+   * @param polygon The polygon in world coordinates, which need not be convex
+   * @param spans Will be set to the rows, in map cells
+   */
+  void polygonSpans(
+    const std::vector<geometry_msgs::msg::Point> & polygon,
+    std::vector<FootprintSpan> & spans) const;
+
+  /**
+   * @brief  Set the cells of some rows to a value, clipped to the map
+   * @param spans The rows, in map cells
+   * @param value The value to set the cells to
+   * @param dx, dy How far to shift the rows, in cells
+   */
+  void setSpansToValue(
+    const std::vector<FootprintSpan> & spans, unsigned char value, int dx = 0, int dy = 0);
+
   /**
    * @brief  Given distance in the world... convert it to cells
    * @param  world_dist The world distance
@@ -351,6 +435,73 @@ protected:
     }
   }
 
+  /**
+   * @brief  Copies the cells two maps share from one to the other, where cell (x, y) of
+   * the destination is cell (x + offset_x, y + offset_y) of the source. Cells of the
+   * destination off the source are left as they are.
+   */
+  template<typename data_type>
+  void copyOverlap(
+    const data_type * source_map, unsigned int source_size_x, unsigned int source_size_y,
+    data_type * dest_map, unsigned int dest_size_x, unsigned int dest_size_y,
+    int offset_x, int offset_y)
+  {
+    int x0 = std::max(0, -offset_x);
+    int y0 = std::max(0, -offset_y);
+    int xn = std::min(static_cast<int>(dest_size_x), static_cast<int>(source_size_x) - offset_x);
+    int yn = std::min(static_cast<int>(dest_size_y), static_cast<int>(source_size_y) - offset_y);
+    if (xn <= x0 || yn <= y0) {
+      return;
+    }
+    for (int y = y0; y < yn; ++y) {
+      memcpy(dest_map + y * dest_size_x + x0,
+        source_map + (y + offset_y) * source_size_x + x0 + offset_x,
+        (xn - x0) * sizeof(data_type));
+    }
+  }
+
+  /**
+   * @brief  Shifts the contents of a map in place so that cell (x, y) takes the value
+   * that was at (x + shift_x, y + shift_y), filling the cells that move in from outside
+   * @param map The map to shift
+   * @param size_x The x size of the map
+   * @param size_y The y size of the map
+   * @param shift_x The number of cells to shift by in x
+   * @param shift_y The number of cells to shift by in y
+   * @param fill_value The value to give the newly exposed cells
+   */
+  template<typename data_type>
+  void shiftMapRegion(
+    data_type * map, unsigned int size_x, unsigned int size_y,
+    int shift_x, int shift_y, data_type fill_value)
+  {
+    int sx = size_x;
+    int sy = size_y;
+    if (shift_x >= sx || -shift_x >= sx || shift_y >= sy || -shift_y >= sy) {
+      std::fill(map, map + size_x * size_y, fill_value);
+      return;
+    }
+
+    // the part of each row that survives the shift, and where it comes from and goes to
+    unsigned int keep_x = sx - std::abs(shift_x);
+    unsigned int src_x = std::max(shift_x, 0);
+    unsigned int dst_x = std::max(-shift_x, 0);
+    unsigned int fill_x = shift_x > 0 ? keep_x : 0;
+    unsigned int keep_y = sy - std::abs(shift_y);
+
+    // walk the rows in the direction the data moves so no row is overwritten before it is read
+    for (unsigned int i = 0; i < keep_y; ++i) {
+      unsigned int y = shift_y > 0 ? i : size_y - 1 - i;
+      data_type * row = map + y * size_x;
+      memmove(row + dst_x, map + (y + shift_y) * size_x + src_x, keep_x * sizeof(data_type));
+      std::fill(row + fill_x, row + fill_x + (size_x - keep_x), fill_value);
+    }
+
+    // the rows that moved in from outside the old window
+    unsigned int fill_y = shift_y > 0 ? keep_y : 0;
+    std::fill(map + fill_y * size_x, map + (fill_y + size_y - keep_y) * size_x, fill_value);
+  }
+
   /**
    * @brief  Deletes the costmap, static_map, and markers data structures
    */
@@ -383,65 +534,26 @@ protected:
     unsigned int y1,
     unsigned int max_length = UINT_MAX)
   {
-    int dx = x1 - x0;
-    int dy = y1 - y0;
-
-    unsigned int abs_dx = abs(dx);
-    unsigned int abs_dy = abs(dy);
-
-    int offset_dx = sign(dx);
-    int offset_dy = sign(dy) * size_x_;
-
-    unsigned int offset = y0 * size_x_ + x0;
-
-    // we need to chose how much to scale our dominant dimension,
-    // based on the maximum length of the line
-    double dist = std::hypot(dx, dy);
-    double scale = (dist == 0.0) ? 1.0 : std::min(1.0, max_length / dist);
-
-    // if x is dominant
-    if (abs_dx >= abs_dy) {
-      int error_y = abs_dx / 2;
-      bresenham2D(at, abs_dx, abs_dy, error_y, offset_dx, offset_dy, offset,
-        (unsigned int)(scale * abs_dx));
-      return;
-    }
-
-    // otherwise y is dominant
-    int error_x = abs_dy / 2;
-    bresenham2D(at, abs_dy, abs_dx, error_x, offset_dy, offset_dx, offset,
-      (unsigned int)(scale * abs_dy));
+    nav2_util::traceOffsets(x0, y0, x1, y1, size_x_, max_length, at);
   }
 
-private:
   /**
-   * @brief  A 2D implementation of Bresenham's raytracing algorithm... applies an action at each step
+   * @brief  Raytrace lines from one start cell to many end cells, applying an action at each step
+   * @param  at The action to take... a functor
+   * @param  x0 The starting x coordinate
+   * @param  y0 The starting y coordinate
+   * @param  ends The end cells
+   * @param  max_length The maximum desired length of each segment
    */
   template<class ActionType>
-  inline void bresenham2D(
-    ActionType at, unsigned int abs_da, unsigned int abs_db, int error_b,
-    int offset_a,
-    int offset_b, unsigned int offset,
-    unsigned int max_length)
-  {
-    unsigned int end = std::min(max_length, abs_da);
-    for (unsigned int i = 0; i < end; ++i) {
-      at(offset);
-      offset += offset_a;
-      error_b += abs_db;
-      if ((unsigned int)error_b >= abs_da) {
-        offset += offset_b;
-        error_b -= abs_da;
-      }
-    }
-    at(offset);
-  }
-
-  inline int sign(int x)
+  inline void raytraceLines(
+    ActionType at, unsigned int x0, unsigned int y0, const std::vector<MapLocation> & ends,
+    unsigned int max_length = UINT_MAX)
   {
-    return x > 0 ? 1.0 : -1.0;
+    nav2_util::traceOffsetsFrom(x0, y0, ends.begin(), ends.end(), size_x_, max_length, at);
   }
 
+private:
   mutex_t * access_;
 
 protected:
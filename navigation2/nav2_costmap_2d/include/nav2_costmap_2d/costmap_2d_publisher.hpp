@@ -39,13 +39,20 @@
 #define NAV2_COSTMAP_2D__COSTMAP_2D_PUBLISHER_HPP_
 
 #include <algorithm>
+#include <chrono>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "rclcpp_lifecycle/lifecycle_node.hpp"
 #include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/dirty_regions.hpp"
+#include "nav2_costmap_2d/layered_costmap.hpp"
 #include "nav_msgs/msg/occupancy_grid.hpp"
 #include "map_msgs/msg/occupancy_grid_update.hpp"
+#include "nav2_msgs/msg/compressed_costmap.hpp"
 #include "nav2_msgs/msg/costmap.hpp"
+#include "nav2_msgs/msg/costmap_update.hpp"
 #include "tf2/transform_datatypes.h"
 #include "nav2_util/lifecycle_node.hpp"
 
@@ -79,12 +86,18 @@ public:
     costmap_pub_->on_activate();
     costmap_update_pub_->on_activate();
     costmap_raw_pub_->on_activate();
+    costmap_raw_update_pub_->on_activate();
+    costmap_compressed_pub_->on_activate();
+    costmap_raw_compressed_pub_->on_activate();
   }
   void on_deactivate()
   {
     costmap_pub_->on_deactivate();
     costmap_update_pub_->on_deactivate();
     costmap_raw_pub_->on_deactivate();
+    costmap_raw_update_pub_->on_deactivate();
+    costmap_compressed_pub_->on_deactivate();
+    costmap_raw_compressed_pub_->on_deactivate();
   }
   void on_cleanup() {}
 
@@ -95,13 +108,84 @@ public:
     xn_ = std::max(xn, xn_);
     y0_ = std::min(y0, y0_);
     yn_ = std::max(yn, yn_);
+    dirty_regions_.add(x0, y0, xn, yn);
+  }
+
+  /**
+   * @brief  Keep up to max_regions changed rectangles rather than one around all of them,
+   *         sending an update for each
+   */
+  void setMaxDirtyRegions(unsigned int max_regions)
+  {
+    dirty_regions_.setMaxRegions(max_regions);
   }
 
   /**
    * @brief  Publishes the visualization data over ROS
+   *
+   * Each stream of topics, the occupancy grid and its updates, the raw costmap and its
+   * deltas, and the compressed maps, is only prepared while something subscribes to it.
+   * A new subscriber is sent a whole map the next cycle.
    */
   void publishCostmap();
 
+  /**
+   * @brief  Cap how often each stream of topics is published, below the publish frequency
+   * @param  grid_frequency For the occupancy grid and its updates, 0 for every cycle
+   * @param  raw_frequency For the raw costmap and its deltas, 0 for every cycle
+   * @param  compressed_frequency For the compressed maps, 0 for every cycle
+   */
+  void setMaxRates(double grid_frequency, double raw_frequency, double compressed_frequency);
+
+  /**
+   * @brief  Read the costmap from the snapshots of layered_costmap when it has them,
+   *         instead of locking the costmap given to the constructor
+   */
+  void setSnapshotSource(LayeredCostmap * layered_costmap)
+  {
+    snapshot_source_ = layered_costmap;
+  }
+
+  /**
+   * @brief  Publish a layer's own costs rather than the master grid's
+   * @param  layer_name The layer named in the messages' metadata
+   * @param  mutex The master grid's mutex, which the layer's updates run under and which is
+   *         locked to copy the costs instead of the costmap's own
+   */
+  void setLayerSource(const std::string & layer_name, Costmap2D::mutex_t * mutex)
+  {
+    layer_name_ = layer_name;
+    copy_mutex_ = mutex;
+  }
+
+  /**
+   * @brief  Also publish the raw costmap as a stream of changes, on <topic>_raw_updates
+   * @param  tile_size Side of the tiles that changes are sent in, in cells
+   * @param  keyframe_interval Send the whole map every this many messages
+   *
+   * Only the tiles that differ from what was last sent go out, except for
+   * keyframes, which are also sent whenever the size or origin of the map
+   * changes.  While deltas are enabled, the full costmap_raw message is only
+   * filled in when something subscribes to it. While the process's black box
+   * is recording, the deltas are also recorded there, subscribers or not.
+   */
+  void enableRawUpdates(unsigned int tile_size, unsigned int keyframe_interval)
+  {
+    raw_update_tile_size_ = tile_size;
+    raw_keyframe_interval_ = keyframe_interval;
+  }
+
+  /**
+   * @brief  Also publish the whole map run-length encoded, every cycle
+   *
+   * The occupancy values go out on <topic>_compressed and the costs on
+   * <topic>_raw_compressed, as nav2_msgs::msg::CompressedCostmap.
+   */
+  void enableCompression()
+  {
+    compress_ = true;
+  }
+
   /**
    * @brief Check if the publisher is active
    * @return True if the frequency for the publisher is non-zero, false otherwise
@@ -113,17 +197,41 @@ public:
 
 private:
   /** @brief Prepare grid_ message for publication. */
-  void prepareGrid();
-  void prepareCostmap();
+  void prepareGrid(const Costmap2D & costmap);
+  void prepareCostmap(const Costmap2D & costmap);
+  void prepareCostmapUpdate(const Costmap2D & costmap);
+  void prepareMetadata(const Costmap2D & costmap, nav2_msgs::msg::CostmapMetaData & metadata);
+  void prepareCompressed(const Costmap2D & costmap);
+
+  /** @brief Translate costs to occupancy values through cost_translation_table_. */
+  template<typename T>
+  static void translateCosts(const unsigned char * costs, size_t size, T * occupancy);
+
+  /** @brief When a stream of topics was last sent, to how many, and how often it may be */
+  struct LazyStream
+  {
+    std::chrono::steady_clock::duration min_period{0};
+    std::chrono::steady_clock::time_point last_sent;
+    size_t subscribers{0};
+    bool missed{true};  ///< Whether a cycle went unsent since the last whole map
+  };
 
-  /** @brief Publish the latest full costmap to the new subscriber. */
-  // void onNewSubscription(const ros::SingleSubscriberPublisher& pub);
+  /** @brief Whether stream is sent this cycle, given its topics' subscribers */
+  static bool isDue(
+    LazyStream & stream, size_t subscribers,
+    std::chrono::steady_clock::time_point now);
+  void publishDue(bool grid_due, bool raw_due, bool compressed_due);
 
   nav2_util::LifecycleNode::SharedPtr node_;
   Costmap2D * costmap_;
+  LayeredCostmap * snapshot_source_{nullptr};
+  std::string layer_name_{"master"};  ///< The layer named in the metadata
+  Costmap2D::mutex_t * copy_mutex_{nullptr};  ///< Locked to copy the costmap, else its own
+  Costmap2D publish_copy_;  ///< The map copied out under its lock, when there's no snapshot
   std::string global_frame_;
   std::string topic_name_;
   unsigned int x0_, xn_, y0_, yn_;
+  DirtyRegions dirty_regions_;     ///< The changed rectangles within x0_, xn_, y0_, yn_
   double saved_origin_x_;
   double saved_origin_y_;
   bool active_;
@@ -135,9 +243,34 @@ private:
     costmap_update_pub_;
   // Publisher for raw costmap values as msg::Costmap from layered costmap
   rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::Costmap>::SharedPtr costmap_raw_pub_;
+  // Publisher for the changes to the raw costmap, when enabled
+  rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::CostmapUpdate>::SharedPtr
+    costmap_raw_update_pub_;
+
+  LazyStream grid_stream_;
+  LazyStream raw_stream_;
+  LazyStream compressed_stream_;
 
   nav_msgs::msg::OccupancyGrid grid_;
   nav2_msgs::msg::Costmap costmap_raw_;
+  nav2_msgs::msg::CostmapUpdate costmap_raw_update_;
+
+  unsigned int raw_update_tile_size_{0};   ///< 0 while deltas are disabled
+  unsigned int raw_keyframe_interval_{0};
+  unsigned int raw_updates_since_keyframe_{0};
+  uint64_t raw_update_sequence_{0};
+  std::vector<unsigned char> raw_update_sent_;  ///< The map as receivers of the deltas have it
+  int black_box_channel_;  ///< Where the deltas are recorded in the black box
+
+  // Publishers for the run-length encoded maps, when enabled
+  rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::CompressedCostmap>::SharedPtr
+    costmap_compressed_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::CompressedCostmap>::SharedPtr
+    costmap_raw_compressed_pub_;
+  nav2_msgs::msg::CompressedCostmap costmap_compressed_;
+  nav2_msgs::msg::CompressedCostmap costmap_raw_compressed_;
+  std::vector<unsigned char> occupancy_scratch_;
+  bool compress_{false};
   // Translate from 0-255 values in costmap to -1 to 100 values in message.
   static char * cost_translation_table_;
 };
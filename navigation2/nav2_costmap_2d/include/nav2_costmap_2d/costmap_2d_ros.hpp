@@ -38,18 +38,27 @@
 #ifndef NAV2_COSTMAP_2D__COSTMAP_2D_ROS_HPP_
 #define NAV2_COSTMAP_2D__COSTMAP_2D_ROS_HPP_
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "geometry_msgs/msg/polygon.h"
 #include "geometry_msgs/msg/polygon_stamped.h"
+#include "nav2_costmap_2d/adaptive_update_policy.hpp"
 #include "nav2_costmap_2d/costmap_2d_publisher.hpp"
+#include "nav2_costmap_2d/costmap_layer.hpp"
 #include "nav2_costmap_2d/footprint.hpp"
 #include "nav2_costmap_2d/clear_costmap_service.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
 #include "nav2_costmap_2d/layer.hpp"
+#include "nav2_costmap_2d/path_validity_service.hpp"
+#include "nav2_costmap_2d/shared_costmap.hpp"
+#include "nav2_costmap_2d/update_trigger.hpp"
 #include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/loop_rate.hpp"
+#include "nav2_util/metrics.hpp"
+#include "nav2_util/pose_cache.hpp"
 #include "pluginlib/class_loader.hpp"
 #include "tf2/convert.h"
 #include "tf2/LinearMath/Transform.h"
@@ -159,6 +168,18 @@ public:
     return layered_costmap_->getCostmap();
   }
 
+  /**
+   * @brief Return an immutable copy of the master costmap as of the last update,
+   *        or null unless the enable_snapshots parameter is set.
+   *
+   * Unlike getCostmap(), the snapshot can be read without taking the costmap
+   * mutex, so readers never wait for an update in progress.
+   */
+  std::shared_ptr<const Costmap2D> getCostmapSnapshot()
+  {
+    return layered_costmap_->getSnapshot();
+  }
+
   /**
    * @brief  Returns the global frame of the costmap
    * @return The global frame of the costmap
@@ -182,6 +203,14 @@ public:
     return layered_costmap_;
   }
 
+  /**
+   * @brief  The plugin named name if it keeps a grid of costs of its own, or null
+   *
+   * The layer's grid is only written by the map update, under the master grid's mutex,
+   * which is the lock to read it under.
+   */
+  std::shared_ptr<CostmapLayer> getCostmapLayer(const std::string & name);
+
   /** @brief Returns the current padded footprint as a geometry_msgs::msg::Polygon. */
   geometry_msgs::msg::Polygon getRobotFootprintPolygon()
   {
@@ -245,6 +274,21 @@ public:
 
   std::shared_ptr<tf2_ros::Buffer> getTfBuffer() {return tf_buffer_;}
 
+  /**
+   * @brief An executor to spin this node with, multi-threaded when executor_threads is above 1
+   *
+   * With more than one thread the services, which wait on the costmap's lock, run beside the
+   * map and footprint subscriptions instead of holding them up. The sensor subscriptions are
+   * on the rclcpp node, which has a thread of its own either way.
+   */
+  std::unique_ptr<rclcpp::executor::Executor> createExecutor();
+
+  /** @brief The callback group of the services, apart from the subscriptions' */
+  rclcpp::callback_group::CallbackGroup::SharedPtr getServicesCallbackGroup()
+  {
+    return services_callback_group_;
+  }
+
 protected:
   rclcpp::Node::SharedPtr client_node_;
 
@@ -252,6 +296,8 @@ protected:
   rclcpp_lifecycle::LifecyclePublisher<geometry_msgs::msg::PolygonStamped>::SharedPtr
     footprint_pub_;
   Costmap2DPublisher * costmap_publisher_{nullptr};
+  std::vector<std::unique_ptr<Costmap2DPublisher>> layer_publishers_;  ///< Of published_layers_
+  std::unique_ptr<SharedCostmapWriter> shared_costmap_;  ///< Null unless shared_memory_name is set
 
   rclcpp::Subscription<geometry_msgs::msg::Polygon>::SharedPtr footprint_sub_;
   rclcpp::Subscription<rcl_interfaces::msg::ParameterEvent>::SharedPtr parameter_sub_;
@@ -259,6 +305,7 @@ protected:
   // Transform listener
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
   std::shared_ptr<tf2_ros::TransformListener> tf_listener_;
+  std::unique_ptr<nav2_util::PoseCache> pose_cache_;  ///< Null unless use_pose_cache is set
 
   LayeredCostmap * layered_costmap_{nullptr};
   std::string name_;
@@ -268,30 +315,69 @@ protected:
   bool initialized_{false};
   bool stopped_{true};
   std::thread * map_update_thread_{nullptr};  ///< @brief A thread for updating the map
+  std::unique_ptr<UpdateTrigger> update_trigger_;  ///< Null unless update_on_data is set
+  /// The time of the map update loop, /clock's with use_sim_time
+  std::shared_ptr<nav2_util::LoopClock> loop_clock_;
+  rclcpp::callback_group::CallbackGroup::SharedPtr services_callback_group_;
   rclcpp::Time last_publish_{0, 0, RCL_ROS_TIME};
   rclcpp::Duration publish_cycle_{1, 0};
   pluginlib::ClassLoader<Layer> plugin_loader_{"nav2_costmap_2d", "nav2_costmap_2d::Layer"};
 
+  /**
+   * @brief Initialize the plugins [first, last), together on threads of their own if several
+   * @param init_times Seconds each plugin took to load, which its initialization is added to
+   */
+  void initializePlugins(
+    const std::vector<std::shared_ptr<Layer>> & plugins, size_t first, size_t last,
+    std::vector<double> & init_times);
+
   // Parameters
   void getParameters();
+  bool adaptive_update_{false};    ///< Scale the update rate and rolling window with speed
+  AdaptiveUpdatePolicy::Params adaptive_params_;
   bool always_send_full_costmap_{false};
+  double compressed_publish_frequency_{0};  ///< Cap on the compressed maps' rate, 0 for none
+  std::string dump_file_;          ///< Restored on activate and dumped on deactivate, "" for none
+  bool enable_snapshots_{false};   ///< Whether to keep lock-free snapshots of the costmap
+  int executor_threads_{1};        ///< Threads of the executor from createExecutor()
   std::string footprint_;
   float footprint_padding_{0};
   std::string global_frame_;       ///< The global frame for the costmap
+  double grid_publish_frequency_{0};  ///< Cap on the occupancy grid's rate, 0 for none
   int map_height_meters_{0};
+  int max_dirty_regions_{1};       ///< Separate windows of the map each update may touch
+  int max_layer_deferrals_{4};     ///< Most cycles in a row a layer may be deferred for
+  double max_update_frequency_{30.0};  ///< Cap on update_on_data's rate, 0 for none
+  double memory_budget_{0};        ///< MB the costmap may hold before resizes fail, 0 for any
+  double memory_report_period_{0};  ///< Seconds between reports of each layer's memory
   double map_publish_frequency_{0};
   double map_update_frequency_{0};
   int map_width_meters_{0};
   double origin_x_{0};
   double origin_y_{0};
+  bool parallel_plugin_init_{false};  ///< Initialize runs of init-safe layers at once
   std::vector<std::string> plugin_names_;
   std::vector<std::string> plugin_types_;
+  std::vector<std::string> published_layers_;  ///< Layers published on <layer>/costmap topics
+  bool publish_compressed_{false};  ///< Whether to also publish run-length encoded maps
+  int pyramid_levels_{0};          ///< Max-pooled levels kept above the costmap
+  int raw_keyframe_interval_{10};  ///< Raw costmap deltas between whole maps
+  double raw_publish_frequency_{0};  ///< Cap on the raw costmap's rate, 0 for none
+  int raw_update_tile_size_{0};    ///< Tile side for raw costmap deltas, 0 to not send them
   double resolution_{0};
   std::string robot_base_frame_;   ///< The frame_id of the robot base
+  std::string shared_memory_name_;  ///< Segment to share each updated costmap in, "" for none
   double robot_radius_;
   bool rolling_window_{false};     ///< Whether to use a rolling window version of the costmap
   bool track_unknown_space_{false};
   double transform_tolerance_{0};  ///< The timeout before transform errors
+  double update_budget_{0};        ///< Seconds updateMap may take before deferring layers
+  int update_threads_{1};          ///< Threads for the tiled updateCosts of tile-safe layers
+  int update_tile_size_{64};       ///< Side of the update tiles, in cells
+  bool update_on_data_{false};     ///< Update as data arrives, update_frequency being the least
+  int update_thread_priority_{0};  ///< SCHED_FIFO priority of the update thread, 0 to leave it
+  std::vector<int> update_thread_cpus_;  ///< CPUs to pin the update thread to, empty for any
+  bool use_pose_cache_{false};     ///< Whether to read the robot pose from a cache fed by /tf
 
   // Derived parameters
   bool use_radius_{false};
@@ -299,6 +385,25 @@ protected:
   std::vector<geometry_msgs::msg::Point> padded_footprint_;
 
   std::unique_ptr<ClearCostmapService> clear_costmap_service_;
+  std::unique_ptr<PathValidityService> path_validity_service_;
+
+  // Update times in the process's metrics registry, as <name>.update_map and
+  // <name>.layer.<layer>, the latter indexed like the layer timings
+  void recordUpdateMetrics(nav2_util::ExecutionTimer & timer);
+  nav2_util::LatencyHistogram * update_map_time_{nullptr};
+  std::vector<nav2_util::LatencyHistogram *> layer_times_;
+
+  // Null unless adaptive_update is set. Fed each update's pose and time on the update thread,
+  // which sets its rate and resizes a rolling window by it. With update_on_data the trigger
+  // keeps its own rate, and only the window adapts.
+  void adaptUpdates(nav2_util::LoopRate & rate, double update_seconds);
+  std::unique_ptr<AdaptiveUpdatePolicy> adaptive_policy_;
+  double window_scale_{1.0};
+
+  // The bytes of the master grid and of each layer, logged and set as the gauges
+  // <name>.memory.<layer> every memory_report_period_
+  void reportMemoryUsage();
+  std::chrono::steady_clock::time_point last_memory_report_;
 };
 
 }  // namespace nav2_costmap_2d
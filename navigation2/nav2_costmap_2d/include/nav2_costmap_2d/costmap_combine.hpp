@@ -0,0 +1,47 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COSTMAP_COMBINE_HPP_
+#define NAV2_COSTMAP_2D__COSTMAP_COMBINE_HPP_
+
+#include <cstddef>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * Row kernels behind the CostmapLayer::updateWith*() combine methods.  Each
+ * combines count layer cells into the master cells at the same offsets, and
+ * a layer cell that is NO_INFORMATION leaves the master cell as it is.
+ *
+ * They use SSE2 or NEON, whichever the target has as a baseline, and the
+ * *Scalar versions otherwise; the *Scalar versions are always built as the
+ * reference for tests and benchmarks.
+ */
+
+/** @brief The larger of the two costs, where NO_INFORMATION in the master loses */
+void combineMax(unsigned char * master, const unsigned char * layer, size_t count);
+void combineMaxScalar(unsigned char * master, const unsigned char * layer, size_t count);
+
+/** @brief The layer cost wherever it is known */
+void combineOverwrite(unsigned char * master, const unsigned char * layer, size_t count);
+void combineOverwriteScalar(unsigned char * master, const unsigned char * layer, size_t count);
+
+/** @brief The sum of the costs, capped below INSCRIBED_INFLATED_OBSTACLE */
+void combineAddition(unsigned char * master, const unsigned char * layer, size_t count);
+void combineAdditionScalar(unsigned char * master, const unsigned char * layer, size_t count);
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COSTMAP_COMBINE_HPP_
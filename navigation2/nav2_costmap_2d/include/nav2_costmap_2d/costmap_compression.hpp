@@ -0,0 +1,42 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COSTMAP_COMPRESSION_HPP_
+#define NAV2_COSTMAP_2D__COSTMAP_COMPRESSION_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @brief Run-length encode a grid of cells, for nav2_msgs::msg::CompressedCostmap
+ *
+ * Each run is its length as an unsigned LEB128 varint followed by the cell
+ * value, so a map that is mostly FREE_SPACE or NO_INFORMATION shrinks to a
+ * few bytes per run.
+ */
+void encodeRunLength(const unsigned char * data, size_t size, std::vector<uint8_t> & encoded);
+
+/**
+ * @brief Decode cells encoded with encodeRunLength()
+ * @return false, leaving data partly written, unless the runs cover exactly size cells
+ */
+bool decodeRunLength(const std::vector<uint8_t> & encoded, unsigned char * data, size_t size);
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COSTMAP_COMPRESSION_HPP_
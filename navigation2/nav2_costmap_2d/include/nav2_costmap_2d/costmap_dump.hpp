@@ -0,0 +1,130 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COSTMAP_DUMP_HPP_
+#define NAV2_COSTMAP_2D__COSTMAP_DUMP_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+class Costmap2D;
+class LayeredCostmap;
+
+/**
+ * @struct DumpGrid
+ * @brief A grid a layer keeps its state in, as it is written to and restored from a dump
+ *
+ * data points at the layer's own cells, size_x * size_y cells of cell_bytes each, so the dump
+ * is written from it and restored into it without going through the layer.
+ */
+struct DumpGrid
+{
+  std::string name;
+  uint32_t size_x;
+  uint32_t size_y;
+  uint32_t size_z;      ///< The levels of a voxel grid, 0 for a 2D grid
+  uint32_t cell_bytes;
+  void * data;
+};
+
+/**
+ * @class CostmapDump
+ * @brief A binary dump of a costmap's raw costs, mapped into memory read only
+ *
+ * The file starts with the geometry of the master grid and a table of grids, followed by the
+ * cells of each grid as they are in memory: the master grid first, then the grids of each
+ * layer as it reported them through Layer::getDumpGrids(). Numbers are in the byte order of
+ * the machine that wrote the file, and a file of the other byte order is rejected through its
+ * version. Unlike Costmap2D::saveMap(), a dump keeps every cost value and is written and read
+ * a grid at a time.
+ */
+class CostmapDump
+{
+public:
+  /**
+   * @brief Map filename and check its header and table of grids
+   * @throws std::runtime_error if the file cannot be mapped or is not a valid dump
+   */
+  explicit CostmapDump(const std::string & filename);
+  ~CostmapDump();
+
+  CostmapDump(const CostmapDump &) = delete;
+  CostmapDump & operator=(const CostmapDump &) = delete;
+
+  /**
+   * @brief Dump costmap alone, whose mutex the caller must hold
+   * @throws std::runtime_error if the file cannot be written
+   */
+  static void write(const std::string & filename, const Costmap2D & costmap);
+
+  /**
+   * @brief Dump the master grid of layers and the grids of every layer, holding the mutex of
+   *        the master grid so that no update runs meanwhile
+   * @throws std::runtime_error if the file cannot be written
+   */
+  static void write(const std::string & filename, LayeredCostmap & layers);
+
+  /**
+   * @brief Resize costmap to the dumped master grid and copy its costs in
+   */
+  void restore(Costmap2D & costmap) const;
+
+  /**
+   * @brief Resize layers to the dumped master grid and copy in the master grid and the grids
+   *        of the layers that are in the dump
+   *
+   * A layer grid is only restored if the dump has one of the same name and size, so a layer
+   * that was added or reconfigured since the dump keeps its state.
+   * @return The number of layer grids restored
+   */
+  size_t restore(LayeredCostmap & layers) const;
+
+  unsigned int sizeX() const;
+  unsigned int sizeY() const;
+  double resolution() const;
+  double originX() const;
+  double originY() const;
+
+  /**
+   * @brief The master costs, size_x * size_y of them row by row, valid while the dump is
+   */
+  const unsigned char * costs() const;
+
+  /**
+   * @brief The cells of the dumped grid matching the name and size of grid, or null
+   */
+  const void * find(const DumpGrid & grid) const;
+
+protected:
+  struct Header;
+  struct Entry;
+
+  static void writeGrids(
+    const std::string & filename, const Costmap2D & master,
+    const std::vector<DumpGrid> & layer_grids);
+
+  const uint8_t * data_{nullptr};
+  size_t size_{0};
+  const Header * header_{nullptr};
+  const Entry * entries_{nullptr};
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COSTMAP_DUMP_HPP_
@@ -41,6 +41,8 @@
 #include <rclcpp/rclcpp.hpp>
 #include <nav2_costmap_2d/layer.hpp>
 #include <nav2_costmap_2d/layered_costmap.hpp>
+#include <mutex>
+#include <vector>
 
 namespace nav2_costmap_2d
 {
@@ -60,6 +62,13 @@ public:
 
   virtual void matchSize();
 
+  /** @brief Dump the layer's costs under the name of the layer. */
+  virtual void getDumpGrids(std::vector<DumpGrid> & grids);
+
+  /** @brief The layer's copy of the costs, a byte a cell. */
+  size_t getMemoryUsage() const override;
+  double getMemoryPerCell() const override;
+
   /**
    * If an external source changes values in the costmap,
    * it should call this method with the area that it changed
@@ -71,6 +80,32 @@ public:
    */
   void addExtraBounds(double mx0, double my0, double mx1, double my1);
 
+  /**
+   * @brief Reset every cell outside a window to a value on the next update
+   *
+   * Clears are queued so that callers on other threads return without waiting on the
+   * update for the layer's mutex. The window is looked up on the map when the clear is
+   * applied, so a rolling window may move in between.
+   * @param min_x, min_y, max_x, max_y The window to keep, in world coordinates
+   * @param value The value to reset to
+   */
+  void queueClearExcept(
+    double min_x, double min_y, double max_x, double max_y, unsigned char value);
+
+  /**
+   * @brief Reset the cells within a polygon to a value on the next update
+   *
+   * The polygon is rasterized once as it is queued, then shifted by however far the origin
+   * moved before it is applied.
+   * @param polygon The polygon in world coordinates, which need not be convex
+   * @param value The value to reset to
+   */
+  void queueClearPolygon(
+    const std::vector<geometry_msgs::msg::Point> & polygon, unsigned char value);
+
+  /** @brief Apply the queued clears, growing the extra bounds to cover them. */
+  void applyQueuedChanges() override;
+
 protected:
   /*
    * Updates the master_grid within the specified
@@ -152,7 +187,19 @@ protected:
   bool has_extra_bounds_;
 
 private:
+  struct QueuedClear
+  {
+    std::vector<geometry_msgs::msg::Point> polygon;  ///< Empty to clear outside the window
+    std::vector<FootprintSpan> spans;  ///< The polygon's cells when queued
+    double origin_x, origin_y, resolution;  ///< Of the layer when queued
+    double min_x, min_y, max_x, max_y;  ///< The window, or the polygon's bounds
+    unsigned char value;
+  };
+
   double extra_min_x_, extra_max_x_, extra_min_y_, extra_max_y_;
+
+  std::mutex queue_mutex_;
+  std::vector<QueuedClear> queued_clears_;
 };
 
 }  // namespace nav2_costmap_2d
@@ -0,0 +1,73 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COSTMAP_PYRAMID_HPP_
+#define NAV2_COSTMAP_2D__COSTMAP_PYRAMID_HPP_
+
+#include <memory>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class CostmapPyramid
+ * @brief Downsampled copies of a costmap, each level half the resolution of the one below
+ *
+ * A level cell holds the highest known cost of the 2x2 cells under it, or
+ * NO_INFORMATION if all of them are unknown, so obstacles and inflation are
+ * never lost on the way up.  Level 1 has twice the cell size of the base
+ * costmap, level 2 four times, and so on; all levels share its origin.
+ */
+class CostmapPyramid
+{
+public:
+  /**
+   * @brief Set the number of levels above the base, 0 to keep none
+   */
+  void setLevels(unsigned int levels);
+
+  unsigned int getLevels() const {return levels_.size();}
+
+  /**
+   * @brief The level above the base, from 1 to getLevels()
+   */
+  const Costmap2D & getLevel(unsigned int level) const {return *levels_[level - 1];}
+
+  /**
+   * @brief Recompute every level from the whole base costmap
+   */
+  void rebuild(const Costmap2D & base);
+
+  /**
+   * @brief Recompute the level cells above the base cells [x0, xn) x [y0, yn)
+   *
+   * Falls back to rebuild() when the size, resolution or origin of the base
+   * no longer matches the levels.
+   */
+  void update(
+    const Costmap2D & base, unsigned int x0, unsigned int y0,
+    unsigned int xn, unsigned int yn);
+
+private:
+  bool matches(const Costmap2D & base) const;
+
+  std::vector<std::unique_ptr<Costmap2D>> levels_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COSTMAP_PYRAMID_HPP_
@@ -16,11 +16,14 @@
 #define NAV2_COSTMAP_2D__COSTMAP_SUBSCRIBER_HPP_
 
 #include <string>
+#include <atomic>
 #include <memory>
 
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_msgs/msg/compressed_costmap.hpp"
 #include "nav2_msgs/msg/costmap.hpp"
+#include "nav2_msgs/msg/costmap_update.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 
 namespace nav2_costmap_2d
@@ -47,6 +50,40 @@ public:
 
   std::shared_ptr<Costmap2D> getCostmap();
 
+  /**
+   * @brief A count of the changes received, which moves on every time the costmap does
+   *
+   * Reading it takes no copy, so a consumer can compare it to the version it last
+   * worked from to tell whether getCostmap() would give it anything new.
+   */
+  uint64_t getVersion() const {return version_;}
+
+  /**
+   * @brief Get the costmap, but only if it has changed since version
+   * @param version The version last seen, set to the version returned
+   * @return The costmap, or null if it has not changed
+   */
+  std::shared_ptr<Costmap2D> getCostmapIfChanged(uint64_t & version);
+
+  /**
+   * @brief Follow the costmap through its delta stream instead of full messages
+   * @param update_topic_name The raw updates topic, e.g. costmap_raw_updates
+   *
+   * The full costmap subscription is dropped and the deltas are applied in
+   * place, under the costmap's mutex, as they arrive.  After a missed delta
+   * the costmap is left as it is until the next keyframe.
+   */
+  void subscribeToUpdates(const std::string & update_topic_name);
+
+  /**
+   * @brief Follow the costmap through its compressed stream instead of full messages
+   * @param compressed_topic_name The raw compressed topic, e.g. costmap_raw_compressed
+   *
+   * The full costmap subscription is dropped and each message is decoded
+   * into the costmap, under its mutex, as it arrives.
+   */
+  void subscribeToCompressed(const std::string & compressed_topic_name);
+
 protected:
   // Interfaces used for logging and creating publishers and subscribers
   rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base_;
@@ -54,13 +91,25 @@ protected:
   rclcpp::node_interfaces::NodeLoggingInterface::SharedPtr node_logging_;
 
   void toCostmap2D();
+  void matchMetadata(const nav2_msgs::msg::CostmapMetaData & metadata);
   void costmapCallback(const nav2_msgs::msg::Costmap::SharedPtr msg);
+  void costmapUpdateCallback(const nav2_msgs::msg::CostmapUpdate::SharedPtr update);
+  bool applyTiles(const nav2_msgs::msg::CostmapUpdate & update);
+  void compressedCostmapCallback(const nav2_msgs::msg::CompressedCostmap::SharedPtr msg);
 
   std::shared_ptr<Costmap2D> costmap_;
   nav2_msgs::msg::Costmap::SharedPtr costmap_msg_;
   std::string topic_name_;
   bool costmap_received_{false};
+  bool costmap_stale_{false};  ///< Whether costmap_msg_ is newer than costmap_
+  std::atomic<uint64_t> version_{0};
   rclcpp::Subscription<nav2_msgs::msg::Costmap>::SharedPtr costmap_sub_;
+
+  bool in_place_{false};  ///< Whether callbacks write into costmap_ directly
+  bool updates_synced_{false};  ///< Whether every delta since the last keyframe was applied
+  uint64_t last_sequence_{0};
+  rclcpp::Subscription<nav2_msgs::msg::CostmapUpdate>::SharedPtr costmap_update_sub_;
+  rclcpp::Subscription<nav2_msgs::msg::CompressedCostmap>::SharedPtr costmap_compressed_sub_;
 };
 
 }  // namespace nav2_costmap_2d
@@ -0,0 +1,83 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__DIRTY_REGIONS_HPP_
+#define NAV2_COSTMAP_2D__DIRTY_REGIONS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @brief A window of the world that changed, as grown by Layer::updateBounds()
+ */
+struct WorldBounds
+{
+  double min_x, min_y, max_x, max_y;
+};
+
+/**
+ * @brief A window of map cells, [x0, xn) by [y0, yn)
+ */
+struct MapRegion
+{
+  int x0, y0, xn, yn;
+
+  int64_t area() const
+  {
+    return static_cast<int64_t>(xn - x0) * (yn - y0);
+  }
+};
+
+/**
+ * @class DirtyRegions
+ * @brief The parts of a map that changed, as a few rectangles instead of one box around all
+ * of them
+ *
+ * Rectangles that overlap, or whose bounding box is no bigger than the two of them, are
+ * merged as they are added. Past the most rectangles kept, the two whose bounding box wastes
+ * the fewest cells are merged, so with one rectangle this is the usual bounding box.
+ */
+class DirtyRegions
+{
+public:
+  explicit DirtyRegions(size_t max_regions = 1);
+
+  void setMaxRegions(size_t max_regions);
+  size_t getMaxRegions() const {return max_regions_;}
+
+  /** @brief Add a window, ignoring empty ones */
+  void add(int x0, int y0, int xn, int yn);
+  void add(const MapRegion & region) {add(region.x0, region.y0, region.xn, region.yn);}
+
+  void clear() {regions_.clear();}
+  bool empty() const {return regions_.empty();}
+  const std::vector<MapRegion> & get() const {return regions_;}
+
+  /** @brief The bounding box of all the regions, which is empty if there are none */
+  MapRegion bounds() const;
+
+private:
+  void mergeCheapest();
+
+  size_t max_regions_;
+  std::vector<MapRegion> regions_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__DIRTY_REGIONS_HPP_
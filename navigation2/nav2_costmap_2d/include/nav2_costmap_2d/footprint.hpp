@@ -39,6 +39,7 @@
 #define NAV2_COSTMAP_2D__FOOTPRINT_HPP_
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "rclcpp/rclcpp.hpp"
@@ -129,6 +130,71 @@ bool makeFootprintFromString(
   const std::string & footprint_string,
   std::vector<geometry_msgs::msg::Point> & footprint);
 
+/**
+ * @brief A row of cells covered by a footprint, as offsets from the cell of its pose
+ */
+struct FootprintSpan
+{
+  int y, min_x, max_x;
+};
+
+/**
+ * @class FootprintMasks
+ * @brief The cells a footprint covers at each of a number of yaw bins, built once per bin
+ *
+ * The cells are offsets from the cell of the pose, with the footprint laid out as if the pose
+ * were at the center of that cell and its yaw at the center of its bin. They are kept until
+ * the footprint or the resolution changes.
+ */
+class FootprintMasks
+{
+public:
+  explicit FootprintMasks(unsigned int yaw_bins = 0);
+
+  unsigned int yawBins() const
+  {
+    return yaw_bins_;
+  }
+
+  /**
+   * @brief Use another footprint or resolution, unless it only moves the footprint's points
+   * by less than a quarter of a cell, which absorbs the jitter of a footprint unoriented
+   * against a slightly different pose
+   * @return Whether the masks were dropped
+   */
+  bool setFootprint(
+    const std::vector<geometry_msgs::msg::Point> & footprint_spec, double resolution);
+
+  /**
+   * @brief Circumscribed radius of the footprint in cells, with a cell to spare
+   */
+  int radius() const
+  {
+    return radius_;
+  }
+
+  /**
+   * @brief The cells on the outline of the footprint at yaw theta, in sorted order
+   */
+  const std::vector<std::pair<int, int>> & outline(double theta);
+
+  /**
+   * @brief The rows of cells within the footprint at yaw theta, which must be convex
+   */
+  const std::vector<FootprintSpan> & fill(double theta);
+
+private:
+  unsigned int bin(double theta) const;
+  void build(unsigned int bin);
+
+  unsigned int yaw_bins_;
+  std::vector<geometry_msgs::msg::Point> footprint_spec_;
+  double resolution_{0.0};
+  int radius_{0};
+  std::vector<std::vector<std::pair<int, int>>> outlines_;
+  std::vector<std::vector<FootprintSpan>> fills_;
+};
+
 }  // end namespace nav2_costmap_2d
 
 #endif  // NAV2_COSTMAP_2D__FOOTPRINT_HPP_
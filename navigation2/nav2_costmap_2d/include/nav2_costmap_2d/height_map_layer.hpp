@@ -0,0 +1,118 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__HEIGHT_MAP_LAYER_HPP_
+#define NAV2_COSTMAP_2D__HEIGHT_MAP_LAYER_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "nav2_costmap_2d/obstacle_layer.hpp"
+#include "nav2_msgs/msg/height_map.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @struct HeightColumn
+ * @brief The obstacle points seen in one cell, in steps of the layer's z_resolution above
+ *        origin_z; none while hits is 0
+ */
+struct HeightColumn
+{
+  uint8_t min_z;
+  uint8_t max_z;
+  uint8_t hits;   ///< Points marked into the column since it was last cleared, up to 255
+};
+
+/**
+ * @class HeightMapLayer
+ * @brief An obstacle layer that keeps the height band of the obstacles in each cell, in place
+ *        of the VoxelLayer's voxel columns
+ *
+ * Clearing rays are traced in 2D, and clear the part of a column's band the ray passes
+ * through at its height there. A cell is lethal while its column holds more than
+ * mark_threshold points. A column takes 3 bytes, and only the columns holding obstacles are
+ * published.
+ */
+class HeightMapLayer : public ObstacleLayer
+{
+public:
+  HeightMapLayer() {}
+  virtual ~HeightMapLayer() {}
+
+  virtual void onInitialize();
+  virtual void updateBounds(
+    double robot_x, double robot_y, double robot_yaw, double * min_x,
+    double * min_y, double * max_x, double * max_y);
+
+  virtual void updateOrigin(double new_origin_x, double new_origin_y);
+  bool isDiscretized()
+  {
+    return true;
+  }
+  virtual void matchSize();
+  virtual void reset();
+
+  /** @brief The obstacle layer's memory and a column a cell. */
+  size_t getMemoryUsage() const override;
+  double getMemoryPerCell() const override;
+
+  /** @brief Dump the columns along with the layer's costs. */
+  virtual void getDumpGrids(std::vector<DumpGrid> & grids);
+
+  /**
+   * @brief The column of cell (mx, my)
+   */
+  const HeightColumn & getColumn(unsigned int mx, unsigned int my) const
+  {
+    return columns_[getIndex(mx, my)];
+  }
+
+  /**
+   * @brief The step of height z, clamped to those a column holds
+   */
+  uint8_t heightStep(double z) const;
+
+protected:
+  virtual void resetMaps();
+
+  virtual void raytraceFreespace(
+    const nav2_costmap_2d::Observation & clearing_observation,
+    double * min_x, double * min_y, double * max_x, double * max_y);
+
+private:
+  /**
+   * @brief Clear the part of the column at offset that [low, high] covers, in meters
+   */
+  void clearColumn(unsigned int offset, double low, double high);
+
+  void publishHeightMap();
+
+  std::vector<HeightColumn> columns_;
+  double origin_z_{0.0};
+  double z_resolution_{0.05};
+  /// @brief How far above and below its height a ray clears, besides its climb across a cell
+  double clearing_tolerance_{0.05};
+  int mark_threshold_{0};
+
+  bool publish_height_map_{false};
+  rclcpp::Publisher<nav2_msgs::msg::HeightMap>::SharedPtr height_map_pub_;
+  nav2_msgs::msg::HeightMap height_map_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__HEIGHT_MAP_LAYER_HPP_
@@ -0,0 +1,122 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__INFLATION_KERNEL_HPP_
+#define NAV2_COSTMAP_2D__INFLATION_KERNEL_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class InflationKernel
+ * @brief The distances and costs around an obstacle cell out to the inflation radius, laid
+ * out flat with every row starting on a cache line
+ *
+ * distance() and cost() take the offset from the obstacle along each axis, from 0 to one
+ * more than the radius. The stamp is the same costs over the whole square of side
+ * 2 * radius + 1 centered on the obstacle, with 0 beyond the radius, for stamp() to
+ * combine into a grid a row at a time.
+ *
+ * rank() numbers the distinct distances within the radius in increasing order, so that a
+ * wavefront can keep its cells in an array of buckets by rank rather than in a map keyed by
+ * the distance.
+ */
+class InflationKernel
+{
+public:
+  /** @brief The largest radius stamp() has a version with the loops unrolled for */
+  static constexpr int MAX_UNROLLED_RADIUS = 16;
+
+  InflationKernel() = default;
+  InflationKernel(const InflationKernel &) = delete;
+  InflationKernel & operator=(const InflationKernel &) = delete;
+
+  /**
+   * @brief Lay out the kernel for a radius, in cells
+   * @param cost_of The cost at a distance from the obstacle, in cells
+   */
+  void build(unsigned int radius, const std::function<unsigned char(double)> & cost_of);
+
+  unsigned int radius() const {return radius_;}
+  bool empty() const {return !storage_;}
+
+  /** @brief Bytes of the distances, costs and stamp, 0 until built */
+  size_t getMemoryUsage() const
+  {
+    if (!storage_) {
+      return 0;
+    }
+    return (radius_ + 2) * (distance_stride_ * sizeof(double) + cost_stride_) +
+           (2 * radius_ + 1) * stamp_stride_ + ranks_.capacity() * sizeof(unsigned int);
+  }
+
+  double distance(unsigned int dx, unsigned int dy) const
+  {
+    return distances_[dx * distance_stride_ + dy];
+  }
+
+  unsigned char cost(unsigned int dx, unsigned int dy) const
+  {
+    return costs_[dx * cost_stride_ + dy];
+  }
+
+  /**
+   * @brief The place of distance(dx, dy) among the distinct distances within the radius,
+   *        from 0 for the obstacle itself, or rankCount() past the radius
+   */
+  unsigned int rank(unsigned int dx, unsigned int dy) const
+  {
+    return ranks_[dx * (radius_ + 2) + dy];
+  }
+
+  /** @brief The number of distinct distances within the radius */
+  unsigned int rankCount() const {return rank_count_;}
+
+  /**
+   * @brief Combine the stamp centered on (x, y) into a grid, clipped to the grid
+   *
+   * A cell takes the larger of its cost and the stamp's, except that a NO_INFORMATION cell
+   * only takes a stamp cost of at least unknown_threshold. Radii up to MAX_UNROLLED_RADIUS
+   * whose stamp fits on the grid use a version with the radius fixed at compile time.
+   */
+  void stamp(
+    unsigned char * grid, int size_x, int size_y, int x, int y,
+    unsigned char unknown_threshold) const;
+
+  /** @brief stamp() without the unrolled versions, for comparing against */
+  void stampGeneric(
+    unsigned char * grid, int size_x, int size_y, int x, int y,
+    unsigned char unknown_threshold) const;
+
+private:
+  unsigned int radius_{0};
+  size_t distance_stride_{0};  ///< In doubles
+  size_t cost_stride_{0};
+  size_t stamp_stride_{0};
+  std::unique_ptr<unsigned char[]> storage_;
+  double * distances_{nullptr};
+  unsigned char * costs_{nullptr};
+  unsigned char * stamp_{nullptr};  ///< Row 0 is the obstacle's row minus the radius
+  std::vector<unsigned int> ranks_;  ///< Laid out as the distances, without the padding
+  unsigned int rank_count_{0};
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__INFLATION_KERNEL_HPP_
@@ -38,15 +38,19 @@
 #ifndef NAV2_COSTMAP_2D__INFLATION_LAYER_HPP_
 #define NAV2_COSTMAP_2D__INFLATION_LAYER_HPP_
 
-#include <map>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 #include "rclcpp/rclcpp.hpp"
+#include "nav2_costmap_2d/inflation_kernel.hpp"
 #include "nav2_costmap_2d/layer.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
 
 namespace nav2_costmap_2d
 {
+class StaticLayer;
+
 /**
  * @class CellData
  * @brief Storage for cell information used during obstacle inflation
@@ -77,10 +81,7 @@ class InflationLayer : public Layer
 public:
   InflationLayer();
 
-  virtual ~InflationLayer()
-  {
-    deleteKernels();
-  }
+  virtual ~InflationLayer() {}
 
   virtual void onInitialize();
   virtual void updateBounds(
@@ -88,6 +89,10 @@ public:
     double * min_y,
     double * max_x,
     double * max_y);
+  /** @brief Grow every region by the inflation radius, along with the last cycle's */
+  virtual void updateRegions(
+    double robot_x, double robot_y, double robot_yaw, bool deferred,
+    std::vector<WorldBounds> & regions);
   virtual void updateCosts(
     nav2_costmap_2d::Costmap2D & master_grid,
     int min_i, int min_j, int max_i, int max_j);
@@ -96,6 +101,11 @@ public:
     return true;
   }
   virtual void matchSize();
+  virtual bool isInitSafe() const {return true;}
+
+  /** @brief The seen cells, the caches and scratch of the inflation mode, and the kernel. */
+  size_t getMemoryUsage() const override;
+  double getMemoryPerCell() const override;
 
   virtual void reset()
   {
@@ -122,6 +132,18 @@ public:
     return cost;
   }
 
+  /**
+   * @brief  The cost of a cell the circumscribed radius from an obstacle, or 0 if the
+   *         inflation stops short of the circumscribed radius
+   */
+  unsigned char getCircumscribedCost() const;
+
+  /**
+   * @brief  The lowest circumscribed cost of the inflation layers of a costmap, for a
+   *         CenterCostCheck, or 0 if it has none
+   */
+  static unsigned char findCircumscribedCost(LayeredCostmap * layered_costmap);
+
 protected:
   virtual void onFootprintChanged();
 
@@ -138,7 +160,7 @@ private:
   {
     unsigned int dx = abs(mx - src_x);
     unsigned int dy = abs(my - src_y);
-    return cached_distances_[dx][dy];
+    return kernel_.distance(dx, dy);
   }
 
   /**
@@ -153,12 +175,10 @@ private:
   {
     unsigned int dx = abs(mx - src_x);
     unsigned int dy = abs(my - src_y);
-    return cached_costs_[dx][dy];
+    return kernel_.cost(dx, dy);
   }
 
   void computeCaches();
-  void deleteKernels();
-  void inflate_area(int min_i, int min_j, int max_i, int max_j, unsigned char * master_grid);
 
   unsigned int cellDistance(double world_dist)
   {
@@ -169,22 +189,111 @@ private:
     unsigned int index, unsigned int mx, unsigned int my,
     unsigned int src_x, unsigned int src_y);
 
+  /**
+   * @brief  Run the wavefront from the cells queued in inflation_cells_,
+   *         calling assign(index, cost) once for every cell it reaches
+   */
+  template<typename AssignFn>
+  void propagate(unsigned int size_x, unsigned int size_y, AssignFn assign);
+
+  /**
+   * @brief  updateCosts() for the distance transform backend: exact Euclidean
+   *         distances from a separable transform, mapped to costs by table
+   */
+  void updateCostsDistanceTransform(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j);
+
+  /**
+   * @brief  updateCosts() for the kernel stamping backend: the square of costs
+   *         around an obstacle combined into the grid around each lethal cell
+   */
+  void updateCostsStamped(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j);
+
+  /**
+   * @brief  updateCosts() for the incremental mode: only re-propagate around
+   *         lethal cells that appeared or disappeared since the last cycle
+   */
+  void updateCostsIncremental(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j);
+  void rebuildIncrementalState(const nav2_costmap_2d::Costmap2D & master_grid);
+
+  /**
+   * @brief  The static layer whose obstacles cache_static_inflation inflates once, or null
+   *         if there is none with a map on the cells of the master grid
+   */
+  std::shared_ptr<StaticLayer> findStaticLayer() const;
+
+  /**
+   * @brief  updateCosts() for cache_static_inflation: the cached inflation of the static
+   *         obstacles, and a wavefront from the others only
+   */
+  void updateCostsStaticSplit(
+    nav2_costmap_2d::Costmap2D & master_grid, StaticLayer & static_layer,
+    int min_i, int min_j, int max_i, int max_j);
+  void rebuildStaticInflation(
+    const StaticLayer & static_layer, unsigned int size_x, unsigned int size_y);
+  void shiftIncrementalState(unsigned int size_x, unsigned int size_y, int dx, int dy);
+
   double inflation_radius_, inscribed_radius_, cost_scaling_factor_;
   bool inflate_unknown_;
   unsigned int cell_inflation_radius_;
-  unsigned int cached_cell_inflation_radius_;
-  std::map<double, std::vector<CellData>> inflation_cells_;
+  // The cells queued for the wavefront, a bucket for each distance by InflationKernel::rank();
+  // the buckets are emptied after each run but keep their capacity
+  std::vector<std::vector<CellData>> inflation_cells_;
 
   double resolution_;
+  bool caches_valid_{false};  ///< Whether the kernels are computed for resolution_
 
-  std::vector<bool> seen_;
+  /** @brief  Unmark every cell of seen_, by starting a new generation */
+  void clearSeen();
+  bool isSeen(unsigned int index) const {return seen_[index] == seen_generation_;}
 
-  unsigned char ** cached_costs_;
-  double ** cached_distances_;
+  // The cells the wavefront has reached, those marked with the current generation
+  std::vector<uint16_t> seen_;
+  uint16_t seen_generation_{1};
+
+  InflationKernel kernel_;
   double last_min_x_, last_min_y_, last_max_x_, last_max_y_;
+  std::vector<WorldBounds> last_regions_;  ///< The regions given to the last updateRegions()
 
   // Indicates that the entire costmap should be reinflated next time around.
   bool need_reinflation_;
+
+  // Distance transform backend: computeCost() for each squared cell distance
+  // within the inflation radius, and scratch space reused between cycles.
+  // Takes precedence over the other backends.
+  bool distance_transform_;
+  std::vector<unsigned char> sq_distance_costs_;
+  std::vector<int> column_distances_;
+  std::vector<int> envelope_sites_;
+  std::vector<double> envelope_bounds_;
+  std::vector<int> row_sq_distances_;
+
+  // Kernel stamping backend, which takes precedence over the incremental mode
+  bool stamp_kernel_;
+
+  // Incremental mode.  lethal_ and inflated_ cover the master grid and hold
+  // the lethal cells and the inflated costs seen on the last cycle; the map
+  // is tracked for changes in square blocks of block_size_ cells.
+  bool incremental_;
+  bool incremental_valid_;
+  std::vector<unsigned char> lethal_;
+  std::vector<unsigned char> inflated_;
+  std::vector<unsigned char> block_level_;
+  unsigned int block_size_;
+  double last_origin_x_, last_origin_y_;
+
+  // Static split, over the other backends when the costmap has a static layer and does not
+  // roll. static_inflated_ covers the master grid and holds the inflation of the static
+  // layer's obstacles for the version of its map in static_version_.
+  bool cache_static_inflation_;
+  bool static_inflation_valid_;
+  unsigned int static_version_;
+  std::vector<unsigned char> static_inflated_;
 };
 
 }  // namespace nav2_costmap_2d
@@ -44,6 +44,8 @@
 #include "tf2_ros/buffer.h"
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/costmap_dump.hpp"
+#include "nav2_costmap_2d/dirty_regions.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 
@@ -91,6 +93,106 @@ public:
     Costmap2D & master_grid,
     int min_i, int min_j, int max_i, int max_j) = 0;
 
+  /**
+   * @brief Whether updateCosts() may be called concurrently on disjoint
+   *        windows of the same master grid.
+   *
+   * Override to return true if updateCosts() only reads and writes master
+   * cells inside the window it is given and does not modify the layer's own
+   * state, so that the LayeredCostmap can split the update into tiles.
+   */
+  virtual bool isTileSafe() const
+  {
+    return false;
+  }
+
+  /**
+   * @brief Whether the LayeredCostmap may skip updateBounds() on cycles that
+   *        run over their time budget.
+   *
+   * Override to return true for layers whose updateBounds() only folds new
+   * sensor data into the layer, so that picking it up a cycle later is fine.
+   * updateCosts() is still called every cycle.
+   */
+  virtual bool isDeferrable() const
+  {
+    return false;
+  }
+
+  /**
+   * @brief Whether initialize() may run concurrently with that of other
+   *        layers of the same costmap.
+   *
+   * Override to return true if onInitialize() does not depend on the layers
+   * before it, and only reads the LayeredCostmap and its master grid, so that
+   * a run of such layers can be initialized together.
+   */
+  virtual bool isInitSafe() const
+  {
+    return false;
+  }
+
+  /**
+   * @brief Called instead of updateBounds() on cycles the layer is deferred.
+   *
+   * Override to do whatever must not wait, such as moving a rolling window
+   * along with the robot.  The bounds may be grown as in updateBounds().
+   */
+  virtual void deferBounds(
+    double /*robot_x*/, double /*robot_y*/, double /*robot_yaw*/,
+    double * /*min_x*/, double * /*min_y*/, double * /*max_x*/, double * /*max_y*/)
+  {
+  }
+
+  /**
+   * @brief Add the windows the layer changed to a list of regions, for the
+   *        LayeredCostmap to update only those rather than one box around all
+   *        of them.
+   *
+   * Called instead of updateBounds() or deferBounds(), as deferred says,
+   * when the LayeredCostmap keeps more than one dirty region.  The default
+   * calls them on an empty box and adds what it grew to as a region of its
+   * own.  Layers whose bounds depend on the ones they are given, such as
+   * inflation, override this to grow the regions already in the list.
+   */
+  virtual void updateRegions(
+    double robot_x, double robot_y, double robot_yaw, bool deferred,
+    std::vector<WorldBounds> & regions);
+
+  /**
+   * @brief Called at the start of every update, before updateBounds() or
+   *        deferBounds(), with the master grid's mutex held.
+   *
+   * Override to apply changes that other threads queued for the layer
+   * rather than waiting on the update to make them.
+   */
+  virtual void applyQueuedChanges() {}
+
+  /**
+   * @brief Append the grids the layer keeps its state in, for CostmapDump to write them out
+   *        and to restore them in place.
+   *
+   * Called with the master grid's mutex held. Layers without a state of their own add none.
+   */
+  virtual void getDumpGrids(std::vector<DumpGrid> & /*grids*/) {}
+
+  /**
+   * @brief Bytes the layer holds in its grids, caches and buffers, for the LayeredCostmap's
+   *        memory accounting.
+   *
+   * Called with the master grid's mutex held. Layers without a state of their own hold none.
+   */
+  virtual size_t getMemoryUsage() const {return 0;}
+
+  /**
+   * @brief Bytes of getMemoryUsage() that grow with each cell of the master grid, such as
+   *        the layer's own copy of it.
+   *
+   * The LayeredCostmap checks a resize against its memory budget by this before matchSize()
+   * allocates anything, counting the rest of getMemoryUsage() as it is.
+   */
+  virtual double getMemoryPerCell() const {return 0.0;}
+
   /** @brief Implement this to make this layer match the size of the parent costmap. */
   virtual void matchSize() {}
 
@@ -38,6 +38,7 @@
 #ifndef NAV2_COSTMAP_2D__LAYERED_COSTMAP_HPP_
 #define NAV2_COSTMAP_2D__LAYERED_COSTMAP_HPP_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -45,11 +46,39 @@
 #include "nav2_costmap_2d/cost_values.hpp"
 #include "nav2_costmap_2d/layer.hpp"
 #include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/costmap_pyramid.hpp"
+#include "nav2_costmap_2d/dirty_regions.hpp"
+#include "nav2_costmap_2d/update_trigger.hpp"
+#include "nav2_costmap_2d/worker_pool.hpp"
 
 namespace nav2_costmap_2d
 {
 class Layer;
 
+/**
+ * @brief How long a layer has been taking in LayeredCostmap::updateMap(), in seconds
+ */
+struct LayerTiming
+{
+  std::string name;
+  double bounds_time{0.0};      ///< Time of the last updateBounds() or deferBounds()
+  double costs_time{0.0};       ///< Time of the last updateCosts()
+  double average_time{0.0};     ///< Running average of bounds_time over full updates
+  double max_time{0.0};         ///< Longest bounds_time + costs_time seen
+  unsigned int updates{0};      ///< Cycles that ran updateBounds()
+  unsigned int deferrals{0};    ///< Cycles that deferred updateBounds()
+  unsigned int deferred_in_a_row{0};
+};
+
+/**
+ * @brief How much memory a part of the costmap holds, in bytes
+ */
+struct LayerMemory
+{
+  std::string name;
+  size_t bytes{0};
+};
+
 /**
  * @class LayeredCostmap
  * @brief Instantiates different layer plugins and aggregates them into one score
@@ -78,7 +107,16 @@ public:
     return global_frame_;
   }
 
-  void resizeMap(
+  /**
+   * @brief Resize the master grid and every layer with it
+   *
+   * A grid lined up with the old one, such as that of a map being built as it grows, keeps
+   * the costs of the cells it still covers, in the master and in the layers, and the layers
+   * keep their caches that only depend on the resolution.
+   * @return False, with nothing resized, if the size would take the costmap past its
+   *         memory budget
+   */
+  bool resizeMap(
     unsigned int size_x, unsigned int size_y, double resolution, double origin_x,
     double origin_y,
     bool size_locked = false);
@@ -136,6 +174,125 @@ public:
     return initialized_;
   }
 
+  /**
+   * @brief Run the updateCosts() of tile-safe layers on num_threads threads.
+   *
+   * The update window is split into square tiles of tile_size cells, and each
+   * run of consecutive layers whose isTileSafe() returns true is applied tile
+   * by tile, in layer order within each tile, with the tiles shared between
+   * the threads.  Other layers are still updated over the whole window on the
+   * calling thread.  One thread (the default) disables tiling.
+   */
+  void setParallelUpdate(unsigned int num_threads, unsigned int tile_size);
+
+  /**
+   * @brief Bound the time updateMap() spends, by deferring expensive layers.
+   *
+   * Before each layer's updateBounds(), its average cost is checked against
+   * what is left of budget seconds once the updateCosts() of every layer is
+   * accounted for.  A deferrable layer that would overrun gets deferBounds()
+   * instead, at most max_deferrals cycles in a row, so it keeps updating at
+   * a lower rate rather than stalling.  A budget of 0 (the default) disables
+   * deferral.
+   */
+  void setUpdateBudget(double budget, unsigned int max_deferrals);
+
+  /**
+   * @brief Update up to max_regions separate windows of the map each cycle,
+   *        instead of one box around everything the layers changed.
+   *
+   * Each layer adds the windows it changed through Layer::updateRegions(),
+   * and they are merged down to max_regions before every layer's
+   * updateCosts() is called on each of them.  Changes at opposite ends of a
+   * large map then no longer update all of the map between them.  One
+   * region (the default) is the usual single bounding box.
+   */
+  void setMaxDirtyRegions(unsigned int max_regions);
+
+  /**
+   * @brief The windows of the map that the last updateMap() updated, in cells
+   */
+  std::vector<MapRegion> getDirtyRegions();
+
+  /**
+   * @brief The timing of each layer over the recent updateMap() calls, in plugin order
+   */
+  std::vector<LayerTiming> getLayerTimings();
+
+  /**
+   * @brief Keep an immutable copy of the costmap from the end of each updateMap()
+   *
+   * Readers that take getSnapshot() instead of locking getCostmap() never
+   * wait for an update in progress.  Two copies are kept and recycled once
+   * no reader holds them, so each update costs one copy of the grid.
+   */
+  void setSnapshots(bool enabled);
+
+  /**
+   * @brief The costmap as of the last completed updateMap(), or null if snapshots are off
+   *
+   * Safe to call from any thread without holding the costmap mutex; the
+   * snapshot stays valid for as long as the caller holds on to it.
+   */
+  std::shared_ptr<const Costmap2D> getSnapshot() const
+  {
+    return std::atomic_load(&snapshot_);
+  }
+
+  /**
+   * @brief Refuse resizes that would take the costmap past budget bytes
+   *
+   * A resize is checked before anything is allocated, by estimateMemoryUsage() at the new
+   * size. 0 (the default) allows any size.
+   */
+  void setMemoryBudget(size_t budget);
+
+  size_t getMemoryBudget() const {return memory_budget_;}
+
+  /**
+   * @brief The bytes held by the master grid with its snapshots and pyramid, under the
+   *        name "master", then by each layer in plugin order
+   */
+  std::vector<LayerMemory> getMemoryUsage();
+
+  /**
+   * @brief The bytes the costmap would hold resized to size_x by size_y cells, by what
+   *        each layer reports through Layer::getMemoryPerCell()
+   */
+  size_t estimateMemoryUsage(unsigned int size_x, unsigned int size_y);
+
+  /**
+   * @brief Keep levels max-pooled levels of the costmap, for coarse-first searches
+   *
+   * The levels are brought up to date over the update bounds at the end of
+   * each updateMap(), and rebuilt whole when the costmap is resized or rolls.
+   * 0 (the default) keeps none.
+   */
+  void setPyramidLevels(unsigned int levels);
+
+  /**
+   * @brief The max-pooled levels; lock getCostmap()->getMutex() while reading them
+   */
+  const CostmapPyramid & getPyramid() const {return pyramid_;}
+
+  /**
+   * @brief Have requestUpdate() notify trigger, or do nothing for nullptr (the default)
+   *
+   * The trigger must outlive the costmap or be replaced first.
+   */
+  void setUpdateTrigger(UpdateTrigger * trigger) {update_trigger_ = trigger;}
+
+  /**
+   * @brief Tell the update thread that a layer has new data, so that an event-driven costmap
+   *        updates now rather than at its next period; layers call it from their callbacks
+   */
+  void requestUpdate()
+  {
+    if (update_trigger_) {
+      update_trigger_->notify();
+    }
+  }
+
   /** @brief Updates the stored footprint, updates the circumscribed
    * and inscribed radii, and calls onFootprintChanged() in all
    * layers. */
@@ -174,6 +331,37 @@ private:
   bool size_locked_;
   double circumscribed_radius_, inscribed_radius_;
   std::vector<geometry_msgs::msg::Point> footprint_;
+
+  void updateCostsTiled(
+    std::vector<std::shared_ptr<Layer>>::iterator first,
+    std::vector<std::shared_ptr<Layer>>::iterator last,
+    int x0, int y0, int xn, int yn);
+
+  std::unique_ptr<WorkerPool> update_pool_;
+  unsigned int update_tile_size_;
+
+  bool shouldDefer(const Layer & plugin, const LayerTiming & timing, double elapsed) const;
+
+  double update_budget_;
+  unsigned int max_deferrals_;
+  std::vector<LayerTiming> layer_timings_;
+
+  void updateSnapshot();
+
+  bool snapshots_enabled_;
+  std::shared_ptr<const Costmap2D> snapshot_;  ///< Only accessed with std::atomic_load/store
+  std::shared_ptr<Costmap2D> spare_snapshot_;
+
+  CostmapPyramid pyramid_;
+
+  double getMasterMemoryPerCell() const;
+
+  size_t memory_budget_;
+
+  DirtyRegions dirty_regions_;
+  std::vector<WorldBounds> bounds_regions_;  ///< Scratch for the layers' updateRegions()
+
+  UpdateTrigger * update_trigger_;
 };
 
 }  // namespace nav2_costmap_2d
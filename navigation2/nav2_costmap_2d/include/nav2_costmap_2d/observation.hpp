@@ -32,6 +32,9 @@
 #ifndef NAV2_COSTMAP_2D__OBSERVATION_HPP_
 #define NAV2_COSTMAP_2D__OBSERVATION_HPP_
 
+#include <memory>
+#include <utility>
+
 #include <geometry_msgs/msg/point.hpp>
 #include <sensor_msgs/msg/point_cloud2.hpp>
 
@@ -42,6 +45,7 @@ namespace nav2_costmap_2d
  * @brief Stores an observation in terms of a point cloud and the origin of the source
  * @note Tried to make members and constructor arguments const but the compiler would not accept the default
  * assignment operator for vector insertion!
+ * @note Copies share the cloud, which must not be modified once the observation is handed out
  */
 class Observation
 {
@@ -50,13 +54,28 @@ public:
    * @brief  Creates an empty observation
    */
   Observation()
-  : cloud_(new sensor_msgs::msg::PointCloud2()), obstacle_range_(0.0), raytrace_range_(0.0)
+  : cloud_(std::make_shared<sensor_msgs::msg::PointCloud2>()), obstacle_range_(0.0),
+    raytrace_range_(0.0)
   {
   }
 
   virtual ~Observation()
   {
-    delete cloud_;
+  }
+
+  // declared, as the virtual destructor would otherwise leave observations copied, not moved
+  Observation(const Observation &) = default;
+  Observation(Observation &&) = default;
+  Observation & operator=(const Observation &) = default;
+  Observation & operator=(Observation &&) = default;
+
+  /**
+   * @brief  Creates an observation of a cloud to be filled in, e.g. one reused from a pool
+   * @param cloud The point cloud of the observation
+   */
+  explicit Observation(std::shared_ptr<sensor_msgs::msg::PointCloud2> cloud)
+  : cloud_(std::move(cloud)), obstacle_range_(0.0), raytrace_range_(0.0)
+  {
   }
 
   /**
@@ -69,18 +88,23 @@ public:
   Observation(
     geometry_msgs::msg::Point & origin, const sensor_msgs::msg::PointCloud2 & cloud,
     double obstacle_range, double raytrace_range)
-  : origin_(origin), cloud_(new sensor_msgs::msg::PointCloud2(cloud)),
+  : origin_(origin), cloud_(std::make_shared<sensor_msgs::msg::PointCloud2>(cloud)),
     obstacle_range_(obstacle_range), raytrace_range_(raytrace_range)
   {
   }
 
   /**
-   * @brief  Copy constructor
-   * @param obs The observation to copy
+   * @brief  Creates an observation that shares an existing point cloud
+   * @param origin The origin point of the observation
+   * @param cloud The point cloud of the observation
+   * @param obstacle_range The range out to which an observation should be able to insert obstacles
+   * @param raytrace_range The range out to which an observation should be able to clear via raytracing
    */
-  Observation(const Observation & obs)
-  : origin_(obs.origin_), cloud_(new sensor_msgs::msg::PointCloud2(*(obs.cloud_))),
-    obstacle_range_(obs.obstacle_range_), raytrace_range_(obs.raytrace_range_)
+  Observation(
+    geometry_msgs::msg::Point & origin, std::shared_ptr<sensor_msgs::msg::PointCloud2> cloud,
+    double obstacle_range, double raytrace_range)
+  : origin_(origin), cloud_(cloud), obstacle_range_(obstacle_range),
+    raytrace_range_(raytrace_range)
   {
   }
 
@@ -90,14 +114,17 @@ public:
    * @param obstacle_range The range out to which an observation should be able to insert obstacles
    */
   Observation(const sensor_msgs::msg::PointCloud2 & cloud, double obstacle_range)
-  : cloud_(new sensor_msgs::msg::PointCloud2(cloud)), obstacle_range_(obstacle_range),
-    raytrace_range_(0.0)
+  : cloud_(std::make_shared<sensor_msgs::msg::PointCloud2>(cloud)),
+    obstacle_range_(obstacle_range), raytrace_range_(0.0)
   {
   }
 
   geometry_msgs::msg::Point origin_;
-  sensor_msgs::msg::PointCloud2 * cloud_;
+  std::shared_ptr<sensor_msgs::msg::PointCloud2> cloud_;
   double obstacle_range_, raytrace_range_;
+  /// @brief For the cloud of a planar scan, with its points in beam order: the widest angle
+  /// between neighboring points that is cleared as part of one polygon. 0 raytraces each point.
+  double polygon_max_gap_{0.0};
 };
 
 }  // namespace nav2_costmap_2d
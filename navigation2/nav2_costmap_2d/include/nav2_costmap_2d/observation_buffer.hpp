@@ -37,16 +37,22 @@
 #ifndef NAV2_COSTMAP_2D__OBSERVATION_BUFFER_HPP_
 #define NAV2_COSTMAP_2D__OBSERVATION_BUFFER_HPP_
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <list>
 #include <string>
+#include <unordered_set>
 
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
 #include "rclcpp/time.hpp"
 #include "tf2_ros/buffer.h"
 #include "tf2_sensor_msgs/tf2_sensor_msgs.h"
+#include "sensor_msgs/msg/laser_scan.hpp"
 #include "sensor_msgs/msg/point_cloud2.hpp"
 #include "nav2_costmap_2d/observation.hpp"
+#include "nav2_costmap_2d/observation_ring.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 
 namespace nav2_costmap_2d
@@ -103,18 +109,73 @@ public:
    */
   void bufferCloud(const sensor_msgs::msg::PointCloud2 & cloud);
 
+  /**
+   * @brief  Buffers an observation another buffer made, as the hub of a shared source hands it
+   *         on, with this buffer's own heights and ranges
+   *
+   * When the observation is in this buffer's global frame, and its points are all within the
+   * buffer's heights with no deduplication to do, its cloud is shared rather than copied.
+   * Otherwise the points are filtered into a cloud of the buffer's own, through one transform
+   * at the cloud's stamp when the frames differ.
+   * @param  shared The observation, in the frame of the buffer that made it
+   * @param  min_z The height of its lowest point
+   * @param  max_z The height of its highest point
+   */
+  void bufferShared(const Observation & shared, float min_z, float max_z);
+
+  /**
+   * @brief  Projects a LaserScan straight into the global frame and buffers it
+   *
+   * Unlike projecting the scan into a PointCloud2 for bufferCloud(), the beams are transformed
+   * in one pass with precomputed angles, but all of them at the scan's stamp: the motion of the
+   * sensor during the scan is not corrected for.
+   * @param  scan The scan to be buffered
+   * @param  inf_is_valid Whether +inf ranges are free space out to the maximum range
+   */
+  void bufferScan(const sensor_msgs::msg::LaserScan & scan, bool inf_is_valid);
+
   /**
    * @brief  Pushes copies of all current observations onto the end of the vector passed in
    * @param  observations The vector to be filled
    */
   void getObservations(std::vector<Observation> & observations);
 
+  /**
+   * @brief  Pushes the current observations themselves onto the end of the vector passed in
+   * @param  observations The vector to be filled
+   *
+   * With a ring, this needs no lock and does not hold up the thread buffering observations.
+   */
+  void getObservations(std::vector<std::shared_ptr<const Observation>> & observations);
+
   /**
    * @brief  Check if the observation buffer is being update at its expected rate
    * @return True if it is being updated at the expected rate, false otherwise
    */
   bool isCurrent() const;
 
+  /**
+   * @brief  Bytes held in the clouds of the buffered observations and of those kept for reuse
+   */
+  size_t getMemoryUsage();
+
+  /**
+   * @brief  Keep observations in a ring of fixed capacity instead of a list
+   * @param  capacity Most observations kept, however recent
+   *
+   * The ring is written by the thread buffering observations and read by one other thread,
+   * which may then call getObservations() and isCurrent() without the lock.
+   */
+  void enableRing(size_t capacity);
+
+  /**
+   * @brief  Whether observations are kept in a ring, see enableRing()
+   */
+  bool hasRing() const
+  {
+    return ring_ != nullptr;
+  }
+
   /**
    * @brief  Lock the observation buffer
    */
@@ -136,17 +197,82 @@ public:
    */
   void resetLastUpdated();
 
+  /**
+   * @brief  Keep only one point of each cloud per grid cell and height band
+   * @param  height_band Height of the bands in meters; 0 keeps one point per cell
+   *
+   * The grid must be set with setDeduplicationGrid() before clouds are thinned.
+   */
+  void enableDeduplication(double height_band);
+
+  /**
+   * @brief  Set the grid that deduplication works on, normally the costmap's
+   * @param  cell_size Side of the cells in meters
+   * @param  origin_x The x coordinate of a cell corner in the global frame
+   * @param  origin_y The y coordinate of a cell corner in the global frame
+   */
+  void setDeduplicationGrid(double cell_size, double origin_x, double origin_y);
+
+  /**
+   * @brief  Have the observations cleared as polygons of neighboring points rather than by
+   *         raytracing each point, for buffers of planar scans only
+   * @param  max_gap Widest angle between neighboring points, in radians, whose wedge is cleared
+   */
+  void enablePolygonClearing(double max_gap);
+
 private:
   /**
    * @brief  Removes any stale observations from the buffer list
    */
   void purgeStaleObservations();
 
+  /**
+   * @brief  Moves the observation just buffered at the front of the list into the ring
+   */
+  void publishToRing();
+
+  /**
+   * @brief  Drops observations from first to the end of the list, keeping their clouds for reuse
+   */
+  void eraseObservations(std::list<Observation>::iterator first);
+
+  /**
+   * @brief  Puts a new observation at the front of the list, in a spare node with a pooled
+   *         cloud when there are some
+   */
+  Observation & startObservation();
+
+  /**
+   * @brief  Returns a cloud no one else holds, reusing a pooled one when possible
+   */
+  std::shared_ptr<sensor_msgs::msg::PointCloud2> takePooledCloud();
+
+  /**
+   * @brief  Sets the origin and ranges of an observation from the transform of its sensor
+   */
+  void setOrigin(
+    Observation & observation, const std_msgs::msg::Header & header,
+    const geometry_msgs::msg::TransformStamped & sensor_transform);
+
+  /**
+   * @brief  Transforms the points of cloud into observation_cloud, keeping those within the
+   *         buffer's heights, and with deduplication only the first of each cell and band
+   */
+  void transformCloud(
+    const sensor_msgs::msg::PointCloud2 & cloud, const tf2::Transform & transform,
+    sensor_msgs::msg::PointCloud2 & observation_cloud);
+
+  /**
+   * @brief  Whether a point of the current cloud already landed in the cell and band of this one
+   */
+  bool isDuplicate(float x, float y, float z);
+
   tf2_ros::Buffer & tf2_buffer_;
   const rclcpp::Duration observation_keep_time_;
   const rclcpp::Duration expected_update_rate_;
   nav2_util::LifecycleNode::SharedPtr nh_;
-  rclcpp::Time last_updated_;
+  std::atomic<rcl_time_point_value_t> last_updated_;  ///< @brief Read without the lock with a ring
+  rcl_clock_type_t clock_type_;
   std::string global_frame_;
   std::string sensor_frame_;
   std::list<Observation> observation_list_;
@@ -155,6 +281,26 @@ private:
   std::recursive_mutex lock_;  ///< @brief A lock for accessing data in callbacks safely
   double obstacle_range_, raytrace_range_;
   double tf_tolerance_;
+
+  bool deduplicate_;
+  double dedup_height_band_;
+  double dedup_cell_size_, dedup_origin_x_, dedup_origin_y_;
+  std::unordered_set<uint64_t> dedup_keys_;  ///< @brief Cells seen in the current cloud
+
+  double polygon_max_gap_{0.0};
+
+  // Beam angles of the last scan configuration, and the projected beams of the last scan
+  float scan_angle_min_{0.0f}, scan_angle_increment_{0.0f};
+  std::vector<float> scan_cos_, scan_sin_;
+  std::vector<float> scan_x_, scan_y_, scan_z_;
+  std::vector<unsigned char> scan_keep_;
+
+  std::unique_ptr<ObservationRing> ring_;
+
+  // Clouds of purged observations, reused once their readers let go of them, and the purged
+  // observations' list nodes, so buffering an observation allocates nothing once warmed up
+  std::vector<std::shared_ptr<sensor_msgs::msg::PointCloud2>> cloud_pool_;
+  std::list<Observation> spare_observations_;
 };
 }  // namespace nav2_costmap_2d
 #endif  // NAV2_COSTMAP_2D__OBSERVATION_BUFFER_HPP_
@@ -0,0 +1,131 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__OBSERVATION_HUB_HPP_
+#define NAV2_COSTMAP_2D__OBSERVATION_HUB_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "rclcpp/rclcpp.hpp"
+#include "tf2_ros/buffer.h"
+#include "nav2_costmap_2d/observation_buffer.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class ObservationHub
+ * @brief Lets the obstacle layers of a process, such as those of the local and global costmap,
+ *        share a sensor: its messages are received, transformed and projected once, then handed
+ *        to each layer's own observation buffer
+ *
+ * A source is received on the node and tf buffer of the first layer to subscribe to it, its
+ * host, and transformed to the host's global frame without any height filter. Each layer's
+ * buffer then takes the observation with bufferShared(), applying its own heights and ranges,
+ * which for a layer in the same frame whose heights take in the whole cloud is just a view of
+ * it. When the host leaves, the source moves on to the next layer's node and tf buffer.
+ */
+class ObservationHub
+{
+public:
+  /**
+   * @brief What makes the sources of two layers the same one
+   */
+  struct SourceKey
+  {
+    std::string topic;
+    std::string data_type;
+    std::string sensor_frame;
+    bool inf_is_valid;
+    bool direct_scan_projection;
+    bool latest_only;
+
+    bool operator<(const SourceKey & other) const;
+  };
+
+  /**
+   * @brief What a layer lends the source to receive and transform its messages with, while it
+   *        is the host
+   */
+  struct Host
+  {
+    nav2_util::LifecycleNode::SharedPtr node;
+    rclcpp::Node::SharedPtr rclcpp_node;
+    tf2_ros::Buffer * tf;
+    std::string global_frame;
+    double transform_tolerance;
+  };
+
+  class Source;
+
+  /**
+   * @brief A layer's share of a source, which it stops taking when destroyed
+   *
+   * To be destroyed before the node and tf buffer of its Host are.
+   */
+  class Consumer
+  {
+public:
+    ~Consumer();
+
+    Consumer(const Consumer &) = delete;
+    Consumer & operator=(const Consumer &) = delete;
+
+    /**
+     * @brief Take the source's observations, or not while the layer is inactive
+     *
+     * The source is unsubscribed from while none of its layers is active.
+     */
+    void setActive(bool active);
+
+private:
+    friend class ObservationHub;
+    Consumer(std::shared_ptr<Source> source, uint64_t id);
+
+    std::shared_ptr<Source> source_;
+    uint64_t id_;
+  };
+
+  /**
+   * @brief The hub of the process
+   */
+  static ObservationHub & global();
+
+  /**
+   * @brief Have a layer's buffer take the observations of a source, starting it if it's new
+   * @param on_update Called after each observation the buffer takes
+   */
+  std::unique_ptr<Consumer> subscribe(
+    const SourceKey & key, const Host & host, std::shared_ptr<ObservationBuffer> buffer,
+    std::function<void()> on_update);
+
+  /**
+   * @brief How many sources are received, for testing
+   */
+  size_t sourceCount();
+
+private:
+  std::mutex mutex_;
+  std::map<SourceKey, std::weak_ptr<Source>> sources_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__OBSERVATION_HUB_HPP_
@@ -0,0 +1,97 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__OBSERVATION_RING_HPP_
+#define NAV2_COSTMAP_2D__OBSERVATION_RING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "nav2_costmap_2d/observation.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class ObservationRing
+ * @brief The last capacity observations of one sensor, written by one thread and read by another
+ *
+ * Neither side takes a lock: the writer publishes each observation by bumping a counter, and
+ * the reader walks back from the newest slot, dropping any slot the writer may have reused
+ * while it looked. Observations are shared, never copied, and must not change once pushed.
+ */
+class ObservationRing
+{
+public:
+  explicit ObservationRing(size_t capacity);
+
+  ObservationRing(const ObservationRing &) = delete;
+  ObservationRing & operator=(const ObservationRing &) = delete;
+
+  size_t capacity() const
+  {
+    return capacity_;
+  }
+
+  /**
+   * @brief  Number of observations held, at most capacity()
+   */
+  size_t size() const;
+
+  /**
+   * @brief  Publish an observation stamped stamp_ns, for the writer only
+   * @return The observation it took the slot of, if the ring was full
+   */
+  std::shared_ptr<const Observation> push(
+    std::shared_ptr<const Observation> observation, int64_t stamp_ns);
+
+  /**
+   * @brief  Append the newest observations stamped at or after oldest_ns, newest first
+   * @param  max_count Stop after this many observations
+   *
+   * Stamps are expected to grow with each push; the walk stops at the first older one.
+   */
+  void collect(
+    int64_t oldest_ns, size_t max_count,
+    std::vector<std::shared_ptr<const Observation>> & observations) const;
+
+  /**
+   * @brief  The observation pushed age pushes before the newest one, for the writer only
+   */
+  std::shared_ptr<const Observation> at(size_t age) const;
+
+  /**
+   * @brief  Swap the observation at age for another with the same stamp, for the writer only
+   */
+  void replace(size_t age, std::shared_ptr<const Observation> observation);
+
+private:
+  struct Slot
+  {
+    std::shared_ptr<const Observation> observation;  ///< Only accessed with std::atomic_*
+    std::atomic<int64_t> stamp_ns{0};
+  };
+
+  size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<uint64_t> started_{0};    ///< Pushes begun, so the reader can tell a reused slot
+  std::atomic<uint64_t> published_{0};  ///< Pushes finished
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__OBSERVATION_RING_HPP_
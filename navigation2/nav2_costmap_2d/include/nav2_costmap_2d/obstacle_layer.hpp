@@ -44,10 +44,6 @@
 
 #include "rclcpp/rclcpp.hpp"
 #include "laser_geometry/laser_geometry.hpp"
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wreorder"
-#include "tf2_ros/message_filter.h"
-#pragma GCC diagnostic pop
 #include "message_filters/subscriber.h"
 #include "nav_msgs/msg/occupancy_grid.hpp"
 #include "sensor_msgs/msg/laser_scan.hpp"
@@ -56,7 +52,10 @@
 #include "nav2_costmap_2d/costmap_layer.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
 #include "nav2_costmap_2d/observation_buffer.hpp"
+#include "nav2_costmap_2d/observation_hub.hpp"
 #include "nav2_costmap_2d/footprint.hpp"
+#include "nav2_costmap_2d/worker_pool.hpp"
+#include "nav2_util/transform_scheduler.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -79,11 +78,38 @@ public:
   virtual void updateCosts(
     nav2_costmap_2d::Costmap2D & master_grid,
     int min_i, int min_j, int max_i, int max_j);
+  virtual bool isTileSafe() const {return true;}
+  virtual bool isDeferrable() const {return true;}
+  virtual bool isInitSafe() const {return true;}
+  virtual void deferBounds(
+    double robot_x, double robot_y, double robot_yaw, double * min_x,
+    double * min_y,
+    double * max_x,
+    double * max_y);
+
+  virtual void matchSize();
+  virtual void updateOrigin(double new_origin_x, double new_origin_y);
+  virtual void onFootprintChanged();
+
+  /** @brief The costs, the stamps of the marks when they decay, and the observations. */
+  size_t getMemoryUsage() const override;
+  double getMemoryPerCell() const override;
 
   virtual void activate();
   virtual void deactivate();
   virtual void reset();
 
+  /**
+   * @brief  Let marks clear by themselves once they are older than decay_time
+   * @param decay_time How long marks last in seconds, 0 to only clear by raytracing
+   * @param passes Cycles it takes to look at every mark once
+   *
+   * Each cycle looks at one stripe of rows, so a mark goes between decay_time and decay_time
+   * plus passes cycles after it was last seen. Observation sources that do not clear can then
+   * leave the costmap to decay instead of raytracing.
+   */
+  void setDecayTime(double decay_time, int passes);
+
   /**
    * @brief  A callback to handle buffering LaserScan messages
    * @param message The message returned from a message notifier
@@ -102,6 +128,17 @@ public:
     sensor_msgs::msg::LaserScan::ConstSharedPtr message,
     const std::shared_ptr<nav2_costmap_2d::ObservationBuffer> & buffer);
 
+  /**
+   * @brief  A callback to handle buffering LaserScan messages without projecting them
+   *         into a PointCloud2 first
+   * @param message The message returned from a message notifier
+   * @param buffer A pointer to the observation buffer to update
+   * @param inf_is_valid Whether +inf ranges are free space out to the maximum range
+   */
+  void laserScanDirectCallback(
+    sensor_msgs::msg::LaserScan::ConstSharedPtr message,
+    const std::shared_ptr<nav2_costmap_2d::ObservationBuffer> & buffer, bool inf_is_valid);
+
   /**
    * @brief  A callback to handle buffering PointCloud2 messages
    * @param message The message returned from a message notifier
@@ -146,6 +183,25 @@ protected:
     double * max_x,
     double * max_y);
 
+  /**
+   * @brief  Raytrace from the sensor origin, in map cells (x0, y0), to the
+   *         points [first, last) of the observation's cloud
+   */
+  void raytracePoints(
+    const nav2_costmap_2d::Observation & clearing_observation,
+    unsigned int x0, unsigned int y0, size_t first, size_t last,
+    double * min_x, double * min_y,
+    double * max_x,
+    double * max_y);
+
+  /**
+   * @brief  Clear the fans about the sensor origin that the neighboring points of a planar
+   *         scan make, for an observation with a polygon_max_gap_
+   */
+  void clearPolygons(
+    const nav2_costmap_2d::Observation & clearing_observation,
+    double * min_x, double * min_y, double * max_x, double * max_y);
+
   void updateRaytraceBounds(
     double ox, double oy, double wx, double wy, double range,
     double * min_x, double * min_y,
@@ -154,6 +210,8 @@ protected:
 
   std::vector<geometry_msgs::msg::Point> transformed_footprint_;
   bool footprint_clearing_enabled_;
+  /// @brief The footprint's cells per yaw bin, to clear it without rasterizing it every cycle
+  FootprintMasks footprint_masks_;
   void updateFootprint(
     double robot_x, double robot_y, double robot_yaw, double * min_x,
     double * min_y,
@@ -167,8 +225,13 @@ protected:
   laser_geometry::LaserProjection projector_;
   /// @brief Used for the observation message filters
   std::vector<std::shared_ptr<message_filters::SubscriberBase>> observation_subscribers_;
-  /// @brief Used to make sure that transforms are available for each sensor
-  std::vector<std::shared_ptr<tf2_ros::MessageFilterBase>> observation_notifiers_;
+  /// @brief Holds each sensor's messages until they can be transformed, shared by every
+  /// layer on the tf buffer
+  std::shared_ptr<nav2_util::TransformScheduler> transform_scheduler_;
+  /// @brief Each sensor's place in the scheduler, with its target frames and queue
+  std::vector<nav2_util::TransformScheduler::ChannelPtr> observation_channels_;
+  /// @brief This layer's share of the sources received through the ObservationHub
+  std::vector<std::unique_ptr<ObservationHub::Consumer>> shared_consumers_;
   /// @brief Used to store observations from various sensors
   std::vector<std::shared_ptr<nav2_costmap_2d::ObservationBuffer>> observation_buffers_;
   /// @brief Used to store observation buffers used for marking obstacles
@@ -182,6 +245,44 @@ protected:
 
   bool rolling_window_;
   int combination_method_;
+
+  /// @brief Number of cloud points raytraced per job on the clearing threads
+  static constexpr size_t CLEARING_CHUNK_SIZE = 4096;
+
+  struct ClearingBounds
+  {
+    double min_x, min_y, max_x, max_y;
+  };
+
+  /// @brief Threads for raytraceFreespace(), if clearing_threads > 1
+  std::unique_ptr<WorkerPool> clearing_pool_;
+  /// @brief Bounds grown by each chunk, kept to avoid reallocating every cycle
+  std::vector<ClearingBounds> clearing_bounds_;
+  /// @brief The fan clearPolygons() fills and its cells, kept to avoid reallocating every cycle
+  std::vector<geometry_msgs::msg::Point> polygon_;
+  std::vector<FootprintSpan> polygon_spans_;
+
+  /**
+   * @brief  Free the marks of one stripe of rows that are older than the decay time
+   * @param now_tick The current time, in decay ticks
+   */
+  void decayMarks(
+    uint16_t now_tick, double * min_x, double * min_y, double * max_x, double * max_y);
+
+  /// @brief Ticks a mark lasts for, 0 unless decay_time is set
+  int64_t decay_ticks_{0};
+  int64_t decay_tick_ns_{0};
+  /// @brief Cycles it takes to look at every mark once
+  int decay_passes_{4};
+  /// @brief The first row of the next stripe to decay
+  unsigned int decay_row_{0};
+  /// @brief When each cell was last marked, in decay ticks that wrap around
+  std::vector<uint16_t> mark_stamps_;
+
+  /// @brief The points of an observation to mark and their cells, kept to avoid reallocating
+  std::vector<double> mark_x_, mark_y_;
+  std::vector<unsigned int> mark_mx_, mark_my_;
+  std::vector<unsigned char> mark_valid_;
 };
 
 }  // namespace nav2_costmap_2d
@@ -0,0 +1,103 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__PATH_VALIDITY_HPP_
+#define NAV2_COSTMAP_2D__PATH_VALIDITY_HPP_
+
+#include <cstddef>
+#include <vector>
+
+#include "geometry_msgs/msg/point.hpp"
+#include "geometry_msgs/msg/pose2_d.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/dirty_regions.hpp"
+#include "nav2_costmap_2d/footprint.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class PathValidity
+ * @brief Tells whether a path is still clear of lethal cells, checking again only the poses
+ * within reach of the parts of the map that changed since the last check
+ *
+ * A pose is blocked when a cell of its footprint, filled at its yaw bin, is lethal, or costs
+ * blocking_cost or more short of unknown. An empty footprint checks the pose's cell only, as
+ * fits a path on an inflated map checked against the inscribed cost. The first
+ * check of a path, or one after the map or footprint changed, looks at every pose, with the
+ * cells of all of them found at once. Not thread safe: the map changes and the checks are
+ * to be serialized by the caller.
+ */
+class PathValidity
+{
+public:
+  /**
+   * @param yaw_bins The yaw bins of the footprint masks
+   * @param max_regions The most separate changed regions kept between checks
+   * @param blocking_cost The lowest cost that blocks a pose
+   */
+  explicit PathValidity(
+    unsigned int yaw_bins = 36, size_t max_regions = 16,
+    unsigned char blocking_cost = LETHAL_OBSTACLE);
+
+  /**
+   * @brief Note that the map changed within region, as LayeredCostmap::getDirtyRegions() has it
+   */
+  void addDirtyRegion(const MapRegion & region);
+
+  /**
+   * @brief The first pose of the path whose footprint hits a lethal cell, or -1
+   * @param costmap The map, in whose frame the poses are
+   * @param poses The path
+   * @param footprint_spec The footprint about the robot's origin, e.g. already padded
+   * @param checked Set to the number of poses checked, if not null
+   */
+  int check(
+    const Costmap2D & costmap, const std::vector<geometry_msgs::msg::Pose2D> & poses,
+    const std::vector<geometry_msgs::msg::Point> & footprint_spec, size_t * checked = nullptr);
+
+  /**
+   * @brief Forget the path, so that the next one is checked whole
+   */
+  void reset();
+
+private:
+  bool blocked(const Costmap2D & costmap, size_t index);
+  bool blocks(unsigned char cost) const
+  {
+    return cost >= blocking_cost_ && cost != NO_INFORMATION;
+  }
+  // Whether the footprint of a pose in cell (mx, my) may reach into a changed region
+  bool nearChange(unsigned int mx, unsigned int my) const;
+
+  FootprintMasks masks_;
+  DirtyRegions dirty_;
+  unsigned char blocking_cost_;
+
+  // The path last checked, its poses' cells and which of them were found clear
+  std::vector<geometry_msgs::msg::Pose2D> poses_;
+  std::vector<double> x_, y_;
+  std::vector<unsigned int> mx_, my_;
+  std::vector<unsigned char> on_map_;
+  std::vector<unsigned char> clear_;
+
+  // The geometry of the map it was checked on
+  unsigned int size_x_{0}, size_y_{0};
+  double origin_x_{0.0}, origin_y_{0.0}, resolution_{0.0};
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__PATH_VALIDITY_HPP_
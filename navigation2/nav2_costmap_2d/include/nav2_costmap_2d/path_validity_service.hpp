@@ -0,0 +1,76 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__PATH_VALIDITY_SERVICE_HPP_
+#define NAV2_COSTMAP_2D__PATH_VALIDITY_SERVICE_HPP_
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "nav2_msgs/srv/is_path_valid.hpp"
+#include "nav2_costmap_2d/dirty_regions.hpp"
+#include "nav2_costmap_2d/path_validity.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+
+namespace nav2_costmap_2d
+{
+
+class Costmap2DROS;
+
+/**
+ * @class PathValidityService
+ * @brief Offers is_path_valid, which tells whether a path is still clear on the costmap and
+ * the robot still on it, for the navigator to replan only when it isn't
+ *
+ * The map update hands it the regions each update changed, and a path asked about again is
+ * only checked again near those.
+ */
+class PathValidityService
+{
+public:
+  PathValidityService(nav2_util::LifecycleNode::SharedPtr node, Costmap2DROS & costmap);
+
+  PathValidityService() = delete;
+
+  /**
+   * @brief Note the regions a map update changed, from the update thread
+   */
+  void addDirtyRegions(const std::vector<MapRegion> & regions);
+
+private:
+  void isPathValidCallback(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<nav2_msgs::srv::IsPathValid::Request> request,
+    const std::shared_ptr<nav2_msgs::srv::IsPathValid::Response> response);
+
+  // The poses of path in the costmap's frame, as x, y and yaw
+  bool toCostmapFrame(
+    const nav2_msgs::msg::Path & path, std::vector<geometry_msgs::msg::Pose2D> & poses);
+
+  // The ROS node to create the service on and log with
+  nav2_util::LifecycleNode::SharedPtr node_;
+
+  Costmap2DROS & costmap_;
+
+  std::mutex mutex_;  ///< Between the update thread's regions and the checks
+  PathValidity validity_;
+
+  rclcpp::Service<nav2_msgs::srv::IsPathValid>::SharedPtr service_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__PATH_VALIDITY_SERVICE_HPP_
@@ -0,0 +1,56 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__SCAN_PROJECTION_HPP_
+#define NAV2_COSTMAP_2D__SCAN_PROJECTION_HPP_
+
+#include <cstddef>
+#include <limits>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @brief How the beams of a laser scan are turned into points of another frame
+ */
+struct ScanProjection
+{
+  float rotation[3][3];  ///< From the scan's frame to the target frame
+  float translation[3];
+  float range_min;       ///< Beams are kept with range_min <= range < range_max
+  float range_max;
+  float inf_range{std::numeric_limits<float>::infinity()};  ///< The range of +inf beams
+  float min_z;           ///< Points are kept with min_z <= z <= max_z in the target frame
+  float max_z;
+};
+
+/**
+ * Project count beams, beam i at the angle whose cosine and sine are cos_table[i] and
+ * sin_table[i], into the target frame of projection. Every beam's point is written to x, y
+ * and z, and keep[i] is set to 1 for the beams within the ranges and heights of projection
+ * and to 0 for the others, NaN ranges included.
+ *
+ * It uses SSE2 or NEON, whichever the target has as a baseline, and projectScanScalar()
+ * otherwise; projectScanScalar() is always built as the reference for tests.
+ */
+void projectScan(
+  const ScanProjection & projection, const float * ranges, const float * cos_table,
+  const float * sin_table, size_t count, float * x, float * y, float * z, unsigned char * keep);
+void projectScanScalar(
+  const ScanProjection & projection, const float * ranges, const float * cos_table,
+  const float * sin_table, size_t count, float * x, float * y, float * z, unsigned char * keep);
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__SCAN_PROJECTION_HPP_
@@ -0,0 +1,119 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__SHARED_COSTMAP_HPP_
+#define NAV2_COSTMAP_2D__SHARED_COSTMAP_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_msgs/msg/costmap.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class SharedCostmapWriter
+ * @brief Keeps the latest snapshot of a costmap in a POSIX shared memory segment
+ *
+ * Processes on the same machine map the segment read-only with a SharedCostmapReader and copy
+ * the snapshot out, instead of having the whole costmap serialized for every request. The
+ * snapshot carries a version that every write increases.
+ */
+class SharedCostmapWriter
+{
+public:
+  /**
+   * @brief Take over the segment called name, removing any left by an earlier writer
+   *
+   * The segment is only created by the first write, once the costmap's size is known.
+   */
+  explicit SharedCostmapWriter(const std::string & name);
+
+  /**
+   * @brief Remove the segment, which readers that already mapped it see as retired
+   */
+  ~SharedCostmapWriter();
+
+  SharedCostmapWriter(const SharedCostmapWriter &) = delete;
+  SharedCostmapWriter & operator=(const SharedCostmapWriter &) = delete;
+
+  /**
+   * @brief Replace the snapshot with costmap, whose mutex the caller must hold
+   *
+   * A costmap larger than the segment moves the snapshot to a new segment of the same name.
+   * @throws std::runtime_error if the segment cannot be created
+   */
+  void write(const Costmap2D & costmap);
+
+  /**
+   * @brief The version of the last snapshot written, 0 before the first
+   */
+  uint64_t version() const {return sequence_ / 2;}
+
+private:
+  void createSegment(size_t capacity);
+  void removeSegment();
+
+  std::string name_;
+  void * segment_{nullptr};
+  size_t segment_size_{0};
+  uint64_t sequence_{0};
+};
+
+/**
+ * @class SharedCostmapReader
+ * @brief Copies snapshots out of the segment of a SharedCostmapWriter
+ */
+class SharedCostmapReader
+{
+public:
+  /**
+   * @brief Read the segment called name, which need not exist yet
+   */
+  explicit SharedCostmapReader(const std::string & name);
+  ~SharedCostmapReader();
+
+  SharedCostmapReader(const SharedCostmapReader &) = delete;
+  SharedCostmapReader & operator=(const SharedCostmapReader &) = delete;
+
+  /**
+   * @brief The version of the latest snapshot, 0 if there is none to read
+   */
+  uint64_t version();
+
+  /**
+   * @brief Copy the latest snapshot's grid and metadata into costmap
+   *
+   * The header is left to the caller, the segment does not record the frame.
+   * @param costmap Set to the snapshot
+   * @param version Set to the snapshot's version
+   * @return false if there is no snapshot, or the writer kept changing it while it was copied
+   */
+  bool read(nav2_msgs::msg::Costmap & costmap, uint64_t & version);
+
+private:
+  bool attach();
+  void detach();
+
+  std::string name_;
+  const void * segment_{nullptr};
+  size_t segment_size_{0};
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__SHARED_COSTMAP_HPP_
@@ -38,13 +38,23 @@
 #ifndef NAV2_COSTMAP_2D__STATIC_LAYER_HPP_
 #define NAV2_COSTMAP_2D__STATIC_LAYER_HPP_
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
+#include "geometry_msgs/msg/transform.hpp"
 #include "map_msgs/msg/occupancy_grid_update.hpp"
 #include "message_filters/subscriber.h"
 #include "nav2_costmap_2d/costmap_layer.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
+#include "nav2_costmap_2d/tiled_costmap.hpp"
+#include "nav2_msgs/srv/get_map_tile.hpp"
+#include "nav2_util/distance_field.hpp"
+#include "nav2_util/execution_timer.hpp"
+#include "nav2_util/map_cache.hpp"
+#include "nav2_util/shared_map_registry.hpp"
 #include "nav_msgs/msg/occupancy_grid.hpp"
 #include "rclcpp/rclcpp.hpp"
 
@@ -70,8 +80,47 @@ public:
     nav2_costmap_2d::Costmap2D & master_grid,
     int min_i, int min_j, int max_i, int max_j);
 
+  // The rolling window update looks up a transform on every call
+  virtual bool isTileSafe() const {return !layered_costmap_->isRolling();}
+  virtual bool isInitSafe() const {return true;}
+
   virtual void matchSize();
 
+  /** @brief The costs, in the tiles with tile_size set, and the shared translated map. */
+  size_t getMemoryUsage() const override;
+
+  /** @brief None when rolling, as the layer then keeps the size of its map. */
+  double getMemoryPerCell() const override;
+
+  /**
+   * @brief  Changes whenever the static costs do, for the layers that derive data from them;
+   * 0 while the layer is disabled or has no map
+   */
+  unsigned int getMapVersion() const {return enabled_ ? map_version_.load() : 0;}
+
+  /**
+   * @brief  The static cost of a cell, wherever it is stored; to be read under getMutex()
+   */
+  unsigned char getStaticCost(unsigned int mx, unsigned int my) const
+  {
+    return tiles_ ? tiles_->getCost(mx, my) : getCost(mx, my);
+  }
+
+  /**
+   * @brief  With shared_distance_field, the distances from the cells to the lethal ones of
+   * the map, shared with the nodes of the process that load it; null without it or once an
+   * update changed the map. To be read under getMutex()
+   */
+  std::shared_ptr<const nav2_util::DistanceField> getDistanceField() const
+  {
+    return distance_field_;
+  }
+
+protected:
+  // With tile_size set, the cells live in tiles_ instead of costmap_
+  virtual void initMaps(unsigned int size_x, unsigned int size_y);
+  virtual void resetMaps();
+
 private:
   void getParameters();
   void processMap(const nav_msgs::msg::OccupancyGrid & new_map);
@@ -85,21 +134,100 @@ private:
   void incomingMap(const nav_msgs::msg::OccupancyGrid::SharedPtr new_map);
   void incomingUpdate(map_msgs::msg::OccupancyGridUpdate::ConstSharedPtr update);
 
+  /**
+   * @brief  Callback to translate a map the map_server preloaded, for a switch to it
+   */
+  void incomingCachedMap(const nav_msgs::msg::OccupancyGrid::SharedPtr map);
+
+  /**
+   * @brief  The costs of map, from cost_cache_ or translated and added to it, and with
+   * share_maps from the layers of the process with the same translation
+   */
+  std::shared_ptr<std::vector<unsigned char>> cachedCosts(
+    const nav_msgs::msg::OccupancyGrid & map);
+
+  /**
+   * @brief  With map_tiles, request the region of the map around the robot once the robot
+   * is far enough from the center of the region last loaded that the window could leave it
+   */
+  void requestTileAround(double robot_x, double robot_y);
+
   unsigned char interpretValue(unsigned char value);
 
+  /**
+   * @brief  Translate size occupancy values into costs through cost_translation_table_
+   */
+  void translateCosts(const unsigned char * source, unsigned char * dest, unsigned int size);
+
+  void setStaticCost(unsigned int mx, unsigned int my, unsigned char cost)
+  {
+    if (tiles_) {
+      tiles_->setCost(mx, my, cost);
+    } else {
+      costmap_[getIndex(mx, my)] = cost;
+    }
+  }
+
+  void updateFromTiles(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j);
+
+  /**
+   * @brief  Bring the static costs under the rolling master grid up to date for a window,
+   * sampling only the cells that have not been sampled since the map or transform changed
+   */
+  void updateRollingCache(
+    const nav2_costmap_2d::Costmap2D & master_grid,
+    const geometry_msgs::msg::Transform & transform,
+    int min_i, int min_j, int max_i, int max_j);
+
   std::string global_frame_;  ///< @brief The global frame for the costmap
   std::string map_frame_;  /// @brief frame that map is located in
 
   bool has_updated_data_{false};
+  std::atomic<unsigned int> map_version_{0};
 
   unsigned int x_{0};
   unsigned int y_{0};
   unsigned int width_{0};
   unsigned int height_{0};
 
+  std::unique_ptr<TiledCostmap> tiles_;  ///< @brief Sparse cell storage, null when dense
+
+  unsigned char cost_translation_table_[256];  ///< @brief Cost for each occupancy value
+
+  // The static costs sampled onto the rolling master grid, and whether each cell has been
+  // sampled and fell on the map, kept while the map and its transform stay the same
+  std::vector<unsigned char> rolling_costs_;
+  std::vector<unsigned char> rolling_states_;
+  double rolling_origin_x_{0.0};
+  double rolling_origin_y_{0.0};
+  double rolling_resolution_{0.0};
+  geometry_msgs::msg::Transform rolling_transform_;
+  bool rolling_cache_stale_{true};
+
   rclcpp::Subscription<nav_msgs::msg::OccupancyGrid>::SharedPtr map_sub_;
   rclcpp::Subscription<map_msgs::msg::OccupancyGridUpdate>::SharedPtr map_update_sub_;
 
+  // The translated costs of the maps seen and preloaded, with map_cache_size
+  std::unique_ptr<nav2_util::MapCache<std::vector<unsigned char>>> cost_cache_;
+  rclcpp::Subscription<nav_msgs::msg::OccupancyGrid>::SharedPtr map_cache_sub_;
+  // With share_maps, the costs of the current map, as registered for the other layers
+  std::shared_ptr<std::vector<unsigned char>> shared_costs_;
+  // With shared_distance_field, that of the current map
+  std::shared_ptr<const nav2_util::DistanceField> distance_field_;
+
+  // With map_tiles, the map is requested a region around the robot at a time instead
+  rclcpp::Client<nav2_msgs::srv::GetMapTile>::SharedPtr map_tile_client_;
+  bool tile_requested_{false};
+  bool tile_loaded_{false};
+  double tile_center_x_{0.0};  ///< @brief In the map frame, of the region last requested
+  double tile_center_y_{0.0};
+
+  // From subscribing to the map until the first one arrives, for the startup report
+  nav2_util::ExecutionTimer map_wait_timer_;
+  bool waiting_for_map_{false};
+
   // Parameters
   std::string map_topic_;
   bool map_subscribe_transient_local_;
@@ -109,6 +237,13 @@ private:
   unsigned char lethal_threshold_;
   unsigned char unknown_cost_value_;
   bool trinary_costmap_;
+  int tile_size_;
+  bool map_tiles_;
+  std::string map_tile_service_;
+  int map_tile_zoom_;
+  int map_cache_size_;
+  bool share_maps_{false};
+  bool shared_distance_field_{false};
 };
 
 }  // namespace nav2_costmap_2d
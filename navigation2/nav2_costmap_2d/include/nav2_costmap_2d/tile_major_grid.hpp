@@ -0,0 +1,174 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__TILE_MAJOR_GRID_HPP_
+#define NAV2_COSTMAP_2D__TILE_MAJOR_GRID_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class TileMajorGrid
+ * @brief Costs stored tile by tile, each tile of 2^TileBits x 2^TileBits cells row major
+ *
+ * A window of the map then spans a few tiles, each a cache line or so of every row it covers
+ * and all on the same page, where Costmap2D's row-major layout puts every row of the window
+ * on a line and often a page of its own. Neighborhood work such as footprint checks and
+ * inflation over a large map can copy the costmap in with fromRowMajor() and read it here;
+ * toRowMajor() gives the layout the costmap and its messages use.
+ */
+template<unsigned int TileBits>
+class TileMajorGrid
+{
+public:
+  static constexpr unsigned int tile_size = 1u << TileBits;
+
+  TileMajorGrid() = default;
+
+  TileMajorGrid(unsigned int size_x, unsigned int size_y, unsigned char value = 0)
+  {
+    resize(size_x, size_y, value);
+  }
+
+  /**
+   * @brief Change the size of the grid, setting every cell to value
+   */
+  void resize(unsigned int size_x, unsigned int size_y, unsigned char value = 0)
+  {
+    size_x_ = size_x;
+    size_y_ = size_y;
+    tiles_x_ = (size_x + mask) >> TileBits;
+    const size_t tiles_y = (size_y + mask) >> TileBits;
+    cells_.assign((tiles_x_ * tiles_y) << (2 * TileBits), value);
+  }
+
+  size_t getIndex(unsigned int mx, unsigned int my) const
+  {
+    return (((my >> TileBits) * tiles_x_ + (mx >> TileBits)) << (2 * TileBits)) |
+           ((my & mask) << TileBits) | (mx & mask);
+  }
+
+  unsigned char getCost(unsigned int mx, unsigned int my) const
+  {
+    return cells_[getIndex(mx, my)];
+  }
+
+  void setCost(unsigned int mx, unsigned int my, unsigned char cost)
+  {
+    cells_[getIndex(mx, my)] = cost;
+  }
+
+  /**
+   * @brief Set every cell from size_x * size_y costs stored row major, as Costmap2D does
+   */
+  void fromRowMajor(const unsigned char * grid)
+  {
+    forEachRowSpan([&](size_t index, size_t offset, unsigned int length) {
+        memcpy(&cells_[index], grid + offset, length);
+      });
+  }
+
+  /**
+   * @brief Write every cell to size_x * size_y costs row major, e.g. for publishing
+   */
+  void toRowMajor(unsigned char * grid) const
+  {
+    forEachRowSpan([&](size_t index, size_t offset, unsigned int length) {
+        memcpy(grid + offset, &cells_[index], length);
+      });
+  }
+
+  /**
+   * @brief Call visit(mx, my, cost) for each cell of [x0, xn) x [y0, yn), clipped to the
+   *        grid, a tile at a time
+   */
+  template<typename Visit>
+  void forEachCell(
+    unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn, Visit visit) const
+  {
+    xn = std::min(xn, size_x_);
+    yn = std::min(yn, size_y_);
+    if (x0 >= xn || y0 >= yn) {
+      return;
+    }
+    for (unsigned int ty = y0 >> TileBits; ty <= (yn - 1) >> TileBits; ++ty) {
+      const unsigned int tile_y0 = std::max(y0, ty << TileBits);
+      const unsigned int tile_yn = std::min(yn, (ty + 1) << TileBits);
+      for (unsigned int tx = x0 >> TileBits; tx <= (xn - 1) >> TileBits; ++tx) {
+        const unsigned int tile_x0 = std::max(x0, tx << TileBits);
+        const unsigned int tile_xn = std::min(xn, (tx + 1) << TileBits);
+        const unsigned char * tile = &cells_[(ty * tiles_x_ + tx) << (2 * TileBits)];
+        for (unsigned int my = tile_y0; my < tile_yn; ++my) {
+          const unsigned char * row = tile + ((my & mask) << TileBits);
+          for (unsigned int mx = tile_x0; mx < tile_xn; ++mx) {
+            visit(mx, my, row[mx & mask]);
+          }
+        }
+      }
+    }
+  }
+
+  unsigned int getSizeInCellsX() const {return size_x_;}
+  unsigned int getSizeInCellsY() const {return size_y_;}
+
+  /**
+   * @brief The cells, size_x and size_y rounded up to whole tiles
+   */
+  unsigned char * getCharMap() {return cells_.data();}
+  const unsigned char * getCharMap() const {return cells_.data();}
+
+private:
+  static constexpr unsigned int mask = tile_size - 1;
+
+  // Call copy(index, offset, length) for each run of a row within a tile, by its index here
+  // and its offset in a row-major grid
+  template<typename Copy>
+  void forEachRowSpan(Copy copy) const
+  {
+    const unsigned int whole_x = size_x_ & ~mask;
+    for (unsigned int my = 0; my < size_y_; ++my) {
+      const size_t row = (((my >> TileBits) * tiles_x_) << (2 * TileBits)) |
+        ((my & mask) << TileBits);
+      const size_t offset = static_cast<size_t>(my) * size_x_;
+      // whole tiles with a length the compiler knows, then what is left of the row
+      for (unsigned int mx = 0; mx < whole_x; mx += tile_size) {
+        copy(row + (static_cast<size_t>(mx) << TileBits), offset + mx, tile_size);
+      }
+      if (whole_x < size_x_) {
+        copy(row + (static_cast<size_t>(whole_x) << TileBits), offset + whole_x,
+          size_x_ - whole_x);
+      }
+    }
+  }
+
+  unsigned int size_x_{0};
+  unsigned int size_y_{0};
+  size_t tiles_x_{0};
+  std::vector<unsigned char> cells_;
+};
+
+template<unsigned int TileBits>
+constexpr unsigned int TileMajorGrid<TileBits>::tile_size;
+
+template<unsigned int TileBits>
+constexpr unsigned int TileMajorGrid<TileBits>::mask;
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__TILE_MAJOR_GRID_HPP_
@@ -0,0 +1,114 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__TILED_COSTMAP_HPP_
+#define NAV2_COSTMAP_2D__TILED_COSTMAP_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class TiledCostmap
+ * @brief Cell storage for a costmap that is split into square tiles, where a
+ * tile is only allocated once a cell in it is set to something other than the
+ * default value. Every untouched tile shares one read-only default tile.
+ */
+class TiledCostmap
+{
+public:
+  /**
+   * @brief A window of cells that lies within a single tile
+   */
+  struct Tile
+  {
+    unsigned int x;  ///< @brief Map x of the first cell
+    unsigned int y;  ///< @brief Map y of the first cell
+    unsigned int size_x;  ///< @brief Width of the window in cells
+    unsigned int size_y;  ///< @brief Height of the window in cells
+    const unsigned char * data;  ///< @brief The first cell of the window
+    unsigned int stride;  ///< @brief Distance in cells from one row of data to the next
+    bool shared;  ///< @brief Whether this is the shared default tile
+  };
+
+  explicit TiledCostmap(unsigned int tile_size = 64);
+
+  /**
+   * @brief Change the size of the map, dropping every allocated tile
+   */
+  void resize(unsigned int size_x, unsigned int size_y, unsigned char default_value);
+
+  /**
+   * @brief Drop every allocated tile, so all cells read the default value again
+   */
+  void reset();
+
+  unsigned char getCost(unsigned int mx, unsigned int my) const
+  {
+    const unsigned char * tile = tiles_[tileIndex(mx, my)].get();
+    if (!tile) {
+      return default_value_;
+    }
+    return tile[(my % tile_size_) * tile_size_ + mx % tile_size_];
+  }
+
+  /**
+   * @brief Set a cell, allocating its tile unless the value is the default
+   */
+  void setCost(unsigned int mx, unsigned int my, unsigned char cost);
+
+  /**
+   * @brief Call visit for each tile that overlaps [x0, xn) x [y0, yn), clipped to the window
+   */
+  void forEachTile(
+    unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn,
+    const std::function<void(const Tile &)> & visit) const;
+
+  unsigned int getSizeInCellsX() const {return size_x_;}
+  unsigned int getSizeInCellsY() const {return size_y_;}
+  unsigned int getTileSize() const {return tile_size_;}
+
+  /**
+   * @brief Number of tiles that hold their own cells
+   */
+  unsigned int getAllocatedTiles() const {return allocated_tiles_;}
+
+  /**
+   * @brief Bytes used for cells, counting the shared default tile once
+   */
+  size_t getMemoryUsage() const;
+
+private:
+  unsigned int tileIndex(unsigned int mx, unsigned int my) const
+  {
+    return (my / tile_size_) * tiles_x_ + mx / tile_size_;
+  }
+
+  unsigned int tile_size_;
+  unsigned int size_x_{0};
+  unsigned int size_y_{0};
+  unsigned int tiles_x_{0};
+  unsigned int allocated_tiles_{0};
+  unsigned char default_value_{0};
+  std::vector<unsigned char> default_tile_;
+  std::vector<std::unique_ptr<unsigned char[]>> tiles_;  ///< @brief Null for untouched tiles
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__TILED_COSTMAP_HPP_
@@ -0,0 +1,74 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__UPDATE_TRIGGER_HPP_
+#define NAV2_COSTMAP_2D__UPDATE_TRIGGER_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class UpdateTrigger
+ * @brief Wakes the map update thread when new data arrives, at most at a given rate
+ *
+ * Sensor callbacks, map updates and footprint changes call notify(); the update thread
+ * loops on wait(). Notifications that arrive before the thread gets to them are merged
+ * into one update, and without any the thread still wakes once a period.
+ */
+class UpdateTrigger
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @param min_interval The least time between the starts of two updates, the rate limit
+   * @param max_interval The most time between them when nothing is notified
+   */
+  UpdateTrigger(Clock::duration min_interval, Clock::duration max_interval);
+
+  /**
+   * @brief Ask for an update; safe to call from any thread, and cheap enough for every message
+   */
+  void notify();
+
+  /**
+   * @brief Make the current or next wait() return at once, e.g. to stop the update thread
+   */
+  void interrupt();
+
+  /**
+   * @brief Block until an update is due: once notified and min_interval after the last
+   *        one started, or max_interval after it regardless
+   * @return The number of notifications the update takes in, 0 when only the period ran out
+   */
+  unsigned int wait();
+
+private:
+  const Clock::duration min_interval_;
+  const Clock::duration max_interval_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  unsigned int pending_{0};
+  bool interrupted_{false};
+  Clock::time_point last_update_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__UPDATE_TRIGGER_HPP_
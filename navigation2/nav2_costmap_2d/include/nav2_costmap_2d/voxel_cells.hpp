@@ -0,0 +1,70 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__VOXEL_CELLS_HPP_
+#define NAV2_COSTMAP_2D__VOXEL_CELLS_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "nav2_msgs/msg/voxel_grid.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/** @brief The centre of a voxel, or of a block of them when downsampled */
+struct VoxelCell
+{
+  double x;
+  double y;
+  double z;
+};
+
+/**
+ * @class VoxelCellCollector
+ * @brief Finds the marked and unknown voxels of a nav2_msgs::msg::VoxelGrid, for visualization
+ *
+ * Only the set bits of each column are visited, so an empty column costs one word rather
+ * than a lookup per level. With a downsampling factor above 1, each block of that many
+ * voxels a side becomes one cell at its centre, marked if any voxel in it is, and otherwise
+ * unknown if any is. The cells' buffers are kept from one grid to the next.
+ */
+class VoxelCellCollector
+{
+public:
+  explicit VoxelCellCollector(unsigned int downsample = 1);
+
+  /**
+   * @param grid The grid, of at most 16 levels
+   * @param unknown Whether to also collect the unknown voxels
+   */
+  void collect(const nav2_msgs::msg::VoxelGrid & grid, bool unknown = true);
+
+  const std::vector<VoxelCell> & marked() const {return marked_;}
+  const std::vector<VoxelCell> & unknown() const {return unknown_;}
+
+  /** @brief The side of the collected cells in voxels */
+  unsigned int downsample() const {return downsample_;}
+
+private:
+  unsigned int downsample_;
+  std::vector<uint32_t> marked_columns_;   ///< A bit per level of each downsampled column
+  std::vector<uint32_t> unknown_columns_;
+  std::vector<VoxelCell> marked_;
+  std::vector<VoxelCell> unknown_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__VOXEL_CELLS_HPP_
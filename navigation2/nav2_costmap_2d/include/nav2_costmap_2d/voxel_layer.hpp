@@ -38,12 +38,16 @@
 #ifndef NAV2_COSTMAP_2D__VOXEL_LAYER_HPP_
 #define NAV2_COSTMAP_2D__VOXEL_LAYER_HPP_
 
+#include <memory>
+#include <vector>
+
 #include <rclcpp/rclcpp.hpp>
 #include <nav2_costmap_2d/layer.hpp>
 #include <nav2_costmap_2d/layered_costmap.hpp>
 #include <nav2_costmap_2d/observation_buffer.hpp>
 #include <nav_msgs/msg/occupancy_grid.hpp>
 #include <nav2_msgs/msg/voxel_grid.hpp>
+#include <nav2_msgs/msg/voxel_grid_update.hpp>
 #include <sensor_msgs/msg/laser_scan.hpp>
 #include <laser_geometry/laser_geometry.hpp>
 #include <sensor_msgs/msg/point_cloud.hpp>
@@ -51,6 +55,7 @@
 #include <message_filters/subscriber.h>
 #include <nav2_costmap_2d/obstacle_layer.hpp>
 #include <nav2_voxel_grid/voxel_grid.hpp>
+#include <nav2_voxel_grid/voxel_grid_64.hpp>
 
 namespace nav2_costmap_2d
 {
@@ -81,11 +86,19 @@ public:
   virtual void matchSize();
   virtual void reset();
 
+  /** @brief The obstacle layer's memory and a column of voxels a cell. */
+  size_t getMemoryUsage() const override;
+  double getMemoryPerCell() const override;
+
+  /** @brief Dump the voxel columns along with the layer's costs. */
+  virtual void getDumpGrids(std::vector<DumpGrid> & grids);
+
 protected:
   virtual void resetMaps();
 
 private:
   void reconfigureCB();
+  void publishVoxelGrid();
   void clearNonLethal(double wx, double wy, double w_size_x, double w_size_y, bool clear_no_info);
   virtual void raytraceFreespace(
     const nav2_costmap_2d::Observation & clearing_observation,
@@ -95,9 +108,24 @@ private:
 
   bool publish_voxel_;
   rclcpp::Publisher<nav2_msgs::msg::VoxelGrid>::SharedPtr voxel_pub_;
+  // the voxel grid as a stream of changed columns, with a keyframe every
+  // voxel_keyframe_interval messages and whenever the grid moves
+  bool publish_voxel_updates_;
+  int voxel_keyframe_interval_;
+  rclcpp::Publisher<nav2_msgs::msg::VoxelGridUpdate>::SharedPtr voxel_update_pub_;
+  nav2_msgs::msg::VoxelGridUpdate voxel_update_;
+  uint64_t voxel_update_sequence_{0};
+  int voxel_updates_since_keyframe_{0};
+  std::vector<uint32_t> voxel_sent_;  ///< The grid as receivers of the updates have it
   nav2_voxel_grid::VoxelGrid voxel_grid_;
+  // used instead of voxel_grid_ when there are more z_voxels than fit in its 16 bits
+  std::unique_ptr<nav2_voxel_grid::VoxelGrid64> voxel_grid_64_;
   double z_resolution_, origin_z_;
   int unknown_threshold_, mark_threshold_, size_z_;
+  // 0 traces each clearing ray with Bresenham, 1 traces them all at once with a 3D DDA
+  // and 2 does the same but updates the costmap once per column a ray crosses
+  int clearing_mode_;
+  std::vector<double> clearing_end_points_;
   rclcpp::Publisher<sensor_msgs::msg::PointCloud>::SharedPtr clearing_endpoints_pub_;
   sensor_msgs::msg::PointCloud clearing_endpoints_;
 
@@ -0,0 +1,84 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__WORKER_POOL_HPP_
+#define NAV2_COSTMAP_2D__WORKER_POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class WorkerPool
+ * @brief A fixed set of threads that runs batches of independent jobs
+ */
+class WorkerPool
+{
+public:
+  /**
+   * @brief Start num_threads - 1 workers; the thread calling run() is the last one
+   */
+  explicit WorkerPool(unsigned int num_threads);
+
+  /**
+   * @brief Stop and join the workers
+   */
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool & operator=(const WorkerPool &) = delete;
+
+  /**
+   * @brief Number of threads taking part in run(), including the caller
+   */
+  unsigned int size() const
+  {
+    return workers_.size() + 1;
+  }
+
+  /**
+   * @brief Call job(i) for every i in [0, job_count) and return once all have finished
+   *
+   * Jobs are handed out one at a time, so they may take uneven amounts of time.
+   * Only one thread may call run() at a time.
+   */
+  void run(const std::function<void(int)> & job, int job_count);
+
+private:
+  void workerLoop();
+  void drain();
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+
+  // The current batch, guarded by mutex_ except for next_job_
+  const std::function<void(int)> * job_{nullptr};
+  int job_count_{0};
+  std::atomic<int> next_job_{0};
+  unsigned int generation_{0};
+  unsigned int busy_workers_{0};
+  bool shutdown_{false};
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__WORKER_POOL_HPP_
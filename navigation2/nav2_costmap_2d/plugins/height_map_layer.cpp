@@ -0,0 +1,348 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/height_map_layer.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <vector>
+
+#include "nav2_util/line_traversal.hpp"
+#include "pluginlib/class_list_macros.hpp"
+#include "sensor_msgs/point_cloud2_iterator.hpp"
+
+PLUGINLIB_EXPORT_CLASS(nav2_costmap_2d::HeightMapLayer, nav2_costmap_2d::Layer)
+
+namespace nav2_costmap_2d
+{
+
+void HeightMapLayer::onInitialize()
+{
+  ObstacleLayer::onInitialize();
+
+  declareParameter("origin_z", rclcpp::ParameterValue(0.0));
+  declareParameter("z_resolution", rclcpp::ParameterValue(0.05));
+  declareParameter("clearing_tolerance", rclcpp::ParameterValue(0.05));
+  declareParameter("mark_threshold", rclcpp::ParameterValue(0));
+  declareParameter("publish_height_map", rclcpp::ParameterValue(false));
+
+  node_->get_parameter(name_ + "." + "origin_z", origin_z_);
+  node_->get_parameter(name_ + "." + "z_resolution", z_resolution_);
+  node_->get_parameter(name_ + "." + "clearing_tolerance", clearing_tolerance_);
+  node_->get_parameter(name_ + "." + "mark_threshold", mark_threshold_);
+  node_->get_parameter(name_ + "." + "publish_height_map", publish_height_map_);
+
+  if (decay_ticks_) {
+    // marks are cleared column by column, and the columns keep no stamps
+    RCLCPP_WARN(node_->get_logger(), "decay_time is not supported by the height map layer");
+    setDecayTime(0.0, 1);
+  }
+
+  if (publish_height_map_) {
+    height_map_pub_ = node_->create_publisher<nav2_msgs::msg::HeightMap>(
+      "height_map", rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable());
+  }
+
+  matchSize();
+}
+
+void HeightMapLayer::matchSize()
+{
+  // the columns are kept with the costs, when those are
+  Costmap2D * master = layered_costmap_->getCostmap();
+  unsigned int old_size_x = size_x_;
+  unsigned int old_size_y = size_y_;
+  int offset_x = 0, offset_y = 0;
+  std::vector<HeightColumn> old_columns;
+  if (columns_.size() == static_cast<size_t>(old_size_x) * old_size_y &&
+    alignedOffset(master->getResolution(), master->getOriginX(), master->getOriginY(),
+    offset_x, offset_y))
+  {
+    old_columns.swap(columns_);
+  }
+
+  ObstacleLayer::matchSize();
+  columns_.assign(static_cast<size_t>(size_x_) * size_y_, HeightColumn{0, 0, 0});
+  if (!old_columns.empty()) {
+    copyOverlap(old_columns.data(), old_size_x, old_size_y, columns_.data(), size_x_, size_y_,
+      offset_x, offset_y);
+  }
+}
+
+size_t HeightMapLayer::getMemoryUsage() const
+{
+  return ObstacleLayer::getMemoryUsage() + columns_.capacity() * sizeof(HeightColumn);
+}
+
+double HeightMapLayer::getMemoryPerCell() const
+{
+  return ObstacleLayer::getMemoryPerCell() + sizeof(HeightColumn);
+}
+
+void HeightMapLayer::getDumpGrids(std::vector<DumpGrid> & grids)
+{
+  ObstacleLayer::getDumpGrids(grids);
+  grids.push_back({name_ + "/columns", size_x_, size_y_, 0, sizeof(HeightColumn),
+      columns_.data()});
+}
+
+void HeightMapLayer::reset()
+{
+  deactivate();
+  resetMaps();
+  current_ = true;
+  activate();
+  undeclareAllParameters();
+}
+
+void HeightMapLayer::resetMaps()
+{
+  Costmap2D::resetMaps();
+  std::fill(columns_.begin(), columns_.end(), HeightColumn{0, 0, 0});
+}
+
+uint8_t HeightMapLayer::heightStep(double z) const
+{
+  double step = std::floor((z - origin_z_) / z_resolution_);
+  return static_cast<uint8_t>(std::min(std::max(step, 0.0), 255.0));
+}
+
+void HeightMapLayer::updateBounds(
+  double robot_x, double robot_y, double robot_yaw, double * min_x,
+  double * min_y, double * max_x, double * max_y)
+{
+  if (rolling_window_) {
+    updateOrigin(robot_x - getSizeInMetersX() / 2, robot_y - getSizeInMetersY() / 2);
+  }
+  if (!enabled_) {
+    return;
+  }
+  useExtraBounds(min_x, min_y, max_x, max_y);
+
+  bool current = true;
+  std::vector<Observation> observations, clearing_observations;
+
+  // get the marking observations
+  current = getMarkingObservations(observations) && current;
+
+  // get the clearing observations
+  current = getClearingObservations(clearing_observations) && current;
+
+  // update the global current status
+  current_ = current;
+
+  // raytrace freespace
+  for (unsigned int i = 0; i < clearing_observations.size(); ++i) {
+    raytraceFreespace(clearing_observations[i], min_x, min_y, max_x, max_y);
+  }
+
+  // fold each point into the band of its column
+  for (const Observation & obs : observations) {
+    const sensor_msgs::msg::PointCloud2 & cloud = *(obs.cloud_);
+    double sq_obstacle_range = obs.obstacle_range_ * obs.obstacle_range_;
+
+    sensor_msgs::PointCloud2ConstIterator<float> iter_x(cloud, "x");
+    sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud, "y");
+    sensor_msgs::PointCloud2ConstIterator<float> iter_z(cloud, "z");
+
+    for (; iter_x != iter_x.end(); ++iter_x, ++iter_y, ++iter_z) {
+      // if the obstacle is too high or too far away from the robot we won't add it
+      if (*iter_z > max_obstacle_height_) {
+        continue;
+      }
+      double sq_dist = (*iter_x - obs.origin_.x) * (*iter_x - obs.origin_.x) +
+        (*iter_y - obs.origin_.y) * (*iter_y - obs.origin_.y) +
+        (*iter_z - obs.origin_.z) * (*iter_z - obs.origin_.z);
+      if (sq_dist >= sq_obstacle_range) {
+        continue;
+      }
+
+      unsigned int mx, my;
+      if (!worldToMap(*iter_x, *iter_y, mx, my)) {
+        continue;
+      }
+
+      unsigned int index = getIndex(mx, my);
+      HeightColumn & column = columns_[index];
+      uint8_t step = heightStep(*iter_z);
+      if (column.hits == 0) {
+        column.min_z = column.max_z = step;
+      } else {
+        column.min_z = std::min(column.min_z, step);
+        column.max_z = std::max(column.max_z, step);
+      }
+      if (column.hits < 255) {
+        ++column.hits;
+      }
+
+      if (column.hits > mark_threshold_) {
+        costmap_[index] = LETHAL_OBSTACLE;
+        touch(static_cast<double>(*iter_x), static_cast<double>(*iter_y),
+          min_x, min_y, max_x, max_y);
+      }
+    }
+  }
+
+  if (publish_height_map_) {
+    publishHeightMap();
+  }
+
+  updateFootprint(robot_x, robot_y, robot_yaw, min_x, min_y, max_x, max_y);
+}
+
+void HeightMapLayer::raytraceFreespace(
+  const Observation & clearing_observation, double * min_x, double * min_y,
+  double * max_x, double * max_y)
+{
+  double ox = clearing_observation.origin_.x;
+  double oy = clearing_observation.origin_.y;
+  double oz = clearing_observation.origin_.z;
+  const sensor_msgs::msg::PointCloud2 & cloud = *(clearing_observation.cloud_);
+
+  unsigned int x0, y0;
+  if (!worldToMap(ox, oy, x0, y0)) {
+    RCLCPP_WARN(node_->get_logger(),
+      "Sensor origin at (%.2f, %.2f) is out of map bounds. The costmap cannot raytrace for it.",
+      ox, oy);
+    return;
+  }
+  touch(ox, oy, min_x, min_y, max_x, max_y);
+
+  double range = clearing_observation.raytrace_range_;
+  double map_end_x = origin_x_ + getSizeInMetersX();
+  double map_end_y = origin_y_ + getSizeInMetersY();
+  const nav2_util::LineCell<2> origin{{static_cast<int>(x0), static_cast<int>(y0)},
+    getIndex(x0, y0)};
+  const int stride[2] = {1, static_cast<int>(size_x_)};
+
+  sensor_msgs::PointCloud2ConstIterator<float> iter_x(cloud, "x");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud, "y");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_z(cloud, "z");
+  for (; iter_x != iter_x.end(); ++iter_x, ++iter_y, ++iter_z) {
+    double a = *iter_x - ox;
+    double b = *iter_y - oy;
+    double c = *iter_z - oz;
+    double sq_length = a * a + b * b;
+    if (sq_length == 0.0) {
+      continue;
+    }
+    double length = std::sqrt(sq_length);
+
+    // the ray stops at the raytrace range and the edges of the map
+    double t = std::min(1.0, range / length);
+    if (ox + a * t < origin_x_) {
+      t = (origin_x_ - ox) / a;
+    }
+    if (oy + b * t < origin_y_) {
+      t = (origin_y_ - oy) / b;
+    }
+    if (ox + a * t > map_end_x) {
+      t = (map_end_x - 0.001 - ox) / a;
+    }
+    if (oy + b * t > map_end_y) {
+      t = (map_end_y - 0.001 - oy) / b;
+    }
+    double wx = ox + a * t;
+    double wy = oy + b * t;
+    unsigned int x1, y1;
+    if (!worldToMap(wx, wy, x1, y1)) {
+      continue;
+    }
+    updateRaytraceBounds(ox, oy, wx, wy, range, min_x, min_y, max_x, max_y);
+
+    // the column the point itself landed in holds what it hit, unless the ray was cut short
+    unsigned int hit_offset = t >= 1.0 ? getIndex(x1, y1) : UINT_MAX;
+
+    // a ray passes through a column over about a cell, climbing this much meanwhile
+    double half_climb = 0.5 * std::abs(c) / length * resolution_ + clearing_tolerance_;
+    const int delta[2] = {static_cast<int>(x1) - static_cast<int>(x0),
+      static_cast<int>(y1) - static_cast<int>(y0)};
+    nav2_util::walkLine(origin, delta, stride, nav2_util::lineStepsWithin(delta, 0.0),
+      [&](const nav2_util::LineCell<2> & cell) {
+        if (cell.offset == hit_offset) {
+          return;
+        }
+        // the ray's height where it is closest to the column's center
+        double cx = origin_x_ + (cell.coord[0] + 0.5) * resolution_ - ox;
+        double cy = origin_y_ + (cell.coord[1] + 0.5) * resolution_ - oy;
+        double along = std::min(std::max((cx * a + cy * b) / sq_length, 0.0), 1.0);
+        double z = oz + c * along;
+        clearColumn(cell.offset, z - half_climb, z + half_climb);
+      });
+  }
+}
+
+void HeightMapLayer::clearColumn(unsigned int offset, double low, double high)
+{
+  HeightColumn & column = columns_[offset];
+  if (column.hits == 0) {
+    costmap_[offset] = FREE_SPACE;
+    return;
+  }
+
+  // the steps [first, last] that [low, high] reaches into
+  int first = static_cast<int>(std::floor((low - origin_z_) / z_resolution_));
+  int last = static_cast<int>(std::floor((high - origin_z_) / z_resolution_));
+  if (first <= column.min_z && last >= column.max_z) {
+    column = HeightColumn{0, 0, 0};
+    costmap_[offset] = FREE_SPACE;
+  } else if (first <= column.min_z && last >= column.min_z) {
+    column.min_z = static_cast<uint8_t>(last + 1);
+  } else if (first <= column.max_z && last >= column.max_z) {
+    column.max_z = static_cast<uint8_t>(first - 1);
+  }
+}
+
+void HeightMapLayer::updateOrigin(double new_origin_x, double new_origin_y)
+{
+  // shift the columns along with the costs they belong to
+  int cell_ox = static_cast<int>((new_origin_x - origin_x_) / resolution_);
+  int cell_oy = static_cast<int>((new_origin_y - origin_y_) / resolution_);
+  shiftMapRegion(columns_.data(), size_x_, size_y_, cell_ox, cell_oy, HeightColumn{0, 0, 0});
+  ObstacleLayer::updateOrigin(new_origin_x, new_origin_y);
+}
+
+void HeightMapLayer::publishHeightMap()
+{
+  // only made for whoever asks for it
+  if (height_map_pub_->get_subscription_count() == 0) {
+    return;
+  }
+
+  nav2_msgs::msg::HeightMap & msg = height_map_;
+  msg.header.frame_id = global_frame_;
+  msg.header.stamp = node_->now();
+  msg.origin.x = origin_x_;
+  msg.origin.y = origin_y_;
+  msg.origin.z = origin_z_;
+  msg.resolutions.x = resolution_;
+  msg.resolutions.y = resolution_;
+  msg.resolutions.z = z_resolution_;
+  msg.size_x = size_x_;
+  msg.size_y = size_y_;
+  msg.columns.clear();
+  msg.min_z.clear();
+  msg.max_z.clear();
+  for (unsigned int i = 0; i < columns_.size(); ++i) {
+    if (columns_[i].hits > mark_threshold_) {
+      msg.columns.push_back(i);
+      msg.min_z.push_back(columns_[i].min_z);
+      msg.max_z.push_back(columns_[i].max_z);
+    }
+  }
+  height_map_pub_->publish(msg);
+}
+
+}  // namespace nav2_costmap_2d
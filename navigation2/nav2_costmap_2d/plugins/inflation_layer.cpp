@@ -38,12 +38,14 @@
 #include "nav2_costmap_2d/inflation_layer.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
-#include <map>
+#include <memory>
 #include <vector>
 
 #include "nav2_costmap_2d/costmap_math.hpp"
 #include "nav2_costmap_2d/footprint.hpp"
+#include "nav2_costmap_2d/static_layer.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "rclcpp/parameter_events_filter.hpp"
 
@@ -62,13 +64,21 @@ InflationLayer::InflationLayer()
   cost_scaling_factor_(0),
   inflate_unknown_(false),
   cell_inflation_radius_(0),
-  cached_cell_inflation_radius_(0),
-  cached_costs_(nullptr),
-  cached_distances_(nullptr),
+  resolution_(0),
   last_min_x_(-std::numeric_limits<float>::max()),
   last_min_y_(-std::numeric_limits<float>::max()),
   last_max_x_(std::numeric_limits<float>::max()),
-  last_max_y_(std::numeric_limits<float>::max())
+  last_max_y_(std::numeric_limits<float>::max()),
+  distance_transform_(false),
+  stamp_kernel_(false),
+  incremental_(false),
+  incremental_valid_(false),
+  block_size_(0),
+  last_origin_x_(0),
+  last_origin_y_(0),
+  cache_static_inflation_(false),
+  static_inflation_valid_(false),
+  static_version_(0)
 {
 }
 
@@ -79,16 +89,25 @@ InflationLayer::onInitialize()
   declareParameter("inflation_radius", rclcpp::ParameterValue(0.55));
   declareParameter("cost_scaling_factor", rclcpp::ParameterValue(10.0));
   declareParameter("inflate_unknown", rclcpp::ParameterValue(false));
+  declareParameter("distance_transform", rclcpp::ParameterValue(false));
+  declareParameter("incremental", rclcpp::ParameterValue(false));
+  declareParameter("stamp_kernel", rclcpp::ParameterValue(false));
+  declareParameter("cache_static_inflation", rclcpp::ParameterValue(false));
 
   node_->get_parameter(name_ + "." + "enabled", enabled_);
   node_->get_parameter(name_ + "." + "inflation_radius", inflation_radius_);
   node_->get_parameter(name_ + "." + "cost_scaling_factor", cost_scaling_factor_);
   node_->get_parameter(name_ + "." + "inflate_unknown", inflate_unknown_);
+  node_->get_parameter(name_ + "." + "distance_transform", distance_transform_);
+  node_->get_parameter(name_ + "." + "incremental", incremental_);
+  node_->get_parameter(name_ + "." + "stamp_kernel", stamp_kernel_);
+  node_->get_parameter(name_ + "." + "cache_static_inflation", cache_static_inflation_);
 
   current_ = true;
   seen_.clear();
   need_reinflation_ = false;
   cell_inflation_radius_ = cellDistance(inflation_radius_);
+  caches_valid_ = false;
   matchSize();
 }
 
@@ -96,10 +115,40 @@ void
 InflationLayer::matchSize()
 {
   nav2_costmap_2d::Costmap2D * costmap = layered_costmap_->getCostmap();
-  resolution_ = costmap->getResolution();
-  cell_inflation_radius_ = cellDistance(inflation_radius_);
-  computeCaches();
-  seen_ = std::vector<bool>(costmap->getSizeInCellsX() * costmap->getSizeInCellsY(), false);
+  // the kernels only depend on the resolution, so a map that grows or moves keeps them
+  if (!caches_valid_ || costmap->getResolution() != resolution_) {
+    resolution_ = costmap->getResolution();
+    cell_inflation_radius_ = cellDistance(inflation_radius_);
+    computeCaches();
+    caches_valid_ = true;
+  }
+  seen_.assign(costmap->getSizeInCellsX() * costmap->getSizeInCellsY(), 0);
+  incremental_valid_ = false;
+  static_inflation_valid_ = false;
+}
+
+size_t
+InflationLayer::getMemoryUsage() const
+{
+  size_t bytes = seen_.capacity() * sizeof(uint16_t) + kernel_.getMemoryUsage() +
+    sq_distance_costs_.capacity() +
+    (column_distances_.capacity() + envelope_sites_.capacity() + row_sq_distances_.capacity()) *
+    sizeof(int) + envelope_bounds_.capacity() * sizeof(double) +
+    lethal_.capacity() + inflated_.capacity() + block_level_.capacity() +
+    static_inflated_.capacity();
+  bytes += inflation_cells_.capacity() * sizeof(std::vector<CellData>);
+  for (const auto & bin : inflation_cells_) {
+    bytes += bin.capacity() * sizeof(CellData);
+  }
+  return bytes;
+}
+
+double
+InflationLayer::getMemoryPerCell() const
+{
+  // the distance transform's scratch covers the whole map on a full update
+  return sizeof(uint16_t) + (distance_transform_ ? sizeof(int) : 0) + (incremental_ ? 2.0 : 0.0) +
+         (cache_static_inflation_ ? 1.0 : 0.0);
 }
 
 void
@@ -136,6 +185,32 @@ InflationLayer::updateBounds(
   }
 }
 
+void
+InflationLayer::updateRegions(
+  double /*robot_x*/, double /*robot_y*/, double /*robot_yaw*/, bool /*deferred*/,
+  std::vector<WorldBounds> & regions)
+{
+  // as with a single box, what changed on the last cycle is updated again with this one's
+  std::vector<WorldBounds> previous;
+  previous.swap(last_regions_);
+  last_regions_ = regions;
+
+  if (need_reinflation_) {
+    double max = std::numeric_limits<float>::max();
+    regions.assign(1, {-max, -max, max, max});
+    need_reinflation_ = false;
+    return;
+  }
+
+  regions.insert(regions.end(), previous.begin(), previous.end());
+  for (WorldBounds & bounds : regions) {
+    bounds.min_x -= inflation_radius_;
+    bounds.min_y -= inflation_radius_;
+    bounds.max_x += inflation_radius_;
+    bounds.max_y += inflation_radius_;
+  }
+}
+
 void
 InflationLayer::onFootprintChanged()
 {
@@ -143,6 +218,8 @@ InflationLayer::onFootprintChanged()
   cell_inflation_radius_ = cellDistance(inflation_radius_);
   computeCaches();
   need_reinflation_ = true;
+  incremental_valid_ = false;
+  static_inflation_valid_ = false;
 
   RCLCPP_DEBUG(rclcpp::get_logger(
       "nav2_costmap_2d"), "InflationLayer::onFootprintChanged(): num footprint points: %lu,"
@@ -150,6 +227,92 @@ InflationLayer::onFootprintChanged()
     layered_costmap_->getFootprint().size(), inscribed_radius_, inflation_radius_);
 }
 
+unsigned char
+InflationLayer::getCircumscribedCost() const
+{
+  double circumscribed_radius = layered_costmap_->getCircumscribedRadius();
+  if (inflation_radius_ < circumscribed_radius || resolution_ <= 0.0) {
+    return 0;
+  }
+  return computeCost(circumscribed_radius / resolution_);
+}
+
+unsigned char
+InflationLayer::findCircumscribedCost(LayeredCostmap * layered_costmap)
+{
+  // a center cost below every layer's threshold has no obstacle within the radius in any
+  int cost = -1;
+  for (auto & plugin : *layered_costmap->getPlugins()) {
+    auto inflation = std::dynamic_pointer_cast<InflationLayer>(plugin);
+    if (inflation) {
+      int layer_cost = inflation->getCircumscribedCost();
+      cost = cost < 0 ? layer_cost : std::min(cost, layer_cost);
+    }
+  }
+  return static_cast<unsigned char>(std::max(cost, 0));
+}
+
+template<typename AssignFn>
+void
+InflationLayer::propagate(unsigned int size_x, unsigned int size_y, AssignFn assign)
+{
+  // Process cells by increasing distance; new cells are appended to the
+  // corresponding distance bin, so they
+  // can overtake previously inserted but farther away cells
+  for (auto & bin : inflation_cells_) {
+    for (unsigned int i = 0; i < bin.size(); ++i) {
+      // process all cells at the bin's distance
+      const CellData & cell = bin[i];
+
+      unsigned int index = cell.index_;
+
+      // ignore if already visited
+      if (isSeen(index)) {
+        continue;
+      }
+
+      seen_[index] = seen_generation_;
+
+      unsigned int mx = cell.x_;
+      unsigned int my = cell.y_;
+      unsigned int sx = cell.src_x_;
+      unsigned int sy = cell.src_y_;
+
+      // assign the cost associated with the distance from an obstacle to the cell
+      assign(index, costLookup(mx, my, sx, sy));
+
+      // attempt to put the neighbors of the current cell onto the inflation list
+      if (mx > 0) {
+        enqueue(index - 1, mx - 1, my, sx, sy);
+      }
+      if (my > 0) {
+        enqueue(index - size_x, mx, my - 1, sx, sy);
+      }
+      if (mx < size_x - 1) {
+        enqueue(index + 1, mx + 1, my, sx, sy);
+      }
+      if (my < size_y - 1) {
+        enqueue(index + size_x, mx, my + 1, sx, sy);
+      }
+    }
+  }
+
+  // a bin may have been added to after it was run, by a cell nearer the obstacle of another
+  for (auto & bin : inflation_cells_) {
+    bin.clear();
+  }
+}
+
+void
+InflationLayer::clearSeen()
+{
+  // only wrapping around to a generation already in seen_ needs a pass over the cells
+  if (++seen_generation_ == 0) {
+    std::fill(seen_.begin(), seen_.end(), 0);
+    seen_generation_ = 1;
+  }
+}
+
 void
 InflationLayer::updateCosts(
   nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j,
@@ -157,12 +320,15 @@ InflationLayer::updateCosts(
   int max_j)
 {
   if (!enabled_ || (cell_inflation_radius_ == 0)) {
+    incremental_valid_ = false;
     return;
   }
 
   // make sure the inflation list is empty at the beginning of the cycle (should always be true)
   RCLCPP_FATAL_EXPRESSION(rclcpp::get_logger("nav2_costmap_2d"),
-    !inflation_cells_.empty(), "The inflation list must be empty at the beginning of inflation");
+    std::any_of(inflation_cells_.begin(), inflation_cells_.end(),
+    [](const std::vector<CellData> & bin) {return !bin.empty();}),
+    "The inflation list must be empty at the beginning of inflation");
 
   unsigned char * master_array = master_grid.getCharMap();
   unsigned int size_x = master_grid.getSizeInCellsX(), size_y = master_grid.getSizeInCellsY();
@@ -170,10 +336,33 @@ InflationLayer::updateCosts(
   if (seen_.size() != size_x * size_y) {
     RCLCPP_WARN(rclcpp::get_logger(
         "nav2_costmap_2d"), "InflationLayer::updateCosts(): seen_ vector size is wrong");
-    seen_ = std::vector<bool>(size_x * size_y, false);
+    seen_.assign(size_x * size_y, 0);
   }
 
-  std::fill(begin(seen_), end(seen_), false);
+  if (cache_static_inflation_) {
+    std::shared_ptr<StaticLayer> static_layer = findStaticLayer();
+    if (static_layer) {
+      updateCostsStaticSplit(master_grid, *static_layer, min_i, min_j, max_i, max_j);
+      return;
+    }
+  }
+
+  if (distance_transform_) {
+    updateCostsDistanceTransform(master_grid, min_i, min_j, max_i, max_j);
+    return;
+  }
+
+  if (stamp_kernel_) {
+    updateCostsStamped(master_grid, min_i, min_j, max_i, max_j);
+    return;
+  }
+
+  if (incremental_) {
+    updateCostsIncremental(master_grid, min_i, min_j, max_i, max_j);
+    return;
+  }
+
+  clearSeen();
 
   // We need to include in the inflation cells outside the bounding
   // box min_i...max_j, by the amount cell_inflation_radius_.  Cells
@@ -195,7 +384,7 @@ InflationLayer::updateCosts(
   // with a notable performance boost
 
   // Start with lethal obstacles: by definition distance is 0.0
-  std::vector<CellData> & obs_bin = inflation_cells_[0.0];
+  std::vector<CellData> & obs_bin = inflation_cells_[0];
   for (int j = min_j; j < max_j; j++) {
     for (int i = min_i; i < max_i; i++) {
       int index = master_grid.getIndex(i, j);
@@ -206,31 +395,279 @@ InflationLayer::updateCosts(
     }
   }
 
-  // Process cells by increasing distance; new cells are appended to the
-  // corresponding distance bin, so they
-  // can overtake previously inserted but farther away cells
-  std::map<double, std::vector<CellData>>::iterator bin;
-  for (bin = inflation_cells_.begin(); bin != inflation_cells_.end(); ++bin) {
-    for (unsigned int i = 0; i < bin->second.size(); ++i) {
-      // process all cells at distance dist_bin.first
-      const CellData & cell = bin->second[i];
+  propagate(size_x, size_y, [&](unsigned int index, unsigned char cost) {
+      unsigned char old_cost = master_array[index];
+      if (old_cost == NO_INFORMATION &&
+        (inflate_unknown_ ? (cost > FREE_SPACE) : (cost >= INSCRIBED_INFLATED_OBSTACLE)))
+      {
+        master_array[index] = cost;
+      } else {
+        master_array[index] = std::max(old_cost, cost);
+      }
+    });
+}
 
-      unsigned int index = cell.index_;
+void
+InflationLayer::updateCostsDistanceTransform(
+  nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j,
+  int max_i,
+  int max_j)
+{
+  unsigned char * master_array = master_grid.getCharMap();
+  int size_x = master_grid.getSizeInCellsX(), size_y = master_grid.getSizeInCellsY();
+  int radius = cell_inflation_radius_;
+
+  // Like the wavefront, take obstacles from the window padded by the radius
+  // and write every cell they reach, which is up to one more radius out
+  int src_min_i = std::max(0, min_i - radius), src_max_i = std::min(size_x, max_i + radius);
+  int src_min_j = std::max(0, min_j - radius), src_max_j = std::min(size_y, max_j + radius);
+  int out_min_i = std::max(0, src_min_i - radius), out_max_i = std::min(size_x, src_max_i + radius);
+  int out_min_j = std::max(0, src_min_j - radius), out_max_j = std::min(size_y, src_max_j + radius);
+  int width = out_max_i - out_min_i, height = out_max_j - out_min_j;
+  if (width <= 0 || height <= 0) {
+    return;
+  }
 
-      // ignore if already visited
-      if (seen_[index]) {
+  // Distances past the radius are never looked up, so anything above it is
+  // "far"; keeping them small also keeps the squares in range
+  const int far = radius + 1;
+  const int far_sq = far * far;
+
+  // First pass: distance along each column to the nearest obstacle, swept a
+  // row at a time so that the inner loops run over contiguous memory
+  column_distances_.resize(width * height);
+  int * g = column_distances_.data();
+  for (int j = 0; j < height; j++) {
+    int * row = g + j * width;
+    const int * prev = j > 0 ? row - width : nullptr;
+    int mj = out_min_j + j;
+    for (int i = 0; i < width; i++) {
+      row[i] = prev ? std::min(prev[i] + 1, far) : far;
+    }
+    if (mj >= src_min_j && mj < src_max_j) {
+      const unsigned char * master_row = master_array + master_grid.getIndex(out_min_i, mj);
+      for (int i = src_min_i - out_min_i; i < src_max_i - out_min_i; i++) {
+        row[i] = master_row[i] == LETHAL_OBSTACLE ? 0 : row[i];
+      }
+    }
+  }
+  for (int j = height - 2; j >= 0; j--) {
+    int * row = g + j * width;
+    const int * next = row + width;
+    for (int i = 0; i < width; i++) {
+      row[i] = std::min(row[i], next[i] + 1);
+    }
+  }
+
+  // Second pass: exact squared distances along each row from the lower
+  // envelope of the parabolas (i - k)^2 + g(k)^2 (Felzenszwalb and
+  // Huttenlocher), then costs through the squared distance table
+  envelope_sites_.resize(width);
+  envelope_bounds_.resize(width + 1);
+  row_sq_distances_.resize(width);
+  int * v = envelope_sites_.data();
+  double * z = envelope_bounds_.data();
+  int * d = row_sq_distances_.data();
+  const unsigned char * sq_costs = sq_distance_costs_.data();
+  const int max_sq_distance = radius * radius;
+
+  for (int j = 0; j < height; j++) {
+    const int * row = g + j * width;
+    int k = -1;
+    for (int q = 0; q < width; q++) {
+      if (row[q] >= far) {
         continue;
       }
+      int fq = row[q] * row[q] + q * q;
+      double s = 0;
+      while (k >= 0) {
+        int p = v[k];
+        s = (fq - (row[p] * row[p] + p * p)) / (2.0 * (q - p));
+        if (s > z[k]) {
+          break;
+        }
+        k--;
+      }
+      if (k < 0) {
+        k = 0;
+        z[0] = -std::numeric_limits<double>::infinity();
+      } else {
+        k++;
+        z[k] = s;
+      }
+      v[k] = q;
+      z[k + 1] = std::numeric_limits<double>::infinity();
+    }
 
-      seen_[index] = true;
+    if (k < 0) {
+      continue;
+    }
+    for (int q = 0, e = 0; q < width; q++) {
+      while (z[e + 1] < q) {
+        e++;
+      }
+      int p = v[e];
+      d[q] = std::min((q - p) * (q - p) + row[p] * row[p], far_sq);
+    }
 
-      unsigned int mx = cell.x_;
-      unsigned int my = cell.y_;
-      unsigned int sx = cell.src_x_;
-      unsigned int sy = cell.src_y_;
+    unsigned char * master_row = master_array + master_grid.getIndex(out_min_i, out_min_j + j);
+    for (int i = 0; i < width; i++) {
+      if (d[i] > max_sq_distance) {
+        continue;
+      }
+      unsigned char cost = sq_costs[d[i]];
+      unsigned char old_cost = master_row[i];
+      if (old_cost == NO_INFORMATION &&
+        (inflate_unknown_ ? (cost > FREE_SPACE) : (cost >= INSCRIBED_INFLATED_OBSTACLE)))
+      {
+        master_row[i] = cost;
+      } else {
+        master_row[i] = std::max(old_cost, cost);
+      }
+    }
+  }
+}
 
-      // assign the cost associated with the distance from an obstacle to the cell
-      unsigned char cost = costLookup(mx, my, sx, sy);
+void
+InflationLayer::updateCostsStamped(
+  nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j,
+  int max_i,
+  int max_j)
+{
+  unsigned char * master_array = master_grid.getCharMap();
+  int size_x = master_grid.getSizeInCellsX(), size_y = master_grid.getSizeInCellsY();
+  int radius = cell_inflation_radius_;
+  unsigned char unknown_threshold = inflate_unknown_ ? FREE_SPACE + 1 : INSCRIBED_INFLATED_OBSTACLE;
+
+  // Like the wavefront, take obstacles from the window padded by the radius;
+  // the stamps reach one more radius out. Stamping every obstacle gives each
+  // cell the cost of its nearest one, as the costs fall off with distance.
+  int src_min_i = std::max(0, min_i - radius), src_max_i = std::min(size_x, max_i + radius);
+  int src_min_j = std::max(0, min_j - radius), src_max_j = std::min(size_y, max_j + radius);
+  for (int j = src_min_j; j < src_max_j; j++) {
+    const unsigned char * row = master_array + master_grid.getIndex(0, j);
+    for (int i = src_min_i; i < src_max_i; i++) {
+      if (row[i] == LETHAL_OBSTACLE) {
+        kernel_.stamp(master_array, size_x, size_y, i, j, unknown_threshold);
+      }
+    }
+  }
+}
+
+void
+InflationLayer::updateCostsIncremental(
+  nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j,
+  int max_i,
+  int max_j)
+{
+  unsigned char * master_array = master_grid.getCharMap();
+  int size_x = master_grid.getSizeInCellsX(), size_y = master_grid.getSizeInCellsY();
+  int radius = cell_inflation_radius_;
+
+  // A rolling window moves the master grid under us; follow it if the old
+  // and new windows still overlap
+  if (incremental_valid_ && lethal_.size() == static_cast<size_t>(size_x * size_y)) {
+    int dx = static_cast<int>(lround((master_grid.getOriginX() - last_origin_x_) / resolution_));
+    int dy = static_cast<int>(lround((master_grid.getOriginY() - last_origin_y_) / resolution_));
+    if (std::abs(dx) >= size_x || std::abs(dy) >= size_y) {
+      incremental_valid_ = false;
+    } else if (dx != 0 || dy != 0) {
+      shiftIncrementalState(size_x, size_y, dx, dy);
+    }
+  } else {
+    incremental_valid_ = false;
+  }
+  last_origin_x_ = master_grid.getOriginX();
+  last_origin_y_ = master_grid.getOriginY();
+
+  if (!incremental_valid_) {
+    rebuildIncrementalState(master_grid);
+  } else {
+    // Obstacles can only have changed inside the window, and new or removed
+    // ones there can change costs up to cell_inflation_radius_ outside of it
+    int block = block_size_;
+    int blocks_x = (size_x + block - 1) / block;
+    int blocks_y = (size_y + block - 1) / block;
+    std::fill(block_level_.begin(), block_level_.end(), 4);
+
+    std::vector<int> dirty_blocks;
+    int scan_min_i = std::max(0, min_i - radius);
+    int scan_min_j = std::max(0, min_j - radius);
+    int scan_max_i = std::min(size_x, max_i + radius);
+    int scan_max_j = std::min(size_y, max_j + radius);
+    for (int j = scan_min_j; j < scan_max_j; j++) {
+      int index = master_grid.getIndex(scan_min_i, j);
+      for (int i = scan_min_i; i < scan_max_i; i++, index++) {
+        unsigned char lethal = master_array[index] == LETHAL_OBSTACLE;
+        if (lethal != lethal_[index]) {
+          lethal_[index] = lethal;
+          int b = (j / block) * blocks_x + i / block;
+          if (block_level_[b] != 0) {
+            block_level_[b] = 0;
+            dirty_blocks.push_back(b);
+          }
+        }
+      }
+    }
+
+    if (dirty_blocks.size() * 4 > block_level_.size()) {
+      // Most of the map changed, e.g. the bounds jumped; start over
+      rebuildIncrementalState(master_grid);
+    } else if (!dirty_blocks.empty()) {
+      // Block size exceeds the inflation radius, so the costs that may change
+      // lie within one block of a dirty block (level 1), the obstacles that
+      // contribute to them within two (level 2), and the wavefront from those
+      // stays within three (level 3)
+      for (int b : dirty_blocks) {
+        int bx = b % blocks_x, by = b / blocks_x;
+        for (int ny = std::max(0, by - 3); ny <= std::min(blocks_y - 1, by + 3); ny++) {
+          for (int nx = std::max(0, bx - 3); nx <= std::min(blocks_x - 1, bx + 3); nx++) {
+            unsigned char level = std::max(std::abs(nx - bx), std::abs(ny - by));
+            unsigned char & current = block_level_[ny * blocks_x + nx];
+            current = std::min(current, level);
+          }
+        }
+      }
+
+      std::vector<CellData> & obs_bin = inflation_cells_[0];
+      for (int by = 0; by < blocks_y; by++) {
+        for (int bx = 0; bx < blocks_x; bx++) {
+          unsigned char level = block_level_[by * blocks_x + bx];
+          if (level > 3) {
+            continue;
+          }
+          int block_max_i = std::min(size_x, (bx + 1) * block);
+          int block_max_j = std::min(size_y, (by + 1) * block);
+          for (int j = by * block; j < block_max_j; j++) {
+            int index = master_grid.getIndex(bx * block, j);
+            for (int i = bx * block; i < block_max_i; i++, index++) {
+              if (level <= 1) {
+                inflated_[index] = FREE_SPACE;
+              }
+              if (level <= 2 && lethal_[index]) {
+                obs_bin.push_back(CellData(index, i, j, i, j));
+              }
+            }
+          }
+        }
+      }
+
+      // Costs outside level 1 are already right, so taking the maximum
+      // leaves them alone
+      propagate(size_x, size_y, [&](unsigned int index, unsigned char cost) {
+          inflated_[index] = std::max(inflated_[index], cost);
+        });
+    }
+  }
+
+  // Combine the inflated costs into the window exactly as a full update would
+  for (int j = min_j; j < max_j; j++) {
+    int index = master_grid.getIndex(min_i, j);
+    for (int i = min_i; i < max_i; i++, index++) {
+      unsigned char cost = inflated_[index];
+      if (cost == FREE_SPACE) {
+        continue;
+      }
       unsigned char old_cost = master_array[index];
       if (old_cost == NO_INFORMATION &&
         (inflate_unknown_ ? (cost > FREE_SPACE) : (cost >= INSCRIBED_INFLATED_OBSTACLE)))
@@ -239,24 +676,180 @@ InflationLayer::updateCosts(
       } else {
         master_array[index] = std::max(old_cost, cost);
       }
+    }
+  }
+}
 
-      // attempt to put the neighbors of the current cell onto the inflation list
-      if (mx > 0) {
-        enqueue(index - 1, mx - 1, my, sx, sy);
+void
+InflationLayer::rebuildIncrementalState(const nav2_costmap_2d::Costmap2D & master_grid)
+{
+  const unsigned char * master_array = master_grid.getCharMap();
+  unsigned int size_x = master_grid.getSizeInCellsX(), size_y = master_grid.getSizeInCellsY();
+
+  block_size_ = std::max(cell_inflation_radius_ + 1, 16u);
+  unsigned int blocks_x = (size_x + block_size_ - 1) / block_size_;
+  unsigned int blocks_y = (size_y + block_size_ - 1) / block_size_;
+  block_level_.assign(blocks_x * blocks_y, 4);
+  lethal_.assign(size_x * size_y, 0);
+  inflated_.assign(size_x * size_y, FREE_SPACE);
+  clearSeen();
+
+  std::vector<CellData> & obs_bin = inflation_cells_[0];
+  for (unsigned int j = 0; j < size_y; j++) {
+    for (unsigned int i = 0; i < size_x; i++) {
+      unsigned int index = master_grid.getIndex(i, j);
+      if (master_array[index] == LETHAL_OBSTACLE) {
+        lethal_[index] = 1;
+        obs_bin.push_back(CellData(index, i, j, i, j));
       }
-      if (my > 0) {
-        enqueue(index - size_x, mx, my - 1, sx, sy);
+    }
+  }
+
+  propagate(size_x, size_y, [&](unsigned int index, unsigned char cost) {
+      inflated_[index] = cost;
+    });
+  incremental_valid_ = true;
+}
+
+void
+InflationLayer::shiftIncrementalState(
+  unsigned int size_x, unsigned int size_y, int dx, int dy)
+{
+  // Cell (i, j) of the new window was cell (i + dx, j + dy) of the old one;
+  // cells that scrolled in start out without obstacles
+  std::vector<unsigned char> old_lethal(size_x * size_y, 0);
+  std::vector<unsigned char> old_inflated(size_x * size_y, FREE_SPACE);
+  old_lethal.swap(lethal_);
+  old_inflated.swap(inflated_);
+
+  int min_i = std::max(0, -dx), max_i = std::min<int>(size_x, size_x - dx);
+  int min_j = std::max(0, -dy), max_j = std::min<int>(size_y, size_y - dy);
+  for (int j = min_j; j < max_j; j++) {
+    unsigned int from = (j + dy) * size_x + min_i + dx;
+    unsigned int to = j * size_x + min_i;
+    std::copy(old_lethal.begin() + from, old_lethal.begin() + from + (max_i - min_i),
+      lethal_.begin() + to);
+    std::copy(old_inflated.begin() + from, old_inflated.begin() + from + (max_i - min_i),
+      inflated_.begin() + to);
+  }
+}
+
+std::shared_ptr<StaticLayer>
+InflationLayer::findStaticLayer() const
+{
+  // a rolling window moves the master grid over the static map, so the cells differ
+  if (layered_costmap_->isRolling()) {
+    return nullptr;
+  }
+  const Costmap2D * master = layered_costmap_->getCostmap();
+  for (auto & plugin : *layered_costmap_->getPlugins()) {
+    auto static_layer = std::dynamic_pointer_cast<StaticLayer>(plugin);
+    if (static_layer && static_layer->getMapVersion() != 0 &&
+      static_layer->getSizeInCellsX() == master->getSizeInCellsX() &&
+      static_layer->getSizeInCellsY() == master->getSizeInCellsY())
+    {
+      return static_layer;
+    }
+  }
+  return nullptr;
+}
+
+void
+InflationLayer::updateCostsStaticSplit(
+  nav2_costmap_2d::Costmap2D & master_grid, StaticLayer & static_layer,
+  int min_i, int min_j, int max_i, int max_j)
+{
+  unsigned char * master_array = master_grid.getCharMap();
+  int size_x = master_grid.getSizeInCellsX(), size_y = master_grid.getSizeInCellsY();
+  int radius = cell_inflation_radius_;
+
+  std::lock_guard<Costmap2D::mutex_t> guard(*static_layer.getMutex());
+  unsigned int version = static_layer.getMapVersion();
+  if (!static_inflation_valid_ || version != static_version_ ||
+    static_inflated_.size() != static_cast<size_t>(size_x * size_y))
+  {
+    rebuildStaticInflation(static_layer, size_x, size_y);
+    static_version_ = version;
+  }
+
+  auto combine = [&](unsigned int index, unsigned char cost) {
+      unsigned char old_cost = master_array[index];
+      if (old_cost == NO_INFORMATION &&
+        (inflate_unknown_ ? (cost > FREE_SPACE) : (cost >= INSCRIBED_INFLATED_OBSTACLE)))
+      {
+        master_array[index] = cost;
+      } else {
+        master_array[index] = std::max(old_cost, cost);
       }
-      if (mx < size_x - 1) {
-        enqueue(index + 1, mx + 1, my, sx, sy);
+    };
+
+  // Each cell gets the cost of its nearest obstacle, the higher of the nearest static one's,
+  // from the cache, and the nearest other one's, from the wavefront below
+  for (int j = min_j; j < max_j; j++) {
+    int index = master_grid.getIndex(min_i, j);
+    for (int i = min_i; i < max_i; i++, index++) {
+      if (static_inflated_[index] != FREE_SPACE) {
+        combine(index, static_inflated_[index]);
       }
-      if (my < size_y - 1) {
-        enqueue(index + size_x, mx, my + 1, sx, sy);
+    }
+  }
+
+  // Like the full update, take the other obstacles from the window padded by the radius
+  int src_min_i = std::max(0, min_i - radius), src_max_i = std::min(size_x, max_i + radius);
+  int src_min_j = std::max(0, min_j - radius), src_max_j = std::min(size_y, max_j + radius);
+  clearSeen();
+
+  std::vector<CellData> & obs_bin = inflation_cells_[0];
+  for (int j = src_min_j; j < src_max_j; j++) {
+    int index = master_grid.getIndex(src_min_i, j);
+    for (int i = src_min_i; i < src_max_i; i++, index++) {
+      if (master_array[index] == LETHAL_OBSTACLE &&
+        static_layer.getStaticCost(i, j) != LETHAL_OBSTACLE)
+      {
+        obs_bin.push_back(CellData(index, i, j, i, j));
+      }
+    }
+  }
+  propagate(size_x, size_y, combine);
+}
+
+void
+InflationLayer::rebuildStaticInflation(
+  const StaticLayer & static_layer, unsigned int size_x, unsigned int size_y)
+{
+  static_inflated_.assign(size_x * size_y, FREE_SPACE);
+
+  // the static layer's field of the map, if it shares one, has the exact distances already
+  std::shared_ptr<const nav2_util::DistanceField> field = static_layer.getDistanceField();
+  if (field && field->width == size_x && field->height == size_y) {
+    const uint32_t max_sq_distance = cell_inflation_radius_ * cell_inflation_radius_;
+    for (size_t index = 0; index < static_inflated_.size(); ++index) {
+      uint32_t sq_distance = field->sq_distances[index];
+      if (sq_distance == 0) {
+        static_inflated_[index] = LETHAL_OBSTACLE;
+      } else if (sq_distance <= max_sq_distance) {
+        static_inflated_[index] = sq_distance_costs_[sq_distance];
+      }
+    }
+    static_inflation_valid_ = true;
+    return;
+  }
+
+  clearSeen();
+
+  std::vector<CellData> & obs_bin = inflation_cells_[0];
+  for (unsigned int j = 0; j < size_y; j++) {
+    for (unsigned int i = 0; i < size_x; i++) {
+      if (static_layer.getStaticCost(i, j) == LETHAL_OBSTACLE) {
+        obs_bin.push_back(CellData(j * size_x + i, i, j, i, j));
       }
     }
   }
 
-  inflation_cells_.clear();
+  propagate(size_x, size_y, [&](unsigned int index, unsigned char cost) {
+      static_inflated_[index] = cost;
+    });
+  static_inflation_valid_ = true;
 }
 
 /**
@@ -273,19 +866,20 @@ InflationLayer::enqueue(
   unsigned int index, unsigned int mx, unsigned int my,
   unsigned int src_x, unsigned int src_y)
 {
-  if (!seen_[index]) {
-    // we compute our distance table one cell further than the
+  if (!isSeen(index)) {
+    // we compute our rank table one cell further than the
     // inflation radius dictates so we can make the check below
-    double distance = distanceLookup(mx, my, src_x, src_y);
+    unsigned int rank = kernel_.rank(abs(static_cast<int>(mx) - static_cast<int>(src_x)),
+        abs(static_cast<int>(my) - static_cast<int>(src_y)));
 
     // we only want to put the cell in the list if it is within
     // the inflation radius of the obstacle point
-    if (distance > cell_inflation_radius_) {
+    if (rank >= inflation_cells_.size()) {
       return;
     }
 
     // push the cell data onto the inflation list and mark
-    inflation_cells_[distance].push_back(CellData(index, mx, my, src_x, src_y));
+    inflation_cells_[rank].push_back(CellData(index, mx, my, src_x, src_y));
   }
 }
 
@@ -297,53 +891,15 @@ InflationLayer::computeCaches()
   }
 
   // based on the inflation radius... compute distance and cost caches
-  if (cell_inflation_radius_ != cached_cell_inflation_radius_) {
-    deleteKernels();
-
-    cached_costs_ = new unsigned char *[cell_inflation_radius_ + 2];
-    cached_distances_ = new double *[cell_inflation_radius_ + 2];
-
-    for (unsigned int i = 0; i <= cell_inflation_radius_ + 1; ++i) {
-      cached_costs_[i] = new unsigned char[cell_inflation_radius_ + 2];
-      cached_distances_[i] = new double[cell_inflation_radius_ + 2];
-      for (unsigned int j = 0; j <= cell_inflation_radius_ + 1; ++j) {
-        cached_distances_[i][j] = hypot(i, j);
-      }
-    }
-
-    cached_cell_inflation_radius_ = cell_inflation_radius_;
-  }
-
-  for (unsigned int i = 0; i <= cell_inflation_radius_ + 1; ++i) {
-    for (unsigned int j = 0; j <= cell_inflation_radius_ + 1; ++j) {
-      cached_costs_[i][j] = computeCost(cached_distances_[i][j]);
-    }
-  }
-}
-
-void
-InflationLayer::deleteKernels()
-{
-  if (cached_distances_ != NULL) {
-    for (unsigned int i = 0; i <= cached_cell_inflation_radius_ + 1; ++i) {
-      if (cached_distances_[i]) {
-        delete[] cached_distances_[i];
-      }
-    }
-    if (cached_distances_) {
-      delete[] cached_distances_;
-    }
-    cached_distances_ = NULL;
-  }
-
-  if (cached_costs_ != NULL) {
-    for (unsigned int i = 0; i <= cached_cell_inflation_radius_ + 1; ++i) {
-      if (cached_costs_[i]) {
-        delete[] cached_costs_[i];
-      }
-    }
-    delete[] cached_costs_;
-    cached_costs_ = NULL;
+  kernel_.build(cell_inflation_radius_, [this](double distance) {return computeCost(distance);});
+  inflation_cells_.resize(kernel_.rankCount());
+
+  // The distance transform yields squared distances; any cell within the
+  // inflation radius has one of these
+  unsigned int max_sq_distance = cell_inflation_radius_ * cell_inflation_radius_;
+  sq_distance_costs_.resize(max_sq_distance + 1);
+  for (unsigned int d = 0; d <= max_sq_distance; ++d) {
+    sq_distance_costs_[d] = computeCost(sqrt(d));
   }
 }
 
@@ -39,10 +39,14 @@
 #include "nav2_costmap_2d/obstacle_layer.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "nav2_util/metrics.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "sensor_msgs/point_cloud2_iterator.hpp"
 #include "nav2_costmap_2d/costmap_math.hpp"
@@ -61,8 +65,9 @@ namespace nav2_costmap_2d
 
 ObstacleLayer::~ObstacleLayer()
 {
-  for (auto & notifier : observation_notifiers_) {
-    notifier.reset();
+  shared_consumers_.clear();
+  for (auto & channel : observation_channels_) {
+    transform_scheduler_->removeChannel(channel);
   }
 }
 
@@ -80,11 +85,23 @@ void ObstacleLayer::onInitialize()
     rclcpp::ParameterValue(true));
   node_->declare_parameter(name_ + "." + "max_obstacle_height", rclcpp::ParameterValue(2.0));
   node_->declare_parameter(name_ + "." + "combination_method", rclcpp::ParameterValue(1));
+  node_->declare_parameter(name_ + "." + "clearing_threads", rclcpp::ParameterValue(1));
+  node_->declare_parameter(name_ + "." + "decay_time", rclcpp::ParameterValue(0.0));
+  node_->declare_parameter(name_ + "." + "decay_passes", rclcpp::ParameterValue(4));
+  node_->declare_parameter(name_ + "." + "footprint_clearing_yaw_bins", rclcpp::ParameterValue(0));
 
   node_->get_parameter(name_ + "." + "enabled", enabled_);
   node_->get_parameter(name_ + "." + "footprint_clearing_enabled", footprint_clearing_enabled_);
   node_->get_parameter(name_ + "." + "max_obstacle_height", max_obstacle_height_);
   node_->get_parameter(name_ + "." + "combination_method", combination_method_);
+  int clearing_threads = 1;
+  node_->get_parameter(name_ + "." + "clearing_threads", clearing_threads);
+  double decay_time = 0.0;
+  node_->get_parameter(name_ + "." + "decay_time", decay_time);
+  int decay_passes = 4;
+  node_->get_parameter(name_ + "." + "decay_passes", decay_passes);
+  int footprint_clearing_yaw_bins = 0;
+  node_->get_parameter(name_ + "." + "footprint_clearing_yaw_bins", footprint_clearing_yaw_bins);
   node_->get_parameter("track_unknown_space", track_unknown_space);
   node_->get_parameter("transform_tolerance", transform_tolerance);
   node_->get_parameter("observation_sources", topics_string);
@@ -99,9 +116,17 @@ void ObstacleLayer::onInitialize()
     default_value_ = FREE_SPACE;
   }
 
+  footprint_masks_ = FootprintMasks(std::max(footprint_clearing_yaw_bins, 0));
   ObstacleLayer::matchSize();
+  setDecayTime(decay_time, decay_passes);
   current_ = true;
 
+  if (clearing_threads > 1) {
+    clearing_pool_ = std::make_unique<WorkerPool>(clearing_threads);
+  } else {
+    clearing_pool_.reset();
+  }
+
   global_frame_ = layered_costmap_->getGlobalFrameID();
 
   // now we need to split the topics based on whitespace which we can use a stringstream for
@@ -112,7 +137,7 @@ void ObstacleLayer::onInitialize()
     // get the parameters for the specific topic
     double observation_keep_time, expected_update_rate, min_obstacle_height, max_obstacle_height;
     std::string topic, sensor_frame, data_type;
-    bool inf_is_valid, clearing, marking;
+    bool inf_is_valid, direct_scan_projection, clearing, marking;
 
     node_->declare_parameter(source + "." + "topic", rclcpp::ParameterValue(source));
     node_->declare_parameter(source + "." + "sensor_frame",
@@ -124,10 +149,20 @@ void ObstacleLayer::onInitialize()
     node_->declare_parameter(source + "." + "min_obstacle_height", rclcpp::ParameterValue(0.0));
     node_->declare_parameter(source + "." + "max_obstacle_height", rclcpp::ParameterValue(0.0));
     node_->declare_parameter(source + "." + "inf_is_valid", rclcpp::ParameterValue(false));
+    node_->declare_parameter(source + "." + "direct_scan_projection",
+      rclcpp::ParameterValue(false));
     node_->declare_parameter(source + "." + "marking", rclcpp::ParameterValue(true));
     node_->declare_parameter(source + "." + "clearing", rclcpp::ParameterValue(false));
     node_->declare_parameter(source + "." + "obstacle_range", rclcpp::ParameterValue(2.5));
     node_->declare_parameter(source + "." + "raytrace_range", rclcpp::ParameterValue(3.0));
+    node_->declare_parameter(source + "." + "deduplicate", rclcpp::ParameterValue(false));
+    node_->declare_parameter(source + "." + "deduplicate_height_band", rclcpp::ParameterValue(0.0));
+    node_->declare_parameter(source + "." + "ring_capacity", rclcpp::ParameterValue(0));
+    node_->declare_parameter(source + "." + "latest_only", rclcpp::ParameterValue(false));
+    node_->declare_parameter(source + "." + "polygon_clearing", rclcpp::ParameterValue(false));
+    node_->declare_parameter(source + "." + "polygon_clearing_max_gap",
+      rclcpp::ParameterValue(0.05));
+    node_->declare_parameter(source + "." + "shared", rclcpp::ParameterValue(false));
 
     node_->get_parameter(source + "." + "topic", topic);
     node_->get_parameter(source + "." + "sensor_frame", sensor_frame);
@@ -137,9 +172,25 @@ void ObstacleLayer::onInitialize()
     node_->get_parameter(source + "." + "min_obstacle_height", min_obstacle_height);
     node_->get_parameter(source + "." + "max_obstacle_height", max_obstacle_height);
     node_->get_parameter(source + "." + "inf_is_valid", inf_is_valid);
+    node_->get_parameter(source + "." + "direct_scan_projection", direct_scan_projection);
     node_->get_parameter(source + "." + "marking", marking);
     node_->get_parameter(source + "." + "clearing", clearing);
 
+    bool deduplicate;
+    double deduplicate_height_band;
+    node_->get_parameter(source + "." + "deduplicate", deduplicate);
+    node_->get_parameter(source + "." + "deduplicate_height_band", deduplicate_height_band);
+    int ring_capacity;
+    node_->get_parameter(source + "." + "ring_capacity", ring_capacity);
+    bool latest_only;
+    node_->get_parameter(source + "." + "latest_only", latest_only);
+    bool polygon_clearing;
+    double polygon_clearing_max_gap;
+    node_->get_parameter(source + "." + "polygon_clearing", polygon_clearing);
+    node_->get_parameter(source + "." + "polygon_clearing_max_gap", polygon_clearing_max_gap);
+    bool shared;
+    node_->get_parameter(source + "." + "shared", shared);
+
     if (!(data_type == "PointCloud2" || data_type == "LaserScan")) {
       RCLCPP_FATAL(node_->get_logger(),
         "Only topics that use point cloud2s or laser scans are currently supported");
@@ -168,6 +219,27 @@ void ObstacleLayer::onInitialize()
       max_obstacle_height, obstacle_range, raytrace_range, *tf_, global_frame_,
       sensor_frame, transform_tolerance)));
 
+    // thin dense clouds down to one point per costmap cell (and height band)
+    if (deduplicate) {
+      observation_buffers_.back()->enableDeduplication(deduplicate_height_band);
+      observation_buffers_.back()->setDeduplicationGrid(resolution_, origin_x_, origin_y_);
+    }
+
+    // keep the last observations in a ring that updates read without locking out the sensor
+    if (ring_capacity > 0) {
+      observation_buffers_.back()->enableRing(ring_capacity);
+    }
+
+    // clear the area between the beams of a planar scan at once, rather than beam by beam
+    if (polygon_clearing) {
+      if (data_type == "LaserScan") {
+        observation_buffers_.back()->enablePolygonClearing(polygon_clearing_max_gap);
+      } else {
+        RCLCPP_WARN(node_->get_logger(),
+          "obstacle_layer: polygon_clearing option is not applicable to PointCloud observations.");
+      }
+    }
+
     // check if we'll add this buffer to our marking observation buffers
     if (marking) {
       marking_buffers_.push_back(observation_buffers_.back());
@@ -184,62 +256,94 @@ void ObstacleLayer::onInitialize()
       source.c_str(), topic.c_str(),
       global_frame_.c_str(), expected_update_rate, observation_keep_time);
 
+    // A shared source is received and transformed once for all the layers of the process
+    // that read the topic alike, such as those of the local and global costmap, and its
+    // observations handed to this layer's buffer
+    if (shared) {
+      ObservationHub::SourceKey key{topic, data_type, sensor_frame,
+        data_type == "LaserScan" && inf_is_valid, direct_scan_projection, latest_only};
+      ObservationHub::Host host{node_, rclcpp_node_, tf_, global_frame_, transform_tolerance};
+      LayeredCostmap * layered_costmap = layered_costmap_;
+      shared_consumers_.push_back(ObservationHub::global().subscribe(key, host,
+        observation_buffers_.back(), [layered_costmap]() {layered_costmap->requestUpdate();}));
+      continue;
+    }
+
+    // With latest_only, the subscription and the transform scheduler each keep just the
+    // newest message, so that a backlog built up while the node was stalled is dropped instead
+    // of being buffered one message at a time
     rmw_qos_profile_t custom_qos_profile = rmw_qos_profile_sensor_data;
-    custom_qos_profile.depth = 50;
+    custom_qos_profile.depth = latest_only ? 1 : 50;
+    size_t channel_queue_size = latest_only ? 1 : 50;
 
-    // create a callback for the topic
-    if (data_type == "LaserScan") {
-      std::shared_ptr<message_filters::Subscriber<sensor_msgs::msg::LaserScan>> sub(
-        new message_filters::Subscriber<sensor_msgs::msg::LaserScan>(
-          rclcpp_node_, topic, custom_qos_profile));
+    // The messages the scheduler drops, for its queue being full or their transform not
+    // arriving
+    nav2_util::Counter * dropped = &nav2_util::MetricsRegistry::global().counter(
+      std::string(node_->get_name()) + "." + name_ + "." + source + ".dropped",
+      "Observations dropped before they reached the obstacle layer");
 
-      std::shared_ptr<tf2_ros::MessageFilter<sensor_msgs::msg::LaserScan>> filter(
-        new tf2_ros::MessageFilter<sensor_msgs::msg::LaserScan>(
-          *sub, *tf_, global_frame_, 50, rclcpp_node_));
+    std::vector<std::string> target_frames;
+    target_frames.push_back(global_frame_);
+    if (sensor_frame != "") {
+      target_frames.push_back(sensor_frame);
+    }
 
-      if (inf_is_valid) {
-        filter->registerCallback(std::bind(
-            &ObstacleLayer::laserScanValidInfCallback, this, std::placeholders::_1,
-            observation_buffers_.back()));
+    if (!transform_scheduler_) {
+      transform_scheduler_ = nav2_util::TransformScheduler::forBuffer(*tf_);
+    }
+    auto scheduler = transform_scheduler_;
+    auto buffer = observation_buffers_.back();
 
+    // create a callback for the topic
+    if (data_type == "LaserScan") {
+      auto sub = std::make_shared<message_filters::Subscriber<sensor_msgs::msg::LaserScan>>(
+        rclcpp_node_, topic, custom_qos_profile);
+
+      auto channel = scheduler->addChannel(target_frames, channel_queue_size,
+          tf2::durationFromSec(0.05), [dropped]() {dropped->increment();});
+
+      std::function<void(sensor_msgs::msg::LaserScan::ConstSharedPtr)> callback;
+      if (direct_scan_projection) {
+        callback = std::bind(
+          &ObstacleLayer::laserScanDirectCallback, this, std::placeholders::_1,
+          buffer, inf_is_valid);
+      } else if (inf_is_valid) {
+        callback = std::bind(
+          &ObstacleLayer::laserScanValidInfCallback, this, std::placeholders::_1, buffer);
       } else {
-        filter->registerCallback(std::bind(
-            &ObstacleLayer::laserScanCallback, this, std::placeholders::_1,
-            observation_buffers_.back()));
+        callback = std::bind(
+          &ObstacleLayer::laserScanCallback, this, std::placeholders::_1, buffer);
       }
+      sub->registerCallback(
+        [scheduler, channel, callback](const sensor_msgs::msg::LaserScan::ConstSharedPtr & msg) {
+          scheduler->schedule(channel, msg, callback);
+        });
 
       observation_subscribers_.push_back(sub);
-
-      observation_notifiers_.push_back(filter);
-      observation_notifiers_.back()->setTolerance(rclcpp::Duration::from_seconds(0.05));
+      observation_channels_.push_back(channel);
 
     } else {
-      std::shared_ptr<message_filters::Subscriber<sensor_msgs::msg::PointCloud2>> sub(
-        new message_filters::Subscriber<sensor_msgs::msg::PointCloud2>(
-          rclcpp_node_, topic, custom_qos_profile));
+      auto sub = std::make_shared<message_filters::Subscriber<sensor_msgs::msg::PointCloud2>>(
+        rclcpp_node_, topic, custom_qos_profile);
 
       if (inf_is_valid) {
         RCLCPP_WARN(node_->get_logger(),
           "obstacle_layer: inf_is_valid option is not applicable to PointCloud observations.");
       }
 
-      std::shared_ptr<tf2_ros::MessageFilter<sensor_msgs::msg::PointCloud2>> filter(
-        new tf2_ros::MessageFilter<sensor_msgs::msg::PointCloud2>(
-          *sub, *tf_, global_frame_, 50, rclcpp_node_));
+      auto channel = scheduler->addChannel(target_frames, channel_queue_size,
+          tf2::Duration(0), [dropped]() {dropped->increment();});
 
-      filter->registerCallback(std::bind(
-          &ObstacleLayer::pointCloud2Callback, this, std::placeholders::_1,
-          observation_buffers_.back()));
+      std::function<void(sensor_msgs::msg::PointCloud2::ConstSharedPtr)> callback = std::bind(
+        &ObstacleLayer::pointCloud2Callback, this, std::placeholders::_1, buffer);
+      sub->registerCallback(
+        [scheduler, channel, callback](
+          const sensor_msgs::msg::PointCloud2::ConstSharedPtr & msg) {
+          scheduler->schedule(channel, msg, callback);
+        });
 
       observation_subscribers_.push_back(sub);
-      observation_notifiers_.push_back(filter);
-    }
-
-    if (sensor_frame != "") {
-      std::vector<std::string> target_frames;
-      target_frames.push_back(global_frame_);
-      target_frames.push_back(sensor_frame);
-      observation_notifiers_.back()->setTargetFrames(target_frames);
+      observation_channels_.push_back(channel);
     }
   }
 }
@@ -268,6 +372,7 @@ ObstacleLayer::laserScanCallback(
   buffer->lock();
   buffer->bufferCloud(cloud);
   buffer->unlock();
+  layered_costmap_->requestUpdate();
 }
 
 void
@@ -303,6 +408,19 @@ ObstacleLayer::laserScanValidInfCallback(
   buffer->lock();
   buffer->bufferCloud(cloud);
   buffer->unlock();
+  layered_costmap_->requestUpdate();
+}
+
+void
+ObstacleLayer::laserScanDirectCallback(
+  sensor_msgs::msg::LaserScan::ConstSharedPtr message,
+  const std::shared_ptr<nav2_costmap_2d::ObservationBuffer> & buffer, bool inf_is_valid)
+{
+  // project and buffer the scan in one go
+  buffer->lock();
+  buffer->bufferScan(*message, inf_is_valid);
+  buffer->unlock();
+  layered_costmap_->requestUpdate();
 }
 
 void
@@ -314,6 +432,63 @@ ObstacleLayer::pointCloud2Callback(
   buffer->lock();
   buffer->bufferCloud(*message);
   buffer->unlock();
+  layered_costmap_->requestUpdate();
+}
+
+size_t
+ObstacleLayer::getMemoryUsage() const
+{
+  size_t bytes = CostmapLayer::getMemoryUsage() + mark_stamps_.capacity() * sizeof(uint16_t) +
+    (mark_x_.capacity() + mark_y_.capacity()) * sizeof(double) +
+    (mark_mx_.capacity() + mark_my_.capacity()) * sizeof(unsigned int) + mark_valid_.capacity();
+  for (const auto & buffer : observation_buffers_) {
+    bytes += buffer->getMemoryUsage();
+  }
+  return bytes;
+}
+
+double
+ObstacleLayer::getMemoryPerCell() const
+{
+  return CostmapLayer::getMemoryPerCell() + (decay_ticks_ ? sizeof(uint16_t) : 0);
+}
+
+void
+ObstacleLayer::matchSize()
+{
+  // the stamps are kept with the costs, when those are
+  Costmap2D * master = layered_costmap_->getCostmap();
+  double old_resolution = resolution_;
+  unsigned int old_size_x = size_x_;
+  unsigned int old_size_y = size_y_;
+  int offset_x = 0, offset_y = 0;
+  std::vector<uint16_t> old_stamps;
+  if (decay_ticks_ && alignedOffset(master->getResolution(), master->getOriginX(),
+    master->getOriginY(), offset_x, offset_y))
+  {
+    old_stamps.swap(mark_stamps_);
+  }
+
+  CostmapLayer::matchSize();
+  if (footprint_masks_.yawBins() > 0 && resolution_ != old_resolution) {
+    footprint_masks_.setFootprint(getFootprint(), resolution_);
+  }
+  if (decay_ticks_) {
+    mark_stamps_.assign(static_cast<size_t>(size_x_) * size_y_, 0);
+    if (old_stamps.size() == static_cast<size_t>(old_size_x) * old_size_y) {
+      copyOverlap(old_stamps.data(), old_size_x, old_size_y, mark_stamps_.data(), size_x_,
+        size_y_, offset_x, offset_y);
+    }
+    decay_row_ = 0;
+  }
+
+  // Keep deduplication aligned with the cells; a rolling window moves by
+  // whole cells, so only a resize can change it
+  for (auto & buffer : observation_buffers_) {
+    buffer->lock();
+    buffer->setDeduplicationGrid(resolution_, origin_x_, origin_y_);
+    buffer->unlock();
+  }
 }
 
 void
@@ -341,6 +516,13 @@ ObstacleLayer::updateBounds(
   // update the global current status
   current_ = current;
 
+  // let marks older than the decay time go
+  uint16_t now_tick = 0;
+  if (decay_ticks_) {
+    now_tick = static_cast<uint16_t>(node_->now().nanoseconds() / decay_tick_ns_);
+    decayMarks(now_tick, min_x, min_y, max_x, max_y);
+  }
+
   // raytrace freespace
   for (unsigned int i = 0; i < clearing_observations.size(); ++i) {
     raytraceFreespace(clearing_observations[i], min_x, min_y, max_x, max_y);
@@ -360,6 +542,8 @@ ObstacleLayer::updateBounds(
     sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud, "y");
     sensor_msgs::PointCloud2ConstIterator<float> iter_z(cloud, "z");
 
+    mark_x_.clear();
+    mark_y_.clear();
     for (; iter_x != iter_x.end(); ++iter_x, ++iter_y, ++iter_z) {
       double px = *iter_x, py = *iter_y, pz = *iter_z;
 
@@ -381,19 +565,126 @@ ObstacleLayer::updateBounds(
         continue;
       }
 
-      // now we need to compute the map coordinates for the observation
-      unsigned int mx, my;
-      if (!worldToMap(px, py, mx, my)) {
-        RCLCPP_DEBUG(node_->get_logger(), "Computing map coords failed");
+      mark_x_.push_back(px);
+      mark_y_.push_back(py);
+    }
+
+    // now we need to compute the map coordinates for the observation, all at once
+    const size_t points = mark_x_.size();
+    mark_mx_.resize(points);
+    mark_my_.resize(points);
+    mark_valid_.resize(points);
+    if (worldToMapBatch(mark_x_.data(), mark_y_.data(), points, mark_mx_.data(),
+      mark_my_.data(), mark_valid_.data()) < points)
+    {
+      RCLCPP_DEBUG(node_->get_logger(), "Computing map coords failed");
+    }
+
+    for (size_t i = 0; i < points; ++i) {
+      if (!mark_valid_[i]) {
         continue;
       }
-
-      unsigned int index = getIndex(mx, my);
+      unsigned int index = getIndex(mark_mx_[i], mark_my_[i]);
       costmap_[index] = LETHAL_OBSTACLE;
-      touch(px, py, min_x, min_y, max_x, max_y);
+      if (decay_ticks_) {
+        mark_stamps_[index] = now_tick;
+      }
+      touch(mark_x_[i], mark_y_[i], min_x, min_y, max_x, max_y);
+    }
+  }
+
+  updateFootprint(robot_x, robot_y, robot_yaw, min_x, min_y, max_x, max_y);
+}
+
+void
+ObstacleLayer::setDecayTime(double decay_time, int passes)
+{
+  // the stamps are 16 bits, in ticks fine enough for the decay but that wrap
+  // around no sooner than twice the decay, so that their ages stay unambiguous
+  if (decay_time > 0.0) {
+    decay_tick_ns_ = std::max<int64_t>(10000000, static_cast<int64_t>(decay_time * 1e9 / 30000));
+    decay_ticks_ = std::max<int64_t>(1, static_cast<int64_t>(decay_time * 1e9 / decay_tick_ns_));
+    decay_passes_ = std::max(1, passes);
+    mark_stamps_.assign(static_cast<size_t>(size_x_) * size_y_, 0);
+    decay_row_ = 0;
+  } else {
+    decay_ticks_ = 0;
+    mark_stamps_.clear();
+  }
+}
+
+void
+ObstacleLayer::decayMarks(
+  uint16_t now_tick, double * min_x, double * min_y, double * max_x, double * max_y)
+{
+  // one stripe of rows per cycle, so that each cell is looked at every decay_passes_ cycles
+  unsigned int stripe = (size_y_ + decay_passes_ - 1) / decay_passes_;
+  if (decay_row_ >= size_y_) {
+    decay_row_ = 0;
+  }
+  unsigned int first_row = decay_row_;
+  unsigned int last_row = std::min(size_y_, first_row + stripe);
+  decay_row_ = last_row;
+
+  unsigned int cleared_min_x = size_x_, cleared_max_x = 0;
+  unsigned int cleared_min_y = size_y_, cleared_max_y = 0;
+  for (unsigned int my = first_row; my < last_row; ++my) {
+    unsigned char * costs = costmap_ + static_cast<size_t>(my) * size_x_;
+    const uint16_t * stamps = mark_stamps_.data() + static_cast<size_t>(my) * size_x_;
+    unsigned int row_min_x = size_x_, row_max_x = 0;
+    for (unsigned int mx = 0; mx < size_x_; ++mx) {
+      // the subtraction wraps along with the stamps
+      if (costs[mx] == LETHAL_OBSTACLE && static_cast<uint16_t>(now_tick - stamps[mx]) >=
+        decay_ticks_)
+      {
+        costs[mx] = FREE_SPACE;
+        row_min_x = std::min(row_min_x, mx);
+        row_max_x = mx;
+      }
+    }
+    if (row_min_x <= row_max_x) {
+      cleared_min_x = std::min(cleared_min_x, row_min_x);
+      cleared_max_x = std::max(cleared_max_x, row_max_x);
+      cleared_min_y = std::min(cleared_min_y, my);
+      cleared_max_y = my;
     }
   }
 
+  if (cleared_min_x <= cleared_max_x) {
+    double wx, wy;
+    mapToWorld(cleared_min_x, cleared_min_y, wx, wy);
+    touch(wx, wy, min_x, min_y, max_x, max_y);
+    mapToWorld(cleared_max_x, cleared_max_y, wx, wy);
+    touch(wx, wy, min_x, min_y, max_x, max_y);
+  }
+}
+
+void
+ObstacleLayer::updateOrigin(double new_origin_x, double new_origin_y)
+{
+  if (decay_ticks_) {
+    // shift the stamps along with the costs they belong to
+    int cell_ox = static_cast<int>((new_origin_x - origin_x_) / resolution_);
+    int cell_oy = static_cast<int>((new_origin_y - origin_y_) / resolution_);
+    shiftMapRegion(mark_stamps_.data(), size_x_, size_y_, cell_ox, cell_oy,
+      static_cast<uint16_t>(0));
+  }
+  CostmapLayer::updateOrigin(new_origin_x, new_origin_y);
+}
+
+void
+ObstacleLayer::deferBounds(
+  double robot_x, double robot_y, double robot_yaw, double * min_x,
+  double * min_y, double * max_x, double * max_y)
+{
+  // the observations wait for the next full update, but the window has to
+  // keep up with the robot and the footprint has to stay clear
+  if (rolling_window_) {
+    updateOrigin(robot_x - getSizeInMetersX() / 2, robot_y - getSizeInMetersY() / 2);
+  }
+  if (!enabled_) {
+    return;
+  }
   updateFootprint(robot_x, robot_y, robot_yaw, min_x, min_y, max_x, max_y);
 }
 
@@ -410,6 +701,22 @@ ObstacleLayer::updateFootprint(
   for (unsigned int i = 0; i < transformed_footprint_.size(); i++) {
     touch(transformed_footprint_[i].x, transformed_footprint_[i].y, min_x, min_y, max_x, max_y);
   }
+
+  // Clear the footprint here rather than in updateCosts(), which may run on
+  // several tiles of the window at once
+  if (footprint_masks_.yawBins() > 0) {
+    setFootprintCost(robot_x, robot_y, robot_yaw, footprint_masks_, nav2_costmap_2d::FREE_SPACE);
+  } else {
+    setConvexPolygonCost(transformed_footprint_, nav2_costmap_2d::FREE_SPACE);
+  }
+}
+
+void
+ObstacleLayer::onFootprintChanged()
+{
+  if (footprint_masks_.yawBins() > 0) {
+    footprint_masks_.setFootprint(getFootprint(), resolution_);
+  }
 }
 
 void
@@ -422,10 +729,6 @@ ObstacleLayer::updateCosts(
     return;
   }
 
-  if (footprint_clearing_enabled_) {
-    setConvexPolygonCost(transformed_footprint_, nav2_costmap_2d::FREE_SPACE);
-  }
-
   switch (combination_method_) {
     case 0:  // Overwrite
       updateWithOverwrite(master_grid, min_i, min_j, max_i, max_j);
@@ -468,10 +771,16 @@ ObstacleLayer::getMarkingObservations(std::vector<Observation> & marking_observa
   bool current = true;
   // get the marking observations
   for (unsigned int i = 0; i < marking_buffers_.size(); ++i) {
-    marking_buffers_[i]->lock();
+    // a ring is read without holding up its sensor callback
+    bool locked = !marking_buffers_[i]->hasRing();
+    if (locked) {
+      marking_buffers_[i]->lock();
+    }
     marking_buffers_[i]->getObservations(marking_observations);
     current = marking_buffers_[i]->isCurrent() && current;
-    marking_buffers_[i]->unlock();
+    if (locked) {
+      marking_buffers_[i]->unlock();
+    }
   }
   marking_observations.insert(marking_observations.end(),
     static_marking_observations_.begin(), static_marking_observations_.end());
@@ -484,10 +793,16 @@ ObstacleLayer::getClearingObservations(std::vector<Observation> & clearing_obser
   bool current = true;
   // get the clearing observations
   for (unsigned int i = 0; i < clearing_buffers_.size(); ++i) {
-    clearing_buffers_[i]->lock();
+    // a ring is read without holding up its sensor callback
+    bool locked = !clearing_buffers_[i]->hasRing();
+    if (locked) {
+      clearing_buffers_[i]->lock();
+    }
     clearing_buffers_[i]->getObservations(clearing_observations);
     current = clearing_buffers_[i]->isCurrent() && current;
-    clearing_buffers_[i]->unlock();
+    if (locked) {
+      clearing_buffers_[i]->unlock();
+    }
   }
   clearing_observations.insert(clearing_observations.end(),
     static_clearing_observations_.begin(), static_clearing_observations_.end());
@@ -514,20 +829,73 @@ ObstacleLayer::raytraceFreespace(
     return;
   }
 
+  touch(ox, oy, min_x, min_y, max_x, max_y);
+
+  if (clearing_observation.polygon_max_gap_ > 0.0) {
+    clearPolygons(clearing_observation, min_x, min_y, max_x, max_y);
+    return;
+  }
+
+  size_t num_points = static_cast<size_t>(cloud.width) * cloud.height;
+  if (!clearing_pool_ || num_points < 2 * CLEARING_CHUNK_SIZE) {
+    raytracePoints(clearing_observation, x0, y0, 0, num_points, min_x, min_y, max_x, max_y);
+    return;
+  }
+
+  // Split the cloud into chunks traced on the clearing threads.  Rays from
+  // different chunks may cross the same cells, but every write stores
+  // FREE_SPACE and marking only runs once all of them are done, so the order
+  // they land in does not matter.  Each chunk grows its own bounds, which are
+  // merged afterwards.
+  int num_chunks = static_cast<int>((num_points + CLEARING_CHUNK_SIZE - 1) / CLEARING_CHUNK_SIZE);
+  clearing_bounds_.resize(num_chunks);
+  clearing_pool_->run([&](int chunk) {
+      ClearingBounds & bounds = clearing_bounds_[chunk];
+      bounds.min_x = bounds.min_y = std::numeric_limits<double>::max();
+      bounds.max_x = bounds.max_y = -std::numeric_limits<double>::max();
+      size_t first = chunk * CLEARING_CHUNK_SIZE;
+      size_t last = std::min(num_points, first + CLEARING_CHUNK_SIZE);
+      raytracePoints(clearing_observation, x0, y0, first, last,
+        &bounds.min_x, &bounds.min_y, &bounds.max_x, &bounds.max_y);
+    }, num_chunks);
+
+  for (const ClearingBounds & bounds : clearing_bounds_) {
+    *min_x = std::min(*min_x, bounds.min_x);
+    *min_y = std::min(*min_y, bounds.min_y);
+    *max_x = std::max(*max_x, bounds.max_x);
+    *max_y = std::max(*max_y, bounds.max_y);
+  }
+}
+
+void
+ObstacleLayer::raytracePoints(
+  const Observation & clearing_observation, unsigned int x0, unsigned int y0,
+  size_t first, size_t last,
+  double * min_x, double * min_y, double * max_x, double * max_y)
+{
+  double ox = clearing_observation.origin_.x;
+  double oy = clearing_observation.origin_.y;
+  const sensor_msgs::msg::PointCloud2 & cloud = *(clearing_observation.cloud_);
+
   // we can pre-compute the enpoints of the map outside of the inner loop... we'll need these later
   double origin_x = origin_x_, origin_y = origin_y_;
   double map_end_x = origin_x + size_x_ * resolution_;
   double map_end_y = origin_y + size_y_ * resolution_;
 
-
-  touch(ox, oy, min_x, min_y, max_x, max_y);
+  unsigned int cell_raytrace_range = cellDistance(clearing_observation.raytrace_range_);
 
   // for each point in the cloud, we want to trace a line from the origin
   // and clear obstacles along it
   sensor_msgs::PointCloud2ConstIterator<float> iter_x(cloud, "x");
   sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud, "y");
+  iter_x += static_cast<int>(first);
+  iter_y += static_cast<int>(first);
+
+  // gather the ends of all the rays first, then trace them back to back from the origin
+  std::vector<MapLocation> ends;
+  ends.reserve(last - first);
 
-  for (; iter_x != iter_x.end(); ++iter_x, ++iter_y) {
+  for (size_t n = first; n < last; ++n, ++iter_x, ++iter_y) {
     double wx = *iter_x;
     double wy = *iter_y;
 
@@ -568,14 +936,74 @@ ObstacleLayer::raytraceFreespace(
       continue;
     }
 
-    unsigned int cell_raytrace_range = cellDistance(clearing_observation.raytrace_range_);
-    MarkCell marker(costmap_, FREE_SPACE);
-    // and finally... we can execute our trace to clear obstacles along that line
-    raytraceLine(marker, x0, y0, x1, y1, cell_raytrace_range);
+    ends.push_back({x1, y1});
 
     updateRaytraceBounds(ox, oy, wx, wy, clearing_observation.raytrace_range_, min_x, min_y, max_x,
       max_y);
   }
+
+  MarkCell marker(costmap_, FREE_SPACE);
+  // and finally... we can execute our trace to clear obstacles along those lines
+  raytraceLines(marker, x0, y0, ends, cell_raytrace_range);
+}
+
+void
+ObstacleLayer::clearPolygons(
+  const Observation & clearing_observation,
+  double * min_x, double * min_y, double * max_x, double * max_y)
+{
+  double ox = clearing_observation.origin_.x;
+  double oy = clearing_observation.origin_.y;
+  const sensor_msgs::msg::PointCloud2 & cloud = *(clearing_observation.cloud_);
+  double range = clearing_observation.raytrace_range_;
+  double max_gap = clearing_observation.polygon_max_gap_;
+
+  // Each run of points with no gap wider than max_gap between neighbors makes a fan about the
+  // origin, which is filled row by row so each cell in it is written once.  The points are
+  // pulled in by a cell, as a ray stops short of the cell it hits, and out to the raytrace range
+  // at most.
+  polygon_.clear();
+  double last_angle = 0.0;
+  auto fill = [this]() {
+      if (polygon_.size() >= 3) {
+        polygonSpans(polygon_, polygon_spans_);
+        setSpansToValue(polygon_spans_, FREE_SPACE);
+      }
+      polygon_.resize(1);
+    };
+
+  geometry_msgs::msg::Point origin;
+  origin.x = ox;
+  origin.y = oy;
+  polygon_.push_back(origin);
+
+  sensor_msgs::PointCloud2ConstIterator<float> iter_x(cloud, "x");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud, "y");
+  size_t num_points = static_cast<size_t>(cloud.width) * cloud.height;
+  for (size_t n = 0; n < num_points; ++n, ++iter_x, ++iter_y) {
+    double dx = *iter_x - ox;
+    double dy = *iter_y - oy;
+    double distance = hypot(dx, dy);
+    double reach = std::min(range, distance - resolution_);
+    if (reach <= 0.0) {
+      continue;
+    }
+
+    double angle = atan2(dy, dx);
+    if (polygon_.size() > 1 &&
+      std::abs(std::remainder(angle - last_angle, 2 * M_PI)) > max_gap)
+    {
+      fill();
+    }
+    last_angle = angle;
+
+    geometry_msgs::msg::Point end;
+    end.x = ox + dx * reach / distance;
+    end.y = oy + dy * reach / distance;
+    polygon_.push_back(end);
+    touch(end.x, end.y, min_x, min_y, max_x, max_y);
+  }
+  fill();
 }
 
 void
@@ -587,6 +1015,9 @@ ObstacleLayer::activate()
       observation_subscribers_[i]->subscribe();
     }
   }
+  for (auto & consumer : shared_consumers_) {
+    consumer->setActive(true);
+  }
 
   for (unsigned int i = 0; i < observation_buffers_.size(); ++i) {
     if (observation_buffers_[i]) {
@@ -602,6 +1033,9 @@ ObstacleLayer::deactivate()
       observation_subscribers_[i]->unsubscribe();
     }
   }
+  for (auto & consumer : shared_consumers_) {
+    consumer->setActive(false);
+  }
 }
 
 void
@@ -40,9 +40,14 @@
 #include "nav2_costmap_2d/static_layer.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "nav2_costmap_2d/costmap_combine.hpp"
 #include "nav2_costmap_2d/costmap_math.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "tf2/convert.h"
@@ -54,6 +59,11 @@ using nav2_costmap_2d::NO_INFORMATION;
 using nav2_costmap_2d::LETHAL_OBSTACLE;
 using nav2_costmap_2d::FREE_SPACE;
 
+// What the rolling cache knows about each cell of the master grid
+static const unsigned char ROLLING_UNSAMPLED = 0;
+static const unsigned char ROLLING_OFF_MAP = 1;
+static const unsigned char ROLLING_ON_MAP = 2;
+
 namespace nav2_costmap_2d
 {
 
@@ -72,6 +82,39 @@ StaticLayer::onInitialize()
 
   getParameters();
 
+  if (map_tiles_ && !layered_costmap_->isRolling()) {
+    RCLCPP_WARN(node_->get_logger(),
+      "StaticLayer: map_tiles is only for rolling costmaps, subscribing to the whole map");
+    map_tiles_ = false;
+  }
+
+  if (map_tiles_) {
+    RCLCPP_INFO(node_->get_logger(),
+      "StaticLayer: Requesting the map around the robot from %s", map_tile_service_.c_str());
+    if (map_cache_size_ > 0) {
+      // the tiles of a map share its load time, which the cache tells maps apart by
+      RCLCPP_WARN(node_->get_logger(), "StaticLayer: map_cache_size is ignored with map_tiles");
+      map_cache_size_ = 0;
+    }
+    map_wait_timer_.start();
+    waiting_for_map_ = true;
+    map_tile_client_ = node_->create_client<nav2_msgs::srv::GetMapTile>(map_tile_service_);
+    if (subscribe_to_updates_) {
+      RCLCPP_WARN(node_->get_logger(),
+        "StaticLayer: Map updates are for the whole map and are ignored with map_tiles");
+    }
+    return;
+  }
+
+  if (map_cache_size_ > 0) {
+    cost_cache_ = std::make_unique<nav2_util::MapCache<std::vector<unsigned char>>>(
+      map_cache_size_);
+    map_cache_sub_ = node_->create_subscription<nav_msgs::msg::OccupancyGrid>(
+      map_topic_ + "_cache",
+      rclcpp::QoS(rclcpp::KeepLast(map_cache_size_)).transient_local().reliable(),
+      std::bind(&StaticLayer::incomingCachedMap, this, std::placeholders::_1));
+  }
+
   rclcpp::QoS map_qos(1);
   if (map_subscribe_transient_local_) {
     map_qos.transient_local();
@@ -81,6 +124,8 @@ StaticLayer::onInitialize()
     "Subscribing to the map topic (%s) with %s durability",
     map_topic_.c_str(),
     map_subscribe_transient_local_ ? "transient local" : "volatile");
+  map_wait_timer_.start();
+  waiting_for_map_ = true;
   map_sub_ = node_->create_subscription<nav_msgs::msg::OccupancyGrid>(
     map_topic_, map_qos,
     std::bind(&StaticLayer::incomingMap, this, std::placeholders::_1));
@@ -109,6 +154,12 @@ StaticLayer::reset()
 {
   map_sub_.reset();
   map_update_sub_.reset();
+  map_tile_client_.reset();
+  map_cache_sub_.reset();
+  cost_cache_.reset();
+  shared_costs_.reset();
+  tile_requested_ = false;
+  tile_loaded_ = false;
 
   undeclareAllParameters();
   onInitialize();
@@ -123,6 +174,14 @@ StaticLayer::getParameters()
   declareParameter("subscribe_to_updates", rclcpp::ParameterValue(false));
   declareParameter("map_subscribe_transient_local",
     rclcpp::ParameterValue(true));
+  declareParameter("tile_size", rclcpp::ParameterValue(0));
+  declareParameter("map_tiles", rclcpp::ParameterValue(false));
+  declareParameter("map_tile_service", rclcpp::ParameterValue(std::string("map_tile")));
+  declareParameter("map_tile_zoom", rclcpp::ParameterValue(0));
+  declareParameter("map_frame", rclcpp::ParameterValue(std::string("map")));
+  declareParameter("map_cache_size", rclcpp::ParameterValue(0));
+  declareParameter("share_maps", rclcpp::ParameterValue(false));
+  declareParameter("shared_distance_field", rclcpp::ParameterValue(false));
 
   node_->get_parameter(name_ + "." + "enabled", enabled_);
   node_->get_parameter(name_ + "." + "subscribe_to_updates", subscribe_to_updates_);
@@ -134,9 +193,48 @@ StaticLayer::getParameters()
   node_->get_parameter("lethal_cost_threshold", temp_lethal_threshold);
   node_->get_parameter("unknown_cost_value", unknown_cost_value_);
   node_->get_parameter("trinary_costmap", trinary_costmap_);
+  node_->get_parameter(name_ + "." + "tile_size", tile_size_);
+  node_->get_parameter(name_ + "." + "map_tiles", map_tiles_);
+  node_->get_parameter(name_ + "." + "map_tile_service", map_tile_service_);
+  node_->get_parameter(name_ + "." + "map_tile_zoom", map_tile_zoom_);
+  node_->get_parameter(name_ + "." + "map_cache_size", map_cache_size_);
+  node_->get_parameter(name_ + "." + "share_maps", share_maps_);
+  node_->get_parameter(name_ + "." + "shared_distance_field", shared_distance_field_);
+  if (map_tiles_ && map_frame_.empty()) {
+    // The frame to request the first tile in, then that of the tiles
+    node_->get_parameter(name_ + "." + "map_frame", map_frame_);
+  }
 
   // Enforce bounds
   lethal_threshold_ = std::max(std::min(temp_lethal_threshold, 100), 0);
+
+  // every occupancy value is translated through a table built from the parameters above
+  for (unsigned int value = 0; value < 256; ++value) {
+    cost_translation_table_[value] = interpretValue(value);
+  }
+
+  if (shared_distance_field_) {
+    // the field's obstacles are the occupancies of at least the lethal threshold, so those
+    // have to be the lethal ones of the values a map holds, -1 to 100
+    for (int value = -1; value <= 100 && shared_distance_field_; ++value) {
+      bool lethal = cost_translation_table_[static_cast<unsigned char>(value)] == LETHAL_OBSTACLE;
+      if (lethal != (value >= lethal_threshold_)) {
+        RCLCPP_WARN(node_->get_logger(), "StaticLayer: shared_distance_field is ignored, as "
+          "unknown_cost_value makes the lethal occupancies other than those over the threshold");
+        shared_distance_field_ = false;
+      }
+    }
+    if (map_tiles_) {
+      RCLCPP_WARN(node_->get_logger(), "StaticLayer: shared_distance_field is ignored with "
+        "map_tiles");
+      shared_distance_field_ = false;
+    }
+  }
+
+  // The storage is chosen once; reset() comes back through here with the map still loaded
+  if (tile_size_ > 0 && !tiles_ && !costmap_) {
+    tiles_ = std::make_unique<TiledCostmap>(tile_size_);
+  }
 }
 
 void
@@ -164,10 +262,16 @@ StaticLayer::processMap(const nav_msgs::msg::OccupancyGrid & new_map)
     RCLCPP_INFO(node_->get_logger(),
       "StaticLayer: Resizing costmap to %d X %d at %f m/pix", size_x, size_y,
       new_map.info.resolution);
-    layered_costmap_->resizeMap(size_x, size_y, new_map.info.resolution,
+    if (!layered_costmap_->resizeMap(size_x, size_y, new_map.info.resolution,
       new_map.info.origin.position.x,
       new_map.info.origin.position.y,
-      true);
+      true))
+    {
+      RCLCPP_ERROR(node_->get_logger(),
+        "StaticLayer: A %d X %d map is over the costmap's memory budget, ignoring it",
+        size_x, size_y);
+      return;
+    }
   } else if (size_x_ != size_x || size_y_ != size_y ||  // NOLINT
     resolution_ != new_map.info.resolution ||
     origin_x_ != new_map.info.origin.position.x ||
@@ -181,25 +285,66 @@ StaticLayer::processMap(const nav_msgs::msg::OccupancyGrid & new_map)
       new_map.info.origin.position.x, new_map.info.origin.position.y);
   }
 
-  unsigned int index = 0;
+  if (tiles_) {
+    // share the most common cost, usually free or unknown space, across untouched tiles
+    std::vector<unsigned int> histogram(256, 0);
+    for (auto value : new_map.data) {
+      ++histogram[static_cast<unsigned char>(value)];
+    }
+    unsigned char common = std::max_element(histogram.begin(), histogram.end()) -
+      histogram.begin();
+    tiles_->resize(size_x, size_y, cost_translation_table_[common]);
+  }
 
-  // initialize the costmap with static data
-  for (unsigned int i = 0; i < size_y; ++i) {
-    for (unsigned int j = 0; j < size_x; ++j) {
-      unsigned char value = new_map.data[index];
-      costmap_[index] = interpretValue(value);
-      ++index;
+  // initialize the costmap with static data, translated before if the map was seen
+  std::shared_ptr<std::vector<unsigned char>> costs;
+  if (cost_cache_ || share_maps_) {
+    costs = cachedCosts(new_map);
+  }
+  if (share_maps_) {
+    // held for as long as the map is, for the layers that load it later to find it
+    shared_costs_ = costs;
+  }
+  const unsigned char * data = reinterpret_cast<const unsigned char *>(new_map.data.data());
+  if (!tiles_) {
+    if (costs) {
+      memcpy(costmap_, costs->data(), costs->size());
+    } else {
+      translateCosts(data, costmap_, size_x * size_y);
+    }
+  } else {
+    unsigned int index = 0;
+    for (unsigned int i = 0; i < size_y; ++i) {
+      for (unsigned int j = 0; j < size_x; ++j) {
+        setStaticCost(j, i, costs ? (*costs)[index] : cost_translation_table_[data[index]]);
+        ++index;
+      }
     }
   }
 
+  if (tiles_) {
+    RCLCPP_INFO(node_->get_logger(),
+      "StaticLayer: Map allocated %u tiles, %.1f MB", tiles_->getAllocatedTiles(),
+      tiles_->getMemoryUsage() / 1e6);
+  }
+
   map_frame_ = new_map.header.frame_id;
 
+  std::shared_ptr<const nav2_util::DistanceField> field;
+  if (shared_distance_field_) {
+    field = nav2_util::sharedDistanceField(new_map, lethal_threshold_,
+        std::max(1u, std::thread::hardware_concurrency()));
+  }
+
   // we have a new map, update full size of map
   std::lock_guard<Costmap2D::mutex_t> guard(*getMutex());
+  distance_field_ = field;
   x_ = y_ = 0;
   width_ = size_x_;
   height_ = size_y_;
   has_updated_data_ = true;
+  rolling_cache_stale_ = true;
+  ++map_version_;
 
   current_ = true;
 }
@@ -210,9 +355,57 @@ StaticLayer::matchSize()
   // If we are using rolling costmap, the static map size is
   //   unrelated to the size of the layered costmap
   if (!layered_costmap_->isRolling()) {
-    Costmap2D * master = layered_costmap_->getCostmap();
-    resizeMap(master->getSizeInCellsX(), master->getSizeInCellsY(), master->getResolution(),
-      master->getOriginX(), master->getOriginY());
+    CostmapLayer::matchSize();
+  }
+}
+
+size_t
+StaticLayer::getMemoryUsage() const
+{
+  size_t bytes = tiles_ ? tiles_->getMemoryUsage() : CostmapLayer::getMemoryUsage();
+  if (shared_costs_) {
+    bytes += shared_costs_->capacity();
+  }
+  return bytes;
+}
+
+double
+StaticLayer::getMemoryPerCell() const
+{
+  // with tiles, a map of a single value would take less
+  return layered_costmap_->isRolling() ? 0.0 : CostmapLayer::getMemoryPerCell();
+}
+
+void
+StaticLayer::initMaps(unsigned int size_x, unsigned int size_y)
+{
+  if (!tiles_) {
+    Costmap2D::initMaps(size_x, size_y);
+    return;
+  }
+  std::unique_lock<Costmap2D::mutex_t> lock(*getMutex());
+  deleteMaps();
+  tiles_->resize(size_x, size_y, default_value_);
+}
+
+void
+StaticLayer::resetMaps()
+{
+  if (!tiles_) {
+    Costmap2D::resetMaps();
+    return;
+  }
+  std::unique_lock<Costmap2D::mutex_t> lock(*getMutex());
+  tiles_->resize(size_x_, size_y_, default_value_);
+}
+
+void
+StaticLayer::translateCosts(const unsigned char * source, unsigned char * dest, unsigned int size)
+{
+  // a table lookup per cell and no branches, so the loop unrolls into straight loads and stores
+  const unsigned char * table = cost_translation_table_;
+  for (unsigned int i = 0; i < size; ++i) {
+    dest[i] = table[source[i]];
   }
 }
 
@@ -239,6 +432,54 @@ StaticLayer::incomingMap(const nav_msgs::msg::OccupancyGrid::SharedPtr new_map)
 {
   std::lock_guard<Costmap2D::mutex_t> guard(*getMutex());
   processMap(*new_map);
+
+  if (waiting_for_map_) {
+    map_wait_timer_.end();
+    node_->record_startup_phase(name_ + ": waiting for the map", map_wait_timer_);
+    waiting_for_map_ = false;
+  }
+  layered_costmap_->requestUpdate();
+}
+
+void
+StaticLayer::incomingCachedMap(const nav_msgs::msg::OccupancyGrid::SharedPtr map)
+{
+  std::lock_guard<Costmap2D::mutex_t> guard(*getMutex());
+  cachedCosts(*map);
+}
+
+std::shared_ptr<std::vector<unsigned char>>
+StaticLayer::cachedCosts(const nav_msgs::msg::OccupancyGrid & map)
+{
+  std::shared_ptr<std::vector<unsigned char>> costs;
+  if (cost_cache_) {
+    costs = cost_cache_->find(map);
+    if (costs) {
+      return costs;
+    }
+  }
+
+  auto translate = [this, &map]() {
+      auto translated = std::make_shared<std::vector<unsigned char>>(map.data.size());
+      translateCosts(reinterpret_cast<const unsigned char *>(map.data.data()),
+        translated->data(), translated->size());
+      return translated;
+    };
+  if (share_maps_) {
+    // the costs only depend on the cells and the translation table, so the layers of the
+    // process with the same table share them
+    std::string table(reinterpret_cast<const char *>(cost_translation_table_),
+      sizeof(cost_translation_table_));
+    costs = nav2_util::SharedMapRegistry<std::vector<unsigned char>>::global().getOrPrepare(
+      {nav2_util::hashOccupancyGrid(map), "static_layer " + table}, translate);
+  } else {
+    costs = translate();
+  }
+
+  if (cost_cache_) {
+    cost_cache_->insert(map, costs);
+  }
+  return costs;
 }
 
 void
@@ -267,31 +508,100 @@ StaticLayer::incomingUpdate(map_msgs::msg::OccupancyGridUpdate::ConstSharedPtr u
       map_frame_.c_str(), update->header.frame_id.c_str());
   }
 
+  const unsigned char * data = reinterpret_cast<const unsigned char *>(update->data.data());
   unsigned int di = 0;
   for (unsigned int y = 0; y < update->height; y++) {
-    unsigned int index_base = (update->y + y) * size_x_;
+    if (!tiles_) {
+      translateCosts(data + di, costmap_ + getIndex(update->x, update->y + y), update->width);
+      di += update->width;
+      continue;
+    }
     for (unsigned int x = 0; x < update->width; x++) {
-      unsigned int index = index_base + x + update->x;
-      costmap_[index] = interpretValue(update->data[di++]);
+      setStaticCost(update->x + x, update->y + y, cost_translation_table_[data[di++]]);
     }
   }
 
+  // the field no longer matches the costs
+  distance_field_.reset();
+
   x_ = update->x;
   y_ = update->y;
   width_ = update->width;
   height_ = update->height;
   has_updated_data_ = true;
+  rolling_cache_stale_ = true;
+  ++map_version_;
+  layered_costmap_->requestUpdate();
 }
 
 
+void
+StaticLayer::requestTileAround(double robot_x, double robot_y)
+{
+  if (tile_requested_ || !map_tile_client_->service_is_ready()) {
+    return;
+  }
+
+  geometry_msgs::msg::TransformStamped transform;
+  try {
+    transform = tf_->lookupTransform(map_frame_, global_frame_, tf2::TimePointZero);
+  } catch (tf2::TransformException & ex) {
+    RCLCPP_WARN(node_->get_logger(), "StaticLayer: %s", ex.what());
+    return;
+  }
+  tf2::Transform tf2_transform;
+  tf2::fromMsg(transform.transform, tf2_transform);
+  tf2::Vector3 robot = tf2_transform * tf2::Vector3(robot_x, robot_y, 0);
+
+  // The region is twice the window on a side, so the window stays in it until the robot is
+  // half a window from its center
+  Costmap2D * master = layered_costmap_->getCostmap();
+  double size_x = master->getSizeInMetersX();
+  double size_y = master->getSizeInMetersY();
+  if (tile_loaded_ && std::fabs(robot.x() - tile_center_x_) < size_x / 2 &&
+    std::fabs(robot.y() - tile_center_y_) < size_y / 2)
+  {
+    return;
+  }
+
+  auto request = std::make_shared<nav2_msgs::srv::GetMapTile::Request>();
+  request->min_x = robot.x() - size_x;
+  request->min_y = robot.y() - size_y;
+  request->max_x = robot.x() + size_x;
+  request->max_y = robot.y() + size_y;
+  request->zoom = std::max(map_tile_zoom_, 0);
+
+  tile_requested_ = true;
+  double center_x = robot.x();
+  double center_y = robot.y();
+  map_tile_client_->async_send_request(request,
+    [this, center_x, center_y](rclcpp::Client<nav2_msgs::srv::GetMapTile>::SharedFuture future) {
+      auto response = future.get();
+      std::lock_guard<Costmap2D::mutex_t> guard(*getMutex());
+      tile_requested_ = false;
+      if (!response->map.info.width || !response->map.info.height) {
+        RCLCPP_WARN(node_->get_logger(), "StaticLayer: The robot is outside of the map");
+        return;
+      }
+      tile_center_x_ = center_x;
+      tile_center_y_ = center_y;
+      tile_loaded_ = true;
+      // the map lives as long as the response
+      incomingMap(nav_msgs::msg::OccupancyGrid::SharedPtr(response, &response->map));
+    });
+}
+
 void
 StaticLayer::updateBounds(
-  double /*robot_x*/, double /*robot_y*/, double /*robot_yaw*/, double * min_x,
+  double robot_x, double robot_y, double /*robot_yaw*/, double * min_x,
   double * min_y,
   double * max_x,
   double * max_y)
 {
   std::lock_guard<Costmap2D::mutex_t> guard(*getMutex());
+  if (map_tile_client_) {
+    requestTileAround(robot_x, robot_y);
+  }
   if (!layered_costmap_->isRolling() ) {
     if (!(has_updated_data_ || has_extra_bounds_)) {
       return;
@@ -324,15 +634,15 @@ StaticLayer::updateCosts(
 
   if (!layered_costmap_->isRolling()) {
     // if not rolling, the layered costmap (master_grid) has same coordinates as this layer
-    if (!use_maximum_) {
+    if (tiles_) {
+      updateFromTiles(master_grid, min_i, min_j, max_i, max_j);
+    } else if (!use_maximum_) {
       updateWithTrueOverwrite(master_grid, min_i, min_j, max_i, max_j);
     } else {
       updateWithMax(master_grid, min_i, min_j, max_i, max_j);
     }
   } else {
     // If rolling window, the master_grid is unlikely to have same coordinates as this layer
-    unsigned int mx, my;
-    double wx, wy;
     // Might even be in a different frame
     geometry_msgs::msg::TransformStamped transform;
     try {
@@ -342,27 +652,114 @@ StaticLayer::updateCosts(
       return;
     }
     // Copy map data given proper transformations
-    tf2::Transform tf2_transform;
-    tf2::fromMsg(transform.transform, tf2_transform);
+    updateRollingCache(master_grid, transform.transform, min_i, min_j, max_i, max_j);
+
+    unsigned char * master = master_grid.getCharMap();
+    unsigned int span = master_grid.getSizeInCellsX();
+    for (int j = min_j; j < max_j; ++j) {
+      unsigned char * dest = master + j * span;
+      const unsigned char * costs = &rolling_costs_[j * span];
+      const unsigned char * states = &rolling_states_[j * span];
+      // only the cells that fall on the static map are written, as selects rather than branches
+      if (!use_maximum_) {
+        for (int i = min_i; i < max_i; ++i) {
+          dest[i] = states[i] == ROLLING_ON_MAP ? costs[i] : dest[i];
+        }
+      } else {
+        for (int i = min_i; i < max_i; ++i) {
+          dest[i] = states[i] == ROLLING_ON_MAP ? std::max(costs[i], dest[i]) : dest[i];
+        }
+      }
+    }
+  }
+}
+
+void
+StaticLayer::updateRollingCache(
+  const nav2_costmap_2d::Costmap2D & master_grid,
+  const geometry_msgs::msg::Transform & transform,
+  int min_i, int min_j, int max_i, int max_j)
+{
+  unsigned int size_x = master_grid.getSizeInCellsX();
+  unsigned int size_y = master_grid.getSizeInCellsY();
+  double resolution = master_grid.getResolution();
+  double origin_x = master_grid.getOriginX();
+  double origin_y = master_grid.getOriginY();
+
+  // the rolling window moves by whole cells, so what the cache already holds can be shifted
+  // into place and only the cells that came into view need sampling
+  int shift_x = std::lround((origin_x - rolling_origin_x_) / resolution);
+  int shift_y = std::lround((origin_y - rolling_origin_y_) / resolution);
+  double tolerance = 1e-3 * resolution;
+  bool aligned = std::fabs(rolling_origin_x_ + shift_x * resolution - origin_x) < tolerance &&
+    std::fabs(rolling_origin_y_ + shift_y * resolution - origin_y) < tolerance;
+
+  if (rolling_cache_stale_ || !aligned || rolling_costs_.size() != size_x * size_y ||
+    rolling_resolution_ != resolution || transform != rolling_transform_)
+  {
+    rolling_costs_.assign(size_x * size_y, NO_INFORMATION);
+    rolling_states_.assign(size_x * size_y, ROLLING_UNSAMPLED);
+    rolling_resolution_ = resolution;
+    rolling_transform_ = transform;
+    rolling_cache_stale_ = false;
+  } else if (shift_x != 0 || shift_y != 0) {
+    shiftMapRegion(rolling_costs_.data(), size_x, size_y, shift_x, shift_y, NO_INFORMATION);
+    shiftMapRegion(rolling_states_.data(), size_x, size_y, shift_x, shift_y, ROLLING_UNSAMPLED);
+  }
+  rolling_origin_x_ = origin_x;
+  rolling_origin_y_ = origin_y;
+
+  tf2::Transform tf2_transform;
+  tf2::fromMsg(transform, tf2_transform);
 
+  unsigned int mx, my;
+  double wx, wy;
+  for (int j = min_j; j < max_j; ++j) {
     for (int i = min_i; i < max_i; ++i) {
-      for (int j = min_j; j < max_j; ++j) {
-        // Convert master_grid coordinates (i,j) into global_frame_(wx,wy) coordinates
-        layered_costmap_->getCostmap()->mapToWorld(i, j, wx, wy);
-        // Transform from global_frame_ to map_frame_
-        tf2::Vector3 p(wx, wy, 0);
-        p = tf2_transform * p;
-        // Set master_grid with cell from map
-        if (worldToMap(p.x(), p.y(), mx, my)) {
-          if (!use_maximum_) {
-            master_grid.setCost(i, j, getCost(mx, my));
-          } else {
-            master_grid.setCost(i, j, std::max(getCost(mx, my), master_grid.getCost(i, j)));
-          }
-        }
+      unsigned int index = j * size_x + i;
+      if (rolling_states_[index] != ROLLING_UNSAMPLED) {
+        continue;
+      }
+      // Convert master_grid coordinates (i,j) into global_frame_(wx,wy) coordinates
+      master_grid.mapToWorld(i, j, wx, wy);
+      // Transform from global_frame_ to map_frame_
+      tf2::Vector3 p(wx, wy, 0);
+      p = tf2_transform * p;
+      // Remember the cell from map
+      if (worldToMap(p.x(), p.y(), mx, my)) {
+        rolling_costs_[index] = getStaticCost(mx, my);
+        rolling_states_[index] = ROLLING_ON_MAP;
+      } else {
+        rolling_states_[index] = ROLLING_OFF_MAP;
       }
     }
   }
 }
 
+void
+StaticLayer::updateFromTiles(
+  nav2_costmap_2d::Costmap2D & master_grid,
+  int min_i, int min_j, int max_i, int max_j)
+{
+  if (max_i <= min_i || max_j <= min_j) {
+    return;
+  }
+  unsigned char * master = master_grid.getCharMap();
+  unsigned int span = master_grid.getSizeInCellsX();
+
+  // the same combines as updateWithTrueOverwrite() and updateWithMax(), a tile at a time
+  tiles_->forEachTile(min_i, min_j, max_i, max_j,
+    [&](const TiledCostmap::Tile & tile) {
+      for (unsigned int y = 0; y < tile.size_y; ++y) {
+        unsigned char * dest = master + (tile.y + y) * span + tile.x;
+        const unsigned char * source = tile.data + y * tile.stride;
+        if (use_maximum_) {
+          combineMax(dest, source, tile.size_x);
+        } else {
+          memcpy(dest, source, tile.size_x);
+        }
+      }
+    });
+}
+
 }  // namespace nav2_costmap_2d
@@ -69,7 +69,10 @@ void VoxelLayer::onInitialize()
   node_->declare_parameter(name_ + "." + "unknown_threshold", rclcpp::ParameterValue(15));
   node_->declare_parameter(name_ + "." + "mark_threshold", rclcpp::ParameterValue(0));
   node_->declare_parameter(name_ + "." + "combination_method", rclcpp::ParameterValue(1));
+  node_->declare_parameter(name_ + "." + "clearing_mode", rclcpp::ParameterValue(0));
   node_->declare_parameter(name_ + "." + "publish_voxel_map", rclcpp::ParameterValue(false));
+  node_->declare_parameter(name_ + "." + "publish_voxel_updates", rclcpp::ParameterValue(false));
+  node_->declare_parameter(name_ + "." + "voxel_keyframe_interval", rclcpp::ParameterValue(20));
 
   node_->get_parameter(name_ + "." + "enabled", enabled_);
   node_->get_parameter(name_ + "." + "footprint_clearing_enabled", footprint_clearing_enabled_);
@@ -80,19 +83,44 @@ void VoxelLayer::onInitialize()
   node_->get_parameter(name_ + "." + "unknown_threshold", unknown_threshold_);
   node_->get_parameter(name_ + "." + "mark_threshold", mark_threshold_);
   node_->get_parameter(name_ + "." + "combination_method", combination_method_);
+  node_->get_parameter(name_ + "." + "clearing_mode", clearing_mode_);
   node_->get_parameter(name_ + "." + "publish_voxel_map", publish_voxel_);
+  node_->get_parameter(name_ + "." + "publish_voxel_updates", publish_voxel_updates_);
+  node_->get_parameter(name_ + "." + "voxel_keyframe_interval", voxel_keyframe_interval_);
+
+  if (decay_ticks_) {
+    // marks are cleared column by column in the voxel grid, which keeps no stamps
+    RCLCPP_WARN(node_->get_logger(), "decay_time is not supported by the voxel layer");
+    setDecayTime(0.0, 1);
+  }
+
+  if (size_z_ > VOXEL_BITS) {
+    voxel_grid_64_ = std::make_unique<nav2_voxel_grid::VoxelGrid64>(0, 0, 0);
+    if (publish_voxel_) {
+      RCLCPP_WARN(node_->get_logger(),
+        "The voxel map can only be published for up to %d z_voxels, not %d",
+        VOXEL_BITS, size_z_);
+      publish_voxel_ = false;
+    }
+  } else {
+    // the 32 bit grid counts its unused levels as unknown
+    unknown_threshold_ += (VOXEL_BITS - size_z_);
+  }
 
   auto custom_qos = rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable();
 
   if (publish_voxel_) {
     voxel_pub_ = node_->create_publisher<nav2_msgs::msg::VoxelGrid>(
       "voxel_grid", custom_qos);
+    if (publish_voxel_updates_) {
+      voxel_update_pub_ = node_->create_publisher<nav2_msgs::msg::VoxelGridUpdate>(
+        "voxel_grid_updates", custom_qos);
+    }
   }
 
   clearing_endpoints_pub_ = node_->create_publisher<sensor_msgs::msg::PointCloud>(
     "clearing_endpoints", custom_qos);
 
-  unknown_threshold_ += (VOXEL_BITS - size_z_);
   matchSize();
 }
 
@@ -102,16 +130,79 @@ VoxelLayer::~VoxelLayer()
 
 void VoxelLayer::matchSize()
 {
+  // the columns are kept with the costs, when those are
+  Costmap2D * master = layered_costmap_->getCostmap();
+  unsigned int old_size_x = size_x_;
+  unsigned int old_size_y = size_y_;
+  size_t old_columns = static_cast<size_t>(old_size_x) * old_size_y;
+  int offset_x = 0, offset_y = 0;
+  unsigned int old_size_z = voxel_grid_64_ ? voxel_grid_64_->sizeZ() : voxel_grid_.sizeZ();
+  bool keep = old_columns > 0 && old_size_z == size_z_ &&
+    alignedOffset(master->getResolution(), master->getOriginX(), master->getOriginY(),
+      offset_x, offset_y);
+
   ObstacleLayer::matchSize();
+  if (voxel_grid_64_) {
+    std::vector<uint64_t> marked, unknown;
+    if (keep) {
+      marked.assign(voxel_grid_64_->getMarkedData(),
+        voxel_grid_64_->getMarkedData() + old_columns);
+      unknown.assign(voxel_grid_64_->getUnknownData(),
+        voxel_grid_64_->getUnknownData() + old_columns);
+    }
+    voxel_grid_64_->resize(size_x_, size_y_, size_z_);
+    assert(voxel_grid_64_->sizeX() == size_x_ && voxel_grid_64_->sizeY() == size_y_);
+    if (keep) {
+      copyOverlap(marked.data(), old_size_x, old_size_y, voxel_grid_64_->getMarkedData(),
+        size_x_, size_y_, offset_x, offset_y);
+      copyOverlap(unknown.data(), old_size_x, old_size_y, voxel_grid_64_->getUnknownData(),
+        size_x_, size_y_, offset_x, offset_y);
+    }
+    return;
+  }
+  std::vector<uint32_t> columns;
+  if (keep) {
+    columns.assign(voxel_grid_.getData(), voxel_grid_.getData() + old_columns);
+  }
   voxel_grid_.resize(size_x_, size_y_, size_z_);
   assert(voxel_grid_.sizeX() == size_x_ && voxel_grid_.sizeY() == size_y_);
+  if (keep) {
+    copyOverlap(columns.data(), old_size_x, old_size_y, voxel_grid_.getData(), size_x_,
+      size_y_, offset_x, offset_y);
+  }
+}
+
+size_t VoxelLayer::getMemoryUsage() const
+{
+  size_t columns = static_cast<size_t>(size_x_) * size_y_;
+  return ObstacleLayer::getMemoryUsage() +
+         columns * (voxel_grid_64_ ? 2 * sizeof(uint64_t) : sizeof(uint32_t));
+}
+
+double VoxelLayer::getMemoryPerCell() const
+{
+  return ObstacleLayer::getMemoryPerCell() +
+         (voxel_grid_64_ ? 2 * sizeof(uint64_t) : sizeof(uint32_t));
+}
+
+void VoxelLayer::getDumpGrids(std::vector<DumpGrid> & grids)
+{
+  ObstacleLayer::getDumpGrids(grids);
+  if (voxel_grid_64_) {
+    grids.push_back({name_ + "/marked", voxel_grid_64_->sizeX(), voxel_grid_64_->sizeY(),
+        voxel_grid_64_->sizeZ(), sizeof(uint64_t), voxel_grid_64_->getMarkedData()});
+    grids.push_back({name_ + "/unknown", voxel_grid_64_->sizeX(), voxel_grid_64_->sizeY(),
+        voxel_grid_64_->sizeZ(), sizeof(uint64_t), voxel_grid_64_->getUnknownData()});
+  } else {
+    grids.push_back({name_ + "/voxels", voxel_grid_.sizeX(), voxel_grid_.sizeY(),
+        voxel_grid_.sizeZ(), sizeof(uint32_t), voxel_grid_.getData()});
+  }
 }
 
 void VoxelLayer::reset()
 {
   deactivate();
   resetMaps();
-  voxel_grid_.reset();
   activate();
   undeclareAllParameters();
 }
@@ -119,7 +210,11 @@ void VoxelLayer::reset()
 void VoxelLayer::resetMaps()
 {
   Costmap2D::resetMaps();
-  voxel_grid_.reset();
+  if (voxel_grid_64_) {
+    voxel_grid_64_->reset();
+  } else {
+    voxel_grid_.reset();
+  }
 }
 
 void VoxelLayer::updateBounds(
@@ -192,7 +287,10 @@ void VoxelLayer::updateBounds(
       }
 
       // mark the cell in the voxel grid and check if we should also mark it in the costmap
-      if (voxel_grid_.markVoxelInMap(mx, my, mz, mark_threshold_)) {
+      bool mark_in_map = voxel_grid_64_ ?
+        voxel_grid_64_->markVoxelInMap(mx, my, mz, mark_threshold_) :
+        voxel_grid_.markVoxelInMap(mx, my, mz, mark_threshold_);
+      if (mark_in_map) {
         unsigned int index = getIndex(mx, my);
 
         costmap_[index] = LETHAL_OBSTACLE;
@@ -203,13 +301,26 @@ void VoxelLayer::updateBounds(
   }
 
   if (publish_voxel_) {
+    publishVoxelGrid();
+  }
+
+  updateFootprint(robot_x, robot_y, robot_yaw, min_x, min_y, max_x, max_y);
+}
+
+void VoxelLayer::publishVoxelGrid()
+{
+  unsigned int size = voxel_grid_.sizeX() * voxel_grid_.sizeY();
+  const uint32_t * data = voxel_grid_.getData();
+
+  // the full grid is only made for whoever asks for it, e.g. the cloud and marker tools,
+  // which only subscribe while something subscribes to them
+  if (voxel_pub_->get_subscription_count() > 0) {
     nav2_msgs::msg::VoxelGrid grid_msg;
-    unsigned int size = voxel_grid_.sizeX() * voxel_grid_.sizeY();
     grid_msg.size_x = voxel_grid_.sizeX();
     grid_msg.size_y = voxel_grid_.sizeY();
     grid_msg.size_z = voxel_grid_.sizeZ();
     grid_msg.data.resize(size);
-    memcpy(&grid_msg.data[0], voxel_grid_.getData(), size * sizeof(unsigned int));
+    memcpy(&grid_msg.data[0], data, size * sizeof(unsigned int));
 
     grid_msg.origin.x = origin_x_;
     grid_msg.origin.y = origin_y_;
@@ -223,7 +334,49 @@ void VoxelLayer::updateBounds(
     voxel_pub_->publish(grid_msg);
   }
 
-  updateFootprint(robot_x, robot_y, robot_yaw, min_x, min_y, max_x, max_y);
+  if (!publish_voxel_updates_) {
+    return;
+  }
+
+  nav2_msgs::msg::VoxelGridUpdate & update = voxel_update_;
+  bool moved = update.origin.x != static_cast<float>(origin_x_) ||
+    update.origin.y != static_cast<float>(origin_y_) ||
+    update.resolutions.x != resolution_;
+
+  update.header.frame_id = global_frame_;
+  update.header.stamp = node_->now();
+  update.sequence = voxel_update_sequence_++;
+  update.size_x = voxel_grid_.sizeX();
+  update.size_y = voxel_grid_.sizeY();
+  update.size_z = voxel_grid_.sizeZ();
+  update.origin.x = origin_x_;
+  update.origin.y = origin_y_;
+  update.origin.z = origin_z_;
+  update.resolutions.x = resolution_;
+  update.resolutions.y = resolution_;
+  update.resolutions.z = z_resolution_;
+  update.columns.clear();
+  update.data.clear();
+
+  // the receivers' copy is only kept in step while the grid keeps its geometry
+  update.keyframe = voxel_updates_since_keyframe_ + 1 >= voxel_keyframe_interval_ ||
+    voxel_sent_.size() != size || moved;
+
+  if (update.keyframe) {
+    update.data.assign(data, data + size);
+    voxel_sent_.assign(data, data + size);
+    voxel_updates_since_keyframe_ = 0;
+  } else {
+    ++voxel_updates_since_keyframe_;
+    for (unsigned int i = 0; i < size; ++i) {
+      if (data[i] != voxel_sent_[i]) {
+        update.columns.push_back(i);
+        update.data.push_back(data[i]);
+        voxel_sent_[i] = data[i];
+      }
+    }
+  }
+  voxel_update_pub_->publish(update);
 }
 
 void VoxelLayer::clearNonLethal(
@@ -268,7 +421,11 @@ void VoxelLayer::clearNonLethal(
       if (*current != LETHAL_OBSTACLE) {
         if (clear_no_info || *current != NO_INFORMATION) {
           *current = FREE_SPACE;
-          voxel_grid_.clearVoxelColumn(index);
+          if (voxel_grid_64_) {
+            voxel_grid_64_->clearVoxelColumn(index);
+          } else {
+            voxel_grid_.clearVoxelColumn(index);
+          }
         }
       }
       current++;
@@ -313,6 +470,12 @@ void VoxelLayer::raytraceFreespace(
   double map_end_x = origin_x_ + getSizeInMetersX();
   double map_end_y = origin_y_ + getSizeInMetersY();
 
+  unsigned int cell_raytrace_range = cellDistance(clearing_observation.raytrace_range_);
+  if (clearing_mode_ != 0) {
+    clearing_end_points_.clear();
+    clearing_end_points_.reserve(3 * clearing_observation_cloud_size);
+  }
+
   sensor_msgs::PointCloud2ConstIterator<float> iter_x(*(clearing_observation.cloud_), "x");
   sensor_msgs::PointCloud2ConstIterator<float> iter_y(*(clearing_observation.cloud_), "y");
   sensor_msgs::PointCloud2ConstIterator<float> iter_z(*(clearing_observation.cloud_), "z");
@@ -366,13 +529,23 @@ void VoxelLayer::raytraceFreespace(
 
     double point_x, point_y, point_z;
     if (worldToMap3DFloat(wpx, wpy, wpz, point_x, point_y, point_z)) {
-      unsigned int cell_raytrace_range = cellDistance(clearing_observation.raytrace_range_);
-
       // voxel_grid_.markVoxelLine(sensor_x, sensor_y, sensor_z, point_x, point_y, point_z);
-      voxel_grid_.clearVoxelLineInMap(sensor_x, sensor_y, sensor_z, point_x, point_y, point_z,
-        costmap_,
-        unknown_threshold_, mark_threshold_, FREE_SPACE, NO_INFORMATION,
-        cell_raytrace_range);
+      if (clearing_mode_ != 0) {
+        // cleared all at once below
+        clearing_end_points_.push_back(point_x);
+        clearing_end_points_.push_back(point_y);
+        clearing_end_points_.push_back(point_z);
+      } else if (voxel_grid_64_) {
+        voxel_grid_64_->clearVoxelLineInMap(sensor_x, sensor_y, sensor_z, point_x, point_y,
+          point_z, costmap_,
+          unknown_threshold_, mark_threshold_, FREE_SPACE, NO_INFORMATION,
+          cell_raytrace_range);
+      } else {
+        voxel_grid_.clearVoxelLineInMap(sensor_x, sensor_y, sensor_z, point_x, point_y, point_z,
+          costmap_,
+          unknown_threshold_, mark_threshold_, FREE_SPACE, NO_INFORMATION,
+          cell_raytrace_range);
+      }
 
       updateRaytraceBounds(ox, oy, wpx, wpy, clearing_observation.raytrace_range_, min_x, min_y,
         max_x,
@@ -388,6 +561,21 @@ void VoxelLayer::raytraceFreespace(
     }
   }
 
+  if (!clearing_end_points_.empty()) {
+    unsigned int num_points = clearing_end_points_.size() / 3;
+    bool per_column = clearing_mode_ == 2;
+    if (voxel_grid_64_) {
+      voxel_grid_64_->clearVoxelRaysInMap(sensor_x, sensor_y, sensor_z, &clearing_end_points_[0],
+        num_points, costmap_, unknown_threshold_, mark_threshold_, FREE_SPACE, NO_INFORMATION,
+        cell_raytrace_range, per_column);
+    } else {
+      voxel_grid_.clearVoxelRaysInMap(sensor_x, sensor_y, sensor_z, &clearing_end_points_[0],
+        num_points, costmap_, unknown_threshold_, mark_threshold_, FREE_SPACE, NO_INFORMATION,
+        cell_raytrace_range, per_column);
+    }
+    clearing_end_points_.clear();
+  }
+
   if (publish_clearing_points) {
     clearing_endpoints_.header.frame_id = global_frame_;
     clearing_endpoints_.header.stamp = clearing_observation.cloud_->header.stamp;
@@ -409,54 +597,22 @@ void VoxelLayer::updateOrigin(double new_origin_x, double new_origin_y)
   new_grid_ox = origin_x_ + cell_ox * resolution_;
   new_grid_oy = origin_y_ + cell_oy * resolution_;
 
-  // To save casting from unsigned int to int a bunch of times
-  int size_x = size_x_;
-  int size_y = size_y_;
-
-  // we need to compute the overlap of the new and existing windows
-  int lower_left_x, lower_left_y, upper_right_x, upper_right_y;
-  lower_left_x = std::min(std::max(cell_ox, 0), size_x);
-  lower_left_y = std::min(std::max(cell_oy, 0), size_y);
-  upper_right_x = std::min(std::max(cell_ox + size_x, 0), size_x);
-  upper_right_y = std::min(std::max(cell_oy + size_y, 0), size_y);
-
-  unsigned int cell_size_x = upper_right_x - lower_left_x;
-  unsigned int cell_size_y = upper_right_y - lower_left_y;
-
-  // we need a map to store the obstacles in the window temporarily
-  unsigned char * local_map = new unsigned char[cell_size_x * cell_size_y];
-  unsigned int * local_voxel_map = new unsigned int[cell_size_x * cell_size_y];
-  unsigned int * voxel_map = voxel_grid_.getData();
-
-  // copy the local window in the costmap to the local map
-  copyMapRegion(costmap_, lower_left_x, lower_left_y, size_x_, local_map, 0, 0, cell_size_x,
-    cell_size_x,
-    cell_size_y);
-  copyMapRegion(voxel_map, lower_left_x, lower_left_y, size_x_, local_voxel_map, 0, 0, cell_size_x,
-    cell_size_x,
-    cell_size_y);
-
-  // we'll reset our maps to unknown space if appropriate
-  resetMaps();
+  // shift the overlapping window of both grids into place, resetting only the strips
+  // that moved into view to unknown space
+  shiftMapRegion(costmap_, size_x_, size_y_, cell_ox, cell_oy, default_value_);
+  if (voxel_grid_64_) {
+    shiftMapRegion(voxel_grid_64_->getMarkedData(), size_x_, size_y_, cell_ox, cell_oy,
+      static_cast<uint64_t>(0));
+    shiftMapRegion(voxel_grid_64_->getUnknownData(), size_x_, size_y_, cell_ox, cell_oy,
+      voxel_grid_64_->getUnknownColumn());
+  } else {
+    shiftMapRegion(voxel_grid_.getData(), size_x_, size_y_, cell_ox, cell_oy,
+      ~(static_cast<uint32_t>(0)) >> 16);
+  }
 
   // update the origin with the appropriate world coordinates
   origin_x_ = new_grid_ox;
   origin_y_ = new_grid_oy;
-
-  // compute the starting cell location for copying data back in
-  int start_x = lower_left_x - cell_ox;
-  int start_y = lower_left_y - cell_oy;
-
-  // now we want to copy the overlapping information back into the map, but in its new location
-  copyMapRegion(local_map, 0, 0, cell_size_x, costmap_, start_x, start_y, size_x_, cell_size_x,
-    cell_size_y);
-  copyMapRegion(local_voxel_map, 0, 0, cell_size_x, voxel_map, start_x, start_y, size_x_,
-    cell_size_x,
-    cell_size_y);
-
-  // make sure to clean up
-  delete[] local_map;
-  delete[] local_voxel_map;
 }
 
 }  // namespace nav2_costmap_2d
@@ -0,0 +1,86 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/adaptive_update_policy.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nav2_costmap_2d
+{
+
+// How much of each new update time the average takes in
+static const double UPDATE_TIME_WEIGHT = 0.2;
+
+AdaptiveUpdatePolicy::AdaptiveUpdatePolicy(const Params & params)
+: params_(params)
+{
+  params_.max_frequency = std::max(params_.max_frequency, params_.min_frequency);
+  params_.min_window_scale = std::min(std::max(params_.min_window_scale, 0.0), 1.0);
+}
+
+void AdaptiveUpdatePolicy::addPose(double x, double y, double yaw, double time)
+{
+  double dt = time - time_;
+  if (has_pose_ && dt > 0.0) {
+    double speed = std::hypot(x - x_, y - y_) / dt;
+    double rotation = std::fabs(std::remainder(yaw - yaw_, 2.0 * M_PI)) / dt;
+    double level = std::min(1.0, std::max(
+          params_.full_speed > 0.0 ? speed / params_.full_speed : 0.0,
+          params_.full_rotation > 0.0 ? rotation / params_.full_rotation : 0.0));
+    if (level >= level_ || params_.settle_time <= 0.0) {
+      level_ = level;
+    } else {
+      level_ = std::max(level, level_ - dt / params_.settle_time);
+    }
+  }
+  // time going back, as on a switch to sim time, starts over from this pose
+  if (!has_pose_ || dt != 0.0) {
+    has_pose_ = true;
+    x_ = x;
+    y_ = y;
+    yaw_ = yaw;
+    time_ = time;
+  }
+}
+
+void AdaptiveUpdatePolicy::addUpdateTime(double seconds)
+{
+  update_time_ = update_time_ > 0.0 ?
+    update_time_ + (seconds - update_time_) * UPDATE_TIME_WEIGHT : seconds;
+}
+
+double AdaptiveUpdatePolicy::frequency() const
+{
+  double frequency = params_.min_frequency +
+    (params_.max_frequency - params_.min_frequency) * level_;
+  if (params_.cpu_budget > 0.0 && update_time_ > 0.0) {
+    frequency = std::min(frequency, params_.cpu_budget / update_time_);
+  }
+  return std::max(frequency, params_.min_frequency);
+}
+
+double AdaptiveUpdatePolicy::windowScale() const
+{
+  double scale = params_.min_window_scale + (1.0 - params_.min_window_scale) * level_;
+  if (params_.window_step > 0.0) {
+    // rounded up, so the window is never smaller than the speed asks for
+    scale = params_.min_window_scale +
+      std::ceil((scale - params_.min_window_scale) / params_.window_step - 1e-9) *
+      params_.window_step;
+  }
+  return std::min(scale, 1.0);
+}
+
+}  // namespace nav2_costmap_2d
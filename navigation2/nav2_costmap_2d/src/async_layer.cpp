@@ -0,0 +1,169 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/async_layer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace nav2_costmap_2d
+{
+
+AsyncLayer::~AsyncLayer()
+{
+  stopWorker();
+}
+
+void AsyncLayer::stopWorker()
+{
+  {
+    std::lock_guard<std::mutex> lock(worker_mutex_);
+    shutdown_ = true;
+  }
+  worker_cv_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+void AsyncLayer::waitForCompute()
+{
+  std::unique_lock<std::mutex> lock(worker_mutex_);
+  worker_cv_.wait(lock, [this] {return finished_ == started_;});
+}
+
+void AsyncLayer::workerLoop()
+{
+  std::unique_lock<std::mutex> lock(worker_mutex_);
+  while (true) {
+    worker_cv_.wait(lock, [this] {return shutdown_ || finished_ != started_;});
+    if (finished_ == started_) {
+      return;
+    }
+
+    lock.unlock();
+    compute(working_, changed_);
+    lock.lock();
+
+    finished_ = started_;
+    has_result_ = true;
+    worker_cv_.notify_all();
+    if (layered_costmap_) {
+      // publish it on the next update rather than the next period
+      layered_costmap_->requestUpdate();
+    }
+  }
+}
+
+void AsyncLayer::updateBounds(
+  double robot_x, double robot_y, double robot_yaw,
+  double * min_x, double * min_y, double * max_x, double * max_y)
+{
+  if (layered_costmap_->isRolling()) {
+    updateOrigin(robot_x - getSizeInMetersX() / 2, robot_y - getSizeInMetersY() / 2);
+  }
+  if (!enabled_) {
+    return;
+  }
+  useExtraBounds(min_x, min_y, max_x, max_y);
+
+  {
+    std::lock_guard<std::mutex> lock(worker_mutex_);
+    if (finished_ != started_ || shutdown_) {
+      return;
+    }
+    if (has_result_) {
+      publishResult(min_x, min_y, max_x, max_y);
+      has_result_ = false;
+    }
+  }
+
+  // the worker is idle, so nothing else reads its inputs or its grid
+  if (!prepareCompute(robot_x, robot_y, robot_yaw)) {
+    return;
+  }
+  working_ = static_cast<const Costmap2D &>(*this);
+  changed_ = {1e30, 1e30, -1e30, -1e30};
+  {
+    std::lock_guard<std::mutex> lock(worker_mutex_);
+    ++started_;
+    if (!worker_.joinable()) {
+      worker_ = std::thread(&AsyncLayer::workerLoop, this);
+    }
+  }
+  worker_cv_.notify_all();
+}
+
+void AsyncLayer::publishResult(double * min_x, double * min_y, double * max_x, double * max_y)
+{
+  if (changed_.min_x > changed_.max_x || changed_.min_y > changed_.max_y ||
+    working_.getSizeInCellsX() != size_x_ || working_.getSizeInCellsY() != size_y_ ||
+    working_.getResolution() != resolution_)
+  {
+    return;
+  }
+
+  int x0, y0, xn, yn;
+  working_.worldToMapEnforceBounds(changed_.min_x, changed_.min_y, x0, y0);
+  working_.worldToMapEnforceBounds(changed_.max_x, changed_.max_y, xn, yn);
+
+  // a rolling window may have moved on by whole cells since the computation started
+  const int dx = static_cast<int>(std::lround((working_.getOriginX() - origin_x_) / resolution_));
+  const int dy = static_cast<int>(std::lround((working_.getOriginY() - origin_y_) / resolution_));
+  x0 = std::max({x0, 0, -dx});
+  y0 = std::max({y0, 0, -dy});
+  xn = std::min({xn + 1, static_cast<int>(size_x_), static_cast<int>(size_x_) - dx});
+  yn = std::min({yn + 1, static_cast<int>(size_y_), static_cast<int>(size_y_) - dy});
+  if (x0 >= xn || y0 >= yn) {
+    return;
+  }
+
+  const unsigned char * source = working_.getCharMap();
+  for (int y = y0; y < yn; ++y) {
+    memcpy(costmap_ + getIndex(x0 + dx, y + dy), source + working_.getIndex(x0, y), xn - x0);
+  }
+  touch(changed_.min_x, changed_.min_y, min_x, min_y, max_x, max_y);
+  touch(changed_.max_x, changed_.max_y, min_x, min_y, max_x, max_y);
+}
+
+void AsyncLayer::updateCosts(
+  Costmap2D & master_grid, int min_i, int min_j, int max_i, int max_j)
+{
+  if (!enabled_) {
+    return;
+  }
+  updateWithMax(master_grid, min_i, min_j, max_i, max_j);
+}
+
+void AsyncLayer::matchSize()
+{
+  waitForCompute();
+  CostmapLayer::matchSize();
+  std::lock_guard<std::mutex> lock(worker_mutex_);
+  has_result_ = false;
+}
+
+size_t AsyncLayer::getMemoryUsage() const
+{
+  return CostmapLayer::getMemoryUsage() +
+         static_cast<size_t>(working_.getSizeInCellsX()) * working_.getSizeInCellsY();
+}
+
+double AsyncLayer::getMemoryPerCell() const
+{
+  return CostmapLayer::getMemoryPerCell() + 1.0;
+}
+
+}  // namespace nav2_costmap_2d
@@ -0,0 +1,36 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/center_cost_check.hpp"
+
+#include <string>
+
+namespace nav2_costmap_2d
+{
+
+bool centerCheckModeFromString(const std::string & name, CenterCheckMode & mode)
+{
+  if (name == "exact") {
+    mode = CenterCheckMode::EXACT;
+  } else if (name == "inscribed") {
+    mode = CenterCheckMode::INSCRIBED;
+  } else if (name == "circumscribed") {
+    mode = CenterCheckMode::CIRCUMSCRIBED;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace nav2_costmap_2d
@@ -46,17 +46,20 @@ ClearCostmapService::ClearCostmapService(
   clear_except_service_ = node_->create_service<ClearExceptRegion>(
     "clear_except_" + costmap_.getName(),
     std::bind(&ClearCostmapService::clearExceptRegionCallback, this,
-    std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+    rmw_qos_profile_services_default, costmap_.getServicesCallbackGroup());
 
   clear_around_service_ = node_->create_service<ClearAroundRobot>(
     "clear_around_" + costmap.getName(),
     std::bind(&ClearCostmapService::clearAroundRobotCallback, this,
-    std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+    rmw_qos_profile_services_default, costmap_.getServicesCallbackGroup());
 
   clear_entire_service_ = node_->create_service<ClearEntirely>(
     "clear_entirely_" + costmap_.getName(),
     std::bind(&ClearCostmapService::clearEntireCallback, this,
-    std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+    rmw_qos_profile_services_default, costmap_.getServicesCallbackGroup());
 }
 
 void ClearCostmapService::clearExceptRegionCallback(
@@ -105,13 +108,9 @@ void ClearCostmapService::clearExceptRegion(const double reset_distance)
     return;
   }
 
-  auto layers = costmap_.getLayeredCostmap()->getPlugins();
-
-  for (auto & layer : *layers) {
-    if (isClearable(getLayerName(*layer))) {
-      auto costmap_layer = std::static_pointer_cast<CostmapLayer>(layer);
-      clearLayerExceptRegion(costmap_layer, x, y, reset_distance);
-    }
+  double half = reset_distance / 2;
+  for (auto & layer : getClearableLayers()) {
+    layer->queueClearExcept(x - half, y - half, x + half, y + half, reset_value_);
   }
 }
 
@@ -143,7 +142,14 @@ void ClearCostmapService::clearAroundRobot(double window_size_x, double window_s
   pt.y = pose_y + window_size_y / 2;
   clear_poly.push_back(pt);
 
-  costmap_.getCostmap()->setConvexPolygonCost(clear_poly, reset_value_);
+  clearPolygon(clear_poly);
+}
+
+void ClearCostmapService::clearPolygon(const std::vector<geometry_msgs::msg::Point> & polygon)
+{
+  for (auto & layer : getClearableLayers()) {
+    layer->queueClearPolygon(polygon, reset_value_);
+  }
 }
 
 void ClearCostmapService::clearEntirely()
@@ -157,36 +163,15 @@ bool ClearCostmapService::isClearable(const string & layer_name) const
   return count(begin(clearable_layers_), end(clearable_layers_), layer_name) != 0;
 }
 
-void ClearCostmapService::clearLayerExceptRegion(
-  shared_ptr<CostmapLayer> & costmap, double pose_x, double pose_y, double reset_distance)
+vector<shared_ptr<CostmapLayer>> ClearCostmapService::getClearableLayers() const
 {
-  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap->getMutex()));
-
-  double start_point_x = pose_x - reset_distance / 2;
-  double start_point_y = pose_y - reset_distance / 2;
-  double end_point_x = start_point_x + reset_distance;
-  double end_point_y = start_point_y + reset_distance;
-
-  int start_x, start_y, end_x, end_y;
-  costmap->worldToMapNoBounds(start_point_x, start_point_y, start_x, start_y);
-  costmap->worldToMapNoBounds(end_point_x, end_point_y, end_x, end_y);
-
-  unsigned int size_x = costmap->getSizeInCellsX();
-  unsigned int size_y = costmap->getSizeInCellsY();
-
-  // Clearing the four rectangular regions around the one we want to keep
-  // top region
-  costmap->resetMapToValue(0, 0, size_x, start_y, reset_value_);
-  // left region
-  costmap->resetMapToValue(0, start_y, start_x, end_y, reset_value_);
-  // right region
-  costmap->resetMapToValue(end_x, start_y, size_x, end_y, reset_value_);
-  // bottom region
-  costmap->resetMapToValue(0, end_y, size_x, size_y, reset_value_);
-
-  double ox = costmap->getOriginX(), oy = costmap->getOriginY();
-  double width = costmap->getSizeInMetersX(), height = costmap->getSizeInMetersY();
-  costmap->addExtraBounds(ox, oy, ox + width, oy + height);
+  vector<shared_ptr<CostmapLayer>> clearable;
+  for (auto & layer : *costmap_.getLayeredCostmap()->getPlugins()) {
+    if (isClearable(getLayerName(*layer))) {
+      clearable.push_back(std::static_pointer_cast<CostmapLayer>(layer));
+    }
+  }
+  return clearable;
 }
 
 bool ClearCostmapService::getPosition(double & x, double & y) const
@@ -12,17 +12,19 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cmath>
 #include <memory>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <utility>
 
 #include "nav2_costmap_2d/collision_checker.hpp"
 
 #include "nav2_costmap_2d/cost_values.hpp"
 #include "nav2_costmap_2d/exceptions.hpp"
 #include "nav2_costmap_2d/footprint.hpp"
-#include "nav2_util/line_iterator.hpp"
+#include "nav2_util/line_traversal.hpp"
 
 using namespace std::chrono_literals;
 
@@ -34,8 +36,11 @@ CollisionChecker::CollisionChecker(
   FootprintSubscriber & footprint_sub,
   tf2_ros::Buffer & tf,
   std::string name,
-  std::string global_frame)
-: name_(name),
+  std::string global_frame,
+  unsigned int yaw_bins)
+: yaw_bins_(yaw_bins),
+  masks_(yaw_bins),
+  name_(name),
   global_frame_(global_frame),
   tf_(tf),
   costmap_sub_(costmap_sub),
@@ -50,39 +55,161 @@ CollisionChecker::~CollisionChecker()
 bool CollisionChecker::isCollisionFree(
   const geometry_msgs::msg::Pose2D & pose)
 {
+  return isCollisionFree(std::vector<geometry_msgs::msg::Pose2D>{pose});
+}
+
+bool CollisionChecker::isCollisionFree(
+  const std::vector<geometry_msgs::msg::Pose2D> & poses)
+{
+  return firstCollision(poses) < 0;
+}
+
+int CollisionChecker::firstCollision(
+  const std::vector<geometry_msgs::msg::Pose2D> & poses)
+{
+  int index = 0;
   try {
-    if (scorePose(pose) < 0) {
-      return false;
+    updateCostmap();
+    Footprint footprint_spec = getFootprintSpec();
+    batchToMap(poses, pose_cells_);
+    for (; index < static_cast<int>(poses.size()); ++index) {
+      if (!pose_cells_.valid[index]) {
+        throw IllegalPoseException(name_, "Pose Goes Off Grid.");
+      }
+      if (cellCost(poses[index], pose_cells_.mx[index], pose_cells_.my[index],
+        footprint_spec) < 0)
+      {
+        return index;
+      }
     }
-    return true;
+    return -1;
   } catch (const IllegalPoseException & e) {
     RCLCPP_ERROR(rclcpp::get_logger(name_), "%s", e.what());
-    return false;
+    return index;
   } catch (const CollisionCheckerException & e) {
     RCLCPP_ERROR(rclcpp::get_logger(name_), "%s", e.what());
-    return false;
+    return index;
   } catch (...) {
     RCLCPP_ERROR(rclcpp::get_logger(name_), "Failed to check pose score!");
-    return false;
+    return index;
   }
 }
 
 double CollisionChecker::scorePose(
   const geometry_msgs::msg::Pose2D & pose)
+{
+  updateCostmap();
+  return poseCost(pose, getFootprintSpec());
+}
+
+std::vector<double> CollisionChecker::scorePoses(
+  const std::vector<geometry_msgs::msg::Pose2D> & poses)
+{
+  updateCostmap();
+  Footprint footprint_spec = getFootprintSpec();
+
+  batchToMap(poses, pose_cells_);
+  std::vector<double> scores;
+  scores.reserve(poses.size());
+  for (size_t i = 0; i < poses.size(); ++i) {
+    try {
+      if (!pose_cells_.valid[i]) {
+        throw IllegalPoseException(name_, "Pose Goes Off Grid.");
+      }
+      scores.push_back(cellCost(poses[i], pose_cells_.mx[i], pose_cells_.my[i], footprint_spec));
+    } catch (const IllegalPoseException & e) {
+      RCLCPP_DEBUG(rclcpp::get_logger(name_), "%s", e.what());
+      scores.push_back(-1.0);
+    }
+  }
+  return scores;
+}
+
+void CollisionChecker::updateCostmap()
 {
   try {
     costmap_ = costmap_sub_.getCostmap();
   } catch (const std::runtime_error & e) {
     throw CollisionCheckerException(e.what());
   }
+}
 
+double CollisionChecker::poseCost(
+  const geometry_msgs::msg::Pose2D & pose,
+  const Footprint & footprint_spec)
+{
   unsigned int cell_x, cell_y;
   if (!costmap_->worldToMap(pose.x, pose.y, cell_x, cell_y)) {
     RCLCPP_DEBUG(rclcpp::get_logger(name_), "Map Cell: [%d, %d]", cell_x, cell_y);
     throw IllegalPoseException(name_, "Pose Goes Off Grid.");
   }
+  return cellCost(pose, cell_x, cell_y, footprint_spec);
+}
+
+double CollisionChecker::cellCost(
+  const geometry_msgs::msg::Pose2D & pose, unsigned int cell_x, unsigned int cell_y,
+  const Footprint & footprint_spec)
+{
+  unsigned char center_cost = costmap_->getCost(cell_x, cell_y);
+  switch (center_check_.classify(center_cost)) {
+    case CenterCheckResult::COLLISION:
+      RCLCPP_DEBUG(rclcpp::get_logger(name_), "Map Cell: [%d, %d]", cell_x, cell_y);
+      throw IllegalPoseException(name_, "Footprint Hits Obstacle.");
+    case CenterCheckResult::FREE:
+      if (footprintOnGrid(cell_x, cell_y, footprint_spec)) {
+        return center_cost;
+      }
+      break;
+    case CenterCheckResult::AMBIGUOUS:
+      break;
+  }
+
+  if (yaw_bins_ > 0) {
+    return rasterCost(cell_x, cell_y, pose.theta, footprint_spec);
+  }
+
+  Footprint footprint;
+  transformFootprint(pose.x, pose.y, pose.theta, footprint_spec, footprint);
+  return footprintCost(footprint);
+}
+
+double CollisionChecker::rasterCost(
+  unsigned int cell_x, unsigned int cell_y, double theta,
+  const Footprint & footprint_spec)
+{
+  masks_.setFootprint(footprint_spec, costmap_->getResolution());
+  const std::vector<std::pair<int, int>> & outline = masks_.outline(theta);
+
+  // a footprint whose circumscribed circle is on the grid needs no bounds checks
+  int size_x = costmap_->getSizeInCellsX();
+  int size_y = costmap_->getSizeInCellsY();
+  int x = cell_x, y = cell_y;
+  int radius = masks_.radius();
+  bool on_grid = x >= radius && y >= radius && x + radius < size_x && y + radius < size_y;
+
+  double footprint_cost = 0.0;
+  for (const auto & offset : outline) {
+    int mx = x + offset.first, my = y + offset.second;
+    if (!on_grid && (mx < 0 || my < 0 || mx >= size_x || my >= size_y)) {
+      RCLCPP_DEBUG(rclcpp::get_logger(name_), "Map Cell: [%d, %d]", mx, my);
+      throw IllegalPoseException(name_, "Footprint Goes Off Grid.");
+    }
+    footprint_cost = std::max(pointCost(mx, my), footprint_cost);
+  }
+  return footprint_cost;
+}
 
-  return footprintCost(getFootprint(pose));
+bool CollisionChecker::footprintOnGrid(
+  unsigned int cell_x, unsigned int cell_y,
+  const Footprint & footprint_spec) const
+{
+  // a footprint off the grid has to be walked to report it as such
+  double min_dist, max_dist;
+  calculateMinAndMaxDistances(footprint_spec, min_dist, max_dist);
+  unsigned int radius = costmap_->cellDistance(max_dist);
+  return cell_x >= radius && cell_y >= radius &&
+         cell_x + radius < costmap_->getSizeInCellsX() &&
+         cell_y + radius < costmap_->getSizeInCellsY();
 }
 
 void CollisionChecker::worldToMap(double wx, double wy, unsigned int & mx, unsigned int & my)
@@ -94,6 +221,14 @@ void CollisionChecker::worldToMap(double wx, double wy, unsigned int & mx, unsig
 }
 
 Footprint CollisionChecker::getFootprint(const geometry_msgs::msg::Pose2D & pose)
+{
+  Footprint footprint;
+  transformFootprint(pose.x, pose.y, pose.theta, getFootprintSpec(), footprint);
+
+  return footprint;
+}
+
+Footprint CollisionChecker::getFootprintSpec()
 {
   Footprint footprint;
   if (!footprint_sub_.getFootprint(footprint)) {
@@ -102,37 +237,30 @@ Footprint CollisionChecker::getFootprint(const geometry_msgs::msg::Pose2D & pose
 
   Footprint footprint_spec;
   unorientFootprint(footprint, footprint_spec);
-  transformFootprint(pose.x, pose.y, pose.theta, footprint_spec, footprint);
-
-  return footprint;
+  return footprint_spec;
 }
 
 double CollisionChecker::footprintCost(const Footprint footprint)
 {
-  // now we really have to lay down the footprint in the costmap_ grid
-  unsigned int x0, x1, y0, y1;
+  // now we really have to lay down the footprint in the costmap_ grid, with the cells of
+  // all of its points found at once
+  BatchCells & cells = footprint_cells_;
+  batchToMap(footprint, cells);
+  for (size_t i = 0; i < footprint.size(); ++i) {
+    if (!cells.valid[i]) {
+      RCLCPP_DEBUG(rclcpp::get_logger(name_), "Map Cell: [%d, %d]", cells.mx[i], cells.my[i]);
+      throw IllegalPoseException(name_, "Footprint Goes Off Grid.");
+    }
+  }
   double footprint_cost = 0.0;
 
-  // we need to rasterize each line in the footprint
-  for (unsigned int i = 0; i < footprint.size() - 1; ++i) {
-    // get the cell coord of the first point
-    worldToMap(footprint[i].x, footprint[i].y, x0, y0);
-
-    // get the cell coord of the second point
-    worldToMap(footprint[i + 1].x, footprint[i + 1].y, x1, y1);
-
-    footprint_cost = std::max(lineCost(x0, x1, y0, y1), footprint_cost);
+  // we need to rasterize each line in the footprint, and connect the last point to the first
+  for (size_t i = 0; i < footprint.size(); ++i) {
+    const size_t next = i + 1 < footprint.size() ? i + 1 : 0;
+    footprint_cost = std::max(lineCost(cells.mx[i], cells.mx[next], cells.my[i],
+        cells.my[next]), footprint_cost);
   }
 
-  // we also need to connect the first point in the footprint to the last point
-  // get the cell coord of the last point
-  worldToMap(footprint.back().x, footprint.back().y, x0, y0);
-
-  // get the cell coord of the first point
-  worldToMap(footprint.front().x, footprint.front().y, x1, y1);
-
-  footprint_cost = std::max(lineCost(x0, x1, y0, y1), footprint_cost);
-
   // if all line costs are legal... then we can return that the footprint is legal
   return footprint_cost;
 }
@@ -140,15 +268,10 @@ double CollisionChecker::footprintCost(const Footprint footprint)
 double CollisionChecker::lineCost(int x0, int x1, int y0, int y1) const
 {
   double line_cost = 0.0;
-  double point_cost = -1.0;
 
-  for (nav2_util::LineIterator line(x0, y0, x1, y1); line.isValid(); line.advance()) {
-    point_cost = pointCost(line.getX(), line.getY());   // Score the current point
-
-    if (line_cost < point_cost) {
-      line_cost = point_cost;
-    }
-  }
+  nav2_util::traceCells(x0, y0, x1, y1, [&](int x, int y) {
+      line_cost = std::max(line_cost, pointCost(x, y));   // Score the current point
+    });
 
   return line_cost;
 }
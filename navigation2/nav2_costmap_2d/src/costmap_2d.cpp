@@ -38,10 +38,14 @@
 #include "nav2_costmap_2d/costmap_2d.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "nav2_util/grid_memory.hpp"
+
 namespace nav2_costmap_2d
 {
 Costmap2D::Costmap2D(
@@ -61,15 +65,16 @@ void Costmap2D::deleteMaps()
 {
   // clean up data
   std::unique_lock<mutex_t> lock(*access_);
-  delete[] costmap_;
+  nav2_util::free_grid(costmap_);
   costmap_ = NULL;
 }
 
 void Costmap2D::initMaps(unsigned int size_x, unsigned int size_y)
 {
   std::unique_lock<mutex_t> lock(*access_);
-  delete[] costmap_;
-  costmap_ = new unsigned char[size_x * size_y];
+  nav2_util::free_grid(costmap_);
+  costmap_ = NULL;
+  costmap_ = nav2_util::allocate_grid_of<unsigned char>(static_cast<size_t>(size_x) * size_y);
 }
 
 void Costmap2D::resizeMap(
@@ -88,6 +93,50 @@ void Costmap2D::resizeMap(
   resetMaps();
 }
 
+bool Costmap2D::resizeMapKeepingCosts(
+  unsigned int size_x, unsigned int size_y, double resolution,
+  double origin_x, double origin_y)
+{
+  int offset_x, offset_y;
+  if (costmap_ == NULL || !alignedOffset(resolution, origin_x, origin_y, offset_x, offset_y)) {
+    resizeMap(size_x, size_y, resolution, origin_x, origin_y);
+    return false;
+  }
+
+  std::unique_lock<mutex_t> lock(*access_);
+  if (size_x != size_x_ || size_y != size_y_ || offset_x != 0 || offset_y != 0) {
+    unsigned char * costs =
+      nav2_util::allocate_grid_of<unsigned char>(static_cast<size_t>(size_x) * size_y);
+    memset(costs, default_value_, static_cast<size_t>(size_x) * size_y * sizeof(unsigned char));
+    copyOverlap(costmap_, size_x_, size_y_, costs, size_x, size_y, offset_x, offset_y);
+    nav2_util::free_grid(costmap_);
+    costmap_ = costs;
+  }
+
+  size_x_ = size_x;
+  size_y_ = size_y;
+  resolution_ = resolution;
+  origin_x_ = origin_x;
+  origin_y_ = origin_y;
+  return true;
+}
+
+bool Costmap2D::alignedOffset(
+  double resolution, double origin_x, double origin_y, int & offset_x,
+  int & offset_y) const
+{
+  // a thousandth of a cell covers the rounding of origins read from map files
+  const double tolerance = 1e-3;
+  if (resolution_ <= 0.0 || std::abs(resolution - resolution_) > tolerance * resolution_) {
+    return false;
+  }
+  double cells_x = (origin_x - origin_x_) / resolution_;
+  double cells_y = (origin_y - origin_y_) / resolution_;
+  offset_x = static_cast<int>(std::lround(cells_x));
+  offset_y = static_cast<int>(std::lround(cells_y));
+  return std::abs(cells_x - offset_x) < tolerance && std::abs(cells_y - offset_y) < tolerance;
+}
+
 void Costmap2D::resetMaps()
 {
   std::unique_lock<mutex_t> lock(*access_);
@@ -109,6 +158,98 @@ void Costmap2D::resetMapToValue(
   }
 }
 
+void Costmap2D::resetMapOutside(int x0, int y0, int xn, int yn, unsigned char value)
+{
+  std::unique_lock<mutex_t> lock(*(access_));
+  int sx = size_x_, sy = size_y_;
+  x0 = std::min(std::max(x0, 0), sx);
+  xn = std::min(std::max(xn, x0), sx);
+  y0 = std::min(std::max(y0, 0), sy);
+  yn = std::min(std::max(yn, y0), sy);
+
+  // the rows above and below the window are contiguous
+  memset(costmap_, value, y0 * size_x_ * sizeof(unsigned char));
+  memset(costmap_ + yn * size_x_, value, (sy - yn) * size_x_ * sizeof(unsigned char));
+  for (int y = y0; y < yn; ++y) {
+    unsigned char * row = costmap_ + y * size_x_;
+    memset(row, value, x0 * sizeof(unsigned char));
+    memset(row + xn, value, (sx - xn) * sizeof(unsigned char));
+  }
+}
+
+void Costmap2D::polygonSpans(
+  const std::vector<geometry_msgs::msg::Point> & polygon,
+  std::vector<FootprintSpan> & spans) const
+{
+  spans.clear();
+  if (polygon.size() < 3) {
+    return;
+  }
+
+  double min_y = polygon[0].y, max_y = polygon[0].y;
+  for (const auto & point : polygon) {
+    min_y = std::min(min_y, point.y);
+    max_y = std::max(max_y, point.y);
+  }
+  int first_row = std::max(0, static_cast<int>(std::floor((min_y - origin_y_) / resolution_)));
+  int last_row = std::min(static_cast<int>(size_y_) - 1,
+      static_cast<int>(std::floor((max_y - origin_y_) / resolution_)));
+
+  // fill between pairs of edge crossings along the row through the cell centers, so the
+  // polygon may be concave; each edge adds its crossings to only the rows it spans, so that a
+  // polygon of many edges, such as the fan of a laser scan, costs its edges plus its crossings
+  std::vector<std::pair<int, double>> crossings;
+  for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+    const auto & a = polygon[i];
+    const auto & b = polygon[j];
+    if (a.y == b.y) {
+      continue;
+    }
+    // the rows whose center lies in [low, high) of the edge, give or take one for rounding,
+    // which the test on the row center then settles
+    double low = std::min(a.y, b.y), high = std::max(a.y, b.y);
+    int begin_row = std::max(first_row,
+        static_cast<int>(std::ceil((low - origin_y_) / resolution_ - 0.5)) - 1);
+    int end_row = std::min(last_row,
+        static_cast<int>(std::ceil((high - origin_y_) / resolution_ - 0.5)));
+    for (int my = begin_row; my <= end_row; ++my) {
+      double wy = origin_y_ + (my + 0.5) * resolution_;
+      if ((a.y <= wy) != (b.y <= wy)) {
+        crossings.emplace_back(my, a.x + (wy - a.y) * (b.x - a.x) / (b.y - a.y));
+      }
+    }
+  }
+  std::sort(crossings.begin(), crossings.end());
+
+  for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+    int my = crossings[i].first;
+    int min_x = static_cast<int>(std::ceil((crossings[i].second - origin_x_) / resolution_ - 0.5));
+    int max_x =
+      static_cast<int>(std::ceil((crossings[i + 1].second - origin_x_) / resolution_ - 0.5)) - 1;
+    min_x = std::max(min_x, 0);
+    max_x = std::min(max_x, static_cast<int>(size_x_) - 1);
+    if (min_x <= max_x) {
+      spans.push_back({my, min_x, max_x});
+    }
+  }
+}
+
+void Costmap2D::setSpansToValue(
+  const std::vector<FootprintSpan> & spans, unsigned char value, int dx, int dy)
+{
+  int sx = size_x_, sy = size_y_;
+  for (const auto & span : spans) {
+    int y = span.y + dy;
+    int min_x = std::max(span.min_x + dx, 0);
+    int max_x = std::min(span.max_x + dx, sx - 1);
+    if (y < 0 || y >= sy || min_x > max_x) {
+      continue;
+    }
+    unsigned char * row = costmap_ + getIndex(0, y);
+    std::fill(row + min_x, row + max_x + 1, value);
+  }
+}
+
 bool Costmap2D::copyCostmapWindow(
   const Costmap2D & map, double win_origin_x, double win_origin_y,
   double win_size_x,
@@ -156,18 +297,22 @@ Costmap2D & Costmap2D::operator=(const Costmap2D & map)
     return *this;
   }
 
-  // clean up old data
-  deleteMaps();
+  // reallocate only if the size changes, as snapshots copy the map every update
+  if (costmap_ == NULL || size_x_ != map.size_x_ || size_y_ != map.size_y_) {
+    // clean up old data
+    deleteMaps();
+
+    size_x_ = map.size_x_;
+    size_y_ = map.size_y_;
+
+    // initialize our various maps
+    initMaps(size_x_, size_y_);
+  }
 
-  size_x_ = map.size_x_;
-  size_y_ = map.size_y_;
   resolution_ = map.resolution_;
   origin_x_ = map.origin_x_;
   origin_y_ = map.origin_y_;
 
-  // initialize our various maps
-  initMaps(size_x_, size_y_);
-
   // copy the cost map
   memcpy(costmap_, map.costmap_, size_x_ * size_y_ * sizeof(unsigned char));
 
@@ -237,6 +382,38 @@ bool Costmap2D::worldToMap(double wx, double wy, unsigned int & mx, unsigned int
   return false;
 }
 
+size_t Costmap2D::worldToMapBatch(
+  const double * wx, const double * wy, size_t count,
+  unsigned int * mx, unsigned int * my, unsigned char * valid) const
+{
+  const double origin_x = origin_x_, origin_y = origin_y_, resolution = resolution_;
+  const double size_x = size_x_, size_y = size_y_;
+  size_t on_map = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const double dx = (wx[i] - origin_x) / resolution;
+    const double dy = (wy[i] - origin_y) / resolution;
+    // & rather than &&, to leave no branches; NaNs fail every comparison
+    const bool inside = (wx[i] >= origin_x) & (wy[i] >= origin_y) & (dx < size_x) &
+      (dy < size_y);
+    mx[i] = static_cast<int>(inside ? dx : 0.0);
+    my[i] = static_cast<int>(inside ? dy : 0.0);
+    valid[i] = inside;
+    on_map += inside;
+  }
+  return on_map;
+}
+
+void Costmap2D::mapToWorldBatch(
+  const unsigned int * mx, const unsigned int * my, size_t count,
+  double * wx, double * wy) const
+{
+  const double origin_x = origin_x_, origin_y = origin_y_, resolution = resolution_;
+  for (size_t i = 0; i < count; ++i) {
+    wx[i] = origin_x + (mx[i] + 0.5) * resolution;
+    wy[i] = origin_y + (my[i] + 0.5) * resolution;
+  }
+}
+
 void Costmap2D::worldToMapNoBounds(double wx, double wy, int & mx, int & my) const
 {
   mx = static_cast<int>((wx - origin_x_) / resolution_);
@@ -278,45 +455,16 @@ void Costmap2D::updateOrigin(double new_origin_x, double new_origin_y)
   new_grid_ox = origin_x_ + cell_ox * resolution_;
   new_grid_oy = origin_y_ + cell_oy * resolution_;
 
-  // To save casting from unsigned int to int a bunch of times
-  int size_x = size_x_;
-  int size_y = size_y_;
-
-  // we need to compute the overlap of the new and existing windows
-  int lower_left_x, lower_left_y, upper_right_x, upper_right_y;
-  lower_left_x = std::min(std::max(cell_ox, 0), size_x);
-  lower_left_y = std::min(std::max(cell_oy, 0), size_y);
-  upper_right_x = std::min(std::max(cell_ox + size_x, 0), size_x);
-  upper_right_y = std::min(std::max(cell_oy + size_y, 0), size_y);
-
-  unsigned int cell_size_x = upper_right_x - lower_left_x;
-  unsigned int cell_size_y = upper_right_y - lower_left_y;
-
-  // we need a map to store the obstacles in the window temporarily
-  unsigned char * local_map = new unsigned char[cell_size_x * cell_size_y];
-
-  // copy the local window in the costmap to the local map
-  copyMapRegion(costmap_, lower_left_x, lower_left_y, size_x_, local_map, 0, 0, cell_size_x,
-    cell_size_x,
-    cell_size_y);
-
-  // now we'll set the costmap to be completely unknown if we track unknown space
-  resetMaps();
+  // shift the overlapping window into its new location in place, so only the
+  // strips that moved into view need to be reset
+  {
+    std::unique_lock<mutex_t> lock(*access_);
+    shiftMapRegion(costmap_, size_x_, size_y_, cell_ox, cell_oy, default_value_);
+  }
 
   // update the origin with the appropriate world coordinates
   origin_x_ = new_grid_ox;
   origin_y_ = new_grid_oy;
-
-  // compute the starting cell location for copying data back in
-  int start_x = lower_left_x - cell_ox;
-  int start_y = lower_left_y - cell_oy;
-
-  // now we want to copy the overlapping information back into the map, but in its new location
-  copyMapRegion(local_map, 0, 0, cell_size_x, costmap_, start_x, start_y, size_x_, cell_size_x,
-    cell_size_y);
-
-  // make sure to clean up
-  delete[] local_map;
 }
 
 bool Costmap2D::setConvexPolygonCost(
@@ -348,6 +496,31 @@ bool Costmap2D::setConvexPolygonCost(
   return true;
 }
 
+bool Costmap2D::setFootprintCost(
+  double wx, double wy, double theta, FootprintMasks & masks,
+  unsigned char cost_value)
+{
+  unsigned int cell_x, cell_y;
+  if (!worldToMap(wx, wy, cell_x, cell_y)) {
+    return false;
+  }
+
+  const std::vector<FootprintSpan> & spans = masks.fill(theta);
+  int x = cell_x, y = cell_y;
+  int sx = size_x_, sy = size_y_;
+  for (const auto & span : spans) {
+    if (x + span.min_x < 0 || x + span.max_x >= sx || y + span.y < 0 || y + span.y >= sy) {
+      return false;
+    }
+  }
+
+  for (const auto & span : spans) {
+    unsigned char * row = costmap_ + getIndex(0, y + span.y);
+    std::fill(row + x + span.min_x, row + x + span.max_x + 1, cost_value);
+  }
+  return true;
+}
+
 void Costmap2D::polygonOutlineCells(
   const std::vector<MapLocation> & polygon,
   std::vector<MapLocation> & polygon_cells)
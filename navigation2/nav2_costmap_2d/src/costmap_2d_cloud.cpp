@@ -25,6 +25,10 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -33,44 +37,52 @@
 #include "sensor_msgs/msg/channel_float32.hpp"
 #include "nav2_voxel_grid/voxel_grid.hpp"
 #include "nav2_msgs/msg/voxel_grid.hpp"
+#include "nav2_costmap_2d/voxel_cells.hpp"
 #include "nav2_util/execution_timer.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 
-static inline void mapToWorld3D(
-  const unsigned int mx,
-  const unsigned int my, const unsigned int mz,
-  const double origin_x, const double origin_y, const double origin_z,
-  const double x_resolution, const double y_resolution,
-  const double z_resolution,
-  double & wx, double & wy, double & wz)
-{
-  // returns the center point of the cell
-  wx = origin_x + (mx + 0.5) * x_resolution;
-  wy = origin_y + (my + 0.5) * y_resolution;
-  wz = origin_z + (mz + 0.5) * z_resolution;
-}
-
-struct Cell
-{
-  double x;
-  double y;
-  double z;
-  nav2_voxel_grid::VoxelStatus status;
-};
-typedef std::vector<Cell> V_Cell;
-
 float g_colors_r[] = {0.0f, 0.0f, 1.0f};
 float g_colors_g[] = {0.0f, 0.0f, 0.0f};
 float g_colors_b[] = {0.0f, 1.0f, 0.0f};
 float g_colors_a[] = {0.0f, 0.5f, 1.0f};
 
-V_Cell g_marked;
-V_Cell g_unknown;
-
 nav2_util::LifecycleNode::SharedPtr g_node;
+std::unique_ptr<nav2_costmap_2d::VoxelCellCollector> g_collector;
+
+// The clouds are kept between grids, so their buffers are only grown, never reallocated
+sensor_msgs::msg::PointCloud g_marked_cloud;
+sensor_msgs::msg::PointCloud g_unknown_cloud;
 
 rclcpp::Publisher<sensor_msgs::msg::PointCloud>::SharedPtr pub_marked;
 rclcpp::Publisher<sensor_msgs::msg::PointCloud>::SharedPtr pub_unknown;
+rclcpp::Subscription<nav2_msgs::msg::VoxelGrid>::SharedPtr g_voxel_sub;
+
+void fillCloud(
+  const std::vector<nav2_costmap_2d::VoxelCell> & cells,
+  nav2_voxel_grid::VoxelStatus status, const std_msgs::msg::Header & header,
+  sensor_msgs::msg::PointCloud & cloud)
+{
+  cloud.header = header;
+  cloud.points.resize(cells.size());
+  cloud.channels.resize(1);
+  cloud.channels[0].name = "rgb";
+  cloud.channels[0].values.resize(cells.size());
+
+  uint32_t r = g_colors_r[status] * 255.0;
+  uint32_t g = g_colors_g[status] * 255.0;
+  uint32_t b = g_colors_b[status] * 255.0;
+  uint32_t col = (r << 16) | (g << 8) | b;
+  float cval;
+  memcpy(&cval, &col, sizeof col);
+
+  for (size_t i = 0; i < cells.size(); ++i) {
+    geometry_msgs::msg::Point32 & p = cloud.points[i];
+    p.x = cells[i].x;
+    p.y = cells[i].y;
+    p.z = cells[i].z;
+  }
+  std::fill(cloud.channels[0].values.begin(), cloud.channels[0].values.end(), cval);
+}
 
 void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
 {
@@ -79,121 +91,46 @@ void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
     return;
   }
 
+  // only the clouds something is looking at are made
+  const bool marked = pub_marked->get_subscription_count() > 0;
+  const bool unknown = pub_unknown->get_subscription_count() > 0;
+  if (!marked && !unknown) {
+    return;
+  }
+
   nav2_util::ExecutionTimer timer;
   timer.start();
 
   RCLCPP_DEBUG(g_node->get_logger(), "Received voxel grid");
-  const std::string frame_id = grid->header.frame_id;
-  const rclcpp::Time stamp = grid->header.stamp;
-  const uint32_t * data = &grid->data.front();
-  const double x_origin = grid->origin.x;
-  const double y_origin = grid->origin.y;
-  const double z_origin = grid->origin.z;
-  const double x_res = grid->resolutions.x;
-  const double y_res = grid->resolutions.y;
-  const double z_res = grid->resolutions.z;
-  const uint32_t x_size = grid->size_x;
-  const uint32_t y_size = grid->size_y;
-  const uint32_t z_size = grid->size_z;
-
-  g_marked.clear();
-  g_unknown.clear();
-  uint32_t num_marked = 0;
-  uint32_t num_unknown = 0;
-  for (uint32_t y_grid = 0; y_grid < y_size; ++y_grid) {
-    for (uint32_t x_grid = 0; x_grid < x_size; ++x_grid) {
-      for (uint32_t z_grid = 0; z_grid < z_size; ++z_grid) {
-        nav2_voxel_grid::VoxelStatus status =
-          nav2_voxel_grid::VoxelGrid::getVoxel(x_grid, y_grid,
-            z_grid, x_size, y_size, z_size, data);
-        if (status == nav2_voxel_grid::UNKNOWN) {
-          Cell c;
-          c.status = status;
-          mapToWorld3D(x_grid, y_grid, z_grid, x_origin, y_origin,
-            z_origin, x_res, y_res, z_res, c.x, c.y, c.z);
-
-          g_unknown.push_back(c);
-
-          ++num_unknown;
-        } else if (status == nav2_voxel_grid::MARKED) {
-          Cell c;
-          c.status = status;
-          mapToWorld3D(x_grid, y_grid, z_grid, x_origin, y_origin,
-            z_origin, x_res, y_res, z_res, c.x, c.y, c.z);
-
-          g_marked.push_back(c);
-
-          ++num_marked;
-        }
-      }
-    }
-  }
+  g_collector->collect(*grid, unknown);
 
-  {
-    sensor_msgs::msg::PointCloud cloud;
-    cloud.points.resize(num_marked);
-    cloud.channels.resize(1);
-    cloud.channels[0].values.resize(num_marked);
-    cloud.channels[0].name = "rgb";
-    cloud.header.frame_id = frame_id;
-    cloud.header.stamp = stamp;
-
-    sensor_msgs::msg::ChannelFloat32 & chan = cloud.channels[0];
-    for (uint32_t i = 0; i < num_marked; ++i) {
-      geometry_msgs::msg::Point32 & p = cloud.points[i];
-      float & cval = chan.values[i];
-      Cell & c = g_marked[i];
-
-      p.x = c.x;
-      p.y = c.y;
-      p.z = c.z;
-
-      uint32_t r = g_colors_r[c.status] * 255.0;
-      uint32_t g = g_colors_g[c.status] * 255.0;
-      uint32_t b = g_colors_b[c.status] * 255.0;
-      // uint32_t a = g_colors_a[c.status] * 255.0;
-
-      uint32_t col = (r << 16) | (g << 8) | b;
-      memcpy(&cval, &col, sizeof col);
-    }
-
-    pub_marked->publish(cloud);
+  if (marked) {
+    fillCloud(g_collector->marked(), nav2_voxel_grid::MARKED, grid->header, g_marked_cloud);
+    pub_marked->publish(g_marked_cloud);
   }
-
-  {
-    sensor_msgs::msg::PointCloud cloud;
-    cloud.points.resize(num_unknown);
-    cloud.channels.resize(1);
-    cloud.channels[0].values.resize(num_unknown);
-    cloud.channels[0].name = "rgb";
-    cloud.header.frame_id = frame_id;
-    cloud.header.stamp = stamp;
-
-    sensor_msgs::msg::ChannelFloat32 & chan = cloud.channels[0];
-    for (uint32_t i = 0; i < num_unknown; ++i) {
-      geometry_msgs::msg::Point32 & p = cloud.points[i];
-      float & cval = chan.values[i];
-      Cell & c = g_unknown[i];
-
-      p.x = c.x;
-      p.y = c.y;
-      p.z = c.z;
-
-      uint32_t r = g_colors_r[c.status] * 255.0;
-      uint32_t g = g_colors_g[c.status] * 255.0;
-      uint32_t b = g_colors_b[c.status] * 255.0;
-      // uint32_t a = g_colors_a[c.status] * 255.0;
-
-      uint32_t col = (r << 16) | (g << 8) | b;
-      memcpy(&cval, &col, sizeof col);
-    }
-
-    pub_unknown->publish(cloud);
+  if (unknown) {
+    fillCloud(g_collector->unknown(), nav2_voxel_grid::UNKNOWN, grid->header, g_unknown_cloud);
+    pub_unknown->publish(g_unknown_cloud);
   }
 
   timer.end();
-  RCLCPP_DEBUG(g_node->get_logger(), "Published %d points in %f seconds",
-    num_marked + num_unknown, timer.elapsed_time_in_seconds());
+  RCLCPP_DEBUG(g_node->get_logger(), "Published %zu points in %f seconds",
+    g_collector->marked().size() + g_collector->unknown().size(),
+    timer.elapsed_time_in_seconds());
+}
+
+// Subscribe to the voxel grid only while the clouds have subscribers, so the voxel layer
+// isn't asked for grids that nobody looks at
+void updateSubscription()
+{
+  const bool wanted = pub_marked->get_subscription_count() > 0 ||
+    pub_unknown->get_subscription_count() > 0;
+  if (wanted && !g_voxel_sub) {
+    g_voxel_sub = g_node->create_subscription<nav2_msgs::msg::VoxelGrid>(
+      "voxel_grid", rclcpp::SystemDefaultsQoS(), voxelCallback);
+  } else if (!wanted && g_voxel_sub) {
+    g_voxel_sub.reset();
+  }
 }
 
 int main(int argc, char ** argv)
@@ -203,12 +140,19 @@ int main(int argc, char ** argv)
 
   RCLCPP_DEBUG(g_node->get_logger(), "Starting up costmap_2d_cloud");
 
+  // Each point can stand for a cube of this many voxels a side, to send fewer of them
+  g_node->declare_parameter("downsample", rclcpp::ParameterValue(1));
+  int downsample = 1;
+  g_node->get_parameter("downsample", downsample);
+  g_collector = std::make_unique<nav2_costmap_2d::VoxelCellCollector>(
+    static_cast<unsigned int>(std::max(downsample, 1)));
+
   pub_marked = g_node->create_publisher<sensor_msgs::msg::PointCloud>(
     "voxel_marked_cloud", 1);
   pub_unknown = g_node->create_publisher<sensor_msgs::msg::PointCloud>(
     "voxel_unknown_cloud", 1);
-  auto sub = g_node->create_subscription<nav2_msgs::msg::VoxelGrid>(
-    "voxel_grid", rclcpp::SystemDefaultsQoS(), voxelCallback);
+  auto subscription_timer = g_node->create_wall_timer(std::chrono::seconds(1),
+      updateSubscription);
 
   rclcpp::spin(g_node->get_node_base_interface());
   rclcpp::shutdown();
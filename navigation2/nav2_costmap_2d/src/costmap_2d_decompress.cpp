@@ -0,0 +1,62 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Republishes a compressed costmap as a plain OccupancyGrid, so that RViz on
+// the far side of a slow link can display it
+
+#include <memory>
+
+#include "rclcpp/rclcpp.hpp"
+#include "nav_msgs/msg/occupancy_grid.hpp"
+#include "nav2_msgs/msg/compressed_costmap.hpp"
+#include "nav2_costmap_2d/costmap_compression.hpp"
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+  auto node = rclcpp::Node::make_shared("costmap_2d_decompress");
+
+  auto qos = rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable();
+  auto pub = node->create_publisher<nav_msgs::msg::OccupancyGrid>("costmap", qos);
+
+  nav_msgs::msg::OccupancyGrid grid;
+  auto sub = node->create_subscription<nav2_msgs::msg::CompressedCostmap>(
+    "costmap_compressed", qos,
+    [&](const nav2_msgs::msg::CompressedCostmap::SharedPtr msg) {
+      if (msg->encoding != "rle" || !msg->occupancy) {
+        RCLCPP_WARN(node->get_logger(), "Expected rle encoded occupancy values, got %s %s",
+          msg->encoding.c_str(), msg->occupancy ? "occupancy" : "costs");
+        return;
+      }
+
+      grid.header = msg->header;
+      grid.info.resolution = msg->metadata.resolution;
+      grid.info.width = msg->metadata.size_x;
+      grid.info.height = msg->metadata.size_y;
+      grid.info.origin = msg->metadata.origin;
+      grid.data.resize(grid.info.width * grid.info.height);
+      if (!nav2_costmap_2d::decodeRunLength(msg->data,
+        reinterpret_cast<unsigned char *>(grid.data.data()), grid.data.size()))
+      {
+        RCLCPP_WARN(node->get_logger(), "Malformed compressed costmap");
+        return;
+      }
+      pub->publish(grid);
+    });
+
+  rclcpp::spin(node);
+  rclcpp::shutdown();
+
+  return 0;
+}
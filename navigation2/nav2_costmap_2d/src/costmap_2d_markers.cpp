@@ -36,6 +36,9 @@
  *         David V. Lu!!
  *         Steve Macenski
  *********************************************************************/
+#include <algorithm>
+#include <chrono>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -43,102 +46,80 @@
 #include "visualization_msgs/msg/marker.hpp"
 #include "nav2_msgs/msg/voxel_grid.hpp"
 #include "nav2_voxel_grid/voxel_grid.hpp"
+#include "nav2_costmap_2d/voxel_cells.hpp"
 #include "nav2_util/execution_timer.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 
-struct Cell
-{
-  double x;
-  double y;
-  double z;
-  nav2_voxel_grid::VoxelStatus status;
-};
-typedef std::vector<Cell> V_Cell;
-
 float g_colors_r[] = {0.0f, 0.0f, 1.0f};
 float g_colors_g[] = {0.0f, 0.0f, 0.0f};
 float g_colors_b[] = {0.0f, 1.0f, 0.0f};
 float g_colors_a[] = {0.0f, 0.5f, 1.0f};
 
-V_Cell g_cells;
 nav2_util::LifecycleNode::SharedPtr g_node;
+std::unique_ptr<nav2_costmap_2d::VoxelCellCollector> g_collector;
+visualization_msgs::msg::Marker g_marker;  ///< Kept between grids to reuse its points' buffer
 rclcpp::Publisher<visualization_msgs::msg::Marker>::SharedPtr pub;
+rclcpp::Subscription<nav2_msgs::msg::VoxelGrid>::SharedPtr g_voxel_sub;
+
 void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
 {
   if (grid->data.empty()) {
     RCLCPP_ERROR(g_node->get_logger(), "Received voxel grid");
     return;
   }
+  if (pub->get_subscription_count() == 0) {
+    return;
+  }
 
   nav2_util::ExecutionTimer timer;
   timer.start();
 
   RCLCPP_DEBUG(g_node->get_logger(), "Received voxel grid");
 
-  const std::string frame_id = grid->header.frame_id;
-  const rclcpp::Time stamp = grid->header.stamp;
-  const uint32_t * data = &grid->data.front();
-  const double x_origin = grid->origin.x;
-  const double y_origin = grid->origin.y;
-  const double z_origin = grid->origin.z;
-  const double x_res = grid->resolutions.x;
-  const double y_res = grid->resolutions.y;
-  const double z_res = grid->resolutions.z;
-  const uint32_t x_size = grid->size_x;
-  const uint32_t y_size = grid->size_y;
-  const uint32_t z_size = grid->size_z;
-
-  g_cells.clear();
-  uint32_t num_markers = 0;
-  for (uint32_t y_grid = 0; y_grid < y_size; ++y_grid) {
-    for (uint32_t x_grid = 0; x_grid < x_size; ++x_grid) {
-      for (uint32_t z_grid = 0; z_grid < z_size; ++z_grid) {
-        nav2_voxel_grid::VoxelStatus status =
-          nav2_voxel_grid::VoxelGrid::getVoxel(x_grid, y_grid,
-            z_grid, x_size, y_size, z_size, data);
-        if (status == nav2_voxel_grid::MARKED) {
-          Cell c;
-          c.status = status;
-          c.x = x_origin + (x_grid + 0.5) * x_res;
-          c.y = y_origin + (y_grid + 0.5) * y_res;
-          c.z = z_origin + (z_grid + 0.5) * z_res;
-          g_cells.push_back(c);
-
-          ++num_markers;
-        }
-      }
-    }
-  }
+  g_collector->collect(*grid, false);
+  const std::vector<nav2_costmap_2d::VoxelCell> & cells = g_collector->marked();
+  const double downsample = g_collector->downsample();
 
-  visualization_msgs::msg::Marker m;
-  m.header.frame_id = frame_id;
-  m.header.stamp = stamp;
+  visualization_msgs::msg::Marker & m = g_marker;
+  m.header = grid->header;
   m.ns = g_node->get_namespace();
   m.id = 0;
   m.type = visualization_msgs::msg::Marker::CUBE_LIST;
   m.action = visualization_msgs::msg::Marker::ADD;
   m.pose.orientation.w = 1.0;
-  m.scale.x = x_res;
-  m.scale.y = y_res;
-  m.scale.z = z_res;
+  m.scale.x = grid->resolutions.x * downsample;
+  m.scale.y = grid->resolutions.y * downsample;
+  m.scale.z = grid->resolutions.z * downsample;
   m.color.r = g_colors_r[nav2_voxel_grid::MARKED];
   m.color.g = g_colors_g[nav2_voxel_grid::MARKED];
   m.color.b = g_colors_b[nav2_voxel_grid::MARKED];
   m.color.a = g_colors_a[nav2_voxel_grid::MARKED];
-  m.points.resize(num_markers);
-  for (uint32_t i = 0; i < num_markers; ++i) {
-    Cell & c = g_cells[i];
+  m.points.resize(cells.size());
+  for (size_t i = 0; i < cells.size(); ++i) {
     geometry_msgs::msg::Point & p = m.points[i];
-    p.x = c.x;
-    p.y = c.y;
-    p.z = c.z;
+    p.x = cells[i].x;
+    p.y = cells[i].y;
+    p.z = cells[i].z;
   }
 
   pub->publish(m);
 
   timer.end();
-  RCLCPP_INFO(g_node->get_logger(), "Published %d markers in %f seconds",
-    num_markers, timer.elapsed_time_in_seconds());
+  RCLCPP_INFO(g_node->get_logger(), "Published %zu markers in %f seconds",
+    cells.size(), timer.elapsed_time_in_seconds());
+}
+
+// Subscribe to the voxel grid only while the markers have subscribers, so the voxel layer
+// isn't asked for grids that nobody looks at
+void updateSubscription()
+{
+  const bool wanted = pub->get_subscription_count() > 0;
+  if (wanted && !g_voxel_sub) {
+    g_voxel_sub = g_node->create_subscription<nav2_msgs::msg::VoxelGrid>(
+      "voxel_grid", rclcpp::SystemDefaultsQoS(), voxelCallback);
+  } else if (!wanted && g_voxel_sub) {
+    g_voxel_sub.reset();
+  }
 }
 
 int main(int argc, char ** argv)
@@ -148,11 +129,17 @@ int main(int argc, char ** argv)
 
   RCLCPP_DEBUG(g_node->get_logger(), "Starting costmap_2d_marker");
 
+  // Each cube can stand for this many voxels a side, to send fewer of them
+  g_node->declare_parameter("downsample", rclcpp::ParameterValue(1));
+  int downsample = 1;
+  g_node->get_parameter("downsample", downsample);
+  g_collector = std::make_unique<nav2_costmap_2d::VoxelCellCollector>(
+    static_cast<unsigned int>(std::max(downsample, 1)));
+
   pub = g_node->create_publisher<visualization_msgs::msg::Marker>(
     "visualization_marker", 1);
-
-  auto sub = g_node->create_subscription<nav2_msgs::msg::VoxelGrid>(
-    "voxel_grid", rclcpp::SystemDefaultsQoS(), voxelCallback);
+  auto subscription_timer = g_node->create_wall_timer(std::chrono::seconds(1),
+      updateSubscription);
 
   rclcpp::spin(g_node->get_node_base_interface());
 }
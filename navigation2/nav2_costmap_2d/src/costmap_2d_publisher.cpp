@@ -37,9 +37,13 @@
  *********************************************************************/
 #include "nav2_costmap_2d/costmap_2d_publisher.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 
 #include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_compression.hpp"
+#include "nav2_util/black_box.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -56,13 +60,21 @@ Costmap2DPublisher::Costmap2DPublisher(
 {
   auto custom_qos = rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable();
 
-  // TODO(bpwilcox): port onNewSubscription functionality for publisher
   costmap_pub_ = node_->create_publisher<nav_msgs::msg::OccupancyGrid>(topic_name,
       custom_qos);
   costmap_raw_pub_ = node_->create_publisher<nav2_msgs::msg::Costmap>(topic_name + "_raw",
       custom_qos);
   costmap_update_pub_ = node_->create_publisher<map_msgs::msg::OccupancyGridUpdate>(
     topic_name + "_updates", custom_qos);
+  costmap_raw_update_pub_ = node_->create_publisher<nav2_msgs::msg::CostmapUpdate>(
+    topic_name + "_raw_updates", custom_qos);
+  costmap_compressed_pub_ = node_->create_publisher<nav2_msgs::msg::CompressedCostmap>(
+    topic_name + "_compressed", custom_qos);
+  costmap_raw_compressed_pub_ = node_->create_publisher<nav2_msgs::msg::CompressedCostmap>(
+    topic_name + "_raw_compressed", custom_qos);
+  black_box_channel_ = nav2_util::BlackBox::global().channel(
+    std::string(node_->get_name()) + "/" + topic_name + "_raw_updates",
+    "nav2_msgs/msg/CostmapUpdate");
 
   if (cost_translation_table_ == NULL) {
     cost_translation_table_ = new char[256];
@@ -87,113 +99,301 @@ Costmap2DPublisher::Costmap2DPublisher(
 
 Costmap2DPublisher::~Costmap2DPublisher() {}
 
-// TODO(bpwilcox): find equivalent/workaround to ros::SingleSubscriberPublishr
-/*
-void Costmap2DPublisher::onNewSubscription(const ros::SingleSubscriberPublisher& pub)
+template<typename T>
+void Costmap2DPublisher::translateCosts(const unsigned char * costs, size_t size, T * occupancy)
 {
-  prepareGrid();
-  pub.publish(grid_);
-} */
+  const char * table = cost_translation_table_;
+  for (size_t i = 0; i < size; ++i) {
+    occupancy[i] = static_cast<T>(table[costs[i]]);
+  }
+}
 
 // prepare grid_ message for publication.
-void Costmap2DPublisher::prepareGrid()
+void Costmap2DPublisher::prepareGrid(const Costmap2D & costmap)
 {
-  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
-  double resolution = costmap_->getResolution();
+  double resolution = costmap.getResolution();
 
   grid_.header.frame_id = global_frame_;
   grid_.header.stamp = rclcpp::Time();
 
   grid_.info.resolution = resolution;
 
-  grid_.info.width = costmap_->getSizeInCellsX();
-  grid_.info.height = costmap_->getSizeInCellsY();
+  grid_.info.width = costmap.getSizeInCellsX();
+  grid_.info.height = costmap.getSizeInCellsY();
 
   double wx, wy;
-  costmap_->mapToWorld(0, 0, wx, wy);
+  costmap.mapToWorld(0, 0, wx, wy);
   grid_.info.origin.position.x = wx - resolution / 2;
   grid_.info.origin.position.y = wy - resolution / 2;
   grid_.info.origin.position.z = 0.0;
   grid_.info.origin.orientation.w = 1.0;
-  saved_origin_x_ = costmap_->getOriginX();
-  saved_origin_y_ = costmap_->getOriginY();
+  saved_origin_x_ = costmap.getOriginX();
+  saved_origin_y_ = costmap.getOriginY();
 
   grid_.data.resize(grid_.info.width * grid_.info.height);
-
-  unsigned char * data = costmap_->getCharMap();
-  for (unsigned int i = 0; i < grid_.data.size(); i++) {
-    grid_.data[i] = cost_translation_table_[data[i]];
-  }
+  translateCosts(costmap.getCharMap(), grid_.data.size(), grid_.data.data());
 }
 
-void Costmap2DPublisher::prepareCostmap()
+void Costmap2DPublisher::prepareCostmap(const Costmap2D & costmap)
 {
-  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
-  double resolution = costmap_->getResolution();
-
   costmap_raw_.header.frame_id = global_frame_;
   costmap_raw_.header.stamp = node_->now();
 
-  costmap_raw_.metadata.layer = "master";
-  costmap_raw_.metadata.resolution = resolution;
+  prepareMetadata(costmap, costmap_raw_.metadata);
+
+  const unsigned char * data = costmap.getCharMap();
+  const size_t size = costmap_raw_.metadata.size_x * costmap_raw_.metadata.size_y;
+  costmap_raw_.data.assign(data, data + size);
+}
 
-  costmap_raw_.metadata.size_x = costmap_->getSizeInCellsX();
-  costmap_raw_.metadata.size_y = costmap_->getSizeInCellsY();
+void Costmap2DPublisher::prepareMetadata(
+  const Costmap2D & costmap,
+  nav2_msgs::msg::CostmapMetaData & metadata)
+{
+  double resolution = costmap.getResolution();
+
+  metadata.layer = layer_name_;
+  metadata.resolution = resolution;
+
+  metadata.size_x = costmap.getSizeInCellsX();
+  metadata.size_y = costmap.getSizeInCellsY();
 
   double wx, wy;
-  costmap_->mapToWorld(0, 0, wx, wy);
-  costmap_raw_.metadata.origin.position.x = wx - resolution / 2;
-  costmap_raw_.metadata.origin.position.y = wy - resolution / 2;
-  costmap_raw_.metadata.origin.position.z = 0.0;
-  costmap_raw_.metadata.origin.orientation.w = 1.0;
+  costmap.mapToWorld(0, 0, wx, wy);
+  metadata.origin.position.x = wx - resolution / 2;
+  metadata.origin.position.y = wy - resolution / 2;
+  metadata.origin.position.z = 0.0;
+  metadata.origin.orientation.w = 1.0;
+}
+
+void Costmap2DPublisher::prepareCostmapUpdate(const Costmap2D & costmap)
+{
+  nav2_msgs::msg::CostmapMetaData previous_metadata = costmap_raw_update_.metadata;
+  costmap_raw_update_.header.frame_id = global_frame_;
+  costmap_raw_update_.header.stamp = node_->now();
+  costmap_raw_update_.sequence = raw_update_sequence_++;
+  costmap_raw_update_.tile_size = raw_update_tile_size_;
+  prepareMetadata(costmap, costmap_raw_update_.metadata);
+  costmap_raw_update_.tiles.clear();
+  costmap_raw_update_.data.clear();
+
+  const nav2_msgs::msg::CostmapMetaData & metadata = costmap_raw_update_.metadata;
+  const unsigned int size_x = metadata.size_x;
+  const unsigned int size_y = metadata.size_y;
+  const unsigned char * data = costmap.getCharMap();
+
+  // the receivers' copy is only kept in step while the map keeps its geometry
+  costmap_raw_update_.keyframe = raw_updates_since_keyframe_ + 1 >= raw_keyframe_interval_ ||
+    raw_update_sent_.size() != size_x * size_y ||
+    previous_metadata.resolution != metadata.resolution ||
+    previous_metadata.origin.position.x != metadata.origin.position.x ||
+    previous_metadata.origin.position.y != metadata.origin.position.y;
 
-  costmap_raw_.data.resize(costmap_raw_.metadata.size_x * costmap_raw_.metadata.size_y);
+  if (costmap_raw_update_.keyframe) {
+    costmap_raw_update_.data.assign(data, data + size_x * size_y);
+    raw_update_sent_.assign(data, data + size_x * size_y);
+    raw_updates_since_keyframe_ = 0;
+    return;
+  }
+  ++raw_updates_since_keyframe_;
+
+  if (x0_ >= xn_ || y0_ >= yn_) {
+    return;
+  }
+
+  // only the tiles overlapping the update bounds can have changed, and of
+  // those only the ones that differ from what was last sent go out; a tile
+  // shared by two regions is unchanged by the time the second one gets to it
+  const unsigned int tile = raw_update_tile_size_;
+  const unsigned int tiles_x = (size_x + tile - 1) / tile;
+  for (const MapRegion & region : dirty_regions_.get()) {
+    const unsigned int last_x = std::min<unsigned int>(region.xn, size_x);
+    const unsigned int last_y = std::min<unsigned int>(region.yn, size_y);
+    for (unsigned int ty = region.y0 / tile; ty * tile < last_y; ++ty) {
+      for (unsigned int tx = region.x0 / tile; tx * tile < last_x; ++tx) {
+        unsigned int cx0 = tx * tile, cy0 = ty * tile;
+        unsigned int width = std::min(tile, size_x - cx0);
+        unsigned int height = std::min(tile, size_y - cy0);
+
+        bool changed = false;
+        for (unsigned int y = cy0; y < cy0 + height && !changed; ++y) {
+          unsigned int index = y * size_x + cx0;
+          changed = !std::equal(data + index, data + index + width,
+              raw_update_sent_.begin() + index);
+        }
+        if (!changed) {
+          continue;
+        }
+
+        costmap_raw_update_.tiles.push_back(ty * tiles_x + tx);
+        for (unsigned int y = cy0; y < cy0 + height; ++y) {
+          unsigned int index = y * size_x + cx0;
+          costmap_raw_update_.data.insert(costmap_raw_update_.data.end(),
+            data + index, data + index + width);
+          std::copy(data + index, data + index + width, raw_update_sent_.begin() + index);
+        }
+      }
+    }
+  }
+}
+
+void Costmap2DPublisher::prepareCompressed(const Costmap2D & costmap)
+{
+  costmap_raw_compressed_.header.frame_id = global_frame_;
+  costmap_raw_compressed_.header.stamp = node_->now();
+  prepareMetadata(costmap, costmap_raw_compressed_.metadata);
+  costmap_raw_compressed_.encoding = "rle";
+  costmap_raw_compressed_.occupancy = false;
+
+  const size_t size = costmap.getSizeInCellsX() * costmap.getSizeInCellsY();
+  const unsigned char * data = costmap.getCharMap();
+  encodeRunLength(data, size, costmap_raw_compressed_.data);
+
+  occupancy_scratch_.resize(size);
+  translateCosts(data, size, occupancy_scratch_.data());
+  costmap_compressed_.header = costmap_raw_compressed_.header;
+  costmap_compressed_.metadata = costmap_raw_compressed_.metadata;
+  costmap_compressed_.encoding = "rle";
+  costmap_compressed_.occupancy = true;
+  encodeRunLength(occupancy_scratch_.data(), size, costmap_compressed_.data);
+}
 
-  unsigned char * data = costmap_->getCharMap();
-  for (unsigned int i = 0; i < costmap_raw_.data.size(); i++) {
-    costmap_raw_.data[i] = data[i];
+bool Costmap2DPublisher::isDue(
+  LazyStream & stream, size_t subscribers,
+  std::chrono::steady_clock::time_point now)
+{
+  // a new subscriber, e.g. one joining late, gets a whole map right away
+  const bool joined = subscribers > stream.subscribers;
+  stream.subscribers = subscribers;
+  if (subscribers == 0 || (!joined && now - stream.last_sent < stream.min_period)) {
+    stream.missed = true;
+    return false;
   }
+  stream.missed = stream.missed || joined;
+  stream.last_sent = now;
+  return true;
+}
+
+void Costmap2DPublisher::setMaxRates(
+  double grid_frequency, double raw_frequency,
+  double compressed_frequency)
+{
+  auto period = [](double frequency) {
+      return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(frequency > 0 ? 1 / frequency : 0));
+    };
+  grid_stream_.min_period = period(grid_frequency);
+  raw_stream_.min_period = period(raw_frequency);
+  compressed_stream_.min_period = period(compressed_frequency);
 }
 
 void Costmap2DPublisher::publishCostmap()
 {
-  prepareCostmap();
-  costmap_raw_pub_->publish(costmap_raw_);
-  float resolution = costmap_->getResolution();
-
-  if (always_send_full_costmap_ || grid_.info.resolution != resolution ||
-    grid_.info.width != costmap_->getSizeInCellsX() ||
-    grid_.info.height != costmap_->getSizeInCellsY() ||
-    saved_origin_x_ != costmap_->getOriginX() ||
-    saved_origin_y_ != costmap_->getOriginY())
+  // Nothing is prepared for a stream with no subscribers or that is over its rate. A skipped
+  // cycle's changes are lost with the dirty regions, so its next message is a whole map.
+  const auto now = std::chrono::steady_clock::now();
+  const bool recording = raw_update_tile_size_ > 0 && nav2_util::BlackBox::global().isOpen();
+  const bool grid_due = isDue(grid_stream_,
+      costmap_pub_->get_subscription_count() + costmap_update_pub_->get_subscription_count(),
+      now);
+  const bool raw_due = isDue(raw_stream_,
+      costmap_raw_pub_->get_subscription_count() +
+      (raw_update_tile_size_ > 0 ? costmap_raw_update_pub_->get_subscription_count() : 0) +
+      (recording ? 1 : 0),
+      now);
+  const bool compressed_due = compress_ && isDue(compressed_stream_,
+      costmap_compressed_pub_->get_subscription_count() +
+      costmap_raw_compressed_pub_->get_subscription_count(),
+      now);
+
+  if (grid_due || raw_due || compressed_due) {
+    publishDue(grid_due, raw_due, compressed_due);
+  }
+
+  dirty_regions_.clear();
+  xn_ = yn_ = 0;
+  x0_ = costmap_->getSizeInCellsX();
+  y0_ = costmap_->getSizeInCellsY();
+}
+
+void Costmap2DPublisher::publishDue(bool grid_due, bool raw_due, bool compressed_due)
+{
+  // The messages are filled in from a snapshot or, without one, a copy made under the lock,
+  // so only a memcpy of the map holds up the next update rather than all of this
+  std::shared_ptr<const Costmap2D> snapshot;
+  if (snapshot_source_) {
+    snapshot = snapshot_source_->getSnapshot();
+  }
+  if (!snapshot) {
+    Costmap2D::mutex_t * mutex = copy_mutex_ ? copy_mutex_ : costmap_->getMutex();
+    std::unique_lock<Costmap2D::mutex_t> lock(*mutex);
+    publish_copy_ = *costmap_;
+  }
+  const Costmap2D & costmap = snapshot ? *snapshot : publish_copy_;
+
+  if (raw_due) {
+    if (costmap_raw_pub_->get_subscription_count() > 0) {
+      prepareCostmap(costmap);
+      costmap_raw_pub_->publish(costmap_raw_);
+    }
+    const bool recording = nav2_util::BlackBox::global().isOpen();
+    if (raw_update_tile_size_ > 0 &&
+      (costmap_raw_update_pub_->get_subscription_count() > 0 || recording))
+    {
+      if (raw_stream_.missed) {
+        // forgetting what was sent makes the next delta a keyframe
+        raw_update_sent_.clear();
+      }
+      prepareCostmapUpdate(costmap);
+      if (costmap_raw_update_pub_->get_subscription_count() > 0) {
+        costmap_raw_update_pub_->publish(costmap_raw_update_);
+      }
+      if (recording) {
+        nav2_util::BlackBox::global().record(black_box_channel_, costmap_raw_update_);
+      }
+    }
+    raw_stream_.missed = false;
+  }
+  if (compressed_due) {
+    prepareCompressed(costmap);
+    costmap_raw_compressed_pub_->publish(costmap_raw_compressed_);
+    costmap_compressed_pub_->publish(costmap_compressed_);
+    compressed_stream_.missed = false;
+  }
+  if (!grid_due) {
+    return;
+  }
+  float resolution = costmap.getResolution();
+
+  if (always_send_full_costmap_ || grid_stream_.missed || grid_.info.resolution != resolution ||
+    grid_.info.width != costmap.getSizeInCellsX() ||
+    grid_.info.height != costmap.getSizeInCellsY() ||
+    saved_origin_x_ != costmap.getOriginX() ||
+    saved_origin_y_ != costmap.getOriginY())
   {
-    prepareGrid();
+    prepareGrid(costmap);
     costmap_pub_->publish(grid_);
   } else if (x0_ < xn_) {
-    std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
-    // Publish Just an Update
-    map_msgs::msg::OccupancyGridUpdate update;
-    update.header.stamp = rclcpp::Time();
-    update.header.frame_id = global_frame_;
-    update.x = x0_;
-    update.y = y0_;
-    update.width = xn_ - x0_;
-    update.height = yn_ - y0_;
-    update.data.resize(update.width * update.height);
-
-    unsigned int i = 0;
-    for (unsigned int y = y0_; y < yn_; y++) {
-      for (unsigned int x = x0_; x < xn_; x++) {
-        unsigned char cost = costmap_->getCost(x, y);
-        update.data[i++] = cost_translation_table_[cost];
+    // Publish Just an Update, one for each changed rectangle
+    for (const MapRegion & region : dirty_regions_.get()) {
+      map_msgs::msg::OccupancyGridUpdate update;
+      update.header.stamp = rclcpp::Time();
+      update.header.frame_id = global_frame_;
+      update.x = region.x0;
+      update.y = region.y0;
+      update.width = region.xn - region.x0;
+      update.height = region.yn - region.y0;
+      update.data.resize(update.width * update.height);
+
+      const unsigned char * data = costmap.getCharMap();
+      for (int y = region.y0; y < region.yn; y++) {
+        translateCosts(data + costmap.getIndex(region.x0, y), update.width,
+          update.data.data() + (y - region.y0) * update.width);
       }
+      costmap_update_pub_->publish(update);
     }
-    costmap_update_pub_->publish(update);
   }
-
-  xn_ = yn_ = 0;
-  x0_ = costmap_->getSizeInCellsX();
-  y0_ = costmap_->getSizeInCellsY();
+  grid_stream_.missed = false;
 }
 
 }  // end namespace nav2_costmap_2d
@@ -38,12 +38,20 @@
 
 #include "nav2_costmap_2d/costmap_2d_ros.hpp"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "nav2_costmap_2d/costmap_dump.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
+#include "nav2_costmap_2d/worker_pool.hpp"
 #include "nav2_util/execution_timer.hpp"
+#include "nav2_util/thread_utils.hpp"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
 #include "tf2_ros/create_timer_ros.h"
 #include "nav2_util/robot_utils.hpp"
@@ -66,34 +74,67 @@ Costmap2DROS::Costmap2DROS(const std::string & name, const std::string & absolut
   auto options = rclcpp::NodeOptions().arguments(
     {"--ros-args", std::string("__node:=") + get_name() + "_client", "--"});
   client_node_ = std::make_shared<rclcpp::Node>("_", options);
+  services_callback_group_ = create_callback_group(
+    rclcpp::callback_group::CallbackGroupType::MutuallyExclusive);
 
   std::vector<std::string> plugin_names{"static_layer", "obstacle_layer", "inflation_layer"};
   std::vector<std::string> plugin_types{"nav2_costmap_2d::StaticLayer",
     "nav2_costmap_2d::ObstacleLayer", "nav2_costmap_2d::InflationLayer"};
 
+  declare_parameter("adaptive_cpu_budget", rclcpp::ParameterValue(0.0));
+  declare_parameter("adaptive_full_rotation", rclcpp::ParameterValue(1.0));
+  declare_parameter("adaptive_full_speed", rclcpp::ParameterValue(0.5));
+  declare_parameter("adaptive_min_frequency", rclcpp::ParameterValue(1.0));
+  declare_parameter("adaptive_min_window", rclcpp::ParameterValue(1.0));
+  declare_parameter("adaptive_update", rclcpp::ParameterValue(false));
   declare_parameter("always_send_full_costmap", rclcpp::ParameterValue(false));
+  declare_parameter("compressed_publish_frequency", rclcpp::ParameterValue(0.0));
+  declare_parameter("dump_file", rclcpp::ParameterValue(std::string("")));
+  declare_parameter("enable_snapshots", rclcpp::ParameterValue(false));
+  declare_parameter("executor_threads", rclcpp::ParameterValue(1));
   declare_parameter("footprint_padding", rclcpp::ParameterValue(0.01f));
   declare_parameter("footprint", rclcpp::ParameterValue(std::string("[]")));
   declare_parameter("global_frame", rclcpp::ParameterValue(std::string("map")));
+  declare_parameter("grid_publish_frequency", rclcpp::ParameterValue(0.0));
   declare_parameter("height", rclcpp::ParameterValue(10));
   declare_parameter("lethal_cost_threshold", rclcpp::ParameterValue(100));
   declare_parameter("map_topic", rclcpp::ParameterValue(std::string("/map")));
+  declare_parameter("max_dirty_regions", rclcpp::ParameterValue(1));
+  declare_parameter("max_layer_deferrals", rclcpp::ParameterValue(4));
+  declare_parameter("max_update_frequency", rclcpp::ParameterValue(30.0));
+  declare_parameter("memory_budget", rclcpp::ParameterValue(0.0));
+  declare_parameter("memory_report_period", rclcpp::ParameterValue(0.0));
   declare_parameter("observation_sources", rclcpp::ParameterValue(std::string("")));
   declare_parameter("origin_x", rclcpp::ParameterValue(0.0));
   declare_parameter("origin_y", rclcpp::ParameterValue(0.0));
+  declare_parameter("parallel_plugin_init", rclcpp::ParameterValue(false));
   declare_parameter("plugin_names", rclcpp::ParameterValue(plugin_names));
   declare_parameter("plugin_types", rclcpp::ParameterValue(plugin_types));
+  declare_parameter("publish_compressed", rclcpp::ParameterValue(false));
+  declare_parameter("published_layers", rclcpp::ParameterValue(std::vector<std::string>{}));
   declare_parameter("publish_frequency", rclcpp::ParameterValue(1.0));
+  declare_parameter("pyramid_levels", rclcpp::ParameterValue(0));
+  declare_parameter("raw_keyframe_interval", rclcpp::ParameterValue(10));
+  declare_parameter("raw_publish_frequency", rclcpp::ParameterValue(0.0));
+  declare_parameter("raw_update_tile_size", rclcpp::ParameterValue(0));
   declare_parameter("resolution", rclcpp::ParameterValue(0.1));
   declare_parameter("robot_base_frame", rclcpp::ParameterValue(std::string("base_link")));
   declare_parameter("robot_radius", rclcpp::ParameterValue(0.1));
+  declare_parameter("shared_memory_name", rclcpp::ParameterValue(std::string("")));
   declare_parameter("rolling_window", rclcpp::ParameterValue(false));
   declare_parameter("track_unknown_space", rclcpp::ParameterValue(false));
   declare_parameter("transform_tolerance", rclcpp::ParameterValue(0.3));
   declare_parameter("trinary_costmap", rclcpp::ParameterValue(true));
   declare_parameter("unknown_cost_value", rclcpp::ParameterValue(static_cast<unsigned char>(0xff)));
+  declare_parameter("update_budget", rclcpp::ParameterValue(0.0));
   declare_parameter("update_frequency", rclcpp::ParameterValue(5.0));
+  declare_parameter("update_on_data", rclcpp::ParameterValue(false));
+  declare_parameter("update_thread_cpus", rclcpp::ParameterValue(std::vector<int64_t>{}));
+  declare_parameter("update_thread_priority", rclcpp::ParameterValue(0));
+  declare_parameter("update_threads", rclcpp::ParameterValue(1));
+  declare_parameter("update_tile_size", rclcpp::ParameterValue(64));
   declare_parameter("use_maximum", rclcpp::ParameterValue(false));
+  declare_parameter("use_pose_cache", rclcpp::ParameterValue(false));
   declare_parameter("width", rclcpp::ParameterValue(10));
 }
 
@@ -110,10 +151,50 @@ Costmap2DROS::on_configure(const rclcpp_lifecycle::State & /*state*/)
 
   // Create the costmap itself
   layered_costmap_ = new LayeredCostmap(global_frame_, rolling_window_, track_unknown_space_);
+  if (update_threads_ > 1 && update_tile_size_ > 0) {
+    layered_costmap_->setParallelUpdate(update_threads_, update_tile_size_);
+  }
+  if (update_budget_ > 0.0) {
+    layered_costmap_->setUpdateBudget(update_budget_, max_layer_deferrals_);
+  }
+  if (max_dirty_regions_ > 1) {
+    layered_costmap_->setMaxDirtyRegions(max_dirty_regions_);
+  }
+  layered_costmap_->setSnapshots(enable_snapshots_);
+  if (pyramid_levels_ > 0) {
+    layered_costmap_->setPyramidLevels(pyramid_levels_);
+  }
+  const size_t memory_budget = static_cast<size_t>(memory_budget_ * 1024 * 1024);
+  layered_costmap_->setMemoryBudget(memory_budget);
+  if (update_on_data_ && map_update_frequency_ > 0.0) {
+    // updates as data arrives, no faster than max_update_frequency and no slower than
+    // update_frequency
+    const double min_period = max_update_frequency_ > 0.0 ? 1.0 / max_update_frequency_ : 0.0;
+    update_trigger_ = std::make_unique<UpdateTrigger>(
+      std::chrono::duration_cast<UpdateTrigger::Clock::duration>(
+        std::chrono::duration<double>(min_period)),
+      std::chrono::duration_cast<UpdateTrigger::Clock::duration>(
+        std::chrono::duration<double>(1.0 / map_update_frequency_)));
+    layered_costmap_->setUpdateTrigger(update_trigger_.get());
+  }
+
+  if (adaptive_update_ && map_update_frequency_ > 0.0) {
+    // at speed, the map updates at update_frequency over all of width and height
+    adaptive_params_.max_frequency = map_update_frequency_;
+    if (!rolling_window_) {
+      adaptive_params_.min_window_scale = 1.0;
+    }
+    adaptive_policy_ = std::make_unique<AdaptiveUpdatePolicy>(adaptive_params_);
+    window_scale_ = 1.0;
+  }
 
-  if (!layered_costmap_->isSizeLocked()) {
-    layered_costmap_->resizeMap((unsigned int)(map_width_meters_ / resolution_),
-      (unsigned int)(map_height_meters_ / resolution_), resolution_, origin_x_, origin_y_);
+  if (!layered_costmap_->isSizeLocked() &&
+    !layered_costmap_->resizeMap((unsigned int)(map_width_meters_ / resolution_),
+    (unsigned int)(map_height_meters_ / resolution_), resolution_, origin_x_, origin_y_))
+  {
+    RCLCPP_ERROR(get_logger(), "A %d x %d m costmap at %f m/cell is over the memory budget "
+      "of %.1f MB", map_width_meters_, map_height_meters_, resolution_, memory_budget_);
+    return nav2_util::CallbackReturn::FAILURE;
   }
 
   // Create the transform-related objects
@@ -123,17 +204,65 @@ Costmap2DROS::on_configure(const rclcpp_lifecycle::State & /*state*/)
     rclcpp_node_->get_node_timers_interface());
   tf_buffer_->setCreateTimerInterface(timer_interface);
   tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_);
+  if (use_pose_cache_) {
+    pose_cache_ = std::make_unique<nav2_util::PoseCache>(rclcpp_node_, *tf_buffer_,
+        std::vector<std::string>{global_frame_}, robot_base_frame_);
+  }
 
   // Then load and add the plug-ins to the costmap
+  std::vector<std::shared_ptr<Layer>> plugins;
+  std::vector<double> load_times;
   for (unsigned int i = 0; i < plugin_names_.size(); ++i) {
     RCLCPP_INFO(get_logger(), "Using plugin \"%s\"", plugin_names_[i].c_str());
 
+    nav2_util::ExecutionTimer timer;
+    timer.start();
+
     std::shared_ptr<Layer> plugin = plugin_loader_.createSharedInstance(plugin_types_[i]);
     layered_costmap_->addPlugin(plugin);
+    plugins.push_back(plugin);
 
-    // TODO(mjeronimo): instead of get(), use a shared ptr
-    plugin->initialize(layered_costmap_, plugin_names_[i], tf_buffer_.get(),
-      shared_from_this(), client_node_, rclcpp_node_);
+    timer.end();
+    load_times.push_back(std::chrono::duration<double>(timer.elapsed_time()).count());
+  }
+
+  // and initialize them in order, each run of consecutive layers that are safe to initialize
+  // together at once if enabled
+  for (size_t first = 0; first < plugins.size(); ) {
+    size_t last = first + 1;
+    if (parallel_plugin_init_ && plugins[first]->isInitSafe()) {
+      while (last < plugins.size() && plugins[last]->isInitSafe()) {
+        ++last;
+      }
+    }
+    initializePlugins(plugins, first, last, load_times);
+    first = last;
+  }
+
+  // A map arriving while layers initialized together resizes the master under them, so they
+  // match its final size once all are done
+  if (parallel_plugin_init_) {
+    std::unique_lock<Costmap2D::mutex_t> lock(*(layered_costmap_->getCostmap()->getMutex()));
+    for (const auto & plugin : plugins) {
+      plugin->matchSize();
+    }
+  }
+
+  for (size_t i = 0; i < plugins.size(); ++i) {
+    record_startup_phase("loading plugin " + plugin_names_[i], load_times[i]);
+  }
+
+  // layers allocate what they need for the current size as they are initialized
+  if (memory_budget > 0) {
+    size_t total = 0;
+    for (const auto & usage : layered_costmap_->getMemoryUsage()) {
+      total += usage.bytes;
+    }
+    if (total > memory_budget) {
+      RCLCPP_ERROR(get_logger(), "The costmap and its layers hold %.1f MB, over the memory "
+        "budget of %.1f MB", total / (1024.0 * 1024.0), memory_budget_);
+      return nav2_util::CallbackReturn::FAILURE;
+    }
   }
 
   // Create the publishers and subscribers
@@ -147,6 +276,42 @@ Costmap2DROS::on_configure(const rclcpp_lifecycle::State & /*state*/)
   costmap_publisher_ = new Costmap2DPublisher(shared_from_this(),
       layered_costmap_->getCostmap(), global_frame_,
       "costmap", always_send_full_costmap_);
+  costmap_publisher_->setSnapshotSource(layered_costmap_);
+  if (max_dirty_regions_ > 1) {
+    costmap_publisher_->setMaxDirtyRegions(max_dirty_regions_);
+  }
+  if (raw_update_tile_size_ > 0) {
+    costmap_publisher_->enableRawUpdates(raw_update_tile_size_, raw_keyframe_interval_);
+  }
+  if (publish_compressed_) {
+    costmap_publisher_->enableCompression();
+  }
+  costmap_publisher_->setMaxRates(grid_publish_frequency_, raw_publish_frequency_,
+    compressed_publish_frequency_);
+  // Each published layer streams its own grid, whose raw deltas only carry the tiles where the
+  // layer itself changed rather than every change to the master grid
+  for (const std::string & layer_name : published_layers_) {
+    std::shared_ptr<CostmapLayer> layer = getCostmapLayer(layer_name);
+    if (!layer) {
+      RCLCPP_WARN(get_logger(), "Not publishing layer \"%s\", which is not a plugin with a "
+        "grid of its own", layer_name.c_str());
+      continue;
+    }
+    auto publisher = std::make_unique<Costmap2DPublisher>(shared_from_this(), layer.get(),
+        global_frame_, layer_name + "/costmap", always_send_full_costmap_);
+    publisher->setLayerSource(layer_name, layered_costmap_->getCostmap()->getMutex());
+    if (max_dirty_regions_ > 1) {
+      publisher->setMaxDirtyRegions(max_dirty_regions_);
+    }
+    if (raw_update_tile_size_ > 0) {
+      publisher->enableRawUpdates(raw_update_tile_size_, raw_keyframe_interval_);
+    }
+    publisher->setMaxRates(grid_publish_frequency_, raw_publish_frequency_, 0.0);
+    layer_publishers_.push_back(std::move(publisher));
+  }
+  if (!shared_memory_name_.empty()) {
+    shared_costmap_ = std::make_unique<SharedCostmapWriter>(shared_memory_name_);
+  }
 
   // Set the footprint
   if (use_radius_) {
@@ -159,6 +324,7 @@ Costmap2DROS::on_configure(const rclcpp_lifecycle::State & /*state*/)
 
   // Add cleaning service
   clear_costmap_service_ = std::make_unique<ClearCostmapService>(shared_from_this(), *this);
+  path_validity_service_ = std::make_unique<PathValidityService>(shared_from_this(), *this);
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -169,6 +335,9 @@ Costmap2DROS::on_activate(const rclcpp_lifecycle::State & /*state*/)
   RCLCPP_INFO(get_logger(), "Activating");
 
   costmap_publisher_->on_activate();
+  for (auto & publisher : layer_publishers_) {
+    publisher->on_activate();
+  }
   footprint_pub_->on_activate();
 
   // First, make sure that the transform between the robot base frame
@@ -177,6 +346,8 @@ Costmap2DROS::on_activate(const rclcpp_lifecycle::State & /*state*/)
   std::string tf_error;
 
   RCLCPP_INFO(get_logger(), "Checking transform");
+  nav2_util::ExecutionTimer tf_timer;
+  tf_timer.start();
   auto sleep_dur = std::chrono::milliseconds(100);
   while (rclcpp::ok() &&
     !tf_buffer_->canTransform(global_frame_, robot_base_frame_, tf2::TimePointZero,
@@ -191,11 +362,27 @@ Costmap2DROS::on_activate(const rclcpp_lifecycle::State & /*state*/)
     tf_error.clear();
     rclcpp::sleep_for(sleep_dur);
   }
+  tf_timer.end();
+  record_startup_phase("waiting for transform " + global_frame_ + " to " + robot_base_frame_,
+    tf_timer);
+
+  // Carry on from the costs the last deactivation left, before the first update
+  if (!dump_file_.empty() && access(dump_file_.c_str(), F_OK) == 0) {
+    try {
+      CostmapDump dump(dump_file_);
+      size_t restored = dump.restore(*layered_costmap_);
+      RCLCPP_INFO(get_logger(), "Restored the costmap and %zu layer grids from %s",
+        restored, dump_file_.c_str());
+    } catch (std::runtime_error & e) {
+      RCLCPP_WARN(get_logger(), "Not restoring the costmap: %s", e.what());
+    }
+  }
 
   // Create a thread to handle updating the map
   stopped_ = false;
   stop_updates_ = false;
   map_update_thread_shutdown_ = false;
+  loop_clock_ = std::make_shared<nav2_util::LoopClock>(get_clock());
 
   map_update_thread_ = new std::thread(std::bind(
         &Costmap2DROS::mapUpdateLoop, this, map_update_frequency_));
@@ -210,6 +397,9 @@ Costmap2DROS::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
   RCLCPP_INFO(get_logger(), "Deactivating");
 
   costmap_publisher_->on_deactivate();
+  for (auto & publisher : layer_publishers_) {
+    publisher->on_deactivate();
+  }
   footprint_pub_->on_deactivate();
 
   stop();
@@ -217,9 +407,22 @@ Costmap2DROS::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
   // Map thread stuff
   // TODO(mjeronimo): unique_ptr
   map_update_thread_shutdown_ = true;
+  if (update_trigger_) {
+    update_trigger_->interrupt();
+  }
+  loop_clock_->interrupt();
   map_update_thread_->join();
   delete map_update_thread_;
   map_update_thread_ = nullptr;
+  loop_clock_.reset();
+
+  if (!dump_file_.empty()) {
+    try {
+      CostmapDump::write(dump_file_, *layered_costmap_);
+    } catch (std::runtime_error & e) {
+      RCLCPP_WARN(get_logger(), "Failed to dump the costmap: %s", e.what());
+    }
+  }
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -231,7 +434,9 @@ Costmap2DROS::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
 
   delete layered_costmap_;
   layered_costmap_ = nullptr;
+  update_trigger_.reset();
 
+  pose_cache_.reset();
   tf_listener_.reset();
   tf_buffer_.reset();
 
@@ -242,8 +447,11 @@ Costmap2DROS::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
     delete costmap_publisher_;
     costmap_publisher_ = nullptr;
   }
+  layer_publishers_.clear();
+  shared_costmap_.reset();
 
   clear_costmap_service_.reset();
+  path_validity_service_.reset();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -268,23 +476,55 @@ Costmap2DROS::getParameters()
   RCLCPP_DEBUG(get_logger(), " getParameters");
 
   // Get all of the required parameters
+  get_parameter("adaptive_cpu_budget", adaptive_params_.cpu_budget);
+  get_parameter("adaptive_full_rotation", adaptive_params_.full_rotation);
+  get_parameter("adaptive_full_speed", adaptive_params_.full_speed);
+  get_parameter("adaptive_min_frequency", adaptive_params_.min_frequency);
+  get_parameter("adaptive_min_window", adaptive_params_.min_window_scale);
+  get_parameter("adaptive_update", adaptive_update_);
   get_parameter("always_send_full_costmap", always_send_full_costmap_);
+  get_parameter("compressed_publish_frequency", compressed_publish_frequency_);
+  get_parameter("dump_file", dump_file_);
+  get_parameter("enable_snapshots", enable_snapshots_);
   get_parameter("footprint", footprint_);
   get_parameter("footprint_padding", footprint_padding_);
   get_parameter("global_frame", global_frame_);
+  get_parameter("grid_publish_frequency", grid_publish_frequency_);
   get_parameter("height", map_height_meters_);
+  get_parameter("max_dirty_regions", max_dirty_regions_);
+  get_parameter("max_layer_deferrals", max_layer_deferrals_);
+  get_parameter("max_update_frequency", max_update_frequency_);
+  get_parameter("memory_budget", memory_budget_);
+  get_parameter("memory_report_period", memory_report_period_);
   get_parameter("origin_x", origin_x_);
   get_parameter("origin_y", origin_y_);
+  get_parameter("parallel_plugin_init", parallel_plugin_init_);
   get_parameter("plugin_names", plugin_names_);
   get_parameter("plugin_types", plugin_types_);
+  get_parameter("publish_compressed", publish_compressed_);
+  get_parameter("published_layers", published_layers_);
   get_parameter("publish_frequency", map_publish_frequency_);
+  get_parameter("pyramid_levels", pyramid_levels_);
+  get_parameter("raw_keyframe_interval", raw_keyframe_interval_);
+  get_parameter("raw_publish_frequency", raw_publish_frequency_);
+  get_parameter("raw_update_tile_size", raw_update_tile_size_);
   get_parameter("resolution", resolution_);
   get_parameter("robot_base_frame", robot_base_frame_);
   get_parameter("robot_radius", robot_radius_);
+  get_parameter("shared_memory_name", shared_memory_name_);
   get_parameter("rolling_window", rolling_window_);
   get_parameter("track_unknown_space", track_unknown_space_);
   get_parameter("transform_tolerance", transform_tolerance_);
+  get_parameter("update_budget", update_budget_);
   get_parameter("update_frequency", map_update_frequency_);
+  get_parameter("update_on_data", update_on_data_);
+  std::vector<int64_t> update_thread_cpus;
+  get_parameter("update_thread_cpus", update_thread_cpus);
+  update_thread_cpus_.assign(update_thread_cpus.begin(), update_thread_cpus.end());
+  get_parameter("update_thread_priority", update_thread_priority_);
+  get_parameter("update_threads", update_threads_);
+  get_parameter("update_tile_size", update_tile_size_);
+  get_parameter("use_pose_cache", use_pose_cache_);
   get_parameter("width", map_width_meters_);
 
   // Semantic checks...
@@ -321,6 +561,44 @@ Costmap2DROS::getParameters()
   }
 }
 
+void
+Costmap2DROS::initializePlugins(
+  const std::vector<std::shared_ptr<Layer>> & plugins, size_t first, size_t last,
+  std::vector<double> & init_times)
+{
+  auto initialize = [&](size_t i) {
+      nav2_util::ExecutionTimer timer;
+      timer.start();
+      // TODO(mjeronimo): instead of get(), use a shared ptr
+      plugins[i]->initialize(layered_costmap_, plugin_names_[i], tf_buffer_.get(),
+        shared_from_this(), client_node_, rclcpp_node_);
+      timer.end();
+      init_times[i] += std::chrono::duration<double>(timer.elapsed_time()).count();
+    };
+
+  if (last - first == 1) {
+    initialize(first);
+    return;
+  }
+
+  // each layer on a thread of its own, as they mostly wait; the first error is rethrown once
+  // all are done
+  std::vector<std::exception_ptr> errors(last - first);
+  WorkerPool pool(last - first);
+  pool.run([&](int job) {
+      try {
+        initialize(first + job);
+      } catch (...) {
+        errors[job] = std::current_exception();
+      }
+    }, static_cast<int>(last - first));
+  for (const auto & error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
 void
 Costmap2DROS::setRobotFootprint(const std::vector<geometry_msgs::msg::Point> & points)
 {
@@ -350,6 +628,32 @@ Costmap2DROS::getOrientedFootprint(std::vector<geometry_msgs::msg::Point> & orie
     padded_footprint_, oriented_footprint);
 }
 
+std::shared_ptr<CostmapLayer>
+Costmap2DROS::getCostmapLayer(const std::string & name)
+{
+  if (!layered_costmap_) {
+    return nullptr;
+  }
+  for (const std::shared_ptr<Layer> & plugin : *layered_costmap_->getPlugins()) {
+    if (plugin->getName() == name) {
+      return std::dynamic_pointer_cast<CostmapLayer>(plugin);
+    }
+  }
+  return nullptr;
+}
+
+std::unique_ptr<rclcpp::executor::Executor>
+Costmap2DROS::createExecutor()
+{
+  // Read here rather than on configure, as the executor spins the node before that
+  get_parameter("executor_threads", executor_threads_);
+  if (executor_threads_ > 1) {
+    return std::make_unique<rclcpp::executors::MultiThreadedExecutor>(
+      rclcpp::executor::ExecutorArgs(), executor_threads_);
+  }
+  return std::make_unique<rclcpp::executors::SingleThreadedExecutor>();
+}
+
 void
 Costmap2DROS::mapUpdateLoop(double frequency)
 {
@@ -360,9 +664,18 @@ Costmap2DROS::mapUpdateLoop(double frequency)
     return;
   }
 
+  std::string error;
+  if (!nav2_util::setThreadPriority(update_thread_priority_, error)) {
+    RCLCPP_WARN(get_logger(), "Could not run the map updates at real-time priority %d: %s",
+      update_thread_priority_, error.c_str());
+  }
+  if (!nav2_util::setThreadAffinity(update_thread_cpus_, error)) {
+    RCLCPP_WARN(get_logger(), "Could not pin the map updates to their CPUs: %s", error.c_str());
+  }
+
   RCLCPP_DEBUG(get_logger(), "Entering loop");
 
-  rclcpp::Rate r(frequency);    // 200ms by default
+  nav2_util::LoopRate r(loop_clock_, frequency);    // 200ms by default
 
   while (rclcpp::ok() && !map_update_thread_shutdown_) {
     nav2_util::ExecutionTimer timer;
@@ -372,12 +685,52 @@ Costmap2DROS::mapUpdateLoop(double frequency)
     updateMap();
     timer.end();
 
+    recordUpdateMetrics(timer);
+    if (adaptive_policy_) {
+      adaptUpdates(r, timer.elapsed_time_in_seconds());
+    }
+    if (memory_report_period_ > 0.0 && std::chrono::steady_clock::now() - last_memory_report_ >
+      std::chrono::duration<double>(memory_report_period_))
+    {
+      reportMemoryUsage();
+      last_memory_report_ = std::chrono::steady_clock::now();
+    }
+
     RCLCPP_DEBUG(get_logger(), "Map update time: %.9f", timer.elapsed_time_in_seconds());
+    for (const auto & timing : layered_costmap_->getLayerTimings()) {
+      RCLCPP_DEBUG(get_logger(),
+        "Layer %s: bounds %.6f s, costs %.6f s, average %.6f s, max %.6f s, "
+        "%u updates, %u deferrals", timing.name.c_str(), timing.bounds_time,
+        timing.costs_time, timing.average_time, timing.max_time, timing.updates,
+        timing.deferrals);
+    }
+    if (update_budget_ > 0.0 && timer.elapsed_time_in_seconds() > update_budget_) {
+      RCLCPP_WARN(get_logger(), "Map update took %.4f seconds, over its budget of %.4f seconds",
+        timer.elapsed_time_in_seconds(), update_budget_);
+    }
+
+    if (shared_costmap_ && layered_costmap_->isInitialized()) {
+      Costmap2D * master = layered_costmap_->getCostmap();
+      std::unique_lock<Costmap2D::mutex_t> lock(*(master->getMutex()));
+      try {
+        shared_costmap_->write(*master);
+      } catch (std::runtime_error & e) {
+        RCLCPP_ERROR(get_logger(), "No longer sharing the costmap: %s", e.what());
+        shared_costmap_.reset();
+      }
+    }
+
+    if (path_validity_service_ && layered_costmap_->isInitialized()) {
+      path_validity_service_->addDirtyRegions(layered_costmap_->getDirtyRegions());
+    }
 
     if (publish_cycle_ > rclcpp::Duration(0) && layered_costmap_->isInitialized()) {
-      unsigned int x0, y0, xn, yn;
-      layered_costmap_->getBounds(&x0, &xn, &y0, &yn);
-      costmap_publisher_->updateBounds(x0, xn, y0, yn);
+      for (const MapRegion & region : layered_costmap_->getDirtyRegions()) {
+        costmap_publisher_->updateBounds(region.x0, region.xn, region.y0, region.yn);
+        for (auto & publisher : layer_publishers_) {
+          publisher->updateBounds(region.x0, region.xn, region.y0, region.yn);
+        }
+      }
 
       auto current_time = now();
       if ((last_publish_ + publish_cycle_ < current_time) ||  // publish_cycle_ is due
@@ -385,10 +738,21 @@ Costmap2DROS::mapUpdateLoop(double frequency)
       {
         RCLCPP_DEBUG(get_logger(), "Publish costmap at %s", name_.c_str());
         costmap_publisher_->publishCostmap();
+        for (auto & publisher : layer_publishers_) {
+          publisher->publishCostmap();
+        }
         last_publish_ = current_time;
       }
     }
 
+    // On sim time the cycles keep to /clock instead, for runs that repeat the same way
+    if (update_trigger_ && !loop_clock_->isSimTime()) {
+      // sleep until a layer has new data, or for the rest of the cycle without any
+      unsigned int notifications = update_trigger_->wait();
+      RCLCPP_DEBUG(get_logger(), "Map update for %u notifications", notifications);
+      continue;
+    }
+
     // Make sure to sleep for the remainder of our cycle time
     r.sleep();
 
@@ -403,6 +767,69 @@ Costmap2DROS::mapUpdateLoop(double frequency)
   }
 }
 
+void
+Costmap2DROS::adaptUpdates(nav2_util::LoopRate & rate, double update_seconds)
+{
+  adaptive_policy_->addUpdateTime(update_seconds);
+  rate.setFrequency(adaptive_policy_->frequency());
+
+  // Each resize clears the layers' grids, so the window changes only a whole step at a time
+  const double scale = adaptive_policy_->windowScale();
+  if (!rolling_window_ || scale == window_scale_) {
+    return;
+  }
+  Costmap2D * master = layered_costmap_->getCostmap();
+  const unsigned int size_x = std::max(1u,
+      static_cast<unsigned int>(map_width_meters_ * scale / resolution_));
+  const unsigned int size_y = std::max(1u,
+      static_cast<unsigned int>(map_height_meters_ * scale / resolution_));
+  if (layered_costmap_->resizeMap(size_x, size_y, resolution_, master->getOriginX(),
+    master->getOriginY(), layered_costmap_->isSizeLocked()))
+  {
+    RCLCPP_DEBUG(get_logger(), "Rolling window now %.0f%% of its size, updating at %.2f Hz",
+      scale * 100.0, adaptive_policy_->frequency());
+    window_scale_ = scale;
+  }
+}
+
+void
+Costmap2DROS::recordUpdateMetrics(nav2_util::ExecutionTimer & timer)
+{
+  nav2_util::MetricsRegistry & registry = nav2_util::MetricsRegistry::global();
+  if (!update_map_time_) {
+    update_map_time_ = &registry.histogram(std::string(get_name()) + ".update_map",
+        "Costmap update");
+  }
+  update_map_time_->record(timer.elapsed_time());
+
+  std::vector<LayerTiming> timings = layered_costmap_->getLayerTimings();
+  if (layer_times_.size() != timings.size()) {
+    layer_times_.clear();
+    for (const auto & timing : timings) {
+      layer_times_.push_back(&registry.histogram(
+          std::string(get_name()) + ".layer." + timing.name, "Costmap layer update"));
+    }
+  }
+  for (size_t i = 0; i < timings.size(); ++i) {
+    layer_times_[i]->recordSeconds(timings[i].bounds_time + timings[i].costs_time);
+  }
+}
+
+void
+Costmap2DROS::reportMemoryUsage()
+{
+  nav2_util::MetricsRegistry & registry = nav2_util::MetricsRegistry::global();
+  size_t total = 0;
+  for (const auto & usage : layered_costmap_->getMemoryUsage()) {
+    RCLCPP_INFO(get_logger(), "Layer %s holds %.2f MB", usage.name.c_str(),
+      usage.bytes / (1024.0 * 1024.0));
+    registry.gauge(std::string(get_name()) + ".memory." + usage.name,
+      "Costmap layer memory, in bytes").set(static_cast<double>(usage.bytes));
+    total += usage.bytes;
+  }
+  RCLCPP_INFO(get_logger(), "The costmap holds %.2f MB", total / (1024.0 * 1024.0));
+}
+
 void
 Costmap2DROS::updateMap()
 {
@@ -417,6 +844,9 @@ Costmap2DROS::updateMap()
       double yaw = tf2::getYaw(pose.pose.orientation);
 
       layered_costmap_->updateMap(x, y, yaw);
+      if (adaptive_policy_) {
+        adaptive_policy_->addPose(x, y, yaw, now().seconds());
+      }
 
       geometry_msgs::msg::PolygonStamped footprint;
       footprint.header.frame_id = global_frame_;
@@ -511,6 +941,13 @@ Costmap2DROS::resetLayers()
 bool
 Costmap2DROS::getRobotPose(geometry_msgs::msg::PoseStamped & global_pose)
 {
+  // the cached pose is as good as a lookup while it is within the transform tolerance
+  if (pose_cache_ && pose_cache_->getPose(global_pose, global_frame_) &&
+    (now() - rclcpp::Time(global_pose.header.stamp)).seconds() <= transform_tolerance_)
+  {
+    return true;
+  }
+
   return nav2_util::getCurrentPose(global_pose, *tf_buffer_,
            global_frame_, robot_base_frame_, transform_tolerance_);
 }
@@ -0,0 +1,185 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/costmap_combine.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include "nav2_costmap_2d/cost_values.hpp"
+
+namespace nav2_costmap_2d
+{
+
+void combineMaxScalar(unsigned char * master, const unsigned char * layer, size_t count)
+{
+  for (size_t i = 0; i < count; i++) {
+    if (layer[i] == NO_INFORMATION) {
+      continue;
+    }
+    if (master[i] == NO_INFORMATION || master[i] < layer[i]) {
+      master[i] = layer[i];
+    }
+  }
+}
+
+void combineOverwriteScalar(unsigned char * master, const unsigned char * layer, size_t count)
+{
+  for (size_t i = 0; i < count; i++) {
+    if (layer[i] != NO_INFORMATION) {
+      master[i] = layer[i];
+    }
+  }
+}
+
+void combineAdditionScalar(unsigned char * master, const unsigned char * layer, size_t count)
+{
+  for (size_t i = 0; i < count; i++) {
+    if (layer[i] == NO_INFORMATION) {
+      continue;
+    }
+    if (master[i] == NO_INFORMATION) {
+      master[i] = layer[i];
+    } else {
+      int sum = master[i] + layer[i];
+      if (sum >= INSCRIBED_INFLATED_OBSTACLE) {
+        master[i] = INSCRIBED_INFLATED_OBSTACLE - 1;
+      } else {
+        master[i] = sum;
+      }
+    }
+  }
+}
+
+// Offsetting by one maps NO_INFORMATION to 0 and every known cost above it, so
+// that an unsigned max treats an unknown master cell as the lowest cost.
+
+#if defined(__SSE2__)
+
+static inline __m128i select(__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+void combineMax(unsigned char * master, const unsigned char * layer, size_t count)
+{
+  const __m128i unknown = _mm_set1_epi8(static_cast<char>(NO_INFORMATION));
+  const __m128i one = _mm_set1_epi8(1);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(master + i));
+    __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(layer + i));
+    __m128i max = _mm_sub_epi8(
+      _mm_max_epu8(_mm_add_epi8(m, one), _mm_add_epi8(l, one)), one);
+    __m128i result = select(_mm_cmpeq_epi8(l, unknown), m, max);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(master + i), result);
+  }
+  combineMaxScalar(master + i, layer + i, count - i);
+}
+
+void combineOverwrite(unsigned char * master, const unsigned char * layer, size_t count)
+{
+  const __m128i unknown = _mm_set1_epi8(static_cast<char>(NO_INFORMATION));
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(master + i));
+    __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(layer + i));
+    __m128i result = select(_mm_cmpeq_epi8(l, unknown), m, l);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(master + i), result);
+  }
+  combineOverwriteScalar(master + i, layer + i, count - i);
+}
+
+void combineAddition(unsigned char * master, const unsigned char * layer, size_t count)
+{
+  const __m128i unknown = _mm_set1_epi8(static_cast<char>(NO_INFORMATION));
+  const __m128i cap = _mm_set1_epi8(static_cast<char>(INSCRIBED_INFLATED_OBSTACLE - 1));
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(master + i));
+    __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(layer + i));
+    __m128i sum = _mm_min_epu8(_mm_adds_epu8(m, l), cap);
+    __m128i result = select(_mm_cmpeq_epi8(m, unknown), l, sum);
+    result = select(_mm_cmpeq_epi8(l, unknown), m, result);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(master + i), result);
+  }
+  combineAdditionScalar(master + i, layer + i, count - i);
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+void combineMax(unsigned char * master, const unsigned char * layer, size_t count)
+{
+  const uint8x16_t unknown = vdupq_n_u8(NO_INFORMATION);
+  const uint8x16_t one = vdupq_n_u8(1);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16_t m = vld1q_u8(master + i);
+    uint8x16_t l = vld1q_u8(layer + i);
+    uint8x16_t max = vsubq_u8(vmaxq_u8(vaddq_u8(m, one), vaddq_u8(l, one)), one);
+    vst1q_u8(master + i, vbslq_u8(vceqq_u8(l, unknown), m, max));
+  }
+  combineMaxScalar(master + i, layer + i, count - i);
+}
+
+void combineOverwrite(unsigned char * master, const unsigned char * layer, size_t count)
+{
+  const uint8x16_t unknown = vdupq_n_u8(NO_INFORMATION);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16_t m = vld1q_u8(master + i);
+    uint8x16_t l = vld1q_u8(layer + i);
+    vst1q_u8(master + i, vbslq_u8(vceqq_u8(l, unknown), m, l));
+  }
+  combineOverwriteScalar(master + i, layer + i, count - i);
+}
+
+void combineAddition(unsigned char * master, const unsigned char * layer, size_t count)
+{
+  const uint8x16_t unknown = vdupq_n_u8(NO_INFORMATION);
+  const uint8x16_t cap = vdupq_n_u8(INSCRIBED_INFLATED_OBSTACLE - 1);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16_t m = vld1q_u8(master + i);
+    uint8x16_t l = vld1q_u8(layer + i);
+    uint8x16_t sum = vminq_u8(vqaddq_u8(m, l), cap);
+    uint8x16_t result = vbslq_u8(vceqq_u8(m, unknown), l, sum);
+    vst1q_u8(master + i, vbslq_u8(vceqq_u8(l, unknown), m, result));
+  }
+  combineAdditionScalar(master + i, layer + i, count - i);
+}
+
+#else
+
+void combineMax(unsigned char * master, const unsigned char * layer, size_t count)
+{
+  combineMaxScalar(master, layer, count);
+}
+
+void combineOverwrite(unsigned char * master, const unsigned char * layer, size_t count)
+{
+  combineOverwriteScalar(master, layer, count);
+}
+
+void combineAddition(unsigned char * master, const unsigned char * layer, size_t count)
+{
+  combineAdditionScalar(master, layer, count);
+}
+
+#endif
+
+}  // namespace nav2_costmap_2d
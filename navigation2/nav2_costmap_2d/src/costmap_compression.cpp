@@ -0,0 +1,74 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/costmap_compression.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+void encodeRunLength(const unsigned char * data, size_t size, std::vector<uint8_t> & encoded)
+{
+  encoded.clear();
+  size_t i = 0;
+  while (i < size) {
+    unsigned char value = data[i];
+    size_t run = 1;
+    while (i + run < size && data[i + run] == value) {
+      ++run;
+    }
+    i += run;
+
+    while (run >= 0x80) {
+      encoded.push_back(static_cast<uint8_t>(run & 0x7F) | 0x80);
+      run >>= 7;
+    }
+    encoded.push_back(static_cast<uint8_t>(run));
+    encoded.push_back(value);
+  }
+}
+
+bool decodeRunLength(const std::vector<uint8_t> & encoded, unsigned char * data, size_t size)
+{
+  size_t cell = 0;
+  size_t i = 0;
+  while (i < encoded.size()) {
+    size_t run = 0;
+    unsigned int shift = 0;
+    while (i < encoded.size() && (encoded[i] & 0x80)) {
+      run |= static_cast<size_t>(encoded[i++] & 0x7F) << shift;
+      shift += 7;
+      if (shift >= 8 * sizeof(size_t)) {
+        return false;
+      }
+    }
+    // the last byte of the length and the value must both be there
+    if (i + 1 >= encoded.size()) {
+      return false;
+    }
+    run |= static_cast<size_t>(encoded[i++]) << shift;
+    unsigned char value = encoded[i++];
+
+    if (run == 0 || run > size - cell) {
+      return false;
+    }
+    std::fill(data + cell, data + cell + run, value);
+    cell += run;
+  }
+  return cell == size;
+}
+
+}  // namespace nav2_costmap_2d
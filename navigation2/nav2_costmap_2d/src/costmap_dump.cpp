@@ -0,0 +1,301 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/costmap_dump.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/layer.hpp"
+#include "nav2_costmap_2d/layered_costmap.hpp"
+
+namespace nav2_costmap_2d
+{
+
+struct CostmapDump::Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t grid_count;
+  uint32_t size_x;
+  uint32_t size_y;
+  double resolution;
+  double origin_x;
+  double origin_y;
+};
+
+struct CostmapDump::Entry
+{
+  char name[56];  // null terminated, empty for the master grid
+  uint32_t size_x;
+  uint32_t size_y;
+  uint32_t size_z;
+  uint32_t cell_bytes;
+  uint64_t offset;  // from the start of the file
+};
+
+namespace
+{
+
+const char DUMP_MAGIC[8] = {'N', 'A', 'V', '2', 'C', 'M', 'D', '\0'};
+const uint32_t DUMP_VERSION = 1;
+
+// Grids start at multiples of this, so that the cells of a mapped dump are aligned
+const uint64_t GRID_ALIGNMENT = 64;
+
+uint64_t gridBytes(uint32_t size_x, uint32_t size_y, uint32_t cell_bytes)
+{
+  return static_cast<uint64_t>(size_x) * size_y * cell_bytes;
+}
+
+}  // namespace
+
+CostmapDump::CostmapDump(const std::string & filename)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open " + filename + ": " + strerror(errno));
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    std::string error = strerror(errno);
+    close(fd);
+    throw std::runtime_error("Failed to stat " + filename + ": " + error);
+  }
+  size_ = file_stat.st_size;
+  if (size_ < sizeof(Header)) {
+    close(fd);
+    throw std::runtime_error(filename + " is too short to be a costmap dump");
+  }
+
+  void * data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  std::string error = strerror(errno);
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("Failed to map " + filename + ": " + error);
+  }
+  data_ = static_cast<const uint8_t *>(data);
+  header_ = reinterpret_cast<const Header *>(data_);
+
+  try {
+    if (std::memcmp(header_->magic, DUMP_MAGIC, sizeof(DUMP_MAGIC)) != 0) {
+      throw std::runtime_error("not a costmap dump");
+    }
+    if (header_->version != DUMP_VERSION) {
+      throw std::runtime_error(
+              "unsupported version " + std::to_string(header_->version) +
+              ", or a file of the other byte order");
+    }
+    if (header_->grid_count == 0) {
+      throw std::runtime_error("no master grid");
+    }
+    uint64_t entries_end = sizeof(Header) + static_cast<uint64_t>(header_->grid_count) *
+      sizeof(Entry);
+    if (entries_end > size_) {
+      throw std::runtime_error("truncated table of grids");
+    }
+    entries_ = reinterpret_cast<const Entry *>(data_ + sizeof(Header));
+
+    for (uint32_t i = 0; i < header_->grid_count; ++i) {
+      const Entry & entry = entries_[i];
+      if (entry.name[sizeof(entry.name) - 1] != '\0') {
+        throw std::runtime_error("unterminated grid name");
+      }
+      uint64_t bytes = gridBytes(entry.size_x, entry.size_y, entry.cell_bytes);
+      if (entry.offset < entries_end || entry.offset > size_ || bytes > size_ - entry.offset) {
+        throw std::runtime_error("grid outside of the file");
+      }
+    }
+    const Entry & master = entries_[0];
+    if (master.name[0] != '\0' || master.cell_bytes != 1 ||
+      master.size_x != header_->size_x || master.size_y != header_->size_y)
+    {
+      throw std::runtime_error("the first grid is not the master grid");
+    }
+  } catch (std::runtime_error & e) {
+    munmap(const_cast<uint8_t *>(data_), size_);
+    throw std::runtime_error("Invalid costmap dump " + filename + ": " + e.what());
+  }
+}
+
+CostmapDump::~CostmapDump()
+{
+  munmap(const_cast<uint8_t *>(data_), size_);
+}
+
+unsigned int CostmapDump::sizeX() const
+{
+  return header_->size_x;
+}
+
+unsigned int CostmapDump::sizeY() const
+{
+  return header_->size_y;
+}
+
+double CostmapDump::resolution() const
+{
+  return header_->resolution;
+}
+
+double CostmapDump::originX() const
+{
+  return header_->origin_x;
+}
+
+double CostmapDump::originY() const
+{
+  return header_->origin_y;
+}
+
+const unsigned char * CostmapDump::costs() const
+{
+  return data_ + entries_[0].offset;
+}
+
+const void * CostmapDump::find(const DumpGrid & grid) const
+{
+  for (uint32_t i = 1; i < header_->grid_count; ++i) {
+    const Entry & entry = entries_[i];
+    if (grid.name == entry.name && grid.size_x == entry.size_x && grid.size_y == entry.size_y &&
+      grid.size_z == entry.size_z && grid.cell_bytes == entry.cell_bytes)
+    {
+      return data_ + entry.offset;
+    }
+  }
+  return nullptr;
+}
+
+void CostmapDump::restore(Costmap2D & costmap) const
+{
+  costmap.resizeMap(sizeX(), sizeY(), resolution(), originX(), originY());
+  std::memcpy(costmap.getCharMap(), costs(), gridBytes(sizeX(), sizeY(), 1));
+}
+
+size_t CostmapDump::restore(LayeredCostmap & layers) const
+{
+  Costmap2D * master = layers.getCostmap();
+  std::unique_lock<Costmap2D::mutex_t> lock(*(master->getMutex()));
+
+  layers.resizeMap(
+    sizeX(), sizeY(), resolution(), originX(), originY(), layers.isSizeLocked());
+  std::memcpy(master->getCharMap(), costs(), gridBytes(sizeX(), sizeY(), 1));
+
+  size_t restored = 0;
+  std::vector<DumpGrid> grids;
+  for (auto & plugin : *layers.getPlugins()) {
+    grids.clear();
+    plugin->getDumpGrids(grids);
+    for (const DumpGrid & grid : grids) {
+      const void * cells = find(grid);
+      if (cells) {
+        std::memcpy(grid.data, cells, gridBytes(grid.size_x, grid.size_y, grid.cell_bytes));
+        ++restored;
+      }
+    }
+  }
+  return restored;
+}
+
+void CostmapDump::write(const std::string & filename, const Costmap2D & costmap)
+{
+  writeGrids(filename, costmap, {});
+}
+
+void CostmapDump::write(const std::string & filename, LayeredCostmap & layers)
+{
+  Costmap2D * master = layers.getCostmap();
+  std::unique_lock<Costmap2D::mutex_t> lock(*(master->getMutex()));
+
+  std::vector<DumpGrid> grids;
+  for (auto & plugin : *layers.getPlugins()) {
+    plugin->getDumpGrids(grids);
+  }
+  writeGrids(filename, *master, grids);
+}
+
+void CostmapDump::writeGrids(
+  const std::string & filename, const Costmap2D & master,
+  const std::vector<DumpGrid> & layer_grids)
+{
+  std::vector<DumpGrid> grids;
+  grids.reserve(layer_grids.size() + 1);
+  grids.push_back({"", master.getSizeInCellsX(), master.getSizeInCellsY(), 0, 1,
+      master.getCharMap()});
+  grids.insert(grids.end(), layer_grids.begin(), layer_grids.end());
+
+  Header header{};
+  std::memcpy(header.magic, DUMP_MAGIC, sizeof(DUMP_MAGIC));
+  header.version = DUMP_VERSION;
+  header.grid_count = static_cast<uint32_t>(grids.size());
+  header.size_x = master.getSizeInCellsX();
+  header.size_y = master.getSizeInCellsY();
+  header.resolution = master.getResolution();
+  header.origin_x = master.getOriginX();
+  header.origin_y = master.getOriginY();
+
+  std::vector<Entry> entries(grids.size());
+  uint64_t offset = sizeof(Header) + entries.size() * sizeof(Entry);
+  for (size_t i = 0; i < grids.size(); ++i) {
+    const DumpGrid & grid = grids[i];
+    if (grid.name.size() >= sizeof(entries[i].name)) {
+      throw std::runtime_error("The grid name " + grid.name + " is too long for a costmap dump");
+    }
+    offset = (offset + GRID_ALIGNMENT - 1) / GRID_ALIGNMENT * GRID_ALIGNMENT;
+    Entry & entry = entries[i];
+    std::memset(&entry, 0, sizeof(entry));
+    std::memcpy(entry.name, grid.name.c_str(), grid.name.size());
+    entry.size_x = grid.size_x;
+    entry.size_y = grid.size_y;
+    entry.size_z = grid.size_z;
+    entry.cell_bytes = grid.cell_bytes;
+    entry.offset = offset;
+    offset += gridBytes(grid.size_x, grid.size_y, grid.cell_bytes);
+  }
+
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    throw std::runtime_error("Failed to open " + filename + " for writing");
+  }
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(Entry));
+
+  const char padding[GRID_ALIGNMENT] = {};
+  uint64_t written = sizeof(Header) + entries.size() * sizeof(Entry);
+  for (size_t i = 0; i < grids.size(); ++i) {
+    file.write(padding, entries[i].offset - written);
+    uint64_t bytes = gridBytes(grids[i].size_x, grids[i].size_y, grids[i].cell_bytes);
+    file.write(static_cast<const char *>(grids[i].data), bytes);
+    written = entries[i].offset + bytes;
+  }
+
+  if (!file) {
+    throw std::runtime_error("Failed to write " + filename);
+  }
+}
+
+}  // namespace nav2_costmap_2d
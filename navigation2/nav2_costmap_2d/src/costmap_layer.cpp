@@ -1,6 +1,12 @@
 #include <nav2_costmap_2d/costmap_layer.hpp>
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_combine.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -17,9 +23,26 @@ void CostmapLayer::touch(
 
 void CostmapLayer::matchSize()
 {
+  // a map that grows or moves by whole cells keeps what the layer had on the cells it still
+  // covers, rather than starting over
   Costmap2D * master = layered_costmap_->getCostmap();
-  resizeMap(master->getSizeInCellsX(), master->getSizeInCellsY(), master->getResolution(),
-    master->getOriginX(), master->getOriginY());
+  resizeMapKeepingCosts(master->getSizeInCellsX(), master->getSizeInCellsY(),
+    master->getResolution(), master->getOriginX(), master->getOriginY());
+}
+
+void CostmapLayer::getDumpGrids(std::vector<DumpGrid> & grids)
+{
+  grids.push_back({name_, size_x_, size_y_, 0, 1, costmap_});
+}
+
+size_t CostmapLayer::getMemoryUsage() const
+{
+  return static_cast<size_t>(size_x_) * size_y_;
+}
+
+double CostmapLayer::getMemoryPerCell() const
+{
+  return 1.0;
 }
 
 void CostmapLayer::addExtraBounds(double mx0, double my0, double mx1, double my1)
@@ -48,12 +71,90 @@ void CostmapLayer::useExtraBounds(double * min_x, double * min_y, double * max_x
   has_extra_bounds_ = false;
 }
 
+void CostmapLayer::queueClearExcept(
+  double min_x, double min_y, double max_x, double max_y, unsigned char value)
+{
+  QueuedClear clear;
+  clear.origin_x = clear.origin_y = clear.resolution = 0.0;
+  clear.min_x = min_x;
+  clear.min_y = min_y;
+  clear.max_x = max_x;
+  clear.max_y = max_y;
+  clear.value = value;
+
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  queued_clears_.push_back(std::move(clear));
+}
+
+void CostmapLayer::queueClearPolygon(
+  const std::vector<geometry_msgs::msg::Point> & polygon, unsigned char value)
+{
+  if (polygon.empty()) {
+    return;
+  }
+
+  QueuedClear clear;
+  clear.polygon = polygon;
+  clear.min_x = clear.max_x = polygon[0].x;
+  clear.min_y = clear.max_y = polygon[0].y;
+  for (const auto & point : polygon) {
+    touch(point.x, point.y, &clear.min_x, &clear.min_y, &clear.max_x, &clear.max_y);
+  }
+  clear.value = value;
+  {
+    std::unique_lock<mutex_t> lock(*getMutex());
+    polygonSpans(polygon, clear.spans);
+    clear.origin_x = origin_x_;
+    clear.origin_y = origin_y_;
+    clear.resolution = resolution_;
+  }
+
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  queued_clears_.push_back(std::move(clear));
+}
+
+void CostmapLayer::applyQueuedChanges()
+{
+  std::vector<QueuedClear> clears;
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (queued_clears_.empty()) {
+      return;
+    }
+    clears.swap(queued_clears_);
+  }
+
+  std::unique_lock<mutex_t> lock(*getMutex());
+  for (QueuedClear & clear : clears) {
+    if (clear.polygon.empty()) {
+      int x0, y0, xn, yn;
+      worldToMapNoBounds(clear.min_x, clear.min_y, x0, y0);
+      worldToMapNoBounds(clear.max_x, clear.max_y, xn, yn);
+      resetMapOutside(x0, y0, xn, yn, clear.value);
+      addExtraBounds(origin_x_, origin_y_,
+        origin_x_ + getSizeInMetersX(), origin_y_ + getSizeInMetersY());
+      continue;
+    }
+
+    int dx = 0, dy = 0;
+    if (clear.resolution != resolution_) {
+      polygonSpans(clear.polygon, clear.spans);
+    } else {
+      // rolling windows move by whole cells
+      dx = static_cast<int>(std::lround((clear.origin_x - origin_x_) / resolution_));
+      dy = static_cast<int>(std::lround((clear.origin_y - origin_y_) / resolution_));
+    }
+    setSpansToValue(clear.spans, clear.value, dx, dy);
+    addExtraBounds(clear.min_x, clear.min_y, clear.max_x, clear.max_y);
+  }
+}
+
 void CostmapLayer::updateWithMax(
   nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j,
   int max_i,
   int max_j)
 {
-  if (!enabled_) {
+  if (!enabled_ || max_i <= min_i) {
     return;
   }
 
@@ -62,18 +163,7 @@ void CostmapLayer::updateWithMax(
 
   for (int j = min_j; j < max_j; j++) {
     unsigned int it = j * span + min_i;
-    for (int i = min_i; i < max_i; i++) {
-      if (costmap_[it] == NO_INFORMATION) {
-        it++;
-        continue;
-      }
-
-      unsigned char old_cost = master_array[it];
-      if (old_cost == NO_INFORMATION || old_cost < costmap_[it]) {
-        master_array[it] = costmap_[it];
-      }
-      it++;
-    }
+    combineMax(master_array + it, costmap_ + it, max_i - min_i);
   }
 }
 
@@ -83,7 +173,7 @@ void CostmapLayer::updateWithTrueOverwrite(
   int max_i,
   int max_j)
 {
-  if (!enabled_) {
+  if (!enabled_ || max_i <= min_i) {
     return;
   }
   unsigned char * master = master_grid.getCharMap();
@@ -91,10 +181,7 @@ void CostmapLayer::updateWithTrueOverwrite(
 
   for (int j = min_j; j < max_j; j++) {
     unsigned int it = span * j + min_i;
-    for (int i = min_i; i < max_i; i++) {
-      master[it] = costmap_[it];
-      it++;
-    }
+    memcpy(master + it, costmap_ + it, max_i - min_i);
   }
 }
 
@@ -102,7 +189,7 @@ void CostmapLayer::updateWithOverwrite(
   nav2_costmap_2d::Costmap2D & master_grid,
   int min_i, int min_j, int max_i, int max_j)
 {
-  if (!enabled_) {
+  if (!enabled_ || max_i <= min_i) {
     return;
   }
   unsigned char * master = master_grid.getCharMap();
@@ -110,12 +197,7 @@ void CostmapLayer::updateWithOverwrite(
 
   for (int j = min_j; j < max_j; j++) {
     unsigned int it = span * j + min_i;
-    for (int i = min_i; i < max_i; i++) {
-      if (costmap_[it] != NO_INFORMATION) {
-        master[it] = costmap_[it];
-      }
-      it++;
-    }
+    combineOverwrite(master + it, costmap_ + it, max_i - min_i);
   }
 }
 
@@ -123,7 +205,7 @@ void CostmapLayer::updateWithAddition(
   nav2_costmap_2d::Costmap2D & master_grid,
   int min_i, int min_j, int max_i, int max_j)
 {
-  if (!enabled_) {
+  if (!enabled_ || max_i <= min_i) {
     return;
   }
   unsigned char * master_array = master_grid.getCharMap();
@@ -131,25 +213,7 @@ void CostmapLayer::updateWithAddition(
 
   for (int j = min_j; j < max_j; j++) {
     unsigned int it = j * span + min_i;
-    for (int i = min_i; i < max_i; i++) {
-      if (costmap_[it] == NO_INFORMATION) {
-        it++;
-        continue;
-      }
-
-      unsigned char old_cost = master_array[it];
-      if (old_cost == NO_INFORMATION) {
-        master_array[it] = costmap_[it];
-      } else {
-        int sum = old_cost + costmap_[it];
-        if (sum >= nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE) {
-          master_array[it] = nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE - 1;
-        } else {
-          master_array[it] = sum;
-        }
-      }
-      it++;
-    }
+    combineAddition(master_array + it, costmap_ + it, max_i - min_i);
   }
 }
 }  // namespace nav2_costmap_2d
@@ -0,0 +1,113 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/costmap_pyramid.hpp"
+
+#include <algorithm>
+#include <memory>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+
+namespace nav2_costmap_2d
+{
+
+// Pools the fine cells under the coarse cells [x0, xn) x [y0, yn)
+static void maxPool(
+  const Costmap2D & fine, Costmap2D & coarse,
+  unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn)
+{
+  const unsigned char * fine_map = fine.getCharMap();
+  unsigned char * coarse_map = coarse.getCharMap();
+  unsigned int fine_x = fine.getSizeInCellsX();
+  unsigned int fine_y = fine.getSizeInCellsY();
+  unsigned int span = coarse.getSizeInCellsX();
+
+  for (unsigned int y = y0; y < yn; ++y) {
+    unsigned int fy0 = 2 * y;
+    unsigned int fyn = std::min(fy0 + 2, fine_y);
+    for (unsigned int x = x0; x < xn; ++x) {
+      unsigned int fx0 = 2 * x;
+      unsigned int fxn = std::min(fx0 + 2, fine_x);
+      int known = -1;
+      for (unsigned int fy = fy0; fy < fyn; ++fy) {
+        for (unsigned int fx = fx0; fx < fxn; ++fx) {
+          unsigned char cost = fine_map[fy * fine_x + fx];
+          if (cost != NO_INFORMATION) {
+            known = std::max(known, static_cast<int>(cost));
+          }
+        }
+      }
+      coarse_map[y * span + x] = known < 0 ? NO_INFORMATION : known;
+    }
+  }
+}
+
+void CostmapPyramid::setLevels(unsigned int levels)
+{
+  levels_.resize(levels);
+  for (auto & level : levels_) {
+    if (!level) {
+      level = std::make_unique<Costmap2D>();
+    }
+  }
+}
+
+bool CostmapPyramid::matches(const Costmap2D & base) const
+{
+  const Costmap2D & level = *levels_.front();
+  return level.getSizeInCellsX() == (base.getSizeInCellsX() + 1) / 2 &&
+         level.getSizeInCellsY() == (base.getSizeInCellsY() + 1) / 2 &&
+         level.getResolution() == base.getResolution() * 2 &&
+         level.getOriginX() == base.getOriginX() &&
+         level.getOriginY() == base.getOriginY();
+}
+
+void CostmapPyramid::rebuild(const Costmap2D & base)
+{
+  const Costmap2D * fine = &base;
+  for (auto & level : levels_) {
+    unsigned int size_x = (fine->getSizeInCellsX() + 1) / 2;
+    unsigned int size_y = (fine->getSizeInCellsY() + 1) / 2;
+    level->resizeMap(size_x, size_y, fine->getResolution() * 2,
+      base.getOriginX(), base.getOriginY());
+    maxPool(*fine, *level, 0, 0, size_x, size_y);
+    fine = level.get();
+  }
+}
+
+void CostmapPyramid::update(
+  const Costmap2D & base, unsigned int x0, unsigned int y0,
+  unsigned int xn, unsigned int yn)
+{
+  if (levels_.empty() || xn <= x0 || yn <= y0) {
+    return;
+  }
+  if (!matches(base)) {
+    rebuild(base);
+    return;
+  }
+
+  const Costmap2D * fine = &base;
+  for (auto & level : levels_) {
+    // the coarse cells touching the window, which shrinks by half each level
+    x0 /= 2;
+    y0 /= 2;
+    xn = std::min((xn + 1) / 2, level->getSizeInCellsX());
+    yn = std::min((yn + 1) / 2, level->getSizeInCellsY());
+    maxPool(*fine, *level, x0, y0, xn, yn);
+    fine = level.get();
+  }
+}
+
+}  // namespace nav2_costmap_2d
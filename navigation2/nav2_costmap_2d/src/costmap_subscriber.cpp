@@ -12,10 +12,13 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <memory>
 
 #include "nav2_costmap_2d/costmap_subscriber.hpp"
+#include "nav2_costmap_2d/costmap_compression.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -58,46 +61,183 @@ std::shared_ptr<Costmap2D> CostmapSubscriber::getCostmap()
   if (!costmap_received_) {
     throw std::runtime_error("Costmap is not available");
   }
-  toCostmap2D();
+  // deltas and compressed maps are decoded into costmap_ as they come in, and full
+  // messages only need converting once each
+  if (!in_place_ && costmap_stale_) {
+    toCostmap2D();
+  }
   return costmap_;
 }
 
-void CostmapSubscriber::toCostmap2D()
+std::shared_ptr<Costmap2D> CostmapSubscriber::getCostmapIfChanged(uint64_t & version)
+{
+  uint64_t current = version_;
+  if (current == version) {
+    return nullptr;
+  }
+  std::shared_ptr<Costmap2D> costmap = getCostmap();
+  version = current;
+  return costmap;
+}
+
+void CostmapSubscriber::subscribeToUpdates(const std::string & update_topic_name)
+{
+  in_place_ = true;
+  costmap_received_ = false;
+  costmap_sub_.reset();
+  costmap_update_sub_ = rclcpp::create_subscription<nav2_msgs::msg::CostmapUpdate>(
+    node_topics_, update_topic_name,
+    rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable(),
+    std::bind(&CostmapSubscriber::costmapUpdateCallback, this, std::placeholders::_1));
+}
+
+void CostmapSubscriber::matchMetadata(const nav2_msgs::msg::CostmapMetaData & metadata)
 {
   if (costmap_ == nullptr) {
     costmap_ = std::make_shared<Costmap2D>(
-      costmap_msg_->metadata.size_x, costmap_msg_->metadata.size_y,
-      costmap_msg_->metadata.resolution, costmap_msg_->metadata.origin.position.x,
-      costmap_msg_->metadata.origin.position.y);
-  } else if (costmap_->getSizeInCellsX() != costmap_msg_->metadata.size_x ||
-    costmap_->getSizeInCellsY() != costmap_msg_->metadata.size_y ||
-    costmap_->getResolution() != costmap_msg_->metadata.resolution ||
-    costmap_->getOriginX() != costmap_msg_->metadata.origin.position.x ||
-    costmap_->getOriginY() != costmap_msg_->metadata.origin.position.y)
+      metadata.size_x, metadata.size_y,
+      metadata.resolution, metadata.origin.position.x,
+      metadata.origin.position.y);
+  } else if (costmap_->getSizeInCellsX() != metadata.size_x ||
+    costmap_->getSizeInCellsY() != metadata.size_y ||
+    costmap_->getResolution() != metadata.resolution ||
+    costmap_->getOriginX() != metadata.origin.position.x ||
+    costmap_->getOriginY() != metadata.origin.position.y)
   {
     // Update the size of the costmap
-    costmap_->resizeMap(costmap_msg_->metadata.size_x, costmap_msg_->metadata.size_y,
-      costmap_msg_->metadata.resolution,
-      costmap_msg_->metadata.origin.position.x,
-      costmap_msg_->metadata.origin.position.y);
+    costmap_->resizeMap(metadata.size_x, metadata.size_y,
+      metadata.resolution,
+      metadata.origin.position.x,
+      metadata.origin.position.y);
   }
+}
 
-  unsigned char * master_array = costmap_->getCharMap();
-  unsigned int index = 0;
-  for (unsigned int i = 0; i < costmap_msg_->metadata.size_x; ++i) {
-    for (unsigned int j = 0; j < costmap_msg_->metadata.size_y; ++j) {
-      master_array[index] = costmap_msg_->data[index];
-      ++index;
-    }
-  }
+void CostmapSubscriber::toCostmap2D()
+{
+  costmap_stale_ = false;
+  nav2_msgs::msg::Costmap::SharedPtr msg = costmap_msg_;
+  matchMetadata(msg->metadata);
+
+  // matchMetadata() keeps the buffer whenever the geometry holds, so this is one memcpy
+  // into memory that is already there
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+  memcpy(costmap_->getCharMap(), msg->data.data(),
+    static_cast<size_t>(msg->metadata.size_x) * msg->metadata.size_y);
 }
 
 void CostmapSubscriber::costmapCallback(const nav2_msgs::msg::Costmap::SharedPtr msg)
 {
   costmap_msg_ = msg;
+  costmap_stale_ = true;
+  ++version_;
   if (!costmap_received_) {
     costmap_received_ = true;
   }
 }
 
+void CostmapSubscriber::subscribeToCompressed(const std::string & compressed_topic_name)
+{
+  in_place_ = true;
+  costmap_received_ = false;
+  costmap_sub_.reset();
+  costmap_compressed_sub_ = rclcpp::create_subscription<nav2_msgs::msg::CompressedCostmap>(
+    node_topics_, compressed_topic_name,
+    rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable(),
+    std::bind(&CostmapSubscriber::compressedCostmapCallback, this, std::placeholders::_1));
+}
+
+void CostmapSubscriber::compressedCostmapCallback(
+  const nav2_msgs::msg::CompressedCostmap::SharedPtr msg)
+{
+  if (msg->encoding != "rle" || msg->occupancy) {
+    RCLCPP_WARN(node_logging_->get_logger(),
+      "Ignoring compressed costmap with %s encoding of %s values", msg->encoding.c_str(),
+      msg->occupancy ? "occupancy" : "cost");
+    return;
+  }
+
+  matchMetadata(msg->metadata);
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+  if (!decodeRunLength(msg->data, costmap_->getCharMap(),
+    static_cast<size_t>(msg->metadata.size_x) * msg->metadata.size_y))
+  {
+    RCLCPP_WARN(node_logging_->get_logger(), "Malformed compressed costmap on %s",
+      topic_name_.c_str());
+    return;
+  }
+  costmap_received_ = true;
+  ++version_;
+}
+
+void CostmapSubscriber::costmapUpdateCallback(
+  const nav2_msgs::msg::CostmapUpdate::SharedPtr update)
+{
+  if (!update->keyframe && (!updates_synced_ || update->sequence != last_sequence_ + 1)) {
+    if (updates_synced_) {
+      RCLCPP_WARN(node_logging_->get_logger(),
+        "Missed a costmap update on %s, waiting for the next keyframe", topic_name_.c_str());
+    }
+    updates_synced_ = false;
+    return;
+  }
+  last_sequence_ = update->sequence;
+
+  if (update->keyframe) {
+    if (update->data.size() !=
+      static_cast<size_t>(update->metadata.size_x) * update->metadata.size_y)
+    {
+      updates_synced_ = false;
+      return;
+    }
+    matchMetadata(update->metadata);
+    std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+    std::copy(update->data.begin(), update->data.end(), costmap_->getCharMap());
+    updates_synced_ = true;
+    costmap_received_ = true;
+    ++version_;
+    return;
+  }
+
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+  if (!applyTiles(*update)) {
+    RCLCPP_WARN(node_logging_->get_logger(),
+      "Malformed costmap update on %s, waiting for the next keyframe", topic_name_.c_str());
+    updates_synced_ = false;
+    return;
+  }
+  ++version_;
+}
+
+bool CostmapSubscriber::applyTiles(const nav2_msgs::msg::CostmapUpdate & update)
+{
+  const unsigned int size_x = costmap_->getSizeInCellsX();
+  const unsigned int size_y = costmap_->getSizeInCellsY();
+  const unsigned int tile = update.tile_size;
+  if (tile == 0 || update.metadata.size_x != size_x || update.metadata.size_y != size_y) {
+    return false;
+  }
+
+  const unsigned int tiles_x = (size_x + tile - 1) / tile;
+  const unsigned int tiles_y = (size_y + tile - 1) / tile;
+  unsigned char * master_array = costmap_->getCharMap();
+  size_t offset = 0;
+  for (unsigned int index : update.tiles) {
+    unsigned int tx = index % tiles_x, ty = index / tiles_x;
+    if (ty >= tiles_y) {
+      return false;
+    }
+    unsigned int cx0 = tx * tile, cy0 = ty * tile;
+    unsigned int width = std::min(tile, size_x - cx0), height = std::min(tile, size_y - cy0);
+    if (offset + static_cast<size_t>(width) * height > update.data.size()) {
+      return false;
+    }
+    for (unsigned int y = cy0; y < cy0 + height; ++y) {
+      std::copy(update.data.begin() + offset, update.data.begin() + offset + width,
+        master_array + y * size_x + cx0);
+      offset += width;
+    }
+  }
+  return offset == update.data.size();
+}
+
 }  // namespace nav2_costmap_2d
@@ -0,0 +1,116 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/dirty_regions.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+MapRegion boundingBox(const MapRegion & a, const MapRegion & b)
+{
+  return {std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.xn, b.xn), std::max(a.yn, b.yn)};
+}
+
+bool overlap(const MapRegion & a, const MapRegion & b)
+{
+  return a.x0 < b.xn && b.x0 < a.xn && a.y0 < b.yn && b.y0 < a.yn;
+}
+
+}  // namespace
+
+DirtyRegions::DirtyRegions(size_t max_regions)
+: max_regions_(std::max<size_t>(max_regions, 1))
+{
+}
+
+void DirtyRegions::setMaxRegions(size_t max_regions)
+{
+  max_regions_ = std::max<size_t>(max_regions, 1);
+  while (regions_.size() > max_regions_) {
+    mergeCheapest();
+  }
+}
+
+void DirtyRegions::add(int x0, int y0, int xn, int yn)
+{
+  if (x0 >= xn || y0 >= yn) {
+    return;
+  }
+
+  // a merged region may reach ones it missed before, so go round until nothing merges
+  MapRegion region{x0, y0, xn, yn};
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (size_t i = 0; i < regions_.size(); ++i) {
+      MapRegion box = boundingBox(region, regions_[i]);
+      if (overlap(region, regions_[i]) || box.area() <= region.area() + regions_[i].area()) {
+        region = box;
+        regions_[i] = regions_.back();
+        regions_.pop_back();
+        merged = true;
+        break;
+      }
+    }
+  }
+  regions_.push_back(region);
+
+  while (regions_.size() > max_regions_) {
+    mergeCheapest();
+  }
+}
+
+MapRegion DirtyRegions::bounds() const
+{
+  if (regions_.empty()) {
+    return {0, 0, 0, 0};
+  }
+  MapRegion box = regions_[0];
+  for (const MapRegion & region : regions_) {
+    box = boundingBox(box, region);
+  }
+  return box;
+}
+
+void DirtyRegions::mergeCheapest()
+{
+  size_t best_i = 0, best_j = 1;
+  int64_t best_waste = std::numeric_limits<int64_t>::max();
+  for (size_t i = 0; i < regions_.size(); ++i) {
+    for (size_t j = i + 1; j < regions_.size(); ++j) {
+      int64_t waste = boundingBox(regions_[i], regions_[j]).area() -
+        regions_[i].area() - regions_[j].area();
+      if (waste < best_waste) {
+        best_waste = waste;
+        best_i = i;
+        best_j = j;
+      }
+    }
+  }
+
+  MapRegion box = boundingBox(regions_[best_i], regions_[best_j]);
+  regions_[best_j] = regions_.back();
+  regions_.pop_back();
+  regions_[best_i] = regions_.back();
+  regions_.pop_back();
+  add(box);
+}
+
+}  // namespace nav2_costmap_2d
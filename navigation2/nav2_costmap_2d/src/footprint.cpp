@@ -29,13 +29,16 @@
 #include "nav2_costmap_2d/footprint.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "geometry_msgs/msg/point32.hpp"
 #include "nav2_costmap_2d/array_parser.hpp"
 #include "nav2_costmap_2d/costmap_math.hpp"
+#include "nav2_util/line_traversal.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -210,4 +213,102 @@ bool makeFootprintFromString(
   return true;
 }
 
+FootprintMasks::FootprintMasks(unsigned int yaw_bins)
+: yaw_bins_(yaw_bins), outlines_(yaw_bins), fills_(yaw_bins)
+{
+}
+
+bool FootprintMasks::setFootprint(
+  const std::vector<geometry_msgs::msg::Point> & footprint_spec, double resolution)
+{
+  bool same_footprint = resolution == resolution_ &&
+    footprint_spec.size() == footprint_spec_.size();
+  for (unsigned int i = 0; same_footprint && i < footprint_spec.size(); ++i) {
+    same_footprint = std::hypot(footprint_spec[i].x - footprint_spec_[i].x,
+        footprint_spec[i].y - footprint_spec_[i].y) < resolution / 4;
+  }
+  if (same_footprint) {
+    return false;
+  }
+
+  footprint_spec_ = footprint_spec;
+  resolution_ = resolution;
+  outlines_.assign(yaw_bins_, std::vector<std::pair<int, int>>());
+  fills_.assign(yaw_bins_, std::vector<FootprintSpan>());
+  double radius = 0.0;
+  for (const auto & point : footprint_spec_) {
+    radius = std::max(radius, std::hypot(point.x, point.y));
+  }
+  radius_ = static_cast<int>(std::ceil(radius / resolution_)) + 1;
+  return true;
+}
+
+const std::vector<std::pair<int, int>> & FootprintMasks::outline(double theta)
+{
+  unsigned int b = bin(theta);
+  if (outlines_[b].empty()) {
+    build(b);
+  }
+  return outlines_[b];
+}
+
+const std::vector<FootprintSpan> & FootprintMasks::fill(double theta)
+{
+  unsigned int b = bin(theta);
+  if (outlines_[b].empty()) {
+    build(b);
+  }
+  return fills_[b];
+}
+
+unsigned int FootprintMasks::bin(double theta) const
+{
+  double turns = theta / (2 * M_PI);
+  return static_cast<unsigned int>(std::lround((turns - std::floor(turns)) * yaw_bins_)) %
+         yaw_bins_;
+}
+
+void FootprintMasks::build(unsigned int bin)
+{
+  // the outline of the footprint at the bin's yaw, for a pose at the center of cell (0, 0)
+  double theta = 2 * M_PI * bin / yaw_bins_;
+  double cos_th = cos(theta), sin_th = sin(theta);
+  std::vector<std::pair<int, int>> vertices;
+  for (const auto & point : footprint_spec_) {
+    double x = point.x * cos_th - point.y * sin_th;
+    double y = point.x * sin_th + point.y * cos_th;
+    vertices.emplace_back(static_cast<int>(std::floor(x / resolution_ + 0.5)),
+      static_cast<int>(std::floor(y / resolution_ + 0.5)));
+  }
+
+  std::vector<std::pair<int, int>> & cells = outlines_[bin];
+  for (unsigned int i = 0; i < vertices.size(); ++i) {
+    const auto & start = vertices[i];
+    const auto & end = vertices[(i + 1) % vertices.size()];
+    nav2_util::traceCells(start.first, start.second, end.first, end.second,
+      [&cells](int x, int y) {cells.emplace_back(x, y);});
+  }
+  std::sort(cells.begin(), cells.end());
+  cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+  if (cells.empty()) {
+    return;
+  }
+
+  // a convex footprint covers each row between the ends of its outline on that row
+  int min_y = cells.front().second, max_y = min_y;
+  for (const auto & cell : cells) {
+    min_y = std::min(min_y, cell.second);
+    max_y = std::max(max_y, cell.second);
+  }
+  std::vector<FootprintSpan> & spans = fills_[bin];
+  for (int y = min_y; y <= max_y; ++y) {
+    spans.push_back({y, std::numeric_limits<int>::max(), std::numeric_limits<int>::min()});
+  }
+  for (const auto & cell : cells) {
+    FootprintSpan & span = spans[cell.second - min_y];
+    span.min_x = std::min(span.min_x, cell.first);
+    span.max_x = std::max(span.max_x, cell.first);
+  }
+}
+
 }  // end namespace nav2_costmap_2d
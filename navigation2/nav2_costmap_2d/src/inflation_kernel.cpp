@@ -0,0 +1,189 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/inflation_kernel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+const size_t CACHE_LINE = 64;
+
+size_t roundUp(size_t bytes)
+{
+  return (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+}
+
+inline void combineRow(
+  unsigned char * out, const unsigned char * stamp, int count, unsigned char unknown_threshold)
+{
+  for (int i = 0; i < count; ++i) {
+    unsigned char old_cost = out[i];
+    unsigned char cost = stamp[i];
+    unsigned char known = old_cost > cost ? old_cost : cost;
+    unsigned char unknown = cost >= unknown_threshold ? cost : old_cost;
+    out[i] = old_cost == NO_INFORMATION ? unknown : known;
+  }
+}
+
+// With the radius known the row loop has a fixed count, which the compiler unrolls or
+// vectorizes whole
+template<int R>
+void stampFixed(
+  unsigned char * grid, int size_x, int x, int y, const unsigned char * stamp,
+  size_t stride, unsigned char unknown_threshold)
+{
+  unsigned char * out = grid + static_cast<ptrdiff_t>(y - R) * size_x + (x - R);
+  for (int row = 0; row < 2 * R + 1; ++row) {
+    combineRow(out, stamp, 2 * R + 1, unknown_threshold);
+    out += size_x;
+    stamp += stride;
+  }
+}
+
+template<int R>
+struct StampDispatch
+{
+  static bool run(
+    int radius, unsigned char * grid, int size_x, int x, int y, const unsigned char * stamp,
+    size_t stride, unsigned char unknown_threshold)
+  {
+    if (radius == R) {
+      stampFixed<R>(grid, size_x, x, y, stamp, stride, unknown_threshold);
+      return true;
+    }
+    return StampDispatch<R - 1>::run(radius, grid, size_x, x, y, stamp, stride,
+             unknown_threshold);
+  }
+};
+
+template<>
+struct StampDispatch<0>
+{
+  static bool run(
+    int, unsigned char *, int, int, int, const unsigned char *, size_t, unsigned char)
+  {
+    return false;
+  }
+};
+
+}  // namespace
+
+void InflationKernel::build(
+  unsigned int radius, const std::function<unsigned char(double)> & cost_of)
+{
+  // the distances and costs go one cell past the radius, for the wavefront's range check
+  size_t side = radius + 2;
+  size_t stamp_side = 2 * radius + 1;
+  size_t distance_bytes = roundUp(side * sizeof(double));
+  size_t cost_bytes = roundUp(side);
+  size_t stamp_bytes = roundUp(stamp_side);
+  size_t total = side * distance_bytes + side * cost_bytes + stamp_side * stamp_bytes;
+
+  if (radius != radius_ || !storage_) {
+    storage_.reset(new unsigned char[total + CACHE_LINE]);
+    uintptr_t base = reinterpret_cast<uintptr_t>(storage_.get());
+    unsigned char * aligned = storage_.get() + (CACHE_LINE - base % CACHE_LINE) % CACHE_LINE;
+    distances_ = reinterpret_cast<double *>(aligned);
+    costs_ = aligned + side * distance_bytes;
+    stamp_ = costs_ + side * cost_bytes;
+    radius_ = radius;
+    distance_stride_ = distance_bytes / sizeof(double);
+    cost_stride_ = cost_bytes;
+    stamp_stride_ = stamp_bytes;
+  }
+
+  for (size_t i = 0; i < side; ++i) {
+    for (size_t j = 0; j < side; ++j) {
+      distances_[i * distance_stride_ + j] = std::hypot(i, j);
+      costs_[i * cost_stride_ + j] = cost_of(distances_[i * distance_stride_ + j]);
+    }
+  }
+
+  // the squared distances are integers, equal exactly when the distances are
+  std::vector<size_t> sq_distances;
+  for (size_t i = 0; i < side; ++i) {
+    for (size_t j = 0; j < side; ++j) {
+      if (distance(i, j) <= radius) {
+        sq_distances.push_back(i * i + j * j);
+      }
+    }
+  }
+  std::sort(sq_distances.begin(), sq_distances.end());
+  sq_distances.erase(std::unique(sq_distances.begin(), sq_distances.end()), sq_distances.end());
+  rank_count_ = sq_distances.size();
+  ranks_.assign(side * side, rank_count_);
+  for (size_t i = 0; i < side; ++i) {
+    for (size_t j = 0; j < side; ++j) {
+      if (distance(i, j) <= radius) {
+        ranks_[i * side + j] = std::lower_bound(sq_distances.begin(), sq_distances.end(),
+            i * i + j * j) - sq_distances.begin();
+      }
+    }
+  }
+
+  int r = static_cast<int>(radius);
+  memset(stamp_, 0, stamp_side * stamp_stride_);
+  for (int dy = -r; dy <= r; ++dy) {
+    unsigned char * row = stamp_ + (dy + r) * stamp_stride_;
+    for (int dx = -r; dx <= r; ++dx) {
+      if (distance(std::abs(dx), std::abs(dy)) <= radius) {
+        row[dx + r] = cost(std::abs(dx), std::abs(dy));
+      }
+    }
+  }
+}
+
+void InflationKernel::stamp(
+  unsigned char * grid, int size_x, int size_y, int x, int y,
+  unsigned char unknown_threshold) const
+{
+  int r = static_cast<int>(radius_);
+  if (x >= r && y >= r && x + r < size_x && y + r < size_y &&
+    StampDispatch<MAX_UNROLLED_RADIUS>::run(r, grid, size_x, x, y, stamp_, stamp_stride_,
+    unknown_threshold))
+  {
+    return;
+  }
+  stampGeneric(grid, size_x, size_y, x, y, unknown_threshold);
+}
+
+void InflationKernel::stampGeneric(
+  unsigned char * grid, int size_x, int size_y, int x, int y,
+  unsigned char unknown_threshold) const
+{
+  int r = static_cast<int>(radius_);
+  int min_i = std::max(x - r, 0), max_i = std::min(x + r + 1, size_x);
+  int min_j = std::max(y - r, 0), max_j = std::min(y + r + 1, size_y);
+  if (min_i >= max_i) {
+    return;
+  }
+  for (int j = min_j; j < max_j; ++j) {
+    const unsigned char * row = stamp_ + (j - y + r) * stamp_stride_ + (min_i - x + r);
+    combineRow(grid + static_cast<ptrdiff_t>(j) * size_x + min_i, row, max_i - min_i,
+      unknown_threshold);
+  }
+}
+
+}  // namespace nav2_costmap_2d
@@ -43,6 +43,24 @@ Layer::Layer()
   enabled_(false)
 {}
 
+void
+Layer::updateRegions(
+  double robot_x, double robot_y, double robot_yaw, bool deferred,
+  std::vector<WorldBounds> & regions)
+{
+  WorldBounds bounds{1e30, 1e30, -1e30, -1e30};
+  if (deferred) {
+    deferBounds(robot_x, robot_y, robot_yaw,
+      &bounds.min_x, &bounds.min_y, &bounds.max_x, &bounds.max_y);
+  } else {
+    updateBounds(robot_x, robot_y, robot_yaw,
+      &bounds.min_x, &bounds.min_y, &bounds.max_x, &bounds.max_y);
+  }
+  if (bounds.min_x <= bounds.max_x && bounds.min_y <= bounds.max_y) {
+    regions.push_back(bounds);
+  }
+}
+
 void
 Layer::initialize(
   LayeredCostmap * parent, std::string name, tf2_ros::Buffer * tf,
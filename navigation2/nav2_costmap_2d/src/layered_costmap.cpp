@@ -38,12 +38,14 @@
 #include "nav2_costmap_2d/layered_costmap.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "nav2_costmap_2d/footprint.hpp"
+#include "nav2_util/tracing.hpp"
 
 
 using std::vector;
@@ -51,6 +53,11 @@ using std::vector;
 namespace nav2_costmap_2d
 {
 
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
 LayeredCostmap::LayeredCostmap(std::string global_frame, bool rolling_window, bool track_unknown)
 : costmap_(),
   global_frame_(global_frame),
@@ -67,7 +74,13 @@ LayeredCostmap::LayeredCostmap(std::string global_frame, bool rolling_window, bo
   initialized_(false),
   size_locked_(false),
   circumscribed_radius_(1.0),
-  inscribed_radius_(0.1)
+  inscribed_radius_(0.1),
+  update_tile_size_(0),
+  update_budget_(0.0),
+  max_deferrals_(0),
+  snapshots_enabled_(false),
+  memory_budget_(0),
+  update_trigger_(nullptr)
 {
   if (track_unknown) {
     costmap_.setDefaultValue(255);
@@ -83,20 +96,26 @@ LayeredCostmap::~LayeredCostmap()
   }
 }
 
-void LayeredCostmap::resizeMap(
+bool LayeredCostmap::resizeMap(
   unsigned int size_x, unsigned int size_y, double resolution,
   double origin_x,
   double origin_y,
   bool size_locked)
 {
   std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  if (memory_budget_ > 0 && estimateMemoryUsage(size_x, size_y) > memory_budget_) {
+    return false;
+  }
   size_locked_ = size_locked;
-  costmap_.resizeMap(size_x, size_y, resolution, origin_x, origin_y);
+  // the master keeps its costs where the layers keep theirs, so it is not published blank
+  // before the next update
+  costmap_.resizeMapKeepingCosts(size_x, size_y, resolution, origin_x, origin_y);
   for (vector<std::shared_ptr<Layer>>::iterator plugin = plugins_.begin();
     plugin != plugins_.end(); ++plugin)
   {
     (*plugin)->matchSize();
   }
+  return true;
 }
 
 void LayeredCostmap::updateMap(double robot_x, double robot_y, double robot_yaw)
@@ -113,12 +132,29 @@ void LayeredCostmap::updateMap(double robot_x, double robot_y, double robot_yaw)
     costmap_.updateOrigin(new_origin_x, new_origin_y);
   }
 
+  for (auto & plugin : plugins_) {
+    plugin->applyQueuedChanges();
+  }
+
   if (plugins_.size() == 0) {
+    if (snapshots_enabled_) {
+      updateSnapshot();
+    }
     return;
   }
 
+  NAV2_TRACEPOINT1(costmap_update_start, this);
+  auto cycle_start = std::chrono::steady_clock::now();
+  if (layer_timings_.size() != plugins_.size()) {
+    layer_timings_.resize(plugins_.size());
+    for (unsigned int i = 0; i < plugins_.size(); ++i) {
+      layer_timings_[i].name = plugins_[i]->getName();
+    }
+  }
   minx_ = miny_ = 1e30;
   maxx_ = maxy_ = -1e30;
+  const bool use_regions = dirty_regions_.getMaxRegions() > 1;
+  bounds_regions_.clear();
 
   for (vector<std::shared_ptr<Layer>>::iterator plugin = plugins_.begin();
     plugin != plugins_.end(); ++plugin)
@@ -127,7 +163,30 @@ void LayeredCostmap::updateMap(double robot_x, double robot_y, double robot_yaw)
     double prev_miny = miny_;
     double prev_maxx = maxx_;
     double prev_maxy = maxy_;
-    (*plugin)->updateBounds(robot_x, robot_y, robot_yaw, &minx_, &miny_, &maxx_, &maxy_);
+    LayerTiming & timing = layer_timings_[plugin - plugins_.begin()];
+    int index = static_cast<int>(plugin - plugins_.begin());
+    NAV2_TRACEPOINT2(costmap_layer_bounds_start, (*plugin)->getName().c_str(), index);
+    auto layer_start = std::chrono::steady_clock::now();
+    bool defer = shouldDefer(**plugin, timing, secondsSince(cycle_start));
+    if (use_regions) {
+      (*plugin)->updateRegions(robot_x, robot_y, robot_yaw, defer, bounds_regions_);
+    } else if (defer) {
+      (*plugin)->deferBounds(robot_x, robot_y, robot_yaw, &minx_, &miny_, &maxx_, &maxy_);
+    } else {
+      (*plugin)->updateBounds(robot_x, robot_y, robot_yaw, &minx_, &miny_, &maxx_, &maxy_);
+    }
+    timing.bounds_time = secondsSince(layer_start);
+    NAV2_TRACEPOINT3(costmap_layer_bounds_end, (*plugin)->getName().c_str(), index, defer);
+    if (defer) {
+      ++timing.deferrals;
+      ++timing.deferred_in_a_row;
+    } else {
+      timing.average_time = timing.updates == 0 ? timing.bounds_time :
+        0.8 * timing.average_time + 0.2 * timing.bounds_time;
+      ++timing.updates;
+      timing.deferred_in_a_row = 0;
+    }
+    timing.max_time = std::max(timing.max_time, timing.bounds_time);
     if (minx_ > prev_minx || miny_ > prev_miny || maxx_ < prev_maxx || maxy_ < prev_maxy) {
       RCLCPP_WARN(rclcpp::get_logger(
           "nav2_costmap_2d"), "Illegal bounds change, was [tl: (%f, %f), br: (%f, %f)], but "
@@ -138,35 +197,276 @@ void LayeredCostmap::updateMap(double robot_x, double robot_y, double robot_yaw)
     }
   }
 
-  int x0, xn, y0, yn;
-  costmap_.worldToMapEnforceBounds(minx_, miny_, x0, y0);
-  costmap_.worldToMapEnforceBounds(maxx_, maxy_, xn, yn);
+  if (use_regions) {
+    for (const WorldBounds & bounds : bounds_regions_) {
+      minx_ = std::min(minx_, bounds.min_x);
+      miny_ = std::min(miny_, bounds.min_y);
+      maxx_ = std::max(maxx_, bounds.max_x);
+      maxy_ = std::max(maxy_, bounds.max_y);
+    }
+  } else {
+    bounds_regions_.push_back({minx_, miny_, maxx_, maxy_});
+  }
 
-  x0 = std::max(0, x0);
-  xn = std::min(static_cast<int>(costmap_.getSizeInCellsX()), xn + 1);
-  y0 = std::max(0, y0);
-  yn = std::min(static_cast<int>(costmap_.getSizeInCellsY()), yn + 1);
+  dirty_regions_.clear();
+  for (const WorldBounds & bounds : bounds_regions_) {
+    int x0, xn, y0, yn;
+    costmap_.worldToMapEnforceBounds(bounds.min_x, bounds.min_y, x0, y0);
+    costmap_.worldToMapEnforceBounds(bounds.max_x, bounds.max_y, xn, yn);
 
-  RCLCPP_DEBUG(rclcpp::get_logger(
-      "nav2_costmap_2d"), "Updating area x: [%d, %d] y: [%d, %d]", x0, xn, y0, yn);
+    x0 = std::max(0, x0);
+    xn = std::min(static_cast<int>(costmap_.getSizeInCellsX()), xn + 1);
+    y0 = std::max(0, y0);
+    yn = std::min(static_cast<int>(costmap_.getSizeInCellsY()), yn + 1);
+    dirty_regions_.add(x0, y0, xn, yn);
+  }
 
-  if (xn < x0 || yn < y0) {
+  if (dirty_regions_.empty()) {
+    if (snapshots_enabled_) {
+      updateSnapshot();
+    }
+    NAV2_TRACEPOINT1(costmap_update_end, this);
     return;
   }
 
-  costmap_.resetMap(x0, y0, xn, yn);
+  const vector<MapRegion> & regions = dirty_regions_.get();
+  MapRegion box = dirty_regions_.bounds();
+  RCLCPP_DEBUG(rclcpp::get_logger(
+      "nav2_costmap_2d"), "Updating area x: [%d, %d] y: [%d, %d] in %zu regions",
+    box.x0, box.xn, box.y0, box.yn, regions.size());
+
+  // every region is reset before any layer runs, so that layers reaching past a region,
+  // such as inflation, never read the previous cycle's costs in another one
+  for (const MapRegion & region : regions) {
+    costmap_.resetMap(region.x0, region.y0, region.xn, region.yn);
+  }
   for (vector<std::shared_ptr<Layer>>::iterator plugin = plugins_.begin();
-    plugin != plugins_.end(); ++plugin)
+    plugin != plugins_.end(); )
   {
-    (*plugin)->updateCosts(costmap_, x0, y0, xn, yn);
+    int index = static_cast<int>(plugin - plugins_.begin());
+    auto layer_start = std::chrono::steady_clock::now();
+    if (!update_pool_ || !(*plugin)->isTileSafe()) {
+      NAV2_TRACEPOINT2(costmap_layer_costs_start, (*plugin)->getName().c_str(), index);
+      for (const MapRegion & region : regions) {
+        (*plugin)->updateCosts(costmap_, region.x0, region.y0, region.xn, region.yn);
+      }
+      layer_timings_[index].costs_time = secondsSince(layer_start);
+      NAV2_TRACEPOINT2(costmap_layer_costs_end, (*plugin)->getName().c_str(), index);
+      ++plugin;
+      continue;
+    }
+
+    vector<std::shared_ptr<Layer>>::iterator last = plugin;
+    while (last != plugins_.end() && (*last)->isTileSafe()) {
+      ++last;
+    }
+    // the layers of a tiled run are traced as one, by the first layer and how many there are
+    int count = static_cast<int>(last - plugin);
+    NAV2_TRACEPOINT2(costmap_tiled_costs_start, index, count);
+    for (const MapRegion & region : regions) {
+      updateCostsTiled(plugin, last, region.x0, region.y0, region.xn, region.yn);
+    }
+    NAV2_TRACEPOINT2(costmap_tiled_costs_end, index, count);
+
+    // the layers of a tiled run are interleaved, so share its time between them
+    double share = secondsSince(layer_start) / (last - plugin);
+    for (; plugin != last; ++plugin) {
+      layer_timings_[plugin - plugins_.begin()].costs_time = share;
+    }
   }
 
-  bx0_ = x0;
-  bxn_ = xn;
-  by0_ = y0;
-  byn_ = yn;
+  for (LayerTiming & timing : layer_timings_) {
+    timing.max_time = std::max(timing.max_time, timing.bounds_time + timing.costs_time);
+  }
+
+  bx0_ = box.x0;
+  bxn_ = box.xn;
+  by0_ = box.y0;
+  byn_ = box.yn;
 
   initialized_ = true;
+
+  if (pyramid_.getLevels() > 0) {
+    for (const MapRegion & region : regions) {
+      pyramid_.update(costmap_, region.x0, region.y0, region.xn, region.yn);
+    }
+  }
+
+  if (snapshots_enabled_) {
+    updateSnapshot();
+  }
+  NAV2_TRACEPOINT1(costmap_update_end, this);
+}
+
+void LayeredCostmap::updateSnapshot()
+{
+  // the spare is no longer published, so once its last reader lets go no new
+  // one can appear and it is safe to overwrite
+  std::shared_ptr<Costmap2D> next = std::move(spare_snapshot_);
+  if (!next || next.use_count() > 1) {
+    next = std::make_shared<Costmap2D>(costmap_);
+  } else {
+    *next = costmap_;
+  }
+
+  std::shared_ptr<const Costmap2D> previous = std::atomic_load(&snapshot_);
+  std::atomic_store(&snapshot_, std::shared_ptr<const Costmap2D>(next));
+  spare_snapshot_ = std::const_pointer_cast<Costmap2D>(previous);
+}
+
+void LayeredCostmap::setSnapshots(bool enabled)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  snapshots_enabled_ = enabled;
+  if (!enabled) {
+    std::atomic_store(&snapshot_, std::shared_ptr<const Costmap2D>());
+    spare_snapshot_.reset();
+  }
+}
+
+void LayeredCostmap::setPyramidLevels(unsigned int levels)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  pyramid_.setLevels(levels);
+  if (levels > 0) {
+    pyramid_.rebuild(costmap_);
+  }
+}
+
+void LayeredCostmap::setMemoryBudget(size_t budget)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  memory_budget_ = budget;
+}
+
+double LayeredCostmap::getMasterMemoryPerCell() const
+{
+  // two snapshots are kept, and each pyramid level has a quarter of the cells of the last
+  double per_cell = snapshots_enabled_ ? 3.0 : 1.0;
+  double level = 1.0;
+  for (unsigned int i = 0; i < pyramid_.getLevels(); ++i) {
+    level /= 4.0;
+    per_cell += level;
+  }
+  return per_cell;
+}
+
+std::vector<LayerMemory> LayeredCostmap::getMemoryUsage()
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  std::vector<LayerMemory> usage;
+  LayerMemory master{"master", static_cast<size_t>(costmap_.getSizeInCellsX()) *
+    costmap_.getSizeInCellsY()};
+  auto snapshot = std::atomic_load(&snapshot_);
+  for (const Costmap2D * copy : {snapshot.get(), static_cast<const Costmap2D *>(
+      spare_snapshot_.get())})
+  {
+    if (copy && copy != &costmap_) {
+      master.bytes += static_cast<size_t>(copy->getSizeInCellsX()) * copy->getSizeInCellsY();
+    }
+  }
+  for (unsigned int level = 1; level <= pyramid_.getLevels(); ++level) {
+    master.bytes += static_cast<size_t>(pyramid_.getLevel(level).getSizeInCellsX()) *
+      pyramid_.getLevel(level).getSizeInCellsY();
+  }
+  usage.push_back(master);
+  for (const auto & plugin : plugins_) {
+    usage.push_back({plugin->getName(), plugin->getMemoryUsage()});
+  }
+  return usage;
+}
+
+size_t LayeredCostmap::estimateMemoryUsage(unsigned int size_x, unsigned int size_y)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  const double cells = static_cast<double>(size_x) * size_y;
+  const double current_cells = static_cast<double>(costmap_.getSizeInCellsX()) *
+    costmap_.getSizeInCellsY();
+
+  // what a layer holds beyond its cells stays as it is
+  double bytes = getMasterMemoryPerCell() * cells;
+  for (const auto & plugin : plugins_) {
+    const double per_cell = plugin->getMemoryPerCell();
+    const double fixed = static_cast<double>(plugin->getMemoryUsage()) - per_cell * current_cells;
+    bytes += per_cell * cells + std::max(0.0, fixed);
+  }
+  return static_cast<size_t>(bytes);
+}
+
+void LayeredCostmap::updateCostsTiled(
+  vector<std::shared_ptr<Layer>>::iterator first,
+  vector<std::shared_ptr<Layer>>::iterator last,
+  int x0, int y0, int xn, int yn)
+{
+  const int tile = static_cast<int>(update_tile_size_);
+  const int tiles_x = (xn - x0 + tile - 1) / tile;
+  const int tiles_y = (yn - y0 + tile - 1) / tile;
+
+  update_pool_->run([&](int index) {
+      int tx0 = x0 + (index % tiles_x) * tile;
+      int ty0 = y0 + (index / tiles_x) * tile;
+      int txn = std::min(tx0 + tile, xn);
+      int tyn = std::min(ty0 + tile, yn);
+      for (vector<std::shared_ptr<Layer>>::iterator plugin = first; plugin != last; ++plugin) {
+        (*plugin)->updateCosts(costmap_, tx0, ty0, txn, tyn);
+      }
+    }, tiles_x * tiles_y);
+}
+
+void LayeredCostmap::setParallelUpdate(unsigned int num_threads, unsigned int tile_size)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  if (num_threads > 1 && tile_size > 0) {
+    update_pool_ = std::make_unique<WorkerPool>(num_threads);
+    update_tile_size_ = tile_size;
+  } else {
+    update_pool_.reset();
+    update_tile_size_ = 0;
+  }
+}
+
+void LayeredCostmap::setMaxDirtyRegions(unsigned int max_regions)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  dirty_regions_.setMaxRegions(max_regions);
+}
+
+std::vector<MapRegion> LayeredCostmap::getDirtyRegions()
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  return dirty_regions_.get();
+}
+
+void LayeredCostmap::setUpdateBudget(double budget, unsigned int max_deferrals)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  update_budget_ = budget;
+  max_deferrals_ = max_deferrals;
+}
+
+std::vector<LayerTiming> LayeredCostmap::getLayerTimings()
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  return layer_timings_;
+}
+
+bool LayeredCostmap::shouldDefer(
+  const Layer & plugin, const LayerTiming & timing,
+  double elapsed) const
+{
+  // a layer runs at least once, so there is a cost to go by
+  if (update_budget_ <= 0.0 || !plugin.isDeferrable() || timing.updates == 0 ||
+    timing.deferred_in_a_row >= max_deferrals_)
+  {
+    return false;
+  }
+
+  // leave room for every layer's updateCosts(), as of the last cycle
+  double costs_time = 0.0;
+  for (const LayerTiming & layer_timing : layer_timings_) {
+    costs_time += layer_timing.costs_time;
+  }
+  return elapsed + timing.average_time + costs_time > update_budget_;
 }
 
 bool LayeredCostmap::isCurrent()
@@ -192,6 +492,7 @@ void LayeredCostmap::setFootprint(const std::vector<geometry_msgs::msg::Point> &
   {
     (*plugin)->onFootprintChanged();
   }
+  requestUpdate();
 }
 
 }  // namespace nav2_costmap_2d
@@ -37,10 +37,15 @@
 #include "nav2_costmap_2d/observation_buffer.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <list>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "nav2_costmap_2d/scan_projection.hpp"
 #include "tf2/convert.h"
 #include "sensor_msgs/point_cloud2_iterator.hpp"
 
@@ -55,10 +60,13 @@ ObservationBuffer::ObservationBuffer(
 : tf2_buffer_(tf2_buffer),
   observation_keep_time_(rclcpp::Duration::from_seconds(observation_keep_time)),
   expected_update_rate_(rclcpp::Duration::from_seconds(expected_update_rate)), nh_(nh),
-  last_updated_(nh->now()), global_frame_(global_frame), sensor_frame_(sensor_frame),
+  last_updated_(nh->now().nanoseconds()), clock_type_(nh->get_clock()->get_clock_type()),
+  global_frame_(global_frame), sensor_frame_(sensor_frame),
   topic_name_(topic_name),
   min_obstacle_height_(min_obstacle_height), max_obstacle_height_(max_obstacle_height),
-  obstacle_range_(obstacle_range), raytrace_range_(raytrace_range), tf_tolerance_(tf_tolerance)
+  obstacle_range_(obstacle_range), raytrace_range_(raytrace_range), tf_tolerance_(tf_tolerance),
+  deduplicate_(false), dedup_height_band_(0.0), dedup_cell_size_(0.0), dedup_origin_x_(0.0),
+  dedup_origin_y_(0.0)
 {
 }
 
@@ -82,27 +90,47 @@ bool ObservationBuffer::setGlobalFrame(const std::string new_global_frame)
     return false;
   }
 
-  std::list<Observation>::iterator obs_it;
-  for (obs_it = observation_list_.begin(); obs_it != observation_list_.end(); ++obs_it) {
-    try {
-      Observation & obs = *obs_it;
+  auto transform_observation = [&](Observation & obs) {
+      try {
+        geometry_msgs::msg::PointStamped origin;
+        origin.header.frame_id = global_frame_;
+        origin.header.stamp = transform_time;
+        origin.point = obs.origin_;
 
-      geometry_msgs::msg::PointStamped origin;
-      origin.header.frame_id = global_frame_;
-      origin.header.stamp = transform_time;
-      origin.point = obs.origin_;
+        // we need to transform the origin of the observation to the new global frame
+        tf2_buffer_.transform(origin, origin, new_global_frame);
+        obs.origin_ = origin.point;
 
-      // we need to transform the origin of the observation to the new global frame
-      tf2_buffer_.transform(origin, origin, new_global_frame);
-      obs.origin_ = origin.point;
+        // we also need to transform the cloud of the observation to the new global frame,
+        // into a new cloud as copies of the observation may still be reading the old one
+        auto cloud = std::make_shared<sensor_msgs::msg::PointCloud2>();
+        tf2_buffer_.transform(*(obs.cloud_), *cloud, new_global_frame);
+        obs.cloud_ = cloud;
+      } catch (tf2::TransformException & ex) {
+        RCLCPP_ERROR(rclcpp::get_logger(
+            "nav2_costmap_2d"),
+          "TF Error attempting to transform an observation from %s to %s: %s",
+          global_frame_.c_str(),
+          new_global_frame.c_str(), ex.what());
+        return false;
+      }
+      return true;
+    };
 
-      // we also need to transform the cloud of the observation to the new global frame
-      tf2_buffer_.transform(*(obs.cloud_), *(obs.cloud_), new_global_frame);
-    } catch (tf2::TransformException & ex) {
-      RCLCPP_ERROR(rclcpp::get_logger(
-          "nav2_costmap_2d"), "TF Error attempting to transform an observation from %s to %s: %s",
-        global_frame_.c_str(),
-        new_global_frame.c_str(), ex.what());
+  if (ring_) {
+    // the ring's observations are shared, so swap in transformed copies
+    for (size_t age = 0; age < ring_->size(); ++age) {
+      Observation obs = *ring_->at(age);
+      if (!transform_observation(obs)) {
+        return false;
+      }
+      ring_->replace(age, std::make_shared<const Observation>(obs));
+    }
+  }
+
+  std::list<Observation>::iterator obs_it;
+  for (obs_it = observation_list_.begin(); obs_it != observation_list_.end(); ++obs_it) {
+    if (!transform_observation(*obs_it)) {
       return false;
     }
   }
@@ -114,96 +142,332 @@ bool ObservationBuffer::setGlobalFrame(const std::string new_global_frame)
 
 void ObservationBuffer::bufferCloud(const sensor_msgs::msg::PointCloud2 & cloud)
 {
-  geometry_msgs::msg::PointStamped global_origin;
-
   // create a new observation on the list to be populated
-  observation_list_.push_front(Observation());
+  Observation & observation = startObservation();
 
-  // check whether the origin frame has been set explicitly
-  // or whether we should get it from the cloud
-  std::string origin_frame = sensor_frame_ == "" ? cloud.header.frame_id : sensor_frame_;
+  try {
+    // look up the cloud transform once and apply it ourselves while filtering,
+    // rather than transforming the whole cloud into an intermediate message
+    geometry_msgs::msg::TransformStamped cloud_transform = tf2_buffer_.lookupTransform(
+      global_frame_, cloud.header.frame_id, tf2_ros::fromMsg(cloud.header.stamp));
+
+    setOrigin(observation, cloud.header, cloud_transform);
+
+    tf2::Transform transform;
+    tf2::fromMsg(cloud_transform.transform, transform);
+
+    // fill a cloud of our own, which the observation and its copies then share
+    transformCloud(cloud, transform, *observation.cloud_);
+  } catch (tf2::TransformException & ex) {
+    // if an exception occurs, we need to remove the empty observation from the list
+    observation_list_.pop_front();
+    RCLCPP_ERROR(rclcpp::get_logger(
+        "nav2_costmap_2d"),
+      "TF Exception that should never happen for sensor frame: %s, cloud frame: %s, %s",
+      sensor_frame_.c_str(),
+      cloud.header.frame_id.c_str(), ex.what());
+    return;
+  }
+
+  // if the update was successful, we want to update the last updated time
+  last_updated_ = nh_->now().nanoseconds();
+
+  // we'll also remove any stale observations from the list, or hand the new one to the ring
+  if (ring_) {
+    publishToRing();
+  } else {
+    purgeStaleObservations();
+  }
+}
+
+void ObservationBuffer::bufferShared(const Observation & shared, float min_z, float max_z)
+{
+  const sensor_msgs::msg::PointCloud2 & cloud = *shared.cloud_;
+  Observation & observation = startObservation();
+
+  bool same_frame = cloud.header.frame_id == global_frame_;
+  bool deduplicate = deduplicate_ && dedup_cell_size_ > 0.0;
+  if (same_frame && !deduplicate && min_z >= min_obstacle_height_ &&
+    max_z <= max_obstacle_height_)
+  {
+    // every point is one we would keep, so the cloud is taken as it is, for nothing
+    const size_t max_pooled = 4;
+    if (cloud_pool_.size() < max_pooled) {
+      cloud_pool_.push_back(std::move(observation.cloud_));
+    }
+    observation.cloud_ = shared.cloud_;
+    observation.origin_ = shared.origin_;
+  } else {
+    try {
+      tf2::Transform transform = tf2::Transform::getIdentity();
+      if (!same_frame) {
+        // the whole cloud was taken at its stamp, so one transform moves all of it
+        tf2::fromMsg(tf2_buffer_.lookupTransform(global_frame_, cloud.header.frame_id,
+          tf2_ros::fromMsg(cloud.header.stamp)).transform, transform);
+      }
+      tf2::Vector3 origin = transform * tf2::Vector3(shared.origin_.x, shared.origin_.y,
+          shared.origin_.z);
+      observation.origin_.x = origin.x();
+      observation.origin_.y = origin.y();
+      observation.origin_.z = origin.z();
+      transformCloud(cloud, transform, *observation.cloud_);
+    } catch (tf2::TransformException & ex) {
+      observation_list_.pop_front();
+      RCLCPP_ERROR(rclcpp::get_logger(
+          "nav2_costmap_2d"),
+        "TF Exception for the shared observations of %s, from %s to %s: %s",
+        topic_name_.c_str(), cloud.header.frame_id.c_str(), global_frame_.c_str(), ex.what());
+      return;
+    }
+  }
+
+  // the ranges are this buffer's own
+  observation.raytrace_range_ = raytrace_range_;
+  observation.obstacle_range_ = obstacle_range_;
+  observation.polygon_max_gap_ = polygon_max_gap_;
+
+  last_updated_ = nh_->now().nanoseconds();
+  if (ring_) {
+    publishToRing();
+  } else {
+    purgeStaleObservations();
+  }
+}
+
+void ObservationBuffer::transformCloud(
+  const sensor_msgs::msg::PointCloud2 & cloud, const tf2::Transform & transform,
+  sensor_msgs::msg::PointCloud2 & observation_cloud)
+{
+  const tf2::Matrix3x3 & basis = transform.getBasis();
+  const tf2::Vector3 & origin = transform.getOrigin();
+  const float r00 = basis[0][0], r01 = basis[0][1], r02 = basis[0][2];
+  const float r10 = basis[1][0], r11 = basis[1][1], r12 = basis[1][2];
+  const float r20 = basis[2][0], r21 = basis[2][1], r22 = basis[2][2];
+  const float tx = origin.x(), ty = origin.y(), tz = origin.z();
+
+  observation_cloud.height = cloud.height;
+  observation_cloud.width = cloud.width;
+  observation_cloud.fields = cloud.fields;
+  observation_cloud.is_bigendian = cloud.is_bigendian;
+  observation_cloud.point_step = cloud.point_step;
+  observation_cloud.row_step = cloud.row_step;
+  observation_cloud.is_dense = cloud.is_dense;
+
+  unsigned int cloud_size = cloud.height * cloud.width;
+  sensor_msgs::PointCloud2Modifier modifier(observation_cloud);
+  modifier.resize(cloud_size);
+  unsigned int point_count = 0;
+
+  // the output points keep the layout of the input ones, so find where x, y and z go
+  sensor_msgs::PointCloud2ConstIterator<float> iter_x(cloud, "x");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud, "y");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_z(cloud, "z");
+  size_t x_offset = 0, y_offset = 0, z_offset = 0;
+  for (const auto & field : cloud.fields) {
+    if (field.name == "x") {
+      x_offset = field.offset;
+    } else if (field.name == "y") {
+      y_offset = field.offset;
+    } else if (field.name == "z") {
+      z_offset = field.offset;
+    }
+  }
+
+  // transform each point and keep those that are within our height bounds, and
+  // if deduplicating, only the first of them to land in each cell and band
+  bool deduplicate = deduplicate_ && dedup_cell_size_ > 0.0;
+  dedup_keys_.clear();
+  const unsigned char * in = cloud.data.data();
+  unsigned char * out = observation_cloud.data.data();
+  const size_t point_step = cloud.point_step;
+  for (unsigned int i = 0; i < cloud_size; ++i, ++iter_x, ++iter_y, ++iter_z, in += point_step) {
+    const float px = *iter_x, py = *iter_y, pz = *iter_z;
+    const float z = r20 * px + r21 * py + r22 * pz + tz;
+    if (z > max_obstacle_height_ || z < min_obstacle_height_) {
+      continue;
+    }
+    const float x = r00 * px + r01 * py + r02 * pz + tx;
+    const float y = r10 * px + r11 * py + r12 * pz + ty;
+
+    if (deduplicate && isDuplicate(x, y, z)) {
+      continue;
+    }
+
+    // carry over any other fields of the point untouched
+    std::memcpy(out, in, point_step);
+    std::memcpy(out + x_offset, &x, sizeof(float));
+    std::memcpy(out + y_offset, &y, sizeof(float));
+    std::memcpy(out + z_offset, &z, sizeof(float));
+    out += point_step;
+    ++point_count;
+  }
+
+  // resize the cloud for the number of legal points
+  modifier.resize(point_count);
+  observation_cloud.header.stamp = cloud.header.stamp;
+  observation_cloud.header.frame_id = global_frame_;
+}
+
+void ObservationBuffer::bufferScan(const sensor_msgs::msg::LaserScan & scan, bool inf_is_valid)
+{
+  // create a new observation on the list to be populated
+  Observation & observation = startObservation();
 
   try {
-    // given these observations come from sensors...
-    // we'll need to store the origin pt of the sensor
-    geometry_msgs::msg::PointStamped local_origin;
-    local_origin.header.stamp = cloud.header.stamp;
-    local_origin.header.frame_id = origin_frame;
-    local_origin.point.x = 0;
-    local_origin.point.y = 0;
-    local_origin.point.z = 0;
-    tf2_buffer_.transform(local_origin, global_origin, global_frame_);
-    tf2::convert(global_origin.point, observation_list_.front().origin_);
-
-    // make sure to pass on the raytrace/obstacle range
-    // of the observation buffer to the observations
-    observation_list_.front().raytrace_range_ = raytrace_range_;
-    observation_list_.front().obstacle_range_ = obstacle_range_;
-
-    sensor_msgs::msg::PointCloud2 global_frame_cloud;
-
-    // transform the point cloud
-    tf2_buffer_.transform(cloud, global_frame_cloud, global_frame_);
-    global_frame_cloud.header.stamp = cloud.header.stamp;
-
-    // now we need to remove observations from the cloud that are below
-    // or above our height thresholds
-    sensor_msgs::msg::PointCloud2 & observation_cloud = *(observation_list_.front().cloud_);
-    observation_cloud.height = global_frame_cloud.height;
-    observation_cloud.width = global_frame_cloud.width;
-    observation_cloud.fields = global_frame_cloud.fields;
-    observation_cloud.is_bigendian = global_frame_cloud.is_bigendian;
-    observation_cloud.point_step = global_frame_cloud.point_step;
-    observation_cloud.row_step = global_frame_cloud.row_step;
-    observation_cloud.is_dense = global_frame_cloud.is_dense;
-
-    unsigned int cloud_size = global_frame_cloud.height * global_frame_cloud.width;
-    sensor_msgs::PointCloud2Modifier modifier(observation_cloud);
-    modifier.resize(cloud_size);
-    unsigned int point_count = 0;
+    // the whole scan is taken at its stamp, as projecting it without tf does
+    geometry_msgs::msg::TransformStamped scan_transform = tf2_buffer_.lookupTransform(
+      global_frame_, scan.header.frame_id, tf2_ros::fromMsg(scan.header.stamp));
+    setOrigin(observation, scan.header, scan_transform);
+
+    tf2::Transform transform;
+    tf2::fromMsg(scan_transform.transform, transform);
+    const tf2::Matrix3x3 & basis = transform.getBasis();
+    ScanProjection projection;
+    for (int row = 0; row < 3; ++row) {
+      for (int col = 0; col < 3; ++col) {
+        projection.rotation[row][col] = basis[row][col];
+      }
+      projection.translation[row] = transform.getOrigin()[row];
+    }
+    projection.range_min = scan.range_min;
+    projection.range_max = scan.range_max;
+    if (inf_is_valid) {
+      // a tenth of a millimeter short of the maximum, to clear without marking
+      projection.inf_range = scan.range_max - 0.0001f;
+    }
+    projection.min_z = min_obstacle_height_;
+    projection.max_z = max_obstacle_height_;
 
-    // copy over the points that are within our height bounds
-    sensor_msgs::PointCloud2Iterator<float> iter_z(global_frame_cloud, "z");
-    std::vector<unsigned char>::const_iterator iter_global = global_frame_cloud.data.begin(),
-      iter_global_end = global_frame_cloud.data.end();
-    std::vector<unsigned char>::iterator iter_obs = observation_cloud.data.begin();
-    for (; iter_global != iter_global_end; ++iter_z, iter_global +=
-      global_frame_cloud.point_step)
+    // the beam angles only change with the scan configuration
+    const size_t beam_count = scan.ranges.size();
+    if (beam_count != scan_cos_.size() || scan.angle_min != scan_angle_min_ ||
+      scan.angle_increment != scan_angle_increment_)
     {
-      if ((*iter_z) <= max_obstacle_height_ &&
-        (*iter_z) >= min_obstacle_height_)
-      {
-        std::copy(iter_global, iter_global + global_frame_cloud.point_step, iter_obs);
-        iter_obs += global_frame_cloud.point_step;
-        ++point_count;
+      scan_angle_min_ = scan.angle_min;
+      scan_angle_increment_ = scan.angle_increment;
+      scan_cos_.resize(beam_count);
+      scan_sin_.resize(beam_count);
+      for (size_t i = 0; i < beam_count; ++i) {
+        double angle = static_cast<double>(scan.angle_min) + i * scan.angle_increment;
+        scan_cos_[i] = std::cos(angle);
+        scan_sin_[i] = std::sin(angle);
+      }
+      scan_x_.resize(beam_count);
+      scan_y_.resize(beam_count);
+      scan_z_.resize(beam_count);
+      scan_keep_.resize(beam_count);
+    }
+    projectScan(projection, scan.ranges.data(), scan_cos_.data(), scan_sin_.data(), beam_count,
+      scan_x_.data(), scan_y_.data(), scan_z_.data(), scan_keep_.data());
+
+    sensor_msgs::msg::PointCloud2 & observation_cloud = *observation.cloud_;
+    observation_cloud.height = 1;
+    observation_cloud.is_bigendian = false;
+    observation_cloud.is_dense = true;
+    sensor_msgs::PointCloud2Modifier modifier(observation_cloud);
+    modifier.setPointCloud2FieldsByString(1, "xyz");
+    modifier.resize(beam_count);
+
+    // gather the points kept into the cloud
+    bool deduplicate = deduplicate_ && dedup_cell_size_ > 0.0;
+    dedup_keys_.clear();
+    unsigned char * out = observation_cloud.data.data();
+    const size_t point_step = observation_cloud.point_step;
+    unsigned int point_count = 0;
+    for (size_t i = 0; i < beam_count; ++i) {
+      if (!scan_keep_[i] || (deduplicate && isDuplicate(scan_x_[i], scan_y_[i], scan_z_[i]))) {
+        continue;
       }
+      std::memcpy(out, &scan_x_[i], sizeof(float));
+      std::memcpy(out + sizeof(float), &scan_y_[i], sizeof(float));
+      std::memcpy(out + 2 * sizeof(float), &scan_z_[i], sizeof(float));
+      out += point_step;
+      ++point_count;
     }
 
-    // resize the cloud for the number of legal points
     modifier.resize(point_count);
-    observation_cloud.header.stamp = cloud.header.stamp;
-    observation_cloud.header.frame_id = global_frame_cloud.header.frame_id;
+    observation_cloud.header.stamp = scan.header.stamp;
+    observation_cloud.header.frame_id = global_frame_;
   } catch (tf2::TransformException & ex) {
     // if an exception occurs, we need to remove the empty observation from the list
     observation_list_.pop_front();
     RCLCPP_ERROR(rclcpp::get_logger(
         "nav2_costmap_2d"),
-      "TF Exception that should never happen for sensor frame: %s, cloud frame: %s, %s",
+      "TF Exception that should never happen for sensor frame: %s, scan frame: %s, %s",
       sensor_frame_.c_str(),
-      cloud.header.frame_id.c_str(), ex.what());
+      scan.header.frame_id.c_str(), ex.what());
     return;
   }
 
   // if the update was successful, we want to update the last updated time
-  last_updated_ = nh_->now();
+  last_updated_ = nh_->now().nanoseconds();
 
-  // we'll also remove any stale observations from the list
-  purgeStaleObservations();
+  // we'll also remove any stale observations from the list, or hand the new one to the ring
+  if (ring_) {
+    publishToRing();
+  } else {
+    purgeStaleObservations();
+  }
+}
+
+void ObservationBuffer::setOrigin(
+  Observation & observation, const std_msgs::msg::Header & header,
+  const geometry_msgs::msg::TransformStamped & sensor_transform)
+{
+  // check whether the origin frame has been set explicitly
+  // or whether we should get it from the message
+  std::string origin_frame = sensor_frame_ == "" ? header.frame_id : sensor_frame_;
+
+  // given these observations come from sensors...
+  // we'll need to store the origin pt of the sensor
+  if (origin_frame == header.frame_id) {
+    const geometry_msgs::msg::Vector3 & t = sensor_transform.transform.translation;
+    observation.origin_.x = t.x;
+    observation.origin_.y = t.y;
+    observation.origin_.z = t.z;
+  } else {
+    geometry_msgs::msg::PointStamped local_origin, global_origin;
+    local_origin.header.stamp = header.stamp;
+    local_origin.header.frame_id = origin_frame;
+    local_origin.point.x = 0;
+    local_origin.point.y = 0;
+    local_origin.point.z = 0;
+    tf2_buffer_.transform(local_origin, global_origin, global_frame_);
+    tf2::convert(global_origin.point, observation.origin_);
+  }
+
+  // make sure to pass on the raytrace/obstacle range
+  // of the observation buffer to the observations
+  observation.raytrace_range_ = raytrace_range_;
+  observation.obstacle_range_ = obstacle_range_;
+  observation.polygon_max_gap_ = polygon_max_gap_;
+}
+
+bool ObservationBuffer::isDuplicate(float x, float y, float z)
+{
+  // 21 bits per axis; cells that far apart never share a cloud
+  int64_t cx = static_cast<int64_t>(std::floor((x - dedup_origin_x_) / dedup_cell_size_));
+  int64_t cy = static_cast<int64_t>(std::floor((y - dedup_origin_y_) / dedup_cell_size_));
+  int64_t cz = dedup_height_band_ > 0.0 ?
+    static_cast<int64_t>(std::floor(z / dedup_height_band_)) : 0;
+  uint64_t key = (static_cast<uint64_t>(cx & 0x1FFFFF) << 42) |
+    (static_cast<uint64_t>(cy & 0x1FFFFF) << 21) | static_cast<uint64_t>(cz & 0x1FFFFF);
+  return !dedup_keys_.insert(key).second;
 }
 
 // returns a copy of the observations
 void ObservationBuffer::getObservations(std::vector<Observation> & observations)
 {
+  if (ring_) {
+    // the copies are small, as they share the clouds
+    std::vector<std::shared_ptr<const Observation>> shared;
+    getObservations(shared);
+    for (const auto & observation : shared) {
+      observations.push_back(*observation);
+    }
+    return;
+  }
+
   // first... let's make sure that we don't have any stale observations
   purgeStaleObservations();
 
@@ -214,13 +478,69 @@ void ObservationBuffer::getObservations(std::vector<Observation> & observations)
   }
 }
 
+void ObservationBuffer::getObservations(
+  std::vector<std::shared_ptr<const Observation>> & observations)
+{
+  if (ring_) {
+    // the stamps index the ring, so the stale observations are simply not looked at
+    int64_t oldest_ns = last_updated_.load() - observation_keep_time_.nanoseconds();
+    size_t max_count = observation_keep_time_ == rclcpp::Duration(0.0) ? 1 : ring_->capacity();
+    ring_->collect(oldest_ns, max_count, observations);
+    return;
+  }
+
+  purgeStaleObservations();
+  for (const auto & observation : observation_list_) {
+    observations.push_back(std::make_shared<const Observation>(observation));
+  }
+}
+
+void ObservationBuffer::enableRing(size_t capacity)
+{
+  ring_ = std::make_unique<ObservationRing>(capacity);
+  eraseObservations(observation_list_.begin());
+}
+
+void ObservationBuffer::publishToRing()
+{
+  auto observation = std::make_shared<const Observation>(std::move(observation_list_.front()));
+  spare_observations_.splice(spare_observations_.begin(), observation_list_,
+    observation_list_.begin());
+  int64_t stamp_ns = rclcpp::Time(observation->cloud_->header.stamp).nanoseconds();
+  std::shared_ptr<const Observation> evicted = ring_->push(observation, stamp_ns);
+
+  // the evicted cloud is reused once the reader lets go of it too
+  const size_t max_pooled = 4;
+  if (evicted && cloud_pool_.size() < max_pooled) {
+    cloud_pool_.push_back(evicted->cloud_);
+  }
+}
+
+void ObservationBuffer::enableDeduplication(double height_band)
+{
+  deduplicate_ = true;
+  dedup_height_band_ = height_band;
+}
+
+void ObservationBuffer::setDeduplicationGrid(double cell_size, double origin_x, double origin_y)
+{
+  dedup_cell_size_ = cell_size;
+  dedup_origin_x_ = origin_x;
+  dedup_origin_y_ = origin_y;
+}
+
+void ObservationBuffer::enablePolygonClearing(double max_gap)
+{
+  polygon_max_gap_ = max_gap;
+}
+
 void ObservationBuffer::purgeStaleObservations()
 {
   if (!observation_list_.empty()) {
     std::list<Observation>::iterator obs_it = observation_list_.begin();
     // if we're keeping observations for no time... then we'll only keep one observation
     if (observation_keep_time_ == rclcpp::Duration(0.0)) {
-      observation_list_.erase(++obs_it, observation_list_.end());
+      eraseObservations(++obs_it);
       return;
     }
 
@@ -229,33 +549,98 @@ void ObservationBuffer::purgeStaleObservations()
       Observation & obs = *obs_it;
       // check if the observation is out of date... and if it is,
       // remove it and those that follow from the list
-      if ((last_updated_ - obs.cloud_->header.stamp) > observation_keep_time_) {
-        observation_list_.erase(obs_it, observation_list_.end());
+      if ((rclcpp::Time(last_updated_.load(), clock_type_) - obs.cloud_->header.stamp) >
+        observation_keep_time_)
+      {
+        eraseObservations(obs_it);
         return;
       }
     }
   }
 }
 
+void ObservationBuffer::eraseObservations(std::list<Observation>::iterator first)
+{
+  // a few spare clouds cover the observations a layer may still be reading
+  const size_t max_pooled = 4;
+  for (auto obs_it = first; obs_it != observation_list_.end(); ++obs_it) {
+    if (cloud_pool_.size() < max_pooled) {
+      cloud_pool_.push_back(std::move(obs_it->cloud_));
+    }
+    obs_it->cloud_.reset();
+  }
+  spare_observations_.splice(spare_observations_.end(), observation_list_, first,
+    observation_list_.end());
+  while (spare_observations_.size() > max_pooled) {
+    spare_observations_.pop_back();
+  }
+}
+
+Observation & ObservationBuffer::startObservation()
+{
+  if (spare_observations_.empty()) {
+    observation_list_.emplace_front(takePooledCloud());
+  } else {
+    observation_list_.splice(observation_list_.begin(), spare_observations_,
+      spare_observations_.begin());
+    observation_list_.front() = Observation(takePooledCloud());
+  }
+  return observation_list_.front();
+}
+
+std::shared_ptr<sensor_msgs::msg::PointCloud2> ObservationBuffer::takePooledCloud()
+{
+  // a pooled cloud can only be handed out again once no copied observation refers to it
+  for (auto pool_it = cloud_pool_.begin(); pool_it != cloud_pool_.end(); ++pool_it) {
+    if (pool_it->use_count() == 1) {
+      std::shared_ptr<sensor_msgs::msg::PointCloud2> cloud = *pool_it;
+      cloud_pool_.erase(pool_it);
+      return cloud;
+    }
+  }
+  return std::make_shared<sensor_msgs::msg::PointCloud2>();
+}
+
 bool ObservationBuffer::isCurrent() const
 {
   if (expected_update_rate_ == rclcpp::Duration(0.0)) {
     return true;
   }
 
-  bool current = (nh_->now() - last_updated_) <= expected_update_rate_;
+  rclcpp::Time last_updated(last_updated_.load(), clock_type_);
+  bool current = (nh_->now() - last_updated) <= expected_update_rate_;
   if (!current) {
     RCLCPP_WARN(rclcpp::get_logger(
         "nav2_costmap_2d"),
       "The %s observation buffer has not been updated for %.2f seconds, and it should be updated every %.2f seconds.", //NOLINT
       topic_name_.c_str(),
-      (nh_->now() - last_updated_).seconds(), expected_update_rate_.seconds());
+      (nh_->now() - last_updated).seconds(), expected_update_rate_.seconds());
   }
   return current;
 }
 
+size_t ObservationBuffer::getMemoryUsage()
+{
+  std::lock_guard<std::recursive_mutex> guard(lock_);
+  auto cloud_bytes = [](const sensor_msgs::msg::PointCloud2 & cloud) {
+      return sizeof(cloud) + cloud.data.capacity();
+    };
+  size_t bytes = 0;
+  for (const Observation & observation : observation_list_) {
+    bytes += sizeof(observation) + cloud_bytes(*observation.cloud_);
+  }
+  for (const Observation & observation : spare_observations_) {
+    bytes += sizeof(observation);
+  }
+  for (const auto & cloud : cloud_pool_) {
+    bytes += cloud_bytes(*cloud);
+  }
+  return bytes + (scan_cos_.capacity() + scan_sin_.capacity() + scan_x_.capacity() +
+         scan_y_.capacity() + scan_z_.capacity()) * sizeof(float) + scan_keep_.capacity();
+}
+
 void ObservationBuffer::resetLastUpdated()
 {
-  last_updated_ = nh_->now();
+  last_updated_ = nh_->now().nanoseconds();
 }
 }  // namespace nav2_costmap_2d
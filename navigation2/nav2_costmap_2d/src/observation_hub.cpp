@@ -0,0 +1,400 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/observation_hub.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "laser_geometry/laser_geometry.hpp"
+#include "message_filters/subscriber.h"
+#include "nav2_util/metrics.hpp"
+#include "nav2_util/transform_scheduler.hpp"
+#include "sensor_msgs/point_cloud2_iterator.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @brief One shared sensor, with the buffers of the layers that take its observations
+ */
+class ObservationHub::Source
+{
+public:
+  explicit Source(const SourceKey & key)
+  : key_(key)
+  {
+  }
+
+  ~Source()
+  {
+    detach();
+  }
+
+  uint64_t add(
+    const Host & host, std::shared_ptr<ObservationBuffer> buffer,
+    std::function<void()> on_update);
+  void remove(uint64_t id);
+  void setActive(uint64_t id, bool active);
+
+private:
+  struct Entry
+  {
+    uint64_t id;
+    Host host;
+    std::shared_ptr<ObservationBuffer> buffer;
+    std::function<void()> on_update;
+    bool active;
+  };
+
+  // Receive the messages on the first layer's node and tf buffer, transforming them to its
+  // frame with the scheduler waiting on the frames of all the layers
+  void attach();
+  // Stop receiving them; mutex_ must not be held, as a message may be on its way in
+  void detach();
+  // Subscribe while any layer is active
+  void followActive();
+
+  void scanCallback(const sensor_msgs::msg::LaserScan::ConstSharedPtr & message);
+  void cloudCallback(const sensor_msgs::msg::PointCloud2::ConstSharedPtr & message);
+  // Hand the observation just made of a message stamped stamp to the active layers
+  void handOn(const builtin_interfaces::msg::Time & stamp);
+
+  const SourceKey key_;
+
+  std::mutex mutex_;
+  std::vector<Entry> entries_;  ///< The host first
+  uint64_t next_id_{0};
+
+  std::shared_ptr<ObservationBuffer> producer_;  ///< In the host's frame, unfiltered
+  laser_geometry::LaserProjection projector_;
+  std::shared_ptr<message_filters::SubscriberBase> subscriber_;
+  std::shared_ptr<nav2_util::TransformScheduler> scheduler_;
+  nav2_util::TransformScheduler::ChannelPtr channel_;
+  std::vector<std::string> target_frames_;
+  bool subscribed_{false};
+};
+
+bool ObservationHub::SourceKey::operator<(const SourceKey & other) const
+{
+  return std::tie(topic, data_type, sensor_frame, inf_is_valid, direct_scan_projection,
+           latest_only) <
+         std::tie(other.topic, other.data_type, other.sensor_frame, other.inf_is_valid,
+           other.direct_scan_projection, other.latest_only);
+}
+
+ObservationHub::Consumer::Consumer(std::shared_ptr<Source> source, uint64_t id)
+: source_(std::move(source)), id_(id)
+{
+}
+
+ObservationHub::Consumer::~Consumer()
+{
+  source_->remove(id_);
+}
+
+void ObservationHub::Consumer::setActive(bool active)
+{
+  source_->setActive(id_, active);
+}
+
+ObservationHub & ObservationHub::global()
+{
+  static ObservationHub hub;
+  return hub;
+}
+
+std::unique_ptr<ObservationHub::Consumer> ObservationHub::subscribe(
+  const SourceKey & key, const Host & host, std::shared_ptr<ObservationBuffer> buffer,
+  std::function<void()> on_update)
+{
+  std::shared_ptr<Source> source;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = sources_.begin(); it != sources_.end(); ) {
+      it = it->second.expired() ? sources_.erase(it) : std::next(it);
+    }
+    std::weak_ptr<Source> & entry = sources_[key];
+    source = entry.lock();
+    if (!source) {
+      source = std::make_shared<Source>(key);
+      entry = source;
+    }
+  }
+  uint64_t id = source->add(host, std::move(buffer), std::move(on_update));
+  return std::unique_ptr<Consumer>(new Consumer(source, id));
+}
+
+size_t ObservationHub::sourceCount()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::count_if(sources_.begin(), sources_.end(),
+           [](const std::pair<const SourceKey, std::weak_ptr<Source>> & entry) {
+             return !entry.second.expired();
+           });
+}
+
+uint64_t ObservationHub::Source::add(
+  const Host & host, std::shared_ptr<ObservationBuffer> buffer,
+  std::function<void()> on_update)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  uint64_t id = next_id_++;
+  entries_.push_back(Entry{id, host, std::move(buffer), std::move(on_update), true});
+
+  // a layer in a frame the scheduler doesn't wait on yet has the messages received anew
+  bool new_frame = std::find(target_frames_.begin(), target_frames_.end(),
+      host.global_frame) == target_frames_.end();
+  if (new_frame && entries_.size() > 1) {
+    lock.unlock();
+    detach();
+    lock.lock();
+  }
+  if (!producer_) {
+    attach();
+  }
+  followActive();
+  return id;
+}
+
+void ObservationHub::Source::remove(uint64_t id)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = std::find_if(entries_.begin(), entries_.end(),
+      [id](const Entry & entry) {return entry.id == id;});
+  if (it == entries_.end()) {
+    return;
+  }
+  bool host = it == entries_.begin();
+  entries_.erase(it);
+
+  if (host) {
+    // the host's node and tf buffer are about to go, so move on to the next layer's
+    lock.unlock();
+    detach();
+    lock.lock();
+    if (!entries_.empty() && !producer_) {
+      attach();
+      followActive();
+    }
+  } else {
+    followActive();
+  }
+}
+
+void ObservationHub::Source::setActive(uint64_t id, bool active)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto & entry : entries_) {
+    if (entry.id == id) {
+      entry.active = active;
+    }
+  }
+  followActive();
+}
+
+void ObservationHub::Source::attach()
+{
+  const Host & host = entries_.front().host;
+
+  // the host's observations keep every point, the layers' heights being applied on hand on
+  const double inf = std::numeric_limits<double>::infinity();
+  producer_ = std::make_shared<ObservationBuffer>(host.node, key_.topic, 0.0, 0.0, -inf, inf,
+      0.0, 0.0, *host.tf, host.global_frame, key_.sensor_frame, host.transform_tolerance);
+
+  target_frames_.clear();
+  for (const auto & entry : entries_) {
+    if (std::find(target_frames_.begin(), target_frames_.end(),
+      entry.host.global_frame) == target_frames_.end())
+    {
+      target_frames_.push_back(entry.host.global_frame);
+    }
+  }
+  if (key_.sensor_frame != "") {
+    target_frames_.push_back(key_.sensor_frame);
+  }
+
+  // As the layers' own subscriptions do, see ObstacleLayer::onInitialize()
+  rmw_qos_profile_t custom_qos_profile = rmw_qos_profile_sensor_data;
+  custom_qos_profile.depth = key_.latest_only ? 1 : 50;
+  size_t channel_queue_size = key_.latest_only ? 1 : 50;
+
+  nav2_util::Counter * dropped = &nav2_util::MetricsRegistry::global().counter(
+    "observation_hub." + key_.topic + ".dropped",
+    "Shared observations dropped before they reached the obstacle layers");
+
+  scheduler_ = nav2_util::TransformScheduler::forBuffer(*host.tf);
+  auto scheduler = scheduler_;
+
+  if (key_.data_type == "LaserScan") {
+    auto sub = std::make_shared<message_filters::Subscriber<sensor_msgs::msg::LaserScan>>(
+      host.rclcpp_node, key_.topic, custom_qos_profile);
+    auto channel = scheduler->addChannel(target_frames_, channel_queue_size,
+        tf2::durationFromSec(0.05), [dropped]() {dropped->increment();});
+    std::function<void(sensor_msgs::msg::LaserScan::ConstSharedPtr)> callback =
+      std::bind(&Source::scanCallback, this, std::placeholders::_1);
+    sub->registerCallback(
+      [scheduler, channel, callback](const sensor_msgs::msg::LaserScan::ConstSharedPtr & msg) {
+        scheduler->schedule(channel, msg, callback);
+      });
+    subscriber_ = sub;
+    channel_ = channel;
+  } else {
+    auto sub = std::make_shared<message_filters::Subscriber<sensor_msgs::msg::PointCloud2>>(
+      host.rclcpp_node, key_.topic, custom_qos_profile);
+    auto channel = scheduler->addChannel(target_frames_, channel_queue_size,
+        tf2::Duration(0), [dropped]() {dropped->increment();});
+    std::function<void(sensor_msgs::msg::PointCloud2::ConstSharedPtr)> callback =
+      std::bind(&Source::cloudCallback, this, std::placeholders::_1);
+    sub->registerCallback(
+      [scheduler, channel, callback](
+        const sensor_msgs::msg::PointCloud2::ConstSharedPtr & msg) {
+        scheduler->schedule(channel, msg, callback);
+      });
+    subscriber_ = sub;
+    channel_ = channel;
+  }
+  subscribed_ = true;
+}
+
+void ObservationHub::Source::detach()
+{
+  std::shared_ptr<message_filters::SubscriberBase> subscriber;
+  std::shared_ptr<nav2_util::TransformScheduler> scheduler;
+  nav2_util::TransformScheduler::ChannelPtr channel;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscriber = std::move(subscriber_);
+    scheduler = std::move(scheduler_);
+    channel = std::move(channel_);
+    producer_.reset();
+    target_frames_.clear();
+    subscribed_ = false;
+  }
+  if (scheduler) {
+    scheduler->removeChannel(channel);
+  }
+}
+
+void ObservationHub::Source::followActive()
+{
+  if (!subscriber_) {
+    return;
+  }
+  bool active = std::any_of(entries_.begin(), entries_.end(),
+      [](const Entry & entry) {return entry.active;});
+  if (active && !subscribed_) {
+    subscriber_->subscribe();
+  } else if (!active && subscribed_) {
+    subscriber_->unsubscribe();
+  }
+  subscribed_ = active;
+}
+
+void ObservationHub::Source::scanCallback(
+  const sensor_msgs::msg::LaserScan::ConstSharedPtr & message)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!producer_) {
+    return;
+  }
+  const Host & host = entries_.front().host;
+
+  if (key_.direct_scan_projection) {
+    producer_->bufferScan(*message, key_.inf_is_valid);
+    handOn(message->header.stamp);
+    return;
+  }
+
+  // As ObstacleLayer::laserScanValidInfCallback() and laserScanCallback() do
+  sensor_msgs::msg::LaserScan filtered;
+  const sensor_msgs::msg::LaserScan * scan = message.get();
+  if (key_.inf_is_valid) {
+    filtered = *message;
+    for (float & range : filtered.ranges) {
+      if (!std::isfinite(range) && range > 0) {
+        range = filtered.range_max - 0.0001f;
+      }
+    }
+    scan = &filtered;
+  }
+
+  sensor_msgs::msg::PointCloud2 cloud;
+  cloud.header = scan->header;
+  try {
+    projector_.transformLaserScanToPointCloud(scan->header.frame_id, *scan, cloud, *host.tf);
+  } catch (tf2::TransformException & ex) {
+    RCLCPP_WARN(host.node->get_logger(),
+      "High fidelity enabled, but TF returned a transform exception to frame %s: %s",
+      host.global_frame.c_str(), ex.what());
+    projector_.projectLaser(*scan, cloud);
+  }
+  producer_->bufferCloud(cloud);
+  handOn(message->header.stamp);
+}
+
+void ObservationHub::Source::cloudCallback(
+  const sensor_msgs::msg::PointCloud2::ConstSharedPtr & message)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!producer_) {
+    return;
+  }
+  producer_->bufferCloud(*message);
+  handOn(message->header.stamp);
+}
+
+void ObservationHub::Source::handOn(const builtin_interfaces::msg::Time & stamp)
+{
+  // with keep time 0 the producer holds the one observation, unless the transform failed
+  std::vector<std::shared_ptr<const Observation>> observations;
+  producer_->getObservations(observations);
+  if (observations.empty() || observations.front()->cloud_->header.stamp != stamp) {
+    return;
+  }
+  const Observation & observation = *observations.front();
+
+  // the height extent of the cloud tells the layers whether their heights take it all in
+  float min_z = std::numeric_limits<float>::infinity();
+  float max_z = -std::numeric_limits<float>::infinity();
+  const sensor_msgs::msg::PointCloud2 & cloud = *observation.cloud_;
+  if (cloud.width * cloud.height > 0) {
+    for (sensor_msgs::PointCloud2ConstIterator<float> iter_z(cloud, "z"); iter_z != iter_z.end();
+      ++iter_z)
+    {
+      min_z = std::min(min_z, *iter_z);
+      max_z = std::max(max_z, *iter_z);
+    }
+  }
+
+  for (const auto & entry : entries_) {
+    if (!entry.active) {
+      continue;
+    }
+    entry.buffer->lock();
+    entry.buffer->bufferShared(observation, min_z, max_z);
+    entry.buffer->unlock();
+    if (entry.on_update) {
+      entry.on_update();
+    }
+  }
+}
+
+}  // namespace nav2_costmap_2d
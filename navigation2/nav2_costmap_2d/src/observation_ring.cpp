@@ -0,0 +1,81 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/observation_ring.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+ObservationRing::ObservationRing(size_t capacity)
+: capacity_(std::max<size_t>(capacity, 1)), slots_(new Slot[capacity_])
+{
+}
+
+size_t ObservationRing::size() const
+{
+  return std::min<uint64_t>(published_.load(), capacity_);
+}
+
+std::shared_ptr<const Observation> ObservationRing::push(
+  std::shared_ptr<const Observation> observation, int64_t stamp_ns)
+{
+  uint64_t index = published_.load();
+  Slot & slot = slots_[index % capacity_];
+
+  // announce the reuse of the slot before touching it
+  started_.store(index + 1);
+  std::shared_ptr<const Observation> evicted =
+    std::atomic_exchange(&slot.observation, std::move(observation));
+  slot.stamp_ns.store(stamp_ns);
+  published_.store(index + 1);
+  return evicted;
+}
+
+void ObservationRing::collect(
+  int64_t oldest_ns, size_t max_count,
+  std::vector<std::shared_ptr<const Observation>> & observations) const
+{
+  uint64_t newest = published_.load();
+  uint64_t count = std::min<uint64_t>({newest, capacity_, max_count});
+  for (uint64_t index = newest; index > newest - count; --index) {
+    const Slot & slot = slots_[(index - 1) % capacity_];
+    int64_t stamp_ns = slot.stamp_ns.load();
+    std::shared_ptr<const Observation> observation = std::atomic_load(&slot.observation);
+
+    // a push that started on this slot since may have replaced either, and so would have
+    // all the older ones
+    if (started_.load() > index - 1 + capacity_ || stamp_ns < oldest_ns) {
+      return;
+    }
+    observations.push_back(std::move(observation));
+  }
+}
+
+std::shared_ptr<const Observation> ObservationRing::at(size_t age) const
+{
+  return std::atomic_load(&slots_[(published_.load() - 1 - age) % capacity_].observation);
+}
+
+void ObservationRing::replace(size_t age, std::shared_ptr<const Observation> observation)
+{
+  std::atomic_store(
+    &slots_[(published_.load() - 1 - age) % capacity_].observation, std::move(observation));
+}
+
+}  // namespace nav2_costmap_2d
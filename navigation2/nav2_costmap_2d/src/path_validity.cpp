@@ -0,0 +1,148 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/path_validity.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+PathValidity::PathValidity(
+  unsigned int yaw_bins, size_t max_regions, unsigned char blocking_cost)
+: masks_(std::max(yaw_bins, 1u)), dirty_(max_regions), blocking_cost_(blocking_cost)
+{
+}
+
+void PathValidity::addDirtyRegion(const MapRegion & region)
+{
+  dirty_.add(region);
+}
+
+void PathValidity::reset()
+{
+  poses_.clear();
+  dirty_.clear();
+}
+
+int PathValidity::check(
+  const Costmap2D & costmap, const std::vector<geometry_msgs::msg::Pose2D> & poses,
+  const std::vector<geometry_msgs::msg::Point> & footprint_spec, size_t * checked)
+{
+  bool same_map = costmap.getSizeInCellsX() == size_x_ &&
+    costmap.getSizeInCellsY() == size_y_ && costmap.getOriginX() == origin_x_ &&
+    costmap.getOriginY() == origin_y_ && costmap.getResolution() == resolution_;
+  bool same_footprint = !masks_.setFootprint(footprint_spec, costmap.getResolution());
+  bool same_path = poses.size() == poses_.size() &&
+    std::equal(poses.begin(), poses.end(), poses_.begin(),
+      [](const geometry_msgs::msg::Pose2D & a, const geometry_msgs::msg::Pose2D & b) {
+        return a.x == b.x && a.y == b.y && a.theta == b.theta;
+      });
+
+  if (!same_path || !same_map) {
+    // the cells of all the poses at once
+    poses_ = poses;
+    x_.resize(poses.size());
+    y_.resize(poses.size());
+    for (size_t i = 0; i < poses.size(); ++i) {
+      x_[i] = poses[i].x;
+      y_[i] = poses[i].y;
+    }
+    mx_.resize(poses.size());
+    my_.resize(poses.size());
+    on_map_.resize(poses.size());
+    costmap.worldToMapBatch(x_.data(), y_.data(), poses.size(), mx_.data(), my_.data(),
+      on_map_.data());
+    size_x_ = costmap.getSizeInCellsX();
+    size_y_ = costmap.getSizeInCellsY();
+    origin_x_ = costmap.getOriginX();
+    origin_y_ = costmap.getOriginY();
+    resolution_ = costmap.getResolution();
+  }
+  if (!same_path || !same_map || !same_footprint) {
+    clear_.assign(poses.size(), 0);
+    dirty_.clear();
+  }
+
+  size_t count = 0;
+  int blocked_index = -1;
+  for (size_t i = 0; i < poses_.size(); ++i) {
+    if (clear_[i] && !nearChange(mx_[i], my_[i])) {
+      continue;
+    }
+    ++count;
+    if (blocked(costmap, i)) {
+      clear_[i] = 0;
+      blocked_index = static_cast<int>(i);
+      // the poses past it still have to be looked at for these changes once it is clear
+      for (size_t j = i + 1; j < poses_.size(); ++j) {
+        if (clear_[j] && nearChange(mx_[j], my_[j])) {
+          clear_[j] = 0;
+        }
+      }
+      break;
+    }
+    clear_[i] = 1;
+  }
+  dirty_.clear();
+
+  if (checked) {
+    *checked = count;
+  }
+  return blocked_index;
+}
+
+bool PathValidity::blocked(const Costmap2D & costmap, size_t index)
+{
+  // a pose off the map can't be told blocked
+  if (!on_map_[index]) {
+    return false;
+  }
+  int x = mx_[index], y = my_[index];
+  if (blocks(costmap.getCost(x, y))) {
+    return true;
+  }
+
+  int size_x = size_x_, size_y = size_y_;
+  for (const FootprintSpan & span : masks_.fill(poses_[index].theta)) {
+    int my = y + span.y;
+    if (my < 0 || my >= size_y) {
+      continue;
+    }
+    int min_x = std::max(x + span.min_x, 0);
+    int max_x = std::min(x + span.max_x, size_x - 1);
+    for (int mx = min_x; mx <= max_x; ++mx) {
+      if (blocks(costmap.getCost(mx, my))) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool PathValidity::nearChange(unsigned int mx, unsigned int my) const
+{
+  int x = mx, y = my, radius = masks_.radius();
+  for (const MapRegion & region : dirty_.get()) {
+    if (x >= region.x0 - radius && x < region.xn + radius &&
+      y >= region.y0 - radius && y < region.yn + radius)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace nav2_costmap_2d
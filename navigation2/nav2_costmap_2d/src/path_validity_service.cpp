@@ -0,0 +1,123 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/path_validity_service.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_2d_ros.hpp"
+#include "tf2_geometry_msgs/tf2_geometry_msgs.h"
+
+namespace nav2_costmap_2d
+{
+
+using IsPathValid = nav2_msgs::srv::IsPathValid;
+
+PathValidityService::PathValidityService(
+  nav2_util::LifecycleNode::SharedPtr node,
+  Costmap2DROS & costmap)
+: node_(node), costmap_(costmap)
+{
+  service_ = node_->create_service<IsPathValid>(
+    "is_path_valid",
+    std::bind(&PathValidityService::isPathValidCallback, this,
+    std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+    rmw_qos_profile_services_default, costmap_.getServicesCallbackGroup());
+}
+
+void PathValidityService::addDirtyRegions(const std::vector<MapRegion> & regions)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const MapRegion & region : regions) {
+    validity_.addDirtyRegion(region);
+  }
+}
+
+void PathValidityService::isPathValidCallback(
+  const std::shared_ptr<rmw_request_id_t>/*request_header*/,
+  const std::shared_ptr<IsPathValid::Request> request,
+  const std::shared_ptr<IsPathValid::Response> response)
+{
+  response->is_valid = false;
+  response->blocked_index = -1;
+  response->deviated = false;
+  response->checked_poses = 0;
+
+  std::vector<geometry_msgs::msg::Pose2D> poses;
+  if (request->path.poses.empty() || !toCostmapFrame(request->path, poses)) {
+    return;
+  }
+
+  if (request->max_deviation > 0.0) {
+    geometry_msgs::msg::PoseStamped robot_pose;
+    if (!costmap_.getRobotPose(robot_pose)) {
+      RCLCPP_WARN(node_->get_logger(), "Cannot tell whether the robot is on the path, "
+        "as its pose cannot be retrieved");
+      return;
+    }
+    double min_distance = std::numeric_limits<double>::max();
+    for (const auto & pose : poses) {
+      min_distance = std::min(min_distance, std::hypot(pose.x - robot_pose.pose.position.x,
+        pose.y - robot_pose.pose.position.y));
+    }
+    response->deviated = min_distance > request->max_deviation;
+  }
+
+  size_t checked = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Costmap2D * costmap = costmap_.getCostmap();
+    std::unique_lock<Costmap2D::mutex_t> costmap_lock(*(costmap->getMutex()));
+    response->blocked_index = validity_.check(*costmap, poses, costmap_.getRobotFootprint(),
+        &checked);
+  }
+  response->checked_poses = checked;
+  response->is_valid = response->blocked_index < 0 && !response->deviated;
+}
+
+bool PathValidityService::toCostmapFrame(
+  const nav2_msgs::msg::Path & path, std::vector<geometry_msgs::msg::Pose2D> & poses)
+{
+  // the path is usually planned on this costmap, and needs no transform
+  tf2::Transform transform = tf2::Transform::getIdentity();
+  const std::string & frame = path.header.frame_id;
+  if (!frame.empty() && frame != costmap_.getGlobalFrameID()) {
+    try {
+      tf2::fromMsg(costmap_.getTfBuffer()->lookupTransform(costmap_.getGlobalFrameID(), frame,
+        tf2::TimePointZero).transform, transform);
+    } catch (tf2::TransformException & ex) {
+      RCLCPP_WARN(node_->get_logger(), "Cannot check a path in %s: %s", frame.c_str(),
+        ex.what());
+      return false;
+    }
+  }
+
+  double yaw = tf2::getYaw(transform.getRotation());
+  poses.resize(path.poses.size());
+  for (size_t i = 0; i < path.poses.size(); ++i) {
+    const geometry_msgs::msg::Point & position = path.poses[i].position;
+    tf2::Vector3 point = transform * tf2::Vector3(position.x, position.y, position.z);
+    poses[i].x = point.x();
+    poses[i].y = point.y();
+    poses[i].theta = tf2::getYaw(path.poses[i].orientation) + yaw;
+  }
+  return true;
+}
+
+}  // namespace nav2_costmap_2d
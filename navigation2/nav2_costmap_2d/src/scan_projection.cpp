@@ -0,0 +1,143 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/scan_projection.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include <limits>
+
+namespace nav2_costmap_2d
+{
+
+// The beams lie in the scan's xy plane, so the third column of the rotation never applies
+
+void projectScanScalar(
+  const ScanProjection & p, const float * ranges, const float * cos_table,
+  const float * sin_table, size_t count, float * x, float * y, float * z, unsigned char * keep)
+{
+  const float inf = std::numeric_limits<float>::infinity();
+  for (size_t i = 0; i < count; i++) {
+    float range = ranges[i] == inf ? p.inf_range : ranges[i];
+    float lx = range * cos_table[i];
+    float ly = range * sin_table[i];
+    x[i] = p.rotation[0][0] * lx + p.rotation[0][1] * ly + p.translation[0];
+    y[i] = p.rotation[1][0] * lx + p.rotation[1][1] * ly + p.translation[1];
+    z[i] = p.rotation[2][0] * lx + p.rotation[2][1] * ly + p.translation[2];
+    keep[i] = range >= p.range_min && range < p.range_max && z[i] >= p.min_z && z[i] <= p.max_z;
+  }
+}
+
+#if defined(__SSE2__)
+
+void projectScan(
+  const ScanProjection & p, const float * ranges, const float * cos_table,
+  const float * sin_table, size_t count, float * x, float * y, float * z, unsigned char * keep)
+{
+  const __m128 inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+  const __m128 inf_range = _mm_set1_ps(p.inf_range);
+  const __m128 r00 = _mm_set1_ps(p.rotation[0][0]), r01 = _mm_set1_ps(p.rotation[0][1]);
+  const __m128 r10 = _mm_set1_ps(p.rotation[1][0]), r11 = _mm_set1_ps(p.rotation[1][1]);
+  const __m128 r20 = _mm_set1_ps(p.rotation[2][0]), r21 = _mm_set1_ps(p.rotation[2][1]);
+  const __m128 tx = _mm_set1_ps(p.translation[0]), ty = _mm_set1_ps(p.translation[1]);
+  const __m128 tz = _mm_set1_ps(p.translation[2]);
+  const __m128 range_min = _mm_set1_ps(p.range_min), range_max = _mm_set1_ps(p.range_max);
+  const __m128 min_z = _mm_set1_ps(p.min_z), max_z = _mm_set1_ps(p.max_z);
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 range = _mm_loadu_ps(ranges + i);
+    __m128 is_inf = _mm_cmpeq_ps(range, inf);
+    range = _mm_or_ps(_mm_and_ps(is_inf, inf_range), _mm_andnot_ps(is_inf, range));
+    __m128 lx = _mm_mul_ps(range, _mm_loadu_ps(cos_table + i));
+    __m128 ly = _mm_mul_ps(range, _mm_loadu_ps(sin_table + i));
+    __m128 px = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r00, lx), _mm_mul_ps(r01, ly)), tx);
+    __m128 py = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r10, lx), _mm_mul_ps(r11, ly)), ty);
+    __m128 pz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r20, lx), _mm_mul_ps(r21, ly)), tz);
+    _mm_storeu_ps(x + i, px);
+    _mm_storeu_ps(y + i, py);
+    _mm_storeu_ps(z + i, pz);
+
+    // ordered comparisons, so that NaN ranges are dropped
+    __m128 in_range = _mm_and_ps(_mm_cmpge_ps(range, range_min), _mm_cmplt_ps(range, range_max));
+    __m128 in_band = _mm_and_ps(_mm_cmpge_ps(pz, min_z), _mm_cmple_ps(pz, max_z));
+    int mask = _mm_movemask_ps(_mm_and_ps(in_range, in_band));
+    keep[i] = mask & 1;
+    keep[i + 1] = (mask >> 1) & 1;
+    keep[i + 2] = (mask >> 2) & 1;
+    keep[i + 3] = (mask >> 3) & 1;
+  }
+  projectScanScalar(
+    p, ranges + i, cos_table + i, sin_table + i, count - i, x + i, y + i, z + i, keep + i);
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+void projectScan(
+  const ScanProjection & p, const float * ranges, const float * cos_table,
+  const float * sin_table, size_t count, float * x, float * y, float * z, unsigned char * keep)
+{
+  const float32x4_t inf = vdupq_n_f32(std::numeric_limits<float>::infinity());
+  const float32x4_t inf_range = vdupq_n_f32(p.inf_range);
+  const float32x4_t range_min = vdupq_n_f32(p.range_min);
+  const float32x4_t range_max = vdupq_n_f32(p.range_max);
+  const float32x4_t min_z = vdupq_n_f32(p.min_z), max_z = vdupq_n_f32(p.max_z);
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    float32x4_t range = vld1q_f32(ranges + i);
+    range = vbslq_f32(vceqq_f32(range, inf), inf_range, range);
+    float32x4_t lx = vmulq_f32(range, vld1q_f32(cos_table + i));
+    float32x4_t ly = vmulq_f32(range, vld1q_f32(sin_table + i));
+    float32x4_t px = vaddq_f32(
+      vaddq_f32(vmulq_n_f32(lx, p.rotation[0][0]), vmulq_n_f32(ly, p.rotation[0][1])),
+      vdupq_n_f32(p.translation[0]));
+    float32x4_t py = vaddq_f32(
+      vaddq_f32(vmulq_n_f32(lx, p.rotation[1][0]), vmulq_n_f32(ly, p.rotation[1][1])),
+      vdupq_n_f32(p.translation[1]));
+    float32x4_t pz = vaddq_f32(
+      vaddq_f32(vmulq_n_f32(lx, p.rotation[2][0]), vmulq_n_f32(ly, p.rotation[2][1])),
+      vdupq_n_f32(p.translation[2]));
+    vst1q_f32(x + i, px);
+    vst1q_f32(y + i, py);
+    vst1q_f32(z + i, pz);
+
+    uint32x4_t in_range = vandq_u32(vcgeq_f32(range, range_min), vcltq_f32(range, range_max));
+    uint32x4_t in_band = vandq_u32(vcgeq_f32(pz, min_z), vcleq_f32(pz, max_z));
+    uint32_t mask[4];
+    vst1q_u32(mask, vandq_u32(in_range, in_band));
+    for (int lane = 0; lane < 4; ++lane) {
+      keep[i + lane] = mask[lane] & 1;
+    }
+  }
+  projectScanScalar(
+    p, ranges + i, cos_table + i, sin_table + i, count - i, x + i, y + i, z + i, keep + i);
+}
+
+#else
+
+void projectScan(
+  const ScanProjection & p, const float * ranges, const float * cos_table,
+  const float * sin_table, size_t count, float * x, float * y, float * z, unsigned char * keep)
+{
+  projectScanScalar(p, ranges, cos_table, sin_table, count, x, y, z, keep);
+}
+
+#endif
+
+}  // namespace nav2_costmap_2d
@@ -0,0 +1,264 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/shared_costmap.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+const uint32_t SEGMENT_MAGIC = 0x6e32636d;
+
+// The start of a segment, followed by capacity bytes of costs from DATA_OFFSET.
+// sequence works as a sequence lock: it is odd while the writer changes the snapshot,
+// and a reader keeps a copy only if sequence was the same even value before and after it.
+struct SegmentHeader
+{
+  std::atomic<uint32_t> magic;
+  std::atomic<uint32_t> retired;  // the writer has moved on to a new segment
+  std::atomic<uint64_t> sequence;
+  uint64_t capacity;
+  uint32_t size_x;
+  uint32_t size_y;
+  double resolution;
+  double origin_x;
+  double origin_y;
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+  "the segment's atomics must be lock free to be shared between processes");
+
+const size_t DATA_OFFSET = 64 * ((sizeof(SegmentHeader) + 63) / 64);
+
+// How many times a reader retries a copy the writer changed under it
+const int READ_ATTEMPTS = 100;
+
+std::string segmentName(const std::string & name)
+{
+  return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+}  // namespace
+
+SharedCostmapWriter::SharedCostmapWriter(const std::string & name)
+: name_(segmentName(name))
+{
+  // a segment left by a writer that crashed has no one to update it
+  shm_unlink(name_.c_str());
+}
+
+SharedCostmapWriter::~SharedCostmapWriter()
+{
+  removeSegment();
+}
+
+void
+SharedCostmapWriter::write(const Costmap2D & costmap)
+{
+  const uint32_t size_x = costmap.getSizeInCellsX();
+  const uint32_t size_y = costmap.getSizeInCellsY();
+  const size_t cells = static_cast<size_t>(size_x) * size_y;
+  if (!segment_ || DATA_OFFSET + cells > segment_size_) {
+    removeSegment();
+    createSegment(cells);
+  }
+
+  SegmentHeader * header = static_cast<SegmentHeader *>(segment_);
+  header->sequence.store(sequence_ + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  header->size_x = size_x;
+  header->size_y = size_y;
+  header->resolution = costmap.getResolution();
+  header->origin_x = costmap.getOriginX();
+  header->origin_y = costmap.getOriginY();
+  memcpy(static_cast<unsigned char *>(segment_) + DATA_OFFSET, costmap.getCharMap(), cells);
+
+  sequence_ += 2;
+  header->sequence.store(sequence_, std::memory_order_release);
+}
+
+void
+SharedCostmapWriter::createSegment(size_t capacity)
+{
+  int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot create shared costmap " + name_ + ": " + strerror(errno));
+  }
+
+  size_t size = DATA_OFFSET + capacity;
+  if (ftruncate(fd, size) != 0) {
+    std::string error = strerror(errno);
+    close(fd);
+    shm_unlink(name_.c_str());
+    throw std::runtime_error("Cannot size shared costmap " + name_ + ": " + error);
+  }
+
+  void * segment = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (segment == MAP_FAILED) {
+    std::string error = strerror(errno);
+    shm_unlink(name_.c_str());
+    throw std::runtime_error("Cannot map shared costmap " + name_ + ": " + error);
+  }
+
+  // the new segment is zeroed, and carries on the versions of the one it replaces
+  segment_ = segment;
+  segment_size_ = size;
+  SegmentHeader * header = static_cast<SegmentHeader *>(segment_);
+  header->capacity = capacity;
+  header->sequence.store(sequence_, std::memory_order_relaxed);
+  header->magic.store(SEGMENT_MAGIC, std::memory_order_release);
+}
+
+void
+SharedCostmapWriter::removeSegment()
+{
+  if (!segment_) {
+    return;
+  }
+  static_cast<SegmentHeader *>(segment_)->retired.store(1, std::memory_order_release);
+  munmap(segment_, segment_size_);
+  shm_unlink(name_.c_str());
+  segment_ = nullptr;
+  segment_size_ = 0;
+}
+
+SharedCostmapReader::SharedCostmapReader(const std::string & name)
+: name_(segmentName(name))
+{
+}
+
+SharedCostmapReader::~SharedCostmapReader()
+{
+  detach();
+}
+
+uint64_t
+SharedCostmapReader::version()
+{
+  if (!attach()) {
+    return 0;
+  }
+  return static_cast<const SegmentHeader *>(segment_)->sequence.load(
+    std::memory_order_acquire) / 2;
+}
+
+bool
+SharedCostmapReader::read(nav2_msgs::msg::Costmap & costmap, uint64_t & version)
+{
+  for (int attempt = 0; attempt < READ_ATTEMPTS; ++attempt) {
+    if (!attach()) {
+      return false;
+    }
+
+    const SegmentHeader * header = static_cast<const SegmentHeader *>(segment_);
+    uint64_t before = header->sequence.load(std::memory_order_acquire);
+    if (before == 0) {
+      return false;
+    }
+    if (before % 2) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    uint32_t size_x = header->size_x;
+    uint32_t size_y = header->size_y;
+    size_t cells = static_cast<size_t>(size_x) * size_y;
+    if (cells <= header->capacity && DATA_OFFSET + cells <= segment_size_) {
+      costmap.metadata.size_x = size_x;
+      costmap.metadata.size_y = size_y;
+      costmap.metadata.resolution = header->resolution;
+      costmap.metadata.origin.position.x = header->origin_x;
+      costmap.metadata.origin.position.y = header->origin_y;
+      costmap.metadata.origin.position.z = 0.0;
+      costmap.metadata.origin.orientation.w = 1.0;
+      const unsigned char * data = static_cast<const unsigned char *>(segment_) + DATA_OFFSET;
+      costmap.data.assign(data, data + cells);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header->sequence.load(std::memory_order_relaxed) == before) {
+      version = before / 2;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+SharedCostmapReader::attach()
+{
+  if (segment_) {
+    if (!static_cast<const SegmentHeader *>(segment_)->retired.load(std::memory_order_acquire)) {
+      return true;
+    }
+    // the writer has moved to a new segment of the same name
+    detach();
+  }
+
+  int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < DATA_OFFSET) {
+    close(fd);
+    return false;
+  }
+
+  size_t size = status.st_size;
+  void * segment = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (segment == MAP_FAILED) {
+    return false;
+  }
+
+  segment_ = segment;
+  segment_size_ = size;
+  const SegmentHeader * header = static_cast<const SegmentHeader *>(segment_);
+  if (header->magic.load(std::memory_order_acquire) != SEGMENT_MAGIC || header->retired.load()) {
+    // still being set up, or already replaced
+    detach();
+    return false;
+  }
+  return true;
+}
+
+void
+SharedCostmapReader::detach()
+{
+  if (segment_) {
+    munmap(const_cast<void *>(segment_), segment_size_);
+    segment_ = nullptr;
+    segment_size_ = 0;
+  }
+}
+
+}  // namespace nav2_costmap_2d
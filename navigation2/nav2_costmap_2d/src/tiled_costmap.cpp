@@ -0,0 +1,104 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/tiled_costmap.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace nav2_costmap_2d
+{
+
+TiledCostmap::TiledCostmap(unsigned int tile_size)
+: tile_size_(std::max(tile_size, 1u))
+{
+}
+
+void TiledCostmap::resize(unsigned int size_x, unsigned int size_y, unsigned char default_value)
+{
+  size_x_ = size_x;
+  size_y_ = size_y;
+  default_value_ = default_value;
+  tiles_x_ = (size_x + tile_size_ - 1) / tile_size_;
+  unsigned int tiles_y = (size_y + tile_size_ - 1) / tile_size_;
+
+  default_tile_.assign(tile_size_ * tile_size_, default_value);
+  tiles_.clear();
+  tiles_.resize(tiles_x_ * tiles_y);
+  allocated_tiles_ = 0;
+}
+
+void TiledCostmap::reset()
+{
+  for (auto & tile : tiles_) {
+    tile.reset();
+  }
+  allocated_tiles_ = 0;
+}
+
+void TiledCostmap::setCost(unsigned int mx, unsigned int my, unsigned char cost)
+{
+  std::unique_ptr<unsigned char[]> & tile = tiles_[tileIndex(mx, my)];
+  if (!tile) {
+    // writing the default into an untouched tile changes nothing
+    if (cost == default_value_) {
+      return;
+    }
+    tile.reset(new unsigned char[default_tile_.size()]);
+    memcpy(tile.get(), default_tile_.data(), default_tile_.size());
+    ++allocated_tiles_;
+  }
+  tile[(my % tile_size_) * tile_size_ + mx % tile_size_] = cost;
+}
+
+void TiledCostmap::forEachTile(
+  unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn,
+  const std::function<void(const Tile &)> & visit) const
+{
+  xn = std::min(xn, size_x_);
+  yn = std::min(yn, size_y_);
+  if (x0 >= xn || y0 >= yn) {
+    return;
+  }
+
+  Tile tile;
+  tile.stride = tile_size_;
+  for (unsigned int ty = y0 / tile_size_; ty * tile_size_ < yn; ++ty) {
+    unsigned int tile_y0 = ty * tile_size_;
+    tile.y = std::max(y0, tile_y0);
+    tile.size_y = std::min(yn, tile_y0 + tile_size_) - tile.y;
+
+    for (unsigned int tx = x0 / tile_size_; tx * tile_size_ < xn; ++tx) {
+      unsigned int tile_x0 = tx * tile_size_;
+      tile.x = std::max(x0, tile_x0);
+      tile.size_x = std::min(xn, tile_x0 + tile_size_) - tile.x;
+
+      const unsigned char * cells = tiles_[ty * tiles_x_ + tx].get();
+      tile.shared = cells == nullptr;
+      if (tile.shared) {
+        cells = default_tile_.data();
+      }
+      tile.data = cells + (tile.y - tile_y0) * tile_size_ + (tile.x - tile_x0);
+      visit(tile);
+    }
+  }
+}
+
+size_t TiledCostmap::getMemoryUsage() const
+{
+  return (allocated_tiles_ + 1) * default_tile_.size() +
+         tiles_.size() * sizeof(std::unique_ptr<unsigned char[]>);
+}
+
+}  // namespace nav2_costmap_2d
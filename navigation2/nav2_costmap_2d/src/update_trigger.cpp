@@ -0,0 +1,61 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/update_trigger.hpp"
+
+namespace nav2_costmap_2d
+{
+
+UpdateTrigger::UpdateTrigger(Clock::duration min_interval, Clock::duration max_interval)
+: min_interval_(min_interval), max_interval_(max_interval), last_update_(Clock::now())
+{
+}
+
+void UpdateTrigger::notify()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++pending_;
+  }
+  cv_.notify_one();
+}
+
+void UpdateTrigger::interrupt()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    interrupted_ = true;
+  }
+  cv_.notify_one();
+}
+
+unsigned int UpdateTrigger::wait()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait_until(lock, last_update_ + max_interval_,
+    [this] {return pending_ > 0 || interrupted_;});
+
+  // notified early: hold off to the rate limit, taking in whatever else arrives meanwhile
+  if (pending_ > 0) {
+    cv_.wait_until(lock, last_update_ + min_interval_, [this] {return interrupted_;});
+  }
+
+  unsigned int notifications = pending_;
+  pending_ = 0;
+  interrupted_ = false;
+  last_update_ = Clock::now();
+  return notifications;
+}
+
+}  // namespace nav2_costmap_2d
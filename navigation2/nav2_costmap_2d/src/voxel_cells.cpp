@@ -0,0 +1,111 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/voxel_cells.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+// The levels' bits of a column, each moved to the bit of the level's block
+uint32_t downsampleLevels(uint32_t levels, unsigned int downsample)
+{
+  if (downsample == 1) {
+    return levels;
+  }
+  uint32_t blocks = 0;
+  while (levels) {
+    blocks |= 1u << (__builtin_ctz(levels) / downsample);
+    levels &= levels - 1;
+  }
+  return blocks;
+}
+
+void appendColumn(
+  uint32_t blocks, double x, double y, double origin_z, double z_size,
+  std::vector<VoxelCell> & cells)
+{
+  while (blocks) {
+    unsigned int z = __builtin_ctz(blocks);
+    cells.push_back({x, y, origin_z + (z + 0.5) * z_size});
+    blocks &= blocks - 1;
+  }
+}
+
+}  // namespace
+
+VoxelCellCollector::VoxelCellCollector(unsigned int downsample)
+: downsample_(std::max(downsample, 1u))
+{
+}
+
+void VoxelCellCollector::collect(const nav2_msgs::msg::VoxelGrid & grid, bool unknown)
+{
+  marked_.clear();
+  unknown_.clear();
+
+  const unsigned int size_x = grid.size_x;
+  const unsigned int size_y = grid.size_y;
+  const unsigned int size_z = std::min(grid.size_z, 16u);
+  if (grid.data.size() < size_x * size_y) {
+    return;
+  }
+  const unsigned int factor = downsample_;
+  const unsigned int blocks_x = (size_x + factor - 1) / factor;
+  const unsigned int blocks_y = (size_y + factor - 1) / factor;
+  const uint32_t levels = (1u << size_z) - 1;
+
+  // a voxel is marked when both of its bits are set and unknown when only one is
+  marked_columns_.assign(blocks_x * blocks_y, 0);
+  unknown_columns_.assign(unknown ? blocks_x * blocks_y : 0, 0);
+  const uint32_t * data = grid.data.data();
+  for (unsigned int y = 0; y < size_y; ++y) {
+    const unsigned int row = (y / factor) * blocks_x;
+    for (unsigned int x = 0; x < size_x; ++x) {
+      const uint32_t column = data[y * size_x + x];
+      if (column == 0) {
+        continue;
+      }
+      const uint32_t low = column & levels;
+      const uint32_t high = (column >> 16) & levels;
+      marked_columns_[row + x / factor] |= downsampleLevels(low & high, factor);
+      if (unknown) {
+        unknown_columns_[row + x / factor] |= downsampleLevels(low ^ high, factor);
+      }
+    }
+  }
+
+  const double x_size = grid.resolutions.x * factor;
+  const double y_size = grid.resolutions.y * factor;
+  const double z_size = grid.resolutions.z * factor;
+  for (unsigned int by = 0; by < blocks_y; ++by) {
+    const double y = grid.origin.y + (by + 0.5) * y_size;
+    for (unsigned int bx = 0; bx < blocks_x; ++bx) {
+      const unsigned int index = by * blocks_x + bx;
+      const double x = grid.origin.x + (bx + 0.5) * x_size;
+      appendColumn(marked_columns_[index], x, y, grid.origin.z, z_size, marked_);
+      if (unknown) {
+        appendColumn(unknown_columns_[index] & ~marked_columns_[index], x, y, grid.origin.z,
+          z_size, unknown_);
+      }
+    }
+  }
+}
+
+}  // namespace nav2_costmap_2d
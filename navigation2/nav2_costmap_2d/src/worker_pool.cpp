@@ -0,0 +1,96 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/worker_pool.hpp"
+
+namespace nav2_costmap_2d
+{
+
+WorkerPool::WorkerPool(unsigned int num_threads)
+{
+  for (unsigned int i = 1; i < num_threads; ++i) {
+    workers_.emplace_back(&WorkerPool::workerLoop, this);
+  }
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  start_cv_.notify_all();
+  for (auto & worker : workers_) {
+    worker.join();
+  }
+}
+
+void WorkerPool::run(const std::function<void(int)> & job, int job_count)
+{
+  if (workers_.empty() || job_count < 2) {
+    for (int i = 0; i < job_count; ++i) {
+      job(i);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job_ = &job;
+    job_count_ = job_count;
+    next_job_ = 0;
+    busy_workers_ = workers_.size();
+    ++generation_;
+  }
+  start_cv_.notify_all();
+
+  drain();
+
+  // The batch references the caller's job, so wait for every worker to let go of it
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] {return busy_workers_ == 0;});
+  job_ = nullptr;
+}
+
+void WorkerPool::drain()
+{
+  for (int i = next_job_++; i < job_count_; i = next_job_++) {
+    (*job_)(i);
+  }
+}
+
+void WorkerPool::workerLoop()
+{
+  unsigned int seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_cv_.wait(lock, [&] {return shutdown_ || generation_ != seen_generation;});
+      if (shutdown_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+
+    drain();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --busy_workers_;
+    }
+    done_cv_.notify_one();
+  }
+}
+
+}  // namespace nav2_costmap_2d
@@ -42,6 +42,7 @@
 #include "rclcpp/rclcpp.hpp"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
 #include "tf2_ros/transform_listener.h"
+#include "nav2_costmap_2d/costmap_2d.hpp"
 #include "nav2_costmap_2d/footprint.hpp"
 
 class RclCppFixture
@@ -202,3 +203,38 @@ TEST_F(TestNode, footprint_from_same_level_param)
   EXPECT_EQ(6.0f, footprint[2].y);
   EXPECT_EQ(0.0f, footprint[2].z);
 }
+
+TEST_F(TestNode, footprint_masks_fill_like_polygons)
+{
+  footprint_tester_->testFootprint(0.0, "[[0.2, 0.1], [0.2, -0.1], [-0.2, -0.1], [-0.2, 0.1]]");
+  std::vector<geometry_msgs::msg::Point> footprint = footprint_tester_->getRobotFootprint();
+  nav2_costmap_2d::FootprintMasks masks(4);
+  EXPECT_TRUE(masks.setFootprint(footprint, 0.1));
+  EXPECT_FALSE(masks.setFootprint(footprint, 0.1));
+
+  // a pose at the center of a cell covers the same cells as the oriented polygon
+  nav2_costmap_2d::Costmap2D polygon_costmap(20, 20, 0.1, 0.0, 0.0);
+  nav2_costmap_2d::Costmap2D mask_costmap(20, 20, 0.1, 0.0, 0.0);
+  std::vector<geometry_msgs::msg::Point> oriented_footprint;
+  nav2_costmap_2d::transformFootprint(1.05, 1.05, 0.0, footprint, oriented_footprint);
+  ASSERT_TRUE(polygon_costmap.setConvexPolygonCost(oriented_footprint, 100));
+  ASSERT_TRUE(mask_costmap.setFootprintCost(1.05, 1.05, 0.0, masks, 100));
+
+  int covered = 0;
+  for (unsigned int y = 0; y < 20; ++y) {
+    for (unsigned int x = 0; x < 20; ++x) {
+      EXPECT_EQ(polygon_costmap.getCost(x, y), mask_costmap.getCost(x, y));
+      covered += mask_costmap.getCost(x, y) == 100;
+    }
+  }
+  EXPECT_EQ(15, covered);
+
+  // a quarter turn lays the footprint on its side
+  const std::vector<nav2_costmap_2d::FootprintSpan> & spans = masks.fill(M_PI / 2);
+  ASSERT_EQ(5u, spans.size());
+  EXPECT_EQ(-1, spans[0].min_x);
+  EXPECT_EQ(1, spans[0].max_x);
+
+  // and a footprint partly off the map is left alone
+  EXPECT_FALSE(mask_costmap.setFootprintCost(0.05, 0.05, 0.0, masks, 0));
+}
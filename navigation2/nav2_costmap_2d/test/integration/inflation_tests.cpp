@@ -75,7 +75,11 @@ public:
     nav2_costmap_2d::InflationLayer * ilayer,
     double inflation_radius);
 
-  void initNode(double inflation_radius);
+  void initNode(double inflation_radius, std::vector<rclcpp::Parameter> parameters = {});
+
+  std::vector<std::vector<unsigned char>> inflateChangingObstacles();
+
+  std::vector<std::vector<unsigned char>> inflateStaticMapAndObstacles();
 
   void waitForMap(nav2_costmap_2d::StaticLayer * slayer);
 
@@ -169,9 +173,8 @@ void TestNode::validatePointInflation(
   delete[] seen;
 }
 
-void TestNode::initNode(double inflation_radius)
+void TestNode::initNode(double inflation_radius, std::vector<rclcpp::Parameter> parameters)
 {
-  std::vector<rclcpp::Parameter> parameters;
   // Set cost_scaling_factor parameter to 1.0 for inflation layer
   parameters.push_back(rclcpp::Parameter("inflation.cost_scaling_factor", 1.0));
   parameters.push_back(rclcpp::Parameter("inflation.inflation_radius", inflation_radius));
@@ -194,6 +197,84 @@ void TestNode::initNode(double inflation_radius)
   node_->declare_parameter("observation_sources", rclcpp::ParameterValue(std::string("")));
 }
 
+// Inflate a few obstacles, then move one of them, and return the costs
+// after each update
+std::vector<std::vector<unsigned char>> TestNode::inflateChangingObstacles()
+{
+  tf2_ros::Buffer tf(node_->get_clock());
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  layers.resizeMap(50, 50, 1, 0, 0);
+  std::vector<Point> polygon = setRadii(layers, 1, 1.75);
+
+  nav2_costmap_2d::ObstacleLayer * olayer = addObstacleLayer(layers, tf, node_);
+  addInflationLayer(layers, tf, node_);
+  layers.setFootprint(polygon);
+
+  nav2_costmap_2d::Costmap2D * costmap = layers.getCostmap();
+  std::vector<std::vector<unsigned char>> costs;
+  auto update = [&]() {
+      layers.updateMap(0, 0, 0);
+      unsigned char * data = costmap->getCharMap();
+      costs.emplace_back(data, data + costmap->getSizeInCellsX() * costmap->getSizeInCellsY());
+    };
+
+  addObservation(olayer, 5, 5, MAX_Z);
+  addObservation(olayer, 6, 5, MAX_Z);
+  addObservation(olayer, 30, 10, MAX_Z);
+  addObservation(olayer, 40, 40, MAX_Z);
+  update();
+
+  // Trace through the obstacle at <30, 10> to clear it, and mark <30, 5>
+  olayer->clearStaticObservations(true, true);
+  addObservation(olayer, 30, 5, MAX_Z, 30, 20, MAX_Z);
+  update();
+
+  // Nothing changes
+  olayer->clearStaticObservations(true, true);
+  update();
+
+  return costs;
+}
+
+// Inflate the static map with obstacles coming and going next to its own, and return the
+// costs after each update
+std::vector<std::vector<unsigned char>> TestNode::inflateStaticMapAndObstacles()
+{
+  tf2_ros::Buffer tf(node_->get_clock());
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  std::vector<Point> polygon = setRadii(layers, 1, 1);
+
+  auto slayer = addStaticLayer(layers, tf, node_);
+  nav2_costmap_2d::ObstacleLayer * olayer = addObstacleLayer(layers, tf, node_);
+  addInflationLayer(layers, tf, node_);
+  layers.setFootprint(polygon);
+  waitForMap(slayer);
+
+  nav2_costmap_2d::Costmap2D * costmap = layers.getCostmap();
+  std::vector<std::vector<unsigned char>> costs;
+  auto update = [&]() {
+      layers.updateMap(0, 0, 0);
+      unsigned char * data = costmap->getCharMap();
+      costs.emplace_back(data, data + costmap->getSizeInCellsX() * costmap->getSizeInCellsY());
+    };
+
+  update();
+
+  addObservation(olayer, 0, 0, 0.4);
+  addObservation(olayer, 1, 9);
+  update();
+
+  // Trace from the obstacle at <1, 9> to clear it, and mark <1, 5>
+  olayer->clearStaticObservations(true, true);
+  addObservation(olayer, 1, 5, MAX_Z, 1, 9, MAX_Z);
+  update();
+
+  olayer->clearStaticObservations(true, true);
+  update();
+
+  return costs;
+}
+
 TEST_F(TestNode, testAdjacentToObstacleCanStillMove)
 {
   initNode(4.1);
@@ -487,3 +568,76 @@ TEST_F(TestNode, testInflation3)
   ASSERT_EQ(countValues(*costmap, nav2_costmap_2d::LETHAL_OBSTACLE), 1u);
   ASSERT_EQ(countValues(*costmap, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE), 4u);
 }
+
+/**
+ * Test that the incremental mode gives the same costs as a full inflation
+ * as obstacles appear and disappear
+ */
+TEST_F(TestNode, testIncrementalInflation)
+{
+  initNode(3);
+  std::vector<std::vector<unsigned char>> expected = inflateChangingObstacles();
+
+  initNode(3, {rclcpp::Parameter("inflation.incremental", true)});
+  std::vector<std::vector<unsigned char>> costs = inflateChangingObstacles();
+
+  ASSERT_EQ(expected.size(), costs.size());
+  for (unsigned int i = 0; i < costs.size(); ++i) {
+    EXPECT_EQ(expected[i], costs[i]) << "after update " << i;
+  }
+}
+
+/**
+ * Test that the distance transform backend gives the same costs as the
+ * wavefront
+ */
+TEST_F(TestNode, testDistanceTransformInflation)
+{
+  initNode(3);
+  std::vector<std::vector<unsigned char>> expected = inflateChangingObstacles();
+
+  initNode(3, {rclcpp::Parameter("inflation.distance_transform", true)});
+  std::vector<std::vector<unsigned char>> costs = inflateChangingObstacles();
+
+  ASSERT_EQ(expected.size(), costs.size());
+  for (unsigned int i = 0; i < costs.size(); ++i) {
+    EXPECT_EQ(expected[i], costs[i]) << "after update " << i;
+  }
+}
+
+/**
+ * Test that caching the inflation of the static map gives the same costs as inflating it
+ * with the other obstacles on every update
+ */
+TEST_F(TestNode, testCachedStaticInflation)
+{
+  initNode(3);
+  std::vector<std::vector<unsigned char>> expected = inflateStaticMapAndObstacles();
+
+  initNode(3, {rclcpp::Parameter("inflation.cache_static_inflation", true)});
+  std::vector<std::vector<unsigned char>> costs = inflateStaticMapAndObstacles();
+
+  ASSERT_EQ(expected.size(), costs.size());
+  for (unsigned int i = 0; i < costs.size(); ++i) {
+    EXPECT_EQ(expected[i], costs[i]) << "after update " << i;
+  }
+}
+
+/**
+ * Test that inflating the static map from its shared distance field gives the same costs as
+ * the wavefront
+ */
+TEST_F(TestNode, testSharedDistanceFieldInflation)
+{
+  initNode(3);
+  std::vector<std::vector<unsigned char>> expected = inflateStaticMapAndObstacles();
+
+  initNode(3, {rclcpp::Parameter("inflation.cache_static_inflation", true),
+      rclcpp::Parameter("static.shared_distance_field", true)});
+  std::vector<std::vector<unsigned char>> costs = inflateStaticMapAndObstacles();
+
+  ASSERT_EQ(expected.size(), costs.size());
+  for (unsigned int i = 0; i < costs.size(); ++i) {
+    EXPECT_EQ(expected[i], costs[i]) << "after update " << i;
+  }
+}
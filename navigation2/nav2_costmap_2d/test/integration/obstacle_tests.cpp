@@ -35,10 +35,13 @@
 #include <memory>
 #include <string>
 #include <algorithm>
+#include <cmath>
 #include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/height_map_layer.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
 #include "nav2_costmap_2d/observation_buffer.hpp"
 #include "nav2_costmap_2d/testing_helper.hpp"
@@ -374,3 +377,198 @@ TEST_F(TestNode, testRepeatedResets) {
       return plugin->hasParameter(layer_param);
     }));
 }
+
+/**
+ * Verify that marks that are not seen again decay, without any clearing observation
+ */
+TEST_F(TestNode, testDecay) {
+  tf2_ros::Buffer tf(node_->get_clock());
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  layers.resizeMap(10, 10, 1, 0, 0);
+
+  auto olayer = std::make_shared<nav2_costmap_2d::ObstacleLayer>();
+  olayer->initialize(&layers, "obstacles", &tf, node_, nullptr, nullptr);
+  layers.addPlugin(olayer);
+  olayer->setDecayTime(0.2, 2);
+
+  addObservation(olayer.get(), 5.0, 5.0);
+  layers.updateMap(0, 0, 0);
+  nav2_costmap_2d::Costmap2D * costmap = layers.getCostmap();
+  ASSERT_EQ(countValues(*costmap, nav2_costmap_2d::LETHAL_OBSTACLE), 1);
+
+  // Too recent to decay, even once both stripes were looked at
+  olayer->clearStaticObservations(true, true);
+  layers.updateMap(0, 0, 0);
+  layers.updateMap(0, 0, 0);
+  ASSERT_EQ(countValues(*costmap, nav2_costmap_2d::LETHAL_OBSTACLE), 1);
+
+  rclcpp::sleep_for(std::chrono::milliseconds(300));
+  layers.updateMap(0, 0, 0);
+  layers.updateMap(0, 0, 0);
+  ASSERT_EQ(countValues(*costmap, nav2_costmap_2d::LETHAL_OBSTACLE), 0);
+}
+
+/**
+ * Verify that a planar scan cleared as polygons frees the space between its beams, but not
+ * the wedges between beams too far apart
+ */
+TEST_F(TestNode, testPolygonClearing) {
+  tf2_ros::Buffer tf(node_->get_clock());
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  layers.resizeMap(10, 10, 1, 0, 0);
+
+  auto olayer = std::make_shared<nav2_costmap_2d::ObstacleLayer>();
+  olayer->initialize(&layers, "obstacles", &tf, node_, nullptr, nullptr);
+  layers.addPlugin(olayer);
+
+  // A quarter circle of beams 6 m long from (0.5, 0.5), with or without those pointing
+  // between 0.45 and 1.15 rad
+  auto clear_scan = [&](bool with_gap) {
+      std::vector<double> angles;
+      for (double angle = 0.0; angle < M_PI / 2; angle += 0.1) {
+        if (!with_gap || angle < 0.45 || angle > 1.15) {
+          angles.push_back(angle);
+        }
+      }
+      sensor_msgs::msg::PointCloud2 cloud;
+      sensor_msgs::PointCloud2Modifier modifier(cloud);
+      modifier.setPointCloud2FieldsByString(1, "xyz");
+      modifier.resize(angles.size());
+      sensor_msgs::PointCloud2Iterator<float> iter_x(cloud, "x");
+      sensor_msgs::PointCloud2Iterator<float> iter_y(cloud, "y");
+      for (double angle : angles) {
+        *iter_x = 0.5 + 6.0 * std::cos(angle);
+        *iter_y = 0.5 + 6.0 * std::sin(angle);
+        ++iter_x;
+        ++iter_y;
+      }
+
+      geometry_msgs::msg::Point origin;
+      origin.x = 0.5;
+      origin.y = 0.5;
+      nav2_costmap_2d::Observation obs(origin, cloud, 100.0, 100.0);
+      obs.polygon_max_gap_ = 0.15;
+
+      olayer->clearStaticObservations(true, true);
+      olayer->addStaticObservation(obs, false, true);
+      olayer->setCost(3, 3, nav2_costmap_2d::LETHAL_OBSTACLE);
+      olayer->setCost(1, 4, nav2_costmap_2d::LETHAL_OBSTACLE);
+      olayer->setCost(8, 8, nav2_costmap_2d::LETHAL_OBSTACLE);
+      layers.updateMap(0, 0, 0);
+    };
+
+  clear_scan(false);
+  ASSERT_EQ(olayer->getCost(3, 3), nav2_costmap_2d::FREE_SPACE);
+  ASSERT_EQ(olayer->getCost(1, 4), nav2_costmap_2d::FREE_SPACE);
+  // beyond the scan
+  ASSERT_EQ(olayer->getCost(8, 8), nav2_costmap_2d::LETHAL_OBSTACLE);
+
+  // (3, 3) lies at 0.79 rad, in the gap, while (1, 4) at 1.33 rad is still seen
+  clear_scan(true);
+  ASSERT_EQ(olayer->getCost(3, 3), nav2_costmap_2d::LETHAL_OBSTACLE);
+  ASSERT_EQ(olayer->getCost(1, 4), nav2_costmap_2d::FREE_SPACE);
+  ASSERT_EQ(olayer->getCost(8, 8), nav2_costmap_2d::LETHAL_OBSTACLE);
+}
+
+/**
+ * Verify that the height map layer only clears the obstacles of a column that a ray passes at
+ * their height
+ */
+TEST_F(TestNode, testHeightMap) {
+  tf2_ros::Buffer tf(node_->get_clock());
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  layers.resizeMap(10, 10, 1, 0, 0);
+
+  auto hlayer = std::make_shared<nav2_costmap_2d::HeightMapLayer>();
+  hlayer->initialize(&layers, "height_map", &tf, node_, nullptr, nullptr);
+  layers.addPlugin(hlayer);
+
+  // A point 0.32 m up in (5, 5)
+  addObservation(hlayer.get(), 5.5, 5.5, 0.32, 0.5, 5.5, 0.32);
+  layers.updateMap(0, 0, 0);
+  ASSERT_EQ(hlayer->getCost(5, 5), nav2_costmap_2d::LETHAL_OBSTACLE);
+  ASSERT_EQ(hlayer->getColumn(5, 5).hits, 1);
+  ASSERT_EQ(hlayer->getColumn(5, 5).min_z, hlayer->heightStep(0.32));
+  ASSERT_EQ(hlayer->getColumn(5, 5).max_z, hlayer->heightStep(0.32));
+
+  // a ray a meter up passes over it
+  hlayer->clearStaticObservations(true, true);
+  addObservation(hlayer.get(), 9.5, 5.5, 1.0, 0.5, 5.5, 1.0);
+  layers.updateMap(0, 0, 0);
+  ASSERT_EQ(hlayer->getCost(5, 5), nav2_costmap_2d::LETHAL_OBSTACLE);
+  ASSERT_EQ(hlayer->getColumn(5, 5).hits, 1);
+
+  // and one at its height clears it
+  hlayer->clearStaticObservations(true, true);
+  addObservation(hlayer.get(), 9.5, 5.5, 0.32, 0.5, 5.5, 0.32);
+  layers.updateMap(0, 0, 0);
+  ASSERT_EQ(hlayer->getCost(5, 5), nav2_costmap_2d::FREE_SPACE);
+  ASSERT_EQ(hlayer->getColumn(5, 5).hits, 0);
+}
+
+/**
+ * Verify that a buffer takes a shared observation as it is when its heights take in the whole
+ * cloud, and filters or transforms it into one of its own when not
+ */
+TEST_F(TestNode, testSharedObservations) {
+  tf2_ros::Buffer tf(node_->get_clock());
+  geometry_msgs::msg::TransformStamped map_to_odom;
+  map_to_odom.header.frame_id = "map";
+  map_to_odom.child_frame_id = "odom";
+  map_to_odom.transform.translation.x = 2.0;
+  map_to_odom.transform.rotation.w = 1.0;
+  tf.setTransform(map_to_odom, "test", true);
+
+  // Points 0.1, 0.5 and 1.5 m up, seen from (0, 0, 0.3) in odom
+  sensor_msgs::msg::PointCloud2 cloud;
+  sensor_msgs::PointCloud2Modifier modifier(cloud);
+  modifier.setPointCloud2FieldsByString(1, "xyz");
+  modifier.resize(3);
+  sensor_msgs::PointCloud2Iterator<float> iter_x(cloud, "x");
+  sensor_msgs::PointCloud2Iterator<float> iter_z(cloud, "z");
+  for (float z : {0.1f, 0.5f, 1.5f}) {
+    *iter_x = 1.0;
+    *iter_z = z;
+    ++iter_x;
+    ++iter_z;
+  }
+  cloud.header.frame_id = "odom";
+  cloud.header.stamp = node_->now();
+  geometry_msgs::msg::Point origin;
+  origin.z = 0.3;
+  nav2_costmap_2d::Observation shared(origin, cloud, 0.0, 0.0);
+
+  auto take = [&](nav2_costmap_2d::ObservationBuffer & buffer) {
+      buffer.bufferShared(shared, 0.1f, 1.5f);
+      std::vector<nav2_costmap_2d::Observation> observations;
+      buffer.getObservations(observations);
+      EXPECT_EQ(observations.size(), 1u);
+      return observations.front();
+    };
+
+  // all the points are within 0 and 2 m, so the cloud is shared, with the buffer's ranges
+  nav2_costmap_2d::ObservationBuffer whole(node_, "scan", 0.0, 0.0, 0.0, 2.0, 2.5, 3.0, tf,
+    "odom", "", 0.3);
+  nav2_costmap_2d::Observation whole_obs = take(whole);
+  ASSERT_EQ(whole_obs.cloud_, shared.cloud_);
+  ASSERT_EQ(whole_obs.obstacle_range_, 2.5);
+  ASSERT_EQ(whole_obs.raytrace_range_, 3.0);
+
+  // the top one isn't below 1 m
+  nav2_costmap_2d::ObservationBuffer low(node_, "scan", 0.0, 0.0, 0.0, 1.0, 2.5, 3.0, tf,
+    "odom", "", 0.3);
+  nav2_costmap_2d::Observation low_obs = take(low);
+  ASSERT_NE(low_obs.cloud_, shared.cloud_);
+  ASSERT_EQ(low_obs.cloud_->width * low_obs.cloud_->height, 2u);
+
+  // in map, the points and origin move 2 m along x
+  nav2_costmap_2d::ObservationBuffer in_map(node_, "scan", 0.0, 0.0, 0.0, 2.0, 2.5, 3.0, tf,
+    "map", "", 0.3);
+  nav2_costmap_2d::Observation map_obs = take(in_map);
+  ASSERT_EQ(map_obs.cloud_->header.frame_id, "map");
+  ASSERT_EQ(map_obs.cloud_->width * map_obs.cloud_->height, 3u);
+  ASSERT_DOUBLE_EQ(map_obs.origin_.x, 2.0);
+  ASSERT_DOUBLE_EQ(map_obs.origin_.z, 0.3);
+  sensor_msgs::PointCloud2ConstIterator<float> map_x(*map_obs.cloud_, "x");
+  ASSERT_FLOAT_EQ(*map_x, 3.0f);
+}
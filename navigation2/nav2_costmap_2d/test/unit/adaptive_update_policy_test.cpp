@@ -0,0 +1,99 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/adaptive_update_policy.hpp"
+
+using nav2_costmap_2d::AdaptiveUpdatePolicy;
+
+static AdaptiveUpdatePolicy::Params params()
+{
+  AdaptiveUpdatePolicy::Params p;
+  p.min_frequency = 1.0;
+  p.max_frequency = 5.0;
+  p.full_speed = 0.5;
+  p.full_rotation = 1.0;
+  p.settle_time = 2.0;
+  p.min_window_scale = 0.5;
+  p.window_step = 0.25;
+  return p;
+}
+
+TEST(AdaptiveUpdatePolicy, ParkedUpdatesSlowlyOverTheSmallWindow)
+{
+  AdaptiveUpdatePolicy policy(params());
+  for (int i = 0; i < 10; ++i) {
+    policy.addPose(1.0, 2.0, 0.3, i * 0.2);
+  }
+  EXPECT_DOUBLE_EQ(policy.level(), 0.0);
+  EXPECT_DOUBLE_EQ(policy.frequency(), 1.0);
+  EXPECT_DOUBLE_EQ(policy.windowScale(), 0.5);
+}
+
+TEST(AdaptiveUpdatePolicy, FollowsASpeedUpAtOnce)
+{
+  AdaptiveUpdatePolicy policy(params());
+  policy.addPose(0.0, 0.0, 0.0, 0.0);
+  policy.addPose(0.05, 0.0, 0.0, 0.2);  // 0.25 m/s, half of full speed
+  EXPECT_DOUBLE_EQ(policy.level(), 0.5);
+  EXPECT_DOUBLE_EQ(policy.frequency(), 3.0);
+  EXPECT_DOUBLE_EQ(policy.windowScale(), 0.75);
+
+  policy.addPose(0.25, 0.0, 0.0, 0.4);  // 1 m/s
+  EXPECT_DOUBLE_EQ(policy.frequency(), 5.0);
+  EXPECT_DOUBLE_EQ(policy.windowScale(), 1.0);
+}
+
+TEST(AdaptiveUpdatePolicy, CountsRotationInPlace)
+{
+  AdaptiveUpdatePolicy policy(params());
+  policy.addPose(0.0, 0.0, 3.0, 0.0);
+  policy.addPose(0.0, 0.0, -3.0, 0.5);  // 0.28 rad across the wrap in 0.5 s
+  EXPECT_NEAR(policy.level(), (2.0 * M_PI - 6.0) / 0.5, 1e-9);
+}
+
+TEST(AdaptiveUpdatePolicy, SettlesAfterAStop)
+{
+  AdaptiveUpdatePolicy policy(params());
+  policy.addPose(0.0, 0.0, 0.0, 0.0);
+  policy.addPose(1.0, 0.0, 0.0, 1.0);
+  EXPECT_DOUBLE_EQ(policy.level(), 1.0);
+
+  // half the settle time takes it half the way down
+  policy.addPose(1.0, 0.0, 0.0, 2.0);
+  EXPECT_DOUBLE_EQ(policy.level(), 0.5);
+  for (int i = 3; i < 10; ++i) {
+    policy.addPose(1.0, 0.0, 0.0, i);
+  }
+  EXPECT_DOUBLE_EQ(policy.level(), 0.0);
+}
+
+TEST(AdaptiveUpdatePolicy, KeepsToTheCpuBudget)
+{
+  AdaptiveUpdatePolicy::Params p = params();
+  p.cpu_budget = 0.2;
+  AdaptiveUpdatePolicy policy(p);
+  policy.addPose(0.0, 0.0, 0.0, 0.0);
+  policy.addPose(1.0, 0.0, 0.0, 1.0);
+
+  // 0.1 s updates at 20% of a core: 2 Hz, not 5
+  policy.addUpdateTime(0.1);
+  EXPECT_DOUBLE_EQ(policy.frequency(), 2.0);
+
+  // but never below the parked rate
+  policy.addUpdateTime(1.1);
+  EXPECT_DOUBLE_EQ(policy.frequency(), 1.0);
+}
@@ -0,0 +1,141 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/async_layer.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/layered_costmap.hpp"
+
+// Marks a point as lethal, once its gate is opened
+class PointLayer : public nav2_costmap_2d::AsyncLayer
+{
+public:
+  explicit PointLayer(nav2_costmap_2d::LayeredCostmap * parent)
+  {
+    layered_costmap_ = parent;
+    enabled_ = true;
+  }
+
+  ~PointLayer() override
+  {
+    open();
+    stopWorker();
+  }
+
+  void open()
+  {
+    {
+      std::lock_guard<std::mutex> lock(gate_mutex_);
+      open_ = true;
+    }
+    gate_cv_.notify_all();
+  }
+
+  double next_x_{0.0}, next_y_{0.0};
+  int computations_{0};
+
+protected:
+  bool prepareCompute(double, double, double) override
+  {
+    x_ = next_x_;
+    y_ = next_y_;
+    return true;
+  }
+
+  void compute(
+    nav2_costmap_2d::Costmap2D & grid, nav2_costmap_2d::WorldBounds & changed) override
+  {
+    std::unique_lock<std::mutex> lock(gate_mutex_);
+    gate_cv_.wait(lock, [this] {return open_;});
+    unsigned int mx, my;
+    if (grid.worldToMap(x_, y_, mx, my)) {
+      grid.setCost(mx, my, nav2_costmap_2d::LETHAL_OBSTACLE);
+      changed = {x_, y_, x_, y_};
+    }
+    ++computations_;
+  }
+
+private:
+  double x_{0.0}, y_{0.0};
+  std::mutex gate_mutex_;
+  std::condition_variable gate_cv_;
+  bool open_{false};
+};
+
+TEST(AsyncLayer, PublishesOnTheUpdateAfterTheComputationFinishes)
+{
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  auto layer = std::make_shared<PointLayer>(&layers);
+  layers.addPlugin(layer);
+  layers.resizeMap(10, 10, 1.0, 0.0, 0.0);
+  nav2_costmap_2d::Costmap2D * master = layers.getCostmap();
+  layer->next_x_ = 3.5;
+  layer->next_y_ = 4.5;
+
+  // the computation runs on, blocked, while the updates go by without it
+  layers.updateMap(0, 0, 0);
+  layers.updateMap(0, 0, 0);
+  EXPECT_EQ(master->getCost(3, 4), nav2_costmap_2d::FREE_SPACE);
+
+  layer->open();
+  layer->waitForCompute();
+  EXPECT_EQ(layer->computations_, 1);
+  EXPECT_EQ(master->getCost(3, 4), nav2_costmap_2d::FREE_SPACE);
+  layers.updateMap(0, 0, 0);
+  EXPECT_EQ(master->getCost(3, 4), nav2_costmap_2d::LETHAL_OBSTACLE);
+
+  // and the next one was handed out as that one was published
+  layer->waitForCompute();
+  EXPECT_EQ(layer->computations_, 2);
+}
+
+TEST(AsyncLayer, PublishesWhereARollingWindowHasMovedTo)
+{
+  nav2_costmap_2d::LayeredCostmap layers("frame", true, false);
+  auto layer = std::make_shared<PointLayer>(&layers);
+  layers.addPlugin(layer);
+  layers.resizeMap(10, 10, 1.0, 0.0, 0.0);
+  nav2_costmap_2d::Costmap2D * master = layers.getCostmap();
+  layer->next_x_ = 3.5;
+  layer->next_y_ = 4.5;
+
+  // started with the window at the origin, finished with it two cells on
+  layers.updateMap(5.0, 5.0, 0);
+  layers.updateMap(7.0, 5.0, 0);
+  layer->open();
+  layer->waitForCompute();
+  layers.updateMap(7.0, 5.0, 0);
+
+  EXPECT_DOUBLE_EQ(master->getOriginX(), 2.0);
+  EXPECT_EQ(master->getCost(1, 4), nav2_costmap_2d::LETHAL_OBSTACLE);
+  EXPECT_EQ(master->getCost(3, 4), nav2_costmap_2d::FREE_SPACE);
+}
+
+TEST(AsyncLayer, CountsTheWorkersGridAsMemory)
+{
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  auto layer = std::make_shared<PointLayer>(&layers);
+  layers.addPlugin(layer);
+  layers.resizeMap(10, 10, 1.0, 0.0, 0.0);
+  layer->open();
+  EXPECT_EQ(layer->getMemoryUsage(), 100u);
+  layers.updateMap(0, 0, 0);
+  layer->waitForCompute();
+  EXPECT_EQ(layer->getMemoryUsage(), 200u);
+  EXPECT_DOUBLE_EQ(layer->getMemoryPerCell(), 2.0);
+}
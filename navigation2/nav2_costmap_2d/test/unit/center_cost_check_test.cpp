@@ -0,0 +1,68 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/center_cost_check.hpp"
+
+using nav2_costmap_2d::CenterCheckMode;
+using nav2_costmap_2d::CenterCheckResult;
+using nav2_costmap_2d::CenterCostCheck;
+
+TEST(CenterCostCheck, ExactWalksEveryPose)
+{
+  CenterCostCheck check(CenterCheckMode::EXACT, 128);
+  for (int cost = 0; cost <= 255; ++cost) {
+    EXPECT_EQ(check.classify(cost), CenterCheckResult::AMBIGUOUS);
+  }
+}
+
+TEST(CenterCostCheck, InscribedSettlesCollisions)
+{
+  CenterCostCheck check(CenterCheckMode::INSCRIBED, 128);
+  EXPECT_EQ(check.classify(nav2_costmap_2d::LETHAL_OBSTACLE), CenterCheckResult::COLLISION);
+  EXPECT_EQ(
+    check.classify(nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE), CenterCheckResult::COLLISION);
+  EXPECT_EQ(check.classify(nav2_costmap_2d::NO_INFORMATION), CenterCheckResult::AMBIGUOUS);
+  EXPECT_EQ(check.classify(0), CenterCheckResult::AMBIGUOUS);
+  EXPECT_EQ(check.classify(200), CenterCheckResult::AMBIGUOUS);
+}
+
+TEST(CenterCostCheck, CircumscribedSettlesFreePoses)
+{
+  CenterCostCheck check(CenterCheckMode::CIRCUMSCRIBED, 128);
+  EXPECT_EQ(check.classify(0), CenterCheckResult::FREE);
+  EXPECT_EQ(check.classify(127), CenterCheckResult::FREE);
+  EXPECT_EQ(check.classify(128), CenterCheckResult::AMBIGUOUS);
+  EXPECT_EQ(check.classify(252), CenterCheckResult::AMBIGUOUS);
+  EXPECT_EQ(
+    check.classify(nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE), CenterCheckResult::COLLISION);
+  EXPECT_EQ(check.classify(nav2_costmap_2d::NO_INFORMATION), CenterCheckResult::AMBIGUOUS);
+
+  // without an inflation reaching the circumscribed radius no pose is free
+  check.setCircumscribedCost(0);
+  EXPECT_EQ(check.classify(0), CenterCheckResult::AMBIGUOUS);
+}
+
+TEST(CenterCostCheck, ParsesModes)
+{
+  CenterCheckMode mode = CenterCheckMode::EXACT;
+  EXPECT_TRUE(nav2_costmap_2d::centerCheckModeFromString("circumscribed", mode));
+  EXPECT_EQ(mode, CenterCheckMode::CIRCUMSCRIBED);
+  EXPECT_TRUE(nav2_costmap_2d::centerCheckModeFromString("inscribed", mode));
+  EXPECT_EQ(mode, CenterCheckMode::INSCRIBED);
+  EXPECT_FALSE(nav2_costmap_2d::centerCheckModeFromString("center", mode));
+  EXPECT_EQ(mode, CenterCheckMode::INSCRIBED);
+  EXPECT_TRUE(nav2_costmap_2d::centerCheckModeFromString("exact", mode));
+  EXPECT_EQ(mode, CenterCheckMode::EXACT);
+}
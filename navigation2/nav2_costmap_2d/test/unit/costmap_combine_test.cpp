@@ -0,0 +1,66 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_combine.hpp"
+
+typedef void (* CombineFn)(unsigned char *, const unsigned char *, size_t);
+
+// Runs a kernel and its scalar reference over every pair of costs, at an odd
+// offset and length so that the unaligned head and the scalar tail are covered
+void expectMatchesScalar(CombineFn combine, CombineFn reference)
+{
+  std::vector<unsigned char> master, layer;
+  master.push_back(0);
+  layer.push_back(0);
+  for (int m = 0; m < 256; ++m) {
+    for (int l = 0; l < 256; ++l) {
+      master.push_back(m);
+      layer.push_back(l);
+    }
+  }
+  std::vector<unsigned char> expected = master;
+
+  size_t count = master.size() - 4;
+  combine(master.data() + 1, layer.data() + 1, count);
+  reference(expected.data() + 1, layer.data() + 1, count);
+  for (size_t i = 0; i < master.size(); ++i) {
+    ASSERT_EQ(master[i], expected[i]) << "at " << i;
+  }
+}
+
+TEST(CostmapCombine, maxMatchesScalar)
+{
+  expectMatchesScalar(nav2_costmap_2d::combineMax, nav2_costmap_2d::combineMaxScalar);
+}
+
+TEST(CostmapCombine, overwriteMatchesScalar)
+{
+  expectMatchesScalar(nav2_costmap_2d::combineOverwrite,
+    nav2_costmap_2d::combineOverwriteScalar);
+}
+
+TEST(CostmapCombine, additionMatchesScalar)
+{
+  expectMatchesScalar(nav2_costmap_2d::combineAddition,
+    nav2_costmap_2d::combineAdditionScalar);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_compression.hpp"
+
+using nav2_costmap_2d::decodeRunLength;
+using nav2_costmap_2d::encodeRunLength;
+
+TEST(CostmapCompression, roundTrip)
+{
+  // A mostly free map with an unknown border and a few obstacles
+  std::vector<unsigned char> map(1000 * 1000, nav2_costmap_2d::FREE_SPACE);
+  std::fill(map.begin(), map.begin() + 5000, nav2_costmap_2d::NO_INFORMATION);
+  for (unsigned int i = 0; i < 100; ++i) {
+    map[123457 + i * 4999] = nav2_costmap_2d::LETHAL_OBSTACLE;
+    map[123458 + i * 4999] = 128;
+  }
+
+  std::vector<uint8_t> encoded;
+  encodeRunLength(map.data(), map.size(), encoded);
+  EXPECT_LT(encoded.size(), 1000u);
+
+  std::vector<unsigned char> decoded(map.size());
+  ASSERT_TRUE(decodeRunLength(encoded, decoded.data(), decoded.size()));
+  EXPECT_EQ(decoded, map);
+}
+
+TEST(CostmapCompression, emptyMap)
+{
+  std::vector<uint8_t> encoded;
+  encodeRunLength(nullptr, 0, encoded);
+  EXPECT_TRUE(encoded.empty());
+  EXPECT_TRUE(decodeRunLength(encoded, nullptr, 0));
+}
+
+TEST(CostmapCompression, rejectsMismatchedSizes)
+{
+  std::vector<unsigned char> map(300, 7);
+  std::vector<uint8_t> encoded;
+  encodeRunLength(map.data(), map.size(), encoded);
+
+  std::vector<unsigned char> decoded(400);
+  EXPECT_FALSE(decodeRunLength(encoded, decoded.data(), 299));
+  EXPECT_FALSE(decodeRunLength(encoded, decoded.data(), 301));
+
+  // Cut off in the middle of a run
+  encoded.pop_back();
+  EXPECT_FALSE(decodeRunLength(encoded, decoded.data(), 300));
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
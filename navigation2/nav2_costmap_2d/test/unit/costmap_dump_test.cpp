@@ -0,0 +1,120 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_dump.hpp"
+#include "nav2_costmap_2d/costmap_layer.hpp"
+#include "nav2_costmap_2d/layered_costmap.hpp"
+
+// A layer with a grid of its own, sized by its parent without going through initialize()
+class GridLayer : public nav2_costmap_2d::CostmapLayer
+{
+public:
+  GridLayer(nav2_costmap_2d::LayeredCostmap * parent, const std::string & name)
+  {
+    layered_costmap_ = parent;
+    name_ = name;
+  }
+
+  void updateBounds(double, double, double, double *, double *, double *, double *) override {}
+  void updateCosts(nav2_costmap_2d::Costmap2D &, int, int, int, int) override {}
+};
+
+TEST(CostmapDump, costmapRoundTrip)
+{
+  nav2_costmap_2d::Costmap2D costmap(7, 5, 0.25, -1.0, 2.0);
+  for (unsigned int i = 0; i < 7 * 5; ++i) {
+    costmap.getCharMap()[i] = static_cast<unsigned char>(i * 7);
+  }
+  nav2_costmap_2d::CostmapDump::write("costmap_dump_test.dump", costmap);
+
+  nav2_costmap_2d::CostmapDump dump("costmap_dump_test.dump");
+  EXPECT_EQ(dump.sizeX(), 7u);
+  EXPECT_EQ(dump.sizeY(), 5u);
+  EXPECT_DOUBLE_EQ(dump.resolution(), 0.25);
+  EXPECT_DOUBLE_EQ(dump.originX(), -1.0);
+  EXPECT_DOUBLE_EQ(dump.originY(), 2.0);
+
+  nav2_costmap_2d::Costmap2D restored;
+  dump.restore(restored);
+  ASSERT_EQ(restored.getSizeInCellsX(), 7u);
+  ASSERT_EQ(restored.getSizeInCellsY(), 5u);
+  EXPECT_DOUBLE_EQ(restored.getOriginX(), -1.0);
+  for (unsigned int i = 0; i < 7 * 5; ++i) {
+    EXPECT_EQ(restored.getCharMap()[i], static_cast<unsigned char>(i * 7));
+  }
+  std::remove("costmap_dump_test.dump");
+}
+
+TEST(CostmapDump, layersRoundTrip)
+{
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  auto obstacles = std::make_shared<GridLayer>(&layers, "obstacles");
+  layers.addPlugin(obstacles);
+  layers.resizeMap(10, 8, 0.5, 1.0, 1.0);
+  layers.getCostmap()->setCost(3, 4, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+  obstacles->setCost(3, 4, nav2_costmap_2d::LETHAL_OBSTACLE);
+  obstacles->setCost(9, 7, 17);
+  nav2_costmap_2d::CostmapDump::write("layers_dump_test.dump", layers);
+
+  nav2_costmap_2d::LayeredCostmap restored("frame", false, false);
+  auto restored_obstacles = std::make_shared<GridLayer>(&restored, "obstacles");
+  auto added = std::make_shared<GridLayer>(&restored, "added");
+  restored.addPlugin(restored_obstacles);
+  restored.addPlugin(added);
+  restored.resizeMap(4, 4, 0.1, 0.0, 0.0);
+  added->setCost(0, 0, 42);
+
+  nav2_costmap_2d::CostmapDump dump("layers_dump_test.dump");
+  EXPECT_EQ(dump.restore(restored), 1u);
+
+  nav2_costmap_2d::Costmap2D * master = restored.getCostmap();
+  ASSERT_EQ(master->getSizeInCellsX(), 10u);
+  ASSERT_EQ(master->getSizeInCellsY(), 8u);
+  EXPECT_DOUBLE_EQ(master->getResolution(), 0.5);
+  EXPECT_EQ(master->getCost(3, 4), nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+  EXPECT_EQ(restored_obstacles->getCost(3, 4), nav2_costmap_2d::LETHAL_OBSTACLE);
+  EXPECT_EQ(restored_obstacles->getCost(9, 7), 17);
+  EXPECT_EQ(restored_obstacles->getCost(0, 0), nav2_costmap_2d::FREE_SPACE);
+
+  // The layer that was not dumped was resized with the others but not restored
+  EXPECT_EQ(added->getSizeInCellsX(), 10u);
+  EXPECT_EQ(added->getCost(0, 0), nav2_costmap_2d::FREE_SPACE);
+  std::remove("layers_dump_test.dump");
+}
+
+TEST(CostmapDump, rejectsOtherFiles)
+{
+  EXPECT_THROW(nav2_costmap_2d::CostmapDump("no_such_costmap.dump"), std::runtime_error);
+
+  {
+    std::ofstream file("not_a_costmap.dump");
+    file << "P2\n10\n10\n255\nand then a lot more text than a costmap dump header takes\n";
+  }
+  EXPECT_THROW(nav2_costmap_2d::CostmapDump("not_a_costmap.dump"), std::runtime_error);
+  std::remove("not_a_costmap.dump");
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,110 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_pyramid.hpp"
+
+using nav2_costmap_2d::Costmap2D;
+using nav2_costmap_2d::CostmapPyramid;
+
+void expectSameLevels(const CostmapPyramid & a, const CostmapPyramid & b)
+{
+  ASSERT_EQ(a.getLevels(), b.getLevels());
+  for (unsigned int level = 1; level <= a.getLevels(); ++level) {
+    const Costmap2D & la = a.getLevel(level);
+    const Costmap2D & lb = b.getLevel(level);
+    ASSERT_EQ(la.getSizeInCellsX(), lb.getSizeInCellsX());
+    ASSERT_EQ(la.getSizeInCellsY(), lb.getSizeInCellsY());
+    for (unsigned int y = 0; y < la.getSizeInCellsY(); ++y) {
+      for (unsigned int x = 0; x < la.getSizeInCellsX(); ++x) {
+        ASSERT_EQ(la.getCost(x, y), lb.getCost(x, y)) << level << ": " << x << ", " << y;
+      }
+    }
+  }
+}
+
+TEST(CostmapPyramid, PoolsTheHighestKnownCost)
+{
+  Costmap2D base(5, 3, 0.1, -1.0, 2.0, nav2_costmap_2d::NO_INFORMATION);
+  base.setCost(0, 0, 10);
+  base.setCost(1, 1, 200);
+  base.setCost(4, 2, nav2_costmap_2d::LETHAL_OBSTACLE);
+
+  CostmapPyramid pyramid;
+  pyramid.setLevels(2);
+  pyramid.rebuild(base);
+
+  const Costmap2D & level1 = pyramid.getLevel(1);
+  EXPECT_EQ(level1.getSizeInCellsX(), 3u);
+  EXPECT_EQ(level1.getSizeInCellsY(), 2u);
+  EXPECT_DOUBLE_EQ(level1.getResolution(), 0.2);
+  EXPECT_DOUBLE_EQ(level1.getOriginX(), -1.0);
+  EXPECT_DOUBLE_EQ(level1.getOriginY(), 2.0);
+  EXPECT_EQ(level1.getCost(0, 0), 200);
+  EXPECT_EQ(level1.getCost(1, 0), nav2_costmap_2d::NO_INFORMATION);
+  EXPECT_EQ(level1.getCost(2, 1), nav2_costmap_2d::LETHAL_OBSTACLE);
+
+  const Costmap2D & level2 = pyramid.getLevel(2);
+  EXPECT_EQ(level2.getSizeInCellsX(), 2u);
+  EXPECT_EQ(level2.getSizeInCellsY(), 1u);
+  EXPECT_EQ(level2.getCost(0, 0), 200);
+  EXPECT_EQ(level2.getCost(1, 0), nav2_costmap_2d::LETHAL_OBSTACLE);
+}
+
+TEST(CostmapPyramid, IncrementalUpdateMatchesRebuild)
+{
+  Costmap2D base(37, 29, 0.05, 0.0, 0.0, 0);
+  CostmapPyramid incremental, rebuilt;
+  incremental.setLevels(3);
+  rebuilt.setLevels(3);
+  incremental.rebuild(base);
+
+  srand(7);
+  for (int round = 0; round < 50; ++round) {
+    unsigned int x0 = rand() % 37, y0 = rand() % 29;
+    unsigned int xn = x0 + 1 + rand() % (37 - x0), yn = y0 + 1 + rand() % (29 - y0);
+    for (unsigned int y = y0; y < yn; ++y) {
+      for (unsigned int x = x0; x < xn; ++x) {
+        base.setCost(x, y, rand() % 256);
+      }
+    }
+    incremental.update(base, x0, y0, xn, yn);
+  }
+
+  rebuilt.rebuild(base);
+  expectSameLevels(incremental, rebuilt);
+}
+
+TEST(CostmapPyramid, RebuildsWhenTheBaseMoves)
+{
+  Costmap2D base(16, 16, 0.1, 0.0, 0.0, 0);
+  CostmapPyramid pyramid;
+  pyramid.setLevels(1);
+  pyramid.rebuild(base);
+
+  base.setCost(15, 15, 100);
+  base.updateOrigin(0.4, 0.4);
+  pyramid.update(base, 0, 0, 1, 1);
+  EXPECT_DOUBLE_EQ(pyramid.getLevel(1).getOriginX(), 0.4);
+  EXPECT_EQ(pyramid.getLevel(1).getCost(5, 5), 100);
+}
+
+int main(int argc, char ** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
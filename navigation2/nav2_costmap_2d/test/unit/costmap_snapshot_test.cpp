@@ -0,0 +1,83 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/layered_costmap.hpp"
+
+// A layer that marks one cell, which the test moves between updates
+class CellLayer : public nav2_costmap_2d::Layer
+{
+public:
+  void updateBounds(
+    double, double, double, double * min_x, double * min_y, double * max_x,
+    double * max_y) override
+  {
+    *min_x = *min_y = 0.0;
+    *max_x = *max_y = 10.0;
+  }
+
+  void updateCosts(nav2_costmap_2d::Costmap2D & master_grid, int, int, int, int) override
+  {
+    master_grid.setCost(x_, 0, nav2_costmap_2d::LETHAL_OBSTACLE);
+  }
+
+  unsigned int x_{0};
+};
+
+TEST(CostmapSnapshot, snapshotsAreOffByDefault)
+{
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  layers.resizeMap(10, 10, 1, 0, 0);
+  layers.addPlugin(std::make_shared<CellLayer>());
+  layers.updateMap(0, 0, 0);
+  EXPECT_EQ(layers.getSnapshot(), nullptr);
+}
+
+TEST(CostmapSnapshot, heldSnapshotIsNotModified)
+{
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  layers.resizeMap(10, 10, 1, 0, 0);
+  auto layer = std::make_shared<CellLayer>();
+  layers.addPlugin(layer);
+  layers.setSnapshots(true);
+
+  layers.updateMap(0, 0, 0);
+  std::shared_ptr<const nav2_costmap_2d::Costmap2D> first = layers.getSnapshot();
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(first->getCost(0, 0), nav2_costmap_2d::LETHAL_OBSTACLE);
+
+  // Later updates go to other copies while the first one is held
+  for (unsigned int x = 1; x < 4; ++x) {
+    layer->x_ = x;
+    layers.updateMap(0, 0, 0);
+    std::shared_ptr<const nav2_costmap_2d::Costmap2D> latest = layers.getSnapshot();
+    EXPECT_NE(latest, first);
+    EXPECT_EQ(latest->getCost(x, 0), nav2_costmap_2d::LETHAL_OBSTACLE);
+    EXPECT_EQ(latest->getCost(x - 1, 0), nav2_costmap_2d::FREE_SPACE);
+  }
+  EXPECT_EQ(first->getCost(0, 0), nav2_costmap_2d::LETHAL_OBSTACLE);
+  EXPECT_EQ(first->getCost(1, 0), nav2_costmap_2d::FREE_SPACE);
+
+  layers.setSnapshots(false);
+  EXPECT_EQ(layers.getSnapshot(), nullptr);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,77 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/dirty_regions.hpp"
+
+using nav2_costmap_2d::DirtyRegions;
+using nav2_costmap_2d::MapRegion;
+
+TEST(DirtyRegions, OneRegionIsTheBoundingBox)
+{
+  DirtyRegions regions;
+  regions.add(0, 0, 10, 10);
+  regions.add(990, 990, 1000, 1000);
+  regions.add(5, 5, 5, 20);  // empty
+  ASSERT_EQ(regions.get().size(), 1u);
+  MapRegion box = regions.get()[0];
+  EXPECT_EQ(box.x0, 0);
+  EXPECT_EQ(box.y0, 0);
+  EXPECT_EQ(box.xn, 1000);
+  EXPECT_EQ(box.yn, 1000);
+}
+
+TEST(DirtyRegions, KeepsDistantChangesApart)
+{
+  DirtyRegions regions(4);
+  regions.add(0, 0, 10, 10);
+  regions.add(990, 990, 1000, 1000);
+  EXPECT_EQ(regions.get().size(), 2u);
+
+  // overlapping the first, and next to it in the same rows
+  regions.add(5, 5, 15, 15);
+  regions.add(15, 0, 20, 15);
+  ASSERT_EQ(regions.get().size(), 2u);
+  int64_t area = 0;
+  for (const MapRegion & region : regions.get()) {
+    area += region.area();
+  }
+  EXPECT_EQ(area, 20 * 15 + 10 * 10);
+
+  // past the limit, the two closest regions merge
+  regions.add(500, 0, 510, 10);
+  regions.add(0, 500, 10, 510);
+  regions.add(520, 0, 530, 10);
+  ASSERT_EQ(regions.get().size(), 4u);
+  bool merged = false;
+  for (const MapRegion & region : regions.get()) {
+    merged |= region.x0 == 500 && region.xn == 530;
+  }
+  EXPECT_TRUE(merged);
+
+  MapRegion box = regions.bounds();
+  EXPECT_EQ(box.x0, 0);
+  EXPECT_EQ(box.xn, 1000);
+
+  regions.setMaxRegions(1);
+  EXPECT_EQ(regions.get().size(), 1u);
+  regions.clear();
+  EXPECT_TRUE(regions.empty());
+}
+
+int main(int argc, char ** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
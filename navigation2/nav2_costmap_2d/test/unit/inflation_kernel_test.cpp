@@ -0,0 +1,125 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/inflation_kernel.hpp"
+
+using nav2_costmap_2d::InflationKernel;
+
+unsigned char costOf(double distance)
+{
+  return distance == 0.0 ? nav2_costmap_2d::LETHAL_OBSTACLE :
+         static_cast<unsigned char>(252 * std::exp(-0.5 * distance)) + 1;
+}
+
+TEST(InflationKernel, LaysOutTheDistancesFlat)
+{
+  InflationKernel kernel;
+  EXPECT_TRUE(kernel.empty());
+  kernel.build(5, costOf);
+  EXPECT_EQ(kernel.radius(), 5u);
+  for (unsigned int dx = 0; dx <= 6; ++dx) {
+    for (unsigned int dy = 0; dy <= 6; ++dy) {
+      EXPECT_DOUBLE_EQ(kernel.distance(dx, dy), std::hypot(dx, dy));
+      EXPECT_EQ(kernel.cost(dx, dy), costOf(std::hypot(dx, dy)));
+    }
+  }
+}
+
+TEST(InflationKernel, RanksTheDistancesInOrder)
+{
+  InflationKernel kernel;
+  kernel.build(7, costOf);
+  // 0, 1, 2, 4, 5, 8, 9, 10, 13, 16, 17, 18, 20, 25, 26, 29, 32, 34, 36, 37, 40, 41, 45 and
+  // 49 are the sums of two squares up to 7 * 7
+  EXPECT_EQ(kernel.rankCount(), 24u);
+  EXPECT_EQ(kernel.rank(0, 0), 0u);
+  EXPECT_EQ(kernel.rank(1, 0), 1u);
+  EXPECT_EQ(kernel.rank(0, 7), 23u);
+  for (unsigned int dx = 0; dx <= 8; ++dx) {
+    for (unsigned int dy = 0; dy <= 8; ++dy) {
+      if (kernel.distance(dx, dy) > 7.0) {
+        EXPECT_EQ(kernel.rank(dx, dy), kernel.rankCount());
+        continue;
+      }
+      EXPECT_EQ(kernel.rank(dx, dy), kernel.rank(dy, dx));
+      for (unsigned int i = 0; i <= 8; ++i) {
+        for (unsigned int j = 0; j <= 8; ++j) {
+          if (kernel.distance(i, j) < kernel.distance(dx, dy)) {
+            EXPECT_LT(kernel.rank(i, j), kernel.rank(dx, dy));
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(InflationKernel, UnrolledStampsMatchTheGenericOne)
+{
+  const int size = 64;
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> cell(0, size - 1);
+  std::uniform_int_distribution<int> kind(0, 3);
+
+  for (unsigned int radius : {1u, 4u, 11u, 16u, 20u}) {
+    InflationKernel kernel;
+    kernel.build(radius, costOf);
+
+    std::vector<unsigned char> base(size * size);
+    for (auto & cost : base) {
+      cost = kind(rng) == 0 ? nav2_costmap_2d::NO_INFORMATION : nav2_costmap_2d::FREE_SPACE;
+    }
+    std::vector<unsigned char> unrolled = base, generic = base;
+    for (int n = 0; n < 20; ++n) {
+      int x = cell(rng), y = cell(rng);
+      kernel.stamp(unrolled.data(), size, size, x, y, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+      kernel.stampGeneric(generic.data(), size, size, x, y,
+        nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+    }
+    EXPECT_EQ(unrolled, generic) << "radius " << radius;
+  }
+}
+
+TEST(InflationKernel, StampsTheNearestObstaclesCost)
+{
+  InflationKernel kernel;
+  kernel.build(3, costOf);
+  std::vector<unsigned char> grid(10 * 10, nav2_costmap_2d::FREE_SPACE);
+  grid[5 * 10 + 2] = nav2_costmap_2d::NO_INFORMATION;
+  grid[5 * 10 + 4] = nav2_costmap_2d::NO_INFORMATION;
+
+  kernel.stamp(grid.data(), 10, 10, 3, 5, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+  kernel.stamp(grid.data(), 10, 10, 0, 0, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+  EXPECT_EQ(grid[5 * 10 + 3], nav2_costmap_2d::LETHAL_OBSTACLE);
+  EXPECT_EQ(grid[5 * 10 + 5], costOf(2.0));
+  EXPECT_EQ(grid[2 * 10 + 3], costOf(3.0));
+  EXPECT_EQ(grid[2 * 10 + 4], nav2_costmap_2d::FREE_SPACE);  // past the radius
+  EXPECT_EQ(grid[1 * 10 + 1], costOf(std::sqrt(2.0)));
+
+  // unknown cells only take costs at or over the threshold
+  EXPECT_EQ(grid[5 * 10 + 2], nav2_costmap_2d::NO_INFORMATION);
+  kernel.stamp(grid.data(), 10, 10, 3, 5, costOf(1.0));
+  EXPECT_EQ(grid[5 * 10 + 4], costOf(1.0));
+}
+
+int main(int argc, char ** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/layered_costmap.hpp"
+
+// A layer holding a copy of the master grid, at bytes_per_cell, plus a fixed table
+class GridLayer : public nav2_costmap_2d::Layer
+{
+public:
+  GridLayer(const std::string & name, double bytes_per_cell, size_t table_bytes)
+  : bytes_per_cell_(bytes_per_cell), table_bytes_(table_bytes)
+  {
+    name_ = name;
+  }
+
+  void updateBounds(double, double, double, double *, double *, double *, double *) override {}
+
+  void updateCosts(nav2_costmap_2d::Costmap2D &, int, int, int, int) override {}
+
+  void matchSize() override
+  {
+    cells_ = static_cast<size_t>(layered_costmap_->getCostmap()->getSizeInCellsX()) *
+      layered_costmap_->getCostmap()->getSizeInCellsY();
+    ++resizes_;
+  }
+
+  size_t getMemoryUsage() const override
+  {
+    return static_cast<size_t>(bytes_per_cell_ * cells_) + table_bytes_;
+  }
+
+  double getMemoryPerCell() const override {return bytes_per_cell_;}
+
+  void attach(nav2_costmap_2d::LayeredCostmap * layers) {layered_costmap_ = layers;}
+
+  double bytes_per_cell_;
+  size_t table_bytes_;
+  size_t cells_{0};
+  int resizes_{0};
+};
+
+static size_t totalOf(const std::vector<nav2_costmap_2d::LayerMemory> & usage)
+{
+  size_t total = 0;
+  for (const auto & part : usage) {
+    total += part.bytes;
+  }
+  return total;
+}
+
+TEST(MemoryBudget, countsEachLayer)
+{
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  auto grid = std::make_shared<GridLayer>("grid", 2.0, 1000);
+  grid->attach(&layers);
+  layers.addPlugin(grid);
+  layers.resizeMap(100, 50, 1, 0, 0);
+
+  std::vector<nav2_costmap_2d::LayerMemory> usage = layers.getMemoryUsage();
+  ASSERT_EQ(usage.size(), 2u);
+  EXPECT_EQ(usage[0].name, "master");
+  EXPECT_EQ(usage[0].bytes, 5000u);
+  EXPECT_EQ(usage[1].name, "grid");
+  EXPECT_EQ(usage[1].bytes, 11000u);
+
+  // the estimate at the current size is what is held
+  EXPECT_EQ(layers.estimateMemoryUsage(100, 50), totalOf(usage));
+  EXPECT_EQ(layers.estimateMemoryUsage(200, 100), 60000u + 1000u);
+}
+
+TEST(MemoryBudget, countsSnapshotsAndPyramid)
+{
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  layers.setSnapshots(true);
+  layers.resizeMap(64, 64, 1, 0, 0);
+  layers.setPyramidLevels(2);
+  layers.updateMap(0, 0, 0);
+  layers.updateMap(0, 0, 0);
+
+  // the grid, the published snapshot and its spare, and levels of 32 x 32 and 16 x 16
+  const size_t expected = 3 * 64 * 64 + 32 * 32 + 16 * 16;
+  EXPECT_EQ(layers.getMemoryUsage()[0].bytes, expected);
+  EXPECT_EQ(layers.estimateMemoryUsage(64, 64), expected);
+}
+
+TEST(MemoryBudget, refusesResizesOverBudget)
+{
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  auto grid = std::make_shared<GridLayer>("grid", 4.0, 0);
+  grid->attach(&layers);
+  layers.addPlugin(grid);
+  layers.setMemoryBudget(50000);
+
+  EXPECT_TRUE(layers.resizeMap(100, 100, 1, 0, 0));
+  EXPECT_EQ(grid->resizes_, 1);
+
+  EXPECT_FALSE(layers.resizeMap(101, 100, 0.5, 1, 1));
+  EXPECT_EQ(grid->resizes_, 1);
+  EXPECT_EQ(layers.getCostmap()->getSizeInCellsX(), 100u);
+  EXPECT_EQ(layers.getCostmap()->getResolution(), 1.0);
+
+  // smaller maps still fit, and no budget allows any size
+  EXPECT_TRUE(layers.resizeMap(50, 50, 1, 0, 0));
+  layers.setMemoryBudget(0);
+  EXPECT_TRUE(layers.resizeMap(1000, 1000, 1, 0, 0));
+  EXPECT_EQ(grid->resizes_, 3);
+}
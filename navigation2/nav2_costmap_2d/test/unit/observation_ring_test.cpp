@@ -0,0 +1,108 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/observation_ring.hpp"
+
+using nav2_costmap_2d::Observation;
+using nav2_costmap_2d::ObservationRing;
+
+// An observation whose origin records when it was taken
+std::shared_ptr<const Observation> observationAt(int64_t stamp_ns)
+{
+  auto observation = std::make_shared<Observation>();
+  observation->origin_.x = stamp_ns;
+  return observation;
+}
+
+TEST(ObservationRing, keepsTheNewestObservations)
+{
+  ObservationRing ring(3);
+  EXPECT_EQ(ring.size(), 0u);
+  for (int64_t stamp = 1; stamp <= 3; ++stamp) {
+    EXPECT_EQ(ring.push(observationAt(stamp), stamp), nullptr);
+  }
+
+  // once full, each push takes the place of the oldest observation
+  std::shared_ptr<const Observation> evicted = ring.push(observationAt(4), 4);
+  ASSERT_NE(evicted, nullptr);
+  EXPECT_EQ(evicted->origin_.x, 1.0);
+  EXPECT_EQ(ring.size(), 3u);
+
+  std::vector<std::shared_ptr<const Observation>> observations;
+  ring.collect(0, 10, observations);
+  ASSERT_EQ(observations.size(), 3u);
+  EXPECT_EQ(observations[0]->origin_.x, 4.0);
+  EXPECT_EQ(observations[2]->origin_.x, 2.0);
+  EXPECT_EQ(ring.at(1)->origin_.x, 3.0);
+}
+
+TEST(ObservationRing, collectsOnlyRecentObservations)
+{
+  ObservationRing ring(8);
+  for (int64_t stamp = 1; stamp <= 5; ++stamp) {
+    ring.push(observationAt(stamp), stamp);
+  }
+
+  std::vector<std::shared_ptr<const Observation>> observations;
+  ring.collect(3, 10, observations);
+  EXPECT_EQ(observations.size(), 3u);
+
+  observations.clear();
+  ring.collect(0, 1, observations);
+  ASSERT_EQ(observations.size(), 1u);
+  EXPECT_EQ(observations[0]->origin_.x, 5.0);
+
+  // the reader sees a replaced observation in the same place
+  ring.replace(0, observationAt(50));
+  observations.clear();
+  ring.collect(0, 1, observations);
+  EXPECT_EQ(observations[0]->origin_.x, 50.0);
+}
+
+TEST(ObservationRing, readsWhileWriting)
+{
+  ObservationRing ring(4);
+  const int64_t pushes = 20000;
+  std::atomic<bool> done{false};
+
+  std::thread writer([&]() {
+      for (int64_t stamp = 1; stamp <= pushes; ++stamp) {
+        ring.push(observationAt(stamp), stamp);
+      }
+      done = true;
+    });
+
+  // whatever a reader gets is newest first, within the capacity and never torn
+  std::vector<std::shared_ptr<const Observation>> observations;
+  while (!done) {
+    observations.clear();
+    ring.collect(0, ring.capacity(), observations);
+    ASSERT_LE(observations.size(), ring.capacity());
+    for (size_t i = 1; i < observations.size(); ++i) {
+      EXPECT_EQ(observations[i]->origin_.x, observations[i - 1]->origin_.x - 1.0);
+    }
+  }
+  writer.join();
+
+  observations.clear();
+  ring.collect(0, ring.capacity(), observations);
+  ASSERT_EQ(observations.size(), 4u);
+  EXPECT_EQ(observations[0]->origin_.x, static_cast<double>(pushes));
+}
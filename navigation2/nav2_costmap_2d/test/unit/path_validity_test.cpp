@@ -0,0 +1,152 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/path_validity.hpp"
+
+using nav2_costmap_2d::Costmap2D;
+using nav2_costmap_2d::LETHAL_OBSTACLE;
+using nav2_costmap_2d::PathValidity;
+
+namespace
+{
+
+// A path along y = 5.05 from x = 0.05 to 9.05 on a 10 m map of 0.1 m cells
+std::vector<geometry_msgs::msg::Pose2D> straightPath()
+{
+  std::vector<geometry_msgs::msg::Pose2D> poses(91);
+  for (size_t i = 0; i < poses.size(); ++i) {
+    poses[i].x = 0.05 + 0.1 * i;
+    poses[i].y = 5.05;
+  }
+  return poses;
+}
+
+// A 0.3 m square footprint
+std::vector<geometry_msgs::msg::Point> squareFootprint()
+{
+  std::vector<geometry_msgs::msg::Point> footprint(4);
+  footprint[0].x = 0.15;
+  footprint[0].y = 0.15;
+  footprint[1].x = -0.15;
+  footprint[1].y = 0.15;
+  footprint[2].x = -0.15;
+  footprint[2].y = -0.15;
+  footprint[3].x = 0.15;
+  footprint[3].y = -0.15;
+  return footprint;
+}
+
+}  // namespace
+
+TEST(PathValidity, FirstCheckLooksAtEveryPose)
+{
+  Costmap2D costmap(100, 100, 0.1, 0.0, 0.0);
+  PathValidity validity;
+  size_t checked = 0;
+  ASSERT_EQ(validity.check(costmap, straightPath(), squareFootprint(), &checked), -1);
+  ASSERT_EQ(checked, 91u);
+
+  // with nothing changed, nothing is checked again
+  ASSERT_EQ(validity.check(costmap, straightPath(), squareFootprint(), &checked), -1);
+  ASSERT_EQ(checked, 0u);
+}
+
+TEST(PathValidity, ChecksOnlyPosesNearChanges)
+{
+  Costmap2D costmap(100, 100, 0.1, 0.0, 0.0);
+  PathValidity validity;
+  validity.check(costmap, straightPath(), squareFootprint());
+
+  // an obstacle a cell above the path, within the footprint of the poses around x = 5
+  costmap.setCost(50, 51, LETHAL_OBSTACLE);
+  validity.addDirtyRegion({50, 51, 51, 52});
+  size_t checked = 0;
+  ASSERT_EQ(validity.check(costmap, straightPath(), squareFootprint(), &checked), 49);
+  ASSERT_LT(checked, 10u);
+
+  // once it's gone the path is clear again
+  costmap.setCost(50, 51, nav2_costmap_2d::FREE_SPACE);
+  validity.addDirtyRegion({50, 51, 51, 52});
+  ASSERT_EQ(validity.check(costmap, straightPath(), squareFootprint(), &checked), -1);
+  ASSERT_LT(checked, 10u);
+}
+
+TEST(PathValidity, ChangesAwayFromThePathAreNotChecked)
+{
+  Costmap2D costmap(100, 100, 0.1, 0.0, 0.0);
+  PathValidity validity;
+  validity.check(costmap, straightPath(), squareFootprint());
+
+  // a change unnoticed, as if the dirty regions were missed, stays unnoticed
+  costmap.setCost(20, 50, LETHAL_OBSTACLE);
+  validity.addDirtyRegion({80, 10, 90, 20});
+  size_t checked = 0;
+  ASSERT_EQ(validity.check(costmap, straightPath(), squareFootprint(), &checked), -1);
+  ASSERT_EQ(checked, 0u);
+
+  // a new path is checked whole
+  std::vector<geometry_msgs::msg::Pose2D> path = straightPath();
+  path.pop_back();
+  ASSERT_EQ(validity.check(costmap, path, squareFootprint(), &checked), 19);
+  ASSERT_EQ(checked, 20u);
+}
+
+TEST(PathValidity, PosesPastABlockedOneAreCheckedOnceItClears)
+{
+  Costmap2D costmap(100, 100, 0.1, 0.0, 0.0);
+  PathValidity validity;
+  validity.check(costmap, straightPath(), squareFootprint());
+
+  // two obstacles come up at once, and the first hides the second
+  costmap.setCost(30, 50, LETHAL_OBSTACLE);
+  costmap.setCost(70, 50, LETHAL_OBSTACLE);
+  validity.addDirtyRegion({30, 50, 71, 51});
+  ASSERT_EQ(validity.check(costmap, straightPath(), squareFootprint()), 29);
+
+  costmap.setCost(30, 50, nav2_costmap_2d::FREE_SPACE);
+  validity.addDirtyRegion({30, 50, 31, 51});
+  ASSERT_EQ(validity.check(costmap, straightPath(), squareFootprint()), 69);
+}
+
+TEST(PathValidity, AMovedMapIsCheckedWhole)
+{
+  Costmap2D costmap(100, 100, 0.1, 0.0, 0.0);
+  PathValidity validity;
+  validity.check(costmap, straightPath(), squareFootprint());
+
+  costmap.updateOrigin(0.5, 0.0);
+  size_t checked = 0;
+  ASSERT_EQ(validity.check(costmap, straightPath(), squareFootprint(), &checked), -1);
+  ASSERT_EQ(checked, 91u);
+}
+
+TEST(PathValidity, APointOnAnInflatedMapIsBlockedFromTheInscribedCost)
+{
+  Costmap2D costmap(100, 100, 0.1, 0.0, 0.0);
+  PathValidity validity(1, 16, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+  std::vector<geometry_msgs::msg::Point> point;
+
+  // only the cells under the poses count, and unknown ones don't block
+  costmap.setCost(40, 51, LETHAL_OBSTACLE);
+  costmap.setCost(50, 50, nav2_costmap_2d::NO_INFORMATION);
+  ASSERT_EQ(validity.check(costmap, straightPath(), point), -1);
+
+  costmap.setCost(60, 50, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+  validity.addDirtyRegion({60, 50, 61, 51});
+  ASSERT_EQ(validity.check(costmap, straightPath(), point), 60);
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_layer.hpp"
+
+using nav2_costmap_2d::Costmap2D;
+using nav2_costmap_2d::FootprintSpan;
+
+class ClearableLayer : public nav2_costmap_2d::CostmapLayer
+{
+public:
+  void updateBounds(double, double, double, double *, double *, double *, double *) override {}
+  void updateCosts(Costmap2D &, int, int, int, int) override {}
+
+  bool hasExtraBounds() const
+  {
+    return has_extra_bounds_;
+  }
+};
+
+geometry_msgs::msg::Point makePoint(double x, double y)
+{
+  geometry_msgs::msg::Point point;
+  point.x = x;
+  point.y = y;
+  return point;
+}
+
+TEST(QueuedClear, ResetsOutsideTheWindow)
+{
+  Costmap2D map(10, 8, 1.0, 0.0, 0.0, 0);
+  map.resetMapOutside(2, 3, 5, 6, 254);
+  for (unsigned int y = 0; y < 8; ++y) {
+    for (unsigned int x = 0; x < 10; ++x) {
+      bool kept = x >= 2 && x < 5 && y >= 3 && y < 6;
+      EXPECT_EQ(map.getCost(x, y), kept ? 0 : 254) << x << ", " << y;
+    }
+  }
+
+  // a window past the edges keeps everything
+  map.resetMapOutside(-4, -4, 20, 20, 100);
+  EXPECT_EQ(map.getCost(0, 0), 254);
+  EXPECT_EQ(map.getCost(3, 4), 0);
+}
+
+TEST(QueuedClear, FillsConcavePolygons)
+{
+  Costmap2D map(10, 10, 1.0, 0.0, 0.0, 0);
+  std::vector<geometry_msgs::msg::Point> l_shape = {
+    makePoint(0.0, 0.0), makePoint(6.0, 0.0), makePoint(6.0, 2.0),
+    makePoint(2.0, 2.0), makePoint(2.0, 6.0), makePoint(0.0, 6.0)};
+  std::vector<FootprintSpan> spans;
+  map.polygonSpans(l_shape, spans);
+  map.setSpansToValue(spans, 254);
+
+  for (unsigned int y = 0; y < 10; ++y) {
+    for (unsigned int x = 0; x < 10; ++x) {
+      bool inside = (y < 2 && x < 6) || (y < 6 && x < 2);
+      EXPECT_EQ(map.getCost(x, y), inside ? 254 : 0) << x << ", " << y;
+    }
+  }
+}
+
+TEST(QueuedClear, WaitsForTheNextUpdate)
+{
+  ClearableLayer layer;
+  layer.resizeMap(10, 10, 1.0, 0.0, 0.0);
+  layer.resetMapToValue(0, 0, 10, 10, 100);
+
+  layer.queueClearExcept(2.0, 2.0, 5.0, 5.0, 0);
+  EXPECT_EQ(layer.getCost(0, 0), 100);
+  EXPECT_FALSE(layer.hasExtraBounds());
+
+  layer.applyQueuedChanges();
+  EXPECT_EQ(layer.getCost(0, 0), 0);
+  EXPECT_EQ(layer.getCost(3, 3), 100);
+  EXPECT_EQ(layer.getCost(5, 5), 0);
+  EXPECT_TRUE(layer.hasExtraBounds());
+
+  // the mask follows the map when the origin moves before the clear is applied
+  layer.resetMapToValue(0, 0, 10, 10, 100);
+  layer.queueClearPolygon(
+    {makePoint(1.0, 1.0), makePoint(3.0, 1.0), makePoint(3.0, 3.0), makePoint(1.0, 3.0)}, 0);
+  layer.updateOrigin(1.0, 0.0);
+  layer.applyQueuedChanges();
+  for (unsigned int y = 0; y < 5; ++y) {
+    for (unsigned int x = 0; x < 5; ++x) {
+      bool inside = x < 2 && y >= 1 && y < 3;
+      EXPECT_EQ(layer.getCost(x, y), inside ? 0 : 100) << x << ", " << y;
+    }
+  }
+}
+
+int main(int argc, char ** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
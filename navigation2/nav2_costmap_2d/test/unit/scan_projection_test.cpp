@@ -0,0 +1,102 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/scan_projection.hpp"
+
+// A sensor 0.3 m up and 1 m ahead, turned a quarter turn to the left
+nav2_costmap_2d::ScanProjection quarterTurn()
+{
+  nav2_costmap_2d::ScanProjection projection = {
+    {{0.0f, -1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}, {1.0f, 0.0f, 0.3f},
+    0.1f, 10.0f, std::numeric_limits<float>::infinity(), 0.0f, 2.0f};
+  return projection;
+}
+
+TEST(ScanProjection, projectsAndFiltersBeams)
+{
+  const float inf = std::numeric_limits<float>::infinity();
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> ranges = {2.0f, 0.05f, 10.0f, inf, nan, 3.0f};
+  std::vector<float> cos_table, sin_table;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    cos_table.push_back(std::cos(i * 0.5f));
+    sin_table.push_back(std::sin(i * 0.5f));
+  }
+
+  std::vector<float> x(ranges.size()), y(ranges.size()), z(ranges.size());
+  std::vector<unsigned char> keep(ranges.size());
+  nav2_costmap_2d::ScanProjection projection = quarterTurn();
+  nav2_costmap_2d::projectScan(projection, ranges.data(), cos_table.data(), sin_table.data(),
+    ranges.size(), x.data(), y.data(), z.data(), keep.data());
+
+  // straight ahead of the sensor is to the left of the robot
+  EXPECT_FLOAT_EQ(x[0], 1.0f);
+  EXPECT_FLOAT_EQ(y[0], 2.0f);
+  EXPECT_FLOAT_EQ(z[0], 0.3f);
+  EXPECT_EQ(keep, std::vector<unsigned char>({1, 0, 0, 0, 0, 1}));
+
+  // with inf_is_valid, +inf is taken just short of the maximum range
+  projection.inf_range = 9.9999f;
+  nav2_costmap_2d::projectScan(projection, ranges.data(), cos_table.data(), sin_table.data(),
+    ranges.size(), x.data(), y.data(), z.data(), keep.data());
+  EXPECT_EQ(keep, std::vector<unsigned char>({1, 0, 0, 1, 0, 1}));
+
+  // and nothing is kept outside of the height band
+  projection.min_z = 0.5f;
+  nav2_costmap_2d::projectScan(projection, ranges.data(), cos_table.data(), sin_table.data(),
+    ranges.size(), x.data(), y.data(), z.data(), keep.data());
+  EXPECT_EQ(keep, std::vector<unsigned char>(ranges.size(), 0));
+}
+
+TEST(ScanProjection, matchesScalar)
+{
+  // an odd count, so that the scalar tail is covered
+  const size_t count = 1081;
+  std::vector<float> ranges(count), cos_table(count), sin_table(count);
+  for (size_t i = 0; i < count; ++i) {
+    double angle = -2.35 + i * 0.00436;
+    cos_table[i] = std::cos(angle);
+    sin_table[i] = std::sin(angle);
+    ranges[i] = i % 7 == 0 ? std::numeric_limits<float>::infinity() : 0.01f * (i % 1200);
+  }
+
+  nav2_costmap_2d::ScanProjection projection = quarterTurn();
+  projection.rotation[2][0] = 0.2f;  // pitched, so that the height band cuts some beams
+  projection.inf_range = 9.9999f;
+  projection.max_z = 1.0f;
+
+  std::vector<float> x(count), y(count), z(count), ex(count), ey(count), ez(count);
+  std::vector<unsigned char> keep(count), expected_keep(count);
+  nav2_costmap_2d::projectScan(projection, ranges.data(), cos_table.data(), sin_table.data(),
+    count, x.data(), y.data(), z.data(), keep.data());
+  nav2_costmap_2d::projectScanScalar(projection, ranges.data(), cos_table.data(),
+    sin_table.data(), count, ex.data(), ey.data(), ez.data(), expected_keep.data());
+  for (size_t i = 0; i < count; ++i) {
+    EXPECT_FLOAT_EQ(x[i], ex[i]) << "beam " << i;
+    EXPECT_FLOAT_EQ(y[i], ey[i]) << "beam " << i;
+    EXPECT_FLOAT_EQ(z[i], ez[i]) << "beam " << i;
+    EXPECT_EQ(keep[i], expected_keep[i]) << "beam " << i;
+  }
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,108 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/shared_costmap.hpp"
+
+using nav2_costmap_2d::Costmap2D;
+using nav2_costmap_2d::SharedCostmapReader;
+using nav2_costmap_2d::SharedCostmapWriter;
+
+static std::string segmentName()
+{
+  return "shared_costmap_test_" + std::to_string(getpid());
+}
+
+TEST(SharedCostmap, readsLatestSnapshot)
+{
+  SharedCostmapWriter writer(segmentName());
+  SharedCostmapReader reader(segmentName());
+
+  nav2_msgs::msg::Costmap costmap;
+  uint64_t version;
+  EXPECT_EQ(reader.version(), 0u);
+  EXPECT_FALSE(reader.read(costmap, version));
+
+  Costmap2D grid(20, 10, 0.05, 1.0, -2.0, 0);
+  grid.setCost(3, 4, 254);
+  writer.write(grid);
+  EXPECT_EQ(writer.version(), 1u);
+  EXPECT_EQ(reader.version(), 1u);
+
+  ASSERT_TRUE(reader.read(costmap, version));
+  EXPECT_EQ(version, 1u);
+  EXPECT_EQ(costmap.metadata.size_x, 20u);
+  EXPECT_EQ(costmap.metadata.size_y, 10u);
+  EXPECT_FLOAT_EQ(costmap.metadata.resolution, 0.05);
+  EXPECT_DOUBLE_EQ(costmap.metadata.origin.position.x, 1.0);
+  EXPECT_DOUBLE_EQ(costmap.metadata.origin.position.y, -2.0);
+  ASSERT_EQ(costmap.data.size(), 200u);
+  EXPECT_EQ(costmap.data[4 * 20 + 3], 254);
+  EXPECT_EQ(costmap.data[0], 0);
+
+  grid.setCost(3, 4, 0);
+  writer.write(grid);
+  ASSERT_TRUE(reader.read(costmap, version));
+  EXPECT_EQ(version, 2u);
+  EXPECT_EQ(costmap.data[4 * 20 + 3], 0);
+}
+
+TEST(SharedCostmap, followsLargerCostmap)
+{
+  SharedCostmapWriter writer(segmentName());
+  SharedCostmapReader reader(segmentName());
+
+  Costmap2D small(10, 10, 0.1, 0.0, 0.0, 7);
+  writer.write(small);
+  nav2_msgs::msg::Costmap costmap;
+  uint64_t version;
+  ASSERT_TRUE(reader.read(costmap, version));
+  EXPECT_EQ(costmap.data.size(), 100u);
+
+  // the writer moves to a larger segment, which the reader maps in place of the old one
+  Costmap2D large(100, 50, 0.1, 0.0, 0.0, 9);
+  writer.write(large);
+  ASSERT_TRUE(reader.read(costmap, version));
+  EXPECT_EQ(version, 2u);
+  EXPECT_EQ(costmap.metadata.size_x, 100u);
+  ASSERT_EQ(costmap.data.size(), 5000u);
+  EXPECT_EQ(costmap.data[4999], 9);
+
+  // and a smaller costmap fits in the segment it already has
+  writer.write(small);
+  ASSERT_TRUE(reader.read(costmap, version));
+  EXPECT_EQ(version, 3u);
+  EXPECT_EQ(costmap.data.size(), 100u);
+  EXPECT_EQ(costmap.data[99], 7);
+}
+
+TEST(SharedCostmap, writerRemovesSegment)
+{
+  SharedCostmapReader reader(segmentName());
+  {
+    SharedCostmapWriter writer(segmentName());
+    writer.write(Costmap2D(5, 5, 0.1, 0.0, 0.0, 0));
+    EXPECT_EQ(reader.version(), 1u);
+  }
+
+  nav2_msgs::msg::Costmap costmap;
+  uint64_t version;
+  EXPECT_EQ(reader.version(), 0u);
+  EXPECT_FALSE(reader.read(costmap, version));
+}
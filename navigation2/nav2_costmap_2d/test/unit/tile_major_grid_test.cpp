@@ -0,0 +1,82 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/tile_major_grid.hpp"
+
+TEST(TileMajorGrid, IndexesEachCellOnce)
+{
+  nav2_costmap_2d::TileMajorGrid<3> grid(37, 23, 7);
+  std::set<size_t> indexes;
+  for (unsigned int y = 0; y < 23; ++y) {
+    for (unsigned int x = 0; x < 37; ++x) {
+      const size_t index = grid.getIndex(x, y);
+      EXPECT_LT(index, 5u * 3u * 64u);
+      indexes.insert(index);
+      EXPECT_EQ(grid.getCost(x, y), 7);
+    }
+  }
+  EXPECT_EQ(indexes.size(), 37u * 23u);
+
+  // the cells of a tile are together, row by row
+  EXPECT_EQ(grid.getIndex(9, 8), 6u * 64u + 1u);
+  EXPECT_EQ(grid.getIndex(8, 9), 6u * 64u + 8u);
+}
+
+TEST(TileMajorGrid, ConvertsToAndFromRowMajor)
+{
+  const unsigned int size_x = 70, size_y = 45;
+  std::vector<unsigned char> row_major(size_x * size_y);
+  for (size_t i = 0; i < row_major.size(); ++i) {
+    row_major[i] = static_cast<unsigned char>(i * 31 % 251);
+  }
+
+  nav2_costmap_2d::TileMajorGrid<4> grid(size_x, size_y);
+  grid.fromRowMajor(row_major.data());
+  for (unsigned int y = 0; y < size_y; ++y) {
+    for (unsigned int x = 0; x < size_x; ++x) {
+      ASSERT_EQ(grid.getCost(x, y), row_major[y * size_x + x]) << x << ", " << y;
+    }
+  }
+
+  grid.setCost(69, 44, 1);
+  std::vector<unsigned char> exported(size_x * size_y, 0);
+  grid.toRowMajor(exported.data());
+  row_major.back() = 1;
+  EXPECT_EQ(exported, row_major);
+}
+
+TEST(TileMajorGrid, VisitsTheWindowOnce)
+{
+  nav2_costmap_2d::TileMajorGrid<3> grid(37, 23);
+  for (unsigned int y = 0; y < 23; ++y) {
+    for (unsigned int x = 0; x < 37; ++x) {
+      grid.setCost(x, y, (x + y) % 200);
+    }
+  }
+
+  std::vector<int> seen(37 * 23, 0);
+  grid.forEachCell(3, 9, 100, 20, [&](unsigned int x, unsigned int y, unsigned char cost) {
+      EXPECT_EQ(cost, (x + y) % 200);
+      ++seen[y * 37 + x];
+    });
+  for (unsigned int y = 0; y < 23; ++y) {
+    for (unsigned int x = 0; x < 37; ++x) {
+      EXPECT_EQ(seen[y * 37 + x], x >= 3 && y >= 9 && y < 20 ? 1 : 0) << x << ", " << y;
+    }
+  }
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/tiled_costmap.hpp"
+
+TEST(TiledCostmap, UntouchedTilesShareTheDefault)
+{
+  nav2_costmap_2d::TiledCostmap tiles(16);
+  tiles.resize(1000, 600, 255);
+  EXPECT_EQ(tiles.getAllocatedTiles(), 0u);
+  EXPECT_EQ(tiles.getCost(999, 599), 255);
+
+  // writing the default value does not allocate
+  tiles.setCost(10, 10, 255);
+  EXPECT_EQ(tiles.getAllocatedTiles(), 0u);
+
+  tiles.setCost(10, 10, 254);
+  tiles.setCost(15, 15, 0);
+  tiles.setCost(16, 15, 0);
+  EXPECT_EQ(tiles.getAllocatedTiles(), 2u);
+  EXPECT_EQ(tiles.getCost(10, 10), 254);
+  EXPECT_EQ(tiles.getCost(11, 10), 255);
+  EXPECT_EQ(tiles.getCost(16, 15), 0);
+  EXPECT_LT(tiles.getMemoryUsage(), 1000u * 600u / 10);
+
+  tiles.reset();
+  EXPECT_EQ(tiles.getAllocatedTiles(), 0u);
+  EXPECT_EQ(tiles.getCost(10, 10), 255);
+}
+
+TEST(TiledCostmap, TilesCoverTheWindowExactlyOnce)
+{
+  const unsigned int size_x = 37;
+  const unsigned int size_y = 23;
+  nav2_costmap_2d::TiledCostmap tiles(8);
+  tiles.resize(size_x, size_y, 0);
+  for (unsigned int y = 0; y < size_y; y += 3) {
+    for (unsigned int x = 0; x < size_x; x += 5) {
+      tiles.setCost(x, y, (x + y) % 200 + 1);
+    }
+  }
+
+  const unsigned int x0 = 3, y0 = 9, xn = 100, yn = 20;
+  std::vector<int> seen(size_x * size_y, 0);
+  tiles.forEachTile(x0, y0, xn, yn,
+    [&](const nav2_costmap_2d::TiledCostmap::Tile & tile) {
+      for (unsigned int y = 0; y < tile.size_y; ++y) {
+        for (unsigned int x = 0; x < tile.size_x; ++x) {
+          unsigned int mx = tile.x + x;
+          unsigned int my = tile.y + y;
+          ++seen[my * size_x + mx];
+          EXPECT_EQ(tile.data[y * tile.stride + x], tiles.getCost(mx, my));
+        }
+      }
+    });
+
+  for (unsigned int y = 0; y < size_y; ++y) {
+    for (unsigned int x = 0; x < size_x; ++x) {
+      bool inside = x >= x0 && y >= y0 && y < yn;
+      EXPECT_EQ(seen[y * size_x + x], inside ? 1 : 0) << x << ", " << y;
+    }
+  }
+}
+
+int main(int argc, char ** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
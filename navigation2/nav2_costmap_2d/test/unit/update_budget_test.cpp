@@ -0,0 +1,106 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/layered_costmap.hpp"
+
+// A layer whose updateBounds() takes a fixed, long time
+class SlowLayer : public nav2_costmap_2d::Layer
+{
+public:
+  explicit SlowLayer(bool deferrable)
+  : deferrable_(deferrable) {}
+
+  void updateBounds(double, double, double, double *, double *, double *, double *) override
+  {
+    ++full_updates_;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+
+  void deferBounds(double, double, double, double *, double *, double *, double *) override
+  {
+    ++deferred_updates_;
+  }
+
+  void updateCosts(nav2_costmap_2d::Costmap2D &, int, int, int, int) override {}
+
+  bool isDeferrable() const override
+  {
+    return deferrable_;
+  }
+
+  bool deferrable_;
+  int full_updates_{0};
+  int deferred_updates_{0};
+};
+
+TEST(UpdateBudget, deferredLayerRunsAtSubRate)
+{
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  layers.resizeMap(10, 10, 1, 0, 0);
+  auto layer = std::make_shared<SlowLayer>(true);
+  layers.addPlugin(layer);
+  layers.setUpdateBudget(0.01, 3);
+
+  for (int i = 0; i < 12; ++i) {
+    layers.updateMap(0, 0, 0);
+  }
+
+  // Every fourth cycle is a full update, the others are deferred
+  EXPECT_EQ(layer->full_updates_, 3);
+  EXPECT_EQ(layer->deferred_updates_, 9);
+
+  std::vector<nav2_costmap_2d::LayerTiming> timings = layers.getLayerTimings();
+  ASSERT_EQ(timings.size(), 1u);
+  EXPECT_EQ(timings[0].updates, 3u);
+  EXPECT_EQ(timings[0].deferrals, 9u);
+  EXPECT_GE(timings[0].average_time, 0.01);
+  EXPECT_GE(timings[0].max_time, timings[0].average_time);
+}
+
+TEST(UpdateBudget, layersAreNotDeferredWithoutBudget)
+{
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  layers.resizeMap(10, 10, 1, 0, 0);
+  auto deferrable = std::make_shared<SlowLayer>(true);
+  auto fixed = std::make_shared<SlowLayer>(false);
+  layers.addPlugin(deferrable);
+  layers.addPlugin(fixed);
+
+  for (int i = 0; i < 3; ++i) {
+    layers.updateMap(0, 0, 0);
+  }
+  EXPECT_EQ(deferrable->deferred_updates_, 0);
+
+  // With a budget only the deferrable layer gives way
+  layers.setUpdateBudget(0.01, 10);
+  for (int i = 0; i < 3; ++i) {
+    layers.updateMap(0, 0, 0);
+  }
+  EXPECT_EQ(deferrable->full_updates_, 3);
+  EXPECT_EQ(deferrable->deferred_updates_, 3);
+  EXPECT_EQ(fixed->full_updates_, 6);
+  EXPECT_EQ(fixed->deferred_updates_, 0);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
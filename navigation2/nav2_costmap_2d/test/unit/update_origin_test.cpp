@@ -0,0 +1,117 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+const unsigned int size_x = 13;
+const unsigned int size_y = 9;
+const unsigned char unknown = 255;
+
+// Fills the map with a distinct value per cell so any misplaced cell shows up
+void fillPattern(nav2_costmap_2d::Costmap2D & costmap)
+{
+  for (unsigned int y = 0; y < size_y; ++y) {
+    for (unsigned int x = 0; x < size_x; ++x) {
+      costmap.setCost(x, y, (y * size_x + x) % 250);
+    }
+  }
+}
+
+TEST(UpdateOrigin, MatchesWindowCopy)
+{
+  for (int dy = -11; dy <= 11; ++dy) {
+    for (int dx = -15; dx <= 15; ++dx) {
+      nav2_costmap_2d::Costmap2D costmap(size_x, size_y, 0.5, 1.0, -2.0, unknown);
+      fillPattern(costmap);
+      std::vector<unsigned char> before(costmap.getCharMap(),
+        costmap.getCharMap() + size_x * size_y);
+
+      costmap.updateOrigin(1.0 + dx * 0.5, -2.0 + dy * 0.5);
+      EXPECT_DOUBLE_EQ(costmap.getOriginX(), 1.0 + dx * 0.5);
+      EXPECT_DOUBLE_EQ(costmap.getOriginY(), -2.0 + dy * 0.5);
+
+      for (int y = 0; y < static_cast<int>(size_y); ++y) {
+        for (int x = 0; x < static_cast<int>(size_x); ++x) {
+          int old_x = x + dx;
+          int old_y = y + dy;
+          unsigned char expected = unknown;
+          if (old_x >= 0 && old_x < static_cast<int>(size_x) &&
+            old_y >= 0 && old_y < static_cast<int>(size_y))
+          {
+            expected = before[old_y * size_x + old_x];
+          }
+          ASSERT_EQ(costmap.getCost(x, y), expected) << "shift " << dx << ", " << dy <<
+            " cell " << x << ", " << y;
+        }
+      }
+    }
+  }
+}
+
+TEST(ResizeKeepingCosts, KeepsSharedCells)
+{
+  // grow by 3 cells to the left, 2 down and more to the right and up, as a map being built
+  nav2_costmap_2d::Costmap2D costmap(size_x, size_y, 0.5, 1.0, -2.0, unknown);
+  fillPattern(costmap);
+  std::vector<unsigned char> before(costmap.getCharMap(),
+    costmap.getCharMap() + size_x * size_y);
+
+  const unsigned int new_size_x = size_x + 7;
+  const unsigned int new_size_y = size_y + 4;
+  EXPECT_TRUE(costmap.resizeMapKeepingCosts(new_size_x, new_size_y, 0.5, -0.5, -3.0));
+  ASSERT_EQ(costmap.getSizeInCellsX(), new_size_x);
+  ASSERT_EQ(costmap.getSizeInCellsY(), new_size_y);
+
+  for (unsigned int y = 0; y < new_size_y; ++y) {
+    for (unsigned int x = 0; x < new_size_x; ++x) {
+      int old_x = static_cast<int>(x) - 3;
+      int old_y = static_cast<int>(y) - 2;
+      unsigned char expected = unknown;
+      if (old_x >= 0 && old_x < static_cast<int>(size_x) &&
+        old_y >= 0 && old_y < static_cast<int>(size_y))
+      {
+        expected = before[old_y * size_x + old_x];
+      }
+      ASSERT_EQ(costmap.getCost(x, y), expected) << "cell " << x << ", " << y;
+    }
+  }
+
+  // and shrink back onto the original window
+  EXPECT_TRUE(costmap.resizeMapKeepingCosts(size_x, size_y, 0.5, 1.0, -2.0));
+  EXPECT_EQ(std::vector<unsigned char>(costmap.getCharMap(),
+    costmap.getCharMap() + size_x * size_y), before);
+}
+
+TEST(ResizeKeepingCosts, ResetsGridsNotLinedUp)
+{
+  nav2_costmap_2d::Costmap2D costmap(size_x, size_y, 0.5, 1.0, -2.0, unknown);
+  fillPattern(costmap);
+  EXPECT_FALSE(costmap.resizeMapKeepingCosts(size_x, size_y, 0.5, 1.2, -2.0));
+  EXPECT_EQ(costmap.getCost(4, 4), unknown);
+  EXPECT_DOUBLE_EQ(costmap.getOriginX(), 1.2);
+
+  fillPattern(costmap);
+  EXPECT_FALSE(costmap.resizeMapKeepingCosts(size_x, size_y, 0.25, 1.2, -2.0));
+  EXPECT_EQ(costmap.getCost(4, 4), unknown);
+  EXPECT_DOUBLE_EQ(costmap.getResolution(), 0.25);
+}
+
+int main(int argc, char ** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
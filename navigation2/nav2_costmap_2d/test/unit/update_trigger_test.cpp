@@ -0,0 +1,93 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/update_trigger.hpp"
+
+using nav2_costmap_2d::UpdateTrigger;
+using std::chrono::milliseconds;
+
+static double secondsSince(UpdateTrigger::Clock::time_point start)
+{
+  return std::chrono::duration<double>(UpdateTrigger::Clock::now() - start).count();
+}
+
+TEST(UpdateTrigger, WakesOnceThePeriodRunsOutWithoutNotifications)
+{
+  UpdateTrigger trigger(milliseconds(0), milliseconds(50));
+  auto start = UpdateTrigger::Clock::now();
+  EXPECT_EQ(trigger.wait(), 0u);
+  EXPECT_GE(secondsSince(start), 0.045);
+}
+
+TEST(UpdateTrigger, WakesSoonAfterANotification)
+{
+  UpdateTrigger trigger(milliseconds(0), std::chrono::seconds(10));
+  std::thread sensor([&trigger] {
+      std::this_thread::sleep_for(milliseconds(20));
+      trigger.notify();
+    });
+  auto start = UpdateTrigger::Clock::now();
+  EXPECT_EQ(trigger.wait(), 1u);
+  EXPECT_LT(secondsSince(start), 5.0);
+  sensor.join();
+}
+
+TEST(UpdateTrigger, MergesNotificationsUnderTheRateLimit)
+{
+  UpdateTrigger trigger(milliseconds(100), std::chrono::seconds(10));
+  auto start = UpdateTrigger::Clock::now();
+  for (int i = 0; i < 5; ++i) {
+    trigger.notify();
+  }
+  // held off to 100 ms after the trigger was made, as if an update had just started
+  EXPECT_EQ(trigger.wait(), 5u);
+  EXPECT_GE(secondsSince(start), 0.095);
+
+  // and again from the start of that update
+  start = UpdateTrigger::Clock::now();
+  trigger.notify();
+  EXPECT_EQ(trigger.wait(), 1u);
+  EXPECT_GE(secondsSince(start), 0.095);
+}
+
+TEST(UpdateTrigger, InterruptEndsAnyWait)
+{
+  UpdateTrigger trigger(std::chrono::seconds(10), std::chrono::seconds(10));
+  std::thread stopper([&trigger] {
+      std::this_thread::sleep_for(milliseconds(20));
+      trigger.interrupt();
+    });
+  auto start = UpdateTrigger::Clock::now();
+  EXPECT_EQ(trigger.wait(), 0u);
+  EXPECT_LT(secondsSince(start), 5.0);
+  stopper.join();
+
+  // past the rate limit too, and only once
+  trigger.notify();
+  trigger.interrupt();
+  EXPECT_EQ(trigger.wait(), 1u);
+  trigger.notify();
+  start = UpdateTrigger::Clock::now();
+  std::thread late_stopper([&trigger] {
+      std::this_thread::sleep_for(milliseconds(50));
+      trigger.interrupt();
+    });
+  EXPECT_EQ(trigger.wait(), 1u);
+  EXPECT_GE(secondsSince(start), 0.045);
+  late_stopper.join();
+}
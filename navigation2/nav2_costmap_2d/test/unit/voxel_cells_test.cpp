@@ -0,0 +1,107 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/voxel_cells.hpp"
+#include "nav2_voxel_grid/voxel_grid.hpp"
+
+using nav2_costmap_2d::VoxelCell;
+using nav2_costmap_2d::VoxelCellCollector;
+
+static nav2_msgs::msg::VoxelGrid makeGrid(unsigned int size_x, unsigned int size_y)
+{
+  nav2_msgs::msg::VoxelGrid grid;
+  grid.size_x = size_x;
+  grid.size_y = size_y;
+  grid.size_z = 10;
+  grid.origin.x = -1.0;
+  grid.origin.y = 2.0;
+  grid.origin.z = 0.1;
+  grid.resolutions.x = 0.05;
+  grid.resolutions.y = 0.05;
+  grid.resolutions.z = 0.2;
+  grid.data.assign(size_x * size_y, 0);
+  return grid;
+}
+
+TEST(VoxelCells, matchesEveryVoxel)
+{
+  auto grid = makeGrid(37, 23);
+  std::mt19937 random(7);
+  for (auto & column : grid.data) {
+    // mostly empty columns, as in a real map, and bits above size_z that are ignored
+    column = random() % 3 == 0 ? static_cast<uint32_t>(random()) : 0;
+  }
+
+  std::vector<VoxelCell> marked, unknown;
+  for (unsigned int y = 0; y < grid.size_y; ++y) {
+    for (unsigned int x = 0; x < grid.size_x; ++x) {
+      for (unsigned int z = 0; z < grid.size_z; ++z) {
+        auto status = nav2_voxel_grid::VoxelGrid::getVoxel(x, y, z,
+            grid.size_x, grid.size_y, grid.size_z, grid.data.data());
+        VoxelCell cell{grid.origin.x + (x + 0.5) * grid.resolutions.x,
+          grid.origin.y + (y + 0.5) * grid.resolutions.y,
+          grid.origin.z + (z + 0.5) * grid.resolutions.z};
+        if (status == nav2_voxel_grid::MARKED) {
+          marked.push_back(cell);
+        } else if (status == nav2_voxel_grid::UNKNOWN) {
+          unknown.push_back(cell);
+        }
+      }
+    }
+  }
+
+  VoxelCellCollector collector;
+  collector.collect(grid);
+  ASSERT_EQ(collector.marked().size(), marked.size());
+  ASSERT_EQ(collector.unknown().size(), unknown.size());
+  for (size_t i = 0; i < marked.size(); ++i) {
+    EXPECT_DOUBLE_EQ(collector.marked()[i].x, marked[i].x);
+    EXPECT_DOUBLE_EQ(collector.marked()[i].y, marked[i].y);
+    EXPECT_DOUBLE_EQ(collector.marked()[i].z, marked[i].z);
+  }
+  for (size_t i = 0; i < unknown.size(); ++i) {
+    EXPECT_DOUBLE_EQ(collector.unknown()[i].x, unknown[i].x);
+    EXPECT_DOUBLE_EQ(collector.unknown()[i].y, unknown[i].y);
+    EXPECT_DOUBLE_EQ(collector.unknown()[i].z, unknown[i].z);
+  }
+
+  collector.collect(grid, false);
+  EXPECT_EQ(collector.marked().size(), marked.size());
+  EXPECT_TRUE(collector.unknown().empty());
+}
+
+TEST(VoxelCells, downsample)
+{
+  auto grid = makeGrid(4, 4);
+  // one block of 2x2x2 with a marked and an unknown voxel, another with only unknown ones
+  grid.data[0] = (1u << 1) | (1u << 17);
+  grid.data[1] = 1u << 0;
+  grid.data[3 * 4 + 3] = (1u << 4) | (1u << 5);
+
+  VoxelCellCollector collector(2);
+  collector.collect(grid);
+  ASSERT_EQ(collector.marked().size(), 1u);
+  EXPECT_DOUBLE_EQ(collector.marked()[0].x, -1.0 + 0.05);
+  EXPECT_DOUBLE_EQ(collector.marked()[0].y, 2.0 + 0.05);
+  EXPECT_DOUBLE_EQ(collector.marked()[0].z, 0.1 + 0.2);
+
+  ASSERT_EQ(collector.unknown().size(), 1u);
+  EXPECT_DOUBLE_EQ(collector.unknown()[0].x, -1.0 + 0.15);
+  EXPECT_DOUBLE_EQ(collector.unknown()[0].y, 2.0 + 0.15);
+  EXPECT_DOUBLE_EQ(collector.unknown()[0].z, 0.1 + 1.0);
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+TEST(WorldToMapBatch, MatchesWorldToMap)
+{
+  nav2_costmap_2d::Costmap2D costmap(173, 91, 0.05, -3.2, 1.7);
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> x(-4.0, 6.0), y(0.5, 7.0);
+
+  std::vector<double> wx, wy;
+  for (int i = 0; i < 20000; ++i) {
+    wx.push_back(x(gen));
+    wy.push_back(y(gen));
+  }
+  // cell edges and the map's own edges
+  for (unsigned int i = 0; i <= 173; ++i) {
+    wx.push_back(-3.2 + i * 0.05);
+    wy.push_back(1.7 + (i % 92) * 0.05);
+  }
+
+  const size_t count = wx.size();
+  std::vector<unsigned int> mx(count), my(count);
+  std::vector<unsigned char> valid(count);
+  size_t on_map = costmap.worldToMapBatch(wx.data(), wy.data(), count,
+      mx.data(), my.data(), valid.data());
+
+  size_t expected_on_map = 0;
+  for (size_t i = 0; i < count; ++i) {
+    unsigned int cx = 0, cy = 0;
+    bool inside = costmap.worldToMap(wx[i], wy[i], cx, cy);
+    ASSERT_EQ(valid[i] != 0, inside) << wx[i] << ", " << wy[i];
+    if (inside) {
+      ++expected_on_map;
+      ASSERT_EQ(mx[i], cx) << wx[i];
+      ASSERT_EQ(my[i], cy) << wy[i];
+    } else {
+      ASSERT_EQ(mx[i], 0u);
+      ASSERT_EQ(my[i], 0u);
+    }
+  }
+  EXPECT_EQ(on_map, expected_on_map);
+  EXPECT_GT(on_map, 0u);
+  EXPECT_LT(on_map, count);
+}
+
+TEST(WorldToMapBatch, RefusesPointsNoMapHolds)
+{
+  nav2_costmap_2d::Costmap2D costmap(10, 10, 0.1, 0.0, 0.0);
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+  std::vector<double> wx = {nan, 0.5, 1e300, 0.5, -inf, 0.5, inf, 0.5};
+  std::vector<double> wy = {0.5, nan, 0.5, -1e300, 0.5, inf, 0.5, -inf};
+  std::vector<unsigned int> mx(wx.size(), 7), my(wx.size(), 7);
+  std::vector<unsigned char> valid(wx.size(), 1);
+  EXPECT_EQ(costmap.worldToMapBatch(wx.data(), wy.data(), wx.size(),
+    mx.data(), my.data(), valid.data()), 0u);
+  for (size_t i = 0; i < wx.size(); ++i) {
+    EXPECT_EQ(valid[i], 0) << i;
+    EXPECT_EQ(mx[i], 0u) << i;
+    EXPECT_EQ(my[i], 0u) << i;
+  }
+}
+
+TEST(WorldToMapBatch, MapToWorldMatchesEachCell)
+{
+  nav2_costmap_2d::Costmap2D costmap(40, 30, 0.1, 2.5, -1.0);
+  std::vector<unsigned int> mx, my;
+  for (unsigned int j = 0; j < 30; ++j) {
+    for (unsigned int i = 0; i < 40; ++i) {
+      mx.push_back(i);
+      my.push_back(j);
+    }
+  }
+  std::vector<double> wx(mx.size()), wy(mx.size());
+  costmap.mapToWorldBatch(mx.data(), my.data(), mx.size(), wx.data(), wy.data());
+  for (size_t i = 0; i < mx.size(); ++i) {
+    double x, y;
+    costmap.mapToWorld(mx[i], my[i], x, y);
+    EXPECT_EQ(wx[i], x);
+    EXPECT_EQ(wy[i], y);
+  }
+}
@@ -0,0 +1,150 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Locus Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef COSTMAP_QUEUE__BUCKET_QUEUE_HPP_
+#define COSTMAP_QUEUE__BUCKET_QUEUE_HPP_
+
+#include <stdexcept>
+#include <vector>
+
+namespace costmap_queue
+{
+/**
+ * @brief Templatized priority queue for small integer priorities
+ *
+ * A drop-in for MapBasedQueue when the priorities are the ranks of a bounded set of values, such
+ * as the distinct cell distances of a CostmapQueue. Each priority is a slot in a vector of bins,
+ * so enqueueing is an index and a push_back, and the bins keep their storage between resets, so
+ * a queue that is reused for the same kind of search stops allocating after the first one.
+ *
+ * Items with the same priority come out last in, first out, as from MapBasedQueue.
+ */
+template<class item_t>
+class BucketQueue
+{
+public:
+  /**
+   * @brief Default Constructor
+   */
+  BucketQueue()
+  : item_count_(0), current_(0), max_used_(0)
+  {
+  }
+
+  /**
+   * @brief Clear the queue
+   */
+  virtual void reset()
+  {
+    // only the bins that can hold items are cleared, their storage is kept
+    for (unsigned int i = current_; i < max_used_ && item_count_ > 0; ++i) {
+      item_count_ -= bins_[i].size();
+      bins_[i].clear();
+    }
+    item_count_ = 0;
+    current_ = 0;
+    max_used_ = 0;
+  }
+
+  /**
+   * @brief Add a new item to the queue with a set priority
+   * @param priority Priority of the item, lower comes out first
+   * @param item Payload item
+   */
+  void enqueue(const unsigned int priority, item_t item)
+  {
+    if (priority >= bins_.size()) {
+      bins_.resize(priority + 1);
+    }
+    bins_[priority].push_back(item);
+    item_count_++;
+
+    if (item_count_ == 1 || priority < current_) {
+      current_ = priority;
+    }
+    if (priority >= max_used_) {
+      max_used_ = priority + 1;
+    }
+  }
+
+  /**
+   * @brief Check to see if there is anything in the queue
+   * @return True if there is nothing in the queue
+   *
+   * Must be called prior to front/pop.
+   */
+  bool isEmpty()
+  {
+    return item_count_ == 0;
+  }
+
+  /**
+   * @brief Return the item at the front of the queue
+   * @return The item at the front of the queue
+   */
+  item_t & front()
+  {
+    if (item_count_ == 0) {
+      throw std::out_of_range("front() called on empty costmap_queue::BucketQueue!");
+    }
+
+    return bins_[current_].back();
+  }
+
+  /**
+   * @brief Remove (and destroy) the item at the front of the queue
+   */
+  void pop()
+  {
+    if (item_count_ == 0) {
+      return;
+    }
+    bins_[current_].pop_back();
+    item_count_--;
+
+    while (item_count_ > 0 && bins_[current_].empty()) {
+      current_++;
+    }
+  }
+
+protected:
+  std::vector<std::vector<item_t>> bins_;
+  size_t item_count_;
+  unsigned int current_;  ///< The lowest bin that may hold items
+  unsigned int max_used_;  ///< One past the highest bin that may hold items
+};
+}  // namespace costmap_queue
+
+#endif  // COSTMAP_QUEUE__BUCKET_QUEUE_HPP_
@@ -40,7 +40,7 @@
 #include <limits>
 #include <memory>
 #include "nav2_costmap_2d/costmap_2d.hpp"
-#include "costmap_queue/map_based_queue.hpp"
+#include "costmap_queue/bucket_queue.hpp"
 
 namespace costmap_queue
 {
@@ -104,8 +104,11 @@ public:
  * The validCellToQueue overridable-function allows for deriving classes to limit the queue traversal
  * to a subset of all costmap cells. LimitedCostmapQueue does this by ignoring distances above a limit.
  *
+ * Since every distance comes from a table of the distances between cells, the cells are queued
+ * by the rank of their distance in that table, in a BucketQueue, and cells are marked as seen with
+ * a generation number, so that a reset does not touch every cell.
  */
-class CostmapQueue : public MapBasedQueue<CellData>
+class CostmapQueue : public BucketQueue<CellData>
 {
 public:
   /**
@@ -160,7 +163,8 @@ protected:
   void computeCache();
 
   nav2_costmap_2d::Costmap2D & costmap_;
-  std::vector<bool> seen_;
+  std::vector<unsigned int> seen_;  ///< A cell has been seen if it holds seen_generation_
+  unsigned int seen_generation_;
   int max_distance_;
   bool manhattan_;
 
@@ -182,6 +186,8 @@ protected:
     return cached_distances_[dx][dy];
   }
   std::vector<std::vector<double>> cached_distances_;
+  /// The rank of each cached distance among the distinct cached distances
+  std::vector<std::vector<unsigned int>> cached_ranks_;
   int cached_max_distance_;
 };
 }  // namespace costmap_queue
@@ -42,7 +42,7 @@ namespace costmap_queue
 {
 
 CostmapQueue::CostmapQueue(nav2_costmap_2d::Costmap2D & costmap, bool manhattan)
-: MapBasedQueue(), costmap_(costmap), max_distance_(-1), manhattan_(manhattan),
+: BucketQueue(), costmap_(costmap), seen_generation_(0), max_distance_(-1), manhattan_(manhattan),
   cached_max_distance_(-1)
 {
   reset();
@@ -51,12 +51,14 @@ CostmapQueue::CostmapQueue(nav2_costmap_2d::Costmap2D & costmap, bool manhattan)
 void CostmapQueue::reset()
 {
   unsigned int size_x = costmap_.getSizeInCellsX(), size_y = costmap_.getSizeInCellsY();
-  if (seen_.size() != size_x * size_y) {
-    seen_.resize(size_x * size_y);
+  // a new generation unmarks every cell at once, the marks are only cleared when
+  // the costmap is resized or the generation wraps around
+  if (seen_.size() != size_x * size_y || ++seen_generation_ == 0) {
+    seen_.assign(size_x * size_y, 0);
+    seen_generation_ = 1;
   }
-  std::fill(seen_.begin(), seen_.end(), false);
   computeCache();
-  MapBasedQueue::reset();
+  BucketQueue::reset();
 }
 
 void CostmapQueue::enqueueCell(unsigned int x, unsigned int y)
@@ -69,15 +71,17 @@ void CostmapQueue::enqueueCell(
   unsigned int index, unsigned int cur_x, unsigned int cur_y,
   unsigned int src_x, unsigned int src_y)
 {
-  if (seen_[index]) {return;}
+  if (seen_[index] == seen_generation_) {return;}
 
   // we compute our distance table one cell further than the inflation radius
   // dictates so we can make the check below
   double distance = distanceLookup(cur_x, cur_y, src_x, src_y);
   CellData data(distance, index, cur_x, cur_y, src_x, src_y);
   if (validCellToQueue(data)) {
-    seen_[index] = true;
-    enqueue(distance, data);
+    seen_[index] = seen_generation_;
+    unsigned int dx = CellData::absolute_difference(cur_x, src_x);
+    unsigned int dy = CellData::absolute_difference(cur_y, src_y);
+    enqueue(cached_ranks_[dx][dy], data);
   }
 }
 
@@ -131,6 +135,23 @@ void CostmapQueue::computeCache()
       }
     }
   }
+
+  // equal distances share a rank, so cells come out in the same order as they would
+  // from a queue keyed by the distances themselves
+  std::vector<double> distances;
+  for (const auto & row : cached_distances_) {
+    distances.insert(distances.end(), row.begin(), row.end());
+  }
+  std::sort(distances.begin(), distances.end());
+  distances.erase(std::unique(distances.begin(), distances.end()), distances.end());
+  cached_ranks_.resize(cached_distances_.size());
+  for (unsigned int i = 0; i < cached_distances_.size(); ++i) {
+    cached_ranks_[i].resize(cached_distances_[i].size());
+    for (unsigned int j = 0; j < cached_distances_[i].size(); ++j) {
+      cached_ranks_[i][j] = std::lower_bound(distances.begin(), distances.end(),
+          cached_distances_[i][j]) - distances.begin();
+    }
+  }
   cached_max_distance_ = max_distance_;
 }
 
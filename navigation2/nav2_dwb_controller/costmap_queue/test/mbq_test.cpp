@@ -34,8 +34,10 @@
 
 #include <string>
 #include "gtest/gtest.h"
+#include "costmap_queue/bucket_queue.hpp"
 #include "costmap_queue/map_based_queue.hpp"
 
+using costmap_queue::BucketQueue;
 using costmap_queue::MapBasedQueue;
 
 void letter_test(MapBasedQueue<char> & q, const char test_letter)
@@ -110,6 +112,66 @@ TEST(MapBasedQueue, checkDynamicOrdering3)
   letter_test(q, 'D');
 }
 
+void letter_test(BucketQueue<char> & q, const char test_letter)
+{
+  ASSERT_FALSE(q.isEmpty());
+  char c = q.front();
+  EXPECT_EQ(c, test_letter);
+  q.pop();
+}
+
+TEST(BucketQueue, checkOrdering)
+{
+  BucketQueue<char> q;
+  EXPECT_TRUE(q.isEmpty());
+  q.enqueue(1, 'A');
+  q.enqueue(3, 'B');
+  q.enqueue(2, 'C');
+  q.enqueue(5, 'D');
+  q.enqueue(0, 'E');
+  q.enqueue(3, 'F');
+
+  // same priorities come out last in, first out, as from MapBasedQueue
+  std::string expected = "EACFBD";
+  for (unsigned int i = 0; i < expected.size(); i++) {
+    letter_test(q, expected[i]);
+  }
+  EXPECT_TRUE(q.isEmpty());
+  EXPECT_THROW(q.front(), std::out_of_range);
+}
+
+TEST(BucketQueue, checkDynamicOrdering)
+{
+  BucketQueue<char> q;
+  q.enqueue(1, 'A');
+  q.enqueue(2, 'B');
+  q.enqueue(5, 'D');
+  letter_test(q, 'A');
+  letter_test(q, 'B');
+  q.enqueue(1, 'C');
+  letter_test(q, 'C');
+  q.enqueue(7, 'E');
+  letter_test(q, 'D');
+  letter_test(q, 'E');
+  EXPECT_TRUE(q.isEmpty());
+}
+
+TEST(BucketQueue, reset)
+{
+  BucketQueue<char> q;
+  q.enqueue(4, 'A');
+  q.enqueue(9, 'B');
+  letter_test(q, 'A');
+  q.reset();
+  EXPECT_TRUE(q.isEmpty());
+
+  q.enqueue(9, 'C');
+  q.enqueue(2, 'D');
+  letter_test(q, 'D');
+  letter_test(q, 'C');
+  EXPECT_TRUE(q.isEmpty());
+}
+
 int main(int argc, char ** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -15,18 +15,23 @@
 #ifndef DWB_CONTROLLER__DWB_CONTROLLER_HPP_
 #define DWB_CONTROLLER__DWB_CONTROLLER_HPP_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "dwb_core/common_types.hpp"
 #include "dwb_core/dwb_local_planner.hpp"
 #include "nav_2d_msgs/msg/pose2_d_stamped.hpp"
 #include "nav_2d_utils/odom_subscriber.hpp"
+#include "nav2_dynamic_params/dynamic_params_client.hpp"
 #include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/metrics.hpp"
 #include "nav2_msgs/action/follow_path.hpp"
 #include "nav2_util/simple_action_server.hpp"
 #include "nav2_util/robot_utils.hpp"
+#include "std_msgs/msg/empty.hpp"
 
 namespace dwb_controller
 {
@@ -36,7 +41,7 @@ class ProgressChecker;
 class DwbController : public nav2_util::LifecycleNode
 {
 public:
-  DwbController();
+  explicit DwbController(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   ~DwbController();
 
 protected:
@@ -56,6 +61,8 @@ protected:
   // The action server callback
   void followPath();
 
+  // Applies the control loop's scheduling to the thread it runs on
+  void configureControlThread();
   void setPlannerPath(const nav2_msgs::msg::Path & path);
   void computeAndPublishVelocity();
   void updateGlobalPath();
@@ -72,15 +79,41 @@ protected:
   std::shared_ptr<nav_2d_utils::OdomSubscriber> odom_sub_;
   rclcpp_lifecycle::LifecyclePublisher<geometry_msgs::msg::Twist>::SharedPtr vel_publisher_;
 
+  // Asks the recovery servers to get ready once progress stalls, ahead of the failure
+  rclcpp_lifecycle::LifecyclePublisher<std_msgs::msg::Empty>::SharedPtr prefetch_publisher_;
+  bool prefetch_requested_{false};
+
   // The local planner
   std::unique_ptr<dwb_core::DWBLocalPlanner> planner_;
 
   // An executor used to spin the costmap node
-  rclcpp::executors::SingleThreadedExecutor costmap_executor_;
+  std::unique_ptr<rclcpp::executor::Executor> costmap_executor_;
 
   std::unique_ptr<ProgressChecker> progress_checker_;
 
+  // The critics' scales can be tuned while running: a change is noted on the rclcpp node's
+  // thread and handed to the planner before it computes the next command
+  std::unique_ptr<nav2_dynamic_params::DynamicParamsClient> dynamic_params_client_;
+  std::atomic<bool> critic_scales_changed_{false};
+
   double controller_frequency_;
+
+  // The control loop's thread can run at a real-time priority, pinned to CPUs of its own,
+  // so other work on the machine doesn't delay its cycles
+  int control_thread_priority_{0};
+  std::vector<int> control_thread_cpus_;
+  std::thread::id control_thread_;
+
+  nav2_util::LatencyHistogram & cycle_lateness_;
+  nav2_util::Counter & overrun_count_;
+
+  // Black box channels for the plans followed, with the transform from their frame to the
+  // costmap's when each arrived, and for the pose and velocity the commands were computed
+  // from, with the commands themselves
+  int plan_channel_;
+  int plan_transform_channel_;
+  int odom_channel_;
+  int cmd_vel_channel_;
 };
 
 }  // namespace dwb_controller
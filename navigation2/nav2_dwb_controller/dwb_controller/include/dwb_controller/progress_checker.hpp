@@ -15,8 +15,11 @@
 #ifndef DWB_CONTROLLER__PROGRESS_CHECKER_HPP_
 #define DWB_CONTROLLER__PROGRESS_CHECKER_HPP_
 
+#include <memory>
+
 #include "rclcpp/rclcpp.hpp"
 #include "nav_2d_msgs/msg/pose2_d_stamped.hpp"
+#include "nav2_util/motion_history.hpp"
 
 namespace dwb_controller
 {
@@ -28,6 +31,21 @@ public:
   void check(nav_2d_msgs::msg::Pose2DStamped & current_pose);
   void reset() {baseline_pose_set_ = false;}
 
+  /**
+   * @brief Whether the robot has made no progress for over half the time allowance, so a
+   * progress failure looks likely
+   */
+  bool isStalling() const;
+
+  /**
+   * @brief Measure progress on the odometry in history, once it has any, instead of the pose
+   * passed to check. Odometry does not jump when the robot is relocalized.
+   */
+  void setMotionHistory(std::shared_ptr<const nav2_util::MotionHistory> history)
+  {
+    history_ = history;
+  }
+
 protected:
   bool is_robot_moved_enough(const geometry_msgs::msg::Pose2D & pose);
   void reset_baseline_pose(const geometry_msgs::msg::Pose2D & pose);
@@ -41,6 +59,9 @@ protected:
   rclcpp::Time baseline_time_;
 
   bool baseline_pose_set_{false};
+  bool baseline_from_history_{false};  ///< Whether the baseline pose is an odometry pose
+
+  std::shared_ptr<const nav2_util::MotionHistory> history_;
 };
 }  // namespace dwb_controller
 
@@ -17,10 +17,16 @@
 #include <chrono>
 #include <memory>
 #include <string>
+#include <vector>
+#include <utility>
 
 #include "dwb_core/exceptions.hpp"
 #include "nav_2d_utils/conversions.hpp"
+#include "nav_msgs/msg/odometry.hpp"
+#include "nav2_util/black_box.hpp"
+#include "nav2_util/loop_rate.hpp"
 #include "nav2_util/node_utils.hpp"
+#include "nav2_util/thread_utils.hpp"
 #include "dwb_controller/progress_checker.hpp"
 
 using namespace std::chrono_literals;
@@ -28,16 +34,35 @@ using namespace std::chrono_literals;
 namespace dwb_controller
 {
 
-DwbController::DwbController()
-: LifecycleNode("dwb_controller", "", true)
+DwbController::DwbController(const rclcpp::NodeOptions & options)
+: LifecycleNode("dwb_controller", "", true, options),
+  cycle_lateness_(nav2_util::MetricsRegistry::global().histogram("dwb_controller.cycle_lateness",
+    "How late a control cycle started after its deadline")),
+  overrun_count_(nav2_util::MetricsRegistry::global().counter("dwb_controller.overruns",
+    "Control cycles that ran past the start of the next one"))
 {
   RCLCPP_INFO(get_logger(), "Creating");
 
+  plan_channel_ = nav2_util::BlackBox::global().channel("dwb_controller/plan",
+      "nav2_msgs/msg/Path");
+  plan_transform_channel_ = nav2_util::BlackBox::global().channel(
+    "dwb_controller/plan_transform", "geometry_msgs/msg/TransformStamped");
+  odom_channel_ = nav2_util::BlackBox::global().channel("dwb_controller/odom",
+      "nav_msgs/msg/Odometry");
+  cmd_vel_channel_ = nav2_util::BlackBox::global().channel("dwb_controller/cmd_vel",
+      "nav_2d_msgs/msg/Twist2DStamped");
+
   declare_parameter("controller_frequency", 20.0);
+  declare_parameter("control_thread_priority", 0);
+  declare_parameter("control_thread_cpus", std::vector<int64_t>{});
 
   // The costmap node is used in the implementation of the DWB controller
   costmap_ros_ = std::make_shared<nav2_costmap_2d::Costmap2DROS>(
     "local_costmap", nav2_util::add_namespaces(std::string{get_namespace()}, "local_costmap"));
+  add_startup_child(costmap_ros_);
+
+  // Create an executor that will be used to spin the costmap node
+  costmap_executor_ = costmap_ros_->createExecutor();
 
   // Launch a thread to run the costmap node
   costmap_thread_ = std::make_unique<std::thread>(
@@ -45,16 +70,16 @@ DwbController::DwbController()
     {
       // TODO(mjeronimo): Once Brian pushes his change upstream to rlcpp executors, we'll
       // be able to provide our own executor to spin(), reducing this to a single line
-      costmap_executor_.add_node(node->get_node_base_interface());
-      costmap_executor_.spin();
-      costmap_executor_.remove_node(node->get_node_base_interface());
+      costmap_executor_->add_node(node->get_node_base_interface());
+      costmap_executor_->spin();
+      costmap_executor_->remove_node(node->get_node_base_interface());
     }, costmap_ros_);
 }
 
 DwbController::~DwbController()
 {
   RCLCPP_INFO(get_logger(), "Destroying");
-  costmap_executor_.cancel();
+  costmap_executor_->cancel();
   costmap_thread_->join();
 }
 
@@ -75,13 +100,30 @@ DwbController::on_configure(const rclcpp_lifecycle::State & state)
 
   get_parameter("controller_frequency", controller_frequency_);
   RCLCPP_INFO(get_logger(), "Controller frequency set to %.4fHz", controller_frequency_);
+  get_parameter("control_thread_priority", control_thread_priority_);
+  std::vector<int64_t> control_thread_cpus;
+  get_parameter("control_thread_cpus", control_thread_cpus);
+  control_thread_cpus_.assign(control_thread_cpus.begin(), control_thread_cpus.end());
 
   odom_sub_ = std::make_shared<nav_2d_utils::OdomSubscriber>(*this);
+  progress_checker_->setMotionHistory(odom_sub_->getMotionHistory());
+
+  std::vector<std::string> scale_names;
+  for (const auto & critic_name : planner_->getCriticNames()) {
+    scale_names.push_back(critic_name + ".scale");
+  }
+  dynamic_params_client_ = std::make_unique<nav2_dynamic_params::DynamicParamsClient>(
+    rclcpp_node_);
+  dynamic_params_client_->add_known_parameters(get_namespace(), get_name(),
+    get_parameters(scale_names));
+  dynamic_params_client_->set_callback([this]() {critic_scales_changed_ = true;}, false);
   vel_publisher_ = create_publisher<geometry_msgs::msg::Twist>("/cmd_vel", 1);
+  prefetch_publisher_ = create_publisher<std_msgs::msg::Empty>("recovery_prefetch", 1);
 
-  // Create the action server that we implement with our followPath method
+  // Create the action server that we implement with our followPath method, run for every
+  // goal on the same worker thread
   action_server_ = std::make_unique<ActionServer>(rclcpp_node_, "FollowPath",
-      std::bind(&DwbController::followPath, this));
+      std::bind(&DwbController::followPath, this), true, true);
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -95,6 +137,7 @@ DwbController::on_activate(const rclcpp_lifecycle::State & state)
   costmap_ros_->on_activate(state);
 
   vel_publisher_->on_activate();
+  prefetch_publisher_->on_activate();
   action_server_->activate();
 
   return nav2_util::CallbackReturn::SUCCESS;
@@ -111,6 +154,7 @@ DwbController::on_deactivate(const rclcpp_lifecycle::State & state)
 
   publishZeroVelocity();
   vel_publisher_->on_deactivate();
+  prefetch_publisher_->on_deactivate();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -125,11 +169,13 @@ DwbController::on_cleanup(const rclcpp_lifecycle::State & state)
   costmap_ros_->on_cleanup(state);
 
   // Release any allocated resources
+  dynamic_params_client_.reset();
   action_server_.reset();
   planner_.reset();
   odom_sub_.reset();
 
   vel_publisher_.reset();
+  prefetch_publisher_.reset();
   action_server_.reset();
 
 
@@ -154,11 +200,22 @@ void DwbController::followPath()
 {
   RCLCPP_INFO(get_logger(), "Received a goal, begin following path");
 
+  // Every goal runs on the action server's worker, which is set up on its first goal
+  if (control_thread_ != std::this_thread::get_id()) {
+    control_thread_ = std::this_thread::get_id();
+    configureControlThread();
+  }
+
   try {
     setPlannerPath(action_server_->get_current_goal()->path);
     progress_checker_->reset();
+    prefetch_requested_ = false;
 
-    rclcpp::Rate loop_rate(controller_frequency_);
+    // Cycles keep steady time, or /clock's with use_sim_time
+    nav2_util::LoopClock clock(get_clock());
+    const auto period = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(1.0 / controller_frequency_));
+    auto next_cycle = clock.now() + period;
     while (rclcpp::ok()) {
       if (action_server_ == nullptr) {
         RCLCPP_DEBUG(get_logger(), "Action server unavailable. Stopping.");
@@ -186,10 +243,26 @@ void DwbController::followPath()
         break;
       }
 
-      if (!loop_rate.sleep()) {
+      // Sleep out the cycle, but handle a preempt or cancel as soon as it arrives rather than
+      // a cycle later. The cycle that handles it is an extra one, so the rate is kept.
+      auto now = clock.now();
+      if (now >= next_cycle) {
+        overrun_count_.increment();
+        cycle_lateness_.record(now - next_cycle);
         RCLCPP_WARN(get_logger(), "Control loop missed its desired rate of %.4fHz",
           controller_frequency_);
+        next_cycle = now;
+      } else {
+        // Woken early only for a request; otherwise how late the wakeup was is the jitter
+        clock.waitUntil(next_cycle, [this](std::chrono::nanoseconds timeout) {
+            return action_server_->wait_for_request(timeout);
+          });
+        now = clock.now();
+        if (now >= next_cycle) {
+          cycle_lateness_.record(now - next_cycle);
+        }
       }
+      next_cycle += period;
     }
   } catch (nav_core2::PlannerException & e) {
     RCLCPP_ERROR(this->get_logger(), e.what());
@@ -206,12 +279,34 @@ void DwbController::followPath()
   action_server_->succeeded_current();
 }
 
+void DwbController::configureControlThread()
+{
+  std::string error;
+  if (!nav2_util::setThreadPriority(control_thread_priority_, error)) {
+    RCLCPP_WARN(get_logger(), "Could not run the control loop at real-time priority %d: %s",
+      control_thread_priority_, error.c_str());
+  }
+  if (!nav2_util::setThreadAffinity(control_thread_cpus_, error)) {
+    RCLCPP_WARN(get_logger(), "Could not pin the control loop to its CPUs: %s", error.c_str());
+  }
+}
+
 void DwbController::setPlannerPath(const nav2_msgs::msg::Path & path)
 {
+  if (nav2_util::BlackBox::global().isOpen()) {
+    nav2_util::BlackBox::global().record(plan_channel_, path);
+    try {
+      nav2_util::BlackBox::global().record(plan_transform_channel_,
+        costmap_ros_->getTfBuffer()->lookupTransform(costmap_ros_->getGlobalFrameID(),
+        path.header.frame_id, tf2::TimePointZero));
+    } catch (const tf2::TransformException &) {
+      // the replay takes the plan to be in the costmap's frame
+    }
+  }
   auto path2d = nav_2d_utils::pathToPath2D(path);
 
   RCLCPP_DEBUG(get_logger(), "Providing path to the local planner");
-  planner_->setPlan(path2d);
+  planner_->setPlan(std::move(path2d));
 
   auto end_pose = *(path.poses.end() - 1);
 
@@ -229,7 +324,30 @@ void DwbController::computeAndPublishVelocity()
 
   progress_checker_->check(pose2d);
 
-  auto cmd_vel_2d = planner_->computeVelocityCommands(pose2d, odom_sub_->getTwist());
+  // Once per stall, so the recovery the failure leads to starts on warm servers
+  if (!progress_checker_->isStalling()) {
+    prefetch_requested_ = false;
+  } else if (!prefetch_requested_) {
+    RCLCPP_DEBUG(get_logger(), "Progress is stalling, asking the recoveries to prefetch");
+    prefetch_publisher_->publish(std_msgs::msg::Empty());
+    prefetch_requested_ = true;
+  }
+
+  if (critic_scales_changed_.exchange(false)) {
+    planner_->updateCriticScales();
+  }
+
+  nav_2d_msgs::msg::Twist2D velocity = odom_sub_->getTwist();
+  auto cmd_vel_2d = planner_->computeVelocityCommands(pose2d, velocity);
+
+  if (nav2_util::BlackBox::global().isOpen()) {
+    nav_msgs::msg::Odometry odom;
+    odom.header = pose2d.header;
+    odom.pose.pose = nav_2d_utils::pose2DToPose(pose2d.pose);
+    odom.twist.twist = nav_2d_utils::twist2Dto3D(velocity);
+    nav2_util::BlackBox::global().record(odom_channel_, odom);
+    nav2_util::BlackBox::global().record(cmd_vel_channel_, cmd_vel_2d);
+  }
 
   RCLCPP_DEBUG(get_logger(), "Publishing velocity at time %.2f", now().seconds());
   publishVelocity(cmd_vel_2d);
@@ -282,3 +400,7 @@ bool DwbController::getRobotPose(nav_2d_msgs::msg::Pose2DStamped & pose2d)
 }
 
 }  // namespace dwb_controller
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(dwb_controller::DwbController)
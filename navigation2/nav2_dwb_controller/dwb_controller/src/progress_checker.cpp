@@ -32,10 +32,22 @@ ProgressChecker::ProgressChecker(const rclcpp::Node::SharedPtr & node)
 
 void ProgressChecker::check(nav_2d_msgs::msg::Pose2DStamped & current_pose)
 {
+  geometry_msgs::msg::Pose2D pose = current_pose.pose;
+  nav2_util::MotionSample sample;
+  bool from_history = history_ && history_->latest(sample);
+  if (from_history) {
+    pose.x = sample.x;
+    pose.y = sample.y;
+    pose.theta = sample.theta;
+  }
+
   // relies on short circuit evaluation to not call is_robot_moved_enough if
-  // baseline_pose is not set.
-  if ((!baseline_pose_set_) || (is_robot_moved_enough(current_pose.pose))) {
-    reset_baseline_pose(current_pose.pose);
+  // baseline_pose is not set, or was taken in the other frame.
+  if ((!baseline_pose_set_) || (baseline_from_history_ != from_history) ||
+    (is_robot_moved_enough(pose)))
+  {
+    reset_baseline_pose(pose);
+    baseline_from_history_ = from_history;
     return;
   }
   if ((nh_->now() - baseline_time_) > time_allowance_) {
@@ -43,6 +55,12 @@ void ProgressChecker::check(nav_2d_msgs::msg::Pose2DStamped & current_pose)
   }
 }
 
+bool ProgressChecker::isStalling() const
+{
+  return baseline_pose_set_ &&
+         (nh_->now() - baseline_time_).nanoseconds() > time_allowance_.nanoseconds() / 2;
+}
+
 void ProgressChecker::reset_baseline_pose(const geometry_msgs::msg::Pose2D & pose)
 {
   baseline_pose_ = pose;
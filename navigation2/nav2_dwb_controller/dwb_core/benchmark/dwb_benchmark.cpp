@@ -0,0 +1,636 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Runs DWBLocalPlanner::computeVelocityCommands offline, without spinning, on
+// a costmap dump or one of the nav2_util test maps scaled up and inflated.
+//
+// With --odom, the poses and velocities of the file are replayed one per
+// cycle. Without it the robot starts on the first pose of the plan and
+// follows its own commands, integrated over --dt, until the goal checker is
+// satisfied or --cycles have run. The clock is simulated and never advances,
+// so the commands are the same from run to run and machine to machine; they
+// are written to --output, one line per cycle, for diffing. The timing of the
+// cycles, of each stage and of each critic, and the trajectories scored per
+// second, are printed when done.
+//
+// With --black-box, the control cycles a black box recorded (see
+// nav2_util/black_box.hpp) are replayed instead: the plans the controller
+// followed, the local costmap as its deltas rebuild it before each cycle, and
+// the pose and velocity of each cycle. The commands are compared with the
+// recorded ones, which they match unless the planner or its parameters changed.
+//
+// Plans are lines of "x y theta" and odometry lines of
+// "x y theta vx vy vtheta", in the map frame, with # starting a comment. The
+// planner's parameters are the node's, e.g. to tune the sampling:
+//
+//   dwb_benchmark --map maze1 --plan maze1.txt --output before.txt \
+//     --ros-args -p vx_samples:=20 -p vtheta_samples:=40 -p sim_time:=1.7
+//
+// Usage:
+//   dwb_benchmark [--map <test map> | --dump <file>] [--plan <file>]
+//                 [--odom <file> | --black-box <file>] [--cycles <n>] [--dt <seconds>]
+//                 [--repeat <n>] [--radius <meters>] [--output <file>]
+//                 [--ros-args ...]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "dwb_core/dwb_local_planner.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_2d_ros.hpp"
+#include "nav2_costmap_2d/costmap_dump.hpp"
+#include "nav2_costmap_2d/inflation_kernel.hpp"
+#include "nav2_msgs/msg/costmap_update.hpp"
+#include "nav2_msgs/msg/path.hpp"
+#include "nav2_util/black_box.hpp"
+#include "nav2_util/costmap.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/metrics.hpp"
+#include "nav_2d_msgs/msg/path2_d.hpp"
+#include "nav_2d_msgs/msg/pose2_d_stamped.hpp"
+#include "nav_2d_msgs/msg/twist2_d.hpp"
+#include "nav_2d_msgs/msg/twist2_d_stamped.hpp"
+#include "nav_2d_utils/conversions.hpp"
+#include "nav_msgs/msg/odometry.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+static const char * FRAME = "map";
+static const double RESOLUTION = 0.05;
+static const double INFLATION_RADIUS = 0.55;
+static const double COST_SCALING_FACTOR = 10.0;
+static const char * BLACK_BOX_COSTMAP = "local_costmap/costmap_raw_updates";
+
+struct OdomSample
+{
+  geometry_msgs::msg::Pose2D pose;
+  nav_2d_msgs::msg::Twist2D velocity;
+};
+
+// A control cycle of a black box, with the plan it followed and the costmap deltas recorded
+// since the cycle before
+struct ReplayCycle
+{
+  OdomSample sample;
+  size_t plan;
+  std::vector<nav2_msgs::msg::CostmapUpdate> updates;
+  bool has_cmd{false};
+  nav_2d_msgs::msg::Twist2D cmd;
+};
+
+struct BlackBoxReplay
+{
+  std::vector<nav_2d_msgs::msg::Path2D> plans;
+  std::vector<ReplayCycle> cycles;
+};
+
+static double yawOf(const geometry_msgs::msg::Quaternion & q)
+{
+  return std::atan2(2.0 * (q.w * q.z + q.x * q.y), 1.0 - 2.0 * (q.y * q.y + q.z * q.z));
+}
+
+// The plan in the costmap's frame, through the transform recorded with it if there is one
+static nav_2d_msgs::msg::Path2D planInCostmapFrame(
+  const nav2_msgs::msg::Path & path, const geometry_msgs::msg::TransformStamped * transform)
+{
+  nav_2d_msgs::msg::Path2D plan = nav_2d_utils::pathToPath2D(path);
+  plan.header.frame_id = FRAME;
+  if (transform) {
+    const auto & t = transform->transform;
+    double yaw = yawOf(t.rotation);
+    double cos_yaw = std::cos(yaw);
+    double sin_yaw = std::sin(yaw);
+    for (auto & pose : plan.poses) {
+      double x = pose.x;
+      pose.x = t.translation.x + cos_yaw * x - sin_yaw * pose.y;
+      pose.y = t.translation.y + sin_yaw * x + cos_yaw * pose.y;
+      pose.theta = std::remainder(pose.theta + yaw, 2.0 * M_PI);
+    }
+  }
+  return plan;
+}
+
+// The cycles of a black box from the first one with both a plan and a whole costmap
+static BlackBoxReplay readBlackBox(const std::string & filename)
+{
+  nav2_util::BlackBoxLog log;
+  if (!log.read(filename)) {
+    throw std::runtime_error("Could not read the black box " + filename);
+  }
+  const int plan_channel = log.find("dwb_controller/plan");
+  const int transform_channel = log.find("dwb_controller/plan_transform");
+  const int odom_channel = log.find("dwb_controller/odom");
+  const int cmd_vel_channel = log.find("dwb_controller/cmd_vel");
+  const int costmap_channel = log.find(BLACK_BOX_COSTMAP);
+  if (odom_channel < 0 || costmap_channel < 0) {
+    throw std::runtime_error(filename + " has no control cycles or no " + BLACK_BOX_COSTMAP);
+  }
+
+  BlackBoxReplay replay;
+  nav2_msgs::msg::Path path;
+  geometry_msgs::msg::TransformStamped transform;
+  bool new_plan = false;
+  bool has_transform = false;
+  bool has_keyframe = false;
+  bool cycle_kept = false;
+  std::vector<nav2_msgs::msg::CostmapUpdate> updates;
+  for (const auto & record : log.records()) {
+    const int channel = static_cast<int>(record.channel);
+    if (channel == costmap_channel) {
+      nav2_msgs::msg::CostmapUpdate update;
+      if (nav2_util::BlackBoxLog::deserialize(record, update) &&
+        (update.keyframe || has_keyframe))
+      {
+        if (update.keyframe) {
+          // what came before it is all overwritten
+          updates.clear();
+          has_keyframe = true;
+        }
+        updates.push_back(std::move(update));
+      }
+    } else if (channel == plan_channel) {
+      new_plan = nav2_util::BlackBoxLog::deserialize(record, path) && !path.poses.empty();
+      has_transform = false;
+    } else if (channel == transform_channel) {
+      has_transform = nav2_util::BlackBoxLog::deserialize(record, transform);
+    } else if (channel == odom_channel) {
+      if (new_plan) {
+        replay.plans.push_back(planInCostmapFrame(path, has_transform ? &transform : nullptr));
+        new_plan = false;
+      }
+      nav_msgs::msg::Odometry odom;
+      cycle_kept = has_keyframe && !replay.plans.empty() &&
+        nav2_util::BlackBoxLog::deserialize(record, odom);
+      if (!cycle_kept) {
+        continue;
+      }
+      ReplayCycle cycle;
+      cycle.sample.pose.x = odom.pose.pose.position.x;
+      cycle.sample.pose.y = odom.pose.pose.position.y;
+      cycle.sample.pose.theta = yawOf(odom.pose.pose.orientation);
+      cycle.sample.velocity.x = odom.twist.twist.linear.x;
+      cycle.sample.velocity.y = odom.twist.twist.linear.y;
+      cycle.sample.velocity.theta = odom.twist.twist.angular.z;
+      cycle.plan = replay.plans.size() - 1;
+      cycle.updates.swap(updates);
+      replay.cycles.push_back(std::move(cycle));
+    } else if (channel == cmd_vel_channel && cycle_kept) {
+      nav_2d_msgs::msg::Twist2DStamped cmd;
+      if (nav2_util::BlackBoxLog::deserialize(record, cmd)) {
+        replay.cycles.back().cmd = cmd.velocity;
+        replay.cycles.back().has_cmd = true;
+      }
+      cycle_kept = false;
+    }
+  }
+  if (replay.cycles.empty()) {
+    throw std::runtime_error(filename + " has no cycle with both a plan and a whole costmap");
+  }
+  return replay;
+}
+
+// Bring the costmap up to date with a delta, or replace it with a keyframe
+static void applyCostmapUpdate(
+  nav2_costmap_2d::LayeredCostmap & layers, const nav2_msgs::msg::CostmapUpdate & update)
+{
+  const nav2_msgs::msg::CostmapMetaData & metadata = update.metadata;
+  nav2_costmap_2d::Costmap2D & costmap = *layers.getCostmap();
+  const unsigned int size_x = metadata.size_x;
+  const unsigned int size_y = metadata.size_y;
+  if (update.keyframe) {
+    if (costmap.getSizeInCellsX() != size_x || costmap.getSizeInCellsY() != size_y ||
+      costmap.getResolution() != metadata.resolution ||
+      costmap.getOriginX() != metadata.origin.position.x ||
+      costmap.getOriginY() != metadata.origin.position.y)
+    {
+      layers.resizeMap(size_x, size_y, metadata.resolution, metadata.origin.position.x,
+        metadata.origin.position.y);
+    }
+    if (update.data.size() == static_cast<size_t>(size_x) * size_y) {
+      std::copy(update.data.begin(), update.data.end(), costmap.getCharMap());
+    }
+    return;
+  }
+  if (update.tile_size == 0 || costmap.getSizeInCellsX() != size_x ||
+    costmap.getSizeInCellsY() != size_y)
+  {
+    return;
+  }
+
+  const unsigned int tile = update.tile_size;
+  const unsigned int tiles_x = (size_x + tile - 1) / tile;
+  unsigned char * grid = costmap.getCharMap();
+  size_t offset = 0;
+  for (uint32_t index : update.tiles) {
+    unsigned int x0 = (index % tiles_x) * tile;
+    unsigned int y0 = (index / tiles_x) * tile;
+    unsigned int width = std::min(tile, size_x - x0);
+    unsigned int height = std::min(tile, size_y - y0);
+    if (y0 >= size_y || offset + static_cast<size_t>(width) * height > update.data.size()) {
+      return;
+    }
+    for (unsigned int y = y0; y < y0 + height; ++y) {
+      std::copy(update.data.begin() + offset, update.data.begin() + offset + width,
+        grid + static_cast<size_t>(y) * size_x + x0);
+      offset += width;
+    }
+  }
+}
+
+// The numbers of each line of a file that is not blank or a comment
+static std::vector<std::vector<double>> readLines(const std::string & filename, size_t columns)
+{
+  std::ifstream in(filename);
+  if (!in) {
+    throw std::runtime_error("Could not read " + filename);
+  }
+  std::vector<std::vector<double>> lines;
+  std::string line;
+  while (std::getline(in, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream stream(line);
+    std::vector<double> values;
+    double value;
+    while (stream >> value) {
+      values.push_back(value);
+    }
+    if (values.empty()) {
+      continue;
+    }
+    if (values.size() != columns) {
+      throw std::runtime_error("Expected " + std::to_string(columns) + " numbers a line in " +
+              filename + ": " + line);
+    }
+    lines.push_back(values);
+  }
+  return lines;
+}
+
+static bool testMapFromString(const std::string & name, nav2_util::TestCostmap & map)
+{
+  const std::pair<const char *, nav2_util::TestCostmap> maps[] = {
+    {"open_space", nav2_util::TestCostmap::open_space},
+    {"bounded", nav2_util::TestCostmap::bounded},
+    {"bottom_left_obstacle", nav2_util::TestCostmap::bottom_left_obstacle},
+    {"top_left_obstacle", nav2_util::TestCostmap::top_left_obstacle},
+    {"maze1", nav2_util::TestCostmap::maze1},
+    {"maze2", nav2_util::TestCostmap::maze2},
+  };
+  for (const auto & entry : maps) {
+    if (name == entry.first) {
+      map = entry.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+// The test map, a cell a meter, at RESOLUTION and inflated as the inflation layer would
+static void loadTestMap(
+  rclcpp::Node * node, nav2_util::TestCostmap type, double inscribed_radius,
+  nav2_costmap_2d::LayeredCostmap & layers)
+{
+  nav2_util::Costmap test_map(node);
+  test_map.set_test_costmap(type);
+  nav2_msgs::msg::Costmap source = test_map.get_costmap(nav2_msgs::msg::CostmapMetaData());
+
+  int scale = static_cast<int>(std::round(source.metadata.resolution / RESOLUTION));
+  int size_x = source.metadata.size_x * scale;
+  int size_y = source.metadata.size_y * scale;
+  layers.resizeMap(size_x, size_y, RESOLUTION, source.metadata.origin.position.x,
+    source.metadata.origin.position.y);
+  unsigned char * grid = layers.getCostmap()->getCharMap();
+  std::vector<int> obstacles;
+  for (int y = 0; y < size_y; ++y) {
+    for (int x = 0; x < size_x; ++x) {
+      unsigned char cost = source.data[(y / scale) * source.metadata.size_x + x / scale];
+      grid[y * size_x + x] = cost;
+      if (cost == nav2_costmap_2d::LETHAL_OBSTACLE) {
+        obstacles.push_back(y * size_x + x);
+      }
+    }
+  }
+
+  nav2_costmap_2d::InflationKernel kernel;
+  kernel.build(static_cast<unsigned int>(std::ceil(INFLATION_RADIUS / RESOLUTION)),
+    [inscribed_radius](double distance) -> unsigned char {
+      if (distance == 0.0) {
+        return nav2_costmap_2d::LETHAL_OBSTACLE;
+      }
+      double meters = distance * RESOLUTION;
+      if (meters <= inscribed_radius) {
+        return nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE;
+      }
+      double factor = std::exp(-COST_SCALING_FACTOR * (meters - inscribed_radius));
+      return static_cast<unsigned char>((nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE - 1) *
+      factor);
+    });
+  for (int index : obstacles) {
+    kernel.stamp(grid, size_x, size_y, index % size_x, index / size_x,
+      nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+  }
+}
+
+static nav_2d_msgs::msg::Path2D makePlan(const std::vector<std::vector<double>> & lines)
+{
+  nav_2d_msgs::msg::Path2D plan;
+  plan.header.frame_id = FRAME;
+  for (const auto & line : lines) {
+    geometry_msgs::msg::Pose2D pose;
+    pose.x = line[0];
+    pose.y = line[1];
+    pose.theta = line[2];
+    plan.poses.push_back(pose);
+  }
+  return plan;
+}
+
+// A straight line across the test maps, a pose every resolution
+static nav_2d_msgs::msg::Path2D defaultPlan()
+{
+  std::vector<std::vector<double>> lines;
+  double x0 = 1.5, y0 = 1.5, x1 = 8.5, y1 = 8.5;
+  double length = std::hypot(x1 - x0, y1 - y0);
+  int steps = static_cast<int>(length / RESOLUTION);
+  for (int i = 0; i <= steps; ++i) {
+    double t = static_cast<double>(i) / steps;
+    lines.push_back({x0 + t * (x1 - x0), y0 + t * (y1 - y0), std::atan2(y1 - y0, x1 - x0)});
+  }
+  return makePlan(lines);
+}
+
+static void printHistogram(const std::string & name, const nav2_util::HistogramSnapshot & h)
+{
+  printf("%-48s %10llu %10.1f %10.1f %10.1f %10.2f\n", name.c_str(),
+    static_cast<unsigned long long>(h.count), h.mean() * 1e6, h.quantile(0.5) * 1e6,  // NOLINT
+    h.quantile(0.99) * 1e6, h.sum_ns * 1e-6);
+}
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+  std::vector<std::string> args = rclcpp::remove_ros_arguments(argc, argv);
+
+  std::string map_name = "open_space";
+  std::string dump_file;
+  std::string plan_file;
+  std::string odom_file;
+  std::string black_box_file;
+  std::string output_file;
+  int max_cycles = 600;
+  double dt = 0.05;
+  int repeat = 1;
+  double radius = 0.22;
+  for (size_t i = 1; i + 1 < args.size(); i += 2) {
+    const std::string & option = args[i];
+    const char * value = args[i + 1].c_str();
+    if (option == "--map") {
+      map_name = value;
+    } else if (option == "--dump") {
+      dump_file = value;
+    } else if (option == "--plan") {
+      plan_file = value;
+    } else if (option == "--odom") {
+      odom_file = value;
+    } else if (option == "--black-box") {
+      black_box_file = value;
+    } else if (option == "--cycles") {
+      max_cycles = atoi(value);
+    } else if (option == "--dt") {
+      dt = atof(value);
+    } else if (option == "--repeat") {
+      repeat = std::max(atoi(value), 1);
+    } else if (option == "--radius") {
+      radius = atof(value);
+    } else if (option == "--output") {
+      output_file = value;
+    } else {
+      fprintf(stderr, "Unknown option %s\n", option.c_str());
+      return 1;
+    }
+  }
+
+  nav_2d_msgs::msg::Path2D plan;
+  std::vector<OdomSample> odometry;
+  BlackBoxReplay replay;
+  try {
+    if (!black_box_file.empty()) {
+      replay = readBlackBox(black_box_file);
+      plan = replay.plans[replay.cycles.front().plan];
+      for (const auto & cycle : replay.cycles) {
+        odometry.push_back(cycle.sample);
+      }
+    } else {
+      plan = plan_file.empty() ? defaultPlan() : makePlan(readLines(plan_file, 3));
+    }
+    if (!odom_file.empty()) {
+      for (const auto & line : readLines(odom_file, 6)) {
+        OdomSample sample;
+        sample.pose.x = line[0];
+        sample.pose.y = line[1];
+        sample.pose.theta = line[2];
+        sample.velocity.x = line[3];
+        sample.velocity.y = line[4];
+        sample.velocity.theta = line[5];
+        odometry.push_back(sample);
+      }
+    }
+  } catch (const std::runtime_error & e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  if (plan.poses.empty()) {
+    fprintf(stderr, "The plan is empty\n");
+    return 1;
+  }
+
+  // A costmap with no layers, configured but never activated, so nothing updates it
+  auto costmap_ros = std::make_shared<nav2_costmap_2d::Costmap2DROS>("dwb_benchmark_costmap");
+  costmap_ros->set_parameters({
+      rclcpp::Parameter("plugin_names", std::vector<std::string>()),
+      rclcpp::Parameter("plugin_types", std::vector<std::string>()),
+      rclcpp::Parameter("global_frame", std::string(FRAME)),
+      rclcpp::Parameter("robot_radius", radius),
+      rclcpp::Parameter("resolution", RESOLUTION),
+    });
+  rclcpp_lifecycle::State state;
+  costmap_ros->on_configure(state);
+
+  nav2_costmap_2d::LayeredCostmap & layers = *costmap_ros->getLayeredCostmap();
+  if (!dump_file.empty()) {
+    try {
+      nav2_costmap_2d::CostmapDump(dump_file).restore(layers);
+    } catch (const std::runtime_error & e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+    }
+  } else {
+    nav2_util::TestCostmap type;
+    if (!testMapFromString(map_name, type)) {
+      fprintf(stderr, "Unknown test map %s\n", map_name.c_str());
+      return 1;
+    }
+    auto map_node = rclcpp::Node::make_shared("dwb_benchmark_map");
+    loadTestMap(map_node.get(), type, layers.getInscribedRadius(), layers);
+  }
+
+  // The plan, the poses and the costmap share a frame, which only has to exist
+  geometry_msgs::msg::TransformStamped identity;
+  identity.header.frame_id = FRAME;
+  identity.child_frame_id = "base_link";
+  identity.transform.rotation.w = 1.0;
+  costmap_ros->getTfBuffer()->setTransform(identity, "dwb_benchmark", true);
+
+  // Profiling on for the per critic timing, with nothing else published; a clock that
+  // never advances keeps time based critics, such as oscillation, repeatable
+  auto options = rclcpp::NodeOptions().parameter_overrides({
+      rclcpp::Parameter("use_sim_time", true),
+      rclcpp::Parameter("publish_evaluation", false),
+      rclcpp::Parameter("publish_global_plan", false),
+      rclcpp::Parameter("publish_transformed_plan", false),
+      rclcpp::Parameter("publish_local_plan", false),
+      rclcpp::Parameter("publish_trajectories", false),
+      rclcpp::Parameter("publish_cost_grid_pc", false),
+      rclcpp::Parameter("publish_profile", true),
+      rclcpp::Parameter("profile_cycles", 1 << 30),
+    });
+  auto node = std::make_shared<nav2_util::LifecycleNode>("dwb_benchmark", "", false, options);
+  dwb_core::DWBLocalPlanner planner(node, costmap_ros->getTfBuffer(), costmap_ros);
+  if (planner.on_configure(state) != nav2_util::CallbackReturn::SUCCESS) {
+    fprintf(stderr, "Could not configure the planner\n");
+    return 1;
+  }
+  planner.on_activate(state);
+
+  FILE * output = nullptr;
+  if (!output_file.empty()) {
+    output = fopen(output_file.c_str(), "w");
+    if (!output) {
+      fprintf(stderr, "Could not write %s\n", output_file.c_str());
+      return 1;
+    }
+  }
+
+  int cycles = 0;
+  int failures = 0;
+  int compared = 0;
+  int diverged = 0;
+  bool reached = false;
+  for (int r = 0; r < repeat; ++r) {
+    planner.setPlan(plan);
+    size_t replay_plan = replay.cycles.empty() ? 0 : replay.cycles.front().plan;
+    nav_2d_msgs::msg::Pose2DStamped pose;
+    pose.header.frame_id = FRAME;
+    pose.pose = plan.poses.front();
+    nav_2d_msgs::msg::Twist2D velocity;
+    int run_cycles = odometry.empty() ? max_cycles : static_cast<int>(odometry.size());
+    for (int cycle = 0; cycle < run_cycles; ++cycle) {
+      if (!replay.cycles.empty()) {
+        // the costmap and plan as the controller had them; the first cycle's deltas start
+        // with a keyframe, so each run starts over from the same map
+        const ReplayCycle & recorded = replay.cycles[cycle];
+        for (const auto & update : recorded.updates) {
+          applyCostmapUpdate(layers, update);
+        }
+        if (recorded.plan != replay_plan) {
+          replay_plan = recorded.plan;
+          planner.setPlan(replay.plans[replay_plan]);
+        }
+      }
+      if (!odometry.empty()) {
+        pose.pose = odometry[cycle].pose;
+        velocity = odometry[cycle].velocity;
+      } else if (planner.isGoalReached(pose, velocity)) {
+        reached = true;
+        break;
+      }
+
+      nav_2d_msgs::msg::Twist2D cmd;
+      bool failed = false;
+      try {
+        cmd = planner.computeVelocityCommands(pose, velocity).velocity;
+      } catch (const std::exception &) {
+        failed = true;
+        ++failures;
+      }
+      ++cycles;
+      if (output && r == 0) {
+        fprintf(output, "%d %.4f %.4f %.4f %s %.4f %.4f %.4f\n", cycle, pose.pose.x,
+          pose.pose.y, pose.pose.theta, failed ? "failed" : "ok", cmd.x, cmd.y, cmd.theta);
+      }
+      if (r == 0 && !replay.cycles.empty() && replay.cycles[cycle].has_cmd && !failed) {
+        const nav_2d_msgs::msg::Twist2D & recorded = replay.cycles[cycle].cmd;
+        ++compared;
+        if (std::abs(cmd.x - recorded.x) > 1e-3 || std::abs(cmd.y - recorded.y) > 1e-3 ||
+          std::abs(cmd.theta - recorded.theta) > 1e-3)
+        {
+          ++diverged;
+        }
+      }
+
+      if (odometry.empty()) {
+        // the robot drives the command exactly for one period
+        double cos_theta = std::cos(pose.pose.theta);
+        double sin_theta = std::sin(pose.pose.theta);
+        pose.pose.x += (cmd.x * cos_theta - cmd.y * sin_theta) * dt;
+        pose.pose.y += (cmd.x * sin_theta + cmd.y * cos_theta) * dt;
+        pose.pose.theta = std::remainder(pose.pose.theta + cmd.theta * dt, 2.0 * M_PI);
+        velocity = cmd;
+      }
+    }
+  }
+  if (output) {
+    fclose(output);
+  }
+
+  nav2_util::MetricsRegistry & registry = nav2_util::MetricsRegistry::global();
+  nav2_util::HistogramSnapshot cycle_time =
+    registry.histogram("dwb.compute_velocity_commands").snapshot();
+  uint64_t trajectories = registry.counter("dwb.trajectories").value();
+  double seconds = cycle_time.sum_ns * 1e-9;
+
+  printf("%d cycles over %d runs, %d failed%s\n", cycles, repeat, failures,
+    odometry.empty() ? (reached ? ", goal reached" : ", goal not reached") : "");
+  if (!replay.cycles.empty()) {
+    printf("%d of %d recorded commands differ by more than 1e-3\n", diverged, compared);
+  }
+  printf("%llu trajectories, %.1f a cycle, %.0f a second\n",
+    static_cast<unsigned long long>(trajectories),  // NOLINT
+    cycles ? static_cast<double>(trajectories) / cycles : 0.0,
+    seconds > 0.0 ? trajectories / seconds : 0.0);
+  printf("\n%-48s %10s %10s %10s %10s %10s\n", "Timing", "Count", "Mean us", "p50 us",
+    "p99 us", "Total ms");
+  printHistogram("dwb.compute_velocity_commands", cycle_time);
+  for (const auto & entry : registry.histograms()) {
+    if (entry.name.compare(0, 4, "dwb.") == 0 &&
+      entry.name != "dwb.compute_velocity_commands")
+    {
+      printHistogram(entry.name, entry.metric->snapshot());
+    }
+  }
+
+  planner.on_deactivate(state);
+  planner.on_cleanup(state);
+  rclcpp::shutdown();
+  return 0;
+}
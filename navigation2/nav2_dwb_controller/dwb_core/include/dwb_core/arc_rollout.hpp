@@ -0,0 +1,108 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Locus Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DWB_CORE__ARC_ROLLOUT_HPP_
+#define DWB_CORE__ARC_ROLLOUT_HPP_
+
+#include <cmath>
+#include <cstddef>
+
+#include "geometry_msgs/msg/pose2_d.hpp"
+#include "nav_2d_msgs/msg/twist2_d.hpp"
+
+namespace dwb_core
+{
+
+/// Below this angular velocity the arc is treated as a straight line
+const double ARC_MIN_ANGULAR_VELOCITY = 1e-9;
+
+/**
+ * @brief The poses a robot reaches from start after each of n times, moving at a
+ * constant velocity in its own frame
+ *
+ * The motion is an arc, or a line without rotation, so each pose is computed directly
+ * from its time rather than by integrating steps, and exactly. The loop has no
+ * dependency between samples for the compiler to vectorize it. A critic may use it to
+ * resample a trajectory of constant velocity, from its first pose and velocity, at
+ * whatever times it needs.
+ *
+ * @param start The pose at time zero
+ * @param vel The velocity, in the robot's frame
+ * @param times The times of the poses, in seconds
+ * @param n The number of times and poses
+ * @param poses Where the poses are written
+ */
+inline void posesAlongArc(
+  const geometry_msgs::msg::Pose2D & start, const nav_2d_msgs::msg::Twist2D & vel,
+  const double * times, size_t n, geometry_msgs::msg::Pose2D * poses)
+{
+  const double cos0 = std::cos(start.theta);
+  const double sin0 = std::sin(start.theta);
+  if (std::fabs(vel.theta) < ARC_MIN_ANGULAR_VELOCITY) {
+    const double vx = vel.x * cos0 - vel.y * sin0;
+    const double vy = vel.x * sin0 + vel.y * cos0;
+    for (size_t i = 0; i < n; ++i) {
+      poses[i].x = start.x + vx * times[i];
+      poses[i].y = start.y + vy * times[i];
+      poses[i].theta = start.theta;
+    }
+    return;
+  }
+
+  // the integral of the velocity rotated by theta(t) = theta0 + w t, relative to the start
+  const double inv_w = 1.0 / vel.theta;
+  for (size_t i = 0; i < n; ++i) {
+    double theta = start.theta + vel.theta * times[i];
+    double dsin = std::sin(theta) - sin0;
+    double dcos = std::cos(theta) - cos0;
+    poses[i].x = start.x + (vel.x * dsin + vel.y * dcos) * inv_w;
+    poses[i].y = start.y + (vel.y * dsin - vel.x * dcos) * inv_w;
+    poses[i].theta = theta;
+  }
+}
+
+/**
+ * @brief The pose a robot reaches from start after time dt at a constant velocity
+ */
+inline geometry_msgs::msg::Pose2D poseAlongArc(
+  const geometry_msgs::msg::Pose2D & start, const nav_2d_msgs::msg::Twist2D & vel, double dt)
+{
+  geometry_msgs::msg::Pose2D pose;
+  posesAlongArc(start, vel, &dt, 1, &pose);
+  return pose;
+}
+
+}  // namespace dwb_core
+
+#endif  // DWB_CORE__ARC_ROLLOUT_HPP_
@@ -40,11 +40,15 @@
 #include <vector>
 
 #include "dwb_core/goal_checker.hpp"
+#include "dwb_core/planner_profiler.hpp"
 #include "dwb_core/publisher.hpp"
 #include "dwb_core/trajectory_critic.hpp"
 #include "dwb_core/trajectory_generator.hpp"
+#include "geometry_msgs/msg/transform_stamped.hpp"
 #include "nav_2d_msgs/msg/pose2_d_stamped.hpp"
 #include "nav_2d_msgs/msg/twist2_d_stamped.hpp"
+#include "nav_2d_utils/path_cache.hpp"
+#include "nav2_costmap_2d/worker_pool.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 #include "pluginlib/class_loader.hpp"
 
@@ -77,13 +81,19 @@ public:
    */
   void setPlan(const nav_2d_msgs::msg::Path2D & path);
 
+  /**
+   * @brief setPlan taking over the path rather than copying it
+   */
+  void setPlan(nav_2d_msgs::msg::Path2D && path);
+
   /**
    * @brief nav_core2 computeVelocityCommands - calculates the best command given the current pose and velocity
    *
    * It is presumed that the global plan is already set.
    *
    * This is mostly a wrapper for the protected computeVelocityCommands
-   * function which has additional debugging info.
+   * function which has additional debugging info. With latency_compensation set, it plans
+   * from the pose predicted for when the command takes effect, see compensateLatency().
    *
    * @param pose Current robot pose
    * @param velocity Current robot velocity
@@ -139,7 +149,38 @@ public:
     const nav_2d_msgs::msg::Twist2D & velocity,
     std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results);
 
+  /**
+   * @brief The names of the loaded critics, whose scales are the <name>.scale parameters
+   */
+  std::vector<std::string> getCriticNames() const;
+
+  /**
+   * @brief Give the critics the current values of their scale parameters
+   *
+   * Changing a scale takes no more than this, so it can be tuned without loading the critics
+   * again. Must not be called while computing velocity commands.
+   */
+  void updateCriticScales();
+
 protected:
+  /**
+   * @brief The pose the robot will be at when the command takes effect
+   *
+   * The latency is the age of the pose, from its stamp, plus command_delay, capped at
+   * max_latency_compensation. The robot is taken to keep its velocity for that long.
+   * The latency is set as the gauge dwb.compensated_latency.
+   */
+  nav_2d_msgs::msg::Pose2DStamped compensateLatency(
+    const nav_2d_msgs::msg::Pose2DStamped & pose,
+    const nav_2d_msgs::msg::Twist2D & velocity);
+
+  /**
+   * @brief Where the pose is after dt seconds at a constant velocity, in the robot's frame
+   */
+  static geometry_msgs::msg::Pose2D predictPose(
+    const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & velocity,
+    double dt);
+
   /**
    * @brief Helper method for two common operations for the operating on the global_plan
    *
@@ -173,7 +214,80 @@ protected:
   nav_2d_msgs::msg::Path2D global_plan_;  ///< Saved Global Plan
   bool prune_plan_;
   double prune_distance_;
+
+  /**
+   * @brief transformGlobalPlan for incremental_plan_transform, which follows the robot along the plan
+   *
+   * The search for the first pose near the robot starts from where it was found last cycle and
+   * looks search_distance along the plan before looking up the rest of it in plan_cache_, which
+   * only visits the poses near the robot. Passed poses are skipped instead of erased from
+   * global_plan_, and the transformed window is reused while neither it nor the transform has
+   * changed.
+   */
+  nav_2d_msgs::msg::Path2D transformPlanWindow(
+    const nav_2d_msgs::msg::Pose2DStamped & pose, const geometry_msgs::msg::Pose2D & robot_pose,
+    double sq_transform_start_threshold, double sq_transform_end_threshold,
+    double search_distance);
+  bool incremental_plan_transform_;
+  size_t plan_start_index_{0};  ///< Index in global_plan_ the next search starts from
+  nav_2d_utils::PathCache plan_cache_;  ///< global_plan_ indexed, for searches off the path ahead
+  nav_2d_msgs::msg::Path2D cached_plan_;
+  geometry_msgs::msg::TransformStamped cached_transform_;
+  size_t cached_begin_{0}, cached_end_{0};  ///< The part of global_plan_ in cached_plan_
   bool debug_trajectory_details_;
+  /// Generates and scores the sampled twists in parallel, null when scoring serially
+  std::unique_ptr<nav2_costmap_2d::WorkerPool> scoring_pool_;
+
+  /**
+   * @brief Debrief every critic on the chosen command, and finish the cycle's profile
+   */
+  void debriefCritics(const nav_2d_msgs::msg::Twist2D & cmd_vel);
+
+  bool profiling_{false};
+  PlannerProfiler profiler_;
+  /// Every computeVelocityCommands(), whether profiling or not
+  nav2_util::LatencyHistogram & cycle_time_;
+  /// Every trajectory generated and scored, legal or not
+  nav2_util::Counter & trajectory_count_;
+  /// The latency of the last compensated cycle
+  nav2_util::Gauge & compensated_latency_;
+
+  bool latency_compensation_{false};
+  double command_delay_{0.0};  ///< Seconds from computing a command to the base acting on it
+  double max_latency_compensation_{0.25};  ///< Most seconds a pose is predicted forward
+
+  /**
+   * @brief Reorder critic_order_ so the critics that reject trajectories cheaply run first
+   */
+  void updateCriticOrder();
+
+  /// Decaying totals of the time and rejections of one critic, used to order the critics
+  struct CriticStats
+  {
+    double seconds{0.0};
+    double calls{0.0};
+    double rejections{0.0};
+  };
+  bool adaptive_critic_order_;
+  std::vector<CriticStats> critic_stats_;  ///< Indexed like critics_
+  std::vector<size_t> critic_order_;  ///< Indices into critics_ in the order they are run
+
+  /**
+   * @brief Add the scores of the critics not scored in a batch to score, whose traj is set
+   *
+   * Scoring stops once the total is above a positive best_score, as in scoreTrajectory.
+   */
+  void scoreCritics(dwb_msgs::msg::TrajectoryScore & score, double best_score);
+  bool batch_scoring_;
+  std::vector<bool> batched_critics_;  ///< Indexed like critics_, true if scored in a batch
+
+  /// Whether the twists are searched coarse to fine rather than all scored, serially
+  bool coarse_to_fine_{false};
+  int refine_top_k_{3};  ///< The candidates refined at each level
+  int refine_levels_{2};  ///< The times the grid is halved around the candidates
+  /// The twist chosen last cycle, which the next coarse search is seeded with
+  nav_2d_msgs::msg::Twist2D last_best_twist_;
+  bool has_last_best_{false};
   rclcpp::Duration transform_tolerance_{0, 0};
 
   /**
@@ -0,0 +1,128 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Locus Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DWB_CORE__PLANNER_PROFILER_HPP_
+#define DWB_CORE__PLANNER_PROFILER_HPP_
+
+#include <string>
+#include <vector>
+
+#include "dwb_core/trajectory_critic.hpp"
+#include "dwb_msgs/msg/planner_profile.hpp"
+#include "dwb_msgs/msg/timing_stats.hpp"
+#include "nav2_util/metrics.hpp"
+
+namespace dwb_core
+{
+
+/**
+ * @class TimingSamples
+ * @brief Durations collected until they are summarized into a TimingStats message
+ */
+class TimingSamples
+{
+public:
+  void add(double seconds) {samples_.push_back(static_cast<float>(seconds * 1e6));}
+
+  /**
+   * @brief Summarize the samples into stats and discard them
+   */
+  void take(dwb_msgs::msg::TimingStats & stats);
+
+protected:
+  std::vector<float> samples_;  ///< Microseconds
+};
+
+/**
+ * @class PlannerProfiler
+ * @brief Collects the stage and per-critic timing of DWBLocalPlanner for a PlannerProfile
+ *
+ * Every duration also goes to a histogram of the process's metrics registry, named
+ * dwb.<stage> or dwb.critic.<critic>.<stage>.
+ */
+class PlannerProfiler
+{
+public:
+  enum Stage {PREPARE, GENERATION, SCORING, DEBRIEF};
+
+  /**
+   * @brief Start over with one entry per critic
+   */
+  void initialize(const std::vector<TrajectoryCritic::Ptr> & critics);
+
+  void addStage(Stage stage, double seconds)
+  {
+    stages_[stage].add(seconds);
+    stage_histograms_[stage]->recordSeconds(seconds);
+  }
+
+  /**
+   * @brief Record one call of a critic, by its index in the critics given to initialize
+   */
+  void addCritic(Stage stage, size_t critic, double seconds)
+  {
+    critics_[critic].stages[stage].add(seconds);
+    critics_[critic].histograms[stage]->recordSeconds(seconds);
+  }
+
+  void addShortCircuit(size_t critic) {critics_[critic].short_circuits++;}
+  void addIllegal(size_t critic) {critics_[critic].illegal++;}
+
+  void endCycle() {cycles_++;}
+  unsigned int cycles() const {return cycles_;}
+
+  /**
+   * @brief Summarize everything collected since the last call into a message and start over
+   */
+  dwb_msgs::msg::PlannerProfile takeProfile();
+
+protected:
+  struct CriticSamples
+  {
+    std::string name;
+    TimingSamples stages[DEBRIEF + 1];
+    nav2_util::LatencyHistogram * histograms[DEBRIEF + 1];
+    unsigned int short_circuits{0};
+    unsigned int illegal{0};
+  };
+
+  unsigned int cycles_{0};
+  TimingSamples stages_[DEBRIEF + 1];
+  nav2_util::LatencyHistogram * stage_histograms_[DEBRIEF + 1];
+  std::vector<CriticSamples> critics_;
+};
+
+}  // namespace dwb_core
+
+#endif  // DWB_CORE__PLANNER_PROFILER_HPP_
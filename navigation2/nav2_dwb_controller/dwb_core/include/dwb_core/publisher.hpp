@@ -35,13 +35,18 @@
 #ifndef DWB_CORE__PUBLISHER_HPP_
 #define DWB_CORE__PUBLISHER_HPP_
 
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "dwb_core/common_types.hpp"
 #include "dwb_core/trajectory_critic.hpp"
 #include "dwb_msgs/msg/local_plan_evaluation.hpp"
+#include "dwb_msgs/msg/planner_profile.hpp"
 #include "nav2_util/lifecycle_helper_interface.hpp"
 #include "nav_msgs/msg/path.hpp"
 #include "rclcpp/rclcpp.hpp"
@@ -65,11 +70,17 @@ namespace dwb_core
  *   4) The Full LocalPlanEvaluation
  *   5) Markers representing the different trajectories evaluated
  *   6) The CostGrid (in the form of a complex PointCloud2)
+ *   7) A PlannerProfile with the stage and critic timing, every profile_cycles cycles
+ *
+ * The evaluation, trajectories and cost grid can be limited to debug_publish_rate, and with
+ * async_publishing set they are published from a background thread. The thread only ever holds
+ * the latest of each, so a snapshot it has not got to yet is dropped for the newer one.
  */
 class DWBPublisher : public nav2_util::LifecycleHelperInterface
 {
 public:
   explicit DWBPublisher(nav2_util::LifecycleNode::SharedPtr node);
+  ~DWBPublisher();
 
   nav2_util::CallbackReturn on_configure(const rclcpp_lifecycle::State & state) override;
   nav2_util::CallbackReturn on_activate(const rclcpp_lifecycle::State & state) override;
@@ -80,10 +91,28 @@ public:
    * @brief Does the publisher require that the LocalPlanEvaluation be saved
    * @return True if the Evaluation is needed to publish either directly or as trajectories
    */
-  bool shouldRecordEvaluation() {return publish_evaluation_ || publish_trajectories_;}
+  bool shouldRecordEvaluation()
+  {
+    return (publish_evaluation_ || publish_trajectories_) && isDue(last_evaluation_time_);
+  }
+
+  /**
+   * @brief Does the publisher require the planner to be profiled
+   */
+  bool shouldRecordProfile() {return publish_profile_;}
+
+  /**
+   * @brief The number of cycles each published profile should cover
+   */
+  unsigned int getProfileCycles() {return profile_cycles_;}
+
+  void publishProfile(const dwb_msgs::msg::PlannerProfile & profile);
 
   /**
    * @brief If the pointer is not null, publish the evaluation and trajectories as needed
+   *
+   * With async_publishing the publisher takes over the evaluation, which must not be
+   * changed afterwards.
    */
   void publishEvaluation(std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> results);
   void publishLocalPlan(
@@ -92,13 +121,29 @@ public:
   void publishCostGrid(
     const CostmapROSPtr costmap_ros,
     const std::vector<TrajectoryCritic::Ptr> critics);
-  void publishGlobalPlan(const nav_2d_msgs::msg::Path2D plan);
-  void publishTransformedPlan(const nav_2d_msgs::msg::Path2D plan);
-  void publishLocalPlan(const nav_2d_msgs::msg::Path2D plan);
+  void publishGlobalPlan(const nav_2d_msgs::msg::Path2D & plan);
+  void publishTransformedPlan(const nav_2d_msgs::msg::Path2D & plan);
+  void publishLocalPlan(const nav_2d_msgs::msg::Path2D & plan);
 
 protected:
   void publishTrajectories(const dwb_msgs::msg::LocalPlanEvaluation & results);
 
+  /**
+   * @brief Whether debug_publish_rate allows publishing again since last_time
+   */
+  bool isDue(std::chrono::steady_clock::time_point last_time) const
+  {
+    return debug_publish_period_ <= 0.0 ||
+           std::chrono::duration<double>(std::chrono::steady_clock::now() - last_time).count() >=
+           debug_publish_period_;
+  }
+
+  /**
+   * @brief Publish the snapshots handed to the background thread until stopPublishThread
+   */
+  void publishLoop();
+  void stopPublishThread();
+
   void addDeleteMarkers(
     visualization_msgs::msg::MarkerArray & ma,
     unsigned startingId,
@@ -107,7 +152,7 @@ protected:
 
   // Helper function for publishing other plans
   void publishGenericPlan(
-    const nav_2d_msgs::msg::Path2D plan,
+    const nav_2d_msgs::msg::Path2D & plan,
     rclcpp::Publisher<nav_msgs::msg::Path> & pub, bool flag);
 
   // Flags for turning on/off publishing specific components
@@ -117,6 +162,19 @@ protected:
   bool publish_local_plan_;
   bool publish_trajectories_;
   bool publish_cost_grid_pc_;
+  bool publish_profile_;
+  unsigned int profile_cycles_;
+
+  // Rate limit and background publishing of the evaluation, trajectories and cost grid
+  double debug_publish_period_;
+  bool async_publishing_;
+  std::chrono::steady_clock::time_point last_evaluation_time_, last_cost_grid_time_;
+  std::thread publish_thread_;
+  std::mutex publish_mutex_;
+  std::condition_variable publish_cv_;
+  bool stop_publishing_{false};
+  std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> pending_evaluation_;
+  std::unique_ptr<sensor_msgs::msg::PointCloud> pending_cost_grid_;
 
   // Previously published marker count for removing markers as needed
   unsigned int prev_marker_count_;
@@ -128,6 +186,7 @@ protected:
   std::shared_ptr<LifecyclePublisher<nav_msgs::msg::Path>> local_pub_;
   std::shared_ptr<LifecyclePublisher<visualization_msgs::msg::MarkerArray>> marker_pub_;
   std::shared_ptr<LifecyclePublisher<sensor_msgs::msg::PointCloud>> cost_grid_pc_pub_;
+  std::shared_ptr<LifecyclePublisher<dwb_msgs::msg::PlannerProfile>> profile_pub_;
 
   nav2_util::LifecycleNode::SharedPtr node_;
 };
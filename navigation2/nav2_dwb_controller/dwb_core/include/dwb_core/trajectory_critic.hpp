@@ -41,6 +41,7 @@
 
 #include "rclcpp/rclcpp.hpp"
 #include "dwb_core/common_types.hpp"
+#include "dwb_core/exceptions.hpp"
 #include "geometry_msgs/msg/pose2_d.hpp"
 #include "nav_2d_msgs/msg/twist2_d.hpp"
 #include "nav_2d_msgs/msg/path2_d.hpp"
@@ -65,7 +66,8 @@ namespace dwb_core
  *       It is presumed that there are multiple trajectories that we want to evaluate,
  *       and there may be some shared work that can be done beforehand to optimize
  *       the scoring of each individual trajectory.
- *  3) scoreTrajectory is called once per trajectory and returns the score.
+ *  3) scoreTrajectory is called once per trajectory and returns the score, or with
+ *       batch_scoring, scoreTrajectories is called once with all of them.
  *  4) debrief is called after each set of trajectories with the chosen trajectory.
  *       This can be used for stateful critics that monitor the trajectory through time.
  *
@@ -141,6 +143,49 @@ public:
    */
   virtual double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) = 0;
 
+  /**
+   * @brief Return a raw score for the given trajectory, possibly cut short past a limit
+   *
+   * If raw_limit is not negative, the trajectory is already beaten once its raw score goes
+   * above raw_limit, so critics whose score only grows along the trajectory may stop early
+   * and return any score above the limit. By default the whole trajectory is scored.
+   */
+  virtual double scoreTrajectoryBounded(
+    const dwb_msgs::msg::Trajectory2D & traj,
+    double /*raw_limit*/)
+  {
+    return scoreTrajectory(traj);
+  }
+
+  /**
+   * @brief Return raw scores for a batch of trajectories at once
+   *
+   * scores and errors are resized to the number of trajectories. An illegal trajectory gets
+   * a negative score and the reason in errors, a legal one an empty error. By default each
+   * trajectory goes through scoreTrajectory; critics that can score the whole batch in one
+   * branch-free pass override this along with hasBatchScoring.
+   */
+  virtual void scoreTrajectories(
+    const std::vector<dwb_msgs::msg::Trajectory2D> & trajs,
+    std::vector<double> & scores, std::vector<std::string> & errors)
+  {
+    scores.resize(trajs.size());
+    errors.assign(trajs.size(), std::string());
+    for (size_t i = 0; i < trajs.size(); ++i) {
+      try {
+        scores[i] = scoreTrajectory(trajs[i]);
+      } catch (const nav_core2::IllegalTrajectoryException & e) {
+        scores[i] = -1.0;
+        errors[i] = e.what();
+      }
+    }
+  }
+
+  /**
+   * @brief Whether scoreTrajectories is cheaper than scoring the trajectories one by one
+   */
+  virtual bool hasBatchScoring() const {return false;}
+
   /**
    * @brief debrief informs the critic what the chosen cmd_vel was (if it cares)
    */
@@ -110,6 +110,31 @@ public:
     return twists;
   }
 
+  /**
+   * @brief Get the twists a coarse-to-fine search starts from: a coarser grid over the same
+   * velocities as getTwists(), which it is unless overridden
+   * @param current_velocity
+   */
+  virtual std::vector<nav_2d_msgs::msg::Twist2D> getCoarseTwists(
+    const nav_2d_msgs::msg::Twist2D & current_velocity)
+  {
+    return getTwists(current_velocity);
+  }
+
+  /**
+   * @brief Get the twists a coarse-to-fine search refines a candidate with: center and its
+   * neighbors, spaced fraction of the coarse grid's spacing apart, that are reachable from
+   * current_velocity
+   *
+   * None unless overridden, which leaves the search at the coarse twists.
+   */
+  virtual std::vector<nav_2d_msgs::msg::Twist2D> getTwistsAround(
+    const nav_2d_msgs::msg::Twist2D & /*current_velocity*/,
+    const nav_2d_msgs::msg::Twist2D & /*center*/, double /*fraction*/)
+  {
+    return {};
+  }
+
   /**
    * @brief Given a cmd_vel in the robot's frame and initial conditions, generate a Trajectory2D
    * @param start_pose Current robot location
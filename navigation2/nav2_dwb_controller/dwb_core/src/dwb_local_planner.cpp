@@ -33,7 +33,12 @@
  */
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -46,16 +51,29 @@
 #include "nav_2d_utils/conversions.hpp"
 #include "nav_2d_utils/parameters.hpp"
 #include "nav_2d_utils/tf_help.hpp"
+#include "nav2_util/execution_timer.hpp"
 #include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/tracing.hpp"
 #include "pluginlib/class_list_macros.hpp"
 
 namespace dwb_core
 {
 
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
 DWBLocalPlanner::DWBLocalPlanner(
   nav2_util::LifecycleNode::SharedPtr node, TFBufferPtr tf,
   CostmapROSPtr costmap_ros)
-: node_(node),
+: cycle_time_(nav2_util::MetricsRegistry::global().histogram("dwb.compute_velocity_commands",
+    "DWB local planner cycle")),
+  trajectory_count_(nav2_util::MetricsRegistry::global().counter("dwb.trajectories",
+    "Trajectories DWB generated and scored")),
+  compensated_latency_(nav2_util::MetricsRegistry::global().gauge("dwb.compensated_latency",
+    "Seconds DWB predicted the robot pose forward by")),
+  node_(node),
   tf_(tf),
   costmap_ros_(costmap_ros),
   traj_gen_loader_("dwb_core", "dwb_core::TrajectoryGenerator"),
@@ -65,6 +83,7 @@ DWBLocalPlanner::DWBLocalPlanner(
   node_->declare_parameter("critics");
   node_->declare_parameter("prune_plan", rclcpp::ParameterValue(true));
   node_->declare_parameter("prune_distance", rclcpp::ParameterValue(1.0));
+  node_->declare_parameter("incremental_plan_transform", rclcpp::ParameterValue(false));
   node_->declare_parameter("debug_trajectory_details", rclcpp::ParameterValue(false));
   node_->declare_parameter("trajectory_generator_name",
     rclcpp::ParameterValue(std::string("dwb_plugins::StandardTrajectoryGenerator")));
@@ -72,6 +91,15 @@ DWBLocalPlanner::DWBLocalPlanner(
     rclcpp::ParameterValue(std::string("dwb_plugins::SimpleGoalChecker")));
   node_->declare_parameter("use_dwa", rclcpp::ParameterValue(false));
   node_->declare_parameter("transform_tolerance", rclcpp::ParameterValue(0.1));
+  node_->declare_parameter("scoring_threads", rclcpp::ParameterValue(1));
+  node_->declare_parameter("adaptive_critic_order", rclcpp::ParameterValue(false));
+  node_->declare_parameter("batch_scoring", rclcpp::ParameterValue(false));
+  node_->declare_parameter("coarse_to_fine", rclcpp::ParameterValue(false));
+  node_->declare_parameter("refine_top_k", rclcpp::ParameterValue(3));
+  node_->declare_parameter("refine_levels", rclcpp::ParameterValue(2));
+  node_->declare_parameter("latency_compensation", rclcpp::ParameterValue(false));
+  node_->declare_parameter("command_delay", rclcpp::ParameterValue(0.0));
+  node_->declare_parameter("max_latency_compensation", rclcpp::ParameterValue(0.25));
 }
 
 nav2_util::CallbackReturn
@@ -87,10 +115,32 @@ DWBLocalPlanner::on_configure(const rclcpp_lifecycle::State & state)
 
   node_->get_parameter("prune_plan", prune_plan_);
   node_->get_parameter("prune_distance", prune_distance_);
+  node_->get_parameter("incremental_plan_transform", incremental_plan_transform_);
   node_->get_parameter("debug_trajectory_details", debug_trajectory_details_);
+  node_->get_parameter("adaptive_critic_order", adaptive_critic_order_);
+  node_->get_parameter("batch_scoring", batch_scoring_);
+  node_->get_parameter("coarse_to_fine", coarse_to_fine_);
+  node_->get_parameter("refine_top_k", refine_top_k_);
+  node_->get_parameter("refine_levels", refine_levels_);
+  refine_top_k_ = std::max(1, refine_top_k_);
+  refine_levels_ = std::max(0, refine_levels_);
+  has_last_best_ = false;
+  node_->get_parameter("latency_compensation", latency_compensation_);
+  node_->get_parameter("command_delay", command_delay_);
+  node_->get_parameter("max_latency_compensation", max_latency_compensation_);
   node_->get_parameter("trajectory_generator_name", traj_generator_name);
   node_->get_parameter("goal_checker_name", goal_checker_name);
 
+  // Scoring in parallel needs the trajectory generator and every critic to be safe to call
+  // from several threads at once, so it stays off unless asked for
+  int scoring_threads;
+  node_->get_parameter("scoring_threads", scoring_threads);
+  if (scoring_threads > 1) {
+    scoring_pool_ = std::make_unique<nav2_costmap_2d::WorkerPool>(scoring_threads);
+  } else {
+    scoring_pool_.reset();
+  }
+
   pub_ = std::make_unique<DWBPublisher>(node_);
   pub_->on_configure(state);
 
@@ -101,12 +151,19 @@ DWBLocalPlanner::on_configure(const rclcpp_lifecycle::State & state)
   goal_checker_->initialize(node_);
 
   try {
+    nav2_util::ExecutionTimer timer;
+    timer.start();
     loadCritics();
+    timer.end();
+    node_->record_startup_phase("loading critics", timer);
   } catch (const std::exception & e) {
     RCLCPP_ERROR(node_->get_logger(), "Couldn't load critics! Caught exception: %s", e.what());
     return nav2_util::CallbackReturn::FAILURE;
   }
 
+  profiling_ = pub_->shouldRecordProfile();
+  profiler_.initialize(critics_);
+
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
@@ -133,6 +190,7 @@ DWBLocalPlanner::on_cleanup(const rclcpp_lifecycle::State & state)
 
   traj_generator_.reset();
   goal_checker_.reset();
+  scoring_pool_.reset();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -190,6 +248,58 @@ DWBLocalPlanner::loadCritics()
     }
     RCLCPP_INFO(node_->get_logger(), "Critic plugin initialized");
   }
+
+  critic_stats_.assign(critics_.size(), CriticStats());
+  batched_critics_.assign(critics_.size(), false);
+  for (size_t i = 0; i < critics_.size(); ++i) {
+    batched_critics_[i] = batch_scoring_ && !scoring_pool_ && critics_[i]->hasBatchScoring();
+  }
+  critic_order_.resize(critics_.size());
+  for (size_t i = 0; i < critic_order_.size(); ++i) {
+    critic_order_[i] = i;
+  }
+}
+
+std::vector<std::string>
+DWBLocalPlanner::getCriticNames() const
+{
+  std::vector<std::string> names;
+  for (const auto & critic : critics_) {
+    names.push_back(critic->getName());
+  }
+  return names;
+}
+
+void
+DWBLocalPlanner::updateCriticScales()
+{
+  for (auto & critic : critics_) {
+    // The raw scale, which getScale may adjust, e.g. for the costmap resolution
+    double scale;
+    if (node_->get_parameter(critic->getName() + ".scale", scale)) {
+      critic->setScale(scale);
+    }
+  }
+}
+
+void
+DWBLocalPlanner::updateCriticOrder()
+{
+  // A trajectory costs least to reject when the critics run in increasing order of their
+  // time per call over the rate at which they reject. Critics not measured yet go first.
+  std::vector<double> keys(critics_.size(), 0.0);
+  for (size_t i = 0; i < critics_.size(); ++i) {
+    CriticStats & stats = critic_stats_[i];
+    if (stats.calls > 0.0) {
+      keys[i] = stats.seconds / (stats.rejections + 1e-3 * stats.calls);
+    }
+    // halve the history so the order follows changes in the scene
+    stats.seconds *= 0.5;
+    stats.calls *= 0.5;
+    stats.rejections *= 0.5;
+  }
+  std::stable_sort(critic_order_.begin(), critic_order_.end(),
+    [&keys](size_t a, size_t b) {return keys[a] < keys[b];});
 }
 
 void
@@ -259,13 +369,24 @@ DWBLocalPlanner::isGoalReached(
 
 void
 DWBLocalPlanner::setPlan(const nav_2d_msgs::msg::Path2D & path)
+{
+  setPlan(nav_2d_msgs::msg::Path2D(path));
+}
+
+void
+DWBLocalPlanner::setPlan(nav_2d_msgs::msg::Path2D && path)
 {
   for (TrajectoryCritic::Ptr critic : critics_) {
     critic->reset();
   }
 
   pub_->publishGlobalPlan(path);
-  global_plan_ = path;
+  global_plan_ = std::move(path);
+  plan_start_index_ = 0;
+  cached_plan_.poses.clear();
+  if (incremental_plan_transform_) {
+    plan_cache_.setPath(global_plan_);
+  }
 }
 
 nav_2d_msgs::msg::Twist2DStamped
@@ -273,21 +394,70 @@ DWBLocalPlanner::computeVelocityCommands(
   const nav_2d_msgs::msg::Pose2DStamped & pose,
   const nav_2d_msgs::msg::Twist2D & velocity)
 {
+  nav2_util::ScopedTimer timer(cycle_time_);
+  NAV2_TRACEPOINT(dwb_compute_start);
   std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> results = nullptr;
   if (pub_->shouldRecordEvaluation()) {
     results = std::make_shared<dwb_msgs::msg::LocalPlanEvaluation>();
   }
 
   try {
-    nav_2d_msgs::msg::Twist2DStamped cmd_vel = computeVelocityCommands(pose, velocity, results);
+    nav_2d_msgs::msg::Twist2DStamped cmd_vel;
+    if (latency_compensation_) {
+      cmd_vel = computeVelocityCommands(compensateLatency(pose, velocity), velocity, results);
+    } else {
+      cmd_vel = computeVelocityCommands(pose, velocity, results);
+    }
     pub_->publishEvaluation(results);
+    NAV2_TRACEPOINT1(dwb_compute_end, 1);
     return cmd_vel;
   } catch (const nav_core2::PlannerException & e) {
     pub_->publishEvaluation(results);
+    NAV2_TRACEPOINT1(dwb_compute_end, 0);
     throw;
   }
 }
 
+nav_2d_msgs::msg::Pose2DStamped
+DWBLocalPlanner::compensateLatency(
+  const nav_2d_msgs::msg::Pose2DStamped & pose,
+  const nav_2d_msgs::msg::Twist2D & velocity)
+{
+  // the pose is as old as its transform, and the command acts command_delay_ from now
+  double latency = (node_->now() - rclcpp::Time(pose.header.stamp)).seconds() + command_delay_;
+  latency = std::min(std::max(latency, 0.0), max_latency_compensation_);
+  compensated_latency_.set(latency);
+
+  nav_2d_msgs::msg::Pose2DStamped predicted = pose;
+  predicted.pose = predictPose(pose.pose, velocity, latency);
+  return predicted;
+}
+
+geometry_msgs::msg::Pose2D
+DWBLocalPlanner::predictPose(
+  const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & velocity,
+  double dt)
+{
+  // the arc a constant twist drives, in the robot's frame, then turned into the pose's
+  double forward, left;
+  const double turn = velocity.theta * dt;
+  if (std::fabs(turn) < 1e-9) {
+    forward = velocity.x * dt;
+    left = velocity.y * dt;
+  } else {
+    const double s = std::sin(turn), c = std::cos(turn);
+    forward = (velocity.x * s + velocity.y * (c - 1.0)) / velocity.theta;
+    left = (velocity.x * (1.0 - c) + velocity.y * s) / velocity.theta;
+  }
+
+  geometry_msgs::msg::Pose2D predicted;
+  const double sin_theta = std::sin(pose.theta), cos_theta = std::cos(pose.theta);
+  predicted.x = pose.x + forward * cos_theta - left * sin_theta;
+  predicted.y = pose.y + forward * sin_theta + left * cos_theta;
+  predicted.theta = pose.theta + turn;
+  return predicted;
+}
+
 void
 DWBLocalPlanner::prepareGlobalPlan(
   const nav_2d_msgs::msg::Pose2DStamped & pose, nav_2d_msgs::msg::Path2D & transformed_plan,
@@ -318,12 +488,20 @@ DWBLocalPlanner::computeVelocityCommands(
   nav_2d_msgs::msg::Path2D transformed_plan;
   nav_2d_msgs::msg::Pose2DStamped goal_pose;
 
+  auto prepare_start = std::chrono::steady_clock::now();
   prepareGlobalPlan(pose, transformed_plan, goal_pose);
 
-  for (TrajectoryCritic::Ptr critic : critics_) {
-    if (critic->prepare(pose.pose, velocity, goal_pose.pose, transformed_plan) == false) {
+  for (size_t i = 0; i < critics_.size(); ++i) {
+    auto critic_start = std::chrono::steady_clock::now();
+    if (critics_[i]->prepare(pose.pose, velocity, goal_pose.pose, transformed_plan) == false) {
       RCLCPP_WARN(rclcpp::get_logger("DWBLocalPlanner"), "A scoring function failed to prepare");
     }
+    if (profiling_) {
+      profiler_.addCritic(PlannerProfiler::PREPARE, i, secondsSince(critic_start));
+    }
+  }
+  if (profiling_) {
+    profiler_.addStage(PlannerProfiler::PREPARE, secondsSince(prepare_start));
   }
 
   try {
@@ -335,9 +513,7 @@ DWBLocalPlanner::computeVelocityCommands(
     cmd_vel.velocity = best.traj.velocity;
 
     // debrief stateful scoring functions
-    for (TrajectoryCritic::Ptr critic : critics_) {
-      critic->debrief(cmd_vel.velocity);
-    }
+    debriefCritics(cmd_vel.velocity);
 
     pub_->publishLocalPlan(pose.header, best.traj);
     pub_->publishCostGrid(costmap_ros_, critics_);
@@ -347,9 +523,7 @@ DWBLocalPlanner::computeVelocityCommands(
     nav_2d_msgs::msg::Twist2D empty_cmd;
     dwb_msgs::msg::Trajectory2D empty_traj;
     // debrief stateful scoring functions
-    for (TrajectoryCritic::Ptr critic : critics_) {
-      critic->debrief(empty_cmd);
-    }
+    debriefCritics(empty_cmd);
     pub_->publishLocalPlan(pose.header, empty_traj);
     pub_->publishCostGrid(costmap_ros_, critics_);
 
@@ -357,26 +531,56 @@ DWBLocalPlanner::computeVelocityCommands(
   }
 }
 
+void
+DWBLocalPlanner::debriefCritics(const nav_2d_msgs::msg::Twist2D & cmd_vel)
+{
+  auto debrief_start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < critics_.size(); ++i) {
+    auto critic_start = std::chrono::steady_clock::now();
+    critics_[i]->debrief(cmd_vel);
+    if (profiling_) {
+      profiler_.addCritic(PlannerProfiler::DEBRIEF, i, secondsSince(critic_start));
+    }
+  }
+
+  if (profiling_) {
+    profiler_.addStage(PlannerProfiler::DEBRIEF, secondsSince(debrief_start));
+    profiler_.endCycle();
+    if (profiler_.cycles() >= pub_->getProfileCycles()) {
+      dwb_msgs::msg::PlannerProfile profile = profiler_.takeProfile();
+      profile.header.stamp = node_->now();
+      pub_->publishProfile(profile);
+    }
+  }
+}
+
+/**
+ * @brief A twist to the micro unit, to tell twists sampled twice by different grids apart
+ */
+static std::array<int64_t, 3> twistKey(const nav_2d_msgs::msg::Twist2D & twist)
+{
+  return {{std::llround(twist.x * 1e6), std::llround(twist.y * 1e6),
+    std::llround(twist.theta * 1e6)}};
+}
+
 dwb_msgs::msg::TrajectoryScore
 DWBLocalPlanner::coreScoringAlgorithm(
   const geometry_msgs::msg::Pose2D & pose,
   const nav_2d_msgs::msg::Twist2D velocity,
   std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results)
 {
-  nav_2d_msgs::msg::Twist2D twist;
-  dwb_msgs::msg::Trajectory2D traj;
   dwb_msgs::msg::TrajectoryScore best, worst;
   best.total = -1;
   worst.total = -1;
   IllegalTrajectoryTracker tracker;
+  uint64_t trajectories = 0;
 
-  traj_generator_->startNewIteration(velocity);
-  while (traj_generator_->hasMoreTwists()) {
-    twist = traj_generator_->nextTwist();
-    traj = traj_generator_->generateTrajectory(pose, velocity, twist);
+  if (adaptive_critic_order_ && !scoring_pool_) {
+    updateCriticOrder();
+  }
 
-    try {
-      dwb_msgs::msg::TrajectoryScore score = scoreTrajectory(traj, best.total);
+  auto add_legal = [&](const dwb_msgs::msg::TrajectoryScore & score) {
+      ++trajectories;
       tracker.addLegalTrajectory();
       if (results) {
         results->twists.push_back(score);
@@ -393,7 +597,10 @@ DWBLocalPlanner::coreScoringAlgorithm(
           results->worst_index = results->twists.size() - 1;
         }
       }
-    } catch (const nav_core2::IllegalTrajectoryException & e) {
+    };
+  auto add_illegal = [&](const dwb_msgs::msg::Trajectory2D & traj,
+      const nav_core2::IllegalTrajectoryException & e) {
+      ++trajectories;
       if (results) {
         dwb_msgs::msg::TrajectoryScore failed_score;
         failed_score.traj = traj;
@@ -406,9 +613,212 @@ DWBLocalPlanner::coreScoringAlgorithm(
         results->twists.push_back(failed_score);
       }
       tracker.addIllegalTrajectory(e);
+    };
+
+  if (coarse_to_fine_) {
+    // A coarse grid, with last cycle's best twist and its neighbors, then grids half as fine
+    // again at each level around the best few found so far. Each twist is scored in full,
+    // as the candidates are ranked by their totals, and only once however often it comes up.
+    double generation_time = 0.0, scoring_time = 0.0;
+    std::chrono::steady_clock::time_point start;
+    std::set<std::array<int64_t, 3>> tried;
+    std::vector<dwb_msgs::msg::TrajectoryScore> candidates;
+    auto evaluate = [&](const std::vector<nav_2d_msgs::msg::Twist2D> & twists) {
+        for (const auto & twist : twists) {
+          if (!tried.insert(twistKey(twist)).second) {
+            continue;
+          }
+          if (profiling_) {
+            start = std::chrono::steady_clock::now();
+          }
+          dwb_msgs::msg::Trajectory2D traj =
+            traj_generator_->generateTrajectory(pose, velocity, twist);
+          if (profiling_) {
+            generation_time += secondsSince(start);
+            start = std::chrono::steady_clock::now();
+          }
+          try {
+            dwb_msgs::msg::TrajectoryScore score = scoreTrajectory(traj, -1.0);
+            add_legal(score);
+            auto rank = std::upper_bound(candidates.begin(), candidates.end(), score.total,
+                [](double total, const dwb_msgs::msg::TrajectoryScore & candidate) {
+                  return total < candidate.total;
+                });
+            if (rank - candidates.begin() < refine_top_k_) {
+              candidates.insert(rank, score);
+              if (static_cast<int>(candidates.size()) > refine_top_k_) {
+                candidates.pop_back();
+              }
+            }
+          } catch (const nav_core2::IllegalTrajectoryException & e) {
+            add_illegal(traj, e);
+          }
+          if (profiling_) {
+            scoring_time += secondsSince(start);
+          }
+        }
+      };
+
+    double finest = std::pow(0.5, refine_levels_);
+    evaluate(traj_generator_->getCoarseTwists(velocity));
+    if (has_last_best_) {
+      evaluate(traj_generator_->getTwistsAround(velocity, last_best_twist_, finest));
+    }
+    double fraction = 1.0;
+    for (int level = 0; level < refine_levels_ && !candidates.empty(); ++level) {
+      fraction *= 0.5;
+      std::vector<nav_2d_msgs::msg::Twist2D> finer;
+      for (const auto & candidate : candidates) {
+        auto around = traj_generator_->getTwistsAround(velocity, candidate.traj.velocity,
+            fraction);
+        finer.insert(finer.end(), around.begin(), around.end());
+      }
+      evaluate(finer);
+    }
+    if (profiling_) {
+      profiler_.addStage(PlannerProfiler::GENERATION, generation_time);
+      profiler_.addStage(PlannerProfiler::SCORING, scoring_time);
+    }
+  } else if (scoring_pool_) {
+    // Every twist is generated and scored on the pool without the early exit on the best
+    // score so far, then the results are reduced in sample order, which picks the same
+    // best trajectory as the serial loop whatever order the jobs finish in.
+    std::vector<nav_2d_msgs::msg::Twist2D> twists = traj_generator_->getTwists(velocity);
+    std::vector<dwb_msgs::msg::TrajectoryScore> scores(twists.size());
+    std::vector<std::unique_ptr<nav_core2::IllegalTrajectoryException>> errors(twists.size());
+
+    auto scoring_start = std::chrono::steady_clock::now();
+    scoring_pool_->run([&](int i) {
+        scores[i].traj = traj_generator_->generateTrajectory(pose, velocity, twists[i]);
+        try {
+          scores[i] = scoreTrajectory(scores[i].traj, -1.0);
+        } catch (const nav_core2::IllegalTrajectoryException & e) {
+          errors[i] = std::make_unique<nav_core2::IllegalTrajectoryException>(e);
+        }
+      }, static_cast<int>(twists.size()));
+    if (profiling_) {
+      profiler_.addStage(PlannerProfiler::SCORING, secondsSince(scoring_start));
+    }
+
+    for (size_t i = 0; i < twists.size(); ++i) {
+      if (errors[i]) {
+        add_illegal(scores[i].traj, *errors[i]);
+      } else {
+        add_legal(scores[i]);
+      }
+    }
+  } else if (batch_scoring_) {
+    // The critics with batch scoring run column-wise over every trajectory first, then
+    // the rest score each trajectory as usual, cut short by the best score so far.
+    std::chrono::steady_clock::time_point start;
+    if (profiling_) {
+      start = std::chrono::steady_clock::now();
+    }
+    std::vector<nav_2d_msgs::msg::Twist2D> twists = traj_generator_->getTwists(velocity);
+    std::vector<dwb_msgs::msg::Trajectory2D> trajs(twists.size());
+    for (size_t i = 0; i < twists.size(); ++i) {
+      trajs[i] = traj_generator_->generateTrajectory(pose, velocity, twists[i]);
+    }
+    if (profiling_) {
+      profiler_.addStage(PlannerProfiler::GENERATION, secondsSince(start));
+      start = std::chrono::steady_clock::now();
+    }
+
+    std::vector<dwb_msgs::msg::TrajectoryScore> scores(trajs.size());
+    std::vector<std::unique_ptr<nav_core2::IllegalTrajectoryException>> errors(trajs.size());
+    std::vector<double> raw_scores;
+    std::vector<std::string> reasons;
+    for (size_t index = 0; index < critics_.size(); ++index) {
+      if (!batched_critics_[index]) {
+        continue;
+      }
+      TrajectoryCritic::Ptr & critic = critics_[index];
+      dwb_msgs::msg::CriticScore cs;
+      cs.name = critic->getName();
+      cs.scale = critic->getScale();
+      if (cs.scale == 0.0) {
+        for (dwb_msgs::msg::TrajectoryScore & score : scores) {
+          score.scores.push_back(cs);
+        }
+        continue;
+      }
+
+      std::chrono::steady_clock::time_point critic_start;
+      if (profiling_) {
+        critic_start = std::chrono::steady_clock::now();
+      }
+      critic->scoreTrajectories(trajs, raw_scores, reasons);
+      for (size_t i = 0; i < trajs.size(); ++i) {
+        if (errors[i]) {
+          continue;
+        }
+        if (raw_scores[i] < 0.0) {
+          errors[i] = std::make_unique<nav_core2::IllegalTrajectoryException>(cs.name, reasons[i]);
+          if (profiling_) {
+            profiler_.addIllegal(index);
+          }
+          continue;
+        }
+        cs.raw_score = raw_scores[i];
+        scores[i].scores.push_back(cs);
+        scores[i].total += raw_scores[i] * cs.scale;
+      }
+      if (profiling_) {
+        profiler_.addCritic(PlannerProfiler::SCORING, index, secondsSince(critic_start));
+      }
+    }
+
+    for (size_t i = 0; i < trajs.size(); ++i) {
+      if (errors[i]) {
+        add_illegal(trajs[i], *errors[i]);
+        continue;
+      }
+      scores[i].traj = std::move(trajs[i]);
+      try {
+        scoreCritics(scores[i], best.total);
+        add_legal(scores[i]);
+      } catch (const nav_core2::IllegalTrajectoryException & e) {
+        add_illegal(scores[i].traj, e);
+      }
+    }
+    if (profiling_) {
+      profiler_.addStage(PlannerProfiler::SCORING, secondsSince(start));
+    }
+  } else {
+    double generation_time = 0.0, scoring_time = 0.0;
+    std::chrono::steady_clock::time_point start;
+    traj_generator_->startNewIteration(velocity);
+    while (traj_generator_->hasMoreTwists()) {
+      if (profiling_) {
+        start = std::chrono::steady_clock::now();
+      }
+      nav_2d_msgs::msg::Twist2D twist = traj_generator_->nextTwist();
+      dwb_msgs::msg::Trajectory2D traj =
+        traj_generator_->generateTrajectory(pose, velocity, twist);
+      if (profiling_) {
+        generation_time += secondsSince(start);
+        start = std::chrono::steady_clock::now();
+      }
+
+      try {
+        add_legal(scoreTrajectory(traj, best.total));
+      } catch (const nav_core2::IllegalTrajectoryException & e) {
+        add_illegal(traj, e);
+      }
+      if (profiling_) {
+        scoring_time += secondsSince(start);
+      }
+    }
+    if (profiling_) {
+      profiler_.addStage(PlannerProfiler::GENERATION, generation_time);
+      profiler_.addStage(PlannerProfiler::SCORING, scoring_time);
     }
   }
 
+  trajectory_count_.increment(trajectories);
+
+  has_last_best_ = best.total >= 0;
+  last_best_twist_ = best.traj.velocity;
   if (best.total < 0) {
     if (debug_trajectory_details_) {
       RCLCPP_ERROR(rclcpp::get_logger("DWBLocalPlanner"), "%s", tracker.getMessage().c_str());
@@ -431,8 +841,41 @@ DWBLocalPlanner::scoreTrajectory(
 {
   dwb_msgs::msg::TrajectoryScore score;
   score.traj = traj;
+  scoreCritics(score, best_score);
+  return score;
+}
 
-  for (TrajectoryCritic::Ptr critic : critics_) {
+void
+DWBLocalPlanner::scoreCritics(dwb_msgs::msg::TrajectoryScore & score, double best_score)
+{
+  const dwb_msgs::msg::Trajectory2D & traj = score.traj;
+
+  // the statistics are only kept when scoring serially, the pool never cuts scoring short
+  bool measure = (adaptive_critic_order_ || profiling_) && !scoring_pool_;
+  auto record = [this](size_t index, std::chrono::steady_clock::time_point start,
+      bool beaten, bool illegal) {
+      double seconds = secondsSince(start);
+      if (adaptive_critic_order_) {
+        CriticStats & stats = critic_stats_[index];
+        stats.seconds += seconds;
+        stats.calls += 1.0;
+        stats.rejections += beaten || illegal ? 1.0 : 0.0;
+      }
+      if (profiling_) {
+        profiler_.addCritic(PlannerProfiler::SCORING, index, seconds);
+        if (illegal) {
+          profiler_.addIllegal(index);
+        } else if (beaten) {
+          profiler_.addShortCircuit(index);
+        }
+      }
+    };
+
+  for (size_t index : critic_order_) {
+    if (batched_critics_[index]) {
+      continue;
+    }
+    TrajectoryCritic::Ptr & critic = critics_[index];
     dwb_msgs::msg::CriticScore cs;
     cs.name = critic->getName();
     cs.scale = critic->getScale();
@@ -442,17 +885,38 @@ DWBLocalPlanner::scoreTrajectory(
       continue;
     }
 
-    double critic_score = critic->scoreTrajectory(traj);
+    // the raw score past which this critic alone makes the trajectory worse than the best
+    double raw_limit = -1.0;
+    if (best_score > 0 && cs.scale > 0.0) {
+      raw_limit = (best_score - score.total) / cs.scale;
+    }
+
+    std::chrono::steady_clock::time_point start;
+    if (measure) {
+      start = std::chrono::steady_clock::now();
+    }
+    double critic_score;
+    try {
+      critic_score = critic->scoreTrajectoryBounded(traj, raw_limit);
+    } catch (const nav_core2::IllegalTrajectoryException &) {
+      if (measure) {
+        record(index, start, false, true);
+      }
+      throw;
+    }
     cs.raw_score = critic_score;
     score.scores.push_back(cs);
     score.total += critic_score * cs.scale;
-    if (best_score > 0 && score.total > best_score) {
-      // since we keep adding positives, once we are worse than the best, we will stay worse
+
+    // since we keep adding positives, once we are worse than the best, we will stay worse
+    bool beaten = best_score > 0 && score.total > best_score;
+    if (measure) {
+      record(index, start, beaten, false);
+    }
+    if (beaten) {
       break;
     }
   }
-
-  return score;
 }
 
 double
@@ -519,6 +983,11 @@ DWBLocalPlanner::transformGlobalPlan(
     sq_transform_end_threshold = sq_dist_threshold;
   }
 
+  if (incremental_plan_transform_) {
+    return transformPlanWindow(pose, robot_pose.pose, sq_transform_start_threshold,
+             sq_transform_end_threshold, 2.0 * dist_threshold);
+  }
+
   // Find the first pose in the plan that's less than sq_transform_start_threshold
   // from the robot.
   auto transformation_begin = std::find_if(
@@ -569,6 +1038,94 @@ DWBLocalPlanner::transformGlobalPlan(
   return transformed_plan;
 }
 
+nav_2d_msgs::msg::Path2D
+DWBLocalPlanner::transformPlanWindow(
+  const nav_2d_msgs::msg::Pose2DStamped & pose, const geometry_msgs::msg::Pose2D & robot_pose,
+  double sq_transform_start_threshold, double sq_transform_end_threshold,
+  double search_distance)
+{
+  const std::vector<geometry_msgs::msg::Pose2D> & poses = global_plan_.poses;
+  auto near_robot = [&](size_t index) {
+      return getSquareDistance(robot_pose, poses[index]) < sq_transform_start_threshold;
+    };
+
+  // Look for the robot along the path ahead of where it was last cycle, and only
+  // search the rest of the plan if it is not within search_distance of there.
+  size_t transformation_begin = plan_start_index_;
+  double searched_distance = 0.0;
+  while (transformation_begin < poses.size() && !near_robot(transformation_begin) &&
+    searched_distance <= search_distance)
+  {
+    if (transformation_begin + 1 < poses.size()) {
+      searched_distance += std::hypot(
+        poses[transformation_begin + 1].x - poses[transformation_begin].x,
+        poses[transformation_begin + 1].y - poses[transformation_begin].y);
+    }
+    ++transformation_begin;
+  }
+  if (transformation_begin < poses.size() && !near_robot(transformation_begin)) {
+    transformation_begin = plan_cache_.firstCloserThan(robot_pose, sq_transform_start_threshold,
+        transformation_begin);
+  }
+
+  size_t transformation_end = transformation_begin;
+  while (transformation_end < poses.size() &&
+    getSquareDistance(robot_pose, poses[transformation_end]) <= sq_transform_end_threshold)
+  {
+    ++transformation_end;
+  }
+
+  if (transformation_begin == transformation_end) {
+    throw nav_core2::PlannerException("Resulting plan has 0 poses in it.");
+  }
+
+  // Every pose is transformed at the latest time, so one lookup serves the whole window
+  geometry_msgs::msg::TransformStamped transform;
+  try {
+    transform = tf_->lookupTransform(costmap_ros_->getGlobalFrameID(),
+        global_plan_.header.frame_id, tf2::TimePointZero);
+  } catch (tf2::TransformException & ex) {
+    throw nav_core2::PlannerTFException("Unable to transform the global plan into the costmap's "
+            "frame: " + std::string(ex.what()));
+  }
+
+  const geometry_msgs::msg::Vector3 & t = transform.transform.translation;
+  const geometry_msgs::msg::Quaternion & q = transform.transform.rotation;
+  const geometry_msgs::msg::Vector3 & cached_t = cached_transform_.transform.translation;
+  const geometry_msgs::msg::Quaternion & cached_q = cached_transform_.transform.rotation;
+  bool same_transform = t.x == cached_t.x && t.y == cached_t.y && t.z == cached_t.z &&
+    q.x == cached_q.x && q.y == cached_q.y && q.z == cached_q.z && q.w == cached_q.w;
+
+  if (cached_plan_.poses.empty() || !same_transform || transformation_begin != cached_begin_ ||
+    transformation_end != cached_end_)
+  {
+    cached_plan_.header.frame_id = costmap_ros_->getGlobalFrameID();
+    cached_plan_.poses.resize(transformation_end - transformation_begin);
+    geometry_msgs::msg::PoseStamped global_pose, local_pose;
+    for (size_t i = transformation_begin; i < transformation_end; ++i) {
+      global_pose.pose = nav_2d_utils::pose2DToPose(poses[i]);
+      tf2::doTransform(global_pose, local_pose, transform);
+      cached_plan_.poses[i - transformation_begin] = nav_2d_utils::poseToPose2D(local_pose.pose);
+    }
+    cached_transform_ = transform;
+    cached_begin_ = transformation_begin;
+    cached_end_ = transformation_end;
+  }
+  cached_plan_.header.stamp = pose.header.stamp;
+
+  // The passed poses are skipped by starting the next search later rather than erased,
+  // which would move the rest of the plan every cycle
+  if (prune_plan_ && transformation_begin > plan_start_index_) {
+    nav_2d_msgs::msg::Path2D remaining_plan;
+    remaining_plan.header = global_plan_.header;
+    remaining_plan.poses.assign(poses.begin() + transformation_begin, poses.end());
+    pub_->publishGlobalPlan(remaining_plan);
+  }
+  plan_start_index_ = transformation_begin;
+
+  return cached_plan_;
+}
+
 }  // namespace dwb_core
 
 // Register this planner as a LocalPlanner plugin
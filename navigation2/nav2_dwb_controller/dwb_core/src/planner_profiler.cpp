@@ -0,0 +1,114 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Locus Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "dwb_core/planner_profiler.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace dwb_core
+{
+
+void TimingSamples::take(dwb_msgs::msg::TimingStats & stats)
+{
+  stats.count = samples_.size();
+  stats.mean_us = stats.p99_us = stats.max_us = 0.0;
+  if (samples_.empty()) {
+    return;
+  }
+
+  double sum = 0.0;
+  for (float sample : samples_) {
+    sum += sample;
+  }
+  stats.mean_us = sum / samples_.size();
+
+  auto p99 = samples_.begin() + (samples_.size() - 1) * 99 / 100;
+  std::nth_element(samples_.begin(), p99, samples_.end());
+  stats.p99_us = *p99;
+  stats.max_us = *std::max_element(p99, samples_.end());
+  samples_.clear();
+}
+
+static const char * const STAGE_NAMES[] = {"prepare", "generation", "scoring", "debrief"};
+
+void PlannerProfiler::initialize(const std::vector<TrajectoryCritic::Ptr> & critics)
+{
+  nav2_util::MetricsRegistry & registry = nav2_util::MetricsRegistry::global();
+  for (int stage = PREPARE; stage <= DEBRIEF; ++stage) {
+    stage_histograms_[stage] = &registry.histogram(std::string("dwb.") + STAGE_NAMES[stage],
+        "DWB local planner stage");
+  }
+
+  cycles_ = 0;
+  for (TimingSamples & stage : stages_) {
+    dwb_msgs::msg::TimingStats discarded;
+    stage.take(discarded);
+  }
+  critics_.clear();
+  critics_.resize(critics.size());
+  for (size_t i = 0; i < critics.size(); ++i) {
+    critics_[i].name = critics[i]->getName();
+    for (int stage = PREPARE; stage <= DEBRIEF; ++stage) {
+      critics_[i].histograms[stage] = &registry.histogram(
+        "dwb.critic." + critics_[i].name + "." + STAGE_NAMES[stage], "DWB critic stage");
+    }
+  }
+}
+
+dwb_msgs::msg::PlannerProfile PlannerProfiler::takeProfile()
+{
+  dwb_msgs::msg::PlannerProfile profile;
+  profile.cycles = cycles_;
+  stages_[PREPARE].take(profile.prepare);
+  stages_[GENERATION].take(profile.generation);
+  stages_[SCORING].take(profile.scoring);
+  stages_[DEBRIEF].take(profile.debrief);
+
+  for (CriticSamples & samples : critics_) {
+    dwb_msgs::msg::CriticProfile critic;
+    critic.name = samples.name;
+    samples.stages[PREPARE].take(critic.prepare);
+    samples.stages[SCORING].take(critic.scoring);
+    samples.stages[DEBRIEF].take(critic.debrief);
+    critic.short_circuits = samples.short_circuits;
+    critic.illegal = samples.illegal;
+    samples.short_circuits = samples.illegal = 0;
+    profile.critics.push_back(critic);
+  }
+  cycles_ = 0;
+  return profile;
+}
+
+}  // namespace dwb_core
@@ -59,6 +59,15 @@ DWBPublisher::DWBPublisher(nav2_util::LifecycleNode::SharedPtr node)
   node_->declare_parameter("publish_local_plan", rclcpp::ParameterValue(true));
   node_->declare_parameter("publish_trajectories", rclcpp::ParameterValue(true));
   node_->declare_parameter("publish_cost_grid_pc", rclcpp::ParameterValue(false));
+  node_->declare_parameter("publish_profile", rclcpp::ParameterValue(false));
+  node_->declare_parameter("profile_cycles", rclcpp::ParameterValue(20));
+  node_->declare_parameter("debug_publish_rate", rclcpp::ParameterValue(0.0));
+  node_->declare_parameter("async_publishing", rclcpp::ParameterValue(false));
+}
+
+DWBPublisher::~DWBPublisher()
+{
+  stopPublishThread();
 }
 
 nav2_util::CallbackReturn
@@ -70,6 +79,14 @@ DWBPublisher::on_configure(const rclcpp_lifecycle::State & /*state*/)
   node_->get_parameter("publish_local_plan", publish_local_plan_);
   node_->get_parameter("publish_trajectories", publish_trajectories_);
   node_->get_parameter("publish_cost_grid_pc", publish_cost_grid_pc_);
+  node_->get_parameter("publish_profile", publish_profile_);
+  int profile_cycles;
+  node_->get_parameter("profile_cycles", profile_cycles);
+  profile_cycles_ = std::max(profile_cycles, 1);
+  double debug_publish_rate;
+  node_->get_parameter("debug_publish_rate", debug_publish_rate);
+  debug_publish_period_ = debug_publish_rate > 0.0 ? 1.0 / debug_publish_rate : 0.0;
+  node_->get_parameter("async_publishing", async_publishing_);
 
   eval_pub_ = node_->create_publisher<dwb_msgs::msg::LocalPlanEvaluation>("evaluation", 1);
   global_pub_ = node_->create_publisher<nav_msgs::msg::Path>("received_global_plan", 1);
@@ -77,9 +94,15 @@ DWBPublisher::on_configure(const rclcpp_lifecycle::State & /*state*/)
   local_pub_ = node_->create_publisher<nav_msgs::msg::Path>("local_plan", 1);
   marker_pub_ = node_->create_publisher<visualization_msgs::msg::MarkerArray>("marker", 1);
   cost_grid_pc_pub_ = node_->create_publisher<sensor_msgs::msg::PointCloud>("cost_cloud", 1);
+  profile_pub_ = node_->create_publisher<dwb_msgs::msg::PlannerProfile>("profile", 1);
 
   prev_marker_count_ = 0;
 
+  if (async_publishing_) {
+    stop_publishing_ = false;
+    publish_thread_ = std::thread(&DWBPublisher::publishLoop, this);
+  }
+
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
@@ -92,6 +115,7 @@ DWBPublisher::on_activate(const rclcpp_lifecycle::State & /*state*/)
   local_pub_->on_activate();
   marker_pub_->on_activate();
   cost_grid_pc_pub_->on_activate();
+  profile_pub_->on_activate();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -105,6 +129,7 @@ DWBPublisher::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
   local_pub_->on_deactivate();
   marker_pub_->on_deactivate();
   cost_grid_pc_pub_->on_deactivate();
+  profile_pub_->on_deactivate();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -112,20 +137,75 @@ DWBPublisher::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
 nav2_util::CallbackReturn
 DWBPublisher::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
 {
+  stopPublishThread();
+
   eval_pub_.reset();
   global_pub_.reset();
   transformed_pub_.reset();
   local_pub_.reset();
   marker_pub_.reset();
   cost_grid_pc_pub_.reset();
+  profile_pub_.reset();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
+void
+DWBPublisher::stopPublishThread()
+{
+  if (!publish_thread_.joinable()) {return;}
+  {
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    stop_publishing_ = true;
+  }
+  publish_cv_.notify_one();
+  publish_thread_.join();
+  pending_evaluation_.reset();
+  pending_cost_grid_.reset();
+}
+
+void
+DWBPublisher::publishLoop()
+{
+  std::unique_lock<std::mutex> lock(publish_mutex_);
+  while (true) {
+    publish_cv_.wait(lock, [this] {
+        return stop_publishing_ || pending_evaluation_ || pending_cost_grid_;
+      });
+    if (stop_publishing_) {return;}
+
+    std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> results = std::move(pending_evaluation_);
+    std::unique_ptr<sensor_msgs::msg::PointCloud> cost_grid_pc = std::move(pending_cost_grid_);
+    lock.unlock();
+
+    if (results) {
+      if (publish_evaluation_) {
+        eval_pub_->publish(*results);
+      }
+      publishTrajectories(*results);
+    }
+    if (cost_grid_pc) {
+      cost_grid_pc_pub_->publish(*cost_grid_pc);
+    }
+
+    lock.lock();
+  }
+}
+
 void
 DWBPublisher::publishEvaluation(std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> results)
 {
   if (results == nullptr) {return;}
+  last_evaluation_time_ = std::chrono::steady_clock::now();
+
+  if (async_publishing_) {
+    {
+      std::lock_guard<std::mutex> lock(publish_mutex_);
+      pending_evaluation_ = std::move(results);
+    }
+    publish_cv_.notify_one();
+    return;
+  }
 
   if (publish_evaluation_) {
     eval_pub_->publish(*results);
@@ -134,6 +214,14 @@ DWBPublisher::publishEvaluation(std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluati
   publishTrajectories(*results);
 }
 
+void
+DWBPublisher::publishProfile(const dwb_msgs::msg::PlannerProfile & profile)
+{
+  if (publish_profile_) {
+    profile_pub_->publish(profile);
+  }
+}
+
 void
 DWBPublisher::publishTrajectories(const dwb_msgs::msg::LocalPlanEvaluation & results)
 {
@@ -210,9 +298,13 @@ DWBPublisher::publishCostGrid(
   const CostmapROSPtr costmap_ros,
   const std::vector<TrajectoryCritic::Ptr> critics)
 {
-  if (!publish_cost_grid_pc_) {return;}
+  if (!publish_cost_grid_pc_ || !isDue(last_cost_grid_time_)) {return;}
+  last_cost_grid_time_ = std::chrono::steady_clock::now();
 
-  sensor_msgs::msg::PointCloud cost_grid_pc;
+  // the critics' grids change in the next cycle's prepare, so the cloud is always built here
+  // and only handed to the background thread for publishing
+  auto cost_grid_pc_ptr = std::make_unique<sensor_msgs::msg::PointCloud>();
+  sensor_msgs::msg::PointCloud & cost_grid_pc = *cost_grid_pc_ptr;
   cost_grid_pc.header.frame_id = costmap_ros->getGlobalFrameID();
   cost_grid_pc.header.stamp = node_->now();
 
@@ -252,30 +344,38 @@ DWBPublisher::publishCostGrid(
   // TODO(crdelsey): convert pc to pc2
   // sensor_msgs::msg::PointCloud2 cost_grid_pc2;
   // convertPointCloudToPointCloud2(cost_grid_pc, cost_grid_pc2);
+  if (async_publishing_) {
+    {
+      std::lock_guard<std::mutex> lock(publish_mutex_);
+      pending_cost_grid_ = std::move(cost_grid_pc_ptr);
+    }
+    publish_cv_.notify_one();
+    return;
+  }
   cost_grid_pc_pub_->publish(cost_grid_pc);
 }
 
 void
-DWBPublisher::publishGlobalPlan(const nav_2d_msgs::msg::Path2D plan)
+DWBPublisher::publishGlobalPlan(const nav_2d_msgs::msg::Path2D & plan)
 {
   publishGenericPlan(plan, *global_pub_, publish_global_plan_);
 }
 
 void
-DWBPublisher::publishTransformedPlan(const nav_2d_msgs::msg::Path2D plan)
+DWBPublisher::publishTransformedPlan(const nav_2d_msgs::msg::Path2D & plan)
 {
   publishGenericPlan(plan, *transformed_pub_, publish_transformed_);
 }
 
 void
-DWBPublisher::publishLocalPlan(const nav_2d_msgs::msg::Path2D plan)
+DWBPublisher::publishLocalPlan(const nav_2d_msgs::msg::Path2D & plan)
 {
   publishGenericPlan(plan, *local_pub_, publish_local_plan_);
 }
 
 void
 DWBPublisher::publishGenericPlan(
-  const nav_2d_msgs::msg::Path2D plan,
+  const nav_2d_msgs::msg::Path2D & plan,
   rclcpp::Publisher<nav_msgs::msg::Path> & pub, bool flag)
 {
   if (!flag) {return;}
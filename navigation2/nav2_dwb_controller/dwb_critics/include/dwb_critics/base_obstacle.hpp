@@ -35,6 +35,9 @@
 #ifndef DWB_CRITICS__BASE_OBSTACLE_HPP_
 #define DWB_CRITICS__BASE_OBSTACLE_HPP_
 
+#include <string>
+#include <vector>
+
 #include "dwb_core/trajectory_critic.hpp"
 
 namespace dwb_critics
@@ -46,7 +49,11 @@ namespace dwb_critics
  * This class can only be used to figure out if a circular robot is in collision. If the cell corresponding
  * with any of the poses in the Trajectory is an obstacle, inscribed obstacle or unknown, it will return a
  * negative cost. Otherwise it will return either the final pose's cost, or the sum of all poses, depending
- * on the sum_scores parameter.
+ * on the sum_scores parameter. When summing, scoring stops as soon as the partial sum passes the
+ * limit given to scoreTrajectoryBounded.
+ *
+ * A set of trajectories is scored in one batch, every pose converted to its cell by a single
+ * Costmap2D::worldToMapBatch call. Subclasses that override scorePose score one by one instead.
  *
  * Other classes (like ObstacleFootprintCritic) can do more advanced checking for collisions.
  */
@@ -55,6 +62,13 @@ class BaseObstacleCritic : public dwb_core::TrajectoryCritic
 public:
   void onInit() override;
   double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) override;
+  double scoreTrajectoryBounded(
+    const dwb_msgs::msg::Trajectory2D & traj,
+    double raw_limit) override;
+  void scoreTrajectories(
+    const std::vector<dwb_msgs::msg::Trajectory2D> & trajs,
+    std::vector<double> & scores, std::vector<std::string> & errors) override;
+  bool hasBatchScoring() const override {return true;}
   void addGridScores(sensor_msgs::msg::PointCloud & pc) override;
 
   /**
@@ -73,6 +87,11 @@ public:
 protected:
   nav2_costmap_2d::Costmap2D * costmap_;
   bool sum_scores_;
+
+  // the poses of a batch and their cells, reused between batches
+  std::vector<double> batch_x_, batch_y_;
+  std::vector<unsigned int> batch_mx_, batch_my_;
+  std::vector<unsigned char> batch_valid_;
 };
 }  // namespace dwb_critics
 
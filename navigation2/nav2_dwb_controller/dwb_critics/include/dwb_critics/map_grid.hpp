@@ -35,6 +35,7 @@
 #ifndef DWB_CRITICS__MAP_GRID_HPP_
 #define DWB_CRITICS__MAP_GRID_HPP_
 
+#include <string>
 #include <vector>
 #include <memory>
 #include "dwb_core/trajectory_critic.hpp"
@@ -54,6 +55,19 @@ namespace dwb_critics
  *
  * This approach was chosen for computational efficiency, such that each trajectory
  * need not be compared to the list of source points.
+ *
+ * The distances only depend on the source cells and the size of the grid, so the last few
+ * grids are shared between all MapGridCritics, and critics with the same sources (such as
+ * PathDistCritic and PathAlignCritic) only run the breadth-first exploration once.
+ *
+ * With bounded_propagation set, the exploration stops at the distance past which no cell is
+ * within reach of the robot in sim_time at the maximum speed, and only the cells it reached
+ * are written. Every other cell scores as unreachable through a generation counter, so no
+ * pass over the whole grid is needed.
+ *
+ * With batch_scoring, the poses of every trajectory are converted to cells in one flat pass
+ * and their scores gathered from the grid, instead of a virtual scorePose() per pose.
+ * Subclasses that override scorePose() score one trajectory at a time instead.
  */
 class MapGridCritic : public dwb_core::TrajectoryCritic
 {
@@ -61,6 +75,10 @@ public:
   // Standard TrajectoryCritic Interface
   void onInit() override;
   double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) override;
+  void scoreTrajectories(
+    const std::vector<dwb_msgs::msg::Trajectory2D> & trajs,
+    std::vector<double> & scores, std::vector<std::string> & errors) override;
+  bool hasBatchScoring() const override {return true;}
   void addGridScores(sensor_msgs::msg::PointCloud & pc) override;
   double getScale() const override {return costmap_->getResolution() * 0.5 * scale_;}
 
@@ -80,7 +98,8 @@ public:
    */
   inline double getScore(unsigned int x, unsigned int y)
   {
-    return cell_values_[costmap_->getIndex(x, y)];
+    unsigned int index = costmap_->getIndex(x, y);
+    return cell_generation_[index] == generation_ ? cell_values_[index] : unreachable_score_;
   }
 
   /**
@@ -121,11 +140,54 @@ protected:
    */
   void reset() override;
 
+  /**
+   * @brief Mark a cell as a source of the distances, with a score of zero
+   * @param x x-coordinate within the costmap
+   * @param y y-coordinate within the costmap
+   */
+  void addSourceCell(unsigned int x, unsigned int y);
+
+  /**
+   * @brief Set the score of a cell for this cycle
+   */
+  inline void setScore(unsigned int index, double value)
+  {
+    cell_values_[index] = value;
+    cell_generation_[index] = generation_;
+  }
+
   /**
    * @brief Go through the queue and set the cells to the Manhattan distance from their parents
+   *
+   * If a grid with the same sources was computed before, its scores are copied instead.
    */
   void propogateManhattanDistances();
 
+  /**
+   * @brief As propogateManhattanDistances(), but stopping where no cell is within reach of pose
+   *
+   * Without bounded_propagation, or if pose is off the grid, the whole grid is explored.
+   */
+  void propogateManhattanDistances(const geometry_msgs::msg::Pose2D & pose);
+
+  /**
+   * @brief Explore the cells no more than limit cells (Manhattan) from their source
+   */
+  void propagateWithin(unsigned int limit);
+
+  std::vector<unsigned int> source_cells_;  ///< Indices of the cells given to addSourceCell
+  std::vector<unsigned int> cell_generation_;  ///< cell_values_ is only set where this matches
+  unsigned int generation_{0};
+  /// If positive, how far from the robot cells may be scored, in meters
+  double propagation_radius_{0.0};
+  unsigned int queue_limit_;  ///< The largest source distance MapGridQueue accepts
+
+  /// The grid cell of each pose scored in a batch, or -1 off the grid, reused between batches
+  std::vector<int> batch_cells_;
+  std::vector<double> batch_x_, batch_y_;
+  std::vector<unsigned int> batch_mx_, batch_my_;
+  std::vector<unsigned char> batch_valid_;
+
   std::shared_ptr<MapGridQueue> queue_;
   nav2_costmap_2d::Costmap2D * costmap_;
   std::vector<double> cell_values_;
@@ -35,8 +35,10 @@
 #ifndef DWB_CRITICS__OBSTACLE_FOOTPRINT_HPP_
 #define DWB_CRITICS__OBSTACLE_FOOTPRINT_HPP_
 
+#include <utility>
 #include <vector>
 #include "dwb_critics/base_obstacle.hpp"
+#include "nav2_costmap_2d/center_cost_check.hpp"
 
 namespace dwb_critics
 {
@@ -61,10 +63,18 @@ Footprint getOrientedFootprint(
  *
  * A more robust class could check every cell within the robot's footprint without inflating the obstacles,
  * at some computational cost. That is left as an excercise to the reader.
+ *
+ * If footprint_yaw_bins is positive, the outline is instead rasterized once per yaw bin as cell
+ * offsets from the pose's cell, and each pose is scored from the cells of its nearest bin.
+ *
+ * center_check set to inscribed or circumscribed settles poses from the cost of their own cell
+ * where the inflation allows, and walks the footprint only for the rest. See
+ * nav2_costmap_2d::CenterCostCheck.
  */
 class ObstacleFootprintCritic : public BaseObstacleCritic
 {
 public:
+  void onInit() override;
   bool prepare(
     const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & vel,
     const geometry_msgs::msg::Pose2D & goal, const nav_2d_msgs::msg::Path2D & global_plan) override;
@@ -72,6 +82,7 @@ public:
   virtual double scorePose(
     const geometry_msgs::msg::Pose2D & pose,
     const Footprint & oriented_footprint);
+  bool hasBatchScoring() const override {return false;}
   double getScale() const override {return costmap_->getResolution() * scale_;}
 
 protected:
@@ -93,7 +104,29 @@ protected:
    */
   double pointCost(int x, int y);
 
+  /**
+   * @brief The cost of the footprint outline in the raster of the yaw bin nearest theta
+   * @param cell_x The x position of the pose in cell coordinates
+   * @param cell_y The y position of the pose in cell coordinates
+   * @param theta The yaw of the pose
+   */
+  double rasterCost(unsigned int cell_x, unsigned int cell_y, double theta);
+
+  /**
+   * @brief Rebuild the rasters of every yaw bin when the footprint or resolution changed
+   */
+  void updateRasters();
+
   Footprint footprint_spec_;
+
+  int yaw_bins_;
+  Footprint raster_spec_;
+  double raster_resolution_{0.0};
+  int raster_radius_{0};  ///< @brief Circumscribed radius of raster_spec_ in cells
+  std::vector<std::vector<std::pair<int, int>>> rasters_;
+
+  nav2_costmap_2d::CenterCostCheck center_check_;
+  int footprint_radius_{0};  ///< @brief Circumscribed radius of footprint_spec_ in cells
 };
 }  // namespace dwb_critics
 
@@ -64,6 +64,7 @@ public:
     const geometry_msgs::msg::Pose2D & goal, const nav_2d_msgs::msg::Path2D & global_plan) override;
   double getScale() const override;
   double scorePose(const geometry_msgs::msg::Pose2D & pose) override;
+  bool hasBatchScoring() const override {return false;}
 
 protected:
   bool zero_scale_;
@@ -36,6 +36,7 @@
 #define DWB_CRITICS__PREFER_FORWARD_HPP_
 
 #include <string>
+#include <vector>
 #include "dwb_core/trajectory_critic.hpp"
 
 namespace dwb_critics
@@ -57,6 +58,10 @@ public:
   : penalty_(1.0), strafe_x_(0.1), strafe_theta_(0.2), theta_scale_(10.0) {}
   void onInit() override;
   double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) override;
+  void scoreTrajectories(
+    const std::vector<dwb_msgs::msg::Trajectory2D> & trajs,
+    std::vector<double> & scores, std::vector<std::string> & errors) override;
+  bool hasBatchScoring() const override {return true;}
 
 private:
   double penalty_, strafe_x_, strafe_theta_, theta_scale_;
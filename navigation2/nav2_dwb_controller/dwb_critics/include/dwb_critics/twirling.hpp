@@ -35,6 +35,8 @@
 #ifndef DWB_CRITICS__TWIRLING_HPP_
 #define DWB_CRITICS__TWIRLING_HPP_
 
+#include <string>
+#include <vector>
 #include "dwb_core/trajectory_critic.hpp"
 
 namespace dwb_critics
@@ -53,6 +55,10 @@ class TwirlingCritic : public dwb_core::TrajectoryCritic
 public:
   void onInit() override;
   double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) override;
+  void scoreTrajectories(
+    const std::vector<dwb_msgs::msg::Trajectory2D> & trajs,
+    std::vector<double> & scores, std::vector<std::string> & errors) override;
+  bool hasBatchScoring() const override {return true;}
 };
 }  // namespace dwb_critics
 
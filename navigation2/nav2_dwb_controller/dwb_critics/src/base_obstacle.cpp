@@ -33,6 +33,8 @@
  */
 
 #include "dwb_critics/base_obstacle.hpp"
+#include <string>
+#include <vector>
 #include "dwb_core/exceptions.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "nav2_costmap_2d/cost_values.hpp"
@@ -52,16 +54,76 @@ void BaseObstacleCritic::onInit()
 
 double BaseObstacleCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj)
 {
+  return scoreTrajectoryBounded(traj, -1.0);
+}
+
+double BaseObstacleCritic::scoreTrajectoryBounded(
+  const dwb_msgs::msg::Trajectory2D & traj,
+  double raw_limit)
+{
+  // pose costs are never negative, so a sum that has passed the limit stays past it
+  bool bounded = sum_scores_ && raw_limit >= 0.0;
   double score = 0.0;
   for (unsigned int i = 0; i < traj.poses.size(); ++i) {
     double pose_score = scorePose(traj.poses[i]);
     // Optimized/branchless version of if (sum_scores_) score += pose_score,
     // else score = pose_score;
     score = static_cast<double>(sum_scores_) * score + pose_score;
+    if (bounded && score > raw_limit) {
+      break;
+    }
   }
   return score;
 }
 
+void BaseObstacleCritic::scoreTrajectories(
+  const std::vector<dwb_msgs::msg::Trajectory2D> & trajs,
+  std::vector<double> & scores, std::vector<std::string> & errors)
+{
+  if (!hasBatchScoring()) {
+    TrajectoryCritic::scoreTrajectories(trajs, scores, errors);
+    return;
+  }
+  scores.resize(trajs.size());
+  errors.assign(trajs.size(), std::string());
+
+  batch_x_.clear();
+  batch_y_.clear();
+  for (const auto & traj : trajs) {
+    for (const auto & pose : traj.poses) {
+      batch_x_.push_back(pose.x);
+      batch_y_.push_back(pose.y);
+    }
+  }
+  const size_t count = batch_x_.size();
+  batch_mx_.resize(count);
+  batch_my_.resize(count);
+  batch_valid_.resize(count);
+  costmap_->worldToMapBatch(batch_x_.data(), batch_y_.data(), count,
+    batch_mx_.data(), batch_my_.data(), batch_valid_.data());
+
+  size_t k = 0;
+  for (size_t t = 0; t < trajs.size(); ++t) {
+    double score = 0.0;
+    for (size_t i = 0; i < trajs[t].poses.size(); ++i, ++k) {
+      if (!errors[t].empty()) {
+        continue;
+      }
+      if (!batch_valid_[k]) {
+        errors[t] = "Trajectory Goes Off Grid.";
+        continue;
+      }
+      unsigned char cost = costmap_->getCost(batch_mx_[k], batch_my_[k]);
+      if (!isValidCost(cost)) {
+        errors[t] = "Trajectory Hits Obstacle.";
+        continue;
+      }
+      score = static_cast<double>(sum_scores_) * score + cost;
+    }
+    scores[t] = errors[t].empty() ? score : -1.0;
+  }
+}
+
 double BaseObstacleCritic::scorePose(const geometry_msgs::msg::Pose2D & pose)
 {
   unsigned int cell_x, cell_y;
@@ -41,7 +41,7 @@
 namespace dwb_critics
 {
 bool GoalDistCritic::prepare(
-  const geometry_msgs::msg::Pose2D &, const nav_2d_msgs::msg::Twist2D &,
+  const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D &,
   const geometry_msgs::msg::Pose2D &,
   const nav_2d_msgs::msg::Path2D & global_plan)
 {
@@ -53,11 +53,9 @@ bool GoalDistCritic::prepare(
   }
 
   // Enqueue just the last pose
-  int index = costmap_->getIndex(local_goal_x, local_goal_y);
-  cell_values_[index] = 0.0;
-  queue_->enqueueCell(local_goal_x, local_goal_y);
+  addSourceCell(local_goal_x, local_goal_y);
 
-  propogateManhattanDistances();
+  propogateManhattanDistances(pose);
 
   return true;
 }
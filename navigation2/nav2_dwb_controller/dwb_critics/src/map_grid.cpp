@@ -36,9 +36,14 @@
 #include <cmath>
 #include <string>
 #include <algorithm>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 #include "dwb_core/exceptions.hpp"
 #include "nav2_costmap_2d/cost_values.hpp"
+#include "nav_2d_utils/parameters.hpp"
 
 using std::abs;
 using costmap_queue::CellData;
@@ -46,10 +51,30 @@ using costmap_queue::CellData;
 namespace dwb_critics
 {
 
+namespace
+{
+
+/**
+ * @brief The cells of a distance grid, and the sources, grid size and limit it was computed with
+ */
+struct SharedDistanceGrid
+{
+  unsigned int size_x, size_y, limit;
+  std::vector<unsigned int> sources;
+  std::vector<std::pair<unsigned int, double>> cells;
+};
+
+// A path and a goal grid per planner are enough to serve every critic in one cycle
+const size_t MAX_SHARED_GRIDS = 4;
+std::mutex shared_grids_mutex;
+std::vector<SharedDistanceGrid> shared_grids;
+
+}  // namespace
+
 // Customization of the CostmapQueue validCellToQueue method
-bool MapGridCritic::MapGridQueue::validCellToQueue(const costmap_queue::CellData & /*cell*/)
+bool MapGridCritic::MapGridQueue::validCellToQueue(const costmap_queue::CellData & cell)
 {
-  return true;
+  return cell.distance_ <= parent_.queue_limit_;
 }
 
 void MapGridCritic::onInit()
@@ -77,29 +102,126 @@ void MapGridCritic::onInit()
       aggro_str.c_str());
     aggregationType_ = ScoreAggregationType::Last;
   }
+
+  nh_->declare_parameter(name_ + ".bounded_propagation", rclcpp::ParameterValue(false));
+  bool bounded_propagation;
+  nh_->get_parameter(name_ + ".bounded_propagation", bounded_propagation);
+  propagation_radius_ = 0.0;
+  if (bounded_propagation) {
+    // the trajectory generator's limits, which are declared before the critics are loaded
+    double max_vel_x = std::max(std::fabs(nav_2d_utils::searchAndGetParam(nh_, "max_vel_x", 0.0)),
+        std::fabs(nav_2d_utils::searchAndGetParam(nh_, "min_vel_x", 0.0)));
+    double max_vel_y = std::max(std::fabs(nav_2d_utils::searchAndGetParam(nh_, "max_vel_y", 0.0)),
+        std::fabs(nav_2d_utils::searchAndGetParam(nh_, "min_vel_y", 0.0)));
+    double max_speed = std::max(nav_2d_utils::searchAndGetParam(nh_, "max_speed_xy", 0.0),
+        std::hypot(max_vel_x, max_vel_y));
+    propagation_radius_ = max_speed * nav_2d_utils::searchAndGetParam(nh_, "sim_time", 1.7);
+    if (propagation_radius_ <= 0.0) {
+      RCLCPP_WARN(rclcpp::get_logger("MapGridCritic"),
+        "bounded_propagation needs a positive speed limit and sim_time, propagating over the "
+        "whole grid instead.");
+    }
+  }
 }
 
 void MapGridCritic::setAsObstacle(unsigned int index)
 {
-  cell_values_[index] = obstacle_score_;
+  setScore(index, obstacle_score_);
 }
 
 void MapGridCritic::reset()
 {
   queue_->reset();
-  cell_values_.resize(costmap_->getSizeInCellsX() * costmap_->getSizeInCellsY());
-  obstacle_score_ = static_cast<double>(cell_values_.size());
+  size_t size = costmap_->getSizeInCellsX() * costmap_->getSizeInCellsY();
+  // a new generation leaves every cell unreachable without touching it, the grid is only
+  // cleared when it is resized or the counter wraps around
+  if (cell_values_.size() != size || ++generation_ == 0) {
+    cell_values_.assign(size, 0.0);
+    cell_generation_.assign(size, 0);
+    generation_ = 1;
+  }
+  obstacle_score_ = static_cast<double>(size);
   unreachable_score_ = obstacle_score_ + 1.0;
-  std::fill(cell_values_.begin(), cell_values_.end(), unreachable_score_);
+  source_cells_.clear();
+  queue_limit_ = std::numeric_limits<unsigned int>::max();
+}
+
+void MapGridCritic::addSourceCell(unsigned int x, unsigned int y)
+{
+  unsigned int index = costmap_->getIndex(x, y);
+  setScore(index, 0.0);
+  queue_->enqueueCell(x, y);
+  source_cells_.push_back(index);
 }
 
 void MapGridCritic::propogateManhattanDistances()
 {
+  propagateWithin(std::numeric_limits<unsigned int>::max());
+}
+
+void MapGridCritic::propogateManhattanDistances(const geometry_msgs::msg::Pose2D & pose)
+{
+  unsigned int limit = std::numeric_limits<unsigned int>::max();
+  unsigned int robot_x, robot_y;
+  if (propagation_radius_ > 0.0 && costmap_->worldToMap(pose.x, pose.y, robot_x, robot_y)) {
+    // a cell within the radius of the robot is at most the radius (Manhattan) plus the robot's
+    // own distance from the nearest source away from a source
+    unsigned int size_x = costmap_->getSizeInCellsX();
+    unsigned int robot_distance = limit;
+    for (unsigned int index : source_cells_) {
+      robot_distance = std::min(robot_distance,
+          CellData::absolute_difference(index % size_x, robot_x) +
+          CellData::absolute_difference(index / size_x, robot_y));
+    }
+    if (robot_distance != limit) {
+      limit = robot_distance + 1 +
+        static_cast<unsigned int>(std::ceil(M_SQRT2 * propagation_radius_ /
+        costmap_->getResolution()));
+    }
+  }
+  propagateWithin(limit);
+}
+
+void MapGridCritic::propagateWithin(unsigned int limit)
+{
+  unsigned int size_x = costmap_->getSizeInCellsX(), size_y = costmap_->getSizeInCellsY();
+  {
+    // a grid explored further holds the same scores for every cell within this limit,
+    // and the cells past it are out of reach of the trajectories
+    std::lock_guard<std::mutex> lock(shared_grids_mutex);
+    for (const SharedDistanceGrid & grid : shared_grids) {
+      if (grid.size_x == size_x && grid.size_y == size_y && grid.limit >= limit &&
+        grid.sources == source_cells_)
+      {
+        for (const auto & cell : grid.cells) {
+          setScore(cell.first, cell.second);
+        }
+        queue_->reset();
+        return;
+      }
+    }
+  }
+
+  queue_limit_ = limit;
+  std::vector<std::pair<unsigned int, double>> cells;
   while (!queue_->isEmpty()) {
     costmap_queue::CellData cell = queue_->getNextCell();
-    cell_values_[cell.index_] = CellData::absolute_difference(cell.src_x_, cell.x_) +
+    double value = CellData::absolute_difference(cell.src_x_, cell.x_) +
       CellData::absolute_difference(cell.src_y_, cell.y_);
+    setScore(cell.index_, value);
+    cells.emplace_back(cell.index_, value);
+  }
+  queue_limit_ = std::numeric_limits<unsigned int>::max();
+
+  if (source_cells_.empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(shared_grids_mutex);
+  if (shared_grids.size() >= MAX_SHARED_GRIDS) {
+    shared_grids.erase(shared_grids.begin());
   }
+  shared_grids.push_back(SharedDistanceGrid{size_x, size_y, limit, source_cells_,
+      std::move(cells)});
 }
 
 double MapGridCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj)
@@ -141,6 +263,89 @@ double MapGridCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj)
   return score;
 }
 
+void MapGridCritic::scoreTrajectories(
+  const std::vector<dwb_msgs::msg::Trajectory2D> & trajs,
+  std::vector<double> & scores, std::vector<std::string> & errors)
+{
+  if (!hasBatchScoring()) {
+    TrajectoryCritic::scoreTrajectories(trajs, scores, errors);
+    return;
+  }
+  scores.resize(trajs.size());
+  errors.assign(trajs.size(), std::string());
+
+  // the same poses scoreTrajectory() looks at: all of them, or only the last
+  bool last_only = aggregationType_ == ScoreAggregationType::Last && !stop_on_failure_;
+  size_t count = 0;
+  for (const auto & traj : trajs) {
+    count += last_only ? std::min<size_t>(traj.poses.size(), 1) : traj.poses.size();
+  }
+
+  // every pose to its cell in one pass
+  batch_x_.clear();
+  batch_y_.clear();
+  for (const auto & traj : trajs) {
+    size_t first = last_only && !traj.poses.empty() ? traj.poses.size() - 1 : 0;
+    for (size_t i = first; i < traj.poses.size(); ++i) {
+      batch_x_.push_back(traj.poses[i].x);
+      batch_y_.push_back(traj.poses[i].y);
+    }
+  }
+  batch_mx_.resize(count);
+  batch_my_.resize(count);
+  batch_valid_.resize(count);
+  costmap_->worldToMapBatch(batch_x_.data(), batch_y_.data(), count,
+    batch_mx_.data(), batch_my_.data(), batch_valid_.data());
+  batch_cells_.resize(count);
+  const unsigned int size_x = costmap_->getSizeInCellsX();
+  for (size_t k = 0; k < count; ++k) {
+    batch_cells_[k] = batch_valid_[k] ?
+      static_cast<int>(batch_my_[k] * size_x + batch_mx_[k]) : -1;
+  }
+
+  size_t k = 0;
+  for (size_t t = 0; t < trajs.size(); ++t) {
+    size_t poses = trajs[t].poses.size();
+    size_t first = last_only && poses > 0 ? poses - 1 : 0;
+    double score = aggregationType_ == ScoreAggregationType::Product ? 1.0 : 0.0;
+    for (size_t i = first; i < poses; ++i, ++k) {
+      if (!errors[t].empty()) {
+        continue;
+      }
+      int cell = batch_cells_[k];
+      if (cell < 0) {
+        errors[t] = "Trajectory Goes Off Grid.";
+        continue;
+      }
+      double grid_dist = cell_generation_[cell] == generation_ ?
+        cell_values_[cell] : unreachable_score_;
+      if (stop_on_failure_) {
+        if (grid_dist == obstacle_score_) {
+          errors[t] = "Trajectory Hits Obstacle.";
+          continue;
+        } else if (grid_dist == unreachable_score_) {
+          errors[t] = "Trajectory Hits Unreachable Area.";
+          continue;
+        }
+      }
+      switch (aggregationType_) {
+        case ScoreAggregationType::Last:
+          score = grid_dist;
+          break;
+        case ScoreAggregationType::Sum:
+          score += grid_dist;
+          break;
+        case ScoreAggregationType::Product:
+          if (score > 0) {
+            score *= grid_dist;
+          }
+          break;
+      }
+    }
+    scores[t] = errors[t].empty() ? score : -1.0;
+  }
+}
+
 double MapGridCritic::scorePose(const geometry_msgs::msg::Pose2D & pose)
 {
   unsigned int cell_x, cell_y;
@@ -34,11 +34,16 @@
 
 #include "dwb_critics/obstacle_footprint.hpp"
 #include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
 #include <vector>
-#include "dwb_critics/line_iterator.hpp"
+#include "nav2_util/line_traversal.hpp"
 #include "dwb_core/exceptions.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/footprint.hpp"
+#include "nav2_costmap_2d/inflation_layer.hpp"
 
 PLUGINLIB_EXPORT_CLASS(dwb_critics::ObstacleFootprintCritic, dwb_core::TrajectoryCritic)
 
@@ -60,6 +65,24 @@ Footprint getOrientedFootprint(
   return oriented_footprint;
 }
 
+void ObstacleFootprintCritic::onInit()
+{
+  BaseObstacleCritic::onInit();
+
+  nh_->declare_parameter(name_ + ".footprint_yaw_bins", rclcpp::ParameterValue(0));
+  nh_->get_parameter(name_ + ".footprint_yaw_bins", yaw_bins_);
+
+  std::string center_check;
+  nh_->declare_parameter(name_ + ".center_check", rclcpp::ParameterValue(std::string("exact")));
+  nh_->get_parameter(name_ + ".center_check", center_check);
+  nav2_costmap_2d::CenterCheckMode mode = nav2_costmap_2d::CenterCheckMode::EXACT;
+  if (!nav2_costmap_2d::centerCheckModeFromString(center_check, mode)) {
+    RCLCPP_WARN(rclcpp::get_logger("ObstacleFootprintCritic"),
+      "Unknown center_check %s, checking footprints exactly", center_check.c_str());
+  }
+  center_check_.setMode(mode);
+}
+
 bool ObstacleFootprintCritic::prepare(
   const geometry_msgs::msg::Pose2D &, const nav_2d_msgs::msg::Twist2D &,
   const geometry_msgs::msg::Pose2D &, const nav_2d_msgs::msg::Path2D &)
@@ -70,18 +93,121 @@ bool ObstacleFootprintCritic::prepare(
       "Footprint spec is empty, maybe missing call to setFootprint?");
     return false;
   }
+  if (yaw_bins_ > 0) {
+    updateRasters();
+  }
+  if (center_check_.getMode() != nav2_costmap_2d::CenterCheckMode::EXACT) {
+    // the inflation or the footprint may have changed since the last trajectory
+    center_check_.setCircumscribedCost(
+      nav2_costmap_2d::InflationLayer::findCircumscribedCost(costmap_ros_->getLayeredCostmap()));
+    double min_dist, max_dist;
+    nav2_costmap_2d::calculateMinAndMaxDistances(footprint_spec_, min_dist, max_dist);
+    footprint_radius_ = costmap_->cellDistance(max_dist);
+  }
   return true;
 }
 
+void ObstacleFootprintCritic::updateRasters()
+{
+  // every bin is built here rather than on first use, since poses may be scored from
+  // several threads at once
+  double resolution = costmap_->getResolution();
+  if (resolution == raster_resolution_ && footprint_spec_ == raster_spec_ &&
+    rasters_.size() == static_cast<size_t>(yaw_bins_))
+  {
+    return;
+  }
+  raster_spec_ = footprint_spec_;
+  raster_resolution_ = resolution;
+  rasters_.assign(yaw_bins_, std::vector<std::pair<int, int>>());
+
+  double radius = 0.0;
+  for (const auto & point : raster_spec_) {
+    radius = std::max(radius, std::hypot(point.x, point.y));
+  }
+  raster_radius_ = static_cast<int>(std::ceil(radius / resolution)) + 1;
+
+  for (int bin = 0; bin < yaw_bins_; ++bin) {
+    // the outline of the footprint at the bin's yaw, for a pose at the center of cell (0, 0)
+    double theta = 2 * M_PI * bin / yaw_bins_;
+    double cos_th = cos(theta), sin_th = sin(theta);
+    std::vector<std::pair<int, int>> vertices;
+    for (const auto & point : raster_spec_) {
+      double x = point.x * cos_th - point.y * sin_th;
+      double y = point.x * sin_th + point.y * cos_th;
+      vertices.emplace_back(static_cast<int>(std::floor(x / resolution + 0.5)),
+        static_cast<int>(std::floor(y / resolution + 0.5)));
+    }
+
+    std::vector<std::pair<int, int>> & cells = rasters_[bin];
+    for (unsigned int i = 0; i < vertices.size(); ++i) {
+      const auto & start = vertices[i];
+      const auto & end = vertices[(i + 1) % vertices.size()];
+      nav2_util::traceCells(start.first, start.second, end.first, end.second,
+        [&cells](int x, int y) {cells.emplace_back(x, y);});
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+  }
+}
+
 double ObstacleFootprintCritic::scorePose(const geometry_msgs::msg::Pose2D & pose)
 {
   unsigned int cell_x, cell_y;
   if (!costmap_->worldToMap(pose.x, pose.y, cell_x, cell_y)) {
     throw nav_core2::IllegalTrajectoryException(name_, "Trajectory Goes Off Grid.");
   }
+
+  unsigned char center_cost = costmap_->getCost(cell_x, cell_y);
+  switch (center_check_.classify(center_cost)) {
+    case nav2_costmap_2d::CenterCheckResult::COLLISION:
+      throw nav_core2::IllegalTrajectoryException(name_, "Trajectory Hits Obstacle.");
+    case nav2_costmap_2d::CenterCheckResult::FREE:
+      {
+        // a footprint off the grid has to be walked to report it as such
+        int x = cell_x, y = cell_y;
+        if (x >= footprint_radius_ && y >= footprint_radius_ &&
+          x + footprint_radius_ < static_cast<int>(costmap_->getSizeInCellsX()) &&
+          y + footprint_radius_ < static_cast<int>(costmap_->getSizeInCellsY()))
+        {
+          return center_cost;
+        }
+        break;
+      }
+    case nav2_costmap_2d::CenterCheckResult::AMBIGUOUS:
+      break;
+  }
+
+  if (yaw_bins_ > 0 && !rasters_.empty()) {
+    return rasterCost(cell_x, cell_y, pose.theta);
+  }
   return scorePose(pose, getOrientedFootprint(pose, footprint_spec_));
 }
 
+double ObstacleFootprintCritic::rasterCost(
+  unsigned int cell_x, unsigned int cell_y, double theta)
+{
+  double turns = theta / (2 * M_PI);
+  int bin = static_cast<int>(std::lround((turns - std::floor(turns)) * yaw_bins_)) % yaw_bins_;
+
+  // a footprint whose circumscribed circle is on the grid needs no bounds checks
+  int size_x = costmap_->getSizeInCellsX();
+  int size_y = costmap_->getSizeInCellsY();
+  int x = cell_x, y = cell_y;
+  bool on_grid = x >= raster_radius_ && y >= raster_radius_ &&
+    x + raster_radius_ < size_x && y + raster_radius_ < size_y;
+
+  double footprint_cost = 0.0;
+  for (const auto & offset : rasters_[bin]) {
+    int mx = x + offset.first, my = y + offset.second;
+    if (!on_grid && (mx < 0 || my < 0 || mx >= size_x || my >= size_y)) {
+      throw nav_core2::IllegalTrajectoryException(name_, "Footprint Goes Off Grid.");
+    }
+    footprint_cost = std::max(pointCost(mx, my), footprint_cost);
+  }
+  return footprint_cost;
+}
+
 double ObstacleFootprintCritic::scorePose(
   const geometry_msgs::msg::Pose2D &,
   const Footprint & footprint)
@@ -128,15 +254,10 @@ double ObstacleFootprintCritic::scorePose(
 double ObstacleFootprintCritic::lineCost(int x0, int x1, int y0, int y1)
 {
   double line_cost = 0.0;
-  double point_cost = -1.0;
-
-  for (LineIterator line(x0, y0, x1, y1); line.isValid(); line.advance()) {
-    point_cost = pointCost(line.getX(), line.getY());   // Score the current point
 
-    if (line_cost < point_cost) {
-      line_cost = point_cost;
-    }
-  }
+  nav2_util::traceCells(x0, y0, x1, y1, [&](int x, int y) {
+      line_cost = std::max(line_cost, pointCost(x, y));   // Score the current point
+    });
 
   return line_cost;
 }
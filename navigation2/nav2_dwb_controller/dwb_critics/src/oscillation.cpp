@@ -214,4 +214,27 @@ double OscillationCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & tr
   return 0.0;
 }
 
+void OscillationCritic::scoreTrajectories(
+  const std::vector<dwb_msgs::msg::Trajectory2D> & trajs,
+  std::vector<double> & scores, std::vector<std::string> & errors)
+{
+  scores.assign(trajs.size(), 0.0);
+  errors.assign(trajs.size(), std::string());
+  if (!x_trend_.hasSignFlipped() && !y_trend_.hasSignFlipped() &&
+    !theta_trend_.hasSignFlipped())
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < trajs.size(); ++i) {
+    const nav_2d_msgs::msg::Twist2D & velocity = trajs[i].velocity;
+    if (x_trend_.isOscillating(velocity.x) || y_trend_.isOscillating(velocity.y) ||
+      theta_trend_.isOscillating(velocity.theta))
+    {
+      scores[i] = -1.0;
+      errors[i] = "Trajectory is oscillating.";
+    }
+  }
+}
+
 }  // namespace dwb_critics
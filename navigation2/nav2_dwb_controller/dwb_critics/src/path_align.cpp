@@ -47,6 +47,10 @@ void PathAlignCritic::onInit()
   PathDistCritic::onInit();
   stop_on_failure_ = false;
   forward_point_distance_ = nav_2d_utils::searchAndGetParam(nh_, "forward_point_distance", 0.325);
+  // the score is taken at a point this far ahead of the trajectory
+  if (propagation_radius_ > 0.0) {
+    propagation_radius_ += forward_point_distance_;
+  }
 }
 
 bool PathAlignCritic::prepare(
@@ -41,7 +41,7 @@
 namespace dwb_critics
 {
 bool PathDistCritic::prepare(
-  const geometry_msgs::msg::Pose2D &, const nav_2d_msgs::msg::Twist2D &,
+  const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D &,
   const geometry_msgs::msg::Pose2D &,
   const nav_2d_msgs::msg::Path2D & global_plan)
 {
@@ -66,9 +66,7 @@ bool PathDistCritic::prepare(
     if (costmap_->worldToMap(g_x, g_y, map_x,
       map_y) && costmap_->getCost(map_x, map_y) != nav2_costmap_2d::NO_INFORMATION)
     {
-      int index = costmap_->getIndex(map_x, map_y);
-      cell_values_[index] = 0.0;
-      queue_->enqueueCell(map_x, map_y);
+      addSourceCell(map_x, map_y);
       started_path = true;
     } else if (started_path) {
       break;
@@ -83,7 +81,7 @@ bool PathDistCritic::prepare(
     return false;
   }
 
-  propogateManhattanDistances();
+  propogateManhattanDistances(pose);
 
   return true;
 }
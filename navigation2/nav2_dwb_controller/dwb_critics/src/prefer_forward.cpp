@@ -34,6 +34,8 @@
 
 #include "dwb_critics/prefer_forward.hpp"
 #include <math.h>
+#include <string>
+#include <vector>
 #include "pluginlib/class_list_macros.hpp"
 
 PLUGINLIB_EXPORT_CLASS(dwb_critics::PreferForwardCritic, dwb_core::TrajectoryCritic)
@@ -69,4 +71,19 @@ double PreferForwardCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D &
   return fabs(traj.velocity.theta) * theta_scale_;
 }
 
+void PreferForwardCritic::scoreTrajectories(
+  const std::vector<dwb_msgs::msg::Trajectory2D> & trajs,
+  std::vector<double> & scores, std::vector<std::string> & errors)
+{
+  scores.resize(trajs.size());
+  errors.assign(trajs.size(), std::string());
+  for (size_t i = 0; i < trajs.size(); ++i) {
+    double x = trajs[i].velocity.x;
+    double theta = fabs(trajs[i].velocity.theta);
+    // the same conditions as scoreTrajectory, combined without branching
+    bool penalized = (x < 0.0) | ((x < strafe_x_) & (theta < strafe_theta_));
+    scores[i] = penalized ? penalty_ : theta * theta_scale_;
+  }
+}
+
 }  // namespace dwb_critics
@@ -88,4 +88,29 @@ double RotateToGoalCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & t
   return fabs(angles::shortest_angular_distance(end_yaw, goal_yaw_));
 }
 
+void RotateToGoalCritic::scoreTrajectories(
+  const std::vector<dwb_msgs::msg::Trajectory2D> & trajs,
+  std::vector<double> & scores, std::vector<std::string> & errors)
+{
+  errors.assign(trajs.size(), std::string());
+  if (!in_window_) {
+    scores.assign(trajs.size(), 0.0);
+    return;
+  }
+
+  scores.resize(trajs.size());
+  for (size_t i = 0; i < trajs.size(); ++i) {
+    const dwb_msgs::msg::Trajectory2D & traj = trajs[i];
+    if (fabs(traj.velocity.x) > 0 || fabs(traj.velocity.y) > 0) {
+      scores[i] = -1.0;
+      errors[i] = "Nonrotation command near goal.";
+    } else if (traj.poses.empty()) {
+      scores[i] = -1.0;
+      errors[i] = "Empty trajectory.";
+    } else {
+      scores[i] = fabs(angles::shortest_angular_distance(traj.poses.back().theta, goal_yaw_));
+    }
+  }
+}
+
 }  // namespace dwb_critics
@@ -33,6 +33,8 @@
  */
 
 #include "dwb_critics/twirling.hpp"
+#include <string>
+#include <vector>
 #include "pluginlib/class_list_macros.hpp"
 
 namespace dwb_critics
@@ -51,6 +53,17 @@ double TwirlingCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj)
 {
   return fabs(traj.velocity.theta);  // add cost for making the robot spin
 }
+
+void TwirlingCritic::scoreTrajectories(
+  const std::vector<dwb_msgs::msg::Trajectory2D> & trajs,
+  std::vector<double> & scores, std::vector<std::string> & errors)
+{
+  scores.resize(trajs.size());
+  errors.assign(trajs.size(), std::string());
+  for (size_t i = 0; i < trajs.size(); ++i) {
+    scores[i] = fabs(trajs[i].velocity.theta);
+  }
+}
 }  // namespace dwb_critics
 
 PLUGINLIB_EXPORT_CLASS(dwb_critics::TwirlingCritic, dwb_core::TrajectoryCritic)
@@ -35,6 +35,7 @@
 #ifndef DWB_PLUGINS__KINEMATIC_PARAMETERS_HPP_
 #define DWB_PLUGINS__KINEMATIC_PARAMETERS_HPP_
 
+#include <cstddef>
 #include <memory>
 
 #include "rclcpp/rclcpp.hpp"
@@ -89,6 +90,15 @@ public:
    */
   bool isValidSpeed(double x, double y, double theta);
 
+  /**
+   * @brief isValidSpeed() of n velocities at once, written to valid as 0 or 1
+   *
+   * Written without branches, for the compiler to vectorize over the arrays.
+   */
+  void isValidSpeed(
+    const double * x, const double * y, const double * theta, size_t n,
+    unsigned char * valid);
+
   typedef std::shared_ptr<KinematicParameters> Ptr;
 
 protected:
@@ -36,6 +36,7 @@
 #define DWB_PLUGINS__LIMITED_ACCEL_GENERATOR_HPP_
 
 #include <memory>
+#include <vector>
 
 #include "dwb_plugins/standard_traj_generator.hpp"
 #include "nav2_util/lifecycle_node.hpp"
@@ -52,6 +53,13 @@ public:
   void initialize(const nav2_util::LifecycleNode::SharedPtr & nh) override;
   void checkUseDwaParam(const nav2_util::LifecycleNode::SharedPtr & nh) override;
   void startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity) override;
+  std::vector<nav_2d_msgs::msg::Twist2D> getTwists(
+    const nav_2d_msgs::msg::Twist2D & current_velocity) override;
+  std::vector<nav_2d_msgs::msg::Twist2D> getCoarseTwists(
+    const nav_2d_msgs::msg::Twist2D & current_velocity) override;
+  std::vector<nav_2d_msgs::msg::Twist2D> getTwistsAround(
+    const nav_2d_msgs::msg::Twist2D & current_velocity,
+    const nav_2d_msgs::msg::Twist2D & center, double fraction) override;
   dwb_msgs::msg::Trajectory2D generateTrajectory(
     const geometry_msgs::msg::Pose2D & start_pose,
     const nav_2d_msgs::msg::Twist2D & start_vel,
@@ -154,6 +154,12 @@ public:
     return current_ > max_vel_ + EPSILON;
   }
 
+  /**
+   * @brief The lowest and highest velocities of the iteration
+   */
+  double getMinVelocity() const {return min_vel_;}
+  double getMaxVelocity() const {return max_vel_;}
+
 private:
   bool return_zero_, return_zero_now_;
   double min_vel_, max_vel_;
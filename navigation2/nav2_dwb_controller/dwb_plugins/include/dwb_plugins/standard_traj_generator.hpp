@@ -35,8 +35,11 @@
 #ifndef DWB_PLUGINS__STANDARD_TRAJ_GENERATOR_HPP_
 #define DWB_PLUGINS__STANDARD_TRAJ_GENERATOR_HPP_
 
-#include <vector>
+#include <array>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "rclcpp/rclcpp.hpp"
 #include "dwb_core/trajectory_generator.hpp"
@@ -50,6 +53,15 @@ namespace dwb_plugins
 /**
  * @class StandardTrajectoryGenerator
  * @brief Standard DWA-like trajectory generator.
+ *
+ * If trajectory_cache_resolution is positive, the current velocity is rounded to that
+ * resolution, so the same twists are sampled while the robot stays in one velocity bucket.
+ * Each trajectory is then simulated once from the origin and cached, and later cycles only
+ * rotate and translate the cached poses to the start pose.
+ *
+ * If analytic_rollout is true, each step moves along the exact arc of its velocity instead
+ * of a straight line, and once the velocity has reached the command the remaining poses are
+ * computed directly from their times rather than step by step.
  */
 class StandardTrajectoryGenerator : public dwb_core::TrajectoryGenerator
 {
@@ -59,6 +71,13 @@ public:
   void startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity) override;
   bool hasMoreTwists() override;
   nav_2d_msgs::msg::Twist2D nextTwist() override;
+  std::vector<nav_2d_msgs::msg::Twist2D> getTwists(
+    const nav_2d_msgs::msg::Twist2D & current_velocity) override;
+  std::vector<nav_2d_msgs::msg::Twist2D> getCoarseTwists(
+    const nav_2d_msgs::msg::Twist2D & current_velocity) override;
+  std::vector<nav_2d_msgs::msg::Twist2D> getTwistsAround(
+    const nav_2d_msgs::msg::Twist2D & current_velocity,
+    const nav_2d_msgs::msg::Twist2D & center, double fraction) override;
 
   dwb_msgs::msg::Trajectory2D generateTrajectory(
     const geometry_msgs::msg::Pose2D & start_pose,
@@ -119,6 +138,40 @@ protected:
    */
   std::vector<double> getTimeSteps(const nav_2d_msgs::msg::Twist2D & cmd_vel);
 
+  /**
+   * @brief Simulate the trajectory from start_pose, as generateTrajectory does without the cache
+   */
+  dwb_msgs::msg::Trajectory2D simulateTrajectory(
+    const geometry_msgs::msg::Pose2D & start_pose,
+    const nav_2d_msgs::msg::Twist2D & start_vel,
+    const nav_2d_msgs::msg::Twist2D & cmd_vel);
+
+  /**
+   * @brief Round each component of a velocity to the trajectory cache resolution
+   */
+  nav_2d_msgs::msg::Twist2D quantizeVelocity(const nav_2d_msgs::msg::Twist2D & velocity) const;
+
+  /**
+   * @brief Every twist the velocity iterator samples in one pass, for getTwists()
+   */
+  std::vector<nav_2d_msgs::msg::Twist2D> sampleTwists(
+    const nav_2d_msgs::msg::Twist2D & current_velocity, double dt);
+
+  /**
+   * @brief The velocity iterator's coarse twists and twists around center, for
+   * getCoarseTwists() and getTwistsAround()
+   */
+  std::vector<nav_2d_msgs::msg::Twist2D> sampleCoarseTwists(
+    const nav_2d_msgs::msg::Twist2D & current_velocity, double dt);
+  std::vector<nav_2d_msgs::msg::Twist2D> sampleTwistsAround(
+    const nav_2d_msgs::msg::Twist2D & current_velocity, double dt,
+    const nav_2d_msgs::msg::Twist2D & center, double fraction);
+
+  /**
+   * @brief The number of evenly spaced time steps getTimeSteps() would return, without allocating them
+   */
+  unsigned int getTimeStepCount(const nav_2d_msgs::msg::Twist2D & cmd_vel) const;
+
   KinematicParameters::Ptr kinematics_;
   std::shared_ptr<VelocityIterator> velocity_iterator_;
 
@@ -135,6 +188,20 @@ protected:
 
   /// @brief If not discretizing by time, the amount of angular space between points
   double angular_granularity_;
+
+  /// @brief Whether steps follow the exact arc of their velocity rather than a straight line
+  bool analytic_rollout_;
+
+  /// @brief Width of the start velocity buckets the cache is keyed by, zero to disable it
+  double cache_resolution_;
+
+  /// @brief Number of cached trajectories at which the cache is emptied and refilled
+  unsigned int cache_size_;
+
+  /// @brief Trajectories from the origin, keyed by the quantized start velocity and the command
+  std::map<std::array<double, 6>, std::shared_ptr<const dwb_msgs::msg::Trajectory2D>>
+  trajectory_cache_;
+  std::mutex cache_mutex_;
 };
 
 
@@ -36,6 +36,7 @@
 #define DWB_PLUGINS__VELOCITY_ITERATOR_HPP_
 
 #include <memory>
+#include <vector>
 
 #include "rclcpp/rclcpp.hpp"
 #include "nav_2d_msgs/msg/twist2_d.hpp"
@@ -44,6 +45,30 @@
 
 namespace dwb_plugins
 {
+
+/**
+ * @struct TwistSamples
+ * @brief A set of twists held as an array per component
+ */
+struct TwistSamples
+{
+  std::vector<double> x, y, theta;
+
+  size_t size() const {return x.size();}
+  void clear()
+  {
+    x.clear();
+    y.clear();
+    theta.clear();
+  }
+  void push_back(const nav_2d_msgs::msg::Twist2D & twist)
+  {
+    x.push_back(twist.x);
+    y.push_back(twist.y);
+    theta.push_back(twist.theta);
+  }
+};
+
 class VelocityIterator
 {
 public:
@@ -54,6 +79,42 @@ public:
   virtual void startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity, double dt) = 0;
   virtual bool hasMoreTwists() = 0;
   virtual nav_2d_msgs::msg::Twist2D nextTwist() = 0;
+
+  /**
+   * @brief Every twist of an iteration at once, in the order the iteration gives them
+   *
+   * Resets the iteration if one is in process.
+   */
+  virtual void sampleTwists(
+    const nav_2d_msgs::msg::Twist2D & current_velocity, double dt, TwistSamples & samples)
+  {
+    samples.clear();
+    startNewIteration(current_velocity, dt);
+    while (hasMoreTwists()) {
+      samples.push_back(nextTwist());
+    }
+  }
+
+  /**
+   * @brief A coarser grid over the same window as sampleTwists(), to start a coarse-to-fine
+   * search; the same twists unless overridden
+   */
+  virtual void sampleCoarseTwists(
+    const nav_2d_msgs::msg::Twist2D & current_velocity, double dt, TwistSamples & samples)
+  {
+    sampleTwists(current_velocity, dt, samples);
+  }
+
+  /**
+   * @brief center and its neighbors on a grid fraction of the coarse spacing apart, those in
+   * the window and valid; none unless overridden
+   */
+  virtual void sampleTwistsAround(
+    const nav_2d_msgs::msg::Twist2D & /*current_velocity*/, double /*dt*/,
+    const nav_2d_msgs::msg::Twist2D & /*center*/, double /*fraction*/, TwistSamples & samples)
+  {
+    samples.clear();
+  }
 };
 }  // namespace dwb_plugins
 
@@ -36,6 +36,7 @@
 #define DWB_PLUGINS__XY_THETA_ITERATOR_HPP_
 
 #include <memory>
+#include <vector>
 
 #include "dwb_plugins/velocity_iterator.hpp"
 #include "dwb_plugins/one_d_velocity_iterator.hpp"
@@ -43,6 +44,20 @@
 
 namespace dwb_plugins
 {
+/**
+ * @class XYThetaIterator
+ * @brief Every combination of the x, y and theta samples that is a valid speed
+ *
+ * sampleTwists() builds the combinations as arrays and checks them all in one pass,
+ * and keeps the result for as long as it is asked for the same current velocity and
+ * time, which the trajectory cache's quantized velocity makes the common case.
+ * It checks the kinematics directly, so a subclass that overrides isValidVelocity()
+ * has to override sampleTwists() as well.
+ *
+ * For a coarse-to-fine search, sampleCoarseTwists() samples each axis about
+ * coarse_sample_factor times more sparsely, and sampleTwistsAround() gives the 3x3x3 grid
+ * around a candidate at a fraction of that spacing.
+ */
 class XYThetaIterator : public VelocityIterator
 {
 public:
@@ -54,14 +69,45 @@ public:
   void startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity, double dt) override;
   bool hasMoreTwists() override;
   nav_2d_msgs::msg::Twist2D nextTwist() override;
+  void sampleTwists(
+    const nav_2d_msgs::msg::Twist2D & current_velocity, double dt,
+    TwistSamples & samples) override;
+  void sampleCoarseTwists(
+    const nav_2d_msgs::msg::Twist2D & current_velocity, double dt,
+    TwistSamples & samples) override;
+  void sampleTwistsAround(
+    const nav_2d_msgs::msg::Twist2D & current_velocity, double dt,
+    const nav_2d_msgs::msg::Twist2D & center, double fraction, TwistSamples & samples) override;
 
 protected:
   virtual bool isValidVelocity();
   void iterateToValidVelocity();
+  /**
+   * @brief Every valid combination of the given numbers of samples per axis
+   */
+  void sampleGrid(
+    const nav_2d_msgs::msg::Twist2D & current_velocity, double dt,
+    int x_samples, int y_samples, int theta_samples, TwistSamples & samples);
+  /// The samples of an axis sampled with num_samples in the coarse grid
+  int coarseSamples(int num_samples) const;
+  /// Keep the combinations_ the kinematics allow in samples
+  void keepValid(TwistSamples & samples);
+
   int vx_samples_, vy_samples_, vtheta_samples_;
+  int coarse_sample_factor_;
   KinematicParameters::Ptr kinematics_;
 
   std::shared_ptr<OneDVelocityIterator> x_it_, y_it_, th_it_;
+
+  /// The valid twists for cached_velocity_ and cached_dt_, if cache_valid_
+  TwistSamples cached_samples_;
+  nav_2d_msgs::msg::Twist2D cached_velocity_;
+  double cached_dt_{0.0};
+  bool cache_valid_{false};
+
+  /// Every combination of the samples, before checking, reused between calls
+  TwistSamples combinations_;
+  std::vector<unsigned char> valid_;
 };
 }  // namespace dwb_plugins
 
@@ -102,4 +102,20 @@ bool KinematicParameters::isValidSpeed(double x, double y, double theta)
   return true;
 }
 
+void KinematicParameters::isValidSpeed(
+  const double * x, const double * y, const double * theta, size_t n,
+  unsigned char * valid)
+{
+  const bool check_max = max_speed_xy_ >= 0.0;
+  const bool check_min = min_speed_xy_ >= 0.0 && min_speed_theta_ >= 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    double vmag_sq = x[i] * x[i] + y[i] * y[i];
+    double abs_theta = fabs(theta[i]);
+    bool too_fast = check_max & (vmag_sq > max_speed_xy_sq_);
+    bool too_slow = check_min & (vmag_sq < min_speed_xy_sq_) & (abs_theta < min_speed_theta_);
+    bool stopped = (vmag_sq == 0.0) & (abs_theta == 0.0);
+    valid[i] = !(too_fast | too_slow | stopped);
+  }
+}
+
 }  // namespace dwb_plugins
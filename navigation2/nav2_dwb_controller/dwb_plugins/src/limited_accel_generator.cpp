@@ -37,6 +37,7 @@
 #include <memory>
 #include "nav_2d_utils/parameters.hpp"
 #include "pluginlib/class_list_macros.hpp"
+#include "dwb_core/arc_rollout.hpp"
 #include "dwb_core/exceptions.hpp"
 
 namespace dwb_plugins
@@ -79,6 +80,25 @@ void LimitedAccelGenerator::startNewIteration(const nav_2d_msgs::msg::Twist2D &
   velocity_iterator_->startNewIteration(current_velocity, acceleration_time_);
 }
 
+std::vector<nav_2d_msgs::msg::Twist2D> LimitedAccelGenerator::getTwists(
+  const nav_2d_msgs::msg::Twist2D & current_velocity)
+{
+  return sampleTwists(current_velocity, acceleration_time_);
+}
+
+std::vector<nav_2d_msgs::msg::Twist2D> LimitedAccelGenerator::getCoarseTwists(
+  const nav_2d_msgs::msg::Twist2D & current_velocity)
+{
+  return sampleCoarseTwists(current_velocity, acceleration_time_);
+}
+
+std::vector<nav_2d_msgs::msg::Twist2D> LimitedAccelGenerator::getTwistsAround(
+  const nav_2d_msgs::msg::Twist2D & current_velocity,
+  const nav_2d_msgs::msg::Twist2D & center, double fraction)
+{
+  return sampleTwistsAround(current_velocity, acceleration_time_, center, fraction);
+}
+
 dwb_msgs::msg::Trajectory2D LimitedAccelGenerator::generateTrajectory(
   const geometry_msgs::msg::Pose2D & start_pose,
   const nav_2d_msgs::msg::Twist2D &,
@@ -87,14 +107,22 @@ dwb_msgs::msg::Trajectory2D LimitedAccelGenerator::generateTrajectory(
   dwb_msgs::msg::Trajectory2D traj;
   traj.velocity = cmd_vel;
   traj.duration = rclcpp::Duration::from_seconds(sim_time_);
-  geometry_msgs::msg::Pose2D pose = start_pose;
 
-  std::vector<double> steps = getTimeSteps(cmd_vel);
-  traj.poses.push_back(start_pose);
-  for (double dt : steps) {
+  unsigned int num_steps = getTimeStepCount(cmd_vel);
+  double dt = sim_time_ / num_steps;
+  traj.poses.resize(num_steps + 1);
+  traj.poses[0] = start_pose;
+  if (analytic_rollout_) {
+    std::vector<double> times(num_steps);
+    for (unsigned int i = 0; i < num_steps; ++i) {
+      times[i] = (i + 1) * dt;
+    }
+    dwb_core::posesAlongArc(start_pose, cmd_vel, times.data(), num_steps, &traj.poses[1]);
+    return traj;
+  }
+  for (unsigned int i = 1; i <= num_steps; ++i) {
     //  update the position using the constant cmd_vel
-    pose = computeNewPosition(pose, cmd_vel, dt);
-    traj.poses.push_back(pose);
+    traj.poses[i] = computeNewPosition(traj.poses[i - 1], cmd_vel, dt);
   }
 
   return traj;
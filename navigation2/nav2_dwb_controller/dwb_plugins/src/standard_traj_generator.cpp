@@ -37,6 +37,7 @@
 #include <vector>
 #include <algorithm>
 #include <memory>
+#include "dwb_core/arc_rollout.hpp"
 #include "dwb_plugins/xy_theta_iterator.hpp"
 #include "nav_2d_utils/parameters.hpp"
 #include "pluginlib/class_list_macros.hpp"
@@ -55,8 +56,17 @@ void StandardTrajectoryGenerator::initialize(const nav2_util::LifecycleNode::Sha
 
   nh->declare_parameter("sim_time", rclcpp::ParameterValue(1.7));
   nh->declare_parameter("discretize_by_time", rclcpp::ParameterValue(false));
+  nh->declare_parameter("trajectory_cache_resolution", rclcpp::ParameterValue(0.0));
+  nh->declare_parameter("trajectory_cache_size", rclcpp::ParameterValue(20000));
+  nh->declare_parameter("analytic_rollout", rclcpp::ParameterValue(false));
 
   nh->get_parameter("sim_time", sim_time_);
+  nh->get_parameter("trajectory_cache_resolution", cache_resolution_);
+  int cache_size;
+  nh->get_parameter("trajectory_cache_size", cache_size);
+  cache_size_ = std::max(cache_size, 1);
+  nh->get_parameter("analytic_rollout", analytic_rollout_);
+  trajectory_cache_.clear();
   checkUseDwaParam(nh);
 
   /*
@@ -100,7 +110,7 @@ void StandardTrajectoryGenerator::checkUseDwaParam(
 void StandardTrajectoryGenerator::startNewIteration(
   const nav_2d_msgs::msg::Twist2D & current_velocity)
 {
-  velocity_iterator_->startNewIteration(current_velocity, sim_time_);
+  velocity_iterator_->startNewIteration(quantizeVelocity(current_velocity), sim_time_);
 }
 
 bool StandardTrajectoryGenerator::hasMoreTwists()
@@ -113,12 +123,67 @@ nav_2d_msgs::msg::Twist2D StandardTrajectoryGenerator::nextTwist()
   return velocity_iterator_->nextTwist();
 }
 
-std::vector<double> StandardTrajectoryGenerator::getTimeSteps(
-  const nav_2d_msgs::msg::Twist2D & cmd_vel)
+std::vector<nav_2d_msgs::msg::Twist2D> StandardTrajectoryGenerator::getTwists(
+  const nav_2d_msgs::msg::Twist2D & current_velocity)
+{
+  return sampleTwists(quantizeVelocity(current_velocity), sim_time_);
+}
+
+std::vector<nav_2d_msgs::msg::Twist2D> StandardTrajectoryGenerator::getCoarseTwists(
+  const nav_2d_msgs::msg::Twist2D & current_velocity)
+{
+  return sampleCoarseTwists(quantizeVelocity(current_velocity), sim_time_);
+}
+
+std::vector<nav_2d_msgs::msg::Twist2D> StandardTrajectoryGenerator::getTwistsAround(
+  const nav_2d_msgs::msg::Twist2D & current_velocity,
+  const nav_2d_msgs::msg::Twist2D & center, double fraction)
+{
+  return sampleTwistsAround(quantizeVelocity(current_velocity), sim_time_, center, fraction);
+}
+
+static std::vector<nav_2d_msgs::msg::Twist2D> toTwists(const TwistSamples & samples)
+{
+  std::vector<nav_2d_msgs::msg::Twist2D> twists(samples.size());
+  for (size_t i = 0; i < twists.size(); ++i) {
+    twists[i].x = samples.x[i];
+    twists[i].y = samples.y[i];
+    twists[i].theta = samples.theta[i];
+  }
+  return twists;
+}
+
+std::vector<nav_2d_msgs::msg::Twist2D> StandardTrajectoryGenerator::sampleTwists(
+  const nav_2d_msgs::msg::Twist2D & current_velocity, double dt)
+{
+  TwistSamples samples;
+  velocity_iterator_->sampleTwists(current_velocity, dt, samples);
+  return toTwists(samples);
+}
+
+std::vector<nav_2d_msgs::msg::Twist2D> StandardTrajectoryGenerator::sampleCoarseTwists(
+  const nav_2d_msgs::msg::Twist2D & current_velocity, double dt)
+{
+  TwistSamples samples;
+  velocity_iterator_->sampleCoarseTwists(current_velocity, dt, samples);
+  return toTwists(samples);
+}
+
+std::vector<nav_2d_msgs::msg::Twist2D> StandardTrajectoryGenerator::sampleTwistsAround(
+  const nav_2d_msgs::msg::Twist2D & current_velocity, double dt,
+  const nav_2d_msgs::msg::Twist2D & center, double fraction)
+{
+  TwistSamples samples;
+  velocity_iterator_->sampleTwistsAround(current_velocity, dt, center, fraction, samples);
+  return toTwists(samples);
+}
+
+unsigned int StandardTrajectoryGenerator::getTimeStepCount(
+  const nav_2d_msgs::msg::Twist2D & cmd_vel) const
 {
-  std::vector<double> steps;
+  int num_steps;
   if (discretize_by_time_) {
-    steps.resize(ceil(sim_time_ / time_granularity_));
+    num_steps = ceil(sim_time_ / time_granularity_);
   } else {  // discretize by distance
     double vmag = hypot(cmd_vel.x, cmd_vel.y);
 
@@ -129,38 +194,120 @@ std::vector<double> StandardTrajectoryGenerator::getTimeSteps(
     double projected_angular_distance = fabs(cmd_vel.theta) * sim_time_;
 
     // Pick the maximum of the two
-    int num_steps = ceil(std::max(projected_linear_distance / linear_granularity_,
+    num_steps = ceil(std::max(projected_linear_distance / linear_granularity_,
         projected_angular_distance / angular_granularity_));
-    steps.resize(num_steps);
   }
-  if (steps.size() == 0) {
-    steps.resize(1);
+  return std::max(num_steps, 1);
+}
+
+std::vector<double> StandardTrajectoryGenerator::getTimeSteps(
+  const nav_2d_msgs::msg::Twist2D & cmd_vel)
+{
+  unsigned int num_steps = getTimeStepCount(cmd_vel);
+  return std::vector<double>(num_steps, sim_time_ / num_steps);
+}
+
+nav_2d_msgs::msg::Twist2D StandardTrajectoryGenerator::quantizeVelocity(
+  const nav_2d_msgs::msg::Twist2D & velocity) const
+{
+  if (cache_resolution_ <= 0.0) {
+    return velocity;
   }
-  std::fill(steps.begin(), steps.end(), sim_time_ / steps.size());
-  return steps;
+  nav_2d_msgs::msg::Twist2D quantized;
+  quantized.x = round(velocity.x / cache_resolution_) * cache_resolution_;
+  quantized.y = round(velocity.y / cache_resolution_) * cache_resolution_;
+  quantized.theta = round(velocity.theta / cache_resolution_) * cache_resolution_;
+  return quantized;
 }
 
 dwb_msgs::msg::Trajectory2D StandardTrajectoryGenerator::generateTrajectory(
   const geometry_msgs::msg::Pose2D & start_pose,
   const nav_2d_msgs::msg::Twist2D & start_vel,
   const nav_2d_msgs::msg::Twist2D & cmd_vel)
+{
+  if (cache_resolution_ <= 0.0) {
+    return simulateTrajectory(start_pose, start_vel, cmd_vel);
+  }
+
+  nav_2d_msgs::msg::Twist2D bucket_vel = quantizeVelocity(start_vel);
+  std::array<double, 6> key = {{bucket_vel.x, bucket_vel.y, bucket_vel.theta,
+    cmd_vel.x, cmd_vel.y, cmd_vel.theta}};
+
+  // the lock only covers the lookup, so that trajectories scored in parallel can be
+  // simulated and placed concurrently
+  std::shared_ptr<const dwb_msgs::msg::Trajectory2D> body;
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    auto it = trajectory_cache_.find(key);
+    if (it != trajectory_cache_.end()) {
+      body = it->second;
+    }
+  }
+  if (!body) {
+    body = std::make_shared<const dwb_msgs::msg::Trajectory2D>(
+      simulateTrajectory(geometry_msgs::msg::Pose2D(), bucket_vel, cmd_vel));
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    if (trajectory_cache_.size() >= cache_size_) {
+      trajectory_cache_.clear();
+    }
+    trajectory_cache_.emplace(key, body);
+  }
+
+  // the motion model is the same at every pose, so a trajectory from the origin only
+  // needs to be moved rigidly onto the start pose
+  dwb_msgs::msg::Trajectory2D traj;
+  traj.velocity = body->velocity;
+  traj.duration = body->duration;
+  traj.poses.resize(body->poses.size());
+  double cos_th = cos(start_pose.theta);
+  double sin_th = sin(start_pose.theta);
+  for (unsigned int i = 0; i < body->poses.size(); ++i) {
+    const geometry_msgs::msg::Pose2D & body_pose = body->poses[i];
+    traj.poses[i].x = start_pose.x + body_pose.x * cos_th - body_pose.y * sin_th;
+    traj.poses[i].y = start_pose.y + body_pose.x * sin_th + body_pose.y * cos_th;
+    traj.poses[i].theta = start_pose.theta + body_pose.theta;
+  }
+  return traj;
+}
+
+dwb_msgs::msg::Trajectory2D StandardTrajectoryGenerator::simulateTrajectory(
+  const geometry_msgs::msg::Pose2D & start_pose,
+  const nav_2d_msgs::msg::Twist2D & start_vel,
+  const nav_2d_msgs::msg::Twist2D & cmd_vel)
 {
   dwb_msgs::msg::Trajectory2D traj;
   traj.velocity = cmd_vel;
   traj.duration = rclcpp::Duration::from_seconds(sim_time_);
   //  simulate the trajectory
-  geometry_msgs::msg::Pose2D pose = start_pose;
   nav_2d_msgs::msg::Twist2D vel = start_vel;
-  std::vector<double> steps = getTimeSteps(cmd_vel);
-  traj.poses.push_back(start_pose);
-  for (double dt : steps) {
+
+  // the steps are evenly spaced, so the poses are sized once and filled in place rather
+  // than growing the vector for each of the thousands of candidates scored per cycle
+  unsigned int num_steps = getTimeStepCount(cmd_vel);
+  double dt = sim_time_ / num_steps;
+  traj.poses.resize(num_steps + 1);
+  traj.poses[0] = start_pose;
+  for (unsigned int i = 1; i <= num_steps; ++i) {
     //  calculate velocities
     vel = computeNewVelocity(cmd_vel, vel, dt);
 
-    //  update the position of the robot using the velocities passed in
-    pose = computeNewPosition(pose, vel, dt);
+    if (analytic_rollout_) {
+      if (vel.x == cmd_vel.x && vel.y == cmd_vel.y && vel.theta == cmd_vel.theta) {
+        // done accelerating, so the rest is one arc from the previous pose
+        std::vector<double> times(num_steps - i + 1);
+        for (unsigned int j = 0; j < times.size(); ++j) {
+          times[j] = (j + 1) * dt;
+        }
+        dwb_core::posesAlongArc(traj.poses[i - 1], cmd_vel, times.data(), times.size(),
+          &traj.poses[i]);
+        break;
+      }
+      traj.poses[i] = dwb_core::poseAlongArc(traj.poses[i - 1], vel, dt);
+      continue;
+    }
 
-    traj.poses.push_back(pose);
+    //  update the position of the robot using the velocities passed in
+    traj.poses[i] = computeNewPosition(traj.poses[i - 1], vel, dt);
   }  //  end for simulation steps
 
   return traj;
@@ -188,11 +335,12 @@ geometry_msgs::msg::Pose2D StandardTrajectoryGenerator::computeNewPosition(
   const geometry_msgs::msg::Pose2D start_pose,
   const nav_2d_msgs::msg::Twist2D & vel, const double dt)
 {
+  // cos(theta + pi/2) is -sin(theta) and sin(theta + pi/2) is cos(theta)
+  double cos_th = cos(start_pose.theta);
+  double sin_th = sin(start_pose.theta);
   geometry_msgs::msg::Pose2D new_pose;
-  new_pose.x = start_pose.x +
-    (vel.x * cos(start_pose.theta) + vel.y * cos(M_PI_2 + start_pose.theta)) * dt;
-  new_pose.y = start_pose.y +
-    (vel.x * sin(start_pose.theta) + vel.y * sin(M_PI_2 + start_pose.theta)) * dt;
+  new_pose.x = start_pose.x + (vel.x * cos_th - vel.y * sin_th) * dt;
+  new_pose.y = start_pose.y + (vel.x * sin_th + vel.y * cos_th) * dt;
   new_pose.theta = start_pose.theta + vel.theta * dt;
   return new_pose;
 }
@@ -33,7 +33,9 @@
  */
 
 #include "dwb_plugins/xy_theta_iterator.hpp"
+#include <algorithm>
 #include <memory>
+#include <vector>
 #include "nav_2d_utils/parameters.hpp"
 
 namespace dwb_plugins
@@ -46,12 +48,16 @@ void XYThetaIterator::initialize(
 
   nh->declare_parameter("vx_samples", rclcpp::ParameterValue(20));
   nh->declare_parameter("vy_samples", rclcpp::ParameterValue(5));
+  nh->declare_parameter("coarse_sample_factor", rclcpp::ParameterValue(4));
 
   nh->get_parameter("vx_samples", vx_samples_);
   nh->get_parameter("vy_samples", vy_samples_);
+  nh->get_parameter("coarse_sample_factor", coarse_sample_factor_);
+  coarse_sample_factor_ = std::max(1, coarse_sample_factor_);
 
   vtheta_samples_ = nav_2d_utils::loadParameterWithDeprecation(nh, "vtheta_samples", "vth_samples",
       20);
+  cache_valid_ = false;
 }
 
 void XYThetaIterator::startNewIteration(
@@ -114,4 +120,152 @@ void XYThetaIterator::iterateToValidVelocity()
   }
 }
 
+/**
+ * @brief Every velocity an iterator gives, in order
+ */
+static void velocitySamples(OneDVelocityIterator it, std::vector<double> & velocities)
+{
+  velocities.clear();
+  for (; !it.isFinished(); ++it) {
+    velocities.push_back(it.getVelocity());
+  }
+}
+
+void XYThetaIterator::sampleTwists(
+  const nav_2d_msgs::msg::Twist2D & current_velocity, double dt,
+  TwistSamples & samples)
+{
+  if (cache_valid_ && dt == cached_dt_ && current_velocity.x == cached_velocity_.x &&
+    current_velocity.y == cached_velocity_.y && current_velocity.theta == cached_velocity_.theta)
+  {
+    samples = cached_samples_;
+    return;
+  }
+
+  sampleGrid(current_velocity, dt, vx_samples_, vy_samples_, vtheta_samples_, cached_samples_);
+  cached_velocity_ = current_velocity;
+  cached_dt_ = dt;
+  cache_valid_ = true;
+  samples = cached_samples_;
+}
+
+void XYThetaIterator::sampleCoarseTwists(
+  const nav_2d_msgs::msg::Twist2D & current_velocity, double dt,
+  TwistSamples & samples)
+{
+  sampleGrid(current_velocity, dt, coarseSamples(vx_samples_), coarseSamples(vy_samples_),
+    coarseSamples(vtheta_samples_), samples);
+}
+
+int XYThetaIterator::coarseSamples(int num_samples) const
+{
+  return std::max(2, (num_samples - 1) / coarse_sample_factor_ + 1);
+}
+
+void XYThetaIterator::sampleGrid(
+  const nav_2d_msgs::msg::Twist2D & current_velocity, double dt,
+  int x_samples, int y_samples, int theta_samples, TwistSamples & samples)
+{
+  std::vector<double> xs, ys, thetas;
+  velocitySamples(OneDVelocityIterator(current_velocity.x,
+    kinematics_->getMinX(), kinematics_->getMaxX(),
+    kinematics_->getAccX(), kinematics_->getDecelX(), dt, x_samples), xs);
+  velocitySamples(OneDVelocityIterator(current_velocity.y,
+    kinematics_->getMinY(), kinematics_->getMaxY(),
+    kinematics_->getAccY(), kinematics_->getDecelY(), dt, y_samples), ys);
+  velocitySamples(OneDVelocityIterator(current_velocity.theta,
+    kinematics_->getMinTheta(), kinematics_->getMaxTheta(),
+    kinematics_->getAccTheta(), kinematics_->getDecelTheta(), dt, theta_samples), thetas);
+
+  // theta varies fastest, then y, then x, the order the iteration gives them in
+  size_t count = xs.size() * ys.size() * thetas.size();
+  combinations_.x.resize(count);
+  combinations_.y.resize(count);
+  combinations_.theta.resize(count);
+  size_t i = 0;
+  for (double x : xs) {
+    for (double y : ys) {
+      for (double theta : thetas) {
+        combinations_.x[i] = x;
+        combinations_.y[i] = y;
+        combinations_.theta[i] = theta;
+        ++i;
+      }
+    }
+  }
+  keepValid(samples);
+}
+
+/**
+ * @brief The values one step either side of center and center itself, those within the
+ * velocities an iterator would sample
+ *
+ * The step is fraction of the spacing of an iterator with coarse_samples samples.
+ */
+static void valuesAround(
+  const OneDVelocityIterator & window, int coarse_samples, double center, double fraction,
+  std::vector<double> & values)
+{
+  values.clear();
+  double min_vel = window.getMinVelocity(), max_vel = window.getMaxVelocity();
+  double step = (max_vel - min_vel) / (coarse_samples - 1) * fraction;
+  for (int side = -1; side <= 1; ++side) {
+    if (side != 0 && step < EPSILON) {
+      continue;
+    }
+    double value = center + side * step;
+    if (value >= min_vel - EPSILON && value <= max_vel + EPSILON) {
+      values.push_back(value);
+    }
+  }
+}
+
+void XYThetaIterator::sampleTwistsAround(
+  const nav_2d_msgs::msg::Twist2D & current_velocity, double dt,
+  const nav_2d_msgs::msg::Twist2D & center, double fraction, TwistSamples & samples)
+{
+  std::vector<double> xs, ys, thetas;
+  valuesAround(OneDVelocityIterator(current_velocity.x,
+    kinematics_->getMinX(), kinematics_->getMaxX(),
+    kinematics_->getAccX(), kinematics_->getDecelX(), dt, vx_samples_),
+    coarseSamples(vx_samples_), center.x, fraction, xs);
+  valuesAround(OneDVelocityIterator(current_velocity.y,
+    kinematics_->getMinY(), kinematics_->getMaxY(),
+    kinematics_->getAccY(), kinematics_->getDecelY(), dt, vy_samples_),
+    coarseSamples(vy_samples_), center.y, fraction, ys);
+  valuesAround(OneDVelocityIterator(current_velocity.theta,
+    kinematics_->getMinTheta(), kinematics_->getMaxTheta(),
+    kinematics_->getAccTheta(), kinematics_->getDecelTheta(), dt, vtheta_samples_),
+    coarseSamples(vtheta_samples_), center.theta, fraction, thetas);
+
+  combinations_.clear();
+  for (double x : xs) {
+    for (double y : ys) {
+      for (double theta : thetas) {
+        combinations_.x.push_back(x);
+        combinations_.y.push_back(y);
+        combinations_.theta.push_back(theta);
+      }
+    }
+  }
+  keepValid(samples);
+}
+
+void XYThetaIterator::keepValid(TwistSamples & samples)
+{
+  size_t count = combinations_.size();
+  valid_.resize(count);
+  kinematics_->isValidSpeed(combinations_.x.data(), combinations_.y.data(),
+    combinations_.theta.data(), count, valid_.data());
+
+  samples.clear();
+  for (size_t i = 0; i < count; ++i) {
+    if (valid_[i]) {
+      samples.x.push_back(combinations_.x[i]);
+      samples.y.push_back(combinations_.y[i]);
+      samples.theta.push_back(combinations_.theta[i]);
+    }
+  }
+}
+
 }  // namespace dwb_plugins
@@ -265,6 +265,62 @@ TEST(VelocityIterator, nonzero)
     0.24622144504490268, 0.0, 0.1);
 }
 
+TEST(VelocityIterator, bulk_matches_iteration)
+{
+  auto nh = makeTestNode("bulk_matches_iteration");
+  nh->set_parameters({rclcpp::Parameter("use_dwa", true)});
+  dwb_plugins::LimitedAccelGenerator gen;
+  gen.initialize(nh);
+  nav_2d_msgs::msg::Twist2D initial;
+  initial.x = 0.1;
+  initial.y = -0.08;
+  initial.theta = 0.05;
+
+  std::vector<nav_2d_msgs::msg::Twist2D> iterated;
+  gen.startNewIteration(initial);
+  while (gen.hasMoreTwists()) {
+    iterated.push_back(gen.nextTwist());
+  }
+
+  // the second call is served from the cache
+  for (int i = 0; i < 2; ++i) {
+    std::vector<nav_2d_msgs::msg::Twist2D> twists = gen.getTwists(initial);
+    ASSERT_EQ(twists.size(), iterated.size());
+    for (size_t j = 0; j < twists.size(); ++j) {
+      EXPECT_EQ(twists[j].x, iterated[j].x);
+      EXPECT_EQ(twists[j].y, iterated[j].y);
+      EXPECT_EQ(twists[j].theta, iterated[j].theta);
+    }
+  }
+}
+
+TEST(VelocityIterator, coarse_to_fine)
+{
+  auto nh = makeTestNode("coarse_to_fine");
+  StandardTrajectoryGenerator gen;
+  gen.initialize(nh);
+
+  // the same window, a fraction of the samples
+  std::vector<nav_2d_msgs::msg::Twist2D> coarse = gen.getCoarseTwists(zero);
+  EXPECT_LT(coarse.size() * 10, gen.getTwists(zero).size());
+  checkLimits(coarse, 0.0, 0.55, -0.1, 0.1, -1.0, 1.0, 0.55, 0.1, 0.4);
+
+  // a step either side is half the coarse spacing: 5 x samples, 2 y and 5 theta
+  nav_2d_msgs::msg::Twist2D center;
+  center.x = 0.275;
+  center.theta = 0.5;
+  std::vector<nav_2d_msgs::msg::Twist2D> around = gen.getTwistsAround(zero, center, 0.5);
+  EXPECT_EQ(around.size(), 27u);
+  checkLimits(around, 0.275 - 0.06875, 0.275 + 0.06875, -0.1, 0.1, 0.25, 0.75);
+
+  // nothing beyond the window, nor faster than max_speed_xy
+  center.x = 0.55;
+  center.y = 0.1;
+  around = gen.getTwistsAround(zero, center, 0.5);
+  EXPECT_EQ(around.size(), 9u);
+  checkLimits(around, 0.55 - 0.06875, 0.55, 0.0, 0.1, 0.25, 0.75);
+}
+
 void matchPose(const geometry_msgs::msg::Pose2D & a, const geometry_msgs::msg::Pose2D & b)
 {
   EXPECT_DOUBLE_EQ(a.x, b.x);
@@ -432,6 +488,30 @@ TEST(TrajectoryGenerator, dwa)
   matchPose(res.poses[4], 1.2, 0, 0);
 }
 
+TEST(TrajectoryGenerator, analytic_arc)
+{
+  auto nh = makeTestNode("analytic_arc");
+  nh->set_parameters({rclcpp::Parameter("use_dwa", true)});
+  nh->set_parameters({rclcpp::Parameter("analytic_rollout", true)});
+  nh->set_parameters({rclcpp::Parameter("discretize_by_time", true)});
+  nh->set_parameters({rclcpp::Parameter("sim_granularity", 0.85)});
+  dwb_plugins::LimitedAccelGenerator gen;
+  gen.initialize(nh);
+
+  nav_2d_msgs::msg::Twist2D cmd = forward;
+  cmd.theta = 0.5;
+  dwb_msgs::msg::Trajectory2D res = gen.generateTrajectory(origin, zero, cmd);
+  ASSERT_EQ(res.poses.size(), 3u);
+  matchPose(res.poses[0], origin);
+  // on the circle of radius 0.6 however coarse the steps
+  for (size_t i = 1; i < res.poses.size(); ++i) {
+    double t = 0.85 * i;
+    EXPECT_NEAR(res.poses[i].x, 0.6 * sin(0.5 * t), 1e-12);
+    EXPECT_NEAR(res.poses[i].y, 0.6 * (1.0 - cos(0.5 * t)), 1e-12);
+    EXPECT_NEAR(res.poses[i].theta, 0.5 * t, 1e-12);
+  }
+}
+
 int main(int argc, char ** argv)
 {
   forward.x = 0.3;
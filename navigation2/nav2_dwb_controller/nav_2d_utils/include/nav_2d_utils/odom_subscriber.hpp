@@ -35,6 +35,7 @@
 #ifndef NAV_2D_UTILS__ODOM_SUBSCRIBER_HPP_
 #define NAV_2D_UTILS__ODOM_SUBSCRIBER_HPP_
 
+#include <algorithm>
 #include <cmath>
 #include <memory>
 #include <mutex>
@@ -42,6 +43,7 @@
 #include "nav_2d_msgs/msg/twist2_d_stamped.hpp"
 #include "nav_msgs/msg/odometry.hpp"
 #include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/motion_history.hpp"
 #include "rclcpp/rclcpp.hpp"
 
 namespace nav_2d_utils
@@ -76,10 +78,22 @@ public:
     nh.get_parameter("min_x_velocity_threshold", min_x_velocity_threshold_);
     nh.get_parameter("min_y_velocity_threshold", min_y_velocity_threshold_);
     nh.get_parameter("min_theta_velocity_threshold", min_theta_velocity_threshold_);
+
+    // The checks on how the robot has been moving read the odometry from here rather than
+    // subscribing again
+    nh.declare_parameter("motion_history_size", rclcpp::ParameterValue(100));
+    int motion_history_size;
+    nh.get_parameter("motion_history_size", motion_history_size);
+    motion_history_ = std::make_shared<nav2_util::MotionHistory>(
+      static_cast<size_t>(std::max(motion_history_size, 3)));
   }
 
   inline nav_2d_msgs::msg::Twist2D getTwist() {return odom_vel_.velocity;}
   inline nav_2d_msgs::msg::Twist2DStamped getTwistStamped() {return odom_vel_;}
+  inline std::shared_ptr<const nav2_util::MotionHistory> getMotionHistory()
+  {
+    return motion_history_;
+  }
 
 protected:
   void odomCallback(const nav_msgs::msg::Odometry::SharedPtr msg)
@@ -93,6 +107,7 @@ protected:
       thresholded_velocity(msg->twist.twist.linear.y, min_y_velocity_threshold_);
     odom_vel_.velocity.theta =
       thresholded_velocity(msg->twist.twist.angular.z, min_theta_velocity_threshold_);
+    motion_history_->push(*msg);
   }
 
   double thresholded_velocity(double velocity, double threshold)
@@ -103,6 +118,7 @@ protected:
   rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
   nav_2d_msgs::msg::Twist2DStamped odom_vel_;
   std::mutex odom_mutex_;
+  std::shared_ptr<nav2_util::MotionHistory> motion_history_;
 
   double min_x_velocity_threshold_;
   double min_y_velocity_threshold_;
@@ -0,0 +1,100 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Locus Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NAV_2D_UTILS__PATH_CACHE_HPP_
+#define NAV_2D_UTILS__PATH_CACHE_HPP_
+
+#include <cstddef>
+#include <vector>
+
+#include "geometry_msgs/msg/pose2_d.hpp"
+#include "nav_2d_msgs/msg/path2_d.hpp"
+
+namespace nav_2d_utils
+{
+/**
+ * @class PathCache
+ * @brief A path with the distance along it to each pose and a grid of the poses near each point
+ *
+ * Built once per path, so that finding the pose at a distance along the path or the first pose
+ * near a point does not walk the whole path every time it is asked.
+ */
+class PathCache
+{
+public:
+  /**
+   * @param cell_size The width of the grid cells the poses are bucketed into, in meters
+   */
+  explicit PathCache(double cell_size = 1.0);
+
+  /**
+   * @brief Replace the path and rebuild the distances and the grid
+   */
+  void setPath(const nav_2d_msgs::msg::Path2D & path);
+
+  const nav_2d_msgs::msg::Path2D & getPath() const {return path_;}
+  size_t size() const {return path_.poses.size();}
+
+  /**
+   * @brief The distance along the path from its first pose to pose index
+   */
+  double distanceAt(size_t index) const {return distances_[index];}
+
+  /**
+   * @brief The first pose at least distance along the path, or size() past the end
+   */
+  size_t indexAtDistance(double distance) const;
+
+  /**
+   * @brief The first pose from begin on that is less than sqrt(sq_distance) from pose
+   * @return Its index, or size() if there is none
+   */
+  size_t firstCloserThan(
+    const geometry_msgs::msg::Pose2D & pose, double sq_distance, size_t begin = 0) const;
+
+private:
+  nav_2d_msgs::msg::Path2D path_;
+  std::vector<double> distances_;
+
+  double cell_size_;  ///< As asked for
+  double cell_size_used_{1.0};  ///< As coarsened for the extent of the path
+  double origin_x_{0.0}, origin_y_{0.0};
+  int cells_x_{0}, cells_y_{0};
+  /// The poses of cell i are cell_poses_[cell_starts_[i]] up to cell_starts_[i + 1], in order
+  std::vector<size_t> cell_starts_;
+  std::vector<size_t> cell_poses_;
+};
+}  // namespace nav_2d_utils
+
+#endif  // NAV_2D_UTILS__PATH_CACHE_HPP_
@@ -134,8 +134,9 @@ nav_2d_msgs::msg::Path2D pathToPath2D(const nav2_msgs::msg::Path & path)
 {
   nav_2d_msgs::msg::Path2D path2d;
   path2d.header = path.header;
-  for (auto & pose : path.poses) {
-    path2d.poses.push_back(poseToPose2D(pose));
+  path2d.poses.resize(path.poses.size());
+  for (unsigned int i = 0; i < path.poses.size(); i++) {
+    path2d.poses[i] = poseToPose2D(path.poses[i]);
   }
   return path2d;
 }
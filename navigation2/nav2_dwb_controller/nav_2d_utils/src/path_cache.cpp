@@ -0,0 +1,146 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Locus Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "nav_2d_utils/path_cache.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace nav_2d_utils
+{
+// The grid is coarsened to keep it to this many cells on a side however long the path
+static const int MAX_CELLS_PER_SIDE = 1024;
+
+PathCache::PathCache(double cell_size)
+: cell_size_(cell_size > 0.0 ? cell_size : 1.0)
+{
+}
+
+void PathCache::setPath(const nav_2d_msgs::msg::Path2D & path)
+{
+  path_ = path;
+  const std::vector<geometry_msgs::msg::Pose2D> & poses = path_.poses;
+  distances_.resize(poses.size());
+  cell_starts_.clear();
+  cell_poses_.clear();
+  cells_x_ = cells_y_ = 0;
+  if (poses.empty()) {
+    return;
+  }
+
+  double min_x = poses[0].x, max_x = poses[0].x, min_y = poses[0].y, max_y = poses[0].y;
+  distances_[0] = 0.0;
+  for (size_t i = 1; i < poses.size(); ++i) {
+    distances_[i] = distances_[i - 1] +
+      std::hypot(poses[i].x - poses[i - 1].x, poses[i].y - poses[i - 1].y);
+    min_x = std::min(min_x, poses[i].x);
+    max_x = std::max(max_x, poses[i].x);
+    min_y = std::min(min_y, poses[i].y);
+    max_y = std::max(max_y, poses[i].y);
+  }
+
+  double cell_size = std::max(cell_size_,
+      std::max(max_x - min_x, max_y - min_y) / MAX_CELLS_PER_SIDE);
+  origin_x_ = min_x;
+  origin_y_ = min_y;
+  cells_x_ = static_cast<int>((max_x - min_x) / cell_size) + 1;
+  cells_y_ = static_cast<int>((max_y - min_y) / cell_size) + 1;
+  cell_size_used_ = cell_size;
+
+  // counted, then filled, so each cell's poses are contiguous and in path order
+  std::vector<size_t> cells(poses.size());
+  cell_starts_.assign(cells_x_ * cells_y_ + 1, 0);
+  for (size_t i = 0; i < poses.size(); ++i) {
+    int cx = std::min(static_cast<int>((poses[i].x - origin_x_) / cell_size), cells_x_ - 1);
+    int cy = std::min(static_cast<int>((poses[i].y - origin_y_) / cell_size), cells_y_ - 1);
+    cells[i] = cy * cells_x_ + cx;
+    ++cell_starts_[cells[i] + 1];
+  }
+  for (size_t c = 1; c < cell_starts_.size(); ++c) {
+    cell_starts_[c] += cell_starts_[c - 1];
+  }
+  cell_poses_.resize(poses.size());
+  std::vector<size_t> fill(cell_starts_.begin(), cell_starts_.end() - 1);
+  for (size_t i = 0; i < poses.size(); ++i) {
+    cell_poses_[fill[cells[i]]++] = i;
+  }
+}
+
+size_t PathCache::indexAtDistance(double distance) const
+{
+  return std::lower_bound(distances_.begin(), distances_.end(), distance) - distances_.begin();
+}
+
+size_t PathCache::firstCloserThan(
+  const geometry_msgs::msg::Pose2D & pose, double sq_distance, size_t begin) const
+{
+  size_t best = size();
+  if (best == 0 || begin >= best || sq_distance <= 0.0) {
+    return best;
+  }
+
+  // the cells the circle around pose overlaps, clipped to the grid
+  double radius = std::sqrt(sq_distance);
+  double low_x = std::floor((pose.x - radius - origin_x_) / cell_size_used_);
+  double high_x = std::floor((pose.x + radius - origin_x_) / cell_size_used_);
+  double low_y = std::floor((pose.y - radius - origin_y_) / cell_size_used_);
+  double high_y = std::floor((pose.y + radius - origin_y_) / cell_size_used_);
+  if (high_x < 0.0 || high_y < 0.0 || low_x >= cells_x_ || low_y >= cells_y_) {
+    return best;
+  }
+  int x0 = static_cast<int>(std::max(low_x, 0.0));
+  int x1 = static_cast<int>(std::min(high_x, cells_x_ - 1.0));
+  int y0 = static_cast<int>(std::max(low_y, 0.0));
+  int y1 = static_cast<int>(std::min(high_y, cells_y_ - 1.0));
+
+  for (int cy = y0; cy <= y1; ++cy) {
+    for (int cx = x0; cx <= x1; ++cx) {
+      size_t cell = cy * cells_x_ + cx;
+      auto first = cell_poses_.begin() + cell_starts_[cell];
+      auto last = cell_poses_.begin() + cell_starts_[cell + 1];
+      for (auto it = std::lower_bound(first, last, begin); it != last && *it < best; ++it) {
+        double dx = path_.poses[*it].x - pose.x;
+        double dy = path_.poses[*it].y - pose.y;
+        if (dx * dx + dy * dy < sq_distance) {
+          best = *it;
+          break;
+        }
+      }
+    }
+  }
+  return best;
+}
+
+}  // namespace nav_2d_utils
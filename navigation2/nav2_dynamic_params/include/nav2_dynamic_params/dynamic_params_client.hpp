@@ -15,10 +15,12 @@
 #ifndef NAV2_DYNAMIC_PARAMS__DYNAMIC_PARAMS_CLIENT_HPP_
 #define NAV2_DYNAMIC_PARAMS__DYNAMIC_PARAMS_CLIENT_HPP_
 
+#include <atomic>
 #include <cstddef>
 #include <map>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include "rclcpp/rclcpp.hpp"
@@ -29,6 +31,25 @@ using namespace std::chrono_literals; // NOLINT
 namespace nav2_dynamic_params
 {
 
+// A dynamic parameter resolved once, which the client keeps up to date from the parameter
+// events. Reading it is a single atomic load, so hot paths can read it every cycle.
+template<class T>
+class DynamicParamHandle
+{
+  static_assert(std::is_arithmetic<T>::value, "Parameter handles hold bool, integer or double");
+
+public:
+  explicit DynamicParamHandle(T value)
+  : value_(value)
+  {}
+
+  T get() const {return value_.load(std::memory_order_relaxed);}
+  void set(T value) {value_.store(value, std::memory_order_relaxed);}
+
+private:
+  std::atomic<T> value_;
+};
+
 class DynamicParamsClient
 {
 public:
@@ -102,6 +123,19 @@ public:
     add_parameters(full_path, param_names);
   }
 
+  // Variant of add_parameters for parameters whose current values are already known, such as
+  // those of a lifecycle node in this process, which are then not fetched from the node
+  void add_known_parameters(
+    const std::string & name_space, const std::string & node_name,
+    const std::vector<rclcpp::Parameter> & params)
+  {
+    auto full_path = join_path(name_space, node_name);
+    add_namespace_event_subscriber(split_path(full_path).first);
+    for (const auto & param : params) {
+      init_param_in_map(param, full_path);
+    }
+  }
+
   // Passes empty vector to add_parameters (which will add all parameters on node)
   void add_parameters_on_node(const std::string full_path)
   {
@@ -196,6 +230,41 @@ public:
       node_->get_namespace(), node_->get_name(), param_name, new_value, default_value);
   }
 
+  // Get a handle on a parameter added to the cached map, holding default_value until it is set.
+  // All the handles an event touches are updated before the user callback, which is called once
+  // per event however many parameters changed.
+  template<class T>
+  std::shared_ptr<const DynamicParamHandle<T>> get_param_handle(
+    const std::string & full_path, const std::string & param_name, const T & default_value)
+  {
+    auto lookup_name = join_path(full_path, param_name);
+    T value = default_value;
+    get_param_from_map<T>(lookup_name, value);
+
+    auto handle = std::make_shared<DynamicParamHandle<T>>(value);
+    handle_updaters_.emplace(lookup_name,
+      [handle](const rclcpp::Parameter & param) {handle->set(param.get_value<T>());});
+    return handle;
+  }
+
+  // Variant of get_param_handle for specifying namespace and node name
+  template<class T>
+  std::shared_ptr<const DynamicParamHandle<T>> get_param_handle(
+    const std::string & name_space, const std::string & node_name,
+    const std::string & param_name, const T & default_value)
+  {
+    return get_param_handle<T>(join_path(name_space, node_name), param_name, default_value);
+  }
+
+  // Variant of get_param_handle for member node parameter
+  template<class T>
+  std::shared_ptr<const DynamicParamHandle<T>> get_param_handle(
+    const std::string & param_name, const T & default_value)
+  {
+    return get_param_handle<T>(
+      node_->get_namespace(), node_->get_name(), param_name, default_value);
+  }
+
   // A check to filter whether parameter name is part of the lastest event
   bool is_in_event(const std::string & path, const std::string & param_name)
   {
@@ -378,6 +447,7 @@ private:
       if (dynamic_param_map_.count(param_name)) {
         auto param = rclcpp::Parameter::from_parameter_msg(new_parameter);
         dynamic_param_map_[param_name] = param;
+        update_handles(param_name, param);
         result = true;
       }
     }
@@ -388,6 +458,7 @@ private:
         auto param = rclcpp::Parameter::from_parameter_msg(changed_parameter);
         if (param.get_type() == dynamic_param_map_[param_name].get_type()) {
           dynamic_param_map_[param_name] = param;
+          update_handles(param_name, param);
           result = true;
         } else {
           RCLCPP_WARN(node_->get_logger(),
@@ -404,10 +475,27 @@ private:
     return result;
   }
 
+  // Store a new value in the handles on a parameter
+  void update_handles(const std::string & name, const rclcpp::Parameter & param)
+  {
+    auto range = handle_updaters_.equal_range(name);
+    for (auto it = range.first; it != range.second; ++it) {
+      try {
+        it->second(param);
+      } catch (const rclcpp::ParameterTypeException &) {
+        RCLCPP_WARN(node_->get_logger(),
+          "Un-matching type for parameter handle: %s", name.c_str());
+      }
+    }
+  }
+
   // Cached Map of dynamic parameters. Parameter values are initialized
   // from remote nodes if the parameter exists
   std::map<std::string, rclcpp::Parameter> dynamic_param_map_;
 
+  // Setters of the handles on each parameter, by full parameter name
+  std::multimap<std::string, std::function<void(const rclcpp::Parameter &)>> handle_updaters_;
+
   // Map to store parameter clients to remote nodes
   std::map<std::string, rclcpp::SyncParametersClient::SharedPtr> parameters_clients_;
 
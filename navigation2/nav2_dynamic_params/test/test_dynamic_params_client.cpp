@@ -57,6 +57,11 @@ public:
     event->node = path;
     event_callback(event);
   }
+
+  void call_event(rcl_interfaces::msg::ParameterEvent::SharedPtr event)
+  {
+    event_callback(event);
+  }
 };
 
 class ClientTest : public ::testing::Test
@@ -202,3 +207,34 @@ TEST_F(ClientTest, testEventCallbacks)
   dynamic_params_client_->get_event_param("baz", baz);
   EXPECT_EQ(2, baz);
 }
+
+TEST_F(ClientTest, testParamHandles)
+{
+  node_->set_parameters({rclcpp::Parameter("baz", 4)});
+  dynamic_params_client_->add_parameters({"baz", "foobaz"});
+
+  auto baz = dynamic_params_client_->get_param_handle("baz", 0);
+  auto foobaz = dynamic_params_client_->get_param_handle("foobaz", 1.5);
+  auto unregistered = dynamic_params_client_->get_param_handle("qux", true);
+  EXPECT_EQ(4, baz->get());
+  EXPECT_EQ(1.5, foobaz->get());
+  EXPECT_EQ(true, unregistered->get());
+
+  int callbacks = 0;
+  dynamic_params_client_->set_callback([&callbacks]() {++callbacks;}, false);
+
+  // Both handles are updated by one event, with a single callback
+  auto event = std::make_shared<rcl_interfaces::msg::ParameterEvent>();
+  event->node = "/dynamic_param_client_test";
+  event->changed_parameters.push_back(rclcpp::Parameter("baz", 6).to_parameter_msg());
+  event->new_parameters.push_back(rclcpp::Parameter("foobaz", 2.5).to_parameter_msg());
+  dynamic_params_client_->call_event(event);
+  EXPECT_EQ(1, callbacks);
+  EXPECT_EQ(6, baz->get());
+  EXPECT_EQ(2.5, foobaz->get());
+
+  // A value of another type leaves the handle as it was
+  dynamic_params_client_->call_test_event(
+    "/dynamic_param_client_test", rclcpp::Parameter("foobaz", "hello"), true);
+  EXPECT_EQ(2.5, foobaz->get());
+}
@@ -17,6 +17,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -24,6 +25,9 @@
 #include "nav2_util/lifecycle_service_client.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "std_srvs/srv/empty.hpp"
+#include "nav2_msgs/msg/startup_phase.hpp"
+#include "nav2_msgs/msg/startup_report.hpp"
+#include "nav2_msgs/srv/get_startup_report.hpp"
 #include "nav2_msgs/srv/manage_lifecycle_nodes.hpp"
 
 namespace nav2_lifecycle_manager
@@ -44,6 +48,9 @@ protected:
   // The services provided by this node
   rclcpp::Service<ManageLifecycleNodes>::SharedPtr manager_srv_;
 
+  // The report of the last bringup, published once every node is active
+  rclcpp::Publisher<nav2_msgs::msg::StartupReport>::SharedPtr startup_report_pub_;
+
   void managerCallback(
     const std::shared_ptr<rmw_request_id_t> request_header,
     const std::shared_ptr<ManageLifecycleNodes::Request> request,
@@ -59,6 +66,9 @@ protected:
   // Support function for creating service clients
   void createLifecycleServiceClients();
 
+  // Group node_names_ into node_levels_ from the node_levels parameter
+  void createNodeLevels();
+
   // Support functions for shutdown
   void shutdownAllNodes();
   void destroyLifecycleServiceClients();
@@ -69,6 +79,12 @@ protected:
   // For each node in the map, transition to the new target state
   bool changeStateForAllNodes(std::uint8_t transition, bool reverse_order = false);
 
+  // For each node of a level, transition to the new target state, concurrently in parallel mode
+  bool changeStateForLevel(const std::vector<std::string> & level, std::uint8_t transition);
+
+  // Publish how long the nodes took to come up, collecting the phases each of them timed
+  void publishStartupReport(double total_seconds);
+
   // Convenience function to highlight the output on the console
   void message(const std::string & msg);
 
@@ -83,8 +99,22 @@ protected:
   // The names of the nodes to be managed, in the order of desired bring-up
   std::vector<std::string> node_names_;
 
+  // node_names_ grouped by dependency level, a node only depending on the nodes of the earlier
+  // levels. Without parallel bringup, every node is a level of its own.
+  std::vector<std::vector<std::string>> node_levels_;
+
+  // Whether to transition the nodes of a level concurrently
+  bool parallel_bringup_;
+
   // Whether to automatically start up the system
   bool autostart_;
+
+  // Whether a reset leaves the nodes configured, for the next startup to just activate them
+  bool warm_reset_;
+
+  // The transitions of the current bringup, as timed from here
+  std::mutex startup_mutex_;
+  std::vector<nav2_msgs::msg::StartupPhase> startup_transitions_;
 };
 
 }  // namespace nav2_lifecycle_manager
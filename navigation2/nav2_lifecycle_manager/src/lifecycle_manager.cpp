@@ -15,8 +15,12 @@
 #include "nav2_lifecycle_manager/lifecycle_manager.hpp"
 
 #include <chrono>
+#include <cstdint>
+#include <future>
+#include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "rclcpp/rclcpp.hpp"
@@ -45,12 +49,27 @@ LifecycleManager::LifecycleManager()
   declare_parameter("node_names", rclcpp::ParameterValue(default_node_names));
   declare_parameter("autostart", rclcpp::ParameterValue(false));
 
+  // With parallel_bringup, the nodes of the same level in node_levels, one per node in
+  // node_names, change state at the same time, the lower levels before the higher ones
+  declare_parameter("parallel_bringup", rclcpp::ParameterValue(false));
+  declare_parameter("node_levels", rclcpp::ParameterValue(std::vector<int64_t>()));
+
+  // With warm_reset, a reset only deactivates the nodes, which keep their maps, costmap layers
+  // and plugins in standby, and the next startup only activates them again
+  declare_parameter("warm_reset", rclcpp::ParameterValue(false));
+
   get_parameter("node_names", node_names_);
   get_parameter("autostart", autostart_);
+  get_parameter("parallel_bringup", parallel_bringup_);
+  get_parameter("warm_reset", warm_reset_);
 
   manager_srv_ = create_service<ManageLifecycleNodes>("lifecycle_manager/manage_nodes",
       std::bind(&LifecycleManager::managerCallback, this, _1, _2, _3));
 
+  startup_report_pub_ = create_publisher<nav2_msgs::msg::StartupReport>(
+    "lifecycle_manager/startup_report",
+    rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable());
+
   auto options = rclcpp::NodeOptions().arguments(
     {"--ros-args", std::string("__node:=") + get_name() + "service_client", "--"});
   service_client_node_ = std::make_shared<rclcpp::Node>("_", options);
@@ -69,6 +88,7 @@ LifecycleManager::LifecycleManager()
   transition_label_map_[Transition::TRANSITION_UNCONFIGURED_SHUTDOWN] =
     std::string("Shutting down ");
 
+  createNodeLevels();
   createLifecycleServiceClients();
 
   if (autostart_) {
@@ -111,8 +131,42 @@ LifecycleManager::createLifecycleServiceClients()
 {
   message("Creating and initializing lifecycle service clients");
   for (auto & node_name : node_names_) {
-    node_map_[node_name] =
-      std::make_shared<LifecycleServiceClient>(node_name, service_client_node_);
+    if (parallel_bringup_) {
+      // Each client spins its own node, so that they can wait on their nodes concurrently
+      node_map_[node_name] = std::make_shared<LifecycleServiceClient>(node_name);
+    } else {
+      node_map_[node_name] =
+        std::make_shared<LifecycleServiceClient>(node_name, service_client_node_);
+    }
+  }
+}
+
+void
+LifecycleManager::createNodeLevels()
+{
+  std::vector<int64_t> levels;
+  get_parameter("node_levels", levels);
+
+  if (parallel_bringup_ && levels.size() != node_names_.size()) {
+    RCLCPP_WARN(get_logger(), "node_levels has %zu levels for %zu nodes, "
+      "bringing the nodes up one at a time", levels.size(), node_names_.size());
+    parallel_bringup_ = false;
+  }
+
+  node_levels_.clear();
+  if (!parallel_bringup_) {
+    for (auto & node_name : node_names_) {
+      node_levels_.push_back({node_name});
+    }
+    return;
+  }
+
+  std::map<int64_t, std::vector<std::string>> by_level;
+  for (size_t i = 0; i < node_names_.size(); ++i) {
+    by_level[levels[i]].push_back(node_names_[i]);
+  }
+  for (auto & kv : by_level) {
+    node_levels_.push_back(kv.second);
   }
 }
 
@@ -128,30 +182,83 @@ LifecycleManager::destroyLifecycleServiceClients()
 bool
 LifecycleManager::changeStateForNode(const std::string & node_name, std::uint8_t transition)
 {
-  message(transition_label_map_[transition] + node_name);
-  if (!node_map_[node_name]->change_state(transition) ||
-    !(node_map_[node_name]->get_state() == transition_state_map_[transition]))
+  // A node left in standby by a warm reset is still configured
+  if (warm_reset_ && transition == Transition::TRANSITION_CONFIGURE &&
+    node_map_.at(node_name)->get_state() == State::PRIMARY_STATE_INACTIVE)
+  {
+    message(node_name + " is in standby, skipping its configuration");
+    return true;
+  }
+
+  message(transition_label_map_.at(transition) + node_name);
+  auto start = std::chrono::steady_clock::now();
+
+  if (!node_map_.at(node_name)->change_state(transition) ||
+    !(node_map_.at(node_name)->get_state() == transition_state_map_.at(transition)))
   {
     RCLCPP_ERROR(get_logger(), "Failed to change state for node: %s", node_name.c_str());
     return false;
   }
 
+  double seconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  RCLCPP_INFO(get_logger(), "%s%s took %.1f ms", transition_label_map_.at(transition).c_str(),
+    node_name.c_str(), seconds * 1e3);
+
+  if (transition == Transition::TRANSITION_CONFIGURE ||
+    transition == Transition::TRANSITION_ACTIVATE)
+  {
+    nav2_msgs::msg::StartupPhase phase;
+    phase.node = node_name;
+    phase.phase = transition == Transition::TRANSITION_CONFIGURE ? "configure" : "activate";
+    phase.seconds = seconds;
+
+    std::lock_guard<std::mutex> lock(startup_mutex_);
+    startup_transitions_.push_back(phase);
+  }
   return true;
 }
 
+bool
+LifecycleManager::changeStateForLevel(
+  const std::vector<std::string> & level, std::uint8_t transition)
+{
+  if (!parallel_bringup_ || level.size() == 1) {
+    for (auto & node_name : level) {
+      if (!changeStateForNode(node_name, transition)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::vector<std::future<bool>> results;
+  for (auto & node_name : level) {
+    results.push_back(std::async(std::launch::async,
+      [this, &node_name, transition]() {return changeStateForNode(node_name, transition);}));
+  }
+
+  // Wait for every node of the level, even once one has failed
+  bool success = true;
+  for (auto & result : results) {
+    success = result.get() && success;
+  }
+  return success;
+}
+
 bool
 LifecycleManager::changeStateForAllNodes(std::uint8_t transition, bool reverse_order)
 {
   if (!reverse_order) {
-    for (auto & node_name : node_names_) {
-      if (!changeStateForNode(node_name, transition)) {
+    for (auto & level : node_levels_) {
+      if (!changeStateForLevel(level, transition)) {
         return false;
       }
     }
   } else {
-    std::vector<std::string>::reverse_iterator rit;
-    for (rit = node_names_.rbegin(); rit != node_names_.rend(); ++rit) {
-      if (!changeStateForNode(*rit, transition)) {
+    std::vector<std::vector<std::string>>::reverse_iterator rit;
+    for (rit = node_levels_.rbegin(); rit != node_levels_.rend(); ++rit) {
+      if (!changeStateForLevel(*rit, transition)) {
         return false;
       }
     }
@@ -173,12 +280,20 @@ bool
 LifecycleManager::startup()
 {
   message("Starting the system bringup...");
+  {
+    std::lock_guard<std::mutex> lock(startup_mutex_);
+    startup_transitions_.clear();
+  }
+  auto start = std::chrono::steady_clock::now();
   if (!changeStateForAllNodes(Transition::TRANSITION_CONFIGURE) ||
     !changeStateForAllNodes(Transition::TRANSITION_ACTIVATE))
   {
     RCLCPP_ERROR(get_logger(), "Failed to bring up nodes: aborting bringup");
     return false;
   }
+  double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  RCLCPP_INFO(get_logger(), "Bringup took %.1f ms", total * 1e3);
+  publishStartupReport(total);
   message("The system is active");
   return true;
 }
@@ -198,12 +313,12 @@ LifecycleManager::reset()
 {
   message("Resetting the system...");
   if (!changeStateForAllNodes(Transition::TRANSITION_DEACTIVATE) ||
-    !changeStateForAllNodes(Transition::TRANSITION_CLEANUP))
+    (!warm_reset_ && !changeStateForAllNodes(Transition::TRANSITION_CLEANUP)))
   {
     RCLCPP_ERROR(get_logger(), "Failed to reset nodes: aborting reset");
     return false;
   }
-  message("The system is reset");
+  message(warm_reset_ ? "The system is in standby" : "The system is reset");
   return true;
 }
 
@@ -231,6 +346,42 @@ LifecycleManager::resume()
   return true;
 }
 
+void
+LifecycleManager::publishStartupReport(double total_seconds)
+{
+  auto report = std::make_unique<nav2_msgs::msg::StartupReport>();
+  report->header.stamp = now();
+  report->total_seconds = total_seconds;
+  {
+    std::lock_guard<std::mutex> lock(startup_mutex_);
+    report->phases = startup_transitions_;
+  }
+
+  for (auto & node_name : node_names_) {
+    // Only nav2_util::LifecycleNodes time their own phases
+    auto client = service_client_node_->create_client<nav2_msgs::srv::GetStartupReport>(
+      node_name + "/get_startup_report");
+    if (!client->wait_for_service(1s)) {
+      RCLCPP_DEBUG(get_logger(), "%s has no startup report", node_name.c_str());
+      continue;
+    }
+
+    auto future_result =
+      client->async_send_request(std::make_shared<nav2_msgs::srv::GetStartupReport::Request>());
+    if (rclcpp::spin_until_future_complete(service_client_node_, future_result, 1s) !=
+      rclcpp::executor::FutureReturnCode::SUCCESS)
+    {
+      RCLCPP_WARN(get_logger(), "Couldn't get the startup report of %s", node_name.c_str());
+      continue;
+    }
+
+    auto & phases = future_result.get()->phases;
+    report->phases.insert(report->phases.end(), phases.begin(), phases.end());
+  }
+
+  startup_report_pub_->publish(std::move(report));
+}
+
 // TODO(mjeronimo): This is used to emphasize the major events during system bring-up and
 // shutdown so that the messgaes can be easily seen among the log output. We should replace
 // this with a ROS2-supported way of highlighting console output, if possible.
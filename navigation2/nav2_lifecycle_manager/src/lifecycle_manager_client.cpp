@@ -14,8 +14,10 @@
 
 #include "nav2_lifecycle_manager/lifecycle_manager_client.hpp"
 
+#include <chrono>
 #include <cmath>
 #include <memory>
+#include <thread>
 
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
 #include "nav2_util/geometry_utils.hpp"
@@ -86,6 +88,14 @@ LifecycleManagerClient::set_initial_pose(double x, double y, double theta)
   pose.pose.covariance[6 * 1 + 1] = 0.5 * 0.5;
   pose.pose.covariance[6 * 5 + 5] = PI / 12.0 * PI / 12.0;
 
+  // A pose published before AMCL has subscribed would be lost
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (rclcpp::ok() && initial_pose_publisher_->get_subscription_count() == 0 &&
+    std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
   initial_pose_publisher_->publish(pose);
 }
 
@@ -0,0 +1,32 @@
+# Copyright (c) 2019 Intel Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# CMake script for finding the LZ4 compression library
+#
+# Output variables:
+#  LZ4_FOUND        - system has LZ4
+#  LZ4_INCLUDE_DIRS - include directories for LZ4
+#  LZ4_LIBRARIES    - libraries you need to link to
+include(FindPackageHandleStandardArgs)
+
+find_path(LZ4_INCLUDE_DIRS
+  NAMES "lz4.h")
+
+find_library(LZ4_LIBRARIES
+  NAMES "lz4")
+
+find_package_handle_standard_args(
+  LZ4
+  LZ4_LIBRARIES
+  LZ4_INCLUDE_DIRS)
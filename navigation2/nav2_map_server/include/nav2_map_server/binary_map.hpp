@@ -0,0 +1,110 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_MAP_SERVER__BINARY_MAP_HPP_
+#define NAV2_MAP_SERVER__BINARY_MAP_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "nav_msgs/msg/occupancy_grid.hpp"
+
+namespace nav2_map_server
+{
+
+// The header of a binary map file. It is followed, for an untiled map, by the width * height
+// cells of the map in the order of OccupancyGrid::data, or, for a tiled map, by a table of
+// BinaryMapTile, one per tile row by row, and then by the tiles. Each tile holds its cells row
+// by row, the tiles at the right and top edges being clipped to the map. All numbers are in
+// the byte order of the machine that wrote the file, and a file of the other byte order is
+// rejected through its version.
+struct BinaryMapHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t tile_size;    // cells on a side of a tile, 0 for an untiled map
+  uint32_t compression;  // a BinaryMapCompression
+  uint32_t reserved;
+  double resolution;
+  double origin_x;
+  double origin_y;
+  double origin_yaw;
+};
+static_assert(sizeof(BinaryMapHeader) == 64, "BinaryMapHeader must not be padded");
+
+enum class BinaryMapCompression : uint32_t
+{
+  None = 0,
+  LZ4 = 1,  // each tile is an LZ4 block
+};
+
+struct BinaryMapTile
+{
+  uint64_t offset;  // from the start of the file
+  uint64_t size;    // in the file, after compression
+};
+
+// A binary map file mapped into memory, read only, so that the nodes loading the same map
+// share its pages. The cells are copied out of the mapping, whole or a tile at a time.
+class BinaryMap
+{
+public:
+  // Map filename and check its header and tile table
+  /// @throw std::runtime_error
+  explicit BinaryMap(const std::string & filename);
+  ~BinaryMap();
+
+  BinaryMap(const BinaryMap &) = delete;
+  BinaryMap & operator=(const BinaryMap &) = delete;
+
+  // Whether filename starts as a binary map file does
+  static bool isBinaryMap(const std::string & filename);
+
+  // Write map to filename, in tiles of tile_size cells on a side unless tile_size is 0, each
+  // compressed with LZ4 if compress is true. compress requires a tiled map.
+  /// @throw std::runtime_error
+  static void write(
+    const std::string & filename, const nav_msgs::msg::OccupancyGrid & map,
+    uint32_t tile_size = 0, bool compress = false);
+
+  const BinaryMapHeader & header() const {return *header_;}
+
+  unsigned int tilesX() const;
+  unsigned int tilesY() const;
+
+  // Copy all the cells, in the order of OccupancyGrid::data. cells must hold width * height.
+  /// @throw std::runtime_error
+  void read(int8_t * cells) const;
+
+  // Copy the cells of the tile at column tx and row ty into cells, row by row, and return the
+  // width and height of the tile. An untiled map is a single tile.
+  /// @throw std::runtime_error
+  void readTile(
+    unsigned int tx, unsigned int ty, std::vector<int8_t> & cells,
+    unsigned int & tile_width, unsigned int & tile_height) const;
+
+protected:
+  const uint8_t * data_{nullptr};
+  size_t size_{0};
+  const BinaryMapHeader * header_{nullptr};
+  const BinaryMapTile * tiles_{nullptr};
+};
+
+}  // namespace nav2_map_server
+
+#endif  // NAV2_MAP_SERVER__BINARY_MAP_HPP_
@@ -36,6 +36,10 @@ protected:
 
   void try_write_map_to_file(const nav_msgs::msg::OccupancyGrid & map);
 
+  // Write the image of map to a PGM or PNG file a band of rows at a time, converting the rows
+  // of a band in parallel, without building the whole image
+  void writeStreaming(const nav_msgs::msg::OccupancyGrid & map, const std::string & filename) const;
+
   std::promise<void> save_next_map_promise;
 
   std::string image_format;
@@ -43,6 +47,10 @@ protected:
   int threshold_occupied_;
   int threshold_free_;
   nav2_map_server::MapMode map_mode;
+
+  // The tiles, and their compression, of a map saved in the binary format
+  int binary_tile_size_;
+  bool binary_compression_;
 };
 
 }  // namespace nav2_map_server
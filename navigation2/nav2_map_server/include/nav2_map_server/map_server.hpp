@@ -25,7 +25,7 @@ namespace nav2_map_server
 class MapServer : public nav2_util::LifecycleNode
 {
 public:
-  MapServer();
+  explicit MapServer(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   ~MapServer();
 
 protected:
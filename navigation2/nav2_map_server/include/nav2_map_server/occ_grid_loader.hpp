@@ -15,12 +15,15 @@
 #ifndef NAV2_MAP_SERVER__OCC_GRID_LOADER_HPP_
 #define NAV2_MAP_SERVER__OCC_GRID_LOADER_HPP_
 
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 #include "nav2_map_server/occ_grid_loader.hpp"
 
 #include "map_mode.hpp"
+#include "nav2_msgs/srv/get_map_tile.hpp"
+#include "nav2_msgs/srv/switch_map.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 #include "nav_msgs/msg/occupancy_grid.hpp"
 #include "nav_msgs/srv/get_map.hpp"
@@ -62,17 +65,46 @@ protected:
   /// @throw YAML::Exception
   LoadParameters load_map_yaml(const std::string & yaml_filename_);
 
-  // Load the image and generate an OccupancyGrid
-  void loadMapFromFile(const LoadParameters & loadParameters);
+  // Load the image and generate an OccupancyGrid. Images of up to 8 bits per channel are
+  // decoded in bulk unless allow_bulk_decoding is false, deeper ones pixel by pixel. A binary
+  // map is copied as it is, with the resolution and origin of its header.
+  void loadMapFromFile(const LoadParameters & loadParameters, bool allow_bulk_decoding = true);
+
+  // Load the maps of the node's map_ids and map_yaml_filenames parameters into cached_maps_
+  void loadCachedMaps();
+
+  // Fill msg with the cells and geometry of the binary map filename
+  void loadBinaryMap(const std::string & filename, nav_msgs::msg::OccupancyGrid & msg);
+
+  // Fill msg with the cells of the image, converted by loadParameters
+  void decodeImage(
+    const LoadParameters & loadParameters, bool allow_bulk_decoding,
+    nav_msgs::msg::OccupancyGrid & msg);
+
+  // Fill tile with the cells of the map in the region of request, at its zoom level
+  void getMapTile(
+    const nav2_msgs::srv::GetMapTile::Request & request,
+    nav_msgs::msg::OccupancyGrid & tile) const;
 
   // A service to provide the occupancy grid (GetMap) and the message to return
   rclcpp::Service<nav_msgs::srv::GetMap>::SharedPtr occ_service_;
 
+  // A service to provide regions of the occupancy grid, so that a node need not take it whole
+  rclcpp::Service<nav2_msgs::srv::GetMapTile>::SharedPtr tile_service_;
+
   // A topic on which the occupancy grid will be published
   rclcpp_lifecycle::LifecyclePublisher<nav_msgs::msg::OccupancyGrid>::SharedPtr occ_pub_;
 
   // The message to publish on the occupancy grid topic
-  std::unique_ptr<nav_msgs::msg::OccupancyGrid> msg_;
+  std::shared_ptr<nav_msgs::msg::OccupancyGrid> msg_;
+
+  // The preloaded maps by ID, which switch_map makes msg_ without loading anything
+  std::map<std::string, std::shared_ptr<nav_msgs::msg::OccupancyGrid>> cached_maps_;
+  rclcpp::Service<nav2_msgs::srv::SwitchMap>::SharedPtr switch_service_;
+
+  // A topic on which the preloaded maps are published once, so that the nodes using the map
+  // can prepare for every one of them before a switch
+  rclcpp_lifecycle::LifecyclePublisher<nav_msgs::msg::OccupancyGrid>::SharedPtr cache_pub_;
 
   // The frame ID used in the returned OccupancyGrid message
   static constexpr const char * frame_id_{"map"};
@@ -83,6 +115,16 @@ protected:
   // The name of the service for getting a map
   static constexpr const char * service_name_{"map"};
 
+  // The name of the service for getting a region of the map
+  static constexpr const char * tile_service_name_{"map_tile"};
+
+  // The names of the service switching between the preloaded maps and of their topic
+  static constexpr const char * switch_service_name_{"switch_map"};
+  static constexpr const char * cache_topic_name_{"map_cache"};
+
+  // The coarsest zoom level served, at which a tile cell merges 2^max_zoom_ cells on a side
+  static constexpr unsigned int max_zoom_{16};
+
   // Timer for republishing map
   rclcpp::TimerBase::SharedPtr timer_;
 };
@@ -0,0 +1,314 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_map_server/binary_map.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "lz4.h"
+#include "tf2/LinearMath/Matrix3x3.h"
+#include "tf2/LinearMath/Quaternion.h"
+
+namespace nav2_map_server
+{
+
+namespace
+{
+
+const char kMagic[8] = {'N', 'A', 'V', '2', 'M', 'A', 'P', '\0'};
+const uint32_t kVersion = 1;
+
+// The first column and row of the tile at column tx and row ty, and its size
+void tileBounds(
+  const BinaryMapHeader & header, unsigned int tx, unsigned int ty,
+  unsigned int & x0, unsigned int & y0, unsigned int & width, unsigned int & height)
+{
+  if (!header.tile_size) {
+    x0 = y0 = 0;
+    width = header.width;
+    height = header.height;
+    return;
+  }
+  x0 = tx * header.tile_size;
+  y0 = ty * header.tile_size;
+  width = std::min(header.tile_size, header.width - x0);
+  height = std::min(header.tile_size, header.height - y0);
+}
+
+}  // namespace
+
+BinaryMap::BinaryMap(const std::string & filename)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open " + filename + ": " + strerror(errno));
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    std::string error = strerror(errno);
+    close(fd);
+    throw std::runtime_error("Failed to stat " + filename + ": " + error);
+  }
+  size_ = file_stat.st_size;
+  if (size_ < sizeof(BinaryMapHeader)) {
+    close(fd);
+    throw std::runtime_error(filename + " is too short to be a binary map");
+  }
+
+  void * data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  std::string error = strerror(errno);
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("Failed to map " + filename + ": " + error);
+  }
+  data_ = static_cast<const uint8_t *>(data);
+  header_ = reinterpret_cast<const BinaryMapHeader *>(data_);
+
+  try {
+    if (std::memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0) {
+      throw std::runtime_error("not a binary map");
+    }
+    if (header_->version != kVersion) {
+      throw std::runtime_error(
+              "unsupported version " + std::to_string(header_->version) +
+              ", or a file of the other byte order");
+    }
+    auto compression = static_cast<BinaryMapCompression>(header_->compression);
+    if (compression != BinaryMapCompression::None && compression != BinaryMapCompression::LZ4) {
+      throw std::runtime_error("unknown compression " + std::to_string(header_->compression));
+    }
+    if (compression != BinaryMapCompression::None && !header_->tile_size) {
+      throw std::runtime_error("an untiled map cannot be compressed");
+    }
+
+    if (!header_->tile_size) {
+      if (size_ - sizeof(BinaryMapHeader) <
+        static_cast<uint64_t>(header_->width) * header_->height)
+      {
+        throw std::runtime_error("truncated cells");
+      }
+    } else {
+      uint64_t tiles = static_cast<uint64_t>(tilesX()) * tilesY();
+      uint64_t tiles_end = sizeof(BinaryMapHeader) + tiles * sizeof(BinaryMapTile);
+      if (tiles_end > size_) {
+        throw std::runtime_error("truncated tile table");
+      }
+      tiles_ = reinterpret_cast<const BinaryMapTile *>(data_ + sizeof(BinaryMapHeader));
+      for (unsigned int ty = 0; ty < tilesY(); ++ty) {
+        for (unsigned int tx = 0; tx < tilesX(); ++tx) {
+          const BinaryMapTile & tile = tiles_[ty * tilesX() + tx];
+          if (tile.offset < tiles_end || tile.offset > size_ || tile.size > size_ - tile.offset) {
+            throw std::runtime_error("tile outside of the file");
+          }
+          unsigned int x0, y0, width, height;
+          tileBounds(*header_, tx, ty, x0, y0, width, height);
+          if (compression == BinaryMapCompression::None &&
+            tile.size != static_cast<uint64_t>(width) * height)
+          {
+            throw std::runtime_error("tile of the wrong size");
+          }
+        }
+      }
+    }
+  } catch (std::runtime_error & e) {
+    munmap(const_cast<uint8_t *>(data_), size_);
+    throw std::runtime_error("Invalid binary map " + filename + ": " + e.what());
+  }
+}
+
+BinaryMap::~BinaryMap()
+{
+  munmap(const_cast<uint8_t *>(data_), size_);
+}
+
+bool BinaryMap::isBinaryMap(const std::string & filename)
+{
+  char magic[sizeof(kMagic)];
+  std::ifstream file(filename, std::ios::binary);
+  return file.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(magic)) == 0;
+}
+
+unsigned int BinaryMap::tilesX() const
+{
+  return header_->tile_size ?
+         (header_->width + header_->tile_size - 1) / header_->tile_size : 1;
+}
+
+unsigned int BinaryMap::tilesY() const
+{
+  return header_->tile_size ?
+         (header_->height + header_->tile_size - 1) / header_->tile_size : 1;
+}
+
+void BinaryMap::read(int8_t * cells) const
+{
+  const BinaryMapHeader & header = *header_;
+  if (!header.tile_size) {
+    std::memcpy(
+      cells, data_ + sizeof(BinaryMapHeader), static_cast<size_t>(header.width) * header.height);
+    return;
+  }
+
+  std::vector<int8_t> tile;
+  for (unsigned int ty = 0; ty < tilesY(); ++ty) {
+    for (unsigned int tx = 0; tx < tilesX(); ++tx) {
+      unsigned int x0, y0, width, height;
+      tileBounds(header, tx, ty, x0, y0, width, height);
+      readTile(tx, ty, tile, width, height);
+      for (unsigned int row = 0; row < height; ++row) {
+        std::memcpy(
+          cells + static_cast<size_t>(y0 + row) * header.width + x0,
+          tile.data() + static_cast<size_t>(row) * width, width);
+      }
+    }
+  }
+}
+
+void BinaryMap::readTile(
+  unsigned int tx, unsigned int ty, std::vector<int8_t> & cells,
+  unsigned int & tile_width, unsigned int & tile_height) const
+{
+  if (tx >= tilesX() || ty >= tilesY()) {
+    throw std::runtime_error(
+            "No tile (" + std::to_string(tx) + ", " + std::to_string(ty) + ") in the map");
+  }
+
+  unsigned int x0, y0;
+  tileBounds(*header_, tx, ty, x0, y0, tile_width, tile_height);
+  const size_t cell_count = static_cast<size_t>(tile_width) * tile_height;
+  cells.resize(cell_count);
+
+  if (!header_->tile_size) {
+    std::memcpy(cells.data(), data_ + sizeof(BinaryMapHeader), cell_count);
+    return;
+  }
+
+  const BinaryMapTile & tile = tiles_[ty * tilesX() + tx];
+  const char * source = reinterpret_cast<const char *>(data_ + tile.offset);
+  if (static_cast<BinaryMapCompression>(header_->compression) == BinaryMapCompression::None) {
+    std::memcpy(cells.data(), source, cell_count);
+    return;
+  }
+
+  int decompressed = LZ4_decompress_safe(
+    source, reinterpret_cast<char *>(cells.data()), static_cast<int>(tile.size),
+    static_cast<int>(cell_count));
+  if (decompressed < 0 || static_cast<size_t>(decompressed) != cell_count) {
+    throw std::runtime_error(
+            "Corrupt tile (" + std::to_string(tx) + ", " + std::to_string(ty) + ") in the map");
+  }
+}
+
+void BinaryMap::write(
+  const std::string & filename, const nav_msgs::msg::OccupancyGrid & map,
+  uint32_t tile_size, bool compress)
+{
+  if (compress && !tile_size) {
+    throw std::runtime_error("Only a tiled binary map can be compressed");
+  }
+  if (map.data.size() != static_cast<size_t>(map.info.width) * map.info.height) {
+    throw std::runtime_error("The map does not have width * height cells");
+  }
+
+  BinaryMapHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.width = map.info.width;
+  header.height = map.info.height;
+  header.tile_size = tile_size;
+  header.compression = static_cast<uint32_t>(
+    compress ? BinaryMapCompression::LZ4 : BinaryMapCompression::None);
+  header.resolution = map.info.resolution;
+  header.origin_x = map.info.origin.position.x;
+  header.origin_y = map.info.origin.position.y;
+
+  const geometry_msgs::msg::Quaternion & orientation = map.info.origin.orientation;
+  tf2::Matrix3x3 mat(tf2::Quaternion(orientation.x, orientation.y, orientation.z, orientation.w));
+  double pitch, roll;
+  mat.getEulerYPR(header.origin_yaw, pitch, roll);
+
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    throw std::runtime_error("Failed to open " + filename + " for writing");
+  }
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  if (!tile_size) {
+    file.write(reinterpret_cast<const char *>(map.data.data()), map.data.size());
+  } else {
+    const unsigned int tiles_x = (header.width + tile_size - 1) / tile_size;
+    const unsigned int tiles_y = (header.height + tile_size - 1) / tile_size;
+
+    // The table is written once the sizes of the tiles are known
+    std::vector<BinaryMapTile> tiles(static_cast<size_t>(tiles_x) * tiles_y);
+    file.write(
+      reinterpret_cast<const char *>(tiles.data()), tiles.size() * sizeof(BinaryMapTile));
+    uint64_t offset = sizeof(BinaryMapHeader) + tiles.size() * sizeof(BinaryMapTile);
+
+    std::vector<char> cells;
+    std::vector<char> compressed;
+    for (unsigned int ty = 0; ty < tiles_y; ++ty) {
+      for (unsigned int tx = 0; tx < tiles_x; ++tx) {
+        unsigned int x0, y0, width, height;
+        tileBounds(header, tx, ty, x0, y0, width, height);
+        cells.resize(static_cast<size_t>(width) * height);
+        for (unsigned int row = 0; row < height; ++row) {
+          std::memcpy(
+            cells.data() + static_cast<size_t>(row) * width,
+            map.data.data() + static_cast<size_t>(y0 + row) * header.width + x0, width);
+        }
+
+        const char * tile_data = cells.data();
+        uint64_t tile_bytes = cells.size();
+        if (compress) {
+          compressed.resize(LZ4_compressBound(static_cast<int>(cells.size())));
+          int compressed_bytes = LZ4_compress_default(
+            cells.data(), compressed.data(), static_cast<int>(cells.size()),
+            static_cast<int>(compressed.size()));
+          if (compressed_bytes <= 0) {
+            throw std::runtime_error("Failed to compress a tile of the map");
+          }
+          tile_data = compressed.data();
+          tile_bytes = compressed_bytes;
+        }
+
+        file.write(tile_data, tile_bytes);
+        tiles[ty * tiles_x + tx] = {offset, tile_bytes};
+        offset += tile_bytes;
+      }
+    }
+
+    file.seekp(sizeof(BinaryMapHeader));
+    file.write(
+      reinterpret_cast<const char *>(tiles.data()), tiles.size() * sizeof(BinaryMapTile));
+  }
+
+  if (!file) {
+    throw std::runtime_error("Failed to write " + filename);
+  }
+}
+
+}  // namespace nav2_map_server
@@ -30,14 +30,21 @@
 
 #include "nav2_map_server/map_saver.hpp"
 
+#include <png.h>
+
+#include <algorithm>
+#include <cmath>
+#include <csetjmp>
 #include <cstdio>
 #include <fstream>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "Magick++.h"
+#include "nav2_map_server/binary_map.hpp"
 #include "nav2_map_server/map_mode.hpp"
 #include "nav_msgs/msg/occupancy_grid.h"
 #include "nav_msgs/srv/get_map.hpp"
@@ -83,7 +90,7 @@ MapSaver::MapSaver(const rclcpp::NodeOptions & options)
     std::transform(
       image_format.begin(), image_format.end(), image_format.begin(),
       [](unsigned char c) {return std::tolower(c);});
-    const std::vector<std::string> BLESSED_FORMATS{"bmp", "pgm", "png"};
+    const std::vector<std::string> BLESSED_FORMATS{"bmp", "pgm", "png", "nmap"};
     if (
       std::find(BLESSED_FORMATS.begin(), BLESSED_FORMATS.end(), image_format) ==
       BLESSED_FORMATS.end())
@@ -103,19 +110,31 @@ MapSaver::MapSaver(const rclcpp::NodeOptions & options)
     }
     const std::string FALLBACK_FORMAT = "png";
 
-    try {
-      Magick::CoderInfo info(image_format);
-      if (!info.isWritable()) {
+    // "nmap" is the binary map format, which stores the cells themselves instead of an image
+    binary_tile_size_ = declare_parameter("binary_tile_size", 0);
+    if (binary_tile_size_ < 0) {
+      throw std::runtime_error("Binary tile size must be 0 or greater");
+    }
+    binary_compression_ = declare_parameter("binary_compression", false);
+    if (binary_compression_ && !binary_tile_size_) {
+      throw std::runtime_error("Binary compression requires a binary tile size");
+    }
+
+    if (image_format != "nmap") {
+      try {
+        Magick::CoderInfo info(image_format);
+        if (!info.isWritable()) {
+          RCLCPP_WARN(
+            get_logger(), "Format '%s' is not writable. Using '%s' instead",
+            image_format.c_str(), FALLBACK_FORMAT.c_str());
+          image_format = FALLBACK_FORMAT;
+        }
+      } catch (Magick::ErrorOption & e) {
         RCLCPP_WARN(
-          get_logger(), "Format '%s' is not writable. Using '%s' instead",
-          image_format.c_str(), FALLBACK_FORMAT.c_str());
+          get_logger(), "Format '%s' is not usable. Using '%s' instead:\n%s",
+          image_format.c_str(), FALLBACK_FORMAT.c_str(), e.what());
         image_format = FALLBACK_FORMAT;
       }
-    } catch (Magick::ErrorOption & e) {
-      RCLCPP_WARN(
-        get_logger(), "Format '%s' is not usable. Using '%s' instead:\n%s",
-        image_format.c_str(), FALLBACK_FORMAT.c_str(), e.what());
-      image_format = FALLBACK_FORMAT;
     }
     if (
       map_mode == MapMode::Scale &&
@@ -135,6 +154,237 @@ MapSaver::MapSaver(const rclcpp::NodeOptions & options)
   }
 }
 
+namespace
+{
+
+// The color of a cell of the map in the image
+Magick::Color cellColor(
+  MapMode map_mode, int threshold_free, int threshold_occupied, int8_t map_cell)
+{
+  Magick::Color pixel;
+
+  switch (map_mode) {
+    case MapMode::Trinary:
+      if (map_cell < 0 || 100 < map_cell) {
+        pixel = Magick::ColorGray(205 / 255.0);
+      } else if (map_cell <= threshold_free) {
+        pixel = Magick::ColorGray(254 / 255.0);
+      } else if (threshold_occupied <= map_cell) {
+        pixel = Magick::ColorGray(0 / 255.0);
+      } else {
+        pixel = Magick::ColorGray(205 / 255.0);
+      }
+      break;
+    case MapMode::Scale:
+      if (map_cell < 0 || 100 < map_cell) {
+        pixel = Magick::ColorGray{0.5};
+        pixel.alphaQuantum(TransparentOpacity);
+      } else {
+        pixel = Magick::ColorGray{(100.0 - map_cell) / 100.0};
+      }
+      break;
+    case MapMode::Raw:
+      Magick::Quantum q;
+      if (map_cell < 0 || 100 < map_cell) {
+        q = MaxRGB;
+      } else {
+        q = map_cell / 255.0 * MaxRGB;
+      }
+      pixel = Magick::Color(q, q, q);
+      break;
+    default:
+      throw std::runtime_error("Invalid map mode");
+  }
+  return pixel;
+}
+
+// Rows converted and written at once, which bounds the memory of a streaming save
+const size_t kBandRows = 256;
+
+// libpng reports errors by a longjmp to the last setjmp, so each call that can fail gets its
+// own frame, with nothing in it to unwind
+bool pngWriteInfo(png_structp png, png_infop info)
+{
+  if (setjmp(png_jmpbuf(png))) {
+    return false;
+  }
+  png_write_info(png, info);
+  return true;
+}
+
+bool pngWriteRow(png_structp png, png_bytep row)
+{
+  if (setjmp(png_jmpbuf(png))) {
+    return false;
+  }
+  png_write_row(png, row);
+  return true;
+}
+
+bool pngWriteEnd(png_structp png, png_infop info)
+{
+  if (setjmp(png_jmpbuf(png))) {
+    return false;
+  }
+  png_write_end(png, info);
+  return true;
+}
+
+// Writes an 8-bit grey image, with alpha or not, a band of rows at a time
+class StreamingImageWriter
+{
+public:
+  StreamingImageWriter(
+    const std::string & filename, bool png, uint32_t width, uint32_t height, bool alpha)
+  : width_(width), channels_(alpha ? 2 : 1)
+  {
+    file_ = fopen(filename.c_str(), "wb");
+    if (!file_) {
+      throw std::runtime_error("Failed to open " + filename + " for writing");
+    }
+
+    if (!png) {
+      // PGM has no alpha channel
+      channels_ = 1;
+      fprintf(file_, "P5\n%u %u\n255\n", width, height);
+      return;
+    }
+
+    png_ = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    info_ = png_ ? png_create_info_struct(png_) : nullptr;
+    if (!info_) {
+      close();
+      throw std::runtime_error("Failed to start writing " + filename);
+    }
+    png_init_io(png_, file_);
+    png_set_IHDR(
+      png_, info_, width, height, 8, alpha ? PNG_COLOR_TYPE_GRAY_ALPHA : PNG_COLOR_TYPE_GRAY,
+      PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    if (!pngWriteInfo(png_, info_)) {
+      close();
+      throw std::runtime_error("Failed to write the header of " + filename);
+    }
+  }
+
+  ~StreamingImageWriter()
+  {
+    close();
+  }
+
+  // The bytes of a pixel
+  unsigned int channels() const {return channels_;}
+
+  // Append rows, each of width * channels bytes, top first
+  void write(const unsigned char * rows, size_t count)
+  {
+    const size_t row_bytes = width_ * channels_;
+    if (!png_) {
+      if (fwrite(rows, row_bytes, count, file_) != count) {
+        throw std::runtime_error("Failed to write the map image");
+      }
+      return;
+    }
+    for (size_t row = 0; row < count; ++row) {
+      if (!pngWriteRow(png_, const_cast<png_bytep>(rows + row * row_bytes))) {
+        throw std::runtime_error("Failed to write the map image");
+      }
+    }
+  }
+
+  void finish()
+  {
+    bool ok = !png_ || pngWriteEnd(png_, info_);
+    ok = close() && ok;
+    if (!ok) {
+      throw std::runtime_error("Failed to finish the map image");
+    }
+  }
+
+private:
+  bool close()
+  {
+    if (png_) {
+      png_destroy_write_struct(&png_, info_ ? &info_ : nullptr);
+      png_ = nullptr;
+      info_ = nullptr;
+    }
+    bool ok = true;
+    if (file_) {
+      ok = fclose(file_) == 0;
+      file_ = nullptr;
+    }
+    return ok;
+  }
+
+  uint32_t width_;
+  unsigned int channels_;
+  FILE * file_{nullptr};
+  png_structp png_{nullptr};
+  png_infop info_{nullptr};
+};
+
+}  // namespace
+
+void MapSaver::writeStreaming(
+  const nav_msgs::msg::OccupancyGrid & map, const std::string & filename) const
+{
+  const size_t width = map.info.width;
+  const size_t height = map.info.height;
+  StreamingImageWriter writer(filename, image_format == "png", width, height,
+    map_mode == MapMode::Scale);
+  const unsigned int channels = writer.channels();
+
+  // The grey and alpha bytes of every cell value, as the image would have stored them
+  std::vector<unsigned char> lut(256 * channels);
+  for (int value = -128; value < 128; ++value) {
+    Magick::Color color =
+      cellColor(map_mode, threshold_free_, threshold_occupied_, static_cast<int8_t>(value));
+    unsigned char * pixel = &lut[static_cast<uint8_t>(value) * channels];
+    pixel[0] = std::lround(color.redQuantum() * 255.0 / MaxRGB);
+    if (channels == 2) {
+      pixel[1] = 255 - std::lround(color.alphaQuantum() * 255.0 / MaxRGB);
+    }
+  }
+
+  const size_t band_rows = std::max<size_t>(1, std::min(kBandRows, height));
+  std::vector<unsigned char> rows(width * band_rows * channels);
+  const size_t threads = std::max(1u, std::min(std::thread::hardware_concurrency(), 8u));
+  std::vector<std::thread> workers;
+
+  for (size_t band = 0; band < height; band += band_rows) {
+    const size_t count = std::min(band_rows, height - band);
+
+    // The image starts at the top row of the map, which is its last
+    auto convert_rows = [&, band](size_t first, size_t last) {
+        for (size_t row = first; row < last; ++row) {
+          const int8_t * cell = &map.data[width * (height - (band + row) - 1)];
+          unsigned char * pixel = &rows[row * width * channels];
+          for (size_t x = 0; x < width; ++x, pixel += channels) {
+            const unsigned char * entry = &lut[static_cast<uint8_t>(cell[x]) * channels];
+            pixel[0] = entry[0];
+            if (channels == 2) {
+              pixel[1] = entry[1];
+            }
+          }
+        }
+      };
+
+    // Rows are independent, so each thread converts a share of the band
+    const size_t share = (count + threads - 1) / threads;
+    for (size_t first = share; first < count; first += share) {
+      workers.emplace_back(convert_rows, first, std::min(first + share, count));
+    }
+    convert_rows(0, std::min(share, count));
+    for (auto & worker : workers) {
+      worker.join();
+    }
+    workers.clear();
+
+    writer.write(rows.data(), count);
+  }
+  writer.finish();
+}
+
 void MapSaver::try_write_map_to_file(const nav_msgs::msg::OccupancyGrid & map)
 {
   auto logger = get_logger();
@@ -143,7 +393,20 @@ void MapSaver::try_write_map_to_file(const nav_msgs::msg::OccupancyGrid & map)
     map.info.resolution);
 
   std::string mapdatafile = mapname_ + "." + image_format;
-  {
+  if (image_format == "nmap") {
+    RCLCPP_INFO(logger, "Writing binary map occupancy data to %s", mapdatafile.c_str());
+    BinaryMap::write(mapdatafile, map, binary_tile_size_, binary_compression_);
+  } else if (image_format == "pgm" || image_format == "png") {
+    RCLCPP_INFO(logger, "Writing map occupancy data to %s", mapdatafile.c_str());
+    writeStreaming(map, mapdatafile);
+  } else {
+    // The color of every cell value, so that each cell is a table lookup
+    std::vector<Magick::Color> colors(256);
+    for (int value = -128; value < 128; ++value) {
+      colors[static_cast<uint8_t>(value)] =
+        cellColor(map_mode, threshold_free_, threshold_occupied_, static_cast<int8_t>(value));
+    }
+
     // should never see this color, so the initialization value is just for debugging
     Magick::Image image({map.info.width, map.info.height}, "red");
 
@@ -158,42 +421,7 @@ void MapSaver::try_write_map_to_file(const nav_msgs::msg::OccupancyGrid & map)
     for (size_t y = 0; y < map.info.height; y++) {
       for (size_t x = 0; x < map.info.width; x++) {
         int8_t map_cell = map.data[map.info.width * (map.info.height - y - 1) + x];
-
-        Magick::Color pixel;
-
-        switch (map_mode) {
-          case MapMode::Trinary:
-            if (map_cell < 0 || 100 < map_cell) {
-              pixel = Magick::ColorGray(205 / 255.0);
-            } else if (map_cell <= threshold_free_) {
-              pixel = Magick::ColorGray(254 / 255.0);
-            } else if (threshold_occupied_ <= map_cell) {
-              pixel = Magick::ColorGray(0 / 255.0);
-            } else {
-              pixel = Magick::ColorGray(205 / 255.0);
-            }
-            break;
-          case MapMode::Scale:
-            if (map_cell < 0 || 100 < map_cell) {
-              pixel = Magick::ColorGray{0.5};
-              pixel.alphaQuantum(TransparentOpacity);
-            } else {
-              pixel = Magick::ColorGray{(100.0 - map_cell) / 100.0};
-            }
-            break;
-          case MapMode::Raw:
-            Magick::Quantum q;
-            if (map_cell < 0 || 100 < map_cell) {
-              q = MaxRGB;
-            } else {
-              q = map_cell / 255.0 * MaxRGB;
-            }
-            pixel = Magick::Color(q, q, q);
-            break;
-          default:
-            throw std::runtime_error("Invalid map mode");
-        }
-        image.pixelColor(x, y, pixel);
+        image.pixelColor(x, y, colors[static_cast<uint8_t>(map_cell)]);
       }
     }
 
@@ -24,7 +24,8 @@ const char * USAGE_STRING{
   "Usage: \n"
   "  map_saver -h/--help\n"
   "  map_saver [--occ <threshold_occupied>] [--free <threshold_free>] [--fmt <image_format>] "
-  "[--mode trinary/scale/raw] [-f <mapname>] [ROS remapping args]"};
+  "[--mode trinary/scale/raw] [--tile <binary_tile_size>] [--lz4] [-f <mapname>] "
+  "[ROS remapping args]"};
 
 int main(int argc, char ** argv)
 {
@@ -68,6 +69,14 @@ int main(int argc, char ** argv)
         continue;
       }
       params_from_args.emplace_back("image_format", *it);
+    } else if (*it == "--tile") {
+      if (++it == arguments.end()) {
+        RCLCPP_WARN(logger, "Argument ignored: --tile should be followed by a value.");
+        continue;
+      }
+      params_from_args.emplace_back("binary_tile_size", atoi(it->c_str()));
+    } else if (*it == "--lz4") {
+      params_from_args.emplace_back("binary_compression", true);
     } else {
       RCLCPP_WARN(logger, "Ignoring unrecognized argument '%s'", it->c_str());
     }
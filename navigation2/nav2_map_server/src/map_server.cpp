@@ -18,6 +18,7 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "nav2_map_server/occ_grid_loader.hpp"
 #include "nav2_util/node_utils.hpp"
@@ -28,13 +29,17 @@ using namespace std::chrono_literals;
 namespace nav2_map_server
 {
 
-MapServer::MapServer()
-: nav2_util::LifecycleNode("map_server")
+MapServer::MapServer(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("map_server", "", false, options)
 {
   RCLCPP_INFO(get_logger(), "Creating");
 
   // Declare the node parameters
   declare_parameter("yaml_filename", rclcpp::ParameterValue(std::string("map.yaml")));
+
+  // Maps loaded up front, to switch to by their ID
+  declare_parameter("map_ids", rclcpp::ParameterValue(std::vector<std::string>()));
+  declare_parameter("map_yaml_filenames", rclcpp::ParameterValue(std::vector<std::string>()));
 }
 
 MapServer::~MapServer()
@@ -124,3 +129,7 @@ MapServer::on_shutdown(const rclcpp_lifecycle::State &)
 }
 
 }  // namespace nav2_map_server
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_map_server::MapServer)
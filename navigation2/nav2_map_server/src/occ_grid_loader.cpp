@@ -32,12 +32,17 @@
 #include "nav2_map_server/occ_grid_loader.hpp"
 
 #include <libgen.h>
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "Magick++.h"
+#include "nav2_map_server/binary_map.hpp"
 #include "tf2/LinearMath/Quaternion.h"
 #include "yaml-cpp/yaml.h"
 #include "nav2_util/geometry_utils.hpp"
@@ -130,7 +135,7 @@ nav2_util::CallbackReturn OccGridLoader::on_configure(const rclcpp_lifecycle::St
 {
   RCLCPP_INFO(node_->get_logger(), "OccGridLoader: Configuring");
 
-  msg_ = std::make_unique<nav_msgs::msg::OccupancyGrid>();
+  msg_ = std::make_shared<nav_msgs::msg::OccupancyGrid>();
   LoadParameters loadParameters;
   try {
     loadParameters = load_map_yaml(yaml_filename_);
@@ -156,6 +161,8 @@ nav2_util::CallbackReturn OccGridLoader::on_configure(const rclcpp_lifecycle::St
     throw std::runtime_error("Failed to load map image file.");
   }
 
+  loadCachedMaps();
+
   // Create a service callback handle
   auto handle_occ_callback = [this](
     const std::shared_ptr<rmw_request_id_t>/*request_header*/,
@@ -168,10 +175,47 @@ nav2_util::CallbackReturn OccGridLoader::on_configure(const rclcpp_lifecycle::St
   // Create a service that provides the occupancy grid
   occ_service_ = node_->create_service<nav_msgs::srv::GetMap>(service_name_, handle_occ_callback);
 
+  auto handle_tile_callback = [this](
+    const std::shared_ptr<rmw_request_id_t>/*request_header*/,
+    const std::shared_ptr<nav2_msgs::srv::GetMapTile::Request> request,
+    std::shared_ptr<nav2_msgs::srv::GetMapTile::Response> response) -> void {
+      getMapTile(*request, response->map);
+    };
+
+  tile_service_ = node_->create_service<nav2_msgs::srv::GetMapTile>(
+    tile_service_name_, handle_tile_callback);
+
   // Create a publisher using the QoS settings to emulate a ROS1 latched topic
   occ_pub_ = node_->create_publisher<nav_msgs::msg::OccupancyGrid>(
     topic_name_, rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable());
 
+  if (!cached_maps_.empty()) {
+    auto handle_switch_callback = [this](
+      const std::shared_ptr<rmw_request_id_t>/*request_header*/,
+      const std::shared_ptr<nav2_msgs::srv::SwitchMap::Request> request,
+      std::shared_ptr<nav2_msgs::srv::SwitchMap::Response> response) -> void {
+        auto it = cached_maps_.find(request->map_id);
+        response->success = it != cached_maps_.end();
+        if (!response->success) {
+          RCLCPP_WARN(
+            node_->get_logger(), "OccGridLoader: No preloaded map '%s'", request->map_id.c_str());
+          return;
+        }
+        RCLCPP_INFO(node_->get_logger(), "OccGridLoader: Switching to map '%s'",
+          request->map_id.c_str());
+        msg_ = it->second;
+        occ_pub_->publish(*msg_);
+      };
+
+    switch_service_ = node_->create_service<nav2_msgs::srv::SwitchMap>(
+      switch_service_name_, handle_switch_callback);
+
+    // Every preloaded map stays on the topic for the nodes that come up later
+    cache_pub_ = node_->create_publisher<nav_msgs::msg::OccupancyGrid>(
+      cache_topic_name_,
+      rclcpp::QoS(rclcpp::KeepLast(cached_maps_.size())).transient_local().reliable());
+  }
+
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
@@ -183,6 +227,13 @@ nav2_util::CallbackReturn OccGridLoader::on_activate(const rclcpp_lifecycle::Sta
   occ_pub_->on_activate();
   occ_pub_->publish(*msg_);
 
+  if (cache_pub_) {
+    cache_pub_->on_activate();
+    for (const auto & cached_map : cached_maps_) {
+      cache_pub_->publish(*cached_map.second);
+    }
+  }
+
   // due to timing / discovery issues, need to republish map
   auto timer_callback = [this]() -> void {occ_pub_->publish(*msg_);};
   timer_ = node_->create_wall_timer(2s, timer_callback);
@@ -195,6 +246,9 @@ nav2_util::CallbackReturn OccGridLoader::on_deactivate(const rclcpp_lifecycle::S
   RCLCPP_INFO(node_->get_logger(), "OccGridLoader: Deactivating");
 
   occ_pub_->on_deactivate();
+  if (cache_pub_) {
+    cache_pub_->on_deactivate();
+  }
   timer_.reset();
 
   return nav2_util::CallbackReturn::SUCCESS;
@@ -206,16 +260,195 @@ nav2_util::CallbackReturn OccGridLoader::on_cleanup(const rclcpp_lifecycle::Stat
 
   occ_pub_.reset();
   occ_service_.reset();
+  tile_service_.reset();
+  switch_service_.reset();
+  cache_pub_.reset();
+  cached_maps_.clear();
   msg_.reset();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
-void OccGridLoader::loadMapFromFile(const LoadParameters & loadParameters)
+void OccGridLoader::loadCachedMaps()
+{
+  std::vector<std::string> map_ids;
+  std::vector<std::string> yaml_filenames;
+  node_->get_parameter("map_ids", map_ids);
+  node_->get_parameter("map_yaml_filenames", yaml_filenames);
+  if (map_ids.size() != yaml_filenames.size()) {
+    RCLCPP_ERROR(
+      node_->get_logger(), "map_ids has %zu IDs but map_yaml_filenames %zu files",
+      map_ids.size(), yaml_filenames.size());
+    throw std::runtime_error("Failed to preload the maps.");
+  }
+
+  // loadMapFromFile fills msg_, so each map gets its own message in turn
+  auto current_map = msg_;
+  for (size_t i = 0; i < map_ids.size(); ++i) {
+    RCLCPP_INFO(
+      node_->get_logger(), "OccGridLoader: Preloading map '%s' from %s", map_ids[i].c_str(),
+      yaml_filenames[i].c_str());
+    msg_ = std::make_shared<nav_msgs::msg::OccupancyGrid>();
+    try {
+      loadMapFromFile(load_map_yaml(yaml_filenames[i]));
+    } catch (std::exception & e) {
+      RCLCPP_ERROR(
+        node_->get_logger(), "Failed to preload map '%s' from %s for reason: %s",
+        map_ids[i].c_str(), yaml_filenames[i].c_str(), e.what());
+      msg_ = current_map;
+      throw std::runtime_error("Failed to preload the maps.");
+    }
+    cached_maps_[map_ids[i]] = msg_;
+  }
+  msg_ = current_map;
+}
+
+void OccGridLoader::getMapTile(
+  const nav2_msgs::srv::GetMapTile::Request & request,
+  nav_msgs::msg::OccupancyGrid & tile) const
+{
+  const nav_msgs::msg::OccupancyGrid & map = *msg_;
+  const unsigned int zoom = std::min<unsigned int>(request.zoom, max_zoom_);
+  const int64_t step = int64_t{1} << zoom;
+
+  // The cells of the map covered by the region, grown to whole tile cells and clipped
+  auto first_cell = [&](double coordinate, double origin, int64_t size) {
+      int64_t cell = std::floor((coordinate - origin) / map.info.resolution);
+      cell = cell < 0 ? 0 : cell / step * step;
+      return std::min(cell, size);
+    };
+  auto end_cell = [&](double coordinate, double origin, int64_t size) {
+      int64_t cell = std::ceil((coordinate - origin) / map.info.resolution);
+      cell = cell <= 0 ? 0 : (cell + step - 1) / step * step;
+      return std::min(cell, size);
+    };
+  const int64_t x0 = first_cell(request.min_x, map.info.origin.position.x, map.info.width);
+  const int64_t y0 = first_cell(request.min_y, map.info.origin.position.y, map.info.height);
+  const int64_t x1 = std::max(x0, end_cell(request.max_x, map.info.origin.position.x,
+      map.info.width));
+  const int64_t y1 = std::max(y0, end_cell(request.max_y, map.info.origin.position.y,
+      map.info.height));
+
+  tile.header = map.header;
+  tile.info = map.info;
+  tile.info.resolution = map.info.resolution * step;
+  tile.info.width = (x1 - x0 + step - 1) / step;
+  tile.info.height = (y1 - y0 + step - 1) / step;
+  tile.info.origin.position.x = map.info.origin.position.x + x0 * map.info.resolution;
+  tile.info.origin.position.y = map.info.origin.position.y + y0 * map.info.resolution;
+  tile.data.assign(static_cast<size_t>(tile.info.width) * tile.info.height, -1);
+
+  for (int64_t y = y0; y < y1; ++y) {
+    const int8_t * source = &map.data[y * map.info.width];
+    int8_t * dest = &tile.data[(y - y0) / step * tile.info.width];
+    if (step == 1) {
+      std::copy(source + x0, source + x1, dest);
+      continue;
+    }
+    // Unknown cells are -1, so that any known cell replaces them
+    for (int64_t x = x0; x < x1; ++x) {
+      int8_t & cell = dest[(x - x0) / step];
+      cell = std::max(cell, source[x]);
+    }
+  }
+}
+
+namespace
+{
+
+// The cell of a pixel whose channels average to quantum, on the scale of Magick::Quantum
+int8_t cellFromQuantum(
+  const OccGridLoader::LoadParameters & loadParameters, bool opaque, double quantum)
+{
+  /// on a scale from 0.0 to 1.0 how bright is the pixel?
+  double shade = Magick::ColorGray::scaleQuantumToDouble(quantum);
+
+  // If negate is true, we consider blacker pixels free, and whiter
+  // pixels occupied. Otherwise, it's vice versa.
+  /// on a scale from 0.0 to 1.0, how occupied is the map cell (before thresholding)?
+  double occ = (loadParameters.negate ? shade : 1.0 - shade);
+
+  switch (loadParameters.mode) {
+    case MapMode::Trinary:
+      if (loadParameters.occupied_thresh < occ) {
+        return 100;
+      } else if (occ < loadParameters.free_thresh) {
+        return 0;
+      }
+      return -1;
+    case MapMode::Scale:
+      if (!opaque) {
+        return -1;
+      } else if (loadParameters.occupied_thresh < occ) {
+        return 100;
+      } else if (occ < loadParameters.free_thresh) {
+        return 0;
+      }
+      return std::rint(
+        (occ - loadParameters.free_thresh) /
+        (loadParameters.occupied_thresh - loadParameters.free_thresh) * 100.0);
+    case MapMode::Raw: {
+        double occ_percent = std::round(shade * 255);
+        if (0 <= occ_percent && occ_percent <= 100) {
+          return static_cast<int8_t>(occ_percent);
+        }
+        return -1;
+      }
+    default:
+      throw std::runtime_error("Invalid map mode");
+  }
+}
+
+// Rows of the image exported at once, which bounds the memory of the bulk decoding
+const size_t kBandRows = 256;
+
+}  // namespace
+
+void OccGridLoader::loadMapFromFile(
+  const LoadParameters & loadParameters, bool allow_bulk_decoding)
 {
-  Magick::InitializeMagick(nullptr);
   nav_msgs::msg::OccupancyGrid msg;
 
+  if (BinaryMap::isBinaryMap(loadParameters.image_file_name)) {
+    loadBinaryMap(loadParameters.image_file_name, msg);
+  } else {
+    decodeImage(loadParameters, allow_bulk_decoding, msg);
+  }
+
+  msg.info.map_load_time = node_->now();
+  msg.header.frame_id = frame_id_;
+  msg.header.stamp = node_->now();
+
+  RCLCPP_DEBUG(
+    node_->get_logger(), "Read map %s: %d X %d map @ %.3lf m/cell",
+    loadParameters.image_file_name.c_str(), msg.info.width, msg.info.height, msg.info.resolution);
+
+  *msg_ = std::move(msg);
+}
+
+void OccGridLoader::loadBinaryMap(const std::string & filename, nav_msgs::msg::OccupancyGrid & msg)
+{
+  BinaryMap map(filename);
+  const BinaryMapHeader & header = map.header();
+
+  msg.info.width = header.width;
+  msg.info.height = header.height;
+  msg.info.resolution = header.resolution;
+  msg.info.origin.position.x = header.origin_x;
+  msg.info.origin.position.y = header.origin_y;
+  msg.info.origin.position.z = 0.0;
+  msg.info.origin.orientation = orientationAroundZAxis(header.origin_yaw);
+
+  msg.data.resize(msg.info.width * msg.info.height);
+  map.read(msg.data.data());
+}
+
+void OccGridLoader::decodeImage(
+  const LoadParameters & loadParameters, bool allow_bulk_decoding,
+  nav_msgs::msg::OccupancyGrid & msg)
+{
+  Magick::InitializeMagick(nullptr);
+
   Magick::Image img(loadParameters.image_file_name);
 
   // Copy the image data into the map structure
@@ -230,79 +463,80 @@ void OccGridLoader::loadMapFromFile(const LoadParameters & loadParameters)
   // Allocate space to hold the data
   msg.data.resize(msg.info.width * msg.info.height);
 
-  // Copy pixel data into the map structure
-  for (size_t y = 0; y < msg.info.height; y++) {
-    for (size_t x = 0; x < msg.info.width; x++) {
-      auto pixel = img.pixelColor(x, y);
-
-      std::vector<Magick::Quantum> channels = {pixel.redQuantum(), pixel.greenQuantum(),
-        pixel.blueQuantum()};
-      if (loadParameters.mode == MapMode::Trinary && img.matte()) {
-        // To preserve existing behavior, average in alpha with color channels in Trinary mode.
-        // CAREFUL. alpha is inverted from what you might expect. High = transparent, low = opaque
-        channels.push_back(MaxRGB - pixel.alphaQuantum());
-      }
-      double sum = 0;
-      for (auto c : channels) {
-        sum += c;
-      }
-      /// on a scale from 0.0 to 1.0 how bright is the pixel?
-      double shade = Magick::ColorGray::scaleQuantumToDouble(sum / channels.size());
-
-      // If negate is true, we consider blacker pixels free, and whiter
-      // pixels occupied. Otherwise, it's vice versa.
-      /// on a scale from 0.0 to 1.0, how occupied is the map cell (before thresholding)?
-      double occ = (loadParameters.negate ? shade : 1.0 - shade);
-
-      int8_t map_cell;
-      switch (loadParameters.mode) {
-        case MapMode::Trinary:
-          if (loadParameters.occupied_thresh < occ) {
-            map_cell = 100;
-          } else if (occ < loadParameters.free_thresh) {
-            map_cell = 0;
-          } else {
-            map_cell = -1;
-          }
-          break;
-        case MapMode::Scale:
-          if (pixel.alphaQuantum() != OpaqueOpacity) {
-            map_cell = -1;
-          } else if (loadParameters.occupied_thresh < occ) {
-            map_cell = 100;
-          } else if (occ < loadParameters.free_thresh) {
-            map_cell = 0;
-          } else {
-            map_cell = std::rint(
-              (occ - loadParameters.free_thresh) /
-              (loadParameters.occupied_thresh - loadParameters.free_thresh) * 100.0);
-          }
-          break;
-        case MapMode::Raw: {
-            double occ_percent = std::round(shade * 255);
-            if (0 <= occ_percent && occ_percent <= 100) {
-              map_cell = static_cast<int8_t>(occ_percent);
-            } else {
-              map_cell = -1;
+  if (allow_bulk_decoding && img.depth() <= 8) {
+    // Export the pixels 8 bits a channel, and map the sum of the channels of each pixel to its
+    // cell through a table. Every 8-bit value is exact as a Quantum, so the cells are the same
+    // as when decoding pixel by pixel.
+    const bool alpha = img.matte();
+    const size_t stride = alpha ? 4 : 3;
+    const size_t channels = (loadParameters.mode == MapMode::Trinary && alpha) ? 4 : 3;
+    const double quantum_scale = MaxRGB / 255;
+
+    std::vector<int8_t> lut(channels * 255 + 1);
+    for (size_t sum = 0; sum < lut.size(); ++sum) {
+      lut[sum] = cellFromQuantum(loadParameters, true, sum * quantum_scale / channels);
+    }
+
+    const size_t width = msg.info.width;
+    const size_t height = msg.info.height;
+    const size_t band_rows = std::min(kBandRows, height);
+    std::vector<unsigned char> pixels(width * band_rows * stride);
+
+    const size_t threads = std::max(1u, std::min(std::thread::hardware_concurrency(), 8u));
+    std::vector<std::thread> workers;
+
+    for (size_t band = 0; band < height; band += band_rows) {
+      const size_t rows = std::min(band_rows, height - band);
+      img.write(0, band, width, rows, alpha ? "RGBA" : "RGB", Magick::CharPixel, pixels.data());
+
+      auto decode_rows = [&, band](size_t first, size_t last) {
+          for (size_t row = first; row < last; ++row) {
+            const unsigned char * pixel = &pixels[row * width * stride];
+            int8_t * cell = &msg.data[width * (height - (band + row) - 1)];
+            for (size_t x = 0; x < width; ++x, pixel += stride) {
+              unsigned int sum = pixel[0] + pixel[1] + pixel[2];
+              if (channels == 4) {
+                sum += pixel[3];
+              }
+              cell[x] = (loadParameters.mode == MapMode::Scale && alpha && pixel[3] != 255) ?
+                -1 : lut[sum];
             }
-            break;
           }
-        default:
-          throw std::runtime_error("Invalid map mode");
+        };
+
+      // Rows are independent, so each thread decodes a share of the band
+      const size_t share = (rows + threads - 1) / threads;
+      for (size_t first = share; first < rows; first += share) {
+        workers.emplace_back(decode_rows, first, std::min(first + share, rows));
+      }
+      decode_rows(0, std::min(share, rows));
+      for (auto & worker : workers) {
+        worker.join();
+      }
+      workers.clear();
+    }
+  } else {
+    // Copy pixel data into the map structure
+    for (size_t y = 0; y < msg.info.height; y++) {
+      for (size_t x = 0; x < msg.info.width; x++) {
+        auto pixel = img.pixelColor(x, y);
+
+        std::vector<Magick::Quantum> channels = {pixel.redQuantum(), pixel.greenQuantum(),
+          pixel.blueQuantum()};
+        if (loadParameters.mode == MapMode::Trinary && img.matte()) {
+          // To preserve existing behavior, average in alpha with color channels in Trinary mode.
+          // CAREFUL. alpha is inverted from what you might expect. High = transparent, low = opaque
+          channels.push_back(MaxRGB - pixel.alphaQuantum());
+        }
+        double sum = 0;
+        for (auto c : channels) {
+          sum += c;
+        }
+        msg.data[msg.info.width * (msg.info.height - y - 1) + x] = cellFromQuantum(
+          loadParameters, pixel.alphaQuantum() == OpaqueOpacity, sum / channels.size());
       }
-      msg.data[msg.info.width * (msg.info.height - y - 1) + x] = map_cell;
     }
   }
-
-  msg.info.map_load_time = node_->now();
-  msg.header.frame_id = frame_id_;
-  msg.header.stamp = node_->now();
-
-  RCLCPP_DEBUG(
-    node_->get_logger(), "Read map %s: %d X %d map @ %.3lf m/cell",
-    loadParameters.image_file_name.c_str(), msg.info.width, msg.info.height, msg.info.resolution);
-
-  *msg_ = msg;
 }
 
 }  // namespace nav2_map_server
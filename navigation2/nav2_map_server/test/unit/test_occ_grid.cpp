@@ -32,6 +32,7 @@
 /* Author: Brian Gerkey */
 
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <experimental/filesystem>
 #include <stdexcept>
 #include <string>
@@ -41,6 +42,7 @@
 #include <fstream>
 
 #include "yaml-cpp/yaml.h"
+#include "nav2_map_server/binary_map.hpp"
 #include "nav2_map_server/occ_grid_loader.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 #include "test_constants/test_constants.h"
@@ -64,6 +66,9 @@ class TestMapLoader : public nav2_map_server::OccGridLoader
   FRIEND_TEST(MapLoaderTest, loadValidPNG);
   FRIEND_TEST(MapLoaderTest, loadValidBMP);
   FRIEND_TEST(MapLoaderTest, loadInvalidFile);
+  FRIEND_TEST(MapLoaderTest, bulkDecodingMatchesPixelByPixel);
+  FRIEND_TEST(MapLoaderTest, loadBinaryMap);
+  FRIEND_TEST(MapLoaderTest, getMapTile);
 
 public:
   explicit TestMapLoader(nav2_util::LifecycleNode::SharedPtr node, std::string yaml_filename)
@@ -214,3 +219,183 @@ TEST_F(MapLoaderTest, loadInvalidFile)
 
   ASSERT_ANY_THROW(map_loader_->loadMapFromFile(loadParameters));
 }
+
+// Decode a valid PNG file in bulk and pixel by pixel.  Succeeds if both give the same map in
+// every mode.
+
+TEST_F(MapLoaderTest, bulkDecodingMatchesPixelByPixel)
+{
+  auto test_png = path(TEST_DIR) / path(g_valid_png_file);
+
+  TestMapLoader::LoadParameters loadParameters;
+  loadParameters.image_file_name = test_png;
+  loadParameters.resolution = g_valid_image_res;
+  loadParameters.origin[0] = 0;
+  loadParameters.origin[1] = 0;
+  loadParameters.origin[2] = 0;
+  loadParameters.free_thresh = 0.196;
+  loadParameters.occupied_thresh = 0.65;
+
+  map_loader_->msg_ = std::make_unique<nav_msgs::msg::OccupancyGrid>();
+
+  for (auto mode : {nav2_map_server::MapMode::Trinary, nav2_map_server::MapMode::Scale,
+      nav2_map_server::MapMode::Raw})
+  {
+    for (int negate : {0, 1}) {
+      loadParameters.mode = mode;
+      loadParameters.negate = negate;
+
+      ASSERT_NO_THROW(map_loader_->loadMapFromFile(loadParameters, false));
+      nav_msgs::msg::OccupancyGrid expected = map_loader_->getOccupancyGrid();
+
+      ASSERT_NO_THROW(map_loader_->loadMapFromFile(loadParameters));
+      nav_msgs::msg::OccupancyGrid map_msg = map_loader_->getOccupancyGrid();
+
+      ASSERT_EQ(expected.data.size(), map_msg.data.size());
+      for (size_t i = 0; i < map_msg.data.size(); i++) {
+        EXPECT_EQ(expected.data[i], map_msg.data[i]);
+      }
+    }
+  }
+}
+
+// Save a valid PNG file as binary maps, untiled and in tiles, compressed or not, and load them
+// back.  Succeeds if every one gives the map of the PNG file, whole and tile by tile.
+
+TEST_F(MapLoaderTest, loadBinaryMap)
+{
+  auto test_png = path(TEST_DIR) / path(g_valid_png_file);
+
+  TestMapLoader::LoadParameters loadParameters;
+  loadParameters.image_file_name = test_png;
+  loadParameters.resolution = g_valid_image_res;
+  loadParameters.origin[0] = 2.0;
+  loadParameters.origin[1] = 3.0;
+  loadParameters.origin[2] = 1.0;
+  loadParameters.free_thresh = 0.196;
+  loadParameters.occupied_thresh = 0.65;
+  loadParameters.mode = nav2_map_server::MapMode::Trinary;
+  loadParameters.negate = 0;
+
+  map_loader_->msg_ = std::make_unique<nav_msgs::msg::OccupancyGrid>();
+
+  ASSERT_NO_THROW(map_loader_->loadMapFromFile(loadParameters));
+  nav_msgs::msg::OccupancyGrid expected = map_loader_->getOccupancyGrid();
+
+  std::string binary_file("/tmp/map_unit_test.nmap");
+  for (auto tiling : {std::make_pair(0u, false), std::make_pair(3u, false),
+      std::make_pair(4u, true)})
+  {
+    ASSERT_NO_THROW(
+      nav2_map_server::BinaryMap::write(binary_file, expected, tiling.first, tiling.second));
+    ASSERT_TRUE(nav2_map_server::BinaryMap::isBinaryMap(binary_file));
+
+    loadParameters.image_file_name = binary_file;
+    ASSERT_NO_THROW(map_loader_->loadMapFromFile(loadParameters));
+    nav_msgs::msg::OccupancyGrid map_msg = map_loader_->getOccupancyGrid();
+
+    EXPECT_FLOAT_EQ(map_msg.info.resolution, expected.info.resolution);
+    EXPECT_EQ(map_msg.info.width, expected.info.width);
+    EXPECT_EQ(map_msg.info.height, expected.info.height);
+    EXPECT_DOUBLE_EQ(map_msg.info.origin.position.x, expected.info.origin.position.x);
+    EXPECT_DOUBLE_EQ(map_msg.info.origin.position.y, expected.info.origin.position.y);
+    EXPECT_NEAR(map_msg.info.origin.orientation.z, expected.info.origin.orientation.z, 1e-9);
+    EXPECT_NEAR(map_msg.info.origin.orientation.w, expected.info.origin.orientation.w, 1e-9);
+    EXPECT_EQ(expected.data, map_msg.data);
+
+    nav2_map_server::BinaryMap binary_map(binary_file);
+    std::vector<int8_t> tile;
+    unsigned int tile_width, tile_height;
+    for (unsigned int ty = 0; ty < binary_map.tilesY(); ty++) {
+      for (unsigned int tx = 0; tx < binary_map.tilesX(); tx++) {
+        ASSERT_NO_THROW(binary_map.readTile(tx, ty, tile, tile_width, tile_height));
+        for (unsigned int y = 0; y < tile_height; y++) {
+          for (unsigned int x = 0; x < tile_width; x++) {
+            unsigned int map_x = tx * tiling.first + x;
+            unsigned int map_y = ty * tiling.first + y;
+            EXPECT_EQ(expected.data[map_y * expected.info.width + map_x], tile[y * tile_width + x]);
+          }
+        }
+      }
+    }
+    EXPECT_ANY_THROW(binary_map.readTile(binary_map.tilesX(), 0, tile, tile_width, tile_height));
+  }
+}
+
+// Get tiles of a valid PNG file.  Succeeds if a region at zoom 0 holds the cells of the map
+// under it, a zoomed tile the most occupied known cell of each block, and a region outside of
+// the map no cells.
+
+TEST_F(MapLoaderTest, getMapTile)
+{
+  auto test_png = path(TEST_DIR) / path(g_valid_png_file);
+
+  TestMapLoader::LoadParameters loadParameters;
+  loadParameters.image_file_name = test_png;
+  loadParameters.resolution = g_valid_image_res;
+  loadParameters.origin[0] = 2.0;
+  loadParameters.origin[1] = 3.0;
+  loadParameters.origin[2] = 0.0;
+  loadParameters.free_thresh = 0.196;
+  loadParameters.occupied_thresh = 0.65;
+  loadParameters.mode = nav2_map_server::MapMode::Trinary;
+  loadParameters.negate = 0;
+
+  map_loader_->msg_ = std::make_unique<nav_msgs::msg::OccupancyGrid>();
+  ASSERT_NO_THROW(map_loader_->loadMapFromFile(loadParameters));
+  nav_msgs::msg::OccupancyGrid map = map_loader_->getOccupancyGrid();
+  const double res = map.info.resolution;
+
+  // Cells 2 to 6 in x and 3 to 4 in y, with the corners inside the cells
+  nav2_msgs::srv::GetMapTile::Request request;
+  request.min_x = 2.0 + 2.5 * res;
+  request.min_y = 3.0 + 3.5 * res;
+  request.max_x = 2.0 + 6.5 * res;
+  request.max_y = 3.0 + 4.5 * res;
+  request.zoom = 0;
+
+  nav_msgs::msg::OccupancyGrid tile;
+  map_loader_->getMapTile(request, tile);
+  ASSERT_EQ(tile.info.width, 5u);
+  ASSERT_EQ(tile.info.height, 2u);
+  EXPECT_FLOAT_EQ(tile.info.resolution, res);
+  EXPECT_NEAR(tile.info.origin.position.x, 2.0 + 2 * res, 1e-6);
+  EXPECT_NEAR(tile.info.origin.position.y, 3.0 + 3 * res, 1e-6);
+  for (unsigned int y = 0; y < tile.info.height; y++) {
+    for (unsigned int x = 0; x < tile.info.width; x++) {
+      EXPECT_EQ(map.data[(y + 3) * map.info.width + x + 2], tile.data[y * tile.info.width + x]);
+    }
+  }
+
+  // The whole map, two cells to a tile cell on a side
+  request.min_x = -100.0;
+  request.min_y = -100.0;
+  request.max_x = 100.0;
+  request.max_y = 100.0;
+  request.zoom = 1;
+  map_loader_->getMapTile(request, tile);
+  ASSERT_EQ(tile.info.width, (map.info.width + 1) / 2);
+  ASSERT_EQ(tile.info.height, (map.info.height + 1) / 2);
+  EXPECT_FLOAT_EQ(tile.info.resolution, 2 * res);
+  for (unsigned int y = 0; y < tile.info.height; y++) {
+    for (unsigned int x = 0; x < tile.info.width; x++) {
+      int8_t expected = -1;
+      for (unsigned int my = 2 * y; my < std::min(2 * y + 2, map.info.height); my++) {
+        for (unsigned int mx = 2 * x; mx < std::min(2 * x + 2, map.info.width); mx++) {
+          expected = std::max(expected, map.data[my * map.info.width + mx]);
+        }
+      }
+      EXPECT_EQ(expected, tile.data[y * tile.info.width + x]);
+    }
+  }
+
+  request.min_x = 50.0;
+  request.min_y = 50.0;
+  request.max_x = 60.0;
+  request.max_y = 60.0;
+  request.zoom = 0;
+  map_loader_->getMapTile(request, tile);
+  EXPECT_EQ(tile.info.width, 0u);
+  EXPECT_EQ(tile.info.height, 0u);
+  EXPECT_TRUE(tile.data.empty());
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_NAVFN_PLANNER__DSTAR_LITE_HPP_
+#define NAV2_NAVFN_PLANNER__DSTAR_LITE_HPP_
+
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace nav2_navfn_planner
+{
+
+/**
+ * @class DStarLite
+ * @brief An incremental search from a goal over the cells of a costmap, D* Lite (Koenig and
+ * Likhachev, D* Lite), kept across plans to the same goal
+ *
+ * After the costmap changes, only the cells whose distance to the goal the change affects,
+ * and that the search from the robot needs, are expanded again. The robot may move between
+ * plans. Cells cost what NavFn makes of them, and a move between two of the 8 neighbors of a
+ * cell the mean of their costs times its length, without cutting the corner of an obstacle.
+ */
+class DStarLite
+{
+public:
+  struct Cell
+  {
+    int x;
+    int y;
+  };
+
+  DStarLite();
+
+  /**
+   * @brief  Start over with a search to a new goal, discarding the kept one
+   * @param costmap The ROS costs of the cells, row by row
+   */
+  void reset(const unsigned char * costmap, int nx, int ny, bool allow_unknown, Cell goal);
+
+  /// @brief  Whether the kept search is to this goal, on a costmap of this size
+  bool hasGoal(Cell goal, int nx, int ny) const
+  {
+    return nx == nx_ && ny == ny_ && goal.x == goal_.x && goal.y == goal_.y;
+  }
+
+  /**
+   * @brief  Bring the search up to date with the costmap, which must be of the size of the last
+   *         one
+   * @return The number of cells whose cost changed
+   */
+  int update(const unsigned char * costmap, bool allow_unknown);
+
+  /**
+   * @brief  Search until the start's distance to the goal is known, and follow it down
+   * @param path Set to the cells from start to goal
+   * @return false if the goal cannot be reached
+   */
+  bool plan(Cell start, std::vector<Cell> & path);
+
+  /// @brief  The cells expanded by the last plan()
+  int getExpandedCells() const {return expanded_cells_;}
+
+private:
+  struct Key
+  {
+    float first;
+    float second;
+    int index;
+
+    bool operator>(const Key & other) const
+    {
+      return first > other.first || (first == other.first && second > other.second);
+    }
+  };
+
+  float heuristic(int a, int b) const;
+  Key calculateKey(int index) const;
+
+  // The cost of the move between two neighboring cells, infinite if it is blocked
+  float moveCost(int from, int to) const;
+
+  void updateVertex(int index);
+  void computeShortestPath();
+
+  // The queue entry of a cell is current if it matches its queued key
+  void push(int index);
+  bool isCurrent(const Key & key) const;
+
+  int nx_{0};
+  int ny_{0};
+  Cell goal_{-1, -1};
+  int goal_index_{-1};
+  int start_index_{-1};
+  int last_index_{-1};  ///< The start when the key modifier was last changed
+  float key_modifier_{0.0f};  ///< Heuristic distance the start moved since the reset
+  std::vector<unsigned char> costs_;  ///< Per cell, as NavFn translates them
+  std::vector<float> g_;
+  std::vector<float> rhs_;
+  std::vector<unsigned char> open_;
+  std::vector<Key> queued_;  ///< The key each open cell was queued with
+  std::priority_queue<Key, std::vector<Key>, std::greater<Key>> queue_;
+  int expanded_cells_{0};
+};
+
+}  // namespace nav2_navfn_planner
+
+#endif  // NAV2_NAVFN_PLANNER__DSTAR_LITE_HPP_
@@ -43,6 +43,12 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+class WorkerPool;
+}
 
 namespace nav2_navfn_planner
 {
@@ -78,6 +84,10 @@ namespace nav2_navfn_planner
 // priority buffers
 #define PRIORITYBUFSIZE 10000
 
+// priority blocks at least this big are updated in parallel, in chunks of PARALLELCHUNK cells
+#define PARALLELBLOCKSIZE 2048
+#define PARALLELCHUNK 256
+
 /**
   Navigation function call.
   \param costmap Cost map array, of type COSTTYPE; origin is upper left
@@ -114,6 +124,9 @@ public:
 
   /**
    * @brief  Sets or resets the size of the map
+   *
+   * The cell arrays are only reallocated when they need to grow. If the size is unchanged
+   * nothing is reset, so the cost array keeps its contents until the next setCostmap().
    * @param nx The x size of the map
    * @param ny The y size of the map
    */
@@ -121,7 +134,7 @@ public:
   int nx, ny, ns;  /**< size of grid, in pixels */
 
   /**
-   * @brief  Set up the cost array for the planner, usually from ROS
+   * @brief  Set up the cost array for the planner, usually from ROS, through a lookup table
    * @param cmap The costmap
    * @param isROS Whether or not the costmap is coming in in ROS format
    * @param allow_unknown Whether or not the planner should be allowed to plan through
@@ -140,6 +153,34 @@ public:
    */
   bool calcNavFnDijkstra(bool atStart = false);
 
+  /**
+   * @brief  Keep propagating past the start until it is settled, rather than stopping when it
+   * is first reached
+   *
+   * The search stops once every cell with a potential below the start's plus margin has been
+   * expanded, which also settles the cells around the start that the path's gradient and a
+   * goal tolerance look at. This applies to A* and to Dijkstra with atStart.
+   * @param margin The potential past the start's to settle, negative to stop at first reach
+   */
+  void setSettleMargin(float margin) {settle_margin_ = margin;}
+
+  /**
+   * @brief  Update large priority blocks on a pool of threads, or one at a time if null
+   *
+   * The cells of a block are then updated from the potentials as they were before the
+   * block, in the way of a Jacobi iteration, rather than each seeing the updates of the
+   * cells before it. The field differs from the serial one by rounding-level amounts and
+   * does not depend on the number of threads.
+   * @param pool The pool to use, which must outlive the planner or be reset first
+   */
+  void setWorkerPool(nav2_costmap_2d::WorkerPool * pool) {pool_ = pool;}
+
+  /**
+   * @brief  Accessor for the number of cells the last propagation put into the priority blocks
+   * @return The number of cells expanded
+   */
+  int getExpandedCells() {return expanded_cells_;}
+
   /**
    * @brief  Accessor for the x-coordinates of a path
    * @return The x-coordinates of a path
@@ -219,6 +260,27 @@ public:
    */
   void updateCellAstar(int n);
 
+  /**
+   * @brief  Update every cell of the current priority block, in parallel on pool_
+   * @param astar Whether to use the A* heuristic in the priorities
+   */
+  void updateBlock(bool astar);
+
+  /**
+   * @brief  The new potential of cell n from its neighbors, without changing anything
+   * @param n The index to update
+   * @param astar Whether to use the A* heuristic in the priorities
+   * @param pushes Set to which neighbors to push, and to which block, if the potential is lower
+   * @return The new potential, or the current one if it does not improve
+   */
+  float cellUpdate(int n, bool astar, unsigned char & pushes);
+
+  /**
+   * @brief  Reset the propagation arrays and seed the goal
+   *
+   * With keepit, only the cells that the last propagation reached are reset.
+   * @param keepit Whether to keep the cost array, otherwise it is reset to COST_NEUTRAL
+   */
   void setupNavFn(bool keepit = false);
 
   /**
@@ -262,6 +324,26 @@ public:
   int displayInt;  /**< save second argument of display() above */
   void (* displayFn)(NavFn * nav);  /**< display function itself */
 
+  float settle_margin_;  /**< potential past the start's to expand, negative for none */
+  int expanded_cells_;  /**< cells put into the priority blocks by the last propagation */
+
+  nav2_costmap_2d::WorkerPool * pool_;  /**< threads to update large priority blocks on */
+  std::vector<float> block_pots_;  /**< new potentials of the current block's cells */
+  std::vector<unsigned char> block_pushes_;  /**< neighbors each of those cells pushes */
+
+  /**
+   * @brief  Whether a propagation towards the start may stop
+   * @param startCell The index of the start cell
+   * @param settled Every cell with a potential below this has been expanded, or 0 if unknown
+   */
+  bool startSettled(int startCell, float settled);
+
+  /** buffer reuse across plans */
+  int ns_capacity_;  /**< number of cells the cell arrays have room for */
+  bool full_reset_;  /**< whether every cell needs resetting, after the layout changed */
+  std::vector<int> reached_cells_;  /**< cells given a potential since the last reset */
+  std::vector<int> gradient_cells_;  /**< cells given a gradient since the last reset */
+
   /** save costmap */
   /**< write out costmap and start/goal states as fname.pgm and fname.txt */
   void savemap(const char * fname);
@@ -19,16 +19,26 @@
 #include <chrono>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "geometry_msgs/msg/point.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav2_costmap_2d/costmap_2d_ros.hpp"
+#include "nav2_costmap_2d/shared_costmap.hpp"
+#include "nav2_costmap_2d/worker_pool.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 #include "nav2_msgs/action/compute_path_to_pose.hpp"
 #include "nav2_msgs/msg/costmap.hpp"
 #include "nav2_msgs/msg/path.hpp"
+#include "nav2_msgs/srv/compute_paths.hpp"
+#include "nav2_navfn_planner/dstar_lite.hpp"
 #include "nav2_navfn_planner/navfn.hpp"
+#include "nav2_navfn_planner/region_graph.hpp"
+#include "nav2_navfn_planner/route_cache.hpp"
 #include "nav2_util/costmap_service_client.hpp"
+#include "nav2_util/metrics.hpp"
 #include "nav2_util/robot_utils.hpp"
 #include "nav2_util/simple_action_server.hpp"
 #include "nav_msgs/msg/path.hpp"
@@ -42,7 +52,7 @@ namespace nav2_navfn_planner
 class NavfnPlanner : public nav2_util::LifecycleNode
 {
 public:
-  NavfnPlanner();
+  explicit NavfnPlanner(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   ~NavfnPlanner();
 
 protected:
@@ -62,13 +72,73 @@ protected:
   // The action server callback
   void computePathToPose();
 
+  // The ComputePaths service plans between one pose and many from a single potential
+  rclcpp::Service<nav2_msgs::srv::ComputePaths>::SharedPtr compute_paths_service_;
+
+  void computePaths(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<nav2_msgs::srv::ComputePaths::Request> request,
+    const std::shared_ptr<nav2_msgs::srv::ComputePaths::Response> response);
+
+  // Serializes the action and the service, which share the planner and the costmap copy
+  std::mutex planner_mutex_;
+
   // Compute a plan given start and goal poses, provided in global world frame.
   bool makePlan(
     const geometry_msgs::msg::Pose & start,
     const geometry_msgs::msg::Pose & goal, double tolerance,
     nav2_msgs::msg::Path & plan);
 
-  // Compute the navigation function given a seed point in the world to start from
+  // Plan on a max-pooled copy of the costmap and mark everything in the full
+  // resolution search further than corridor_width from that path as an obstacle
+  bool restrictToCorridor(const int * map_start, const int * map_goal, double tolerance);
+
+  // With reuse_potential, plan on a potential grown from the goal, which serves any start
+  // it has settled and is kept until the goal or the costmap around it changes. Returns
+  // false to fall back to planning from the robot.
+  bool makePlanFromGoalPotential(
+    const geometry_msgs::msg::Pose & start,
+    const geometry_msgs::msg::Pose & goal,
+    nav2_msgs::msg::Path & plan);
+
+  // Whether the kept goal potential was computed on a different costmap somewhere that
+  // the wave reached or was stopped by
+  bool goalPotentialOutOfDate();
+
+  // With incremental_replanning, repair the kept D* Lite search to the goal where the costmap
+  // changed and plan on it. Returns false to fall back to planning from the robot.
+  bool makePlanIncrementally(
+    const geometry_msgs::msg::Pose & start,
+    const geometry_msgs::msg::Pose & goal,
+    nav2_msgs::msg::Path & plan);
+
+  // With region_size, search the region graph and refine the path through the first
+  // refine_regions regions with NavFn, following the shortest paths within the others.
+  // Returns false to fall back to planning over the whole costmap.
+  bool makePlanOverRegions(
+    const geometry_msgs::msg::Pose & start,
+    const geometry_msgs::msg::Pose & goal,
+    nav2_msgs::msg::Path & plan);
+
+  // With route_cache_size, follow the route kept from the start's square to the goal's,
+  // repairing it where it is blocked, joined to the start and the goal in a straight line.
+  // Returns false to plan with makePlan, whose plan is then kept.
+  bool makePlanFromRouteCache(
+    const geometry_msgs::msg::Pose & start,
+    const geometry_msgs::msg::Pose & goal,
+    nav2_msgs::msg::Path & plan);
+
+  // Replan the part of a route from route_repair_margin before the blocked pose to as far
+  // past the poses blocked after it
+  bool repairRoute(std::vector<geometry_msgs::msg::Pose> & poses, size_t blocked);
+
+  // Find the reachable cell closest to the goal, within tolerance of it
+  bool findLegalGoal(
+    const geometry_msgs::msg::Pose & goal, double tolerance,
+    geometry_msgs::msg::Pose & best_pose);
+
+  // Compute the navigation function over the whole costmap given a seed point in the
+  // world to start from
   bool computePotential(const geometry_msgs::msg::Point & world_point);
 
   // Compute a plan to a goal from a potential - must call computePotential first
@@ -76,6 +146,22 @@ protected:
     const geometry_msgs::msg::Pose & goal,
     nav2_msgs::msg::Path & plan);
 
+  // Smooth the path with path_smoothing passes, then keep a pose every path_spacing along it,
+  // or with shortcut_cost, shortcut it instead
+  void simplifyPath(nav2_msgs::msg::Path & plan);
+
+  // Keep only the poses from which the next kept one is in sight, as in Theta*
+  void shortcutPath(std::vector<geometry_msgs::msg::Pose> & poses);
+
+  // Replace the straight segments between the poses with a Catmull-Rom spline where it stays
+  // below shortcut_cost
+  void splinePath(std::vector<geometry_msgs::msg::Pose> & poses);
+
+  // Whether every cell on the line between two points costs less than max_cost
+  bool inSight(
+    const geometry_msgs::msg::Point & from, const geometry_msgs::msg::Point & to,
+    int max_cost);
+
   // Remove artifacts at the end of the path - originated from planning on a discretized world
   void smoothApproachToGoal(
     const geometry_msgs::msg::Pose & goal,
@@ -124,9 +210,17 @@ protected:
   // Determine if a new planner object should be made
   bool isPlannerOutOfDate();
 
+  // Updates the large priority blocks of planner_ in parallel, null to update them serially.
+  // Declared first, so that it outlives the planner.
+  std::unique_ptr<nav2_costmap_2d::WorkerPool> propagation_pool_;
+
   // Planner based on ROS1 NavFn algorithm
   std::unique_ptr<NavFn> planner_;
 
+  // Planner for the coarse pass, and the max-pooled costmap it runs on
+  std::unique_ptr<NavFn> coarse_planner_;
+  std::vector<unsigned char> coarse_costmap_;
+
   // TF buffer
   std::shared_ptr<tf2_ros::Buffer> tf_;
   std::shared_ptr<tf2_ros::TransformListener> tf_listener_;
@@ -134,6 +228,17 @@ protected:
   // Service client for getting the costmap
   nav2_util::CostmapServiceClient costmap_client_{"navfn_planner"};
 
+  // With own_costmap, the planner runs its own costmap node and reads it directly
+  // instead of calling the service
+  bool own_costmap_;
+  std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros_;
+  std::unique_ptr<std::thread> costmap_thread_;
+  std::unique_ptr<rclcpp::executor::Executor> costmap_executor_;
+
+  // With shared_costmap set, the planner copies the costmap out of the shared memory segment
+  // of that name, falling back to the service until the costmap node has written to it
+  std::unique_ptr<nav2_costmap_2d::SharedCostmapReader> shared_costmap_;
+
   // Publishers for the path
   rclcpp_lifecycle::LifecyclePublisher<nav_msgs::msg::Path>::SharedPtr plan_publisher_;
 
@@ -153,6 +258,74 @@ protected:
 
   // Whether to use the astar planner or default dijkstras
   bool use_astar_;
+
+  // Whether to search until the goal and its tolerance are settled instead of stopping
+  // as soon as the goal cell is reached
+  bool settle_start_;
+
+  // Whether to keep the potential grown from the goal across plans to the same goal
+  bool reuse_potential_;
+
+  // The potential in planner_ is grown from goal_potential_cell_ on goal_potential_costmap_,
+  // and settled up to goal_potential_bound_
+  bool goal_potential_valid_{false};
+  unsigned int goal_potential_cell_[2];
+  float goal_potential_bound_;
+  nav2_msgs::msg::Costmap goal_potential_costmap_;
+
+  // Whether to keep a D* Lite search to the goal across plans and repair it where the costmap
+  // changed
+  bool incremental_replanning_;
+
+  // The search to the goal, on a costmap with the origin incremental_origin_
+  std::unique_ptr<DStarLite> incremental_planner_;
+  double incremental_origin_[2];
+
+  // Cells of the costmap per coarse cell side, 0 or 1 to plan at full resolution only
+  int coarse_factor_;
+
+  // Width in meters of the corridor around the coarse path that the full search may use
+  double corridor_width_;
+
+  // Cells per side of the regions of region_graph_, 0 to plan without it
+  int region_size_;
+
+  // Regions along the graph's path that NavFn refines the path through
+  int refine_regions_;
+
+  // Kept across plans and repaired where the costmap changed
+  std::unique_ptr<RegionGraph> region_graph_;
+
+  // Routes by the squares of their start and goal, kept for the life of the node and, with
+  // route_cache_file, saved there on deactivation and loaded on configuration
+  std::unique_ptr<RouteCache> route_cache_;
+  std::string route_cache_file_;
+
+  // Meters of a blocked route replanned on either side of the blocked poses
+  double route_repair_margin_;
+
+  // Step in cells taken down the gradient while extracting a path, at most 1
+  double path_step_;
+
+  // Meters along the path between the poses kept in a plan, 0 to keep every step
+  double path_spacing_;
+
+  // Passes of neighbor averaging over the path before it is thinned out
+  int path_smoothing_;
+
+  // The costmap cost that a shortcut may not cross, 0 to not shortcut the path
+  int shortcut_cost_;
+
+  // Whether to follow a spline through the corners of the shortcut path
+  bool shortcut_spline_;
+
+  // Every fetch of the costmap, from whichever source, and every plan of the action
+  nav2_util::LatencyHistogram & get_costmap_time_;
+  nav2_util::LatencyHistogram & make_plan_time_;
+
+  // The plans of the action served from the route cache, and those it had no route for
+  nav2_util::Counter & route_cache_hits_;
+  nav2_util::Counter & route_cache_misses_;
 };
 
 }  // namespace nav2_navfn_planner
@@ -0,0 +1,144 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_NAVFN_PLANNER__REGION_GRAPH_HPP_
+#define NAV2_NAVFN_PLANNER__REGION_GRAPH_HPP_
+
+#include <vector>
+
+namespace nav2_navfn_planner
+{
+
+/**
+ * @class RegionGraph
+ * @brief A graph over square regions of a costmap, for searching long distances in two
+ * levels as in HPA* (Botea, Mueller and Schaeffer, Near Optimal Hierarchical Path-Finding)
+ *
+ * Neighboring regions are connected through entrances: one in the middle of each run of
+ * traversable cells along their shared border, or one at each end of a long run. The
+ * entrances of a region are connected by the costs of the shortest paths between them within
+ * it, so a search of the graph only expands entrances. Cells cost what NavFn makes of them,
+ * and a move between two cells the mean of their costs times its length.
+ */
+class RegionGraph
+{
+public:
+  struct Cell
+  {
+    int x;
+    int y;
+  };
+
+  /**
+   * @param region_size Cells per side of a region
+   */
+  explicit RegionGraph(int region_size);
+
+  /**
+   * @brief  Rebuild the regions whose cells changed since the last update, along with their
+   *         neighbors, or all of them for a costmap of another size
+   * @param costmap The ROS costs of the cells, row by row
+   * @return The number of regions whose cells changed
+   */
+  int update(const unsigned char * costmap, int nx, int ny, bool allow_unknown);
+
+  /**
+   * @brief  Search the graph from start to goal, taking the start cell as free
+   * @param waypoints Set to the cells the path runs through, from start to goal: each
+   *        entrance it takes adds the cells on both sides of the border
+   * @return false if the goal is an obstacle or cannot be reached
+   */
+  bool plan(Cell start, Cell goal, std::vector<Cell> & waypoints);
+
+  /**
+   * @brief  Append the cells of the shortest path from one cell to another, to included, both
+   *         in one region or either side of a border between two
+   * @return false if there is no path within the region
+   */
+  bool appendCellPath(Cell from, Cell to, std::vector<Cell> & cells);
+
+  /// @brief  The index of the region of a cell
+  int regionOf(Cell cell) const
+  {
+    return (cell.y / region_size_) * regions_x_ + cell.x / region_size_;
+  }
+
+  int getRegionSize() const {return region_size_;}
+  int getRegionsX() const {return regions_x_;}
+  int getRegionsY() const {return regions_y_;}
+
+private:
+  // Sides of a region, each the border with a neighbor
+  enum Side {WEST = 0, EAST = 1, SOUTH = 2, NORTH = 3};
+
+  struct Node
+  {
+    Cell cell;
+    int side;
+    int entrance;  ///< Index among the entrances of the border on that side
+  };
+
+  struct Region
+  {
+    std::vector<Node> nodes;  ///< The entrances of its borders, side by side
+    int side_offset[4];  ///< Index of the first node of each side
+    std::vector<float> costs;  ///< Between every two nodes, row by row, infinite if apart
+  };
+
+  // The entrances of a border, as positions along it
+  using Border = std::vector<int>;
+
+  float cost(Cell cell) const {return costs_[cell.y * nx_ + cell.x];}
+  bool passable(Cell cell) const {return costs_[cell.y * nx_ + cell.x] < blocked_;}
+
+  // The border of a region on a side, or null on the edge of the costmap
+  Border * border(int region, int side);
+  int neighbor(int region, int side) const;
+
+  // The cells a region covers
+  void bounds(int region, int & min_x, int & min_y, int & max_x, int & max_y) const;
+
+  // The cell of an entrance on the given side of a region
+  Cell entranceCell(int region, int side, int along) const;
+
+  void rebuildBorder(int region, int side);
+  void rebuildRegion(int region);
+
+  // Shortest paths from a cell to every cell of its region, into distances_ and parents_
+  void searchRegion(int region, Cell source);
+  // The distance to a cell of the region from the last search of it
+  float regionDistance(int region, Cell cell) const;
+
+  float moveCost(Cell a, Cell b) const;
+
+  int region_size_;
+  int nx_{0};
+  int ny_{0};
+  int regions_x_{0};
+  int regions_y_{0};
+  std::vector<unsigned char> costs_;  ///< Per cell, as NavFn translates them
+  unsigned char blocked_;  ///< The cost of the cells that cannot be crossed
+  std::vector<Region> regions_;
+  std::vector<Border> vertical_;  ///< Between each region and its east neighbor
+  std::vector<Border> horizontal_;  ///< Between each region and its north neighbor
+
+  // Scratch space of searchRegion(), over the cells of a region
+  std::vector<float> distances_;
+  std::vector<int> parents_;
+  std::vector<unsigned char> settled_;
+};
+
+}  // namespace nav2_navfn_planner
+
+#endif  // NAV2_NAVFN_PLANNER__REGION_GRAPH_HPP_
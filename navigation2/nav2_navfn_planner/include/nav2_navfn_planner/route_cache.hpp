@@ -0,0 +1,136 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_NAVFN_PLANNER__ROUTE_CACHE_HPP_
+#define NAV2_NAVFN_PLANNER__ROUTE_CACHE_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "geometry_msgs/msg/pose.hpp"
+#include "geometry_msgs/msg/pose2_d.hpp"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/path_validity.hpp"
+#include "nav2_msgs/msg/costmap.hpp"
+
+namespace nav2_navfn_planner
+{
+
+/**
+ * @class RouteCache
+ * @brief Plans kept by the squares of the map their start and goal fall in, for a robot that
+ * goes back and forth between the same places
+ *
+ * Each route keeps a PathValidity, so a route asked for again is only checked near the cells
+ * of the costmap that changed since it was last checked. The changed cells are found by
+ * comparing each costmap given with the last one. Poses on cells of the inscribed cost or
+ * more, short of unknown, block a route, as they would stop NavFn. Past capacity, the route
+ * least recently used is dropped.
+ */
+class RouteCache
+{
+public:
+  /**
+   * @param region_size Meters per side of the squares starts and goals are matched by
+   * @param capacity The most routes kept
+   */
+  RouteCache(double region_size, size_t capacity);
+
+  /**
+   * @brief Compare the costmap with the last one, for the routes to be checked where it
+   * changed, and keep it to check them on
+   */
+  void setCostmap(const nav2_msgs::msg::Costmap & costmap);
+
+  /**
+   * @brief The route from start's square to goal's, or null if there is none
+   */
+  const std::vector<geometry_msgs::msg::Pose> * find(
+    const geometry_msgs::msg::Pose & start, const geometry_msgs::msg::Pose & goal);
+
+  /**
+   * @brief The first pose of the route from start's square to goal's that is blocked on the
+   * last costmap given, or -1
+   * @param checked Set to the number of poses checked, if not null
+   */
+  int check(
+    const geometry_msgs::msg::Pose & start, const geometry_msgs::msg::Pose & goal,
+    size_t * checked = nullptr);
+
+  /**
+   * @brief Keep poses as the route from start's square to goal's, replacing any other
+   */
+  void insert(
+    const geometry_msgs::msg::Pose & start, const geometry_msgs::msg::Pose & goal,
+    const std::vector<geometry_msgs::msg::Pose> & poses);
+
+  void erase(const geometry_msgs::msg::Pose & start, const geometry_msgs::msg::Pose & goal);
+
+  size_t size() const {return routes_.size();}
+
+  /**
+   * @brief Write the routes to filename, through a file beside it renamed over it
+   */
+  bool save(const std::string & filename) const;
+
+  /**
+   * @brief Add the routes in filename, which are checked whole when first asked for
+   * @return false if the file can't be read, or was saved with another region_size
+   */
+  bool load(const std::string & filename);
+
+private:
+  struct Key
+  {
+    int32_t start_x, start_y, goal_x, goal_y;
+
+    bool operator==(const Key & other) const
+    {
+      return start_x == other.start_x && start_y == other.start_y &&
+             goal_x == other.goal_x && goal_y == other.goal_y;
+    }
+  };
+
+  struct KeyHash
+  {
+    size_t operator()(const Key & key) const;
+  };
+
+  struct Route
+  {
+    std::vector<geometry_msgs::msg::Pose> poses;
+    std::vector<geometry_msgs::msg::Pose2D> poses_2d;
+    std::unique_ptr<nav2_costmap_2d::PathValidity> validity;
+    uint64_t last_used;
+  };
+
+  Key keyOf(const geometry_msgs::msg::Pose & start, const geometry_msgs::msg::Pose & goal) const;
+  Route & add(const Key & key, const std::vector<geometry_msgs::msg::Pose> & poses);
+
+  double region_size_;
+  size_t capacity_;
+  uint64_t uses_{0};
+  std::unordered_map<Key, Route, KeyHash> routes_;
+
+  // The last costmap given, and whether there was one
+  nav2_costmap_2d::Costmap2D costmap_;
+  bool have_costmap_{false};
+};
+
+}  // namespace nav2_navfn_planner
+
+#endif  // NAV2_NAVFN_PLANNER__ROUTE_CACHE_HPP_
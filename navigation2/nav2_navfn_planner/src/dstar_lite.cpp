@@ -0,0 +1,323 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_navfn_planner/dstar_lite.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "nav2_navfn_planner/navfn.hpp"
+
+namespace nav2_navfn_planner
+{
+
+namespace
+{
+
+const float infinity = std::numeric_limits<float>::infinity();
+const float diagonal = std::sqrt(2.0f);
+
+// Relative rounding error allowed for in the keys
+const float key_tolerance = 1e-4f;
+
+const int neighbor_dx[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+const int neighbor_dy[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+// The translation of NavFn::setCostmap() for a ROS costmap
+void makeCostTable(bool allow_unknown, unsigned char * lut)
+{
+  for (int v = 0; v < 256; v++) {
+    int cost = COST_OBS;
+    if (v < COST_OBS_ROS) {
+      cost = std::min(static_cast<int>(COST_NEUTRAL + COST_FACTOR * v), COST_OBS - 1);
+    } else if (v == COST_UNKNOWN_ROS && allow_unknown) {
+      cost = COST_OBS - 1;
+    }
+    lut[v] = cost;
+  }
+}
+
+}  // namespace
+
+DStarLite::DStarLite()
+{
+}
+
+void
+DStarLite::reset(
+  const unsigned char * costmap, int nx, int ny, bool allow_unknown, Cell goal)
+{
+  nx_ = nx;
+  ny_ = ny;
+  goal_ = goal;
+  goal_index_ = goal.y * nx + goal.x;
+  start_index_ = -1;
+  last_index_ = -1;
+  key_modifier_ = 0.0f;
+
+  unsigned char lut[256];
+  makeCostTable(allow_unknown, lut);
+  costs_.resize(nx * ny);
+  for (int i = 0; i < nx * ny; ++i) {
+    costs_[i] = lut[costmap[i]];
+  }
+  g_.assign(nx * ny, infinity);
+  rhs_.assign(nx * ny, infinity);
+  rhs_[goal_index_] = 0.0f;
+  open_.assign(nx * ny, 0);
+  queued_.resize(nx * ny);
+  queue_ = decltype(queue_)();
+}
+
+int
+DStarLite::update(const unsigned char * costmap, bool allow_unknown)
+{
+  unsigned char lut[256];
+  makeCostTable(allow_unknown, lut);
+
+  // compared a row at a time, as most of them are unchanged
+  std::vector<int> changed;
+  std::vector<unsigned char> row(nx_);
+  for (int y = 0; y < ny_; ++y) {
+    const unsigned char * source = costmap + y * nx_;
+    for (int x = 0; x < nx_; ++x) {
+      row[x] = lut[source[x]];
+    }
+    unsigned char * kept = &costs_[y * nx_];
+    if (memcmp(&row[0], kept, nx_) == 0) {
+      continue;
+    }
+    for (int x = 0; x < nx_; ++x) {
+      if (row[x] != kept[x]) {
+        kept[x] = row[x];
+        changed.push_back(y * nx_ + x);
+      }
+    }
+  }
+
+  // nothing was searched before the first plan
+  if (last_index_ < 0) {
+    return changed.size();
+  }
+
+  // a cell's cost changes the moves into it, and the diagonal moves past its corners, all of
+  // which start from it or its neighbors
+  for (int index : changed) {
+    updateVertex(index);
+    int x = index % nx_;
+    int y = index / nx_;
+    for (int n = 0; n < 8; ++n) {
+      int neighbor_x = x + neighbor_dx[n];
+      int neighbor_y = y + neighbor_dy[n];
+      if (neighbor_x >= 0 && neighbor_x < nx_ && neighbor_y >= 0 && neighbor_y < ny_) {
+        updateVertex(neighbor_y * nx_ + neighbor_x);
+      }
+    }
+  }
+
+  // drop the entries left behind by cells that were queued again, once they outnumber the cells
+  if (queue_.size() > costs_.size()) {
+    std::vector<Key> current;
+    while (!queue_.empty()) {
+      if (isCurrent(queue_.top())) {
+        current.push_back(queue_.top());
+      }
+      queue_.pop();
+    }
+    queue_ = decltype(queue_)(std::greater<Key>(), std::move(current));
+  }
+  return changed.size();
+}
+
+bool
+DStarLite::plan(Cell start, std::vector<Cell> & path)
+{
+  path.clear();
+  expanded_cells_ = 0;
+  int start_index = start.y * nx_ + start.x;
+  if (last_index_ < 0) {
+    start_index_ = last_index_ = start_index;
+    push(goal_index_);
+  } else if (start_index != last_index_) {
+    // the keys queued so far are lower bounds by as much as the start moved
+    key_modifier_ += heuristic(last_index_, start_index);
+    start_index_ = last_index_ = start_index;
+  }
+
+  computeShortestPath();
+  if (g_[start_index_] == infinity) {
+    return false;
+  }
+
+  // down the distances to the goal, which lead to it in at most as many moves as there are cells
+  int index = start_index_;
+  path.push_back(start);
+  for (size_t step = 0; index != goal_index_; ++step) {
+    if (step == costs_.size()) {
+      return false;
+    }
+    int x = index % nx_;
+    int y = index / nx_;
+    int best = -1;
+    float best_distance = infinity;
+    for (int n = 0; n < 8; ++n) {
+      int neighbor_x = x + neighbor_dx[n];
+      int neighbor_y = y + neighbor_dy[n];
+      if (neighbor_x < 0 || neighbor_x >= nx_ || neighbor_y < 0 || neighbor_y >= ny_) {
+        continue;
+      }
+      int neighbor = neighbor_y * nx_ + neighbor_x;
+      float distance = moveCost(index, neighbor) + g_[neighbor];
+      if (distance < best_distance) {
+        best_distance = distance;
+        best = neighbor;
+      }
+    }
+    if (best < 0) {
+      return false;
+    }
+    index = best;
+    path.push_back({index % nx_, index / nx_});
+  }
+  return true;
+}
+
+float
+DStarLite::heuristic(int a, int b) const
+{
+  // no move costs less than a neutral cell
+  int dx = std::abs(a % nx_ - b % nx_);
+  int dy = std::abs(a / nx_ - b / nx_);
+  return COST_NEUTRAL * (std::max(dx, dy) + (diagonal - 1.0f) * std::min(dx, dy));
+}
+
+DStarLite::Key
+DStarLite::calculateKey(int index) const
+{
+  float distance = std::min(g_[index], rhs_[index]);
+  return {distance + heuristic(start_index_, index) + key_modifier_, distance, index};
+}
+
+float
+DStarLite::moveCost(int from, int to) const
+{
+  if (costs_[from] >= COST_OBS || costs_[to] >= COST_OBS) {
+    return infinity;
+  }
+  int from_x = from % nx_;
+  int to_x = to % nx_;
+  if (from_x != to_x && from / nx_ != to / nx_) {
+    // the corners on both sides of a diagonal move must be open
+    if (costs_[from - from_x + to_x] >= COST_OBS || costs_[to - to_x + from_x] >= COST_OBS) {
+      return infinity;
+    }
+    return 0.5f * (costs_[from] + costs_[to]) * diagonal;
+  }
+  return 0.5f * (costs_[from] + costs_[to]);
+}
+
+void
+DStarLite::updateVertex(int index)
+{
+  if (index != goal_index_) {
+    int x = index % nx_;
+    int y = index / nx_;
+    float rhs = infinity;
+    for (int n = 0; n < 8; ++n) {
+      int neighbor_x = x + neighbor_dx[n];
+      int neighbor_y = y + neighbor_dy[n];
+      if (neighbor_x >= 0 && neighbor_x < nx_ && neighbor_y >= 0 && neighbor_y < ny_) {
+        int neighbor = neighbor_y * nx_ + neighbor_x;
+        rhs = std::min(rhs, moveCost(index, neighbor) + g_[neighbor]);
+      }
+    }
+    rhs_[index] = rhs;
+  }
+  if (g_[index] != rhs_[index]) {
+    push(index);
+  } else {
+    open_[index] = 0;
+  }
+}
+
+void
+DStarLite::computeShortestPath()
+{
+  while (true) {
+    while (!queue_.empty() && !isCurrent(queue_.top())) {
+      queue_.pop();
+    }
+    // the keys tie with the start's within the rounding of the key modifier, and the cells that
+    // tie with it have to be expanded for the path down from it to be the shortest
+    float bound = calculateKey(start_index_).first * (1.0f + key_tolerance);
+    if (queue_.empty() ||
+      (queue_.top().first > bound && rhs_[start_index_] == g_[start_index_]))
+    {
+      return;
+    }
+
+    Key old_key = queue_.top();
+    int index = old_key.index;
+    queue_.pop();
+    Key new_key = calculateKey(index);
+    if (new_key > old_key) {
+      push(index);
+      continue;
+    }
+
+    ++expanded_cells_;
+    open_[index] = 0;
+    if (g_[index] > rhs_[index]) {
+      g_[index] = rhs_[index];
+    } else {
+      g_[index] = infinity;
+      updateVertex(index);
+    }
+    int x = index % nx_;
+    int y = index / nx_;
+    for (int n = 0; n < 8; ++n) {
+      int neighbor_x = x + neighbor_dx[n];
+      int neighbor_y = y + neighbor_dy[n];
+      if (neighbor_x >= 0 && neighbor_x < nx_ && neighbor_y >= 0 && neighbor_y < ny_) {
+        updateVertex(neighbor_y * nx_ + neighbor_x);
+      }
+    }
+  }
+}
+
+void
+DStarLite::push(int index)
+{
+  Key key = calculateKey(index);
+  if (isCurrent(key)) {
+    return;
+  }
+  queued_[index] = key;
+  open_[index] = 1;
+  queue_.push(key);
+}
+
+bool
+DStarLite::isCurrent(const Key & key) const
+{
+  const Key & queued = queued_[key.index];
+  return open_[key.index] && queued.first == key.first && queued.second == key.second;
+}
+
+}  // namespace nav2_navfn_planner
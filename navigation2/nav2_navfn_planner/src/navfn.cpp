@@ -44,6 +44,8 @@
 #include "nav2_navfn_planner/navfn.hpp"
 
 #include <algorithm>
+#include "nav2_costmap_2d/worker_pool.hpp"
+#include "nav2_util/grid_memory.hpp"
 #include "rclcpp/rclcpp.hpp"
 
 namespace nav2_navfn_planner
@@ -113,6 +115,9 @@ NavFn::NavFn(int xs, int ys)
   potarr = NULL;
   pending = NULL;
   gradx = grady = NULL;
+  ns_capacity_ = 0;
+  full_reset_ = true;
+  nx = ny = ns = 0;
   setNavArr(xs, ys);
 
   // priority buffers
@@ -136,25 +141,32 @@ NavFn::NavFn(int xs, int ys)
   npathbuf = npath = 0;
   pathx = pathy = NULL;
   pathStep = 0.5;
+
+  // stop when the start is first reached
+  settle_margin_ = -1.0;
+  expanded_cells_ = 0;
+
+  // update one cell at a time
+  pool_ = NULL;
 }
 
 
 NavFn::~NavFn()
 {
   if (costarr) {
-    delete[] costarr;
+    nav2_util::free_grid(costarr);
   }
   if (potarr) {
-    delete[] potarr;
+    nav2_util::free_grid(potarr);
   }
   if (pending) {
-    delete[] pending;
+    nav2_util::free_grid(pending);
   }
   if (gradx) {
-    delete[] gradx;
+    nav2_util::free_grid(gradx);
   }
   if (grady) {
-    delete[] grady;
+    nav2_util::free_grid(grady);
   }
   if (pathx) {
     delete[] pathx;
@@ -204,34 +216,49 @@ NavFn::setNavArr(int xs, int ys)
 {
   RCLCPP_DEBUG(rclcpp::get_logger("rclcpp"), "[NavFn] Array is %d x %d\n", xs, ys);
 
+  if (xs != nx || ys != ny) {
+    full_reset_ = true;
+  }
   nx = xs;
   ny = ys;
   ns = nx * ny;
 
+  // keep the arrays while they are big enough, replanning at the same size resets
+  // only what the last plan touched
+  if (ns <= ns_capacity_) {
+    if (full_reset_) {
+      memset(costarr, 0, ns * sizeof(COSTTYPE));
+    }
+    return;
+  }
+  ns_capacity_ = ns;
+  full_reset_ = true;
+  reached_cells_.clear();
+  gradient_cells_.clear();
+
   if (costarr) {
-    delete[] costarr;
+    nav2_util::free_grid(costarr);
   }
   if (potarr) {
-    delete[] potarr;
+    nav2_util::free_grid(potarr);
   }
   if (pending) {
-    delete[] pending;
+    nav2_util::free_grid(pending);
   }
 
   if (gradx) {
-    delete[] gradx;
+    nav2_util::free_grid(gradx);
   }
   if (grady) {
-    delete[] grady;
+    nav2_util::free_grid(grady);
   }
 
-  costarr = new COSTTYPE[ns];  // cost array, 2d config space
-  memset(costarr, 0, ns * sizeof(COSTTYPE));
-  potarr = new float[ns];  // navigation potential array
-  pending = new bool[ns];
-  memset(pending, 0, ns * sizeof(bool));
-  gradx = new float[ns];
-  grady = new float[ns];
+  // zeroed, and on huge pages for large maps
+  costarr = nav2_util::allocate_grid_of<COSTTYPE>(ns);  // cost array, 2d config space
+  potarr = nav2_util::allocate_grid_of<float>(ns);  // navigation potential array
+  pending = nav2_util::allocate_grid_of<bool>(ns);
+  gradx = nav2_util::allocate_grid_of<float>(ns);
+  grady = nav2_util::allocate_grid_of<float>(ns);
 }
 
 
@@ -242,51 +269,46 @@ NavFn::setNavArr(int xs, int ys)
 void
 NavFn::setCostmap(const COSTTYPE * cmap, bool isROS, bool allow_unknown)
 {
+  static_assert(sizeof(COSTTYPE) == 1, "The cost lookup table needs a one byte COSTTYPE");
+
+  // This transforms the incoming cost values:
+  // COST_OBS                 -> COST_OBS (incoming "lethal obstacle")
+  // COST_OBS_ROS             -> COST_OBS (incoming "inscribed inflated obstacle")
+  // values in range 0 to 252 -> values from COST_NEUTRAL to COST_OBS_ROS.
+  // COST_UNKNOWN_ROS         -> COST_OBS - 1 if unknown space is allowed, else COST_OBS
+  // A PGM map always allows unknown space.
+  COSTTYPE lut[256];
+  for (int v = 0; v < 256; v++) {
+    int cost = COST_OBS;
+    if (v < COST_OBS_ROS) {
+      cost = COST_NEUTRAL + COST_FACTOR * v;
+      if (cost >= COST_OBS) {
+        cost = COST_OBS - 1;
+      }
+    } else if (v == COST_UNKNOWN_ROS && (allow_unknown || !isROS)) {
+      cost = COST_OBS - 1;
+    }
+    lut[v] = cost;
+  }
+
   COSTTYPE * cm = costarr;
+  int ntot = 0;
   if (isROS) {  // ROS-type cost array
-    for (int i = 0; i < ny; i++) {
-      int k = i * nx;
-      for (int j = 0; j < nx; j++, k++, cmap++, cm++) {
-        // This transforms the incoming cost values:
-        // COST_OBS                 -> COST_OBS (incoming "lethal obstacle")
-        // COST_OBS_ROS             -> COST_OBS (incoming "inscribed inflated obstacle")
-        // values in range 0 to 252 -> values from COST_NEUTRAL to COST_OBS_ROS.
-        *cm = COST_OBS;
-        int v = *cmap;
-        if (v < COST_OBS_ROS) {
-          v = COST_NEUTRAL + COST_FACTOR * v;
-          if (v >= COST_OBS) {
-            v = COST_OBS - 1;
-          }
-          *cm = v;
-        } else if (v == COST_UNKNOWN_ROS && allow_unknown) {
-          v = COST_OBS - 1;
-          *cm = v;
-        }
-      }
+    for (int k = 0; k < ns; k++) {
+      cm[k] = lut[cmap[k]];
+      ntot += cm[k] >= COST_OBS;
     }
   } else {  // not a ROS map, just a PGM
-    for (int i = 0; i < ny; i++) {
-      int k = i * nx;
-      for (int j = 0; j < nx; j++, k++, cmap++, cm++) {
-        *cm = COST_OBS;
-        if (i < 7 || i > ny - 8 || j < 7 || j > nx - 8) {
-          continue;  // don't do borders
-        }
-        int v = *cmap;
-        if (v < COST_OBS_ROS) {
-          v = COST_NEUTRAL + COST_FACTOR * v;
-          if (v >= COST_OBS) {
-            v = COST_OBS - 1;
-          }
-          *cm = v;
-        } else if (v == COST_UNKNOWN_ROS) {
-          v = COST_OBS - 1;
-          *cm = v;
-        }
+    for (int i = 0; i < ny; i++, cmap += nx, cm += nx) {
+      bool border_row = i < 7 || i > ny - 8;
+      for (int j = 0; j < nx; j++) {
+        // don't do borders
+        cm[j] = border_row || j < 7 || j > nx - 8 ? COST_OBS : lut[cmap[j]];
+        ntot += cm[j] >= COST_OBS;
       }
     }
   }
+  nobs = ntot;
 }
 
 bool
@@ -359,32 +381,62 @@ int NavFn::getPathLen() {return npath;}
 void
 NavFn::setupNavFn(bool keepit)
 {
-  // reset values in propagation arrays
-  for (int i = 0; i < ns; i++) {
-    potarr[i] = POT_HIGH;
-    if (!keepit) {
-      costarr[i] = COST_NEUTRAL;
+  bool full_reset = full_reset_ || !keepit;
+  if (full_reset) {
+    // reset values in propagation arrays
+    for (int i = 0; i < ns; i++) {
+      potarr[i] = POT_HIGH;
+      if (!keepit) {
+        costarr[i] = COST_NEUTRAL;
+      }
+      gradx[i] = grady[i] = 0.0;
+    }
+    memset(pending, 0, ns * sizeof(bool));
+    full_reset_ = false;
+  } else {
+    // only the cells the last propagation reached are not already reset, and the
+    // cells still pending are all in the priority buffers
+    for (int n : reached_cells_) {
+      potarr[n] = POT_HIGH;
+    }
+    for (int n : gradient_cells_) {
+      gradx[n] = grady[n] = 0.0;
+    }
+    for (int i = 0; i < curPe; i++) {
+      pending[curP[i]] = false;
+    }
+    for (int i = 0; i < nextPe; i++) {
+      pending[nextP[i]] = false;
+    }
+    for (int i = 0; i < overPe; i++) {
+      pending[overP[i]] = false;
     }
-    gradx[i] = grady[i] = 0.0;
   }
-
-  // outer bounds of cost array
+  reached_cells_.clear();
+  gradient_cells_.clear();
+
+  // outer bounds of cost array, counted as obstacles if they were not already
+  int nborder = 0;
+  auto set_border = [&](COSTTYPE * pc) {
+      nborder += *pc < COST_OBS;
+      *pc = COST_OBS;
+    };
   COSTTYPE * pc;
   pc = costarr;
   for (int i = 0; i < nx; i++) {
-    *pc++ = COST_OBS;
+    set_border(pc++);
   }
   pc = costarr + (ny - 1) * nx;
   for (int i = 0; i < nx; i++) {
-    *pc++ = COST_OBS;
+    set_border(pc++);
   }
   pc = costarr;
   for (int i = 0; i < ny; i++, pc += nx) {
-    *pc = COST_OBS;
+    set_border(pc);
   }
   pc = costarr + nx - 1;
   for (int i = 0; i < ny; i++, pc += nx) {
-    *pc = COST_OBS;
+    set_border(pc);
   }
 
   // priority buffers
@@ -395,21 +447,24 @@ NavFn::setupNavFn(bool keepit)
   nextPe = 0;
   overP = pb3;
   overPe = 0;
-  memset(pending, 0, ns * sizeof(bool));
 
   // set goal
   int k = goal[0] + goal[1] * nx;
   initCost(k, 0);
 
-  // find # of obstacle cells
-  pc = costarr;
-  int ntot = 0;
-  for (int i = 0; i < ns; i++, pc++) {
-    if (*pc >= COST_OBS) {
-      ntot++;  // number of cells that are obstacles
+  // find # of obstacle cells, which setCostmap() has counted unless the costs were reset
+  if (!keepit) {
+    pc = costarr;
+    int ntot = 0;
+    for (int i = 0; i < ns; i++, pc++) {
+      if (*pc >= COST_OBS) {
+        ntot++;  // number of cells that are obstacles
+      }
     }
+    nobs = ntot;
+  } else {
+    nobs += nborder;
   }
-  nobs = ntot;
 }
 
 
@@ -418,6 +473,9 @@ NavFn::setupNavFn(bool keepit)
 void
 NavFn::initCost(int k, float v)
 {
+  if (potarr[k] >= POT_HIGH) {
+    reached_cells_.push_back(k);
+  }
   potarr[k] = v;
   push_cur(k + 1);
   push_cur(k - 1);
@@ -484,6 +542,9 @@ NavFn::updateCell(int n)
       float re = INVSQRT2 * static_cast<float>(costarr[n + 1]);
       float ue = INVSQRT2 * static_cast<float>(costarr[n - nx]);
       float de = INVSQRT2 * static_cast<float>(costarr[n + nx]);
+      if (potarr[n] >= POT_HIGH) {
+        reached_cells_.push_back(n);
+      }
       potarr[n] = pot;
       if (pot < curT) {  // low-cost buffer block
         if (l > pot + le) {push_next(n - 1);}
@@ -565,6 +626,9 @@ NavFn::updateCellAstar(int n)
       int y = n / nx;
       float dist = hypot(x - start[0], y - start[1]) * static_cast<float>(COST_NEUTRAL);
 
+      if (potarr[n] >= POT_HIGH) {
+        reached_cells_.push_back(n);
+      }
       potarr[n] = pot;
       pot += dist;
       if (pot < curT) {  // low-cost buffer block
@@ -583,6 +647,123 @@ NavFn::updateCellAstar(int n)
 }
 
 
+//
+// Parallel update of a whole priority block
+// Every cell is first updated from the potentials before the block on the pool,
+// then the new potentials are stored and the neighbors pushed in block order,
+// so the result does not depend on how the cells were shared out
+//
+
+#define PUSH_L 1
+#define PUSH_R 2
+#define PUSH_U 4
+#define PUSH_D 8
+#define PUSH_OVER 16
+
+inline float
+NavFn::cellUpdate(int n, bool astar, unsigned char & pushes)
+{
+  pushes = 0;
+
+  // get neighbors
+  float u, d, l, r;
+  l = potarr[n - 1];
+  r = potarr[n + 1];
+  u = potarr[n - nx];
+  d = potarr[n + nx];
+
+  // find lowest, and its lowest neighbor
+  float ta, tc;
+  if (l < r) {tc = l;} else {tc = r;}
+  if (u < d) {ta = u;} else {ta = d;}
+
+  // don't propagate into obstacles
+  if (costarr[n] >= COST_OBS) {
+    return potarr[n];
+  }
+
+  // do planar wave update, as in updateCell()
+  float hf = static_cast<float>(costarr[n]);  // traversability factor
+  float dc = tc - ta;  // relative cost between ta,tc
+  if (dc < 0) {  // ta is lowest
+    dc = -dc;
+    ta = tc;
+  }
+
+  float pot;
+  if (dc >= hf) {  // if too large, use ta-only update
+    pot = ta + hf;
+  } else {  // two-neighbor interpolation update
+    float d = dc / hf;
+    float v = -0.2301 * d * d + 0.5307 * d + 0.7040;
+    pot = ta + hf * v;
+  }
+
+  if (pot >= potarr[n]) {
+    return potarr[n];
+  }
+
+  float le = INVSQRT2 * static_cast<float>(costarr[n - 1]);
+  float re = INVSQRT2 * static_cast<float>(costarr[n + 1]);
+  float ue = INVSQRT2 * static_cast<float>(costarr[n - nx]);
+  float de = INVSQRT2 * static_cast<float>(costarr[n + nx]);
+
+  // the priority, with A* the potential plus the distance to the start
+  float pri = pot;
+  if (astar) {
+    int x = n % nx;
+    int y = n / nx;
+    pri += hypot(x - start[0], y - start[1]) * static_cast<float>(COST_NEUTRAL);
+  }
+  if (pri >= curT) {
+    pushes |= PUSH_OVER;
+  }
+  if (l > pri + le) {pushes |= PUSH_L;}
+  if (r > pri + re) {pushes |= PUSH_R;}
+  if (u > pri + ue) {pushes |= PUSH_U;}
+  if (d > pri + de) {pushes |= PUSH_D;}
+  return pot;
+}
+
+void
+NavFn::updateBlock(bool astar)
+{
+  block_pots_.resize(curPe);
+  block_pushes_.resize(curPe);
+  int jobs = (curPe + PARALLELCHUNK - 1) / PARALLELCHUNK;
+  pool_->run([this, astar](int job) {
+      int end = std::min(curPe, (job + 1) * PARALLELCHUNK);
+      for (int i = job * PARALLELCHUNK; i < end; i++) {
+        block_pots_[i] = cellUpdate(curP[i], astar, block_pushes_[i]);
+      }
+    }, jobs);
+
+  for (int i = 0; i < curPe; i++) {
+    int n = curP[i];
+    float pot = block_pots_[i];
+    if (pot >= potarr[n]) {
+      continue;
+    }
+    if (potarr[n] >= POT_HIGH) {
+      reached_cells_.push_back(n);
+    }
+    potarr[n] = pot;
+
+    unsigned char pushes = block_pushes_[i];
+    if (pushes & PUSH_OVER) {  // overflow block
+      if (pushes & PUSH_L) {push_over(n - 1);}
+      if (pushes & PUSH_R) {push_over(n + 1);}
+      if (pushes & PUSH_U) {push_over(n - nx);}
+      if (pushes & PUSH_D) {push_over(n + nx);}
+    } else {  // low-cost buffer block
+      if (pushes & PUSH_L) {push_next(n - 1);}
+      if (pushes & PUSH_R) {push_next(n + 1);}
+      if (pushes & PUSH_U) {push_next(n - nx);}
+      if (pushes & PUSH_D) {push_next(n + nx);}
+    }
+  }
+}
+
 //
 // main propagation function
 // Dijkstra method, breadth-first
@@ -620,10 +801,14 @@ NavFn::propNavFnDijkstra(int cycles, bool atStart)
     }
 
     // process current priority buffer
-    pb = curP;
-    i = curPe;
-    while (i-- > 0) {
-      updateCell(*pb++);
+    if (pool_ && curPe >= PARALLELBLOCKSIZE) {
+      updateBlock(false);
+    } else {
+      pb = curP;
+      i = curPe;
+      while (i-- > 0) {
+        updateCell(*pb++);
+      }
     }
 
     if (displayInt > 0 && (cycle % displayInt) == 0) {
@@ -638,7 +823,9 @@ NavFn::propNavFnDijkstra(int cycles, bool atStart)
     nextP = pb;
 
     // see if we're done with this priority level
+    float settled = 0.0;
     if (curPe == 0) {
+      settled = curT;  // every cell below the threshold has been expanded
       curT += priInc;  // increment priority threshold
       curPe = overPe;  // set current to overflow block
       overPe = 0;
@@ -649,11 +836,12 @@ NavFn::propNavFnDijkstra(int cycles, bool atStart)
 
     // check if we've hit the Start cell
     if (atStart) {
-      if (potarr[startCell] < POT_HIGH) {
+      if (startSettled(startCell, settled)) {
         break;
       }
     }
   }
+  expanded_cells_ = nc;
 
   RCLCPP_DEBUG(rclcpp::get_logger("rclcpp"),
     "[NavFn] Used %d cycles, %d cells visited (%d%%), priority buf max %d\n",
@@ -705,10 +893,14 @@ NavFn::propNavFnAstar(int cycles)
     }
 
     // process current priority buffer
-    pb = curP;
-    i = curPe;
-    while (i-- > 0) {
-      updateCellAstar(*pb++);
+    if (pool_ && curPe >= PARALLELBLOCKSIZE) {
+      updateBlock(true);
+    } else {
+      pb = curP;
+      i = curPe;
+      while (i-- > 0) {
+        updateCellAstar(*pb++);
+      }
     }
 
     if (displayInt > 0 && (cycle % displayInt) == 0) {
@@ -723,7 +915,9 @@ NavFn::propNavFnAstar(int cycles)
     nextP = pb;
 
     // see if we're done with this priority level
+    float settled = 0.0;
     if (curPe == 0) {
+      settled = curT;  // every cell below the threshold has been expanded
       curT += priInc;  // increment priority threshold
       curPe = overPe;  // set current to overflow block
       overPe = 0;
@@ -733,10 +927,11 @@ NavFn::propNavFnAstar(int cycles)
     }
 
     // check if we've hit the Start cell
-    if (potarr[startCell] < POT_HIGH) {
+    if (startSettled(startCell, settled)) {
       break;
     }
   }
+  expanded_cells_ = nc;
 
   last_path_cost_ = potarr[startCell];
 
@@ -752,6 +947,15 @@ NavFn::propNavFnAstar(int cycles)
 }
 
 
+bool
+NavFn::startSettled(int startCell, float settled)
+{
+  if (potarr[startCell] >= POT_HIGH) {
+    return false;
+  }
+  return settle_margin_ < 0.0 || potarr[startCell] + settle_margin_ < settled;
+}
+
 float NavFn::getLastPathCost()
 {
   return last_path_cost_;
@@ -984,6 +1188,7 @@ NavFn::gradCell(int n)
   float norm = hypot(dx, dy);
   if (norm > 0) {
     norm = 1.0 / norm;
+    gradient_cells_.push_back(n);
     gradx[n] = norm * dx;
     grady[n] = norm * dy;
   }
@@ -20,6 +20,7 @@
 
 #include "nav2_navfn_planner/navfn_planner.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <iomanip>
@@ -33,9 +34,13 @@
 #include "geometry_msgs/msg/point.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "nav2_msgs/msg/costmap.hpp"
+#include "nav2_msgs/srv/compute_paths.hpp"
 #include "nav2_msgs/srv/get_costmap.hpp"
 #include "nav2_navfn_planner/navfn.hpp"
 #include "nav2_util/costmap.hpp"
+#include "nav2_util/line_traversal.hpp"
+#include "nav2_util/node_utils.hpp"
+#include "nav2_util/tracing.hpp"
 #include "nav_msgs/msg/path.hpp"
 #include "visualization_msgs/msg/marker.hpp"
 
@@ -44,14 +49,41 @@ using namespace std::chrono_literals;
 namespace nav2_navfn_planner
 {
 
-NavfnPlanner::NavfnPlanner()
-: nav2_util::LifecycleNode("navfn_planner", "", true)
+NavfnPlanner::NavfnPlanner(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("navfn_planner", "", true, options),
+  get_costmap_time_(nav2_util::MetricsRegistry::global().histogram("navfn.get_costmap",
+    "Costmap fetch of the planner")),
+  make_plan_time_(nav2_util::MetricsRegistry::global().histogram("navfn.make_plan",
+    "ComputePathToPose plan")),
+  route_cache_hits_(nav2_util::MetricsRegistry::global().counter("navfn.route_cache_hits",
+    "Plans served from the route cache")),
+  route_cache_misses_(nav2_util::MetricsRegistry::global().counter("navfn.route_cache_misses",
+    "Plans the route cache had no route for"))
 {
   RCLCPP_INFO(get_logger(), "Creating");
 
   // Declare this node's parameters
+  declare_parameter("coarse_factor", rclcpp::ParameterValue(0));
+  declare_parameter("corridor_width", rclcpp::ParameterValue(2.0));
+  declare_parameter("incremental_replanning", rclcpp::ParameterValue(false));
+  declare_parameter("region_size", rclcpp::ParameterValue(0));
+  declare_parameter("refine_regions", rclcpp::ParameterValue(4));
+  declare_parameter("path_step", rclcpp::ParameterValue(0.5));
+  declare_parameter("path_spacing", rclcpp::ParameterValue(0.0));
+  declare_parameter("path_smoothing", rclcpp::ParameterValue(0));
+  declare_parameter("shortcut_cost", rclcpp::ParameterValue(0));
+  declare_parameter("shortcut_spline", rclcpp::ParameterValue(false));
   declare_parameter("tolerance", rclcpp::ParameterValue(0.0));
   declare_parameter("use_astar", rclcpp::ParameterValue(false));
+  declare_parameter("settle_start", rclcpp::ParameterValue(false));
+  declare_parameter("reuse_potential", rclcpp::ParameterValue(false));
+  declare_parameter("own_costmap", rclcpp::ParameterValue(false));
+  declare_parameter("shared_costmap", rclcpp::ParameterValue(std::string("")));
+  declare_parameter("propagation_threads", rclcpp::ParameterValue(1));
+  declare_parameter("route_cache_size", rclcpp::ParameterValue(0));
+  declare_parameter("route_cache_region", rclcpp::ParameterValue(1.0));
+  declare_parameter("route_cache_file", rclcpp::ParameterValue(std::string("")));
+  declare_parameter("route_repair_margin", rclcpp::ParameterValue(1.0));
 
   tf_ = std::make_shared<tf2_ros::Buffer>(get_clock());
   auto timer_interface = std::make_shared<tf2_ros::CreateTimerROS>(
@@ -64,16 +96,109 @@ NavfnPlanner::NavfnPlanner()
 NavfnPlanner::~NavfnPlanner()
 {
   RCLCPP_INFO(get_logger(), "Destroying");
+  if (costmap_thread_) {
+    costmap_executor_->cancel();
+    costmap_thread_->join();
+  }
 }
 
 nav2_util::CallbackReturn
-NavfnPlanner::on_configure(const rclcpp_lifecycle::State & /*state*/)
+NavfnPlanner::on_configure(const rclcpp_lifecycle::State & state)
 {
   RCLCPP_INFO(get_logger(), "Configuring");
 
   // Initialize parameters
+  get_parameter("coarse_factor", coarse_factor_);
+  get_parameter("corridor_width", corridor_width_);
+  get_parameter("incremental_replanning", incremental_replanning_);
+  if (!incremental_replanning_) {
+    incremental_planner_.reset();
+  }
+  get_parameter("region_size", region_size_);
+  get_parameter("refine_regions", refine_regions_);
+  refine_regions_ = std::max(refine_regions_, 1);
+  if (region_size_ <= 0) {
+    region_graph_.reset();
+  }
+  get_parameter("path_step", path_step_);
+  get_parameter("path_spacing", path_spacing_);
+  get_parameter("path_smoothing", path_smoothing_);
+  get_parameter("shortcut_cost", shortcut_cost_);
+  get_parameter("shortcut_spline", shortcut_spline_);
+  if (path_step_ <= 0.0 || path_step_ > 1.0) {
+    // the path follower moves at most one cell per step
+    RCLCPP_WARN(get_logger(), "path_step must be in (0, 1], using 0.5 instead of %.2f",
+      path_step_);
+    path_step_ = 0.5;
+  }
   get_parameter("tolerance", tolerance_);
   get_parameter("use_astar", use_astar_);
+  get_parameter("settle_start", settle_start_);
+  get_parameter("reuse_potential", reuse_potential_);
+  get_parameter("own_costmap", own_costmap_);
+
+  std::string shared_costmap;
+  get_parameter("shared_costmap", shared_costmap);
+  if (!shared_costmap.empty() && !own_costmap_) {
+    shared_costmap_ = std::make_unique<nav2_costmap_2d::SharedCostmapReader>(shared_costmap);
+  } else {
+    shared_costmap_.reset();
+  }
+
+  int propagation_threads;
+  get_parameter("propagation_threads", propagation_threads);
+  if (propagation_threads > 1) {
+    propagation_pool_ = std::make_unique<nav2_costmap_2d::WorkerPool>(propagation_threads);
+  } else {
+    propagation_pool_.reset();
+  }
+
+  int route_cache_size;
+  double route_cache_region;
+  get_parameter("route_cache_size", route_cache_size);
+  get_parameter("route_cache_region", route_cache_region);
+  get_parameter("route_cache_file", route_cache_file_);
+  get_parameter("route_repair_margin", route_repair_margin_);
+  if (route_cache_size <= 0) {
+    route_cache_.reset();
+  } else if (!route_cache_) {
+    if (route_cache_region <= 0.0) {
+      RCLCPP_WARN(get_logger(), "route_cache_region must be positive, using 1.0 instead of %.2f",
+        route_cache_region);
+      route_cache_region = 1.0;
+    }
+    route_cache_ = std::make_unique<RouteCache>(route_cache_region, route_cache_size);
+    if (!route_cache_file_.empty()) {
+      if (route_cache_->load(route_cache_file_)) {
+        RCLCPP_INFO(get_logger(), "Loaded %zu routes from %s", route_cache_->size(),
+          route_cache_file_.c_str());
+      } else {
+        RCLCPP_INFO(get_logger(), "No routes loaded from %s", route_cache_file_.c_str());
+      }
+    }
+  }
+
+  if (own_costmap_ && !costmap_ros_) {
+    // The costmap node is used in place of the world model's GetCostmap service
+    costmap_ros_ = std::make_shared<nav2_costmap_2d::Costmap2DROS>(
+      "global_costmap", nav2_util::add_namespaces(std::string{get_namespace()}, "global_costmap"));
+    add_startup_child(costmap_ros_);
+
+    // Create an executor that will be used to spin the costmap node
+    costmap_executor_ = costmap_ros_->createExecutor();
+
+    // Launch a thread to run the costmap node
+    costmap_thread_ = std::make_unique<std::thread>(
+      [&](rclcpp_lifecycle::LifecycleNode::SharedPtr node)
+      {
+        costmap_executor_->add_node(node->get_node_base_interface());
+        costmap_executor_->spin();
+        costmap_executor_->remove_node(node->get_node_base_interface());
+      }, costmap_ros_);
+  }
+  if (costmap_ros_) {
+    costmap_ros_->on_configure(state);
+  }
 
   getCostmap(costmap_);
   RCLCPP_DEBUG(get_logger(), "Costmap size: %d,%d",
@@ -85,24 +210,38 @@ NavfnPlanner::on_configure(const rclcpp_lifecycle::State & /*state*/)
     current_costmap_size_[1] = costmap_.metadata.size_y;
     planner_ = std::make_unique<NavFn>(costmap_.metadata.size_x, costmap_.metadata.size_y);
   }
+  if (planner_) {
+    planner_->setWorkerPool(propagation_pool_.get());
+    planner_->pathStep = path_step_;
+  }
 
   // Initialize pubs & subs
   plan_publisher_ = create_publisher<nav_msgs::msg::Path>("plan", 1);
 
   auto node = shared_from_this();
 
-  // Create the action server that we implement with our navigateToPose method
+  // Create the action server that we implement with our navigateToPose method, run for every
+  // goal on the same worker thread
   action_server_ = std::make_unique<ActionServer>(rclcpp_node_, "ComputePathToPose",
-      std::bind(&NavfnPlanner::computePathToPose, this));
+      std::bind(&NavfnPlanner::computePathToPose, this), true, true);
+
+  // Create the service that plans between one pose and many
+  compute_paths_service_ = create_service<nav2_msgs::srv::ComputePaths>("ComputePaths",
+      std::bind(&NavfnPlanner::computePaths, this, std::placeholders::_1,
+      std::placeholders::_2, std::placeholders::_3));
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
 nav2_util::CallbackReturn
-NavfnPlanner::on_activate(const rclcpp_lifecycle::State & /*state*/)
+NavfnPlanner::on_activate(const rclcpp_lifecycle::State & state)
 {
   RCLCPP_INFO(get_logger(), "Activating");
 
+  if (costmap_ros_) {
+    costmap_ros_->on_activate(state);
+  }
+
   plan_publisher_->on_activate();
   action_server_->activate();
 
@@ -110,24 +249,42 @@ NavfnPlanner::on_activate(const rclcpp_lifecycle::State & /*state*/)
 }
 
 nav2_util::CallbackReturn
-NavfnPlanner::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
+NavfnPlanner::on_deactivate(const rclcpp_lifecycle::State & state)
 {
   RCLCPP_INFO(get_logger(), "Deactivating");
 
   action_server_->deactivate();
   plan_publisher_->on_deactivate();
+  if (route_cache_ && !route_cache_file_.empty()) {
+    std::lock_guard<std::mutex> lock(planner_mutex_);
+    if (!route_cache_->save(route_cache_file_)) {
+      RCLCPP_WARN(get_logger(), "Could not save the routes to %s", route_cache_file_.c_str());
+    }
+  }
+  if (costmap_ros_) {
+    costmap_ros_->on_deactivate(state);
+  }
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
 nav2_util::CallbackReturn
-NavfnPlanner::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
+NavfnPlanner::on_cleanup(const rclcpp_lifecycle::State & state)
 {
   RCLCPP_INFO(get_logger(), "Cleaning up");
 
+  if (costmap_ros_) {
+    costmap_ros_->on_cleanup(state);
+  }
+
   action_server_.reset();
+  compute_paths_service_.reset();
   plan_publisher_.reset();
   planner_.reset();
+  region_graph_.reset();
+  incremental_planner_.reset();
+  propagation_pool_.reset();
+  shared_costmap_.reset();
   tf_listener_.reset();
   tf_.reset();
 
@@ -155,6 +312,7 @@ NavfnPlanner::computePathToPose()
   auto goal = action_server_->get_current_goal();
   auto result = std::make_shared<nav2_msgs::action::ComputePathToPose::Result>();
 
+  std::lock_guard<std::mutex> lock(planner_mutex_);
   try {
     if (action_server_ == nullptr) {
       RCLCPP_DEBUG(get_logger(), "Action server unavailable. Stopping.");
@@ -177,11 +335,6 @@ NavfnPlanner::computePathToPose()
     RCLCPP_DEBUG(get_logger(), "Costmap size: %d,%d",
       costmap_.metadata.size_x, costmap_.metadata.size_y);
 
-    geometry_msgs::msg::PoseStamped start;
-    if (!nav2_util::getCurrentPose(start, *tf_)) {
-      return;
-    }
-
     // Update planner based on the new costmap size
     if (isPlannerOutOfDate()) {
       current_costmap_size_[0] = costmap_.metadata.size_x;
@@ -194,12 +347,33 @@ NavfnPlanner::computePathToPose()
       goal = action_server_->accept_pending_goal();
     }
 
+    // A goal can give the start, such as the end of the leg before it on a route
+    geometry_msgs::msg::PoseStamped start;
+    if (goal->use_start) {
+      start = goal->start;
+    } else if (!nav2_util::getCurrentPose(start, *tf_)) {
+      return;
+    }
+
     RCLCPP_DEBUG(get_logger(), "Attempting to a find path from (%.2f, %.2f) to "
       "(%.2f, %.2f).", start.pose.position.x, start.pose.position.y,
       goal->pose.pose.position.x, goal->pose.pose.position.y);
 
     // Make the plan for the provided goal pose
-    bool foundPath = makePlan(start.pose, goal->pose.pose, tolerance_, result->path);
+    NAV2_TRACEPOINT(navfn_plan_start);
+    bool foundPath;
+    {
+      nav2_util::ScopedTimer timer(make_plan_time_);
+      foundPath = route_cache_ &&
+        makePlanFromRouteCache(start.pose, goal->pose.pose, result->path);
+      if (!foundPath) {
+        foundPath = makePlan(start.pose, goal->pose.pose, tolerance_, result->path);
+        if (foundPath && route_cache_) {
+          route_cache_->insert(start.pose, goal->pose.pose, result->path.poses);
+        }
+      }
+    }
+    NAV2_TRACEPOINT2(navfn_plan_end, foundPath, result->path.poses.size());
 
     if (!foundPath) {
       RCLCPP_WARN(get_logger(), "Planning algorithm failed to generate a valid"
@@ -240,6 +414,69 @@ NavfnPlanner::computePathToPose()
   }
 }
 
+void
+NavfnPlanner::computePaths(
+  const std::shared_ptr<rmw_request_id_t>/*request_header*/,
+  const std::shared_ptr<nav2_msgs::srv::ComputePaths::Request> request,
+  const std::shared_ptr<nav2_msgs::srv::ComputePaths::Response> response)
+{
+  response->paths.resize(request->poses.size());
+  response->costs.assign(request->poses.size(), -1.0);
+
+  std::lock_guard<std::mutex> lock(planner_mutex_);
+  try {
+    // Get the current costmap
+    getCostmap(costmap_);
+
+    geometry_msgs::msg::PoseStamped pose = request->pose;
+    bool from_robot = pose.header.frame_id.empty();
+    if (from_robot && !nav2_util::getCurrentPose(pose, *tf_)) {
+      return;
+    }
+
+    if (isPlannerOutOfDate()) {
+      current_costmap_size_[0] = costmap_.metadata.size_x;
+      current_costmap_size_[1] = costmap_.metadata.size_y;
+      planner_->setNavArr(costmap_.metadata.size_x, costmap_.metadata.size_y);
+    }
+
+    unsigned int mx, my;
+    if (from_robot && worldToMap(pose.pose.position.x, pose.pose.position.y, mx, my)) {
+      clearRobotCell(mx, my);
+    }
+
+    // a single wave from the shared end reaches every other one
+    if (!computePotential(pose.pose.position)) {
+      RCLCPP_WARN(get_logger(), "Cannot plan from (%.2f, %.2f), it is off the global costmap",
+        pose.pose.position.x, pose.pose.position.y);
+      return;
+    }
+
+    for (size_t i = 0; i < request->poses.size(); ++i) {
+      geometry_msgs::msg::Pose best_pose;
+      if (!findLegalGoal(request->poses[i].pose, tolerance_, best_pose)) {
+        continue;
+      }
+
+      if (request->include_paths) {
+        nav2_msgs::msg::Path & plan = response->paths[i];
+        if (!getPlanFromPotential(best_pose, plan)) {
+          continue;
+        }
+        smoothApproachToGoal(best_pose, plan);
+        if (request->reverse) {
+          std::reverse(plan.poses.begin(), plan.poses.end());
+        }
+      }
+      response->costs[i] = getPointPotential(best_pose.position);
+    }
+
+    RCLCPP_DEBUG(get_logger(), "Computed %zu paths from one potential", request->poses.size());
+  } catch (std::exception & ex) {
+    RCLCPP_WARN(get_logger(), "Batch plan calculation failed: \"%s\"", ex.what());
+  }
+}
+
 bool
 NavfnPlanner::isPlannerOutOfDate()
 {
@@ -260,6 +497,24 @@ NavfnPlanner::makePlan(
   // clear the plan, just in case
   plan.poses.clear();
 
+  if (incremental_replanning_ && makePlanIncrementally(start, goal, plan)) {
+    return true;
+  }
+  plan.poses.clear();
+
+  if (region_size_ > 0 && makePlanOverRegions(start, goal, plan)) {
+    return true;
+  }
+  plan.poses.clear();
+
+  if (reuse_potential_ && makePlanFromGoalPotential(start, goal, plan)) {
+    NAV2_TRACEPOINT(navfn_potential_reused);
+    return true;
+  }
+  // the search from the robot below replaces the potential
+  goal_potential_valid_ = false;
+  plan.poses.clear();
+
   // TODO(orduno): add checks for start and goal reference frame -- should be in global frame
 
   double wx = start.position.x;
@@ -304,19 +559,466 @@ NavfnPlanner::makePlan(
   map_goal[0] = mx;
   map_goal[1] = my;
 
+  bool restricted = coarse_factor_ > 1 && restrictToCorridor(map_start, map_goal, tolerance);
+
   // TODO(orduno): Explain why we are providing 'map_goal' to setStart().
   //               Same for setGoal, seems reversed. Computing backwards?
 
   planner_->setStart(map_goal);
   planner_->setGoal(map_start);
+
+  // stop the wave once it has settled the goal and its tolerance window, instead of
+  // at the first touch of the goal cell, each cell costing at most COST_OBS to cross
+  if (settle_start_) {
+    int window = std::ceil(std::sqrt(2.0) * tolerance / costmap_.metadata.resolution);
+    planner_->setSettleMargin((window + 2) * static_cast<float>(COST_OBS));
+  } else {
+    planner_->setSettleMargin(-1.0);
+  }
+
+  NAV2_TRACEPOINT1(navfn_wave_start, restricted);
   if (use_astar_) {
     planner_->calcNavFnAstar();
   } else {
     planner_->calcNavFnDijkstra(true);
   }
+  NAV2_TRACEPOINT1(navfn_wave_end, planner_->getExpandedCells());
+  RCLCPP_DEBUG(get_logger(), "Expanded %d cells", planner_->getExpandedCells());
+
+  geometry_msgs::msg::Pose best_pose;
+  bool found_legal = findLegalGoal(goal, tolerance, best_pose);
+
+  if (!found_legal && restricted) {
+    // the coarse path can squeeze a gap shut, so fall back to the whole costmap
+    RCLCPP_DEBUG(get_logger(), "No plan within the coarse corridor, searching the full costmap");
+    planner_->setCostmap(&costmap_.data[0], true, allow_unknown_);
+    if (use_astar_) {
+      planner_->calcNavFnAstar();
+    } else {
+      planner_->calcNavFnDijkstra(true);
+    }
+    found_legal = findLegalGoal(goal, tolerance, best_pose);
+  }
 
+  if (found_legal) {
+    // extract the plan
+    if (getPlanFromPotential(best_pose, plan)) {
+      smoothApproachToGoal(best_pose, plan);
+    } else {
+      RCLCPP_ERROR(
+        get_logger(),
+        "Failed to create a plan from potential when a legal"
+        " potential was found. This shouldn't happen.");
+    }
+  }
+
+  return !plan.poses.empty();
+}
+
+bool
+NavfnPlanner::makePlanFromGoalPotential(
+  const geometry_msgs::msg::Pose & start,
+  const geometry_msgs::msg::Pose & goal,
+  nav2_msgs::msg::Path & plan)
+{
+  unsigned int start_mx, start_my, goal_mx, goal_my;
+  if (!worldToMap(start.position.x, start.position.y, start_mx, start_my) ||
+    !worldToMap(goal.position.x, goal.position.y, goal_mx, goal_my))
+  {
+    return false;
+  }
+
+  // an obstructed goal needs the tolerance search from the robot
+  unsigned char goal_cost = costmap_.data[goal_my * costmap_.metadata.size_x + goal_mx];
+  if (goal_cost >= COST_OBS_ROS && !(goal_cost == COST_UNKNOWN_ROS && allow_unknown_)) {
+    return false;
+  }
+
+  int map_start[2] = {static_cast<int>(start_mx), static_cast<int>(start_my)};
+  int map_goal[2] = {static_cast<int>(goal_mx), static_cast<int>(goal_my)};
+  unsigned int start_index = start_my * planner_->nx + start_mx;
+  const float margin = 2.0 * COST_OBS;
+
+  bool reuse = goal_potential_valid_ && goal_potential_cell_[0] == goal_mx &&
+    goal_potential_cell_[1] == goal_my && !goalPotentialOutOfDate() &&
+    planner_->potarr[start_index] <= goal_potential_bound_;
+
+  if (reuse) {
+    RCLCPP_DEBUG(get_logger(), "Reusing the potential grown from the goal");
+    planner_->setStart(map_start);
+    planner_->calcPath(static_cast<int>(costmap_.metadata.size_x * 2 / path_step_));
+  } else {
+    goal_potential_costmap_ = costmap_;
+    clearRobotCell(start_mx, start_my);
+    planner_->setNavArr(costmap_.metadata.size_x, costmap_.metadata.size_y);
+    planner_->setCostmap(&costmap_.data[0], true, allow_unknown_);
+
+    // grow the wave from the goal until the robot is settled with some room to move
+    planner_->setGoal(map_goal);
+    planner_->setStart(map_start);
+    planner_->setSettleMargin(margin);
+    if (use_astar_) {
+      planner_->calcNavFnAstar();
+    } else {
+      planner_->calcNavFnDijkstra(true);
+    }
+    RCLCPP_DEBUG(get_logger(), "Expanded %d cells from the goal", planner_->getExpandedCells());
+
+    goal_potential_valid_ = planner_->potarr[start_index] < POT_HIGH;
+    goal_potential_cell_[0] = goal_mx;
+    goal_potential_cell_[1] = goal_my;
+    goal_potential_bound_ = planner_->potarr[start_index] + margin;
+  }
+
+  // the path runs from the robot down the potential to the goal
+  float * x = planner_->getPathX();
+  float * y = planner_->getPathY();
+  int len = planner_->getPathLen();
+  if (!goal_potential_valid_ || len == 0) {
+    return false;
+  }
+
+  plan.header.stamp = this->now();
+  plan.header.frame_id = global_frame_;
+  for (int i = 0; i < len; ++i) {
+    double world_x, world_y;
+    mapToWorld(x[i], y[i], world_x, world_y);
+
+    geometry_msgs::msg::Pose pose;
+    pose.position.x = world_x;
+    pose.position.y = world_y;
+    pose.position.z = 0.0;
+    pose.orientation.w = 1.0;
+    plan.poses.push_back(pose);
+  }
+  simplifyPath(plan);
+  smoothApproachToGoal(goal, plan);
+  return true;
+}
+
+bool
+NavfnPlanner::makePlanIncrementally(
+  const geometry_msgs::msg::Pose & start,
+  const geometry_msgs::msg::Pose & goal,
+  nav2_msgs::msg::Path & plan)
+{
+  using Cell = DStarLite::Cell;
+  unsigned int start_mx, start_my, goal_mx, goal_my;
+  if (!worldToMap(start.position.x, start.position.y, start_mx, start_my) ||
+    !worldToMap(goal.position.x, goal.position.y, goal_mx, goal_my))
+  {
+    return false;
+  }
+
+  // an obstructed goal needs the tolerance search from the robot
+  unsigned char goal_cost = costmap_.data[goal_my * costmap_.metadata.size_x + goal_mx];
+  if (goal_cost >= COST_OBS_ROS && !(goal_cost == COST_UNKNOWN_ROS && allow_unknown_)) {
+    return false;
+  }
+
+  clearRobotCell(start_mx, start_my);
+  const int nx = costmap_.metadata.size_x;
+  const int ny = costmap_.metadata.size_y;
+  Cell goal_cell{static_cast<int>(goal_mx), static_cast<int>(goal_my)};
+  if (incremental_planner_ && incremental_planner_->hasGoal(goal_cell, nx, ny) &&
+    incremental_origin_[0] == costmap_.metadata.origin.position.x &&
+    incremental_origin_[1] == costmap_.metadata.origin.position.y)
+  {
+    int changed = incremental_planner_->update(&costmap_.data[0], allow_unknown_);
+    RCLCPP_DEBUG(get_logger(), "Repairing the search to the goal around %d changed cells",
+      changed);
+  } else {
+    if (!incremental_planner_) {
+      incremental_planner_ = std::make_unique<DStarLite>();
+    }
+    incremental_planner_->reset(&costmap_.data[0], nx, ny, allow_unknown_, goal_cell);
+    incremental_origin_[0] = costmap_.metadata.origin.position.x;
+    incremental_origin_[1] = costmap_.metadata.origin.position.y;
+  }
+
+  std::vector<Cell> cells;
+  bool found = incremental_planner_->plan(
+    {static_cast<int>(start_mx), static_cast<int>(start_my)}, cells);
+  RCLCPP_DEBUG(get_logger(), "Expanded %d cells", incremental_planner_->getExpandedCells());
+  if (!found) {
+    return false;
+  }
+
+  plan.header.stamp = this->now();
+  plan.header.frame_id = global_frame_;
+  for (const Cell & cell : cells) {
+    geometry_msgs::msg::Pose pose;
+    mapToWorld(cell.x, cell.y, pose.position.x, pose.position.y);
+    pose.position.z = 0.0;
+    pose.orientation.w = 1.0;
+    plan.poses.push_back(pose);
+  }
+  simplifyPath(plan);
+  smoothApproachToGoal(goal, plan);
+  return true;
+}
+
+bool
+NavfnPlanner::makePlanOverRegions(
+  const geometry_msgs::msg::Pose & start,
+  const geometry_msgs::msg::Pose & goal,
+  nav2_msgs::msg::Path & plan)
+{
+  using Cell = RegionGraph::Cell;
+  unsigned int start_mx, start_my, goal_mx, goal_my;
+  if (!worldToMap(start.position.x, start.position.y, start_mx, start_my) ||
+    !worldToMap(goal.position.x, goal.position.y, goal_mx, goal_my))
+  {
+    return false;
+  }
+
+  const int nx = costmap_.metadata.size_x;
+  const int ny = costmap_.metadata.size_y;
+  if (!region_graph_ || region_graph_->getRegionSize() != region_size_) {
+    region_graph_ = std::make_unique<RegionGraph>(region_size_);
+  }
+  // only the regions that changed since the last plan, and their neighbors, are rebuilt
+  int changed = region_graph_->update(&costmap_.data[0], nx, ny, allow_unknown_);
+  RCLCPP_DEBUG(get_logger(), "Rebuilt the region graph around %d changed regions", changed);
+
+  // an obstructed goal needs the tolerance search over the whole costmap
+  std::vector<Cell> waypoints;
+  Cell start_cell{static_cast<int>(start_mx), static_cast<int>(start_my)};
+  Cell goal_cell{static_cast<int>(goal_mx), static_cast<int>(goal_my)};
+  if (!region_graph_->plan(start_cell, goal_cell, waypoints)) {
+    RCLCPP_DEBUG(get_logger(), "No path over the region graph");
+    return false;
+  }
+
+  // NavFn refines the path up to where it leaves the first refine_regions regions, which
+  // the robot is still in at the next plan, within those regions only
+  size_t target = waypoints.size() - 1;
+  std::vector<unsigned char> corridor(
+    region_graph_->getRegionsX() * region_graph_->getRegionsY(), 0);
+  int regions = 1;
+  corridor[region_graph_->regionOf(waypoints[0])] = 1;
+  for (size_t i = 1; i < waypoints.size(); ++i) {
+    int region = region_graph_->regionOf(waypoints[i]);
+    if (region != region_graph_->regionOf(waypoints[i - 1]) && ++regions > refine_regions_) {
+      target = i - 1;
+      break;
+    }
+    corridor[region] = 1;
+  }
+
+  goal_potential_valid_ = false;
+  clearRobotCell(start_mx, start_my);
+  planner_->setNavArr(nx, ny);
+  planner_->setCostmap(&costmap_.data[0], true, allow_unknown_);
+  const int size = region_graph_->getRegionSize();
+  for (int y = 0; y < ny; ++y) {
+    const unsigned char * corridor_row = &corridor[(y / size) * region_graph_->getRegionsX()];
+    COSTTYPE * cost_row = planner_->costarr + y * nx;
+    for (int x = 0; x < nx; ++x) {
+      if (!corridor_row[x / size]) {
+        cost_row[x] = COST_OBS;
+      }
+    }
+  }
+
+  int map_start[2] = {start_cell.x, start_cell.y};
+  int map_target[2] = {waypoints[target].x, waypoints[target].y};
+  planner_->setStart(map_target);
+  planner_->setGoal(map_start);
+  planner_->setSettleMargin(-1.0);
+  if (use_astar_) {
+    planner_->calcNavFnAstar();
+  } else {
+    planner_->calcNavFnDijkstra(true);
+  }
+  RCLCPP_DEBUG(get_logger(), "Expanded %d cells through %d regions",
+    planner_->getExpandedCells(), std::min(regions, refine_regions_));
+
+  geometry_msgs::msg::Pose target_pose;
+  mapToWorld(map_target[0], map_target[1], target_pose.position.x, target_pose.position.y);
+  target_pose.orientation.w = 1.0;
+  if (!getPlanFromPotential(target_pose, plan)) {
+    return false;
+  }
+
+  // the rest of the way, from cell to cell
+  std::vector<Cell> cells;
+  for (size_t i = target + 1; i < waypoints.size(); ++i) {
+    if (!region_graph_->appendCellPath(waypoints[i - 1], waypoints[i], cells)) {
+      return false;
+    }
+  }
+  if (!cells.empty()) {
+    nav2_msgs::msg::Path rest;
+    for (const Cell & cell : cells) {
+      geometry_msgs::msg::Pose pose;
+      mapToWorld(cell.x, cell.y, pose.position.x, pose.position.y);
+      pose.orientation.w = 1.0;
+      rest.poses.push_back(pose);
+    }
+    simplifyPath(rest);
+    plan.poses.insert(plan.poses.end(), rest.poses.begin(), rest.poses.end());
+  }
+  smoothApproachToGoal(goal, plan);
+  return true;
+}
+
+bool
+NavfnPlanner::makePlanFromRouteCache(
+  const geometry_msgs::msg::Pose & start,
+  const geometry_msgs::msg::Pose & goal,
+  nav2_msgs::msg::Path & plan)
+{
+  // a route is checked again only where the costmap changed since it last was
+  route_cache_->setCostmap(costmap_);
+  const std::vector<geometry_msgs::msg::Pose> * route = route_cache_->find(start, goal);
+  if (!route || route->size() < 2) {
+    route_cache_misses_.increment();
+    return false;
+  }
+  std::vector<geometry_msgs::msg::Pose> poses = *route;
+
+  size_t checked = 0;
+  int blocked = route_cache_->check(start, goal, &checked);
+  RCLCPP_DEBUG(get_logger(), "Checked %zu poses of the cached route", checked);
+  // each repair can run into more of the change further along
+  const int max_repairs = 3;
+  for (int repairs = 0; blocked >= 0; ++repairs) {
+    if (repairs == max_repairs || !repairRoute(poses, static_cast<size_t>(blocked))) {
+      RCLCPP_DEBUG(get_logger(), "The cached route is blocked at pose %d, planning anew",
+        blocked);
+      route_cache_->erase(start, goal);
+      return false;
+    }
+    route_cache_->insert(start, goal, poses);
+    blocked = route_cache_->check(start, goal);
+  }
+
+  // join the route where it comes nearest the robot, in its first half, and the goal, in
+  // its second, if there is nothing in the way
+  auto nearest = [&](const geometry_msgs::msg::Pose & pose, size_t begin, size_t end) {
+      size_t best = begin;
+      for (size_t i = begin + 1; i < end; ++i) {
+        if (squared_distance(poses[i], pose) < squared_distance(poses[best], pose)) {
+          best = i;
+        }
+      }
+      return best;
+    };
+  const size_t half = poses.size() / 2;
+  size_t first = nearest(start, 0, half);
+  size_t last = nearest(goal, half, poses.size());
+
+  unsigned int mx, my;
+  if (!worldToMap(start.position.x, start.position.y, mx, my)) {
+    return false;
+  }
+  clearRobotCell(mx, my);
+  if (!inSight(start.position, poses[first].position, COST_OBS_ROS) ||
+    !inSight(poses[last].position, goal.position, COST_OBS_ROS))
+  {
+    RCLCPP_DEBUG(get_logger(), "The cached route can't be joined to the robot or the goal");
+    return false;
+  }
+
+  plan.poses.clear();
+  plan.header.stamp = this->now();
+  plan.header.frame_id = global_frame_;
+  geometry_msgs::msg::Pose start_pose;
+  start_pose.position = start.position;
+  start_pose.orientation.w = 1.0;
+  plan.poses.push_back(start_pose);
+  plan.poses.insert(plan.poses.end(), poses.begin() + first, poses.begin() + last + 1);
+  smoothApproachToGoal(goal, plan);
+  route_cache_hits_.increment();
+  return true;
+}
+
+bool
+NavfnPlanner::repairRoute(std::vector<geometry_msgs::msg::Pose> & poses, size_t blocked)
+{
+  const unsigned int nx = costmap_.metadata.size_x;
+  auto obstructed = [&](const geometry_msgs::msg::Pose & pose) {
+      unsigned int mx, my;
+      if (!worldToMap(pose.position.x, pose.position.y, mx, my)) {
+        return false;
+      }
+      unsigned char cost = costmap_.data[my * nx + mx];
+      return cost >= COST_OBS_ROS && cost != COST_UNKNOWN_ROS;
+    };
+  auto distance = [&](size_t i) {
+      return std::hypot(poses[i + 1].position.x - poses[i].position.x,
+               poses[i + 1].position.y - poses[i].position.y);
+    };
+
+  size_t from = blocked;
+  for (double back = 0.0; from > 0 && back < route_repair_margin_; --from) {
+    back += distance(from - 1);
+  }
+  size_t to = blocked;
+  while (to < poses.size() && obstructed(poses[to])) {
+    ++to;
+  }
+  if (to == poses.size()) {
+    // the goal is obstructed, which needs the tolerance of a new plan
+    return false;
+  }
+  for (double ahead = 0.0; to + 1 < poses.size() && ahead < route_repair_margin_; ++to) {
+    ahead += distance(to);
+  }
+
+  nav2_msgs::msg::Path segment;
+  if (!makePlan(poses[from], poses[to], 0.0, segment)) {
+    return false;
+  }
+  RCLCPP_DEBUG(get_logger(), "Repaired poses %zu to %zu of the cached route", from, to);
+
+  std::vector<geometry_msgs::msg::Pose> repaired(poses.begin(), poses.begin() + from);
+  repaired.insert(repaired.end(), segment.poses.begin(), segment.poses.end());
+  repaired.insert(repaired.end(), poses.begin() + to + 1, poses.end());
+  poses.swap(repaired);
+  return true;
+}
+
+bool
+NavfnPlanner::goalPotentialOutOfDate()
+{
+  const nav2_msgs::msg::CostmapMetaData & kept = goal_potential_costmap_.metadata;
+  const nav2_msgs::msg::CostmapMetaData & current = costmap_.metadata;
+  if (kept.size_x != current.size_x || kept.size_y != current.size_y ||
+    kept.resolution != current.resolution ||
+    kept.origin.position.x != current.origin.position.x ||
+    kept.origin.position.y != current.origin.position.y)
+  {
+    return true;
+  }
+
+  // a change in a cell the wave never reached nor was stopped by leaves the potential as is
+  const int nx = current.size_x;
+  const int ns = current.size_x * current.size_y;
+  const float * potential = planner_->potarr;
+  auto reached = [&](int index) {
+      return index >= 0 && index < ns && potential[index] < POT_HIGH;
+    };
+  const std::vector<uint8_t> & kept_data = goal_potential_costmap_.data;
+  const std::vector<uint8_t> & data = costmap_.data;
+  for (int i = 0; i < ns; ++i) {
+    if (data[i] != kept_data[i] &&
+      (reached(i) || reached(i - 1) || reached(i + 1) || reached(i - nx) || reached(i + nx)))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+NavfnPlanner::findLegalGoal(
+  const geometry_msgs::msg::Pose & goal, double tolerance,
+  geometry_msgs::msg::Pose & best_pose)
+{
   double resolution = costmap_.metadata.resolution;
-  geometry_msgs::msg::Pose p, best_pose;
+  geometry_msgs::msg::Pose p;
   p = goal;
 
   bool found_legal = false;
@@ -339,19 +1041,80 @@ NavfnPlanner::makePlan(
     p.position.y += resolution;
   }
 
-  if (found_legal) {
-    // extract the plan
-    if (getPlanFromPotential(best_pose, plan)) {
-      smoothApproachToGoal(best_pose, plan);
-    } else {
-      RCLCPP_ERROR(
-        get_logger(),
-        "Failed to create a plan from potential when a legal"
-        " potential was found. This shouldn't happen.");
+  return found_legal;
+}
+
+bool
+NavfnPlanner::restrictToCorridor(const int * map_start, const int * map_goal, double tolerance)
+{
+  const int factor = coarse_factor_;
+  const int nx = costmap_.metadata.size_x;
+  const int ny = costmap_.metadata.size_y;
+  const int cnx = (nx + factor - 1) / factor;
+  const int cny = (ny + factor - 1) / factor;
+  const unsigned char unknown = nav2_util::Costmap::no_information;
+
+  // each coarse cell keeps the highest known cost under it, so that obstacles
+  // and inflation survive, and is unknown only if all of its cells are
+  coarse_costmap_.assign(cnx * cny, unknown);
+  for (int y = 0; y < ny; ++y) {
+    unsigned char * coarse_row = &coarse_costmap_[(y / factor) * cnx];
+    const uint8_t * row = &costmap_.data[y * nx];
+    for (int x = 0; x < nx; ++x) {
+      unsigned char & coarse = coarse_row[x / factor];
+      if (row[x] != unknown && (coarse == unknown || row[x] > coarse)) {
+        coarse = row[x];
+      }
     }
   }
 
-  return !plan.poses.empty();
+  // the robot and goal cells are known to be free, even if a neighbour is not
+  int coarse_start[2] = {map_start[0] / factor, map_start[1] / factor};
+  int coarse_goal[2] = {map_goal[0] / factor, map_goal[1] / factor};
+  coarse_costmap_[coarse_start[1] * cnx + coarse_start[0]] = nav2_util::Costmap::free_space;
+  coarse_costmap_[coarse_goal[1] * cnx + coarse_goal[0]] = nav2_util::Costmap::free_space;
+
+  if (!coarse_planner_ || coarse_planner_->nx != cnx || coarse_planner_->ny != cny) {
+    coarse_planner_ = std::make_unique<NavFn>(cnx, cny);
+  }
+  coarse_planner_->setCostmap(&coarse_costmap_[0], true, allow_unknown_);
+  coarse_planner_->setStart(coarse_goal);
+  coarse_planner_->setGoal(coarse_start);
+  if (!coarse_planner_->calcNavFnDijkstra(true)) {
+    RCLCPP_DEBUG(get_logger(), "No coarse plan, searching the full costmap");
+    return false;
+  }
+
+  // widen the coarse path into the corridor, and keep the whole goal tolerance in it
+  double coarse_resolution = costmap_.metadata.resolution * factor;
+  int radius = static_cast<int>(std::ceil(corridor_width_ / 2.0 / coarse_resolution));
+  int goal_radius = std::max(radius, static_cast<int>(std::ceil(tolerance / coarse_resolution)));
+  std::vector<unsigned char> corridor(cnx * cny, 0);
+  auto mark = [&](int cx, int cy, int r) {
+      for (int y = std::max(cy - r, 0); y <= std::min(cy + r, cny - 1); ++y) {
+        for (int x = std::max(cx - r, 0); x <= std::min(cx + r, cnx - 1); ++x) {
+          corridor[y * cnx + x] = 1;
+        }
+      }
+    };
+  float * path_x = coarse_planner_->getPathX();
+  float * path_y = coarse_planner_->getPathY();
+  for (int i = 0; i < coarse_planner_->getPathLen(); ++i) {
+    mark(static_cast<int>(path_x[i]), static_cast<int>(path_y[i]), radius);
+  }
+  mark(coarse_start[0], coarse_start[1], radius);
+  mark(coarse_goal[0], coarse_goal[1], goal_radius);
+
+  for (int y = 0; y < ny; ++y) {
+    const unsigned char * corridor_row = &corridor[(y / factor) * cnx];
+    COSTTYPE * cost_row = planner_->costarr + y * nx;
+    for (int x = 0; x < nx; ++x) {
+      if (!corridor_row[x / factor]) {
+        cost_row[x] = COST_OBS;
+      }
+    }
+  }
+  return true;
 }
 
 void
@@ -378,6 +1141,8 @@ NavfnPlanner::smoothApproachToGoal(
 bool
 NavfnPlanner::computePotential(const geometry_msgs::msg::Point & world_point)
 {
+  goal_potential_valid_ = false;
+
   // make sure to resize the underlying array that Navfn uses
   planner_->setNavArr(costmap_.metadata.size_x, costmap_.metadata.size_y);
 
@@ -402,11 +1167,9 @@ NavfnPlanner::computePotential(const geometry_msgs::msg::Point & world_point)
   planner_->setStart(map_start);
   planner_->setGoal(map_goal);
 
-  if (use_astar_) {
-    return planner_->calcNavFnAstar();
-  }
-
-  return planner_->calcNavFnDijkstra();
+  // the A* heuristic would only grow the potential towards the start cell
+  planner_->calcNavFnDijkstra();
+  return true;
 }
 
 bool
@@ -437,7 +1200,7 @@ NavfnPlanner::getPlanFromPotential(
 
   planner_->setStart(map_goal);
 
-  planner_->calcPath(costmap_.metadata.size_x * 4);
+  planner_->calcPath(static_cast<int>(costmap_.metadata.size_x * 2 / path_step_));
 
   // extract the plan
   float * x = planner_->getPathX();
@@ -462,10 +1225,152 @@ NavfnPlanner::getPlanFromPotential(
     pose.orientation.w = 1.0;
     plan.poses.push_back(pose);
   }
+  simplifyPath(plan);
 
   return !plan.poses.empty();
 }
 
+void
+NavfnPlanner::simplifyPath(nav2_msgs::msg::Path & plan)
+{
+  std::vector<geometry_msgs::msg::Pose> & poses = plan.poses;
+  if (poses.size() < 3) {
+    return;
+  }
+
+  // the shortcuts are the sparse path, which averaging could pull into obstacles
+  if (shortcut_cost_ > 0) {
+    shortcutPath(poses);
+    if (shortcut_spline_) {
+      splinePath(poses);
+    }
+    return;
+  }
+
+  // average each pose with its neighbors, keeping both ends in place
+  for (int pass = 0; pass < path_smoothing_; ++pass) {
+    geometry_msgs::msg::Point previous = poses[0].position;
+    for (size_t i = 1; i + 1 < poses.size(); ++i) {
+      geometry_msgs::msg::Point current = poses[i].position;
+      const geometry_msgs::msg::Point & next = poses[i + 1].position;
+      poses[i].position.x = 0.25 * previous.x + 0.5 * current.x + 0.25 * next.x;
+      poses[i].position.y = 0.25 * previous.y + 0.5 * current.y + 0.25 * next.y;
+      previous = current;
+    }
+  }
+
+  // the controller interpolates the plan to its own resolution, so sparse poses do
+  if (path_spacing_ > 0.0) {
+    std::vector<geometry_msgs::msg::Pose> kept{poses.front()};
+    double travelled = 0.0;
+    for (size_t i = 1; i + 1 < poses.size(); ++i) {
+      travelled += std::hypot(poses[i].position.x - poses[i - 1].position.x,
+          poses[i].position.y - poses[i - 1].position.y);
+      if (travelled >= path_spacing_) {
+        kept.push_back(poses[i]);
+        travelled = 0.0;
+      }
+    }
+    kept.push_back(poses.back());
+    poses.swap(kept);
+  }
+}
+
+void
+NavfnPlanner::shortcutPath(std::vector<geometry_msgs::msg::Pose> & poses)
+{
+  // from each kept pose, the furthest one in sight is found by doubling the distance along the
+  // path and then bisecting, which may miss a pose in sight beyond one that is not
+  std::vector<geometry_msgs::msg::Pose> kept{poses.front()};
+  const size_t last = poses.size() - 1;
+  size_t anchor = 0;
+  while (anchor < last) {
+    size_t visible = anchor + 1;
+    size_t hidden = last + 1;
+    for (size_t step = 1; visible < last; step *= 2) {
+      size_t next = std::min(visible + step, last);
+      if (!inSight(poses[anchor].position, poses[next].position, shortcut_cost_)) {
+        hidden = next;
+        break;
+      }
+      visible = next;
+    }
+    while (hidden - visible > 1) {
+      size_t middle = visible + (hidden - visible) / 2;
+      if (inSight(poses[anchor].position, poses[middle].position, shortcut_cost_)) {
+        visible = middle;
+      } else {
+        hidden = middle;
+      }
+    }
+    kept.push_back(poses[visible]);
+    anchor = visible;
+  }
+  poses.swap(kept);
+}
+
+void
+NavfnPlanner::splinePath(std::vector<geometry_msgs::msg::Pose> & poses)
+{
+  if (poses.size() < 3) {
+    return;
+  }
+  const double spacing = path_spacing_ > 0.0 ? path_spacing_ : costmap_.metadata.resolution;
+
+  std::vector<geometry_msgs::msg::Pose> curved{poses.front()};
+  std::vector<geometry_msgs::msg::Pose> span;
+  for (size_t i = 0; i + 1 < poses.size(); ++i) {
+    // the ends of the path are repeated as the control points beyond them
+    const geometry_msgs::msg::Point & p0 = poses[i > 0 ? i - 1 : 0].position;
+    const geometry_msgs::msg::Point & p1 = poses[i].position;
+    const geometry_msgs::msg::Point & p2 = poses[i + 1].position;
+    const geometry_msgs::msg::Point & p3 = poses[std::min(i + 2, poses.size() - 1)].position;
+    int samples = std::max(1, static_cast<int>(std::hypot(p2.x - p1.x, p2.y - p1.y) / spacing));
+
+    span.clear();
+    geometry_msgs::msg::Point previous = p1;
+    bool clear = true;
+    for (int k = 1; k < samples && clear; ++k) {
+      double t = static_cast<double>(k) / samples;
+      double t2 = t * t;
+      double t3 = t2 * t;
+      geometry_msgs::msg::Pose pose;
+      pose.position.x = 0.5 * (2.0 * p1.x + (p2.x - p0.x) * t +
+        (2.0 * p0.x - 5.0 * p1.x + 4.0 * p2.x - p3.x) * t2 +
+        (3.0 * p1.x - p0.x - 3.0 * p2.x + p3.x) * t3);
+      pose.position.y = 0.5 * (2.0 * p1.y + (p2.y - p0.y) * t +
+        (2.0 * p0.y - 5.0 * p1.y + 4.0 * p2.y - p3.y) * t2 +
+        (3.0 * p1.y - p0.y - 3.0 * p2.y + p3.y) * t3);
+      pose.orientation.w = 1.0;
+      clear = inSight(previous, pose.position, shortcut_cost_);
+      previous = pose.position;
+      span.push_back(pose);
+    }
+    // a span that bulges into the costs keeps its straight segment
+    if (clear && inSight(previous, p2, shortcut_cost_)) {
+      curved.insert(curved.end(), span.begin(), span.end());
+    }
+    curved.push_back(poses[i + 1]);
+  }
+  poses.swap(curved);
+}
+
+bool
+NavfnPlanner::inSight(
+  const geometry_msgs::msg::Point & from,
+  const geometry_msgs::msg::Point & to,
+  int max_cost)
+{
+  unsigned int x0, y0, x1, y1;
+  if (!worldToMap(from.x, from.y, x0, y0) || !worldToMap(to.x, to.y, x1, y1)) {
+    return false;
+  }
+  const unsigned int nx = costmap_.metadata.size_x;
+  const unsigned char * data = costmap_.data.data();
+  return nav2_util::traceOffsets(x0, y0, x1, y1, nx, UINT_MAX,
+           [&](unsigned int offset) {return data[offset] < max_cost;});
+}
+
 double
 NavfnPlanner::getPointPotential(const geometry_msgs::msg::Point & world_point)
 {
@@ -551,13 +1456,57 @@ NavfnPlanner::clearRobotCell(unsigned int mx, unsigned int my)
 void
 NavfnPlanner::getCostmap(
   nav2_msgs::msg::Costmap & costmap,
-  const std::string /*layer*/)
+  const std::string layer)
 {
-  // TODO(orduno): explicitly provide specifications for costmap using the costmap on the request,
-  //               including master (aggregate) layer
+  nav2_util::ScopedTimer timer(get_costmap_time_);
+  if (costmap_ros_) {
+    // Take a snapshot of the costmap node's master grid, or of the layer's own grid, locked
+    // against its update thread
+    nav2_costmap_2d::Costmap2D * grid = costmap_ros_->getCostmap();
+    std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(grid->getMutex()));
+    std::shared_ptr<nav2_costmap_2d::CostmapLayer> costmap_layer;
+    if (!layer.empty() && layer != "master") {
+      costmap_layer = costmap_ros_->getCostmapLayer(layer);
+      if (costmap_layer) {
+        grid = costmap_layer.get();
+      } else {
+        RCLCPP_WARN(get_logger(), "No layer \"%s\" to plan on, using the master grid",
+          layer.c_str());
+      }
+    }
+
+    unsigned int size_x = grid->getSizeInCellsX();
+    unsigned int size_y = grid->getSizeInCellsY();
+    const unsigned char * data = grid->getCharMap();
+    costmap.header.stamp = now();
+    costmap.header.frame_id = costmap_ros_->getGlobalFrameID();
+    costmap.metadata.size_x = size_x;
+    costmap.metadata.size_y = size_y;
+    costmap.metadata.resolution = grid->getResolution();
+    costmap.metadata.update_time = costmap.header.stamp;
+    costmap.metadata.origin.position.x = grid->getOriginX();
+    costmap.metadata.origin.position.y = grid->getOriginY();
+    costmap.metadata.origin.position.z = 0.0;
+    costmap.metadata.origin.orientation.w = 1.0;
+    costmap.data.assign(data, data + size_x * size_y);
+    return;
+  }
+
+  uint64_t version;
+  if (shared_costmap_ && shared_costmap_->read(costmap, version)) {
+    costmap.header.stamp = now();
+    costmap.header.frame_id = global_frame_;
+    costmap.metadata.update_time = costmap.header.stamp;
+    RCLCPP_DEBUG(get_logger(), "Read version %llu of the shared costmap",
+      static_cast<unsigned long long>(version));
+    return;
+  }
+
+  // TODO(orduno): explicitly provide specifications for costmap using the costmap on the request
 
   auto request = std::make_shared<nav2_util::CostmapServiceClient::CostmapServiceRequest>();
   request->specs.resolution = 1.0;
+  request->specs.layer = layer;
 
   auto result = costmap_client_.invoke(request, 5s);
   costmap = result.get()->map;
@@ -609,3 +1558,7 @@ NavfnPlanner::publishPlan(const nav2_msgs::msg::Path & path)
 }
 
 }  // namespace nav2_navfn_planner
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_navfn_planner::NavfnPlanner)
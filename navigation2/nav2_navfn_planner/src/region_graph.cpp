@@ -0,0 +1,499 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_navfn_planner/region_graph.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "nav2_navfn_planner/navfn.hpp"
+
+namespace nav2_navfn_planner
+{
+
+namespace
+{
+
+const float infinity = std::numeric_limits<float>::infinity();
+const float diagonal = std::sqrt(2.0f);
+
+// Runs of open border cells at least this long get an entrance at each end
+const int long_run = 6;
+
+// The octile distance between two cells
+float octile(RegionGraph::Cell a, RegionGraph::Cell b)
+{
+  int dx = std::abs(a.x - b.x);
+  int dy = std::abs(a.y - b.y);
+  return std::max(dx, dy) + (diagonal - 1.0f) * std::min(dx, dy);
+}
+
+}  // namespace
+
+RegionGraph::RegionGraph(int region_size)
+: region_size_(std::max(region_size, 2)),
+  blocked_(COST_OBS)
+{
+}
+
+int
+RegionGraph::update(const unsigned char * costmap, int nx, int ny, bool allow_unknown)
+{
+  // the translation of NavFn::setCostmap() for a ROS costmap
+  unsigned char lut[256];
+  for (int v = 0; v < 256; v++) {
+    int cost = COST_OBS;
+    if (v < COST_OBS_ROS) {
+      cost = std::min(static_cast<int>(COST_NEUTRAL + COST_FACTOR * v), COST_OBS - 1);
+    } else if (v == COST_UNKNOWN_ROS && allow_unknown) {
+      cost = COST_OBS - 1;
+    }
+    lut[v] = cost;
+  }
+
+  bool resized = nx != nx_ || ny != ny_;
+  if (resized) {
+    nx_ = nx;
+    ny_ = ny;
+    regions_x_ = (nx + region_size_ - 1) / region_size_;
+    regions_y_ = (ny + region_size_ - 1) / region_size_;
+    costs_.assign(nx * ny, COST_OBS);
+    regions_.assign(regions_x_ * regions_y_, Region());
+    vertical_.assign(regions_.size(), Border());
+    horizontal_.assign(regions_.size(), Border());
+  }
+
+  // a region is dirty if any of its cells changed, compared a row of a region at a time
+  std::vector<unsigned char> dirty(regions_.size(), resized);
+  std::vector<unsigned char> row(nx);
+  for (int y = 0; y < ny; ++y) {
+    const unsigned char * source = costmap + y * nx;
+    for (int x = 0; x < nx; ++x) {
+      row[x] = lut[source[x]];
+    }
+    unsigned char * kept = &costs_[y * nx];
+    int first_region = (y / region_size_) * regions_x_;
+    for (int x = 0; x < nx; x += region_size_) {
+      int width = std::min(region_size_, nx - x);
+      if (memcmp(&row[x], kept + x, width) != 0) {
+        memcpy(kept + x, &row[x], width);
+        dirty[first_region + x / region_size_] = 1;
+      }
+    }
+  }
+
+  // the borders of a dirty region change the entrances, and so the edges, of its neighbors
+  int changed = 0;
+  std::vector<unsigned char> rebuild(regions_.size(), 0);
+  for (size_t region = 0; region < regions_.size(); ++region) {
+    if (!dirty[region]) {
+      continue;
+    }
+    ++changed;
+    rebuild[region] = 1;
+    for (int side = WEST; side <= NORTH; ++side) {
+      if (border(region, side)) {
+        rebuildBorder(region, side);
+        rebuild[neighbor(region, side)] = 1;
+      }
+    }
+  }
+  for (size_t region = 0; region < regions_.size(); ++region) {
+    if (rebuild[region]) {
+      rebuildRegion(region);
+    }
+  }
+  return changed;
+}
+
+RegionGraph::Border *
+RegionGraph::border(int region, int side)
+{
+  int rx = region % regions_x_;
+  int ry = region / regions_x_;
+  switch (side) {
+    case WEST:
+      return rx > 0 ? &vertical_[region - 1] : nullptr;
+    case EAST:
+      return rx < regions_x_ - 1 ? &vertical_[region] : nullptr;
+    case SOUTH:
+      return ry > 0 ? &horizontal_[region - regions_x_] : nullptr;
+    default:
+      return ry < regions_y_ - 1 ? &horizontal_[region] : nullptr;
+  }
+}
+
+int
+RegionGraph::neighbor(int region, int side) const
+{
+  switch (side) {
+    case WEST:
+      return region - 1;
+    case EAST:
+      return region + 1;
+    case SOUTH:
+      return region - regions_x_;
+    default:
+      return region + regions_x_;
+  }
+}
+
+void
+RegionGraph::bounds(int region, int & min_x, int & min_y, int & max_x, int & max_y) const
+{
+  min_x = (region % regions_x_) * region_size_;
+  min_y = (region / regions_x_) * region_size_;
+  max_x = std::min(min_x + region_size_, nx_);
+  max_y = std::min(min_y + region_size_, ny_);
+}
+
+RegionGraph::Cell
+RegionGraph::entranceCell(int region, int side, int along) const
+{
+  int min_x, min_y, max_x, max_y;
+  bounds(region, min_x, min_y, max_x, max_y);
+  switch (side) {
+    case WEST:
+      return {min_x, along};
+    case EAST:
+      return {max_x - 1, along};
+    case SOUTH:
+      return {along, min_y};
+    default:
+      return {along, max_y - 1};
+  }
+}
+
+void
+RegionGraph::rebuildBorder(int region, int side)
+{
+  // each border is kept by the region to its west or south
+  if (side == WEST || side == SOUTH) {
+    region = neighbor(region, side);
+    side = side == WEST ? EAST : NORTH;
+  }
+  Border & entrances = *border(region, side);
+  int other = neighbor(region, side);
+  int other_side = side == EAST ? WEST : SOUTH;
+
+  int min_x, min_y, max_x, max_y;
+  bounds(region, min_x, min_y, max_x, max_y);
+  int begin = side == EAST ? min_y : min_x;
+  int end = side == EAST ? max_y : max_x;
+
+  entrances.clear();
+  int run_start = -1;
+  for (int along = begin; along <= end; ++along) {
+    bool open = along < end && passable(entranceCell(region, side, along)) &&
+      passable(entranceCell(other, other_side, along));
+    if (open && run_start < 0) {
+      run_start = along;
+    } else if (!open && run_start >= 0) {
+      int run_end = along - 1;
+      if (run_end - run_start + 1 >= long_run) {
+        entrances.push_back(run_start);
+        entrances.push_back(run_end);
+      } else {
+        entrances.push_back((run_start + run_end) / 2);
+      }
+      run_start = -1;
+    }
+  }
+}
+
+void
+RegionGraph::rebuildRegion(int region)
+{
+  Region & r = regions_[region];
+  r.nodes.clear();
+  for (int side = WEST; side <= NORTH; ++side) {
+    r.side_offset[side] = r.nodes.size();
+    Border * entrances = border(region, side);
+    if (!entrances) {
+      continue;
+    }
+    for (size_t e = 0; e < entrances->size(); ++e) {
+      r.nodes.push_back({entranceCell(region, side, (*entrances)[e]), side,
+          static_cast<int>(e)});
+    }
+  }
+
+  size_t n = r.nodes.size();
+  r.costs.assign(n * n, infinity);
+  if (n == 0) {
+    return;
+  }
+
+  // open space, and other regions of a single cost, need no search
+  int min_x, min_y, max_x, max_y;
+  bounds(region, min_x, min_y, max_x, max_y);
+  unsigned char first = costs_[min_y * nx_ + min_x];
+  bool uniform = true;
+  for (int y = min_y; y < max_y && uniform; ++y) {
+    const unsigned char * row = &costs_[y * nx_];
+    uniform = std::all_of(row + min_x, row + max_x, [first](unsigned char c) {return c == first;});
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    if (uniform) {
+      for (size_t j = 0; j < n; ++j) {
+        r.costs[i * n + j] = first * octile(r.nodes[i].cell, r.nodes[j].cell);
+      }
+      continue;
+    }
+    searchRegion(region, r.nodes[i].cell);
+    for (size_t j = 0; j < n; ++j) {
+      r.costs[i * n + j] = regionDistance(region, r.nodes[j].cell);
+    }
+  }
+}
+
+float
+RegionGraph::regionDistance(int region, Cell cell) const
+{
+  int min_x, min_y, max_x, max_y;
+  bounds(region, min_x, min_y, max_x, max_y);
+  return distances_[(cell.y - min_y) * (max_x - min_x) + cell.x - min_x];
+}
+
+float
+RegionGraph::moveCost(Cell a, Cell b) const
+{
+  float length = a.x != b.x && a.y != b.y ? diagonal : 1.0f;
+  return 0.5f * (cost(a) + cost(b)) * length;
+}
+
+void
+RegionGraph::searchRegion(int region, Cell source)
+{
+  int min_x, min_y, max_x, max_y;
+  bounds(region, min_x, min_y, max_x, max_y);
+  int width = max_x - min_x;
+  int height = max_y - min_y;
+  distances_.assign(width * height, infinity);
+  parents_.assign(width * height, -1);
+  settled_.assign(width * height, 0);
+
+  using Entry = std::pair<float, int>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+  int source_index = (source.y - min_y) * width + source.x - min_x;
+  distances_[source_index] = 0.0f;
+  open.push({0.0f, source_index});
+
+  while (!open.empty()) {
+    int index = open.top().second;
+    open.pop();
+    if (settled_[index]) {
+      continue;
+    }
+    settled_[index] = 1;
+    Cell cell{min_x + index % width, min_y + index / width};
+
+    for (int dy = -1; dy <= 1; ++dy) {
+      for (int dx = -1; dx <= 1; ++dx) {
+        Cell next{cell.x + dx, cell.y + dy};
+        if ((dx == 0 && dy == 0) || next.x < min_x || next.x >= max_x ||
+          next.y < min_y || next.y >= max_y || !passable(next))
+        {
+          continue;
+        }
+        // no cutting the corner of an obstacle
+        if (dx != 0 && dy != 0 &&
+          (!passable({cell.x + dx, cell.y}) || !passable({cell.x, cell.y + dy})))
+        {
+          continue;
+        }
+        int next_index = (next.y - min_y) * width + next.x - min_x;
+        float distance = distances_[index] + moveCost(cell, next);
+        if (distance < distances_[next_index]) {
+          distances_[next_index] = distance;
+          parents_[next_index] = index;
+          open.push({distance, next_index});
+        }
+      }
+    }
+  }
+}
+
+bool
+RegionGraph::plan(Cell start, Cell goal, std::vector<Cell> & waypoints)
+{
+  waypoints.clear();
+  if (start.x < 0 || start.x >= nx_ || start.y < 0 || start.y >= ny_ ||
+    goal.x < 0 || goal.x >= nx_ || goal.y < 0 || goal.y >= ny_ || !passable(goal))
+  {
+    return false;
+  }
+
+  // the robot's cell is free, whatever the costmap has there, for this search only
+  unsigned char & start_cost = costs_[start.y * nx_ + start.x];
+  unsigned char kept_start_cost = start_cost;
+  start_cost = COST_NEUTRAL;
+
+  int start_region = regionOf(start);
+  int goal_region = regionOf(goal);
+  // the costs from a cell to the entrances of its region, leaving its search in distances_
+  auto region_costs = [this](int region, Cell source) {
+      searchRegion(region, source);
+      std::vector<float> costs;
+      for (const Node & node : regions_[region].nodes) {
+        costs.push_back(regionDistance(region, node.cell));
+      }
+      return costs;
+    };
+  // the moves cost the same both ways, so the costs from the goal are those to it
+  std::vector<float> to_goal = region_costs(goal_region, goal);
+  std::vector<float> from_start = region_costs(start_region, start);
+  float direct = start_region == goal_region ? regionDistance(start_region, goal) : infinity;
+
+  // A* over the entrances, keyed by region and node, with the start and goal apart
+  const int64_t start_key = -1;
+  const int64_t goal_key = -2;
+  auto key_of = [](int region, int node) {
+      return (static_cast<int64_t>(region) << 32) | static_cast<uint32_t>(node);
+    };
+  auto cell_of = [&](int64_t key) {
+      if (key == start_key) {
+        return start;
+      }
+      if (key == goal_key) {
+        return goal;
+      }
+      return regions_[key >> 32].nodes[key & 0xffffffff].cell;
+    };
+
+  struct Visit
+  {
+    float cost;
+    int64_t parent;
+    bool closed;
+  };
+  std::unordered_map<int64_t, Visit> visits;
+  using Entry = std::pair<float, int64_t>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+  auto relax = [&](int64_t from, int64_t to, float cost) {
+      if (!std::isfinite(cost)) {
+        return;
+      }
+      auto found = visits.find(to);
+      if (found != visits.end() && (found->second.closed || found->second.cost <= cost)) {
+        return;
+      }
+      visits[to] = {cost, from, false};
+      open.push({cost + COST_NEUTRAL * octile(cell_of(to), goal), to});
+    };
+
+  visits[start_key] = {0.0f, start_key, false};
+  open.push({COST_NEUTRAL * octile(start, goal), start_key});
+  bool found = false;
+  while (!open.empty()) {
+    int64_t key = open.top().second;
+    open.pop();
+    Visit & visit = visits[key];
+    if (visit.closed) {
+      continue;
+    }
+    visit.closed = true;
+    float cost = visit.cost;
+    if (key == goal_key) {
+      found = true;
+      break;
+    }
+
+    if (key == start_key) {
+      for (size_t i = 0; i < from_start.size(); ++i) {
+        relax(key, key_of(start_region, i), from_start[i]);
+      }
+      relax(key, goal_key, direct);
+      continue;
+    }
+
+    int region = key >> 32;
+    int i = key & 0xffffffff;
+    const Region & r = regions_[region];
+    size_t n = r.nodes.size();
+    for (size_t j = 0; j < n; ++j) {
+      if (static_cast<int>(j) != i) {
+        relax(key, key_of(region, j), cost + r.costs[i * n + j]);
+      }
+    }
+    const Node & node = r.nodes[i];
+    int other = neighbor(region, node.side);
+    int other_side = node.side ^ 1;
+    int j = regions_[other].side_offset[other_side] + node.entrance;
+    relax(key, key_of(other, j), cost + moveCost(node.cell, regions_[other].nodes[j].cell));
+    if (region == goal_region) {
+      relax(key, goal_key, cost + to_goal[i]);
+    }
+  }
+  start_cost = kept_start_cost;
+  if (!found) {
+    return false;
+  }
+
+  for (int64_t key = goal_key; key != start_key; key = visits[key].parent) {
+    Cell cell = cell_of(key);
+    // the nodes of a corner cell on two sides are the same cell
+    if (waypoints.empty() || waypoints.back().x != cell.x || waypoints.back().y != cell.y) {
+      waypoints.push_back(cell);
+    }
+  }
+  if (waypoints.back().x != start.x || waypoints.back().y != start.y) {
+    waypoints.push_back(start);
+  }
+  std::reverse(waypoints.begin(), waypoints.end());
+  return true;
+}
+
+bool
+RegionGraph::appendCellPath(Cell from, Cell to, std::vector<Cell> & cells)
+{
+  int region = regionOf(from);
+  if (regionOf(to) != region) {
+    // the two cells of an entrance
+    if (std::abs(from.x - to.x) + std::abs(from.y - to.y) != 1) {
+      return false;
+    }
+    cells.push_back(to);
+    return true;
+  }
+
+  searchRegion(region, from);
+  int min_x, min_y, max_x, max_y;
+  bounds(region, min_x, min_y, max_x, max_y);
+  int width = max_x - min_x;
+  int index = (to.y - min_y) * width + to.x - min_x;
+  if (!std::isfinite(distances_[index])) {
+    return false;
+  }
+  size_t end = cells.size();
+  int source = (from.y - min_y) * width + from.x - min_x;
+  for (; index != source; index = parents_[index]) {
+    cells.push_back({min_x + index % width, min_y + index / width});
+  }
+  std::reverse(cells.begin() + end, cells.end());
+  return true;
+}
+
+}  // namespace nav2_navfn_planner
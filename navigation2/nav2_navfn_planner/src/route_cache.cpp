@@ -0,0 +1,252 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_navfn_planner/route_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/dirty_regions.hpp"
+
+namespace nav2_navfn_planner
+{
+
+static const char ROUTES_MAGIC[8] = {'N', 'A', 'V', 'F', 'N', 'R', 'T', '1'};
+
+// The changed rows of a costmap are merged down to this many rectangles for the routes
+static const size_t CHANGED_REGIONS = 16;
+
+template<typename T>
+static void writeValue(std::ofstream & out, T value)
+{
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+static bool readValue(std::ifstream & in, T & value)
+{
+  return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+size_t RouteCache::KeyHash::operator()(const Key & key) const
+{
+  size_t hash = 0;
+  for (int32_t value : {key.start_x, key.start_y, key.goal_x, key.goal_y}) {
+    hash = hash * 1000003 ^ std::hash<int32_t>()(value);
+  }
+  return hash;
+}
+
+RouteCache::RouteCache(double region_size, size_t capacity)
+: region_size_(region_size), capacity_(std::max<size_t>(capacity, 1))
+{
+}
+
+void RouteCache::setCostmap(const nav2_msgs::msg::Costmap & costmap)
+{
+  const nav2_msgs::msg::CostmapMetaData & metadata = costmap.metadata;
+  const unsigned int nx = metadata.size_x, ny = metadata.size_y;
+  if (costmap.data.size() < static_cast<size_t>(nx) * ny) {
+    return;
+  }
+
+  bool same_map = have_costmap_ && costmap_.getSizeInCellsX() == nx &&
+    costmap_.getSizeInCellsY() == ny && costmap_.getResolution() == metadata.resolution &&
+    costmap_.getOriginX() == metadata.origin.position.x &&
+    costmap_.getOriginY() == metadata.origin.position.y;
+  const uint8_t * data = costmap.data.data();
+
+  if (same_map) {
+    // each row's changes from its first changed cell to its last, with the rows merged
+    nav2_costmap_2d::DirtyRegions changed(CHANGED_REGIONS);
+    const unsigned char * kept = costmap_.getCharMap();
+    for (unsigned int y = 0; y < ny; ++y) {
+      const uint8_t * row = data + y * nx;
+      const unsigned char * kept_row = kept + y * nx;
+      if (std::memcmp(row, kept_row, nx) == 0) {
+        continue;
+      }
+      unsigned int min_x = 0, max_x = nx - 1;
+      while (row[min_x] == kept_row[min_x]) {
+        ++min_x;
+      }
+      while (row[max_x] == kept_row[max_x]) {
+        --max_x;
+      }
+      changed.add(min_x, y, max_x + 1, y + 1);
+    }
+    for (auto & entry : routes_) {
+      for (const nav2_costmap_2d::MapRegion & region : changed.get()) {
+        entry.second.validity->addDirtyRegion(region);
+      }
+    }
+  } else {
+    // the routes are checked whole on a map of another geometry
+    costmap_.resizeMap(nx, ny, metadata.resolution, metadata.origin.position.x,
+      metadata.origin.position.y);
+  }
+
+  std::copy(data, data + static_cast<size_t>(nx) * ny, costmap_.getCharMap());
+  have_costmap_ = true;
+}
+
+const std::vector<geometry_msgs::msg::Pose> * RouteCache::find(
+  const geometry_msgs::msg::Pose & start, const geometry_msgs::msg::Pose & goal)
+{
+  auto it = routes_.find(keyOf(start, goal));
+  if (it == routes_.end()) {
+    return nullptr;
+  }
+  it->second.last_used = ++uses_;
+  return &it->second.poses;
+}
+
+int RouteCache::check(
+  const geometry_msgs::msg::Pose & start, const geometry_msgs::msg::Pose & goal,
+  size_t * checked)
+{
+  static const std::vector<geometry_msgs::msg::Point> point_footprint;
+  if (checked) {
+    *checked = 0;
+  }
+  auto it = routes_.find(keyOf(start, goal));
+  if (it == routes_.end() || !have_costmap_) {
+    return -1;
+  }
+  Route & route = it->second;
+  return route.validity->check(costmap_, route.poses_2d, point_footprint, checked);
+}
+
+void RouteCache::insert(
+  const geometry_msgs::msg::Pose & start, const geometry_msgs::msg::Pose & goal,
+  const std::vector<geometry_msgs::msg::Pose> & poses)
+{
+  add(keyOf(start, goal), poses).last_used = ++uses_;
+}
+
+void RouteCache::erase(
+  const geometry_msgs::msg::Pose & start, const geometry_msgs::msg::Pose & goal)
+{
+  routes_.erase(keyOf(start, goal));
+}
+
+bool RouteCache::save(const std::string & filename) const
+{
+  // written aside and renamed over the file, so a crash never leaves half of it
+  std::string temporary = filename + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary);
+    if (!out) {
+      return false;
+    }
+    out.write(ROUTES_MAGIC, sizeof(ROUTES_MAGIC));
+    writeValue(out, region_size_);
+    writeValue(out, static_cast<uint32_t>(routes_.size()));
+    for (const auto & entry : routes_) {
+      const Key & key = entry.first;
+      writeValue(out, key.start_x);
+      writeValue(out, key.start_y);
+      writeValue(out, key.goal_x);
+      writeValue(out, key.goal_y);
+      writeValue(out, static_cast<uint32_t>(entry.second.poses.size()));
+      for (const geometry_msgs::msg::Pose & pose : entry.second.poses) {
+        writeValue(out, pose.position.x);
+        writeValue(out, pose.position.y);
+        writeValue(out, pose.orientation.z);
+        writeValue(out, pose.orientation.w);
+      }
+    }
+    if (!out) {
+      return false;
+    }
+  }
+  return std::rename(temporary.c_str(), filename.c_str()) == 0;
+}
+
+bool RouteCache::load(const std::string & filename)
+{
+  std::ifstream in(filename, std::ios::binary);
+  char magic[sizeof(ROUTES_MAGIC)];
+  double region_size;
+  uint32_t count;
+  if (!in.read(magic, sizeof(magic)) ||
+    std::memcmp(magic, ROUTES_MAGIC, sizeof(ROUTES_MAGIC)) != 0 ||
+    !readValue(in, region_size) || region_size != region_size_ || !readValue(in, count))
+  {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    Key key;
+    uint32_t size;
+    if (!readValue(in, key.start_x) || !readValue(in, key.start_y) ||
+      !readValue(in, key.goal_x) || !readValue(in, key.goal_y) || !readValue(in, size))
+    {
+      return false;
+    }
+    std::vector<geometry_msgs::msg::Pose> poses(size);
+    for (geometry_msgs::msg::Pose & pose : poses) {
+      if (!readValue(in, pose.position.x) || !readValue(in, pose.position.y) ||
+        !readValue(in, pose.orientation.z) || !readValue(in, pose.orientation.w))
+      {
+        return false;
+      }
+    }
+    add(key, poses).last_used = ++uses_;
+  }
+  return true;
+}
+
+RouteCache::Key RouteCache::keyOf(
+  const geometry_msgs::msg::Pose & start, const geometry_msgs::msg::Pose & goal) const
+{
+  auto square = [this](double coordinate) {
+      return static_cast<int32_t>(std::floor(coordinate / region_size_));
+    };
+  return {square(start.position.x), square(start.position.y),
+    square(goal.position.x), square(goal.position.y)};
+}
+
+RouteCache::Route & RouteCache::add(
+  const Key & key, const std::vector<geometry_msgs::msg::Pose> & poses)
+{
+  if (routes_.size() >= capacity_ && routes_.find(key) == routes_.end()) {
+    auto oldest = std::min_element(routes_.begin(), routes_.end(),
+        [](const auto & a, const auto & b) {return a.second.last_used < b.second.last_used;});
+    routes_.erase(oldest);
+  }
+
+  Route & route = routes_[key];
+  route.poses = poses;
+  route.poses_2d.resize(poses.size());
+  for (size_t i = 0; i < poses.size(); ++i) {
+    route.poses_2d[i].x = poses[i].position.x;
+    route.poses_2d[i].y = poses[i].position.y;
+    route.poses_2d[i].theta = 2.0 * std::atan2(poses[i].orientation.z, poses[i].orientation.w);
+  }
+  // a point on the inflated costmap, with no yaw to bin
+  route.validity = std::make_unique<nav2_costmap_2d::PathValidity>(1, CHANGED_REGIONS,
+      nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+  return route;
+}
+
+}  // namespace nav2_navfn_planner
@@ -36,10 +36,8 @@ public:
   Status onCycleUpdate() override;
 
 protected:
-  bool isCollisionFree(
-    const double & distance,
-    const geometry_msgs::msg::Twist & cmd_vel,
-    geometry_msgs::msg::Pose2D & pose2d);
+  /// @brief Distance between the poses simulated along the way, in meters
+  static constexpr double LOOKAHEAD_STEP = 0.02;
 
   double min_linear_vel_;
   double max_linear_vel_;
@@ -0,0 +1,51 @@
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License. Reserved.
+
+#ifndef NAV2_RECOVERIES__RECOVERIES_NODE_HPP_
+#define NAV2_RECOVERIES__RECOVERIES_NODE_HPP_
+
+#include <memory>
+
+#include "rclcpp/rclcpp.hpp"
+#include "tf2_ros/buffer.h"
+#include "tf2_ros/transform_listener.h"
+#include "nav2_recoveries/back_up.hpp"
+#include "nav2_recoveries/spin.hpp"
+
+namespace nav2_recoveries
+{
+
+// The "recoveries" node, which serves the Spin and BackUp recoveries
+class RecoveriesNode
+{
+public:
+  explicit RecoveriesNode(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
+
+  rclcpp::node_interfaces::NodeBaseInterface::SharedPtr get_node_base_interface()
+  {
+    return node_->get_node_base_interface();
+  }
+
+private:
+  rclcpp::Node::SharedPtr node_;
+  std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
+  std::shared_ptr<tf2_ros::TransformListener> tf_listener_;
+
+  std::shared_ptr<Spin> spin_;
+  std::shared_ptr<BackUp> back_up_;
+};
+
+}  // namespace nav2_recoveries
+
+#endif  // NAV2_RECOVERIES__RECOVERIES_NODE_HPP_
@@ -15,18 +15,28 @@
 #ifndef NAV2_RECOVERIES__RECOVERY_HPP_
 #define NAV2_RECOVERIES__RECOVERY_HPP_
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <cmath>
 #include <chrono>
 #include <ctime>
+#include <future>
+#include <mutex>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "rclcpp/rclcpp.hpp"
+#include "tf2/utils.h"
 #include "tf2_ros/transform_listener.h"
 #include "tf2_ros/create_timer_ros.h"
 #include "geometry_msgs/msg/twist.hpp"
+#include "nav_msgs/msg/odometry.hpp"
+#include "std_msgs/msg/empty.hpp"
 #include "nav2_costmap_2d/collision_checker.hpp"
+#include "nav2_util/loop_rate.hpp"
 #include "nav2_util/simple_action_server.hpp"
 #include "nav2_util/robot_utils.hpp"
 
@@ -90,29 +100,96 @@ protected:
   std::unique_ptr<nav2_costmap_2d::CollisionChecker> collision_checker_;
   double cycle_frequency_;
 
+  // With use_cycle_timer, cycles run from a timer on the node's executor instead of a
+  // sleeping loop on the action server's thread
+  bool use_cycle_timer_{false};
+
+  // With an odom_topic, the latest odometry pose stands in for a tf lookup every cycle
+  rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
+  std::mutex odom_mutex_;
+  geometry_msgs::msg::PoseStamped odom_pose_;
+  bool odom_received_{false};
+
+  // A prefetch request warms the costmap, pose and footprint for a recovery likely to come,
+  // on the node's executor, while no command runs
+  rclcpp::Subscription<std_msgs::msg::Empty>::SharedPtr prefetch_sub_;
+  std::atomic<bool> executing_{false};
+
+  // How long onCycleUpdate() took over the current command, in seconds
+  struct CycleStats
+  {
+    size_t count{0};
+    double total{0.0};
+    double max{0.0};
+  } cycle_stats_;
+
+  // The remaining motion of the current command, simulated once as poses along it
+  std::vector<geometry_msgs::msg::Pose2D> lookahead_poses_;
+  size_t lookahead_checked_{0};  ///< Poses before it were collision free in lookahead_version_
+  uint64_t lookahead_version_{0};  ///< The costmap version the poses were checked in
+
   void configure()
   {
     RCLCPP_INFO(node_->get_logger(), "Configuring %s", recovery_name_.c_str());
 
     std::string costmap_topic;
+    std::string costmap_updates_topic;
     std::string footprint_topic;
+    int footprint_yaw_bins = 0;
+    std::string center_check;
+    int circumscribed_cost = 0;
+    std::string odom_topic;
 
     node_->get_parameter("costmap_topic", costmap_topic);
+    node_->get_parameter("costmap_updates_topic", costmap_updates_topic);
     node_->get_parameter("footprint_topic", footprint_topic);
+    node_->get_parameter("footprint_yaw_bins", footprint_yaw_bins);
+    node_->get_parameter("center_check", center_check);
+    node_->get_parameter("circumscribed_cost", circumscribed_cost);
+    node_->get_parameter("cycle_frequency", cycle_frequency_);
+    node_->get_parameter("use_cycle_timer", use_cycle_timer_);
+    node_->get_parameter("odom_topic", odom_topic);
 
     action_server_ = std::make_unique<ActionServer>(node_, recovery_name_,
         std::bind(&Recovery::execute, this));
 
     costmap_sub_ = std::make_shared<nav2_costmap_2d::CostmapSubscriber>(
       node_, costmap_topic);
+    if (!costmap_updates_topic.empty()) {
+      costmap_sub_->subscribeToUpdates(costmap_updates_topic);
+    }
 
     footprint_sub_ = std::make_shared<nav2_costmap_2d::FootprintSubscriber>(
       node_, footprint_topic);
 
     collision_checker_ = std::make_unique<nav2_costmap_2d::CollisionChecker>(
-      *costmap_sub_, *footprint_sub_, tf_, node_->get_name(), "odom");
+      *costmap_sub_, *footprint_sub_, tf_, node_->get_name(), "odom",
+      std::max(footprint_yaw_bins, 0));
+
+    nav2_costmap_2d::CenterCheckMode center_mode = nav2_costmap_2d::CenterCheckMode::EXACT;
+    if (!nav2_costmap_2d::centerCheckModeFromString(center_check, center_mode)) {
+      RCLCPP_WARN(node_->get_logger(), "Unknown center_check %s, checking footprints exactly",
+        center_check.c_str());
+    }
+    collision_checker_->setCenterCheck(nav2_costmap_2d::CenterCostCheck(center_mode,
+      static_cast<unsigned char>(std::min(std::max(circumscribed_cost, 0), 255))));
 
     vel_pub_ = node_->create_publisher<geometry_msgs::msg::Twist>("cmd_vel", 1);
+
+    if (!odom_topic.empty()) {
+      odom_sub_ = node_->create_subscription<nav_msgs::msg::Odometry>(odom_topic,
+          rclcpp::SystemDefaultsQoS(),
+          [this](const nav_msgs::msg::Odometry::SharedPtr msg) {
+            std::lock_guard<std::mutex> lock(odom_mutex_);
+            odom_pose_.header = msg->header;
+            odom_pose_.pose = msg->pose.pose;
+            odom_received_ = true;
+          });
+    }
+
+    prefetch_sub_ = node_->create_subscription<std_msgs::msg::Empty>("recovery_prefetch",
+        rclcpp::SystemDefaultsQoS(),
+        [this](const std_msgs::msg::Empty::SharedPtr) {prefetch();});
   }
 
   void cleanup()
@@ -122,60 +199,216 @@ protected:
     footprint_sub_.reset();
     costmap_sub_.reset();
     collision_checker_.reset();
+    odom_sub_.reset();
+    prefetch_sub_.reset();
   }
 
   void execute()
   {
     RCLCPP_INFO(node_->get_logger(), "Attempting %s", recovery_name_.c_str());
 
+    executing_ = true;
+    run();
+    executing_ = false;
+  }
+
+  void run()
+  {
     if (onRun(action_server_->get_current_goal()) != Status::SUCCEEDED) {
       RCLCPP_INFO(node_->get_logger(), "Initial checks failed for %s", recovery_name_.c_str());
       action_server_->terminate_goals();
       return;
     }
 
+    cycle_stats_ = CycleStats();
+
     // Log a message every second
     auto timer = node_->create_wall_timer(1s,
         [&]() {RCLCPP_INFO(node_->get_logger(), "%s running...", recovery_name_.c_str());});
 
-    rclcpp::Rate loop_rate(cycle_frequency_);
-
-    while (rclcpp::ok()) {
-      if (action_server_->is_cancel_requested()) {
-        RCLCPP_INFO(node_->get_logger(), "Canceling %s", recovery_name_.c_str());
-        stopRobot();
-        action_server_->terminate_goals();
-        return;
+    // On sim time the cycles keep to /clock, which the wall timer doesn't
+    auto loop_clock = std::make_shared<nav2_util::LoopClock>(node_->get_clock());
+    if (use_cycle_timer_ && !loop_clock->isSimTime()) {
+      executeOnTimer();
+    } else {
+      nav2_util::LoopRate loop_rate(loop_clock, cycle_frequency_);
+      while (rclcpp::ok() && !cycle()) {
+        loop_rate.sleep();
       }
+    }
+
+    if (cycle_stats_.count > 0) {
+      RCLCPP_INFO(node_->get_logger(), "%s ran %zu cycles, %.3f ms on average and %.3f ms at most",
+        recovery_name_.c_str(), cycle_stats_.count, 1e3 * cycle_stats_.total / cycle_stats_.count,
+        1e3 * cycle_stats_.max);
+    }
+  }
+
+  void executeOnTimer()
+  {
+    // the timer may still be running a cycle when the executor shuts down, so what it
+    // shares is not on this stack
+    struct Run
+    {
+      std::promise<void> done;
+      bool finished{false};
+    };
+    auto run = std::make_shared<Run>();
+    std::future<void> done = run->done.get_future();
+
+    auto period = std::chrono::duration<double>(1.0 / cycle_frequency_);
+    auto cycle_timer = node_->create_wall_timer(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(period),
+      [this, run]() {
+        if (!run->finished && cycle()) {
+          run->finished = true;
+          run->done.set_value();
+        }
+      });
+
+    while (rclcpp::ok() && done.wait_for(100ms) != std::future_status::ready) {
+    }
+    cycle_timer->cancel();
+  }
+
+  /**
+   * @brief Run one cycle of the recovery
+   * @return Whether the recovery is over, its goal then being answered
+   */
+  bool cycle()
+  {
+    if (action_server_->is_cancel_requested()) {
+      RCLCPP_INFO(node_->get_logger(), "Canceling %s", recovery_name_.c_str());
+      stopRobot();
+      action_server_->terminate_goals();
+      return true;
+    }
 
-      // TODO(orduno) #868 Enable preempting a Recovery on-the-fly without stopping
-      if (action_server_->is_preempt_requested()) {
-        RCLCPP_ERROR(node_->get_logger(), "Received a preemption request for %s,"
-          " however feature is currently not implemented. Aborting and stopping.",
-          recovery_name_.c_str());
-        stopRobot();
+    // TODO(orduno) #868 Enable preempting a Recovery on-the-fly without stopping
+    if (action_server_->is_preempt_requested()) {
+      RCLCPP_ERROR(node_->get_logger(), "Received a preemption request for %s,"
+        " however feature is currently not implemented. Aborting and stopping.",
+        recovery_name_.c_str());
+      stopRobot();
+      action_server_->terminate_goals();
+      return true;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Status status = onCycleUpdate();
+    std::chrono::duration<double> elapsed_time = std::chrono::steady_clock::now() - start;
+    double elapsed = elapsed_time.count();
+    cycle_stats_.count++;
+    cycle_stats_.total += elapsed;
+    cycle_stats_.max = std::max(cycle_stats_.max, elapsed);
+
+    switch (status) {
+      case Status::SUCCEEDED:
+        RCLCPP_INFO(node_->get_logger(), "%s completed successfully", recovery_name_.c_str());
+        action_server_->succeeded_current();
+        return true;
+
+      case Status::FAILED:
+        RCLCPP_WARN(node_->get_logger(), "%s failed", recovery_name_.c_str());
         action_server_->terminate_goals();
+        return true;
+
+      case Status::RUNNING:
+
+      default:
+        return false;
+    }
+  }
+
+  /**
+   * @brief Get ready for a command: convert the latest costmap, look up the robot's pose and
+   * score the footprint there, which fills the collision checker's rasters
+   *
+   * A command that arrives after does the same work again, but on converted data and warm
+   * caches, so its first cycle comes sooner.
+   */
+  void prefetch()
+  {
+    if (executing_) {
+      return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    try {
+      costmap_sub_->getCostmap();
+
+      geometry_msgs::msg::PoseStamped pose;
+      if (!getRobotPose(pose)) {
         return;
       }
+      geometry_msgs::msg::Pose2D pose2d;
+      pose2d.x = pose.pose.position.x;
+      pose2d.y = pose.pose.position.y;
+      pose2d.theta = tf2::getYaw(pose.pose.orientation);
+      collision_checker_->scorePose(pose2d);
+    } catch (const std::exception & e) {
+      RCLCPP_DEBUG(node_->get_logger(), "%s could not prefetch: %s", recovery_name_.c_str(),
+        e.what());
+      return;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    RCLCPP_DEBUG(node_->get_logger(), "%s prefetched in %.3f ms", recovery_name_.c_str(),
+      1e3 * elapsed.count());
+  }
 
-      switch (onCycleUpdate()) {
-        case Status::SUCCEEDED:
-          RCLCPP_INFO(node_->get_logger(), "%s completed successfully", recovery_name_.c_str());
-          action_server_->succeeded_current();
-          return;
+  /**
+   * @brief Get the robot's pose in the odom frame, from the latest odometry if there is
+   * an odom_topic, or else from tf
+   */
+  bool getRobotPose(geometry_msgs::msg::PoseStamped & pose)
+  {
+    if (odom_sub_) {
+      std::lock_guard<std::mutex> lock(odom_mutex_);
+      if (odom_received_) {
+        pose = odom_pose_;
+        return true;
+      }
+    }
+    return nav2_util::getCurrentPose(pose, tf_, "odom");
+  }
 
-        case Status::FAILED:
-          RCLCPP_WARN(node_->get_logger(), "%s failed", recovery_name_.c_str());
-          action_server_->terminate_goals();
-          return;
+  /**
+   * @brief Set the poses along the remaining motion, for checkLookahead()
+   */
+  void setLookahead(std::vector<geometry_msgs::msg::Pose2D> poses)
+  {
+    lookahead_poses_ = std::move(poses);
+    lookahead_checked_ = 0;
+  }
 
-        case Status::RUNNING:
+  /**
+   * @brief Whether the lookahead poses from first, over the next count of them, are
+   * collision free
+   *
+   * Poses found free stay so until the costmap changes, so a call only checks the poses
+   * that came into the window since the last one, or all of them after a costmap update.
+   */
+  bool checkLookahead(size_t first, size_t count)
+  {
+    size_t end = std::min(first + count, lookahead_poses_.size());
+    uint64_t version = costmap_sub_->getVersion();
+    if (version != lookahead_version_ || lookahead_checked_ < first) {
+      lookahead_version_ = version;
+      lookahead_checked_ = first;
+    }
+    if (lookahead_checked_ >= end) {
+      return true;
+    }
 
-        default:
-          loop_rate.sleep();
-          break;
-      }
+    std::vector<geometry_msgs::msg::Pose2D> poses(
+      lookahead_poses_.begin() + lookahead_checked_, lookahead_poses_.begin() + end);
+    int collision = collision_checker_->firstCollision(poses);
+    if (collision >= 0) {
+      RCLCPP_DEBUG(node_->get_logger(), "Simulated pose %zu of %zu is in collision",
+        lookahead_checked_ + collision, lookahead_poses_.size());
+      return false;
     }
+    lookahead_checked_ = end;
+    return true;
   }
 
   void stopRobot()
@@ -38,10 +38,8 @@ public:
   Status onCycleUpdate() override;
 
 protected:
-  bool isCollisionFree(
-    const double & distance,
-    const geometry_msgs::msg::Twist & cmd_vel,
-    geometry_msgs::msg::Pose2D & pose2d);
+  /// @brief Yaw between the poses simulated along the turn
+  static constexpr double LOOKAHEAD_YAW_STEP = 0.1;
 
   double min_rotational_vel_;
   double max_rotational_vel_;
@@ -12,9 +12,13 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <ctime>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "nav2_recoveries/back_up.hpp"
 
@@ -44,18 +48,31 @@ Status BackUp::onRun(const std::shared_ptr<const BackUpAction::Goal> command)
 
   command_x_ = command->target.x;
 
-  if (!nav2_util::getCurrentPose(initial_pose_, tf_, "odom")) {
+  if (!getRobotPose(initial_pose_)) {
     RCLCPP_ERROR(node_->get_logger(), "Initial robot pose is not available.");
     return Status::FAILED;
   }
 
+  // the whole way, along the initial heading, one distance step apart
+  std::vector<geometry_msgs::msg::Pose2D> poses;
+  geometry_msgs::msg::Pose2D pose2d;
+  pose2d.theta = tf2::getYaw(initial_pose_.pose.orientation);
+  const double direction = command_x_ < 0 ? -1.0 : 1.0;
+  const int steps = static_cast<int>(std::ceil(abs(command_x_) / LOOKAHEAD_STEP));
+  for (int i = 1; i <= steps; ++i) {
+    double travel = direction * std::min(i * LOOKAHEAD_STEP, abs(command_x_));
+    pose2d.x = initial_pose_.pose.position.x + travel * cos(pose2d.theta);
+    pose2d.y = initial_pose_.pose.position.y + travel * sin(pose2d.theta);
+    poses.push_back(pose2d);
+  }
+  setLookahead(std::move(poses));
   return Status::SUCCEEDED;
 }
 
 Status BackUp::onCycleUpdate()
 {
   geometry_msgs::msg::PoseStamped current_pose;
-  if (!nav2_util::getCurrentPose(current_pose, tf_, "odom")) {
+  if (!getRobotPose(current_pose)) {
     RCLCPP_ERROR(node_->get_logger(), "Current robot pose is not available.");
     return Status::FAILED;
   }
@@ -74,12 +91,11 @@ Status BackUp::onCycleUpdate()
   cmd_vel.angular.z = 0.0;
   command_x_ < 0 ? cmd_vel.linear.x = -0.025 : cmd_vel.linear.x = 0.025;
 
-  geometry_msgs::msg::Pose2D pose2d;
-  pose2d.x = current_pose.pose.position.x;
-  pose2d.y = current_pose.pose.position.y;
-  pose2d.theta = tf2::getYaw(current_pose.pose.orientation);
-
-  if (!isCollisionFree(distance, cmd_vel, pose2d)) {
+  // the way ahead that could be covered in simulate_ahead_time_
+  const size_t first = static_cast<size_t>(distance / LOOKAHEAD_STEP);
+  const double lookahead_distance = abs(cmd_vel.linear.x) * simulate_ahead_time_;
+  const size_t count = static_cast<size_t>(std::ceil(lookahead_distance / LOOKAHEAD_STEP));
+  if (!checkLookahead(first, count)) {
     stopRobot();
     RCLCPP_WARN(node_->get_logger(), "Collision Ahead - Exiting BackUp");
     return Status::SUCCEEDED;
@@ -90,31 +106,4 @@ Status BackUp::onCycleUpdate()
   return Status::RUNNING;
 }
 
-bool BackUp::isCollisionFree(
-  const double & distance,
-  const geometry_msgs::msg::Twist & cmd_vel,
-  geometry_msgs::msg::Pose2D & pose2d)
-{
-  // Simulate ahead by simulate_ahead_time_ in cycle_frequency_ increments
-  int cycle_count = 0;
-  double sim_position_change;
-  const double diff_dist = abs(command_x_) - distance;
-  const int max_cycle_count = static_cast<int>(cycle_frequency_ * simulate_ahead_time_);
-
-  while (cycle_count < max_cycle_count) {
-    sim_position_change = cmd_vel.linear.x * (cycle_count / cycle_frequency_);
-    pose2d.x += sim_position_change;
-    cycle_count++;
-
-    if (diff_dist - abs(sim_position_change) <= 0.) {
-      break;
-    }
-
-    if (!collision_checker_->isCollisionFree(pose2d)) {
-      return false;
-    }
-  }
-  return true;
-}
-
 }  // namespace nav2_recoveries
@@ -0,0 +1,63 @@
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License. Reserved.
+
+#include "nav2_recoveries/recoveries_node.hpp"
+
+#include <memory>
+#include <string>
+
+#include "tf2_ros/create_timer_ros.h"
+
+namespace nav2_recoveries
+{
+
+RecoveriesNode::RecoveriesNode(const rclcpp::NodeOptions & options)
+: node_(std::make_shared<rclcpp::Node>("recoveries", options))
+{
+  tf_buffer_ = std::make_shared<tf2_ros::Buffer>(node_->get_clock());
+  auto timer_interface = std::make_shared<tf2_ros::CreateTimerROS>(
+    node_->get_node_base_interface(),
+    node_->get_node_timers_interface());
+  tf_buffer_->setCreateTimerInterface(timer_interface);
+  tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_);
+
+  node_->declare_parameter(
+    "costmap_topic", rclcpp::ParameterValue(std::string("local_costmap/costmap_raw")));
+  // e.g. local_costmap/costmap_raw_updates, when the costmap publishes raw deltas
+  node_->declare_parameter(
+    "costmap_updates_topic", rclcpp::ParameterValue(std::string("")));
+  node_->declare_parameter(
+    "footprint_topic", rclcpp::ParameterValue(std::string("local_costmap/published_footprint")));
+  // 0 checks the exact footprint at every pose instead of a cached one per yaw bin
+  node_->declare_parameter("footprint_yaw_bins", rclcpp::ParameterValue(72));
+  // inscribed or circumscribed to settle poses from the cost of their cell where it can, the
+  // latter given the costmap's cost at the circumscribed radius, which it does not publish
+  node_->declare_parameter("center_check", rclcpp::ParameterValue(std::string("exact")));
+  node_->declare_parameter("circumscribed_cost", rclcpp::ParameterValue(0));
+  // the recoveries check each part of their motion once, so this costs little beyond commands
+  node_->declare_parameter("cycle_frequency", rclcpp::ParameterValue(10.0));
+  // run the cycles from a timer, which keeps to higher rates than a sleeping loop
+  node_->declare_parameter("use_cycle_timer", rclcpp::ParameterValue(false));
+  // e.g. odom, to take the robot's pose from odometry in the odom frame instead of tf
+  node_->declare_parameter("odom_topic", rclcpp::ParameterValue(std::string("")));
+
+  spin_ = std::make_shared<Spin>(node_, tf_buffer_);
+  back_up_ = std::make_shared<BackUp>(node_, tf_buffer_);
+}
+
+}  // namespace nav2_recoveries
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_recoveries::RecoveriesNode)
@@ -18,6 +18,8 @@
 #include <thread>
 #include <algorithm>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "nav2_recoveries/spin.hpp"
 #pragma GCC diagnostic push
@@ -50,7 +52,7 @@ Spin::~Spin()
 Status Spin::onRun(const std::shared_ptr<const SpinAction::Goal> command)
 {
   geometry_msgs::msg::PoseStamped current_pose;
-  if (!nav2_util::getCurrentPose(current_pose, tf_, "odom")) {
+  if (!getRobotPose(current_pose)) {
     RCLCPP_ERROR(node_->get_logger(), "Current robot pose is not available.");
     return Status::FAILED;
   }
@@ -59,13 +61,26 @@ Status Spin::onRun(const std::shared_ptr<const SpinAction::Goal> command)
   cmd_yaw_ = -command->target_yaw;
   RCLCPP_INFO(node_->get_logger(), "Turning %0.2f for spin recovery.",
     cmd_yaw_);
+
+  // the whole turn, in place, one yaw step apart
+  std::vector<geometry_msgs::msg::Pose2D> poses;
+  geometry_msgs::msg::Pose2D pose2d;
+  pose2d.x = current_pose.pose.position.x;
+  pose2d.y = current_pose.pose.position.y;
+  const double direction = cmd_yaw_ < 0 ? -1.0 : 1.0;
+  const int steps = static_cast<int>(std::ceil(abs(cmd_yaw_) / LOOKAHEAD_YAW_STEP));
+  for (int i = 1; i <= steps; ++i) {
+    pose2d.theta = initial_yaw_ + direction * std::min(i * LOOKAHEAD_YAW_STEP, abs(cmd_yaw_));
+    poses.push_back(pose2d);
+  }
+  setLookahead(std::move(poses));
   return Status::SUCCEEDED;
 }
 
 Status Spin::onCycleUpdate()
 {
   geometry_msgs::msg::PoseStamped current_pose;
-  if (!nav2_util::getCurrentPose(current_pose, tf_, "odom")) {
+  if (!getRobotPose(current_pose)) {
     RCLCPP_ERROR(node_->get_logger(), "Current robot pose is not available.");
     return Status::FAILED;
   }
@@ -88,12 +103,11 @@ Status Spin::onCycleUpdate()
   geometry_msgs::msg::Twist cmd_vel;
   cmd_yaw_ < 0 ? cmd_vel.angular.z = -vel : cmd_vel.angular.z = vel;
 
-  geometry_msgs::msg::Pose2D pose2d;
-  pose2d.x = current_pose.pose.position.x;
-  pose2d.y = current_pose.pose.position.y;
-  pose2d.theta = tf2::getYaw(current_pose.pose.orientation);
-
-  if (!isCollisionFree(relative_yaw, cmd_vel, pose2d)) {
+  // the turn ahead that could be covered in simulate_ahead_time_
+  const size_t first = static_cast<size_t>(relative_yaw / LOOKAHEAD_YAW_STEP);
+  const double lookahead_yaw = max_rotational_vel_ * simulate_ahead_time_;
+  const size_t count = static_cast<size_t>(std::ceil(lookahead_yaw / LOOKAHEAD_YAW_STEP));
+  if (!checkLookahead(first, count)) {
     stopRobot();
     RCLCPP_WARN(node_->get_logger(), "Collision Ahead - Exiting Spin");
     return Status::SUCCEEDED;
@@ -104,30 +118,4 @@ Status Spin::onCycleUpdate()
   return Status::RUNNING;
 }
 
-bool Spin::isCollisionFree(
-  const double & relative_yaw,
-  const geometry_msgs::msg::Twist & cmd_vel,
-  geometry_msgs::msg::Pose2D & pose2d)
-{
-  // Simulate ahead by simulate_ahead_time_ in cycle_frequency_ increments
-  int cycle_count = 0;
-  double sim_position_change;
-  const int max_cycle_count = static_cast<int>(cycle_frequency_ * simulate_ahead_time_);
-
-  while (cycle_count < max_cycle_count) {
-    sim_position_change = cmd_vel.angular.z * (cycle_count / cycle_frequency_);
-    pose2d.theta += sim_position_change;
-    cycle_count++;
-
-    if (abs(relative_yaw) - abs(sim_position_change) <= 0.) {
-      break;
-    }
-
-    if (!collision_checker_->isCollisionFree(pose2d)) {
-      return false;
-    }
-  }
-  return true;
-}
-
 }  // namespace nav2_recoveries
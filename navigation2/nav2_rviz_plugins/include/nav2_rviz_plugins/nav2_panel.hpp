@@ -23,6 +23,7 @@
 
 #include "nav2_lifecycle_manager/lifecycle_manager_client.hpp"
 #include "nav2_msgs/action/navigate_to_pose.hpp"
+#include "nav2_rviz_plugins/performance_view.hpp"
 #include "nav2_rviz_plugins/ros_action_qevent.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
@@ -55,6 +56,7 @@ private Q_SLOTS:
   void onShutdown();
   void onCancel();
   void onNewGoal(double x, double y, double theta, QString frame);
+  void onPerformanceToggled(bool on);
 
 private:
   void loadLogFiles();
@@ -85,6 +87,10 @@ private:
 
   QPushButton * start_stop_button_{nullptr};
 
+  // The performance view, shown and subscribed to the metrics while its box is checked
+  QGroupBox * performance_box_{nullptr};
+  PerformanceView * performance_view_{nullptr};
+
   QStateMachine state_machine_;
 
   QState * initial_{nullptr};
@@ -0,0 +1,96 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_RVIZ_PLUGINS__PERFORMANCE_VIEW_HPP_
+#define NAV2_RVIZ_PLUGINS__PERFORMANCE_VIEW_HPP_
+
+#include <QtWidgets>
+#include <QBasicTimer>
+
+#include <deque>
+#include <map>
+#include <string>
+
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace nav2_rviz_plugins
+{
+
+/// The recent history of a value, drawn as a line scaled to its largest value
+class Sparkline : public QWidget
+{
+  Q_OBJECT
+
+public:
+  explicit Sparkline(QWidget * parent = 0);
+
+  void addValue(double value);
+
+  QSize sizeHint() const override {return QSize(80, 16);}
+
+protected:
+  void paintEvent(QPaintEvent * event) override;
+
+private:
+  std::deque<double> values_;
+};
+
+/// The metrics the nav2 nodes export, by node: the CPU and memory of its process, the rate
+/// and p99 latency of the cycles that matter for keeping up, and the deadlines missed
+class PerformanceView : public QWidget
+{
+  Q_OBJECT
+
+public:
+  explicit PerformanceView(QWidget * parent = 0);
+
+  /// Subscribe to the metrics, or drop the subscription so that the view costs nothing
+  void setActive(bool active);
+
+private:
+  // The metrics are taken in and shown only once a second, however often they are published
+  void timerEvent(QTimerEvent * event) override;
+  void onMetrics(const diagnostic_msgs::msg::DiagnosticArray::SharedPtr msg);
+  void refresh();
+
+  // The row of a metric of a node, created on first use
+  QTreeWidgetItem * row(const std::string & node, const std::string & metric, double trend);
+
+  struct Row
+  {
+    QTreeWidgetItem * item;
+    Sparkline * sparkline;
+  };
+
+  // The (non-spinning) node to receive the metrics with, spun by the timer
+  rclcpp::Node::SharedPtr node_;
+  rclcpp::Subscription<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr subscription_;
+  QBasicTimer timer_;
+
+  // The latest metrics of each node, since the last refresh
+  std::map<std::string, diagnostic_msgs::msg::DiagnosticArray::SharedPtr> latest_;
+
+  // The last value of each node's missed deadline counters
+  std::map<std::string, double> deadline_counts_;
+
+  std::map<std::string, QTreeWidgetItem *> nodes_;
+  std::map<std::string, Row> rows_;
+  QTreeWidget * tree_{nullptr};
+  QLabel * status_{nullptr};
+};
+
+}  // namespace nav2_rviz_plugins
+
+#endif  //  NAV2_RVIZ_PLUGINS__PERFORMANCE_VIEW_HPP_
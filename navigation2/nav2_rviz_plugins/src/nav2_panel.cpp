@@ -112,9 +112,22 @@ Nav2Panel::Nav2Panel(QWidget * parent)
   state_machine_.setInitialState(initial_);
   state_machine_.start();
 
+  performance_view_ = new PerformanceView;
+  performance_box_ = new QGroupBox("Performance");
+  performance_box_->setCheckable(true);
+  performance_box_->setToolTip("Per-node load and latency from the metrics topic");
+  QVBoxLayout * performance_layout = new QVBoxLayout;
+  performance_layout->addWidget(performance_view_);
+  performance_box_->setLayout(performance_layout);
+  QObject::connect(performance_box_, SIGNAL(toggled(bool)), this,
+    SLOT(onPerformanceToggled(bool)));
+  performance_box_->setChecked(true);
+  onPerformanceToggled(true);
+
   // Lay out the items in the panel
   QVBoxLayout * main_layout = new QVBoxLayout;
   main_layout->addWidget(start_stop_button_);
+  main_layout->addWidget(performance_box_);
   main_layout->setContentsMargins(10, 10, 10, 10);
   setLayout(main_layout);
 
@@ -181,6 +194,13 @@ Nav2Panel::onNewGoal(double x, double y, double theta, QString frame)
   startNavigation(pose);
 }
 
+void
+Nav2Panel::onPerformanceToggled(bool on)
+{
+  performance_view_->setVisible(on);
+  performance_view_->setActive(on);
+}
+
 void
 Nav2Panel::onCancelButtonPressed()
 {
@@ -261,12 +281,17 @@ void
 Nav2Panel::save(rviz_common::Config config) const
 {
   Panel::save(config);
+  config.mapSetValue("ShowPerformance", performance_box_->isChecked());
 }
 
 void
 Nav2Panel::load(const rviz_common::Config & config)
 {
   Panel::load(config);
+  QVariant show_performance;
+  if (config.mapGetValue("ShowPerformance", &show_performance)) {
+    performance_box_->setChecked(show_performance.toBool());
+  }
 }
 
 }  // namespace nav2_rviz_plugins
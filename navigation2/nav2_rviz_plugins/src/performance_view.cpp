@@ -0,0 +1,232 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_rviz_plugins/performance_view.hpp"
+
+#include <QPainter>
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nav2_rviz_plugins
+{
+
+// The cycles shown, besides the costmap updates (*.update_map)
+static const char * const CYCLES[] = {
+  "amcl.total", "bt.tick", "dwb.compute_velocity_commands", "navfn.make_plan"};
+
+// The counters of deadlines missed, and work dropped for lack of time
+static const char * const DEADLINE_COUNTERS[] = {"amcl.dropped_scans", "dwb_controller.overruns"};
+
+// A process using more of a core than this is taken as short of CPU
+static const double CPU_WARNING_PERCENT = 90.0;
+
+static const size_t SPARKLINE_LENGTH = 60;
+
+static bool isShownCycle(const std::string & name)
+{
+  const std::string update_map = ".update_map";
+  if (name.size() > update_map.size() &&
+    name.compare(name.size() - update_map.size(), update_map.size(), update_map) == 0)
+  {
+    return true;
+  }
+  return std::find(std::begin(CYCLES), std::end(CYCLES), name) != std::end(CYCLES);
+}
+
+Sparkline::Sparkline(QWidget * parent)
+: QWidget(parent)
+{
+  setMinimumSize(sizeHint());
+}
+
+void
+Sparkline::addValue(double value)
+{
+  values_.push_back(value);
+  if (values_.size() > SPARKLINE_LENGTH) {
+    values_.pop_front();
+  }
+  update();
+}
+
+void
+Sparkline::paintEvent(QPaintEvent * /*event*/)
+{
+  if (values_.size() < 2) {
+    return;
+  }
+  double top = std::max(*std::max_element(values_.begin(), values_.end()), 1e-9);
+  double step = static_cast<double>(width() - 1) / (SPARKLINE_LENGTH - 1);
+  double offset = (SPARKLINE_LENGTH - values_.size()) * step;
+
+  QPolygonF line;
+  for (size_t i = 0; i < values_.size(); ++i) {
+    line << QPointF(offset + i * step, (height() - 1) * (1.0 - values_[i] / top));
+  }
+  QPainter painter(this);
+  painter.setRenderHint(QPainter::Antialiasing);
+  painter.setPen(palette().color(QPalette::Highlight));
+  painter.drawPolyline(line);
+}
+
+PerformanceView::PerformanceView(QWidget * parent)
+: QWidget(parent)
+{
+  status_ = new QLabel("Waiting for metrics");
+  status_->setWordWrap(true);
+  status_->setToolTip("Nodes export their metrics with the metrics_period parameter");
+
+  tree_ = new QTreeWidget;
+  tree_->setColumnCount(3);
+  tree_->setHeaderLabels({"Metric", "Value", "Trend"});
+  tree_->setRootIsDecorated(true);
+  tree_->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+  QVBoxLayout * layout = new QVBoxLayout;
+  layout->addWidget(status_);
+  layout->addWidget(tree_);
+  layout->setContentsMargins(0, 0, 0, 0);
+  setLayout(layout);
+
+  auto options = rclcpp::NodeOptions().arguments({"__node:=navigation_dialog_metrics"});
+  node_ = std::make_shared<rclcpp::Node>("_", options);
+}
+
+void
+PerformanceView::setActive(bool active)
+{
+  if (active && !subscription_) {
+    // Best effort takes whatever the publishers send without asking for resends, and the depth
+    // holds a second of metrics from a few dozen nodes
+    subscription_ = node_->create_subscription<diagnostic_msgs::msg::DiagnosticArray>(
+      "metrics", rclcpp::QoS(rclcpp::KeepLast(32)).best_effort(),
+      std::bind(&PerformanceView::onMetrics, this, std::placeholders::_1));
+    timer_.start(1000, this);
+  } else if (!active && subscription_) {
+    timer_.stop();
+    subscription_.reset();
+    latest_.clear();
+  }
+}
+
+void
+PerformanceView::timerEvent(QTimerEvent * event)
+{
+  if (event->timerId() == timer_.timerId()) {
+    rclcpp::spin_some(node_);
+    refresh();
+  }
+}
+
+void
+PerformanceView::onMetrics(const diagnostic_msgs::msg::DiagnosticArray::SharedPtr msg)
+{
+  if (!msg->status.empty()) {
+    latest_[msg->status.front().hardware_id] = msg;
+  }
+}
+
+QTreeWidgetItem *
+PerformanceView::row(const std::string & node, const std::string & metric, double trend)
+{
+  auto & node_item = nodes_[node];
+  if (!node_item) {
+    node_item = new QTreeWidgetItem(tree_, {QString::fromStdString(node)});
+    node_item->setExpanded(true);
+  }
+
+  auto entry = rows_.find(node + "/" + metric);
+  if (entry == rows_.end()) {
+    Row created;
+    created.item = new QTreeWidgetItem(node_item, {QString::fromStdString(metric)});
+    created.sparkline = new Sparkline;
+    tree_->setItemWidget(created.item, 2, created.sparkline);
+    entry = rows_.emplace(node + "/" + metric, created).first;
+  }
+  entry->second.sparkline->addValue(trend);
+  return entry->second.item;
+}
+
+void
+PerformanceView::refresh()
+{
+  if (latest_.empty()) {
+    return;
+  }
+
+  std::vector<std::string> starved;
+  for (const auto & latest : latest_) {
+    const std::string & node = latest.first.empty() ? "(unnamed)" : latest.first;
+    for (const auto & status : latest.second->status) {
+      std::map<std::string, double> values;
+      for (const auto & kv : status.values) {
+        values[kv.key] = std::atof(kv.value.c_str());
+      }
+
+      if (status.name == "metrics") {
+        if (values.count("process.cpu_percent")) {
+          double cpu = values["process.cpu_percent"];
+          row(node, "CPU", cpu)->setText(1, QString("%1 %").arg(cpu, 0, 'f', 0));
+          if (cpu >= CPU_WARNING_PERCENT) {
+            starved.push_back(node + " CPU " + std::to_string(static_cast<int>(cpu)) + "%");
+          }
+        }
+        if (values.count("process.rss_mb")) {
+          double rss = values["process.rss_mb"];
+          row(node, "Memory", rss)->setText(1, QString("%1 MB").arg(rss, 0, 'f', 0));
+        }
+        for (const char * counter : DEADLINE_COUNTERS) {
+          if (!values.count(counter)) {
+            continue;
+          }
+          // What was missed before the view started is only in the total
+          auto last = deadline_counts_.emplace(node + "/" + counter, values[counter]).first;
+          double missed = std::max(values[counter] - last->second, 0.0);
+          last->second = values[counter];
+          row(node, counter, missed)->setText(1,
+            QString("%1 new, %2 total").arg(missed, 0, 'f', 0).arg(values[counter], 0, 'f', 0));
+          if (missed > 0) {
+            starved.push_back(std::string(counter) + " +" +
+              std::to_string(static_cast<int>(missed)));
+          }
+        }
+      } else if (isShownCycle(status.name)) {
+        double p99 = values.count("p99") ? values["p99"] : 0.0;
+        row(node, status.name, p99)->setText(1,
+          QString("%1 Hz, p99 %2 ms").arg(values["rate"], 0, 'f', 1).arg(p99, 0, 'f', 1));
+      }
+    }
+  }
+  latest_.clear();
+
+  if (starved.empty()) {
+    status_->setText("All nodes keeping up");
+    status_->setStyleSheet("QLabel { color: green; }");
+  } else {
+    std::string text = "Compute-starved:";
+    for (const auto & reason : starved) {
+      text += " " + reason + ";";
+    }
+    text.pop_back();
+    status_->setText(QString::fromStdString(text));
+    status_->setStyleSheet("QLabel { color: red; font-weight: bold; }");
+  }
+}
+
+}  // namespace nav2_rviz_plugins
@@ -0,0 +1,201 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+
+#include "kinematic_sim.hpp"
+
+namespace nav2_system_tests
+{
+
+namespace
+{
+
+geometry_msgs::msg::Quaternion yawToQuaternion(double yaw)
+{
+  geometry_msgs::msg::Quaternion q;
+  q.z = std::sin(yaw / 2.0);
+  q.w = std::cos(yaw / 2.0);
+  return q;
+}
+
+}  // namespace
+
+KinematicSim::KinematicSim()
+: Node("kinematic_sim")
+{
+  RCLCPP_INFO(get_logger(), "Initializing KinematicSim...");
+
+  declare_parameter("step", 0.01);
+  declare_parameter("real_time_factor", 0.0);
+  declare_parameter("lockstep", true);
+  declare_parameter("control_period", 0.05);
+  declare_parameter("lockstep_timeout", 0.1);
+  declare_parameter("cmd_vel_timeout", 0.5);
+  declare_parameter("publish_map_transform", true);
+  declare_parameter("global_frame", std::string("map"));
+  declare_parameter("odom_frame", std::string("odom"));
+  declare_parameter("base_frame", std::string("base_link"));
+  declare_parameter("initial_x", 0.0);
+  declare_parameter("initial_y", 0.0);
+  declare_parameter("initial_yaw", 0.0);
+
+  double lockstep_timeout;
+  get_parameter("step", step_);
+  get_parameter("real_time_factor", real_time_factor_);
+  get_parameter("lockstep", lockstep_);
+  get_parameter("control_period", control_period_);
+  get_parameter("lockstep_timeout", lockstep_timeout);
+  get_parameter("cmd_vel_timeout", cmd_vel_timeout_);
+  get_parameter("publish_map_transform", publish_map_transform_);
+  get_parameter("global_frame", global_frame_);
+  get_parameter("odom_frame", odom_frame_);
+  get_parameter("base_frame", base_frame_);
+  get_parameter("initial_x", initial_x_);
+  get_parameter("initial_y", initial_y_);
+  get_parameter("initial_yaw", initial_yaw_);
+  lockstep_timeout_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::duration<double>(lockstep_timeout));
+
+  clock_pub_ = create_publisher<rosgraph_msgs::msg::Clock>("clock", 1);
+  odom_pub_ = create_publisher<nav_msgs::msg::Odometry>("odom", 1);
+  tf_pub_ = create_publisher<tf2_msgs::msg::TFMessage>("tf", 100);
+  cmd_vel_sub_ = create_subscription<geometry_msgs::msg::Twist>("cmd_vel", 1,
+      std::bind(&KinematicSim::onCmdVel, this, std::placeholders::_1));
+
+  thread_ = std::thread(&KinematicSim::run, this);
+
+  RCLCPP_INFO(get_logger(), "Initialized KinematicSim");
+}
+
+KinematicSim::~KinematicSim()
+{
+  stop_ = true;
+  cmd_cv_.notify_all();
+  thread_.join();
+}
+
+void
+KinematicSim::onCmdVel(const geometry_msgs::msg::Twist::SharedPtr msg)
+{
+  std::lock_guard<std::mutex> lock(cmd_mutex_);
+  cmd_ = *msg;
+  cmd_time_ = time_;
+  commands_++;
+  cmd_cv_.notify_all();
+}
+
+void
+KinematicSim::run()
+{
+  const auto start = std::chrono::steady_clock::now();
+  const int64_t step_ns = static_cast<int64_t>(step_ * 1e9);
+  const int64_t control_ns = static_cast<int64_t>(control_period_ * 1e9);
+  int64_t next_control = control_ns;
+
+  publish();
+  while (rclcpp::ok() && !stop_) {
+    step(step_);
+    {
+      std::lock_guard<std::mutex> lock(cmd_mutex_);
+      time_ += step_ns;
+    }
+    publish();
+
+    if (lockstep_ && time_ >= next_control) {
+      waitForCommand();
+      next_control += control_ns;
+    }
+    if (real_time_factor_ > 0.0) {
+      std::this_thread::sleep_until(start + std::chrono::duration_cast<
+          std::chrono::steady_clock::duration>(std::chrono::nanoseconds(
+          static_cast<int64_t>(time_ / real_time_factor_))));
+    }
+  }
+}
+
+bool
+KinematicSim::waitForCommand()
+{
+  // A command for this period is one that came after the clock reached its start
+  std::unique_lock<std::mutex> lock(cmd_mutex_);
+  const uint64_t commands = commands_;
+  return cmd_cv_.wait_for(lock, lockstep_timeout_,
+           [this, commands]() {return stop_ || commands_ != commands;});
+}
+
+void
+KinematicSim::step(double dt)
+{
+  geometry_msgs::msg::Twist cmd;
+  {
+    std::lock_guard<std::mutex> lock(cmd_mutex_);
+    if ((time_ - cmd_time_) * 1e-9 <= cmd_vel_timeout_) {
+      cmd = cmd_;
+    }
+  }
+
+  // A unicycle, integrated at the middle of the step
+  double yaw = yaw_ + cmd.angular.z * dt / 2.0;
+  x_ += (cmd.linear.x * std::cos(yaw) - cmd.linear.y * std::sin(yaw)) * dt;
+  y_ += (cmd.linear.x * std::sin(yaw) + cmd.linear.y * std::cos(yaw)) * dt;
+  yaw_ = std::remainder(yaw_ + cmd.angular.z * dt, 2.0 * M_PI);
+  twist_ = cmd;
+}
+
+void
+KinematicSim::publish()
+{
+  rclcpp::Time stamp(time_, RCL_ROS_TIME);
+
+  rosgraph_msgs::msg::Clock clock;
+  clock.clock = stamp;
+  clock_pub_->publish(clock);
+
+  nav_msgs::msg::Odometry odom;
+  odom.header.stamp = stamp;
+  odom.header.frame_id = odom_frame_;
+  odom.child_frame_id = base_frame_;
+  odom.pose.pose.position.x = x_;
+  odom.pose.pose.position.y = y_;
+  odom.pose.pose.orientation = yawToQuaternion(yaw_);
+  odom.twist.twist = twist_;
+  odom_pub_->publish(odom);
+
+  tf2_msgs::msg::TFMessage tf;
+  geometry_msgs::msg::TransformStamped odom_to_base;
+  odom_to_base.header = odom.header;
+  odom_to_base.child_frame_id = base_frame_;
+  odom_to_base.transform.translation.x = x_;
+  odom_to_base.transform.translation.y = y_;
+  odom_to_base.transform.rotation = odom.pose.pose.orientation;
+  tf.transforms.push_back(odom_to_base);
+
+  if (publish_map_transform_) {
+    geometry_msgs::msg::TransformStamped map_to_odom;
+    map_to_odom.header.stamp = stamp;
+    map_to_odom.header.frame_id = global_frame_;
+    map_to_odom.child_frame_id = odom_frame_;
+    map_to_odom.transform.translation.x = initial_x_;
+    map_to_odom.transform.translation.y = initial_y_;
+    map_to_odom.transform.rotation = yawToQuaternion(initial_yaw_);
+    tf.transforms.push_back(map_to_odom);
+  }
+  tf_pub_->publish(tf);
+}
+
+}  // namespace nav2_system_tests
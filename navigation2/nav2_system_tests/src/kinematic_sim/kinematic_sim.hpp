@@ -0,0 +1,93 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KINEMATIC_SIM__KINEMATIC_SIM_HPP_
+#define KINEMATIC_SIM__KINEMATIC_SIM_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "geometry_msgs/msg/twist.hpp"
+#include "nav_msgs/msg/odometry.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "rosgraph_msgs/msg/clock.hpp"
+#include "tf2_msgs/msg/tf_message.hpp"
+
+namespace nav2_system_tests
+{
+
+// A robot without a body or sensors that moves as cmd_vel says, for system tests that don't
+// need Gazebo. It owns the time: it publishes /clock, with the odometry and the odom to base
+// transform (and map to odom, in place of localization) for each step, so a stack on
+// use_sim_time runs as fast as the steps come.
+//
+// The steps come at real_time_factor times real time, or as fast as they can with 0. With
+// lockstep, each control_period of sim time also waits, up to lockstep_timeout of real time,
+// for the controller's command for it, so a loaded machine slows the run down rather than
+// changing how it goes.
+class KinematicSim : public rclcpp::Node
+{
+public:
+  KinematicSim();
+  ~KinematicSim();
+
+private:
+  void run();
+  void step(double dt);
+  void publish();
+  bool waitForCommand();
+
+  void onCmdVel(const geometry_msgs::msg::Twist::SharedPtr msg);
+
+  rclcpp::Publisher<rosgraph_msgs::msg::Clock>::SharedPtr clock_pub_;
+  rclcpp::Publisher<nav_msgs::msg::Odometry>::SharedPtr odom_pub_;
+  rclcpp::Publisher<tf2_msgs::msg::TFMessage>::SharedPtr tf_pub_;
+  rclcpp::Subscription<geometry_msgs::msg::Twist>::SharedPtr cmd_vel_sub_;
+
+  double step_;
+  double real_time_factor_;
+  bool lockstep_;
+  double control_period_;
+  std::chrono::nanoseconds lockstep_timeout_;
+  double cmd_vel_timeout_;
+  bool publish_map_transform_;
+  std::string global_frame_;
+  std::string odom_frame_;
+  std::string base_frame_;
+  double initial_x_, initial_y_, initial_yaw_;  ///< where odom is on the map
+
+  // The state, in the odom frame, and the time, in nanoseconds from the start
+  double x_{0.0}, y_{0.0}, yaw_{0.0};
+  geometry_msgs::msg::Twist twist_;
+  int64_t time_{0};
+
+  // The last command and when it came, in sim time; commands_ counts them for lockstep
+  std::mutex cmd_mutex_;
+  std::condition_variable cmd_cv_;
+  geometry_msgs::msg::Twist cmd_;
+  int64_t cmd_time_{0};
+  uint64_t commands_{0};
+
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
+
+}  // namespace nav2_system_tests
+
+#endif  // KINEMATIC_SIM__KINEMATIC_SIM_HPP_
@@ -0,0 +1,359 @@
+#! /usr/bin/env python3
+# Copyright 2018 Intel Corporation.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Measures the latency from a NavigateToPose goal to the first velocity command, and from an
+# obstacle appearing in the scan to the robot reacting to it.
+#
+# Each goal is timed at the hops visible from outside: the goal accepted by the bt_navigator,
+# the first plan published by the planner and the first moving command on cmd_vel. The stages
+# inside the nodes come from the metrics they export: the BT tick, the planner's costmap fetch
+# and plan, the world model serving the costmap and the DWB cycle. While the robot drives to
+# the last goal, a phantom obstacle is put in front of it in the scan, and the time until it
+# shows up in the local costmap and until the command slows down is measured.
+#
+# With -o, every sample is also written to a CSV file, one source,stage,statistic,value row
+# each.
+
+import argparse
+import math
+import sys
+import time
+
+from diagnostic_msgs.msg import DiagnosticArray
+from geometry_msgs.msg import Pose
+from geometry_msgs.msg import PoseStamped
+from geometry_msgs.msg import PoseWithCovarianceStamped
+from geometry_msgs.msg import Twist
+from lifecycle_msgs.srv import GetState
+from nav2_msgs.action import NavigateToPose
+from nav2_msgs.msg import Costmap
+from nav_msgs.msg import Path
+import rclpy
+from rclpy.action import ActionClient
+from rclpy.node import Node
+from rosgraph_msgs.msg import Clock
+from sensor_msgs.msg import LaserScan
+
+# The metrics of the stages between the goal and the command, as the nodes export them
+STAGE_METRICS = [
+    'bt.tick',
+    'navfn.get_costmap',
+    'world_model.get_costmap',
+    'navfn.make_plan',
+    'dwb.compute_velocity_commands',
+    'dwb_controller.cycle_lateness',
+    'local_costmap.update_map',
+]
+
+LETHAL_OBSTACLE = 254
+
+
+def quantile(samples, q):
+    ordered = sorted(samples)
+    return ordered[min(len(ordered) - 1, int(q * len(ordered)))]
+
+
+class Results:
+    """Logs the measurements, and writes them to a CSV file if given one."""
+
+    def __init__(self, logger, filename):
+        self.logger = logger
+        self.file = None
+        if filename:
+            self.file = open(filename, 'w')
+            self.file.write('source,stage,statistic,value\n')
+
+    def add(self, source, stage, statistic, value):
+        if self.file:
+            self.file.write('%s,%s,%s,%f\n' % (source, stage, statistic, value))
+            self.file.flush()
+
+    def summarize(self, source, stage, samples_ms):
+        if not samples_ms:
+            self.logger.warn('%s: no samples' % stage)
+            return
+        self.logger.info('%s: n=%d min=%.1f p50=%.1f p90=%.1f max=%.1f ms' % (
+            stage, len(samples_ms), min(samples_ms), quantile(samples_ms, 0.5),
+            quantile(samples_ms, 0.9), max(samples_ms)))
+        for sample in samples_ms:
+            self.add(source, stage, 'sample_ms', sample)
+
+
+class LatencyTester(Node):
+
+    def __init__(self):
+        super().__init__('nav2_latency_tester')
+        self.initial_pose_pub = self.create_publisher(PoseWithCovarianceStamped,
+                                                      '/initialpose')
+        self.scan_pub = self.create_publisher(LaserScan, '/scan')
+        self.navigate_client = ActionClient(self, NavigateToPose, 'NavigateToPose')
+
+        self.create_subscription(PoseWithCovarianceStamped, '/amcl_pose', self.poseCallback)
+        self.create_subscription(Path, '/plan', self.planCallback)
+        self.create_subscription(Twist, '/cmd_vel', self.cmdVelCallback)
+        self.create_subscription(Costmap, '/local_costmap/costmap_raw', self.costmapCallback)
+        self.create_subscription(DiagnosticArray, '/metrics', self.metricsCallback)
+        self.create_subscription(Clock, '/clock', self.clockCallback)
+
+        self.current_pose = None
+        self.clock = None
+        self.first_plan_time = None
+        self.first_command_time = None
+        self.last_command = None
+        self.lethal_cells = 0
+        self.lethal_cells_time = None
+        self.goal_start = None
+        self.goal_accepted = None
+
+        # Per metric, the (count, mean, p90, max) of each exported interval
+        self.metrics = {name: [] for name in STAGE_METRICS}
+
+    def poseCallback(self, msg):
+        self.current_pose = msg.pose.pose
+
+    def clockCallback(self, msg):
+        self.clock = msg.clock
+
+    def planCallback(self, msg):
+        if self.goal_start is not None and self.first_plan_time is None:
+            self.first_plan_time = time.monotonic()
+
+    def cmdVelCallback(self, msg):
+        now = time.monotonic()
+        moving = abs(msg.linear.x) > 1e-3 or abs(msg.angular.z) > 1e-3
+        if self.goal_start is not None and self.first_command_time is None and moving:
+            self.first_command_time = now
+        self.last_command = (now, msg.linear.x)
+
+    def costmapCallback(self, msg):
+        lethal_cells = sum(1 for cost in msg.data if cost == LETHAL_OBSTACLE)
+        if lethal_cells != self.lethal_cells:
+            self.lethal_cells = lethal_cells
+            self.lethal_cells_time = time.monotonic()
+
+    def metricsCallback(self, msg):
+        for status in msg.status:
+            if status.name not in self.metrics:
+                continue
+            values = {kv.key: float(kv.value) for kv in status.values}
+            if values.get('count', 0) > 0:
+                self.metrics[status.name].append(
+                    (values['count'], values['mean'], values['p90'], values['max']))
+
+    def spinFor(self, seconds, until=None):
+        deadline = time.monotonic() + seconds
+        while time.monotonic() < deadline:
+            rclpy.spin_once(self, timeout_sec=0.01)
+            if until is not None and until():
+                return True
+        return False
+
+    def waitForNodeActive(self, node):
+        state_client = self.create_client(GetState, '/' + node + '/get_state')
+        while not state_client.wait_for_service(timeout_sec=1.0):
+            self.get_logger().info(node + ' state service not available, waiting...')
+        state = 'UNKNOWN'
+        while state != 'active':
+            future = state_client.call_async(GetState.Request())
+            rclpy.spin_until_future_complete(self, future)
+            if future.result() is not None:
+                state = future.result().current_state.label
+            if state != 'active':
+                time.sleep(1)
+
+    def setInitialPose(self, x, y, retries=10):
+        msg = PoseWithCovarianceStamped()
+        msg.header.frame_id = 'map'
+        msg.pose.pose.position.x = x
+        msg.pose.pose.position.y = y
+        msg.pose.pose.orientation.w = 1.0
+        for _ in range(retries):
+            self.initial_pose_pub.publish(msg)
+            if self.spinFor(1.0, lambda: self.current_pose is not None):
+                return True
+        return False
+
+    def sendGoal(self, x, y):
+        """Send a goal and time it up to the first command; the goal handle, or None."""
+        goal = NavigateToPose.Goal()
+        goal.pose = PoseStamped()
+        goal.pose.header.frame_id = 'map'
+        goal.pose.pose = Pose()
+        goal.pose.pose.position.x = x
+        goal.pose.pose.position.y = y
+        goal.pose.pose.orientation.w = 1.0
+
+        self.first_plan_time = None
+        self.first_command_time = None
+        self.goal_start = time.monotonic()
+        future = self.navigate_client.send_goal_async(goal)
+        rclpy.spin_until_future_complete(self, future)
+        self.goal_accepted = time.monotonic()
+        goal_handle = future.result()
+        if goal_handle is None or not goal_handle.accepted:
+            self.get_logger().error('Goal to (%.2f, %.2f) was rejected' % (x, y))
+            return None
+        self.spinFor(10.0, lambda: self.first_command_time is not None)
+        return goal_handle
+
+    def waitForResult(self, goal_handle, timeout):
+        future = goal_handle.get_result_async()
+        rclpy.spin_until_future_complete(self, future, timeout_sec=timeout)
+        self.goal_start = None
+        if not future.done():
+            self.cancel(goal_handle)
+            return False
+        return True
+
+    def cancel(self, goal_handle):
+        future = goal_handle.cancel_goal_async()
+        rclpy.spin_until_future_complete(self, future, timeout_sec=5.0)
+        self.goal_start = None
+
+    def publishPhantomObstacle(self, distance):
+        """A scan of the robot's lidar with a wall at distance across its front."""
+        scan = LaserScan()
+        scan.header.frame_id = 'base_scan'
+        if self.clock is not None:
+            scan.header.stamp = self.clock
+        scan.angle_min = 0.0
+        scan.angle_max = 6.28
+        scan.angle_increment = 6.28 / 359
+        scan.range_min = 0.12
+        scan.range_max = 3.5
+        for i in range(360):
+            angle = scan.angle_min + i * scan.angle_increment
+            in_front = min(angle, 2 * math.pi - angle) < math.radians(30)
+            scan.ranges.append(distance / math.cos(angle) if in_front else float('inf'))
+        self.scan_pub.publish(scan)
+
+    def measureObstacleReaction(self, timeout=3.0):
+        """The seconds until a phantom obstacle is in the local costmap and until the
+        command slows down for it, each None if it did not happen."""
+        # Let the robot get up to speed first
+        self.spinFor(2.0)
+        if self.last_command is None or self.last_command[1] < 0.05:
+            self.get_logger().warn('The robot is not driving forward; no obstacle reaction')
+            return None, None
+        cruising = self.last_command[1]
+        lethal_before = self.lethal_cells
+
+        # Keep the obstacle in the scan, as the real scans clear it again
+        start = time.monotonic()
+        costmap_reaction = None
+        command_reaction = None
+        next_scan = start
+        while time.monotonic() - start < timeout and command_reaction is None:
+            if time.monotonic() >= next_scan:
+                self.publishPhantomObstacle(0.5)
+                next_scan += 0.05
+            rclpy.spin_once(self, timeout_sec=0.005)
+            if (costmap_reaction is None and self.lethal_cells > lethal_before and
+                    self.lethal_cells_time >= start):
+                costmap_reaction = self.lethal_cells_time - start
+            if self.last_command[0] >= start and self.last_command[1] < 0.5 * cruising:
+                command_reaction = self.last_command[0] - start
+        return costmap_reaction, command_reaction
+
+
+def main(argv=sys.argv[1:]):
+    parser = argparse.ArgumentParser()
+    parser.add_argument('-o', '--output', help='CSV file for the samples')
+    parser.add_argument('-r', '--rounds', type=int, default=2,
+                        help='times to go around the goals')
+    args = parser.parse_args(argv)
+
+    rclpy.init()
+    tester = LatencyTester()
+    results = Results(tester.get_logger(), args.output)
+
+    tester.waitForNodeActive('amcl')
+    if not tester.setInitialPose(-2.0, -0.5):
+        tester.get_logger().error('No amcl_pose after setting the initial pose')
+        exit(1)
+    tester.waitForNodeActive('bt_navigator')
+    tester.navigate_client.wait_for_server()
+
+    # Goals across the map, the last of them the one the obstacle is put in the way to
+    goals = [(0.94, -0.55), (1.7, 0.5), (0.02, 1.74), (-2.0, -0.5)]
+    accept_ms = []
+    plan_ms = []
+    command_ms = []
+    total_ms = []
+    costmap_reaction_ms = []
+    command_reaction_ms = []
+    for _ in range(args.rounds):
+        for i, (x, y) in enumerate(goals):
+            goal_handle = tester.sendGoal(x, y)
+            if goal_handle is None:
+                continue
+            accept_ms.append(1e3 * (tester.goal_accepted - tester.goal_start))
+            if tester.first_plan_time is not None:
+                plan_ms.append(1e3 * (tester.first_plan_time - tester.goal_accepted))
+            if tester.first_command_time is not None:
+                if tester.first_plan_time is not None:
+                    command_ms.append(1e3 * (tester.first_command_time - tester.first_plan_time))
+                total_ms.append(1e3 * (tester.first_command_time - tester.goal_start))
+            else:
+                tester.get_logger().warn('No command for the goal to (%.2f, %.2f)' % (x, y))
+
+            if i == len(goals) - 1:
+                costmap_reaction, command_reaction = tester.measureObstacleReaction()
+                if costmap_reaction is not None:
+                    costmap_reaction_ms.append(1e3 * costmap_reaction)
+                if command_reaction is not None:
+                    command_reaction_ms.append(1e3 * command_reaction)
+                # The obstacle is gone from the next real scan, so the goal carries on
+            tester.waitForResult(goal_handle, 60.0)
+            tester.spinFor(1.0)
+
+    # Let the last interval of the metrics come in
+    tester.spinFor(2.0)
+
+    tester.get_logger().info('Goal to command, end to end:')
+    results.summarize('end_to_end', 'goal_accepted', accept_ms)
+    results.summarize('end_to_end', 'first_plan', plan_ms)
+    results.summarize('end_to_end', 'first_command', command_ms)
+    results.summarize('end_to_end', 'total', total_ms)
+
+    tester.get_logger().info('Obstacle reaction:')
+    results.summarize('end_to_end', 'scan_to_costmap', costmap_reaction_ms)
+    results.summarize('end_to_end', 'scan_to_command', command_reaction_ms)
+
+    tester.get_logger().info('Stages, from the metrics:')
+    for name in STAGE_METRICS:
+        intervals = tester.metrics[name]
+        if not intervals:
+            tester.get_logger().warn('%s: no samples' % name)
+            continue
+        count = sum(interval[0] for interval in intervals)
+        mean = sum(interval[0] * interval[1] for interval in intervals) / count
+        worst_p90 = max(interval[2] for interval in intervals)
+        worst = max(interval[3] for interval in intervals)
+        tester.get_logger().info('%s: n=%d mean=%.2f worst p90=%.2f max=%.2f ms' % (
+            name, count, mean, worst_p90, worst))
+        results.add('metrics', name, 'count', count)
+        results.add('metrics', name, 'mean_ms', mean)
+        results.add('metrics', name, 'worst_p90_ms', worst_p90)
+        results.add('metrics', name, 'max_ms', worst)
+
+    if not total_ms:
+        tester.get_logger().error('Test FAILED: no goal led to a command')
+        exit(1)
+    tester.get_logger().info('Test PASSED')
+
+
+if __name__ == '__main__':
+    main()
@@ -12,6 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License. Reserved.
 
+#include <sys/resource.h>
+
+#include <cmath>
 #include <string>
 #include <random>
 #include <tuple>
@@ -25,6 +28,7 @@
 #include "geometry_msgs/msg/twist.hpp"
 #include "nav2_util/map_loader/map_loader.hpp"
 #include "nav2_msgs/msg/costmap_meta_data.hpp"
+#include "nav2_navfn_planner/navfn.hpp"
 
 using namespace std::chrono_literals;
 using namespace std::chrono;  // NOLINT
@@ -168,6 +172,20 @@ void PlannerTester::startCostmapServer()
 }
 
 void PlannerTester::loadDefaultMap()
+{
+  std::string file_path = "";
+  char const * path = getenv("TEST_MAP");
+  if (path == NULL) {
+    throw std::runtime_error("Path to map image file"
+            " has not been specified in environment variable `TEST_MAP`.");
+  } else {
+    file_path = std::string(path);
+  }
+
+  loadMap(file_path);
+}
+
+void PlannerTester::loadMap(const std::string & file_path)
 {
   // Specs for the default map
   double resolution = 1.0;
@@ -186,15 +204,6 @@ void PlannerTester::loadDefaultMap()
 
   MapMode mode = TRINARY;
 
-  std::string file_path = "";
-  char const * path = getenv("TEST_MAP");
-  if (path == NULL) {
-    throw std::runtime_error("Path to map image file"
-            " has not been specified in environment variable `TEST_MAP`.");
-  } else {
-    file_path = std::string(path);
-  }
-
   RCLCPP_INFO(this->get_logger(), "Loading map with file_path: %s", file_path.c_str());
 
   try {
@@ -237,6 +246,20 @@ void PlannerTester::loadSimpleCostmap(const TestCostmap & testCostmapType)
   using_fake_costmap_ = true;
 }
 
+void PlannerTester::loadSyntheticCostmap(const nav2_util::SyntheticMapSpec & spec)
+{
+  if (costmap_set_) {
+    RCLCPP_DEBUG(this->get_logger(), "Setting a new synthetic costmap");
+  }
+
+  costmap_ = std::make_unique<Costmap>(this);
+
+  costmap_->set_synthetic_costmap(spec);
+
+  costmap_set_ = true;
+  using_fake_costmap_ = true;
+}
+
 void PlannerTester::setCostmap()
 {
   if (!map_set_) {
@@ -374,6 +397,85 @@ bool PlannerTester::defaultPlannerRandomTests(
   return true;
 }
 
+void PlannerTester::writeBenchmarkHeader(std::ostream & csv)
+{
+  csv << "map,query,algorithm,start_x,start_y,goal_x,goal_y,success,latency_us,"
+    "expanded_cells,path_poses,path_length,max_rss_kb\n";
+}
+
+void PlannerTester::benchmarkPlanner(
+  const std::string & map_name,
+  const unsigned int number_queries,
+  std::ostream & csv,
+  const unsigned int seed)
+{
+  if (!costmap_set_) {
+    RCLCPP_ERROR(this->get_logger(), "Costmap must be set before benchmarking the planner");
+    return;
+  }
+
+  nav2_msgs::msg::Costmap costmap = costmap_->get_costmap(nav2_msgs::msg::CostmapMetaData());
+  const int size_x = costmap.metadata.size_x;
+  const int size_y = costmap.metadata.size_y;
+  const double resolution = costmap.metadata.resolution;
+
+  // The same queries for every run, NavFn blocks the outer ring of cells
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<> distribution_x(1, size_x - 2);
+  std::uniform_int_distribution<> distribution_y(1, size_y - 2);
+
+  auto generate_random = [&]() mutable -> std::pair<int, int> {
+      bool point_is_free = false;
+      int x, y;
+      while (!point_is_free) {
+        x = distribution_x(generator);
+        y = distribution_y(generator);
+        point_is_free = costmap_->is_free(x, y);
+      }
+      return std::make_pair(x, y);
+    };
+
+  nav2_navfn_planner::NavFn planner(size_x, size_y);
+
+  for (unsigned int query = 0; query < number_queries; ++query) {
+    auto start = generate_random();
+    auto goal = generate_random();
+
+    for (bool use_astar : {false, true}) {
+      // The planner node plans from the goal to the robot, so does the benchmark
+      int map_start[2] = {start.first, start.second};
+      int map_goal[2] = {goal.first, goal.second};
+
+      auto begin = steady_clock::now();
+      planner.setNavArr(size_x, size_y);
+      planner.setCostmap(&costmap.data[0], true, true);
+      planner.setStart(map_goal);
+      planner.setGoal(map_start);
+      bool found = use_astar ? planner.calcNavFnAstar() : planner.calcNavFnDijkstra(true);
+      auto latency = duration_cast<microseconds>(steady_clock::now() - begin);
+
+      float * x = planner.getPathX();
+      float * y = planner.getPathY();
+      int len = found ? planner.getPathLen() : 0;
+      double path_length = 0.0;
+      for (int i = 1; i < len; ++i) {
+        path_length += std::hypot(x[i] - x[i - 1], y[i] - y[i - 1]) * resolution;
+      }
+
+      struct rusage usage;
+      getrusage(RUSAGE_SELF, &usage);
+
+      csv << map_name << ',' << query << ',' << (use_astar ? "astar" : "dijkstra") << ',' <<
+        start.first << ',' << start.second << ',' << goal.first << ',' << goal.second << ',' <<
+        found << ',' << latency.count() << ',' << planner.getExpandedCells() << ',' << len <<
+        ',' << path_length << ',' << usage.ru_maxrss << '\n';
+    }
+  }
+
+  RCLCPP_INFO(this->get_logger(), "Benchmarked %u queries on %s", number_queries,
+    map_name.c_str());
+}
+
 bool PlannerTester::plannerTest(
   const geometry_msgs::msg::Point & robot_position,
   const ComputePathToPoseCommand & goal,
@@ -17,6 +17,7 @@
 
 #include <gtest/gtest.h>
 #include <memory>
+#include <ostream>
 #include <string>
 #include <thread>
 
@@ -59,9 +60,15 @@ public:
   // Loads the provided map and and generates a costmap from it.
   void loadDefaultMap();
 
+  // Loads the map image at file_path and generates a costmap from it.
+  void loadMap(const std::string & file_path);
+
   // Alternatively, use a preloaded 10x10 costmap
   void loadSimpleCostmap(const nav2_util::TestCostmap & testCostmapType);
 
+  // Or a generated costmap of any size
+  void loadSyntheticCostmap(const nav2_util::SyntheticMapSpec & spec);
+
   // Runs a single test with default poses depending on the loaded map
   // Success criteria is a collision free path and a deviation to a
   // reference path smaller than a tolerance.
@@ -74,6 +81,18 @@ public:
     const unsigned int number_tests,
     const float acceptable_fail_ratio);
 
+  // Writes the column names of the benchmark results
+  static void writeBenchmarkHeader(std::ostream & csv);
+
+  // Plans between random free cells of the loaded costmap with NavFn directly, without the
+  // planner node and its action round trip, in both Dijkstra and A* mode. Appends a line
+  // per query and mode to csv, the same queries for a given seed.
+  void benchmarkPlanner(
+    const std::string & map_name,
+    const unsigned int number_queries,
+    std::ostream & csv,
+    const unsigned int seed = 1);
+
 private:
   bool is_active_;
   bool map_set_;
@@ -0,0 +1,96 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License. Reserved.
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "planner_tester.hpp"
+
+using nav2_system_tests::PlannerTester;
+using nav2_util::TestCostmap;
+
+// rclcpp::init can only be called once per process, so this needs to be a global variable
+class RclCppFixture
+{
+public:
+  RclCppFixture() {rclcpp::init(0, nullptr);}
+  ~RclCppFixture() {rclcpp::shutdown();}
+};
+
+RclCppFixture g_rclcppfixture;
+
+// Runs NavFn over the test costmaps, the map in TEST_MAP, the colon separated map images
+// in BENCHMARK_MAPS and the space separated synthetic map specs in BENCHMARK_SYNTHETIC_MAPS,
+// writing the results to BENCHMARK_OUTPUT or planner_benchmark.csv
+TEST_F(PlannerTester, benchmarkNavFn)
+{
+  char const * output = getenv("BENCHMARK_OUTPUT");
+  std::ofstream csv(output ? output : "planner_benchmark.csv");
+  ASSERT_TRUE(csv.is_open());
+  writeBenchmarkHeader(csv);
+
+  std::vector<std::pair<TestCostmap, std::string>> costmaps = {
+    {TestCostmap::open_space, "open_space"},
+    {TestCostmap::bounded, "bounded"},
+    {TestCostmap::top_left_obstacle, "top_left_obstacle"},
+    {TestCostmap::bottom_left_obstacle, "bottom_left_obstacle"},
+    {TestCostmap::maze1, "maze1"},
+    {TestCostmap::maze2, "maze2"}
+  };
+
+  for (auto costmap : costmaps) {
+    loadSimpleCostmap(costmap.first);
+    benchmarkPlanner(costmap.second, 20, csv);
+  }
+
+  std::vector<std::string> maps;
+  if (char const * path = getenv("TEST_MAP")) {
+    maps.push_back(path);
+  }
+  if (char const * paths = getenv("BENCHMARK_MAPS")) {
+    std::stringstream stream(paths);
+    std::string path;
+    while (std::getline(stream, path, ':')) {
+      if (!path.empty()) {
+        maps.push_back(path);
+      }
+    }
+  }
+
+  for (auto map : maps) {
+    loadMap(map);
+    benchmarkPlanner(map, 100, csv);
+  }
+
+  if (char const * specs = getenv("BENCHMARK_SYNTHETIC_MAPS")) {
+    std::stringstream stream(specs);
+    std::string text;
+    while (stream >> text) {
+      nav2_util::SyntheticMapSpec spec;
+      std::string error;
+      ASSERT_TRUE(nav2_util::parse_synthetic_map_spec(text, spec, error)) << text << ": " <<
+        error;
+      loadSyntheticCostmap(spec);
+      benchmarkPlanner(text, 20, csv);
+    }
+  }
+
+  EXPECT_TRUE(csv.good());
+}
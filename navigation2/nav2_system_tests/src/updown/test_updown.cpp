@@ -12,12 +12,35 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+// Brings the nav2 system up and down. With -c, it goes through that many cycles of bringup and
+// reset before the final shutdown, timing each transition and tracking the memory of the other
+// processes of the launch. With -o, the measurements are also written to a CSV file, one
+// cycle,measure,subject,value row each:
+//
+//   bringup_seconds, reset_seconds, shutdown_seconds     of the system
+//   configure_seconds, activate_seconds                  of each node, as the manager timed them
+//   rss_kb                                               of each process, after each bringup
+//   rss_growth_kb                                        of each process, from the first bringup
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
 #include <random>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "builtin_interfaces/msg/time.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "nav2_lifecycle_manager/lifecycle_manager_client.hpp"
+#include "nav2_msgs/msg/startup_report.hpp"
 #include "rcutils/cmdline_parser.h"
 
 using namespace std::chrono_literals;
@@ -29,11 +52,153 @@ struct xytheta
   double theta;
 };
 
+namespace
+{
+
+rclcpp::Logger logger()
+{
+  return rclcpp::get_logger("test_updown");
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Logs the measurements, and writes them to a CSV file if given one
+class Measurements
+{
+public:
+  explicit Measurements(const char * filename)
+  {
+    if (filename && *filename) {
+      file_.open(filename);
+      file_ << "cycle,measure,subject,value\n";
+    }
+  }
+
+  void add(int cycle, const std::string & measure, const std::string & subject, double value)
+  {
+    RCLCPP_INFO(logger(), "Cycle %d: %s of %s: %.3f", cycle, measure.c_str(), subject.c_str(),
+      value);
+    if (file_.is_open()) {
+      file_ << cycle << ',' << measure << ',' << subject << ',' << value << '\n';
+      file_.flush();
+    }
+  }
+
+private:
+  std::ofstream file_;
+};
+
+// The resident memory (kB) of the other processes the launch started, which are the nodes, by
+// the name of their executable
+std::map<std::string, long> launchMemory()
+{
+  std::map<std::string, long> memory;
+  DIR * proc = opendir("/proc");
+  if (!proc) {
+    return memory;
+  }
+  std::string parent = std::to_string(getppid());
+  std::string self = std::to_string(getpid());
+  while (dirent * entry = readdir(proc)) {
+    std::string pid = entry->d_name;
+    if (pid.find_first_not_of("0123456789") != std::string::npos || pid == self) {
+      continue;
+    }
+
+    // The parent is the fourth field, after the name in parentheses
+    std::ifstream stat("/proc/" + pid + "/stat");
+    std::string line;
+    std::getline(stat, line);
+    size_t name_end = line.rfind(')');
+    if (name_end == std::string::npos) {
+      continue;
+    }
+    std::istringstream fields(line.substr(name_end + 1));
+    std::string state, ppid;
+    fields >> state >> ppid;
+    if (ppid != parent) {
+      continue;
+    }
+
+    std::ifstream cmdline("/proc/" + pid + "/cmdline");
+    std::string executable;
+    std::getline(cmdline, executable, '\0');
+    executable = executable.substr(executable.rfind('/') + 1);
+
+    std::ifstream status("/proc/" + pid + "/status");
+    while (std::getline(status, line)) {
+      if (line.compare(0, 6, "VmRSS:") == 0) {
+        memory[executable] += std::atol(line.c_str() + 6);
+      }
+    }
+  }
+  closedir(proc);
+  return memory;
+}
+
+// Follows the startup reports of the lifecycle manager, which it publishes once all of the
+// nodes are active
+class StartupReports
+{
+public:
+  StartupReports()
+  : node_(rclcpp::Node::make_shared("test_updown"))
+  {
+    subscription_ = node_->create_subscription<nav2_msgs::msg::StartupReport>(
+      "lifecycle_manager/startup_report",
+      rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable(),
+      [this](nav2_msgs::msg::StartupReport::SharedPtr report) {latest_ = report;});
+  }
+
+  // Take in the report of an earlier bringup, if there is one, so that it is not mistaken for
+  // the next one
+  void skipLatest()
+  {
+    rclcpp::spin_some(node_);
+    if (latest_) {
+      last_stamp_ = latest_->header.stamp;
+    }
+  }
+
+  // The report of the bringup since skipLatest(), or null if none arrives
+  nav2_msgs::msg::StartupReport::SharedPtr next()
+  {
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while (rclcpp::ok() && std::chrono::steady_clock::now() < deadline) {
+      rclcpp::spin_some(node_);
+      if (latest_ && (latest_->header.stamp.sec != last_stamp_.sec ||
+        latest_->header.stamp.nanosec != last_stamp_.nanosec))
+      {
+        return latest_;
+      }
+      std::this_thread::sleep_for(10ms);
+    }
+    return nullptr;
+  }
+
+private:
+  rclcpp::Node::SharedPtr node_;
+  rclcpp::Subscription<nav2_msgs::msg::StartupReport>::SharedPtr subscription_;
+  nav2_msgs::msg::StartupReport::SharedPtr latest_;
+  builtin_interfaces::msg::Time last_stamp_;
+};
+
+}  // namespace
+
 int main(int argc, char ** argv)
 {
   rclcpp::init(argc, argv);
   nav2_lifecycle_manager::LifecycleManagerClient client;
 
+  // Parse the command line options
+  char * nav_type_arg = rcutils_cli_get_option(argv, argv + argc, "-t");
+  char * cycles_arg = rcutils_cli_get_option(argv, argv + argc, "-c");
+  int cycles = cycles_arg ? std::max(std::atoi(cycles_arg), 1) : 1;
+  Measurements measurements(rcutils_cli_get_option(argv, argv + argc, "-o"));
+
   // Create a set of target poses across the map
   std::vector<xytheta> target_poses;
   target_poses.push_back({-2.0, -0.5, 0});
@@ -44,21 +209,59 @@ int main(int argc, char ** argv)
 
   xytheta & initial_pose = target_poses[0];
 
-  // Wait for a few seconds to let all of the nodes come up
-  std::this_thread::sleep_for(5s);
+  // No need to wait for the nodes to come up: the lifecycle manager waits for each of their
+  // services, and the client for the manager's
+  StartupReports reports;
+  std::map<std::string, long> first_memory;
+  for (int cycle = 1; cycle <= cycles; cycle++) {
+    // Start the nav2 system, bringing it to the ACTIVE state
+    reports.skipLatest();
+    auto start = std::chrono::steady_clock::now();
+    if (!client.startup()) {
+      RCLCPP_ERROR(logger(), "Bringup failed!");
+      rclcpp::shutdown();
+      return 1;
+    }
+    measurements.add(cycle, "bringup_seconds", "system", secondsSince(start));
 
-  // Start the nav2 system, bringing it to the ACTIVE state
-  client.startup();
+    auto report = reports.next();
+    if (report) {
+      for (auto & phase : report->phases) {
+        if (phase.phase == "configure" || phase.phase == "activate") {
+          measurements.add(cycle, phase.phase + "_seconds", phase.node, phase.seconds);
+        }
+      }
+    } else {
+      RCLCPP_WARN(logger(), "No startup report from the lifecycle manager");
+    }
 
-  // Set the robot's starting pose (approximately where it comes up in gazebo)
-  client.set_initial_pose(initial_pose.x, initial_pose.y, initial_pose.theta);
+    auto memory = launchMemory();
+    for (auto & process : memory) {
+      measurements.add(cycle, "rss_kb", process.first, process.second);
+    }
+    if (cycle == 1) {
+      first_memory = memory;
+    } else if (cycle == cycles) {
+      for (auto & process : memory) {
+        measurements.add(cycle, "rss_growth_kb", process.first,
+          process.second - first_memory[process.first]);
+      }
+    }
 
-  // Wait for a couple secs to make sure the nodes have processed all discovery
-  // info before starting
-  std::this_thread::sleep_for(2s);
+    // Set the robot's starting pose (approximately where it comes up in gazebo)
+    client.set_initial_pose(initial_pose.x, initial_pose.y, initial_pose.theta);
+
+    if (cycle < cycles) {
+      start = std::chrono::steady_clock::now();
+      if (!client.reset()) {
+        RCLCPP_ERROR(logger(), "Reset failed!");
+        rclcpp::shutdown();
+        return 1;
+      }
+      measurements.add(cycle, "reset_seconds", "system", secondsSince(start));
+    }
+  }
 
-  // Parse the command line options
-  char * nav_type_arg = rcutils_cli_get_option(argv, argv + argc, "-t");
   if (nav_type_arg != nullptr) {
     std::string nav_type(nav_type_arg);
 
@@ -68,7 +271,7 @@ int main(int argc, char ** argv)
       for (std::vector<xytheta>::size_type i = 1; i < target_poses.size(); i++) {
         auto pose = target_poses[i];
         if (!client.navigate_to_pose(pose.x, pose.y, pose.theta)) {
-          RCLCPP_ERROR(rclcpp::get_logger("test_updown"), "Navigation failed!");
+          RCLCPP_ERROR(logger(), "Navigation failed!");
           break;
         }
       }
@@ -92,18 +295,20 @@ int main(int argc, char ** argv)
         // Grab the pose for that index and start the navigation
         auto pose = target_poses[next_index];
         if (!client.navigate_to_pose(pose.x, pose.y, pose.theta)) {
-          RCLCPP_ERROR(rclcpp::get_logger("test_updown"), "Navigation failed!");
+          RCLCPP_ERROR(logger(), "Navigation failed!");
           break;
         }
       }
     } else {
-      RCLCPP_ERROR(rclcpp::get_logger("test_updown"),
-        "Unrecognized test type: %s, running simple up/down test\n", nav_type);
+      RCLCPP_ERROR(logger(), "Unrecognized test type: %s, running simple up/down test\n",
+        nav_type.c_str());
     }
   }
 
   // Shut down the nav2 system, bringing it to the FINALIZED state
+  auto start = std::chrono::steady_clock::now();
   client.shutdown();
+  measurements.add(cycles, "shutdown_seconds", "system", secondsSince(start));
 
   rclcpp::shutdown();
   return 0;
@@ -27,6 +27,9 @@ def generate_launch_description():
     world = launch.substitutions.LaunchConfiguration('world')
     urdf = launch.substitutions.LaunchConfiguration('urdf')
 
+    cycles = launch.substitutions.LaunchConfiguration('cycles')
+    csv = launch.substitutions.LaunchConfiguration('csv')
+
     params_file = launch.substitutions.LaunchConfiguration(
         'params',
         default=[launch.substitutions.ThisLaunchFileDir(), '/nav2_params.yaml'])
@@ -43,6 +46,16 @@ def generate_launch_description():
                        '/../../urdf/turtlebot3_burger.urdf'],
         description='Full path to model file to load')
 
+    declare_cycles_cmd = launch.actions.DeclareLaunchArgument(
+        'cycles',
+        default_value='1',
+        description='Number of bringup and reset cycles before the shutdown')
+
+    declare_csv_cmd = launch.actions.DeclareLaunchArgument(
+        'csv',
+        default_value='',
+        description='File to write the bringup and shutdown timings to, as CSV')
+
     launch_dir = os.path.join(
         get_package_share_directory('nav2_bringup'), 'launch')
 
@@ -124,6 +137,7 @@ def generate_launch_description():
             os.path.join(
                 get_package_prefix('nav2_system_tests'),
                 'lib/nav2_system_tests/test_updown'),
+            '-c', cycles, '-o', csv,
             '--ros-args', ['__params:=', params_file]],
         cwd=[launch_dir], output='screen')
 
@@ -138,6 +152,8 @@ def generate_launch_description():
 
     ld.add_action(declare_world_cmd)
     ld.add_action(declare_urdf_cmd)
+    ld.add_action(declare_cycles_cmd)
+    ld.add_action(declare_csv_cmd)
     ld.add_action(start_controller_cmd)
     ld.add_action(start_gazebo_cmd)
     ld.add_action(start_robot_state_publisher_cmd)
@@ -0,0 +1,158 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__BLACK_BOX_HPP_
+#define NAV2_UTIL__BLACK_BOX_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rmw/rmw.h"
+#include "rosidl_typesupport_cpp/message_type_support.hpp"
+
+namespace nav2_util
+{
+
+/**
+ * @class BlackBox
+ * @brief Records the latest messages of a process into a ring in shared memory, for the
+ * benchmark harnesses to replay what led up to a crash or a bad run
+ *
+ * Recording does nothing until open() is called, which LifecycleNode does when a node's
+ * black_box_size parameter is positive. A record takes its space with an atomic add and is
+ * copied in without a lock or an allocation, and once the ring is full the oldest records are
+ * overwritten. Messages are kept CDR-serialized, as rosbag2 keeps them.
+ *
+ * The segment lives in /dev/shm, so it outlives a crash of the process, and
+ * `black_box save <segment> <file>` saves it to a file, while the process runs or after it
+ * died. It is removed when the process exits normally. Given a crash file, the process also
+ * writes the segment there itself on SIGSEGV, SIGBUS, SIGFPE or SIGABRT.
+ */
+class BlackBox
+{
+public:
+  static const size_t MAX_CHANNELS = 64;
+
+  /// @brief The black box of the process
+  static BlackBox & global();
+
+  BlackBox() = default;
+  ~BlackBox();
+  BlackBox(const BlackBox &) = delete;
+  BlackBox & operator=(const BlackBox &) = delete;
+
+  /**
+   * @brief Create the shared memory segment and start recording into it
+   * @param name The name of the segment, e.g. nav2_black_box_amcl
+   * @param size The size of the segment in bytes
+   * @param crash_file Where to write the segment on a crash, or empty to leave it in /dev/shm
+   * @return Whether it is recording, which it already is if opened before
+   */
+  bool open(const std::string & name, size_t size, const std::string & crash_file = "");
+
+  bool isOpen() const {return segment_.load(std::memory_order_acquire) != nullptr;}
+
+  /// @brief The channel to record topic on, registered the first time, or -1 past MAX_CHANNELS
+  /// @param type The message type, e.g. sensor_msgs/msg/LaserScan
+  int channel(const std::string & topic, const std::string & type);
+
+  /// @brief Record a serialized message; does nothing unless open
+  void record(int channel, const uint8_t * data, size_t size);
+
+  /// @brief Serialize msg and record it; does nothing unless open
+  template<typename MessageT>
+  void record(int channel, const MessageT & msg)
+  {
+    if (channel >= 0 && isOpen()) {
+      recordMessage(channel, &msg,
+        rosidl_typesupport_cpp::get_message_type_support_handle<MessageT>());
+    }
+  }
+
+  /// @brief Save what the ring holds, oldest first, to a file that BlackBoxLog reads
+  bool save(const std::string & filename) const;
+
+  /**
+   * @brief Save a segment of another process to a file that BlackBoxLog reads
+   * @param source The name of the segment in /dev/shm, or a file its process wrote on a crash
+   */
+  static bool saveSegment(const std::string & source, const std::string & filename);
+
+private:
+  void recordMessage(
+    int channel, const void * msg, const rosidl_message_type_support_t * type_support);
+  void copyIn(uint64_t position, const void * data, size_t size);
+  static void onCrash(int signal);
+
+  std::atomic<uint8_t *> segment_{nullptr};
+  size_t size_{0};
+  std::string name_;
+
+  mutable std::mutex channels_mutex_;
+  std::vector<std::pair<std::string, std::string>> channels_;
+};
+
+/**
+ * @class BlackBoxLog
+ * @brief A black box saved to a file, for the replay tools
+ */
+class BlackBoxLog
+{
+public:
+  struct Channel
+  {
+    std::string topic;
+    std::string type;
+  };
+
+  struct Record
+  {
+    uint32_t channel;
+    int64_t stamp;  // nanoseconds since the epoch, when it was recorded
+    std::vector<uint8_t> data;
+  };
+
+  /// @brief Read a file written by BlackBox::save(); false if it is not one
+  bool read(const std::string & filename);
+
+  const std::vector<Channel> & channels() const {return channels_;}
+
+  /// @brief The records of every channel, oldest first
+  const std::vector<Record> & records() const {return records_;}
+
+  /// @brief The channel of topic, or -1 if nothing was recorded on it
+  int find(const std::string & topic) const;
+
+  template<typename MessageT>
+  static bool deserialize(const Record & record, MessageT & msg)
+  {
+    return deserialize(record, &msg,
+             rosidl_typesupport_cpp::get_message_type_support_handle<MessageT>());
+  }
+
+private:
+  static bool deserialize(
+    const Record & record, void * msg, const rosidl_message_type_support_t * type_support);
+
+  std::vector<Channel> channels_;
+  std::vector<Record> records_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__BLACK_BOX_HPP_
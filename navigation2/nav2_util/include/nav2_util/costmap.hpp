@@ -22,6 +22,7 @@
 #include "nav2_msgs/msg/costmap.hpp"
 #include "nav2_msgs/msg/costmap_meta_data.hpp"
 #include "nav_msgs/msg/occupancy_grid.hpp"
+#include "nav2_util/synthetic_costmap.hpp"
 
 namespace nav2_util
 {
@@ -53,6 +54,9 @@ public:
 
   void set_test_costmap(const TestCostmap & testCostmapType);
 
+  // A generated map of any size, see synthetic_costmap.hpp
+  void set_synthetic_costmap(const SyntheticMapSpec & spec);
+
   nav2_msgs::msg::Costmap get_costmap(const nav2_msgs::msg::CostmapMetaData & specifications);
 
   nav2_msgs::msg::CostmapMetaData get_properties() {return costmap_properties_;}
@@ -0,0 +1,60 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__DISTANCE_FIELD_HPP_
+#define NAV2_UTIL__DISTANCE_FIELD_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "nav_msgs/msg/occupancy_grid.hpp"
+
+namespace nav2_util
+{
+
+/// @brief The exact Euclidean distance from each cell of a map to its nearest obstacle, for
+/// AMCL's likelihood field and the inflation of the static map alike
+struct DistanceField
+{
+  unsigned int width{0};
+  unsigned int height{0};
+  /// @brief The squared distance in cells, row-major as the map's cells; more than
+  /// width^2 + height^2 when the map has no obstacle
+  std::vector<uint32_t> sq_distances;
+
+  uint32_t getSqDistance(unsigned int x, unsigned int y) const
+  {
+    return sq_distances[static_cast<size_t>(y) * width + x];
+  }
+};
+
+/**
+ * @brief The distance field of map, with the cells of at least obstacle_value as obstacles
+ *
+ * A separable transform, a column pass then a row pass, each split over threads.
+ */
+std::shared_ptr<DistanceField> computeDistanceField(
+  const nav_msgs::msg::OccupancyGrid & map, int8_t obstacle_value, int threads = 1);
+
+/**
+ * @brief computeDistanceField() done once for the nodes of the process that ask for the field
+ * of the same cells and obstacle_value while one of them holds it, through SharedMapRegistry
+ */
+std::shared_ptr<const DistanceField> sharedDistanceField(
+  const nav_msgs::msg::OccupancyGrid & map, int8_t obstacle_value, int threads = 1);
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__DISTANCE_FIELD_HPP_
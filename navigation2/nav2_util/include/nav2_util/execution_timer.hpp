@@ -17,6 +17,8 @@
 
 #include <chrono>
 
+#include "nav2_util/metrics.hpp"
+
 namespace nav2_util
 {
 
@@ -33,6 +35,13 @@ public:
   /// @brief Call just after the code you want to measure
   void end() {end_ = Clock::now();}
 
+  /// @brief end(), then record the measured time into a histogram
+  void end(LatencyHistogram & histogram)
+  {
+    end();
+    histogram.record(elapsed_time());
+  }
+
   /// @brief Extract the measured time as an integral std::chrono::duration object
   nanoseconds elapsed_time() {return end_ - start_;}
 
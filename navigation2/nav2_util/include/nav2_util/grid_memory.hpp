@@ -0,0 +1,81 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__GRID_MEMORY_HPP_
+#define NAV2_UTIL__GRID_MEMORY_HPP_
+
+// Also included from C, by AMCL's map library
+
+#ifdef __cplusplus
+
+#include <cstddef>
+
+namespace nav2_util
+{
+
+enum class HugePages
+{
+  off,          // the heap, as new and malloc would
+  transparent,  // mapped 2 MB aligned and madvise()d for the kernel's transparent huge pages
+  reserved      // MAP_HUGETLB pages from vm.nr_hugepages, else as transparent
+};
+
+/**
+ * @brief Zeroed memory for a grid, to be released with free_grid()
+ *
+ * Grids of 2 MB and more are backed by huge pages as set_grid_huge_pages() allows, which
+ * takes most of the TLB misses out of random access across them. Their pages are left
+ * untouched, so on a multi-socket machine each lands on the node of the thread that first
+ * writes it.
+ * @throw std::bad_alloc when there is no memory
+ */
+void * allocate_grid(size_t bytes);
+
+template<typename T>
+T * allocate_grid_of(size_t count)
+{
+  return static_cast<T *>(allocate_grid(count * sizeof(T)));
+}
+
+/**
+ * @brief Release memory from allocate_grid(), or nothing for nullptr
+ */
+void free_grid(void * grid);
+
+/**
+ * @brief Set how later grids are allocated
+ *
+ * The environment variable NAV2_HUGE_PAGES, off, transparent or reserved, gives the mode
+ * until this is called; it is transparent without it.
+ */
+void set_grid_huge_pages(HugePages mode);
+
+HugePages get_grid_huge_pages();
+
+}  // namespace nav2_util
+
+extern "C" {
+#else
+#include <stddef.h>
+#endif
+
+// allocate_grid() and free_grid() for C, with NULL for no memory
+void * nav2_util_allocate_grid(size_t bytes);
+void nav2_util_free_grid(void * grid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // NAV2_UTIL__GRID_MEMORY_HPP_
@@ -15,11 +15,18 @@
 #ifndef NAV2_UTIL__LIFECYCLE_NODE_HPP_
 #define NAV2_UTIL__LIFECYCLE_NODE_HPP_
 
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
+#include "nav2_msgs/msg/startup_phase.hpp"
+#include "nav2_msgs/srv/get_startup_report.hpp"
+#include "nav2_util/execution_timer.hpp"
 #include "nav2_util/lifecycle_helper_interface.hpp"
+#include "nav2_util/metrics_exporter.hpp"
 #include "rclcpp_lifecycle/lifecycle_node.hpp"
 #include "rclcpp/rclcpp.hpp"
 
@@ -113,6 +120,21 @@ public:
     declare_parameter(descriptor.name, default_value, descriptor);
   }
 
+  // Startup report: how long bringing the node up took. on_configure and on_activate are timed
+  // when the node makes the transition, and a node can add the steps of its own that are worth
+  // knowing about. The report is served by the node's get_startup_report service, and starts
+  // over every time the node is configured.
+
+  // Record that phase took the time measured by timer
+  void record_startup_phase(const std::string & phase, ExecutionTimer & timer);
+  void record_startup_phase(const std::string & phase, double seconds);
+
+  // Include the phases of a helper node, such as a costmap, which the node transitions itself
+  void add_startup_child(std::shared_ptr<LifecycleNode> child);
+
+  // The phases of the node, then those of its helper nodes
+  std::vector<nav2_msgs::msg::StartupPhase> get_startup_phases();
+
 protected:
   // Whether or not to create a local rclcpp::Node which can be used for ROS2 classes that don't
   // yet support lifecycle nodes
@@ -124,6 +146,21 @@ protected:
   // When creating a local node, this class will launch a separate thread created to spin the node
   std::unique_ptr<std::thread> rclcpp_thread_;
   rclcpp::executors::SingleThreadedExecutor rclcpp_exec_;
+
+private:
+  // Time a transition into the startup report
+  CallbackReturn timed_transition(
+    const std::string & phase, const std::function<CallbackReturn()> & transition);
+
+  void clear_startup_phases();
+
+  // Exports the process's metrics while metrics_period is positive
+  std::unique_ptr<MetricsExporter> metrics_exporter_;
+
+  std::mutex startup_mutex_;
+  std::vector<nav2_msgs::msg::StartupPhase> startup_phases_;
+  std::vector<std::weak_ptr<LifecycleNode>> startup_children_;
+  rclcpp::Service<nav2_msgs::srv::GetStartupReport>::SharedPtr startup_report_service_;
 };
 
 }  // namespace nav2_util
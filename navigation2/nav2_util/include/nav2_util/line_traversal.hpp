@@ -0,0 +1,210 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__LINE_TRAVERSAL_HPP_
+#define NAV2_UTIL__LINE_TRAVERSAL_HPP_
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <type_traits>
+#include <utility>
+
+namespace nav2_util
+{
+
+/**
+ * @brief The cell a line walk is on
+ *
+ * The offset is the cell's index in a row-major grid, kept up to date from the strides the
+ * walk was given, so visitors reading a flat array need no multiply per cell. Axes with a
+ * stride of 0 only move their coordinate.
+ */
+template<int N>
+struct LineCell
+{
+  int coord[N];
+  unsigned int offset;
+};
+
+namespace detail
+{
+
+// A visitor returning void never stops the walk; one returning bool stops it with false
+template<class Visit, class Cell>
+inline bool visitCell(Visit & visit, const Cell & cell, std::true_type /*returns void*/)
+{
+  visit(cell);
+  return true;
+}
+
+template<class Visit, class Cell>
+inline bool visitCell(Visit & visit, const Cell & cell, std::false_type /*returns void*/)
+{
+  return static_cast<bool>(visit(cell));
+}
+
+template<class Visit, class Cell>
+inline bool visitCell(Visit & visit, const Cell & cell)
+{
+  return visitCell(visit, cell,
+           std::is_void<decltype(visit(std::declval<const Cell &>()))>());
+}
+
+}  // namespace detail
+
+/**
+ * @brief The number of steps along the major axis of a line of the given length that stay
+ * within max_length, as Costmap2D and VoxelGrid have always clipped their rays
+ */
+template<int N>
+inline unsigned int lineStepsWithin(
+  const int (&delta)[N], double length, unsigned int max_length = UINT_MAX)
+{
+  unsigned int abs_major = 0;
+  for (int i = 0; i < N; ++i) {
+    abs_major = std::max(abs_major, static_cast<unsigned int>(std::abs(delta[i])));
+  }
+  if (max_length == UINT_MAX || length == 0.0) {
+    return abs_major;
+  }
+  double scale = std::min(1.0, max_length / length);
+  return static_cast<unsigned int>(scale * abs_major);
+}
+
+/**
+ * @brief Walk the cells of a line with Bresenham's algorithm, calling visit on each
+ *
+ * The walk starts at cell and moves delta cells along each axis, visiting max_steps + 1 cells
+ * at most, the first and the last included. The major axis steps every cell; each other axis
+ * carries a fixed-point error in units of 1 / |delta major|, starting at one half, and steps
+ * when it carries over. The inner loop is integer adds and compares only, and gives the same
+ * cells as the Bresenham walks it replaces in Costmap2D, VoxelGrid and LineIterator.
+ *
+ * visit takes a const LineCell<N> & and is inlined into the loop. It may return void, or a
+ * bool that stops the walk early when false.
+ *
+ * @return False if visit stopped the walk
+ */
+template<int N, class Visit>
+inline bool walkLine(
+  LineCell<N> cell, const int (&delta)[N], const int (&stride)[N],
+  unsigned int max_steps, Visit && visit)
+{
+  // the axes in slots, the major axis first, so it can step unconditionally
+  int axis[N];
+  unsigned int abs_d[N];
+  int step[N];
+  int step_offset[N];
+  int error[N];
+  int major = 0;
+  for (int i = 0; i < N; ++i) {
+    if (std::abs(delta[i]) > std::abs(delta[major])) {
+      major = i;
+    }
+  }
+  for (int i = 0, slot = 1; i < N; ++i) {
+    axis[i == major ? 0 : slot++] = i;
+  }
+  for (int s = 0; s < N; ++s) {
+    int a = axis[s];
+    abs_d[s] = std::abs(delta[a]);
+    step[s] = delta[a] > 0 ? 1 : -1;
+    step_offset[s] = step[s] * stride[a];
+  }
+  unsigned int abs_da = abs_d[0];
+  for (int s = 1; s < N; ++s) {
+    error[s] = abs_da / 2;
+  }
+
+  unsigned int end = std::min(max_steps, abs_da);
+  for (unsigned int k = 0; k < end; ++k) {
+    if (!detail::visitCell(visit, cell)) {
+      return false;
+    }
+    cell.coord[axis[0]] += step[0];
+    cell.offset += step_offset[0];
+    for (int s = 1; s < N; ++s) {
+      error[s] += abs_d[s];
+      if (static_cast<unsigned int>(error[s]) >= abs_da) {
+        cell.coord[axis[s]] += step[s];
+        cell.offset += step_offset[s];
+        error[s] -= abs_da;
+      }
+    }
+  }
+  return detail::visitCell(visit, cell);
+}
+
+/**
+ * @brief Visit the cells from (x0, y0) to (x1, y1) by their coordinates, as visit(x, y)
+ * @return False if visit returned false to stop early
+ */
+template<class Visit>
+inline bool traceCells(int x0, int y0, int x1, int y1, Visit && visit)
+{
+  LineCell<2> cell{{x0, y0}, 0};
+  const int delta[2] = {x1 - x0, y1 - y0};
+  const int stride[2] = {0, 0};
+  return walkLine(cell, delta, stride, UINT_MAX,
+           [&visit](const LineCell<2> & c) {return visit(c.coord[0], c.coord[1]);});
+}
+
+/**
+ * @brief Visit the cells from (x0, y0) to (x1, y1) of a row-major grid size_x cells wide by
+ * their offsets, as visit(offset), stopping after max_length cells of length
+ * @return False if visit returned false to stop early
+ */
+template<class Visit>
+inline bool traceOffsets(
+  unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1,
+  unsigned int size_x, unsigned int max_length, Visit && visit)
+{
+  LineCell<2> cell{{static_cast<int>(x0), static_cast<int>(y0)}, y0 * size_x + x0};
+  const int delta[2] = {static_cast<int>(x1 - x0), static_cast<int>(y1 - y0)};
+  const int stride[2] = {1, static_cast<int>(size_x)};
+  return walkLine(cell, delta, stride,
+           lineStepsWithin(delta, std::hypot(delta[0], delta[1]), max_length),
+           [&visit](const LineCell<2> & c) {return visit(c.offset);});
+}
+
+/**
+ * @brief Visit the cells of many rays from one origin (x0, y0), as traceOffsets() would one
+ * ray at a time
+ *
+ * [first, last) are the ray ends, anything with x and y members. The origin's offset is worked
+ * out once for all of them, and the rays are walked back to back in one tight loop, so
+ * callers can gather the ends of a whole scan before tracing any. A visitor returning false
+ * ends the ray it is on; the next ray still runs.
+ */
+template<class Iterator, class Visit>
+inline void traceOffsetsFrom(
+  unsigned int x0, unsigned int y0, Iterator first, Iterator last,
+  unsigned int size_x, unsigned int max_length, Visit && visit)
+{
+  const LineCell<2> origin{{static_cast<int>(x0), static_cast<int>(y0)}, y0 * size_x + x0};
+  const int stride[2] = {1, static_cast<int>(size_x)};
+  auto at = [&visit](const LineCell<2> & c) {return visit(c.offset);};
+  for (; first != last; ++first) {
+    const int delta[2] = {static_cast<int>(first->x) - origin.coord[0],
+      static_cast<int>(first->y) - origin.coord[1]};
+    walkLine(origin, delta, stride,
+      lineStepsWithin(delta, std::hypot(delta[0], delta[1]), max_length), at);
+  }
+}
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__LINE_TRAVERSAL_HPP_
@@ -0,0 +1,138 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__LOOP_RATE_HPP_
+#define NAV2_UTIL__LOOP_RATE_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "rclcpp/rclcpp.hpp"
+
+namespace nav2_util
+{
+
+/**
+ * @brief The time the loops of a node keep: steady time, or the time /clock gives once the
+ * node's clock follows it with use_sim_time
+ *
+ * A simulator publishing /clock faster than real time then runs the loops that much faster,
+ * and one that steps /clock only as fast as the stack keeps up runs them in lockstep with it.
+ * Safe to use from several threads.
+ */
+class LoopClock
+{
+public:
+  /**
+   * @param clock The node's clock, or null for steady time only
+   */
+  explicit LoopClock(rclcpp::Clock::SharedPtr clock = nullptr);
+
+  /**
+   * @brief Whether the time is that of /clock, which it is from the first message on
+   */
+  bool isSimTime() const;
+
+  /**
+   * @brief The time, of the steady clock or of /clock by isSimTime()
+   */
+  std::chrono::nanoseconds now() const;
+
+  /**
+   * @brief Sleep until now() reaches deadline
+   * @return false when woken before by interrupt() or a shutdown
+   */
+  bool sleepUntil(std::chrono::nanoseconds deadline);
+
+  /**
+   * @brief Wait for an event until now() reaches deadline
+   * @param wait Waits at most a steady duration for the event, and returns whether it came
+   * @return Whether the event came
+   *
+   * In sim time the wait is in slices of at most SIM_SLICE of steady time, so the deadline is
+   * kept within a slice of however fast /clock runs.
+   */
+  bool waitUntil(
+    std::chrono::nanoseconds deadline,
+    const std::function<bool(std::chrono::nanoseconds)> & wait);
+
+  /**
+   * @brief Wake the sleepUntil() calls in progress, for a loop to stop
+   */
+  void interrupt();
+
+  static constexpr std::chrono::nanoseconds SIM_SLICE{std::chrono::milliseconds(1)};
+
+private:
+  rclcpp::Clock::SharedPtr clock_;
+
+  std::mutex mutex_;
+  std::condition_variable ticked_;  ///< notified as /clock moves and on interrupt()
+  uint64_t interrupts_{0};
+
+  // Last, to be unregistered before the rest goes
+  rclcpp::JumpHandler::SharedPtr jump_handler_;
+};
+
+/**
+ * @brief A loop rate kept on a LoopClock, like rclcpp::Rate
+ */
+class LoopRate
+{
+public:
+  LoopRate(std::shared_ptr<LoopClock> clock, double frequency);
+
+  /**
+   * @brief Sleep out the rest of the cycle, or start the next one now if it is already over
+   * @return false when woken before by interrupt() or a shutdown
+   */
+  bool sleep();
+
+  /**
+   * @brief The end of the cycle, on the clock
+   */
+  std::chrono::nanoseconds deadline() const {return deadline_;}
+
+  /**
+   * @brief Move on to the next cycle, from the deadline if it is still ahead or now if not
+   * @return How late now is past the deadline, or 0
+   */
+  std::chrono::nanoseconds next();
+
+  std::chrono::nanoseconds period() const {return period_;}
+
+  /**
+   * @brief Change the rate, the cycle in progress ending a new period after it started
+   */
+  void setFrequency(double frequency);
+
+  const std::shared_ptr<LoopClock> & clock() const {return clock_;}
+
+private:
+  // Restart the cycle from now if the clock changed between steady and sim time
+  void followClock();
+
+  std::shared_ptr<LoopClock> clock_;
+  std::chrono::nanoseconds period_;
+  std::chrono::nanoseconds deadline_;
+  bool sim_time_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__LOOP_RATE_HPP_
@@ -0,0 +1,92 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__MAP_CACHE_HPP_
+#define NAV2_UTIL__MAP_CACHE_HPP_
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+#include "nav_msgs/msg/occupancy_grid.hpp"
+
+namespace nav2_util
+{
+
+/// @brief What a node prepared from the maps it was given, such as a distance field or a cost
+/// array, kept so that switching back to a map skips preparing it again.
+///
+/// The map server stamps each map once, when it loads it, so a map is recognized by its load
+/// time and size without looking at its cells. Safe to use from several threads.
+template<typename T>
+class MapCache
+{
+public:
+  /// @brief Keep at most capacity maps, dropping the least recently used
+  explicit MapCache(size_t capacity)
+  : capacity_(capacity) {}
+
+  /// @brief What was prepared from map, or null
+  std::shared_ptr<T> find(const nav_msgs::msg::OccupancyGrid & map)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Key key = keyOf(map);
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->first == key) {
+        entries_.splice(entries_.begin(), entries_, it);
+        return entries_.front().second;
+      }
+    }
+    return nullptr;
+  }
+
+  /// @brief Keep prepared for map, replacing what was kept for it
+  void insert(const nav_msgs::msg::OccupancyGrid & map, std::shared_ptr<T> prepared)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Key key = keyOf(map);
+    entries_.remove_if([&key](const Entry & entry) {return entry.first == key;});
+    entries_.emplace_front(key, std::move(prepared));
+    while (entries_.size() > capacity_) {
+      entries_.pop_back();
+    }
+  }
+
+  void clear()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+  }
+
+protected:
+  using Key = std::tuple<int32_t, uint32_t, uint32_t, uint32_t, float>;
+  using Entry = std::pair<Key, std::shared_ptr<T>>;
+
+  static Key keyOf(const nav_msgs::msg::OccupancyGrid & map)
+  {
+    return Key(
+      map.info.map_load_time.sec, map.info.map_load_time.nanosec,
+      map.info.width, map.info.height, map.info.resolution);
+  }
+
+  size_t capacity_;
+  std::mutex mutex_;
+  std::list<Entry> entries_;  // most recently used first
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__MAP_CACHE_HPP_
@@ -0,0 +1,264 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__METRICS_HPP_
+#define NAV2_UTIL__METRICS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nav2_util
+{
+
+/// @brief The number of shards a histogram or counter splits its counts over, each thread
+/// writing to one so threads recording at once rarely share a cache line
+static const size_t METRICS_SHARDS = 8;
+
+/// @brief The shard of the calling thread, assigned round-robin on first use
+size_t metricsShard();
+
+/**
+ * @brief The counts of a LatencyHistogram at one moment, merged over its shards
+ *
+ * Durations are in nanoseconds, with quantiles reported in seconds.
+ */
+struct HistogramSnapshot
+{
+  std::vector<uint64_t> buckets;
+  uint64_t count{0};
+  uint64_t sum_ns{0};
+  uint64_t max_ns{0};  ///< Since the histogram was created, also in a difference
+
+  /// @brief The duration no more than a fraction q of the samples took, within one bucket
+  double quantile(double q) const;
+  double mean() const {return count ? sum_ns * 1e-9 / count : 0.0;}
+
+  /// @brief The samples recorded between an earlier snapshot of the same histogram and this one
+  HistogramSnapshot since(const HistogramSnapshot & earlier) const;
+};
+
+/**
+ * @class LatencyHistogram
+ * @brief A histogram of durations with buckets whose width grows with the duration, as HDR
+ * histograms have, to keep the error of any quantile within 1/16 of its value
+ *
+ * Durations below 16ns get a bucket each. Above that every power of two is split into 16
+ * buckets, up to 2^40ns (about 18 minutes), beyond which durations land in the last bucket.
+ * Recording is a few relaxed atomic adds to the calling thread's shard, without locks.
+ */
+class LatencyHistogram
+{
+public:
+  static const int SUB_BUCKET_BITS = 4;
+  static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static const int MAX_EXPONENT = 40;
+  static const int BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+  LatencyHistogram();
+  LatencyHistogram(const LatencyHistogram &) = delete;
+  LatencyHistogram & operator=(const LatencyHistogram &) = delete;
+
+  void record(std::chrono::nanoseconds duration);
+  void recordSeconds(double seconds)
+  {
+    record(std::chrono::nanoseconds(static_cast<int64_t>(seconds * 1e9)));
+  }
+
+  HistogramSnapshot snapshot() const;
+
+  static int bucketOf(uint64_t ns);
+  /// @brief The smallest duration in a bucket, and one past its largest
+  static uint64_t bucketLow(int bucket);
+  static uint64_t bucketHigh(int bucket);
+
+private:
+  struct Shard
+  {
+    std::atomic<uint64_t> buckets[BUCKET_COUNT];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum_ns;
+    std::atomic<uint64_t> max_ns;
+    char padding[64];  ///< Keeps the next shard's counts off this one's last cache line
+  };
+  std::unique_ptr<Shard[]> shards_;
+};
+
+/**
+ * @class Counter
+ * @brief A count that only goes up, such as of dropped messages, sharded like LatencyHistogram
+ */
+class Counter
+{
+public:
+  Counter();
+  Counter(const Counter &) = delete;
+  Counter & operator=(const Counter &) = delete;
+
+  void increment(uint64_t n = 1)
+  {
+    shards_[metricsShard()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+  uint64_t value() const;
+
+private:
+  struct Shard
+  {
+    std::atomic<uint64_t> value;
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+  };
+  std::unique_ptr<Shard[]> shards_;
+};
+
+/**
+ * @class Gauge
+ * @brief A value that is set rather than accumulated, such as a queue depth
+ */
+class Gauge
+{
+public:
+  Gauge() = default;
+  Gauge(const Gauge &) = delete;
+  Gauge & operator=(const Gauge &) = delete;
+
+  void set(double value) {value_.store(value, std::memory_order_relaxed);}
+  void add(double delta);
+  double value() const {return value_.load(std::memory_order_relaxed);}
+
+private:
+  std::atomic<double> value_{0.0};
+};
+
+/**
+ * @class ScopedTimer
+ * @brief Records the time from its construction to its destruction into a histogram
+ */
+class ScopedTimer
+{
+public:
+  explicit ScopedTimer(LatencyHistogram & histogram)
+  : histogram_(histogram), start_(std::chrono::steady_clock::now())
+  {
+  }
+  ~ScopedTimer()
+  {
+    histogram_.record(std::chrono::steady_clock::now() - start_);
+  }
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer & operator=(const ScopedTimer &) = delete;
+
+private:
+  LatencyHistogram & histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * @class MetricsRegistry
+ * @brief The histograms, counters and gauges of a process by name
+ *
+ * Looking a metric up takes a lock, so callers keep the reference, which stays valid for the
+ * life of the process. Names are dotted, e.g. amcl.sensor_update, and the first description
+ * given for a name is kept.
+ */
+class MetricsRegistry
+{
+public:
+  /// @brief The registry of the process
+  static MetricsRegistry & global();
+
+  LatencyHistogram & histogram(const std::string & name, const std::string & description = "");
+  Counter & counter(const std::string & name, const std::string & description = "");
+  Gauge & gauge(const std::string & name, const std::string & description = "");
+
+  template<typename MetricT>
+  struct Entry
+  {
+    std::string name;
+    std::string description;
+    const MetricT * metric;
+  };
+
+  /// @brief The metrics registered so far, sorted by name
+  std::vector<Entry<LatencyHistogram>> histograms() const;
+  std::vector<Entry<Counter>> counters() const;
+  std::vector<Entry<Gauge>> gauges() const;
+
+private:
+  template<typename MetricT>
+  struct Named
+  {
+    std::string description;
+    std::unique_ptr<MetricT> metric;
+  };
+
+  template<typename MetricT>
+  static MetricT & findOrAdd(
+    std::map<std::string, Named<MetricT>> & metrics,
+    const std::string & name, const std::string & description);
+  template<typename MetricT>
+  static std::vector<Entry<MetricT>> list(const std::map<std::string, Named<MetricT>> & metrics);
+
+  mutable std::mutex mutex_;
+  std::map<std::string, Named<LatencyHistogram>> histograms_;
+  std::map<std::string, Named<Counter>> counters_;
+  std::map<std::string, Named<Gauge>> gauges_;
+};
+
+/// @brief The name of a metric as Prometheus allows, with every other character replaced by _
+std::string prometheusName(const std::string & name);
+
+/**
+ * @class MetricsReport
+ * @brief Renders the metrics of a registry, with the quantiles of each histogram taken over
+ * the samples recorded since the previous render
+ */
+class MetricsReport
+{
+public:
+  explicit MetricsReport(const MetricsRegistry & registry = MetricsRegistry::global())
+  : registry_(registry)
+  {
+  }
+
+  struct HistogramRow
+  {
+    std::string name;
+    std::string description;
+    HistogramSnapshot total;     ///< Every sample so far
+    HistogramSnapshot interval;  ///< The samples since the previous update()
+  };
+
+  /// @brief Snapshot every histogram, starting a new interval
+  const std::vector<HistogramRow> & update();
+
+  /// @brief The Prometheus text exposition of the rows of the last update(), with the
+  /// histograms as summaries of their interval quantiles
+  std::string prometheusText() const;
+
+  const std::vector<HistogramRow> & rows() const {return rows_;}
+
+private:
+  const MetricsRegistry & registry_;
+  std::map<std::string, HistogramSnapshot> previous_;
+  std::vector<HistogramRow> rows_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__METRICS_HPP_
@@ -0,0 +1,99 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__METRICS_EXPORTER_HPP_
+#define NAV2_UTIL__METRICS_EXPORTER_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+#include "nav2_util/metrics.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace nav2_util
+{
+
+/**
+ * @class MetricsExporter
+ * @brief Exports the process's metrics every period from a thread of its own, as a
+ * DiagnosticArray on a topic, in the Prometheus text format to a file, or both
+ *
+ * The diagnostics have a status per histogram with its rate per second and quantiles in
+ * milliseconds over the period, and one more with the counters and gauges, each with the name
+ * of the exporting node as its hardware_id. The file is replaced whole each time, for the
+ * textfile collector of the Prometheus node exporter to pick up. Every node of a process sees
+ * the same metrics, so one exporter per process is enough. The exporter keeps the gauges
+ * process.cpu_percent, of one core over the period, and process.rss_mb up to date.
+ */
+class MetricsExporter
+{
+public:
+  /**
+   * @param node_topics The node to publish with
+   * @param period Seconds between exports
+   * @param topic The topic for the diagnostics, or empty for none
+   * @param prometheus_file The file for the Prometheus text, or empty for none
+   */
+  MetricsExporter(
+    const rclcpp::node_interfaces::NodeTopicsInterface::SharedPtr node_topics,
+    double period, const std::string & topic = "metrics",
+    const std::string & prometheus_file = "");
+
+  template<typename NodeT>
+  MetricsExporter(
+    NodeT node, double period, const std::string & topic = "metrics",
+    const std::string & prometheus_file = "")
+  : MetricsExporter(node->get_node_topics_interface(), period, topic, prometheus_file)
+  {
+  }
+
+  ~MetricsExporter();
+
+  MetricsExporter(const MetricsExporter &) = delete;
+  MetricsExporter & operator=(const MetricsExporter &) = delete;
+
+  /// @brief Export now instead of waiting for the period, starting a new period
+  void exportNow();
+
+private:
+  void run();
+  void publishDiagnostics(const rclcpp::Time & stamp);
+  void writePrometheusFile();
+  void updateProcessGauges();
+
+  MetricsReport report_;
+  std::string source_;
+  Gauge & cpu_percent_;
+  Gauge & rss_mb_;
+  std::chrono::steady_clock::time_point last_export_;
+  double last_cpu_seconds_{0.0};
+  double interval_seconds_{0.0};
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr diagnostics_pub_;
+  std::string prometheus_file_;
+  std::chrono::nanoseconds period_;
+
+  std::mutex export_mutex_;  ///< Held while exporting, which exportNow() may do on any thread
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+  bool running_{true};
+  std::thread thread_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__METRICS_EXPORTER_HPP_
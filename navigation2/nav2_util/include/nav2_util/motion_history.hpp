@@ -0,0 +1,103 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__MOTION_HISTORY_HPP_
+#define NAV2_UTIL__MOTION_HISTORY_HPP_
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "nav_msgs/msg/odometry.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace nav2_util
+{
+
+/// @brief A planar pose and velocity of the robot at some time
+struct MotionSample
+{
+  double stamp{0.0};  ///< Seconds
+  double x{0.0};
+  double y{0.0};
+  double theta{0.0};
+  double v_x{0.0};  ///< Velocities in the robot frame
+  double v_y{0.0};
+  double v_theta{0.0};
+};
+
+/**
+ * @class MotionHistory
+ * @brief A fixed-size ring of the latest odometry samples, for the checks on how the robot has
+ * been moving to share instead of each keeping its own history
+ *
+ * Queries look a number of samples back and take constant time. Pushing copies a sample into
+ * a slot allocated up front, so nothing is allocated per odometry message.
+ */
+class MotionHistory
+{
+public:
+  /// @param capacity The number of samples kept, at least 3
+  explicit MotionHistory(size_t capacity = 100);
+
+  /// @brief Follow an odometry topic, pushing each message
+  template<typename NodeT>
+  void subscribe(NodeT node, const std::string & topic = "odom")
+  {
+    odom_sub_ = node->template create_subscription<nav_msgs::msg::Odometry>(topic,
+        rclcpp::SystemDefaultsQoS(),
+        [this](const nav_msgs::msg::Odometry::SharedPtr msg) {push(*msg);});
+  }
+
+  void push(const MotionSample & sample);
+  void push(const nav_msgs::msg::Odometry & odom);
+  void clear();
+
+  size_t size() const;
+  size_t capacity() const {return samples_.size();}
+
+  /// @brief Get the sample age samples before the newest one
+  /// @return False if there are not that many samples
+  bool at(size_t age, MotionSample & sample) const;
+  bool latest(MotionSample & sample) const {return at(0, sample);}
+
+  /// @brief The straight-line distance between the sample age samples back and the newest one,
+  /// or 0 if there are not that many samples
+  double displacement(size_t age) const;
+
+  /// @brief The average speed over the last age samples, from their displacement
+  double speed(size_t age) const;
+
+  /// @brief The latest change of the forward velocity, per second
+  double acceleration() const;
+
+  /// @brief The latest change of the forward acceleration, per second
+  double jerk() const;
+
+protected:
+  // Called with the mutex held
+  const MotionSample & sampleAt(size_t age) const;
+  double accelerationAt(size_t age) const;
+
+  mutable std::mutex mutex_;
+  std::vector<MotionSample> samples_;
+  size_t next_{0};   ///< Where the next sample goes
+  size_t count_{0};  ///< Samples pushed since the last clear, capped at the capacity
+
+  rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__MOTION_HISTORY_HPP_
@@ -0,0 +1,96 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__POSE_CACHE_HPP_
+#define NAV2_UTIL__POSE_CACHE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "tf2_msgs/msg/tf_message.hpp"
+#include "tf2_ros/buffer.h"
+
+namespace nav2_util
+{
+
+/**
+ * @class PoseCache
+ * @brief Keeps the latest pose of the robot in a few global frames, refreshed from tf as
+ * transforms come in, for any number of threads to read without touching the tf buffer
+ *
+ * Each time a message arrives on /tf the robot frame is looked up once per global frame,
+ * and the result is written to a slot guarded by a sequence count: readers copy the slot
+ * and retry if the writer got in the way, so they never wait on a lock.
+ */
+class PoseCache
+{
+public:
+  /**
+   * @brief Start following /tf
+   * @param node_topics The node to subscribe with
+   * @param tf_buffer A buffer kept up to date by a tf listener
+   * @param global_frames The frames to keep the robot's pose in, e.g. map and odom
+   * @param robot_frame The frame of the robot
+   */
+  PoseCache(
+    const rclcpp::node_interfaces::NodeTopicsInterface::SharedPtr node_topics,
+    tf2_ros::Buffer & tf_buffer, const std::vector<std::string> & global_frames,
+    const std::string & robot_frame = "base_link");
+
+  template<typename NodeT>
+  PoseCache(
+    NodeT node, tf2_ros::Buffer & tf_buffer, const std::vector<std::string> & global_frames,
+    const std::string & robot_frame = "base_link")
+  : PoseCache(node->get_node_topics_interface(), tf_buffer, global_frames, robot_frame)
+  {
+  }
+
+  PoseCache(const PoseCache &) = delete;
+  PoseCache & operator=(const PoseCache &) = delete;
+
+  /**
+   * @brief Get the latest pose of the robot in global_frame
+   * @return False if global_frame is not kept or no transform was found yet
+   */
+  bool getPose(geometry_msgs::msg::PoseStamped & pose, const std::string & global_frame) const;
+
+  /**
+   * @brief Look up the robot's pose in every global frame and store it, as done for each
+   * message on /tf
+   */
+  void refresh();
+
+private:
+  struct Slot
+  {
+    std::string global_frame;
+    std::atomic<uint32_t> sequence{0};  ///< Odd while the slot is being written
+    std::atomic<int64_t> stamp_ns{0};
+    std::atomic<double> values[7] = {};  ///< x, y, z, then the quaternion's x, y, z and w
+  };
+
+  tf2_ros::Buffer & tf_buffer_;
+  std::string robot_frame_;
+  std::vector<std::unique_ptr<Slot>> slots_;  ///< Fixed once constructed
+  rclcpp::Subscription<tf2_msgs::msg::TFMessage>::SharedPtr tf_sub_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__POSE_CACHE_HPP_
@@ -0,0 +1,157 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__SHARED_MAP_REGISTRY_HPP_
+#define NAV2_UTIL__SHARED_MAP_REGISTRY_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "nav_msgs/msg/occupancy_grid.hpp"
+
+namespace nav2_util
+{
+
+/// @brief A hash of a map's geometry and cells, the same for the same map however it was loaded
+inline uint64_t hashOccupancyGrid(const nav_msgs::msg::OccupancyGrid & map)
+{
+  // FNV-1a, over the cells a word at a time
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](uint64_t word) {hash = (hash ^ word) * 1099511628211ull;};
+  auto mix_double = [&mix](double value) {
+      uint64_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      mix(bits);
+    };
+  mix(map.info.width);
+  mix(map.info.height);
+  mix_double(map.info.resolution);
+  mix_double(map.info.origin.position.x);
+  mix_double(map.info.origin.position.y);
+  mix_double(map.info.origin.orientation.z);
+  mix_double(map.info.origin.orientation.w);
+
+  const size_t size = map.data.size();
+  const int8_t * data = map.data.data();
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    mix(word);
+  }
+  for (; i < size; ++i) {
+    mix(static_cast<uint8_t>(data[i]));
+  }
+  return hash;
+}
+
+/// @brief What nodes prepared from a map, such as a distance field or a cost array, shared
+/// by every node of the process that prepares the same thing from the same map.
+///
+/// Unlike MapCache, entries are found by the map's cells, since each robot's map server stamps
+/// its own copy of a map, and an entry lives only as long as some node holds it. What is shared
+/// must be treated as read-only. Preparing an entry is done once: others asking for it at the
+/// same time wait for it. Safe to use from several threads.
+template<typename T>
+class SharedMapRegistry
+{
+public:
+  /// @brief The map's hash, from hashOccupancyGrid(), and what was prepared with which
+  /// parameters, e.g. "cspace 2.0"
+  using Key = std::pair<uint64_t, std::string>;
+
+  /// @brief The registry of the process for T
+  static SharedMapRegistry & global()
+  {
+    static SharedMapRegistry registry;
+    return registry;
+  }
+
+  /// @brief What was prepared for key and is still held, or else what prepare() returns
+  std::shared_ptr<T> getOrPrepare(
+    const Key & key,
+    const std::function<std::shared_ptr<T>()> & prepare)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    Entry * entry;
+    while (true) {
+      entry = &entries_[key];
+      if (!entry->preparing) {
+        break;
+      }
+      prepared_.wait(lock);
+    }
+    if (std::shared_ptr<T> shared = entry->prepared.lock()) {
+      return shared;
+    }
+
+    entry->preparing = true;
+    lock.unlock();
+    std::shared_ptr<T> prepared;
+    try {
+      prepared = prepare();
+    } catch (...) {
+      lock.lock();
+      entries_[key].preparing = false;
+      prepared_.notify_all();
+      throw;
+    }
+    lock.lock();
+
+    // the entries of maps no one holds any more go as others come
+    for (auto it = entries_.begin(); it != entries_.end(); ) {
+      if (!it->second.preparing && it->second.prepared.expired() && it->first != key) {
+        it = entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    entries_[key] = Entry{prepared, false};
+    prepared_.notify_all();
+    return prepared;
+  }
+
+  /// @brief How many maps something is kept or being prepared for
+  size_t size()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (const auto & entry : entries_) {
+      count += entry.second.preparing || !entry.second.prepared.expired();
+    }
+    return count;
+  }
+
+protected:
+  struct Entry
+  {
+    std::weak_ptr<T> prepared;
+    bool preparing{false};
+  };
+
+  std::mutex mutex_;
+  std::condition_variable prepared_;
+  std::map<Key, Entry> entries_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__SHARED_MAP_REGISTRY_HPP_
@@ -15,9 +15,12 @@
 #ifndef NAV2_UTIL__SIMPLE_ACTION_SERVER_HPP_
 #define NAV2_UTIL__SIMPLE_ACTION_SERVER_HPP_
 
+#include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 
 #include "rclcpp/rclcpp.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
@@ -31,17 +34,24 @@ class SimpleActionServer
 public:
   typedef std::function<void ()> ExecuteCallback;
 
+  // With persistent_worker, every goal is executed on the same thread, which waits for the
+  // next one, instead of on a new thread per goal
   explicit SimpleActionServer(
     rclcpp::Node::SharedPtr node,
     const std::string & action_name,
     ExecuteCallback execute_callback,
-    bool autostart = true)
+    bool autostart = true,
+    bool persistent_worker = false)
   : node_(node), action_name_(action_name), execute_callback_(execute_callback)
   {
     if (autostart) {
       server_active_ = true;
     }
 
+    if (persistent_worker) {
+      worker_thread_ = std::thread([this]() {work();});
+    }
+
     auto handle_goal =
       [this](const rclcpp_action::GoalUUID &, std::shared_ptr<const typename ActionT::Goal>)
       {
@@ -61,6 +71,8 @@ public:
         std::lock_guard<std::recursive_mutex> lock(update_mutex_);
         // TODO(orduno) could goal handle be aborted (and on a terminal state) before reaching here?
         debug_msg("Received request for goal cancellation");
+        // The handle is marked canceling right after this returns
+        notify_request();
         return rclcpp_action::CancelResponse::ACCEPT;
       };
 
@@ -85,6 +97,7 @@ public:
           debug_msg("Setting flag so the action server can grab the preempt request.");
           preempt_requested_ = true;
           pending_handle_ = handle;
+          notify_request();
         } else {
           if (is_active(pending_handle_)) {
             // Shouldn't reach a state with a pending goal but no current one.
@@ -95,10 +108,19 @@ public:
             preempt_requested_ = false;
           }
 
-          debug_msg("Starting a thread to process the goals");
-
           current_handle_ = handle;
-          std::thread{execute_callback_}.detach();
+
+          if (worker_thread_.joinable()) {
+            debug_msg("Handing the goal to the worker thread");
+            {
+              std::lock_guard<std::mutex> worker_lock(worker_mutex_);
+              goal_ready_ = true;
+            }
+            worker_cv_.notify_one();
+          } else {
+            debug_msg("Starting a thread to process the goals");
+            std::thread{execute_callback_}.detach();
+          }
         }
       };
 
@@ -110,6 +132,19 @@ public:
       handle_accepted);
   }
 
+  // Waits for the goal being executed by the worker thread to return
+  ~SimpleActionServer()
+  {
+    if (worker_thread_.joinable()) {
+      {
+        std::lock_guard<std::mutex> worker_lock(worker_mutex_);
+        stop_worker_ = true;
+      }
+      worker_cv_.notify_one();
+      worker_thread_.join();
+    }
+  }
+
   void activate()
   {
     std::lock_guard<std::recursive_mutex> lock(update_mutex_);
@@ -132,6 +167,27 @@ public:
     terminate_goals();
   }
 
+  // Set a callback for the execute callback to learn of a preempt or cancel request as it
+  // arrives, rather than the next time it polls for one. Called from the node's executor.
+  void set_request_callback(std::function<void()> request_callback)
+  {
+    std::lock_guard<std::recursive_mutex> lock(update_mutex_);
+    request_callback_ = request_callback;
+  }
+
+  // Sleep until a preempt or cancel request arrives or timeout passes, for an execute
+  // callback that would otherwise only see requests the next time it polls for them.
+  // Returns whether a request arrived since the last call.
+  template<typename Rep, typename Period>
+  bool wait_for_request(const std::chrono::duration<Rep, Period> & timeout)
+  {
+    std::unique_lock<std::mutex> request_lock(request_mutex_);
+    request_cv_.wait_for(request_lock, timeout, [this]() {return request_pending_;});
+    bool pending = request_pending_;
+    request_pending_ = false;
+    return pending;
+  }
+
   bool is_server_active()
   {
     std::lock_guard<std::recursive_mutex> lock(update_mutex_);
@@ -267,6 +323,19 @@ protected:
   std::string action_name_;
 
   ExecuteCallback execute_callback_;
+  std::function<void()> request_callback_;
+
+  // A preempt or cancel request arrived since the last wait_for_request
+  std::mutex request_mutex_;
+  std::condition_variable request_cv_;
+  bool request_pending_{false};
+
+  // With persistent_worker, the thread executing the goals, woken for a new goal or to stop
+  std::thread worker_thread_;
+  std::mutex worker_mutex_;
+  std::condition_variable worker_cv_;
+  bool goal_ready_{false};
+  bool stop_worker_{false};
 
   mutable std::recursive_mutex update_mutex_;
   bool server_active_{false};
@@ -276,6 +345,35 @@ protected:
 
   typename rclcpp_action::Server<ActionT>::SharedPtr action_server_;
 
+  void notify_request()
+  {
+    {
+      std::lock_guard<std::mutex> request_lock(request_mutex_);
+      request_pending_ = true;
+    }
+    request_cv_.notify_all();
+
+    if (request_callback_) {
+      request_callback_();
+    }
+  }
+
+  void work()
+  {
+    std::unique_lock<std::mutex> worker_lock(worker_mutex_);
+    while (true) {
+      worker_cv_.wait(worker_lock, [this]() {return goal_ready_ || stop_worker_;});
+      if (stop_worker_) {
+        return;
+      }
+      goal_ready_ = false;
+
+      worker_lock.unlock();
+      execute_callback_();
+      worker_lock.lock();
+    }
+  }
+
   constexpr auto empty_result() const
   {
     return std::make_shared<typename ActionT::Result>();
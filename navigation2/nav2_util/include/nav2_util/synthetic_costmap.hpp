@@ -0,0 +1,81 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__SYNTHETIC_COSTMAP_HPP_
+#define NAV2_UTIL__SYNTHETIC_COSTMAP_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nav2_util
+{
+
+enum class SyntheticStyle
+{
+  scattered,  // rectangular obstacles scattered over open space
+  corridors,  // walled rooms with doors, between a grid of corridors
+  maze        // a maze with a single path between any two of its cells
+};
+
+// What a synthetic costmap looks like; the same spec always gives the same map, whatever the
+// number of threads building it
+struct SyntheticMapSpec
+{
+  SyntheticStyle style{SyntheticStyle::scattered};
+  unsigned int size_x{100};
+  unsigned int size_y{100};
+  double resolution{0.05};
+  uint32_t seed{0};
+
+  // scattered: the fraction of the map under obstacles, and their largest side in cells
+  double density{0.1};
+  unsigned int obstacle_size{8};
+
+  // corridors and maze: the width of the passages and of the walls, in cells
+  unsigned int corridor_width{10};
+  unsigned int wall_width{2};
+
+  // inflation around lethal cells as the costmap's inflation layer does it, none at 0
+  double inflation_radius{0.0};
+  double inscribed_radius{0.0};
+  double cost_scaling_factor{10.0};
+
+  // 0 for one per core
+  unsigned int threads{0};
+};
+
+/**
+ * @brief Build a costmap, row major from the origin, of nav2_util::Costmap cost values
+ *
+ * A 10000 x 10000 map takes a second or two of a core, split between the threads, so
+ * benchmarks can make their large maps at startup instead of keeping them in the repository.
+ * @throw std::invalid_argument for a spec that describes no map
+ */
+std::vector<uint8_t> generate_synthetic_costmap(const SyntheticMapSpec & spec);
+
+/**
+ * @brief Read a spec from <style>:<size_x>x<size_y>[:<key>=<value>...]
+ *
+ * e.g. maze:4000x4000:seed=3:inflation=0.55, with the keys resolution, seed, density,
+ * obstacle, corridor, wall, inflation, inscribed, scaling and threads.
+ * @param error Set to what is wrong with the text when it can't be read
+ * @return Whether spec was read
+ */
+bool parse_synthetic_map_spec(
+  const std::string & text, SyntheticMapSpec & spec, std::string & error);
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__SYNTHETIC_COSTMAP_HPP_
@@ -0,0 +1,45 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__THREAD_UTILS_HPP_
+#define NAV2_UTIL__THREAD_UTILS_HPP_
+
+#include <string>
+#include <vector>
+
+namespace nav2_util
+{
+
+/**
+ * @brief Run the calling thread under the SCHED_FIFO real-time policy
+ *
+ * Needs CAP_SYS_NICE or an rtprio limit in limits.conf, which a robot can grant to the
+ * navigation processes alone.
+ * @param priority 1 to 99, higher preempting lower; 0 leaves the thread as it is
+ * @param error Set to why it failed when it does
+ * @return Whether the thread is running at the priority
+ */
+bool setThreadPriority(int priority, std::string & error);
+
+/**
+ * @brief Pin the calling thread to CPUs, e.g. ones isolated from the rest of the system
+ * @param cpus The CPUs' numbers; empty leaves the thread as it is
+ * @param error Set to why it failed when it does
+ * @return Whether the thread is pinned
+ */
+bool setThreadAffinity(const std::vector<int> & cpus, std::string & error);
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__THREAD_UTILS_HPP_
@@ -0,0 +1,54 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__TRACING_HPP_
+#define NAV2_UTIL__TRACING_HPP_
+
+/**
+ * Static tracepoints at the boundaries of the hot paths, in the provider "nav2".
+ *
+ * Built with NAV2_TRACING (on by default where sys/sdt.h is found), each is a USDT probe: a
+ * single nop in the code and a note in the binary naming it and where its arguments live.
+ * Nothing runs until a tracer attaches, which can be done to a running process, e.g.
+ *
+ *   perf buildid-cache --add <library> && perf probe sdt_nav2:'*'
+ *   perf record -e 'sdt_nav2:*' -e sched:sched_switch -a
+ *   bpftrace -e 'usdt:<library>:nav2:costmap_layer_update_start { ... }'
+ *   lttng enable-event --userspace-probe=sdt:<library>:nav2:dwb_compute_start ...
+ *
+ * Probes come in _start and _end pairs with the same arguments where a duration is wanted.
+ * Arguments are integers or pointers, strings being passed as const char *; they are only
+ * read by the tracer, so are not evaluated when tracing is compiled out.
+ */
+
+#ifdef NAV2_TRACING_USDT
+
+#include <sys/sdt.h>
+
+#define NAV2_TRACEPOINT(name) DTRACE_PROBE(nav2, name)
+#define NAV2_TRACEPOINT1(name, a) DTRACE_PROBE1(nav2, name, a)
+#define NAV2_TRACEPOINT2(name, a, b) DTRACE_PROBE2(nav2, name, a, b)
+#define NAV2_TRACEPOINT3(name, a, b, c) DTRACE_PROBE3(nav2, name, a, b, c)
+
+#else
+
+#define NAV2_TRACEPOINT(name) do {} while (0)
+#define NAV2_TRACEPOINT1(name, a) do {(void)sizeof(a);} while (0)
+#define NAV2_TRACEPOINT2(name, a, b) do {(void)sizeof(a); (void)sizeof(b);} while (0)
+#define NAV2_TRACEPOINT3(name, a, b, c) \
+  do {(void)sizeof(a); (void)sizeof(b); (void)sizeof(c);} while (0)
+
+#endif  // NAV2_TRACING_USDT
+
+#endif  // NAV2_UTIL__TRACING_HPP_
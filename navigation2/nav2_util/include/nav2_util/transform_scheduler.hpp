@@ -0,0 +1,177 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__TRANSFORM_SCHEDULER_HPP_
+#define NAV2_UTIL__TRANSFORM_SCHEDULER_HPP_
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "tf2/buffer_core.h"
+#include "tf2/time.h"
+#include "tf2_ros/buffer_interface.h"
+
+namespace nav2_util
+{
+
+/**
+ * @class TransformScheduler
+ * @brief Holds sensor messages until their frame can be transformed to the frames their users
+ * need, then hands them on, for every subscriber of a tf buffer at once
+ *
+ * It stands in for one tf2_ros::MessageFilter per subscription. Messages waiting on the same
+ * source and target frame share a group, and a group asks the buffer to be told when its
+ * earliest message can be transformed, with one request at a time whatever the number of
+ * messages or subscriptions in it. When the buffer answers, the group's messages are checked
+ * in stamp order up to the first that still has to wait.
+ *
+ * A message that can be transformed when scheduled is dispatched at once, on the caller's
+ * thread. The rest are dispatched on the scheduler's thread, so the tf listener only queues
+ * the buffer's answers and is never held up by a subscriber's callback.
+ */
+class TransformScheduler
+{
+public:
+  /**
+   * @brief The messages of one subscription, with the frames they must be transformed to, how
+   * many of them may wait, and what to do with those dropped
+   */
+  class Channel;
+  using ChannelPtr = std::shared_ptr<Channel>;
+
+  /**
+   * @param buffer The tf buffer, which must outlive the scheduler
+   */
+  explicit TransformScheduler(tf2::BufferCore & buffer);
+  ~TransformScheduler();
+
+  TransformScheduler(const TransformScheduler &) = delete;
+  TransformScheduler & operator=(const TransformScheduler &) = delete;
+
+  /**
+   * @brief The scheduler shared by the users of buffer in this process, made on first use
+   */
+  static std::shared_ptr<TransformScheduler> forBuffer(tf2::BufferCore & buffer);
+
+  /**
+   * @brief Add a subscription's channel
+   * @param target_frames The frames its messages must be transformable to
+   * @param queue_size How many of its messages may wait at once; the oldest is dropped for a
+   * new one beyond that
+   * @param tolerance How long after its stamp a message's transforms must reach, e.g. for the
+   * time a scan takes
+   * @param on_drop Called for each message dropped, for the queue being full or its
+   * transforms having left the buffer
+   */
+  ChannelPtr addChannel(
+    const std::vector<std::string> & target_frames, size_t queue_size,
+    tf2::Duration tolerance = tf2::Duration(0), std::function<void()> on_drop = nullptr);
+
+  /**
+   * @brief Drop a channel's waiting messages and dispatch none of its messages from now on
+   *
+   * Returns once a dispatch of its underway on the scheduler's thread is over, so what the
+   * channel's callbacks use can be destroyed after. Not to be called from a callback.
+   */
+  void removeChannel(const ChannelPtr & channel);
+
+  /**
+   * @brief Call dispatch once source_frame at stamp can be transformed to the channel's
+   * target frames
+   */
+  void schedule(
+    const ChannelPtr & channel, const std::string & source_frame, tf2::TimePoint stamp,
+    std::function<void()> dispatch);
+
+  /**
+   * @brief Call callback(message) once the message's frame at its stamp can be transformed to
+   * the channel's target frames
+   */
+  template<class MessageT, class Callback>
+  void schedule(
+    const ChannelPtr & channel, const std::shared_ptr<const MessageT> & message,
+    Callback callback)
+  {
+    schedule(channel, message->header.frame_id, tf2_ros::fromMsg(message->header.stamp),
+      [message, callback]() {callback(message);});
+  }
+
+  /// @brief The number of messages waiting for their transforms
+  size_t waiting() const;
+
+private:
+  struct Entry;
+  using EntryPtr = std::shared_ptr<Entry>;
+  using GroupKey = std::pair<std::string, std::string>;  ///< The target and source frame
+
+  struct Group
+  {
+    std::multimap<tf2::TimePoint, EntryPtr> waiting;  ///< By the time they wait for
+    tf2::TransformableRequestHandle request{0};  ///< The request outstanding, if any
+  };
+
+  using Dispatches = std::vector<EntryPtr>;
+  using Drops = std::vector<std::function<void()>>;
+
+  // Move entry through the targets it can be transformed to, and queue it for dispatch past
+  // the last, or to wait on the first it can't
+  void advance(const EntryPtr & entry, Dispatches & ready, Drops & drops);
+  void enqueue(const EntryPtr & entry, Dispatches & ready, Drops & drops);
+  // Take the group's messages that can now be transformed, dropping those at or before
+  // failed_stamp, then ask the buffer about the earliest left
+  void process(
+    const GroupKey & key, Group & group, Dispatches & ready, Drops & drops,
+    const tf2::TimePoint * failed_stamp);
+  void finish(const EntryPtr & entry);
+  void drop(const EntryPtr & entry, Drops & drops);
+  void run(const Dispatches & ready, const Drops & drops);
+
+  struct Answer
+  {
+    tf2::TransformableRequestHandle request;
+    tf2::TimePoint stamp;
+    tf2::TransformableResult result;
+  };
+
+  // Called by the buffer, with its own lock held, so it only passes the answer on
+  void onTransformable(const Answer & answer);
+  void work();
+
+  tf2::BufferCore & buffer_;
+  tf2::TransformableCallbackHandle callback_handle_;
+
+  mutable std::mutex mutex_;  ///< Guards the channels' queues and the groups
+  std::map<GroupKey, Group> groups_;
+  std::map<tf2::TransformableRequestHandle, GroupKey> requests_;
+  size_t waiting_{0};
+
+  std::mutex dispatch_mutex_;  ///< Held while the scheduler's thread dispatches
+
+  std::mutex answers_mutex_;  ///< Taken by the buffer's callback, so never held calling it
+  std::condition_variable answers_cv_;
+  std::vector<Answer> answers_;
+  bool stop_{false};
+  std::thread worker_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__TRANSFORM_SCHEDULER_HPP_
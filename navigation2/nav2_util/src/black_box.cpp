@@ -0,0 +1,497 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/black_box.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rmw/serialized_message.h"
+
+namespace nav2_util
+{
+
+// The segment is a header with the channels, an index of where the latest records start, and
+// the ring of records. A record is a RecordHeader followed by the message, padded to 8 bytes,
+// and wraps around the end of the ring. The first word of a record is set to its position
+// plus one once the rest is in, which is what a reader checks before taking it; a reader then
+// knows it was not overwritten while being copied if no writer has since taken space past a
+// ring's length after it.
+
+static const char SEGMENT_MAGIC[8] = {'N', 'A', 'V', '2', 'B', 'B', 'S', '1'};
+static const char LOG_MAGIC[8] = {'N', 'A', 'V', '2', 'B', 'B', 'L', '1'};
+static const size_t NAME_LENGTH = 112;
+
+// Bytes of ring per slot of the index: with smaller records on average, the index rather than
+// the ring limits how far back the black box goes
+static const uint64_t BYTES_PER_INDEX_SLOT = 128;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the ring is shared with other processes");
+
+struct ChannelEntry
+{
+  char topic[NAME_LENGTH];
+  char type[NAME_LENGTH];
+};
+
+struct SegmentHeader
+{
+  char magic[8];
+  uint64_t index_slots;
+  uint64_t ring_size;
+  std::atomic<uint64_t> reserved;  // bytes of the ring taken so far
+  std::atomic<uint64_t> started;   // records started so far
+  std::atomic<uint32_t> channel_count;
+  uint32_t padding;
+  ChannelEntry channels[BlackBox::MAX_CHANNELS];
+};
+
+struct RecordHeader
+{
+  uint64_t commit;
+  uint32_t channel;
+  uint32_t size;
+  int64_t stamp;
+};
+
+static std::atomic<uint64_t> * indexOf(const uint8_t * segment)
+{
+  return reinterpret_cast<std::atomic<uint64_t> *>(
+    const_cast<uint8_t *>(segment) + sizeof(SegmentHeader));
+}
+
+static uint8_t * ringOf(const uint8_t * segment)
+{
+  auto header = reinterpret_cast<const SegmentHeader *>(segment);
+  return const_cast<uint8_t *>(segment) + sizeof(SegmentHeader) +
+         header->index_slots * sizeof(uint64_t);
+}
+
+// The commit word of the record at position, which never wraps since both are 8-byte aligned
+static std::atomic<uint64_t> & commitOf(uint8_t * ring, uint64_t ring_size, uint64_t position)
+{
+  return *reinterpret_cast<std::atomic<uint64_t> *>(ring + position % ring_size);
+}
+
+static void copyOut(
+  const uint8_t * ring, uint64_t ring_size, uint64_t position, void * data, size_t size)
+{
+  const uint64_t offset = position % ring_size;
+  const size_t first = static_cast<size_t>(std::min<uint64_t>(size, ring_size - offset));
+  std::memcpy(data, ring + offset, first);
+  std::memcpy(static_cast<uint8_t *>(data) + first, ring, size - first);
+}
+
+static void setName(char (& entry)[NAME_LENGTH], const std::string & name)
+{
+  std::strncpy(entry, name.c_str(), NAME_LENGTH - 1);
+  entry[NAME_LENGTH - 1] = '\0';
+}
+
+template<typename T>
+static void writeValue(std::ofstream & out, T value)
+{
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+static bool readValue(std::ifstream & in, T & value)
+{
+  return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+static void writeString(std::ofstream & out, const std::string & value)
+{
+  writeValue<uint16_t>(out, static_cast<uint16_t>(value.size()));
+  out.write(value.data(), value.size());
+}
+
+static bool readString(std::ifstream & in, std::string & value)
+{
+  uint16_t size;
+  if (!readValue(in, size)) {
+    return false;
+  }
+  value.resize(size);
+  return static_cast<bool>(in.read(&value[0], size));
+}
+
+// Writes the records a segment still holds, oldest first, skipping those being written or
+// overwritten while it reads
+static bool writeLog(const uint8_t * segment, size_t size, const std::string & filename)
+{
+  auto header = reinterpret_cast<const SegmentHeader *>(segment);
+  if (size < sizeof(SegmentHeader) ||
+    std::memcmp(header->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0 ||
+    sizeof(SegmentHeader) + header->index_slots * sizeof(uint64_t) + header->ring_size > size)
+  {
+    return false;
+  }
+  const uint64_t ring_size = header->ring_size;
+  uint8_t * ring = ringOf(segment);
+
+  std::vector<uint64_t> positions;
+  auto index = indexOf(segment);
+  for (uint64_t slot = 0; slot < header->index_slots; ++slot) {
+    uint64_t position = index[slot].load(std::memory_order_acquire);
+    if (position > 0) {
+      positions.push_back(position - 1);
+    }
+  }
+  std::sort(positions.begin(), positions.end());
+  positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+  std::ofstream out(filename, std::ios::binary);
+  if (!out) {
+    return false;
+  }
+  out.write(LOG_MAGIC, sizeof(LOG_MAGIC));
+  const uint32_t channel_count = std::min<uint32_t>(
+    header->channel_count.load(std::memory_order_acquire), BlackBox::MAX_CHANNELS);
+  writeValue(out, channel_count);
+  for (uint32_t i = 0; i < channel_count; ++i) {
+    writeString(out, std::string(header->channels[i].topic,
+      strnlen(header->channels[i].topic, NAME_LENGTH)));
+    writeString(out, std::string(header->channels[i].type,
+      strnlen(header->channels[i].type, NAME_LENGTH)));
+  }
+
+  std::vector<uint8_t> data;
+  for (uint64_t position : positions) {
+    if (header->reserved.load(std::memory_order_acquire) > position + ring_size ||
+      commitOf(ring, ring_size, position).load(std::memory_order_acquire) != position + 1)
+    {
+      continue;
+    }
+    RecordHeader record;
+    copyOut(ring, ring_size, position, &record, sizeof(record));
+    if (record.size > ring_size / 2 || record.channel >= channel_count) {
+      continue;
+    }
+    data.resize(record.size);
+    copyOut(ring, ring_size, position + sizeof(record), data.data(), record.size);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header->reserved.load(std::memory_order_relaxed) > position + ring_size) {
+      continue;
+    }
+    writeValue(out, record.channel);
+    writeValue(out, record.size);
+    writeValue(out, record.stamp);
+    out.write(reinterpret_cast<const char *>(data.data()), data.size());
+  }
+  return static_cast<bool>(out);
+}
+
+// What the crash handler writes, set up ahead since it can't allocate
+static char crash_file[4096];
+static const uint8_t * crash_segment = nullptr;
+static size_t crash_size = 0;
+
+BlackBox &
+BlackBox::global()
+{
+  static BlackBox black_box;
+  return black_box;
+}
+
+BlackBox::~BlackBox()
+{
+  uint8_t * segment = segment_.exchange(nullptr);
+  if (segment) {
+    munmap(segment, size_);
+    shm_unlink(name_.c_str());
+  }
+}
+
+bool
+BlackBox::open(const std::string & name, size_t size, const std::string & crash_file_name)
+{
+  std::lock_guard<std::mutex> lock(channels_mutex_);
+  if (isOpen()) {
+    return true;
+  }
+  if (size < sizeof(SegmentHeader) + 4096 || crash_file_name.size() >= sizeof(crash_file)) {
+    return false;
+  }
+  const uint64_t available = size - sizeof(SegmentHeader);
+  const uint64_t index_slots = available / (BYTES_PER_INDEX_SLOT + sizeof(uint64_t));
+  const uint64_t ring_size = (available - index_slots * sizeof(uint64_t)) & ~uint64_t(7);
+
+  std::string shm_name = name.empty() || name[0] != '/' ? "/" + name : name;
+  int fd = shm_open(shm_name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+  if (fd < 0) {
+    return false;
+  }
+  if (ftruncate(fd, size) != 0) {
+    ::close(fd);
+    shm_unlink(shm_name.c_str());
+    return false;
+  }
+  void * memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (memory == MAP_FAILED) {
+    shm_unlink(shm_name.c_str());
+    return false;
+  }
+
+  // the truncated segment is all zeros, which is an empty ring and index
+  auto header = new (memory) SegmentHeader();
+  header->index_slots = index_slots;
+  header->ring_size = ring_size;
+  for (size_t i = 0; i < channels_.size(); ++i) {
+    setName(header->channels[i].topic, channels_[i].first);
+    setName(header->channels[i].type, channels_[i].second);
+  }
+  header->channel_count.store(static_cast<uint32_t>(channels_.size()), std::memory_order_release);
+  std::memcpy(header->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+
+  size_ = size;
+  name_ = shm_name;
+  if (!crash_file_name.empty()) {
+    std::strcpy(crash_file, crash_file_name.c_str());
+    crash_segment = static_cast<uint8_t *>(memory);
+    crash_size = size;
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = &BlackBox::onCrash;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    for (int signal : {SIGSEGV, SIGBUS, SIGFPE, SIGABRT}) {
+      sigaction(signal, &action, nullptr);
+    }
+  }
+  segment_.store(static_cast<uint8_t *>(memory), std::memory_order_release);
+  return true;
+}
+
+void
+BlackBox::onCrash(int signal)
+{
+  // only what is async-signal-safe, and then the default action with the handler reset
+  int fd = ::open(crash_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    size_t written = 0;
+    while (written < crash_size) {
+      ssize_t result = ::write(fd, crash_segment + written, crash_size - written);
+      if (result <= 0) {
+        break;
+      }
+      written += result;
+    }
+    ::close(fd);
+  }
+  raise(signal);
+}
+
+int
+BlackBox::channel(const std::string & topic, const std::string & type)
+{
+  std::lock_guard<std::mutex> lock(channels_mutex_);
+  for (size_t i = 0; i < channels_.size(); ++i) {
+    if (channels_[i].first == topic) {
+      return static_cast<int>(i);
+    }
+  }
+  if (channels_.size() >= MAX_CHANNELS) {
+    return -1;
+  }
+  channels_.emplace_back(topic, type);
+
+  uint8_t * segment = segment_.load(std::memory_order_acquire);
+  if (segment) {
+    auto header = reinterpret_cast<SegmentHeader *>(segment);
+    setName(header->channels[channels_.size() - 1].topic, topic);
+    setName(header->channels[channels_.size() - 1].type, type);
+    header->channel_count.store(static_cast<uint32_t>(channels_.size()),
+      std::memory_order_release);
+  }
+  return static_cast<int>(channels_.size() - 1);
+}
+
+void
+BlackBox::copyIn(uint64_t position, const void * data, size_t size)
+{
+  uint8_t * segment = segment_.load(std::memory_order_relaxed);
+  const uint64_t ring_size = reinterpret_cast<SegmentHeader *>(segment)->ring_size;
+  uint8_t * ring = ringOf(segment);
+  const uint64_t offset = position % ring_size;
+  const size_t first = static_cast<size_t>(std::min<uint64_t>(size, ring_size - offset));
+  std::memcpy(ring + offset, data, first);
+  std::memcpy(ring, static_cast<const uint8_t *>(data) + first, size - first);
+}
+
+void
+BlackBox::record(int channel, const uint8_t * data, size_t size)
+{
+  uint8_t * segment = segment_.load(std::memory_order_acquire);
+  if (!segment || channel < 0) {
+    return;
+  }
+  auto header = reinterpret_cast<SegmentHeader *>(segment);
+  const uint64_t length = (sizeof(RecordHeader) + size + 7) & ~uint64_t(7);
+  if (length > header->ring_size / 2) {
+    return;
+  }
+
+  RecordHeader record;
+  record.channel = static_cast<uint32_t>(channel);
+  record.size = static_cast<uint32_t>(size);
+  record.stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+
+  const uint64_t position = header->reserved.fetch_add(length, std::memory_order_relaxed);
+  const uint64_t slot = header->started.fetch_add(1, std::memory_order_relaxed) %
+    header->index_slots;
+  copyIn(position + sizeof(record.commit), &record.channel,
+    sizeof(record) - sizeof(record.commit));
+  copyIn(position + sizeof(record), data, size);
+  commitOf(ringOf(segment), header->ring_size, position).store(position + 1,
+    std::memory_order_release);
+  indexOf(segment)[slot].store(position + 1, std::memory_order_release);
+}
+
+void
+BlackBox::recordMessage(
+  int channel, const void * msg, const rosidl_message_type_support_t * type_support)
+{
+  // each thread serializes into a buffer of its own, which only grows
+  struct Buffer
+  {
+    Buffer()
+    : message(rmw_get_zero_initialized_serialized_message())
+    {
+      auto allocator = rcutils_get_default_allocator();
+      rmw_serialized_message_init(&message, 4096, &allocator);
+    }
+    ~Buffer() {rmw_serialized_message_fini(&message);}
+    rmw_serialized_message_t message;
+  };
+  thread_local Buffer buffer;
+
+  if (rmw_serialize(msg, type_support, &buffer.message) == RMW_RET_OK) {
+    record(channel, reinterpret_cast<const uint8_t *>(buffer.message.buffer),
+      buffer.message.buffer_length);
+  }
+}
+
+bool
+BlackBox::save(const std::string & filename) const
+{
+  const uint8_t * segment = segment_.load(std::memory_order_acquire);
+  return segment && writeLog(segment, size_, filename);
+}
+
+bool
+BlackBox::saveSegment(const std::string & source, const std::string & filename)
+{
+  // a crash file if there is one by that name, else a segment in /dev/shm
+  struct stat info;
+  int fd;
+  if (::stat(source.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+    fd = ::open(source.c_str(), O_RDONLY);
+  } else {
+    fd = shm_open((source.empty() || source[0] != '/' ? "/" + source : source).c_str(),
+        O_RDONLY, 0);
+  }
+  if (fd < 0) {
+    return false;
+  }
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+  const size_t size = static_cast<size_t>(info.st_size);
+  void * memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (memory == MAP_FAILED) {
+    return false;
+  }
+  bool saved = writeLog(static_cast<const uint8_t *>(memory), size, filename);
+  munmap(memory, size);
+  return saved;
+}
+
+bool
+BlackBoxLog::read(const std::string & filename)
+{
+  channels_.clear();
+  records_.clear();
+
+  std::ifstream in(filename, std::ios::binary);
+  char magic[sizeof(LOG_MAGIC)];
+  uint32_t channel_count;
+  if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0 ||
+    !readValue(in, channel_count) || channel_count > BlackBox::MAX_CHANNELS)
+  {
+    return false;
+  }
+  channels_.resize(channel_count);
+  for (auto & channel : channels_) {
+    if (!readString(in, channel.topic) || !readString(in, channel.type)) {
+      return false;
+    }
+  }
+
+  Record record;
+  uint32_t size;
+  while (readValue(in, record.channel)) {
+    if (!readValue(in, size) || !readValue(in, record.stamp) || record.channel >= channel_count) {
+      return false;
+    }
+    record.data.resize(size);
+    if (!in.read(reinterpret_cast<char *>(record.data.data()), size)) {
+      return false;
+    }
+    records_.push_back(std::move(record));
+  }
+  return true;
+}
+
+int
+BlackBoxLog::find(const std::string & topic) const
+{
+  for (size_t i = 0; i < channels_.size(); ++i) {
+    if (channels_[i].topic == topic) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+bool
+BlackBoxLog::deserialize(
+  const Record & record, void * msg, const rosidl_message_type_support_t * type_support)
+{
+  rmw_serialized_message_t serialized = rmw_get_zero_initialized_serialized_message();
+  serialized.buffer = reinterpret_cast<decltype(serialized.buffer)>(
+    const_cast<uint8_t *>(record.data.data()));
+  serialized.buffer_length = record.data.size();
+  serialized.buffer_capacity = record.data.size();
+  return rmw_deserialize(&serialized, type_support, msg) == RMW_RET_OK;
+}
+
+}  // namespace nav2_util
@@ -0,0 +1,66 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "nav2_util/black_box.hpp"
+
+using std::cerr;
+
+void usage()
+{
+  cerr << "Invalid command line.\n\n";
+  cerr << "Saves the black box of a running or crashed process, or lists a saved one\n\n";
+  cerr << "Usage:\n";
+  cerr << " > black_box save <segment name | crash file> <file>\n";
+  cerr << " > black_box list <file>\n";
+  std::exit(1);
+}
+
+int main(int argc, char * argv[])
+{
+  if (argc == 4 && std::string(argv[1]) == "save") {
+    if (!nav2_util::BlackBox::saveSegment(argv[2], argv[3])) {
+      cerr << "Could not save " << argv[2] << " to " << argv[3] << "\n";
+      return 1;
+    }
+    return 0;
+  }
+  if (argc != 3 || std::string(argv[1]) != "list") {
+    usage();
+  }
+
+  nav2_util::BlackBoxLog log;
+  if (!log.read(argv[2])) {
+    cerr << "Could not read " << argv[2] << "\n";
+    return 1;
+  }
+  std::map<uint32_t, size_t> counts, bytes;
+  for (const auto & record : log.records()) {
+    counts[record.channel]++;
+    bytes[record.channel] += record.data.size();
+  }
+  if (!log.records().empty()) {
+    std::cout << "Seconds: " <<
+      (log.records().back().stamp - log.records().front().stamp) * 1e-9 << "\n";
+  }
+  for (uint32_t i = 0; i < log.channels().size(); ++i) {
+    std::cout << log.channels()[i].topic << " (" << log.channels()[i].type << "): " <<
+      counts[i] << " records, " << bytes[i] << " bytes\n";
+  }
+  return 0;
+}
@@ -104,6 +104,24 @@ void Costmap::set_test_costmap(const TestCostmap & testCostmapType)
   using_test_map_ = true;
 }
 
+void Costmap::set_synthetic_costmap(const SyntheticMapSpec & spec)
+{
+  costmap_properties_.map_load_time = node_->now();
+  costmap_properties_.update_time = node_->now();
+  costmap_properties_.layer = "Master";
+  costmap_properties_.resolution = spec.resolution;
+  costmap_properties_.size_x = spec.size_x;
+  costmap_properties_.size_y = spec.size_y;
+  costmap_properties_.origin.position.x = 0.0;
+  costmap_properties_.origin.position.y = 0.0;
+  costmap_properties_.origin.position.z = 0.0;
+  costmap_properties_.origin.orientation = orientationAroundZAxis(0.0);
+
+  costs_ = generate_synthetic_costmap(spec);
+
+  using_test_map_ = true;
+}
+
 nav2_msgs::msg::Costmap Costmap::get_costmap(
   const nav2_msgs::msg::CostmapMetaData & /*specifications*/)
 {
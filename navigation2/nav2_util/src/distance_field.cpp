@@ -0,0 +1,137 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/distance_field.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nav2_util/shared_map_registry.hpp"
+
+namespace nav2_util
+{
+
+namespace
+{
+
+// One dimensional squared distance transform of the finite sampled function f, from
+// Felzenszwalb & Huttenlocher, "Distance Transforms of Sampled Functions". v and z are
+// workspace of n and n + 1 elements.
+void distanceTransform1D(const double * f, int n, double * d, int * v, double * z)
+{
+  int k = 0;
+  v[0] = 0;
+  z[0] = -HUGE_VAL;
+  z[1] = HUGE_VAL;
+  for (int q = 1; q < n; q++) {
+    double s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+    while (s <= z[k]) {
+      k--;
+      s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+    }
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = HUGE_VAL;
+  }
+
+  k = 0;
+  for (int q = 0; q < n; q++) {
+    while (z[k + 1] < q) {
+      k++;
+    }
+    d[q] = static_cast<double>(q - v[k]) * (q - v[k]) + f[v[k]];
+  }
+}
+
+// fn(begin, end) over [0, n) in contiguous ranges, one per thread
+template<typename Fn>
+void parallelFor(int threads, int n, Fn fn)
+{
+  threads = std::max(1, std::min(threads, n));
+  std::vector<std::thread> workers;
+  int chunk = (n + threads - 1) / threads;
+  for (int begin = chunk; begin < n; begin += chunk) {
+    workers.emplace_back(fn, begin, std::min(n, begin + chunk));
+  }
+  fn(0, std::min(n, chunk));
+  for (auto & worker : workers) {
+    worker.join();
+  }
+}
+
+}  // namespace
+
+std::shared_ptr<DistanceField>
+computeDistanceField(
+  const nav_msgs::msg::OccupancyGrid & map, int8_t obstacle_value, int threads)
+{
+  auto field = std::make_shared<DistanceField>();
+  const int width = field->width = map.info.width;
+  const int height = field->height = map.info.height;
+  field->sq_distances.resize(static_cast<size_t>(width) * height);
+  if (field->sq_distances.empty()) {
+    return field;
+  }
+
+  // beyond any distance on the map, and exact in a double
+  const double none = static_cast<double>(width) * width + static_cast<double>(height) * height +
+    1.0;
+  std::vector<double> columns(field->sq_distances.size());
+
+  parallelFor(threads, width, [&](int begin, int end) {
+      std::vector<double> f(height), d(height), z(height + 1);
+      std::vector<int> v(height);
+      for (int i = begin; i < end; i++) {
+        for (int j = 0; j < height; j++) {
+          f[j] = map.data[i + static_cast<size_t>(j) * width] >= obstacle_value ? 0.0 : none;
+        }
+        distanceTransform1D(f.data(), height, d.data(), v.data(), z.data());
+        for (int j = 0; j < height; j++) {
+          columns[i + static_cast<size_t>(j) * width] = std::min(d[j], none);
+        }
+      }
+    });
+
+  const double max_sq = std::numeric_limits<uint32_t>::max();
+  parallelFor(threads, height, [&](int begin, int end) {
+      std::vector<double> d(width), z(width + 1);
+      std::vector<int> v(width);
+      for (int j = begin; j < end; j++) {
+        size_t row = static_cast<size_t>(j) * width;
+        distanceTransform1D(&columns[row], width, d.data(), v.data(), z.data());
+        for (int i = 0; i < width; i++) {
+          field->sq_distances[row + i] = static_cast<uint32_t>(std::min(d[i], max_sq));
+        }
+      }
+    });
+  return field;
+}
+
+std::shared_ptr<const DistanceField>
+sharedDistanceField(
+  const nav_msgs::msg::OccupancyGrid & map, int8_t obstacle_value, int threads)
+{
+  return SharedMapRegistry<DistanceField>::global().getOrPrepare(
+    {hashOccupancyGrid(map), "distance_field " + std::to_string(obstacle_value)},
+    [&map, obstacle_value, threads]() {
+      return computeDistanceField(map, obstacle_value, threads);
+    });
+}
+
+}  // namespace nav2_util
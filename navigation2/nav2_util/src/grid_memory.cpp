@@ -0,0 +1,172 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/grid_memory.hpp"
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace nav2_util
+{
+
+namespace
+{
+
+constexpr size_t huge_page = size_t{2} << 20;
+
+// Every grid is preceded by where its memory came from, in a cache line of its own
+constexpr size_t header_size = 64;
+
+enum class Source
+{
+  heap,
+  mapped
+};
+
+struct Header
+{
+  void * base;
+  size_t length;
+  Source source;
+};
+
+static_assert(sizeof(Header) <= header_size, "The grid header outgrew its cache line");
+
+HugePages modeFromEnvironment()
+{
+  const char * mode = std::getenv("NAV2_HUGE_PAGES");
+  if (mode && std::strcmp(mode, "off") == 0) {
+    return HugePages::off;
+  }
+  if (mode && std::strcmp(mode, "reserved") == 0) {
+    return HugePages::reserved;
+  }
+  return HugePages::transparent;
+}
+
+std::atomic<HugePages> & mode()
+{
+  static std::atomic<HugePages> mode{modeFromEnvironment()};
+  return mode;
+}
+
+size_t roundUp(size_t value, size_t multiple)
+{
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+void * place(void * base, size_t length, Source source, unsigned char * grid)
+{
+  Header * header = reinterpret_cast<Header *>(grid - header_size);
+  header->base = base;
+  header->length = length;
+  header->source = source;
+  return grid;
+}
+
+void * mapHuge(size_t bytes, HugePages huge_pages)
+{
+#ifdef MAP_HUGETLB
+  if (huge_pages == HugePages::reserved) {
+    const size_t length = roundUp(bytes + header_size, huge_page);
+    void * base = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (base != MAP_FAILED) {
+      return place(base, length, Source::mapped, static_cast<unsigned char *>(base) +
+               header_size);
+    }
+  }
+#endif
+
+  // room to start the grid on a huge page boundary, with its header on the page before
+  const size_t length = roundUp(bytes, huge_page) + huge_page;
+  void * base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+      -1, 0);
+  if (base == MAP_FAILED) {
+    return nullptr;
+  }
+  unsigned char * grid = reinterpret_cast<unsigned char *>(
+    roundUp(reinterpret_cast<uintptr_t>(base) + header_size, huge_page));
+#ifdef MADV_HUGEPAGE
+  madvise(grid, roundUp(bytes, huge_page), MADV_HUGEPAGE);
+#endif
+  return place(base, length, Source::mapped, grid);
+}
+
+void * allocate(size_t bytes)
+{
+  const HugePages huge_pages = mode().load(std::memory_order_relaxed);
+  if (huge_pages != HugePages::off && bytes >= huge_page) {
+    if (void * grid = mapHuge(bytes, huge_pages)) {
+      return grid;
+    }
+  }
+  void * base = std::calloc(1, bytes + header_size);
+  if (!base) {
+    return nullptr;
+  }
+  return place(base, 0, Source::heap, static_cast<unsigned char *>(base) + header_size);
+}
+
+}  // namespace
+
+void * allocate_grid(size_t bytes)
+{
+  void * grid = allocate(bytes);
+  if (!grid) {
+    throw std::bad_alloc();
+  }
+  return grid;
+}
+
+void free_grid(void * grid)
+{
+  if (!grid) {
+    return;
+  }
+  const Header * header = reinterpret_cast<const Header *>(
+    static_cast<unsigned char *>(grid) - header_size);
+  if (header->source == Source::mapped) {
+    munmap(header->base, header->length);
+  } else {
+    std::free(header->base);
+  }
+}
+
+void set_grid_huge_pages(HugePages huge_pages)
+{
+  mode().store(huge_pages, std::memory_order_relaxed);
+}
+
+HugePages get_grid_huge_pages()
+{
+  return mode().load(std::memory_order_relaxed);
+}
+
+}  // namespace nav2_util
+
+void * nav2_util_allocate_grid(size_t bytes)
+{
+  return nav2_util::allocate(bytes);
+}
+
+void nav2_util_free_grid(void * grid)
+{
+  nav2_util::free_grid(grid);
+}
@@ -15,10 +15,12 @@
 #include "nav2_util/lifecycle_node.hpp"
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "lifecycle_msgs/msg/state.hpp"
+#include "nav2_util/black_box.hpp"
 
 namespace nav2_util
 {
@@ -62,6 +64,66 @@ LifecycleNode::LifecycleNode(
       },
       rclcpp_node_);
   }
+
+  register_on_configure([this](const rclcpp_lifecycle::State & state) {
+      clear_startup_phases();
+      return timed_transition("on_configure", [&]() {return on_configure(state);});
+    });
+  register_on_activate([this](const rclcpp_lifecycle::State & state) {
+      return timed_transition("on_activate", [&]() {return on_activate(state);});
+    });
+
+  // metrics are kept per process, so one node of a process setting metrics_period is enough
+  if (!has_parameter("metrics_period")) {
+    declare_parameter("metrics_period", rclcpp::ParameterValue(0.0));
+  }
+  if (!has_parameter("metrics_topic")) {
+    declare_parameter("metrics_topic", rclcpp::ParameterValue(std::string("metrics")));
+  }
+  if (!has_parameter("metrics_file")) {
+    declare_parameter("metrics_file", rclcpp::ParameterValue(std::string("")));
+  }
+  double metrics_period = get_parameter("metrics_period").as_double();
+  if (metrics_period > 0.0) {
+    metrics_exporter_ = std::make_unique<MetricsExporter>(
+      get_node_topics_interface(), metrics_period,
+      get_parameter("metrics_topic").as_string(), get_parameter("metrics_file").as_string());
+  }
+
+  // as are the recordings of the black box, whose segment is named after the first node to
+  // open it unless black_box_name says otherwise
+  if (!has_parameter("black_box_size")) {
+    declare_parameter("black_box_size", rclcpp::ParameterValue(0));
+  }
+  if (!has_parameter("black_box_name")) {
+    declare_parameter("black_box_name", rclcpp::ParameterValue(std::string("")));
+  }
+  if (!has_parameter("black_box_crash_file")) {
+    declare_parameter("black_box_crash_file", rclcpp::ParameterValue(std::string("")));
+  }
+  int black_box_size = get_parameter("black_box_size").as_int();
+  if (black_box_size > 0 && !BlackBox::global().isOpen()) {
+    std::string name = get_parameter("black_box_name").as_string();
+    if (name.empty()) {
+      name = std::string("nav2_black_box_") + get_name();
+    }
+    if (BlackBox::global().open(name, static_cast<size_t>(black_box_size) << 20,
+      get_parameter("black_box_crash_file").as_string()))
+    {
+      RCLCPP_INFO(get_logger(), "Recording the black box in /dev/shm/%s (%d MB)",
+        name.c_str(), black_box_size);
+    } else {
+      RCLCPP_WARN(get_logger(), "Could not create the black box %s", name.c_str());
+    }
+  }
+
+  startup_report_service_ = create_service<nav2_msgs::srv::GetStartupReport>(
+    std::string(get_name()) + "/get_startup_report",
+    [this](const std::shared_ptr<rmw_request_id_t>,
+    const std::shared_ptr<nav2_msgs::srv::GetStartupReport::Request>,
+    std::shared_ptr<nav2_msgs::srv::GetStartupReport::Response> response) {
+      response->phases = get_startup_phases();
+    });
 }
 
 LifecycleNode::~LifecycleNode()
@@ -80,4 +142,82 @@ LifecycleNode::~LifecycleNode()
   }
 }
 
+CallbackReturn
+LifecycleNode::timed_transition(
+  const std::string & phase, const std::function<CallbackReturn()> & transition)
+{
+  ExecutionTimer timer;
+  timer.start();
+  CallbackReturn result = transition();
+  timer.end();
+
+  record_startup_phase(phase, timer);
+  return result;
+}
+
+void
+LifecycleNode::record_startup_phase(const std::string & phase, ExecutionTimer & timer)
+{
+  record_startup_phase(phase, timer.elapsed_time_in_seconds());
+}
+
+void
+LifecycleNode::record_startup_phase(const std::string & phase, double seconds)
+{
+  nav2_msgs::msg::StartupPhase record;
+  record.node = get_name();
+  record.phase = phase;
+  record.seconds = seconds;
+
+  RCLCPP_DEBUG(get_logger(), "%s took %.3f s", phase.c_str(), seconds);
+
+  std::lock_guard<std::mutex> lock(startup_mutex_);
+  startup_phases_.push_back(record);
+}
+
+void
+LifecycleNode::add_startup_child(std::shared_ptr<LifecycleNode> child)
+{
+  std::lock_guard<std::mutex> lock(startup_mutex_);
+  startup_children_.push_back(child);
+}
+
+std::vector<nav2_msgs::msg::StartupPhase>
+LifecycleNode::get_startup_phases()
+{
+  std::vector<nav2_msgs::msg::StartupPhase> phases;
+  std::vector<std::weak_ptr<LifecycleNode>> children;
+  {
+    std::lock_guard<std::mutex> lock(startup_mutex_);
+    phases = startup_phases_;
+    children = startup_children_;
+  }
+
+  for (auto & weak_child : children) {
+    if (auto child = weak_child.lock()) {
+      auto child_phases = child->get_startup_phases();
+      phases.insert(phases.end(), child_phases.begin(), child_phases.end());
+    }
+  }
+  return phases;
+}
+
+void
+LifecycleNode::clear_startup_phases()
+{
+  std::vector<std::weak_ptr<LifecycleNode>> children;
+  {
+    std::lock_guard<std::mutex> lock(startup_mutex_);
+    startup_phases_.clear();
+    children = startup_children_;
+  }
+
+  // The helper nodes are configured along with this one
+  for (auto & weak_child : children) {
+    if (auto child = weak_child.lock()) {
+      child->clear_startup_phases();
+    }
+  }
+}
+
 }  // namespace nav2_util
@@ -0,0 +1,169 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/loop_rate.hpp"
+
+#include <algorithm>
+#include <memory>
+
+using std::chrono::nanoseconds;
+
+namespace nav2_util
+{
+
+constexpr nanoseconds LoopClock::SIM_SLICE;
+
+namespace
+{
+
+// How long a sleep in sim time waits for /clock before looking again for a shutdown
+const nanoseconds SIM_POLL = std::chrono::milliseconds(100);
+
+nanoseconds steadyNow()
+{
+  return std::chrono::duration_cast<nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch());
+}
+
+}  // namespace
+
+LoopClock::LoopClock(rclcpp::Clock::SharedPtr clock)
+: clock_(clock)
+{
+  if (!clock_ || clock_->get_clock_type() != RCL_ROS_TIME) {
+    return;
+  }
+
+  // Every step of /clock, and the switch to it, wakes the sleepers to look at the time
+  rcl_jump_threshold_t threshold;
+  threshold.on_clock_change = true;
+  threshold.min_forward.nanoseconds = 1;
+  threshold.min_backward.nanoseconds = -1;
+  jump_handler_ = clock_->create_jump_callback([]() {},
+      [this](const rcl_time_jump_t &) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ticked_.notify_all();
+      }, threshold);
+}
+
+bool
+LoopClock::isSimTime() const
+{
+  return clock_ && clock_->get_clock_type() == RCL_ROS_TIME && clock_->ros_time_is_active();
+}
+
+nanoseconds
+LoopClock::now() const
+{
+  if (isSimTime()) {
+    return nanoseconds(clock_->now().nanoseconds());
+  }
+  return steadyNow();
+}
+
+bool
+LoopClock::sleepUntil(nanoseconds deadline)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  const uint64_t interrupts = interrupts_;
+  bool sim_time = isSimTime();
+  while (rclcpp::ok() && interrupts == interrupts_) {
+    nanoseconds now = this->now();
+    if (now >= deadline) {
+      return true;
+    }
+    if (isSimTime() != sim_time) {
+      // The deadline was for the other clock
+      return true;
+    }
+    nanoseconds wait = sim_time ? SIM_POLL : std::min(deadline - now, SIM_POLL);
+    ticked_.wait_for(lock, wait);
+  }
+  return false;
+}
+
+bool
+LoopClock::waitUntil(
+  nanoseconds deadline, const std::function<bool(nanoseconds)> & wait)
+{
+  while (rclcpp::ok()) {
+    nanoseconds left = deadline - now();
+    if (left <= nanoseconds(0)) {
+      return false;
+    }
+    if (isSimTime()) {
+      left = std::min(left, SIM_SLICE);
+    }
+    if (wait(left)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+LoopClock::interrupt()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  interrupts_++;
+  ticked_.notify_all();
+}
+
+LoopRate::LoopRate(std::shared_ptr<LoopClock> clock, double frequency)
+: clock_(clock),
+  period_(std::chrono::duration_cast<nanoseconds>(std::chrono::duration<double>(1.0 / frequency))),
+  deadline_(clock_->now() + period_),
+  sim_time_(clock_->isSimTime())
+{
+}
+
+bool
+LoopRate::sleep()
+{
+  followClock();
+  bool slept = clock_->sleepUntil(deadline_);
+  next();
+  return slept;
+}
+
+nanoseconds
+LoopRate::next()
+{
+  followClock();
+  nanoseconds now = clock_->now();
+  nanoseconds late = std::max(nanoseconds(0), now - deadline_);
+  // A whole cycle behind, the cycles start over from now rather than run back to back
+  deadline_ = late > period_ ? now + period_ : deadline_ + period_;
+  return late;
+}
+
+void
+LoopRate::setFrequency(double frequency)
+{
+  nanoseconds period =
+    std::chrono::duration_cast<nanoseconds>(std::chrono::duration<double>(1.0 / frequency));
+  deadline_ += period - period_;
+  period_ = period;
+}
+
+void
+LoopRate::followClock()
+{
+  if (clock_->isSimTime() != sim_time_) {
+    sim_time_ = !sim_time_;
+    deadline_ = clock_->now() + period_;
+  }
+}
+
+}  // namespace nav2_util
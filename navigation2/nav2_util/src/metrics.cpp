@@ -0,0 +1,319 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace nav2_util
+{
+
+size_t metricsShard()
+{
+  static std::atomic<size_t> next_shard{0};
+  static thread_local size_t shard = next_shard.fetch_add(1) % METRICS_SHARDS;
+  return shard;
+}
+
+double HistogramSnapshot::quantile(double q) const
+{
+  if (count == 0) {
+    return 0.0;
+  }
+  uint64_t rank = static_cast<uint64_t>(std::ceil(std::min(std::max(q, 0.0), 1.0) * count));
+  rank = std::max<uint64_t>(rank, 1);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      // the top of the bucket, as no sample in it took longer, nor longer than the slowest
+      uint64_t high = LatencyHistogram::bucketHigh(static_cast<int>(i)) - 1;
+      return std::min(high, max_ns) * 1e-9;
+    }
+  }
+  return max_ns * 1e-9;
+}
+
+HistogramSnapshot HistogramSnapshot::since(const HistogramSnapshot & earlier) const
+{
+  HistogramSnapshot difference = *this;
+  if (earlier.buckets.size() != buckets.size()) {
+    return difference;
+  }
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    difference.buckets[i] -= earlier.buckets[i];
+  }
+  difference.count -= earlier.count;
+  difference.sum_ns -= earlier.sum_ns;
+  return difference;
+}
+
+LatencyHistogram::LatencyHistogram()
+: shards_(new Shard[METRICS_SHARDS])
+{
+  for (size_t s = 0; s < METRICS_SHARDS; ++s) {
+    Shard & shard = shards_[s];
+    for (auto & bucket : shard.buckets) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    shard.count.store(0, std::memory_order_relaxed);
+    shard.sum_ns.store(0, std::memory_order_relaxed);
+    shard.max_ns.store(0, std::memory_order_relaxed);
+  }
+}
+
+int LatencyHistogram::bucketOf(uint64_t ns)
+{
+  if (ns < static_cast<uint64_t>(SUB_BUCKETS)) {
+    return static_cast<int>(ns);
+  }
+  int exponent = 63 - __builtin_clzll(ns);
+  if (exponent > MAX_EXPONENT) {
+    return BUCKET_COUNT - 1;
+  }
+  int shift = exponent - SUB_BUCKET_BITS;
+  int sub_bucket = static_cast<int>((ns >> shift) & (SUB_BUCKETS - 1));
+  return (shift + 1) * SUB_BUCKETS + sub_bucket;
+}
+
+uint64_t LatencyHistogram::bucketLow(int bucket)
+{
+  if (bucket < SUB_BUCKETS) {
+    return bucket;
+  }
+  int shift = bucket / SUB_BUCKETS - 1;
+  uint64_t sub_bucket = bucket % SUB_BUCKETS;
+  return (SUB_BUCKETS + sub_bucket) << shift;
+}
+
+uint64_t LatencyHistogram::bucketHigh(int bucket)
+{
+  if (bucket < SUB_BUCKETS) {
+    return bucket + 1;
+  }
+  return bucketLow(bucket) + (uint64_t(1) << (bucket / SUB_BUCKETS - 1));
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds duration)
+{
+  uint64_t ns = duration.count() > 0 ? static_cast<uint64_t>(duration.count()) : 0;
+  Shard & shard = shards_[metricsShard()];
+  shard.buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+  shard.count.fetch_add(1, std::memory_order_relaxed);
+  shard.sum_ns.fetch_add(ns, std::memory_order_relaxed);
+  uint64_t max_ns = shard.max_ns.load(std::memory_order_relaxed);
+  while (ns > max_ns &&
+    !shard.max_ns.compare_exchange_weak(max_ns, ns, std::memory_order_relaxed))
+  {
+  }
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const
+{
+  // the shards are read while being written, so a snapshot may count a sample in some of
+  // its totals and not yet others; the count is taken from the buckets to stay consistent
+  HistogramSnapshot snapshot;
+  snapshot.buckets.assign(BUCKET_COUNT, 0);
+  for (size_t s = 0; s < METRICS_SHARDS; ++s) {
+    const Shard & shard = shards_[s];
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+      uint64_t n = shard.buckets[i].load(std::memory_order_relaxed);
+      snapshot.buckets[i] += n;
+      snapshot.count += n;
+    }
+    snapshot.sum_ns += shard.sum_ns.load(std::memory_order_relaxed);
+    snapshot.max_ns = std::max(snapshot.max_ns, shard.max_ns.load(std::memory_order_relaxed));
+  }
+  return snapshot;
+}
+
+Counter::Counter()
+: shards_(new Shard[METRICS_SHARDS])
+{
+  for (size_t s = 0; s < METRICS_SHARDS; ++s) {
+    shards_[s].value.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint64_t Counter::value() const
+{
+  uint64_t total = 0;
+  for (size_t s = 0; s < METRICS_SHARDS; ++s) {
+    total += shards_[s].value.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+void Gauge::add(double delta)
+{
+  double value = value_.load(std::memory_order_relaxed);
+  while (!value_.compare_exchange_weak(value, value + delta, std::memory_order_relaxed)) {
+  }
+}
+
+MetricsRegistry & MetricsRegistry::global()
+{
+  static MetricsRegistry registry;
+  return registry;
+}
+
+template<typename MetricT>
+MetricT & MetricsRegistry::findOrAdd(
+  std::map<std::string, Named<MetricT>> & metrics,
+  const std::string & name, const std::string & description)
+{
+  auto & named = metrics[name];
+  if (!named.metric) {
+    named.description = description;
+    named.metric = std::make_unique<MetricT>();
+  }
+  return *named.metric;
+}
+
+template<typename MetricT>
+std::vector<MetricsRegistry::Entry<MetricT>> MetricsRegistry::list(
+  const std::map<std::string, Named<MetricT>> & metrics)
+{
+  std::vector<Entry<MetricT>> entries;
+  for (const auto & named : metrics) {
+    entries.push_back({named.first, named.second.description, named.second.metric.get()});
+  }
+  return entries;
+}
+
+LatencyHistogram & MetricsRegistry::histogram(
+  const std::string & name, const std::string & description)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return findOrAdd(histograms_, name, description);
+}
+
+Counter & MetricsRegistry::counter(const std::string & name, const std::string & description)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return findOrAdd(counters_, name, description);
+}
+
+Gauge & MetricsRegistry::gauge(const std::string & name, const std::string & description)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return findOrAdd(gauges_, name, description);
+}
+
+std::vector<MetricsRegistry::Entry<LatencyHistogram>> MetricsRegistry::histograms() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return list(histograms_);
+}
+
+std::vector<MetricsRegistry::Entry<Counter>> MetricsRegistry::counters() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return list(counters_);
+}
+
+std::vector<MetricsRegistry::Entry<Gauge>> MetricsRegistry::gauges() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return list(gauges_);
+}
+
+std::string prometheusName(const std::string & name)
+{
+  std::string result = name;
+  for (size_t i = 0; i < result.size(); ++i) {
+    char c = result[i];
+    bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':' ||
+      (i > 0 && c >= '0' && c <= '9');
+    if (!valid) {
+      result[i] = '_';
+    }
+  }
+  return result;
+}
+
+const std::vector<MetricsReport::HistogramRow> & MetricsReport::update()
+{
+  rows_.clear();
+  for (const auto & entry : registry_.histograms()) {
+    HistogramRow row;
+    row.name = entry.name;
+    row.description = entry.description;
+    row.total = entry.metric->snapshot();
+    auto previous = previous_.find(entry.name);
+    row.interval = previous == previous_.end() ? row.total : row.total.since(previous->second);
+    previous_[entry.name] = row.total;
+    rows_.push_back(std::move(row));
+  }
+  return rows_;
+}
+
+namespace
+{
+
+std::string formatValue(double value)
+{
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.9g", value);
+  return buffer;
+}
+
+void writeHeader(
+  std::ostringstream & out, const std::string & name, const std::string & description,
+  const char * type)
+{
+  if (!description.empty()) {
+    out << "# HELP " << name << " " << description << "\n";
+  }
+  out << "# TYPE " << name << " " << type << "\n";
+}
+
+}  // namespace
+
+std::string MetricsReport::prometheusText() const
+{
+  static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+  std::ostringstream out;
+  for (const auto & row : rows_) {
+    std::string name = prometheusName(row.name) + "_seconds";
+    writeHeader(out, name, row.description, "summary");
+    for (double q : quantiles) {
+      out << name << "{quantile=\"" << formatValue(q) << "\"} " <<
+        formatValue(row.interval.quantile(q)) << "\n";
+    }
+    out << name << "_sum " << formatValue(row.total.sum_ns * 1e-9) << "\n";
+    out << name << "_count " << row.total.count << "\n";
+  }
+  for (const auto & entry : registry_.counters()) {
+    std::string name = prometheusName(entry.name) + "_total";
+    writeHeader(out, name, entry.description, "counter");
+    out << name << " " << entry.metric->value() << "\n";
+  }
+  for (const auto & entry : registry_.gauges()) {
+    std::string name = prometheusName(entry.name);
+    writeHeader(out, name, entry.description, "gauge");
+    out << name << " " << formatValue(entry.metric->value()) << "\n";
+  }
+  return out.str();
+}
+
+}  // namespace nav2_util
@@ -0,0 +1,183 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/metrics_exporter.hpp"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace nav2_util
+{
+
+MetricsExporter::MetricsExporter(
+  const rclcpp::node_interfaces::NodeTopicsInterface::SharedPtr node_topics,
+  double period, const std::string & topic, const std::string & prometheus_file)
+: source_(node_topics->get_node_base_interface()->get_fully_qualified_name()),
+  cpu_percent_(MetricsRegistry::global().gauge("process.cpu_percent",
+    "CPU time of the process, in percent of one core")),
+  rss_mb_(MetricsRegistry::global().gauge("process.rss_mb", "Resident memory of the process")),
+  prometheus_file_(prometheus_file),
+  period_(std::chrono::nanoseconds(static_cast<int64_t>(std::max(period, 0.01) * 1e9)))
+{
+  if (!topic.empty()) {
+    diagnostics_pub_ = rclcpp::create_publisher<diagnostic_msgs::msg::DiagnosticArray>(
+      node_topics, topic, rclcpp::SystemDefaultsQoS());
+  }
+  // the first interval starts now
+  report_.update();
+  updateProcessGauges();
+  thread_ = std::thread(&MetricsExporter::run, this);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    running_ = false;
+  }
+  wake_.notify_all();
+  thread_.join();
+}
+
+void MetricsExporter::run()
+{
+  std::unique_lock<std::mutex> lock(wake_mutex_);
+  while (running_) {
+    if (wake_.wait_for(lock, period_, [this]() {return !running_;})) {
+      break;
+    }
+    lock.unlock();
+    exportNow();
+    lock.lock();
+  }
+}
+
+void MetricsExporter::exportNow()
+{
+  std::lock_guard<std::mutex> lock(export_mutex_);
+  updateProcessGauges();
+  report_.update();
+  if (diagnostics_pub_) {
+    publishDiagnostics(rclcpp::Clock().now());
+  }
+  if (!prometheus_file_.empty()) {
+    writePrometheusFile();
+  }
+}
+
+void MetricsExporter::publishDiagnostics(const rclcpp::Time & stamp)
+{
+  auto msg = std::make_unique<diagnostic_msgs::msg::DiagnosticArray>();
+  msg->header.stamp = stamp;
+
+  auto add_value = [](diagnostic_msgs::msg::DiagnosticStatus & status,
+      const std::string & key, const std::string & value) {
+      diagnostic_msgs::msg::KeyValue kv;
+      kv.key = key;
+      kv.value = value;
+      status.values.push_back(kv);
+    };
+
+  for (const auto & row : report_.rows()) {
+    diagnostic_msgs::msg::DiagnosticStatus status;
+    status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+    status.name = row.name;
+    status.message = row.description;
+    status.hardware_id = source_;
+    add_value(status, "count", std::to_string(row.interval.count));
+    if (interval_seconds_ > 0.0) {
+      add_value(status, "rate", std::to_string(row.interval.count / interval_seconds_));
+    }
+    if (row.interval.count > 0) {
+      add_value(status, "mean", std::to_string(1e3 * row.interval.mean()));
+      add_value(status, "p50", std::to_string(1e3 * row.interval.quantile(0.5)));
+      add_value(status, "p90", std::to_string(1e3 * row.interval.quantile(0.9)));
+      add_value(status, "p99", std::to_string(1e3 * row.interval.quantile(0.99)));
+    }
+    add_value(status, "max", std::to_string(1e-6 * row.total.max_ns));
+    msg->status.push_back(status);
+  }
+
+  diagnostic_msgs::msg::DiagnosticStatus values;
+  values.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+  values.name = "metrics";
+  values.message = "Counters and gauges";
+  values.hardware_id = source_;
+  for (const auto & entry : MetricsRegistry::global().counters()) {
+    add_value(values, entry.name, std::to_string(entry.metric->value()));
+  }
+  for (const auto & entry : MetricsRegistry::global().gauges()) {
+    add_value(values, entry.name, std::to_string(entry.metric->value()));
+  }
+  if (!values.values.empty()) {
+    msg->status.push_back(values);
+  }
+
+  diagnostics_pub_->publish(std::move(msg));
+}
+
+void MetricsExporter::updateProcessGauges()
+{
+  auto now = std::chrono::steady_clock::now();
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  double cpu_seconds = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+    1e-6 * (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+  if (last_export_ != std::chrono::steady_clock::time_point()) {
+    interval_seconds_ = std::chrono::duration<double>(now - last_export_).count();
+    if (interval_seconds_ > 0.0) {
+      cpu_percent_.set(100.0 * (cpu_seconds - last_cpu_seconds_) / interval_seconds_);
+    }
+  }
+  last_export_ = now;
+  last_cpu_seconds_ = cpu_seconds;
+
+  // the second field of statm is the resident set, in pages
+  long pages = 0;
+  if (FILE * statm = std::fopen("/proc/self/statm", "r")) {
+    if (std::fscanf(statm, "%*ld %ld", &pages) != 1) {
+      pages = 0;
+    }
+    std::fclose(statm);
+  }
+  rss_mb_.set(pages * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0));
+}
+
+void MetricsExporter::writePrometheusFile()
+{
+  // written aside and renamed over the file, so a collector never reads half of it
+  std::string temporary = prometheus_file_ + ".tmp";
+  {
+    std::ofstream out(temporary);
+    if (!out) {
+      RCLCPP_WARN(rclcpp::get_logger("MetricsExporter"), "Could not write %s",
+        temporary.c_str());
+      return;
+    }
+    out << report_.prometheusText();
+  }
+  if (std::rename(temporary.c_str(), prometheus_file_.c_str()) != 0) {
+    RCLCPP_WARN(rclcpp::get_logger("MetricsExporter"), "Could not replace %s",
+      prometheus_file_.c_str());
+  }
+}
+
+}  // namespace nav2_util
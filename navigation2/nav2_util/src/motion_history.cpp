@@ -0,0 +1,138 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/motion_history.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nav2_util
+{
+
+MotionHistory::MotionHistory(size_t capacity)
+: samples_(std::max<size_t>(capacity, 3))
+{
+}
+
+void MotionHistory::push(const MotionSample & sample)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  samples_[next_] = sample;
+  next_ = (next_ + 1) % samples_.size();
+  count_ = std::min(count_ + 1, samples_.size());
+}
+
+void MotionHistory::push(const nav_msgs::msg::Odometry & odom)
+{
+  const auto & q = odom.pose.pose.orientation;
+
+  MotionSample sample;
+  sample.stamp = odom.header.stamp.sec + odom.header.stamp.nanosec * 1e-9;
+  sample.x = odom.pose.pose.position.x;
+  sample.y = odom.pose.pose.position.y;
+  sample.theta = std::atan2(2.0 * (q.w * q.z + q.x * q.y), 1.0 - 2.0 * (q.y * q.y + q.z * q.z));
+  sample.v_x = odom.twist.twist.linear.x;
+  sample.v_y = odom.twist.twist.linear.y;
+  sample.v_theta = odom.twist.twist.angular.z;
+  push(sample);
+}
+
+void MotionHistory::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  count_ = 0;
+}
+
+size_t MotionHistory::size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return count_;
+}
+
+bool MotionHistory::at(size_t age, MotionSample & sample) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (age >= count_) {
+    return false;
+  }
+  sample = sampleAt(age);
+  return true;
+}
+
+double MotionHistory::displacement(size_t age) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (age >= count_) {
+    return 0.0;
+  }
+  const MotionSample & newest = sampleAt(0);
+  const MotionSample & oldest = sampleAt(age);
+  return std::hypot(newest.x - oldest.x, newest.y - oldest.y);
+}
+
+double MotionHistory::speed(size_t age) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (age == 0 || age >= count_) {
+    return 0.0;
+  }
+  const MotionSample & newest = sampleAt(0);
+  const MotionSample & oldest = sampleAt(age);
+  double dt = newest.stamp - oldest.stamp;
+  if (dt <= 0.0) {
+    return 0.0;
+  }
+  return std::hypot(newest.x - oldest.x, newest.y - oldest.y) / dt;
+}
+
+double MotionHistory::acceleration() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return accelerationAt(0);
+}
+
+double MotionHistory::jerk() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (count_ < 3) {
+    return 0.0;
+  }
+  // the two accelerations are taken over the intervals either side of the previous sample
+  double dt = (sampleAt(0).stamp - sampleAt(2).stamp) / 2.0;
+  if (dt <= 0.0) {
+    return 0.0;
+  }
+  return (accelerationAt(0) - accelerationAt(1)) / dt;
+}
+
+const MotionSample & MotionHistory::sampleAt(size_t age) const
+{
+  return samples_[(next_ + samples_.size() - 1 - age) % samples_.size()];
+}
+
+double MotionHistory::accelerationAt(size_t age) const
+{
+  if (age + 1 >= count_) {
+    return 0.0;
+  }
+  const MotionSample & current = sampleAt(age);
+  const MotionSample & previous = sampleAt(age + 1);
+  double dt = current.stamp - previous.stamp;
+  if (dt <= 0.0) {
+    return 0.0;
+  }
+  return (current.v_x - previous.v_x) / dt;
+}
+
+}  // namespace nav2_util
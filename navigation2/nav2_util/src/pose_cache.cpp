@@ -0,0 +1,108 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/pose_cache.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nav2_util
+{
+
+PoseCache::PoseCache(
+  const rclcpp::node_interfaces::NodeTopicsInterface::SharedPtr node_topics,
+  tf2_ros::Buffer & tf_buffer, const std::vector<std::string> & global_frames,
+  const std::string & robot_frame)
+: tf_buffer_(tf_buffer), robot_frame_(robot_frame)
+{
+  for (const auto & global_frame : global_frames) {
+    slots_.push_back(std::make_unique<Slot>());
+    slots_.back()->global_frame = global_frame;
+  }
+
+  tf_sub_ = rclcpp::create_subscription<tf2_msgs::msg::TFMessage>(node_topics, "/tf",
+      rclcpp::SystemDefaultsQoS(),
+      [this](const tf2_msgs::msg::TFMessage::SharedPtr) {refresh();});
+}
+
+bool PoseCache::getPose(
+  geometry_msgs::msg::PoseStamped & pose, const std::string & global_frame) const
+{
+  for (const auto & slot : slots_) {
+    if (slot->global_frame != global_frame) {
+      continue;
+    }
+
+    int64_t stamp_ns;
+    double values[7];
+    uint32_t before, after;
+    do {
+      before = slot->sequence.load(std::memory_order_acquire);
+      stamp_ns = slot->stamp_ns.load(std::memory_order_relaxed);
+      for (int i = 0; i < 7; ++i) {
+        values[i] = slot->values[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = slot->sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    // nothing was written yet
+    if (before == 0) {
+      return false;
+    }
+
+    pose.header.frame_id = global_frame;
+    pose.header.stamp = rclcpp::Time(stamp_ns);
+    pose.pose.position.x = values[0];
+    pose.pose.position.y = values[1];
+    pose.pose.position.z = values[2];
+    pose.pose.orientation.x = values[3];
+    pose.pose.orientation.y = values[4];
+    pose.pose.orientation.z = values[5];
+    pose.pose.orientation.w = values[6];
+    return true;
+  }
+  return false;
+}
+
+void PoseCache::refresh()
+{
+  for (auto & slot : slots_) {
+    geometry_msgs::msg::TransformStamped transform;
+    try {
+      transform = tf_buffer_.lookupTransform(slot->global_frame, robot_frame_,
+          tf2::TimePointZero);
+    } catch (tf2::TransformException &) {
+      // not connected yet, which the readers see as no pose
+      continue;
+    }
+
+    // the only writer, so the count is odd exactly while it writes
+    uint32_t sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->stamp_ns.store(rclcpp::Time(transform.header.stamp).nanoseconds(),
+      std::memory_order_relaxed);
+    const auto & t = transform.transform.translation;
+    const auto & q = transform.transform.rotation;
+    const double values[7] = {t.x, t.y, t.z, q.x, q.y, q.z, q.w};
+    for (int i = 0; i < 7; ++i) {
+      slot->values[i].store(values[i], std::memory_order_relaxed);
+    }
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+  }
+}
+
+}  // namespace nav2_util
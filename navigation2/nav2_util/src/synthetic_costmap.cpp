@@ -0,0 +1,488 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/synthetic_costmap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "nav2_util/costmap.hpp"
+#include "nav2_util/string_utils.hpp"
+
+namespace nav2_util
+{
+
+namespace
+{
+
+const uint8_t FREE = Costmap::free_space;
+const uint8_t LETHAL = Costmap::lethal_obstacle;
+
+// The scattered obstacles are placed a tile at a time
+const unsigned int TILE = 64;
+
+// Beyond this, the costs of the inflation wouldn't fit a table
+const unsigned int MAX_INFLATION_CELLS = 4096;
+
+// Run fn(begin, end) on parts of [0, count), each on a thread of its own
+template<typename Fn>
+void parallel_for(unsigned int count, unsigned int threads, Fn fn)
+{
+  threads = std::max(1u, std::min(threads, count));
+  if (threads == 1) {
+    fn(0u, count);
+    return;
+  }
+  std::vector<std::thread> workers;
+  for (unsigned int t = 0; t < threads; ++t) {
+    auto begin = static_cast<unsigned int>(static_cast<uint64_t>(count) * t / threads);
+    auto end = static_cast<unsigned int>(static_cast<uint64_t>(count) * (t + 1) / threads);
+    workers.emplace_back(fn, begin, end);
+  }
+  for (auto & worker : workers) {
+    worker.join();
+  }
+}
+
+// A generator for each part of the map, so the parts can be built in any order
+std::mt19937 part_generator(uint32_t seed, uint32_t a, uint32_t b)
+{
+  std::seed_seq sequence{seed, a, b};
+  return std::mt19937(sequence);
+}
+
+void fill(
+  std::vector<uint8_t> & grid, unsigned int size_x,
+  unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, uint8_t cost)
+{
+  for (unsigned int y = y0; y < y1; ++y) {
+    std::fill(grid.begin() + (static_cast<size_t>(y) * size_x + x0),
+      grid.begin() + (static_cast<size_t>(y) * size_x + x1), cost);
+  }
+}
+
+void scatter(const SyntheticMapSpec & spec, unsigned int threads, std::vector<uint8_t> & grid)
+{
+  const unsigned int tiles_x = (spec.size_x + TILE - 1) / TILE;
+  const unsigned int tiles_y = (spec.size_y + TILE - 1) / TILE;
+  parallel_for(tiles_y, threads, [&](unsigned int begin, unsigned int end) {
+      for (unsigned int ty = begin; ty < end; ++ty) {
+        for (unsigned int tx = 0; tx < tiles_x; ++tx) {
+          const unsigned int x0 = tx * TILE;
+          const unsigned int y0 = ty * TILE;
+          const unsigned int width = std::min(TILE, spec.size_x - x0);
+          const unsigned int height = std::min(TILE, spec.size_y - y0);
+          const auto area = width * height;
+          const auto target = static_cast<unsigned int>(spec.density * area);
+
+          // obstacles are clipped to their tile, and may overlap
+          std::mt19937 generator = part_generator(spec.seed, tx, ty);
+          std::uniform_int_distribution<unsigned int> side(1, spec.obstacle_size);
+          std::uniform_int_distribution<unsigned int> at_x(0, width - 1);
+          std::uniform_int_distribution<unsigned int> at_y(0, height - 1);
+          unsigned int covered = 0;
+          for (unsigned int attempt = 0; covered < target && attempt < 4 * area; ++attempt) {
+            const unsigned int x = at_x(generator);
+            const unsigned int y = at_y(generator);
+            const unsigned int x_end = std::min(width, x + side(generator));
+            const unsigned int y_end = std::min(height, y + side(generator));
+            for (unsigned int j = y; j < y_end; ++j) {
+              uint8_t * row = &grid[static_cast<size_t>(y0 + j) * spec.size_x + x0];
+              for (unsigned int i = x; i < x_end; ++i) {
+                covered += row[i] != LETHAL;
+                row[i] = LETHAL;
+              }
+            }
+          }
+        }
+      }
+    });
+}
+
+// Where the blocks between the corridors start and end along a side of the map
+std::vector<std::pair<unsigned int, unsigned int>> block_spans(
+  const SyntheticMapSpec & spec, unsigned int size, uint32_t axis)
+{
+  const unsigned int corridor = spec.corridor_width;
+  const unsigned int shortest = std::max(2 * corridor, 2 * spec.wall_width + corridor);
+  std::mt19937 generator = part_generator(spec.seed, std::numeric_limits<uint32_t>::max(), axis);
+  std::uniform_int_distribution<unsigned int> length(shortest, 3 * shortest);
+
+  std::vector<std::pair<unsigned int, unsigned int>> spans;
+  if (size < 2 * (spec.wall_width + corridor)) {
+    return spans;
+  }
+  const unsigned int last = size - spec.wall_width - corridor;
+  for (unsigned int start = spec.wall_width + corridor; start < last; ) {
+    const unsigned int end = std::min(last, start + length(generator));
+    spans.emplace_back(start, end);
+    start = end + corridor;
+  }
+  return spans;
+}
+
+void build_corridors(
+  const SyntheticMapSpec & spec, unsigned int threads, std::vector<uint8_t> & grid)
+{
+  const unsigned int wall = spec.wall_width;
+  const auto columns = block_spans(spec, spec.size_x, 0);
+  const auto rows = block_spans(spec, spec.size_y, 1);
+  const auto block_rows = static_cast<unsigned int>(rows.size());
+  parallel_for(block_rows, threads, [&](unsigned int begin, unsigned int end) {
+      for (unsigned int by = begin; by < end; ++by) {
+        for (unsigned int bx = 0; bx < columns.size(); ++bx) {
+          const unsigned int x0 = columns[bx].first;
+          const unsigned int x1 = columns[bx].second;
+          const unsigned int y0 = rows[by].first;
+          const unsigned int y1 = rows[by].second;
+          if (x1 - x0 <= 2 * wall || y1 - y0 <= 2 * wall) {
+            fill(grid, spec.size_x, x0, y0, x1, y1, LETHAL);
+            continue;
+          }
+
+          // a walled room with a door onto at least one of the corridors around it
+          fill(grid, spec.size_x, x0, y0, x1, y0 + wall, LETHAL);
+          fill(grid, spec.size_x, x0, y1 - wall, x1, y1, LETHAL);
+          fill(grid, spec.size_x, x0, y0, x0 + wall, y1, LETHAL);
+          fill(grid, spec.size_x, x1 - wall, y0, x1, y1, LETHAL);
+          std::mt19937 generator = part_generator(spec.seed, bx, by);
+          const unsigned int sides = std::uniform_int_distribution<unsigned int>(1, 15)(generator);
+          auto door = [&](unsigned int length) {
+              const unsigned int width = std::min(spec.corridor_width, length - 2 * wall);
+              const unsigned int at = std::uniform_int_distribution<unsigned int>(
+                wall, length - wall - width)(generator);
+              return std::make_pair(at, at + width);
+            };
+          if (sides & 1) {
+            auto gap = door(x1 - x0);
+            fill(grid, spec.size_x, x0 + gap.first, y0, x0 + gap.second, y0 + wall, FREE);
+          }
+          if (sides & 2) {
+            auto gap = door(x1 - x0);
+            fill(grid, spec.size_x, x0 + gap.first, y1 - wall, x0 + gap.second, y1, FREE);
+          }
+          if (sides & 4) {
+            auto gap = door(y1 - y0);
+            fill(grid, spec.size_x, x0, y0 + gap.first, x0 + wall, y0 + gap.second, FREE);
+          }
+          if (sides & 8) {
+            auto gap = door(y1 - y0);
+            fill(grid, spec.size_x, x1 - wall, y0 + gap.first, x1, y0 + gap.second, FREE);
+          }
+        }
+      }
+    });
+}
+
+void build_maze(const SyntheticMapSpec & spec, unsigned int threads, std::vector<uint8_t> & grid)
+{
+  const unsigned int wall = spec.wall_width;
+  const unsigned int pitch = spec.corridor_width + wall;
+  const unsigned int cells_x = (spec.size_x - wall) / pitch;
+  const unsigned int cells_y = (spec.size_y - wall) / pitch;
+  if (cells_x == 0 || cells_y == 0) {
+    throw std::invalid_argument("the map is too small for a corridor of the maze");
+  }
+
+  // a depth first walk from a corner, opening the wall to the east or north of each cell
+  // it leaves for one it hasn't been to
+  const uint8_t EAST = 1, NORTH = 2, VISITED = 4;
+  std::vector<uint8_t> cells(static_cast<size_t>(cells_x) * cells_y, 0);
+  std::mt19937 generator = part_generator(spec.seed, std::numeric_limits<uint32_t>::max(), 2);
+  std::vector<size_t> path = {0};
+  cells[0] = VISITED;
+  while (!path.empty()) {
+    const size_t cell = path.back();
+    const unsigned int x = cell % cells_x;
+    const unsigned int y = cell / cells_x;
+    size_t next[4];
+    int count = 0;
+    if (x > 0 && !(cells[cell - 1] & VISITED)) {next[count++] = cell - 1;}
+    if (x + 1 < cells_x && !(cells[cell + 1] & VISITED)) {next[count++] = cell + 1;}
+    if (y > 0 && !(cells[cell - cells_x] & VISITED)) {next[count++] = cell - cells_x;}
+    if (y + 1 < cells_y && !(cells[cell + cells_x] & VISITED)) {next[count++] = cell + cells_x;}
+    if (count == 0) {
+      path.pop_back();
+      continue;
+    }
+    const size_t to = next[std::uniform_int_distribution<int>(0, count - 1)(generator)];
+    if (to == cell + 1) {
+      cells[cell] |= EAST;
+    } else if (to == cell - 1) {
+      cells[to] |= EAST;
+    } else if (to == cell + cells_x) {
+      cells[cell] |= NORTH;
+    } else {
+      cells[to] |= NORTH;
+    }
+    cells[to] |= VISITED;
+    path.push_back(to);
+  }
+
+  std::fill(grid.begin(), grid.end(), LETHAL);
+  parallel_for(cells_y, threads, [&](unsigned int begin, unsigned int end) {
+      for (unsigned int y = begin; y < end; ++y) {
+        const unsigned int y0 = wall + y * pitch;
+        const unsigned int y1 = y0 + spec.corridor_width;
+        for (unsigned int x = 0; x < cells_x; ++x) {
+          const unsigned int x0 = wall + x * pitch;
+          const unsigned int x1 = x0 + spec.corridor_width;
+          const uint8_t cell = cells[static_cast<size_t>(y) * cells_x + x];
+          fill(grid, spec.size_x, x0, y0, x1, y1, FREE);
+          if (cell & EAST) {
+            fill(grid, spec.size_x, x1, y0, x1 + wall, y1, FREE);
+          }
+          if (cell & NORTH) {
+            fill(grid, spec.size_x, x0, y1, x1, y1 + wall, FREE);
+          }
+        }
+      }
+    });
+}
+
+// Inflate from the exact distance of each cell to the nearest lethal one: the distances
+// down the columns, then the lower envelope of the parabolas along the rows (Felzenszwalb
+// and Huttenlocher), which both split between threads with no ordering between them
+void inflate(const SyntheticMapSpec & spec, unsigned int threads, std::vector<uint8_t> & grid)
+{
+  const unsigned int size_x = spec.size_x;
+  const unsigned int size_y = spec.size_y;
+  const auto radius = static_cast<unsigned int>(std::ceil(spec.inflation_radius /
+    spec.resolution));
+  if (radius > MAX_INFLATION_CELLS) {
+    throw std::invalid_argument("an inflation radius of more than " +
+            std::to_string(MAX_INFLATION_CELLS) + " cells");
+  }
+
+  // the costs of the inflation layer, by squared distance in cells
+  const size_t reach = static_cast<size_t>(radius) * radius;
+  std::vector<uint8_t> costs(reach + 1, FREE);
+  costs[0] = LETHAL;
+  for (size_t d2 = 1; d2 <= reach; ++d2) {
+    const double distance = std::sqrt(static_cast<double>(d2)) * spec.resolution;
+    if (distance > spec.inflation_radius) {
+      continue;
+    }
+    if (distance <= spec.inscribed_radius) {
+      costs[d2] = Costmap::inscribed_inflated_obstacle;
+    } else {
+      costs[d2] = static_cast<uint8_t>((Costmap::inscribed_inflated_obstacle - 1) *
+        std::exp(-spec.cost_scaling_factor * (distance - spec.inscribed_radius)));
+    }
+  }
+
+  // rows down a column to a lethal cell, past the radius being as good as any
+  const auto far = static_cast<uint16_t>(radius + 1);
+  std::vector<uint16_t> rows(grid.size());
+  parallel_for(size_x, threads, [&](unsigned int begin, unsigned int end) {
+      for (unsigned int x = begin; x < end; ++x) {
+        rows[x] = grid[x] == LETHAL ? 0 : far;
+      }
+      for (unsigned int y = 1; y < size_y; ++y) {
+        const size_t row = static_cast<size_t>(y) * size_x;
+        for (unsigned int x = begin; x < end; ++x) {
+          if (grid[row + x] == LETHAL) {
+            rows[row + x] = 0;
+          } else {
+            rows[row + x] = std::min<uint16_t>(far, rows[row - size_x + x] + 1);
+          }
+        }
+      }
+      for (unsigned int y = size_y - 1; y-- > 0; ) {
+        const size_t row = static_cast<size_t>(y) * size_x;
+        for (unsigned int x = begin; x < end; ++x) {
+          rows[row + x] = std::min<uint16_t>(rows[row + x], rows[row + size_x + x] + 1);
+        }
+      }
+    });
+
+  parallel_for(size_y, threads, [&](unsigned int begin, unsigned int end) {
+      std::vector<int64_t> f(size_x);
+      std::vector<unsigned int> v(size_x);
+      std::vector<double> z(size_x + 1);
+      for (unsigned int y = begin; y < end; ++y) {
+        const size_t row = static_cast<size_t>(y) * size_x;
+        bool near = false;
+        for (unsigned int x = 0; x < size_x; ++x) {
+          f[x] = static_cast<int64_t>(rows[row + x]) * rows[row + x];
+          near |= rows[row + x] < far;
+        }
+        if (!near) {
+          continue;
+        }
+
+        unsigned int k = 0;
+        v[0] = 0;
+        z[0] = -std::numeric_limits<double>::infinity();
+        z[1] = std::numeric_limits<double>::infinity();
+        for (unsigned int q = 1; q < size_x; ++q) {
+          auto meet = [&](int64_t p) {
+              return static_cast<double>((f[q] + static_cast<int64_t>(q) * q) - (f[p] + p * p)) /
+                     (2.0 * (q - p));
+            };
+          double s = meet(v[k]);
+          while (s <= z[k]) {
+            --k;
+            s = meet(v[k]);
+          }
+          ++k;
+          v[k] = q;
+          z[k] = s;
+          z[k + 1] = std::numeric_limits<double>::infinity();
+        }
+
+        k = 0;
+        for (unsigned int x = 0; x < size_x; ++x) {
+          while (z[k + 1] < x) {
+            ++k;
+          }
+          const int64_t dx = static_cast<int64_t>(x) - v[k];
+          const auto d2 = static_cast<size_t>(dx * dx + f[v[k]]);
+          if (d2 <= reach) {
+            grid[row + x] = std::max(grid[row + x], costs[d2]);
+          }
+        }
+      }
+    });
+}
+
+bool parse_number(const std::string & text, double & value)
+{
+  char * end;
+  value = std::strtod(text.c_str(), &end);
+  return !text.empty() && *end == '\0';
+}
+
+}  // namespace
+
+std::vector<uint8_t> generate_synthetic_costmap(const SyntheticMapSpec & spec)
+{
+  if (spec.size_x == 0 || spec.size_y == 0) {
+    throw std::invalid_argument("a synthetic map needs cells");
+  }
+  if (spec.resolution <= 0.0) {
+    throw std::invalid_argument("a synthetic map needs a positive resolution");
+  }
+  if (spec.density < 0.0 || spec.density > 1.0) {
+    throw std::invalid_argument("the density of a synthetic map is a fraction");
+  }
+  if (spec.obstacle_size == 0 || spec.corridor_width == 0) {
+    throw std::invalid_argument("the obstacles and corridors of a synthetic map need cells");
+  }
+  if (spec.style == SyntheticStyle::maze && spec.wall_width == 0) {
+    throw std::invalid_argument("a maze needs walls");
+  }
+
+  unsigned int threads = spec.threads;
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  std::vector<uint8_t> grid(static_cast<size_t>(spec.size_x) * spec.size_y, FREE);
+  switch (spec.style) {
+    case SyntheticStyle::scattered:
+      scatter(spec, threads, grid);
+      break;
+    case SyntheticStyle::corridors:
+      build_corridors(spec, threads, grid);
+      fill(grid, spec.size_x, 0, 0, spec.size_x, std::min(spec.wall_width, spec.size_y), LETHAL);
+      fill(grid, spec.size_x, 0, spec.size_y - std::min(spec.wall_width, spec.size_y),
+        spec.size_x, spec.size_y, LETHAL);
+      fill(grid, spec.size_x, 0, 0, std::min(spec.wall_width, spec.size_x), spec.size_y, LETHAL);
+      fill(grid, spec.size_x, spec.size_x - std::min(spec.wall_width, spec.size_x), 0,
+        spec.size_x, spec.size_y, LETHAL);
+      break;
+    case SyntheticStyle::maze:
+      build_maze(spec, threads, grid);
+      break;
+  }
+  if (spec.inflation_radius > 0.0) {
+    inflate(spec, threads, grid);
+  }
+  return grid;
+}
+
+bool parse_synthetic_map_spec(
+  const std::string & text, SyntheticMapSpec & spec, std::string & error)
+{
+  Tokens fields = split(text, ':');
+  SyntheticMapSpec parsed;
+  if (fields[0] == "scattered") {
+    parsed.style = SyntheticStyle::scattered;
+  } else if (fields[0] == "corridors") {
+    parsed.style = SyntheticStyle::corridors;
+  } else if (fields[0] == "maze") {
+    parsed.style = SyntheticStyle::maze;
+  } else {
+    error = "no style " + fields[0] + ", only scattered, corridors and maze";
+    return false;
+  }
+
+  if (fields.size() < 2 ||
+    sscanf(fields[1].c_str(), "%ux%u", &parsed.size_x, &parsed.size_y) != 2)
+  {
+    error = "no <size_x>x<size_y> after the style";
+    return false;
+  }
+
+  for (size_t i = 2; i < fields.size(); ++i) {
+    const size_t equals = fields[i].find('=');
+    const std::string key = fields[i].substr(0, equals);
+    double value;
+    if (equals == std::string::npos || !parse_number(fields[i].substr(equals + 1), value) ||
+      value < 0.0)
+    {
+      error = "no number for " + key;
+      return false;
+    }
+    if (key == "resolution") {
+      parsed.resolution = value;
+    } else if (key == "seed") {
+      parsed.seed = static_cast<uint32_t>(value);
+    } else if (key == "density") {
+      parsed.density = value;
+    } else if (key == "obstacle") {
+      parsed.obstacle_size = static_cast<unsigned int>(value);
+    } else if (key == "corridor") {
+      parsed.corridor_width = static_cast<unsigned int>(value);
+    } else if (key == "wall") {
+      parsed.wall_width = static_cast<unsigned int>(value);
+    } else if (key == "inflation") {
+      parsed.inflation_radius = value;
+    } else if (key == "inscribed") {
+      parsed.inscribed_radius = value;
+    } else if (key == "scaling") {
+      parsed.cost_scaling_factor = value;
+    } else if (key == "threads") {
+      parsed.threads = static_cast<unsigned int>(value);
+    } else {
+      error = "no key " + key;
+      return false;
+    }
+  }
+
+  spec = parsed;
+  return true;
+}
+
+}  // namespace nav2_util
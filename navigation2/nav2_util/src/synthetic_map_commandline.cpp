@@ -0,0 +1,89 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "nav2_util/costmap.hpp"
+#include "nav2_util/synthetic_costmap.hpp"
+
+using std::cerr;
+
+void usage()
+{
+  cerr << "Invalid command line.\n\n";
+  cerr << "Writes a synthetic map as map_server's <name>.pgm and <name>.yaml, for the tools\n";
+  cerr << "that read maps from files\n\n";
+  cerr << "Usage:\n";
+  cerr << " > synthetic_map <style>:<size_x>x<size_y>[:<key>=<value>...] <name>\n";
+  std::exit(1);
+}
+
+int main(int argc, char * argv[])
+{
+  if (argc != 3) {
+    usage();
+  }
+
+  nav2_util::SyntheticMapSpec spec;
+  std::string error;
+  if (!nav2_util::parse_synthetic_map_spec(argv[1], spec, error)) {
+    cerr << "Could not read " << argv[1] << ": " << error << "\n";
+    return 1;
+  }
+  std::vector<uint8_t> costs;
+  try {
+    costs = nav2_util::generate_synthetic_costmap(spec);
+  } catch (const std::invalid_argument & e) {
+    cerr << "Could not generate " << argv[1] << ": " << e.what() << "\n";
+    return 1;
+  }
+
+  // occupied, unknown and free as map_saver writes them, the top row first
+  const std::string name = argv[2];
+  std::ofstream image(name + ".pgm", std::ios::binary);
+  image << "P5\n# " << argv[1] << "\n" << spec.size_x << " " << spec.size_y << "\n255\n";
+  std::vector<char> row(spec.size_x);
+  for (unsigned int y = spec.size_y; y-- > 0; ) {
+    for (unsigned int x = 0; x < spec.size_x; ++x) {
+      const uint8_t cost = costs[static_cast<size_t>(y) * spec.size_x + x];
+      if (cost == nav2_util::Costmap::lethal_obstacle) {
+        row[x] = static_cast<char>(0);
+      } else if (cost == nav2_util::Costmap::no_information) {
+        row[x] = static_cast<char>(205);
+      } else {
+        row[x] = static_cast<char>(254);
+      }
+    }
+    image.write(row.data(), row.size());
+  }
+
+  std::ofstream yaml(name + ".yaml");
+  yaml << "image: " << name.substr(name.find_last_of('/') + 1) << ".pgm\n";
+  yaml << "resolution: " << spec.resolution << "\n";
+  yaml << "origin: [0.0, 0.0, 0.0]\n";
+  yaml << "negate: 0\n";
+  yaml << "occupied_thresh: 0.65\n";
+  yaml << "free_thresh: 0.196\n";
+
+  if (!image.good() || !yaml.good()) {
+    cerr << "Could not write " << name << ".pgm and " << name << ".yaml\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/thread_utils.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace nav2_util
+{
+
+bool setThreadPriority(int priority, std::string & error)
+{
+  if (priority == 0) {
+    return true;
+  }
+  const int min = sched_get_priority_min(SCHED_FIFO);
+  const int max = sched_get_priority_max(SCHED_FIFO);
+  if (priority < min || priority > max) {
+    error = "priority " + std::to_string(priority) + " is outside " + std::to_string(min) +
+      " to " + std::to_string(max);
+    return false;
+  }
+  sched_param param{};
+  param.sched_priority = priority;
+  const int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (result != 0) {
+    error = std::strerror(result);
+    return false;
+  }
+  return true;
+}
+
+bool setThreadAffinity(const std::vector<int> & cpus, std::string & error)
+{
+  if (cpus.empty()) {
+    return true;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      error = "there is no CPU " + std::to_string(cpu);
+      return false;
+    }
+    CPU_SET(cpu, &set);
+  }
+  const int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (result != 0) {
+    error = std::strerror(result);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace nav2_util
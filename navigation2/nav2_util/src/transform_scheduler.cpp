@@ -0,0 +1,342 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/transform_scheduler.hpp"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nav2_util
+{
+
+// What addTransformableRequest() returns for a time the buffer has already let go of
+static const tf2::TransformableRequestHandle never_transformable = 0xffffffffffffffffULL;
+
+class TransformScheduler::Channel
+{
+public:
+  std::vector<std::string> target_frames;
+  size_t queue_size;  ///< 0 for no limit
+  tf2::Duration tolerance;
+  std::function<void()> on_drop;
+
+  std::deque<EntryPtr> queue;  ///< The messages waiting, oldest first, some maybe done
+  size_t waiting{0};
+  std::atomic<bool> removed{false};
+};
+
+struct TransformScheduler::Entry
+{
+  ChannelPtr channel;
+  std::string source_frame;
+  tf2::TimePoint stamp;  ///< The message's stamp, and the channel's tolerance
+  std::function<void()> dispatch;
+  size_t target{0};  ///< The first target frame not yet known to be transformable
+  bool queued{false};
+  bool done{false};
+};
+
+TransformScheduler::TransformScheduler(tf2::BufferCore & buffer)
+: buffer_(buffer)
+{
+  callback_handle_ = buffer_.addTransformableCallback(
+    [this](tf2::TransformableRequestHandle request, const std::string &, const std::string &,
+    tf2::TimePoint stamp, tf2::TransformableResult result) {
+      onTransformable(Answer{request, stamp, result});
+    });
+  worker_ = std::thread(&TransformScheduler::work, this);
+}
+
+TransformScheduler::~TransformScheduler()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto & request : requests_) {
+      buffer_.cancelTransformableRequest(request.first);
+    }
+    requests_.clear();
+  }
+  buffer_.removeTransformableCallback(callback_handle_);
+
+  {
+    std::lock_guard<std::mutex> lock(answers_mutex_);
+    stop_ = true;
+  }
+  answers_cv_.notify_all();
+  worker_.join();
+}
+
+std::shared_ptr<TransformScheduler> TransformScheduler::forBuffer(tf2::BufferCore & buffer)
+{
+  static std::mutex registry_mutex;
+  static std::map<tf2::BufferCore *, std::weak_ptr<TransformScheduler>> registry;
+
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for (auto it = registry.begin(); it != registry.end(); ) {
+    it = it->second.expired() ? registry.erase(it) : std::next(it);
+  }
+  auto scheduler = registry[&buffer].lock();
+  if (!scheduler) {
+    scheduler = std::make_shared<TransformScheduler>(buffer);
+    registry[&buffer] = scheduler;
+  }
+  return scheduler;
+}
+
+TransformScheduler::ChannelPtr TransformScheduler::addChannel(
+  const std::vector<std::string> & target_frames, size_t queue_size,
+  tf2::Duration tolerance, std::function<void()> on_drop)
+{
+  auto channel = std::make_shared<Channel>();
+  channel->target_frames = target_frames;
+  channel->queue_size = queue_size;
+  channel->tolerance = tolerance;
+  channel->on_drop = std::move(on_drop);
+  return channel;
+}
+
+void TransformScheduler::removeChannel(const ChannelPtr & channel)
+{
+  if (!channel) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    channel->removed = true;
+    for (const auto & entry : channel->queue) {
+      if (!entry->done) {
+        entry->done = true;
+        waiting_--;
+      }
+    }
+    channel->queue.clear();
+    channel->waiting = 0;
+  }
+
+  // wait out a dispatch underway, which may have been taken before the channel was removed
+  std::lock_guard<std::mutex> lock(dispatch_mutex_);
+}
+
+void TransformScheduler::schedule(
+  const ChannelPtr & channel, const std::string & source_frame, tf2::TimePoint stamp,
+  std::function<void()> dispatch)
+{
+  auto entry = std::make_shared<Entry>();
+  entry->channel = channel;
+  entry->source_frame = source_frame;
+  entry->stamp = stamp + channel->tolerance;
+  entry->dispatch = std::move(dispatch);
+
+  Dispatches ready;
+  Drops drops;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (channel->removed) {
+      return;
+    }
+    advance(entry, ready, drops);
+  }
+  run(ready, drops);
+}
+
+size_t TransformScheduler::waiting() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return waiting_;
+}
+
+void TransformScheduler::advance(const EntryPtr & entry, Dispatches & ready, Drops & drops)
+{
+  const auto & targets = entry->channel->target_frames;
+  while (entry->target < targets.size() &&
+    buffer_.canTransform(targets[entry->target], entry->source_frame, entry->stamp))
+  {
+    entry->target++;
+  }
+
+  if (entry->target < targets.size()) {
+    enqueue(entry, ready, drops);
+    return;
+  }
+  finish(entry);
+  ready.push_back(entry);
+}
+
+void TransformScheduler::enqueue(const EntryPtr & entry, Dispatches & ready, Drops & drops)
+{
+  Channel & channel = *entry->channel;
+  if (!entry->queued) {
+    entry->queued = true;
+    channel.queue.push_back(entry);
+    channel.waiting++;
+    waiting_++;
+    // the front is never done, finish() popping those that are
+    while (channel.queue_size != 0 && channel.waiting > channel.queue_size) {
+      EntryPtr oldest = channel.queue.front();
+      drop(oldest, drops);
+    }
+    if (entry->done) {
+      return;
+    }
+  }
+
+  GroupKey key(channel.target_frames[entry->target], entry->source_frame);
+  Group & group = groups_[key];
+  group.waiting.emplace(entry->stamp, entry);
+  if (group.request == 0) {
+    process(key, group, ready, drops, nullptr);
+  }
+}
+
+void TransformScheduler::process(
+  const GroupKey & key, Group & group, Dispatches & ready, Drops & drops,
+  const tf2::TimePoint * failed_stamp)
+{
+  tf2::TimePoint failed;
+  bool earliest_transformable = false;  // as the buffer has just said
+  for (;; ) {
+    while (!group.waiting.empty()) {
+      auto it = group.waiting.begin();
+      EntryPtr entry = it->second;
+      if (entry->done) {
+        group.waiting.erase(it);
+        continue;
+      }
+      if (failed_stamp && it->first <= *failed_stamp) {
+        group.waiting.erase(it);
+        drop(entry, drops);
+        continue;
+      }
+      if (!earliest_transformable && !buffer_.canTransform(key.first, key.second, it->first)) {
+        break;
+      }
+      earliest_transformable = false;
+      group.waiting.erase(it);
+      entry->target++;
+      advance(entry, ready, drops);
+    }
+
+    // one request for the group, whose answer covers the messages stamped before it too
+    if (group.waiting.empty() || group.request != 0) {
+      return;
+    }
+    tf2::TimePoint stamp = group.waiting.begin()->first;
+    tf2::TransformableRequestHandle request =
+      buffer_.addTransformableRequest(callback_handle_, key.first, key.second, stamp);
+    if (request == 0) {
+      // it came in since it was checked
+      earliest_transformable = true;
+      failed_stamp = nullptr;
+    } else if (request == never_transformable) {
+      failed = stamp;
+      failed_stamp = &failed;
+    } else {
+      group.request = request;
+      requests_[request] = key;
+      return;
+    }
+  }
+}
+
+void TransformScheduler::finish(const EntryPtr & entry)
+{
+  if (entry->done) {
+    return;
+  }
+  entry->done = true;
+  if (!entry->queued) {
+    return;
+  }
+  Channel & channel = *entry->channel;
+  channel.waiting--;
+  waiting_--;
+  while (!channel.queue.empty() && channel.queue.front()->done) {
+    channel.queue.pop_front();
+  }
+}
+
+void TransformScheduler::drop(const EntryPtr & entry, Drops & drops)
+{
+  finish(entry);
+  if (entry->channel->on_drop) {
+    drops.push_back(entry->channel->on_drop);
+  }
+}
+
+void TransformScheduler::run(const Dispatches & ready, const Drops & drops)
+{
+  for (const auto & on_drop : drops) {
+    on_drop();
+  }
+  for (const auto & entry : ready) {
+    if (!entry->channel->removed) {
+      entry->dispatch();
+    }
+  }
+}
+
+void TransformScheduler::onTransformable(const Answer & answer)
+{
+  {
+    std::lock_guard<std::mutex> lock(answers_mutex_);
+    answers_.push_back(answer);
+  }
+  answers_cv_.notify_one();
+}
+
+void TransformScheduler::work()
+{
+  std::vector<Answer> answers;
+  for (;; ) {
+    {
+      std::unique_lock<std::mutex> lock(answers_mutex_);
+      answers_cv_.wait(lock, [this]() {return stop_ || !answers_.empty();});
+      if (stop_) {
+        return;
+      }
+      answers.swap(answers_);
+    }
+
+    Dispatches ready;
+    Drops drops;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (const auto & answer : answers) {
+        auto request = requests_.find(answer.request);
+        if (request == requests_.end()) {
+          continue;
+        }
+        GroupKey key = request->second;
+        requests_.erase(request);
+        Group & group = groups_[key];
+        group.request = 0;
+        process(key, group, ready, drops,
+          answer.result == tf2::TransformAvailable ? nullptr : &answer.stamp);
+      }
+    }
+    answers.clear();
+
+    std::lock_guard<std::mutex> lock(dispatch_mutex_);
+    run(ready, drops);
+  }
+}
+
+}  // namespace nav2_util
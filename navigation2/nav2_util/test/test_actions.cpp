@@ -14,6 +14,7 @@
 
 #include <chrono>
 #include <memory>
+#include <string>
 #include <thread>
 
 #include "gtest/gtest.h"
@@ -30,8 +31,10 @@ using namespace std::chrono_literals;
 class FibonacciServerNode : public rclcpp::Node
 {
 public:
-  FibonacciServerNode()
-  : rclcpp::Node("fibonacci_server_node")
+  explicit FibonacciServerNode(
+    const std::string & action_name = "fibonacci", bool persistent_worker = false)
+  : rclcpp::Node(action_name + "_server_node"), action_name_(action_name),
+    persistent_worker_(persistent_worker)
   {
   }
 
@@ -43,8 +46,9 @@ public:
   {
     action_server_ = std::make_unique<nav2_util::SimpleActionServer<Fibonacci>>(
       shared_from_this(),
-      "fibonacci",
-      std::bind(&FibonacciServerNode::execute, this));
+      action_name_,
+      std::bind(&FibonacciServerNode::execute, this),
+      true, persistent_worker_);
   }
 
   void on_term()
@@ -97,6 +101,8 @@ preempted:
   }
 
 private:
+  std::string action_name_;
+  bool persistent_worker_;
   std::unique_ptr<nav2_util::SimpleActionServer<Fibonacci>> action_server_;
 };
 
@@ -120,7 +126,16 @@ public:
   {
     auto node = std::make_shared<FibonacciServerNode>();
     node->on_init();
-    rclcpp::spin(node->get_node_base_interface());
+    auto persistent_node = std::make_shared<FibonacciServerNode>("fibonacci_persistent", true);
+    persistent_node->on_init();
+
+    rclcpp::executors::SingleThreadedExecutor executor;
+    executor.add_node(node->get_node_base_interface());
+    executor.add_node(persistent_node->get_node_base_interface());
+    executor.spin();
+
+    persistent_node->on_term();
+    persistent_node.reset();
     node->on_term();
     node.reset();
   }
@@ -142,14 +157,19 @@ public:
   {
     action_client_ = rclcpp_action::create_client<Fibonacci>(shared_from_this(), "fibonacci");
     action_client_->wait_for_action_server();
+    persistent_client_ =
+      rclcpp_action::create_client<Fibonacci>(shared_from_this(), "fibonacci_persistent");
+    persistent_client_->wait_for_action_server();
   }
 
   void on_term()
   {
+    persistent_client_.reset();
     action_client_.reset();
   }
 
   rclcpp_action::Client<Fibonacci>::SharedPtr action_client_;
+  rclcpp_action::Client<Fibonacci>::SharedPtr persistent_client_;
 };
 
 class ActionTest : public ::testing::Test
@@ -245,3 +265,32 @@ TEST_F(ActionTest, test_simple_action_with_feedback)
   ASSERT_EQ(sum, 143);
   ASSERT_GE(feedback_sum, 0);  // We should have received *some* feedback
 }
+
+TEST_F(ActionTest, test_persistent_worker)
+{
+  // The worker thread executes one goal after the other
+  for (int i = 0; i < 2; ++i) {
+    auto goal = Fibonacci::Goal();
+    goal.order = 12;
+
+    auto future_goal_handle = node_->persistent_client_->async_send_goal(goal);
+    ASSERT_EQ(rclcpp::spin_until_future_complete(node_,
+      future_goal_handle), rclcpp::executor::FutureReturnCode::SUCCESS);
+
+    auto goal_handle = future_goal_handle.get();
+
+    auto future_result = node_->persistent_client_->async_get_result(goal_handle);
+    ASSERT_EQ(rclcpp::spin_until_future_complete(node_, future_result),
+      rclcpp::executor::FutureReturnCode::SUCCESS);
+
+    rclcpp_action::ClientGoalHandle<Fibonacci>::WrappedResult result = future_result.get();
+    ASSERT_EQ(result.code, rclcpp_action::ResultCode::SUCCEEDED);
+
+    int sum = 0;
+    for (auto number : result.result->sequence) {
+      sum += number;
+    }
+
+    ASSERT_EQ(sum, 376);
+  }
+}
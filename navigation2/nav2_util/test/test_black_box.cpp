@@ -0,0 +1,125 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "gtest/gtest.h"
+#include "nav2_util/black_box.hpp"
+
+using nav2_util::BlackBox;
+using nav2_util::BlackBoxLog;
+
+static std::string segmentName(const std::string & test)
+{
+  return "nav2_test_black_box_" + test + "_" + std::to_string(getpid());
+}
+
+static geometry_msgs::msg::PoseStamped makePose(int i)
+{
+  geometry_msgs::msg::PoseStamped pose;
+  pose.header.frame_id = "odom";
+  pose.header.stamp.sec = i;
+  pose.pose.position.x = i * 0.5;
+  return pose;
+}
+
+TEST(BlackBox, RecordsNothingUntilOpened)
+{
+  BlackBox black_box;
+  int channel = black_box.channel("pose", "geometry_msgs/msg/PoseStamped");
+  EXPECT_EQ(channel, 0);
+  EXPECT_EQ(black_box.channel("pose", "geometry_msgs/msg/PoseStamped"), channel);
+  black_box.record(channel, makePose(1));
+  EXPECT_FALSE(black_box.save("/tmp/" + segmentName("closed")));
+
+  ASSERT_TRUE(black_box.open(segmentName("closed"), 1 << 20));
+  black_box.record(channel, makePose(2));
+
+  std::string filename = "/tmp/" + segmentName("closed") + ".bbl";
+  ASSERT_TRUE(black_box.save(filename));
+  BlackBoxLog log;
+  ASSERT_TRUE(log.read(filename));
+  std::remove(filename.c_str());
+
+  // the channel registered before opening is in the segment, but not what it recorded then
+  ASSERT_EQ(log.channels().size(), 1u);
+  EXPECT_EQ(log.channels()[0].type, "geometry_msgs/msg/PoseStamped");
+  ASSERT_EQ(log.records().size(), 1u);
+  geometry_msgs::msg::PoseStamped pose;
+  ASSERT_TRUE(BlackBoxLog::deserialize(log.records()[0], pose));
+  EXPECT_EQ(pose, makePose(2));
+}
+
+TEST(BlackBox, KeepsTheLatestRecords)
+{
+  BlackBox black_box;
+  ASSERT_TRUE(black_box.open(segmentName("latest"), 64 * 1024));
+  int poses = black_box.channel("pose", "geometry_msgs/msg/PoseStamped");
+  int others = black_box.channel("other", "geometry_msgs/msg/PoseStamped");
+  EXPECT_EQ(black_box.channel("more", ""), 2);
+
+  // far more than the ring holds, from two threads
+  const int count = 20000;
+  std::thread other([&]() {
+      for (int i = 0; i < count; ++i) {
+        black_box.record(others, makePose(-i));
+      }
+    });
+  for (int i = 0; i < count; ++i) {
+    black_box.record(poses, makePose(i));
+  }
+  other.join();
+
+  // saved by another process, from the segment
+  std::string filename = "/tmp/" + segmentName("latest") + ".bbl";
+  ASSERT_TRUE(BlackBox::saveSegment(segmentName("latest"), filename));
+  BlackBoxLog log;
+  ASSERT_TRUE(log.read(filename));
+  std::remove(filename.c_str());
+
+  ASSERT_EQ(log.channels().size(), 3u);
+  EXPECT_EQ(log.find("other"), others);
+  EXPECT_EQ(log.find("missing"), -1);
+  ASSERT_GT(log.records().size(), 100u);
+  ASSERT_LT(log.records().size(), static_cast<size_t>(count));
+
+  // each channel's records are whole and in order
+  int last_pose = -1;
+  int last_other = 1;
+  for (const auto & record : log.records()) {
+    geometry_msgs::msg::PoseStamped pose;
+    ASSERT_TRUE(BlackBoxLog::deserialize(record, pose));
+    ASSERT_EQ(pose.pose.position.x, pose.header.stamp.sec * 0.5);
+    if (static_cast<int>(record.channel) == poses) {
+      ASSERT_GT(pose.header.stamp.sec, last_pose);
+      last_pose = pose.header.stamp.sec;
+    } else {
+      ASSERT_LT(pose.header.stamp.sec, last_other);
+      last_other = pose.header.stamp.sec;
+    }
+  }
+  // whichever thread finished last still has its last record
+  EXPECT_TRUE(last_pose == count - 1 || last_other == 1 - count);
+}
+
+TEST(BlackBox, SavesNothingFromAMissingSegment)
+{
+  EXPECT_FALSE(BlackBox::saveSegment(segmentName("missing"), "/tmp/" + segmentName("missing")));
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+
+#include "nav2_util/distance_field.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::computeDistanceField;
+using nav2_util::sharedDistanceField;
+
+static nav_msgs::msg::OccupancyGrid makeMap(unsigned int width, unsigned int height)
+{
+  nav_msgs::msg::OccupancyGrid map;
+  map.info.width = width;
+  map.info.height = height;
+  map.info.resolution = 0.05f;
+  map.data.assign(width * height, 0);
+  return map;
+}
+
+TEST(DistanceField, MatchesBruteForce)
+{
+  auto map = makeMap(37, 23);
+  std::mt19937 random(7);
+  for (auto & value : map.data) {
+    int draw = random() % 40;
+    value = draw == 0 ? 100 : (draw == 1 ? -1 : (draw == 2 ? 60 : 0));
+  }
+
+  for (int threads : {1, 3}) {
+    auto field = computeDistanceField(map, 100, threads);
+    ASSERT_EQ(field->sq_distances.size(), map.data.size());
+    for (unsigned int y = 0; y < 23; y++) {
+      for (unsigned int x = 0; x < 37; x++) {
+        uint32_t nearest = UINT32_MAX;
+        for (unsigned int oy = 0; oy < 23; oy++) {
+          for (unsigned int ox = 0; ox < 37; ox++) {
+            if (map.data[oy * 37 + ox] == 100) {
+              int dx = ox - x, dy = oy - y;
+              nearest = std::min(nearest, static_cast<uint32_t>(dx * dx + dy * dy));
+            }
+          }
+        }
+        EXPECT_EQ(field->getSqDistance(x, y), nearest) << x << " " << y;
+      }
+    }
+  }
+}
+
+TEST(DistanceField, NoObstacles)
+{
+  auto map = makeMap(5, 4);
+  map.data[3] = 60;
+  auto field = computeDistanceField(map, 100);
+  for (auto sq_distance : field->sq_distances) {
+    EXPECT_GT(sq_distance, 5u * 5u + 4u * 4u);
+  }
+  // a lower obstacle value takes the 60 in
+  EXPECT_EQ(computeDistanceField(map, 50)->getSqDistance(0, 1), 9u + 1u);
+}
+
+TEST(DistanceField, SharedWhileHeld)
+{
+  auto map = makeMap(8, 8);
+  map.data[9] = 100;
+  auto field = sharedDistanceField(map, 100);
+  EXPECT_EQ(sharedDistanceField(map, 100), field);
+  EXPECT_NE(sharedDistanceField(map, 50), field);
+
+  auto other = makeMap(8, 8);
+  other.data[10] = 100;
+  EXPECT_NE(sharedDistanceField(other, 100), field);
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+#include "gtest/gtest.h"
+#include "nav2_util/grid_memory.hpp"
+
+using nav2_util::HugePages;
+
+// Sets a mode for the life of a test
+class ScopedHugePages
+{
+public:
+  explicit ScopedHugePages(HugePages mode)
+  : previous_(nav2_util::get_grid_huge_pages())
+  {
+    nav2_util::set_grid_huge_pages(mode);
+  }
+  ~ScopedHugePages() {nav2_util::set_grid_huge_pages(previous_);}
+
+private:
+  HugePages previous_;
+};
+
+static const HugePages modes[] = {HugePages::off, HugePages::transparent, HugePages::reserved};
+
+TEST(GridMemory, GivesZeroedWritableGrids)
+{
+  for (HugePages mode : modes) {
+    ScopedHugePages huge_pages(mode);
+    for (size_t count : {size_t{1}, size_t{1000}, size_t{3} << 20, (size_t{2} << 20) + 7}) {
+      float * grid = nav2_util::allocate_grid_of<float>(count);
+      ASSERT_NE(grid, nullptr);
+      EXPECT_TRUE(std::all_of(grid, grid + count, [](float value) {return value == 0.0f;}));
+      std::fill(grid, grid + count, 1.5f);
+      EXPECT_EQ(grid[count - 1], 1.5f);
+      nav2_util::free_grid(grid);
+    }
+  }
+  nav2_util::free_grid(nullptr);
+}
+
+TEST(GridMemory, GivesGridsToC)
+{
+  for (HugePages mode : modes) {
+    ScopedHugePages huge_pages(mode);
+    auto grid = static_cast<uint16_t *>(nav2_util_allocate_grid(sizeof(uint16_t) << 21));
+    ASSERT_NE(grid, nullptr);
+    grid[(1 << 21) - 1] = 7;
+    nav2_util_free_grid(grid);
+  }
+}
+
+TEST(GridMemory, AlignsLargeGridsToHugePages)
+{
+  ScopedHugePages huge_pages(HugePages::transparent);
+  void * grid = nav2_util::allocate_grid(size_t{5} << 20);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(grid) % (size_t{2} << 20), 0u);
+  nav2_util::free_grid(grid);
+}
+
+TEST(GridMemory, ThrowsWithoutMemory)
+{
+  EXPECT_THROW(nav2_util::allocate_grid(SIZE_MAX / 2), std::bad_alloc);
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_util/line_iterator.hpp"
+#include "nav2_util/line_traversal.hpp"
+
+using Cells = std::vector<std::pair<int, int>>;
+
+static Cells iteratorCells(int x0, int y0, int x1, int y1)
+{
+  Cells cells;
+  for (nav2_util::LineIterator line(x0, y0, x1, y1); line.isValid(); line.advance()) {
+    cells.emplace_back(line.getX(), line.getY());
+  }
+  return cells;
+}
+
+static Cells tracedCells(int x0, int y0, int x1, int y1)
+{
+  Cells cells;
+  nav2_util::traceCells(x0, y0, x1, y1, [&cells](int x, int y) {cells.emplace_back(x, y);});
+  return cells;
+}
+
+TEST(LineTraversal, MatchesLineIterator)
+{
+  for (int x1 = -7; x1 <= 7; ++x1) {
+    for (int y1 = -7; y1 <= 7; ++y1) {
+      EXPECT_EQ(tracedCells(3, -2, x1, y1), iteratorCells(3, -2, x1, y1)) <<
+        "to (" << x1 << ", " << y1 << ")";
+    }
+  }
+}
+
+TEST(LineTraversal, StopsWhenVisitReturnsFalse)
+{
+  Cells cells;
+  bool finished = nav2_util::traceCells(0, 0, 10, 0, [&cells](int x, int y) {
+        cells.emplace_back(x, y);
+        return x < 4;
+      });
+  EXPECT_FALSE(finished);
+  EXPECT_EQ(cells.size(), 5u);
+
+  EXPECT_TRUE(nav2_util::traceCells(0, 0, 10, 3, [](int, int) {return true;}));
+}
+
+TEST(LineTraversal, OffsetsFollowCells)
+{
+  const unsigned int size_x = 20;
+  for (unsigned int x1 = 0; x1 < size_x; x1 += 3) {
+    for (unsigned int y1 = 0; y1 < 12; y1 += 5) {
+      std::vector<unsigned int> offsets;
+      nav2_util::traceOffsets(9, 6, x1, y1, size_x, UINT_MAX,
+        [&offsets](unsigned int offset) {offsets.push_back(offset);});
+
+      Cells cells = iteratorCells(9, 6, x1, y1);
+      ASSERT_EQ(offsets.size(), cells.size());
+      for (size_t i = 0; i < cells.size(); ++i) {
+        EXPECT_EQ(offsets[i], cells[i].second * size_x + cells[i].first);
+      }
+    }
+  }
+}
+
+TEST(LineTraversal, ClipsToMaxLength)
+{
+  std::vector<unsigned int> offsets;
+  nav2_util::traceOffsets(0, 0, 10, 10, 20, 5,
+    [&offsets](unsigned int offset) {offsets.push_back(offset);});
+  // 5 cells of length along the diagonal are 3 steps, and the start cell
+  EXPECT_EQ(offsets.size(), 4u);
+}
+
+TEST(LineTraversal, BatchMatchesSingleRays)
+{
+  struct End
+  {
+    unsigned int x, y;
+  };
+  const std::vector<End> ends = {{0, 0}, {15, 2}, {7, 11}, {8, 6}, {2, 9}};
+
+  std::vector<unsigned int> single, batch;
+  for (const End & end : ends) {
+    nav2_util::traceOffsets(8, 6, end.x, end.y, 16, 6,
+      [&single](unsigned int offset) {single.push_back(offset);});
+  }
+  nav2_util::traceOffsetsFrom(8, 6, ends.begin(), ends.end(), 16, 6,
+    [&batch](unsigned int offset) {batch.push_back(offset);});
+  EXPECT_EQ(batch, single);
+}
+
+TEST(LineTraversal, WalksThreeAxes)
+{
+  nav2_util::LineCell<3> cell{{1, 2, 0}, 0};
+  const int delta[3] = {2, -1, 6};
+  const int stride[3] = {0, 0, 0};
+  std::vector<std::vector<int>> visited;
+  nav2_util::walkLine(cell, delta, stride, UINT_MAX, [&visited](const nav2_util::LineCell<3> & c) {
+      visited.push_back({c.coord[0], c.coord[1], c.coord[2]});
+    });
+
+  // z is the major axis and steps every cell, from the start to the end
+  ASSERT_EQ(visited.size(), 7u);
+  EXPECT_EQ(visited.front(), (std::vector<int>{1, 2, 0}));
+  EXPECT_EQ(visited.back(), (std::vector<int>{3, 1, 6}));
+  for (size_t i = 0; i < visited.size(); ++i) {
+    EXPECT_EQ(visited[i][2], static_cast<int>(i));
+  }
+}
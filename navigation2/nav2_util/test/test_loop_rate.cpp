@@ -0,0 +1,123 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "nav2_util/loop_rate.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+using nav2_util::LoopClock;
+using nav2_util::LoopRate;
+using namespace std::chrono_literals;
+
+class RclCppFixture
+{
+public:
+  RclCppFixture() {rclcpp::init(0, nullptr);}
+  ~RclCppFixture() {rclcpp::shutdown();}
+};
+RclCppFixture g_rclcppfixture;
+
+// A ROS clock on sim time, set by hand as the TimeSource sets it from /clock
+class SimClock
+{
+public:
+  SimClock()
+  : clock(std::make_shared<rclcpp::Clock>(RCL_ROS_TIME))
+  {
+    rcl_enable_ros_time_override(clock->get_clock_handle());
+    set(0ns);
+  }
+
+  void set(std::chrono::nanoseconds time)
+  {
+    rcl_set_ros_time_override(clock->get_clock_handle(), time.count());
+  }
+
+  rclcpp::Clock::SharedPtr clock;
+};
+
+TEST(LoopRate, KeepsSteadyTimeWithoutSimTime)
+{
+  auto clock = std::make_shared<LoopClock>(std::make_shared<rclcpp::Clock>(RCL_ROS_TIME));
+  EXPECT_FALSE(clock->isSimTime());
+
+  LoopRate rate(clock, 100.0);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 5; i++) {
+    EXPECT_TRUE(rate.sleep());
+  }
+  EXPECT_GE(std::chrono::steady_clock::now() - start, 45ms);
+}
+
+TEST(LoopRate, FollowsSimTime)
+{
+  SimClock sim;
+  auto clock = std::make_shared<LoopClock>(sim.clock);
+  EXPECT_TRUE(clock->isSimTime());
+
+  LoopRate rate(clock, 10.0);
+  std::atomic<int> cycles{0};
+  std::thread loop([&]() {
+      while (cycles < 3 && rate.sleep()) {
+        cycles++;
+      }
+    });
+
+  // Far faster than real time: the loop only moves as /clock does
+  std::this_thread::sleep_for(20ms);
+  EXPECT_EQ(cycles, 0);
+  for (int step = 1; step <= 30 && cycles < 3; step++) {
+    sim.set(std::chrono::milliseconds(10 * step));
+    std::this_thread::sleep_for(1ms);
+  }
+  loop.join();
+  EXPECT_EQ(cycles, 3);
+  EXPECT_GE(clock->now(), 300ms);
+}
+
+TEST(LoopRate, InterruptWakesASleeper)
+{
+  SimClock sim;
+  auto clock = std::make_shared<LoopClock>(sim.clock);
+
+  LoopRate rate(clock, 1.0);
+  std::atomic<bool> slept{true};
+  std::thread loop([&]() {slept = rate.sleep();});
+  std::this_thread::sleep_for(10ms);
+  clock->interrupt();
+  loop.join();
+  EXPECT_FALSE(slept);
+}
+
+TEST(LoopClock, WaitUntilEndsAtTheSimDeadline)
+{
+  SimClock sim;
+  auto clock = std::make_shared<LoopClock>(sim.clock);
+
+  int waits = 0;
+  bool came = clock->waitUntil(50ms, [&](std::chrono::nanoseconds left) {
+        EXPECT_LE(left, LoopClock::SIM_SLICE);
+        sim.set(std::chrono::milliseconds(10 * ++waits));
+        return false;
+      });
+  EXPECT_FALSE(came);
+  EXPECT_EQ(waits, 5);
+
+  EXPECT_TRUE(clock->waitUntil(100ms, [](std::chrono::nanoseconds) {return true;}));
+}
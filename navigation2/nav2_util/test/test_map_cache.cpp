@@ -0,0 +1,69 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+
+#include "nav2_util/map_cache.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::MapCache;
+
+nav_msgs::msg::OccupancyGrid makeMap(int32_t load_sec)
+{
+  nav_msgs::msg::OccupancyGrid map;
+  map.info.map_load_time.sec = load_sec;
+  map.info.width = 10;
+  map.info.height = 20;
+  map.info.resolution = 0.05f;
+  return map;
+}
+
+TEST(MapCache, FindsByLoadTimeAndSize)
+{
+  MapCache<int> cache(2);
+  auto map = makeMap(1);
+  EXPECT_EQ(cache.find(map), nullptr);
+
+  cache.insert(map, std::make_shared<int>(1));
+  ASSERT_NE(cache.find(map), nullptr);
+  EXPECT_EQ(*cache.find(map), 1);
+
+  // the same cells loaded again are another map
+  EXPECT_EQ(cache.find(makeMap(2)), nullptr);
+
+  auto resized = map;
+  resized.info.width = 11;
+  EXPECT_EQ(cache.find(resized), nullptr);
+
+  cache.insert(map, std::make_shared<int>(2));
+  EXPECT_EQ(*cache.find(map), 2);
+
+  cache.clear();
+  EXPECT_EQ(cache.find(map), nullptr);
+}
+
+TEST(MapCache, DropsLeastRecentlyUsed)
+{
+  MapCache<int> cache(2);
+  cache.insert(makeMap(1), std::make_shared<int>(1));
+  cache.insert(makeMap(2), std::make_shared<int>(2));
+
+  // using the first map makes the second the least recently used
+  ASSERT_NE(cache.find(makeMap(1)), nullptr);
+  cache.insert(makeMap(3), std::make_shared<int>(3));
+
+  EXPECT_NE(cache.find(makeMap(1)), nullptr);
+  EXPECT_EQ(cache.find(makeMap(2)), nullptr);
+  EXPECT_NE(cache.find(makeMap(3)), nullptr);
+}
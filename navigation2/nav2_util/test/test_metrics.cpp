@@ -0,0 +1,131 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_util/metrics.hpp"
+
+using nav2_util::HistogramSnapshot;
+using nav2_util::LatencyHistogram;
+using nav2_util::MetricsRegistry;
+using nav2_util::MetricsReport;
+using namespace std::chrono_literals;
+
+TEST(LatencyHistogram, BucketsCoverEveryDuration)
+{
+  EXPECT_EQ(LatencyHistogram::bucketOf(0), 0);
+  EXPECT_EQ(LatencyHistogram::bucketOf(15), 15);
+  EXPECT_EQ(LatencyHistogram::bucketOf(16), 16);
+  EXPECT_EQ(LatencyHistogram::bucketOf(uint64_t(1) << 50), LatencyHistogram::BUCKET_COUNT - 1);
+
+  // the buckets tile the durations, each within 1/16 of its low end
+  for (int bucket = 0; bucket + 1 < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+    uint64_t low = LatencyHistogram::bucketLow(bucket);
+    uint64_t high = LatencyHistogram::bucketHigh(bucket);
+    ASSERT_EQ(high, LatencyHistogram::bucketLow(bucket + 1));
+    ASSERT_EQ(LatencyHistogram::bucketOf(low), bucket);
+    ASSERT_EQ(LatencyHistogram::bucketOf(high - 1), bucket);
+    ASSERT_LE((high - low) * 16, std::max<uint64_t>(low, 16));
+  }
+}
+
+TEST(LatencyHistogram, ReportsQuantiles)
+{
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.snapshot().quantile(0.5), 0.0);
+
+  // 1ms to 100ms, one sample each
+  for (int ms = 1; ms <= 100; ++ms) {
+    histogram.record(std::chrono::milliseconds(ms));
+  }
+  HistogramSnapshot snapshot = histogram.snapshot();
+  EXPECT_EQ(snapshot.count, 100u);
+  EXPECT_NEAR(snapshot.mean(), 0.0505, 1e-9);
+  EXPECT_NEAR(snapshot.quantile(0.5), 0.050, 0.050 / 16);
+  EXPECT_NEAR(snapshot.quantile(0.99), 0.099, 0.099 / 16);
+  EXPECT_DOUBLE_EQ(snapshot.quantile(1.0), 0.1);
+
+  // only the samples since the first snapshot
+  histogram.recordSeconds(2.0);
+  HistogramSnapshot interval = histogram.snapshot().since(snapshot);
+  EXPECT_EQ(interval.count, 1u);
+  EXPECT_DOUBLE_EQ(interval.quantile(0.5), 2.0);
+}
+
+TEST(LatencyHistogram, CountsEveryThread)
+{
+  LatencyHistogram histogram;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&histogram]() {
+        for (int i = 0; i < 10000; ++i) {
+          histogram.record(1us);
+        }
+      });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(histogram.snapshot().count, 40000u);
+}
+
+TEST(MetricsRegistry, KeepsOneMetricPerName)
+{
+  MetricsRegistry registry;
+  LatencyHistogram & histogram = registry.histogram("test.update", "How long updates take");
+  EXPECT_EQ(&registry.histogram("test.update"), &histogram);
+
+  {
+    nav2_util::ScopedTimer timer(histogram);
+  }
+  registry.counter("test.drops").increment(3);
+  registry.counter("test.drops").increment();
+  registry.gauge("test.depth").set(2.0);
+  registry.gauge("test.depth").add(0.5);
+
+  EXPECT_EQ(histogram.snapshot().count, 1u);
+  EXPECT_EQ(registry.counter("test.drops").value(), 4u);
+  EXPECT_DOUBLE_EQ(registry.gauge("test.depth").value(), 2.5);
+  ASSERT_EQ(registry.histograms().size(), 1u);
+  EXPECT_EQ(registry.histograms()[0].description, "How long updates take");
+}
+
+TEST(MetricsReport, WritesPrometheusText)
+{
+  EXPECT_EQ(nav2_util::prometheusName("local_costmap.update-map"), "local_costmap_update_map");
+  EXPECT_EQ(nav2_util::prometheusName("2d"), "_d");
+
+  MetricsRegistry registry;
+  registry.histogram("dwb.cycle", "Controller cycle").recordSeconds(0.01);
+  registry.counter("dwb.failures").increment(2);
+  registry.gauge("amcl.particles").set(500);
+
+  MetricsReport report(registry);
+  ASSERT_EQ(report.update().size(), 1u);
+  std::string text = report.prometheusText();
+  EXPECT_NE(text.find("# HELP dwb_cycle_seconds Controller cycle\n"), std::string::npos);
+  EXPECT_NE(text.find("# TYPE dwb_cycle_seconds summary\n"), std::string::npos);
+  EXPECT_NE(text.find("dwb_cycle_seconds_count 1\n"), std::string::npos);
+  EXPECT_NE(text.find("dwb_failures_total 2\n"), std::string::npos);
+  EXPECT_NE(text.find("amcl_particles 500\n"), std::string::npos);
+
+  // a quiet interval has no quantiles to report, but keeps the totals
+  report.update();
+  EXPECT_EQ(report.rows()[0].interval.count, 0u);
+  EXPECT_EQ(report.rows()[0].total.count, 1u);
+}
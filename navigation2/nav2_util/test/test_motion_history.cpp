@@ -0,0 +1,94 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "nav2_util/motion_history.hpp"
+
+using nav2_util::MotionHistory;
+using nav2_util::MotionSample;
+
+MotionSample sampleAt(double stamp, double x, double v_x)
+{
+  MotionSample sample;
+  sample.stamp = stamp;
+  sample.x = x;
+  sample.v_x = v_x;
+  return sample;
+}
+
+TEST(MotionHistory, KeepsTheNewestSamples)
+{
+  MotionHistory history(4);
+  MotionSample sample;
+  EXPECT_FALSE(history.latest(sample));
+
+  for (int i = 0; i < 6; ++i) {
+    history.push(sampleAt(i * 0.1, i * 0.05, 0.5));
+  }
+  EXPECT_EQ(history.size(), 4u);
+  ASSERT_TRUE(history.latest(sample));
+  EXPECT_DOUBLE_EQ(sample.x, 0.25);
+  ASSERT_TRUE(history.at(3, sample));
+  EXPECT_DOUBLE_EQ(sample.x, 0.1);
+  EXPECT_FALSE(history.at(4, sample));
+
+  EXPECT_NEAR(history.displacement(3), 0.15, 1e-9);
+  EXPECT_NEAR(history.speed(3), 0.5, 1e-9);
+  EXPECT_DOUBLE_EQ(history.displacement(4), 0.0);
+
+  history.clear();
+  EXPECT_EQ(history.size(), 0u);
+  EXPECT_FALSE(history.latest(sample));
+}
+
+TEST(MotionHistory, DifferencesTheVelocity)
+{
+  MotionHistory history(10);
+  EXPECT_DOUBLE_EQ(history.acceleration(), 0.0);
+
+  // speeding up at 1 m/s^2, then braking hard
+  history.push(sampleAt(0.0, 0.0, 0.0));
+  history.push(sampleAt(0.1, 0.0, 0.1));
+  EXPECT_NEAR(history.acceleration(), 1.0, 1e-9);
+  EXPECT_DOUBLE_EQ(history.jerk(), 0.0);
+
+  history.push(sampleAt(0.2, 0.0, 0.2));
+  EXPECT_NEAR(history.jerk(), 0.0, 1e-9);
+
+  history.push(sampleAt(0.3, 0.0, -0.8));
+  EXPECT_NEAR(history.acceleration(), -10.0, 1e-9);
+  EXPECT_NEAR(history.jerk(), -110.0, 1e-9);
+}
+
+TEST(MotionHistory, ReadsOdometry)
+{
+  nav_msgs::msg::Odometry odom;
+  odom.header.stamp.sec = 2;
+  odom.header.stamp.nanosec = 500000000;
+  odom.pose.pose.position.x = 1.0;
+  odom.pose.pose.orientation.z = std::sin(0.25);
+  odom.pose.pose.orientation.w = std::cos(0.25);
+  odom.twist.twist.linear.x = 0.3;
+
+  MotionHistory history;
+  history.push(odom);
+  MotionSample sample;
+  ASSERT_TRUE(history.latest(sample));
+  EXPECT_DOUBLE_EQ(sample.stamp, 2.5);
+  EXPECT_DOUBLE_EQ(sample.x, 1.0);
+  EXPECT_NEAR(sample.theta, 0.5, 1e-9);
+  EXPECT_DOUBLE_EQ(sample.v_x, 0.3);
+}
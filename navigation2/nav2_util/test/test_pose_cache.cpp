@@ -0,0 +1,69 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "nav2_util/pose_cache.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+class RclCppFixture
+{
+public:
+  RclCppFixture() {rclcpp::init(0, nullptr);}
+  ~RclCppFixture() {rclcpp::shutdown();}
+};
+RclCppFixture g_rclcppfixture;
+
+TEST(PoseCache, KeepsThePoseInEachFrame)
+{
+  auto node = rclcpp::Node::make_shared("pose_cache_test");
+  tf2_ros::Buffer tf_buffer(node->get_clock());
+  nav2_util::PoseCache cache(node, tf_buffer, {"map", "odom"});
+
+  geometry_msgs::msg::PoseStamped pose;
+  EXPECT_FALSE(cache.getPose(pose, "odom"));
+
+  geometry_msgs::msg::TransformStamped odom_to_base;
+  odom_to_base.header.frame_id = "odom";
+  odom_to_base.header.stamp = rclcpp::Time(5, 0);
+  odom_to_base.child_frame_id = "base_link";
+  odom_to_base.transform.translation.x = 1.5;
+  odom_to_base.transform.rotation.w = 1.0;
+  tf_buffer.setTransform(odom_to_base, "test");
+  cache.refresh();
+
+  ASSERT_TRUE(cache.getPose(pose, "odom"));
+  EXPECT_EQ(pose.header.frame_id, "odom");
+  EXPECT_EQ(pose.header.stamp.sec, 5);
+  EXPECT_DOUBLE_EQ(pose.pose.position.x, 1.5);
+  EXPECT_DOUBLE_EQ(pose.pose.orientation.w, 1.0);
+
+  // map is not connected yet, and base_link is not one of the global frames
+  EXPECT_FALSE(cache.getPose(pose, "map"));
+  EXPECT_FALSE(cache.getPose(pose, "base_link"));
+
+  geometry_msgs::msg::TransformStamped map_to_odom;
+  map_to_odom.header.frame_id = "map";
+  map_to_odom.header.stamp = rclcpp::Time(5, 0);
+  map_to_odom.child_frame_id = "odom";
+  map_to_odom.transform.translation.y = 2.0;
+  map_to_odom.transform.rotation.w = 1.0;
+  tf_buffer.setTransform(map_to_odom, "test", true);
+  cache.refresh();
+
+  ASSERT_TRUE(cache.getPose(pose, "map"));
+  EXPECT_DOUBLE_EQ(pose.pose.position.x, 1.5);
+  EXPECT_DOUBLE_EQ(pose.pose.position.y, 2.0);
+}
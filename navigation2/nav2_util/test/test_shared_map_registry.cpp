@@ -0,0 +1,103 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "nav2_util/shared_map_registry.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::SharedMapRegistry;
+using nav2_util::hashOccupancyGrid;
+
+static nav_msgs::msg::OccupancyGrid makeMap(int32_t load_sec)
+{
+  nav_msgs::msg::OccupancyGrid map;
+  map.info.map_load_time.sec = load_sec;
+  map.info.width = 10;
+  map.info.height = 20;
+  map.info.resolution = 0.05f;
+  map.data.assign(200, 0);
+  map.data[123] = 100;
+  return map;
+}
+
+TEST(SharedMapRegistry, HashesTheCells)
+{
+  // the same cells loaded twice are the same map
+  EXPECT_EQ(hashOccupancyGrid(makeMap(1)), hashOccupancyGrid(makeMap(2)));
+
+  auto changed = makeMap(1);
+  changed.data[199] = -1;
+  EXPECT_NE(hashOccupancyGrid(changed), hashOccupancyGrid(makeMap(1)));
+
+  auto moved = makeMap(1);
+  moved.info.origin.position.x = 1.0;
+  EXPECT_NE(hashOccupancyGrid(moved), hashOccupancyGrid(makeMap(1)));
+}
+
+TEST(SharedMapRegistry, SharesWhileHeld)
+{
+  SharedMapRegistry<int> registry;
+  int preparations = 0;
+  auto prepare = [&preparations]() {
+      ++preparations;
+      return std::make_shared<int>(preparations);
+    };
+  SharedMapRegistry<int>::Key key(hashOccupancyGrid(makeMap(1)), "test");
+
+  auto first = registry.getOrPrepare(key, prepare);
+  auto second = registry.getOrPrepare(key, prepare);
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(preparations, 1);
+
+  // other parameters are another entry
+  auto other = registry.getOrPrepare({key.first, "other"}, prepare);
+  EXPECT_NE(other, first);
+  EXPECT_EQ(registry.size(), 2u);
+
+  // once no one holds it, it is prepared again
+  first.reset();
+  second.reset();
+  EXPECT_EQ(registry.size(), 1u);
+  auto third = registry.getOrPrepare(key, prepare);
+  EXPECT_EQ(*third, 3);
+}
+
+TEST(SharedMapRegistry, PreparesOnceForConcurrentNodes)
+{
+  SharedMapRegistry<int> registry;
+  std::atomic<int> preparations{0};
+  std::vector<std::shared_ptr<int>> results(8);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < results.size(); ++i) {
+    threads.emplace_back([&, i]() {
+        results[i] = registry.getOrPrepare({1, "test"}, [&preparations]() {
+            ++preparations;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            return std::make_shared<int>(1);
+          });
+      });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(preparations, 1);
+  for (const auto & result : results) {
+    EXPECT_EQ(result, results[0]);
+  }
+}
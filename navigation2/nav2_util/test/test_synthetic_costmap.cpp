@@ -0,0 +1,174 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_util/costmap.hpp"
+#include "nav2_util/synthetic_costmap.hpp"
+
+using nav2_util::Costmap;
+using nav2_util::SyntheticMapSpec;
+using nav2_util::SyntheticStyle;
+using nav2_util::generate_synthetic_costmap;
+using nav2_util::parse_synthetic_map_spec;
+
+static SyntheticMapSpec specOf(const std::string & text)
+{
+  SyntheticMapSpec spec;
+  std::string error;
+  EXPECT_TRUE(parse_synthetic_map_spec(text, spec, error)) << error;
+  return spec;
+}
+
+static double fractionOf(const std::vector<uint8_t> & costs, uint8_t cost)
+{
+  return static_cast<double>(std::count(costs.begin(), costs.end(), cost)) / costs.size();
+}
+
+TEST(SyntheticCostmap, ReadsSpecs)
+{
+  SyntheticMapSpec spec = specOf("corridors:300x200:seed=4:corridor=6:inflation=0.5");
+  EXPECT_EQ(spec.style, SyntheticStyle::corridors);
+  EXPECT_EQ(spec.size_x, 300u);
+  EXPECT_EQ(spec.size_y, 200u);
+  EXPECT_EQ(spec.seed, 4u);
+  EXPECT_EQ(spec.corridor_width, 6u);
+  EXPECT_DOUBLE_EQ(spec.inflation_radius, 0.5);
+
+  std::string error;
+  EXPECT_FALSE(parse_synthetic_map_spec("forest:100x100", spec, error));
+  EXPECT_FALSE(parse_synthetic_map_spec("maze", spec, error));
+  EXPECT_FALSE(parse_synthetic_map_spec("maze:100x100:walls=2", spec, error));
+  EXPECT_FALSE(parse_synthetic_map_spec("maze:100x100:wall=", spec, error));
+  EXPECT_EQ(spec.style, SyntheticStyle::corridors);
+}
+
+TEST(SyntheticCostmap, IsTheSameOnAnyNumberOfThreads)
+{
+  for (const char * text : {"scattered:500x300:density=0.3:inflation=0.3",
+      "corridors:500x300:inflation=0.3:inscribed=0.1", "maze:500x300:inflation=0.2"})
+  {
+    SyntheticMapSpec spec = specOf(text);
+    spec.threads = 1;
+    std::vector<uint8_t> one = generate_synthetic_costmap(spec);
+    spec.threads = 7;
+    EXPECT_EQ(generate_synthetic_costmap(spec), one) << text;
+    spec.seed = 1;
+    EXPECT_NE(generate_synthetic_costmap(spec), one) << text;
+  }
+}
+
+TEST(SyntheticCostmap, ScattersObstaclesToTheDensity)
+{
+  for (double density : {0.0, 0.05, 0.3}) {
+    SyntheticMapSpec spec;
+    spec.size_x = 640;
+    spec.size_y = 640;
+    spec.density = density;
+    std::vector<uint8_t> costs = generate_synthetic_costmap(spec);
+    EXPECT_NEAR(fractionOf(costs, Costmap::lethal_obstacle), density, 0.01);
+    EXPECT_NEAR(fractionOf(costs, Costmap::free_space), 1.0 - density, 0.01);
+  }
+}
+
+TEST(SyntheticCostmap, ConnectsTheWholeMaze)
+{
+  SyntheticMapSpec spec = specOf("maze:203x157:corridor=3:wall=1:seed=9");
+  std::vector<uint8_t> costs = generate_synthetic_costmap(spec);
+
+  // a flood from the first free cell reaches every free one
+  const auto start = std::find(costs.begin(), costs.end(), Costmap::free_space) - costs.begin();
+  std::vector<bool> reached(costs.size(), false);
+  std::vector<size_t> open = {static_cast<size_t>(start)};
+  reached[start] = true;
+  size_t count = 0;
+  while (!open.empty()) {
+    const size_t cell = open.back();
+    open.pop_back();
+    ++count;
+    const int x = cell % spec.size_x;
+    const int y = cell / spec.size_x;
+    for (auto step : {std::make_pair(-1, 0), std::make_pair(1, 0), std::make_pair(0, -1),
+        std::make_pair(0, 1)})
+    {
+      const int i = x + step.first;
+      const int j = y + step.second;
+      if (i < 0 || j < 0 || i >= static_cast<int>(spec.size_x) ||
+        j >= static_cast<int>(spec.size_y))
+      {
+        continue;
+      }
+      const size_t next = static_cast<size_t>(j) * spec.size_x + i;
+      if (!reached[next] && costs[next] == Costmap::free_space) {
+        reached[next] = true;
+        open.push_back(next);
+      }
+    }
+  }
+  EXPECT_EQ(count, static_cast<size_t>(std::count(costs.begin(), costs.end(),
+    Costmap::free_space)));
+
+  // cells of a maze of 50 x 39 corridors, with the walls between them of a perfect maze
+  EXPECT_EQ(count, 50u * 39u * 9u + (50u * 39u - 1u) * 3u);
+}
+
+TEST(SyntheticCostmap, InflatesByTheDistanceToTheNearestObstacle)
+{
+  SyntheticMapSpec spec = specOf("scattered:150x120:density=0.02:inflation=0.4:inscribed=0.12");
+  spec.inflation_radius = 0.0;
+  std::vector<uint8_t> obstacles = generate_synthetic_costmap(spec);
+  spec.inflation_radius = 0.4;
+  std::vector<uint8_t> costs = generate_synthetic_costmap(spec);
+
+  for (unsigned int y = 0; y < spec.size_y; ++y) {
+    for (unsigned int x = 0; x < spec.size_x; ++x) {
+      // past the radius, any distance gives no cost
+      double nearest = 1e9;
+      for (unsigned int j = y < 9 ? 0 : y - 9; j < std::min(spec.size_y, y + 10); ++j) {
+        for (unsigned int i = x < 9 ? 0 : x - 9; i < std::min(spec.size_x, x + 10); ++i) {
+          if (obstacles[j * spec.size_x + i] == Costmap::lethal_obstacle) {
+            nearest = std::min(nearest, std::hypot(i - x * 1.0, j - y * 1.0) * spec.resolution);
+          }
+        }
+      }
+      uint8_t expected = Costmap::free_space;
+      if (nearest == 0.0) {
+        expected = Costmap::lethal_obstacle;
+      } else if (nearest <= spec.inscribed_radius) {
+        expected = Costmap::inscribed_inflated_obstacle;
+      } else if (nearest <= spec.inflation_radius) {
+        expected = static_cast<uint8_t>((Costmap::inscribed_inflated_obstacle - 1) *
+          std::exp(-spec.cost_scaling_factor * (nearest - spec.inscribed_radius)));
+      }
+      ASSERT_EQ(costs[y * spec.size_x + x], expected) << x << ", " << y;
+    }
+  }
+}
+
+TEST(SyntheticCostmap, RefusesSpecsOfNoMap)
+{
+  SyntheticMapSpec spec;
+  spec.size_x = 0;
+  EXPECT_THROW(generate_synthetic_costmap(spec), std::invalid_argument);
+  EXPECT_THROW(generate_synthetic_costmap(specOf("scattered:10x10:density=2")),
+    std::invalid_argument);
+  EXPECT_THROW(generate_synthetic_costmap(specOf("maze:10x10:corridor=20")),
+    std::invalid_argument);
+}
@@ -0,0 +1,151 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "geometry_msgs/msg/transform_stamped.hpp"
+#include "gtest/gtest.h"
+#include "nav2_util/transform_scheduler.hpp"
+
+static void setOdomToBase(tf2::BufferCore & buffer, int seconds)
+{
+  geometry_msgs::msg::TransformStamped transform;
+  transform.header.frame_id = "odom";
+  transform.header.stamp.sec = seconds;
+  transform.child_frame_id = "base_link";
+  transform.transform.rotation.w = 1.0;
+  buffer.setTransform(transform, "test");
+}
+
+static tf2::TimePoint at(int seconds)
+{
+  return tf2::TimePoint(std::chrono::seconds(seconds));
+}
+
+// The scheduler's thread dispatches soon after the buffer answers, but not at once
+static bool eventually(const std::atomic<int> & count, int expected)
+{
+  for (int i = 0; i < 200 && count != expected; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return count == expected;
+}
+
+TEST(TransformScheduler, DispatchesAtOnceWhenTransformable)
+{
+  tf2::BufferCore buffer;
+  setOdomToBase(buffer, 1);
+  setOdomToBase(buffer, 2);
+  nav2_util::TransformScheduler scheduler(buffer);
+  auto channel = scheduler.addChannel({"odom"}, 10);
+
+  int dispatched = 0;
+  scheduler.schedule(channel, "base_link", at(1), [&dispatched]() {dispatched++;});
+  EXPECT_EQ(dispatched, 1);
+  EXPECT_EQ(scheduler.waiting(), 0u);
+}
+
+TEST(TransformScheduler, WaitsForTheTransform)
+{
+  tf2::BufferCore buffer;
+  setOdomToBase(buffer, 1);
+  nav2_util::TransformScheduler scheduler(buffer);
+  auto channel = scheduler.addChannel({"odom"}, 10);
+
+  std::atomic<int> dispatched{0};
+  scheduler.schedule(channel, "base_link", at(3), [&dispatched]() {dispatched++;});
+  scheduler.schedule(channel, "base_link", at(4), [&dispatched]() {dispatched++;});
+  scheduler.schedule(channel, "base_link", at(6), [&dispatched]() {dispatched++;});
+  EXPECT_EQ(dispatched, 0);
+  EXPECT_EQ(scheduler.waiting(), 3u);
+
+  // the one answer for the earliest lets through those the transform now covers
+  setOdomToBase(buffer, 5);
+  EXPECT_TRUE(eventually(dispatched, 2));
+  EXPECT_EQ(scheduler.waiting(), 1u);
+
+  setOdomToBase(buffer, 7);
+  EXPECT_TRUE(eventually(dispatched, 3));
+  EXPECT_EQ(scheduler.waiting(), 0u);
+}
+
+TEST(TransformScheduler, WaitsForEveryTargetFrame)
+{
+  tf2::BufferCore buffer;
+  setOdomToBase(buffer, 1);
+  setOdomToBase(buffer, 3);
+  nav2_util::TransformScheduler scheduler(buffer);
+  auto channel = scheduler.addChannel({"odom", "map"}, 10);
+
+  std::atomic<int> dispatched{0};
+  scheduler.schedule(channel, "base_link", at(2), [&dispatched]() {dispatched++;});
+  EXPECT_EQ(dispatched, 0);
+
+  geometry_msgs::msg::TransformStamped map_to_odom;
+  map_to_odom.header.frame_id = "map";
+  map_to_odom.child_frame_id = "odom";
+  map_to_odom.transform.rotation.w = 1.0;
+  buffer.setTransform(map_to_odom, "test", true);
+  EXPECT_TRUE(eventually(dispatched, 1));
+}
+
+TEST(TransformScheduler, DropsTheOldestBeyondTheQueueSize)
+{
+  tf2::BufferCore buffer;
+  setOdomToBase(buffer, 1);
+  nav2_util::TransformScheduler scheduler(buffer);
+  std::atomic<int> dropped{0};
+  auto channel = scheduler.addChannel({"odom"}, 1, tf2::Duration(0),
+      [&dropped]() {dropped++;});
+
+  std::atomic<int> latest{0};
+  scheduler.schedule(channel, "base_link", at(3), [&latest]() {latest = 3;});
+  scheduler.schedule(channel, "base_link", at(4), [&latest]() {latest = 4;});
+  EXPECT_EQ(dropped, 1);
+  EXPECT_EQ(scheduler.waiting(), 1u);
+
+  setOdomToBase(buffer, 5);
+  EXPECT_TRUE(eventually(latest, 4));
+}
+
+TEST(TransformScheduler, RemovedChannelsDispatchNothing)
+{
+  tf2::BufferCore buffer;
+  setOdomToBase(buffer, 1);
+  nav2_util::TransformScheduler scheduler(buffer);
+  auto removed = scheduler.addChannel({"odom"}, 10);
+  auto kept = scheduler.addChannel({"odom"}, 10);
+
+  std::atomic<int> from_removed{0};
+  std::atomic<int> from_kept{0};
+  scheduler.schedule(removed, "base_link", at(2), [&from_removed]() {from_removed++;});
+  scheduler.schedule(kept, "base_link", at(2), [&from_kept]() {from_kept++;});
+  scheduler.removeChannel(removed);
+  EXPECT_EQ(scheduler.waiting(), 1u);
+
+  setOdomToBase(buffer, 3);
+  EXPECT_TRUE(eventually(from_kept, 1));
+  EXPECT_EQ(from_removed, 0);
+}
+
+TEST(TransformScheduler, SharedPerBuffer)
+{
+  tf2::BufferCore buffer, other;
+  auto scheduler = nav2_util::TransformScheduler::forBuffer(buffer);
+  EXPECT_EQ(nav2_util::TransformScheduler::forBuffer(buffer), scheduler);
+  EXPECT_NE(nav2_util::TransformScheduler::forBuffer(other), scheduler);
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_VOXEL_GRID__VOXEL_DDA_HPP_
+#define NAV2_VOXEL_GRID__VOXEL_DDA_HPP_
+
+#include <math.h>
+#include <limits>
+
+namespace nav2_voxel_grid
+{
+
+/**
+ * @brief  Walk every voxel a ray passes through with a 3D DDA (Amanatides and Woo)
+ *
+ * Both end points are in grid coordinates and must lie inside the grid.  at(column index, z)
+ * is called for each voxel in order, starting with the one holding the origin, and the walk
+ * stops at the end point or once the ray is max_length cells long.  Unlike the Bresenham
+ * walk of VoxelGrid::raytraceLine() no voxel the ray crosses is skipped, and each step is a
+ * compare and an add with no per-axis error terms.
+ */
+template<class ActionType>
+inline void raytraceDDA(
+  ActionType at, unsigned int size_x,
+  double x0, double y0, double z0, double x1, double y1, double z1,
+  double max_length = std::numeric_limits<double>::infinity())
+{
+  const double inf = std::numeric_limits<double>::infinity();
+
+  int x = static_cast<int>(x0), y = static_cast<int>(y0), z = static_cast<int>(z0);
+  const int x_end = static_cast<int>(x1), y_end = static_cast<int>(y1);
+  const int z_end = static_cast<int>(z1);
+
+  double dx = x1 - x0, dy = y1 - y0, dz = z1 - z0;
+  double length = sqrt(dx * dx + dy * dy + dz * dz);
+  double t_end = length > max_length ? max_length / length : 1.0;
+
+  // t runs from 0 at the origin to 1 at the end point, t_delta is the change in t across
+  // one cell along each axis and t_max the t of the next boundary the ray crosses on it.
+  // An axis that has reached its end cell never steps again, which keeps the walk inside
+  // the box spanned by the end points whatever the rounding.
+  int step_x = dx > 0 ? 1 : -1;
+  int step_y = dy > 0 ? 1 : -1;
+  int step_z = dz > 0 ? 1 : -1;
+  double t_delta_x = fabs(1.0 / dx), t_delta_y = fabs(1.0 / dy), t_delta_z = fabs(1.0 / dz);
+  double t_max_x = x == x_end ? inf : (dx > 0 ? x + 1 - x0 : x0 - x) * t_delta_x;
+  double t_max_y = y == y_end ? inf : (dy > 0 ? y + 1 - y0 : y0 - y) * t_delta_y;
+  double t_max_z = z == z_end ? inf : (dz > 0 ? z + 1 - z0 : z0 - z) * t_delta_z;
+
+  const int offset_y = step_y * static_cast<int>(size_x);
+  unsigned int offset = static_cast<unsigned int>(y) * size_x + static_cast<unsigned int>(x);
+
+  at(offset, static_cast<unsigned int>(z));
+  while (true) {
+    if (t_max_x <= t_max_y && t_max_x <= t_max_z) {
+      if (t_max_x > t_end) {
+        return;
+      }
+      x += step_x;
+      offset += step_x;
+      t_max_x = x == x_end ? inf : t_max_x + t_delta_x;
+    } else if (t_max_y <= t_max_z) {
+      if (t_max_y > t_end) {
+        return;
+      }
+      y += step_y;
+      offset += offset_y;
+      t_max_y = y == y_end ? inf : t_max_y + t_delta_y;
+    } else {
+      if (t_max_z > t_end) {
+        return;
+      }
+      z += step_z;
+      t_max_z = z == z_end ? inf : t_max_z + t_delta_z;
+    }
+    at(offset, static_cast<unsigned int>(z));
+  }
+}
+
+}  // namespace nav2_voxel_grid
+
+#endif  // NAV2_VOXEL_GRID__VOXEL_DDA_HPP_
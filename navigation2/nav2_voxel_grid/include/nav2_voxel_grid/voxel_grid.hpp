@@ -45,6 +45,8 @@
 #include <limits.h>
 #include <algorithm>
 #include "rclcpp/rclcpp.hpp"
+#include "nav2_util/line_traversal.hpp"
+#include "nav2_voxel_grid/voxel_dda.hpp"
 
 /**
  * @class VoxelGrid
@@ -154,24 +156,12 @@ public:
 
   inline bool bitsBelowThreshold(unsigned int n, unsigned int bit_threshold)
   {
-    unsigned int bit_count;
-    for (bit_count = 0; n; ) {
-      ++bit_count;
-      if (bit_count > bit_threshold) {
-        return false;
-      }
-      n &= n - 1;  // clear the least significant bit set
-    }
-    return true;
+    return numBits(n) <= bit_threshold;
   }
 
   static inline unsigned int numBits(unsigned int n)
   {
-    unsigned int bit_count;
-    for (bit_count = 0; n; ++bit_count) {
-      n &= n - 1;  // clear the least significant bit set
-    }
-    return bit_count;
+    return __builtin_popcount(n);
   }
 
   static VoxelStatus getVoxel(
@@ -207,6 +197,22 @@ public:
     unsigned char free_cost = 0, unsigned char unknown_cost = 255,
     unsigned int max_length = UINT_MAX);
 
+  /**
+   * @brief  Clear the voxels along rays from one origin to each of num_points end points,
+   * updating map_2d as clearVoxelLineInMap() does
+   *
+   * The rays are walked with raytraceDDA(), so every voxel they pass through is cleared, and
+   * each stops max_length cells from the origin.  With per_column set, a column's cleared
+   * voxels are collected while the ray is inside it and its costmap cell is only updated once
+   * the ray leaves, which gives the same map as updating it for every voxel.
+   * @param end_points The x, y and z of each end point in grid coordinates, one after another
+   */
+  void clearVoxelRaysInMap(
+    double x0, double y0, double z0, const double * end_points, unsigned int num_points,
+    unsigned char * map_2d, unsigned int unknown_threshold, unsigned int mark_threshold,
+    unsigned char free_cost = 0, unsigned char unknown_cost = 255,
+    unsigned int max_length = UINT_MAX, bool per_column = true);
+
   VoxelStatus getVoxel(unsigned int x, unsigned int y, unsigned int z);
 
   // Are there any obstacles at that (x, y) location in the grid?
@@ -225,94 +231,23 @@ public:
     ActionType at, double x0, double y0, double z0,
     double x1, double y1, double z1, unsigned int max_length = UINT_MAX)
   {
-    int dx = int(x1) - int(x0);  // NOLINT
-    int dy = int(y1) - int(y0);  // NOLINT
-    int dz = int(z1) - int(z0);  // NOLINT
-
-    unsigned int abs_dx = abs(dx);
-    unsigned int abs_dy = abs(dy);
-    unsigned int abs_dz = abs(dz);
-
-    int offset_dx = sign(dx);
-    int offset_dy = sign(dy) * size_x_;
-    int offset_dz = sign(dz);
-
-    unsigned int z_mask = ((1 << 16) | 1) << (unsigned int)z0;
-    unsigned int offset = (unsigned int)y0 * size_x_ + (unsigned int)x0;
-
-    GridOffset grid_off(offset);
-    ZOffset z_off(z_mask);
+    // x and y fold into the column offset, z into the bit of the column
+    nav2_util::LineCell<3> cell{{int(x0), int(y0), int(z0)},  // NOLINT
+      (unsigned int)y0 * size_x_ + (unsigned int)x0};
+    const int delta[3] = {int(x1) - int(x0), int(y1) - int(y0), int(z1) - int(z0)};  // NOLINT
+    const int stride[3] = {1, static_cast<int>(size_x_), 0};
 
     // we need to chose how much to scale our dominant dimension, based on the
     // maximum length of the line
     double dist = sqrt((x0 - x1) * (x0 - x1) + (y0 - y1) * (y0 - y1) + (z0 - z1) * (z0 - z1));
-    double scale = std::min(1.0, max_length / dist);
-
-    // is x dominant
-    if (abs_dx >= max(abs_dy, abs_dz)) {
-      int error_y = abs_dx / 2;
-      int error_z = abs_dx / 2;
 
-      bresenham3D(at, grid_off, grid_off, z_off, abs_dx, abs_dy, abs_dz, error_y, error_z,
-        offset_dx, offset_dy, offset_dz, offset, z_mask, (unsigned int)(scale * abs_dx));
-      return;
-    }
-
-    // y is dominant
-    if (abs_dy >= abs_dz) {
-      int error_x = abs_dy / 2;
-      int error_z = abs_dy / 2;
-
-      bresenham3D(at, grid_off, grid_off, z_off, abs_dy, abs_dx, abs_dz, error_x, error_z,
-        offset_dy, offset_dx, offset_dz, offset, z_mask, (unsigned int)(scale * abs_dy));
-      return;
-    }
-
-    // otherwise, z is dominant
-    int error_x = abs_dz / 2;
-    int error_y = abs_dz / 2;
-
-    bresenham3D(at, z_off, grid_off, grid_off, abs_dz, abs_dx, abs_dy, error_x, error_y, offset_dz,
-      offset_dx, offset_dy, offset, z_mask, (unsigned int)(scale * abs_dz));
+    nav2_util::walkLine(cell, delta, stride, nav2_util::lineStepsWithin(delta, dist, max_length),
+      [&at](const nav2_util::LineCell<3> & c) {
+        at(c.offset, ((1u << 16) | 1u) << c.coord[2]);
+      });
   }
 
 private:
-  // the real work is done here... 3D bresenham implementation
-  template<class ActionType, class OffA, class OffB, class OffC>
-  inline void bresenham3D(
-    ActionType at, OffA off_a, OffB off_b, OffC off_c,
-    unsigned int abs_da, unsigned int abs_db, unsigned int abs_dc,
-    int error_b, int error_c, int offset_a, int offset_b, int offset_c, unsigned int & offset,
-    unsigned int & z_mask, unsigned int max_length = UINT_MAX)
-  {
-    unsigned int end = std::min(max_length, abs_da);
-    for (unsigned int i = 0; i < end; ++i) {
-      at(offset, z_mask);
-      off_a(offset_a);
-      error_b += abs_db;
-      error_c += abs_dc;
-      if ((unsigned int)error_b >= abs_da) {
-        off_b(offset_b);
-        error_b -= abs_da;
-      }
-      if ((unsigned int)error_c >= abs_da) {
-        off_c(offset_c);
-        error_c -= abs_da;
-      }
-    }
-    at(offset, z_mask);
-  }
-
-  inline int sign(int i)
-  {
-    return i > 0 ? 1 : -1;
-  }
-
-  inline unsigned int max(unsigned int x, unsigned int y)
-  {
-    return x > y ? x : y;
-  }
-
   unsigned int size_x_, size_y_, size_z_;
   uint32_t * data_;
   unsigned char * costmap;
@@ -383,15 +318,7 @@ public:
 private:
     inline bool bitsBelowThreshold(unsigned int n, unsigned int bit_threshold)
     {
-      unsigned int bit_count;
-      for (bit_count = 0; n; ) {
-        ++bit_count;
-        if (bit_count > bit_threshold) {
-          return false;
-        }
-        n &= n - 1;  // clear the least significant bit set
-      }
-      return true;
+      return __builtin_popcount(n) <= bit_threshold;
     }
 
     uint32_t * data_;
@@ -399,34 +326,6 @@ private:
     unsigned int unknown_clear_threshold_, marked_clear_threshold_;
     unsigned char free_cost_, unknown_cost_;
   };
-
-  class GridOffset
-  {
-public:
-    explicit GridOffset(unsigned int & offset)
-    : offset_(offset) {}
-    inline void operator()(int offset_val)
-    {
-      offset_ += offset_val;
-    }
-
-private:
-    unsigned int & offset_;
-  };
-
-  class ZOffset
-  {
-public:
-    explicit ZOffset(unsigned int & z_mask)
-    : z_mask_(z_mask) {}
-    inline void operator()(int offset_val)
-    {
-      offset_val > 0 ? z_mask_ <<= 1 : z_mask_ >>= 1;
-    }
-
-private:
-    unsigned int & z_mask_;
-  };
 };
 
 }  // namespace nav2_voxel_grid
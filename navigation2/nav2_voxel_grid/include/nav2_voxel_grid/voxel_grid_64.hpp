@@ -0,0 +1,185 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_VOXEL_GRID__VOXEL_GRID_64_HPP_
+#define NAV2_VOXEL_GRID__VOXEL_GRID_64_HPP_
+
+#include <stdint.h>
+#include <limits.h>
+#include <vector>
+
+#include "nav2_voxel_grid/voxel_dda.hpp"
+#include "nav2_voxel_grid/voxel_grid.hpp"
+
+namespace nav2_voxel_grid
+{
+
+/**
+ * @class VoxelGrid64
+ * @brief A VoxelGrid with up to 64 z levels per column.
+ *
+ * Each column is two 64-bit words, one with a bit per marked voxel and one
+ * with a bit per voxel that has not been seen yet, kept in separate arrays
+ * so that whole runs of columns can be classified at once.  The thresholds
+ * and return values match VoxelGrid, except that only the size_z levels in
+ * use start out unknown, so unknown thresholds need no padding for the
+ * unused bits.
+ */
+class VoxelGrid64
+{
+public:
+  static const unsigned int MAX_SIZE_Z = 64;
+
+  /**
+   * @brief  Constructor for a voxel grid
+   * @param size_x The x size of the grid
+   * @param size_y The y size of the grid
+   * @param size_z The z size of the grid, only sizes <= 64 are supported
+   */
+  VoxelGrid64(unsigned int size_x, unsigned int size_y, unsigned int size_z);
+
+  /**
+   * @brief  Resizes a voxel grid to the desired size, leaving every voxel unknown
+   */
+  void resize(unsigned int size_x, unsigned int size_y, unsigned int size_z);
+
+  void reset();
+
+  uint64_t * getMarkedData() {return marked_.data();}
+  uint64_t * getUnknownData() {return unknown_.data();}
+
+  /**
+   * @brief  The unknown word of a column that has not been seen yet
+   */
+  uint64_t getUnknownColumn() const {return unknown_column_;}
+
+  inline void markVoxel(unsigned int x, unsigned int y, unsigned int z)
+  {
+    if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
+      return;
+    }
+    unsigned int index = y * size_x_ + x;
+    marked_[index] |= bit(z);
+    unknown_[index] &= ~bit(z);
+  }
+
+  /**
+   * @brief  Mark a voxel, and return whether its column now has more than marked_threshold marks
+   */
+  inline bool markVoxelInMap(
+    unsigned int x, unsigned int y, unsigned int z,
+    unsigned int marked_threshold)
+  {
+    if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
+      return false;
+    }
+    unsigned int index = y * size_x_ + x;
+    marked_[index] |= bit(z);
+    unknown_[index] &= ~bit(z);
+    return bitCount(marked_[index]) > marked_threshold;
+  }
+
+  inline void clearVoxel(unsigned int x, unsigned int y, unsigned int z)
+  {
+    if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
+      return;
+    }
+    unsigned int index = y * size_x_ + x;
+    marked_[index] &= ~bit(z);
+    unknown_[index] &= ~bit(z);
+  }
+
+  inline void clearVoxelColumn(unsigned int index)
+  {
+    marked_[index] = 0;
+    unknown_[index] = 0;
+  }
+
+  void markVoxelLine(
+    double x0, double y0, double z0, double x1, double y1, double z1,
+    unsigned int max_length = UINT_MAX);
+  void clearVoxelLine(
+    double x0, double y0, double z0, double x1, double y1, double z1,
+    unsigned int max_length = UINT_MAX);
+  void clearVoxelLineInMap(
+    double x0, double y0, double z0, double x1, double y1, double z1, unsigned char * map_2d,
+    unsigned int unknown_threshold, unsigned int mark_threshold,
+    unsigned char free_cost = 0, unsigned char unknown_cost = 255,
+    unsigned int max_length = UINT_MAX);
+
+  /**
+   * @brief  Clear the voxels along rays from one origin, as VoxelGrid::clearVoxelRaysInMap() does
+   */
+  void clearVoxelRaysInMap(
+    double x0, double y0, double z0, const double * end_points, unsigned int num_points,
+    unsigned char * map_2d, unsigned int unknown_threshold, unsigned int mark_threshold,
+    unsigned char free_cost = 0, unsigned char unknown_cost = 255,
+    unsigned int max_length = UINT_MAX, bool per_column = true);
+
+  VoxelStatus getVoxel(unsigned int x, unsigned int y, unsigned int z) const;
+
+  // Are there any obstacles at that (x, y) location in the grid?
+  VoxelStatus getVoxelColumn(
+    unsigned int x, unsigned int y,
+    unsigned int unknown_threshold = 0, unsigned int marked_threshold = 0) const;
+
+  /**
+   * @brief  Classify count columns starting at index first, as getVoxelColumn() would
+   */
+  void getVoxelColumns(
+    unsigned int first, unsigned int count,
+    unsigned int unknown_threshold, unsigned int marked_threshold,
+    VoxelStatus * status) const;
+
+  /**
+   * @brief  Set every cell of a costmap with the size of the grid from its column
+   */
+  void updateCostmap(
+    unsigned char * costmap, unsigned int unknown_threshold, unsigned int marked_threshold,
+    unsigned char marked_cost, unsigned char free_cost = 0,
+    unsigned char unknown_cost = 255) const;
+
+  unsigned int sizeX() const {return size_x_;}
+  unsigned int sizeY() const {return size_y_;}
+  unsigned int sizeZ() const {return size_z_;}
+
+  static inline unsigned int bitCount(uint64_t n)
+  {
+    return __builtin_popcountll(n);
+  }
+
+private:
+  static inline uint64_t bit(unsigned int z)
+  {
+    return static_cast<uint64_t>(1) << z;
+  }
+
+  // Walks the voxels from (x0, y0, z0) to (x1, y1, z1) as VoxelGrid::raytraceLine() does,
+  // calling at(column index, z bit) for each
+  template<class ActionType>
+  void raytraceLine(
+    ActionType at, double x0, double y0, double z0,
+    double x1, double y1, double z1, unsigned int max_length);
+
+  bool lineInBounds(double x0, double y0, double z0, double x1, double y1, double z1) const;
+
+  unsigned int size_x_{0}, size_y_{0}, size_z_{0};
+  uint64_t unknown_column_{0};  ///< @brief The unknown word of an unseen column
+  std::vector<uint64_t> marked_;
+  std::vector<uint64_t> unknown_;
+};
+
+}  // namespace nav2_voxel_grid
+
+#endif  // NAV2_VOXEL_GRID__VOXEL_GRID_64_HPP_
@@ -37,6 +37,8 @@
 #include <nav2_voxel_grid/voxel_grid.hpp>
 #include <sys/time.h>
 
+#include "nav2_util/grid_memory.hpp"
+
 namespace nav2_voxel_grid
 {
 VoxelGrid::VoxelGrid(unsigned int size_x, unsigned int size_y, unsigned int size_z)
@@ -52,7 +54,7 @@ VoxelGrid::VoxelGrid(unsigned int size_x, unsigned int size_y, unsigned int size
     size_z_ = 16;
   }
 
-  data_ = new uint32_t[size_x_ * size_y_];
+  data_ = nav2_util::allocate_grid_of<uint32_t>(static_cast<size_t>(size_x_) * size_y_);
   uint32_t unknown_col = ~((uint32_t)0) >> 16;
   uint32_t * col = data_;
   for (unsigned int i = 0; i < size_x_ * size_y_; ++i) {
@@ -69,7 +71,7 @@ void VoxelGrid::resize(unsigned int size_x, unsigned int size_y, unsigned int si
     return;
   }
 
-  delete[] data_;
+  nav2_util::free_grid(data_);
   size_x_ = size_x;
   size_y_ = size_y;
   size_z_ = size_z;
@@ -80,7 +82,7 @@ void VoxelGrid::resize(unsigned int size_x, unsigned int size_y, unsigned int si
     size_z_ = 16;
   }
 
-  data_ = new uint32_t[size_x_ * size_y_];
+  data_ = nav2_util::allocate_grid_of<uint32_t>(static_cast<size_t>(size_x_) * size_y_);
   uint32_t unknown_col = ~((uint32_t)0) >> 16;
   uint32_t * col = data_;
   for (unsigned int i = 0; i < size_x_ * size_y_; ++i) {
@@ -91,7 +93,7 @@ void VoxelGrid::resize(unsigned int size_x, unsigned int size_y, unsigned int si
 
 VoxelGrid::~VoxelGrid()
 {
-  delete[] data_;
+  nav2_util::free_grid(data_);
 }
 
 void VoxelGrid::reset()
@@ -165,6 +167,52 @@ void VoxelGrid::clearVoxelLineInMap(
   raytraceLine(cvm, x0, y0, z0, x1, y1, z1, max_length);
 }
 
+void VoxelGrid::clearVoxelRaysInMap(
+  double x0, double y0, double z0, const double * end_points, unsigned int num_points,
+  unsigned char * map_2d, unsigned int unknown_threshold, unsigned int mark_threshold,
+  unsigned char free_cost, unsigned char unknown_cost, unsigned int max_length,
+  bool per_column)
+{
+  if (x0 >= size_x_ || y0 >= size_y_ || z0 >= size_z_) {
+    RCLCPP_DEBUG(logger, "Error, ray origin out of bounds. (%.2f, %.2f, %.2f)", x0, y0, z0);
+    return;
+  }
+
+  ClearVoxelInMap cvm(data_, map_2d, unknown_threshold, mark_threshold, free_cost, unknown_cost);
+  for (unsigned int i = 0; i < num_points; ++i) {
+    double x1 = end_points[3 * i];
+    double y1 = end_points[3 * i + 1];
+    double z1 = end_points[3 * i + 2];
+    if (x1 >= size_x_ || y1 >= size_y_ || z1 >= size_z_) {
+      RCLCPP_DEBUG(logger, "Error, ray end point out of bounds. (%.2f, %.2f, %.2f)", x1, y1, z1);
+      continue;
+    }
+
+    if (map_2d == NULL) {
+      ClearVoxel cv(data_);
+      raytraceDDA([&](unsigned int offset, unsigned int z) {
+          cv(offset, ((1 << 16) | 1) << z);
+        }, size_x_, x0, y0, z0, x1, y1, z1, max_length);
+    } else if (per_column) {
+      unsigned int column = 0;
+      unsigned int z_mask = 0;
+      raytraceDDA([&](unsigned int offset, unsigned int z) {
+          if (offset != column && z_mask) {
+            cvm(column, z_mask);
+            z_mask = 0;
+          }
+          column = offset;
+          z_mask |= ((1 << 16) | 1) << z;
+        }, size_x_, x0, y0, z0, x1, y1, z1, max_length);
+      cvm(column, z_mask);
+    } else {
+      raytraceDDA([&](unsigned int offset, unsigned int z) {
+          cvm(offset, ((1 << 16) | 1) << z);
+        }, size_x_, x0, y0, z0, x1, y1, z1, max_length);
+    }
+  }
+}
+
 VoxelStatus VoxelGrid::getVoxel(unsigned int x, unsigned int y, unsigned int z)
 {
   if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
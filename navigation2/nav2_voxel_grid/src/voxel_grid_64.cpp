@@ -0,0 +1,257 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_voxel_grid/voxel_grid_64.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "nav2_util/line_traversal.hpp"
+
+namespace nav2_voxel_grid
+{
+
+static rclcpp::Logger logger = rclcpp::get_logger("voxel_grid");
+
+VoxelGrid64::VoxelGrid64(unsigned int size_x, unsigned int size_y, unsigned int size_z)
+{
+  resize(size_x, size_y, size_z);
+}
+
+void VoxelGrid64::resize(unsigned int size_x, unsigned int size_y, unsigned int size_z)
+{
+  if (size_z > MAX_SIZE_Z) {
+    RCLCPP_INFO(logger, "Error, this implementation can only support up to 64 z values (%d)",
+      size_z);
+    size_z = MAX_SIZE_Z;
+  }
+  size_x_ = size_x;
+  size_y_ = size_y;
+  size_z_ = size_z;
+  unknown_column_ = size_z_ == MAX_SIZE_Z ? ~static_cast<uint64_t>(0) : bit(size_z_) - 1;
+
+  marked_.assign(size_x_ * size_y_, 0);
+  unknown_.assign(size_x_ * size_y_, unknown_column_);
+}
+
+void VoxelGrid64::reset()
+{
+  std::fill(marked_.begin(), marked_.end(), 0);
+  std::fill(unknown_.begin(), unknown_.end(), unknown_column_);
+}
+
+bool VoxelGrid64::lineInBounds(
+  double x0, double y0, double z0, double x1, double y1, double z1) const
+{
+  if (x0 >= size_x_ || y0 >= size_y_ || z0 >= size_z_ || x1 >= size_x_ || y1 >= size_y_ ||
+    z1 >= size_z_)
+  {
+    RCLCPP_DEBUG(logger,
+      "Error, line endpoint out of bounds. "
+      "(%.2f, %.2f, %.2f) to (%.2f, %.2f, %.2f),  size: (%d, %d, %d)",
+      x0, y0, z0, x1, y1, z1, size_x_, size_y_, size_z_);
+    return false;
+  }
+  return true;
+}
+
+template<class ActionType>
+void VoxelGrid64::raytraceLine(
+  ActionType at, double x0, double y0, double z0,
+  double x1, double y1, double z1, unsigned int max_length)
+{
+  nav2_util::LineCell<3> cell{{static_cast<int>(x0), static_cast<int>(y0), static_cast<int>(z0)},
+    static_cast<unsigned int>(y0) * size_x_ + static_cast<unsigned int>(x0)};
+  const int delta[3] = {static_cast<int>(x1) - static_cast<int>(x0),
+    static_cast<int>(y1) - static_cast<int>(y0), static_cast<int>(z1) - static_cast<int>(z0)};
+  const int stride[3] = {1, static_cast<int>(size_x_), 0};
+
+  double dist = sqrt((x0 - x1) * (x0 - x1) + (y0 - y1) * (y0 - y1) + (z0 - z1) * (z0 - z1));
+
+  nav2_util::walkLine(cell, delta, stride, nav2_util::lineStepsWithin(delta, dist, max_length),
+    [&at](const nav2_util::LineCell<3> & c) {
+      at(c.offset, static_cast<unsigned int>(c.coord[2]));
+    });
+}
+
+void VoxelGrid64::markVoxelLine(
+  double x0, double y0, double z0, double x1, double y1, double z1,
+  unsigned int max_length)
+{
+  if (!lineInBounds(x0, y0, z0, x1, y1, z1)) {
+    return;
+  }
+  raytraceLine([this](unsigned int offset, unsigned int z) {
+      marked_[offset] |= bit(z);
+      unknown_[offset] &= ~bit(z);
+    }, x0, y0, z0, x1, y1, z1, max_length);
+}
+
+void VoxelGrid64::clearVoxelLine(
+  double x0, double y0, double z0, double x1, double y1, double z1,
+  unsigned int max_length)
+{
+  if (!lineInBounds(x0, y0, z0, x1, y1, z1)) {
+    return;
+  }
+  raytraceLine([this](unsigned int offset, unsigned int z) {
+      marked_[offset] &= ~bit(z);
+      unknown_[offset] &= ~bit(z);
+    }, x0, y0, z0, x1, y1, z1, max_length);
+}
+
+void VoxelGrid64::clearVoxelLineInMap(
+  double x0, double y0, double z0, double x1, double y1, double z1, unsigned char * map_2d,
+  unsigned int unknown_threshold, unsigned int mark_threshold, unsigned char free_cost,
+  unsigned char unknown_cost, unsigned int max_length)
+{
+  if (map_2d == NULL) {
+    clearVoxelLine(x0, y0, z0, x1, y1, z1, max_length);
+    return;
+  }
+  if (!lineInBounds(x0, y0, z0, x1, y1, z1)) {
+    return;
+  }
+
+  raytraceLine([&](unsigned int offset, unsigned int z) {
+      marked_[offset] &= ~bit(z);
+      unknown_[offset] &= ~bit(z);
+
+      // make sure the number of bits in each is below our thesholds
+      if (bitCount(marked_[offset]) <= mark_threshold) {
+        if (bitCount(unknown_[offset]) <= unknown_threshold) {
+          map_2d[offset] = free_cost;
+        } else {
+          map_2d[offset] = unknown_cost;
+        }
+      }
+    }, x0, y0, z0, x1, y1, z1, max_length);
+}
+
+void VoxelGrid64::clearVoxelRaysInMap(
+  double x0, double y0, double z0, const double * end_points, unsigned int num_points,
+  unsigned char * map_2d, unsigned int unknown_threshold, unsigned int mark_threshold,
+  unsigned char free_cost, unsigned char unknown_cost, unsigned int max_length,
+  bool per_column)
+{
+  if (x0 >= size_x_ || y0 >= size_y_ || z0 >= size_z_) {
+    RCLCPP_DEBUG(logger, "Error, ray origin out of bounds. (%.2f, %.2f, %.2f)", x0, y0, z0);
+    return;
+  }
+
+  auto clear_in_map = [&](unsigned int offset, uint64_t z_mask) {
+      marked_[offset] &= ~z_mask;
+      unknown_[offset] &= ~z_mask;
+      if (map_2d && bitCount(marked_[offset]) <= mark_threshold) {
+        if (bitCount(unknown_[offset]) <= unknown_threshold) {
+          map_2d[offset] = free_cost;
+        } else {
+          map_2d[offset] = unknown_cost;
+        }
+      }
+    };
+
+  for (unsigned int i = 0; i < num_points; ++i) {
+    double x1 = end_points[3 * i];
+    double y1 = end_points[3 * i + 1];
+    double z1 = end_points[3 * i + 2];
+    if (x1 >= size_x_ || y1 >= size_y_ || z1 >= size_z_) {
+      RCLCPP_DEBUG(logger, "Error, ray end point out of bounds. (%.2f, %.2f, %.2f)", x1, y1, z1);
+      continue;
+    }
+
+    if (per_column) {
+      unsigned int column = 0;
+      uint64_t z_mask = 0;
+      raytraceDDA([&](unsigned int offset, unsigned int z) {
+          if (offset != column && z_mask) {
+            clear_in_map(column, z_mask);
+            z_mask = 0;
+          }
+          column = offset;
+          z_mask |= bit(z);
+        }, size_x_, x0, y0, z0, x1, y1, z1, max_length);
+      clear_in_map(column, z_mask);
+    } else {
+      raytraceDDA([&](unsigned int offset, unsigned int z) {
+          clear_in_map(offset, bit(z));
+        }, size_x_, x0, y0, z0, x1, y1, z1, max_length);
+    }
+  }
+}
+
+VoxelStatus VoxelGrid64::getVoxel(unsigned int x, unsigned int y, unsigned int z) const
+{
+  if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
+    RCLCPP_DEBUG(logger, "Error, voxel out of bounds. (%d, %d, %d)\n", x, y, z);
+    return UNKNOWN;
+  }
+  unsigned int index = y * size_x_ + x;
+  if (marked_[index] & bit(z)) {
+    return MARKED;
+  }
+  return (unknown_[index] & bit(z)) ? UNKNOWN : FREE;
+}
+
+VoxelStatus VoxelGrid64::getVoxelColumn(
+  unsigned int x, unsigned int y,
+  unsigned int unknown_threshold, unsigned int marked_threshold) const
+{
+  if (x >= size_x_ || y >= size_y_) {
+    RCLCPP_DEBUG(logger, "Error, voxel out of bounds. (%d, %d)\n", x, y);
+    return UNKNOWN;
+  }
+
+  VoxelStatus status;
+  getVoxelColumns(y * size_x_ + x, 1, unknown_threshold, marked_threshold, &status);
+  return status;
+}
+
+void VoxelGrid64::getVoxelColumns(
+  unsigned int first, unsigned int count,
+  unsigned int unknown_threshold, unsigned int marked_threshold,
+  VoxelStatus * status) const
+{
+  // branch free so that the loop vectorizes where the target has a vector popcount,
+  // and otherwise runs one popcount instruction per word
+  const uint64_t * marked = marked_.data() + first;
+  const uint64_t * unknown = unknown_.data() + first;
+  for (unsigned int i = 0; i < count; ++i) {
+    unsigned int is_marked = bitCount(marked[i]) > marked_threshold;
+    unsigned int is_unknown = bitCount(unknown[i]) > unknown_threshold;
+    status[i] = static_cast<VoxelStatus>(is_marked ? static_cast<unsigned int>(MARKED) :
+      is_unknown * UNKNOWN);
+  }
+}
+
+void VoxelGrid64::updateCostmap(
+  unsigned char * costmap, unsigned int unknown_threshold, unsigned int marked_threshold,
+  unsigned char marked_cost, unsigned char free_cost, unsigned char unknown_cost) const
+{
+  const unsigned char costs[3] = {free_cost, unknown_cost, marked_cost};
+  const unsigned int batch = 256;
+  VoxelStatus status[batch];
+
+  unsigned int size = size_x_ * size_y_;
+  for (unsigned int first = 0; first < size; first += batch) {
+    unsigned int count = std::min(batch, size - first);
+    getVoxelColumns(first, count, unknown_threshold, marked_threshold, status);
+    for (unsigned int i = 0; i < count; ++i) {
+      costmap[first + i] = costs[status[i]];
+    }
+  }
+}
+
+}  // namespace nav2_voxel_grid
@@ -0,0 +1,132 @@
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include "nav2_voxel_grid/voxel_grid.hpp"
+#include "nav2_voxel_grid/voxel_grid_64.hpp"
+
+static double randomCoordinate(unsigned int size)
+{
+  return (rand() % (size * 100)) / 100.0;
+}
+
+TEST(voxel_grid_64, matchesVoxelGrid) {
+  const unsigned int size_x = 20, size_y = 15, size_z = 10;
+  nav2_voxel_grid::VoxelGrid vg(size_x, size_y, size_z);
+  nav2_voxel_grid::VoxelGrid64 vg64(size_x, size_y, size_z);
+  std::vector<unsigned char> map(size_x * size_y, 100), map64(size_x * size_y, 100);
+
+  srand(3);
+  for (int i = 0; i < 400; ++i) {
+    double x0 = randomCoordinate(size_x), y0 = randomCoordinate(size_y);
+    double z0 = randomCoordinate(size_z);
+    double x1 = randomCoordinate(size_x), y1 = randomCoordinate(size_y);
+    double z1 = randomCoordinate(size_z);
+    unsigned int max_length = i % 3 == 0 ? 5 : UINT_MAX;
+    if (i % 2) {
+      vg.markVoxelLine(x0, y0, z0, x1, y1, z1, max_length);
+      vg64.markVoxelLine(x0, y0, z0, x1, y1, z1, max_length);
+    } else {
+      // VoxelGrid counts the unused levels above size_z as unknown
+      vg.clearVoxelLineInMap(x0, y0, z0, x1, y1, z1, &map[0], 16 - size_z + 2, 1,
+        0, 255, max_length);
+      vg64.clearVoxelLineInMap(x0, y0, z0, x1, y1, z1, &map64[0], 2, 1, 0, 255, max_length);
+    }
+  }
+
+  for (unsigned int y = 0; y < size_y; ++y) {
+    for (unsigned int x = 0; x < size_x; ++x) {
+      for (unsigned int z = 0; z < size_z; ++z) {
+        ASSERT_EQ(vg.getVoxel(x, y, z), vg64.getVoxel(x, y, z));
+      }
+      ASSERT_EQ(vg.getVoxelColumn(x, y, 16 - size_z + 3, 2), vg64.getVoxelColumn(x, y, 3, 2));
+      ASSERT_EQ(map[y * size_x + x], map64[y * size_x + x]);
+    }
+  }
+}
+
+TEST(voxel_grid_64, clearRaysMatchesVoxelGrid) {
+  const unsigned int size_x = 25, size_y = 25, size_z = 12;
+  nav2_voxel_grid::VoxelGrid vg(size_x, size_y, size_z);
+  nav2_voxel_grid::VoxelGrid64 vg64(size_x, size_y, size_z);
+  std::vector<unsigned char> map(size_x * size_y, 254), map64(size_x * size_y, 254);
+
+  srand(8);
+  std::vector<double> end_points;
+  for (int i = 0; i < 200; ++i) {
+    unsigned int x = rand() % size_x, y = rand() % size_y, z = rand() % size_z;
+    vg.markVoxel(x, y, z);
+    vg64.markVoxel(x, y, z);
+    end_points.push_back(randomCoordinate(size_x));
+    end_points.push_back(randomCoordinate(size_y));
+    end_points.push_back(randomCoordinate(size_z));
+  }
+  vg.clearVoxelRaysInMap(12.5, 12.5, 6.5, &end_points[0], 200, &map[0], 16 - size_z + 3, 0);
+  vg64.clearVoxelRaysInMap(12.5, 12.5, 6.5, &end_points[0], 200, &map64[0], 3, 0);
+
+  for (unsigned int y = 0; y < size_y; ++y) {
+    for (unsigned int x = 0; x < size_x; ++x) {
+      for (unsigned int z = 0; z < size_z; ++z) {
+        ASSERT_EQ(vg.getVoxel(x, y, z), vg64.getVoxel(x, y, z));
+      }
+      ASSERT_EQ(map[y * size_x + x], map64[y * size_x + x]);
+    }
+  }
+}
+
+TEST(voxel_grid_64, sixtyFourLevels) {
+  nav2_voxel_grid::VoxelGrid64 vg(4, 3, 80);
+  ASSERT_EQ(vg.sizeZ(), 64u);
+  vg.resize(4, 3, 60);
+  ASSERT_EQ(vg.sizeZ(), 60u);
+
+  // a forklift mast is a column of marks from the floor to the top level
+  vg.markVoxelLine(1.5, 1.5, 0.0, 1.5, 1.5, 59.5);
+  for (unsigned int z = 0; z < 60; ++z) {
+    ASSERT_EQ(vg.getVoxel(1, 1, z), nav2_voxel_grid::MARKED);
+  }
+  ASSERT_EQ(vg.getVoxel(1, 1, 60), nav2_voxel_grid::UNKNOWN);
+  ASSERT_EQ(nav2_voxel_grid::VoxelGrid64::bitCount(vg.getMarkedData()[1 * 4 + 1]), 60u);
+
+  vg.clearVoxelLine(3.5, 0.5, 10.5, 3.5, 0.5, 59.5);
+  vg.markVoxel(0, 2, 45);
+
+  std::vector<unsigned char> costmap(4 * 3, 7);
+  vg.updateCostmap(&costmap[0], 10, 0, 254, 0, 255);
+  for (unsigned int y = 0; y < 3; ++y) {
+    for (unsigned int x = 0; x < 4; ++x) {
+      unsigned char expected = 255;
+      if ((x == 1 && y == 1) || (x == 0 && y == 2)) {
+        expected = 254;
+      } else if (x == 3 && y == 0) {
+        expected = 0;
+      }
+      EXPECT_EQ(costmap[y * 4 + x], expected) << x << ", " << y;
+    }
+  }
+
+  vg.reset();
+  ASSERT_EQ(vg.getVoxelColumn(1, 1, 59, 0), nav2_voxel_grid::UNKNOWN);
+  ASSERT_EQ(vg.getVoxelColumn(1, 1, 60, 0), nav2_voxel_grid::FREE);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
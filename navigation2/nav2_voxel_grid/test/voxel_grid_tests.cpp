@@ -36,6 +36,8 @@
 *********************************************************************/
 #include <nav2_voxel_grid/voxel_grid.hpp>
 #include <gtest/gtest.h>
+#include <stdlib.h>
+#include <vector>
 
 TEST(voxel_grid, basicMarkingAndClearing) {
   int size_x = 50, size_y = 10, size_z = 16;
@@ -137,6 +139,74 @@ TEST(voxel_grid, basicMarkingAndClearing) {
      */
 }
 
+TEST(voxel_grid, ddaVisitsEveryCrossedVoxel) {
+  unsigned int size_x = 20;
+  srand(5);
+  for (int i = 0; i < 200; ++i) {
+    double x0 = (rand() % 2000) / 100.0, y0 = (rand() % 1000) / 100.0;
+    double z0 = (rand() % 1600) / 100.0;
+    double x1 = (rand() % 2000) / 100.0, y1 = (rand() % 1000) / 100.0;
+    double z1 = (rand() % 1600) / 100.0;
+
+    std::vector<unsigned int> offsets, zs;
+    nav2_voxel_grid::raytraceDDA([&](unsigned int offset, unsigned int z) {
+        offsets.push_back(offset);
+        zs.push_back(z);
+      }, size_x, x0, y0, z0, x1, y1, z1);
+
+    // the walk goes from the origin voxel to the end voxel one face at a time
+    ASSERT_EQ(offsets.front(), static_cast<unsigned int>(y0) * size_x +
+      static_cast<unsigned int>(x0));
+    ASSERT_EQ(zs.front(), static_cast<unsigned int>(z0));
+    ASSERT_EQ(offsets.back(), static_cast<unsigned int>(y1) * size_x +
+      static_cast<unsigned int>(x1));
+    ASSERT_EQ(zs.back(), static_cast<unsigned int>(z1));
+    unsigned int steps = abs(static_cast<int>(x1) - static_cast<int>(x0)) +
+      abs(static_cast<int>(y1) - static_cast<int>(y0)) +
+      abs(static_cast<int>(z1) - static_cast<int>(z0));
+    ASSERT_EQ(offsets.size(), steps + 1);
+  }
+
+  // a ray along x stops once it is max_length cells long
+  unsigned int count = 0;
+  nav2_voxel_grid::raytraceDDA([&](unsigned int, unsigned int) {++count;},
+    size_x, 0.5, 0.5, 0.5, 19.5, 0.5, 0.5, 4.0);
+  ASSERT_EQ(count, 5u);
+}
+
+TEST(voxel_grid, clearRaysPerColumn) {
+  unsigned int size_x = 30, size_y = 20, size_z = 10;
+  nav2_voxel_grid::VoxelGrid per_voxel(size_x, size_y, size_z);
+  nav2_voxel_grid::VoxelGrid per_column(size_x, size_y, size_z);
+  std::vector<unsigned char> map_voxel(size_x * size_y, 254), map_column(size_x * size_y, 254);
+
+  srand(11);
+  for (int i = 0; i < 300; ++i) {
+    unsigned int x = rand() % size_x, y = rand() % size_y, z = rand() % size_z;
+    per_voxel.markVoxel(x, y, z);
+    per_column.markVoxel(x, y, z);
+  }
+
+  std::vector<double> end_points;
+  for (int i = 0; i < 100; ++i) {
+    end_points.push_back((rand() % 3000) / 100.0);
+    end_points.push_back((rand() % 2000) / 100.0);
+    end_points.push_back((rand() % 1000) / 100.0);
+  }
+  per_voxel.clearVoxelRaysInMap(15.2, 10.7, 5.5, &end_points[0], 100, &map_voxel[0],
+    6 + 4, 0, 0, 255, 12, false);
+  per_column.clearVoxelRaysInMap(15.2, 10.7, 5.5, &end_points[0], 100, &map_column[0],
+    6 + 4, 0, 0, 255, 12, true);
+
+  unsigned int cleared = 0;
+  for (unsigned int i = 0; i < size_x * size_y; ++i) {
+    ASSERT_EQ(per_voxel.getData()[i], per_column.getData()[i]);
+    ASSERT_EQ(map_voxel[i], map_column[i]);
+    cleared += map_voxel[i] != 254;
+  }
+  ASSERT_GT(cleared, 0u);
+}
+
 int main(int argc, char ** argv)
 {
   testing::InitGoogleTest(&argc, argv);
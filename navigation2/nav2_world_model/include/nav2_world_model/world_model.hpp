@@ -16,10 +16,12 @@
 #define NAV2_WORLD_MODEL__WORLD_MODEL_HPP_
 
 #include <memory>
+#include <string>
 #include <thread>
 
 #include "nav2_costmap_2d/costmap_2d_ros.hpp"
 #include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/metrics.hpp"
 #include "nav2_msgs/msg/costmap.hpp"
 #include "nav2_msgs/srv/get_costmap.hpp"
 
@@ -29,7 +31,7 @@ namespace nav2_world_model
 class WorldModel : public nav2_util::LifecycleNode
 {
 public:
-  WorldModel();
+  explicit WorldModel(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   ~WorldModel();
 
 protected:
@@ -49,6 +51,17 @@ protected:
     const std::shared_ptr<nav2_msgs::srv::GetCostmap::Request> request,
     const std::shared_ptr<nav2_msgs::srv::GetCostmap::Response> response);
 
+  // Whether a requested layer name means the master grid: none, "Master" or "master"
+  static bool isMasterLayer(const std::string & layer);
+
+  // Copy the window of the costmap requested by specs into window, clipped to the costmap,
+  // setting origin_x and origin_y to its lower left corner and factor to the number of its
+  // cells to merge into one in each direction. Returns false if nothing of it is on the map.
+  bool copyWindow(
+    const nav2_costmap_2d::Costmap2D & costmap, const nav2_msgs::msg::CostmapMetaData & specs,
+    nav2_costmap_2d::Costmap2D & window, double & origin_x, double & origin_y,
+    unsigned int & factor);
+
   // The implementation of the WorldModel uses a Costmap2DROS node
   std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros_;
 
@@ -60,7 +73,10 @@ protected:
   static constexpr const char * metadata_layer_{"Master"};
 
   // An executor used to spin the costmap node
-  std::unique_ptr<rclcpp::executors::SingleThreadedExecutor> costmap_executor_;
+  std::unique_ptr<rclcpp::executor::Executor> costmap_executor_;
+
+  // Every GetCostmap request served
+  nav2_util::LatencyHistogram & service_time_;
 };
 
 }  // namespace nav2_world_model
@@ -13,8 +13,11 @@
 // limitations under the License.
 
 #include "nav2_world_model/world_model.hpp"
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <string>
+#include "nav2_costmap_2d/cost_values.hpp"
 #include "nav2_util/node_utils.hpp"
 
 
@@ -23,17 +26,20 @@ using namespace std::placeholders;
 namespace nav2_world_model
 {
 
-WorldModel::WorldModel()
-: nav2_util::LifecycleNode("world_model")
+WorldModel::WorldModel(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("world_model", "", false, options),
+  service_time_(nav2_util::MetricsRegistry::global().histogram("world_model.get_costmap",
+    "GetCostmap request"))
 {
   RCLCPP_INFO(get_logger(), "Creating World Model");
 
   // The costmap node is used in the implementation of the world model
   costmap_ros_ = std::make_shared<nav2_costmap_2d::Costmap2DROS>(
     "global_costmap", nav2_util::add_namespaces(std::string{get_namespace()}, "global_costmap"));
+  add_startup_child(costmap_ros_);
 
   // Create an executor that will be used to spin the costmap node
-  costmap_executor_ = std::make_unique<rclcpp::executors::SingleThreadedExecutor>();
+  costmap_executor_ = costmap_ros_->createExecutor();
 
   // Launch a thread to run the costmap node
   costmap_thread_ = std::make_unique<std::thread>(
@@ -116,9 +122,10 @@ WorldModel::on_shutdown(const rclcpp_lifecycle::State & /*state*/)
 void
 WorldModel::costmap_service_callback(
   const std::shared_ptr<rmw_request_id_t>/*request_header*/,
-  const std::shared_ptr<nav2_msgs::srv::GetCostmap::Request>/*request*/,
+  const std::shared_ptr<nav2_msgs::srv::GetCostmap::Request> request,
   const std::shared_ptr<nav2_msgs::srv::GetCostmap::Response> response)
 {
+  nav2_util::ScopedTimer timer(service_time_);
   RCLCPP_DEBUG(get_logger(), "Received costmap service request");
 
   // TODO(bpwilcox): Grab correct orientation information
@@ -126,27 +133,124 @@ WorldModel::costmap_service_callback(
   quaternion.setRPY(0.0, 0.0, 0.0);
 
   nav2_costmap_2d::Costmap2D * costmap_ = costmap_ros_->getCostmap();
+  std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
 
-  auto size_x = costmap_->getSizeInCellsX();
-  auto size_y = costmap_->getSizeInCellsY();
+  // A named layer is served from its own grid, which its updates write under the master
+  // grid's mutex, so it is copied out before the lock is let go
+  std::string layer_name = metadata_layer_;
+  std::shared_ptr<nav2_costmap_2d::CostmapLayer> layer;
+  if (!isMasterLayer(request->specs.layer)) {
+    layer = costmap_ros_->getCostmapLayer(request->specs.layer);
+    if (!layer) {
+      RCLCPP_WARN(get_logger(), "There is no layer \"%s\" with a grid of its own to send",
+        request->specs.layer.c_str());
+      response->map.metadata.layer = request->specs.layer;
+      return;
+    }
+    layer_name = request->specs.layer;
+  }
+  const nav2_costmap_2d::Costmap2D & costs = layer ? *layer : *costmap_;
+
+  // Without a size the whole costmap is sent, as it was before windows could be requested
+  const nav2_costmap_2d::Costmap2D * source = &costs;
+  double origin_x = costs.getOriginX();
+  double origin_y = costs.getOriginY();
+  unsigned int factor = 1;
+  nav2_costmap_2d::Costmap2D window;
+  if (request->specs.size_x > 0 && request->specs.size_y > 0) {
+    if (!copyWindow(costs, request->specs, window, origin_x, origin_y, factor)) {
+      RCLCPP_WARN(get_logger(), "The requested costmap window at (%.2f, %.2f) is off the map",
+        request->specs.origin.position.x, request->specs.origin.position.y);
+    }
+    source = &window;
+  } else if (layer) {
+    window = costs;
+    source = &window;
+  }
+  lock.unlock();
+
+  auto source_x = source->getSizeInCellsX();
+  auto source_y = source->getSizeInCellsY();
+  auto size_x = (source_x + factor - 1) / factor;
+  auto size_y = (source_y + factor - 1) / factor;
   auto data_length = size_x * size_y;
-  unsigned char * data = costmap_->getCharMap();
+  unsigned char * data = source->getCharMap();
   auto current_time = now();
 
   response->map.header.stamp = current_time;
   response->map.header.frame_id = frame_id_;
   response->map.metadata.size_x = size_x;
   response->map.metadata.size_y = size_y;
-  response->map.metadata.resolution = costmap_->getResolution();
-  response->map.metadata.layer = metadata_layer_;
+  response->map.metadata.resolution = costmap_->getResolution() * factor;
+  response->map.metadata.layer = layer_name;
   response->map.metadata.map_load_time = current_time;
   response->map.metadata.update_time = current_time;
-  response->map.metadata.origin.position.x = costmap_->getOriginX();
-  response->map.metadata.origin.position.y = costmap_->getOriginY();
+  response->map.metadata.origin.position.x = origin_x;
+  response->map.metadata.origin.position.y = origin_y;
   response->map.metadata.origin.position.z = 0.0;
   response->map.metadata.origin.orientation = tf2::toMsg(quaternion);
-  response->map.data.resize(data_length);
-  response->map.data.assign(data, data + data_length);
+
+  if (factor == 1) {
+    response->map.data.assign(data, data + data_length);
+    return;
+  }
+
+  // A merged cell takes the highest known cost under it, so no obstacle is lost,
+  // and is unknown only if all of them are
+  response->map.data.assign(data_length, nav2_costmap_2d::NO_INFORMATION);
+  for (unsigned int y = 0; y < source_y; ++y) {
+    for (unsigned int x = 0; x < source_x; ++x) {
+      unsigned char cost = data[y * source_x + x];
+      unsigned char & merged = response->map.data[(y / factor) * size_x + x / factor];
+      if (cost != nav2_costmap_2d::NO_INFORMATION &&
+        (merged == nav2_costmap_2d::NO_INFORMATION || cost > merged))
+      {
+        merged = cost;
+      }
+    }
+  }
+}
+
+bool
+WorldModel::isMasterLayer(const std::string & layer)
+{
+  return layer.empty() || layer == metadata_layer_ || layer == "master";
+}
+
+bool
+WorldModel::copyWindow(
+  const nav2_costmap_2d::Costmap2D & costmap, const nav2_msgs::msg::CostmapMetaData & specs,
+  nav2_costmap_2d::Costmap2D & window, double & origin_x, double & origin_y,
+  unsigned int & factor)
+{
+  // The window is specs.size_x by specs.size_y cells of specs.resolution, which is rounded
+  // to a whole number of the costmap's cells
+  const double resolution = costmap.getResolution();
+  factor = std::max(1, static_cast<int>(std::round(specs.resolution / resolution)));
+
+  // The costmap cells in the window, clipped to the costmap but for its last row and column,
+  // which copyCostmapWindow cannot reach
+  const int size_x = costmap.getSizeInCellsX();
+  const int size_y = costmap.getSizeInCellsY();
+  double x0 = (specs.origin.position.x - costmap.getOriginX()) / resolution;
+  double y0 = (specs.origin.position.y - costmap.getOriginY()) / resolution;
+  int mx0 = std::max(0, static_cast<int>(std::floor(x0)));
+  int my0 = std::max(0, static_cast<int>(std::floor(y0)));
+  int mxn = std::min(size_x - 1, static_cast<int>(std::ceil(x0 + specs.size_x * factor)));
+  int myn = std::min(size_y - 1, static_cast<int>(std::ceil(y0 + specs.size_y * factor)));
+  if (mxn <= mx0 || myn <= my0) {
+    return false;
+  }
+
+  // Aim at the cell centers so that rounding cannot move the window by a cell
+  origin_x = costmap.getOriginX() + mx0 * resolution;
+  origin_y = costmap.getOriginY() + my0 * resolution;
+  return window.copyCostmapWindow(costmap, origin_x + 0.5 * resolution,
+           origin_y + 0.5 * resolution, (mxn - mx0) * resolution, (myn - my0) * resolution);
 }
 
 }  // namespace nav2_world_model
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_world_model::WorldModel)
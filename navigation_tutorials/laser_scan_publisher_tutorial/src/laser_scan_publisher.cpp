@@ -34,50 +34,198 @@
 *
 * Author: Eitan Marder-Eppstein
 *********************************************************************/
+// A synthetic laser load: num_sensors scanners on one robot, each publishing num_readings beams
+// at rate Hz on scan (scan_0, scan_1, ... for more than one). The beams are cast in the map
+// of the static_map service from the robot at (x, y, yaw) in it, each scanner turned by
+// 2 pi / num_sensors from the one before, with num_obstacles round obstacles of
+// obstacle_radius scattered within obstacle_range of the robot, scattered anew every
+// obstacle_period seconds (0 to keep them). Without use_map, the obstacles are all there is.
+// The ranges get gaussian noise of noise_stddev, and a fraction dropout_ratio of the beams
+// return nothing. The scanners are published on tf from base_frame.
+//
+// Every message is published as a shared pointer, which roscpp hands to subscribers in the same
+// process (nodelets) without serializing it. Every 10 s, the achieved rate is logged.
 #include <ros/ros.h>
+#include <nav_msgs/GetMap.h>
 #include <sensor_msgs/LaserScan.h>
+#include <tf/transform_broadcaster.h>
+#include <tf/transform_datatypes.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Obstacle {
+  double x, y;
+};
+
+// The range along a ray from (x, y) to the first occupied cell of the map, or max_range
+double castInMap(const nav_msgs::OccupancyGrid& map, double x, double y, double angle,
+                 double max_range){
+  double step = map.info.resolution / 2;
+  double dx = cos(angle) * step, dy = sin(angle) * step;
+  double origin_x = map.info.origin.position.x, origin_y = map.info.origin.position.y;
+  for(double range = 0; range < max_range; range += step, x += dx, y += dy){
+    int i = static_cast<int>(floor((x - origin_x) / map.info.resolution));
+    int j = static_cast<int>(floor((y - origin_y) / map.info.resolution));
+    if(i < 0 || j < 0 || i >= static_cast<int>(map.info.width) ||
+       j >= static_cast<int>(map.info.height)){
+      break;
+    }
+    if(map.data[j * map.info.width + i] >= 65){
+      return range;
+    }
+  }
+  return max_range;
+}
+
+// The range along a ray from (x, y) to the nearest obstacle it crosses, or max_range
+double castAtObstacles(const std::vector<Obstacle>& obstacles, double radius, double x, double y,
+                       double angle, double max_range){
+  double c = cos(angle), s = sin(angle);
+  double best = max_range;
+  for(const Obstacle& obstacle : obstacles){
+    double ox = obstacle.x - x, oy = obstacle.y - y;
+    double along = ox * c + oy * s;
+    double across2 = ox * ox + oy * oy - along * along;
+    if(along > 0 && across2 < radius * radius){
+      best = std::min(best, along - sqrt(radius * radius - across2));
+    }
+  }
+  return std::max(best, 0.0);
+}
+
+}  // namespace
 
 int main(int argc, char** argv){
   ros::init(argc, argv, "laser_scan_publisher");
 
   ros::NodeHandle n;
-  ros::Publisher scan_pub = n.advertise<sensor_msgs::LaserScan>("scan", 50);
+  ros::NodeHandle pn("~");
 
-  unsigned int num_readings = 100;
-  double laser_frequency = 40;
-  double ranges[num_readings];
-  double intensities[num_readings];
+  int num_sensors, num_readings, num_obstacles;
+  double rate, x, y, yaw, noise_stddev, dropout_ratio, range_max;
+  double obstacle_radius, obstacle_range, obstacle_period;
+  bool use_map;
+  std::string base_frame;
+  pn.param("num_sensors", num_sensors, 1);
+  pn.param("num_readings", num_readings, 100);
+  pn.param("rate", rate, 1.0);
+  pn.param("range_max", range_max, 10.0);
+  pn.param("use_map", use_map, false);
+  pn.param("x", x, 0.0);
+  pn.param("y", y, 0.0);
+  pn.param("yaw", yaw, 0.0);
+  pn.param("num_obstacles", num_obstacles, 0);
+  pn.param("obstacle_radius", obstacle_radius, 0.2);
+  pn.param("obstacle_range", obstacle_range, 3.0);
+  pn.param("obstacle_period", obstacle_period, 0.0);
+  pn.param("noise_stddev", noise_stddev, 0.0);
+  pn.param("dropout_ratio", dropout_ratio, 0.0);
+  pn.param("base_frame", base_frame, std::string("base_link"));
+  num_sensors = std::max(num_sensors, 1);
+  num_readings = std::max(num_readings, 1);
 
-  int count = 0;
-  ros::Rate r(1.0);
-  while(n.ok()){
-    //generate some fake data for our laser scan
-    for(unsigned int i = 0; i < num_readings; ++i){
-      ranges[i] = count;
-      intensities[i] = 100 + count;
+  nav_msgs::GetMap get_map;
+  if(use_map){
+    ros::service::waitForService("static_map");
+    if(!ros::service::call("static_map", get_map)){
+      ROS_ERROR("Could not get the map from static_map");
+      return 1;
     }
-    ros::Time scan_time = ros::Time::now();
+  }
+
+  //one scanner per sensor, around the robot
+  std::vector<ros::Publisher> scan_pubs;
+  std::vector<sensor_msgs::LaserScan> scans(num_sensors);
+  std::vector<tf::StampedTransform> mounts;
+  double laser_frequency = 40;
+  for(int k = 0; k < num_sensors; ++k){
+    std::string suffix = num_sensors > 1 ? "_" + std::to_string(k) : "";
+    scan_pubs.push_back(n.advertise<sensor_msgs::LaserScan>("scan" + suffix, 50));
 
-    //populate the LaserScan message
-    sensor_msgs::LaserScan scan;
-    scan.header.stamp = scan_time;
-    scan.header.frame_id = "laser_frame";
+    sensor_msgs::LaserScan& scan = scans[k];
+    scan.header.frame_id = "laser_frame" + suffix;
     scan.angle_min = -1.57;
     scan.angle_max = 1.57;
     scan.angle_increment = 3.14 / num_readings;
     scan.time_increment = (1 / laser_frequency) / (num_readings);
     scan.range_min = 0.0;
-    scan.range_max = 100.0;
-
+    scan.range_max = range_max;
     scan.ranges.resize(num_readings);
-    scan.intensities.resize(num_readings);
-    for(unsigned int i = 0; i < num_readings; ++i){
-      scan.ranges[i] = ranges[i];
-      scan.intensities[i] = intensities[i];
+    scan.intensities.assign(num_readings, 100);
+
+    tf::Transform mount(tf::createQuaternionFromYaw(2 * M_PI * k / num_sensors));
+    mounts.push_back(tf::StampedTransform(mount, ros::Time(), base_frame, scan.header.frame_id));
+  }
+  tf::TransformBroadcaster mount_broadcaster;
+
+  std::mt19937 random;
+  std::normal_distribution<double> noise(0.0, noise_stddev);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  //the noiseless ranges, cast again whenever the obstacles move
+  std::vector<std::vector<float>> clean(num_sensors, std::vector<float>(num_readings));
+  std::vector<Obstacle> obstacles;
+  ros::Time obstacles_time;
+
+  ros::Time report_time = ros::Time::now();
+  int published = 0;
+  ros::Rate r(rate);
+  while(n.ok()){
+    ros::Time scan_time = ros::Time::now();
+
+    if(obstacles_time.isZero() ||
+       (obstacle_period > 0 && (scan_time - obstacles_time).toSec() >= obstacle_period)){
+      obstacles.clear();
+      for(int i = 0; i < num_obstacles; ++i){
+        double distance = obstacle_range * sqrt(uniform(random));
+        double bearing = 2 * M_PI * uniform(random);
+        obstacles.push_back({x + distance * cos(bearing), y + distance * sin(bearing)});
+      }
+      for(int k = 0; k < num_sensors; ++k){
+        for(int i = 0; i < num_readings; ++i){
+          double angle = yaw + 2 * M_PI * k / num_sensors + scans[k].angle_min +
+            i * scans[k].angle_increment;
+          double range = castAtObstacles(obstacles, obstacle_radius, x, y, angle, range_max);
+          if(use_map){
+            range = std::min(range, castInMap(get_map.response.map, x, y, angle, range_max));
+          }
+          clean[k][i] = range;
+        }
+      }
+      obstacles_time = scan_time;
     }
 
-    scan_pub.publish(scan);
-    ++count;
+    for(int k = 0; k < num_sensors; ++k){
+      //a fresh message each time, as subscribers in the process keep what they are handed
+      sensor_msgs::LaserScanPtr scan(new sensor_msgs::LaserScan(scans[k]));
+      scan->header.stamp = scan_time;
+      for(int i = 0; i < num_readings; ++i){
+        float range = clean[k][i];
+        if(dropout_ratio > 0 && uniform(random) < dropout_ratio){
+          range = range_max + 1;
+        }else if(noise_stddev > 0 && range < range_max){
+          range = std::max(0.0, range + noise(random));
+        }
+        scan->ranges[i] = range;
+      }
+      scan_pubs[k].publish(scan);
+      mounts[k].stamp_ = scan_time;
+    }
+    mount_broadcaster.sendTransform(mounts);
+    published += num_sensors;
+
+    if((scan_time - report_time).toSec() >= 10.0){
+      ROS_INFO("Published %.1f scans/s of %d readings",
+               published / (scan_time - report_time).toSec(), num_readings);
+      report_time = scan_time;
+      published = 0;
+    }
     r.sleep();
   }
 }
@@ -34,41 +34,240 @@
 *
 * Author: Eitan Marder-Eppstein
 *********************************************************************/
+// A synthetic depth sensor load: num_sensors sensors on one robot, each publishing a cloud of
+// columns x rows points at rate Hz on cloud (cloud_0, cloud_1, ... for more than one), as a
+// sensor_msgs/PointCloud, or a PointCloud2 with use_cloud2. The rays fan out over fov
+// horizontally and vertical_fov vertically from height above the floor, and end on the floor
+// or on the walls of the map of the static_map service, seen from the robot at (x, y, yaw) in
+// it, each sensor turned by 2 pi / num_sensors from the one before. The walls and the
+// num_obstacles round obstacles of obstacle_radius, scattered within obstacle_range of the
+// robot and scattered anew every obstacle_period seconds (0 to keep them), are as high as the
+// rays reach. Without use_map, the floor and the obstacles are all there is. The ranges get
+// gaussian noise of noise_stddev, and a fraction dropout_ratio of the rays return nothing, as
+// do those reaching range_max. The sensors are published on tf from base_frame.
+//
+// Every message is published as a shared pointer, which roscpp hands to subscribers in the same
+// process (nodelets) without serializing it. Every 10 s, the achieved rate is logged.
 #include <ros/ros.h>
+#include <nav_msgs/GetMap.h>
 #include <sensor_msgs/PointCloud.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <sensor_msgs/point_cloud_conversion.h>
+#include <tf/transform_broadcaster.h>
+#include <tf/transform_datatypes.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Obstacle {
+  double x, y;
+};
+
+// The range along a ray from (x, y) to the first occupied cell of the map, or max_range
+double castInMap(const nav_msgs::OccupancyGrid& map, double x, double y, double angle,
+                 double max_range){
+  double step = map.info.resolution / 2;
+  double dx = cos(angle) * step, dy = sin(angle) * step;
+  double origin_x = map.info.origin.position.x, origin_y = map.info.origin.position.y;
+  for(double range = 0; range < max_range; range += step, x += dx, y += dy){
+    int i = static_cast<int>(floor((x - origin_x) / map.info.resolution));
+    int j = static_cast<int>(floor((y - origin_y) / map.info.resolution));
+    if(i < 0 || j < 0 || i >= static_cast<int>(map.info.width) ||
+       j >= static_cast<int>(map.info.height)){
+      break;
+    }
+    if(map.data[j * map.info.width + i] >= 65){
+      return range;
+    }
+  }
+  return max_range;
+}
+
+// The range along a ray from (x, y) to the nearest obstacle it crosses, or max_range
+double castAtObstacles(const std::vector<Obstacle>& obstacles, double radius, double x, double y,
+                       double angle, double max_range){
+  double c = cos(angle), s = sin(angle);
+  double best = max_range;
+  for(const Obstacle& obstacle : obstacles){
+    double ox = obstacle.x - x, oy = obstacle.y - y;
+    double along = ox * c + oy * s;
+    double across2 = ox * ox + oy * oy - along * along;
+    if(along > 0 && across2 < radius * radius){
+      best = std::min(best, along - sqrt(radius * radius - across2));
+    }
+  }
+  return std::max(best, 0.0);
+}
+
+}  // namespace
 
 int main(int argc, char** argv){
   ros::init(argc, argv, "point_cloud_publisher");
 
   ros::NodeHandle n;
-  ros::Publisher cloud_pub = n.advertise<sensor_msgs::PointCloud>("cloud", 50);
+  ros::NodeHandle pn("~");
+
+  int num_sensors, columns, rows, num_obstacles;
+  double rate, fov, vertical_fov, height, x, y, yaw, noise_stddev, dropout_ratio, range_max;
+  double obstacle_radius, obstacle_range, obstacle_period;
+  bool use_map, use_cloud2;
+  std::string base_frame;
+  pn.param("num_sensors", num_sensors, 1);
+  pn.param("columns", columns, 100);
+  pn.param("rows", rows, 1);
+  pn.param("rate", rate, 1.0);
+  pn.param("fov", fov, 1.5);
+  pn.param("vertical_fov", vertical_fov, 0.8);
+  pn.param("height", height, 0.3);
+  pn.param("range_max", range_max, 5.0);
+  pn.param("use_map", use_map, false);
+  pn.param("use_cloud2", use_cloud2, false);
+  pn.param("x", x, 0.0);
+  pn.param("y", y, 0.0);
+  pn.param("yaw", yaw, 0.0);
+  pn.param("num_obstacles", num_obstacles, 0);
+  pn.param("obstacle_radius", obstacle_radius, 0.2);
+  pn.param("obstacle_range", obstacle_range, 3.0);
+  pn.param("obstacle_period", obstacle_period, 0.0);
+  pn.param("noise_stddev", noise_stddev, 0.0);
+  pn.param("dropout_ratio", dropout_ratio, 0.0);
+  pn.param("base_frame", base_frame, std::string("base_link"));
+  num_sensors = std::max(num_sensors, 1);
+  columns = std::max(columns, 1);
+  rows = std::max(rows, 1);
+
+  nav_msgs::GetMap get_map;
+  if(use_map){
+    ros::service::waitForService("static_map");
+    if(!ros::service::call("static_map", get_map)){
+      ROS_ERROR("Could not get the map from static_map");
+      return 1;
+    }
+  }
+
+  //one sensor per cloud, around the robot
+  std::vector<ros::Publisher> cloud_pubs;
+  std::vector<std::string> frames;
+  std::vector<tf::StampedTransform> mounts;
+  for(int k = 0; k < num_sensors; ++k){
+    std::string suffix = num_sensors > 1 ? "_" + std::to_string(k) : "";
+    if(use_cloud2){
+      cloud_pubs.push_back(n.advertise<sensor_msgs::PointCloud2>("cloud" + suffix, 50));
+    }else{
+      cloud_pubs.push_back(n.advertise<sensor_msgs::PointCloud>("cloud" + suffix, 50));
+    }
+    frames.push_back("sensor_frame" + suffix);
+
+    tf::Transform mount(tf::createQuaternionFromYaw(2 * M_PI * k / num_sensors),
+                        tf::Vector3(0, 0, height));
+    mounts.push_back(tf::StampedTransform(mount, ros::Time(), base_frame, frames[k]));
+  }
+  tf::TransformBroadcaster mount_broadcaster;
+
+  //the direction of every ray, column by column
+  std::vector<double> azimuths(columns), elevations(rows);
+  for(int c = 0; c < columns; ++c){
+    azimuths[c] = columns > 1 ? -fov / 2 + fov * c / (columns - 1) : 0.0;
+  }
+  for(int r = 0; r < rows; ++r){
+    elevations[r] = rows > 1 ? -vertical_fov / 2 + vertical_fov * r / (rows - 1) : 0.0;
+  }
 
-  unsigned int num_points = 100;
+  std::mt19937 random;
+  std::normal_distribution<double> noise(0.0, noise_stddev);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
 
-  int count = 0;
-  ros::Rate r(1.0);
+  //the noiseless range of every ray, cast again whenever the obstacles move
+  std::vector<std::vector<float>> clean(num_sensors, std::vector<float>(columns * rows));
+  std::vector<Obstacle> obstacles;
+  ros::Time obstacles_time;
+
+  ros::Time report_time = ros::Time::now();
+  int published = 0;
+  ros::Rate loop(rate);
   while(n.ok()){
-    sensor_msgs::PointCloud cloud;
-    cloud.header.stamp = ros::Time::now();
-    cloud.header.frame_id = "sensor_frame";
-
-    cloud.points.resize(num_points);
-
-    //we'll also add an intensity channel to the cloud
-    cloud.channels.resize(1);
-    cloud.channels[0].name = "intensities";
-    cloud.channels[0].values.resize(num_points);
-
-    //generate some fake data for our point cloud
-    for(unsigned int i = 0; i < num_points; ++i){
-      cloud.points[i].x = 1 + count;
-      cloud.points[i].y = 2 + count;
-      cloud.points[i].z = 3 + count;
-      cloud.channels[0].values[i] = 100 + count;
+    ros::Time cloud_time = ros::Time::now();
+
+    if(obstacles_time.isZero() ||
+       (obstacle_period > 0 && (cloud_time - obstacles_time).toSec() >= obstacle_period)){
+      obstacles.clear();
+      for(int i = 0; i < num_obstacles; ++i){
+        double distance = obstacle_range * sqrt(uniform(random));
+        double bearing = 2 * M_PI * uniform(random);
+        obstacles.push_back({x + distance * cos(bearing), y + distance * sin(bearing)});
+      }
+      for(int k = 0; k < num_sensors; ++k){
+        for(int c = 0; c < columns; ++c){
+          double angle = yaw + 2 * M_PI * k / num_sensors + azimuths[c];
+          double wall = castAtObstacles(obstacles, obstacle_radius, x, y, angle, range_max);
+          if(use_map){
+            wall = std::min(wall, castInMap(get_map.response.map, x, y, angle, range_max));
+          }
+          for(int r = 0; r < rows; ++r){
+            //the range along the ray to the wall, or to the floor if that is nearer
+            double range = wall / cos(elevations[r]);
+            if(elevations[r] < 0){
+              range = std::min(range, height / sin(-elevations[r]));
+            }
+            clean[k][c * rows + r] = std::min(range, range_max);
+          }
+        }
+      }
+      obstacles_time = cloud_time;
+    }
+
+    for(int k = 0; k < num_sensors; ++k){
+      sensor_msgs::PointCloudPtr cloud(new sensor_msgs::PointCloud);
+      cloud->header.stamp = cloud_time;
+      cloud->header.frame_id = frames[k];
+      cloud->points.reserve(columns * rows);
+
+      //we'll also add an intensity channel to the cloud
+      cloud->channels.resize(1);
+      cloud->channels[0].name = "intensities";
+      cloud->channels[0].values.reserve(columns * rows);
+
+      for(int c = 0; c < columns; ++c){
+        for(int r = 0; r < rows; ++r){
+          double range = clean[k][c * rows + r];
+          if(range >= range_max || (dropout_ratio > 0 && uniform(random) < dropout_ratio)){
+            continue;
+          }
+          if(noise_stddev > 0){
+            range = std::max(0.0, range + noise(random));
+          }
+          geometry_msgs::Point32 point;
+          point.x = range * cos(elevations[r]) * cos(azimuths[c]);
+          point.y = range * cos(elevations[r]) * sin(azimuths[c]);
+          point.z = range * sin(elevations[r]);
+          cloud->points.push_back(point);
+          cloud->channels[0].values.push_back(100);
+        }
+      }
+
+      if(use_cloud2){
+        sensor_msgs::PointCloud2Ptr cloud2(new sensor_msgs::PointCloud2);
+        sensor_msgs::convertPointCloudToPointCloud2(*cloud, *cloud2);
+        cloud_pubs[k].publish(cloud2);
+      }else{
+        cloud_pubs[k].publish(cloud);
+      }
+      mounts[k].stamp_ = cloud_time;
     }
+    mount_broadcaster.sendTransform(mounts);
+    published += num_sensors;
 
-    cloud_pub.publish(cloud);
-    ++count;
-    r.sleep();
+    if((cloud_time - report_time).toSec() >= 10.0){
+      ROS_INFO("Published %.1f clouds/s of up to %d points",
+               published / (cloud_time - report_time).toSec(), columns * rows);
+      report_time = cloud_time;
+      published = 0;
+    }
+    loop.sleep();
   }
 }